@@ -43,6 +43,8 @@ set(SOURCE_FILES
     version.sql
     size_utils.sql
     histogram.sql
+    approx_count_distinct.sql
+    quantile_sketch.sql
     bgw_scheduler.sql
     metadata.sql
     views.sql
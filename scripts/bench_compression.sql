@@ -0,0 +1,73 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Benchmark for the compression algorithms. Reports the compression ratio and
+-- the throughput of compression, of the forward and reverse decompression
+-- iterators and of the bulk decompression, for each algorithm, type and data
+-- distribution, in CSV format for regression tracking. The MB/s are counted
+-- in the uncompressed size. Bulk decompression has null throughput when it
+-- is not supported for the compressed data. Needs a Debug build, which has
+-- the TSL test functions, so the optimizations have to be enabled explicitly:
+--   cmake -DCMAKE_BUILD_TYPE=Debug -DCMAKE_C_FLAGS_DEBUG="-O2 -g" ...
+-- Run it in a database with the extension installed:
+--   psql -X -v fuzzing_dir=$PWD/tsl/test/fuzzing/compression -f scripts/bench_compression.sql
+-- The fuzzing corpora are optional, the path must be absolute because it is
+-- opened by the server.
+
+SELECT format('$libdir/timescaledb-tsl-%s', extversion) AS "TSL_MODULE_PATHNAME"
+FROM pg_extension WHERE extname = 'timescaledb' \gset
+
+CREATE OR REPLACE FUNCTION pg_temp.ts_bench_compression(algo cstring, type regtype,
+    distribution cstring, null_fraction float8, total_rows int, iterations int,
+    OUT rows int8, OUT uncompressed_bytes int8, OUT compressed_bytes int8,
+    OUT compression_ratio float8, OUT result_algorithms text,
+    OUT compress_mb_per_second float8, OUT compress_rows_per_second float8,
+    OUT forward_mb_per_second float8, OUT forward_rows_per_second float8,
+    OUT reverse_mb_per_second float8, OUT reverse_rows_per_second float8,
+    OUT bulk_mb_per_second float8, OUT bulk_rows_per_second float8)
+AS :'TSL_MODULE_PATHNAME', 'ts_bench_compression' LANGUAGE C STRICT;
+
+CREATE OR REPLACE FUNCTION pg_temp.ts_bench_compression_directory(algo cstring, type regtype,
+    path cstring, iterations int,
+    OUT rows int8, OUT uncompressed_bytes int8, OUT compressed_bytes int8,
+    OUT compression_ratio float8, OUT result_algorithms text,
+    OUT compress_mb_per_second float8, OUT compress_rows_per_second float8,
+    OUT forward_mb_per_second float8, OUT forward_rows_per_second float8,
+    OUT reverse_mb_per_second float8, OUT reverse_rows_per_second float8,
+    OUT bulk_mb_per_second float8, OUT bulk_rows_per_second float8)
+AS :'TSL_MODULE_PATHNAME', 'ts_bench_compression_directory' LANGUAGE C STRICT;
+
+\pset format csv
+
+-- Synthetic datasets.
+SELECT algo, type, distribution, null_fraction, b.*
+FROM (VALUES
+    ('deltadelta', 'int8'::regtype),
+    ('deltadelta', 'timestamptz'),
+    ('deltadelta', 'int4'),
+    ('for', 'int8'),
+    ('gorilla', 'float8'),
+    ('alp', 'float8'),
+    ('dictionary', 'text'),
+    ('array', 'text'),
+    ('fsst', 'text'),
+    ('bool', 'bool')) algos(algo, type),
+    unnest(array['constant', 'sequential', 'random', 'low_cardinality']) distribution,
+    unnest(array[0, 0.1]) null_fraction,
+    pg_temp.ts_bench_compression(algo::cstring, type, distribution::cstring, null_fraction,
+        1000000, 10) b
+ORDER BY 1, 2, 3, 4;
+
+-- Datasets from the fuzzing corpora.
+\if :{?fuzzing_dir}
+SELECT algo, type, corpus, b.*
+FROM (VALUES
+    ('deltadelta', 'int8'::regtype, 'deltadelta-int8'),
+    ('gorilla', 'float8', 'gorilla-float8'),
+    ('dictionary', 'text', 'dictionary-text'),
+    ('array', 'text', 'array-text')) corpora(algo, type, corpus),
+    pg_temp.ts_bench_compression_directory(algo::cstring, type,
+        format('%s/%s', :'fuzzing_dir', corpus)::cstring, 10) b
+ORDER BY 1, 2, 3;
+\endif
@@ -0,0 +1,221 @@
+#!/usr/bin/env bash
+
+# Ingest throughput benchmark. Runs pgbench with custom scripts for the
+# combinations of the ingest scenarios, the ingest modes, a unique constraint
+# and an attached continuous aggregate, each in a freshly created database.
+# Reports the ingested rows per second and the p99 statement latency in CSV.
+#
+# The connection is set with the usual PG* environment variables. The COPY
+# modes read server-side files, so the server must run on the same host and
+# the user needs the pg_read_server_files and pg_write_server_files roles.
+#
+# Scenarios (BENCH_SCENARIOS):
+#   ordered            continuous time-ordered ingest into uncompressed chunks
+#   late_compressed    ingest into the time range of compressed chunks
+#   space_partitions   time-ordered ingest with a hash dimension on the device
+#   chunk_boundaries   every batch crosses several chunk boundaries
+#
+# Modes (BENCH_MODES): insert, copy_text, copy_binary
+#
+# Example:
+#   BENCH_SCENARIOS="ordered late_compressed" BENCH_CAGG=0 scripts/bench_ingest.sh
+
+set -eu
+set -o pipefail
+
+BENCH_DB=${BENCH_DB:-ts_bench_ingest}
+BENCH_CLIENTS=${BENCH_CLIENTS:-4}
+BENCH_TRANSACTIONS=${BENCH_TRANSACTIONS:-250}
+BENCH_ROWS=${BENCH_ROWS:-1000}
+BENCH_DEVICES=${BENCH_DEVICES:-100}
+BENCH_SPACE_PARTITIONS=${BENCH_SPACE_PARTITIONS:-16}
+BENCH_SCENARIOS=${BENCH_SCENARIOS:-"ordered late_compressed space_partitions chunk_boundaries"}
+BENCH_MODES=${BENCH_MODES:-"insert copy_text copy_binary"}
+BENCH_UNIQUE=${BENCH_UNIQUE:-"0 1"}
+BENCH_CAGG=${BENCH_CAGG:-"0 1"}
+BENCH_DIR=${BENCH_DIR:-$(mktemp -d -t ts_bench_ingest.XXXXXX)}
+
+PSQL="psql -X -q -v ON_ERROR_STOP=1"
+
+# The batches are numbered from a sequence, one batch per transaction, and the
+# rows of all batches are one second apart, so the ingest is time-ordered
+# across the clients.
+TOTAL_BATCHES=$((BENCH_CLIENTS * BENCH_TRANSACTIONS))
+TOTAL_ROWS=$((TOTAL_BATCHES * BENCH_ROWS))
+
+# The server reads the COPY files and writes them in the setup
+chmod 755 "${BENCH_DIR}"
+
+setup_database() {
+  local scenario=$1 mode=$2 unique=$3 cagg=$4
+
+  # The late data is between the seconds of the data that is loaded and
+  # compressed before the benchmark, so that it doesn't conflict with the
+  # unique constraint.
+  local offset_ms=0 chunk_interval="1 day"
+  case ${scenario} in
+    late_compressed) offset_ms=500 ;;
+    chunk_boundaries) chunk_interval="$((BENCH_ROWS / 4)) seconds" ;;
+  esac
+
+  # The output of the setup is not interesting, only the offset is returned
+  $PSQL -d postgres -c "DROP DATABASE IF EXISTS ${BENCH_DB}" \
+    -c "CREATE DATABASE ${BENCH_DB}" > /dev/null
+
+  $PSQL -d "${BENCH_DB}" \
+    -v scenario="${scenario}" -v mode="${mode}" -v unique="${unique}" -v cagg="${cagg}" \
+    -v chunk_interval="${chunk_interval}" -v offset_ms="${offset_ms}" \
+    -v devices="${BENCH_DEVICES}" -v space_partitions="${BENCH_SPACE_PARTITIONS}" \
+    -v rows="${BENCH_ROWS}" -v total_rows="${TOTAL_ROWS}" \
+    -v total_batches="${TOTAL_BATCHES}" -v dir="${BENCH_DIR}" > /dev/null <<'EOF'
+SET client_min_messages TO warning;
+CREATE EXTENSION timescaledb;
+
+CREATE FUNCTION bench_rows(first_row bigint, nrows int, devices int, offset_ms int)
+RETURNS TABLE (time timestamptz, device int, value float8) LANGUAGE sql AS $$
+    SELECT '2025-01-01'::timestamptz + r * interval '1 second' + offset_ms * interval '1 ms',
+        (r % devices)::int, random()
+    FROM generate_series(first_row, first_row + nrows - 1) r
+$$;
+
+CREATE SEQUENCE bench_batch MINVALUE 0 START 0;
+CREATE TABLE metrics (time timestamptz NOT NULL, device int NOT NULL, value float8);
+SELECT :unique = 1 AS bench_unique, :cagg = 1 AS bench_cagg,
+    :'mode' LIKE 'copy%' AS bench_copy,
+    :'scenario' = 'late_compressed' AS bench_late,
+    :'scenario' = 'space_partitions' AS bench_space \gset
+
+\if :bench_unique
+ALTER TABLE metrics ADD UNIQUE (time, device);
+\endif
+
+SELECT FROM create_hypertable('metrics', 'time', chunk_time_interval => :'chunk_interval'::interval);
+
+\if :bench_space
+SELECT FROM add_dimension('metrics', 'device', number_partitions => :space_partitions);
+\endif
+
+\if :bench_late
+INSERT INTO metrics SELECT * FROM bench_rows(0, :total_rows, :devices, 0);
+ALTER TABLE metrics SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+    timescaledb.compress_orderby = 'time');
+SELECT count(compress_chunk(c)) AS compressed_chunks FROM show_chunks('metrics') c \gset
+\endif
+
+\if :bench_cagg
+CREATE MATERIALIZED VIEW metrics_hourly WITH (timescaledb.continuous) AS
+SELECT time_bucket('1 hour', time) AS bucket, device, avg(value)
+FROM metrics GROUP BY 1, 2 WITH NO DATA;
+-- The ingest below the invalidation threshold is logged as invalidations
+CALL refresh_continuous_aggregate('metrics_hourly', NULL, NULL);
+\endif
+
+-- One file per batch for COPY, with the same rows that the INSERT would add.
+-- The psql variables are not substituted in the DO block, so they are passed
+-- as settings.
+\if :bench_copy
+SELECT set_config('bench.mode', :'mode', false), set_config('bench.dir', :'dir', false),
+    set_config('bench.total_batches', :'total_batches', false),
+    set_config('bench.rows', :'rows', false), set_config('bench.devices', :'devices', false),
+    set_config('bench.offset_ms', :'offset_ms', false);
+DO $$
+DECLARE
+    file_format text := CASE WHEN current_setting('bench.mode') = 'copy_binary' THEN 'binary'
+        ELSE 'text' END;
+    nrows int := current_setting('bench.rows')::int;
+BEGIN
+    FOR batch IN 0 .. current_setting('bench.total_batches')::int - 1 LOOP
+        EXECUTE format('COPY (SELECT * FROM bench_rows(%s, %s, %s, %s)) TO %L WITH (FORMAT %s)',
+            batch::bigint * nrows, nrows, current_setting('bench.devices'),
+            current_setting('bench.offset_ms'),
+            format('%s/batch_%s.%s', current_setting('bench.dir'), batch, file_format),
+            file_format);
+    END LOOP;
+END;
+$$;
+\endif
+
+VACUUM ANALYZE;
+CHECKPOINT;
+EOF
+
+  echo "${offset_ms}"
+}
+
+write_script() {
+  local mode=$1 script=$2
+
+  case ${mode} in
+    insert)
+      cat > "${script}" <<'EOF'
+INSERT INTO metrics
+SELECT * FROM bench_rows(nextval('bench_batch') * :rows, :rows, :devices, :offset_ms);
+EOF
+      ;;
+    copy_text | copy_binary)
+      cat > "${script}" <<'EOF'
+SELECT nextval('bench_batch') AS batch \gset
+COPY metrics FROM ':dir/batch_:batch.:format' WITH (FORMAT :format);
+EOF
+      ;;
+    *)
+      echo "unknown mode ${mode}" >&2
+      exit 1
+      ;;
+  esac
+}
+
+# The 99th percentile of the transaction latencies in the pgbench logs, in
+# milliseconds. The latency in microseconds is the third field.
+p99_latency_ms() {
+  cat "$@" | awk '{ print $3 }' | sort -n | awk '
+    { latency[NR] = $1 }
+    END {
+      index99 = int(NR * 0.99 + 0.5)
+      if (index99 < 1) index99 = 1
+      printf "%.3f", latency[index99] / 1000
+    }'
+}
+
+echo "scenario,mode,unique,cagg,rows_per_second,p99_latency_ms"
+
+for scenario in ${BENCH_SCENARIOS}; do
+  for mode in ${BENCH_MODES}; do
+    for unique in ${BENCH_UNIQUE}; do
+      for cagg in ${BENCH_CAGG}; do
+        offset_ms=$(setup_database "${scenario}" "${mode}" "${unique}" "${cagg}")
+
+        format=text
+        if [ "${mode}" == copy_binary ]; then
+          format=binary
+        fi
+
+        script="${BENCH_DIR}/${mode}.sql"
+        write_script "${mode}" "${script}"
+
+        logdir="${BENCH_DIR}/log"
+        rm -rf "${logdir}"
+        mkdir "${logdir}"
+
+        # Only the time of the transactions counts, not the connection setup
+        output=$(pgbench -n -d "${BENCH_DB}" -c "${BENCH_CLIENTS}" -j "${BENCH_CLIENTS}" \
+          -t "${BENCH_TRANSACTIONS}" -f "${script}" \
+          -D rows="${BENCH_ROWS}" -D devices="${BENCH_DEVICES}" -D offset_ms="${offset_ms}" \
+          -D dir="${BENCH_DIR}" -D format="${format}" \
+          -l --log-prefix="${logdir}/pgbench_log" 2>&1)
+
+        tps=$(echo "${output}" | sed -n 's/^tps = \([0-9.]*\) (without initial connection time)$/\1/p')
+        if [ -z "${tps}" ]; then
+          echo "${output}" >&2
+          exit 1
+        fi
+
+        rows_per_second=$(awk -v tps="${tps}" -v rows="${BENCH_ROWS}" 'BEGIN { printf "%d", tps * rows }')
+        echo "${scenario},${mode},${unique},${cagg},${rows_per_second},$(p99_latency_ms "${logdir}"/pgbench_log.*)"
+      done
+    done
+  done
+done
+
+$PSQL -d postgres -c "DROP DATABASE IF EXISTS ${BENCH_DB}"
+rm -rf "${BENCH_DIR:?}"/batch_* "${BENCH_DIR:?}"/log
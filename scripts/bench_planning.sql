@@ -0,0 +1,158 @@
+-- This file and its contents are licensed under the Apache License 2.0.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-APACHE for a copy of the license.
+
+-- Benchmark for the planning latency of hypertables by the number of chunks.
+-- Creates hypertables with the given numbers of chunks, with and without a
+-- space dimension and compression, and reports the median planning and
+-- execution time of point, range, ORDER BY LIMIT and aggregate queries, and
+-- the memory used for planning (PG17 and later), in CSV format for regression
+-- tracking. The queries that cannot exclude chunks lock all of them, so the
+-- lock table has to be large enough for the largest hypertable, for example:
+--   max_locks_per_transaction = 4096
+-- Run it in a database with the extension installed:
+--   psql -X -v chunk_counts='{100,1000,10000,100000}' -f scripts/bench_planning.sql
+-- Creating the hypertables with 100k chunks takes a while.
+
+\set ON_ERROR_STOP 1
+
+\if :{?chunk_counts}
+\else
+\set chunk_counts '{100,1000,10000,100000}'
+\endif
+
+\if :{?repeats}
+\else
+\set repeats 5
+\endif
+
+SET client_min_messages TO warning;
+DROP SCHEMA IF EXISTS bench_planning CASCADE;
+CREATE SCHEMA bench_planning;
+
+CREATE TABLE bench_planning.results (chunks int, space bool, compressed bool, query text,
+    planning_ms float8, execution_ms float8, planning_memory_kb float8);
+
+-- One hour per chunk and 16 devices, which are hashed into 4 partitions for
+-- the space dimension. The chunks are created and compressed in separate
+-- transactions, so that their locks don't overflow the lock table.
+CREATE PROCEDURE bench_planning.create(tab name, chunks int, space bool, compressed bool)
+LANGUAGE plpgsql AS $$
+DECLARE
+    rel text := format('bench_planning.%I', tab);
+    time_chunks int := CASE WHEN space THEN chunks / 4 ELSE chunks END;
+    chunk regclass;
+BEGIN
+    EXECUTE format('CREATE TABLE %s (time timestamptz NOT NULL, device int NOT NULL, '
+        'value float8)', rel);
+    PERFORM create_hypertable(rel::regclass, 'time', chunk_time_interval => interval '1 hour');
+    IF space THEN
+        PERFORM add_dimension(rel::regclass, 'device', number_partitions => 4);
+    END IF;
+    COMMIT;
+
+    FOR first_hour IN 0 .. time_chunks - 1 BY 1000 LOOP
+        EXECUTE format('INSERT INTO %s SELECT ''2000-01-01''::timestamptz + h * interval ''1 hour'' '
+            '+ d * interval ''1 minute'', d, random() '
+            'FROM generate_series(%s, %s) h, generate_series(0, 15) d',
+            rel, first_hour, least(first_hour + 999, time_chunks - 1));
+        COMMIT;
+    END LOOP;
+
+    IF compressed THEN
+        EXECUTE format('ALTER TABLE %s SET (timescaledb.compress, '
+            'timescaledb.compress_segmentby = ''device'', timescaledb.compress_orderby = ''time'')',
+            rel);
+        COMMIT;
+        FOR chunk IN SELECT show_chunks(rel::regclass) LOOP
+            PERFORM compress_chunk(chunk);
+            COMMIT;
+        END LOOP;
+    END IF;
+
+    EXECUTE format('ANALYZE %s', rel);
+END;
+$$;
+
+-- The median planning and execution time of the query. The first run fills
+-- the caches and is not counted.
+CREATE FUNCTION bench_planning.explain(query text, repeats int, OUT planning_ms float8,
+    OUT execution_ms float8, OUT planning_memory_kb float8)
+LANGUAGE plpgsql AS $$
+DECLARE
+    options text := 'ANALYZE, SUMMARY, FORMAT JSON';
+    plan json;
+    planning float8[] := '{}';
+    execution float8[] := '{}';
+BEGIN
+    IF current_setting('server_version_num')::int >= 170000 THEN
+        options := options || ', MEMORY';
+    END IF;
+
+    FOR i IN 0 .. repeats LOOP
+        EXECUTE format('EXPLAIN (%s) %s', options, query) INTO plan;
+        IF i > 0 THEN
+            planning := planning || (plan->0->>'Planning Time')::float8;
+            execution := execution || (plan->0->>'Execution Time')::float8;
+        END IF;
+    END LOOP;
+
+    SELECT percentile_cont(0.5) WITHIN GROUP (ORDER BY p) INTO planning_ms FROM unnest(planning) p;
+    SELECT percentile_cont(0.5) WITHIN GROUP (ORDER BY e) INTO execution_ms FROM unnest(execution) e;
+    planning_memory_kb := (plan->0->'Planning'->>'Memory Used')::float8 / 1024;
+END;
+$$;
+
+-- Each query runs in its own transaction, so that the locks of the chunks
+-- are released in between.
+CREATE PROCEDURE bench_planning.run(tab name, chunks int, space bool, compressed bool,
+    repeats int)
+LANGUAGE plpgsql AS $$
+DECLARE
+    rel text := format('bench_planning.%I', tab);
+    middle timestamptz := '2000-01-01'::timestamptz
+        + (CASE WHEN space THEN chunks / 4 ELSE chunks END) / 2 * interval '1 hour';
+    query record;
+BEGIN
+    FOR query IN
+        SELECT * FROM (VALUES
+            ('point', format('SELECT * FROM %s WHERE time = %L AND device = 0', rel, middle)),
+            ('range', format('SELECT * FROM %s WHERE time >= %L AND time < %L', rel, middle,
+                middle + interval '12 hours')),
+            ('order_by_limit', format('SELECT * FROM %s ORDER BY time DESC LIMIT 10', rel)),
+            ('aggregate',
+                format('SELECT device, count(*), avg(value) FROM %s GROUP BY device', rel))
+        ) queries(name, sql)
+    LOOP
+        INSERT INTO bench_planning.results
+        SELECT chunks, space, compressed, query.name, e.*
+        FROM bench_planning.explain(query.sql, repeats) e;
+        COMMIT;
+    END LOOP;
+END;
+$$;
+
+SELECT format('CALL bench_planning.create(%L, %s, %s, %s)', tab, chunks, space, compressed),
+    format('CALL bench_planning.run(%L, %s, %s, %s, %s)', tab, chunks, space, compressed,
+        :repeats)
+FROM (SELECT format('t_%s%s%s', chunks, CASE WHEN space THEN '_space' ELSE '' END,
+        CASE WHEN compressed THEN '_compressed' ELSE '' END) AS tab, chunks, space, compressed
+    FROM unnest(:'chunk_counts'::int[]) chunks, unnest(array[false, true]) space,
+        unnest(array[false, true]) compressed) configs
+ORDER BY chunks, space, compressed \gexec
+
+RESET client_min_messages;
+\pset format csv
+
+SELECT chunks, space, compressed, query, round(planning_ms::numeric, 3) AS planning_ms,
+    round(execution_ms::numeric, 3) AS execution_ms,
+    round(planning_memory_kb::numeric, 1) AS planning_memory_kb
+FROM bench_planning.results
+ORDER BY chunks, space, compressed, query;
+
+\pset format aligned
+
+-- Drop the hypertables one by one, for the same reason as above
+SELECT format('DROP TABLE %s', oid::regclass) FROM pg_class
+WHERE relnamespace = 'bench_planning'::regnamespace AND relkind = 'r' \gexec
+DROP SCHEMA bench_planning CASCADE;
@@ -0,0 +1,39 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Microbenchmark for the vectorized sum(), min() and max() over one batch.
+-- Reports the aggregated rows per second and the nanoseconds per row for each
+-- argument type and null fraction. Needs a Debug build, which has the TSL test
+-- functions, so the optimizations have to be enabled explicitly:
+--   cmake -DCMAKE_BUILD_TYPE=Debug -DCMAKE_C_FLAGS_DEBUG="-O2 -g" ...
+-- Run it in a database with the extension installed:
+--   psql -X -f scripts/bench_vector_agg.sql
+
+SELECT format('$libdir/timescaledb-tsl-%s', extversion) AS "TSL_MODULE_PATHNAME"
+FROM pg_extension WHERE extname = 'timescaledb' \gset
+
+CREATE OR REPLACE FUNCTION pg_temp.ts_bench_vector_agg(agg regprocedure, argtype regtype,
+    null_fraction float8, total_rows int)
+RETURNS float8 AS :'TSL_MODULE_PATHNAME', 'ts_bench_vector_agg' LANGUAGE C STRICT;
+
+-- Warm up.
+SELECT pg_temp.ts_bench_vector_agg('sum(int4)', 'int4', 0, 10000000);
+
+SELECT function, type, null_fraction, round(rows_per_second / 1e6) AS mrows_per_second,
+    round((1e9 / rows_per_second)::numeric, 3) AS ns_per_row
+FROM (SELECT agg::regproc AS function, argtype AS type, null_fraction,
+    pg_temp.ts_bench_vector_agg(agg, argtype, null_fraction, 100000000) AS rows_per_second
+FROM (VALUES
+    ('sum(int2)'::regprocedure, 'int2'::regtype),
+    ('sum(int4)', 'int4'),
+    ('sum(float4)', 'float4'),
+    ('sum(float8)', 'float8'),
+    ('min(int4)', 'int4'),
+    ('min(int8)', 'int8'),
+    ('min(float8)', 'float8'),
+    ('max(int8)', 'int8'),
+    ('max(float8)', 'float8'),
+    ('max(timestamptz)', 'timestamptz')) functions(agg, argtype),
+    unnest(array[0, 0.01, 0.5, 0.99]) null_fraction) results
+ORDER BY 1, 2, 3;
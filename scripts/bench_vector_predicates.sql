@@ -0,0 +1,52 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Microbenchmark for the vectorized predicates with a constant argument.
+-- Reports the nanoseconds per row for each operator, null fraction and
+-- selectivity. The selectivity applies to the "<" operators, the other
+-- operators compare with the same constant. Needs a Debug build, which has the
+-- TSL test functions, so the optimizations have to be enabled explicitly:
+--   cmake -DCMAKE_BUILD_TYPE=Debug -DCMAKE_C_FLAGS_DEBUG="-O2 -g" ...
+-- Run it in a database with the extension installed:
+--   psql -X -f scripts/bench_vector_predicates.sql
+
+SELECT format('$libdir/timescaledb-tsl-%s', extversion) AS "TSL_MODULE_PATHNAME"
+FROM pg_extension WHERE extname = 'timescaledb' \gset
+
+CREATE OR REPLACE FUNCTION pg_temp.ts_bench_vector_predicate(op regoperator,
+    null_fraction float8, selectivity float8, batch_rows int, total_rows int)
+RETURNS float8 AS :'TSL_MODULE_PATHNAME', 'ts_bench_vector_predicate' LANGUAGE C STRICT;
+
+-- Warm up.
+SELECT pg_temp.ts_bench_vector_predicate('<(int4,int4)', 0, 0.5, 1000, 10000000);
+
+SELECT op AS operator, null_fraction, selectivity,
+    round(pg_temp.ts_bench_vector_predicate(op, null_fraction, selectivity, 1000,
+        100000000)::numeric, 3) AS ns_per_row
+FROM unnest(array[
+    '<(int4,int4)'::regoperator,
+    '=(int4,int4)',
+    '<(int8,int8)',
+    '=(int8,int8)',
+    '<(int8,int4)',
+    '<(float4,float4)',
+    '<(float8,float8)',
+    '=(float8,float8)',
+    '<(timestamptz,timestamptz)',
+    '<(int2,int2)']) op,
+    unnest(array[0, 0.5]) null_fraction,
+    unnest(array[0.01, 0.5, 0.99]) selectivity
+ORDER BY 1, 2, 3;
+
+-- The text predicates are slower, so run them on fewer rows.
+SELECT op AS operator, null_fraction,
+    round(pg_temp.ts_bench_vector_predicate(op, null_fraction, 0.5, 1000,
+        10000000)::numeric, 3) AS ns_per_row
+FROM unnest(array[
+    '=(text,text)'::regoperator,
+    '<>(text,text)',
+    '~~(text,text)',
+    '!~~(text,text)']) op,
+    unnest(array[0, 0.5]) null_fraction
+ORDER BY 1, 2;
@@ -0,0 +1,41 @@
+-- This file and its contents are licensed under the Apache License 2.0.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-APACHE for a copy of the license.
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.hll_sfunc(state INTERNAL, val ANYELEMENT)
+RETURNS INTERNAL
+AS '@MODULE_PATHNAME@', 'ts_hll_sfunc'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.hll_combinefunc(state1 INTERNAL, state2 INTERNAL)
+RETURNS INTERNAL
+AS '@MODULE_PATHNAME@', 'ts_hll_combinefunc'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.hll_serializefunc(INTERNAL)
+RETURNS bytea
+AS '@MODULE_PATHNAME@', 'ts_hll_serializefunc'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.hll_deserializefunc(bytea, INTERNAL)
+RETURNS INTERNAL
+AS '@MODULE_PATHNAME@', 'ts_hll_deserializefunc'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.hll_finalfunc(state INTERNAL)
+RETURNS BIGINT
+AS '@MODULE_PATHNAME@', 'ts_hll_finalfunc'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Approximate number of distinct non-null values, estimated with a HyperLogLog
+-- sketch. The standard error of the estimate is about 1.6%. The values are
+-- compared by their binary representation.
+CREATE OR REPLACE AGGREGATE @extschema@.approx_count_distinct(ANYELEMENT) (
+    SFUNC = _timescaledb_functions.hll_sfunc,
+    STYPE = INTERNAL,
+    COMBINEFUNC = _timescaledb_functions.hll_combinefunc,
+    SERIALFUNC = _timescaledb_functions.hll_serializefunc,
+    DESERIALFUNC = _timescaledb_functions.hll_deserializefunc,
+    PARALLEL = SAFE,
+    FINALFUNC = _timescaledb_functions.hll_finalfunc
+);
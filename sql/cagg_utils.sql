@@ -12,6 +12,12 @@ CREATE OR REPLACE FUNCTION _timescaledb_functions.cagg_validate_query(
     OUT error_hint TEXT
 ) RETURNS RECORD AS '@MODULE_PATHNAME@', 'ts_continuous_agg_validate_query' LANGUAGE C STRICT VOLATILE;
 
+-- Merge the overlapping and adjacent entries in the hypertable invalidation
+-- log of a hypertable. Returns the number of entries removed from the log.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.cagg_compact_invalidation_log(
+    hypertable REGCLASS
+) RETURNS BIGINT AS '@MODULE_PATHNAME@', 'ts_continuous_agg_compact_invalidation_log' LANGUAGE C STRICT VOLATILE;
+
 CREATE OR REPLACE FUNCTION _timescaledb_functions.cagg_get_bucket_function_info(
     mat_hypertable_id INTEGER,
     -- The bucket function
@@ -21,6 +21,17 @@ CREATE OR REPLACE FUNCTION _timescaledb_functions.calculate_chunk_interval(
         chunk_target_size BIGINT
 ) RETURNS BIGINT AS '@MODULE_PATHNAME@', 'ts_calculate_chunk_interval' LANGUAGE C;
 
+-- Calculate the next chunk interval like calculate_chunk_interval, but
+-- take the range of the recent chunks from their column statistics when
+-- those are up to date instead of scanning the chunks, and measure the
+-- chunks by their size after compression. Can be used as the
+-- chunk_sizing_func of set_adaptive_chunking.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.calculate_chunk_interval_from_stats(
+        dimension_id INTEGER,
+        dimension_coord BIGINT,
+        chunk_target_size BIGINT
+) RETURNS BIGINT AS '@MODULE_PATHNAME@', 'ts_calculate_chunk_interval_from_stats' LANGUAGE C;
+
 -- Get the status of the chunk
 CREATE OR REPLACE FUNCTION _timescaledb_functions.chunk_status(REGCLASS) RETURNS INT
 AS '@MODULE_PATHNAME@', 'ts_chunk_status' LANGUAGE C;
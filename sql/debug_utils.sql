@@ -14,3 +14,82 @@ AS '@MODULE_PATHNAME@', 'ts_is_compressed_tid' LANGUAGE C STRICT;
 
 GRANT EXECUTE ON FUNCTION _timescaledb_debug.is_compressed_tid TO PUBLIC;
 
+-- The arrow cache statistics of the current backend, accumulated for all
+-- queries on Hypercore tables since the backend start.
+CREATE OR REPLACE FUNCTION _timescaledb_debug.hypercore_arrow_cache_stats(
+    OUT hits BIGINT,
+    OUT misses BIGINT,
+    OUT evictions BIGINT,
+    OUT shared_hits BIGINT,
+    OUT decompressions BIGINT,
+    OUT decompress_calls BIGINT
+) RETURNS RECORD
+AS '@MODULE_PATHNAME@', 'ts_hypercore_arrow_cache_stats' LANGUAGE C STRICT;
+
+GRANT EXECUTE ON FUNCTION _timescaledb_debug.hypercore_arrow_cache_stats TO PUBLIC;
+
+
+-- The number of calls and the time in milliseconds spent in the stages of the
+-- TimescaleDB planner hooks in the current backend since the backend start.
+-- The timing is only done when timescaledb.enable_planner_stats is on.
+CREATE OR REPLACE FUNCTION _timescaledb_debug.planner_stats(
+    OUT stage TEXT,
+    OUT calls BIGINT,
+    OUT total_time DOUBLE PRECISION
+) RETURNS SETOF RECORD
+AS '@MODULE_PATHNAME@', 'ts_planner_stats' LANGUAGE C STRICT;
+
+GRANT EXECUTE ON FUNCTION _timescaledb_debug.planner_stats TO PUBLIC;
+
+-- The time in milliseconds spent in initializing TimescaleDB in the current
+-- backend: the init function of the library, and loading and initializing the
+-- TSL module. The TSL times are NULL if the module is not loaded yet, which
+-- with timescaledb.enable_lazy_tsl_load is only done on first use.
+CREATE OR REPLACE FUNCTION _timescaledb_debug.init_stats(
+    OUT stage TEXT,
+    OUT total_time DOUBLE PRECISION
+) RETURNS SETOF RECORD
+AS '@MODULE_PATHNAME@', 'ts_init_stats' LANGUAGE C STRICT;
+
+GRANT EXECUTE ON FUNCTION _timescaledb_debug.init_stats TO PUBLIC;
+
+-- The usage of the metadata caches in the current backend since the backend
+-- start. The entries and the allocated memory in bytes are NULL for the
+-- caches that are created per hypertable or per statement:
+--
+-- hypertable_cache: the hypertables and their dimensions
+-- chunk_cache: the chunks looked up by relid or id
+-- hypertable_chunk_store: the chunks cached per hypertable for tuple
+--   routing, limited by timescaledb.max_cached_chunks_per_hypertable
+-- chunk_insert_state_cache: the chunks open for insert per statement,
+--   limited by timescaledb.max_open_chunks_per_insert and
+--   timescaledb.max_open_chunks_memory_per_insert
+-- compression_settings_cache: the compression settings of hypertables and
+--   chunks
+-- watermark_cache: the watermarks of continuous aggregates, used with READ
+--   COMMITTED
+CREATE OR REPLACE FUNCTION _timescaledb_debug.cache_stats(
+    OUT cache_name TEXT,
+    OUT entries BIGINT,
+    OUT hits BIGINT,
+    OUT misses BIGINT,
+    OUT evictions BIGINT,
+    OUT invalidations BIGINT,
+    OUT memory_bytes BIGINT
+) RETURNS SETOF RECORD
+AS '@MODULE_PATHNAME@', 'ts_cache_stats' LANGUAGE C STRICT;
+
+GRANT EXECUTE ON FUNCTION _timescaledb_debug.cache_stats TO PUBLIC;
+
+-- The memory contexts and the memory in bytes allocated and used by the
+-- subsystems in the current backend. The memory of the contexts that don't
+-- belong to a TimescaleDB subsystem is reported as "other".
+CREATE OR REPLACE FUNCTION _timescaledb_debug.memory_usage(
+    OUT subsystem TEXT,
+    OUT contexts BIGINT,
+    OUT total_bytes BIGINT,
+    OUT used_bytes BIGINT
+) RETURNS SETOF RECORD
+AS '@MODULE_PATHNAME@', 'ts_memory_usage' LANGUAGE C STRICT;
+
+GRANT EXECUTE ON FUNCTION _timescaledb_debug.memory_usage TO PUBLIC;
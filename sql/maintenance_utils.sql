@@ -32,6 +32,13 @@ CREATE OR REPLACE FUNCTION _timescaledb_functions.create_compressed_chunk(
     numrows_post_compression BIGINT
 ) RETURNS REGCLASS AS '@MODULE_PATHNAME@', 'ts_create_compressed_chunk' LANGUAGE C STRICT VOLATILE;
 
+-- Check whether the value might be present in a compressed batch, using the
+-- bloom filter sparse index of the batch.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.bloom1_contains(
+    bloom BYTEA,
+    value ANYELEMENT
+) RETURNS BOOL AS '@MODULE_PATHNAME@', 'ts_bloom1_contains' LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
 CREATE OR REPLACE FUNCTION @extschema@.compress_chunk(
     uncompressed_chunk REGCLASS,
     if_not_compressed BOOLEAN = true,
@@ -57,6 +64,14 @@ CREATE OR REPLACE PROCEDURE @extschema@.convert_to_rowstore(
     if_columnstore BOOLEAN = true
 ) AS '@MODULE_PATHNAME@', 'ts_decompress_chunk' LANGUAGE C;
 
+-- Export the rows of a hypertable, chunk or table as the messages of an
+-- Arrow IPC stream, which is the concatenation of the returned messages.
+CREATE OR REPLACE FUNCTION @extschema@.export_arrow_ipc(
+    relation REGCLASS,
+    columns NAME[] = NULL,
+    chunks REGCLASS[] = NULL
+) RETURNS SETOF BYTEA AS '@MODULE_PATHNAME@', 'ts_export_arrow_ipc' LANGUAGE C VOLATILE;
+
 CREATE OR REPLACE PROCEDURE @extschema@.merge_chunks(
    chunk1 REGCLASS, chunk2 REGCLASS
 ) LANGUAGE C AS '@MODULE_PATHNAME@', 'ts_merge_two_chunks';
@@ -70,6 +85,35 @@ CREATE OR REPLACE FUNCTION _timescaledb_functions.recompress_chunk_segmentwise(
     if_compressed BOOLEAN = true
 ) RETURNS REGCLASS AS '@MODULE_PATHNAME@', 'ts_recompress_chunk_segmentwise' LANGUAGE C STRICT VOLATILE;
 
+-- Compress at most slice_rows rows of a chunk. Returns true if the chunk
+-- still has rows left to compress.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.compress_chunk_slice(
+    chunk REGCLASS,
+    slice_rows BIGINT
+) RETURNS BOOL AS '@MODULE_PATHNAME@', 'ts_compress_chunk_slice' LANGUAGE C STRICT VOLATILE;
+
+-- Compress a chunk in slices of slice_rows rows, committing after each
+-- slice. This bounds the extra disk space needed while compressing a large
+-- chunk, since the space of the compressed rows can be reclaimed by vacuum
+-- between the slices. The bound depends on (auto)vacuum processing the chunk
+-- while the procedure runs: until vacuum removes the compressed rows, the
+-- chunk keeps its size and the compressed data needs additional space. Note
+-- that this procedure cannot be executed in an explicit transaction since it
+-- contains transaction control commands.
+--
+-- Parameters:
+--   chunk: Chunk to compress.
+--   slice_rows: Number of rows to compress in each transaction.
+CREATE OR REPLACE PROCEDURE @extschema@.compress_chunk_incremental(
+    chunk REGCLASS,
+    slice_rows BIGINT = 1000000
+) LANGUAGE PLPGSQL AS $$
+BEGIN
+  WHILE _timescaledb_functions.compress_chunk_slice(chunk, slice_rows) LOOP
+    COMMIT;
+  END LOOP;
+END$$;
+
 -- find the index on the compressed chunk that can be used to recompress efficiently
 -- this index must contain all the segmentby columns and the meta_sequence_number column last
 CREATE OR REPLACE FUNCTION _timescaledb_functions.get_compressed_chunk_index_for_recompression(
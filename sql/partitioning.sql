@@ -10,3 +10,17 @@ CREATE OR REPLACE FUNCTION _timescaledb_functions.get_partition_for_key(val anye
 CREATE OR REPLACE FUNCTION _timescaledb_functions.get_partition_hash(val anyelement)
     RETURNS int
     AS '@MODULE_PATHNAME@', 'ts_get_partition_hash' LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- UUIDv7 functions. A uuid column as an open dimension is partitioned on
+-- the timestamp of its UUIDv7 values.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.timestamptz_from_uuid_v7(val uuid)
+    RETURNS timestamptz
+    AS '@MODULE_PATHNAME@', 'ts_timestamptz_from_uuid_v7' LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.uuid_v7_from_timestamptz(ts timestamptz)
+    RETURNS uuid
+    AS '@MODULE_PATHNAME@', 'ts_uuid_v7_from_timestamptz' LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.generate_uuid_v7()
+    RETURNS uuid
+    AS '@MODULE_PATHNAME@', 'ts_uuid_generate_v7' LANGUAGE C VOLATILE PARALLEL SAFE;
@@ -44,6 +44,45 @@ CREATE OR REPLACE FUNCTION @extschema@.remove_reorder_policy(hypertable REGCLASS
 AS '@MODULE_PATHNAME@', 'ts_policy_reorder_remove'
 LANGUAGE C VOLATILE STRICT;
 
+/* chunk precreation policy */
+-- Create the chunks for the current chunk interval and the given number of
+-- intervals after it ahead of time, so that the inserts don't have to wait
+-- for the chunk creation when crossing a chunk boundary. On hypertables with
+-- space partitioning, the chunks are created for all the partitions.
+CREATE OR REPLACE FUNCTION @extschema@.add_chunk_precreation_policy(
+    hypertable REGCLASS,
+    chunks_ahead INTEGER = 2,
+    if_not_exists BOOL = false,
+    schedule_interval INTERVAL = NULL,
+    initial_start TIMESTAMPTZ = NULL,
+    timezone TEXT = NULL
+) RETURNS INTEGER
+AS '@MODULE_PATHNAME@', 'ts_policy_precreate_chunks_add'
+LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION @extschema@.remove_chunk_precreation_policy(hypertable REGCLASS, if_exists BOOL = false) RETURNS VOID
+AS '@MODULE_PATHNAME@', 'ts_policy_precreate_chunks_remove'
+LANGUAGE C VOLATILE STRICT;
+
+/* merge chunks policy */
+-- Merge adjacent chunks that are smaller than target_size (e.g., '1GB') into
+-- chunks of up to target_size. Only chunks that end before the current time
+-- are merged, and compressed chunks are merged without decompressing them.
+CREATE OR REPLACE FUNCTION @extschema@.add_merge_chunks_policy(
+    hypertable REGCLASS,
+    target_size TEXT,
+    if_not_exists BOOL = false,
+    schedule_interval INTERVAL = NULL,
+    initial_start TIMESTAMPTZ = NULL,
+    timezone TEXT = NULL
+) RETURNS INTEGER
+AS '@MODULE_PATHNAME@', 'ts_policy_merge_chunks_add'
+LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION @extschema@.remove_merge_chunks_policy(hypertable REGCLASS, if_exists BOOL = false) RETURNS VOID
+AS '@MODULE_PATHNAME@', 'ts_policy_merge_chunks_remove'
+LANGUAGE C VOLATILE STRICT;
+
 /* compression policy */
 CREATE OR REPLACE FUNCTION @extschema@.add_compression_policy(
     hypertable REGCLASS,
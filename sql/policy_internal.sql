@@ -10,6 +10,14 @@ CREATE OR REPLACE FUNCTION _timescaledb_functions.policy_retention_check(config
 RETURNS void AS '@MODULE_PATHNAME@', 'ts_policy_retention_check'
 LANGUAGE C;
 
+CREATE OR REPLACE PROCEDURE _timescaledb_functions.policy_retention_batch(job_id INTEGER, config JSONB)
+AS '@MODULE_PATHNAME@', 'ts_policy_retention_batch_proc'
+LANGUAGE C;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.policy_retention_batch_check(config JSONB)
+RETURNS void AS '@MODULE_PATHNAME@', 'ts_policy_retention_batch_check'
+LANGUAGE C;
+
 CREATE OR REPLACE PROCEDURE _timescaledb_functions.policy_reorder(job_id INTEGER, config JSONB)
 AS '@MODULE_PATHNAME@', 'ts_policy_reorder_proc'
 LANGUAGE C;
@@ -18,6 +26,22 @@ CREATE OR REPLACE FUNCTION _timescaledb_functions.policy_reorder_check(config JS
 RETURNS void AS '@MODULE_PATHNAME@', 'ts_policy_reorder_check'
 LANGUAGE C;
 
+CREATE OR REPLACE PROCEDURE _timescaledb_functions.policy_precreate_chunks(job_id INTEGER, config JSONB)
+AS '@MODULE_PATHNAME@', 'ts_policy_precreate_chunks_proc'
+LANGUAGE C;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.policy_precreate_chunks_check(config JSONB)
+RETURNS void AS '@MODULE_PATHNAME@', 'ts_policy_precreate_chunks_check'
+LANGUAGE C;
+
+CREATE OR REPLACE PROCEDURE _timescaledb_functions.policy_merge_chunks(job_id INTEGER, config JSONB)
+AS '@MODULE_PATHNAME@', 'ts_policy_merge_chunks_proc'
+LANGUAGE C;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.policy_merge_chunks_check(config JSONB)
+RETURNS void AS '@MODULE_PATHNAME@', 'ts_policy_merge_chunks_check'
+LANGUAGE C;
+
 CREATE OR REPLACE PROCEDURE _timescaledb_functions.policy_recompression(job_id INTEGER, config JSONB)
 AS '@MODULE_PATHNAME@', 'ts_policy_recompression_proc'
 LANGUAGE C;
@@ -26,6 +50,19 @@ CREATE OR REPLACE FUNCTION _timescaledb_functions.policy_compression_check(confi
 RETURNS void AS '@MODULE_PATHNAME@', 'ts_policy_compression_check'
 LANGUAGE C;
 
+-- Compress the chunks in parallel workers, each chunk in its own transaction.
+-- Returns the number of chunks that failed to compress, or NULL if no worker
+-- could be started. No chunks are started after the deadline.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.policy_compression_execute_parallel(
+  job_id                      INTEGER,
+  chunks                      REGCLASS[],
+  max_parallel_chunks         INTEGER,
+  verbose_log                 BOOLEAN,
+  hypercore_use_access_method BOOLEAN,
+  deadline                    TIMESTAMPTZ = NULL)
+RETURNS INTEGER AS '@MODULE_PATHNAME@', 'ts_policy_compression_execute_parallel'
+LANGUAGE C VOLATILE;
+
 CREATE OR REPLACE PROCEDURE _timescaledb_functions.policy_refresh_continuous_aggregate(job_id INTEGER, config JSONB)
 AS '@MODULE_PATHNAME@', 'ts_policy_refresh_cagg_proc'
 LANGUAGE C;
@@ -34,6 +71,34 @@ CREATE OR REPLACE FUNCTION _timescaledb_functions.policy_refresh_continuous_aggr
 RETURNS void AS '@MODULE_PATHNAME@', 'ts_policy_refresh_cagg_check'
 LANGUAGE C;
 
+-- Compact the hypertable invalidation logs of all hypertables with
+-- continuous aggregates, one hypertable per transaction. The job is not
+-- scheduled by default, add it with add_job() for hypertables that get a
+-- lot of backfill between the refreshes.
+CREATE OR REPLACE PROCEDURE _timescaledb_functions.policy_compact_invalidation_logs(job_id INTEGER, config JSONB)
+AS $$
+DECLARE
+  htoid       REGCLASS;
+  numrows     BIGINT;
+BEGIN
+  -- procedures with SET clause cannot execute transaction
+  -- control so we adjust search_path in procedure body
+  SET LOCAL search_path TO pg_catalog, pg_temp;
+
+  FOR htoid IN
+    SELECT format('%I.%I', h.schema_name, h.table_name)
+    FROM _timescaledb_catalog.continuous_aggs_invalidation_threshold t
+      INNER JOIN _timescaledb_catalog.hypertable h ON h.id = t.hypertable_id
+    ORDER BY h.id
+  LOOP
+    numrows := _timescaledb_functions.cagg_compact_invalidation_log(htoid);
+    COMMIT;
+    SET LOCAL search_path TO pg_catalog, pg_temp;
+    RAISE DEBUG 'job % removed % entries from the invalidation log of "%"', job_id, numrows, htoid;
+  END LOOP;
+END;
+$$ LANGUAGE PLPGSQL;
+
 CREATE OR REPLACE PROCEDURE
 _timescaledb_functions.policy_compression_execute(
   job_id              INTEGER,
@@ -43,12 +108,23 @@ _timescaledb_functions.policy_compression_execute(
   verbose_log         BOOLEAN,
   recompress_enabled  BOOLEAN,
   use_creation_time   BOOLEAN,
-  useam               BOOLEAN = NULL)
+  useam               BOOLEAN = NULL,
+  max_parallel_chunks INTEGER = NULL,
+  chunk_selection     TEXT = NULL,
+  time_budget         INTERVAL = NULL)
 AS $$
 DECLARE
   htoid       REGCLASS;
   chunk_rec   RECORD;
+  chunk_oid   REGCLASS;
+  chunks      REGCLASS[] := '{}';
+  chunk_ids   INTEGER[] := '{}';
   numchunks   INTEGER := 1;
+  deadline    TIMESTAMPTZ := NULL;
+  ratio       FLOAT8;
+  est_saved   BIGINT;
+  est_work    BIGINT;
+  numleft     INTEGER := 0;
   _message     text;
   _detail      text;
   _sqlstate    text;
@@ -60,13 +136,17 @@ DECLARE
   bit_frozen int := 4;
   bit_compressed_partial int := 8;
   creation_lag INTERVAL := NULL;
-  chunks_failure INTEGER := 0;
+  chunks_failure INTEGER := NULL;
 BEGIN
 
   -- procedures with SET clause cannot execute transaction
   -- control so we adjust search_path in procedure body
   SET LOCAL search_path TO pg_catalog, pg_temp;
 
+  IF time_budget IS NOT NULL THEN
+    deadline := clock_timestamp() + time_budget;
+  END IF;
+
   SELECT format('%I.%I', schema_name, table_name) INTO htoid
   FROM _timescaledb_catalog.hypertable
   WHERE id = htid;
@@ -91,7 +171,7 @@ BEGIN
 
   FOR chunk_rec IN
     SELECT
-      show.oid, ch.schema_name, ch.table_name, ch.status
+      show.oid, ch.id, ch.schema_name, ch.table_name, ch.status
     FROM
       @extschema@.show_chunks(htoid, older_than => lag, created_before => creation_lag) AS show(oid)
       INNER JOIN pg_class pgc ON pgc.oid = show.oid
@@ -99,42 +179,124 @@ BEGIN
       INNER JOIN _timescaledb_catalog.chunk ch ON ch.table_name = pgc.relname AND ch.schema_name = pgns.nspname AND ch.hypertable_id = htid
     WHERE NOT ch.dropped
     AND NOT ch.osm_chunk
-    -- Checking for chunks which are not fully compressed and not frozen
-    AND ch.status != status_fully_compressed
+    -- Checking for chunks which are not fully compressed and not frozen.
+    -- The status ranges are used with the (hypertable_id, status) index,
+    -- unlike an inequality, so the fully compressed chunks are not read.
+    AND (ch.status < status_fully_compressed OR ch.status > status_fully_compressed)
     AND ch.status & bit_frozen = 0
   LOOP
-    BEGIN
-      IF chunk_rec.status = bit_compressed OR recompress_enabled IS TRUE THEN
-        PERFORM @extschema@.compress_chunk(chunk_rec.oid, hypercore_use_access_method => useam);
-        numchunks := numchunks + 1;
-      END IF;
-    EXCEPTION WHEN OTHERS THEN
-      GET STACKED DIAGNOSTICS
-          _message = MESSAGE_TEXT,
-          _detail = PG_EXCEPTION_DETAIL,
-          _sqlstate = RETURNED_SQLSTATE;
-      RAISE WARNING 'compressing chunk "%" failed when compression policy is executed', chunk_rec.oid::regclass::text
-          USING DETAIL = format('Message: (%s), Detail: (%s).', _message, _detail),
-                ERRCODE = _sqlstate;
-      chunks_failure := chunks_failure + 1;
-    END;
-    COMMIT;
-    -- SET LOCAL is only active until end of transaction.
-    -- While we could use SET at the start of the function we do not
-    -- want to bleed out search_path to caller, so we do SET LOCAL
-    -- again after COMMIT
-    SET LOCAL search_path TO pg_catalog, pg_temp;
-    IF verbose_log THEN
-       RAISE LOG 'job % completed processing chunk %.%', job_id, chunk_rec.schema_name, chunk_rec.table_name;
+    IF chunk_rec.status = bit_compressed OR recompress_enabled IS TRUE THEN
+      chunks := array_append(chunks, chunk_rec.oid::regclass);
+      chunk_ids := array_append(chunk_ids, chunk_rec.id);
+      numchunks := numchunks + 1;
     END IF;
-    IF maxchunks > 0 AND numchunks >= maxchunks THEN
+    -- When selecting by benefit, the limit applies after ranking all chunks
+    IF maxchunks > 0 AND numchunks >= maxchunks AND chunk_selection IS DISTINCT FROM 'benefit' THEN
          EXIT;
     END IF;
   END LOOP;
 
+  -- Rank the chunks by the bytes saved per byte of compression work, which
+  -- is proportional to the bytes saved per second of work. The savings are
+  -- estimated from the compression ratio of the already compressed chunks
+  -- of the hypertable. Compressing a partially compressed chunk also
+  -- decompresses its compressed data, so these chunks rank lower the more
+  -- they are compressed already.
+  IF chunk_selection = 'benefit' AND array_length(chunks, 1) > 0 THEN
+    SELECT coalesce(
+      sum(s.compressed_heap_size + s.compressed_toast_size + s.compressed_index_size)::float8 /
+      nullif(sum(s.uncompressed_heap_size + s.uncompressed_toast_size + s.uncompressed_index_size), 0),
+      0.1)
+    INTO ratio
+    FROM _timescaledb_catalog.compression_chunk_size s
+      INNER JOIN _timescaledb_catalog.chunk ch ON ch.id = s.chunk_id
+    WHERE ch.hypertable_id = htid;
+    ratio := greatest(least(ratio, 1.0), 0.01);
+
+    SELECT coalesce(array_agg(r.oid ORDER BY r.rank), '{}'), sum(r.saved), sum(r.work)
+    INTO chunks, est_saved, est_work
+    FROM (
+      SELECT
+        e.oid, e.saved, e.work,
+        row_number() OVER (ORDER BY e.saved::float8 / greatest(e.work, 1) DESC, e.saved DESC) AS rank
+      FROM (
+        SELECT
+          c.oid,
+          (c.size * (1 - ratio))::bigint AS saved,
+          (c.size + c.compressed_size / ratio)::bigint AS work
+        FROM (
+          SELECT
+            u.oid,
+            pg_total_relation_size(u.oid) AS size,
+            coalesce(s.compressed_heap_size + s.compressed_toast_size + s.compressed_index_size, 0) AS compressed_size
+          FROM unnest(chunks, chunk_ids) AS u(oid, id)
+            LEFT JOIN _timescaledb_catalog.compression_chunk_size s ON s.chunk_id = u.id
+        ) c
+      ) e
+    ) r
+    -- The same number of chunks as the loop above selects
+    WHERE maxchunks <= 0 OR r.rank < maxchunks;
+
+    numchunks := coalesce(array_length(chunks, 1), 0) + 1;
+    IF verbose_log THEN
+      RAISE LOG 'job % selected % chunks, estimated to save % bytes with % bytes of work',
+        job_id, numchunks - 1, est_saved, est_work;
+    END IF;
+  END IF;
+
+  -- The chunks are compressed in parallel workers if configured. The
+  -- workers lock the chunks in their own transactions, so commit first to
+  -- not hold any locks on the chunks.
+  IF max_parallel_chunks > 1 AND array_length(chunks, 1) > 1 THEN
+    COMMIT;
+    SET LOCAL search_path TO pg_catalog, pg_temp;
+    chunks_failure := _timescaledb_functions.policy_compression_execute_parallel(
+      job_id, chunks, max_parallel_chunks, verbose_log, useam, deadline
+    );
+  END IF;
+
+  -- Otherwise, or if no worker could be started, compress the chunks here
+  IF chunks_failure IS NULL THEN
+    chunks_failure := 0;
+    FOREACH chunk_oid IN ARRAY chunks
+    LOOP
+      -- The chunks that are left are compressed by the next runs
+      IF deadline IS NOT NULL AND clock_timestamp() >= deadline THEN
+        numleft := numleft + 1;
+        CONTINUE;
+      END IF;
+      BEGIN
+        PERFORM @extschema@.compress_chunk(chunk_oid, hypercore_use_access_method => useam);
+      EXCEPTION WHEN OTHERS THEN
+        GET STACKED DIAGNOSTICS
+            _message = MESSAGE_TEXT,
+            _detail = PG_EXCEPTION_DETAIL,
+            _sqlstate = RETURNED_SQLSTATE;
+        RAISE WARNING 'compressing chunk "%" failed when compression policy is executed', chunk_oid::text
+            USING DETAIL = format('Message: (%s), Detail: (%s).', _message, _detail),
+                  ERRCODE = _sqlstate;
+        chunks_failure := chunks_failure + 1;
+      END;
+      COMMIT;
+      -- SET LOCAL is only active until end of transaction.
+      -- While we could use SET at the start of the function we do not
+      -- want to bleed out search_path to caller, so we do SET LOCAL
+      -- again after COMMIT
+      SET LOCAL search_path TO pg_catalog, pg_temp;
+      IF verbose_log THEN
+         RAISE LOG 'job % completed processing chunk %', job_id, chunk_oid::text;
+      END IF;
+    END LOOP;
+
+    IF numleft > 0 THEN
+      RAISE LOG 'job % reached its time budget, % chunks are left to compress', job_id, numleft;
+      numchunks := numchunks - numleft;
+    END IF;
+  END IF;
+
   IF chunks_failure > 0 THEN
     RAISE EXCEPTION 'compression policy failure'
-      USING DETAIL = format('Failed to compress %L chunks. Successfully compressed %L chunks.', chunks_failure, numchunks - chunks_failure);
+      USING DETAIL = format('Failed to compress %L chunks. Successfully compressed %L chunks.', chunks_failure, array_length(chunks, 1) - chunks_failure - numleft);
   END IF;
 END;
 $$ LANGUAGE PLPGSQL;
@@ -158,6 +320,9 @@ DECLARE
   recompress_enabled  BOOL;
   use_creation_time   BOOL := FALSE;
   hypercore_use_access_method   BOOL;
+  max_parallel_chunks INTEGER;
+  chunk_selection     TEXT;
+  time_budget         INTERVAL;
 BEGIN
 
   -- procedures with SET clause cannot execute transaction
@@ -176,6 +341,9 @@ BEGIN
   verbose_log         := COALESCE(jsonb_object_field_text(config, 'verbose_log')::BOOLEAN, FALSE);
   maxchunks           := COALESCE(jsonb_object_field_text(config, 'maxchunks_to_compress')::INTEGER, 0);
   recompress_enabled  := COALESCE(jsonb_object_field_text(config, 'recompress')::BOOLEAN, TRUE);
+  max_parallel_chunks := jsonb_object_field_text(config, 'max_parallel_chunks')::INTEGER;
+  chunk_selection     := jsonb_object_field_text(config, 'chunk_selection');
+  time_budget         := jsonb_object_field_text(config, 'time_budget')::INTERVAL;
 
   -- find primary dimension type --
   SELECT dim.column_type INTO dimtype
@@ -205,22 +373,26 @@ BEGIN
     WHEN 'TIMESTAMP'::regtype, 'TIMESTAMPTZ'::regtype, 'DATE'::regtype, 'INTERVAL' ::regtype  THEN
       CALL _timescaledb_functions.policy_compression_execute(
         job_id, htid, lag_value::INTERVAL,
-        maxchunks, verbose_log, recompress_enabled, use_creation_time, hypercore_use_access_method
+        maxchunks, verbose_log, recompress_enabled, use_creation_time, hypercore_use_access_method,
+        max_parallel_chunks, chunk_selection, time_budget
       );
     WHEN 'BIGINT'::regtype THEN
       CALL _timescaledb_functions.policy_compression_execute(
         job_id, htid, lag_value::BIGINT,
-        maxchunks, verbose_log, recompress_enabled, use_creation_time, hypercore_use_access_method
+        maxchunks, verbose_log, recompress_enabled, use_creation_time, hypercore_use_access_method,
+        max_parallel_chunks, chunk_selection, time_budget
       );
     WHEN 'INTEGER'::regtype THEN
       CALL _timescaledb_functions.policy_compression_execute(
         job_id, htid, lag_value::INTEGER,
-        maxchunks, verbose_log, recompress_enabled, use_creation_time, hypercore_use_access_method
+        maxchunks, verbose_log, recompress_enabled, use_creation_time, hypercore_use_access_method,
+        max_parallel_chunks, chunk_selection, time_budget
       );
     WHEN 'SMALLINT'::regtype THEN
       CALL _timescaledb_functions.policy_compression_execute(
         job_id, htid, lag_value::SMALLINT,
-        maxchunks, verbose_log, recompress_enabled, use_creation_time, hypercore_use_access_method
+        maxchunks, verbose_log, recompress_enabled, use_creation_time, hypercore_use_access_method,
+        max_parallel_chunks, chunk_selection, time_budget
       );
   END CASE;
 END;
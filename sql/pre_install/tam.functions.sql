@@ -8,3 +8,6 @@ AS '@MODULE_PATHNAME@', 'ts_hypercore_handler' LANGUAGE C;
 CREATE OR REPLACE FUNCTION ts_hypercore_proxy_handler(internal) RETURNS index_am_handler
 AS '@MODULE_PATHNAME@', 'ts_hypercore_proxy_handler' LANGUAGE C;
 
+
+CREATE OR REPLACE FUNCTION ts_hypercore_sparse_handler(internal) RETURNS index_am_handler
+AS '@MODULE_PATHNAME@', 'ts_hypercore_sparse_handler' LANGUAGE C;
@@ -0,0 +1,64 @@
+-- This file and its contents are licensed under the Apache License 2.0.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-APACHE for a copy of the license.
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.ddsketch_sfunc(state INTERNAL, val DOUBLE PRECISION)
+RETURNS INTERNAL
+AS '@MODULE_PATHNAME@', 'ts_ddsketch_sfunc'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.ddsketch_rollup_sfunc(state INTERNAL, sketch BYTEA)
+RETURNS INTERNAL
+AS '@MODULE_PATHNAME@', 'ts_ddsketch_rollup_sfunc'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.ddsketch_combinefunc(state1 INTERNAL, state2 INTERNAL)
+RETURNS INTERNAL
+AS '@MODULE_PATHNAME@', 'ts_ddsketch_combinefunc'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.ddsketch_serializefunc(INTERNAL)
+RETURNS bytea
+AS '@MODULE_PATHNAME@', 'ts_ddsketch_serializefunc'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.ddsketch_deserializefunc(bytea, INTERNAL)
+RETURNS INTERNAL
+AS '@MODULE_PATHNAME@', 'ts_ddsketch_deserializefunc'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_functions.ddsketch_finalfunc(state INTERNAL)
+RETURNS bytea
+AS '@MODULE_PATHNAME@', 'ts_ddsketch_finalfunc'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- A mergeable sketch of the distribution of the non-null values, for use with
+-- approx_quantile(). The quantile estimates have a relative error of at most
+-- 1%. The sketches can be stored, e.g. in a continuous aggregate, and merged
+-- later with quantile_sketch_rollup().
+CREATE OR REPLACE AGGREGATE @extschema@.quantile_sketch(DOUBLE PRECISION) (
+    SFUNC = _timescaledb_functions.ddsketch_sfunc,
+    STYPE = INTERNAL,
+    COMBINEFUNC = _timescaledb_functions.ddsketch_combinefunc,
+    SERIALFUNC = _timescaledb_functions.ddsketch_serializefunc,
+    DESERIALFUNC = _timescaledb_functions.ddsketch_deserializefunc,
+    PARALLEL = SAFE,
+    FINALFUNC = _timescaledb_functions.ddsketch_finalfunc
+);
+
+CREATE OR REPLACE AGGREGATE @extschema@.quantile_sketch_rollup(BYTEA) (
+    SFUNC = _timescaledb_functions.ddsketch_rollup_sfunc,
+    STYPE = INTERNAL,
+    COMBINEFUNC = _timescaledb_functions.ddsketch_combinefunc,
+    SERIALFUNC = _timescaledb_functions.ddsketch_serializefunc,
+    DESERIALFUNC = _timescaledb_functions.ddsketch_deserializefunc,
+    PARALLEL = SAFE,
+    FINALFUNC = _timescaledb_functions.ddsketch_finalfunc
+);
+
+-- The estimated value at the given fraction of the sorted values, e.g. 0.99
+-- for the 99th percentile.
+CREATE OR REPLACE FUNCTION @extschema@.approx_quantile(sketch BYTEA, fraction DOUBLE PRECISION)
+RETURNS DOUBLE PRECISION
+AS '@MODULE_PATHNAME@', 'ts_approx_quantile'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
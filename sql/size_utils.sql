@@ -560,6 +560,34 @@ CREATE OR REPLACE FUNCTION @extschema@.chunk_columnstore_stats (hypertable REGCL
     AS 'SELECT * FROM @extschema@.chunk_compression_stats($1)'
     SET search_path TO pg_catalog, pg_temp;
 
+-- Get the statistics of the compressed columns of a compressed chunk, one row
+-- per column and compression algorithm. This decompresses all the batches of
+-- the chunk to count the nulls and to measure the decode time.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.compressed_column_stats (chunk REGCLASS)
+    RETURNS TABLE (
+        column_name name,
+        algorithm name,
+        batches bigint,
+        rows bigint,
+        compressed_bytes bigint,
+        null_fraction float8,
+        avg_batch_rows float8,
+        decode_ns_per_row float8)
+    AS '@MODULE_PATHNAME@', 'ts_compressed_column_stats'
+    LANGUAGE C VOLATILE STRICT;
+
+-- Measure the decode cost of the compression algorithms on the current
+-- hardware, in units of cpu_operator_cost per row, and optionally store them
+-- in the metadata table for the planner to use for the decompression costs.
+-- Storing the costs requires superuser.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.calibrate_decompression_cost (store BOOL = true)
+    RETURNS TABLE (
+        algorithm name,
+        decode_ns_per_row float8,
+        cost_per_row float8)
+    AS '@MODULE_PATHNAME@', 'ts_calibrate_decompression_cost'
+    LANGUAGE C VOLATILE STRICT;
+
 -- Get compression statistics for a hypertable that has
 -- compression enabled
 CREATE OR REPLACE FUNCTION @extschema@.hypertable_compression_stats (hypertable REGCLASS)
@@ -0,0 +1,101 @@
+INSERT INTO _timescaledb_catalog.compression_algorithm( id, version, name, description) values
+( 7, 1, 'COMPRESSION_ALGORITHM_FOR', 'for'),
+( 8, 1, 'COMPRESSION_ALGORITHM_ALP', 'alp'),
+( 9, 1, 'COMPRESSION_ALGORITHM_FSST', 'fsst'),
+(10, 1, 'COMPRESSION_ALGORITHM_BLOCK', 'block'),
+(11, 1, 'COMPRESSION_ALGORITHM_UUID', 'uuid'),
+(12, 1, 'COMPRESSION_ALGORITHM_JSONB', 'jsonb')
+;
+
+CREATE INDEX chunk_hypertable_id_status_idx ON _timescaledb_catalog.chunk (hypertable_id, status);
+
+DROP PROCEDURE IF EXISTS _timescaledb_functions.policy_compression_execute(job_id INTEGER, htid INTEGER, lag ANYELEMENT, maxchunks INTEGER, verbose_log BOOLEAN, recompress_enabled BOOLEAN, use_creation_time BOOLEAN, useam BOOLEAN);
+
+CREATE FUNCTION ts_hypercore_sparse_handler(internal) RETURNS index_am_handler
+AS '@MODULE_PATHNAME@', 'ts_hypercore_sparse_handler' LANGUAGE C;
+
+CREATE ACCESS METHOD hypercore_sparse TYPE INDEX HANDLER ts_hypercore_sparse_handler;
+COMMENT ON ACCESS METHOD hypercore_sparse IS 'Hypercore sparse index access method with one entry per compressed batch';
+
+-- The sparse index is a btree internally, so the operator classes are
+-- the same as the btree operator classes.
+CREATE OPERATOR CLASS int2_ops
+DEFAULT FOR TYPE int2 USING hypercore_sparse AS
+	OPERATOR 1 < (int2, int2),
+	OPERATOR 2 <= (int2, int2),
+	OPERATOR 3 = (int2, int2),
+	OPERATOR 4 >= (int2, int2),
+	OPERATOR 5 > (int2, int2),
+	FUNCTION 1 btint2cmp(int2, int2);
+CREATE OPERATOR CLASS int4_ops
+DEFAULT FOR TYPE int4 USING hypercore_sparse AS
+	OPERATOR 1 < (int4, int4),
+	OPERATOR 2 <= (int4, int4),
+	OPERATOR 3 = (int4, int4),
+	OPERATOR 4 >= (int4, int4),
+	OPERATOR 5 > (int4, int4),
+	FUNCTION 1 btint4cmp(int4, int4);
+CREATE OPERATOR CLASS int8_ops
+DEFAULT FOR TYPE int8 USING hypercore_sparse AS
+	OPERATOR 1 < (int8, int8),
+	OPERATOR 2 <= (int8, int8),
+	OPERATOR 3 = (int8, int8),
+	OPERATOR 4 >= (int8, int8),
+	OPERATOR 5 > (int8, int8),
+	FUNCTION 1 btint8cmp(int8, int8);
+CREATE OPERATOR CLASS float4_ops
+DEFAULT FOR TYPE float4 USING hypercore_sparse AS
+	OPERATOR 1 < (float4, float4),
+	OPERATOR 2 <= (float4, float4),
+	OPERATOR 3 = (float4, float4),
+	OPERATOR 4 >= (float4, float4),
+	OPERATOR 5 > (float4, float4),
+	FUNCTION 1 btfloat4cmp(float4, float4);
+CREATE OPERATOR CLASS float8_ops
+DEFAULT FOR TYPE float8 USING hypercore_sparse AS
+	OPERATOR 1 < (float8, float8),
+	OPERATOR 2 <= (float8, float8),
+	OPERATOR 3 = (float8, float8),
+	OPERATOR 4 >= (float8, float8),
+	OPERATOR 5 > (float8, float8),
+	FUNCTION 1 btfloat8cmp(float8, float8);
+CREATE OPERATOR CLASS numeric_ops
+DEFAULT FOR TYPE numeric USING hypercore_sparse AS
+	OPERATOR 1 < (numeric, numeric),
+	OPERATOR 2 <= (numeric, numeric),
+	OPERATOR 3 = (numeric, numeric),
+	OPERATOR 4 >= (numeric, numeric),
+	OPERATOR 5 > (numeric, numeric),
+	FUNCTION 1 numeric_cmp(numeric, numeric);
+CREATE OPERATOR CLASS date_ops
+DEFAULT FOR TYPE date USING hypercore_sparse AS
+	OPERATOR 1 < (date, date),
+	OPERATOR 2 <= (date, date),
+	OPERATOR 3 = (date, date),
+	OPERATOR 4 >= (date, date),
+	OPERATOR 5 > (date, date),
+	FUNCTION 1 date_cmp(date, date);
+CREATE OPERATOR CLASS timestamp_ops
+DEFAULT FOR TYPE timestamp USING hypercore_sparse AS
+	OPERATOR 1 < (timestamp, timestamp),
+	OPERATOR 2 <= (timestamp, timestamp),
+	OPERATOR 3 = (timestamp, timestamp),
+	OPERATOR 4 >= (timestamp, timestamp),
+	OPERATOR 5 > (timestamp, timestamp),
+	FUNCTION 1 timestamp_cmp(timestamp, timestamp);
+CREATE OPERATOR CLASS timestamptz_ops
+DEFAULT FOR TYPE timestamptz USING hypercore_sparse AS
+	OPERATOR 1 < (timestamptz, timestamptz),
+	OPERATOR 2 <= (timestamptz, timestamptz),
+	OPERATOR 3 = (timestamptz, timestamptz),
+	OPERATOR 4 >= (timestamptz, timestamptz),
+	OPERATOR 5 > (timestamptz, timestamptz),
+	FUNCTION 1 timestamptz_cmp(timestamptz, timestamptz);
+CREATE OPERATOR CLASS text_ops
+DEFAULT FOR TYPE text USING hypercore_sparse AS
+	OPERATOR 1 < (text, text),
+	OPERATOR 2 <= (text, text),
+	OPERATOR 3 = (text, text),
+	OPERATOR 4 >= (text, text),
+	OPERATOR 5 > (text, text),
+	FUNCTION 1 bttextcmp(text, text);
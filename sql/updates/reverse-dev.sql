@@ -0,0 +1,75 @@
+DELETE FROM _timescaledb_catalog.compression_algorithm WHERE id = 7 AND version = 1 AND name = 'COMPRESSION_ALGORITHM_FOR';
+DELETE FROM _timescaledb_catalog.compression_algorithm WHERE id = 8 AND version = 1 AND name = 'COMPRESSION_ALGORITHM_ALP';
+DELETE FROM _timescaledb_catalog.compression_algorithm WHERE id = 9 AND version = 1 AND name = 'COMPRESSION_ALGORITHM_FSST';
+DELETE FROM _timescaledb_catalog.compression_algorithm WHERE id = 10 AND version = 1 AND name = 'COMPRESSION_ALGORITHM_BLOCK';
+DELETE FROM _timescaledb_catalog.compression_algorithm WHERE id = 11 AND version = 1 AND name = 'COMPRESSION_ALGORITHM_UUID';
+DELETE FROM _timescaledb_catalog.compression_algorithm WHERE id = 12 AND version = 1 AND name = 'COMPRESSION_ALGORITHM_JSONB';
+
+DROP FUNCTION IF EXISTS _timescaledb_functions.bloom1_contains(bytea, anyelement);
+DROP FUNCTION IF EXISTS _timescaledb_functions.compressed_column_stats(REGCLASS);
+DROP FUNCTION IF EXISTS _timescaledb_functions.compress_chunk_slice(REGCLASS, BIGINT);
+DROP PROCEDURE IF EXISTS @extschema@.compress_chunk_incremental(REGCLASS, BIGINT);
+DROP AGGREGATE IF EXISTS @extschema@.approx_count_distinct(ANYELEMENT);
+DROP FUNCTION IF EXISTS _timescaledb_functions.hll_sfunc(INTERNAL, ANYELEMENT);
+DROP FUNCTION IF EXISTS _timescaledb_functions.hll_combinefunc(INTERNAL, INTERNAL);
+DROP FUNCTION IF EXISTS _timescaledb_functions.hll_serializefunc(INTERNAL);
+DROP FUNCTION IF EXISTS _timescaledb_functions.hll_deserializefunc(BYTEA, INTERNAL);
+DROP FUNCTION IF EXISTS _timescaledb_functions.hll_finalfunc(INTERNAL);
+DROP FUNCTION IF EXISTS @extschema@.approx_quantile(BYTEA, DOUBLE PRECISION);
+DROP AGGREGATE IF EXISTS @extschema@.quantile_sketch(DOUBLE PRECISION);
+DROP AGGREGATE IF EXISTS @extschema@.quantile_sketch_rollup(BYTEA);
+DROP FUNCTION IF EXISTS _timescaledb_functions.ddsketch_sfunc(INTERNAL, DOUBLE PRECISION);
+DROP FUNCTION IF EXISTS _timescaledb_functions.ddsketch_rollup_sfunc(INTERNAL, BYTEA);
+DROP FUNCTION IF EXISTS _timescaledb_functions.ddsketch_combinefunc(INTERNAL, INTERNAL);
+DROP FUNCTION IF EXISTS _timescaledb_functions.ddsketch_serializefunc(INTERNAL);
+DROP FUNCTION IF EXISTS _timescaledb_functions.ddsketch_deserializefunc(BYTEA, INTERNAL);
+DROP FUNCTION IF EXISTS _timescaledb_functions.ddsketch_finalfunc(INTERNAL);
+DROP FUNCTION IF EXISTS _timescaledb_debug.hypercore_arrow_cache_stats();
+DROP FUNCTION IF EXISTS @extschema@.add_chunk_precreation_policy(REGCLASS, INTEGER, BOOL, INTERVAL, TIMESTAMPTZ, TEXT);
+DROP FUNCTION IF EXISTS @extschema@.remove_chunk_precreation_policy(REGCLASS, BOOL);
+DROP PROCEDURE IF EXISTS _timescaledb_functions.policy_precreate_chunks(INTEGER, JSONB);
+DROP FUNCTION IF EXISTS _timescaledb_functions.policy_precreate_chunks_check(JSONB);
+DROP FUNCTION IF EXISTS _timescaledb_debug.planner_stats();
+DROP FUNCTION IF EXISTS _timescaledb_debug.cache_stats();
+DROP FUNCTION IF EXISTS _timescaledb_functions.cagg_compact_invalidation_log(REGCLASS);
+DROP PROCEDURE IF EXISTS _timescaledb_functions.policy_compact_invalidation_logs(INTEGER, JSONB);
+DROP VIEW IF EXISTS timescaledb_information.continuous_aggregate_refresh_progress;
+DROP FUNCTION IF EXISTS _timescaledb_functions.get_progress_info(TEXT);
+DROP VIEW IF EXISTS timescaledb_information.compressed_scan_stats;
+DROP VIEW IF EXISTS timescaledb_information.compressed_column_scan_stats;
+DROP FUNCTION IF EXISTS @extschema@.reset_compressed_scan_stats(REGCLASS);
+DROP FUNCTION IF EXISTS _timescaledb_functions.compressed_scan_stats();
+DROP FUNCTION IF EXISTS _timescaledb_debug.memory_usage();
+DROP VIEW IF EXISTS timescaledb_information.lock_wait_stats;
+DROP FUNCTION IF EXISTS @extschema@.reset_lock_wait_stats();
+DROP FUNCTION IF EXISTS _timescaledb_functions.lock_wait_stats();
+DROP FUNCTION IF EXISTS @extschema@.get_performance_report();
+DROP FUNCTION IF EXISTS _timescaledb_functions.calibrate_decompression_cost(BOOL);
+DROP FUNCTION IF EXISTS @extschema@.export_arrow_ipc(REGCLASS, NAME[], REGCLASS[]);
+DROP OPERATOR FAMILY IF EXISTS int2_ops USING hypercore_sparse;
+DROP OPERATOR FAMILY IF EXISTS int4_ops USING hypercore_sparse;
+DROP OPERATOR FAMILY IF EXISTS int8_ops USING hypercore_sparse;
+DROP OPERATOR FAMILY IF EXISTS float4_ops USING hypercore_sparse;
+DROP OPERATOR FAMILY IF EXISTS float8_ops USING hypercore_sparse;
+DROP OPERATOR FAMILY IF EXISTS numeric_ops USING hypercore_sparse;
+DROP OPERATOR FAMILY IF EXISTS date_ops USING hypercore_sparse;
+DROP OPERATOR FAMILY IF EXISTS timestamp_ops USING hypercore_sparse;
+DROP OPERATOR FAMILY IF EXISTS timestamptz_ops USING hypercore_sparse;
+DROP OPERATOR FAMILY IF EXISTS text_ops USING hypercore_sparse;
+DROP ACCESS METHOD IF EXISTS hypercore_sparse;
+DROP FUNCTION IF EXISTS ts_hypercore_sparse_handler;
+DROP FUNCTION IF EXISTS _timescaledb_functions.calculate_chunk_interval_from_stats(INTEGER, BIGINT, BIGINT);
+DROP FUNCTION IF EXISTS _timescaledb_debug.init_stats();
+DROP FUNCTION IF EXISTS _timescaledb_functions.timestamptz_from_uuid_v7(uuid);
+DROP FUNCTION IF EXISTS _timescaledb_functions.uuid_v7_from_timestamptz(timestamptz);
+DROP FUNCTION IF EXISTS _timescaledb_functions.generate_uuid_v7();
+
+DROP INDEX IF EXISTS _timescaledb_catalog.chunk_hypertable_id_status_idx;
+DROP FUNCTION IF EXISTS _timescaledb_functions.policy_compression_execute_parallel(INTEGER, REGCLASS[], INTEGER, BOOLEAN, BOOLEAN, TIMESTAMPTZ);
+DROP PROCEDURE IF EXISTS _timescaledb_functions.policy_compression_execute(INTEGER, INTEGER, ANYELEMENT, INTEGER, BOOLEAN, BOOLEAN, BOOLEAN, BOOLEAN, INTEGER, TEXT, INTERVAL);
+DROP PROCEDURE IF EXISTS _timescaledb_functions.policy_retention_batch(INTEGER, JSONB);
+DROP FUNCTION IF EXISTS _timescaledb_functions.policy_retention_batch_check(JSONB);
+DROP FUNCTION IF EXISTS @extschema@.add_merge_chunks_policy(REGCLASS, TEXT, BOOL, INTERVAL, TIMESTAMPTZ, TEXT);
+DROP FUNCTION IF EXISTS @extschema@.remove_merge_chunks_policy(REGCLASS, BOOL);
+DROP PROCEDURE IF EXISTS _timescaledb_functions.policy_merge_chunks(INTEGER, JSONB);
+DROP FUNCTION IF EXISTS _timescaledb_functions.policy_merge_chunks_check(JSONB);
@@ -408,5 +408,160 @@ AS SELECT * FROM timescaledb_information.hypertable_compression_settings;
 CREATE OR REPLACE VIEW timescaledb_information.chunk_columnstore_settings AS
 SELECT * FROM timescaledb_information.chunk_compression_settings;
 
+-- The progress of the commands running in the backends of the current
+-- database. The parameters are defined by the command, see progress.h.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.get_progress_info(
+    command TEXT,
+    OUT pid INTEGER,
+    OUT datid OID,
+    OUT relid OID,
+    OUT params BIGINT[]
+) RETURNS SETOF RECORD
+AS '@MODULE_PATHNAME@', 'ts_progress_info' LANGUAGE C STRICT VOLATILE;
+
+-- The progress of the running refreshes of continuous aggregates. The
+-- windows are the ranges that are materialized separately, the window
+-- columns show the range that is currently materialized.
+CREATE OR REPLACE VIEW timescaledb_information.continuous_aggregate_refresh_progress AS
+SELECT p.pid,
+  cagg.user_view_schema AS view_schema,
+  cagg.user_view_name AS view_name,
+  CASE p.params[1]
+    WHEN 1 THEN 'processing hypertable invalidations'
+    WHEN 2 THEN 'processing continuous aggregate invalidations'
+    WHEN 3 THEN 'materializing'
+    ELSE 'initializing'
+  END AS phase,
+  nullif(p.params[2], 0) AS batch,
+  nullif(p.params[3], 0) AS batches,
+  CASE WHEN p.params[6] = 0 THEN
+    NULL
+  WHEN dim.column_type = ANY(ARRAY['timestamp','timestamptz','date']::regtype[]) THEN
+    _timescaledb_functions.to_timestamp(p.params[4])
+  ELSE
+    NULL
+  END AS window_start,
+  CASE WHEN p.params[6] = 0 THEN
+    NULL
+  WHEN dim.column_type = ANY(ARRAY['timestamp','timestamptz','date']::regtype[]) THEN
+    _timescaledb_functions.to_timestamp(p.params[5])
+  ELSE
+    NULL
+  END AS window_end,
+  CASE WHEN p.params[6] = 0 THEN
+    NULL
+  WHEN dim.column_type = ANY(ARRAY['timestamp','timestamptz','date']::regtype[]) THEN
+    NULL
+  ELSE
+    p.params[4]
+  END AS window_start_integer,
+  CASE WHEN p.params[6] = 0 THEN
+    NULL
+  WHEN dim.column_type = ANY(ARRAY['timestamp','timestamptz','date']::regtype[]) THEN
+    NULL
+  ELSE
+    p.params[5]
+  END AS window_end_integer,
+  p.params[6] AS windows_total,
+  p.params[7] AS windows_done,
+  p.params[8] AS rows_deleted,
+  p.params[9] AS rows_inserted,
+  _timescaledb_functions.to_interval(p.params[10]) AS invalidation_processing_time,
+  _timescaledb_functions.to_interval(p.params[11]) AS materialization_time
+FROM _timescaledb_functions.get_progress_info('cagg refresh') p
+  LEFT JOIN _timescaledb_catalog.continuous_agg cagg
+    ON format('%I.%I', cagg.user_view_schema, cagg.user_view_name)::regclass = p.relid
+  LEFT JOIN _timescaledb_catalog.dimension dim ON dim.hypertable_id = cagg.mat_hypertable_id;
+
+-- The cumulative statistics of the scans of compressed chunks of the
+-- hypertables of the current database and of their columns. The counters
+-- are defined by the extension, see compressed_scan_stats.h. The column
+-- name is null for the statistics of a hypertable.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.compressed_scan_stats(
+    OUT hypertable_id INTEGER,
+    OUT column_name NAME,
+    OUT counters BIGINT[]
+) RETURNS SETOF RECORD
+AS '@MODULE_PATHNAME@', 'ts_compressed_scan_stats' LANGUAGE C STRICT VOLATILE;
+
+-- Reset the statistics of the scans of compressed chunks of a hypertable, or
+-- of all hypertables of the current database if none is given.
+CREATE OR REPLACE FUNCTION @extschema@.reset_compressed_scan_stats(
+    hypertable REGCLASS = NULL
+) RETURNS VOID
+AS '@MODULE_PATHNAME@', 'ts_compressed_scan_stats_reset' LANGUAGE C VOLATILE;
+
+-- The work done by the scans of the compressed chunks of each hypertable,
+-- summed over all backends since the server start or the last reset. The
+-- cache is the cache of decompressed columns that is used on rescans, and
+-- the arrow cache for the hypercore table access method.
+CREATE OR REPLACE VIEW timescaledb_information.compressed_scan_stats AS
+SELECT ht.schema_name AS hypertable_schema,
+  ht.table_name AS hypertable_name,
+  s.counters[1] AS scans,
+  s.counters[2] AS batches,
+  s.counters[3] AS batches_filtered,
+  s.counters[4] AS decompressed_rows,
+  s.counters[5] AS row_by_row_decompressed_rows,
+  s.counters[6] AS detoasted_bytes,
+  s.counters[7] AS vectorized_filter_batches,
+  s.counters[8] AS row_filter_batches,
+  s.counters[9] AS vectorized_aggregation_batches,
+  s.counters[10] AS cache_hits,
+  s.counters[11] AS cache_misses,
+  s.counters[10]::float8 / nullif(s.counters[10] + s.counters[11], 0) AS cache_hit_ratio
+FROM _timescaledb_functions.compressed_scan_stats() s
+  JOIN _timescaledb_catalog.hypertable ht ON ht.id = s.hypertable_id
+WHERE s.column_name IS NULL;
+
+-- The rows decompressed for each column of the hypertables, see above. The
+-- segmentby columns are not decompressed.
+CREATE OR REPLACE VIEW timescaledb_information.compressed_column_scan_stats AS
+SELECT ht.schema_name AS hypertable_schema,
+  ht.table_name AS hypertable_name,
+  s.column_name,
+  s.counters[4] AS decompressed_rows
+FROM _timescaledb_functions.compressed_scan_stats() s
+  JOIN _timescaledb_catalog.hypertable ht ON ht.id = s.hypertable_id
+WHERE s.column_name IS NOT NULL;
+
+-- The counters of the waits for the locks taken by the extension, for all
+-- databases. The lock manager only shows these as waits for a relation or a
+-- tuple in pg_stat_activity.
+CREATE OR REPLACE FUNCTION _timescaledb_functions.lock_wait_stats(
+    OUT lock_name TEXT,
+    OUT acquired BIGINT,
+    OUT waits BIGINT,
+    OUT wait_time BIGINT,
+    OUT max_wait_time BIGINT
+) RETURNS SETOF RECORD
+AS '@MODULE_PATHNAME@', 'ts_lock_wait_stats' LANGUAGE C STRICT VOLATILE;
+
+-- Reset the lock wait statistics of all databases.
+CREATE OR REPLACE FUNCTION @extschema@.reset_lock_wait_stats() RETURNS VOID
+AS '@MODULE_PATHNAME@', 'ts_lock_wait_stats_reset' LANGUAGE C VOLATILE;
+
+-- How often and how long the backends waited for chunk creation, the tuple
+-- locks on the dimension slices, the invalidation threshold and the other
+-- catalog tables, and the chunk locks of compression, since the server start
+-- or the last reset. A wait is an acquisition that could not be granted at
+-- once.
+CREATE OR REPLACE VIEW timescaledb_information.lock_wait_stats AS
+SELECT s.lock_name,
+  s.acquired,
+  s.waits,
+  _timescaledb_functions.to_interval(s.wait_time) AS total_wait_time,
+  _timescaledb_functions.to_interval(s.max_wait_time) AS max_wait_time,
+  _timescaledb_functions.to_interval(s.wait_time / nullif(s.waits, 0)) AS avg_wait_time
+FROM _timescaledb_functions.lock_wait_stats() s;
+
+-- A local report of the statistics that are relevant for the performance:
+-- the relation statistics of the telemetry report, the compression of the
+-- hypertables, the failures and the lateness of the jobs and the lock
+-- waits, and the planner, cache and memory statistics of the current
+-- backend. Nothing is sent anywhere, also when telemetry is enabled.
+CREATE OR REPLACE FUNCTION @extschema@.get_performance_report() RETURNS JSONB
+AS '@MODULE_PATHNAME@', 'ts_performance_report' LANGUAGE C VOLATILE;
+
 GRANT SELECT ON ALL TABLES IN SCHEMA timescaledb_information TO PUBLIC;
 
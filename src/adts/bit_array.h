@@ -38,6 +38,11 @@ static void bit_array_iterator_init_rev(BitArrayIterator *iter, const BitArray *
 /* return last num_bits in forward-order (not reverse-order); must have been written as num_bits */
 static uint64 bit_array_iter_next_rev(BitArrayIterator *iter, uint8 num_bits);
 
+/* return num_bits at bit_offset of packed buckets, for vectorized bulk unpacking */
+pg_attribute_always_inline static uint64 bit_array_unpack_at(const uint64 *restrict buckets,
+															 uint32 last_bucket,
+															 uint64 bit_offset, uint8 num_bits);
+
 /* I/O */
 static inline void bit_array_send(StringInfo buffer, const BitArray *data);
 static inline BitArray bit_array_recv(const StringInfo buffer);
@@ -334,6 +334,37 @@ bit_array_iter_next_rev(BitArrayIterator *iter, uint8 num_bits)
 	return value;
 }
 
+/*
+ * Bulk extraction of bit-packed values, shared by the bulk decompression of
+ * the compression algorithms.
+ *
+ * The values are packed the same way as in the bit array, from LSB to MSB
+ * of 64-bit buckets, and a value can span two buckets with the low-order
+ * bits in the first one. The value at an arbitrary bit offset is extracted
+ * without loop-carried dependencies, so the loops that unpack many values
+ * with it are vectorized by the compiler, whatever the layout of the widths
+ * is. This is the place to tune the extraction, not the decoders.
+ *
+ * The buckets are read only up to last_bucket. The caller must check that
+ * the value fits into the buckets, the clamped reads only happen for the
+ * bits that are masked out anyway.
+ */
+pg_attribute_always_inline static uint64
+bit_array_unpack_at(const uint64 *restrict buckets, uint32 last_bucket, uint64 bit_offset,
+					uint8 num_bits)
+{
+	const uint32 bucket = Min(bit_offset / BITS_PER_BUCKET, last_bucket);
+	const uint32 next_bucket = Min(bucket + 1, last_bucket);
+	const uint8 bit_in_bucket = bit_offset % BITS_PER_BUCKET;
+
+	const uint64 low = buckets[bucket] >> bit_in_bucket;
+	const uint64 high =
+		bit_in_bucket == 0 ? 0 : buckets[next_bucket] << (BITS_PER_BUCKET - bit_in_bucket);
+	const uint64 mask = num_bits == 0 ? 0 : (~0ULL >> (BITS_PER_BUCKET - num_bits));
+
+	return (low | high) & mask;
+}
+
 /************************
  ***  Private Helpers ***
  ************************/
@@ -0,0 +1,198 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Wake up the scheduler when enough rows of a hypertable were modified, for
+ * the event-driven continuous aggregate refresh policies.
+ *
+ * The scheduler registers the raw hypertables of these policies in the
+ * shared hash table of the loader, with its latch and the count of modified
+ * rows at which to wake up. The backends add the rows they modified in the
+ * registered hypertables when their transaction commits, and set the latch of
+ * the scheduler when the count reaches the wakeup count. The scheduler then
+ * starts the jobs whose number of rows modified since their last start
+ * reaches their threshold, see start_invalidated_jobs().
+ */
+#include <postgres.h>
+#include <fmgr.h>
+#include <miscadmin.h>
+#include <storage/latch.h>
+
+#include "bgw/invalidation_wakeup.h"
+#include "loader/invalidation_wakeup.h"
+
+static InvalidationWakeupRendezvous *invalidation_wakeup = NULL;
+
+/* Get the shared state, or NULL if the loader doesn't support it */
+static InvalidationWakeupRendezvous *
+get_invalidation_wakeup(void)
+{
+	if (invalidation_wakeup == NULL)
+	{
+		InvalidationWakeupRendezvous **rendezvous =
+			(InvalidationWakeupRendezvous **) find_rendezvous_variable(
+				RENDEZVOUS_INVALIDATION_WAKEUP);
+
+		invalidation_wakeup = *rendezvous;
+	}
+
+	return invalidation_wakeup;
+}
+
+/*
+ * Add the rows modified by a committed transaction. Called at commit, so this
+ * must not fail.
+ */
+void
+ts_invalidation_wakeup_add_rows(int32 hypertable_id, uint64 nrows)
+{
+	InvalidationWakeupRendezvous *wakeup = get_invalidation_wakeup();
+	InvalidationWakeupKey key = {
+		.database_id = MyDatabaseId,
+		.hypertable_id = hypertable_id,
+	};
+	InvalidationWakeupEntry *entry;
+
+	if (wakeup == NULL || nrows == 0)
+		return;
+
+	LWLockAcquire(wakeup->lock, LW_SHARED);
+	entry = hash_search(wakeup->entries, &key, HASH_FIND, NULL);
+
+	if (entry != NULL)
+	{
+		uint64 rows = pg_atomic_add_fetch_u64(&entry->rows, nrows);
+		uint64 wakeup_rows = pg_atomic_read_u64(&entry->wakeup_rows);
+
+		/* Only the transaction that reaches the wakeup count sets the latch */
+		if (rows >= wakeup_rows && rows - nrows < wakeup_rows)
+			SetLatch(entry->latch);
+	}
+
+	LWLockRelease(wakeup->lock);
+}
+
+/*
+ * Register a hypertable for the scheduler of the current database, and get
+ * the current count of modified rows. Returns false if the hypertable can't
+ * be registered, in which case the jobs only run on their schedule.
+ */
+bool
+ts_invalidation_wakeup_register(int32 hypertable_id, uint64 *rows)
+{
+	InvalidationWakeupRendezvous *wakeup = get_invalidation_wakeup();
+	InvalidationWakeupKey key = {
+		.database_id = MyDatabaseId,
+		.hypertable_id = hypertable_id,
+	};
+	InvalidationWakeupEntry *entry;
+	bool found;
+
+	if (wakeup == NULL)
+		return false;
+
+	LWLockAcquire(wakeup->lock, LW_EXCLUSIVE);
+	entry = hash_search(wakeup->entries, &key, HASH_ENTER_NULL, &found);
+
+	if (entry == NULL)
+	{
+		LWLockRelease(wakeup->lock);
+		elog(LOG,
+			 "too many hypertables with event-driven refresh policies, hypertable %d is "
+			 "refreshed on schedule",
+			 hypertable_id);
+		return false;
+	}
+
+	if (!found)
+	{
+		pg_atomic_init_u64(&entry->rows, 0);
+		pg_atomic_init_u64(&entry->wakeup_rows, PG_UINT64_MAX);
+	}
+
+	entry->latch = MyLatch;
+	*rows = pg_atomic_read_u64(&entry->rows);
+	LWLockRelease(wakeup->lock);
+
+	return true;
+}
+
+/* Get the count of modified rows of a registered hypertable */
+bool
+ts_invalidation_wakeup_get_rows(int32 hypertable_id, uint64 *rows)
+{
+	InvalidationWakeupRendezvous *wakeup = get_invalidation_wakeup();
+	InvalidationWakeupKey key = {
+		.database_id = MyDatabaseId,
+		.hypertable_id = hypertable_id,
+	};
+	InvalidationWakeupEntry *entry;
+
+	if (wakeup == NULL)
+		return false;
+
+	LWLockAcquire(wakeup->lock, LW_SHARED);
+	entry = hash_search(wakeup->entries, &key, HASH_FIND, NULL);
+
+	if (entry != NULL)
+		*rows = pg_atomic_read_u64(&entry->rows);
+
+	LWLockRelease(wakeup->lock);
+
+	return entry != NULL;
+}
+
+/* Set the count of modified rows at which to wake up the scheduler */
+void
+ts_invalidation_wakeup_set_wakeup_rows(int32 hypertable_id, uint64 wakeup_rows)
+{
+	InvalidationWakeupRendezvous *wakeup = get_invalidation_wakeup();
+	InvalidationWakeupKey key = {
+		.database_id = MyDatabaseId,
+		.hypertable_id = hypertable_id,
+	};
+	InvalidationWakeupEntry *entry;
+
+	if (wakeup == NULL)
+		return;
+
+	LWLockAcquire(wakeup->lock, LW_SHARED);
+	entry = hash_search(wakeup->entries, &key, HASH_FIND, NULL);
+
+	if (entry != NULL)
+		pg_atomic_write_u64(&entry->wakeup_rows, wakeup_rows);
+
+	LWLockRelease(wakeup->lock);
+}
+
+/*
+ * Remove the hypertables of the current database that are not in the list,
+ * e.g., all of them when the scheduler exits.
+ */
+void
+ts_invalidation_wakeup_unregister_others(List *hypertable_ids)
+{
+	InvalidationWakeupRendezvous *wakeup = get_invalidation_wakeup();
+	HASH_SEQ_STATUS status;
+	InvalidationWakeupEntry *entry;
+
+	if (wakeup == NULL)
+		return;
+
+	LWLockAcquire(wakeup->lock, LW_EXCLUSIVE);
+
+	/* Removing the current element is allowed during a sequential scan */
+	hash_seq_init(&status, wakeup->entries);
+
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.database_id == MyDatabaseId &&
+			!list_member_int(hypertable_ids, entry->key.hypertable_id))
+			hash_search(wakeup->entries, &entry->key, HASH_REMOVE, NULL);
+	}
+
+	LWLockRelease(wakeup->lock);
+}
@@ -0,0 +1,20 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <nodes/pg_list.h>
+
+#include "export.h"
+
+/* Used by the backends that modify the hypertables */
+extern TSDLLEXPORT void ts_invalidation_wakeup_add_rows(int32 hypertable_id, uint64 nrows);
+
+/* Used by the scheduler */
+extern bool ts_invalidation_wakeup_register(int32 hypertable_id, uint64 *rows);
+extern bool ts_invalidation_wakeup_get_rows(int32 hypertable_id, uint64 *rows);
+extern void ts_invalidation_wakeup_set_wakeup_rows(int32 hypertable_id, uint64 wakeup_rows);
+extern void ts_invalidation_wakeup_unregister_others(List *hypertable_ids);
@@ -8,6 +8,7 @@
 #include <unistd.h>
 #include <access/xact.h>
 #include <catalog/pg_authid.h>
+#include <commands/discard.h>
 #include <executor/execdebug.h>
 #include <executor/instrument.h>
 #include <miscadmin.h>
@@ -33,6 +34,9 @@
 #include <utils/timestamp.h>
 
 #include "compat/compat.h"
+#include "bgw/job_profile.h"
+#include "bgw/job_runner.h"
+#include "bgw/launcher_interface.h"
 #include "bgw/job_stat_history.h"
 #include "bgw/scheduler.h"
 #include "bgw_policy/chunk_stats.h"
@@ -40,12 +44,17 @@
 #include "config.h"
 #include "cross_module_fn.h"
 #include "debug_assert.h"
+#include "debug_point.h"
 #include "extension.h"
+#include "guc.h"
 #include "job.h"
 #include "job_stat.h"
+#include "jsonb_utils.h"
 #include "license_guc.h"
 #include "scan_iterator.h"
 #include "scanner.h"
+#include "trace.h"
+#include "ts_catalog/continuous_agg.h"
 #include "tss_callbacks.h"
 #include "utils.h"
 
@@ -56,6 +65,8 @@
 static scheduler_test_hook_type scheduler_test_hook = NULL;
 static char *job_entrypoint_function_name = "ts_bgw_job_entrypoint";
 
+static void bgw_job_get_refresh_invalidated_rows(BgwJob *job);
+
 /*
  * Get the mem_guard callbacks.
  *
@@ -81,21 +92,101 @@ typedef enum JobLockLifetime
 	TXN_LOCK,
 } JobLockLifetime;
 
-BackgroundWorkerHandle *
-ts_bgw_job_start(BgwJob *job, Oid user_oid)
+void
+ts_bgw_job_init_params(BgwJob *job, Oid user_oid, BgwParams *bgw_params)
 {
-	BgwParams bgw_params = {
+	*bgw_params = (BgwParams){
 		.job_id = Int32GetDatum(job->fd.id),
 		.job_history_id = job->job_history.id,
 		.job_history_execution_start = job->job_history.execution_start,
 		.user_oid = user_oid,
+		.job_runner_pool = DSM_HANDLE_INVALID,
 	};
 
-	strlcpy(bgw_params.bgw_main, job_entrypoint_function_name, sizeof(bgw_params.bgw_main));
+	strlcpy(bgw_params->bgw_main, job_entrypoint_function_name, sizeof(bgw_params->bgw_main));
+}
+
+BackgroundWorkerHandle *
+ts_bgw_job_start(BgwJob *job, Oid user_oid)
+{
+	BgwParams bgw_params;
+
+	ts_bgw_job_init_params(job, user_oid, &bgw_params);
 
 	return ts_bgw_start_worker(NameStr(job->fd.application_name), &bgw_params);
 }
 
+/*
+ * Start a helper worker that runs a part of a job in parallel with the job,
+ * e.g., compresses the chunks of a compression policy, as the current user.
+ * The work is passed in the dynamic shared memory segment with the handle
+ * and is done by ts_cm_functions->bgw_job_helper_main().
+ *
+ * The helper workers count against the background workers of TimescaleDB,
+ * the same as the jobs. Returns NULL if there is no background worker
+ * available, and the handle otherwise, which must be passed to
+ * ts_bgw_job_wait_for_helper().
+ */
+BackgroundWorkerHandle *
+ts_bgw_job_start_helper(int32 job_id, dsm_handle handle)
+{
+	BgwJobHelperParams params = {
+		.user_oid = GetUserId(),
+		.job_id = job_id,
+		.handle = handle,
+	};
+	BackgroundWorker worker = {
+		.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION,
+		.bgw_start_time = BgWorkerStart_RecoveryFinished,
+		.bgw_restart_time = BGW_NEVER_RESTART,
+		.bgw_notify_pid = MyProcPid,
+		.bgw_main_arg = ObjectIdGetDatum(MyDatabaseId),
+	};
+	BackgroundWorkerHandle *worker_handle = NULL;
+
+	/* Lets the tests check the fallback when no background worker is available */
+	if (DEBUG_POINT_IS_ENABLED("bgw_job_start_helper"))
+		return NULL;
+
+	if (!ts_bgw_worker_reserve())
+		return NULL;
+
+	snprintf(worker.bgw_name, BGW_MAXLEN, "TimescaleDB Background Worker Job %d Helper", job_id);
+	strlcpy(worker.bgw_library_name, ts_extension_get_so_name(), BGW_MAXLEN);
+	strlcpy(worker.bgw_function_name, "ts_bgw_job_helper_entrypoint", BGW_MAXLEN);
+	memcpy(worker.bgw_extra, &params, sizeof(params));
+
+	if (!RegisterDynamicBackgroundWorker(&worker, &worker_handle))
+	{
+		ts_bgw_worker_release();
+		return NULL;
+	}
+
+	return worker_handle;
+}
+
+/*
+ * Terminate a helper worker without waiting for it to exit, e.g., when the
+ * job fails, and release its background worker.
+ */
+void
+ts_bgw_job_terminate_helper(BackgroundWorkerHandle *handle)
+{
+	TerminateBackgroundWorker(handle);
+	ts_bgw_worker_release();
+}
+
+/*
+ * Wait for a helper worker to exit and release its background worker.
+ */
+void
+ts_bgw_job_wait_for_helper(BackgroundWorkerHandle *handle)
+{
+	WaitForBackgroundWorkerShutdown(handle);
+	ts_bgw_worker_release();
+	pfree(handle);
+}
+
 static void
 job_execute_function(FuncExpr *funcexpr)
 {
@@ -369,10 +460,17 @@ ts_bgw_job_get_scheduled(size_t alloc_size, MemoryContext mctx)
 		value = slot_getattr(ti->slot, Anum_bgw_job_hypertable_id, &isnull);
 		job->fd.hypertable_id = isnull ? 0 : DatumGetInt32(value);
 
+		/* The scheduler only needs the config to get the class of the job */
+		value = slot_getattr(ti->slot, Anum_bgw_job_config, &isnull);
+		job->fd.config = isnull ? NULL : DatumGetJsonbP(value);
+		job->job_class = ts_bgw_job_get_class(job);
+		bgw_job_get_refresh_invalidated_rows(job);
+
 		/* We skip config, check_name, and check_schema since the scheduler
-		 * doesn't need these, it saves us from detoasting, and simplifies
-		 * freeing job lists in the scheduler as otherwise the config field
-		 * would have to be freed separately when freeing a job. */
+		 * doesn't need these, it saves us from detoasting in the scheduler
+		 * memory context, and simplifies freeing job lists in the scheduler as
+		 * otherwise the config field would have to be freed separately when
+		 * freeing a job. */
 		job->fd.config = NULL;
 
 		old_ctx = MemoryContextSwitchTo(mctx);
@@ -475,6 +573,33 @@ ts_bgw_job_find_by_proc_and_hypertable_id(const char *proc_name, const char *pro
 	return list_data.list;
 }
 
+List *
+ts_bgw_job_find_by_proc(const char *proc_name, const char *proc_schema)
+{
+	Catalog *catalog = ts_catalog_get();
+	ScanKeyData scankey[2];
+	AccumData list_data = {
+		.list = NIL,
+		.alloc_size = sizeof(BgwJob),
+	};
+	ScannerCtx scanctx = {
+		.table = catalog_get_table_id(catalog, BGW_JOB),
+		.index = catalog_get_index(ts_catalog_get(), BGW_JOB, BGW_JOB_PROC_HYPERTABLE_ID_IDX),
+		.data = &list_data,
+		.scankey = scankey,
+		.nkeys = sizeof(scankey) / sizeof(*scankey),
+		.tuple_found = bgw_job_accum_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	init_scan_by_proc_schema(&scankey[0], proc_schema);
+	init_scan_by_proc_name(&scankey[1], proc_name);
+
+	ts_scanner_scan(&scanctx);
+	return list_data.list;
+}
+
 List *
 ts_bgw_job_find_by_hypertable_id(int32 hypertable_id)
 {
@@ -541,6 +666,15 @@ ts_lock_job_id(int32 job_id, LOCKMODE mode, bool session_lock, LOCKTAG *tag, boo
 	return LockAcquire(tag, mode, session_lock, !block) != LOCKACQUIRE_NOT_AVAIL;
 }
 
+static void
+unlock_job_id(int32 job_id, LOCKMODE mode, bool session_lock)
+{
+	LOCKTAG tag;
+
+	TS_SET_LOCKTAG_ADVISORY(tag, MyDatabaseId, job_id, 0);
+	LockRelease(&tag, mode, session_lock);
+}
+
 static BgwJob *
 ts_bgw_job_find_with_lock(int32 bgw_job_id, MemoryContext mctx, LOCKMODE tuple_lock_mode,
 						  JobLockLifetime lock_type, bool block, bool *got_lock)
@@ -1011,6 +1145,107 @@ ts_is_telemetry_job(BgwJob *job)
 }
 #endif
 
+static const char *const job_class_names[_JOB_CLASS_MAX] = {
+	[JOB_CLASS_REFRESH] = "refresh",
+	[JOB_CLASS_CUSTOM] = "custom",
+	[JOB_CLASS_MAINTENANCE] = "maintenance",
+};
+
+const char *
+ts_bgw_job_class_name(BgwJobClass job_class)
+{
+	Assert(job_class >= 0 && job_class < _JOB_CLASS_MAX);
+	return job_class_names[job_class];
+}
+
+/*
+ * Get the concurrency class of the job.
+ *
+ * The class can be set with the "job_class" key in the job config. Otherwise
+ * the continuous aggregate refresh policies are refresh jobs, since the
+ * freshness of the aggregates is visible to the users, the other policies are
+ * maintenance jobs, and the user-defined actions are custom jobs.
+ */
+BgwJobClass
+ts_bgw_job_get_class(BgwJob *job)
+{
+	if (job->fd.config != NULL)
+	{
+		char *name = ts_jsonb_get_str_field(job->fd.config, BGW_JOB_CONFIG_KEY_CLASS);
+
+		if (name != NULL)
+		{
+			for (int i = 0; i < _JOB_CLASS_MAX; i++)
+			{
+				if (pg_strcasecmp(name, job_class_names[i]) == 0)
+					return (BgwJobClass) i;
+			}
+
+			elog(LOG,
+				 "invalid job class \"%s\" for job %d, using the default class",
+				 name,
+				 job->fd.id);
+		}
+	}
+
+	if (namestrcmp(&job->fd.proc_schema, FUNCTIONS_SCHEMA_NAME) != 0)
+		return JOB_CLASS_CUSTOM;
+
+	if (namestrcmp(&job->fd.proc_name, "policy_refresh_continuous_aggregate") == 0)
+		return JOB_CLASS_REFRESH;
+
+	return JOB_CLASS_MAINTENANCE;
+}
+
+/*
+ * Get the number of modified rows of the raw hypertable after which a
+ * continuous aggregate refresh policy is started before its schedule, see
+ * invalidation_wakeup.c. An invalid value is ignored rather than failing the
+ * scheduler, the policy check rejects it when the config is set.
+ */
+static void
+bgw_job_get_refresh_invalidated_rows(BgwJob *job)
+{
+	ContinuousAgg *cagg;
+	char *value;
+	char *end;
+	int64 rows;
+
+	job->refresh_invalidated_rows = 0;
+	job->raw_hypertable_id = 0;
+
+	if (job->fd.config == NULL || job->fd.hypertable_id == 0 ||
+		namestrcmp(&job->fd.proc_schema, FUNCTIONS_SCHEMA_NAME) != 0 ||
+		namestrcmp(&job->fd.proc_name, "policy_refresh_continuous_aggregate") != 0)
+		return;
+
+	value = ts_jsonb_get_str_field(job->fd.config, BGW_JOB_CONFIG_KEY_REFRESH_ON_INVALIDATED_ROWS);
+
+	if (value == NULL)
+		return;
+
+	errno = 0;
+	rows = strtoi64(value, &end, 10);
+
+	if (errno != 0 || *end != '\0' || rows <= 0)
+	{
+		elog(LOG,
+			 "invalid %s \"%s\" for job %d, the job runs on schedule",
+			 BGW_JOB_CONFIG_KEY_REFRESH_ON_INVALIDATED_ROWS,
+			 value,
+			 job->fd.id);
+		return;
+	}
+
+	cagg = ts_continuous_agg_find_by_mat_hypertable_id(job->fd.hypertable_id, true);
+
+	if (cagg == NULL)
+		return;
+
+	job->refresh_invalidated_rows = rows;
+	job->raw_hypertable_id = cagg->data.raw_hypertable_id;
+}
+
 JobResult
 ts_bgw_job_execute(BgwJob *job)
 {
@@ -1133,58 +1368,28 @@ ts_bgw_job_function_call_string(BgwJob *job)
 	return stmt->data;
 }
 
-extern Datum
-ts_bgw_job_entrypoint(PG_FUNCTION_ARGS)
+/*
+ * Run the job of the parameters in the background worker.
+ */
+static void
+bgw_job_run(const BgwParams *params)
 {
-	Oid db_oid = DatumGetObjectId(MyBgworkerEntry->bgw_main_arg);
-	BgwParams params;
 	BgwJob *job;
 	JobResult res = JOB_FAILURE_IN_EXECUTION;
 	bool got_lock;
 	instr_time start;
 	instr_time duration;
 
-	memcpy(&params, MyBgworkerEntry->bgw_extra, sizeof(BgwParams));
-	Ensure(OidIsValid(params.user_oid) && params.job_id != 0,
-		   "job id or user oid was zero - job_id: %d, user_oid: %d",
-		   params.job_id,
-		   params.user_oid);
-
-	BackgroundWorkerBlockSignals();
-	/* Setup any signal handlers here */
-
-	/*
-	 * do not use the default `bgworker_die` sigterm handler because it does
-	 * not respect critical sections
-	 */
-	pqsignal(SIGTERM, die);
-	BackgroundWorkerUnblockSignals();
-
-	/*
-	 * Set up mem_guard before starting to allocate (any significant amounts
-	 * of) memory but after we have unblocked signals since we have no control
-	 * over how the callback behaves.
-	 */
-	MGCallbacks *callbacks = ts_get_mem_guard_callbacks();
-	if (callbacks && callbacks->version_num == MG_CALLBACKS_VERSION &&
-		callbacks->toggle_allocation_blocking && !callbacks->enabled)
-		callbacks->toggle_allocation_blocking(/*enable=*/true);
-
-	BackgroundWorkerInitializeConnectionByOid(db_oid, params.user_oid, 0);
-
-	log_min_messages = ts_guc_bgw_log_level;
-
-	elog(DEBUG2, "job %d started execution", params.job_id);
-
-	ts_license_enable_module_loading();
+	elog(DEBUG2, "job %d started execution", params->job_id);
 
 	INSTR_TIME_SET_CURRENT(start);
 
 	StartTransactionCommand();
 
-	/* Grab a session lock on the job row to prevent concurrent deletes. Lock is released
-	 * when the job process exits */
-	job = ts_bgw_job_find_with_lock(params.job_id,
+	/* Grab a session lock on the job row to prevent concurrent deletes. The lock is
+	 * released at the end of this function, since a pooled job runner doesn't exit
+	 * after the job, or when the job process exits on an error */
+	job = ts_bgw_job_find_with_lock(params->job_id,
 									TopMemoryContext,
 									RowShareLock,
 									SESSION_LOCK,
@@ -1192,16 +1397,15 @@ ts_bgw_job_entrypoint(PG_FUNCTION_ARGS)
 									&got_lock);
 	if (job == NULL)
 		/* If the job is not found, we can't proceed */
-		elog(ERROR, "job %d not found when running the background worker", params.job_id);
+		elog(ERROR, "job %d not found when running the background worker", params->job_id);
 
 	/* get parameters from bgworker */
-	job->job_history.id = params.job_history_id;
-	job->job_history.execution_start = params.job_history_execution_start;
-	ts_bgw_job_stat_history_update(JOB_STAT_HISTORY_UPDATE_PID, job, JOB_SUCCESS, NULL);
+	job->job_history.id = params->job_history_id;
+	job->job_history.execution_start = params->job_history_execution_start;
 
 	CommitTransactionCommand();
 
-	elog(DEBUG2, "job %d (%s) found", params.job_id, NameStr(job->fd.application_name));
+	elog(DEBUG2, "job %d (%s) found", params->job_id, NameStr(job->fd.application_name));
 
 	pgstat_report_appname(NameStr(job->fd.application_name));
 	MemoryContext oldcontext = CurrentMemoryContext;
@@ -1210,6 +1414,10 @@ ts_bgw_job_entrypoint(PG_FUNCTION_ARGS)
 	if (scheduler_test_hook == NULL)
 		ts_begin_tss_store_callback();
 
+	/* The timings of the phases are written to the execution history */
+	if (ts_guc_enable_job_execution_logging)
+		ts_job_profile_begin();
+
 	PG_TRY();
 	{
 		/*
@@ -1220,6 +1428,7 @@ ts_bgw_job_entrypoint(PG_FUNCTION_ARGS)
 		zero_guc("max_parallel_workers");
 		zero_guc("max_parallel_maintenance_workers");
 
+		TIMESCALEDB_BGW_JOB_START(params->job_id);
 		res = ts_bgw_job_execute(job);
 
 		/* The job is responsible for committing or aborting it's own txns */
@@ -1259,7 +1468,7 @@ ts_bgw_job_entrypoint(PG_FUNCTION_ARGS)
 		 * removed the session lock. Don't block and only record if the lock was actually
 		 * obtained.
 		 */
-		job = ts_bgw_job_find_with_lock(params.job_id,
+		job = ts_bgw_job_find_with_lock(params->job_id,
 										TopMemoryContext,
 										RowShareLock,
 										TXN_LOCK,
@@ -1270,8 +1479,8 @@ ts_bgw_job_entrypoint(PG_FUNCTION_ARGS)
 			namestrcpy(&proc_name, NameStr(job->fd.proc_name));
 			namestrcpy(&proc_schema, NameStr(job->fd.proc_schema));
 
-			job->job_history.id = params.job_history_id;
-			job->job_history.execution_start = params.job_history_execution_start;
+			job->job_history.id = params->job_history_id;
+			job->job_history.execution_start = params->job_history_execution_start;
 
 			ts_bgw_job_stat_mark_end(job,
 									 JOB_FAILURE_IN_EXECUTION,
@@ -1279,12 +1488,14 @@ ts_bgw_job_entrypoint(PG_FUNCTION_ARGS)
 			ts_bgw_job_check_max_retries(job);
 			pfree(job);
 		}
+		ts_job_profile_end();
 
 		/*
 		 * the rethrow will log the error; but also log which job threw the
 		 * error
 		 */
-		elog(LOG, "job %d threw an error", params.job_id);
+		elog(LOG, "job %d threw an error", params->job_id);
+		TIMESCALEDB_BGW_JOB_DONE(params->job_id, false);
 
 		CommitTransactionCommand();
 		ReThrowError(edata);
@@ -1300,6 +1511,7 @@ ts_bgw_job_entrypoint(PG_FUNCTION_ARGS)
 	 * is launched
 	 */
 	ts_bgw_job_stat_mark_end(job, res, NULL);
+	ts_job_profile_end();
 
 	if (!job_failed && ts_is_tss_enabled() && scheduler_test_hook == NULL)
 	{
@@ -1312,18 +1524,113 @@ ts_bgw_job_entrypoint(PG_FUNCTION_ARGS)
 	INSTR_TIME_SET_CURRENT(duration);
 	INSTR_TIME_SUBTRACT(duration, start);
 
+	TIMESCALEDB_BGW_JOB_DONE(params->job_id, res == JOB_SUCCESS);
+
 	elog(DEBUG1,
 		 "job %d (%s) exiting with %s: execution time %.2f ms",
-		 params.job_id,
+		 params->job_id,
 		 NameStr(job->fd.application_name),
 		 (res == JOB_SUCCESS ? "success" : "failure"),
 		 INSTR_TIME_GET_MILLISEC(duration));
 
+	/* Let delete_job() of this job go ahead while the runner waits for the next job */
+	unlock_job_id(params->job_id, RowShareLock, /* session_lock */ true);
+
 	if (job != NULL)
 	{
 		pfree(job);
 		job = NULL;
 	}
+}
+
+extern Datum
+ts_bgw_job_entrypoint(PG_FUNCTION_ARGS)
+{
+	Oid db_oid = DatumGetObjectId(MyBgworkerEntry->bgw_main_arg);
+	BgwParams params;
+	bool pooled;
+
+	memcpy(&params, MyBgworkerEntry->bgw_extra, sizeof(BgwParams));
+	Ensure(OidIsValid(params.user_oid) && params.job_id != 0,
+		   "job id or user oid was zero - job_id: %d, user_oid: %d",
+		   params.job_id,
+		   params.user_oid);
+
+	BackgroundWorkerBlockSignals();
+	/* Setup any signal handlers here */
+
+	/*
+	 * do not use the default `bgworker_die` sigterm handler because it does
+	 * not respect critical sections
+	 */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/*
+	 * Set up mem_guard before starting to allocate (any significant amounts
+	 * of) memory but after we have unblocked signals since we have no control
+	 * over how the callback behaves.
+	 */
+	MGCallbacks *callbacks = ts_get_mem_guard_callbacks();
+	if (callbacks && callbacks->version_num == MG_CALLBACKS_VERSION &&
+		callbacks->toggle_allocation_blocking && !callbacks->enabled)
+		callbacks->toggle_allocation_blocking(/*enable=*/true);
+
+	BackgroundWorkerInitializeConnectionByOid(db_oid, params.user_oid, 0);
+
+	log_min_messages = ts_guc_bgw_log_level;
+
+	ts_license_enable_module_loading();
+
+	/*
+	 * A pooled job runner runs the next jobs that the scheduler passes to it
+	 * after the first job, which is in the parameters of the worker.
+	 */
+	pooled = ts_bgw_job_runner_attach(&params);
+
+	for (;;)
+	{
+		bgw_job_run(&params);
+
+		if (!pooled)
+			break;
+
+		/* Don't leave any session state of the job to the next job */
+		StartTransactionCommand();
+		DiscardStmt discard = { .type = T_DiscardStmt, .target = DISCARD_ALL };
+		DiscardCommand(&discard, true);
+		CommitTransactionCommand();
+		log_min_messages = ts_guc_bgw_log_level;
+
+		if (!ts_bgw_job_runner_next_job(&params))
+			break;
+	}
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Entrypoint of the helper workers started with ts_bgw_job_start_helper().
+ */
+Datum
+ts_bgw_job_helper_entrypoint(PG_FUNCTION_ARGS)
+{
+	Oid db_oid = DatumGetObjectId(MyBgworkerEntry->bgw_main_arg);
+	BgwJobHelperParams params;
+
+	memcpy(&params, MyBgworkerEntry->bgw_extra, sizeof(params));
+
+	BackgroundWorkerBlockSignals();
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnectionByOid(db_oid, params.user_oid, 0);
+
+	log_min_messages = ts_guc_bgw_log_level;
+
+	ts_license_enable_module_loading();
+
+	ts_cm_functions->bgw_job_helper_main(params.job_id, params.handle);
 
 	PG_RETURN_VOID();
 }
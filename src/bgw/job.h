@@ -11,6 +11,7 @@
 
 #include "export.h"
 #include "ts_catalog/catalog.h"
+#include "worker.h"
 
 #define TELEMETRY_INITIAL_NUM_RUNS 12
 #define SCHEDULER_APPNAME "TimescaleDB Background Worker Scheduler"
@@ -40,6 +41,28 @@ typedef struct MGCallbacks
 	mg_enabled enabled;
 } MGCallbacks;
 
+/*
+ * The concurrency classes of the jobs, in the order of priority. The scheduler
+ * starts the due jobs of the higher priority classes first, and limits the
+ * number of running jobs of each class, see ts_bgw_job_get_class().
+ */
+typedef enum BgwJobClass
+{
+	JOB_CLASS_REFRESH = 0,
+	JOB_CLASS_CUSTOM,
+	JOB_CLASS_MAINTENANCE,
+	_JOB_CLASS_MAX,
+} BgwJobClass;
+
+#define BGW_JOB_CONFIG_KEY_CLASS "job_class"
+
+/*
+ * The number of modified rows of the raw hypertable after which a continuous
+ * aggregate refresh policy runs before its schedule. The schedule interval is
+ * then the maximum staleness of the continuous aggregate.
+ */
+#define BGW_JOB_CONFIG_KEY_REFRESH_ON_INVALIDATED_ROWS "refresh_on_invalidated_rows"
+
 typedef struct BgwJobHistory
 {
 	int64 id;
@@ -50,6 +73,11 @@ typedef struct BgwJob
 {
 	FormData_bgw_job fd;
 	BgwJobHistory job_history;
+	/* Only set for the jobs of ts_bgw_job_get_scheduled() */
+	BgwJobClass job_class;
+	/* Zero if the job only runs on schedule, see invalidation_wakeup.c */
+	int64 refresh_invalidated_rows;
+	int32 raw_hypertable_id;
 } BgwJob;
 
 /* Positive result numbers reserved for success */
@@ -60,15 +88,34 @@ typedef enum JobResult
 	JOB_SUCCESS = 1,
 } JobResult;
 
+/*
+ * Parameters to the helper workers of a job, see ts_bgw_job_start_helper().
+ */
+typedef struct BgwJobHelperParams
+{
+	Oid user_oid;
+	int32 job_id;
+	dsm_handle handle;
+} BgwJobHelperParams;
+
 typedef bool job_main_func(void);
 typedef bool (*scheduler_test_hook_type)(BgwJob *job);
 
+extern void ts_bgw_job_init_params(BgwJob *job, Oid user_oid, BgwParams *bgw_params);
 extern BackgroundWorkerHandle *ts_bgw_job_start(BgwJob *job, Oid user_oid);
+extern TSDLLEXPORT BackgroundWorkerHandle *ts_bgw_job_start_helper(int32 job_id,
+																 dsm_handle handle);
+extern TSDLLEXPORT void ts_bgw_job_wait_for_helper(BackgroundWorkerHandle *handle);
+extern TSDLLEXPORT void ts_bgw_job_terminate_helper(BackgroundWorkerHandle *handle);
+
+extern BgwJobClass ts_bgw_job_get_class(BgwJob *job);
+extern const char *ts_bgw_job_class_name(BgwJobClass job_class);
 
 extern List *ts_bgw_job_get_all(size_t alloc_size, MemoryContext mctx);
 extern List *ts_bgw_job_get_scheduled(size_t alloc_size, MemoryContext mctx);
 
 extern TSDLLEXPORT List *ts_bgw_job_find_by_hypertable_id(int32 hypertable_id);
+extern TSDLLEXPORT List *ts_bgw_job_find_by_proc(const char *proc_name, const char *proc_schema);
 extern TSDLLEXPORT List *ts_bgw_job_find_by_proc_and_hypertable_id(const char *proc_name,
 																   const char *proc_schema,
 																   int32 hypertable_id);
@@ -96,6 +143,7 @@ extern JobResult ts_bgw_job_execute(BgwJob *job);
 extern TSDLLEXPORT void ts_bgw_job_run_config_check(Oid check, int32 job_id, Jsonb *config);
 
 extern TSDLLEXPORT Datum ts_bgw_job_entrypoint(PG_FUNCTION_ARGS);
+extern TSDLLEXPORT Datum ts_bgw_job_helper_entrypoint(PG_FUNCTION_ARGS);
 extern void ts_bgw_job_set_scheduler_test_hook(scheduler_test_hook_type hook);
 extern void ts_bgw_job_set_job_entrypoint_function_name(char *func_name);
 extern TSDLLEXPORT bool ts_bgw_job_run_and_set_next_start(BgwJob *job, job_main_func func,
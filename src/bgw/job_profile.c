@@ -0,0 +1,124 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#include <postgres.h>
+#include <utils/jsonb.h>
+
+#include "job_profile.h"
+#include "jsonb_utils.h"
+
+/*
+ * The phases are few, and their names are string constants, so they are
+ * kept in a fixed array that survives the transactions of the job.
+ */
+#define MAX_JOB_PHASES 16
+
+typedef struct JobPhase
+{
+	const char *name;
+	int64 calls;
+	instr_time total;
+} JobPhase;
+
+static bool job_profile_active = false;
+static JobPhase job_phases[MAX_JOB_PHASES];
+static int num_job_phases = 0;
+
+void
+ts_job_phase_start(instr_time *start)
+{
+	if (job_profile_active)
+		INSTR_TIME_SET_CURRENT(*start);
+	else
+		INSTR_TIME_SET_ZERO(*start);
+}
+
+void
+ts_job_phase_end(const char *phase, const instr_time *start)
+{
+	instr_time duration;
+	int i;
+
+	/* The job might have started after the start of the phase */
+	if (!job_profile_active || INSTR_TIME_IS_ZERO(*start))
+		return;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, *start);
+
+	for (i = 0; i < num_job_phases; i++)
+	{
+		if (strcmp(job_phases[i].name, phase) == 0)
+			break;
+	}
+
+	if (i == num_job_phases)
+	{
+		/* More phases than expected, which are not recorded */
+		if (num_job_phases == MAX_JOB_PHASES)
+			return;
+
+		job_phases[i].name = phase;
+		job_phases[i].calls = 0;
+		INSTR_TIME_SET_ZERO(job_phases[i].total);
+		num_job_phases++;
+	}
+
+	job_phases[i].calls++;
+	INSTR_TIME_ADD(job_phases[i].total, duration);
+}
+
+/*
+ * Start timing the phases of a job execution.
+ */
+void
+ts_job_profile_begin(void)
+{
+	job_profile_active = true;
+	num_job_phases = 0;
+}
+
+/*
+ * Stop timing the phases, after the execution history is written.
+ */
+void
+ts_job_profile_end(void)
+{
+	job_profile_active = false;
+	num_job_phases = 0;
+}
+
+/*
+ * Add the timings of the phases as an object with the number of calls and the
+ * total time in milliseconds of each phase, e.g.,
+ * {"sort": {"calls": 2, "total_ms": 12.5}}. Nothing is added if no phases were
+ * timed.
+ */
+void
+ts_job_profile_add_jsonb(JsonbParseState *parse_state, const char *key)
+{
+	JsonbParseState *phases_state = NULL;
+	JsonbValue value = { 0 };
+
+	if (num_job_phases == 0)
+		return;
+
+	pushJsonbValue(&phases_state, WJB_BEGIN_OBJECT, NULL);
+	for (int i = 0; i < num_job_phases; i++)
+	{
+		JsonbParseState *phase_state = NULL;
+
+		pushJsonbValue(&phase_state, WJB_BEGIN_OBJECT, NULL);
+		ts_jsonb_add_int64(phase_state, "calls", job_phases[i].calls);
+		ts_jsonb_add_float8(phase_state, "total_ms", INSTR_TIME_GET_MILLISEC(job_phases[i].total));
+		JsonbToJsonbValue(JsonbValueToJsonb(pushJsonbValue(&phase_state, WJB_END_OBJECT, NULL)),
+						  &value);
+		ts_jsonb_add_value(phases_state, job_phases[i].name, &value);
+	}
+
+	JsonbToJsonbValue(JsonbValueToJsonb(pushJsonbValue(&phases_state, WJB_END_OBJECT, NULL)),
+					  &value);
+	ts_jsonb_add_value(parse_state, key, &value);
+}
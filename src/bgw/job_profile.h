@@ -0,0 +1,28 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <portability/instr_time.h>
+#include <utils/jsonb.h>
+
+#include "export.h"
+
+/*
+ * The timings of the phases of a job execution, which are recorded in the
+ * job execution history when timescaledb.enable_job_execution_logging is on.
+ *
+ * A phase is timed by calling ts_job_phase_start() before it and
+ * ts_job_phase_end() with the name of the phase after it. The times of the
+ * phases with the same name are added up. The phases are only timed while a
+ * background job is executed, otherwise these do nothing.
+ */
+extern TSDLLEXPORT void ts_job_phase_start(instr_time *start);
+extern TSDLLEXPORT void ts_job_phase_end(const char *phase, const instr_time *start);
+
+extern void ts_job_profile_begin(void);
+extern void ts_job_profile_end(void);
+extern void ts_job_profile_add_jsonb(JsonbParseState *parse_state, const char *key);
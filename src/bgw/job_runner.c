@@ -0,0 +1,486 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Pool of job runners for the scheduler of a database.
+ *
+ * Starting a background worker for every job execution means paying for the
+ * fork, the backend initialization and the warm-up of the caches, which can
+ * take longer than the job itself for frequent short jobs. With
+ * timescaledb.bgw_job_runner_lifetime set, the workers wait for the next job
+ * of the same owner after finishing a job, instead of exiting, until they
+ * were idle for JOB_RUNNER_IDLE_TIMEOUT_MS or reached the configured
+ * lifetime.
+ *
+ * The pool is a dynamic shared memory segment created by the scheduler, with
+ * a slot for every runner. The state of a slot goes through:
+ *
+ * - FREE: the slot is not used.
+ * - RUNNING: the runner is running a job. The scheduler starts a new runner
+ *   in this state, with the job in the parameters of the background worker.
+ * - IDLE: the runner finished the job and waits for the next one.
+ * - CLAIMED: the scheduler picked the idle runner for a job it is starting.
+ * - ASSIGNED: the scheduler put the job in the slot for the runner.
+ * - EXITING: the runner exits, and doesn't use the slot anymore.
+ *
+ * The scheduler sees the end of a job on a runner from the IDLE state instead
+ * of the exit of the worker. A runner that fails a job exits as before, and
+ * so does a runner that the scheduler terminates because of a job timeout.
+ *
+ * The scheduler keeps the handle of an idle runner and the background worker
+ * that is reserved for it. They belong to the scheduled job while the runner
+ * runs a job of it.
+ */
+#include <postgres.h>
+
+#include <miscadmin.h>
+#include <pgstat.h>
+#include <postmaster/bgworker.h>
+#include <postmaster/interrupt.h>
+#include <storage/dsm.h>
+#include <storage/latch.h>
+#include <storage/spin.h>
+#include <utils/memutils.h>
+#include <utils/timestamp.h>
+
+#include "bgw/job_runner.h"
+#include "guc.h"
+#include "launcher_interface.h"
+
+#define JOB_RUNNER_IDLE_TIMEOUT_MS (60 * 1000)
+#define JOB_RUNNER_POLL_MS 1000
+
+typedef enum JobRunnerState
+{
+	JOB_RUNNER_FREE = 0,
+	JOB_RUNNER_RUNNING,
+	JOB_RUNNER_IDLE,
+	JOB_RUNNER_CLAIMED,
+	JOB_RUNNER_ASSIGNED,
+	JOB_RUNNER_EXITING,
+} JobRunnerState;
+
+typedef struct JobRunnerSlot
+{
+	slock_t mutex;
+	JobRunnerState state;
+	Oid user_oid;
+	pid_t pid;
+	Latch *latch;
+	BgwParams params; /* The job to run */
+} JobRunnerSlot;
+
+typedef struct JobRunnerPool
+{
+	Latch *scheduler_latch;
+	bool shutdown;
+	int num_slots;
+	JobRunnerSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} JobRunnerPool;
+
+/* The state of a runner that only the scheduler knows */
+typedef struct JobRunner
+{
+	/* The handle of the idle runner, NULL while it runs a job */
+	BackgroundWorkerHandle *handle;
+	bool reserved_worker;
+} JobRunner;
+
+static JobRunnerPool *pool = NULL;
+
+/* In the scheduler */
+static dsm_segment *pool_segment = NULL;
+static JobRunner *runners = NULL;
+
+/* In the runners */
+static int my_runner = JOB_RUNNER_NONE;
+static TimestampTz my_runner_start = 0;
+
+static bool
+job_runner_pool_create(void)
+{
+	Size size = add_size(offsetof(JobRunnerPool, slots),
+						 mul_size(max_worker_processes, sizeof(JobRunnerSlot)));
+
+	pool_segment = dsm_create(size, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+
+	if (pool_segment == NULL)
+	{
+		elog(LOG, "could not create the job runner pool, starting a worker for every job");
+		return false;
+	}
+
+	/* Keep the pool for the lifetime of the scheduler */
+	dsm_pin_mapping(pool_segment);
+
+	pool = dsm_segment_address(pool_segment);
+	memset(pool, 0, size);
+	pool->scheduler_latch = MyLatch;
+	pool->num_slots = max_worker_processes;
+
+	for (int i = 0; i < pool->num_slots; i++)
+		SpinLockInit(&pool->slots[i].mutex);
+
+	runners = MemoryContextAllocZero(TopMemoryContext, sizeof(JobRunner) * pool->num_slots);
+
+	return true;
+}
+
+static bool
+job_runner_is_alive(BackgroundWorkerHandle *handle)
+{
+	pid_t pid;
+
+	return GetBackgroundWorkerPid(handle, &pid) == BGWH_STARTED;
+}
+
+/*
+ * Claim an idle runner of the user to start a job on it. Returns the runner,
+ * with its handle in the handle argument and its reserved background worker
+ * passing to the caller, or JOB_RUNNER_NONE if there is no idle runner.
+ */
+int
+ts_bgw_job_runner_claim(Oid user_oid, BackgroundWorkerHandle **handle)
+{
+	if (pool_segment == NULL || ts_guc_bgw_job_runner_lifetime == 0)
+		return JOB_RUNNER_NONE;
+
+	for (int i = 0; i < pool->num_slots; i++)
+	{
+		JobRunnerSlot *slot = &pool->slots[i];
+		bool claimed = false;
+
+		if (runners[i].handle == NULL || !job_runner_is_alive(runners[i].handle))
+			continue;
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->state == JOB_RUNNER_IDLE && slot->user_oid == user_oid)
+		{
+			slot->state = JOB_RUNNER_CLAIMED;
+			claimed = true;
+		}
+		SpinLockRelease(&slot->mutex);
+
+		if (claimed)
+		{
+			Assert(runners[i].reserved_worker);
+			*handle = runners[i].handle;
+			runners[i].handle = NULL;
+			runners[i].reserved_worker = false;
+			return i;
+		}
+	}
+
+	return JOB_RUNNER_NONE;
+}
+
+/*
+ * Pass the job to the claimed runner.
+ */
+void
+ts_bgw_job_runner_dispatch(int runner, const BgwParams *params)
+{
+	JobRunnerSlot *slot = &pool->slots[runner];
+	Latch *latch;
+
+	SpinLockAcquire(&slot->mutex);
+	Assert(slot->state == JOB_RUNNER_CLAIMED);
+	slot->params = *params;
+	slot->state = JOB_RUNNER_ASSIGNED;
+	latch = slot->latch;
+	SpinLockRelease(&slot->mutex);
+
+	SetLatch(latch);
+}
+
+/*
+ * Prepare a slot for a new runner that is started with the job in the
+ * parameters. Returns the runner, or JOB_RUNNER_NONE if the job should run in
+ * a worker that exits after the job.
+ */
+int
+ts_bgw_job_runner_prepare(BgwParams *params)
+{
+	if (ts_guc_bgw_job_runner_lifetime == 0)
+		return JOB_RUNNER_NONE;
+
+	if (pool_segment == NULL && !job_runner_pool_create())
+		return JOB_RUNNER_NONE;
+
+	for (int i = 0; i < pool->num_slots; i++)
+	{
+		JobRunnerSlot *slot = &pool->slots[i];
+
+		if (runners[i].handle != NULL || slot->state != JOB_RUNNER_FREE)
+			continue;
+
+		SpinLockAcquire(&slot->mutex);
+		slot->state = JOB_RUNNER_RUNNING;
+		slot->user_oid = params->user_oid;
+		slot->pid = 0;
+		slot->latch = NULL;
+		slot->params = *params;
+		SpinLockRelease(&slot->mutex);
+
+		params->job_runner_pool = dsm_segment_handle(pool_segment);
+		return i;
+	}
+
+	return JOB_RUNNER_NONE;
+}
+
+/*
+ * Whether the runner finished the job that it was started with or that was
+ * dispatched to it.
+ */
+bool
+ts_bgw_job_runner_is_idle(int runner)
+{
+	JobRunnerSlot *slot = &pool->slots[runner];
+	bool idle;
+
+	SpinLockAcquire(&slot->mutex);
+	idle = slot->state == JOB_RUNNER_IDLE;
+	SpinLockRelease(&slot->mutex);
+
+	return idle;
+}
+
+/*
+ * Give the runner back to the pool after the end of a job, with the handle
+ * and the reserved background worker. Returns false if the runner is not
+ * idle, e.g., because it exited, or the worker could not be started, in
+ * which case the slot is freed and the caller keeps the handle and the
+ * reserved worker.
+ */
+bool
+ts_bgw_job_runner_release(int runner, BackgroundWorkerHandle *handle, bool reserved_worker)
+{
+	JobRunnerSlot *slot = &pool->slots[runner];
+	bool keep = handle != NULL && reserved_worker && ts_guc_bgw_job_runner_lifetime > 0 &&
+				!pool->shutdown && job_runner_is_alive(handle);
+
+	Assert(runners[runner].handle == NULL);
+
+	SpinLockAcquire(&slot->mutex);
+	if (slot->state != JOB_RUNNER_IDLE)
+		keep = false;
+	if (!keep)
+		slot->state = JOB_RUNNER_FREE;
+	SpinLockRelease(&slot->mutex);
+
+	if (keep)
+	{
+		runners[runner].handle = handle;
+		runners[runner].reserved_worker = reserved_worker;
+		return true;
+	}
+
+	/* Make sure that an idle runner that we don't keep is gone */
+	if (handle != NULL && job_runner_is_alive(handle))
+	{
+		TerminateBackgroundWorker(handle);
+		WaitForBackgroundWorkerShutdown(handle);
+	}
+
+	return false;
+}
+
+/*
+ * Free the slots of the idle runners that exited.
+ */
+void
+ts_bgw_job_runner_reap(void)
+{
+	if (pool_segment == NULL)
+		return;
+
+	for (int i = 0; i < pool->num_slots; i++)
+	{
+		JobRunnerSlot *slot = &pool->slots[i];
+
+		if (runners[i].handle == NULL || job_runner_is_alive(runners[i].handle))
+			continue;
+
+		pfree(runners[i].handle);
+		runners[i].handle = NULL;
+
+		if (runners[i].reserved_worker)
+		{
+			ts_bgw_worker_release();
+			runners[i].reserved_worker = false;
+		}
+
+		SpinLockAcquire(&slot->mutex);
+		slot->state = JOB_RUNNER_FREE;
+		SpinLockRelease(&slot->mutex);
+	}
+}
+
+/*
+ * Stop the idle runners when the scheduler exits, and make the runners that
+ * still run a job exit after the job. When called from the exit callback, we
+ * don't wait for the runners to stop.
+ */
+void
+ts_bgw_job_runner_shutdown(bool wait)
+{
+	if (pool_segment == NULL)
+		return;
+
+	pool->shutdown = true;
+
+	for (int i = 0; i < pool->num_slots; i++)
+	{
+		if (runners[i].handle == NULL)
+			continue;
+
+		TerminateBackgroundWorker(runners[i].handle);
+
+		if (wait)
+			WaitForBackgroundWorkerShutdown(runners[i].handle);
+
+		if (runners[i].reserved_worker)
+		{
+			ts_bgw_worker_release();
+			runners[i].reserved_worker = false;
+		}
+
+		pfree(runners[i].handle);
+		runners[i].handle = NULL;
+	}
+}
+
+/*
+ * Attach the job runner to its slot in the pool. Returns false if the runner
+ * is not pooled, or the pool is gone, in which case the runner exits after
+ * the job of its parameters.
+ */
+bool
+ts_bgw_job_runner_attach(BgwParams *params)
+{
+	dsm_segment *segment;
+
+	if (params->job_runner_pool == DSM_HANDLE_INVALID)
+		return false;
+
+	segment = dsm_attach(params->job_runner_pool);
+
+	if (segment == NULL)
+		return false;
+
+	dsm_pin_mapping(segment);
+	pool = dsm_segment_address(segment);
+
+	/* A job runs only once at a time, so its id identifies the new runner */
+	for (int i = 0; i < pool->num_slots; i++)
+	{
+		JobRunnerSlot *slot = &pool->slots[i];
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->state == JOB_RUNNER_RUNNING && slot->pid == 0 &&
+			slot->params.job_id == params->job_id)
+		{
+			slot->pid = MyProcPid;
+			slot->latch = MyLatch;
+			my_runner = i;
+		}
+		SpinLockRelease(&slot->mutex);
+
+		if (my_runner != JOB_RUNNER_NONE)
+			break;
+	}
+
+	if (my_runner == JOB_RUNNER_NONE)
+		return false;
+
+	my_runner_start = GetCurrentTimestamp();
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+
+	return true;
+}
+
+/*
+ * Wait for the next job after finishing a job. Returns false if the runner
+ * should exit instead, e.g., when it was idle for too long or reached its
+ * lifetime.
+ */
+bool
+ts_bgw_job_runner_next_job(BgwParams *params)
+{
+	JobRunnerSlot *slot;
+	TimestampTz idle_start = GetCurrentTimestamp();
+	bool exit_runner;
+
+	if (my_runner == JOB_RUNNER_NONE)
+		return false;
+
+	slot = &pool->slots[my_runner];
+	exit_runner =
+		pool->shutdown || ts_guc_bgw_job_runner_lifetime == 0 ||
+		TimestampDifferenceExceeds(my_runner_start, idle_start, ts_guc_bgw_job_runner_lifetime);
+
+	SpinLockAcquire(&slot->mutex);
+	if (slot->state == JOB_RUNNER_RUNNING)
+		slot->state = exit_runner ? JOB_RUNNER_EXITING : JOB_RUNNER_IDLE;
+	else
+		exit_runner = true;
+	SpinLockRelease(&slot->mutex);
+
+	SetLatch(pool->scheduler_latch);
+
+	if (exit_runner)
+		return false;
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	for (;;)
+	{
+		TimestampTz now;
+		bool got_job = false;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		now = GetCurrentTimestamp();
+		exit_runner =
+			pool->shutdown || ts_guc_bgw_job_runner_lifetime == 0 ||
+			TimestampDifferenceExceeds(idle_start, now, JOB_RUNNER_IDLE_TIMEOUT_MS) ||
+			TimestampDifferenceExceeds(my_runner_start, now, ts_guc_bgw_job_runner_lifetime);
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->state == JOB_RUNNER_ASSIGNED)
+		{
+			*params = slot->params;
+			slot->state = JOB_RUNNER_RUNNING;
+			got_job = true;
+		}
+		else if (slot->state == JOB_RUNNER_IDLE && exit_runner)
+			slot->state = JOB_RUNNER_EXITING;
+		else if (slot->state != JOB_RUNNER_IDLE && slot->state != JOB_RUNNER_CLAIMED)
+			exit_runner = true; /* The scheduler gave up on the runner */
+		else
+			exit_runner = false;
+		SpinLockRelease(&slot->mutex);
+
+		if (got_job)
+			return true;
+
+		if (exit_runner)
+			return false;
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 JOB_RUNNER_POLL_MS,
+						 PG_WAIT_EXTENSION);
+		ResetLatch(MyLatch);
+	}
+}
@@ -0,0 +1,27 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <postmaster/bgworker.h>
+
+#include "worker.h"
+
+#define JOB_RUNNER_NONE (-1)
+
+/* Used by the scheduler */
+extern int ts_bgw_job_runner_claim(Oid user_oid, BackgroundWorkerHandle **handle);
+extern void ts_bgw_job_runner_dispatch(int runner, const BgwParams *params);
+extern int ts_bgw_job_runner_prepare(BgwParams *params);
+extern bool ts_bgw_job_runner_is_idle(int runner);
+extern bool ts_bgw_job_runner_release(int runner, BackgroundWorkerHandle *handle,
+									  bool reserved_worker);
+extern void ts_bgw_job_runner_reap(void);
+extern void ts_bgw_job_runner_shutdown(bool wait);
+
+/* Used by the job runners */
+extern bool ts_bgw_job_runner_attach(BgwParams *params);
+extern bool ts_bgw_job_runner_next_job(BgwParams *params);
@@ -6,6 +6,7 @@
 #include <postgres.h>
 
 #include <access/xact.h>
+#include <common/hashfn.h>
 #include <math.h>
 #include <stdlib.h>
 #include <utils/builtins.h>
@@ -275,12 +276,46 @@ ts_get_next_scheduled_execution_slot(BgwJob *job, TimestampTz finish_time)
 	return DatumGetTimestampTz(result);
 }
 
+/*
+ * Get the offset of the start of a fixed-schedule job into its scheduled
+ * slot, so that the jobs with the same schedule, e.g., created together, do
+ * not all start at the same time. The offset is derived from the job id to
+ * keep the start of a job at the same point of the slot every time.
+ */
+static int64
+job_start_spread_offset(BgwJob *job)
+{
+	const Interval *interval = &job->fd.schedule_interval;
+	int64 window = ts_guc_bgw_start_spread * INT64CONST(1000);
+	int64 interval_usecs;
+
+	if (window <= 0)
+		return 0;
+
+	/* Stay within the slot, otherwise the job would skip slots */
+	interval_usecs = interval->time + interval->day * USECS_PER_DAY +
+					 interval->month * (int64) DAYS_PER_MONTH * USECS_PER_DAY;
+	window = Min(window, interval_usecs);
+
+	if (window <= 0)
+		return 0;
+
+	return hash_uint32((uint32) job->fd.id) % window;
+}
+
+/* Get the next start of a fixed-schedule job after the finish time */
+static TimestampTz
+calculate_next_start_fixed(TimestampTz finish_time, BgwJob *job)
+{
+	return ts_get_next_scheduled_execution_slot(job, finish_time) + job_start_spread_offset(job);
+}
+
 static TimestampTz
 calculate_next_start_on_success_fixed(TimestampTz finish_time, BgwJob *job)
 {
 	TimestampTz next_slot;
 
-	next_slot = ts_get_next_scheduled_execution_slot(job, finish_time);
+	next_slot = calculate_next_start_fixed(finish_time, job);
 
 	return next_slot;
 }
@@ -434,7 +469,7 @@ calculate_next_start_on_failure(TimestampTz finish_time, int consecutive_failure
 	 * of the next scheduled slot, so we don't get off track */
 	if (job->fd.fixed_schedule)
 	{
-		TimestampTz next_slot = ts_get_next_scheduled_execution_slot(job, finish_time);
+		TimestampTz next_slot = calculate_next_start_fixed(finish_time, job);
 		if (res > next_slot)
 			res = next_slot;
 	}
@@ -629,23 +664,36 @@ bgw_job_stat_insert_relation(Relation rel, int32 bgw_job_id, bool mark_start,
 	return true;
 }
 
+/*
+ * Update the job stats with the tuple_found function, or insert them if the
+ * job has no stats yet.
+ *
+ * The updates only take a RowExclusiveLock, so that the job stats of
+ * different jobs are updated concurrently by the scheduler and the jobs. We
+ * grab a ShareRowExclusiveLock only when we have to insert the job stats,
+ * because we need to ensure that no job races and adds a job when we insert
+ * the relation as well since that can trigger a failure when inserting a row
+ * for the job.
+ */
+static void
+bgw_job_stat_upsert(int32 bgw_job_id, tuple_found_func tuple_found, void *data, bool mark_start,
+					TimestampTz next_start)
+{
+	Relation rel;
+
+	if (bgw_job_stat_scan_job_id(bgw_job_id, tuple_found, NULL, data, RowExclusiveLock))
+		return;
+
+	rel = table_open(catalog_get_table_id(ts_catalog_get(), BGW_JOB_STAT), ShareRowExclusiveLock);
+	if (!bgw_job_stat_scan_job_id(bgw_job_id, tuple_found, NULL, data, RowExclusiveLock))
+		bgw_job_stat_insert_relation(rel, bgw_job_id, mark_start, next_start);
+	table_close(rel, NoLock);
+}
+
 void
 ts_bgw_job_stat_mark_start(BgwJob *job)
 {
-	/* We grab a ShareRowExclusiveLock here because we need to ensure that no
-	 * job races and adds a job when we insert the relation as well since that
-	 * can trigger a failure when inserting a row for the job. We use the
-	 * RowExclusiveLock in the scan since we cannot use NoLock (relation_open
-	 * requires a lock that it not NoLock). */
-	Relation rel =
-		table_open(catalog_get_table_id(ts_catalog_get(), BGW_JOB_STAT), ShareRowExclusiveLock);
-	if (!bgw_job_stat_scan_job_id(job->fd.id,
-								  bgw_job_stat_tuple_mark_start,
-								  NULL,
-								  NULL,
-								  RowExclusiveLock))
-		bgw_job_stat_insert_relation(rel, job->fd.id, true, DT_NOBEGIN);
-	table_close(rel, NoLock);
+	bgw_job_stat_upsert(job->fd.id, bgw_job_stat_tuple_mark_start, NULL, true, DT_NOBEGIN);
 
 	/* We need to capture the execution start because failures are always logged */
 	job->job_history.execution_start = ts_timer_get_current_timestamp();
@@ -668,7 +716,7 @@ ts_bgw_job_stat_mark_end(BgwJob *job, JobResult result, Jsonb *edata)
 								  bgw_job_stat_tuple_mark_end,
 								  NULL,
 								  &res,
-								  ShareRowExclusiveLock))
+								  RowExclusiveLock))
 	{
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -720,7 +768,7 @@ ts_bgw_job_stat_set_next_start(int32 job_id, TimestampTz next_start)
 								  bgw_job_stat_tuple_set_next_start,
 								  NULL,
 								  &next_start,
-								  ShareRowExclusiveLock))
+								  RowExclusiveLock))
 	{
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -745,7 +793,7 @@ ts_bgw_job_stat_update_next_start(int32 job_id, TimestampTz next_start, bool all
 									 bgw_job_stat_tuple_set_next_start,
 									 NULL,
 									 &next_start,
-									 ShareRowExclusiveLock);
+									 RowExclusiveLock);
 	return found;
 }
 
@@ -760,20 +808,11 @@ ts_bgw_job_stat_upsert_next_start(int32 bgw_job_id, TimestampTz next_start)
 				 errmsg("cannot set next start to -infinity")));
 	}
 
-	/* We grab a ShareRowExclusiveLock here because we need to ensure that no
-	 * job races and adds a job when we insert the relation as well since that
-	 * can trigger a failure when inserting a row for the job. We use the
-	 * RowExclusiveLock in the scan since we cannot use NoLock (relation_open
-	 * requires a lock that it not NoLock). */
-	Relation rel =
-		table_open(catalog_get_table_id(ts_catalog_get(), BGW_JOB_STAT), ShareRowExclusiveLock);
-	if (!bgw_job_stat_scan_job_id(bgw_job_id,
-								  bgw_job_stat_tuple_set_next_start,
-								  NULL,
-								  &next_start,
-								  RowExclusiveLock))
-		bgw_job_stat_insert_relation(rel, bgw_job_id, false, next_start);
-	table_close(rel, NoLock);
+	bgw_job_stat_upsert(bgw_job_id,
+						bgw_job_stat_tuple_set_next_start,
+						&next_start,
+						false,
+						next_start);
 }
 
 bool
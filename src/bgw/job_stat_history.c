@@ -11,6 +11,7 @@
 #include "compat/compat.h"
 #include "guc.h"
 #include "hypertable.h"
+#include "job_profile.h"
 #include "job_stat_history.h"
 #include "jsonb_utils.h"
 #include "timer.h"
@@ -87,16 +88,28 @@ ts_bgw_job_stat_history_build_data_info(BgwJobStatHistoryContext *context)
 		ts_jsonb_add_value(parse_state, "error_data", &value);
 	}
 
+	/* timings of the phases of the execution, if any were recorded */
+	ts_job_profile_add_jsonb(parse_state, "phases");
+
 	return JsonbValueToJsonb(pushJsonbValue(&parse_state, WJB_END_OBJECT, NULL));
 }
 
+/*
+ * Insert the history of a finished execution.
+ *
+ * The history of an execution is written once, when it finishes, instead of
+ * inserting it at the start and updating it at the end, which leaves two
+ * dead tuples per execution in the catalog table. Executions that are still
+ * running are not in the history table, the job stats show them.
+ */
 static void
-bgw_job_stat_history_insert(BgwJobStatHistoryContext *context, bool track_only_errors)
+bgw_job_stat_history_insert(BgwJobStatHistoryContext *context)
 {
 	Assert(context != NULL);
 
+	/* The id comes from a sequence, so concurrent inserts don't conflict */
 	Relation rel = table_open(catalog_get_table_id(ts_catalog_get(), BGW_JOB_STAT_HISTORY),
-							  ShareRowExclusiveLock);
+							  RowExclusiveLock);
 	TupleDesc desc = RelationGetDescr(rel);
 	NullableDatum values[Natts_bgw_job_stat_history] = { { 0 } };
 	CatalogSecurityContext sec_ctx;
@@ -106,24 +119,15 @@ bgw_job_stat_history_insert(BgwJobStatHistoryContext *context, bool track_only_e
 							 values,
 							 context->job->job_history.execution_start,
 							 false);
-	if (track_only_errors)
-	{
-		/* In case of logging only ERRORs */
-		ts_datum_set_int32(Anum_bgw_job_stat_history_pid, values, MyProcPid, false);
-		ts_datum_set_timestamptz(Anum_bgw_job_stat_history_execution_finish,
-								 values,
-								 ts_timer_get_current_timestamp(),
-								 false);
-		ts_datum_set_bool(Anum_bgw_job_stat_history_succeeded, values, false, false);
-	}
-	else
-	{
-		/* When tracking history first we INSERT the job without the FINISH execution timestamp,
-		 * PID and SUCCEED flag because it will be marked once the job finishes */
-		ts_datum_set_int32(Anum_bgw_job_stat_history_pid, values, 0, true);
-		ts_datum_set_timestamptz(Anum_bgw_job_stat_history_execution_finish, values, 0, true);
-		ts_datum_set_bool(Anum_bgw_job_stat_history_succeeded, values, false, true);
-	}
+	ts_datum_set_int32(Anum_bgw_job_stat_history_pid, values, MyProcPid, false);
+	ts_datum_set_timestamptz(Anum_bgw_job_stat_history_execution_finish,
+							 values,
+							 ts_timer_get_current_timestamp(),
+							 false);
+	ts_datum_set_bool(Anum_bgw_job_stat_history_succeeded,
+					  values,
+					  context->result == JOB_SUCCESS,
+					  false);
 
 	ts_datum_set_jsonb(Anum_bgw_job_stat_history_data,
 					   values,
@@ -133,7 +137,7 @@ bgw_job_stat_history_insert(BgwJobStatHistoryContext *context, bool track_only_e
 
 	if (context->job->job_history.id == INVALID_BGW_JOB_STAT_HISTORY_ID)
 	{
-		/* We need to get a new job id to mark the end later */
+		/* Only the executions that are logged get an id at the start */
 		context->job->job_history.id =
 			ts_catalog_table_next_seq_id(ts_catalog_get(), BGW_JOB_STAT_HISTORY);
 	}
@@ -148,11 +152,21 @@ bgw_job_stat_history_insert(BgwJobStatHistoryContext *context, bool track_only_e
 static void
 bgw_job_stat_history_mark_start(BgwJobStatHistoryContext *context)
 {
+	CatalogSecurityContext sec_ctx;
+
 	/* Don't mark the start in case of the GUC be disabled */
 	if (!ts_guc_enable_job_execution_logging)
 		return;
 
-	bgw_job_stat_history_insert(context, false);
+	/*
+	 * Take the id of the execution at the start, so that the history is in
+	 * the order of the starts of the executions. The history itself is
+	 * inserted at the end.
+	 */
+	ts_catalog_database_info_become_owner(ts_catalog_database_info_get(), &sec_ctx);
+	context->job->job_history.id =
+		ts_catalog_table_next_seq_id(ts_catalog_get(), BGW_JOB_STAT_HISTORY);
+	ts_catalog_restore_user(&sec_ctx);
 }
 
 static bool
@@ -213,40 +227,23 @@ bgw_job_stat_history_tuple_update(TupleInfo *ti, void *const data)
 	bool nulls[Natts_bgw_job_stat_history] = { 0 };
 	bool doReplace[Natts_bgw_job_stat_history] = { 0 };
 
-	switch (context->update_type)
-	{
-		case JOB_STAT_HISTORY_UPDATE_PID:
-		{
-			values[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_pid)] =
-				Int32GetDatum(MyProcPid);
-			doReplace[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_pid)] = true;
-			break;
-		}
+	Assert(context->update_type == JOB_STAT_HISTORY_UPDATE_END);
 
-		case JOB_STAT_HISTORY_UPDATE_END:
-		{
-			values[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_execution_finish)] =
-				TimestampTzGetDatum(ts_timer_get_current_timestamp());
-			doReplace[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_execution_finish)] = true;
-
-			values[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_succeeded)] =
-				BoolGetDatum((context->result == JOB_SUCCESS));
-			doReplace[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_succeeded)] = true;
-
-			job_history_data = ts_bgw_job_stat_history_build_data_info(context);
-
-			if (job_history_data != NULL)
-			{
-				values[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_data)] =
-					JsonbPGetDatum(job_history_data);
-				doReplace[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_data)] = true;
-			}
-			break;
-		}
+	values[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_execution_finish)] =
+		TimestampTzGetDatum(ts_timer_get_current_timestamp());
+	doReplace[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_execution_finish)] = true;
 
-		case JOB_STAT_HISTORY_UPDATE_START:
-			pg_unreachable();
-			break;
+	values[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_succeeded)] =
+		BoolGetDatum((context->result == JOB_SUCCESS));
+	doReplace[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_succeeded)] = true;
+
+	job_history_data = ts_bgw_job_stat_history_build_data_info(context);
+
+	if (job_history_data != NULL)
+	{
+		values[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_data)] =
+			JsonbPGetDatum(job_history_data);
+		doReplace[AttrNumberGetAttrOffset(Anum_bgw_job_stat_history_data)] = true;
 	}
 
 	HeapTuple new_tuple =
@@ -282,24 +279,18 @@ bgw_job_stat_history_update(BgwJobStatHistoryContext *context)
 	 * execution history */
 	context->job = new_job;
 
-	/* Failures are always logged so in case of the GUC is false and a failure happens then we need
-	 * to insert all the information in the job error history table */
-	if (!ts_guc_enable_job_execution_logging && context->result != JOB_SUCCESS)
-	{
-		bgw_job_stat_history_insert(context, true);
-	}
-	else
-	{
-		/* Mark the end of the previous inserted start execution */
-		if (!bgw_job_stat_history_scan_id(new_job->job_history.id,
-										  bgw_job_stat_history_tuple_update,
-										  NULL,
-										  context,
-										  RowExclusiveLock))
-			ereport(ERROR,
-					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-					 errmsg("unable to find job history " INT64_FORMAT, new_job->job_history.id)));
-	}
+	/*
+	 * Insert the history of the execution. An execution that was started by
+	 * an earlier version has its start inserted already, so mark the end of
+	 * it in that case.
+	 */
+	if (new_job->job_history.id == INVALID_BGW_JOB_STAT_HISTORY_ID ||
+		!bgw_job_stat_history_scan_id(new_job->job_history.id,
+									  bgw_job_stat_history_tuple_update,
+									  NULL,
+									  context,
+									  RowExclusiveLock))
+		bgw_job_stat_history_insert(context);
 }
 
 void
@@ -319,7 +310,6 @@ ts_bgw_job_stat_history_update(BgwJobStatHistoryUpdateType update_type, BgwJob *
 			bgw_job_stat_history_mark_start(&context);
 			break;
 		case JOB_STAT_HISTORY_UPDATE_END:
-		case JOB_STAT_HISTORY_UPDATE_PID:
 			bgw_job_stat_history_update(&context);
 			break;
 	}
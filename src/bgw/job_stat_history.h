@@ -15,7 +15,6 @@ typedef enum BgwJobStatHistoryUpdateType
 {
 	JOB_STAT_HISTORY_UPDATE_START,
 	JOB_STAT_HISTORY_UPDATE_END,
-	JOB_STAT_HISTORY_UPDATE_PID,
 } BgwJobStatHistoryUpdateType;
 
 extern void ts_bgw_job_stat_history_update(BgwJobStatHistoryUpdateType update_type, BgwJob *job,
@@ -13,6 +13,7 @@
 #include <postgres.h>
 
 #include <access/xact.h>
+#include <lib/pairingheap.h>
 #include <miscadmin.h>
 #include <nodes/pg_list.h>
 #include <pgstat.h>
@@ -33,7 +34,9 @@
 #include "compat/compat.h"
 #include "extension.h"
 #include "guc.h"
+#include "invalidation_wakeup.h"
 #include "job.h"
+#include "job_runner.h"
 #include "job_stat.h"
 #include "launcher_interface.h"
 #include "scheduler.h"
@@ -107,8 +110,127 @@ typedef struct ScheduledBgwJob
 	 */
 	bool may_need_mark_end;
 	int32 consecutive_failed_launches;
+
+	/* The pooled job runner that runs the job, see job_runner.c */
+	bool has_runner;
+	int runner;
+
+	/* Nodes in the start and timeout heaps, see scheduled_job_update_heaps() */
+	pairingheap_node start_node;
+	pairingheap_node timeout_node;
+	bool in_start_heap;
+	bool in_timeout_heap;
+
+	/*
+	 * The count of modified rows of the raw hypertable at the last start of
+	 * an event-driven refresh policy, see start_invalidated_jobs().
+	 */
+	bool invalidation_wakeup;
+	uint64 invalidated_rows_base;
 } ScheduledBgwJob;
 
+/*
+ * The pairing heaps are max-heaps, so the job with the earliest time compares
+ * as the greatest.
+ */
+static int
+cmp_next_start(const pairingheap_node *a, const pairingheap_node *b, void *arg)
+{
+	const ScheduledBgwJob *left_sjob = pairingheap_const_container(ScheduledBgwJob, start_node, a);
+	const ScheduledBgwJob *right_sjob =
+		pairingheap_const_container(ScheduledBgwJob, start_node, b);
+
+	if (left_sjob->next_start < right_sjob->next_start)
+		return 1;
+
+	if (left_sjob->next_start > right_sjob->next_start)
+		return -1;
+
+	return 0;
+}
+
+static int
+cmp_timeout_at(const pairingheap_node *a, const pairingheap_node *b, void *arg)
+{
+	const ScheduledBgwJob *left_sjob =
+		pairingheap_const_container(ScheduledBgwJob, timeout_node, a);
+	const ScheduledBgwJob *right_sjob =
+		pairingheap_const_container(ScheduledBgwJob, timeout_node, b);
+
+	if (left_sjob->timeout_at < right_sjob->timeout_at)
+		return 1;
+
+	if (left_sjob->timeout_at > right_sjob->timeout_at)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * The scheduled jobs ordered by next_start, and the started jobs that have a
+ * timeout ordered by timeout_at, so that the scheduler doesn't have to walk
+ * all jobs to find the jobs to start and the next wakeup time. The heaps
+ * reference the jobs of scheduled_jobs and are rebuilt when the list is
+ * updated.
+ */
+static pairingheap start_heap = { .ph_compare = cmp_next_start };
+
+/* The jobs started in the current second, see ts_guc_bgw_max_launches_per_second */
+static TimestampTz launch_window_start = DT_NOBEGIN;
+static int launches_in_window = 0;
+static pairingheap timeout_heap = { .ph_compare = cmp_timeout_at };
+
+/*
+ * Move the job to the heap that matches its state. Has to be called after
+ * changing the state, next_start or timeout_at of the job.
+ */
+static void
+scheduled_job_update_heaps(ScheduledBgwJob *sjob)
+{
+	if (sjob->in_start_heap)
+	{
+		pairingheap_remove(&start_heap, &sjob->start_node);
+		sjob->in_start_heap = false;
+	}
+
+	if (sjob->in_timeout_heap)
+	{
+		pairingheap_remove(&timeout_heap, &sjob->timeout_node);
+		sjob->in_timeout_heap = false;
+	}
+
+	if (sjob->state == JOB_STATE_SCHEDULED)
+	{
+		pairingheap_add(&start_heap, &sjob->start_node);
+		sjob->in_start_heap = true;
+	}
+	else if (sjob->state == JOB_STATE_STARTED && sjob->timeout_at != DT_NOEND)
+	{
+		pairingheap_add(&timeout_heap, &sjob->timeout_node);
+		sjob->in_timeout_heap = true;
+	}
+}
+
+/*
+ * Empty the heaps, e.g., before the jobs they reference are freed.
+ */
+static void
+scheduled_jobs_reset_heaps(List *jobs)
+{
+	ListCell *lc;
+
+	pairingheap_reset(&start_heap);
+	pairingheap_reset(&timeout_heap);
+
+	foreach (lc, jobs)
+	{
+		ScheduledBgwJob *sjob = lfirst(lc);
+
+		sjob->in_start_heap = false;
+		sjob->in_timeout_heap = false;
+	}
+}
+
 static void on_failure_to_start_job(ScheduledBgwJob *sjob);
 
 static volatile sig_atomic_t got_SIGHUP = false;
@@ -212,6 +334,20 @@ worker_state_cleanup(ScheduledBgwJob *sjob)
 	 * This function needs to be safe wrt failures occurring at any point in
 	 * the job starting process.
 	 */
+	/*
+	 * A pooled job runner that finished the job goes back to the pool with
+	 * the reserved worker, instead of exiting.
+	 */
+	if (sjob->has_runner)
+	{
+		if (ts_bgw_job_runner_release(sjob->runner, sjob->handle, sjob->reserved_worker))
+		{
+			sjob->handle = NULL;
+			sjob->reserved_worker = false;
+		}
+		sjob->has_runner = false;
+	}
+
 	if (sjob->handle != NULL)
 	{
 #ifdef USE_ASSERT_CHECKING
@@ -284,6 +420,7 @@ scheduled_bgw_job_transition_state_to(ScheduledBgwJob *sjob, JobState new_state)
 #endif
 
 	BgwJobStat *job_stat;
+	BgwParams bgw_params;
 
 	switch (new_state)
 	{
@@ -306,6 +443,7 @@ scheduled_bgw_job_transition_state_to(ScheduledBgwJob *sjob, JobState new_state)
 			Assert(prev_state == JOB_STATE_SCHEDULED);
 			Assert(sjob->handle == NULL);
 			Assert(!sjob->reserved_worker);
+			Assert(!sjob->has_runner);
 
 			StartTransactionCommand();
 
@@ -320,8 +458,14 @@ scheduled_bgw_job_transition_state_to(ScheduledBgwJob *sjob, JobState new_state)
 				return;
 			}
 
-			/* If we are unable to reserve a worker go back to the scheduled state */
-			sjob->reserved_worker = ts_bgw_worker_reserve();
+			/*
+			 * Take an idle job runner of the owner if there is one, it has
+			 * a reserved worker already. If we are unable to reserve a
+			 * worker go back to the scheduled state.
+			 */
+			sjob->runner = ts_bgw_job_runner_claim(sjob->job.fd.owner, &sjob->handle);
+			sjob->has_runner = sjob->runner != JOB_RUNNER_NONE;
+			sjob->reserved_worker = sjob->has_runner || ts_bgw_worker_reserve();
 			if (!sjob->reserved_worker)
 			{
 				elog(WARNING,
@@ -354,7 +498,20 @@ scheduled_bgw_job_transition_state_to(ScheduledBgwJob *sjob, JobState new_state)
 				 sjob->job.fd.id,
 				 NameStr(sjob->job.fd.application_name));
 
-			sjob->handle = ts_bgw_job_start(&sjob->job, sjob->job.fd.owner);
+			ts_bgw_job_init_params(&sjob->job, sjob->job.fd.owner, &bgw_params);
+
+			if (sjob->has_runner)
+			{
+				ts_bgw_job_runner_dispatch(sjob->runner, &bgw_params);
+			}
+			else
+			{
+				sjob->runner = ts_bgw_job_runner_prepare(&bgw_params);
+				sjob->has_runner = sjob->runner != JOB_RUNNER_NONE;
+				sjob->handle =
+					ts_bgw_start_worker(NameStr(sjob->job.fd.application_name), &bgw_params);
+			}
+
 			if (sjob->handle == NULL)
 			{
 				elog(WARNING,
@@ -374,6 +531,7 @@ scheduled_bgw_job_transition_state_to(ScheduledBgwJob *sjob, JobState new_state)
 			break;
 	}
 	sjob->state = new_state;
+	scheduled_job_update_heaps(sjob);
 }
 
 static void
@@ -480,15 +638,87 @@ terminate_and_cleanup_job(ScheduledBgwJob *sjob)
  *  Assume that both lists are ordered by job ID.
  *  Note that this function call will destroy cur_jobs_list and return a new list.
  */
+/*
+ * Set the count of modified rows of a hypertable at which the scheduler is
+ * woken up, which is the earliest count at which one of the event-driven
+ * refresh policies on the hypertable is due.
+ */
+static void
+update_invalidation_wakeup_rows(List *jobs, int32 hypertable_id)
+{
+	uint64 wakeup_rows = PG_UINT64_MAX;
+	ListCell *lc;
+
+	foreach (lc, jobs)
+	{
+		ScheduledBgwJob *sjob = lfirst(lc);
+
+		if (sjob->invalidation_wakeup && sjob->job.raw_hypertable_id == hypertable_id)
+			wakeup_rows = Min(wakeup_rows,
+							  sjob->invalidated_rows_base +
+								  (uint64) sjob->job.refresh_invalidated_rows);
+	}
+
+	ts_invalidation_wakeup_set_wakeup_rows(hypertable_id, wakeup_rows);
+}
+
+/*
+ * Register the raw hypertables of the event-driven refresh policies, so that
+ * the backends that modify them wake up the scheduler, and remove the ones
+ * that no longer have such policies.
+ */
+static void
+register_invalidation_wakeups(List *jobs)
+{
+	List *hypertable_ids = NIL;
+	ListCell *lc;
+
+	foreach (lc, jobs)
+	{
+		ScheduledBgwJob *sjob = lfirst(lc);
+		uint64 rows;
+
+		if (sjob->job.refresh_invalidated_rows <= 0 ||
+			!ts_invalidation_wakeup_register(sjob->job.raw_hypertable_id, &rows))
+		{
+			sjob->invalidation_wakeup = false;
+			continue;
+		}
+
+		/* The rows modified before the job was known are not counted */
+		if (!sjob->invalidation_wakeup)
+		{
+			sjob->invalidation_wakeup = true;
+			sjob->invalidated_rows_base = rows;
+		}
+
+		hypertable_ids = list_append_unique_int(hypertable_ids, sjob->job.raw_hypertable_id);
+	}
+
+	ts_invalidation_wakeup_unregister_others(hypertable_ids);
+
+	foreach (lc, hypertable_ids)
+		update_invalidation_wakeup_rows(jobs, lfirst_int(lc));
+
+	list_free(hypertable_ids);
+}
+
 List *
 ts_update_scheduled_jobs_list(List *cur_jobs_list, MemoryContext mctx)
 {
 	List *new_jobs = ts_bgw_job_get_scheduled(sizeof(ScheduledBgwJob), mctx);
 	ListCell *new_ptr = list_head(new_jobs);
 	ListCell *cur_ptr = list_head(cur_jobs_list);
+	ListCell *lc;
 
 	elog(DEBUG2, "updating scheduled jobs list");
 
+	/*
+	 * The state of the existing jobs is copied to the new jobs, including the
+	 * heap membership, so empty the heaps first and add the new jobs below.
+	 */
+	scheduled_jobs_reset_heaps(cur_jobs_list);
+
 	while (cur_ptr != NULL && new_ptr != NULL)
 	{
 		ScheduledBgwJob *new_sjob = lfirst(new_ptr);
@@ -552,6 +782,16 @@ ts_update_scheduled_jobs_list(List *cur_jobs_list, MemoryContext mctx)
 			scheduled_bgw_job_transition_state_to(lfirst(ptr), JOB_STATE_SCHEDULED);
 	}
 
+	/*
+	 * Add the jobs that kept their state, e.g., the running jobs, to the
+	 * heaps. This also moves the jobs that were transitioned above, which
+	 * is harmless.
+	 */
+	foreach (lc, new_jobs)
+		scheduled_job_update_heaps(lfirst(lc));
+
+	register_invalidation_wakeups(new_jobs);
+
 	/* Free the old list */
 	list_free_deep(cur_jobs_list);
 	return new_jobs;
@@ -579,79 +819,242 @@ ts_populate_scheduled_job_tuple(ScheduledBgwJob *sjob, Datum *values)
 }
 #endif
 
+/* Get the max number of running jobs of the class, or -1 for no limit */
 static int
-cmp_next_start(const ListCell *left_cell, const ListCell *right_cell)
+job_class_max_jobs(BgwJobClass job_class)
 {
-	ScheduledBgwJob *left_sjob = lfirst(left_cell);
-	ScheduledBgwJob *right_sjob = lfirst(right_cell);
+	switch (job_class)
+	{
+		case JOB_CLASS_REFRESH:
+			return ts_guc_bgw_max_refresh_jobs;
+		case JOB_CLASS_CUSTOM:
+			return ts_guc_bgw_max_custom_jobs;
+		case JOB_CLASS_MAINTENANCE:
+			return ts_guc_bgw_max_maintenance_jobs;
+		case _JOB_CLASS_MAX:
+			break;
+	}
+	pg_unreachable();
+	return -1;
+}
 
-	if (left_sjob->next_start < right_sjob->next_start)
-		return -1;
+/* Order the due jobs by the priority of their class, then by next_start */
+static int
+cmp_job_class_and_next_start(const ListCell *a, const ListCell *b)
+{
+	const ScheduledBgwJob *left_sjob = lfirst(a);
+	const ScheduledBgwJob *right_sjob = lfirst(b);
 
-	if (left_sjob->next_start > right_sjob->next_start)
-		return 1;
+	if (left_sjob->job.job_class != right_sjob->job.job_class)
+		return left_sjob->job.job_class < right_sjob->job.job_class ? -1 : 1;
+
+	if (left_sjob->next_start != right_sjob->next_start)
+		return left_sjob->next_start < right_sjob->next_start ? -1 : 1;
 
 	return 0;
 }
 
+/*
+ * Make the event-driven refresh policies due when enough rows of their raw
+ * hypertable were modified since their last start. Otherwise they start on
+ * their schedule, which bounds the staleness of the continuous aggregates.
+ */
+static void
+start_invalidated_jobs(void)
+{
+	ListCell *lc;
+	TimestampTz now = ts_timer_get_current_timestamp();
+
+	foreach (lc, scheduled_jobs)
+	{
+		ScheduledBgwJob *sjob = lfirst(lc);
+		uint64 rows;
+
+		if (!sjob->invalidation_wakeup || sjob->state != JOB_STATE_SCHEDULED ||
+			sjob->next_start <= now)
+			continue;
+
+		if (!ts_invalidation_wakeup_get_rows(sjob->job.raw_hypertable_id, &rows) ||
+			rows - sjob->invalidated_rows_base < (uint64) sjob->job.refresh_invalidated_rows)
+			continue;
+
+		elog(DEBUG1,
+			 "starting job %d before its schedule, " UINT64_FORMAT " rows were modified",
+			 sjob->job.fd.id,
+			 rows - sjob->invalidated_rows_base);
+		sjob->next_start = now;
+		scheduled_job_update_heaps(sjob);
+	}
+}
+
+/* Count the rows modified after the start of an event-driven refresh policy */
+static void
+reset_invalidation_wakeup(ScheduledBgwJob *sjob)
+{
+	uint64 rows;
+
+	if (!sjob->invalidation_wakeup ||
+		!ts_invalidation_wakeup_get_rows(sjob->job.raw_hypertable_id, &rows))
+		return;
+
+	sjob->invalidated_rows_base = rows;
+	update_invalidation_wakeup_rows(scheduled_jobs, sjob->job.raw_hypertable_id);
+}
+
 static void
 start_scheduled_jobs(register_background_worker_callback_type bgw_register)
 {
-	List *ordered_scheduled_jobs;
+	List *jobs_to_start = NIL;
 	ListCell *lc;
+	TimestampTz now = ts_timer_get_current_timestamp();
+	int running_jobs[_JOB_CLASS_MAX] = { 0 };
 	Assert(CurrentMemoryContext == scratch_mctx);
 
-	/* Order jobs by increasing next_start */
-	/* list_sort does in-place sort - so make a copy and sort that */
-	ordered_scheduled_jobs = list_copy(scheduled_jobs);
-	list_sort(ordered_scheduled_jobs, cmp_next_start);
-
-	foreach (lc, ordered_scheduled_jobs)
+	foreach (lc, scheduled_jobs)
 	{
 		ScheduledBgwJob *sjob = lfirst(lc);
 
-		int64 job_start_diff = sjob->next_start - ts_timer_get_current_timestamp();
+		if (sjob->state == JOB_STATE_STARTED || sjob->state == JOB_STATE_TERMINATING)
+			running_jobs[sjob->job.job_class]++;
+	}
+
+	/*
+	 * Take the jobs that are due from the heap in the order of increasing
+	 * next_start first, since starting a job can put it back with a
+	 * next_start that is due again, and every job should be started at most
+	 * once per iteration.
+	 */
+	while (!pairingheap_is_empty(&start_heap))
+	{
+		ScheduledBgwJob *sjob =
+			pairingheap_container(ScheduledBgwJob, start_node, pairingheap_first(&start_heap));
 
-		if (sjob->state == JOB_STATE_SCHEDULED &&
-			(job_start_diff <= 0 || sjob->next_start == DT_NOBEGIN))
-		{
-			elog(DEBUG2, "starting scheduled job %d", sjob->job.fd.id);
-			scheduled_ts_bgw_job_start(sjob, bgw_register);
-		}
-		else
+		Assert(sjob->state == JOB_STATE_SCHEDULED);
+
+		if (sjob->next_start != DT_NOBEGIN && sjob->next_start > now)
 		{
 			elog(DEBUG5,
 				 "starting scheduled job %d in " INT64_FORMAT " seconds",
 				 sjob->job.fd.id,
-				 job_start_diff / ONE_SECOND_IN_MICROSECONDS);
+				 (sjob->next_start - now) / ONE_SECOND_IN_MICROSECONDS);
+			break;
 		}
+
+		pairingheap_remove_first(&start_heap);
+		sjob->in_start_heap = false;
+		jobs_to_start = lappend(jobs_to_start, sjob);
 	}
 
-	list_free(ordered_scheduled_jobs);
+	/*
+	 * Start the jobs of the higher priority classes first, so that they get
+	 * the background workers when there are not enough for all due jobs.
+	 */
+	list_sort(jobs_to_start, cmp_job_class_and_next_start);
+
+	foreach (lc, jobs_to_start)
+	{
+		ScheduledBgwJob *sjob = lfirst(lc);
+		BgwJobClass job_class = sjob->job.job_class;
+		int max_jobs = job_class_max_jobs(job_class);
+
+		/*
+		 * Leave the job in the start heap if its class has the max number of
+		 * running jobs. It is retried when a job exits or after the retry
+		 * period, see earliest_wakeup_to_start_next_job().
+		 */
+		if (max_jobs >= 0 && running_jobs[job_class] >= max_jobs)
+		{
+			elog(DEBUG2,
+				 "not starting scheduled job %d, %d %s jobs are running",
+				 sjob->job.fd.id,
+				 running_jobs[job_class],
+				 ts_bgw_job_class_name(job_class));
+			scheduled_job_update_heaps(sjob);
+			continue;
+		}
+
+		/*
+		 * Likewise if the max number of jobs were started in the current
+		 * second. The retry period is a second, so the job is retried in the
+		 * next window.
+		 */
+		if (ts_guc_bgw_max_launches_per_second > 0)
+		{
+			if (launch_window_start == DT_NOBEGIN ||
+				now >= launch_window_start + ONE_SECOND_IN_MICROSECONDS)
+			{
+				launch_window_start = now;
+				launches_in_window = 0;
+			}
+
+			if (launches_in_window >= ts_guc_bgw_max_launches_per_second)
+			{
+				elog(DEBUG2,
+					 "not starting scheduled job %d, %d jobs were started in the last second",
+					 sjob->job.fd.id,
+					 launches_in_window);
+				scheduled_job_update_heaps(sjob);
+				continue;
+			}
+		}
+
+		elog(DEBUG2, "starting scheduled job %d", sjob->job.fd.id);
+		scheduled_ts_bgw_job_start(sjob, bgw_register);
+
+		if (sjob->state == JOB_STATE_STARTED)
+		{
+			running_jobs[job_class]++;
+			launches_in_window++;
+			reset_invalidation_wakeup(sjob);
+		}
+
+		/* The job stays scheduled if it was deleted while starting it */
+		scheduled_job_update_heaps(sjob);
+	}
+
+	list_free(jobs_to_start);
 }
 
 /* Returns the earliest time the scheduler should start a job that is waiting to be started */
 static TimestampTz
 earliest_wakeup_to_start_next_job()
 {
+	List *past_jobs = NIL;
 	ListCell *lc;
 	TimestampTz earliest = DT_NOEND;
 	TimestampTz now = ts_timer_get_current_timestamp();
 
-	foreach (lc, scheduled_jobs)
+	/*
+	 * If the start is less than now, this means we tried and failed to start
+	 * it already, so use the retry period. Take these jobs out of the heap
+	 * to look at the next start in the future, and put them back after.
+	 */
+	while (!pairingheap_is_empty(&start_heap))
 	{
-		ScheduledBgwJob *sjob = lfirst(lc);
+		ScheduledBgwJob *sjob =
+			pairingheap_container(ScheduledBgwJob, start_node, pairingheap_first(&start_heap));
 
-		if (sjob->state == JOB_STATE_SCHEDULED)
+		if (sjob->next_start >= now)
 		{
-			TimestampTz start = sjob->next_start;
-			/* if the start is less than now, this means we tried and failed to start it already, so
-			 * use the retry period */
-			if (start < now)
-				start = TimestampTzPlusMilliseconds(now, START_RETRY_MS);
-			earliest = least_timestamp(earliest, start);
+			earliest = sjob->next_start;
+			break;
 		}
+
+		pairingheap_remove_first(&start_heap);
+		past_jobs = lappend(past_jobs, sjob);
+	}
+
+	foreach (lc, past_jobs)
+	{
+		ScheduledBgwJob *sjob = lfirst(lc);
+
+		pairingheap_add(&start_heap, &sjob->start_node);
 	}
+
+	if (past_jobs != NIL)
+		earliest = least_timestamp(earliest, TimestampTzPlusMilliseconds(now, START_RETRY_MS));
+
+	list_free(past_jobs);
 	return earliest;
 }
 
@@ -659,17 +1062,14 @@ earliest_wakeup_to_start_next_job()
 static TimestampTz
 earliest_job_timeout()
 {
-	ListCell *lc;
-	TimestampTz earliest = DT_NOEND;
+	ScheduledBgwJob *sjob;
 
-	foreach (lc, scheduled_jobs)
-	{
-		ScheduledBgwJob *sjob = lfirst(lc);
+	if (pairingheap_is_empty(&timeout_heap))
+		return DT_NOEND;
 
-		if (sjob->state == JOB_STATE_STARTED)
-			earliest = least_timestamp(earliest, sjob->timeout_at);
-	}
-	return earliest;
+	sjob = pairingheap_container(ScheduledBgwJob, timeout_node, pairingheap_first(&timeout_heap));
+	Assert(sjob->state == JOB_STATE_STARTED);
+	return sjob->timeout_at;
 }
 
 /* Special exit function only used in shmem_exit_callback.
@@ -701,6 +1101,8 @@ terminate_all_jobs_and_release_workers()
 			sjob->reserved_worker = false;
 		}
 	}
+
+	ts_bgw_job_runner_shutdown(/* wait = */ false);
 }
 
 static void
@@ -734,6 +1136,11 @@ check_for_stopped_and_timed_out_jobs()
 
 		status = GetBackgroundWorkerPid(sjob->handle, &pid);
 
+		/* A pooled job runner waits for the next job when the job ends */
+		if (status == BGWH_STARTED && sjob->state == JOB_STATE_STARTED && sjob->has_runner &&
+			ts_bgw_job_runner_is_idle(sjob->runner))
+			status = BGWH_STOPPED;
+
 		switch (status)
 		{
 			case BGWH_POSTMASTER_DIED:
@@ -830,6 +1237,7 @@ ts_bgw_scheduler_process(int32 run_for_interval_ms,
 
 		/* start jobs, and then check when to next wake up */
 		elog(DEBUG5, "scheduler wakeup in database %u", MyDatabaseId);
+		start_invalidated_jobs();
 		start_scheduled_jobs(bgw_register);
 		next_wakeup = least_timestamp(next_wakeup, earliest_wakeup_to_start_next_job());
 		next_wakeup = least_timestamp(next_wakeup, earliest_job_timeout());
@@ -864,6 +1272,7 @@ ts_bgw_scheduler_process(int32 run_for_interval_ms,
 		}
 
 		check_for_stopped_and_timed_out_jobs();
+		ts_bgw_job_runner_reap();
 
 		MemoryContextReset(scratch_mctx);
 	}
@@ -881,8 +1290,10 @@ ts_bgw_scheduler_process(int32 run_for_interval_ms,
 scheduler_exit:
 	CHECK_FOR_INTERRUPTS();
 
+	ts_bgw_job_runner_shutdown(/* wait = */ true);
 	wait_for_all_jobs_to_shutdown();
 	check_for_stopped_and_timed_out_jobs();
+	scheduled_jobs_reset_heaps(scheduled_jobs);
 	scheduled_jobs = NIL;
 	proc_exit(ts_debug_bgw_scheduler_exit_status);
 }
@@ -891,6 +1302,7 @@ static void
 bgw_scheduler_before_shmem_exit_callback(int code, Datum arg)
 {
 	terminate_all_jobs_and_release_workers();
+	ts_invalidation_wakeup_unregister_others(NIL);
 }
 
 void
@@ -8,6 +8,7 @@
 #include <postgres.h>
 
 #include <postmaster/bgworker.h>
+#include <storage/dsm.h>
 
 /**
  * Parameters to background workers.
@@ -41,6 +42,10 @@ typedef struct BgwParams
 	/** Time to live. Only used in tests. */
 	int32 ttl;
 
+	/** Shared memory of the job runner pool if the worker is a pooled job
+	 * runner, or DSM_HANDLE_INVALID. */
+	dsm_handle job_runner_pool;
+
 	/** Name of function to call when starting the background worker. */
 	char bgw_main[BGW_MAXLEN];
 } BgwParams;
@@ -4,11 +4,22 @@
  * LICENSE-APACHE for a copy of the license.
  */
 #include <postgres.h>
+#include <access/htup_details.h>
 #include <access/xact.h>
+#include <funcapi.h>
 #include <storage/ipc.h>
+#include <utils/builtins.h>
 
 #include "compat/compat.h"
 #include "cache.h"
+#include "chunk_cache.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+#include "jsonb_utils.h"
+#include "nodes/chunk_dispatch/chunk_dispatch.h"
+#include "ts_catalog/compression_settings.h"
+#include "ts_catalog/continuous_aggs_watermark.h"
+#include "utils.h"
 
 /* List of pinned caches. A cache occurs once in this list for every pin
  * taken */
@@ -344,6 +355,139 @@ cache_subxact_abort(SubXactEvent event, SubTransactionId subtxn_id, SubTransacti
 	}
 }
 
+/*
+ * Add the usage of the cache to the usage counters, which may include the
+ * counters of the previous instances of the cache.
+ */
+void
+ts_cache_get_usage(Cache *cache, CacheUsage *usage)
+{
+	usage->name = cache->name;
+	usage->entries = hash_get_num_entries(cache->htab);
+	usage->hits += cache->stats.hits;
+	usage->misses += cache->stats.misses;
+	usage->memory = MemoryContextMemAllocated(ts_cache_memory_ctx(cache), true);
+}
+
+#define NUM_CACHES 6
+
+static CacheUsage *
+cache_stats_collect(void)
+{
+	CacheUsage *usage = palloc0(sizeof(CacheUsage) * NUM_CACHES);
+
+	ts_hypertable_cache_get_usage(&usage[0]);
+	ts_chunk_cache_get_usage(&usage[1]);
+	ts_hypertable_chunk_store_get_usage(&usage[2]);
+	ts_chunk_dispatch_get_usage(&usage[3]);
+	ts_compression_settings_cache_get_usage(&usage[4]);
+	ts_cagg_watermark_cache_get_usage(&usage[5]);
+
+	return usage;
+}
+
+/*
+ * Add the usage of the metadata caches of the current backend as an object
+ * with the counters of each cache and its hit ratio.
+ */
+void
+ts_cache_stats_add_jsonb(JsonbParseState *state)
+{
+	const CacheUsage *usage = cache_stats_collect();
+
+	pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	for (int i = 0; i < NUM_CACHES; i++)
+	{
+		const CacheUsage *cu = &usage[i];
+		const uint64 lookups = cu->hits + cu->misses;
+		JsonbValue key = {
+			.type = jbvString,
+			.val.string.val = (char *) cu->name,
+			.val.string.len = strlen(cu->name),
+		};
+
+		pushJsonbValue(&state, WJB_KEY, &key);
+		pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+		if (cu->entries >= 0)
+			ts_jsonb_add_int64(state, "entries", cu->entries);
+		ts_jsonb_add_int64(state, "hits", (int64) cu->hits);
+		ts_jsonb_add_int64(state, "misses", (int64) cu->misses);
+		ts_jsonb_add_int64(state, "evictions", (int64) cu->evictions);
+		ts_jsonb_add_int64(state, "invalidations", (int64) cu->invalidations);
+		if (lookups > 0)
+			ts_jsonb_add_float8(state, "hit_ratio", (double) cu->hits / lookups);
+		if (cu->memory >= 0)
+			ts_jsonb_add_int64(state, "memory_bytes", cu->memory);
+		pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+	}
+
+	pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+}
+
+/*
+ * Return the usage of the metadata caches of the current backend, accumulated
+ * since the backend start.
+ */
+TS_FUNCTION_INFO_V1(ts_cache_stats);
+
+Datum
+ts_cache_stats(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	CacheUsage *usage;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
+
+		usage = cache_stats_collect();
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		funcctx->user_fctx = usage;
+		funcctx->max_calls = NUM_CACHES;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	usage = funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		const CacheUsage *cu = &usage[funcctx->call_cntr];
+		Datum values[7] = {
+			CStringGetTextDatum(cu->name),
+			Int64GetDatum(cu->entries),
+			Int64GetDatum((int64) cu->hits),
+			Int64GetDatum((int64) cu->misses),
+			Int64GetDatum((int64) cu->evictions),
+			Int64GetDatum((int64) cu->invalidations),
+			Int64GetDatum(cu->memory),
+		};
+		bool nulls[7] = { false };
+
+		nulls[1] = cu->entries < 0;
+		nulls[6] = cu->memory < 0;
+
+		Assert(funcctx->tuple_desc->natts == lengthof(values));
+
+		HeapTuple tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
 void
 _cache_init(void)
 {
@@ -7,6 +7,7 @@
 
 #include <postgres.h>
 #include <utils/hsearch.h>
+#include <utils/jsonb.h>
 #include <utils/memutils.h>
 
 #include "export.h"
@@ -35,6 +36,23 @@ typedef struct CacheStats
 	uint64 misses;
 } CacheStats;
 
+/*
+ * The usage of a cache in the current backend, as reported by
+ * _timescaledb_debug.cache_stats(). The entries and the memory are -1 for
+ * caches that don't track them, e.g., the caches that are created per
+ * hypertable or per statement.
+ */
+typedef struct CacheUsage
+{
+	const char *name;
+	int64 entries;
+	uint64 hits;
+	uint64 misses;
+	uint64 evictions;	  /* Entries removed to make room for new entries */
+	uint64 invalidations; /* Entries removed or marked stale by invalidations */
+	int64 memory;		  /* Bytes allocated in the memory context of the cache */
+} CacheUsage;
+
 typedef struct Cache
 {
 	HASHCTL hctl;
@@ -66,6 +84,8 @@ extern TSDLLEXPORT void *ts_cache_fetch(Cache *cache, CacheQuery *query);
 extern TSDLLEXPORT MemoryContext ts_cache_memory_ctx(Cache *cache);
 extern TSDLLEXPORT Cache *ts_cache_pin(Cache *cache);
 extern TSDLLEXPORT int ts_cache_release(Cache *cache);
+extern void ts_cache_get_usage(Cache *cache, CacheUsage *usage);
+extern void ts_cache_stats_add_jsonb(JsonbParseState *state);
 
 extern void _cache_init(void);
 extern void _cache_fini(void);
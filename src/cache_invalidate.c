@@ -14,9 +14,13 @@
 
 #include "compat/compat.h"
 #include "annotations.h"
+#include "chunk_cache.h"
+#include "dimension_slice_index.h"
 #include "extension.h"
 #include "hypertable_cache.h"
 #include "ts_catalog/catalog.h"
+#include "ts_catalog/compression_settings.h"
+#include "ts_catalog/continuous_aggs_watermark.h"
 
 #include "bgw/scheduler.h"
 #include "cache_invalidate.h"
@@ -58,6 +62,10 @@ cache_invalidate_relcache_all(void)
 {
 	ts_hypertable_cache_invalidate_callback();
 	ts_bgw_job_cache_invalidate_callback();
+	ts_chunk_cache_invalidate(InvalidOid);
+	ts_dimension_slice_index_invalidate(InvalidOid);
+	ts_compression_settings_invalidate(InvalidOid);
+	ts_cagg_watermark_cache_invalidate(InvalidOid);
 }
 
 static Oid hypertable_proxy_table_oid = InvalidOid;
@@ -94,11 +102,30 @@ cache_invalidate_relcache_callback(Datum arg, Oid relid)
 	else if (relid == hypertable_proxy_table_oid)
 	{
 		ts_hypertable_cache_invalidate_callback();
+		ts_chunk_cache_invalidate(InvalidOid);
+		ts_dimension_slice_index_invalidate(InvalidOid);
+		ts_compression_settings_invalidate(InvalidOid);
+		ts_cagg_watermark_cache_invalidate(InvalidOid);
 	}
 	else if (relid == bgw_proxy_table_oid)
 	{
 		ts_bgw_job_cache_invalidate_callback();
 	}
+	else
+	{
+		/*
+		 * The chunk relation itself might have changed, e.g., its access
+		 * method, or a chunk might have been added to the hypertable. The
+		 * catalog changes that only affect one hypertable also invalidate
+		 * the relcache of the hypertable, so we only invalidate the cached
+		 * data of the hypertable and its chunks.
+		 */
+		ts_hypertable_cache_invalidate_entry(relid);
+		ts_chunk_cache_invalidate(relid);
+		ts_dimension_slice_index_invalidate(relid);
+		ts_compression_settings_invalidate(relid);
+		ts_cagg_watermark_cache_invalidate(relid);
+	}
 }
 
 TS_FUNCTION_INFO_V1(ts_timescaledb_invalidate_cache);
@@ -36,6 +36,7 @@
 #include <utils/builtins.h>
 #include <utils/datum.h>
 #include <utils/hsearch.h>
+#include <utils/inval.h>
 #include <utils/lsyscache.h>
 #include <utils/palloc.h>
 #include <utils/syscache.h>
@@ -44,8 +45,10 @@
 #include "chunk.h"
 
 #include "compat/compat.h"
+#include "bgw/job_profile.h"
 #include "bgw_policy/chunk_stats.h"
 #include "cache.h"
+#include "chunk_cache.h"
 #include "chunk_index.h"
 #include "chunk_scan.h"
 #include "cross_module_fn.h"
@@ -53,6 +56,7 @@
 #include "debug_point.h"
 #include "dimension.h"
 #include "dimension_slice.h"
+#include "dimension_slice_index.h"
 #include "dimension_vector.h"
 #include "errors.h"
 #include "export.h"
@@ -60,6 +64,7 @@
 #include "hypercube.h"
 #include "hypertable.h"
 #include "hypertable_cache.h"
+#include "lock_wait_stats.h"
 #include "osm_callbacks.h"
 #include "partitioning.h"
 #include "process_utility.h"
@@ -252,6 +257,14 @@ ts_chunk_insert_lock(const Chunk *chunk, LOCKMODE lock)
 	rel = table_open(catalog_get_table_id(catalog, CHUNK), lock);
 	chunk_insert_relation(rel, chunk);
 	table_close(rel, lock);
+
+	/*
+	 * Inserting the chunk doesn't invalidate the hypertable cache, but the
+	 * slice index of the hypertable has to be rebuilt to include the new
+	 * chunk.
+	 */
+	if (OidIsValid(chunk->hypertable_relid))
+		CacheInvalidateRelcacheByRelid(chunk->hypertable_relid);
 }
 
 typedef struct CollisionInfo
@@ -1013,7 +1026,9 @@ ts_chunk_create_only_table(Hypertable *ht, Hypercube *cube, const char *schema_n
 	 * ShareUpdateExclusiveLock, which is the weakest lock possible that
 	 * conflicts with itself. The lock needs to be held until transaction end.
 	 */
-	LockRelationOid(ht->main_table_relid, ShareUpdateExclusiveLock);
+	ts_lock_wait_stats_lock_relation(LOCK_WAIT_STATS_CHUNK_CREATE,
+									 ht->main_table_relid,
+									 ShareUpdateExclusiveLock);
 
 	ts_hypercube_find_existing_slices(cube, &tuplock);
 
@@ -1235,7 +1250,9 @@ ts_chunk_find_or_create_without_cuts(const Hypertable *ht, Hypercube *hc, const
 	if (NULL == stub)
 	{
 		/* Serialize chunk creation around the root hypertable */
-		LockRelationOid(ht->main_table_relid, ShareUpdateExclusiveLock);
+		ts_lock_wait_stats_lock_relation(LOCK_WAIT_STATS_CHUNK_CREATE,
+										 ht->main_table_relid,
+										 ShareUpdateExclusiveLock);
 
 		/* Check again after lock */
 		stub = chunk_collides(ht, hc);
@@ -1330,7 +1347,9 @@ ts_chunk_create_for_point(const Hypertable *ht, const Point *p, bool *found, con
 	 * ShareUpdateExclusiveLock, which is the weakest lock possible that
 	 * conflicts with itself. The lock needs to be held until transaction end.
 	 */
-	LockRelationOid(ht->main_table_relid, ShareUpdateExclusiveLock);
+	ts_lock_wait_stats_lock_relation(LOCK_WAIT_STATS_CHUNK_CREATE,
+									 ht->main_table_relid,
+									 ShareUpdateExclusiveLock);
 
 	DEBUG_WAITPOINT("chunk_create_for_point");
 
@@ -1735,6 +1754,10 @@ chunk_collision_scan(ChunkScanCtx *scanctx, const Hypercube *cube)
 {
 	int i;
 
+	/* Find the colliding chunks in the slice index, if it can be used */
+	if (ts_dimension_slice_index_collision_scan(scanctx, cube))
+		return;
+
 	/* Scan all dimensions for colliding slices */
 	for (i = 0; i < scanctx->ht->space->num_dimensions; i++)
 	{
@@ -2053,7 +2076,9 @@ ts_chunk_show_chunks(PG_FUNCTION_ARGS)
 		Oid arg_type;
 		bool older_newer = false;
 		bool before_after = false;
+		instr_time start;
 
+		ts_job_phase_start(&start);
 		hcache = ts_hypertable_cache_pin();
 		ht = ts_resolve_hypertable_from_table_or_cagg(hcache, relid, true);
 		Assert(ht != NULL);
@@ -2183,6 +2208,7 @@ ts_chunk_show_chunks(PG_FUNCTION_ARGS)
 															  NULL);
 		}
 		ts_cache_release(hcache);
+		ts_job_phase_end("chunk_selection", &start);
 	}
 
 	return show_chunks_return_srf(fcinfo);
@@ -2285,6 +2311,26 @@ ts_chunk_copy(const Chunk *chunk)
 	return copy;
 }
 
+/*
+ * Get the constraints of the chunk, loading them from the catalog if the
+ * chunk was created without them. The constraints are allocated in the memory
+ * context of the chunk, so that they live as long as the chunk.
+ */
+ChunkConstraints *
+ts_chunk_get_constraints(Chunk *chunk)
+{
+	if (chunk->constraints == NULL)
+	{
+		MemoryContext mctx = GetMemoryChunkContext(chunk);
+
+		chunk->constraints = ts_chunk_constraint_scan_by_chunk_id(chunk->fd.id,
+																  chunk->cube->num_slices,
+																  mctx);
+	}
+
+	return chunk->constraints;
+}
+
 static int
 chunk_scan_internal(int indexid, ScanKeyData scankey[], int nkeys, tuple_filter_func filter,
 					tuple_found_func tuple_found, void *data, int limit, ScanDirection scandir,
@@ -2514,6 +2560,8 @@ ts_chunk_get_by_name_with_memory_context(const char *schema_name, const char *ta
 Chunk *
 ts_chunk_get_by_relid(Oid relid, bool fail_if_not_found)
 {
+	Chunk *chunk;
+	uint64 generation;
 	char *schema;
 	char *table;
 
@@ -2525,9 +2573,20 @@ ts_chunk_get_by_relid(Oid relid, bool fail_if_not_found)
 			return NULL;
 	}
 
+	chunk = ts_chunk_cache_get_by_relid(relid);
+
+	if (chunk != NULL)
+		return chunk;
+
+	generation = ts_chunk_cache_generation();
 	schema = get_namespace_name(get_rel_namespace(relid));
 	table = get_rel_name(relid);
-	return chunk_get_by_name(schema, table, fail_if_not_found);
+	chunk = chunk_get_by_name(schema, table, fail_if_not_found);
+
+	if (chunk != NULL)
+		ts_chunk_cache_add(chunk, generation);
+
+	return chunk;
 }
 
 void
@@ -2564,17 +2623,29 @@ ts_chunk_get_by_id(int32 id, bool fail_if_not_found)
 		[0] = { .name = "id", .as_string = DatumGetInt32AsString },
 	};
 
+	Chunk *chunk = ts_chunk_cache_get_by_id(id);
+	uint64 generation;
+
+	if (chunk != NULL)
+		return chunk;
+
 	/*
 	 * Perform an index scan on chunk id.
 	 */
 	ScanKeyInit(&scankey[0], Anum_chunk_idx_id, BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(id));
 
-	return chunk_scan_find(CHUNK_ID_INDEX,
-						   scankey,
-						   1,
-						   CurrentMemoryContext,
-						   fail_if_not_found,
-						   displaykey);
+	generation = ts_chunk_cache_generation();
+	chunk = chunk_scan_find(CHUNK_ID_INDEX,
+							scankey,
+							1,
+							CurrentMemoryContext,
+							fail_if_not_found,
+							displaykey);
+
+	if (chunk != NULL)
+		ts_chunk_cache_add(chunk, generation);
+
+	return chunk;
 }
 
 /*
@@ -2724,6 +2795,20 @@ ts_chunk_get_hypertable_id_by_reloid(Oid reloid)
 	return 0;
 }
 
+/*
+ * Returns 0 if there is no chunk with such id.
+ */
+int32
+ts_chunk_get_hypertable_id_by_id(int32 chunk_id)
+{
+	FormData_chunk form;
+
+	if (chunk_simple_scan_by_id(chunk_id, &form, /* missing_ok = */ true))
+		return form.hypertable_id;
+
+	return 0;
+}
+
 FormData_chunk
 ts_chunk_get_formdata(int32 chunk_id)
 {
@@ -3110,6 +3195,36 @@ ts_chunk_exists_with_compression(int32 hypertable_id)
 	return found;
 }
 
+/*
+ * Check if any chunk of the hypertable was dropped with its catalog row
+ * preserved, that is, if the hypertable has chunk tombstones.
+ */
+bool
+ts_chunk_exists_dropped(int32 hypertable_id)
+{
+	ScanIterator iterator = ts_scan_iterator_create(CHUNK, AccessShareLock, CurrentMemoryContext);
+	bool found = false;
+
+	init_scan_by_hypertable_id(&iterator, hypertable_id);
+	ts_scanner_foreach(&iterator)
+	{
+		bool isnull;
+		bool dropped = DatumGetBool(
+			slot_getattr(ts_scan_iterator_slot(&iterator), Anum_chunk_dropped, &isnull));
+
+		/* dropped is not NULLABLE */
+		Assert(!isnull);
+
+		if (dropped)
+		{
+			found = true;
+			break;
+		}
+	}
+	ts_scan_iterator_close(&iterator);
+	return found;
+}
+
 static void
 init_scan_by_compressed_chunk_id(ScanIterator *iterator, int32 compressed_chunk_id)
 {
@@ -3787,6 +3902,25 @@ ts_chunk_drop_preserve_catalog_row(const Chunk *chunk, DropBehavior behavior, in
 	ts_chunk_drop_internal(chunk, behavior, log_level, true);
 }
 
+/* The range of the primary dimension of a dropped chunk */
+typedef struct DroppedRange
+{
+	int64 start;
+	int64 end;
+} DroppedRange;
+
+static int
+dropped_range_cmp(const void *left, const void *right)
+{
+	const DroppedRange *left_range = left;
+	const DroppedRange *right_range = right;
+
+	if (left_range->start != right_range->start)
+		return left_range->start < right_range->start ? -1 : 1;
+
+	return 0;
+}
+
 static void
 lock_referenced_tables(Oid table_relid)
 {
@@ -3826,9 +3960,13 @@ ts_chunk_do_drop_chunks(Hypertable *ht, int64 older_than, int64 newer_than, int3
 		.waitpolicy = LockWaitBlock,
 		.lockmode = LockTupleExclusive,
 	};
+	instr_time start;
 
 	ts_hypertable_permissions_check(ht->main_table_relid, GetUserId());
 
+	/* Finding and locking the chunks, and invalidating their regions */
+	ts_job_phase_start(&start);
+
 	/* We have a FK between hypertable H and PAR. Hypertable H has number of
 	 * chunks C1, C2, etc. When we execute "drop table C", PG acquires locks
 	 * on C and PAR. If we have a query as "select * from hypertable", this
@@ -3939,7 +4077,14 @@ ts_chunk_do_drop_chunks(Hypertable *ht, int64 older_than, int64 newer_than, int3
 		 *
 		 * The invalidation will allow the refresh command on a continuous
 		 * aggregate to see that this region was dropped and and will
-		 * therefore be able to refresh accordingly.*/
+		 * therefore be able to refresh accordingly.
+		 *
+		 * The ranges of adjacent chunks are merged, so that dropping many
+		 * chunks adds few entries to the invalidation log and the refresh
+		 * has fewer invalidations to process. */
+		DroppedRange *ranges = palloc(sizeof(DroppedRange) * (num_chunks + 1));
+		uint64 num_ranges = 0;
+
 		for (uint64 i = 0; i < num_chunks; i++)
 		{
 			if (osm_chunk_id == chunks[i].fd.id)
@@ -3947,13 +4092,29 @@ ts_chunk_do_drop_chunks(Hypertable *ht, int64 older_than, int64 newer_than, int3
 				// we do not rebuild continuous aggs if tiered data is dropped */
 				continue;
 			}
-			int64 start = ts_chunk_primary_dimension_start(&chunks[i]);
-			int64 end = ts_chunk_primary_dimension_end(&chunks[i]);
+			ranges[num_ranges].start = ts_chunk_primary_dimension_start(&chunks[i]);
+			ranges[num_ranges].end = ts_chunk_primary_dimension_end(&chunks[i]);
+			num_ranges++;
+		}
+
+		qsort(ranges, num_ranges, sizeof(DroppedRange), dropped_range_cmp);
+
+		for (uint64 i = 0; i < num_ranges;)
+		{
+			int64 start = ranges[i].start;
+			int64 end = ranges[i].end;
+
+			for (i++; i < num_ranges && ranges[i].start <= end; i++)
+				end = Max(end, ranges[i].end);
 
 			ts_cm_functions->continuous_agg_invalidate_raw_ht(ht, start, end);
 		}
+
+		pfree(ranges);
 	}
+	ts_job_phase_end("lock", &start);
 
+	ts_job_phase_start(&start);
 	bool all_caggs_finalized = ts_continuous_agg_hypertable_all_finalized(hypertable_id);
 	List *dropped_chunk_names = NIL;
 	for (uint64 i = 0; i < num_chunks; i++)
@@ -4006,6 +4167,7 @@ ts_chunk_do_drop_chunks(Hypertable *ht, int64 older_than, int64 newer_than, int3
 			}
 		}
 	}
+	ts_job_phase_end("drop", &start);
 
 	/* When dropping chunks for a given CAgg then force set the watermark */
 	if (is_materialization_hypertable)
@@ -4574,6 +4736,17 @@ ts_chunk_scan_iterator_set_chunk_id(ScanIterator *it, int32 chunk_id)
 								   Int32GetDatum(chunk_id));
 }
 
+/*
+ * Scan for the chunks with any of the ids, in the order of the ids.
+ */
+void
+ts_chunk_scan_iterator_set_chunk_ids(ScanIterator *it, const int32 *chunk_ids, int num_chunk_ids)
+{
+	it->ctx.index = catalog_get_index(ts_catalog_get(), CHUNK, CHUNK_ID_INDEX);
+	ts_scan_iterator_scan_key_reset(it);
+	ts_scan_iterator_scan_key_init_int32_array(it, Anum_chunk_idx_id, chunk_ids, num_chunk_ids);
+}
+
 /*
  * Create a hypercube for the OSM chunk
  * The initial range for the OSM chunk will be from INT64_MAX - 1 to INT64_MAX.
@@ -74,6 +74,12 @@ typedef struct Chunk
 	 * chunk table.
 	 */
 	Hypercube *cube;
+
+	/*
+	 * The constraints are not loaded for the chunks found when expanding a
+	 * hypertable during planning, where only the hypercube is needed. Use
+	 * ts_chunk_get_constraints() when the constraints might not be loaded.
+	 */
 	ChunkConstraints *constraints;
 
 } Chunk;
@@ -164,6 +170,7 @@ List *ts_chunk_id_find_in_subspace(Hypertable *ht, List *dimension_vecs);
 extern TSDLLEXPORT Chunk *ts_chunk_create_base(int32 id, int16 num_constraints, const char relkind);
 extern TSDLLEXPORT ChunkStub *ts_chunk_stub_create(int32 id, int16 num_constraints);
 extern TSDLLEXPORT Chunk *ts_chunk_copy(const Chunk *chunk);
+extern TSDLLEXPORT ChunkConstraints *ts_chunk_get_constraints(Chunk *chunk);
 extern TSDLLEXPORT Chunk *ts_chunk_get_by_name_with_memory_context(const char *schema_name,
 																   const char *table_name,
 																   MemoryContext mctx,
@@ -177,6 +184,7 @@ extern TSDLLEXPORT Chunk *ts_chunk_get_by_relid(Oid relid, bool fail_if_not_foun
 extern TSDLLEXPORT void ts_chunk_free(Chunk *chunk);
 extern bool ts_chunk_exists(const char *schema_name, const char *table_name);
 extern TSDLLEXPORT int32 ts_chunk_get_hypertable_id_by_reloid(Oid reloid);
+extern int32 ts_chunk_get_hypertable_id_by_id(int32 chunk_id);
 extern TSDLLEXPORT FormData_chunk ts_chunk_get_formdata(int32 chunk_id);
 extern TSDLLEXPORT bool ts_chunk_simple_scan_by_reloid(Oid reloid, FormData_chunk *form,
 													   bool missing_ok);
@@ -186,6 +194,7 @@ extern TSDLLEXPORT bool ts_chunk_get_id(const char *schema, const char *table, i
 										bool missing_ok);
 extern bool ts_chunk_exists_relid(Oid relid);
 extern TSDLLEXPORT bool ts_chunk_exists_with_compression(int32 hypertable_id);
+extern TSDLLEXPORT bool ts_chunk_exists_dropped(int32 hypertable_id);
 extern void ts_chunk_recreate_all_constraints_for_dimension(Hypertable *ht, int32 dimension_id);
 extern int ts_chunk_delete_by_hypertable_id(int32 hypertable_id);
 extern TSDLLEXPORT int ts_chunk_delete_by_name(const char *schema, const char *table,
@@ -242,6 +251,8 @@ extern Chunk *ts_chunk_build_from_tuple_and_stub(Chunk **chunkptr, TupleInfo *ti
 
 extern ScanIterator ts_chunk_scan_iterator_create(MemoryContext result_mcxt);
 extern void ts_chunk_scan_iterator_set_chunk_id(ScanIterator *it, int32 chunk_id);
+extern void ts_chunk_scan_iterator_set_chunk_ids(ScanIterator *it, const int32 *chunk_ids,
+												 int num_chunk_ids);
 extern bool ts_chunk_lock_if_exists(Oid chunk_oid, LOCKMODE chunk_lockmode);
 int ts_chunk_get_osm_chunk_id(int hypertable_id);
 extern TSDLLEXPORT void ts_chunk_merge_on_dimension(const Hypertable *ht, Chunk *chunk,
@@ -268,9 +279,9 @@ extern TSDLLEXPORT void ts_chunk_merge_on_dimension(const Hypertable *ht, Chunk
 		Assert((chunk)->fd.hypertable_id > 0);                                                     \
 		Assert(OidIsValid((chunk)->table_id));                                                     \
 		Assert(OidIsValid((chunk)->hypertable_relid));                                             \
-		Assert((chunk)->constraints);                                                              \
 		Assert((chunk)->cube);                                                                     \
-		Assert((chunk)->cube->num_slices == (chunk)->constraints->num_dimension_constraints);      \
+		Assert((chunk)->constraints == NULL ||                                                     \
+			   (chunk)->cube->num_slices == (chunk)->constraints->num_dimension_constraints);      \
 		Assert((chunk)->relkind == RELKIND_RELATION || (chunk)->relkind == RELKIND_FOREIGN_TABLE); \
 	} while (0)
 
@@ -6,11 +6,13 @@
  */
 #include <postgres.h>
 #include <catalog/pg_proc.h>
+#include <catalog/pg_statistic.h>
 #include <catalog/pg_type.h>
 #include <funcapi.h>
 #include <math.h>
 #include <miscadmin.h>
 #include <parser/parse_func.h>
+#include <pgstat.h>
 #include <utils/acl.h>
 #include <utils/array.h>
 #include <utils/builtins.h>
@@ -26,6 +28,7 @@
 #include "errors.h"
 #include "hypercube.h"
 #include "hypertable_cache.h"
+#include "ts_catalog/compression_chunk_size.h"
 #include "utils.h"
 
 #define DEFAULT_CHUNK_SIZING_FN_NAME "calculate_chunk_interval"
@@ -304,6 +307,137 @@ ts_chunk_get_minmax(Oid relid, Oid atttype, AttrNumber attnum, const char *call_
 	return res == MINMAX_FOUND;
 }
 
+/*
+ * The column statistics of a chunk are used instead of scanning it only if
+ * the rows modified since the last ANALYZE are at most this fraction of the
+ * live rows.
+ */
+#define STATS_MAX_MODIFIED_FRACTION 0.1
+
+/*
+ * Get the min and max value for a given column of a chunk from the column
+ * statistics gathered by ANALYZE.
+ *
+ * The values are the extremes of the histogram and the most common values,
+ * which cover the range of the rows sampled by ANALYZE. The statistics are
+ * only used if the insert and update counters of the chunk show that it has
+ * not changed much since then, so that the range is still accurate.
+ *
+ * Returns true iff min and max is found, otherwise false.
+ */
+static bool
+chunk_get_minmax_from_stats(Oid relid, Oid atttype, AttrNumber attnum, int64 *min, int64 *max)
+{
+	static const int stakinds[] = { STATISTIC_KIND_HISTOGRAM, STATISTIC_KIND_MCV };
+	PgStat_StatTabEntry *tabentry = pgstat_fetch_stat_tabentry(relid);
+	HeapTuple tuple;
+	bool found = false;
+
+	if (tabentry == NULL || pgstat_tabentry_live_tuples(tabentry) <= 0 ||
+		pgstat_tabentry_mod_since_analyze(tabentry) >
+			STATS_MAX_MODIFIED_FRACTION * pgstat_tabentry_live_tuples(tabentry))
+		return false;
+
+	tuple = SearchSysCache3(STATRELATTINH,
+							ObjectIdGetDatum(relid),
+							Int16GetDatum(attnum),
+							BoolGetDatum(false));
+
+	if (!HeapTupleIsValid(tuple))
+		return false;
+
+	for (size_t i = 0; i < lengthof(stakinds); i++)
+	{
+		AttStatsSlot sslot;
+
+		if (!get_attstatsslot(&sslot, tuple, stakinds[i], InvalidOid, ATTSTATSSLOT_VALUES))
+			continue;
+
+		for (int j = 0; j < sslot.nvalues; j++)
+		{
+			int64 value = ts_time_value_to_internal(sslot.values[j], atttype);
+
+			if (!found || value < *min)
+				*min = value;
+			if (!found || value > *max)
+				*max = value;
+			found = true;
+		}
+
+		free_attstatsslot(&sslot);
+	}
+
+	ReleaseSysCache(tuple);
+
+	return found;
+}
+
+/*
+ * Get the ratio of the compressed size to the uncompressed size of the most
+ * recently compressed chunks of a hypertable, or 1.0 if no chunk is
+ * compressed.
+ */
+#define COMPRESSION_RATIO_WINDOW 10
+
+static double
+hypertable_get_compression_ratio(const Hypertable *ht)
+{
+	List *chunk_ids;
+	int64 uncompressed_total = 0;
+	int64 compressed_total = 0;
+	int num_compressed = 0;
+
+	if (!TS_HYPERTABLE_HAS_COMPRESSION_ENABLED(ht))
+		return 1.0;
+
+	/* The most recently created chunks have the highest ids */
+	chunk_ids = ts_chunk_get_chunk_ids_by_hypertable_id(ht->fd.id);
+	list_sort(chunk_ids, list_int_cmp);
+
+	for (int i = list_length(chunk_ids) - 1; i >= 0 && num_compressed < COMPRESSION_RATIO_WINDOW;
+		 i--)
+	{
+		int64 uncompressed_size;
+		int64 compressed_size;
+
+		if (ts_compression_chunk_size_get_sizes(list_nth_int(chunk_ids, i),
+												&uncompressed_size,
+												&compressed_size))
+		{
+			uncompressed_total += uncompressed_size;
+			compressed_total += compressed_size;
+			num_compressed++;
+		}
+	}
+
+	if (uncompressed_total <= 0 || compressed_total <= 0)
+		return 1.0;
+
+	return (double) compressed_total / uncompressed_total;
+}
+
+/*
+ * Get the size of a chunk as it is stored eventually, i.e., the size after
+ * compression. For a compressed chunk this is the size of the compressed
+ * data plus the rows inserted after the compression, and the size of a
+ * chunk that is not compressed yet is scaled down by the compression ratio
+ * that the hypertable gets.
+ */
+static int64
+chunk_get_stored_size(const Chunk *chunk, double compression_ratio)
+{
+	int64 size = DatumGetInt64(
+		DirectFunctionCall1(pg_total_relation_size, ObjectIdGetDatum(chunk->table_id)));
+	int64 uncompressed_size;
+	int64 compressed_size;
+
+	if (ts_chunk_is_compressed(chunk) &&
+		ts_compression_chunk_size_get_sizes(chunk->fd.id, &uncompressed_size, &compressed_size))
+		return compressed_size + (int64) (size * compression_ratio);
+
+	return (int64) (size * compression_ratio);
+}
+
 #define CHUNK_SIZING_FUNC_NARGS 3
 #define DEFAULT_CHUNK_WINDOW 3
 
@@ -328,8 +462,6 @@ ts_chunk_get_minmax(Oid relid, Oid atttype, AttrNumber attnum, const char *call_
  * and be used in normal prediction mode */
 #define UNDERSIZED_FILLFACTOR_THRESH (SIZE_FILLFACTOR_THRESH * 1.1)
 
-TS_FUNCTION_INFO_V1(ts_calculate_chunk_interval);
-
 /*
  * Calculate a new interval for a chunk in a given dimension.
  *
@@ -408,13 +540,17 @@ TS_FUNCTION_INFO_V1(ts_calculate_chunk_interval);
  * size so that the next chunks created at least meet SIZE_FILLFACTOR_THRESH.
  * This will then allow the algorithm to work in the normal way to adjust
  * further if needed.
+ *
+ * With "use_stats", the MIN and MAX dimension values are taken from the
+ * column statistics of the chunks when they are up to date, and the chunks
+ * are only scanned when they are not. The chunk size is then the size after
+ * compression, so that the target size applies to the storage the chunks
+ * eventually take.
  */
-Datum
-ts_calculate_chunk_interval(PG_FUNCTION_ARGS)
+static int64
+calculate_chunk_interval(int32 dimension_id, int64 dimension_coord, int64 chunk_target_size_bytes,
+						 bool use_stats)
 {
-	int32 dimension_id = PG_GETARG_INT32(0);
-	int64 dimension_coord = PG_GETARG_INT64(1);
-	int64 chunk_target_size_bytes = PG_GETARG_INT64(2);
 	int64 chunk_interval = 0;
 	int64 undersized_intervals = 0;
 	int64 current_interval;
@@ -427,11 +563,9 @@ ts_calculate_chunk_interval(PG_FUNCTION_ARGS)
 	int num_undersized_intervals = 0;
 	double interval_diff;
 	double undersized_fillfactor = 0.0;
+	double compression_ratio = 1.0;
 	AclResult acl_result;
 
-	if (PG_NARGS() != CHUNK_SIZING_FUNC_NARGS)
-		elog(ERROR, "invalid number of arguments");
-
 	if (chunk_target_size_bytes < 0)
 		elog(ERROR, "chunk_target_size must be positive");
 
@@ -458,6 +592,12 @@ ts_calculate_chunk_interval(PG_FUNCTION_ARGS)
 
 	current_interval = dim->fd.interval_length;
 
+	if (use_stats)
+	{
+		compression_ratio = hypertable_get_compression_ratio(ht);
+		elog(DEBUG1, "[adaptive] compression_ratio=%lf", compression_ratio);
+	}
+
 	/* Get a window of recent chunks */
 	chunks = ts_chunk_get_window(dimension_id,
 								 dimension_coord,
@@ -470,24 +610,47 @@ ts_calculate_chunk_interval(PG_FUNCTION_ARGS)
 		const DimensionSlice *slice =
 			ts_hypercube_get_slice_by_dimension_id(chunk->cube, dimension_id);
 		int64 chunk_size, slice_interval;
-		Datum minmax[2];
+		int64 min = 0;
+		int64 max = 0;
+		bool found = false;
 		AttrNumber attno = ts_map_attno(ht->main_table_relid, chunk->table_id, dim->column_attno);
 
 		Assert(NULL != slice);
 
-		chunk_size = DatumGetInt64(
-			DirectFunctionCall1(pg_total_relation_size, ObjectIdGetDatum(chunk->table_id)));
+		if (use_stats)
+		{
+			chunk_size = chunk_get_stored_size(chunk, compression_ratio);
+			found = chunk_get_minmax_from_stats(chunk->table_id,
+												dim->fd.column_type,
+												attno,
+												&min,
+												&max);
+		}
+		else
+			chunk_size = DatumGetInt64(
+				DirectFunctionCall1(pg_total_relation_size, ObjectIdGetDatum(chunk->table_id)));
 
 		slice_interval = slice->fd.range_end - slice->fd.range_start;
 
-		if (ts_chunk_get_minmax(chunk->table_id,
-								dim->fd.column_type,
-								attno,
-								"adaptive chunking",
-								minmax))
+		if (!found)
+		{
+			Datum minmax[2];
+
+			found = ts_chunk_get_minmax(chunk->table_id,
+										dim->fd.column_type,
+										attno,
+										"adaptive chunking",
+										minmax);
+
+			if (found)
+			{
+				min = ts_time_value_to_internal(minmax[0], dim->fd.column_type);
+				max = ts_time_value_to_internal(minmax[1], dim->fd.column_type);
+			}
+		}
+
+		if (found)
 		{
-			int64 min = ts_time_value_to_internal(minmax[0], dim->fd.column_type);
-			int64 max = ts_time_value_to_internal(minmax[1], dim->fd.column_type);
 			double interval_fillfactor, size_fillfactor;
 			int64 extrapolated_chunk_size;
 
@@ -577,7 +740,7 @@ ts_calculate_chunk_interval(PG_FUNCTION_ARGS)
 			 "nor enough undersized chunks to estimate. "
 			 "use previous size of " UINT64_FORMAT,
 			 current_interval);
-		PG_RETURN_INT64(current_interval);
+		return current_interval;
 	}
 	else
 		chunk_interval /= num_intervals;
@@ -606,7 +769,40 @@ ts_calculate_chunk_interval(PG_FUNCTION_ARGS)
 			 hypertable_id);
 	}
 
-	PG_RETURN_INT64(chunk_interval);
+	return chunk_interval;
+}
+
+TS_FUNCTION_INFO_V1(ts_calculate_chunk_interval);
+
+Datum
+ts_calculate_chunk_interval(PG_FUNCTION_ARGS)
+{
+	if (PG_NARGS() != CHUNK_SIZING_FUNC_NARGS)
+		elog(ERROR, "invalid number of arguments");
+
+	PG_RETURN_INT64(calculate_chunk_interval(PG_GETARG_INT32(0),
+											 PG_GETARG_INT64(1),
+											 PG_GETARG_INT64(2),
+											 /* use_stats = */ false));
+}
+
+TS_FUNCTION_INFO_V1(ts_calculate_chunk_interval_from_stats);
+
+/*
+ * Calculate a new chunk interval like ts_calculate_chunk_interval(), but
+ * using the column statistics instead of scanning the recent chunks, and
+ * the compressed size of the chunks.
+ */
+Datum
+ts_calculate_chunk_interval_from_stats(PG_FUNCTION_ARGS)
+{
+	if (PG_NARGS() != CHUNK_SIZING_FUNC_NARGS)
+		elog(ERROR, "invalid number of arguments");
+
+	PG_RETURN_INT64(calculate_chunk_interval(PG_GETARG_INT32(0),
+											 PG_GETARG_INT64(1),
+											 PG_GETARG_INT64(2),
+											 /* use_stats = */ true));
 }
 
 /*
@@ -0,0 +1,281 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Backend-local cache of the chunk metadata, keyed by the chunk relid and the
+ * chunk id, so that repeated lookups of the same chunks, e.g., when creating
+ * the chunk insert states or planning queries on a hypertable, don't scan the
+ * chunk catalog with its constraints and dimension slices every time.
+ *
+ * The cached chunks are complete, including the constraints, the hypercube
+ * and the chunk status, so they are invalidated when any of these change:
+ *
+ * - Any update or delete in the chunk, chunk constraint or dimension slice
+ *   catalog invalidates the relcache of the hypertable, which drops the
+ *   entries of its chunks, or the hypertable cache proxy if the hypertable is
+ *   not known, which resets this cache.
+ * - A relcache invalidation of a chunk drops the entry of the chunk.
+ * - An insert into the chunk constraint catalog resets the cache of the
+ *   current backend, since an existing chunk might get new constraints.
+ *   Other backends can't have cached the chunk with the uncommitted
+ *   constraints.
+ * - Aborted transactions reset the cache.
+ *
+ * The invalidations are processed when the chunk is locked, so we see the
+ * changes made by the concurrent operations that held a conflicting lock,
+ * the same as when reading the catalog. The least recently used entries are
+ * evicted when the cache is full.
+ */
+#include <postgres.h>
+#include <lib/ilist.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
+
+#include "chunk_cache.h"
+
+#define CHUNK_CACHE_SIZE 1024
+
+typedef struct ChunkCacheEntry
+{
+	Oid chunk_relid; /* Hash key */
+	Chunk *chunk;
+	dlist_node lru_node;
+} ChunkCacheEntry;
+
+typedef struct ChunkCacheIdEntry
+{
+	int32 chunk_id; /* Hash key */
+	Oid chunk_relid;
+} ChunkCacheIdEntry;
+
+static MemoryContext chunk_cache_mcxt = NULL;
+static HTAB *chunk_cache = NULL;
+static HTAB *chunk_cache_by_id = NULL;
+static dlist_head chunk_cache_lru;
+
+/*
+ * Incremented on every invalidation, to detect invalidations that happen
+ * while we read the chunk metadata.
+ */
+static uint64 chunk_cache_generation = 0;
+
+static uint64 chunk_cache_hits = 0;
+static uint64 chunk_cache_misses = 0;
+static uint64 chunk_cache_evictions = 0;
+static uint64 chunk_cache_invalidations = 0;
+
+static void
+chunk_cache_remove(ChunkCacheEntry *entry)
+{
+	Oid chunk_relid = entry->chunk_relid;
+
+	hash_search(chunk_cache_by_id, &entry->chunk->fd.id, HASH_REMOVE, NULL);
+	dlist_delete(&entry->lru_node);
+	ts_chunk_free(entry->chunk);
+	hash_search(chunk_cache, &chunk_relid, HASH_REMOVE, NULL);
+}
+
+static void
+chunk_cache_create(void)
+{
+	HASHCTL ctl = {
+		.keysize = sizeof(Oid),
+		.entrysize = sizeof(ChunkCacheEntry),
+	};
+	HASHCTL id_ctl = {
+		.keysize = sizeof(int32),
+		.entrysize = sizeof(ChunkCacheIdEntry),
+	};
+
+	chunk_cache_mcxt =
+		AllocSetContextCreate(CacheMemoryContext, "chunk cache", ALLOCSET_DEFAULT_SIZES);
+	ctl.hcxt = chunk_cache_mcxt;
+	id_ctl.hcxt = chunk_cache_mcxt;
+	chunk_cache = hash_create("chunk cache",
+							  CHUNK_CACHE_SIZE,
+							  &ctl,
+							  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	chunk_cache_by_id = hash_create("chunk cache by id",
+									CHUNK_CACHE_SIZE,
+									&id_ctl,
+									HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	dlist_init(&chunk_cache_lru);
+}
+
+/*
+ * Invalidate the cached chunk with the relid, or the cached chunks of the
+ * hypertable with the relid, or all cached chunks if the relid is invalid.
+ *
+ * Called from the relcache invalidation callback, so this must not access
+ * the catalogs.
+ */
+void
+ts_chunk_cache_invalidate(Oid relid)
+{
+	HASH_SEQ_STATUS status;
+	ChunkCacheEntry *entry;
+
+	chunk_cache_generation++;
+
+	if (chunk_cache == NULL)
+		return;
+
+	if (!OidIsValid(relid))
+	{
+		chunk_cache_invalidations += hash_get_num_entries(chunk_cache);
+		MemoryContextDelete(chunk_cache_mcxt);
+		chunk_cache_mcxt = NULL;
+		chunk_cache = NULL;
+		chunk_cache_by_id = NULL;
+		return;
+	}
+
+	entry = hash_search(chunk_cache, &relid, HASH_FIND, NULL);
+
+	if (entry != NULL)
+	{
+		chunk_cache_remove(entry);
+		chunk_cache_invalidations++;
+		return;
+	}
+
+	/* Removing the current element is allowed during a sequential scan */
+	hash_seq_init(&status, chunk_cache);
+
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->chunk->hypertable_relid == relid)
+		{
+			chunk_cache_remove(entry);
+			chunk_cache_invalidations++;
+		}
+	}
+}
+
+/*
+ * Get the cached chunk with the relid, or NULL if it is not cached. Returns a
+ * copy in the current memory context, since the cache might be invalidated
+ * while the chunk is used, and the callers are free to modify the chunk.
+ */
+Chunk *
+ts_chunk_cache_get_by_relid(Oid chunk_relid)
+{
+	ChunkCacheEntry *entry;
+
+	if (chunk_cache == NULL)
+	{
+		chunk_cache_misses++;
+		return NULL;
+	}
+
+	entry = hash_search(chunk_cache, &chunk_relid, HASH_FIND, NULL);
+
+	if (entry == NULL)
+	{
+		chunk_cache_misses++;
+		return NULL;
+	}
+
+	chunk_cache_hits++;
+	dlist_move_head(&chunk_cache_lru, &entry->lru_node);
+	return ts_chunk_copy(entry->chunk);
+}
+
+/*
+ * Get the cached chunk with the id, or NULL if it is not cached.
+ */
+Chunk *
+ts_chunk_cache_get_by_id(int32 chunk_id)
+{
+	ChunkCacheIdEntry *id_entry;
+
+	if (chunk_cache == NULL)
+	{
+		chunk_cache_misses++;
+		return NULL;
+	}
+
+	id_entry = hash_search(chunk_cache_by_id, &chunk_id, HASH_FIND, NULL);
+
+	if (id_entry == NULL)
+	{
+		chunk_cache_misses++;
+		return NULL;
+	}
+
+	return ts_chunk_cache_get_by_relid(id_entry->chunk_relid);
+}
+
+/*
+ * Get the current generation of the cache, to pass to ts_chunk_cache_add()
+ * after reading the chunk from the catalog.
+ */
+uint64
+ts_chunk_cache_generation(void)
+{
+	return chunk_cache_generation;
+}
+
+/*
+ * Add a copy of the chunk read from the catalog to the cache, unless the
+ * cache was invalidated since the given generation, in which case the chunk
+ * might have changed while we read it.
+ */
+void
+ts_chunk_cache_add(const Chunk *chunk, uint64 generation)
+{
+	ChunkCacheEntry *entry;
+	ChunkCacheIdEntry *id_entry;
+	bool found;
+
+	if (generation != chunk_cache_generation || !OidIsValid(chunk->table_id))
+		return;
+
+	if (chunk_cache == NULL)
+		chunk_cache_create();
+
+	entry = hash_search(chunk_cache, &chunk->table_id, HASH_FIND, NULL);
+
+	if (entry != NULL)
+		chunk_cache_remove(entry);
+	else if (hash_get_num_entries(chunk_cache) >= CHUNK_CACHE_SIZE)
+	{
+		chunk_cache_remove(dlist_tail_element(ChunkCacheEntry, lru_node, &chunk_cache_lru));
+		chunk_cache_evictions++;
+	}
+
+	/* The chunk id might be reused by a chunk with a new relid */
+	id_entry = hash_search(chunk_cache_by_id, &chunk->fd.id, HASH_FIND, NULL);
+
+	if (id_entry != NULL)
+		chunk_cache_remove(hash_search(chunk_cache, &id_entry->chunk_relid, HASH_FIND, NULL));
+
+	MemoryContext old_mcxt = MemoryContextSwitchTo(chunk_cache_mcxt);
+	Chunk *copy = ts_chunk_copy(chunk);
+	MemoryContextSwitchTo(old_mcxt);
+
+	entry = hash_search(chunk_cache, &chunk->table_id, HASH_ENTER, &found);
+	Assert(!found);
+	entry->chunk = copy;
+	dlist_push_head(&chunk_cache_lru, &entry->lru_node);
+
+	id_entry = hash_search(chunk_cache_by_id, &chunk->fd.id, HASH_ENTER, &found);
+	Assert(!found);
+	id_entry->chunk_relid = chunk->table_id;
+}
+
+void
+ts_chunk_cache_get_usage(CacheUsage *usage)
+{
+	usage->name = "chunk_cache";
+	usage->entries = chunk_cache == NULL ? 0 : hash_get_num_entries(chunk_cache);
+	usage->hits = chunk_cache_hits;
+	usage->misses = chunk_cache_misses;
+	usage->evictions = chunk_cache_evictions;
+	usage->invalidations = chunk_cache_invalidations;
+	usage->memory =
+		chunk_cache_mcxt == NULL ? 0 : MemoryContextMemAllocated(chunk_cache_mcxt, true);
+}
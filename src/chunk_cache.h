@@ -0,0 +1,18 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include "cache.h"
+#include "chunk.h"
+
+extern Chunk *ts_chunk_cache_get_by_relid(Oid chunk_relid);
+extern Chunk *ts_chunk_cache_get_by_id(int32 chunk_id);
+extern uint64 ts_chunk_cache_generation(void);
+extern void ts_chunk_cache_add(const Chunk *chunk, uint64 generation);
+extern void ts_chunk_cache_invalidate(Oid relid);
+extern void ts_chunk_cache_get_usage(CacheUsage *usage);
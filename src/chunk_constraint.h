@@ -91,3 +91,6 @@ extern ChunkConstraint *ts_chunk_constraints_add_from_tuple(ChunkConstraints *cc
 extern ScanIterator ts_chunk_constraint_scan_iterator_create(MemoryContext result_mcxt);
 extern void ts_chunk_constraint_scan_iterator_set_slice_id(ScanIterator *it, int32 slice_id);
 extern void ts_chunk_constraint_scan_iterator_set_chunk_id(ScanIterator *it, int32 chunk_id);
+extern void ts_chunk_constraint_scan_iterator_set_chunk_ids(ScanIterator *it,
+															const int32 *chunk_ids,
+															int num_chunk_ids);
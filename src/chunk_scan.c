@@ -20,6 +20,15 @@
 #include "scan_iterator.h"
 #include "utils.h"
 
+static int
+int32_cmp(const void *a, const void *b)
+{
+	int32 lhs = *(const int32 *) a;
+	int32 rhs = *(const int32 *) b;
+
+	return (lhs > rhs) - (lhs < rhs);
+}
+
 /*
  * Scan for chunks matching a query.
  *
@@ -36,6 +45,15 @@
  * For performance, try not to interleave scans of different metadata tables
  * in order to maintain data locality while scanning. Also, keep scanned
  * tables and indexes open until all the metadata is scanned for all chunks.
+ *
+ * Each catalog table is read with a single index scan for all the chunks,
+ * using an array scan key over the ids, instead of a rescan per chunk. The
+ * index returns the tuples ordered by the id, so the chunk ids must be
+ * sorted, and the chunks are returned in the same order.
+ *
+ * The chunks are returned without their constraints, since the planner only
+ * needs the hypercubes. This saves a lot of memory when planning queries on
+ * many chunks.
  */
 Chunk **
 ts_chunk_scan_by_chunk_ids(const Hyperspace *hs, const List *chunk_ids, unsigned int *num_chunks)
@@ -44,82 +62,112 @@ ts_chunk_scan_by_chunk_ids(const Hyperspace *hs, const List *chunk_ids, unsigned
 		AllocSetContextCreate(CurrentMemoryContext, "chunk-scan-work", ALLOCSET_DEFAULT_SIZES);
 	Chunk **locked_chunks = NULL;
 	int locked_chunk_count = 0;
+	int num_ids = list_length(chunk_ids);
+	int num_found = 0;
+	TupleInfo *ti;
 	ListCell *lc;
+	int i = 0;
 
 	Assert(OidIsValid(hs->main_table_relid));
 	MemoryContext orig_mcxt = MemoryContextSwitchTo(work_mcxt);
 
+	int32 *ids = palloc(sizeof(int32) * num_ids);
+	int32 *found_ids = palloc(sizeof(int32) * num_ids);
+	Oid *found_relids = palloc(sizeof(Oid) * num_ids);
+
+	foreach (lc, chunk_ids)
+	{
+		ids[i] = lfirst_int(lc);
+		Assert(i == 0 || ids[i - 1] <= ids[i]);
+		i++;
+	}
+
 	/*
-	 * For each matching chunk, fill in the metadata from the "chunk" table.
-	 * Make sure to filter out "dropped" chunks.
+	 * Find the matching chunks in the "chunk" table. Make sure to filter out
+	 * "dropped" chunks.
 	 */
 	ScanIterator chunk_it = ts_chunk_scan_iterator_create(orig_mcxt);
-	locked_chunks =
-		(Chunk **) MemoryContextAlloc(orig_mcxt, sizeof(Chunk *) * list_length(chunk_ids));
-	foreach (lc, chunk_ids)
-	{
-		int chunk_id = lfirst_int(lc);
+	locked_chunks = (Chunk **) MemoryContextAlloc(orig_mcxt, sizeof(Chunk *) * num_ids);
 
-		Assert(CurrentMemoryContext == work_mcxt);
+	if (num_ids > 0)
+	{
+		ts_chunk_scan_iterator_set_chunk_ids(&chunk_it, ids, num_ids);
+		ts_scan_iterator_start_scan(&chunk_it);
 
-		ts_chunk_scan_iterator_set_chunk_id(&chunk_it, chunk_id);
-		ts_scan_iterator_start_or_restart_scan(&chunk_it);
-		TupleInfo *ti = ts_scan_iterator_next(&chunk_it);
-		if (ti == NULL)
-		{
-			continue;
-		}
-		bool isnull;
-		Datum datum = slot_getattr(ti->slot, Anum_chunk_dropped, &isnull);
-		const bool is_dropped = isnull ? false : DatumGetBool(datum);
-		if (is_dropped)
+		while ((ti = ts_scan_iterator_next(&chunk_it)) != NULL)
 		{
-			continue;
-		}
+			bool isnull;
+			Datum datum = slot_getattr(ti->slot, Anum_chunk_dropped, &isnull);
+			const bool is_dropped = isnull ? false : DatumGetBool(datum);
+			if (is_dropped)
+			{
+				continue;
+			}
 
-		/* We found a chunk that is not dropped. First, try to lock it. */
-		Name schema_name = DatumGetName(slot_getattr(ti->slot, Anum_chunk_schema_name, &isnull));
-		Assert(!isnull);
-		Name table_name = DatumGetName(slot_getattr(ti->slot, Anum_chunk_table_name, &isnull));
-		Assert(!isnull);
+			Name schema_name =
+				DatumGetName(slot_getattr(ti->slot, Anum_chunk_schema_name, &isnull));
+			Assert(!isnull);
+			Name table_name = DatumGetName(slot_getattr(ti->slot, Anum_chunk_table_name, &isnull));
+			Assert(!isnull);
 
-		Oid chunk_reloid = ts_get_relation_relid(NameStr(*schema_name),
-												 NameStr(*table_name),
-												 /* return_invalid = */ false);
-		Assert(OidIsValid(chunk_reloid));
+			Oid chunk_reloid = ts_get_relation_relid(NameStr(*schema_name),
+													 NameStr(*table_name),
+													 /* return_invalid = */ false);
+			Assert(OidIsValid(chunk_reloid));
 
-		/* Only one chunk should match */
-		Assert(ts_scan_iterator_next(&chunk_it) == NULL);
+			found_ids[num_found] = DatumGetInt32(slot_getattr(ti->slot, Anum_chunk_id, &isnull));
+			Assert(!isnull);
+			found_relids[num_found] = chunk_reloid;
+			num_found++;
+		}
+	}
 
+	/* We found the chunks that are not dropped. Now, try to lock them. */
+	int num_locked = 0;
+	for (i = 0; i < num_found; i++)
+	{
 		DEBUG_WAITPOINT("hypertable_expansion_before_lock_chunk");
-		if (!ts_chunk_lock_if_exists(chunk_reloid, AccessShareLock))
+		if (!ts_chunk_lock_if_exists(found_relids[i], AccessShareLock))
 		{
 			continue;
 		}
 
-		/*
-		 * Now after we have locked the chunk, we have to reread its metadata.
-		 * It might have been modified concurrently by decompression, for
-		 * example.
-		 */
-		ts_chunk_scan_iterator_set_chunk_id(&chunk_it, chunk_id);
+		found_ids[num_locked] = found_ids[i];
+		found_relids[num_locked] = found_relids[i];
+		num_locked++;
+	}
+
+	/*
+	 * Now after we have locked the chunks, we have to reread their metadata.
+	 * It might have been modified concurrently by decompression, for
+	 * example.
+	 */
+	if (num_locked > 0)
+	{
+		int found_index = 0;
+
+		ts_chunk_scan_iterator_set_chunk_ids(&chunk_it, found_ids, num_locked);
 		ts_scan_iterator_start_or_restart_scan(&chunk_it);
-		ti = ts_scan_iterator_next(&chunk_it);
-		Assert(ti != NULL);
-		Chunk *chunk = MemoryContextAllocZero(orig_mcxt, sizeof(Chunk));
 
-		ts_chunk_formdata_fill(&chunk->fd, ti);
+		while ((ti = ts_scan_iterator_next(&chunk_it)) != NULL)
+		{
+			Chunk *chunk = MemoryContextAllocZero(orig_mcxt, sizeof(Chunk));
+
+			ts_chunk_formdata_fill(&chunk->fd, ti);
 
-		chunk->constraints = NULL;
-		chunk->cube = NULL;
-		chunk->hypertable_relid = hs->main_table_relid;
-		chunk->table_id = chunk_reloid;
+			/* The tuples are returned in the order of the ids */
+			while (found_index < num_locked && found_ids[found_index] != chunk->fd.id)
+				found_index++;
+			Assert(found_index < num_locked);
 
-		locked_chunks[locked_chunk_count] = chunk;
-		locked_chunk_count++;
+			chunk->constraints = NULL;
+			chunk->cube = NULL;
+			chunk->hypertable_relid = hs->main_table_relid;
+			chunk->table_id = found_relids[found_index];
 
-		/* Only one chunk should match */
-		Assert(ts_scan_iterator_next(&chunk_it) == NULL);
+			locked_chunks[locked_chunk_count] = chunk;
+			locked_chunk_count++;
+		}
 	}
 
 	ts_scan_iterator_close(&chunk_it);
@@ -128,66 +176,126 @@ ts_chunk_scan_by_chunk_ids(const Hyperspace *hs, const List *chunk_ids, unsigned
 	Assert(locked_chunk_count <= list_length(chunk_ids));
 	Assert(CurrentMemoryContext == work_mcxt);
 
-	for (int i = 0; i < locked_chunk_count; i++)
+	for (i = 0; i < locked_chunk_count; i++)
 	{
 		Chunk *chunk = locked_chunks[i];
 
 		ts_get_rel_info(chunk->table_id, &chunk->amoid, &chunk->relkind);
 
 		Assert(OidIsValid(chunk->amoid) || chunk->fd.osm_chunk);
+
+		ids[i] = chunk->fd.id;
 	}
 
 	/*
-	 * Fetch the chunk constraints.
+	 * Fetch the dimension slice ids from the chunk constraints. They are
+	 * ordered by the chunk id, the same as the chunks. The planner only needs
+	 * the hypercube, so the constraints themselves are not kept and are
+	 * loaded on demand with ts_chunk_get_constraints().
 	 */
+	List **chunk_slice_ids = palloc0(sizeof(List *) * Max(locked_chunk_count, 1));
+	int num_slice_ids = 0;
+	int num_slices = 0;
 	ScanIterator constr_it = ts_chunk_constraint_scan_iterator_create(orig_mcxt);
 
-	for (int i = 0; i < locked_chunk_count; i++)
+	if (locked_chunk_count > 0)
 	{
-		Chunk *chunk = locked_chunks[i];
-		chunk->constraints = ts_chunk_constraints_alloc(/* size_hint = */ 0, orig_mcxt);
+		int chunk_index = 0;
 
-		ts_chunk_constraint_scan_iterator_set_chunk_id(&constr_it, chunk->fd.id);
-		ts_scan_iterator_start_or_restart_scan(&constr_it);
+		ts_chunk_constraint_scan_iterator_set_chunk_ids(&constr_it, ids, locked_chunk_count);
+		ts_scan_iterator_start_scan(&constr_it);
 
-		while (ts_scan_iterator_next(&constr_it) != NULL)
+		while ((ti = ts_scan_iterator_next(&constr_it)) != NULL)
 		{
-			TupleInfo *constr_ti = ts_scan_iterator_tuple_info(&constr_it);
-			ts_chunk_constraints_add_from_tuple(chunk->constraints, constr_ti);
+			bool chunk_id_isnull;
+			bool slice_id_isnull;
+			int32 chunk_id = DatumGetInt32(
+				slot_getattr(ti->slot, Anum_chunk_constraint_chunk_id, &chunk_id_isnull));
+			Datum slice_id =
+				slot_getattr(ti->slot, Anum_chunk_constraint_dimension_slice_id, &slice_id_isnull);
+			Assert(!chunk_id_isnull);
+
+			/* Not a dimension constraint */
+			if (slice_id_isnull)
+				continue;
+
+			while (chunk_index < locked_chunk_count &&
+				   locked_chunks[chunk_index]->fd.id != chunk_id)
+				chunk_index++;
+			Assert(chunk_index < locked_chunk_count);
+
+			chunk_slice_ids[chunk_index] =
+				lappend_int(chunk_slice_ids[chunk_index], DatumGetInt32(slice_id));
+			num_slice_ids++;
 		}
 	}
 	ts_scan_iterator_close(&constr_it);
 
 	/*
-	 * Build hypercubes for the chunks by finding and combining the dimension
-	 * slices that match the chunk constraints.
+	 * Fetch all the dimension slices referenced by the chunks, which are
+	 * often shared between the chunks. Don't have to lock them because the
+	 * chunks are locked.
+	 */
+	int32 *slice_ids = palloc(sizeof(int32) * Max(num_slice_ids, 1));
+
+	for (i = 0; i < locked_chunk_count; i++)
+	{
+		foreach (lc, chunk_slice_ids[i])
+			slice_ids[num_slices++] = lfirst_int(lc);
+	}
+
+	Assert(num_slices == num_slice_ids);
+	qsort(slice_ids, num_slice_ids, sizeof(int32), int32_cmp);
+
+	/* Remove the duplicates, so that the slices match the ids by position */
+	num_slices = 0;
+	for (i = 0; i < num_slice_ids; i++)
+	{
+		if (num_slices == 0 || slice_ids[num_slices - 1] != slice_ids[i])
+			slice_ids[num_slices++] = slice_ids[i];
+	}
+
+	DimensionSlice **slices = palloc0(sizeof(DimensionSlice *) * Max(num_slices, 1));
+	ScanIterator slice_iterator = ts_dimension_slice_scan_iterator_create(NULL, work_mcxt);
+
+	if (num_slices > 0)
+	{
+		int slice_index = 0;
+
+		ts_dimension_slice_scan_iterator_set_slice_ids(&slice_iterator, slice_ids, num_slices);
+		ts_scan_iterator_start_scan(&slice_iterator);
+
+		while ((ti = ts_scan_iterator_next(&slice_iterator)) != NULL)
+		{
+			DimensionSlice *slice = ts_dimension_slice_from_tuple(ti);
+
+			while (slice_index < num_slices && slice_ids[slice_index] != slice->fd.id)
+				slice_index++;
+			Assert(slice_index < num_slices);
+
+			slices[slice_index] = slice;
+		}
+	}
+	ts_scan_iterator_close(&slice_iterator);
+
+	/*
+	 * Build hypercubes for the chunks by combining the dimension slices that
+	 * match the chunk constraints.
 	 */
-	ScanIterator slice_iterator = ts_dimension_slice_scan_iterator_create(NULL, orig_mcxt);
 	for (int chunk_index = 0; chunk_index < locked_chunk_count; chunk_index++)
 	{
 		Chunk *chunk = locked_chunks[chunk_index];
-		ChunkConstraints *constraints = chunk->constraints;
 		MemoryContextSwitchTo(orig_mcxt);
-		Hypercube *cube = ts_hypercube_alloc(constraints->num_dimension_constraints);
+		Hypercube *cube = ts_hypercube_alloc(list_length(chunk_slice_ids[chunk_index]));
 		MemoryContextSwitchTo(work_mcxt);
-		for (int constraint_index = 0; constraint_index < constraints->num_constraints;
-			 constraint_index++)
-		{
-			ChunkConstraint *constraint = &constraints->constraints[constraint_index];
-			if (!is_dimension_constraint(constraint))
-			{
-				continue;
-			}
 
-			/*
-			 * Find the slice by id. Don't have to lock it because the chunk is
-			 * locked.
-			 */
-			const int slice_id = constraint->fd.dimension_slice_id;
+		foreach (lc, chunk_slice_ids[chunk_index])
+		{
+			const int32 slice_id = lfirst_int(lc);
+			const int32 *slice_id_ptr =
+				bsearch(&slice_id, slice_ids, num_slices, sizeof(int32), int32_cmp);
 			DimensionSlice *slice_ptr =
-				ts_dimension_slice_scan_iterator_get_by_id(&slice_iterator,
-														   slice_id,
-														   /* tuplock = */ NULL);
+				slice_id_ptr == NULL ? NULL : slices[slice_id_ptr - slice_ids];
 			if (slice_ptr == NULL)
 			{
 				elog(ERROR, "dimension slice %d is not found", slice_id);
@@ -212,7 +320,6 @@ ts_chunk_scan_by_chunk_ids(const Hyperspace *hs, const List *chunk_ids, unsigned
 		ts_hypercube_slice_sort(cube);
 		chunk->cube = cube;
 	}
-	ts_scan_iterator_close(&slice_iterator);
 
 	Assert(CurrentMemoryContext == work_mcxt);
 	MemoryContextSwitchTo(orig_mcxt);
@@ -220,7 +327,7 @@ ts_chunk_scan_by_chunk_ids(const Hyperspace *hs, const List *chunk_ids, unsigned
 
 #ifdef USE_ASSERT_CHECKING
 	/* Assert that we always return valid chunks */
-	for (int i = 0; i < locked_chunk_count; i++)
+	for (i = 0; i < locked_chunk_count; i++)
 	{
 		ASSERT_IS_VALID_CHUNK(locked_chunks[i]);
 	}
@@ -677,3 +677,16 @@ pg_cmp_u32(uint32 a, uint32 b)
 #define i64abs(i) llabs(i)
 #endif
 #endif
+
+/*
+ * The tuple counters of the table statistics entries were renamed in PG16,
+ * e.g., n_live_tuples to live_tuples and changes_since_analyze to
+ * mod_since_analyze.
+ */
+#if PG16_LT
+#define pgstat_tabentry_live_tuples(tabentry) ((tabentry)->n_live_tuples)
+#define pgstat_tabentry_mod_since_analyze(tabentry) ((tabentry)->changes_since_analyze)
+#else
+#define pgstat_tabentry_live_tuples(tabentry) ((tabentry)->live_tuples)
+#define pgstat_tabentry_mod_since_analyze(tabentry) ((tabentry)->mod_since_analyze)
+#endif
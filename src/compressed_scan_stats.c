@@ -0,0 +1,275 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Cumulative statistics of the scans of compressed chunks, summed over all
+ * backends since the server start or the last reset.
+ *
+ * The nodes that scan compressed chunks report their counters when they end,
+ * to the hash table that the loader allocates in shared memory. The custom
+ * statistics kinds of the cumulative statistics system are only available
+ * from PG18, so this works like the function telemetry instead. Without a
+ * loader that allocates the hash table, nothing is counted.
+ */
+#include <postgres.h>
+#include <access/htup_details.h>
+#include <catalog/pg_type.h>
+#include <funcapi.h>
+#include <miscadmin.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+
+#include "compressed_scan_stats.h"
+#include "hypertable.h"
+#include "hypertable_cache.h"
+#include "loader/compressed_scan_stats.h"
+#include "utils.h"
+
+StaticAssertDecl(COMPRESSED_SCAN_STATS_NUM_COUNTERS <= TS_COMPRESSED_SCAN_STATS_NUM_COUNTERS,
+				 "too many compressed scan counters for the shared memory entries");
+
+static CompressedScanStatsRendezvous *scan_stats = NULL;
+
+static void
+compressed_scan_stats_key_init(CompressedScanStatsKey *key, int32 hypertable_id,
+							   const char *column_name)
+{
+	/* The key is compared as a blob, so the padding must be zero as well. */
+	memset(key, 0, sizeof(*key));
+	key->database_id = MyDatabaseId;
+	key->hypertable_id = hypertable_id;
+	if (column_name != NULL)
+		namestrcpy(&key->column_name, column_name);
+}
+
+/*
+ * Add the counters of a scan of the given hypertable, or of one of its
+ * columns if the column name is given. The counters are indexed by the
+ * COMPRESSED_SCAN_STATS_* values.
+ */
+void
+ts_compressed_scan_stats_report(int32 hypertable_id, const char *column_name,
+								const int64 *counters)
+{
+	CompressedScanStatsKey key;
+	CompressedScanStatsEntry *entry;
+	bool any = false;
+	bool found;
+
+	if (scan_stats == NULL)
+		return;
+
+	for (int i = 0; i < COMPRESSED_SCAN_STATS_NUM_COUNTERS; i++)
+		any = any || counters[i] != 0;
+
+	if (!any)
+		return;
+
+	compressed_scan_stats_key_init(&key, hypertable_id, column_name);
+
+	/*
+	 * The entry usually exists, so first try to add the counters under the
+	 * shared lock, the additions are atomic.
+	 */
+	LWLockAcquire(scan_stats->lock, LW_SHARED);
+	entry = hash_search(scan_stats->entries, &key, HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		for (int i = 0; i < COMPRESSED_SCAN_STATS_NUM_COUNTERS; i++)
+			pg_atomic_fetch_add_u64(&entry->counters[i], counters[i]);
+	}
+	LWLockRelease(scan_stats->lock);
+
+	if (entry != NULL)
+		return;
+
+	LWLockAcquire(scan_stats->lock, LW_EXCLUSIVE);
+	entry = hash_search(scan_stats->entries, &key, HASH_ENTER_NULL, &found);
+
+	/* The hash table is full, the statistics of this entry are not kept. */
+	if (entry != NULL)
+	{
+		for (int i = 0; i < TS_COMPRESSED_SCAN_STATS_NUM_COUNTERS; i++)
+		{
+			const int64 value = i < COMPRESSED_SCAN_STATS_NUM_COUNTERS ? counters[i] : 0;
+
+			if (found)
+				pg_atomic_fetch_add_u64(&entry->counters[i], value);
+			else
+				pg_atomic_init_u64(&entry->counters[i], value);
+		}
+	}
+	LWLockRelease(scan_stats->lock);
+}
+
+/*
+ * Return the statistics of the hypertables of the current database and of
+ * their columns. The column name is null for the statistics of a hypertable.
+ */
+TS_FUNCTION_INFO_V1(ts_compressed_scan_stats);
+
+Datum
+ts_compressed_scan_stats(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	CompressedScanStatsKey *keys;
+	int64 *counters;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc tupdesc;
+		HASH_SEQ_STATUS hash_seq;
+		CompressedScanStatsEntry *entry;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		funcctx->max_calls = 0;
+		keys = NULL;
+		counters = NULL;
+
+		/* Copy the entries, so that the lock is not held while returning them */
+		if (scan_stats != NULL)
+		{
+			LWLockAcquire(scan_stats->lock, LW_SHARED);
+
+			const long num_entries = hash_get_num_entries(scan_stats->entries);
+			keys = palloc(sizeof(CompressedScanStatsKey) * Max(num_entries, 1));
+			counters =
+				palloc(sizeof(int64) * COMPRESSED_SCAN_STATS_NUM_COUNTERS * Max(num_entries, 1));
+
+			hash_seq_init(&hash_seq, scan_stats->entries);
+			while ((entry = hash_seq_search(&hash_seq)) != NULL)
+			{
+				if (entry->key.database_id != MyDatabaseId)
+					continue;
+
+				keys[funcctx->max_calls] = entry->key;
+				for (int i = 0; i < COMPRESSED_SCAN_STATS_NUM_COUNTERS; i++)
+				{
+					counters[funcctx->max_calls * COMPRESSED_SCAN_STATS_NUM_COUNTERS + i] =
+						(int64) pg_atomic_read_u64(&entry->counters[i]);
+				}
+				funcctx->max_calls++;
+			}
+
+			LWLockRelease(scan_stats->lock);
+		}
+
+		funcctx->user_fctx = list_make2(keys, counters);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	keys = linitial(funcctx->user_fctx);
+	counters = lsecond(funcctx->user_fctx);
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		const CompressedScanStatsKey *key = &keys[funcctx->call_cntr];
+		const int64 *entry_counters =
+			&counters[funcctx->call_cntr * COMPRESSED_SCAN_STATS_NUM_COUNTERS];
+		Datum params[COMPRESSED_SCAN_STATS_NUM_COUNTERS];
+		Datum values[3];
+		bool nulls[3] = { false };
+
+		Assert(funcctx->tuple_desc->natts == lengthof(values));
+
+		for (int i = 0; i < COMPRESSED_SCAN_STATS_NUM_COUNTERS; i++)
+			params[i] = Int64GetDatum(entry_counters[i]);
+
+		values[0] = Int32GetDatum(key->hypertable_id);
+		values[1] = NameGetDatum(&key->column_name);
+		nulls[1] = NameStr(key->column_name)[0] == '\0';
+		values[2] = PointerGetDatum(construct_array(params,
+													COMPRESSED_SCAN_STATS_NUM_COUNTERS,
+													INT8OID,
+													sizeof(int64),
+													FLOAT8PASSBYVAL,
+													TYPALIGN_DOUBLE));
+
+		HeapTuple tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+/*
+ * Reset the statistics of the given hypertable and its columns, or of all
+ * hypertables of the current database. The owner of a hypertable can reset
+ * its statistics, resetting all of them requires superuser, like
+ * pg_stat_reset().
+ */
+TS_FUNCTION_INFO_V1(ts_compressed_scan_stats_reset);
+
+Datum
+ts_compressed_scan_stats_reset(PG_FUNCTION_ARGS)
+{
+	int32 hypertable_id = INVALID_HYPERTABLE_ID;
+	HASH_SEQ_STATUS hash_seq;
+	CompressedScanStatsEntry *entry;
+
+	if (!PG_ARGISNULL(0))
+	{
+		Cache *hcache;
+		Hypertable *ht =
+			ts_hypertable_cache_get_cache_and_entry(PG_GETARG_OID(0), CACHE_FLAG_NONE, &hcache);
+
+		ts_hypertable_permissions_check(ht->main_table_relid, GetUserId());
+		hypertable_id = ht->fd.id;
+		ts_cache_release(hcache);
+	}
+	else if (!superuser())
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to reset the statistics of all hypertables")));
+	}
+
+	if (scan_stats == NULL)
+		PG_RETURN_VOID();
+
+	LWLockAcquire(scan_stats->lock, LW_EXCLUSIVE);
+	hash_seq_init(&hash_seq, scan_stats->entries);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		if (entry->key.database_id != MyDatabaseId ||
+			(hypertable_id != INVALID_HYPERTABLE_ID && entry->key.hypertable_id != hypertable_id))
+			continue;
+
+		/* Removing the current entry of a sequential scan is allowed. */
+		hash_search(scan_stats->entries, &entry->key, HASH_REMOVE, NULL);
+	}
+	LWLockRelease(scan_stats->lock);
+
+	PG_RETURN_VOID();
+}
+
+void
+_compressed_scan_stats_init(void)
+{
+	CompressedScanStatsRendezvous **rendezvous =
+		(CompressedScanStatsRendezvous **) find_rendezvous_variable(
+			RENDEZVOUS_COMPRESSED_SCAN_STATS);
+
+	/* Is NULL if the loader doesn't allocate the statistics. */
+	scan_stats = *rendezvous;
+}
+
+void
+_compressed_scan_stats_fini(void)
+{
+	scan_stats = NULL;
+}
@@ -0,0 +1,35 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include "export.h"
+
+/*
+ * The cumulative counters of the scans of compressed chunks, shown by
+ * timescaledb_information.compressed_scan_stats. The entries of the columns
+ * only use the decompressed rows.
+ */
+#define COMPRESSED_SCAN_STATS_SCANS 0
+#define COMPRESSED_SCAN_STATS_BATCHES 1
+#define COMPRESSED_SCAN_STATS_BATCHES_FILTERED 2 /* Entirely by the vectorized filters */
+#define COMPRESSED_SCAN_STATS_DECOMPRESSED_ROWS 3
+#define COMPRESSED_SCAN_STATS_ITERATOR_ROWS 4 /* Decompressed row by row */
+#define COMPRESSED_SCAN_STATS_DETOASTED_BYTES 5
+#define COMPRESSED_SCAN_STATS_VECTOR_QUAL_BATCHES 6
+#define COMPRESSED_SCAN_STATS_ROW_QUAL_BATCHES 7
+#define COMPRESSED_SCAN_STATS_VECTOR_AGG_BATCHES 8
+#define COMPRESSED_SCAN_STATS_CACHE_HITS 9
+#define COMPRESSED_SCAN_STATS_CACHE_MISSES 10
+#define COMPRESSED_SCAN_STATS_NUM_COUNTERS 11
+
+extern TSDLLEXPORT void ts_compressed_scan_stats_report(int32 hypertable_id,
+														const char *column_name,
+														const int64 *counters);
+
+extern void _compressed_scan_stats_init(void);
+extern void _compressed_scan_stats_fini(void);
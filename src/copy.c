@@ -18,6 +18,14 @@
  * insert our chunk dispatching. So, most of this code is a straight-up
  * copy of the regular PostgreSQL source code for the COPY command
  * (command/copy.c and command/copyfrom.c), albeit with minor modifications.
+ *
+ * A COPY is parsed, routed, and inserted by a single backend. It can't use
+ * parallel workers, since PostgreSQL does not allow them to insert tuples or
+ * to assign transaction IDs, and creating chunks writes to the catalog. To
+ * load data with several cores, split the input and run several COPY
+ * commands concurrently instead. Each of them routes its tuples with its
+ * own ChunkDispatch, and the concurrent creation of the same chunk is
+ * serialized by the lock on the hypertable taken in ts_chunk_create_for_point().
  */
 
 #include <postgres.h>
@@ -33,8 +41,10 @@
 #include <access/sysattr.h>
 #include <access/xact.h>
 #include <catalog/pg_trigger_d.h>
+#include <catalog/pg_type.h>
 #include <commands/copy.h>
 #include <commands/copyfrom_internal.h>
+#include <commands/progress.h>
 #include <commands/tablecmds.h>
 #include <commands/trigger.h>
 #include <executor/executor.h>
@@ -46,6 +56,8 @@
 #include <parser/parse_collate.h>
 #include <parser/parse_expr.h>
 #include <parser/parse_relation.h>
+#include <pgstat.h>
+#include <port/pg_bswap.h>
 #include <storage/bufmgr.h>
 #include <storage/smgr.h>
 #include <utils/builtins.h>
@@ -55,6 +67,8 @@
 #include <utils/lsyscache.h>
 #include <utils/rel.h>
 #include <utils/rls.h>
+#include <utils/timestamp.h>
+#include <utils/uuid.h>
 
 #include "compat/compat.h"
 #include "copy.h"
@@ -62,25 +76,25 @@
 #include "dimension.h"
 #include "hypertable.h"
 #include "nodes/chunk_dispatch/chunk_dispatch.h"
+#include "nodes/chunk_dispatch/chunk_fk_check.h"
 #include "nodes/chunk_dispatch/chunk_insert_state.h"
 #include "subspace_store.h"
+#include "trace.h"
 
 /*
- * No more than this many tuples per TSCopyMultiInsertBuffer
- *
- * Caution: Don't make this too big, as we could end up with this many
- * TSCopyMultiInsertBuffer items stored in TSCopyMultiInsertInfo's
- * multiInsertBuffers list.  Increasing this can cause quadratic growth in
- * memory requirements during copies into partitioned tables with a large
- * number of partitions.
+ * A TSCopyMultiInsertBuffer starts with room for this many tuples. When it is
+ * full, it doubles its size up to MAX_BUFFERED_TUPLES if the doubled buffer
+ * would still fit the memory budget, or else it is flushed. So the buffers of
+ * the narrow rows grow larger and are flushed less often.
  */
-#define MAX_BUFFERED_TUPLES 1000
+#define MIN_BUFFERED_TUPLES 1000
+#define MAX_BUFFERED_TUPLES 16000
 
 /*
- * Flush buffers if there are >= this many bytes, as counted by the input
- * size, of tuples stored.
+ * Flush the largest buffers if there are >= this many bytes of tuples stored
+ * in all the buffers.
  */
-#define MAX_BUFFERED_BYTES 65535
+#define MAX_BUFFERED_BYTES CHUNK_MULTI_INSERT_MAX_BYTES
 
 /* Trim the list of buffers back down to this number after flushing */
 #define MAX_PARTITION_BUFFERS 32
@@ -94,12 +108,13 @@ typedef struct TSCopyMultiInsertBuffer
 	 * not needed and is wasting a lot of CPU in ResourceOwner.
 	 */
 	TupleDesc tupdesc;
-	TupleTableSlot *slots[MAX_BUFFERED_TUPLES]; /* Array to store tuples */
-	Point *point;								/* The point in space of this buffer */
-	BulkInsertState bistate;					/* BulkInsertState for this buffer */
-	int nused;									/* number of 'slots' containing tuples */
-	uint64 linenos[MAX_BUFFERED_TUPLES];		/* Line # of tuple in copy
-												 * stream */
+	TupleTableSlot **slots;	 /* Array to store tuples */
+	Point *point;			 /* The point in space of this buffer */
+	BulkInsertState bistate; /* BulkInsertState for this buffer */
+	int nused;				 /* number of 'slots' containing tuples */
+	int capacity;			 /* number of entries in 'slots' and 'linenos' */
+	Size nbytes;			 /* number of bytes of the buffered tuples */
+	uint64 *linenos;		 /* Line # of tuple in copy stream */
 } TSCopyMultiInsertBuffer;
 
 /*
@@ -119,7 +134,9 @@ typedef struct TSCopyMultiInsertInfo
 	HTAB *multiInsertBuffers; /* Maps the chunk ids to the buffers (chunkid ->
 								 TSCopyMultiInsertBuffer) */
 	int bufferedTuples;		  /* number of tuples buffered over all buffers */
-	int bufferedBytes;		  /* number of bytes from all buffered tuples */
+	Size bufferedBytes;		  /* number of bytes from all buffered tuples */
+	int64 flushes;			  /* number of buffer flushes */
+	int64 flushedBytes;		  /* number of bytes of the flushed tuples */
 	CopyChunkState *ccstate;  /* Copy chunk state for this TSCopyMultiInsertInfo */
 	EState *estate;			  /* Executor state used for COPY */
 	CommandId mycid;		  /* Command Id used for COPY */
@@ -170,6 +187,7 @@ copy_chunk_state_create(Hypertable *ht, Relation rel, CopyFromFunc from_func, Co
 	ccstate->scandesc = scandesc;
 	ccstate->next_copy_from = from_func;
 	ccstate->where_clause = NULL;
+	ccstate->binary = NULL;
 
 	return ccstate;
 }
@@ -184,9 +202,12 @@ TSCopyMultiInsertBufferInit(ChunkInsertState *cis, Point *point)
 	TSCopyMultiInsertBuffer *buffer;
 
 	buffer = (TSCopyMultiInsertBuffer *) palloc(sizeof(TSCopyMultiInsertBuffer));
-	memset((void *) buffer->slots, 0, sizeof(TupleTableSlot *) * MAX_BUFFERED_TUPLES);
+	buffer->slots = palloc0(sizeof(TupleTableSlot *) * MIN_BUFFERED_TUPLES);
+	buffer->linenos = palloc(sizeof(uint64) * MIN_BUFFERED_TUPLES);
+	buffer->capacity = MIN_BUFFERED_TUPLES;
 	buffer->bistate = GetBulkInsertState();
 	buffer->nused = 0;
+	buffer->nbytes = 0;
 
 	buffer->point = palloc(POINT_SIZE(point->num_coords));
 	memcpy(buffer->point, point, POINT_SIZE(point->num_coords));
@@ -258,6 +279,8 @@ TSCopyMultiInsertInfoInit(TSCopyMultiInsertInfo *miinfo, ResultRelInfo *rri,
 	miinfo->multiInsertBuffers = TSCopyCreateNewInsertBufferHashMap();
 	miinfo->bufferedTuples = 0;
 	miinfo->bufferedBytes = 0;
+	miinfo->flushes = 0;
+	miinfo->flushedBytes = 0;
 	miinfo->ccstate = ccstate;
 	miinfo->estate = estate;
 	miinfo->mycid = mycid;
@@ -266,18 +289,42 @@ TSCopyMultiInsertInfoInit(TSCopyMultiInsertInfo *miinfo, ResultRelInfo *rri,
 }
 
 /*
- * Returns true if the buffers are full.
+ * Returns true if the buffered tuples take the entire memory budget.
  */
 static inline bool
 TSCopyMultiInsertInfoIsFull(TSCopyMultiInsertInfo *miinfo)
 {
-	if (miinfo->bufferedTuples >= MAX_BUFFERED_TUPLES ||
-		miinfo->bufferedBytes >= MAX_BUFFERED_BYTES)
+	if (miinfo->bufferedBytes >= MAX_BUFFERED_BYTES)
 		return true;
 
 	return false;
 }
 
+/*
+ * Double the size of a full buffer, if the tuples would still fit the memory
+ * budget after filling it up with tuples of the same size.
+ *
+ * Returns false if the buffer could not grow and has to be flushed.
+ */
+static bool
+TSCopyMultiInsertBufferGrow(TSCopyMultiInsertInfo *miinfo, TSCopyMultiInsertBuffer *buffer)
+{
+	Assert(buffer->nused == buffer->capacity);
+
+	if (buffer->capacity * 2 > MAX_BUFFERED_TUPLES ||
+		miinfo->bufferedBytes + buffer->nbytes > MAX_BUFFERED_BYTES)
+		return false;
+
+	buffer->slots = repalloc(buffer->slots, sizeof(TupleTableSlot *) * buffer->capacity * 2);
+	memset((void *) &buffer->slots[buffer->capacity],
+		   0,
+		   sizeof(TupleTableSlot *) * buffer->capacity);
+	buffer->linenos = repalloc(buffer->linenos, sizeof(uint64) * buffer->capacity * 2);
+	buffer->capacity *= 2;
+
+	return true;
+}
+
 /*
  * Write the tuples stored in 'buffer' out to the table.
  */
@@ -296,6 +343,16 @@ TSCopyMultiInsertBufferFlush(TSCopyMultiInsertInfo *miinfo, TSCopyMultiInsertBuf
 	int nused = buffer->nused;
 	TupleTableSlot **slots = buffer->slots;
 
+	/* Account for the flushed tuples, the buffer is empty when we return */
+	miinfo->bufferedTuples -= nused;
+	miinfo->bufferedBytes -= buffer->nbytes;
+	if (nused > 0)
+	{
+		miinfo->flushes++;
+		miinfo->flushedBytes += buffer->nbytes;
+	}
+	buffer->nbytes = 0;
+
 	/*
 	 * table_multi_insert and reinitialization of the chunk insert state may
 	 * leak memory, so switch to short-lived memory context before calling it.
@@ -320,6 +377,8 @@ TSCopyMultiInsertBufferFlush(TSCopyMultiInsertInfo *miinfo, TSCopyMultiInsertBuf
 
 	ResultRelInfo *resultRelInfo = cis->result_relation_info;
 
+	TIMESCALEDB_COPY_FLUSH_START(cis->chunk_id, nused);
+
 	/*
 	 * Add context information to the copy state, which is used to display
 	 * error messages with additional details.
@@ -337,12 +396,48 @@ TSCopyMultiInsertBufferFlush(TSCopyMultiInsertInfo *miinfo, TSCopyMultiInsertBuf
 		cstate->line_buf_valid = false;
 	}
 
+	/*
+	 * The rows that are compressed directly into the compressed chunk do not
+	 * have index entries or AFTER ROW triggers on the chunk.
+	 */
+	if (cis->direct_compress != NULL)
+	{
+		for (i = 0; i < nused; i++)
+		{
+			ts_cm_functions->direct_compress_insert(cis->direct_compress, slots[i]);
+			ExecClearTuple(slots[i]);
+		}
+
+		MemoryContextSwitchTo(oldcontext);
+		buffer->nused = 0;
+
+		if (cstate != NULL)
+		{
+			cstate->line_buf_valid = line_buf_valid;
+			cstate->cur_lineno = save_cur_lineno;
+		}
+
+		TIMESCALEDB_COPY_FLUSH_DONE(cis->chunk_id, nused);
+		return cis->chunk_id;
+	}
+
+	/* Check the foreign keys that the chunk has no triggers for */
+	if (cis->fk_check != NULL)
+		ts_chunk_fk_check_rows(cis->fk_check, slots, nused);
+
 	table_multi_insert(resultRelInfo->ri_RelationDesc,
 					   slots,
 					   nused,
 					   mycid,
 					   ti_options,
 					   buffer->bistate);
+
+	/* Record the invalidations that the chunk has no trigger for */
+	if (cis->cagg_hypertable_id > 0)
+		ts_cm_functions->continuous_agg_invalidate_slots(cis->cagg_hypertable_id,
+														 resultRelInfo->ri_RelationDesc,
+														 slots,
+														 nused);
 	MemoryContextSwitchTo(oldcontext);
 
 	for (i = 0; i < nused; i++)
@@ -410,6 +505,7 @@ TSCopyMultiInsertBufferFlush(TSCopyMultiInsertInfo *miinfo, TSCopyMultiInsertBuf
 		cstate->cur_lineno = save_cur_lineno;
 	}
 
+	TIMESCALEDB_COPY_FLUSH_DONE(cis->chunk_id, nused);
 	return cis->chunk_id;
 }
 
@@ -429,9 +525,11 @@ TSCopyMultiInsertBufferCleanup(TSCopyMultiInsertInfo *miinfo, TSCopyMultiInsertB
 	FreeBulkInsertState(buffer->bistate);
 
 	/* Since we only create slots on demand, just drop the non-null ones. */
-	for (i = 0; i < MAX_BUFFERED_TUPLES && buffer->slots[i] != NULL; i++)
+	for (i = 0; i < buffer->capacity && buffer->slots[i] != NULL; i++)
 		ExecDropSingleTupleTableSlot(buffer->slots[i]);
 
+	pfree(buffer->slots);
+	pfree(buffer->linenos);
 	pfree(buffer->point);
 	FreeTupleDesc(buffer->tupdesc);
 	pfree(buffer);
@@ -517,8 +615,90 @@ TSCopyMultiInsertInfoFlush(TSCopyMultiInsertInfo *miinfo, ChunkInsertState *cur_
 	list_free(buffer_list);
 
 	/* All buffers have been flushed */
-	miinfo->bufferedTuples = 0;
-	miinfo->bufferedBytes = 0;
+	Assert(miinfo->bufferedTuples == 0);
+	Assert(miinfo->bufferedBytes == 0);
+}
+
+/* list_sort comparator to sort MultiInsertBufferEntry by buffered bytes, largest first */
+static int
+TSCmpBuffersBySize(const ListCell *a, const ListCell *b)
+{
+	Size b1 = ((const MultiInsertBufferEntry *) lfirst(a))->buffer->nbytes;
+	Size b2 = ((const MultiInsertBufferEntry *) lfirst(b))->buffer->nbytes;
+
+	if (b1 > b2)
+		return -1;
+
+	if (b1 == b2)
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Flush the largest buffers until the buffered tuples take at most half of
+ * the memory budget. In addition, trim down the amount of multi-insert
+ * buffers to MAX_PARTITION_BUFFERS by deleting empty buffers.
+ *
+ * Flushing the largest buffers first frees the most memory with the fewest
+ * (and largest) multi-inserts, while the buffers of the chunks that get few
+ * tuples can keep collecting them.
+ */
+static void
+TSCopyMultiInsertInfoFlushLargest(TSCopyMultiInsertInfo *miinfo, ChunkInsertState *cur_cis)
+{
+	HASH_SEQ_STATUS status;
+	MultiInsertBufferEntry *entry;
+	List *entry_list = NIL;
+	ListCell *lc;
+	int buffers_to_delete =
+		Max(hash_get_num_entries(miinfo->multiInsertBuffers) - MAX_PARTITION_BUFFERS, 0);
+
+	hash_seq_init(&status, miinfo->multiInsertBuffers);
+	for (entry = hash_seq_search(&status); entry != NULL; entry = hash_seq_search(&status))
+	{
+		entry_list = lappend(entry_list, entry);
+	}
+
+	list_sort(entry_list, TSCmpBuffersBySize);
+
+	/* Flush the largest buffers */
+	foreach (lc, entry_list)
+	{
+		entry = (MultiInsertBufferEntry *) lfirst(lc);
+
+		if (miinfo->bufferedBytes <= MAX_BUFFERED_BYTES / 2)
+			break;
+
+		if (entry->buffer->nused > 0)
+			TSCopyMultiInsertBufferFlush(miinfo, entry->buffer);
+	}
+
+	/*
+	 * Delete the empty buffers. However, the current used buffer should not
+	 * be deleted because it might be reused for the next insert.
+	 */
+	foreach (lc, entry_list)
+	{
+		int32 chunk_id;
+		bool found;
+
+		if (buffers_to_delete == 0)
+			break;
+
+		entry = (MultiInsertBufferEntry *) lfirst(lc);
+		chunk_id = entry->key;
+
+		if (entry->buffer->nused > 0 || (cur_cis != NULL && chunk_id == cur_cis->chunk_id))
+			continue;
+
+		TSCopyMultiInsertBufferCleanup(miinfo, entry->buffer);
+		hash_search(miinfo->multiInsertBuffers, &chunk_id, HASH_REMOVE, &found);
+		Assert(found);
+		buffers_to_delete--;
+	}
+
+	list_free(entry_list);
 }
 
 /*
@@ -561,7 +741,7 @@ TSCopyMultiInsertInfoNextFreeSlot(TSCopyMultiInsertInfo *miinfo,
 	int nused = buffer->nused;
 
 	Assert(buffer != NULL);
-	Assert(nused < MAX_BUFFERED_TUPLES);
+	Assert(nused < buffer->capacity);
 
 	if (buffer->slots[nused] == NULL)
 	{
@@ -597,19 +777,15 @@ TSCopyMultiInsertInfoStore(TSCopyMultiInsertInfo *miinfo, ResultRelInfo *rri,
 	/* Record this slot as being used */
 	buffer->nused++;
 
-	/* Update how many tuples are stored and their size */
-	miinfo->bufferedTuples++;
-
 	/*
-	 * Note: There is no reliable way to determine the in-memory size of a virtual
-	 * tuple. So, we perform flushing in PG < 14 only based on the number of buffered
-	 * tuples and not based on the size.
+	 * Update how many tuples are stored and their size. The slot is
+	 * materialized, so this is the in-memory size of the tuple, also for the
+	 * binary format and when migrating data from a table.
 	 */
-	if (cstate != NULL)
-	{
-		int tuplen = cstate->line_buf.len;
-		miinfo->bufferedBytes += tuplen;
-	}
+	const Size tuplen = ts_chunk_multi_insert_tuple_size(slot);
+	buffer->nbytes += tuplen;
+	miinfo->bufferedTuples++;
+	miinfo->bufferedBytes += tuplen;
 }
 
 static void
@@ -626,6 +802,228 @@ next_copy_from(CopyChunkState *ccstate, ExprContext *econtext, Datum *values, bo
 	return NextCopyFrom(ccstate->cstate, econtext, values, nulls);
 }
 
+/*
+ * Fast path for the binary format.
+ *
+ * NextCopyFrom() calls the receive function of the column type for every
+ * value. For the common fixed-width types, we decode the values directly from
+ * the raw input buffer of the COPY state into the slot instead. We only do
+ * this when the entire row is in the input buffer and every value has the
+ * expected length. Otherwise, NextCopyFrom() reads the row, which also takes
+ * care of loading the input buffer, the end-of-data marker and reporting the
+ * errors.
+ */
+struct CopyBinaryState
+{
+	int natts;		 /* Number of attributes of the relation */
+	int nfields;	 /* Number of fields in every row */
+	int *attoffs;	 /* Attribute offsets in field order */
+	Oid *typids;	 /* Types of the fields */
+	pg_uuid_t *uuids; /* Storage of the uuid values of the current row */
+};
+
+static bool
+copy_binary_type_supported(Form_pg_attribute att)
+{
+	switch (att->atttypid)
+	{
+		case BOOLOID:
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case UUIDOID:
+			return true;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			/* The receive function rounds the values to the precision */
+			return att->atttypmod < 0;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Create the state for the binary fast path, if all the columns have
+ * supported types and no default values have to be computed.
+ */
+static CopyBinaryState *
+copy_binary_state_create(CopyFromState cstate, Relation rel)
+{
+	TupleDesc tupdesc = RelationGetDescr(rel);
+	ListCell *lc;
+	int i = 0;
+
+	if (!cstate->opts.binary || cstate->num_defaults > 0)
+		return NULL;
+
+	foreach (lc, cstate->attnumlist)
+	{
+		if (!copy_binary_type_supported(TupleDescAttr(tupdesc, lfirst_int(lc) - 1)))
+			return NULL;
+	}
+
+	CopyBinaryState *binary = palloc(sizeof(CopyBinaryState));
+	binary->natts = tupdesc->natts;
+	binary->nfields = list_length(cstate->attnumlist);
+	binary->attoffs = palloc(sizeof(int) * binary->nfields);
+	binary->typids = palloc(sizeof(Oid) * binary->nfields);
+	binary->uuids = palloc(sizeof(pg_uuid_t) * binary->nfields);
+
+	foreach (lc, cstate->attnumlist)
+	{
+		const AttrNumber attnum = lfirst_int(lc);
+
+		binary->attoffs[i] = AttrNumberGetAttrOffset(attnum);
+		binary->typids[i] = TupleDescAttr(tupdesc, AttrNumberGetAttrOffset(attnum))->atttypid;
+		i++;
+	}
+
+	return binary;
+}
+
+static inline uint16
+copy_binary_get_uint16(const char *data)
+{
+	uint16 value;
+	memcpy(&value, data, sizeof(value));
+	return pg_ntoh16(value);
+}
+
+static inline uint32
+copy_binary_get_uint32(const char *data)
+{
+	uint32 value;
+	memcpy(&value, data, sizeof(value));
+	return pg_ntoh32(value);
+}
+
+static inline uint64
+copy_binary_get_uint64(const char *data)
+{
+	uint64 value;
+	memcpy(&value, data, sizeof(value));
+	return pg_ntoh64(value);
+}
+
+/*
+ * Decode a non-null value in the same way as the receive function of the
+ * type. Returns false if the value should be left to the receive function,
+ * e.g., to report an error.
+ */
+static inline bool
+copy_binary_decode(CopyBinaryState *binary, int field, const char *data, int32 len, Datum *value)
+{
+	switch (binary->typids[field])
+	{
+		case BOOLOID:
+			if (len != 1)
+				return false;
+			*value = BoolGetDatum(*data != 0);
+			return true;
+		case INT2OID:
+			if (len != sizeof(int16))
+				return false;
+			*value = Int16GetDatum((int16) copy_binary_get_uint16(data));
+			return true;
+		case INT4OID:
+			if (len != sizeof(int32))
+				return false;
+			*value = Int32GetDatum((int32) copy_binary_get_uint32(data));
+			return true;
+		case INT8OID:
+			if (len != sizeof(int64))
+				return false;
+			*value = Int64GetDatum((int64) copy_binary_get_uint64(data));
+			return true;
+		case FLOAT4OID:
+		{
+			if (len != sizeof(float4))
+				return false;
+			const uint32 bits = copy_binary_get_uint32(data);
+			float4 f;
+			memcpy(&f, &bits, sizeof(f));
+			*value = Float4GetDatum(f);
+			return true;
+		}
+		case FLOAT8OID:
+		{
+			if (len != sizeof(float8))
+				return false;
+			const uint64 bits = copy_binary_get_uint64(data);
+			float8 f;
+			memcpy(&f, &bits, sizeof(f));
+			*value = Float8GetDatum(f);
+			return true;
+		}
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		{
+			if (len != sizeof(Timestamp))
+				return false;
+			const Timestamp ts = (Timestamp) copy_binary_get_uint64(data);
+			if (!TIMESTAMP_NOT_FINITE(ts) && !IS_VALID_TIMESTAMP(ts))
+				return false;
+			*value = TimestampGetDatum(ts);
+			return true;
+		}
+		case UUIDOID:
+			if (len != UUID_LEN)
+				return false;
+			memcpy(binary->uuids[field].data, data, UUID_LEN);
+			*value = UUIDPGetDatum(&binary->uuids[field]);
+			return true;
+		default:
+			return false;
+	}
+}
+
+static bool
+next_copy_from_binary(CopyChunkState *ccstate, ExprContext *econtext, Datum *values, bool *nulls)
+{
+	CopyFromState cstate = ccstate->cstate;
+	CopyBinaryState *binary = ccstate->binary;
+	const char *data = cstate->raw_buf + cstate->raw_buf_index;
+	const char *end = cstate->raw_buf + cstate->raw_buf_len;
+
+	Assert(binary != NULL);
+
+	/* The end-of-data marker has a field count of -1, so it is left to NextCopyFrom() */
+	if (end - data < (int) sizeof(int16) ||
+		(int16) copy_binary_get_uint16(data) != binary->nfields)
+		return NextCopyFrom(cstate, econtext, values, nulls);
+	data += sizeof(int16);
+
+	memset(values, 0, sizeof(Datum) * binary->natts);
+	memset(nulls, true, sizeof(bool) * binary->natts);
+
+	for (int i = 0; i < binary->nfields; i++)
+	{
+		if (end - data < (int) sizeof(int32))
+			return NextCopyFrom(cstate, econtext, values, nulls);
+
+		const int32 len = (int32) copy_binary_get_uint32(data);
+		data += sizeof(int32);
+
+		/* Null values have length -1. These are base types, so no domain checks are needed. */
+		if (len == -1)
+			continue;
+
+		if (len < 0 || end - data < len ||
+			!copy_binary_decode(binary, i, data, len, &values[binary->attoffs[i]]))
+			return NextCopyFrom(cstate, econtext, values, nulls);
+
+		nulls[binary->attoffs[i]] = false;
+		data += len;
+	}
+
+	cstate->raw_buf_index = data - cstate->raw_buf;
+	cstate->cur_lineno++;
+
+	return true;
+}
+
 /*
  * Error context callback when copying from table to chunk.
  */
@@ -696,6 +1094,7 @@ copyfrom(CopyChunkState *ccstate, ParseState *pstate, Hypertable *ht, MemoryCont
 	int ti_options = 0;							   /* start with default options for insert */
 	BulkInsertState bistate = NULL;
 	uint64 processed = 0;
+	uint64 excluded = 0;
 	bool has_before_insert_row_trig;
 	bool has_instead_insert_row_trig;
 	bool has_after_insert_statement_trig;
@@ -877,6 +1276,7 @@ copyfrom(CopyChunkState *ccstate, ParseState *pstate, Hypertable *ht, MemoryCont
 	else
 	{
 		insertMethod = CIM_MULTI_CONDITIONAL;
+		dispatch->copy_multi_insert = true;
 		ereport(DEBUG1,
 				(errmsg("Using optimized multi-buffer copy operation (CIM_MULTI_CONDITIONAL).")));
 		TSCopyMultiInsertInfoInit(&multiInsertInfo,
@@ -999,7 +1399,11 @@ copyfrom(CopyChunkState *ccstate, ParseState *pstate, Hypertable *ht, MemoryCont
 		{
 			econtext->ecxt_scantuple = myslot;
 			if (!ExecQual(qualexpr, econtext))
+			{
+				if (ccstate->cstate)
+					pgstat_progress_update_param(PROGRESS_COPY_TUPLES_EXCLUDED, ++excluded);
 				continue;
+			}
 		}
 
 		/*
@@ -1043,7 +1447,12 @@ copyfrom(CopyChunkState *ccstate, ParseState *pstate, Hypertable *ht, MemoryCont
 				ExecConstraints(resultRelInfo, myslot, estate);
 			}
 
-			if (currentTupleInsertMethod == CIM_SINGLE)
+			if (currentTupleInsertMethod == CIM_SINGLE && cis->direct_compress != NULL)
+			{
+				/* Buffer the tuple to be compressed into the compressed chunk */
+				ts_cm_functions->direct_compress_insert(cis->direct_compress, myslot);
+			}
+			else if (currentTupleInsertMethod == CIM_SINGLE)
 			{
 				/* OK, store the tuple and create index entries for it */
 				table_tuple_insert(resultRelInfo->ri_RelationDesc,
@@ -1087,17 +1496,25 @@ copyfrom(CopyChunkState *ccstate, ParseState *pstate, Hypertable *ht, MemoryCont
 										   ccstate->cstate);
 
 				/*
-				 * If enough inserts have queued up, then flush all
-				 * buffers out to their tables.
+				 * If the buffer of the chunk is full, make room for more
+				 * tuples, or flush it out to its table.
+				 */
+				if (buffer->nused == buffer->capacity &&
+					!TSCopyMultiInsertBufferGrow(&multiInsertInfo, buffer))
+					TSCopyMultiInsertBufferFlush(&multiInsertInfo, buffer);
+
+				/*
+				 * If the buffered tuples take too much memory, then flush
+				 * the largest buffers out to their tables.
 				 */
 				if (TSCopyMultiInsertInfoIsFull(&multiInsertInfo))
 				{
 					ereport(DEBUG2,
-							(errmsg("flush called with %d bytes and %d buffered tuples",
+							(errmsg("flush called with %zu bytes and %d buffered tuples",
 									multiInsertInfo.bufferedBytes,
 									multiInsertInfo.bufferedTuples)));
 
-					TSCopyMultiInsertInfoFlush(&multiInsertInfo, cis);
+					TSCopyMultiInsertInfoFlushLargest(&multiInsertInfo, cis);
 				}
 			}
 
@@ -1109,6 +1526,9 @@ copyfrom(CopyChunkState *ccstate, ParseState *pstate, Hypertable *ht, MemoryCont
 			 * tuples inserted by an INSERT command.
 			 */
 			processed++;
+
+			if (ccstate->cstate)
+				pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED, processed);
 		}
 
 		resultRelInfo = saved_resultRelInfo;
@@ -1116,8 +1536,18 @@ copyfrom(CopyChunkState *ccstate, ParseState *pstate, Hypertable *ht, MemoryCont
 
 	/* Flush any remaining buffered tuples */
 	if (insertMethod != CIM_SINGLE)
+	{
 		TSCopyMultiInsertInfoFlushAndCleanup(&multiInsertInfo);
 
+		ereport(DEBUG2,
+				(errmsg("flushed multi-insert buffers %lld times with %lld bytes",
+						(long long) multiInsertInfo.flushes,
+						(long long) multiInsertInfo.flushedBytes)));
+	}
+
+	/* Compress the rows buffered for direct compression */
+	ts_chunk_dispatch_flush_direct_compress(dispatch);
+
 	/* Done, clean up */
 	if (ccstate->cstate && callback)
 		error_context_stack = errcallback.previous;
@@ -1366,8 +1796,15 @@ timescaledb_DoCopy(const CopyStmt *stmt, const char *queryString, uint64 *proces
 		where_clause = (Node *) make_ands_implicit((Expr *) where_clause);
 	}
 
-	ccstate = copy_chunk_state_create(ht, rel, next_copy_from, cstate, NULL);
+	CopyBinaryState *binary = copy_binary_state_create(cstate, rel);
+
+	ccstate = copy_chunk_state_create(ht,
+									  rel,
+									  binary != NULL ? next_copy_from_binary : next_copy_from,
+									  cstate,
+									  NULL);
 	ccstate->where_clause = where_clause;
+	ccstate->binary = binary;
 	copycontext = cstate->copycontext;
 	*processed = copyfrom(ccstate, pstate, ht, copycontext, CopyFromErrorCallback, cstate);
 
@@ -14,6 +14,7 @@
 #include <storage/lockdefs.h>
 
 typedef struct ChunkDispatch ChunkDispatch;
+typedef struct CopyBinaryState CopyBinaryState;
 typedef struct CopyChunkState CopyChunkState;
 typedef struct Hypertable Hypertable;
 
@@ -29,6 +30,8 @@ typedef struct CopyChunkState
 	CopyFromState cstate;
 	TableScanDesc scandesc;
 	Node *where_clause;
+	/* Decoding state for the binary format without receive functions, if possible */
+	CopyBinaryState *binary;
 } CopyChunkState;
 
 extern void timescaledb_DoCopy(const CopyStmt *stmt, const char *queryString, uint64 *processed,
@@ -5,6 +5,7 @@
  */
 #include <postgres.h>
 #include <access/amapi.h>
+#include <access/nbtree.h>
 #include <fmgr.h>
 #include <utils/lsyscache.h>
 #include <utils/timestamp.h>
@@ -15,10 +16,16 @@
 #include "guc.h"
 #include "license_guc.h"
 
+/*
+ * The wrappers make sure that the TSL module is loaded, since the functions
+ * can be called without planning a query first, e.g., triggers in logical
+ * replication workers.
+ */
 #define CROSSMODULE_WRAPPER(func)                                                                  \
 	TS_FUNCTION_INFO_V1(ts_##func);                                                                \
 	Datum ts_##func(PG_FUNCTION_ARGS)                                           \
 	{                                                                                              \
+		ts_license_enable_module_loading();                                                        \
 		PG_RETURN_DATUM(ts_cm_functions->func(fcinfo));                                            \
 	}
 
@@ -27,6 +34,7 @@ CROSSMODULE_WRAPPER(policy_compression_add);
 CROSSMODULE_WRAPPER(policy_compression_remove);
 CROSSMODULE_WRAPPER(policy_recompression_proc);
 CROSSMODULE_WRAPPER(policy_compression_check);
+CROSSMODULE_WRAPPER(policy_compression_execute_parallel);
 CROSSMODULE_WRAPPER(policy_refresh_cagg_add);
 CROSSMODULE_WRAPPER(policy_refresh_cagg_proc);
 CROSSMODULE_WRAPPER(policy_refresh_cagg_check);
@@ -39,6 +47,16 @@ CROSSMODULE_WRAPPER(policy_retention_add);
 CROSSMODULE_WRAPPER(policy_retention_proc);
 CROSSMODULE_WRAPPER(policy_retention_check);
 CROSSMODULE_WRAPPER(policy_retention_remove);
+CROSSMODULE_WRAPPER(policy_retention_batch_proc);
+CROSSMODULE_WRAPPER(policy_retention_batch_check);
+CROSSMODULE_WRAPPER(policy_precreate_chunks_add);
+CROSSMODULE_WRAPPER(policy_precreate_chunks_proc);
+CROSSMODULE_WRAPPER(policy_precreate_chunks_check);
+CROSSMODULE_WRAPPER(policy_precreate_chunks_remove);
+CROSSMODULE_WRAPPER(policy_merge_chunks_add);
+CROSSMODULE_WRAPPER(policy_merge_chunks_proc);
+CROSSMODULE_WRAPPER(policy_merge_chunks_check);
+CROSSMODULE_WRAPPER(policy_merge_chunks_remove);
 
 CROSSMODULE_WRAPPER(job_add);
 CROSSMODULE_WRAPPER(job_delete);
@@ -69,6 +87,21 @@ CROSSMODULE_WRAPPER(compressed_data_in);
 CROSSMODULE_WRAPPER(compressed_data_out);
 CROSSMODULE_WRAPPER(compressed_data_info);
 CROSSMODULE_WRAPPER(compressed_data_has_nulls);
+CROSSMODULE_WRAPPER(bloom1_contains);
+CROSSMODULE_WRAPPER(compressed_column_stats);
+CROSSMODULE_WRAPPER(calibrate_decompression_cost);
+CROSSMODULE_WRAPPER(hll_sfunc);
+CROSSMODULE_WRAPPER(hll_combinefunc);
+CROSSMODULE_WRAPPER(hll_serializefunc);
+CROSSMODULE_WRAPPER(hll_deserializefunc);
+CROSSMODULE_WRAPPER(hll_finalfunc);
+CROSSMODULE_WRAPPER(ddsketch_sfunc);
+CROSSMODULE_WRAPPER(ddsketch_rollup_sfunc);
+CROSSMODULE_WRAPPER(ddsketch_combinefunc);
+CROSSMODULE_WRAPPER(ddsketch_serializefunc);
+CROSSMODULE_WRAPPER(ddsketch_deserializefunc);
+CROSSMODULE_WRAPPER(ddsketch_finalfunc);
+CROSSMODULE_WRAPPER(approx_quantile);
 CROSSMODULE_WRAPPER(deltadelta_compressor_append);
 CROSSMODULE_WRAPPER(deltadelta_compressor_finish);
 CROSSMODULE_WRAPPER(gorilla_compressor_append);
@@ -82,8 +115,11 @@ CROSSMODULE_WRAPPER(bool_compressor_finish);
 CROSSMODULE_WRAPPER(create_compressed_chunk);
 CROSSMODULE_WRAPPER(compress_chunk);
 CROSSMODULE_WRAPPER(decompress_chunk);
+CROSSMODULE_WRAPPER(export_arrow_ipc);
+CROSSMODULE_WRAPPER(compress_chunk_slice);
 CROSSMODULE_WRAPPER(hypercore_handler);
 CROSSMODULE_WRAPPER(hypercore_proxy_handler);
+CROSSMODULE_WRAPPER(hypercore_sparse_handler);
 
 /* continuous aggregate */
 CROSSMODULE_WRAPPER(continuous_agg_invalidation_trigger);
@@ -92,6 +128,7 @@ CROSSMODULE_WRAPPER(continuous_agg_validate_query);
 CROSSMODULE_WRAPPER(continuous_agg_get_bucket_function);
 CROSSMODULE_WRAPPER(continuous_agg_get_bucket_function_info);
 CROSSMODULE_WRAPPER(continuous_agg_migrate_to_time_bucket);
+CROSSMODULE_WRAPPER(continuous_agg_compact_invalidation_log);
 CROSSMODULE_WRAPPER(cagg_try_repair);
 
 CROSSMODULE_WRAPPER(chunk_freeze_chunk);
@@ -105,6 +142,7 @@ CROSSMODULE_WRAPPER(merge_chunks);
 
 /* hypercore */
 CROSSMODULE_WRAPPER(is_compressed_tid);
+CROSSMODULE_WRAPPER(hypercore_arrow_cache_stats);
 
 /*
  * casting a function pointer to a pointer of another type is undefined
@@ -154,6 +192,25 @@ process_hypercore_proxy_handler(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(amroutine);
 }
 
+static Datum
+process_hypercore_sparse_handler(PG_FUNCTION_ARGS)
+{
+	ts_license_enable_module_loading();
+
+	if (ts_cm_functions->hypercore_sparse_handler != process_hypercore_sparse_handler)
+		return ts_cm_functions->hypercore_sparse_handler(fcinfo);
+
+	IndexAmRoutine *amroutine = makeNode(IndexAmRoutine);
+
+	/* The operator classes are btree operator classes */
+	amroutine->amstrategies = BTMaxStrategyNumber;
+	amroutine->amsupport = BTNProcs;
+	amroutine->amoptsprocnum = BTOPTIONS_PROC;
+	amroutine->amoptions = error_hypercore_proxy_index_options;
+
+	PG_RETURN_POINTER(amroutine);
+}
+
 static bool
 error_no_default_fn_bool_void_community(void)
 {
@@ -168,6 +225,13 @@ job_execute_default_fn(BgwJob *job)
 	pg_unreachable();
 }
 
+static void
+bgw_job_helper_main_default_fn(int32 job_id, dsm_handle handle)
+{
+	error_no_default_fn_community();
+	pg_unreachable();
+}
+
 static void
 tsl_postprocess_plan_stub(PlannedStmt *stmt)
 {
@@ -301,6 +365,14 @@ continuous_agg_invalidate_mat_ht_all_default(const Hypertable *raw_ht, const Hyp
 	pg_unreachable();
 }
 
+static void
+continuous_agg_invalidate_slots_default(int32 hypertable_id, Relation chunk_rel,
+										TupleTableSlot **slots, int nslots)
+{
+	error_no_default_fn_community();
+	pg_unreachable();
+}
+
 static void
 continuous_agg_call_invalidation_trigger_default(int32 hypertable_id, Relation chunk_rel,
 												 HeapTuple chunk_tuple, HeapTuple chunk_newtuple,
@@ -354,6 +426,7 @@ TSDLLEXPORT CrossModuleFunctions ts_cm_functions_default = {
 	.policy_compression_remove = error_no_default_fn_pg_community,
 	.policy_recompression_proc = error_no_default_fn_pg_community,
 	.policy_compression_check = error_no_default_fn_pg_community,
+	.policy_compression_execute_parallel = error_no_default_fn_pg_community,
 	.policy_refresh_cagg_add = error_no_default_fn_pg_community,
 	.policy_refresh_cagg_proc = error_no_default_fn_pg_community,
 	.policy_refresh_cagg_check = error_no_default_fn_pg_community,
@@ -366,6 +439,16 @@ TSDLLEXPORT CrossModuleFunctions ts_cm_functions_default = {
 	.policy_retention_proc = error_no_default_fn_pg_community,
 	.policy_retention_check = error_no_default_fn_pg_community,
 	.policy_retention_remove = error_no_default_fn_pg_community,
+	.policy_retention_batch_proc = error_no_default_fn_pg_community,
+	.policy_retention_batch_check = error_no_default_fn_pg_community,
+	.policy_precreate_chunks_add = error_no_default_fn_pg_community,
+	.policy_precreate_chunks_proc = error_no_default_fn_pg_community,
+	.policy_precreate_chunks_check = error_no_default_fn_pg_community,
+	.policy_precreate_chunks_remove = error_no_default_fn_pg_community,
+	.policy_merge_chunks_add = error_no_default_fn_pg_community,
+	.policy_merge_chunks_proc = error_no_default_fn_pg_community,
+	.policy_merge_chunks_check = error_no_default_fn_pg_community,
+	.policy_merge_chunks_remove = error_no_default_fn_pg_community,
 
 	.job_add = error_no_default_fn_pg_community,
 	.job_alter = error_no_default_fn_pg_community,
@@ -373,6 +456,7 @@ TSDLLEXPORT CrossModuleFunctions ts_cm_functions_default = {
 	.job_delete = error_no_default_fn_pg_community,
 	.job_run = error_no_default_fn_pg_community,
 	.job_execute = job_execute_default_fn,
+	.bgw_job_helper_main = bgw_job_helper_main_default_fn,
 
 	.reorder_chunk = error_no_default_fn_pg_community,
 	.move_chunk = error_no_default_fn_pg_community,
@@ -393,12 +477,14 @@ TSDLLEXPORT CrossModuleFunctions ts_cm_functions_default = {
 	.continuous_agg_call_invalidation_trigger = continuous_agg_call_invalidation_trigger_default,
 	.continuous_agg_refresh = error_no_default_fn_pg_community,
 	.continuous_agg_invalidate_raw_ht = continuous_agg_invalidate_raw_ht_all_default,
+	.continuous_agg_invalidate_slots = continuous_agg_invalidate_slots_default,
 	.continuous_agg_invalidate_mat_ht = continuous_agg_invalidate_mat_ht_all_default,
 	.continuous_agg_update_options = continuous_agg_update_options_default,
 	.continuous_agg_validate_query = error_no_default_fn_pg_community,
 	.continuous_agg_get_bucket_function = error_no_default_fn_pg_community,
 	.continuous_agg_get_bucket_function_info = error_no_default_fn_pg_community,
 	.continuous_agg_migrate_to_time_bucket = error_no_default_fn_pg_community,
+	.continuous_agg_compact_invalidation_log = error_no_default_fn_pg_community,
 	.cagg_try_repair = process_cagg_try_repair,
 
 	/* compression */
@@ -406,10 +492,27 @@ TSDLLEXPORT CrossModuleFunctions ts_cm_functions_default = {
 	.compressed_data_recv = error_no_default_fn_pg_community,
 	.compressed_data_in = process_compressed_data_in,
 	.compressed_data_out = process_compressed_data_out,
+	.bloom1_contains = error_no_default_fn_pg_community,
+	.compressed_column_stats = error_no_default_fn_pg_community,
+	.calibrate_decompression_cost = error_no_default_fn_pg_community,
+	.hll_sfunc = error_no_default_fn_pg_community,
+	.hll_combinefunc = error_no_default_fn_pg_community,
+	.hll_serializefunc = error_no_default_fn_pg_community,
+	.hll_deserializefunc = error_no_default_fn_pg_community,
+	.hll_finalfunc = error_no_default_fn_pg_community,
+	.ddsketch_sfunc = error_no_default_fn_pg_community,
+	.ddsketch_rollup_sfunc = error_no_default_fn_pg_community,
+	.ddsketch_combinefunc = error_no_default_fn_pg_community,
+	.ddsketch_serializefunc = error_no_default_fn_pg_community,
+	.ddsketch_deserializefunc = error_no_default_fn_pg_community,
+	.ddsketch_finalfunc = error_no_default_fn_pg_community,
+	.approx_quantile = error_no_default_fn_pg_community,
 	.process_compress_table = process_compress_table_default,
 	.create_compressed_chunk = error_no_default_fn_pg_community,
 	.compress_chunk = error_no_default_fn_pg_community,
 	.decompress_chunk = error_no_default_fn_pg_community,
+	.export_arrow_ipc = error_no_default_fn_pg_community,
+	.compress_chunk_slice = error_no_default_fn_pg_community,
 	.compressed_data_decompress_forward = error_no_default_fn_pg_community,
 	.compressed_data_decompress_reverse = error_no_default_fn_pg_community,
 	.deltadelta_compressor_append = error_no_default_fn_pg_community,
@@ -424,7 +527,9 @@ TSDLLEXPORT CrossModuleFunctions ts_cm_functions_default = {
 	.bool_compressor_finish = error_no_default_fn_pg_community,
 	.hypercore_handler = process_hypercore_handler,
 	.hypercore_proxy_handler = process_hypercore_proxy_handler,
+	.hypercore_sparse_handler = process_hypercore_sparse_handler,
 	.is_compressed_tid = error_no_default_fn_pg_community,
+	.hypercore_arrow_cache_stats = error_no_default_fn_pg_community,
 
 	.show_chunk = error_no_default_fn_pg_community,
 	.create_chunk = error_no_default_fn_pg_community,
@@ -35,6 +35,7 @@ typedef struct Chunk Chunk;
 typedef struct ChunkInsertState ChunkInsertState;
 typedef struct CopyChunkState CopyChunkState;
 typedef struct HypertableModifyState HypertableModifyState;
+typedef struct DirectCompressState DirectCompressState;
 
 typedef struct CrossModuleFunctions
 {
@@ -42,6 +43,7 @@ typedef struct CrossModuleFunctions
 	PGFunction policy_compression_remove;
 	PGFunction policy_recompression_proc;
 	PGFunction policy_compression_check;
+	PGFunction policy_compression_execute_parallel;
 	PGFunction policy_refresh_cagg_add;
 	PGFunction policy_refresh_cagg_proc;
 	PGFunction policy_refresh_cagg_check;
@@ -54,6 +56,16 @@ typedef struct CrossModuleFunctions
 	PGFunction policy_retention_proc;
 	PGFunction policy_retention_check;
 	PGFunction policy_retention_remove;
+	PGFunction policy_retention_batch_proc;
+	PGFunction policy_retention_batch_check;
+	PGFunction policy_precreate_chunks_add;
+	PGFunction policy_precreate_chunks_proc;
+	PGFunction policy_precreate_chunks_check;
+	PGFunction policy_precreate_chunks_remove;
+	PGFunction policy_merge_chunks_add;
+	PGFunction policy_merge_chunks_proc;
+	PGFunction policy_merge_chunks_check;
+	PGFunction policy_merge_chunks_remove;
 
 	PGFunction policies_add;
 	PGFunction policies_remove;
@@ -68,6 +80,7 @@ typedef struct CrossModuleFunctions
 	PGFunction job_run;
 
 	bool (*job_execute)(BgwJob *job);
+	void (*bgw_job_helper_main)(int32 job_id, dsm_handle handle);
 
 	void (*create_upper_paths_hook)(PlannerInfo *, UpperRelationKind, RelOptInfo *, RelOptInfo *,
 									TsRelType input_reltype, Hypertable *ht, void *extra);
@@ -107,6 +120,8 @@ typedef struct CrossModuleFunctions
 													 HeapTuple chunk_newtuple, bool update);
 	PGFunction continuous_agg_refresh;
 	void (*continuous_agg_invalidate_raw_ht)(const Hypertable *raw_ht, int64 start, int64 end);
+	void (*continuous_agg_invalidate_slots)(int32 hypertable_id, Relation chunk_rel,
+											TupleTableSlot **slots, int nslots);
 	void (*continuous_agg_invalidate_mat_ht)(const Hypertable *raw_ht, const Hypertable *mat_ht,
 											 int64 start, int64 end);
 	void (*continuous_agg_update_options)(ContinuousAgg *cagg,
@@ -115,6 +130,7 @@ typedef struct CrossModuleFunctions
 	PGFunction continuous_agg_get_bucket_function;
 	PGFunction continuous_agg_get_bucket_function_info;
 	PGFunction continuous_agg_migrate_to_time_bucket;
+	PGFunction continuous_agg_compact_invalidation_log;
 	PGFunction cagg_try_repair;
 
 	PGFunction compressed_data_send;
@@ -123,14 +139,34 @@ typedef struct CrossModuleFunctions
 	PGFunction compressed_data_out;
 	PGFunction compressed_data_info;
 	PGFunction compressed_data_has_nulls;
+	PGFunction bloom1_contains;
+	PGFunction compressed_column_stats;
+	PGFunction calibrate_decompression_cost;
+	PGFunction hll_sfunc;
+	PGFunction hll_combinefunc;
+	PGFunction hll_serializefunc;
+	PGFunction hll_deserializefunc;
+	PGFunction hll_finalfunc;
+	PGFunction ddsketch_sfunc;
+	PGFunction ddsketch_rollup_sfunc;
+	PGFunction ddsketch_combinefunc;
+	PGFunction ddsketch_serializefunc;
+	PGFunction ddsketch_deserializefunc;
+	PGFunction ddsketch_finalfunc;
+	PGFunction approx_quantile;
 	bool (*process_compress_table)(Hypertable *ht, WithClauseResult *with_clause_options);
 	void (*process_altertable_cmd)(Hypertable *ht, const AlterTableCmd *cmd);
 	void (*process_rename_cmd)(Oid relid, Cache *hcache, const RenameStmt *stmt);
 	PGFunction create_compressed_chunk;
 	PGFunction compress_chunk;
 	PGFunction decompress_chunk;
-	void (*decompress_batches_for_insert)(const ChunkInsertState *state, TupleTableSlot *slot);
+	PGFunction export_arrow_ipc;
+	PGFunction compress_chunk_slice;
+	void (*decompress_batches_for_insert)(ChunkInsertState *state, TupleTableSlot *slot);
 	bool (*decompress_target_segments)(HypertableModifyState *ht_state);
+	DirectCompressState *(*direct_compress_begin)(ChunkInsertState *state);
+	void (*direct_compress_insert)(DirectCompressState *state, TupleTableSlot *slot);
+	void (*direct_compress_end)(ChunkInsertState *state);
 	int (*hypercore_decompress_update_segment)(Relation relation, const ItemPointer ctid,
 											   TupleTableSlot *slot, Snapshot snapshot,
 											   ItemPointer new_tid);
@@ -153,7 +189,9 @@ typedef struct CrossModuleFunctions
 	PGFunction bool_compressor_finish;
 	PGFunction hypercore_handler;
 	PGFunction hypercore_proxy_handler;
+	PGFunction hypercore_sparse_handler;
 	PGFunction is_compressed_tid;
+	PGFunction hypercore_arrow_cache_stats;
 
 	PGFunction create_chunk;
 	PGFunction show_chunk;
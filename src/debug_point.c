@@ -268,3 +268,27 @@ ts_debug_point_raise_error_if_enabled(const char *name)
 
 	ereport(ERROR, (errmsg("error injected at debug point '%s'", point.name)));
 }
+
+/*
+ * Check if the debug point is enabled, for simulating a failure that is
+ * handled without an error, e.g., a resource that is not available.
+ */
+bool
+ts_debug_point_is_enabled(const char *name)
+{
+	DebugPoint point;
+	LockAcquireResult lock_acquire_result;
+
+	debug_point_init(&point, name);
+
+	lock_acquire_result = LockAcquire(&point.tag, ExclusiveLock, true, true);
+
+	if (lock_acquire_result == LOCKACQUIRE_NOT_AVAIL)
+		return true;
+
+	/* Release/decrement lock count */
+	LockRelease(&point.tag, ExclusiveLock, true);
+
+	/* The debug point was enabled by this session */
+	return lock_acquire_result != LOCKACQUIRE_OK;
+}
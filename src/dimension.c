@@ -32,6 +32,7 @@
 #include "scanner.h"
 #include "time_utils.h"
 #include "ts_catalog/catalog.h"
+#include "ts_catalog/catalog_snapshot.h"
 #include "utils.h"
 
 /* add_dimension record attribute numbers */
@@ -167,6 +168,30 @@ dimension_type(TupleInfo *ti)
 	return DIMENSION_TYPE_ANY;
 }
 
+/*
+ * Fill in the parts of the dimension that are not stored in the catalog, but
+ * derived from the main table and the partitioning function.
+ */
+static void
+dimension_fill_in_relation_info(Dimension *d, Oid main_table_relid, MemoryContext mctx)
+{
+	if (NameStr(d->fd.partitioning_func)[0] != '\0')
+	{
+		MemoryContext old = MemoryContextSwitchTo(mctx);
+
+		d->partitioning = ts_partitioning_info_create(NameStr(d->fd.partitioning_func_schema),
+													  NameStr(d->fd.partitioning_func),
+													  NameStr(d->fd.column_name),
+													  d->type,
+													  main_table_relid);
+
+		MemoryContextSwitchTo(old);
+	}
+
+	d->column_attno = get_attnum(main_table_relid, NameStr(d->fd.column_name));
+	d->main_table_relid = main_table_relid;
+}
+
 static void
 dimension_fill_in_from_tuple(Dimension *d, TupleInfo *ti, Oid main_table_relid)
 {
@@ -194,8 +219,6 @@ dimension_fill_in_from_tuple(Dimension *d, TupleInfo *ti, Oid main_table_relid)
 	if (!isnull[AttrNumberGetAttrOffset(Anum_dimension_partitioning_func_schema)] &&
 		!isnull[AttrNumberGetAttrOffset(Anum_dimension_partitioning_func)])
 	{
-		MemoryContext old;
-
 		d->fd.num_slices =
 			DatumGetInt16(values[AttrNumberGetAttrOffset(Anum_dimension_num_slices)]);
 
@@ -205,15 +228,6 @@ dimension_fill_in_from_tuple(Dimension *d, TupleInfo *ti, Oid main_table_relid)
 		namestrcpy(&d->fd.partitioning_func,
 				   DatumGetCString(
 					   values[AttrNumberGetAttrOffset(Anum_dimension_partitioning_func)]));
-
-		old = MemoryContextSwitchTo(ti->mctx);
-		d->partitioning = ts_partitioning_info_create(NameStr(d->fd.partitioning_func_schema),
-													  NameStr(d->fd.partitioning_func),
-													  NameStr(d->fd.column_name),
-													  d->type,
-													  main_table_relid);
-
-		MemoryContextSwitchTo(old);
 	}
 
 	if (!isnull[AttrNumberGetAttrOffset(Anum_dimension_integer_now_func_schema)] &&
@@ -239,8 +253,7 @@ dimension_fill_in_from_tuple(Dimension *d, TupleInfo *ti, Oid main_table_relid)
 				values[AttrNumberGetAttrOffset(Anum_dimension_compress_interval_length)]);
 	}
 
-	d->column_attno = get_attnum(main_table_relid, NameStr(d->fd.column_name));
-	d->main_table_relid = main_table_relid;
+	dimension_fill_in_relation_info(d, main_table_relid, ti->mctx);
 
 	if (should_free)
 		heap_freetuple(tuple);
@@ -528,6 +541,26 @@ hyperspace_create(int32 hypertable_id, Oid main_table_relid, uint16 num_dimensio
 	return hs;
 }
 
+/*
+ * Fill in the compact point info of the dimensions once all dimensions are
+ * added and sorted.
+ */
+static void
+hyperspace_fill_in_point_info(Hyperspace *hs)
+{
+	DimensionPointInfo *info = HYPERSPACE_POINT_INFO(hs);
+
+	for (int i = 0; i < hs->num_dimensions; i++)
+	{
+		const Dimension *d = &hs->dimensions[i];
+
+		info[i].type = d->type;
+		info[i].column_attno = d->column_attno;
+		info[i].partition_type = ts_dimension_get_partition_type(d);
+		info[i].partitioning = d->partitioning;
+	}
+}
+
 static ScanTupleResult
 dimension_tuple_found(TupleInfo *ti, void *data)
 {
@@ -585,6 +618,33 @@ ts_dimension_scan(int32 hypertable_id, Oid main_table_relid, int16 num_dimension
 
 	/* Sort dimensions in ascending order to allow binary search lookups */
 	qsort(space->dimensions, space->num_dimensions, sizeof(Dimension), cmp_dimension_id);
+	hyperspace_fill_in_point_info(space);
+
+	return space;
+}
+
+/*
+ * Create the hyperspace from the dimensions in the shared catalog snapshot,
+ * instead of scanning the dimension catalog.
+ */
+Hyperspace *
+ts_dimension_space_from_snapshot(int32 hypertable_id, Oid main_table_relid,
+								 const DimensionSnapshot *dimensions, int16 num_dimensions,
+								 MemoryContext mctx)
+{
+	Hyperspace *space = hyperspace_create(hypertable_id, main_table_relid, num_dimensions, mctx);
+
+	for (int i = 0; i < num_dimensions; i++)
+	{
+		Dimension *d = &space->dimensions[space->num_dimensions++];
+
+		d->fd = dimensions[i].fd;
+		d->type = dimensions[i].type;
+		dimension_fill_in_relation_info(d, main_table_relid, mctx);
+	}
+
+	/* The dimensions were stored from a hyperspace, so they are sorted */
+	hyperspace_fill_in_point_info(space);
 
 	return space;
 }
@@ -953,15 +1013,15 @@ ts_point_create(int16 num_dimensions)
 TSDLLEXPORT Point *
 ts_hyperspace_calculate_point(const Hyperspace *hs, TupleTableSlot *slot)
 {
+	const DimensionPointInfo *info = HYPERSPACE_POINT_INFO(hs);
 	Point *p = ts_point_create(hs->num_dimensions);
 	int i;
 
 	for (i = 0; i < hs->num_dimensions; i++)
 	{
-		const Dimension *d = &hs->dimensions[i];
+		const DimensionPointInfo *d = &info[i];
 		Datum datum;
 		bool isnull;
-		Oid dimtype;
 
 		if (NULL != d->partitioning)
 			datum = ts_partitioning_func_apply_slot(d->partitioning, slot, &isnull);
@@ -971,16 +1031,15 @@ ts_hyperspace_calculate_point(const Hyperspace *hs, TupleTableSlot *slot)
 		switch (d->type)
 		{
 			case DIMENSION_TYPE_OPEN:
-				dimtype = ts_dimension_get_partition_type(d);
-
 				if (isnull)
 					ereport(ERROR,
 							(errcode(ERRCODE_NOT_NULL_VIOLATION),
 							 errmsg("NULL value in column \"%s\" violates not-null constraint",
-									NameStr(d->fd.column_name)),
+									NameStr(hs->dimensions[i].fd.column_name)),
 							 errhint("Columns used for time partitioning cannot be NULL.")));
 
-				p->coordinates[p->num_coords++] = ts_time_value_to_internal(datum, dimtype);
+				p->coordinates[p->num_coords++] =
+					ts_time_value_to_internal(datum, d->partition_type);
 				break;
 			case DIMENSION_TYPE_CLOSED:
 				p->coordinates[p->num_coords++] = (int64) DatumGetInt32(datum);
@@ -1334,6 +1393,9 @@ dimension_info_validate_open(DimensionInfo *info)
 
 	Assert(info->type == DIMENSION_TYPE_OPEN);
 
+	if (!OidIsValid(info->partitioning_func))
+		info->partitioning_func = ts_partitioning_func_get_open_default(info->coltype);
+
 	if (OidIsValid(info->partitioning_func))
 	{
 		if (!ts_partitioning_func_is_valid(info->partitioning_func, info->type, info->coltype))
@@ -36,6 +36,20 @@ typedef struct Dimension
 	PartitioningInfo *partitioning;
 } Dimension;
 
+/*
+ * The fields of a dimension that are needed to calculate the point of a
+ * tuple. They are stored in a compact array after the dimensions, in the same
+ * allocation as the hyperspace, so that routing a tuple only touches a few
+ * cache lines instead of the full dimensions.
+ */
+typedef struct DimensionPointInfo
+{
+	DimensionType type;
+	AttrNumber column_attno;
+	Oid partition_type;
+	PartitioningInfo *partitioning;
+} DimensionPointInfo;
+
 #define IS_OPEN_DIMENSION(d) ((d)->type == DIMENSION_TYPE_OPEN)
 #define IS_CLOSED_DIMENSION(d) ((d)->type == DIMENSION_TYPE_CLOSED)
 #define IS_VALID_OPEN_DIM_TYPE(type)                                                               \
@@ -55,7 +69,9 @@ typedef struct Hyperspace
 } Hyperspace;
 
 #define HYPERSPACE_SIZE(num_dimensions)                                                            \
-	(sizeof(Hyperspace) + (sizeof(Dimension) * (num_dimensions)))
+	(sizeof(Hyperspace) + ((sizeof(Dimension) + sizeof(DimensionPointInfo)) * (num_dimensions)))
+
+#define HYPERSPACE_POINT_INFO(hs) ((DimensionPointInfo *) &(hs)->dimensions[(hs)->capacity])
 
 /*
  * A point in an N-dimensional hyperspace.
@@ -122,6 +138,10 @@ typedef struct DimensionInfo
 
 extern Hyperspace *ts_dimension_scan(int32 hypertable_id, Oid main_table_relid, int16 num_dimension,
 									 MemoryContext mctx);
+typedef struct DimensionSnapshot DimensionSnapshot;
+extern Hyperspace *ts_dimension_space_from_snapshot(int32 hypertable_id, Oid main_table_relid,
+													const DimensionSnapshot *dimensions,
+													int16 num_dimensions, MemoryContext mctx);
 extern DimensionSlice *ts_dimension_calculate_default_slice(const Dimension *dim, int64 value);
 extern TSDLLEXPORT Point *ts_hyperspace_calculate_point(const Hyperspace *h, TupleTableSlot *slot);
 extern int ts_dimension_get_slice_ordinal(const Dimension *dim, const DimensionSlice *slice);
@@ -982,6 +982,21 @@ ts_dimension_slice_scan_iterator_set_slice_id(ScanIterator *it, int32 slice_id,
 	it->ctx.tuplock = tuplock;
 }
 
+/*
+ * Scan for the slices with any of the ids, in the order of the ids.
+ */
+void
+ts_dimension_slice_scan_iterator_set_slice_ids(ScanIterator *it, const int32 *slice_ids,
+											   int num_slice_ids)
+{
+	it->ctx.index = catalog_get_index(ts_catalog_get(), DIMENSION_SLICE, DIMENSION_SLICE_ID_IDX);
+	ts_scan_iterator_scan_key_reset(it);
+	ts_scan_iterator_scan_key_init_int32_array(it,
+											   Anum_dimension_slice_id_idx_id,
+											   slice_ids,
+											   num_slice_ids);
+}
+
 DimensionSlice *
 ts_dimension_slice_scan_iterator_get_by_id(ScanIterator *it, int32 slice_id,
 										   const ScanTupLock *tuplock)
@@ -1363,6 +1378,51 @@ ts_dimension_slice_get_chunkids_to_compress(int32 dimension_id, StrategyNumber s
 	return chunk_ids;
 }
 
+/*
+ * Get the ids of the compressed chunks that have a slice of the dimension
+ * within the range [range_start, range_end), i.e., the compressed chunks that
+ * the range covers completely in the dimension.
+ */
+TSDLLEXPORT List *
+ts_dimension_slice_get_compressed_chunkids_in_range(int32 dimension_id, int64 range_start,
+													int64 range_end)
+{
+	List *chunk_ids = NIL;
+	ScanIterator it = ts_dimension_slice_scan_iterator_create(NULL, CurrentMemoryContext);
+
+	Assert(range_start < range_end);
+
+	/* The end of the slice range is exclusive, the scan expects an inclusive end */
+	ts_dimension_slice_scan_iterator_set_range(&it,
+											   dimension_id,
+											   BTGreaterEqualStrategyNumber,
+											   range_start,
+											   BTLessEqualStrategyNumber,
+											   range_end - 1);
+
+	ts_scanner_foreach(&it)
+	{
+		DimensionSlice *slice = dimension_slice_from_slot(ts_scan_iterator_slot(&it));
+		List *slice_chunk_ids = NIL;
+		ListCell *lc;
+
+		ts_chunk_constraint_scan_by_dimension_slice_to_list(slice,
+															&slice_chunk_ids,
+															CurrentMemoryContext);
+		foreach (lc, slice_chunk_ids)
+		{
+			int32 chunk_id = lfirst_int(lc);
+
+			if (ts_chunk_get_compression_status(chunk_id) != CHUNK_COMPRESS_NONE)
+				chunk_ids = lappend_int(chunk_ids, chunk_id);
+		}
+	}
+
+	ts_scan_iterator_close(&it);
+
+	return chunk_ids;
+}
+
 /* This function checks for overlap between the range we want to update
  for the OSM chunk and the chunks currently in timescaledb (not managed by OSM)
  */
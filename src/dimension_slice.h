@@ -95,10 +95,15 @@ extern TSDLLEXPORT int32 ts_dimension_slice_oldest_valid_chunk_for_reorder(
 extern TSDLLEXPORT List *ts_dimension_slice_get_chunkids_to_compress(
 	int32 dimension_id, StrategyNumber start_strategy, int64 start_value,
 	StrategyNumber end_strategy, int64 end_value, bool compress, bool recompress, int32 numchunks);
+extern TSDLLEXPORT List *ts_dimension_slice_get_compressed_chunkids_in_range(int32 dimension_id,
+																		   int64 range_start,
+																		   int64 range_end);
 
 extern DimensionSlice *ts_dimension_slice_from_tuple(TupleInfo *ti);
 extern ScanIterator ts_dimension_slice_scan_iterator_create(const ScanTupLock *tuplock,
 															MemoryContext result_mcxt);
+extern void ts_dimension_slice_scan_iterator_set_slice_ids(ScanIterator *it, const int32 *slice_ids,
+														   int num_slice_ids);
 extern void ts_dimension_slice_scan_iterator_set_slice_id(ScanIterator *it, int32 slice_id,
 														  const ScanTupLock *tuplock);
 extern DimensionSlice *ts_dimension_slice_scan_iterator_get_by_id(ScanIterator *it, int32 slice_id,
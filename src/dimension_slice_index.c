@@ -0,0 +1,717 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Session-level index of the dimension slices of the hypertables, used for
+ * chunk exclusion when planning and for the collision checks when creating
+ * chunks.
+ *
+ * Finding the chunks that match the query restrictions in the catalog takes
+ * an index scan on the dimension slices for every restricted dimension, and
+ * an index scan on the chunk constraints for every matching slice, which is
+ * slow for hypertables with many chunks. Instead, we keep the slices of every
+ * dimension sorted by their ranges together with the ids of the chunks that
+ * use them, so that the matching chunks are found with a binary search.
+ * The same goes for the chunks that collide with the hypercube of a new
+ * chunk, which we otherwise find with a slice and constraint scan for every
+ * dimension on every chunk creation.
+ *
+ * Any update or delete of the slices and chunk constraints invalidates the
+ * hypertable cache, and we reset the slice indexes at the same time. The new
+ * slices and chunk constraints are only inserted together with a new chunk,
+ * and ts_chunk_insert_lock() sends a relcache invalidation for the
+ * hypertable, which drops its slice index. We accept the pending
+ * invalidations before every lookup, so we see the chunks created by the
+ * concurrent transactions, the same as the catalog scans with a self
+ * snapshot do.
+ */
+#include <postgres.h>
+
+#include <access/stratnum.h>
+#include <utils/hsearch.h>
+#include <utils/inval.h>
+#include <utils/memutils.h>
+
+#include "dimension_slice_index.h"
+
+#include "chunk.h"
+#include "chunk_constraint.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "scan_iterator.h"
+#include "ts_catalog/catalog.h"
+
+typedef struct SliceIndexSlice
+{
+	int32 slice_id;
+	int64 range_start;
+	int64 range_end;
+	int32 num_chunks;
+	int32 *chunk_ids;
+} SliceIndexSlice;
+
+typedef struct SliceIndexDimension
+{
+	int32 dimension_id;
+	int num_slices;
+	SliceIndexSlice *slices; /* Sorted by range start, then range end */
+	int64 *max_range_end;	 /* Largest range end among the slices up to this one */
+} SliceIndexDimension;
+
+typedef struct DimensionSliceIndex
+{
+	MemoryContext mcxt;
+	int num_dimensions;
+	SliceIndexDimension *dimensions;
+} DimensionSliceIndex;
+
+typedef struct SliceIndexChunkCount
+{
+	int32 chunk_id; /* Hash key */
+	int num_dimensions;
+} SliceIndexChunkCount;
+
+typedef struct DimensionSliceIndexEntry
+{
+	Oid hypertable_relid; /* Hash key */
+	DimensionSliceIndex *index;
+} DimensionSliceIndexEntry;
+
+static HTAB *dimension_slice_indexes = NULL;
+
+/*
+ * Incremented on the invalidations that affect the index we are building, to
+ * detect the changes that happen while we read the catalog.
+ */
+static uint64 dimension_slice_index_generation = 0;
+static Oid dimension_slice_index_building_relid = InvalidOid;
+
+/*
+ * Invalidate the slice index of the hypertable, or of all hypertables if the
+ * relid is invalid.
+ *
+ * Called from the relcache invalidation callback, so this must not access
+ * the catalogs.
+ */
+void
+ts_dimension_slice_index_invalidate(Oid hypertable_relid)
+{
+	if (!OidIsValid(hypertable_relid) || hypertable_relid == dimension_slice_index_building_relid)
+		dimension_slice_index_generation++;
+
+	if (dimension_slice_indexes == NULL)
+		return;
+
+	if (OidIsValid(hypertable_relid))
+	{
+		DimensionSliceIndexEntry *entry =
+			hash_search(dimension_slice_indexes, &hypertable_relid, HASH_FIND, NULL);
+
+		if (entry != NULL)
+		{
+			MemoryContextDelete(entry->index->mcxt);
+			hash_search(dimension_slice_indexes, &hypertable_relid, HASH_REMOVE, NULL);
+		}
+
+		return;
+	}
+
+	HASH_SEQ_STATUS status;
+	DimensionSliceIndexEntry *entry;
+
+	hash_seq_init(&status, dimension_slice_indexes);
+	while ((entry = hash_seq_search(&status)) != NULL)
+		MemoryContextDelete(entry->index->mcxt);
+
+	hash_destroy(dimension_slice_indexes);
+	dimension_slice_indexes = NULL;
+}
+
+static int
+slice_index_slice_cmp(const void *left, const void *right)
+{
+	const SliceIndexSlice *left_slice = left;
+	const SliceIndexSlice *right_slice = right;
+
+	if (left_slice->range_start != right_slice->range_start)
+		return left_slice->range_start < right_slice->range_start ? -1 : 1;
+
+	if (left_slice->range_end != right_slice->range_end)
+		return left_slice->range_end < right_slice->range_end ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * Read the slices of the dimension and the ids of the chunks that use them
+ * from the catalog.
+ */
+static void
+slice_index_dimension_build(SliceIndexDimension *idim, const Dimension *dim,
+							ScanIterator *slice_it, ScanIterator *constraint_it,
+							MemoryContext mcxt)
+{
+	List *slices = NIL;
+	ListCell *lc;
+
+	idim->dimension_id = dim->fd.id;
+
+	ts_dimension_slice_scan_iterator_set_range(slice_it,
+											   dim->fd.id,
+											   InvalidStrategy,
+											   0,
+											   InvalidStrategy,
+											   0);
+	ts_scan_iterator_start_or_restart_scan(slice_it);
+
+	while (ts_scan_iterator_next(slice_it) != NULL)
+	{
+		TupleInfo *ti = ts_scan_iterator_tuple_info(slice_it);
+		DimensionSlice *slice = ts_dimension_slice_from_tuple(ti);
+
+		if (slice != NULL)
+			slices = lappend(slices, slice);
+	}
+
+	idim->slices = MemoryContextAlloc(mcxt, sizeof(SliceIndexSlice) * Max(list_length(slices), 1));
+	idim->num_slices = 0;
+
+	foreach (lc, slices)
+	{
+		const DimensionSlice *slice = lfirst(lc);
+		List *chunk_ids = NIL;
+
+		ts_chunk_constraint_scan_iterator_set_slice_id(constraint_it, slice->fd.id);
+		ts_scan_iterator_start_or_restart_scan(constraint_it);
+
+		while (ts_scan_iterator_next(constraint_it) != NULL)
+		{
+			TupleInfo *ti = ts_scan_iterator_tuple_info(constraint_it);
+			bool isnull;
+			Datum datum = slot_getattr(ti->slot, Anum_chunk_constraint_chunk_id, &isnull);
+
+			Assert(!isnull);
+			chunk_ids = lappend_int(chunk_ids, DatumGetInt32(datum));
+		}
+
+		/* Slices without chunks can't give any matches */
+		if (chunk_ids == NIL)
+			continue;
+
+		SliceIndexSlice *islice = &idim->slices[idim->num_slices++];
+		islice->slice_id = slice->fd.id;
+		islice->range_start = slice->fd.range_start;
+		islice->range_end = slice->fd.range_end;
+		islice->num_chunks = list_length(chunk_ids);
+		islice->chunk_ids = MemoryContextAlloc(mcxt, sizeof(int32) * islice->num_chunks);
+
+		for (int i = 0; i < islice->num_chunks; i++)
+			islice->chunk_ids[i] = list_nth_int(chunk_ids, i);
+	}
+
+	/* The index scan returns the slices in this order, but don't rely on it */
+	qsort(idim->slices, idim->num_slices, sizeof(SliceIndexSlice), slice_index_slice_cmp);
+
+	idim->max_range_end = MemoryContextAlloc(mcxt, sizeof(int64) * Max(idim->num_slices, 1));
+	for (int i = 0; i < idim->num_slices; i++)
+	{
+		idim->max_range_end[i] = idim->slices[i].range_end;
+		if (i > 0 && idim->max_range_end[i - 1] > idim->max_range_end[i])
+			idim->max_range_end[i] = idim->max_range_end[i - 1];
+	}
+}
+
+static DimensionSliceIndex *
+dimension_slice_index_build(const Hypertable *ht)
+{
+	const Hyperspace *hs = ht->space;
+	MemoryContext mcxt = AllocSetContextCreate(CurrentMemoryContext,
+											   "dimension slice index",
+											   ALLOCSET_DEFAULT_SIZES);
+	MemoryContext work_mcxt = AllocSetContextCreate(CurrentMemoryContext,
+													"dimension slice index build",
+													ALLOCSET_DEFAULT_SIZES);
+	MemoryContext old_mcxt = MemoryContextSwitchTo(work_mcxt);
+
+	DimensionSliceIndex *index = MemoryContextAllocZero(mcxt, sizeof(DimensionSliceIndex));
+	index->mcxt = mcxt;
+	index->dimensions =
+		MemoryContextAllocZero(mcxt, sizeof(SliceIndexDimension) * Max(hs->num_dimensions, 1));
+
+	ScanIterator slice_it = ts_dimension_slice_scan_iterator_create(NULL, work_mcxt);
+	ScanIterator constraint_it = ts_chunk_constraint_scan_iterator_create(work_mcxt);
+
+	for (int i = 0; i < hs->num_dimensions; i++)
+	{
+		const Dimension *dim = &hs->dimensions[i];
+
+		if (dim->type != DIMENSION_TYPE_OPEN && dim->type != DIMENSION_TYPE_CLOSED)
+			continue;
+
+		slice_index_dimension_build(&index->dimensions[index->num_dimensions++],
+									dim,
+									&slice_it,
+									&constraint_it,
+									mcxt);
+	}
+
+	ts_scan_iterator_close(&slice_it);
+	ts_scan_iterator_close(&constraint_it);
+
+	MemoryContextSwitchTo(old_mcxt);
+	MemoryContextDelete(work_mcxt);
+
+	return index;
+}
+
+/*
+ * Get the slice index of the hypertable from the cache, or build it. The
+ * index is not cached if the catalog might have changed while we read it,
+ * and then the caller has to free it. The index is built in the current
+ * memory context, so that it is freed if we fail while reading the catalog.
+ */
+static DimensionSliceIndex *
+dimension_slice_index_get(const Hypertable *ht, bool *cached)
+{
+	const Oid relid = ht->main_table_relid;
+	DimensionSliceIndexEntry *entry;
+	bool found;
+
+	if (dimension_slice_indexes != NULL)
+	{
+		entry = hash_search(dimension_slice_indexes, &relid, HASH_FIND, NULL);
+
+		if (entry != NULL)
+		{
+			*cached = true;
+			return entry->index;
+		}
+	}
+
+	/*
+	 * If we fail, the relid is reset by the next build. Until then, it can
+	 * only cause some spurious generation increments.
+	 */
+	const uint64 generation = dimension_slice_index_generation;
+	dimension_slice_index_building_relid = relid;
+	DimensionSliceIndex *index = dimension_slice_index_build(ht);
+	dimension_slice_index_building_relid = InvalidOid;
+
+	if (generation != dimension_slice_index_generation)
+	{
+		*cached = false;
+		return index;
+	}
+
+	if (dimension_slice_indexes == NULL)
+	{
+		HASHCTL ctl = {
+			.keysize = sizeof(Oid),
+			.entrysize = sizeof(DimensionSliceIndexEntry),
+			.hcxt = CacheMemoryContext,
+		};
+
+		dimension_slice_indexes = hash_create("dimension slice indexes",
+											  32,
+											  &ctl,
+											  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	MemoryContextSetParent(index->mcxt, CacheMemoryContext);
+	entry = hash_search(dimension_slice_indexes, &relid, HASH_ENTER, &found);
+	Assert(!found);
+	entry->index = index;
+	*cached = true;
+
+	return index;
+}
+
+static const SliceIndexDimension *
+slice_index_get_dimension(const DimensionSliceIndex *index, int32 dimension_id)
+{
+	for (int i = 0; i < index->num_dimensions; i++)
+	{
+		if (index->dimensions[i].dimension_id == dimension_id)
+			return &index->dimensions[i];
+	}
+
+	return NULL;
+}
+
+static inline bool
+slice_index_value_matches(int64 value, StrategyNumber strategy, int64 bound)
+{
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+			return value < bound;
+		case BTLessEqualStrategyNumber:
+			return value <= bound;
+		case BTGreaterEqualStrategyNumber:
+			return value >= bound;
+		case BTGreaterStrategyNumber:
+			return value > bound;
+		default:
+			Assert(strategy == InvalidStrategy);
+			return true;
+	}
+}
+
+/*
+ * The range end is exclusive, so we compare it with the next value, same as
+ * ts_dimension_slice_scan_iterator_set_range().
+ */
+static inline int64
+slice_index_range_end_bound(int64 value)
+{
+	if (value == PG_INT64_MAX)
+		return PG_INT64_MAX;
+
+	return REMAP_LAST_COORDINATE(value + 1);
+}
+
+/*
+ * Add the chunks of the slices with the range start matching the start
+ * restriction, and the range end matching the end restriction. The range
+ * starts are sorted, so the slices that can match the start restriction are
+ * a prefix of the array. The maximum range ends are sorted as well, so the
+ * slices that can match the end restriction follow the first slice where
+ * the maximum range end does.
+ */
+static void
+slice_index_find_range(const SliceIndexDimension *idim, StrategyNumber start_strategy,
+					   int64 start_value, StrategyNumber end_strategy, int64 end_value,
+					   bool *seen, List **matches)
+{
+	int lo = 0;
+	int hi = idim->num_slices;
+
+	Assert(start_strategy == InvalidStrategy || start_strategy == BTLessStrategyNumber ||
+		   start_strategy == BTLessEqualStrategyNumber);
+	Assert(end_strategy == InvalidStrategy || end_strategy == BTGreaterStrategyNumber ||
+		   end_strategy == BTGreaterEqualStrategyNumber);
+
+	if (start_strategy != InvalidStrategy)
+	{
+		int low = 0;
+
+		while (low < hi)
+		{
+			const int mid = low + (hi - low) / 2;
+
+			if (slice_index_value_matches(idim->slices[mid].range_start,
+										  start_strategy,
+										  start_value))
+				low = mid + 1;
+			else
+				hi = mid;
+		}
+	}
+
+	if (end_strategy != InvalidStrategy)
+	{
+		end_value = slice_index_range_end_bound(end_value);
+
+		int high = hi;
+		while (lo < high)
+		{
+			const int mid = lo + (high - lo) / 2;
+
+			if (slice_index_value_matches(idim->max_range_end[mid], end_strategy, end_value))
+				high = mid;
+			else
+				lo = mid + 1;
+		}
+	}
+
+	for (int i = lo; i < hi; i++)
+	{
+		const SliceIndexSlice *islice = &idim->slices[i];
+
+		if (seen[i] || !slice_index_value_matches(islice->range_end, end_strategy, end_value))
+			continue;
+
+		seen[i] = true;
+		*matches = lappend(*matches, (void *) islice);
+	}
+}
+
+/*
+ * Find the ids of the chunks matching the restrictions on the hypertable
+ * dimensions. This is the same as gather_restriction_dimension_vectors()
+ * followed by ts_chunk_id_find_in_subspace(), but uses the slice index
+ * instead of the catalog.
+ *
+ * Returns false if the index can't be used for these restrictions.
+ */
+bool
+ts_dimension_slice_index_find_chunk_ids(const Hypertable *ht, DimensionRestrictInfo **restrictions,
+										int num_restrictions, List **chunk_ids)
+{
+	/* The stats dimensions don't have slices */
+	for (int i = 0; i < num_restrictions; i++)
+	{
+		if (restrictions[i]->dimension->type != DIMENSION_TYPE_OPEN &&
+			restrictions[i]->dimension->type != DIMENSION_TYPE_CLOSED)
+			return false;
+	}
+
+	AcceptInvalidationMessages();
+
+	bool cached;
+	DimensionSliceIndex *index = dimension_slice_index_get(ht, &cached);
+	HTAB *chunk_counts = NULL;
+	bool usable = true;
+
+	*chunk_ids = NIL;
+
+	if (num_restrictions > 1)
+	{
+		HASHCTL ctl = {
+			.keysize = sizeof(int32),
+			.entrysize = sizeof(SliceIndexChunkCount),
+			.hcxt = CurrentMemoryContext,
+		};
+
+		chunk_counts = hash_create("dimension slice index chunks",
+								   256,
+								   &ctl,
+								   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	for (int i = 0; i < num_restrictions; i++)
+	{
+		const DimensionRestrictInfo *dri = restrictions[i];
+		const SliceIndexDimension *idim = slice_index_get_dimension(index, dri->dimension->fd.id);
+		List *matches = NIL;
+		ListCell *lc;
+
+		if (idim == NULL)
+		{
+			usable = false;
+			break;
+		}
+
+		bool *seen = palloc0(sizeof(bool) * Max(idim->num_slices, 1));
+
+		if (dri->dimension->type == DIMENSION_TYPE_OPEN)
+		{
+			const DimensionRestrictInfoOpen *open = (const DimensionRestrictInfoOpen *) dri;
+
+			slice_index_find_range(idim,
+								   open->upper_strategy,
+								   open->upper_bound,
+								   open->lower_strategy,
+								   open->lower_bound,
+								   seen,
+								   &matches);
+		}
+		else
+		{
+			const DimensionRestrictInfoClosed *closed = (const DimensionRestrictInfoClosed *) dri;
+
+			Assert(closed->strategy == BTEqualStrategyNumber);
+
+			foreach (lc, closed->partitions)
+			{
+				const int32 partition = lfirst_int(lc);
+
+				slice_index_find_range(idim,
+									   BTLessEqualStrategyNumber,
+									   partition,
+									   BTGreaterEqualStrategyNumber,
+									   partition,
+									   seen,
+									   &matches);
+			}
+		}
+
+		pfree(seen);
+
+		/*
+		 * A chunk matches when it has a matching slice in every restricted
+		 * dimension. It has only one slice per dimension, so we count the
+		 * dimensions where it matched.
+		 */
+		foreach (lc, matches)
+		{
+			const SliceIndexSlice *islice = lfirst(lc);
+
+			for (int j = 0; j < islice->num_chunks; j++)
+			{
+				const int32 chunk_id = islice->chunk_ids[j];
+
+				if (chunk_counts == NULL)
+				{
+					*chunk_ids = lappend_int(*chunk_ids, chunk_id);
+					continue;
+				}
+
+				bool found;
+				SliceIndexChunkCount *count =
+					hash_search(chunk_counts, &chunk_id, HASH_ENTER, &found);
+
+				if (!found)
+					count->num_dimensions = 0;
+
+				if (++count->num_dimensions == num_restrictions)
+					*chunk_ids = lappend_int(*chunk_ids, chunk_id);
+			}
+		}
+
+		list_free(matches);
+	}
+
+	if (chunk_counts != NULL)
+		hash_destroy(chunk_counts);
+
+	if (!cached)
+		MemoryContextDelete(index->mcxt);
+
+	if (!usable)
+	{
+		list_free(*chunk_ids);
+		*chunk_ids = NIL;
+	}
+
+	return usable;
+}
+
+/*
+ * Add the chunks of the slices that collide with the range to the chunk scan
+ * context, the same as ts_chunk_constraint_scan_by_dimension_slice() does for
+ * the slices found by dimension_slice_collision_scan(). The slices collide
+ * when the range start is before the end of the other range, and the range
+ * end is after the start of the other range.
+ */
+static void
+slice_index_add_colliding_chunks(const SliceIndexDimension *idim, const DimensionSlice *slice,
+								 ChunkScanCtx *scanctx)
+{
+	const Hyperspace *hs = scanctx->ht->space;
+	int lo = 0;
+	int hi = idim->num_slices;
+
+	/* Find the first slice that starts at or after the end of the range */
+	while (lo < hi)
+	{
+		const int mid = lo + (hi - lo) / 2;
+
+		if (idim->slices[mid].range_start < slice->fd.range_end)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* Find the first slice where the maximum range end is after the start */
+	hi = lo;
+	lo = 0;
+	while (lo < hi)
+	{
+		const int mid = lo + (hi - lo) / 2;
+
+		if (idim->max_range_end[mid] > slice->fd.range_start)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	for (int i = lo; i < idim->num_slices && idim->slices[i].range_start < slice->fd.range_end;
+		 i++)
+	{
+		const SliceIndexSlice *islice = &idim->slices[i];
+		DimensionSlice *chunk_slice;
+
+		if (islice->range_end <= slice->fd.range_start)
+			continue;
+
+		chunk_slice =
+			ts_dimension_slice_create(idim->dimension_id, islice->range_start, islice->range_end);
+		chunk_slice->fd.id = islice->slice_id;
+
+		for (int j = 0; j < islice->num_chunks; j++)
+		{
+			const int32 chunk_id = islice->chunk_ids[j];
+			ChunkScanEntry *entry;
+			ChunkStub *stub;
+			bool found;
+
+			entry = hash_search(scanctx->htab, &chunk_id, HASH_ENTER, &found);
+
+			if (!found)
+			{
+				stub = ts_chunk_stub_create(chunk_id, hs->num_dimensions);
+				stub->cube = ts_hypercube_alloc(hs->num_dimensions);
+				entry->stub = stub;
+			}
+			else
+				stub = entry->stub;
+
+			ts_chunk_constraints_add(stub->constraints, chunk_id, islice->slice_id, NULL, NULL);
+			ts_hypercube_add_slice(stub->cube, chunk_slice);
+
+			if (chunk_stub_is_complete(stub, hs))
+				scanctx->num_complete_chunks++;
+		}
+	}
+}
+
+/*
+ * Find the chunks that collide with the hypercube in any dimension and add
+ * them to the chunk scan context. This is the same as chunk_collision_scan()
+ * with the catalog, but uses the slice index. Only the chunks, and not the
+ * slices without chunks, are of interest here, so it doesn't matter that the
+ * index doesn't have the latter.
+ *
+ * Returns false if the index can't be used for the hyperspace.
+ */
+bool
+ts_dimension_slice_index_collision_scan(ChunkScanCtx *scanctx, const Hypercube *cube)
+{
+	const Hyperspace *hs = scanctx->ht->space;
+
+	Assert(cube->num_slices == hs->num_dimensions);
+
+	for (int i = 0; i < hs->num_dimensions; i++)
+	{
+		if (hs->dimensions[i].type != DIMENSION_TYPE_OPEN &&
+			hs->dimensions[i].type != DIMENSION_TYPE_CLOSED)
+			return false;
+	}
+
+	AcceptInvalidationMessages();
+
+	bool cached;
+	DimensionSliceIndex *index = dimension_slice_index_get(scanctx->ht, &cached);
+	bool usable = true;
+
+	for (int i = 0; i < cube->num_slices; i++)
+	{
+		if (slice_index_get_dimension(index, cube->slices[i]->fd.dimension_id) == NULL)
+		{
+			usable = false;
+			break;
+		}
+	}
+
+	if (usable)
+	{
+		for (int i = 0; i < cube->num_slices; i++)
+		{
+			const DimensionSlice *slice = cube->slices[i];
+
+			slice_index_add_colliding_chunks(slice_index_get_dimension(index,
+																	   slice->fd.dimension_id),
+											 slice,
+											 scanctx);
+		}
+	}
+
+	if (!cached)
+		MemoryContextDelete(index->mcxt);
+
+	return usable;
+}
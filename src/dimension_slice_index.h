@@ -0,0 +1,19 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include "chunk.h"
+#include "hypercube.h"
+#include "hypertable.h"
+#include "hypertable_restrict_info.h"
+
+extern bool ts_dimension_slice_index_find_chunk_ids(const Hypertable *ht,
+													DimensionRestrictInfo **restrictions,
+													int num_restrictions, List **chunk_ids);
+extern bool ts_dimension_slice_index_collision_scan(ChunkScanCtx *scanctx, const Hypercube *cube);
+extern void ts_dimension_slice_index_invalidate(Oid hypertable_relid);
@@ -5,14 +5,23 @@
  */
 #include <postgres.h>
 #include <catalog/pg_type.h>
+#include <math.h>
 #include <optimizer/optimizer.h>
 #include <parser/parse_oper.h>
+#include <parser/parsetree.h>
 #include <utils/selfuncs.h>
 
+#include "cache.h"
+#include "chunk.h"
 #include "compat/compat.h"
+#include "dimension.h"
+#include "dimension_slice.h"
 #include "estimate.h"
 #include "func_cache.h"
+#include "hypercube.h"
+#include "hypertable.h"
 #include "import/planner.h"
+#include "planner/planner.h"
 #include "utils.h"
 
 /*
@@ -105,6 +114,84 @@ estimate_max_spread_expr(PlannerInfo *root, Expr *expr)
 	}
 }
 
+/*
+ * Estimate the number of intervals of size interval_period that the values of
+ * the open dimension var of a hypertable fall into, using the dimension slices
+ * of the chunks that remain after chunk exclusion.
+ *
+ * A chunk cannot contribute more intervals than its slice covers or than it
+ * has rows. The row estimate of a compressed chunk is based on the number of
+ * compressed batches, so this also accounts for the compressed chunks. Since
+ * an interval can span several chunks, the sum is capped by the number of
+ * intervals between the lowest and the highest slice boundary.
+ */
+static double
+estimate_group_var_chunks(PlannerInfo *root, Var *var, double interval_period)
+{
+	RangeTblEntry *rte;
+	Hypertable *ht;
+	const Dimension *dim;
+	ListCell *lc;
+	double groups = 0;
+	int64 range_min = PG_INT64_MAX;
+	int64 range_max = PG_INT64_MIN;
+	bool found = false;
+
+	if (var->varlevelsup != 0 || var->varno <= 0 || var->varno >= root->simple_rel_array_size)
+		return INVALID_ESTIMATE;
+
+	rte = planner_rt_fetch(var->varno, root);
+	if (rte->rtekind != RTE_RELATION || !rte->inh)
+		return INVALID_ESTIMATE;
+
+	ht = ts_planner_get_hypertable(rte->relid, CACHE_FLAG_CHECK);
+	if (ht == NULL)
+		return INVALID_ESTIMATE;
+
+	dim = hyperspace_get_open_dimension(ht->space, 0);
+	if (dim == NULL || dim->column_attno != var->varattno)
+		return INVALID_ESTIMATE;
+
+	foreach (lc, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = lfirst_node(AppendRelInfo, lc);
+		RelOptInfo *child;
+		TimescaleDBPrivate *child_private;
+		const DimensionSlice *slice;
+		double span;
+
+		if (appinfo->parent_relid != (Index) var->varno)
+			continue;
+
+		child = root->simple_rel_array[appinfo->child_relid];
+		if (child == NULL || IS_DUMMY_REL(child))
+			continue;
+
+		child_private = child->fdw_private;
+		if (child_private == NULL || child_private->cached_chunk_struct == NULL)
+			return INVALID_ESTIMATE;
+
+		slice = ts_hypercube_get_slice_by_dimension_id(child_private->cached_chunk_struct->cube,
+													   dim->fd.id);
+		if (slice == NULL || slice->fd.range_start == DIMENSION_SLICE_MINVALUE ||
+			slice->fd.range_end == DIMENSION_SLICE_MAXVALUE)
+			return INVALID_ESTIMATE;
+
+		/* The slice can start in the middle of an interval */
+		span = (double) slice->fd.range_end - (double) slice->fd.range_start;
+		groups += Min(ceil(span / interval_period) + 1, clamp_row_est(child->rows));
+
+		range_min = Min(range_min, slice->fd.range_start);
+		range_max = Max(range_max, slice->fd.range_end);
+		found = true;
+	}
+
+	if (!found)
+		return INVALID_ESTIMATE;
+
+	return Min(groups, ceil(((double) range_max - (double) range_min) / interval_period) + 1);
+}
+
 /*
  * Return an estimate for the number of groups formed when expr is divided
  * into intervals of size interval_period.
@@ -113,13 +200,24 @@ double
 ts_estimate_group_expr_interval(PlannerInfo *root, Expr *expr, double interval_period)
 {
 	double max_period;
+	double chunk_groups = INVALID_ESTIMATE;
 
 	if (interval_period <= 0)
 		return INVALID_ESTIMATE;
 
+	if (IsA(expr, Var))
+		chunk_groups = estimate_group_var_chunks(root, (Var *) expr, interval_period);
+
 	max_period = estimate_max_spread_expr(root, expr);
 	if (!IS_VALID_ESTIMATE(max_period))
+	{
+		if (IS_VALID_ESTIMATE(chunk_groups))
+			return clamp_row_est(chunk_groups);
 		return INVALID_ESTIMATE;
+	}
+
+	if (IS_VALID_ESTIMATE(chunk_groups))
+		return clamp_row_est(Min(chunk_groups, max_period / interval_period));
 
 	return clamp_row_est(max_period / interval_period);
 }
@@ -6,6 +6,7 @@
 #include <postgres.h>
 #include <miscadmin.h>
 #include <parser/parse_func.h>
+#include <postmaster/bgworker.h>
 #include <utils/guc.h>
 #include <utils/regproc.h>
 #include <utils/varlena.h>
@@ -111,6 +112,30 @@ static const struct config_enum_entry transparent_decompression_options[] = {
 	{ NULL, 0, false }
 };
 
+static const struct config_enum_entry compression_block_codec_options[] = {
+	{ "none", BLOCK_CODEC_NONE, false },
+#ifdef USE_LZ4
+	{ "lz4", BLOCK_CODEC_LZ4, false },
+#endif
+#ifdef USE_ZSTD
+	{ "zstd", BLOCK_CODEC_ZSTD, false },
+#endif
+	{ NULL, 0, false }
+};
+
+static const struct config_enum_entry compression_objective_options[] = {
+	{ "size", COMPRESSION_OBJECTIVE_SIZE, false },
+	{ "balanced", COMPRESSION_OBJECTIVE_BALANCED, false },
+	{ "speed", COMPRESSION_OBJECTIVE_SPEED, false },
+	{ NULL, 0, false }
+};
+
+static const struct config_enum_entry chunk_tablespace_placement_options[] = {
+	{ "round_robin", CHUNK_TABLESPACE_PLACEMENT_ROUND_ROBIN, false },
+	{ "load", CHUNK_TABLESPACE_PLACEMENT_LOAD, false },
+	{ NULL, 0, false }
+};
+
 static const struct config_enum_entry hypercore_copy_to_options[] = {
 	{ "all_data", HYPERCORE_COPY_ALL_DATA, false },
 	{ "no_compressed_data", HYPERCORE_COPY_NO_COMPRESSED_DATA, false },
@@ -124,37 +149,64 @@ bool ts_guc_enable_constraint_aware_append = true;
 bool ts_guc_enable_ordered_append = true;
 bool ts_guc_enable_chunk_append = true;
 bool ts_guc_enable_parallel_chunk_append = true;
+int ts_guc_chunk_append_prefetch_depth = 1;
 bool ts_guc_enable_runtime_exclusion = true;
+bool ts_guc_enable_startup_exclusion_costing = true;
 bool ts_guc_enable_constraint_exclusion = true;
 bool ts_guc_enable_qual_propagation = true;
 bool ts_guc_enable_cagg_reorder_groupby = true;
 bool ts_guc_enable_now_constify = true;
+TSDLLEXPORT bool ts_guc_enable_planner_stats = false;
 bool ts_guc_enable_foreign_key_propagation = true;
 #if PG16_GE
 TSDLLEXPORT bool ts_guc_enable_cagg_sort_pushdown = true;
 #endif
 TSDLLEXPORT bool ts_guc_enable_cagg_watermark_constify = true;
+TSDLLEXPORT bool ts_guc_enable_cagg_query_rewrite = false;
 TSDLLEXPORT int ts_guc_cagg_max_individual_materializations = 10;
 bool ts_guc_enable_osm_reads = true;
 TSDLLEXPORT bool ts_guc_enable_compressed_direct_batch_delete = true;
+TSDLLEXPORT bool ts_guc_enable_compressed_direct_batch_update = false;
+TSDLLEXPORT bool ts_guc_enable_direct_compress_insert = false;
 TSDLLEXPORT bool ts_guc_enable_dml_decompression = true;
 TSDLLEXPORT bool ts_guc_enable_dml_decompression_tuple_filtering = true;
 TSDLLEXPORT int ts_guc_max_tuples_decompressed_per_dml = 100000;
 TSDLLEXPORT int ts_guc_enable_transparent_decompression = 1;
 TSDLLEXPORT bool ts_guc_enable_compression_wal_markers = false;
 TSDLLEXPORT bool ts_guc_enable_decompression_sorted_merge = true;
+TSDLLEXPORT bool ts_guc_enable_parallel_batch_distribution = false;
+TSDLLEXPORT bool ts_guc_enable_runtime_join_filters = false;
+TSDLLEXPORT bool ts_guc_enable_decompression_cache = false;
+TSDLLEXPORT int ts_guc_partial_agg_cache_size = 0;
 bool ts_guc_enable_chunkwise_aggregation = true;
 bool ts_guc_enable_vectorized_aggregation = true;
+bool ts_guc_enable_heap_vectorized_aggregation = false;
 bool ts_guc_enable_custom_hashagg = false;
 TSDLLEXPORT bool ts_guc_enable_compression_indexscan = false;
+TSDLLEXPORT bool ts_guc_enable_compression_presorted_scan = false;
 TSDLLEXPORT bool ts_guc_enable_bulk_decompression = true;
+TSDLLEXPORT bool ts_guc_enable_decompression_stats = false;
 TSDLLEXPORT bool ts_guc_auto_sparse_indexes = true;
 TSDLLEXPORT bool ts_guc_default_hypercore_use_access_method = false;
 bool ts_guc_enable_chunk_skipping = false;
 TSDLLEXPORT bool ts_guc_enable_segmentwise_recompression = true;
 TSDLLEXPORT bool ts_guc_enable_exclusive_locking_recompression = false;
 TSDLLEXPORT bool ts_guc_enable_bool_compression = false;
+TSDLLEXPORT bool ts_guc_enable_for_compression = false;
+TSDLLEXPORT bool ts_guc_enable_alp_compression = false;
+TSDLLEXPORT bool ts_guc_enable_fsst_compression = false;
+TSDLLEXPORT bool ts_guc_enable_uuid_compression = false;
+TSDLLEXPORT bool ts_guc_enable_fixed_dictionary_compression = false;
+TSDLLEXPORT bool ts_guc_enable_jsonb_shredding = false;
+TSDLLEXPORT bool ts_guc_enable_adaptive_compression = false;
+TSDLLEXPORT CompressionBlockCodec ts_guc_compression_block_codec = BLOCK_CODEC_NONE;
+TSDLLEXPORT CompressionObjective ts_guc_compression_objective = COMPRESSION_OBJECTIVE_SIZE;
 TSDLLEXPORT int ts_guc_compression_batch_size_limit = 1000;
+TSDLLEXPORT int ts_guc_compression_batch_memory_limit = 262144;
+TSDLLEXPORT int ts_guc_compression_parallel_workers = 0;
+TSDLLEXPORT int ts_guc_decompression_parallel_workers = 0;
+TSDLLEXPORT bool ts_guc_compression_force_toast = false;
+TSDLLEXPORT bool ts_guc_enable_compression_bulk_wal = false;
 
 /* Only settable in debug mode for testing */
 TSDLLEXPORT bool ts_guc_enable_null_compression = true;
@@ -163,7 +215,14 @@ TSDLLEXPORT bool ts_guc_enable_null_compression = true;
  * disabled, regular sequence scans will be used instead. */
 TSDLLEXPORT bool ts_guc_enable_columnarscan = true;
 TSDLLEXPORT int ts_guc_bgw_log_level = WARNING;
+int ts_guc_bgw_job_runner_lifetime = 0;
+int ts_guc_bgw_max_refresh_jobs = -1;
+int ts_guc_bgw_max_custom_jobs = -1;
+int ts_guc_bgw_max_maintenance_jobs = -1;
+int ts_guc_bgw_start_spread = 0;
+int ts_guc_bgw_max_launches_per_second = 0;
 TSDLLEXPORT bool ts_guc_enable_skip_scan = true;
+TSDLLEXPORT bool ts_guc_enable_compressed_skip_scan = true;
 #if PG16_GE
 TSDLLEXPORT bool ts_guc_enable_skip_scan_for_distinct_aggregates = true;
 #endif
@@ -172,24 +231,33 @@ static char *ts_guc_default_orderby_fn = NULL;
 TSDLLEXPORT bool ts_guc_enable_job_execution_logging = false;
 bool ts_guc_enable_tss_callbacks = true;
 TSDLLEXPORT bool ts_guc_enable_delete_after_compression = false;
+TSDLLEXPORT bool ts_guc_enable_concurrent_reorder = false;
+TSDLLEXPORT int ts_guc_move_chunk_io_rate_limit = 0;
 TSDLLEXPORT bool ts_guc_enable_merge_on_cagg_refresh = false;
+TSDLLEXPORT bool ts_guc_enable_cagg_cascade_refresh = false;
+TSDLLEXPORT bool ts_guc_enable_compressed_cagg_refresh = false;
 TSDLLEXPORT char *ts_guc_hypercore_indexam_whitelist;
 TSDLLEXPORT HypercoreCopyToBehavior ts_guc_hypercore_copy_to_behavior =
 	HYPERCORE_COPY_NO_COMPRESSED_DATA;
 TSDLLEXPORT bool ts_guc_enable_hypercore_scankey_pushdown = true;
 TSDLLEXPORT int ts_guc_hypercore_arrow_cache_max_entries;
+TSDLLEXPORT int ts_guc_hypercore_arrow_cache_max_memory = 262144;
+TSDLLEXPORT int ts_guc_hypercore_shared_arrow_cache_size = 0;
 
 /* default value of ts_guc_max_open_chunks_per_insert and
  * ts_guc_max_cached_chunks_per_hypertable will be set as their respective boot-value when the
  * GUC mechanism starts up */
 int ts_guc_max_open_chunks_per_insert;
 int ts_guc_max_cached_chunks_per_hypertable;
+int ts_guc_max_open_chunks_memory_per_insert = 0;
+ChunkTablespacePlacement ts_guc_chunk_tablespace_placement = CHUNK_TABLESPACE_PLACEMENT_ROUND_ROBIN;
 #ifdef USE_TELEMETRY
 TelemetryLevel ts_guc_telemetry_level = TELEMETRY_DEFAULT;
 char *ts_telemetry_cloud = NULL;
 #endif
 
 TSDLLEXPORT char *ts_guc_license = TS_LICENSE_DEFAULT;
+bool ts_guc_enable_lazy_tsl_load = true;
 char *ts_last_tune_time = NULL;
 char *ts_last_tune_version = NULL;
 
@@ -538,6 +606,21 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable(MAKE_EXTOPTION("chunk_append_prefetch_depth"),
+							"Number of chunks prefetched ahead by the chunk append node",
+							"While a chunk is scanned, the chunk append node issues read-ahead "
+							"for the first blocks of the relations of this many of the next "
+							"chunks. Setting this to 0 disables the prefetching.",
+							&ts_guc_chunk_append_prefetch_depth,
+							1,
+							0,
+							64,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_runtime_exclusion"),
 							 "Enable runtime chunk exclusion",
 							 "Enable runtime chunk exclusion in ChunkAppend node",
@@ -549,6 +632,18 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_startup_exclusion_costing"),
+							 "Enable costing of startup chunk exclusion",
+							 "Account for the chunks excluded at executor startup on the "
+							 "parameters of prepared statements in ChunkAppend cost",
+							 &ts_guc_enable_startup_exclusion_costing,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_constraint_exclusion"),
 							 "Enable constraint exclusion",
 							 "Enable planner constraint exclusion",
@@ -616,6 +711,31 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_compressed_direct_batch_update"),
+							 "Enable direct update of compressed batches",
+							 "Enable updating the segmentby values of the compressed batches "
+							 "in place, without decompressing them",
+							 &ts_guc_enable_compressed_direct_batch_update,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_direct_compress_insert"),
+							 "Enable direct compression of inserted rows",
+							 "Enable compressing the rows inserted into compressed chunks "
+							 "directly into compressed batches, without writing them to the "
+							 "uncompressed chunk first",
+							 &ts_guc_enable_direct_compress_insert,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomIntVariable(MAKE_EXTOPTION("max_tuples_decompressed_per_dml_transaction"),
 							"The max number of tuples that can be decompressed during an "
 							"INSERT, UPDATE, or DELETE.",
@@ -655,6 +775,18 @@ _guc_init(void)
 							 NULL,
 							 NULL,
 							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_compressed_skipscan"),
+							 "Enable SkipScan for compressed chunks",
+							 "Enable SkipScan over the segmentby index of compressed chunks for "
+							 "DISTINCT on segmentby columns",
+							 &ts_guc_enable_compressed_skip_scan,
+							 true,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
 #if PG16_GE
 	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_skipscan_for_distinct_aggregates"),
 							 "Enable SkipScan for DISTINCT aggregates",
@@ -691,6 +823,61 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_parallel_batch_distribution"),
+							 "Enable batch-level work distribution in parallel decompression",
+							 "Enable the parallel plans where the workers claim the compressed "
+							 "batches from a shared state instead of splitting the compressed "
+							 "chunk scan by pages, and the parallel compressed batches heap merge",
+							 &ts_guc_enable_parallel_batch_distribution,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_runtime_join_filters"),
+							 "Enable runtime join filters for compressed chunks",
+							 "Enable filtering the compressed chunks on the probe side of a hash "
+							 "join by the range and the set of the join keys collected from its "
+							 "hashed side. The hypercore tables are not filtered",
+							 &ts_guc_enable_runtime_join_filters,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_decompression_cache"),
+							 "Enable caching of decompressed batches across rescans",
+							 "Keep the decompressed batches of a compressed chunk scan that is "
+							 "rescanned, such as the inner side of a nested loop join, and reuse "
+							 "them in the subsequent scans. The cache is limited by work_mem",
+							 &ts_guc_enable_decompression_cache,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable(MAKE_EXTOPTION("partial_agg_cache_size"),
+							"Size of the cache of per-chunk partial aggregates",
+							"Keep the results of the partial aggregation of compressed chunks "
+							"in a backend-local cache, and reuse them in the repeated queries "
+							"while the compressed data visible to the query does not change. "
+							"Setting this to 0 disables the cache.",
+							&ts_guc_partial_agg_cache_size,
+							0,
+							0,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL,
+							NULL,
+							NULL);
+
 	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_cagg_reorder_groupby"),
 							 "Enable group by reordering",
 							 "Enable group by clause reordering for continuous aggregates",
@@ -713,6 +900,18 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_planner_stats"),
+							 "Enable planner stage timing",
+							 "Measure the time spent in the stages of the TimescaleDB planner "
+							 "hooks, and show it in EXPLAIN summary",
+							 &ts_guc_enable_planner_stats,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 #if PG16_GE
 	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_cagg_sort_pushdown"),
 							 "Enable sort pushdown for continuous aggregates",
@@ -737,6 +936,18 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_cagg_query_rewrite"),
+							 "Enable query rewrite to continuous aggregates",
+							 "Enable answering aggregate queries on a hypertable from a real-time "
+							 "continuous aggregate with the same grouping and aggregates",
+							 &ts_guc_enable_cagg_query_rewrite,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_merge_on_cagg_refresh"),
 							 "Enable MERGE statement on cagg refresh",
 							 "Enable MERGE statement on cagg refresh",
@@ -748,6 +959,31 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_cagg_cascade_refresh"),
+							 "Enable cascading refresh of hierarchical caggs",
+							 "Refresh the continuous aggregates on top of a continuous aggregate "
+							 "right after its refresh policy refreshed it",
+							 &ts_guc_enable_cagg_cascade_refresh,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_compressed_cagg_refresh"),
+							 "Enable cagg refresh of whole compressed chunks",
+							 "Replace the data of the compressed chunks of the materialization "
+							 "hypertable that the refresh covers completely without decompressing "
+							 "them, and compress the new materialization right away",
+							 &ts_guc_enable_compressed_cagg_refresh,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_chunk_skipping"),
 							 "Enable chunk skipping functionality",
 							 "Enable using chunk column stats to filter chunks based on column "
@@ -792,24 +1028,220 @@ _guc_init(void)
 							 NULL,
 							 NULL,
 							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_for_compression"),
+							 "Enable experimental frame-of-reference compression functionality",
+							 "Use frame-of-reference bit-packing for integer columns when it "
+							 "gives a smaller result than the delta-delta encoding",
+							 &ts_guc_enable_for_compression,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_alp_compression"),
+							 "Enable experimental ALP compression functionality",
+							 "Use the adaptive lossless floating point encoding for float columns "
+							 "when it gives a smaller result than the Gorilla encoding",
+							 &ts_guc_enable_alp_compression,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_fsst_compression"),
+							 "Enable experimental FSST compression functionality",
+							 "Use the fast static symbol table encoding for text columns "
+							 "when it gives a smaller result than the array encoding",
+							 &ts_guc_enable_fsst_compression,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_uuid_compression"),
+							 "Enable experimental UUID compression functionality",
+							 "Use the delta-delta encoding of the timestamps for the version 7 "
+							 "UUID columns when it gives a smaller result than the dictionary or "
+							 "array encoding",
+							 &ts_guc_enable_uuid_compression,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_fixed_dictionary_compression"),
+							 "Enable experimental dictionary compression of fixed-width columns",
+							 "Use the dictionary encoding for integer and float columns with "
+							 "few distinct values when it gives a better result than the "
+							 "delta-delta or Gorilla encoding",
+							 &ts_guc_enable_fixed_dictionary_compression,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_jsonb_shredding"),
+							 "Enable experimental shredding of jsonb columns",
+							 "Store the top-level keys of jsonb columns that have string values "
+							 "in most rows as separate compressed text columns, so that the "
+							 "filters on them don't have to decompress the entire value",
+							 &ts_guc_enable_jsonb_shredding,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_adaptive_compression"),
+							 "Enable experimental adaptive compression functionality",
+							 "Try all the experimental compression algorithms that apply to "
+							 "the column type for each batch, and keep the one that is best "
+							 "for timescaledb.compression_objective",
+							 &ts_guc_enable_adaptive_compression,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomEnumVariable(MAKE_EXTOPTION("compression_objective"),
+							 "Objective for choosing the compression algorithm of a batch",
+							 "When several compression algorithms apply to a batch, keep the "
+							 "smallest result (size), or also take the decompression speed into "
+							 "account (balanced, speed).",
+							 (int *) &ts_guc_compression_objective,
+							 COMPRESSION_OBJECTIVE_SIZE,
+							 compression_objective_options,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomEnumVariable(MAKE_EXTOPTION("compression_block_codec"),
+							 "Codec for the array and dictionary compressed data",
+							 "Compress the array and dictionary compressed data with the given "
+							 "codec instead of relying on the TOAST compression. The compression "
+							 "method of a column set with ALTER TABLE ... SET COMPRESSION takes "
+							 "precedence: lz4 selects the LZ4 codec, pglz disables the codec.",
+							 (int *) &ts_guc_compression_block_codec,
+							 BLOCK_CODEC_NONE,
+							 compression_block_codec_options,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
 	DefineCustomIntVariable(MAKE_EXTOPTION("compression_batch_size_limit"),
 							"The max number of tuples that can be batched together during "
 							"compression",
 							"Setting this option to a number between 1 and 999 will force "
-							"compression "
-							"to limit the size of compressed batches to that amount of "
-							"uncompressed tuples."
-							"Setting this to 0 defaults to the max batch size of 1000.",
+							"compression to limit the size of compressed batches to that "
+							"amount of uncompressed tuples. Larger values, up to 32767, give "
+							"fewer and larger batches, which compress better but have to be "
+							"decompressed as a whole also by selective queries. Hypercore "
+							"supports at most 1023 tuples per batch.",
 							&ts_guc_compression_batch_size_limit,
 							1000,
 							1,
-							1000,
+							/* The max rows per batch of the compressed formats */
+							INT16_MAX,
 							PGC_USERSET,
 							0,
 							NULL,
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable(MAKE_EXTOPTION("compression_batch_memory_limit"),
+							"The max amount of memory used to build a compressed batch",
+							"Compressed batches are cut before reaching the batch size "
+							"limit when the compressors use more memory than this. "
+							"Setting this to 0 disables the limit.",
+							&ts_guc_compression_batch_memory_limit,
+							262144,
+							0,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable(MAKE_EXTOPTION("compression_parallel_workers"),
+							"Number of parallel workers used to sort a chunk for compression",
+							"Sets the number of parallel worker processes that scan and sort "
+							"the rows of a chunk before it is compressed. The number is also "
+							"limited by max_parallel_maintenance_workers. "
+							"Setting this to 0 disables the parallel sort.",
+							&ts_guc_compression_parallel_workers,
+							0,
+							0,
+							MAX_PARALLEL_WORKER_LIMIT,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable(MAKE_EXTOPTION("decompression_parallel_workers"),
+							"Number of parallel workers used to decompress a chunk",
+							"Sets the number of parallel worker processes that decompress "
+							"the batches of a compressed chunk in decompress_chunk(). The "
+							"number is also limited by max_parallel_maintenance_workers. "
+							"Setting this to 0 disables the parallel decompression.",
+							&ts_guc_decompression_parallel_workers,
+							0,
+							0,
+							MAX_PARALLEL_WORKER_LIMIT,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("compression_force_toast"),
+							 "Store the compressed columns of all batches out of line",
+							 "The compressed columns are normally moved to the TOAST table "
+							 "only when the compressed tuple is larger than the TOAST "
+							 "threshold. Enabling this moves them out of line for all "
+							 "batches, so that queries reading a few columns of a wide "
+							 "table do not read the data of the other columns.",
+							 &ts_guc_compression_force_toast,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_compression_bulk_wal"),
+							 "Write new compressed chunks with full-page WAL records",
+							 "When a chunk is compressed into a new compressed chunk, write "
+							 "the pages of the compressed chunk directly and WAL-log them "
+							 "as full pages in batches, like index builds do, instead of "
+							 "logging every compressed tuple and index entry. Not used when "
+							 "logical decoding is enabled.",
+							 &ts_guc_enable_compression_bulk_wal,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 #ifdef TS_DEBUG
 	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_null_compression"),
 							 "Debug only flag to enable NULL compression",
@@ -889,6 +1321,18 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_heap_vectorized_aggregation"),
+							 "Enable vectorized aggregation for uncompressed chunks",
+							 "Enable vectorized aggregation for the uncompressed chunks, that reads "
+							 "the heap tuples in batches",
+							 &ts_guc_enable_heap_vectorized_aggregation,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_compression_indexscan"),
 							 "Enable compression to take indexscan path",
 							 "Enable indexscan during compression, if matching index is found",
@@ -900,6 +1344,19 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_compression_presorted_scan"),
+							 "Enable compression to read presorted chunks in physical order",
+							 "Enable reading the rows in physical order during compression, "
+							 "if the matching index is the clustered index of the chunk, and "
+							 "the rows are mostly sorted, for example by reorder_chunk",
+							 &ts_guc_enable_compression_presorted_scan,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_bulk_decompression"),
 							 "Enable decompression of the entire compressed batches",
 							 "Increases throughput of decompression, but might increase query "
@@ -912,6 +1369,20 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_decompression_stats"),
+							 "Show decompression statistics in EXPLAIN ANALYZE",
+							 "Count the decompressed batches, rows and detoasted bytes of the "
+							 "DecompressChunk nodes, measure the time spent in detoasting, "
+							 "decompression and vectorized filters, and show it in EXPLAIN ANALYZE "
+							 "together with the grouping statistics of the VectorAgg nodes",
+							 &ts_guc_enable_decompression_stats,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable(MAKE_EXTOPTION("auto_sparse_indexes"),
 							 "Create sparse indexes on compressed chunks",
 							 "The hypertable columns that are used as index keys will have "
@@ -953,6 +1424,36 @@ _guc_init(void)
 							assign_max_open_chunks_per_insert_hook,
 							NULL);
 
+	DefineCustomIntVariable(MAKE_EXTOPTION("max_open_chunks_memory_per_insert"),
+							"Maximum memory of the open chunks per insert",
+							"The chunks open for an insert are closed, starting with the "
+							"earliest, when the memory used for them exceeds this before "
+							"opening another chunk. The rows buffered for the closed chunks "
+							"are inserted first. Setting this to 0 disables the limit.",
+							&ts_guc_max_open_chunks_memory_per_insert,
+							0,
+							0,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomEnumVariable(MAKE_EXTOPTION("chunk_tablespace_placement"),
+							 "Placement of new chunks on the attached tablespaces",
+							 "Place new chunks on the attached tablespaces by their slice in the "
+							 "first space dimension (round_robin), or on the tablespace with the "
+							 "fewest recent chunks and then the most free space (load).",
+							 (int *) &ts_guc_chunk_tablespace_placement,
+							 CHUNK_TABLESPACE_PLACEMENT_ROUND_ROBIN,
+							 chunk_tablespace_placement_options,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomIntVariable(MAKE_EXTOPTION("max_cached_chunks_per_hypertable"),
 							"Maximum cached chunks",
 							"Maximum number of chunks stored in the cache",
@@ -999,6 +1500,37 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_concurrent_reorder"),
+							 "Reorder chunks without blocking writes during the copy",
+							 "Copy the chunk in reorder_chunk(), move_chunk() and the reorder "
+							 "policies while writes continue, and apply the changes made during "
+							 "the copy with the writes blocked only at the end",
+							 &ts_guc_enable_concurrent_reorder,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable(/* name= */ MAKE_EXTOPTION("move_chunk_io_rate_limit"),
+							/* short_desc= */ "max data per second copied by move_chunk",
+							/* long_desc= */
+							"Throttle the copy of move_chunk() to this amount of data per second, "
+							"to limit its impact on the I/O of other queries. The compressed "
+							"chunks are then copied block by block, and the uncompressed chunks "
+							"are throttled when reordered concurrently. Setting this to 0 "
+							"disables the throttling.",
+							/* valueAddr= */ &ts_guc_move_chunk_io_rate_limit,
+							/* bootValue= */ 0,
+							/* minValue= */ 0,
+							/* maxValue= */ INT_MAX,
+							/* context= */ PGC_USERSET,
+							/* flags= */ GUC_UNIT_KB,
+							/* check_hook= */ NULL,
+							/* assign_hook= */ NULL,
+							/* show_hook= */ NULL);
+
 #ifdef USE_TELEMETRY
 	DefineCustomEnumVariable(MAKE_EXTOPTION("telemetry_level"),
 							 "Telemetry settings level",
@@ -1050,6 +1582,19 @@ _guc_init(void)
 							   /* assign_hook= */ ts_license_guc_assign_hook,
 							   /* show_hook= */ NULL);
 
+	DefineCustomBoolVariable(MAKE_EXTOPTION("enable_lazy_tsl_load"),
+							 "Load the TSL module on first use",
+							 "Load and initialize the TSL module when a backend first runs a "
+							 "query or command that can use it, instead of when the extension is "
+							 "loaded",
+							 &ts_guc_enable_lazy_tsl_load,
+							 true,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomStringVariable(/* name= */ MAKE_EXTOPTION("last_tuned"),
 							   /* short_desc= */ "last tune run",
 							   /* long_desc= */ "records last time timescaledb-tune ran",
@@ -1085,6 +1630,107 @@ _guc_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable(/* name= */ MAKE_EXTOPTION("bgw_job_runner_lifetime"),
+							/* short_desc= */ "max lifetime of the pooled job runners",
+							/* long_desc= */
+							"The background workers that run the jobs are kept after a job and "
+							"run the next jobs of the same owner for up to this time, to avoid "
+							"starting a new background worker for every job execution. Setting "
+							"this to 0 starts a new background worker for every execution.",
+							/* valueAddr= */ &ts_guc_bgw_job_runner_lifetime,
+							/* bootValue= */ 0,
+							/* minValue= */ 0,
+							/* maxValue= */ INT_MAX,
+							/* context= */ PGC_SIGHUP,
+							/* flags= */ GUC_UNIT_MS,
+							/* check_hook= */ NULL,
+							/* assign_hook= */ NULL,
+							/* show_hook= */ NULL);
+
+	DefineCustomIntVariable(/* name= */ MAKE_EXTOPTION("bgw_max_refresh_jobs"),
+							/* short_desc= */ "max number of running refresh jobs",
+							/* long_desc= */
+							"The maximum number of jobs of the refresh class that the scheduler of "
+							"a database runs at the same time. The continuous aggregate refresh "
+							"policies are refresh jobs by default. Setting this to -1 removes "
+							"the limit.",
+							/* valueAddr= */ &ts_guc_bgw_max_refresh_jobs,
+							/* bootValue= */ -1,
+							/* minValue= */ -1,
+							/* maxValue= */ INT_MAX,
+							/* context= */ PGC_SIGHUP,
+							/* flags= */ 0,
+							/* check_hook= */ NULL,
+							/* assign_hook= */ NULL,
+							/* show_hook= */ NULL);
+
+	DefineCustomIntVariable(/* name= */ MAKE_EXTOPTION("bgw_max_custom_jobs"),
+							/* short_desc= */ "max number of running custom jobs",
+							/* long_desc= */
+							"The maximum number of jobs of the custom class that the scheduler of "
+							"a database runs at the same time. The user-defined actions are "
+							"custom jobs by default. Setting this to -1 removes the limit.",
+							/* valueAddr= */ &ts_guc_bgw_max_custom_jobs,
+							/* bootValue= */ -1,
+							/* minValue= */ -1,
+							/* maxValue= */ INT_MAX,
+							/* context= */ PGC_SIGHUP,
+							/* flags= */ 0,
+							/* check_hook= */ NULL,
+							/* assign_hook= */ NULL,
+							/* show_hook= */ NULL);
+
+	DefineCustomIntVariable(/* name= */ MAKE_EXTOPTION("bgw_max_maintenance_jobs"),
+							/* short_desc= */ "max number of running maintenance jobs",
+							/* long_desc= */
+							"The maximum number of jobs of the maintenance class that the "
+							"scheduler of a database runs at the same time. The compression, "
+							"retention and other policies are maintenance jobs by default. "
+							"Setting this to -1 removes the limit.",
+							/* valueAddr= */ &ts_guc_bgw_max_maintenance_jobs,
+							/* bootValue= */ -1,
+							/* minValue= */ -1,
+							/* maxValue= */ INT_MAX,
+							/* context= */ PGC_SIGHUP,
+							/* flags= */ 0,
+							/* check_hook= */ NULL,
+							/* assign_hook= */ NULL,
+							/* show_hook= */ NULL);
+
+	DefineCustomIntVariable(/* name= */ MAKE_EXTOPTION("bgw_start_spread"),
+							/* short_desc= */ "window to spread the starts of fixed-schedule jobs",
+							/* long_desc= */
+							"The jobs with a fixed schedule start at an offset into their "
+							"scheduled slot of up to this time, which is derived from the job id, "
+							"so that jobs with the same schedule do not all start at once. The "
+							"offset is never more than the schedule interval. Setting this to 0 "
+							"starts the jobs at the beginning of their slots.",
+							/* valueAddr= */ &ts_guc_bgw_start_spread,
+							/* bootValue= */ 0,
+							/* minValue= */ 0,
+							/* maxValue= */ INT_MAX,
+							/* context= */ PGC_SIGHUP,
+							/* flags= */ GUC_UNIT_MS,
+							/* check_hook= */ NULL,
+							/* assign_hook= */ NULL,
+							/* show_hook= */ NULL);
+
+	DefineCustomIntVariable(/* name= */ MAKE_EXTOPTION("bgw_max_launches_per_second"),
+							/* short_desc= */ "max number of jobs started per second",
+							/* long_desc= */
+							"The maximum number of jobs that the scheduler of a database starts "
+							"per second. The due jobs over the limit are started in the next "
+							"seconds. Setting this to 0 removes the limit.",
+							/* valueAddr= */ &ts_guc_bgw_max_launches_per_second,
+							/* bootValue= */ 0,
+							/* minValue= */ 0,
+							/* maxValue= */ INT_MAX,
+							/* context= */ PGC_SIGHUP,
+							/* flags= */ 0,
+							/* check_hook= */ NULL,
+							/* assign_hook= */ NULL,
+							/* show_hook= */ NULL);
+
 	/* this information is useful in general on customer deployments */
 	DefineCustomBoolVariable(/* name= */ MAKE_EXTOPTION("debug_compression_path_info"),
 							 /* short_desc= */ "show various compression-related debug info",
@@ -1179,6 +1825,39 @@ _guc_init(void)
 							/* assign_hook= */ NULL,
 							/* show_hook= */ NULL);
 
+	DefineCustomIntVariable(/* name= */ MAKE_EXTOPTION("hypercore_arrow_cache_max_memory"),
+							/* short_desc= */ "max memory used by arrow data cache",
+							/* long_desc= */
+							"The max amount of memory used by the decompressed arrow "
+							"segments in the cache, in addition to the limit on the number "
+							"of entries. Setting this to 0 disables the limit.",
+							/* valueAddr= */ &ts_guc_hypercore_arrow_cache_max_memory,
+							/* bootValue= */ 262144,
+							/* minValue= */ 0,
+							/* maxValue= */ MAX_KILOBYTES,
+							/* context= */ PGC_USERSET,
+							/* flags= */ GUC_UNIT_KB,
+							/* check_hook= */ NULL,
+							/* assign_hook= */ NULL,
+							/* show_hook= */ NULL);
+
+	DefineCustomIntVariable(/* name= */ MAKE_EXTOPTION("hypercore_shared_arrow_cache_size"),
+							/* short_desc= */ "size of the arrow data cache shared by all backends",
+							/* long_desc= */
+							"The amount of shared memory used to cache the decompressed arrow "
+							"segments for all backends, in addition to the per-backend cache. "
+							"Requires PostgreSQL 17 or later. Setting this to 0 disables the "
+							"shared cache.",
+							/* valueAddr= */ &ts_guc_hypercore_shared_arrow_cache_size,
+							/* bootValue= */ 0,
+							/* minValue= */ 0,
+							/* maxValue= */ MAX_KILOBYTES,
+							/* context= */ PGC_POSTMASTER,
+							/* flags= */ GUC_UNIT_KB,
+							/* check_hook= */ NULL,
+							/* assign_hook= */ NULL,
+							/* show_hook= */ NULL);
+
 	DefineCustomIntVariable(/* name= */ MAKE_EXTOPTION("debug_bgw_scheduler_exit_status"),
 							/* short_desc= */ "exit status to use when shutting down the scheduler",
 							/* long_desc= */ "this is for debugging purposes",
@@ -37,41 +37,109 @@ extern bool ts_guc_enable_constraint_aware_append;
 extern bool ts_guc_enable_ordered_append;
 extern bool ts_guc_enable_chunk_append;
 extern bool ts_guc_enable_parallel_chunk_append;
+extern int ts_guc_chunk_append_prefetch_depth;
 extern bool ts_guc_enable_qual_propagation;
 extern bool ts_guc_enable_runtime_exclusion;
+extern bool ts_guc_enable_startup_exclusion_costing;
 extern bool ts_guc_enable_constraint_exclusion;
 extern bool ts_guc_enable_cagg_reorder_groupby;
 extern TSDLLEXPORT int ts_guc_cagg_max_individual_materializations;
 extern bool ts_guc_enable_now_constify;
+extern TSDLLEXPORT bool ts_guc_enable_planner_stats;
 extern bool ts_guc_enable_foreign_key_propagation;
 extern TSDLLEXPORT bool ts_guc_enable_osm_reads;
 #if PG16_GE
 extern TSDLLEXPORT bool ts_guc_enable_cagg_sort_pushdown;
 #endif
 extern TSDLLEXPORT bool ts_guc_enable_cagg_watermark_constify;
+extern TSDLLEXPORT bool ts_guc_enable_cagg_query_rewrite;
 extern TSDLLEXPORT bool ts_guc_enable_dml_decompression;
 extern TSDLLEXPORT bool ts_guc_enable_dml_decompression_tuple_filtering;
 extern TSDLLEXPORT bool ts_guc_enable_compressed_direct_batch_delete;
+extern TSDLLEXPORT bool ts_guc_enable_compressed_direct_batch_update;
+extern TSDLLEXPORT bool ts_guc_enable_direct_compress_insert;
 extern TSDLLEXPORT int ts_guc_max_tuples_decompressed_per_dml;
 extern TSDLLEXPORT int ts_guc_enable_transparent_decompression;
 extern TSDLLEXPORT bool ts_guc_enable_compression_wal_markers;
 extern TSDLLEXPORT bool ts_guc_enable_decompression_sorted_merge;
+extern TSDLLEXPORT bool ts_guc_enable_parallel_batch_distribution;
+extern TSDLLEXPORT bool ts_guc_enable_runtime_join_filters;
+extern TSDLLEXPORT bool ts_guc_enable_decompression_cache;
+extern TSDLLEXPORT int ts_guc_partial_agg_cache_size;
 extern TSDLLEXPORT bool ts_guc_enable_skip_scan;
+extern TSDLLEXPORT bool ts_guc_enable_compressed_skip_scan;
 extern TSDLLEXPORT bool ts_guc_enable_chunkwise_aggregation;
 extern TSDLLEXPORT bool ts_guc_enable_vectorized_aggregation;
+extern TSDLLEXPORT bool ts_guc_enable_heap_vectorized_aggregation;
 extern TSDLLEXPORT bool ts_guc_enable_custom_hashagg;
 extern bool ts_guc_restoring;
 extern int ts_guc_max_open_chunks_per_insert;
+extern int ts_guc_max_open_chunks_memory_per_insert;
 extern int ts_guc_max_cached_chunks_per_hypertable;
+
+/*
+ * How the tablespace of a new chunk is selected among the tablespaces
+ * attached to the hypertable.
+ */
+typedef enum ChunkTablespacePlacement
+{
+	CHUNK_TABLESPACE_PLACEMENT_ROUND_ROBIN = 0,
+	CHUNK_TABLESPACE_PLACEMENT_LOAD = 1,
+} ChunkTablespacePlacement;
+
+extern ChunkTablespacePlacement ts_guc_chunk_tablespace_placement;
 extern TSDLLEXPORT bool ts_guc_enable_job_execution_logging;
 extern bool ts_guc_enable_tss_callbacks;
 extern TSDLLEXPORT bool ts_guc_enable_delete_after_compression;
+extern TSDLLEXPORT bool ts_guc_enable_concurrent_reorder;
+extern TSDLLEXPORT int ts_guc_move_chunk_io_rate_limit;
 extern TSDLLEXPORT bool ts_guc_enable_merge_on_cagg_refresh;
+extern TSDLLEXPORT bool ts_guc_enable_cagg_cascade_refresh;
+extern TSDLLEXPORT bool ts_guc_enable_compressed_cagg_refresh;
 extern bool ts_guc_enable_chunk_skipping;
 extern TSDLLEXPORT bool ts_guc_enable_segmentwise_recompression;
 extern TSDLLEXPORT bool ts_guc_enable_exclusive_locking_recompression;
 extern TSDLLEXPORT bool ts_guc_enable_bool_compression;
+extern TSDLLEXPORT bool ts_guc_enable_for_compression;
+extern TSDLLEXPORT bool ts_guc_enable_alp_compression;
+extern TSDLLEXPORT bool ts_guc_enable_fsst_compression;
+extern TSDLLEXPORT bool ts_guc_enable_uuid_compression;
+extern TSDLLEXPORT bool ts_guc_enable_fixed_dictionary_compression;
+extern TSDLLEXPORT bool ts_guc_enable_jsonb_shredding;
+extern TSDLLEXPORT bool ts_guc_enable_adaptive_compression;
+
+/*
+ * The general-purpose codec that the compressor applies to the array and
+ * dictionary compressed data. The values are stored in the compressed data,
+ * so they must not change.
+ */
+typedef enum CompressionBlockCodec
+{
+	BLOCK_CODEC_NONE = 0,
+	BLOCK_CODEC_LZ4 = 1,
+	BLOCK_CODEC_ZSTD = 2,
+} CompressionBlockCodec;
+
+extern TSDLLEXPORT CompressionBlockCodec ts_guc_compression_block_codec;
+
+/*
+ * What the compressor optimizes for when it chooses between the candidate
+ * algorithms for a batch.
+ */
+typedef enum CompressionObjective
+{
+	COMPRESSION_OBJECTIVE_SIZE = 0,
+	COMPRESSION_OBJECTIVE_BALANCED = 1,
+	COMPRESSION_OBJECTIVE_SPEED = 2,
+} CompressionObjective;
+
+extern TSDLLEXPORT CompressionObjective ts_guc_compression_objective;
 extern TSDLLEXPORT int ts_guc_compression_batch_size_limit;
+extern TSDLLEXPORT int ts_guc_compression_batch_memory_limit;
+extern TSDLLEXPORT int ts_guc_compression_parallel_workers;
+extern TSDLLEXPORT int ts_guc_decompression_parallel_workers;
+extern TSDLLEXPORT bool ts_guc_compression_force_toast;
+extern TSDLLEXPORT bool ts_guc_enable_compression_bulk_wal;
 #if PG16_GE
 extern TSDLLEXPORT bool ts_guc_enable_skip_scan_for_distinct_aggregates;
 #endif
@@ -92,14 +160,23 @@ extern char *ts_telemetry_cloud;
 #endif
 
 extern TSDLLEXPORT char *ts_guc_license;
+extern bool ts_guc_enable_lazy_tsl_load;
 extern char *ts_last_tune_time;
 extern char *ts_last_tune_version;
 extern TSDLLEXPORT bool ts_guc_enable_2pc;
 extern TSDLLEXPORT bool ts_guc_enable_compression_indexscan;
+extern TSDLLEXPORT bool ts_guc_enable_compression_presorted_scan;
 extern TSDLLEXPORT bool ts_guc_enable_bulk_decompression;
+extern TSDLLEXPORT bool ts_guc_enable_decompression_stats;
 extern TSDLLEXPORT bool ts_guc_auto_sparse_indexes;
 extern TSDLLEXPORT bool ts_guc_enable_columnarscan;
 extern TSDLLEXPORT int ts_guc_bgw_log_level;
+extern int ts_guc_bgw_job_runner_lifetime;
+extern int ts_guc_bgw_max_refresh_jobs;
+extern int ts_guc_bgw_max_custom_jobs;
+extern int ts_guc_bgw_max_maintenance_jobs;
+extern int ts_guc_bgw_start_spread;
+extern int ts_guc_bgw_max_launches_per_second;
 
 /*
  * Exit code to use when scheduler exits.
@@ -159,6 +236,8 @@ typedef enum HypercoreCopyToBehavior
 extern TSDLLEXPORT HypercoreCopyToBehavior ts_guc_hypercore_copy_to_behavior;
 extern TSDLLEXPORT bool ts_guc_enable_hypercore_scankey_pushdown;
 extern TSDLLEXPORT int ts_guc_hypercore_arrow_cache_max_entries;
+extern TSDLLEXPORT int ts_guc_hypercore_arrow_cache_max_memory;
+extern TSDLLEXPORT int ts_guc_hypercore_shared_arrow_cache_size;
 
 void _guc_init(void);
 
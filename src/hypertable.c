@@ -16,6 +16,7 @@
 #include <catalog/pg_inherits.h>
 #include <catalog/pg_namespace_d.h>
 #include <catalog/pg_proc.h>
+#include <catalog/pg_tablespace_d.h>
 #include <catalog/pg_type.h>
 #include <commands/dbcommands.h>
 #include <commands/schemacmds.h>
@@ -38,6 +39,9 @@
 #include <utils/memutils.h>
 #include <utils/snapmgr.h>
 #include <utils/syscache.h>
+#ifndef WIN32
+#include <sys/statvfs.h>
+#endif
 
 #include "hypertable.h"
 
@@ -45,6 +49,7 @@
 #include "bgw_policy/policy.h"
 #include "chunk.h"
 #include "chunk_adaptive.h"
+#include "chunk_constraint.h"
 #include "copy.h"
 #include "cross_module_fn.h"
 #include "debug_assert.h"
@@ -64,6 +69,7 @@
 #include "subspace_store.h"
 #include "trigger.h"
 #include "ts_catalog/catalog.h"
+#include "ts_catalog/catalog_snapshot.h"
 #include "ts_catalog/chunk_column_stats.h"
 #include "ts_catalog/compression_settings.h"
 #include "ts_catalog/continuous_agg.h"
@@ -236,18 +242,32 @@ ts_hypertable_formdata_fill(FormData_hypertable *fd, const TupleInfo *ti)
 		heap_freetuple(tuple);
 }
 
-Hypertable *
-ts_hypertable_from_tupleinfo(const TupleInfo *ti)
+/* The counters of the chunk stores of all cached hypertables in the backend */
+static CacheUsage hypertable_chunk_store_usage = {
+	.name = "hypertable_chunk_store",
+	.entries = -1,
+	.memory = -1,
+};
+
+void
+ts_hypertable_chunk_store_get_usage(CacheUsage *usage)
+{
+	*usage = hypertable_chunk_store_usage;
+}
+
+/*
+ * Fill in the parts of the hypertable that are not read from the hypertable
+ * and dimension catalogs.
+ */
+static void
+hypertable_fill_in(Hypertable *h, MemoryContext mctx)
 {
-	Hypertable *h = MemoryContextAllocZero(ti->mctx, sizeof(Hypertable));
 	char relkind;
 
-	ts_hypertable_formdata_fill(&h->fd, ti);
-	h->main_table_relid =
-		ts_get_relation_relid(NameStr(h->fd.schema_name), NameStr(h->fd.table_name), true);
-	h->space = ts_dimension_scan(h->fd.id, h->main_table_relid, h->fd.num_dimensions, ti->mctx);
-	h->chunk_cache =
-		ts_subspace_store_init(h->space, ti->mctx, ts_guc_max_cached_chunks_per_hypertable);
+	h->chunk_cache = ts_subspace_store_init(h->space,
+											mctx,
+											ts_guc_max_cached_chunks_per_hypertable,
+											&hypertable_chunk_store_usage);
 	h->chunk_sizing_func = get_chunk_sizing_func_oid(&h->fd);
 
 	if (OidIsValid(h->main_table_relid))
@@ -256,8 +276,41 @@ ts_hypertable_from_tupleinfo(const TupleInfo *ti)
 	if (ts_guc_enable_chunk_skipping)
 	{
 		h->range_space =
-			ts_chunk_column_stats_range_space_scan(h->fd.id, h->main_table_relid, ti->mctx);
+			ts_chunk_column_stats_range_space_scan(h->fd.id, h->main_table_relid, mctx);
 	}
+}
+
+Hypertable *
+ts_hypertable_from_tupleinfo(const TupleInfo *ti)
+{
+	Hypertable *h = MemoryContextAllocZero(ti->mctx, sizeof(Hypertable));
+
+	ts_hypertable_formdata_fill(&h->fd, ti);
+	h->main_table_relid =
+		ts_get_relation_relid(NameStr(h->fd.schema_name), NameStr(h->fd.table_name), true);
+	h->space = ts_dimension_scan(h->fd.id, h->main_table_relid, h->fd.num_dimensions, ti->mctx);
+	hypertable_fill_in(h, ti->mctx);
+
+	return h;
+}
+
+/*
+ * Create the hypertable from the shared catalog snapshot, instead of scanning
+ * the hypertable and dimension catalogs.
+ */
+Hypertable *
+ts_hypertable_from_snapshot(const HypertableSnapshot *snapshot, Oid relid, MemoryContext mctx)
+{
+	Hypertable *h = MemoryContextAllocZero(mctx, sizeof(Hypertable));
+
+	h->fd = snapshot->fd;
+	h->main_table_relid = relid;
+	h->space = ts_dimension_space_from_snapshot(h->fd.id,
+												relid,
+												snapshot->dimensions,
+												snapshot->num_dimensions,
+												mctx);
+	hypertable_fill_in(h, mctx);
 
 	return h;
 }
@@ -1087,6 +1140,105 @@ hypertable_get_chunk_round_robin_index(const Hypertable *ht, const Hypercube *hc
 	return ts_dimension_get_slice_ordinal(dim, slice) + offset;
 }
 
+/*
+ * The number of the latest slices of the first open (time) dimension whose
+ * chunks make up the recent write load of the tablespaces.
+ */
+#define TABLESPACE_LOAD_RECENT_SLICES 2
+
+/*
+ * Get the free space on the file system of a tablespace, or 0 if unknown.
+ */
+static uint64
+tablespace_get_free_bytes(Oid tspc_oid)
+{
+#ifndef WIN32
+	struct statvfs fsstat;
+	char *path;
+	int ret;
+
+	if (tspc_oid == DEFAULTTABLESPACE_OID)
+		path = pstrdup("base");
+	else
+		path = psprintf("pg_tblspc/%u", tspc_oid);
+
+	/* The path is relative to the data directory, which is the working directory */
+	ret = statvfs(path, &fsstat);
+	pfree(path);
+
+	if (ret == 0)
+		return (uint64) fsstat.f_bavail * fsstat.f_frsize;
+#endif
+	return 0;
+}
+
+/*
+ * Select the tablespace with the fewest chunks in the latest time slices,
+ * which are the ones that get the inserts, and then with the most free
+ * space. The remaining ties go to the round-robin choice, given by start.
+ */
+static Tablespace *
+hypertable_select_tablespace_by_load(const Hypertable *ht, const Tablespaces *tspcs, int start)
+{
+	const Dimension *dim = hyperspace_get_open_dimension(ht->space, 0);
+	int *load = palloc0(sizeof(int) * tspcs->num_tablespaces);
+	Tablespace *selected = NULL;
+	int selected_load = 0;
+	uint64 selected_free_bytes = 0;
+
+	for (int n = 1; dim != NULL && n <= TABLESPACE_LOAD_RECENT_SLICES; n++)
+	{
+		DimensionSlice *slice = ts_dimension_slice_nth_latest_slice(dim->fd.id, n);
+		List *chunk_ids = NIL;
+		ListCell *lc;
+
+		if (slice == NULL)
+			break;
+
+		ts_chunk_constraint_scan_by_dimension_slice_to_list(slice,
+															&chunk_ids,
+															CurrentMemoryContext);
+
+		foreach (lc, chunk_ids)
+		{
+			Oid relid = ts_chunk_get_relid(lfirst_int(lc), true);
+			Oid tspc_oid;
+
+			if (!OidIsValid(relid))
+				continue;
+
+			/* Relations in the database's default tablespace store it as 0 */
+			tspc_oid = get_rel_tablespace(relid);
+			if (!OidIsValid(tspc_oid))
+				tspc_oid = MyDatabaseTableSpace;
+
+			for (int i = 0; i < tspcs->num_tablespaces; i++)
+			{
+				if (tspcs->tablespaces[i].tablespace_oid == tspc_oid)
+					load[i]++;
+			}
+		}
+	}
+
+	for (int j = 0; j < tspcs->num_tablespaces; j++)
+	{
+		int i = (start + j) % tspcs->num_tablespaces;
+		uint64 free_bytes = tablespace_get_free_bytes(tspcs->tablespaces[i].tablespace_oid);
+
+		if (selected == NULL || load[i] < selected_load ||
+			(load[i] == selected_load && free_bytes > selected_free_bytes))
+		{
+			selected = &tspcs->tablespaces[i];
+			selected_load = load[i];
+			selected_free_bytes = free_bytes;
+		}
+	}
+
+	pfree(load);
+
+	return selected;
+}
+
 /*
  * Select a tablespace to use for a given chunk.
  *
@@ -1096,6 +1248,9 @@ hypertable_get_chunk_round_robin_index(const Hypertable *ht, const Hypercube *hc
  * We try to do "sticky" selection to consistently pick the same tablespace for
  * chunks in the same closed (space) dimension. This ensures chunks in the same
  * "space" partition will live on the same disk.
+ *
+ * With the load placement, the tablespace is instead selected by the recent
+ * write load and the free space, see hypertable_select_tablespace_by_load().
  */
 Tablespace *
 ts_hypertable_select_tablespace(const Hypertable *ht, const Chunk *chunk)
@@ -1108,6 +1263,10 @@ ts_hypertable_select_tablespace(const Hypertable *ht, const Chunk *chunk)
 
 	i = hypertable_get_chunk_round_robin_index(ht, chunk->cube);
 
+	if (ts_guc_chunk_tablespace_placement == CHUNK_TABLESPACE_PLACEMENT_LOAD &&
+		tspcs->num_tablespaces > 1)
+		return hypertable_select_tablespace_by_load(ht, tspcs, i % tspcs->num_tablespaces);
+
 	/* Use the index of the slice to find the tablespace */
 	return &tspcs->tablespaces[i % tspcs->num_tablespaces];
 }
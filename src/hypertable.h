@@ -101,6 +101,9 @@ extern TSDLLEXPORT Oid ts_hypertable_permissions_check(Oid hypertable_oid, Oid u
 
 extern TSDLLEXPORT void ts_hypertable_permissions_check_by_id(int32 hypertable_id);
 extern Hypertable *ts_hypertable_from_tupleinfo(const TupleInfo *ti);
+typedef struct HypertableSnapshot HypertableSnapshot;
+extern Hypertable *ts_hypertable_from_snapshot(const HypertableSnapshot *snapshot, Oid relid,
+											   MemoryContext mctx);
 extern Hypertable *ts_resolve_hypertable_from_table_or_cagg(Cache *hcache, Oid relid,
 															bool allow_matht);
 extern int ts_hypertable_scan_with_memory_context(const char *schema, const char *table,
@@ -122,6 +125,7 @@ extern TSDLLEXPORT void ts_hypertable_drop(Hypertable *hypertable, DropBehavior
 extern int ts_hypertable_reset_associated_schema_name(const char *associated_schema);
 extern TSDLLEXPORT Oid ts_hypertable_id_to_relid(int32 hypertable_id, bool return_invalid);
 extern TSDLLEXPORT int32 ts_hypertable_relid_to_id(Oid relid);
+extern void ts_hypertable_chunk_store_get_usage(CacheUsage *usage);
 extern TSDLLEXPORT Chunk *ts_hypertable_find_chunk_for_point(const Hypertable *h,
 															 const Point *point);
 extern TSDLLEXPORT Chunk *ts_hypertable_create_chunk_for_point(const Hypertable *h,
@@ -16,9 +16,11 @@
 #include "hypertable_cache.h"
 #include "scanner.h"
 #include "ts_catalog/catalog.h"
+#include "ts_catalog/catalog_snapshot.h"
 #include "ts_catalog/tablespace.h"
 
 static void *hypertable_cache_create_entry(Cache *cache, CacheQuery *query);
+static void *hypertable_cache_update_entry(Cache *cache, CacheQuery *query);
 static void hypertable_cache_missing_error(const Cache *cache, const CacheQuery *query);
 
 typedef struct HypertableCacheQuery
@@ -39,8 +41,20 @@ typedef struct
 {
 	Oid relid;
 	Hypertable *hypertable;
+	bool stale; /* Re-read the hypertable on the next lookup */
 } HypertableCacheEntry;
 
+/*
+ * Number of entries with a hypertable that were marked stale since the cache
+ * was created. The memory of the stale hypertables can't be freed, since the
+ * cache might be pinned while they are used, so we recreate the cache when
+ * this exceeds the number of entries.
+ */
+static long hypertable_cache_num_stale = 0;
+
+/* The counters of the previous instances of the cache and the invalidations */
+static CacheUsage hypertable_cache_usage = { 0 };
+
 static bool
 hypertable_cache_valid_result(const void *result)
 {
@@ -69,6 +83,7 @@ hypertable_cache_create()
 		.flags = HASH_ELEM | HASH_CONTEXT | HASH_BLOBS,
 		.get_key = hypertable_cache_get_key,
 		.create_entry = hypertable_cache_create_entry,
+		.update_entry = hypertable_cache_update_entry,
 		.missing_error = hypertable_cache_missing_error,
 		.valid_result = hypertable_cache_valid_result,
 	};
@@ -76,6 +91,7 @@ hypertable_cache_create()
 	*cache = template;
 
 	ts_cache_init(cache);
+	hypertable_cache_num_stale = 0;
 
 	return cache;
 }
@@ -96,14 +112,26 @@ hypertable_cache_create_entry(Cache *cache, CacheQuery *query)
 {
 	HypertableCacheQuery *hq = (HypertableCacheQuery *) query;
 	HypertableCacheEntry *cache_entry = query->result;
+	uint64 snapshot_version;
 	int number_found;
 
+	cache_entry->stale = false;
+
 	if (NULL == hq->schema)
 		hq->schema = get_namespace_name(get_rel_namespace(hq->relid));
 
 	if (NULL == hq->table)
 		hq->table = get_rel_name(hq->relid);
 
+	cache_entry->hypertable = ts_catalog_snapshot_get_hypertable(hq->relid,
+																 hq->schema,
+																 hq->table,
+																 ts_cache_memory_ctx(cache));
+
+	if (cache_entry->hypertable != NULL)
+		return cache_entry;
+
+	snapshot_version = ts_catalog_snapshot_version();
 	number_found = ts_hypertable_scan_with_memory_context(hq->schema,
 														  hq->table,
 														  hypertable_tuple_found,
@@ -124,6 +152,9 @@ hypertable_cache_create_entry(Cache *cache, CacheQuery *query)
 			Assert(strncmp(NameStr(cache_entry->hypertable->fd.table_name),
 						   hq->table,
 						   NAMEDATALEN) == 0);
+			ts_catalog_snapshot_add_hypertable(hq->relid,
+											   cache_entry->hypertable,
+											   snapshot_version);
 			break;
 		default:
 			elog(ERROR, "got an unexpected number of records: %d", number_found);
@@ -133,6 +164,26 @@ hypertable_cache_create_entry(Cache *cache, CacheQuery *query)
 	return cache_entry->hypertable == NULL ? NULL : cache_entry;
 }
 
+/*
+ * Re-read a stale entry on lookup. The previous hypertable stays allocated in the cache
+ * memory context until the cache is recreated, since it might still be in
+ * use.
+ */
+static void *
+hypertable_cache_update_entry(Cache *cache, CacheQuery *query)
+{
+	HypertableCacheEntry *cache_entry = query->result;
+
+	/*
+	 * Callers that don't create entries, e.g., the planner when it looks up
+	 * the hypertables it has already seen, get the cached entry as before.
+	 */
+	if (!cache_entry->stale || (query->flags & CACHE_FLAG_NOCREATE))
+		return cache_entry;
+
+	return hypertable_cache_create_entry(cache, query);
+}
+
 static void
 hypertable_cache_missing_error(const Cache *cache, const CacheQuery *query)
 {
@@ -152,10 +203,52 @@ hypertable_cache_missing_error(const Cache *cache, const CacheQuery *query)
 void
 ts_hypertable_cache_invalidate_callback(void)
 {
+	/* Keep the counters of the current cache, which is reset */
+	hypertable_cache_usage.hits += hypertable_cache_current->stats.hits;
+	hypertable_cache_usage.misses += hypertable_cache_current->stats.misses;
+	hypertable_cache_usage.invalidations += hash_get_num_entries(hypertable_cache_current->htab);
 	ts_cache_invalidate(hypertable_cache_current);
 	hypertable_cache_current = hypertable_cache_create();
 }
 
+/*
+ * Mark the entry of the relation stale, so that it is re-read on the next
+ * lookup, instead of recreating the whole cache.
+ *
+ * Called from the relcache invalidation callback, so this must not access
+ * the catalogs.
+ */
+void
+ts_hypertable_cache_invalidate_entry(Oid relid)
+{
+	HypertableCacheEntry *entry;
+
+	if (hypertable_cache_current == NULL)
+		return;
+
+	entry = hash_search(hypertable_cache_current->htab, &relid, HASH_FIND, NULL);
+
+	if (entry == NULL || entry->stale)
+		return;
+
+	entry->stale = true;
+	hypertable_cache_usage.invalidations++;
+
+	/* Negative entries have no memory to reclaim */
+	if (entry->hypertable == NULL)
+		return;
+
+	if (++hypertable_cache_num_stale > hash_get_num_entries(hypertable_cache_current->htab))
+		ts_hypertable_cache_invalidate_callback();
+}
+
+void
+ts_hypertable_cache_get_usage(CacheUsage *usage)
+{
+	*usage = hypertable_cache_usage;
+	ts_cache_get_usage(hypertable_cache_current, usage);
+}
+
 /* Get hypertable cache entry. If the entry is not in the cache, add it. */
 Hypertable *
 ts_hypertable_cache_get_entry(Cache *const cache, const Oid relid, const unsigned int flags)
@@ -52,8 +52,10 @@ extern TSDLLEXPORT Hypertable *ts_hypertable_cache_get_entry_by_id(Cache *cache,
 																   const int32 hypertable_id);
 
 extern void ts_hypertable_cache_invalidate_callback(void);
+extern void ts_hypertable_cache_invalidate_entry(Oid relid);
 
 extern TSDLLEXPORT Cache *ts_hypertable_cache_pin(void);
+extern void ts_hypertable_cache_get_usage(CacheUsage *usage);
 
 extern void _hypertable_cache_init(void);
 extern void _hypertable_cache_fini(void);
@@ -13,6 +13,7 @@
 #include <utils/builtins.h>
 #include <utils/lsyscache.h>
 #include <utils/typcache.h>
+#include <utils/uuid.h>
 
 #include "hypertable_restrict_info.h"
 
@@ -20,6 +21,7 @@
 #include "chunk_scan.h"
 #include "dimension.h"
 #include "dimension_slice.h"
+#include "dimension_slice_index.h"
 #include "dimension_vector.h"
 #include "expression_utils.h"
 #include "guc.h"
@@ -28,12 +30,14 @@
 #include "scan_iterator.h"
 #include "ts_catalog/chunk_column_stats.h"
 #include "utils.h"
+#include "uuid.h"
 
 typedef struct DimensionValues
 {
 	List *values;
-	bool use_or; /* ORed or ANDed values */
-	Oid type;	 /* Oid type for values */
+	bool use_or;	  /* ORed or ANDed values */
+	Oid type;		  /* Oid type for values */
+	bool partitioned; /* values are results of the partitioning function */
 } DimensionValues;
 
 static DimensionRestrictInfoOpen *
@@ -132,13 +136,37 @@ dimension_restrict_info_open_add(DimensionRestrictInfoOpen *dri, StrategyNumber
 
 	foreach (item, dimvalues->values)
 	{
-		Oid restype;
-		Datum datum = ts_dimension_transform_value(dri->base.dimension,
-												   collation,
-												   PointerGetDatum(lfirst(item)),
-												   dimvalues->type,
-												   &restype);
-		int64 value = ts_time_value_to_internal_or_infinite(datum, restype);
+		Oid restype = dimvalues->type;
+		Datum datum = PointerGetDatum(lfirst(item));
+		int64 value;
+
+		if (!dimvalues->partitioned)
+		{
+			/* Only UUIDv7 values have a timestamp to partition on */
+			if (dimvalues->type == UUIDOID && !ts_uuid_is_v7(DatumGetUUIDP(datum)))
+				continue;
+
+			datum = ts_dimension_transform_value(dri->base.dimension,
+												 collation,
+												 datum,
+												 dimvalues->type,
+												 &restype);
+
+			/*
+			 * A partitioning function can map different values to the same
+			 * result, e.g. all UUIDv7 values of a millisecond, so a strict
+			 * inequality on the column does not hold for the result.
+			 */
+			if (dri->base.dimension->partitioning != NULL)
+			{
+				if (strategy == BTLessStrategyNumber)
+					strategy = BTLessEqualStrategyNumber;
+				else if (strategy == BTGreaterStrategyNumber)
+					strategy = BTGreaterEqualStrategyNumber;
+			}
+		}
+
+		value = ts_time_value_to_internal_or_infinite(datum, restype);
 
 		switch (strategy)
 		{
@@ -392,6 +420,7 @@ dimension_values_create(List *values, Oid type, bool use_or)
 	dimvalues->values = values;
 	dimvalues->use_or = use_or;
 	dimvalues->type = type;
+	dimvalues->partitioned = false;
 
 	return dimvalues;
 }
@@ -429,6 +458,95 @@ dimension_values_create_from_single_element(Const *c, bool user_or)
 								   user_or);
 }
 
+/*
+ * Add a restriction on the result of the partitioning function of an open
+ * dimension, "partfunc(col) op const", e.g. a time predicate on the
+ * timestamp of a UUIDv7 column. The value is compared with the slice ranges
+ * as is, without applying the partitioning function.
+ */
+static void
+hypertable_restrict_info_add_partfunc_expr(HypertableRestrictInfo *hri, PlannerInfo *root,
+										   OpExpr *op)
+{
+	Expr *leftop, *rightop;
+	Oid opno = op->opno;
+	FuncExpr *func;
+	Var *var;
+	DimensionRestrictInfo *dri;
+	const PartitioningInfo *partitioning;
+	TypeCacheEntry *tce;
+	int strategy;
+	Oid lefttype, righttype;
+	Expr *expr;
+	Const *c;
+	DimensionValues *dimvalues;
+
+	if (list_length(op->args) != 2 || op->opresulttype != BOOLOID)
+		return;
+
+	leftop = linitial(op->args);
+	rightop = lsecond(op->args);
+
+	if (!IsA(leftop, FuncExpr))
+	{
+		Expr *tmp = leftop;
+
+		leftop = rightop;
+		rightop = tmp;
+		opno = get_commutator(opno);
+
+		if (!IsA(leftop, FuncExpr) || !OidIsValid(opno))
+			return;
+	}
+
+	func = castNode(FuncExpr, leftop);
+
+	if (list_length(func->args) != 1 || !IsA(linitial(func->args), Var))
+		return;
+
+	var = linitial_node(Var, func->args);
+
+	if (var->varattno <= 0)
+		return;
+
+	dri = hypertable_restrict_info_get(hri, var->varattno);
+
+	if (dri == NULL || dri->dimension->type != DIMENSION_TYPE_OPEN)
+		return;
+
+	partitioning = dri->dimension->partitioning;
+
+	if (partitioning == NULL || partitioning->partfunc.func_fmgr.fn_oid != func->funcid)
+		return;
+
+	expr = (Expr *) eval_const_expressions(root, (Node *) rightop);
+
+	if (!IsA(expr, Const) || !op_strict(opno))
+		return;
+
+	c = castNode(Const, expr);
+
+	if (c->constisnull)
+		return;
+
+	tce = lookup_type_cache(partitioning->partfunc.rettype, TYPECACHE_BTREE_OPFAMILY);
+
+	if (!op_in_opfamily(opno, tce->btree_opf))
+		return;
+
+	get_op_opfamily_properties(opno, tce->btree_opf, false, &strategy, &lefttype, &righttype);
+
+	/* cross-type comparisons would need a conversion of the value */
+	if (righttype != partitioning->partfunc.rettype)
+		return;
+
+	dimvalues = dimension_values_create_from_single_element(c, false);
+	dimvalues->partitioned = true;
+
+	if (dimension_restrict_info_add(dri, strategy, c->constcollid, dimvalues))
+		hri->num_base_restrictions++;
+}
+
 static void
 hypertable_restrict_info_add_restrict_info(HypertableRestrictInfo *hri, PlannerInfo *root,
 										   RestrictInfo *ri)
@@ -468,6 +586,8 @@ hypertable_restrict_info_add_restrict_info(HypertableRestrictInfo *hri, PlannerI
 		}
 		hypertable_restrict_info_add_expr(hri, root, var, arg_value, opno, value_func, use_or);
 	}
+	else if (IsA(e, OpExpr))
+		hypertable_restrict_info_add_partfunc_expr(hri, root, castNode(OpExpr, e));
 }
 
 void
@@ -689,21 +809,29 @@ ts_hypertable_restrict_info_get_chunks(HypertableRestrictInfo *hri, Hypertable *
 	else
 	{
 		/*
-		 * Have some restrictions, enumerate the matching dimension slices.
+		 * Have some restrictions, find the matching chunks in the slice
+		 * index. If it can't handle the restrictions, enumerate the matching
+		 * dimension slices in the catalog.
 		 */
-		List *dimension_vectors = gather_restriction_dimension_vectors(hri);
-		if (list_length(dimension_vectors) == 0)
+		if (!ts_dimension_slice_index_find_chunk_ids(ht,
+													 hri->dimension_restriction,
+													 hri->num_dimensions,
+													 &chunk_ids))
 		{
-			/*
-			 * No dimension slices match for some dimension for which there is
-			 * a restriction. This means that no chunks match.
-			 */
-			chunk_ids = NIL;
-		}
-		else
-		{
-			/* Find the chunks matching these dimension ranges/slices. */
-			chunk_ids = ts_chunk_id_find_in_subspace(ht, dimension_vectors);
+			List *dimension_vectors = gather_restriction_dimension_vectors(hri);
+			if (list_length(dimension_vectors) == 0)
+			{
+				/*
+				 * No dimension slices match for some dimension for which
+				 * there is a restriction. This means that no chunks match.
+				 */
+				chunk_ids = NIL;
+			}
+			else
+			{
+				/* Find the chunks matching these dimension ranges/slices. */
+				chunk_ids = ts_chunk_id_find_in_subspace(ht, dimension_vectors);
+			}
 		}
 
 		int32 osm_chunk_id = ts_chunk_get_osm_chunk_id(ht->fd.id);
@@ -789,7 +917,9 @@ chunk_cmp_reverse(const void *c1, const void *c2)
  *
  * nested_oids is a list of lists, chunks that occupy the same time slice will be
  * in the same list. In the list [[1,2,3],[4,5,6]] chunks 1, 2 and 3 are space partitions of
- * the same time slice and 4, 5 and 6 are space partitions of the next time slice.
+ * the same time slice and 4, 5 and 6 are space partitions of the next time slice. The
+ * chunks with overlapping but different time slices are also in the same list, so that
+ * the lists never overlap in time and can be appended in order.
  *
  */
 Chunk **
@@ -798,7 +928,8 @@ ts_hypertable_restrict_info_get_chunks_ordered(HypertableRestrictInfo *hri, Hype
 											   List **nested_oids, unsigned int *num_chunks)
 {
 	List *slot_chunk_oids = NIL;
-	DimensionSlice *slice = NULL;
+	int64 group_start = 0;
+	int64 group_end = 0;
 	unsigned int i;
 
 	if (chunks == NULL)
@@ -817,21 +948,42 @@ ts_hypertable_restrict_info_get_chunks_ordered(HypertableRestrictInfo *hri, Hype
 	else
 		qsort((void *) chunks, *num_chunks, sizeof(Chunk *), chunk_cmp);
 
+	if (NULL == nested_oids)
+		return chunks;
+
 	for (i = 0; i < *num_chunks; i++)
 	{
 		Chunk *chunk = chunks[i];
+		const DimensionSlice *slice = chunk->cube->slices[0];
 
-		if (NULL != slice && ts_dimension_slice_cmp(slice, chunk->cube->slices[0]) != 0 &&
-			slot_chunk_oids != NIL)
+		/*
+		 * The chunks are sorted by the start of their time slice, so a chunk
+		 * that doesn't overlap the time range of the current group can't
+		 * overlap the previous groups either. The chunks that do overlap it
+		 * have to be merged with the group, because the groups are appended
+		 * in order. Usually, these are the space partitions of the same time
+		 * slice, but the slices can differ between the space partitions,
+		 * e.g. after the chunk time interval was changed.
+		 */
+		if (slot_chunk_oids != NIL &&
+			(reverse ? slice->fd.range_end <= group_start : slice->fd.range_start >= group_end))
 		{
 			*nested_oids = lappend(*nested_oids, slot_chunk_oids);
 			slot_chunk_oids = NIL;
 		}
 
-		if (NULL != nested_oids)
-			slot_chunk_oids = lappend_oid(slot_chunk_oids, chunk->table_id);
+		if (slot_chunk_oids == NIL)
+		{
+			group_start = slice->fd.range_start;
+			group_end = slice->fd.range_end;
+		}
+		else
+		{
+			group_start = Min(group_start, slice->fd.range_start);
+			group_end = Max(group_end, slice->fd.range_end);
+		}
 
-		slice = chunk->cube->slices[0];
+		slot_chunk_oids = lappend_oid(slot_chunk_oids, chunk->table_id);
 	}
 
 	if (slot_chunk_oids != NIL)
@@ -14,7 +14,9 @@
 #include "ts_explain.h"
 
 #include <commands/explain.h>
+#include <executor/instrument.h>
 #include <nodes/makefuncs.h>
+#include <tcop/tcopprot.h>
 #include <utils/ruleutils.h>
 
 #include "compat/compat.h"
@@ -101,3 +103,51 @@ ts_show_instrumentation_count(const char *qlabel, int which, PlanState *planstat
 			ExplainPropertyFloat(qlabel, NULL, 0.0, 0, es);
 	}
 }
+
+/*
+ * Plan the query and explain it the same way as EXPLAIN does without an
+ * ExplainOneQuery_hook, for the hooks that add to the standard output.
+ *
+ * Copied from backend/commands/explain.c since there is no such function for
+ * ExplainOneQuery before PostgreSQL 17.
+ */
+void
+ts_standard_ExplainOneQuery(Query *query, int cursorOptions, IntoClause *into, ExplainState *es,
+							const char *queryString, ParamListInfo params,
+							QueryEnvironment *queryEnv)
+{
+#if PG17_LT
+	PlannedStmt *plan;
+	instr_time planstart, planduration;
+	BufferUsage bufusage_start, bufusage;
+
+	if (es->buffers)
+		bufusage_start = pgBufferUsage;
+	INSTR_TIME_SET_CURRENT(planstart);
+
+	/* plan the query */
+	plan = pg_plan_query(query, queryString, cursorOptions, params);
+
+	INSTR_TIME_SET_CURRENT(planduration);
+	INSTR_TIME_SUBTRACT(planduration, planstart);
+
+	/* calc differences of buffer counters. */
+	if (es->buffers)
+	{
+		memset(&bufusage, 0, sizeof(BufferUsage));
+		BufferUsageAccumDiff(&bufusage, &pgBufferUsage, &bufusage_start);
+	}
+
+	/* run it (if needed) and produce output */
+	ExplainOnePlan(plan,
+				   into,
+				   es,
+				   queryString,
+				   params,
+				   queryEnv,
+				   &planduration,
+				   (es->buffers ? &bufusage : NULL));
+#else
+	standard_ExplainOneQuery(query, cursorOptions, into, es, queryString, params, queryEnv);
+#endif
+}
@@ -25,3 +25,8 @@ extern TSDLLEXPORT void ts_show_scan_qual(List *qual, const char *qlabel, PlanSt
 
 extern TSDLLEXPORT void ts_show_instrumentation_count(const char *qlabel, int which,
 													  PlanState *planstate, ExplainState *es);
+
+extern TSDLLEXPORT void ts_standard_ExplainOneQuery(Query *query, int cursorOptions,
+													IntoClause *into, ExplainState *es,
+													const char *queryString, ParamListInfo params,
+													QueryEnvironment *queryEnv);
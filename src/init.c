@@ -5,11 +5,15 @@
  */
 #include <postgres.h>
 
+#include <access/htup_details.h>
 #include <access/xact.h>
 #include <commands/extension.h>
+#include <funcapi.h>
 #include <miscadmin.h>
 #include <parser/analyze.h>
+#include <portability/instr_time.h>
 #include <storage/ipc.h>
+#include <utils/builtins.h>
 #include <utils/guc.h>
 
 #include "compat/compat.h"
@@ -35,9 +39,21 @@ extern void _cache_invalidate_fini(void);
 extern void _cache_init(void);
 extern void _cache_fini(void);
 
+extern void _catalog_snapshot_init(void);
+extern void _catalog_snapshot_fini(void);
+
+extern void _compressed_scan_stats_init(void);
+extern void _compressed_scan_stats_fini(void);
+
+extern void _lock_wait_stats_init(void);
+extern void _lock_wait_stats_fini(void);
+
 extern void _planner_init(void);
 extern void _planner_fini(void);
 
+extern void _progress_init(void);
+extern void _progress_fini(void);
+
 extern void _process_utility_init(void);
 extern void _process_utility_fini(void);
 
@@ -64,6 +80,10 @@ extern void TSDLLEXPORT _PG_init(void);
 #endif
 
 TS_FUNCTION_INFO_V1(ts_post_load_init);
+TS_FUNCTION_INFO_V1(ts_init_stats);
+
+/* Time spent in _PG_init() */
+static instr_time pg_init_time;
 
 /* Called when the backend exits */
 static void
@@ -84,6 +104,10 @@ cleanup_on_pg_proc_exit(int code, Datum arg)
 	_event_trigger_fini();
 	_planner_fini();
 	_cache_invalidate_fini();
+	_progress_fini();
+	_compressed_scan_stats_fini();
+	_lock_wait_stats_fini();
+	_catalog_snapshot_fini();
 	_hypertable_cache_fini();
 	_cache_fini();
 }
@@ -107,8 +131,15 @@ _PG_init(void)
 	if (init_done)
 		return;
 
+	instr_time start;
+	INSTR_TIME_SET_CURRENT(start);
+
 	_cache_init();
 	_hypertable_cache_init();
+	_catalog_snapshot_init();
+	_progress_init();
+	_compressed_scan_stats_init();
+	_lock_wait_stats_init();
 	_cache_invalidate_init();
 	_planner_init();
 	_constraint_aware_append_init();
@@ -127,6 +158,9 @@ _PG_init(void)
 	/* Register a cleanup function to be called when the backend exits */
 	on_proc_exit(cleanup_on_pg_proc_exit, 0);
 	init_done = true;
+
+	INSTR_TIME_SET_CURRENT(pg_init_time);
+	INSTR_TIME_SUBTRACT(pg_init_time, start);
 }
 
 TSDLLEXPORT Datum
@@ -136,8 +170,66 @@ ts_post_load_init(PG_FUNCTION_ARGS)
 	 * Unfortunately, if we load the tsl during _PG_init parallel workers try
 	 * to load the tsl before timescale itself, causing link-time errors. To
 	 * prevent this we defer loading until here.
+	 *
+	 * With lazy loading, we defer it further until the first query or command
+	 * that can use the tsl, see callers of ts_license_enable_module_loading().
 	 */
-	ts_license_enable_module_loading();
+	if (!ts_guc_enable_lazy_tsl_load)
+		ts_license_enable_module_loading();
 
 	PG_RETURN_VOID();
 }
+
+/*
+ * Return the time in milliseconds spent in initializing the extension in the
+ * current backend: the init function of the library, and loading and
+ * initializing the TSL module. The TSL times are NULL if the module is not
+ * loaded (yet).
+ */
+Datum
+ts_init_stats(PG_FUNCTION_ARGS)
+{
+	static const char *const stage_names[] = { "init", "tsl_load", "tsl_init" };
+	FuncCallContext *funcctx;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		funcctx->max_calls = lengthof(stage_names);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		instr_time times[lengthof(stage_names)];
+		const bool tsl_loaded = ts_license_get_tsl_load_times(&times[1], &times[2]);
+		Datum values[2];
+		bool nulls[2] = { false };
+
+		times[0] = pg_init_time;
+		values[0] = CStringGetTextDatum(stage_names[funcctx->call_cntr]);
+		values[1] = Float8GetDatum(INSTR_TIME_GET_MILLISEC(times[funcctx->call_cntr]));
+		nulls[1] = funcctx->call_cntr > 0 && !tsl_loaded;
+
+		Assert(funcctx->tuple_desc->natts == lengthof(values));
+
+		HeapTuple tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
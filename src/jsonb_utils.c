@@ -65,6 +65,8 @@ get_convert_func(Oid typeid)
 			return int4_numeric;
 		case INT8OID:
 			return int8_numeric;
+		case FLOAT8OID:
+			return float8_numeric;
 		default:
 			return NULL;
 	}
@@ -83,6 +85,7 @@ ts_jsonb_set_value_by_type(JsonbValue *value, Oid typeid, Datum datum)
 		case INT2OID:
 		case INT4OID:
 		case INT8OID:
+		case FLOAT8OID:
 		case NUMERICOID:
 			func = get_convert_func(typeid);
 			value->type = jbvNumeric;
@@ -117,6 +120,15 @@ ts_jsonb_add_int64(JsonbParseState *state, const char *key, const int64 int_valu
 	ts_jsonb_add_value(state, key, &json_value);
 }
 
+void
+ts_jsonb_add_float8(JsonbParseState *state, const char *key, const float8 float_value)
+{
+	JsonbValue json_value;
+
+	ts_jsonb_set_value_by_type(&json_value, FLOAT8OID, Float8GetDatum(float_value));
+	ts_jsonb_add_value(state, key, &json_value);
+}
+
 void
 ts_jsonb_add_interval(JsonbParseState *state, const char *key, Interval *interval)
 {
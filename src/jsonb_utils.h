@@ -21,6 +21,8 @@ extern TSDLLEXPORT void ts_jsonb_add_int32(JsonbParseState *state, const char *k
 										   const int32 value);
 extern TSDLLEXPORT void ts_jsonb_add_int64(JsonbParseState *state, const char *key,
 										   const int64 value);
+extern TSDLLEXPORT void ts_jsonb_add_float8(JsonbParseState *state, const char *key,
+											const float8 value);
 extern TSDLLEXPORT void ts_jsonb_set_value_by_type(JsonbValue *value, Oid typeid, Datum datum);
 
 extern void ts_jsonb_add_value(JsonbParseState *state, const char *key, JsonbValue *value);
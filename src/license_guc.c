@@ -7,6 +7,7 @@
 #include <catalog/pg_authid.h>
 #include <fmgr.h>
 #include <miscadmin.h>
+#include <portability/instr_time.h>
 #include <utils/acl.h>
 #include <utils/builtins.h>
 #include <utils/guc.h>
@@ -22,6 +23,10 @@ static void *tsl_handle = NULL;
 static PGFunction tsl_init_fn = NULL;
 static bool tsl_register_proc_exit = false;
 
+/* Time spent in loading the TSL module and in its init function */
+static instr_time tsl_load_time;
+static instr_time tsl_init_time;
+
 /*
  * License Functions.
  *
@@ -53,6 +58,11 @@ static bool tsl_register_proc_exit = false;
  * loaded. In order to ensure that the initial value doesn't break this, we
  * disable loading submodules until the post_load_init.
  *
+ * With timescaledb.enable_lazy_tsl_load, the loading is enabled even later,
+ * when the backend first plans a query or runs a command that can use the
+ * submodule, so that the connections that never do don't pay for loading and
+ * initializing it.
+ *
  * No license change from user session is allowed. License can be changed only
  * if it is set from server configuration file or the server command line.
  */
@@ -82,6 +92,16 @@ ts_license_is_apache(void)
 	return license_type_of(ts_guc_license) == LICENSE_APACHE;
 }
 
+/*
+ * Check if the submodule can be loaded already. Until then, the
+ * cross-module functions are the defaults.
+ */
+bool
+ts_license_is_module_loading_enabled(void)
+{
+	return load_enabled;
+}
+
 TSDLLEXPORT void
 ts_license_enable_module_loading(void)
 {
@@ -120,13 +140,17 @@ tsl_module_load(void)
 {
 	void *function;
 	void *handle;
+	instr_time start;
 
 	if (tsl_handle != NULL)
 		return true;
 
+	INSTR_TIME_SET_CURRENT(start);
 	function = load_external_function(EXTENSION_TSL_SO, "ts_module_init", false, &handle);
 	if (function == NULL || handle == NULL)
 		return false;
+	INSTR_TIME_SET_CURRENT(tsl_load_time);
+	INSTR_TIME_SUBTRACT(tsl_load_time, start);
 	tsl_init_fn = function;
 	tsl_handle = handle;
 	/* the on_proc_exit callback is registered by the tsl_init_fn after load */
@@ -137,9 +161,16 @@ tsl_module_load(void)
 static void
 tsl_module_init(void)
 {
+	instr_time start;
+	instr_time duration;
+
 	Assert(tsl_handle != NULL);
 	Assert(tsl_init_fn != NULL);
+	INSTR_TIME_SET_CURRENT(start);
 	DirectFunctionCall1(tsl_init_fn, BoolGetDatum(tsl_register_proc_exit));
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	INSTR_TIME_ADD(tsl_init_time, duration);
 	/* register the on_proc_exit only when the module is reloaded */
 	if (tsl_register_proc_exit)
 		tsl_register_proc_exit = false;
@@ -205,3 +236,16 @@ ts_license_guc_assign_hook(const char *newval, void *extra)
 	if (load_enabled && license_type_of(newval) == LICENSE_TIMESCALE)
 		tsl_module_init();
 }
+
+/*
+ * Get the time spent in loading and initializing the TSL module. Returns false
+ * if the module is not loaded in this backend.
+ */
+bool
+ts_license_get_tsl_load_times(instr_time *load_time, instr_time *init_time)
+{
+	*load_time = tsl_load_time;
+	*init_time = tsl_init_time;
+
+	return tsl_handle != NULL;
+}
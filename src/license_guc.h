@@ -7,6 +7,7 @@
 
 #include <postgres.h>
 #include <fmgr.h>
+#include <portability/instr_time.h>
 #include <utils/guc.h>
 
 #include <export.h>
@@ -28,4 +29,6 @@ extern bool ts_license_guc_check_hook(char **newval, void **extra, GucSource sou
 extern void ts_license_guc_assign_hook(const char *newval, void *extra);
 
 extern TSDLLEXPORT void ts_license_enable_module_loading(void);
+extern bool ts_license_is_module_loading_enabled(void);
 extern bool ts_license_is_apache(void);
+extern bool ts_license_get_tsl_load_times(instr_time *load_time, instr_time *init_time);
@@ -0,0 +1,102 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Shared memory for the snapshot of the hypertable catalog, so that new
+ * backends don't need to scan the catalog to build their hypertable cache.
+ * The extension stores and reads the entries, the loader only allocates the
+ * shared hash table and the catalog change counter, since shared memory can
+ * only be set up in shared_preload_libraries.
+ */
+#include <postgres.h>
+#include <fmgr.h>
+#include <storage/shmem.h>
+#include <utils/guc.h>
+
+#include "extension_constants.h"
+#include "loader/catalog_snapshot.h"
+
+#define CATALOG_SNAPSHOT_SHMEM_NAME "ts_catalog_snapshot_shmem"
+#define CATALOG_SNAPSHOT_HASH_NAME "timescaledb catalog snapshot hash"
+
+/* Number of hypertables in the snapshot, zero disables it */
+int ts_guc_catalog_snapshot_size = 0;
+
+typedef struct CatalogSnapshotShared
+{
+	LWLock *lock;
+	pg_atomic_uint64 version;
+} CatalogSnapshotShared;
+
+static CatalogSnapshotRendezvous rendezvous;
+
+void
+ts_catalog_snapshot_setup_gucs(void)
+{
+	DefineCustomIntVariable(MAKE_EXTOPTION("catalog_snapshot_size"),
+							"Number of hypertables in the shared catalog snapshot",
+							"Share the hypertable and dimension metadata between the "
+							"backends, so that new backends don't scan the catalog on the "
+							"first access to a hypertable. Zero disables the snapshot",
+							&ts_guc_catalog_snapshot_size,
+							0,
+							0,
+							1000000,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+}
+
+void
+ts_catalog_snapshot_shmem_alloc(void)
+{
+	if (ts_guc_catalog_snapshot_size == 0)
+		return;
+
+	RequestAddinShmemSpace(
+		add_size(sizeof(CatalogSnapshotShared),
+				 hash_estimate_size(ts_guc_catalog_snapshot_size, sizeof(CatalogSnapshotEntry))));
+	RequestNamedLWLockTranche(CATALOG_SNAPSHOT_LWLOCK_TRANCHE_NAME, 1);
+}
+
+void
+ts_catalog_snapshot_shmem_startup(void)
+{
+	CatalogSnapshotRendezvous **rendezvous_ptr;
+	CatalogSnapshotShared *shared;
+	HASHCTL hash_info = {
+		.keysize = sizeof(CatalogSnapshotKey),
+		.entrysize = sizeof(CatalogSnapshotEntry),
+	};
+	bool found;
+
+	if (ts_guc_catalog_snapshot_size == 0)
+		return;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	shared = ShmemInitStruct(CATALOG_SNAPSHOT_SHMEM_NAME, sizeof(CatalogSnapshotShared), &found);
+	if (!found)
+	{
+		shared->lock = &(GetNamedLWLockTranche(CATALOG_SNAPSHOT_LWLOCK_TRANCHE_NAME))->lock;
+		pg_atomic_init_u64(&shared->version, 0);
+	}
+
+	rendezvous.entries = ShmemInitHash(CATALOG_SNAPSHOT_HASH_NAME,
+									   ts_guc_catalog_snapshot_size,
+									   ts_guc_catalog_snapshot_size,
+									   &hash_info,
+									   HASH_ELEM | HASH_BLOBS);
+	LWLockRelease(AddinShmemInitLock);
+
+	rendezvous.lock = shared->lock;
+	rendezvous.version = &shared->version;
+
+	rendezvous_ptr =
+		(CatalogSnapshotRendezvous **) find_rendezvous_variable(RENDEZVOUS_CATALOG_SNAPSHOT);
+	*rendezvous_ptr = &rendezvous;
+}
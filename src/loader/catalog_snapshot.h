@@ -0,0 +1,47 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <port/atomics.h>
+#include <storage/lwlock.h>
+#include <utils/hsearch.h>
+
+#define RENDEZVOUS_CATALOG_SNAPSHOT "ts_catalog_snapshot"
+#define CATALOG_SNAPSHOT_LWLOCK_TRANCHE_NAME "ts_catalog_snapshot_lwlock_tranche"
+
+/*
+ * Size of the data of an entry. The loader doesn't know the layout of the
+ * data, which is defined by the extension version that stores it.
+ */
+#define CATALOG_SNAPSHOT_DATA_SIZE 2048
+
+typedef struct CatalogSnapshotKey
+{
+	Oid database_id;
+	Oid relid;
+} CatalogSnapshotKey;
+
+typedef struct CatalogSnapshotEntry
+{
+	CatalogSnapshotKey key;
+	uint64 version; /* Catalog change counter before the data was read */
+	uint32 layout;	/* Layout of the data, set by the extension */
+	char data[CATALOG_SNAPSHOT_DATA_SIZE];
+} CatalogSnapshotEntry;
+
+typedef struct CatalogSnapshotRendezvous
+{
+	LWLock *lock;
+	pg_atomic_uint64 *version;
+	HTAB *entries;
+} CatalogSnapshotRendezvous;
+
+extern int ts_guc_catalog_snapshot_size;
+
+extern void ts_catalog_snapshot_setup_gucs(void);
+extern void ts_catalog_snapshot_shmem_alloc(void);
+extern void ts_catalog_snapshot_shmem_startup(void);
@@ -0,0 +1,74 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Shared memory for the cumulative statistics of the scans of compressed
+ * data, summed over all backends. The extension updates and reads the
+ * entries, the loader only allocates the hash table, since shared memory can
+ * only be set up in shared_preload_libraries.
+ */
+#include <postgres.h>
+#include <fmgr.h>
+#include <storage/shmem.h>
+
+#include "loader/compressed_scan_stats.h"
+
+/*
+ * The number of entries, for the hypertables and their columns of all
+ * databases. The statistics of new hypertables and columns are not kept when
+ * the table is full, until it is reset.
+ */
+#define COMPRESSED_SCAN_STATS_HASH_SIZE 4096
+
+static CompressedScanStatsRendezvous rendezvous;
+
+void
+ts_compressed_scan_stats_shmem_alloc(void)
+{
+	Size size =
+		hash_estimate_size(COMPRESSED_SCAN_STATS_HASH_SIZE, sizeof(CompressedScanStatsEntry));
+	RequestAddinShmemSpace(add_size(size, sizeof(LWLock *)));
+	RequestNamedLWLockTranche(COMPRESSED_SCAN_STATS_LWLOCK_TRANCHE_NAME, 1);
+}
+
+void
+ts_compressed_scan_stats_shmem_startup(void)
+{
+	CompressedScanStatsRendezvous **rendezvous_ptr;
+	HASHCTL hash_info;
+	HTAB *entries;
+	LWLock **lock;
+	bool found;
+
+	hash_info.keysize = sizeof(CompressedScanStatsKey);
+	hash_info.entrysize = sizeof(CompressedScanStatsEntry);
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	/*
+	 * GetNamedLWLockTranche must only be run once, see
+	 * ts_function_telemetry_shmem_startup().
+	 */
+	lock = (LWLock **) ShmemInitStruct("compressed_scan_stats_detect_first_run",
+									   sizeof(LWLock *),
+									   &found);
+	if (!found)
+		*lock = &(GetNamedLWLockTranche(COMPRESSED_SCAN_STATS_LWLOCK_TRANCHE_NAME))->lock;
+
+	entries = ShmemInitHash("timescaledb compressed scan stats hash",
+							COMPRESSED_SCAN_STATS_HASH_SIZE,
+							COMPRESSED_SCAN_STATS_HASH_SIZE,
+							&hash_info,
+							HASH_ELEM | HASH_BLOBS);
+	LWLockRelease(AddinShmemInitLock);
+
+	rendezvous.lock = *lock;
+	rendezvous.entries = entries;
+
+	rendezvous_ptr = (CompressedScanStatsRendezvous **) find_rendezvous_variable(
+		RENDEZVOUS_COMPRESSED_SCAN_STATS);
+	*rendezvous_ptr = &rendezvous;
+}
@@ -0,0 +1,47 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <port/atomics.h>
+#include <storage/lwlock.h>
+#include <utils/hsearch.h>
+
+#define RENDEZVOUS_COMPRESSED_SCAN_STATS "ts_compressed_scan_stats"
+#define COMPRESSED_SCAN_STATS_LWLOCK_TRANCHE_NAME "ts_compressed_scan_stats_lwlock_tranche"
+
+/* Number of counters of an entry. The counters are defined by the extension. */
+#define TS_COMPRESSED_SCAN_STATS_NUM_COUNTERS 16
+
+/*
+ * The statistics are kept for each hypertable and for each of its columns.
+ * The column name is empty for the entry of the hypertable.
+ */
+typedef struct CompressedScanStatsKey
+{
+	Oid database_id;
+	int32 hypertable_id;
+	NameData column_name;
+} CompressedScanStatsKey;
+
+typedef struct CompressedScanStatsEntry
+{
+	CompressedScanStatsKey key;
+	pg_atomic_uint64 counters[TS_COMPRESSED_SCAN_STATS_NUM_COUNTERS];
+} CompressedScanStatsEntry;
+
+/*
+ * The counters are added under a shared lock, the entries are added and
+ * removed under an exclusive lock.
+ */
+typedef struct CompressedScanStatsRendezvous
+{
+	LWLock *lock;
+	HTAB *entries;
+} CompressedScanStatsRendezvous;
+
+extern void ts_compressed_scan_stats_shmem_alloc(void);
+extern void ts_compressed_scan_stats_shmem_startup(void);
@@ -0,0 +1,62 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Shared memory for the counts of the modified rows of the hypertables with
+ * event-driven continuous aggregate refresh policies, so that the backends
+ * can wake up the scheduler when there is enough to refresh. The extension
+ * updates and reads the entries, the loader only allocates the shared hash
+ * table, since shared memory can only be set up in shared_preload_libraries.
+ */
+#include <postgres.h>
+#include <fmgr.h>
+#include <storage/shmem.h>
+
+#include "loader/invalidation_wakeup.h"
+
+#define INVALIDATION_WAKEUP_SHMEM_NAME "ts_invalidation_wakeup_shmem"
+#define INVALIDATION_WAKEUP_HASH_NAME "timescaledb invalidation wakeup hash"
+
+static InvalidationWakeupRendezvous rendezvous;
+
+void
+ts_invalidation_wakeup_shmem_alloc(void)
+{
+	RequestAddinShmemSpace(add_size(sizeof(LWLock *),
+									hash_estimate_size(INVALIDATION_WAKEUP_MAX_ENTRIES,
+													   sizeof(InvalidationWakeupEntry))));
+	RequestNamedLWLockTranche(INVALIDATION_WAKEUP_LWLOCK_TRANCHE_NAME, 1);
+}
+
+void
+ts_invalidation_wakeup_shmem_startup(void)
+{
+	InvalidationWakeupRendezvous **rendezvous_ptr;
+	LWLock **lock;
+	HASHCTL hash_info = {
+		.keysize = sizeof(InvalidationWakeupKey),
+		.entrysize = sizeof(InvalidationWakeupEntry),
+	};
+	bool found;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	lock = ShmemInitStruct(INVALIDATION_WAKEUP_SHMEM_NAME, sizeof(LWLock *), &found);
+	if (!found)
+		*lock = &(GetNamedLWLockTranche(INVALIDATION_WAKEUP_LWLOCK_TRANCHE_NAME))->lock;
+
+	rendezvous.entries = ShmemInitHash(INVALIDATION_WAKEUP_HASH_NAME,
+									   INVALIDATION_WAKEUP_MAX_ENTRIES,
+									   INVALIDATION_WAKEUP_MAX_ENTRIES,
+									   &hash_info,
+									   HASH_ELEM | HASH_BLOBS);
+	LWLockRelease(AddinShmemInitLock);
+
+	rendezvous.lock = *lock;
+
+	rendezvous_ptr =
+		(InvalidationWakeupRendezvous **) find_rendezvous_variable(RENDEZVOUS_INVALIDATION_WAKEUP);
+	*rendezvous_ptr = &rendezvous;
+}
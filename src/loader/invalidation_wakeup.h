@@ -0,0 +1,48 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <port/atomics.h>
+#include <storage/latch.h>
+#include <storage/lwlock.h>
+#include <utils/hsearch.h>
+
+#define RENDEZVOUS_INVALIDATION_WAKEUP "ts_invalidation_wakeup"
+#define INVALIDATION_WAKEUP_LWLOCK_TRANCHE_NAME "ts_invalidation_wakeup_lwlock_tranche"
+
+/* Number of hypertables with event-driven refresh policies in all databases */
+#define INVALIDATION_WAKEUP_MAX_ENTRIES 1024
+
+typedef struct InvalidationWakeupKey
+{
+	Oid database_id;
+	int32 hypertable_id;
+} InvalidationWakeupKey;
+
+/*
+ * The modified rows of a hypertable that has continuous aggregates with
+ * event-driven refresh policies, and the latch of the scheduler to set when
+ * the number of rows reaches the wakeup count. The entries are added and
+ * removed by the scheduler of the database, and the counts are updated by the
+ * backends that modify the hypertable.
+ */
+typedef struct InvalidationWakeupEntry
+{
+	InvalidationWakeupKey key;
+	pg_atomic_uint64 rows;		  /* Only increases */
+	pg_atomic_uint64 wakeup_rows; /* Set the latch when rows reaches this */
+	Latch *latch;
+} InvalidationWakeupEntry;
+
+typedef struct InvalidationWakeupRendezvous
+{
+	LWLock *lock;
+	HTAB *entries;
+} InvalidationWakeupRendezvous;
+
+extern void ts_invalidation_wakeup_shmem_alloc(void);
+extern void ts_invalidation_wakeup_shmem_startup(void);
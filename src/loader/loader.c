@@ -38,9 +38,14 @@
 #include "loader/bgw_interface.h"
 #include "loader/bgw_launcher.h"
 #include "loader/bgw_message_queue.h"
+#include "loader/catalog_snapshot.h"
+#include "loader/compressed_scan_stats.h"
 #include "loader/function_telemetry.h"
+#include "loader/invalidation_wakeup.h"
 #include "loader/loader.h"
+#include "loader/lock_wait_stats.h"
 #include "loader/lwlocks.h"
+#include "loader/progress.h"
 
 /*
  * Loading process:
@@ -579,6 +584,11 @@ timescaledb_shmem_startup_hook(void)
 	ts_bgw_message_queue_shmem_startup();
 	ts_lwlocks_shmem_startup();
 	ts_function_telemetry_shmem_startup();
+	ts_catalog_snapshot_shmem_startup();
+	ts_progress_shmem_startup();
+	ts_compressed_scan_stats_shmem_startup();
+	ts_lock_wait_stats_shmem_startup();
+	ts_invalidation_wakeup_shmem_startup();
 }
 
 /*
@@ -596,6 +606,11 @@ timescaledb_shmem_request_hook(void)
 	ts_bgw_message_queue_alloc();
 	ts_lwlocks_shmem_alloc();
 	ts_function_telemetry_shmem_alloc();
+	ts_catalog_snapshot_shmem_alloc();
+	ts_progress_shmem_alloc();
+	ts_compressed_scan_stats_shmem_alloc();
+	ts_lock_wait_stats_shmem_alloc();
+	ts_invalidation_wakeup_shmem_alloc();
 }
 
 static void
@@ -619,6 +634,7 @@ _PG_init(void)
 
 	ts_bgw_cluster_launcher_init();
 	ts_bgw_counter_setup_gucs();
+	ts_catalog_snapshot_setup_gucs();
 	ts_bgw_interface_register_api_version();
 
 	/* This is a safety-valve variable to prevent loading the full extension */
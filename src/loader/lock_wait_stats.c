@@ -0,0 +1,46 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Shared memory for the cumulative statistics of the waits for the locks of
+ * the extension, summed over all backends. The extension updates and reads
+ * the counters, the loader only allocates them, since shared memory can only
+ * be set up in shared_preload_libraries.
+ */
+#include <postgres.h>
+#include <fmgr.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+
+#include "loader/lock_wait_stats.h"
+
+void
+ts_lock_wait_stats_shmem_alloc(void)
+{
+	RequestAddinShmemSpace(sizeof(LockWaitStatsRendezvous));
+}
+
+void
+ts_lock_wait_stats_shmem_startup(void)
+{
+	LockWaitStatsRendezvous **rendezvous_ptr;
+	LockWaitStatsRendezvous *stats;
+	bool found;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	stats = ShmemInitStruct("timescaledb lock wait stats", sizeof(LockWaitStatsRendezvous), &found);
+	if (!found)
+	{
+		for (int i = 0; i < TS_LOCK_WAIT_STATS_NUM_LOCKS; i++)
+			for (int j = 0; j < TS_LOCK_WAIT_STATS_NUM_COUNTERS; j++)
+				pg_atomic_init_u64(&stats->counters[i][j], 0);
+	}
+	LWLockRelease(AddinShmemInitLock);
+
+	rendezvous_ptr =
+		(LockWaitStatsRendezvous **) find_rendezvous_variable(RENDEZVOUS_LOCK_WAIT_STATS);
+	*rendezvous_ptr = stats;
+}
@@ -0,0 +1,30 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <port/atomics.h>
+
+#define RENDEZVOUS_LOCK_WAIT_STATS "ts_lock_wait_stats"
+
+/*
+ * Number of locks and of the counters of each lock. The locks and counters
+ * are defined by the extension.
+ */
+#define TS_LOCK_WAIT_STATS_NUM_LOCKS 16
+#define TS_LOCK_WAIT_STATS_NUM_COUNTERS 8
+
+/*
+ * The counters of the locks of all databases. The counters are only changed
+ * with atomic operations, so there is no lock.
+ */
+typedef struct LockWaitStatsRendezvous
+{
+	pg_atomic_uint64 counters[TS_LOCK_WAIT_STATS_NUM_LOCKS][TS_LOCK_WAIT_STATS_NUM_COUNTERS];
+} LockWaitStatsRendezvous;
+
+extern void ts_lock_wait_stats_shmem_alloc(void);
+extern void ts_lock_wait_stats_shmem_startup(void);
@@ -0,0 +1,55 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Shared memory for the progress of the long-running commands of the
+ * extension, e.g., the refresh of continuous aggregates, with one slot per
+ * backend. The extension writes and reads the slots, the loader only
+ * allocates them, since shared memory can only be set up in
+ * shared_preload_libraries.
+ */
+#include <postgres.h>
+#include <fmgr.h>
+#include <miscadmin.h>
+#include <storage/shmem.h>
+
+#include "loader/progress.h"
+
+#define PROGRESS_SHMEM_NAME "ts_progress_shmem"
+
+static TsProgressRendezvous rendezvous;
+
+static Size
+progress_shmem_size(void)
+{
+	return mul_size(MaxBackends, sizeof(TsProgressSlot));
+}
+
+void
+ts_progress_shmem_alloc(void)
+{
+	RequestAddinShmemSpace(progress_shmem_size());
+}
+
+void
+ts_progress_shmem_startup(void)
+{
+	TsProgressRendezvous **rendezvous_ptr;
+	TsProgressSlot *slots;
+	bool found;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	slots = ShmemInitStruct(PROGRESS_SHMEM_NAME, progress_shmem_size(), &found);
+	if (!found)
+		MemSet(slots, 0, progress_shmem_size());
+	LWLockRelease(AddinShmemInitLock);
+
+	rendezvous.num_slots = MaxBackends;
+	rendezvous.slots = slots;
+
+	rendezvous_ptr = (TsProgressRendezvous **) find_rendezvous_variable(RENDEZVOUS_PROGRESS);
+	*rendezvous_ptr = &rendezvous;
+}
@@ -0,0 +1,42 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#define RENDEZVOUS_PROGRESS "ts_progress"
+
+/* Number of parameters of a command, the same as for the PostgreSQL commands */
+#define TS_PROGRESS_NUM_PARAMS 20
+
+/*
+ * The progress of the command running in a backend, like the progress
+ * parameters in the backend status of PostgreSQL, which are only available
+ * for the PostgreSQL commands. The loader doesn't know the commands and their
+ * parameters, which are defined by the extension.
+ *
+ * The backend only writes its own slot. The change count is odd while the
+ * slot is written, so that readers can retry to get a consistent copy.
+ */
+typedef struct TsProgressSlot
+{
+	int changecount;
+	int command; /* Zero if no command is running */
+	int pid;
+	Oid database_id;
+	Oid userid;
+	Oid relid;
+	int64 params[TS_PROGRESS_NUM_PARAMS];
+} TsProgressSlot;
+
+typedef struct TsProgressRendezvous
+{
+	int num_slots;
+	TsProgressSlot *slots; /* Indexed by the process number of the backend */
+} TsProgressRendezvous;
+
+extern void ts_progress_shmem_alloc(void);
+extern void ts_progress_shmem_startup(void);
@@ -0,0 +1,259 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Cumulative statistics of the waits for the locks that serialize chunk
+ * creation, the changes of the catalog and compression, summed over all
+ * backends since the server start or the last reset.
+ *
+ * The lock manager reports the waits for the heavyweight locks in
+ * pg_stat_activity as waits for a relation or a tuple, and overrides any
+ * wait event that is set while it sleeps, so the waits are counted here to
+ * tell apart the locks of the extension. A lock is first tried without
+ * waiting, and only if that fails, the time of the wait is measured. The
+ * counters are allocated by the loader, without it nothing is counted.
+ */
+#include <postgres.h>
+#include <access/htup_details.h>
+#include <funcapi.h>
+#include <miscadmin.h>
+#include <storage/lmgr.h>
+#include <utils/builtins.h>
+
+#include "extension.h"
+#include "jsonb_utils.h"
+#include "loader/lock_wait_stats.h"
+#include "lock_wait_stats.h"
+#include "ts_catalog/catalog.h"
+#include "utils.h"
+
+StaticAssertDecl(LOCK_WAIT_STATS_NUM_LOCKS <= TS_LOCK_WAIT_STATS_NUM_LOCKS,
+				 "too many locks for the shared memory counters");
+StaticAssertDecl(LOCK_WAIT_STATS_NUM_COUNTERS <= TS_LOCK_WAIT_STATS_NUM_COUNTERS,
+				 "too many lock wait counters for the shared memory counters");
+
+static const char *const lock_names[LOCK_WAIT_STATS_NUM_LOCKS] = {
+	[LOCK_WAIT_STATS_CHUNK_CREATE] = "chunk_create",
+	[LOCK_WAIT_STATS_DIMENSION_SLICE] = "dimension_slice",
+	[LOCK_WAIT_STATS_INVALIDATION_THRESHOLD] = "invalidation_threshold",
+	[LOCK_WAIT_STATS_COMPRESSION] = "compression",
+	[LOCK_WAIT_STATS_CATALOG_TUPLE] = "catalog_tuple",
+};
+
+static LockWaitStatsRendezvous *lock_wait_stats = NULL;
+
+/*
+ * Count an acquisition of the lock. The start of the wait is NULL if the lock
+ * was granted without waiting.
+ */
+void
+ts_lock_wait_stats_report(LockWaitStatsLock lock, const instr_time *wait_start)
+{
+	pg_atomic_uint64 *counters;
+	instr_time duration;
+	uint64 wait_time;
+	uint64 max_wait_time;
+
+	if (lock_wait_stats == NULL)
+		return;
+
+	Assert(lock < LOCK_WAIT_STATS_NUM_LOCKS);
+	counters = lock_wait_stats->counters[lock];
+	pg_atomic_fetch_add_u64(&counters[LOCK_WAIT_STATS_ACQUIRED], 1);
+
+	if (wait_start == NULL)
+		return;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, *wait_start);
+	wait_time = INSTR_TIME_GET_MICROSEC(duration);
+
+	pg_atomic_fetch_add_u64(&counters[LOCK_WAIT_STATS_WAITS], 1);
+	pg_atomic_fetch_add_u64(&counters[LOCK_WAIT_STATS_WAIT_TIME], wait_time);
+
+	/* The compare and exchange updates the expected value on failure */
+	max_wait_time = pg_atomic_read_u64(&counters[LOCK_WAIT_STATS_MAX_WAIT_TIME]);
+	while (wait_time > max_wait_time &&
+		   !pg_atomic_compare_exchange_u64(&counters[LOCK_WAIT_STATS_MAX_WAIT_TIME],
+										   &max_wait_time,
+										   wait_time))
+		;
+}
+
+/*
+ * Lock a relation like LockRelationOid() and count the wait for it.
+ */
+void
+ts_lock_wait_stats_lock_relation(LockWaitStatsLock lock, Oid relid, LOCKMODE lockmode)
+{
+	instr_time wait_start;
+
+	if (lock_wait_stats == NULL)
+	{
+		LockRelationOid(relid, lockmode);
+		return;
+	}
+
+	if (ConditionalLockRelationOid(relid, lockmode))
+	{
+		ts_lock_wait_stats_report(lock, NULL);
+		return;
+	}
+
+	INSTR_TIME_SET_CURRENT(wait_start);
+	LockRelationOid(relid, lockmode);
+	ts_lock_wait_stats_report(lock, &wait_start);
+}
+
+/*
+ * The lock that the tuple locks on a catalog table are counted for.
+ */
+LockWaitStatsLock
+ts_lock_wait_stats_catalog_tuple_lock(Oid relid)
+{
+	Catalog *catalog;
+
+	if (lock_wait_stats == NULL || !ts_extension_is_loaded())
+		return LOCK_WAIT_STATS_CATALOG_TUPLE;
+
+	catalog = ts_catalog_get();
+
+	if (relid == catalog_get_table_id(catalog, DIMENSION_SLICE))
+		return LOCK_WAIT_STATS_DIMENSION_SLICE;
+
+	if (relid == catalog_get_table_id(catalog, CONTINUOUS_AGGS_INVALIDATION_THRESHOLD))
+		return LOCK_WAIT_STATS_INVALIDATION_THRESHOLD;
+
+	return LOCK_WAIT_STATS_CATALOG_TUPLE;
+}
+
+/*
+ * Return the counters of each lock, for all databases.
+ */
+TS_FUNCTION_INFO_V1(ts_lock_wait_stats);
+
+Datum
+ts_lock_wait_stats(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		funcctx->max_calls = lock_wait_stats != NULL ? LOCK_WAIT_STATS_NUM_LOCKS : 0;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		pg_atomic_uint64 *counters = lock_wait_stats->counters[funcctx->call_cntr];
+		Datum values[LOCK_WAIT_STATS_NUM_COUNTERS + 1];
+		bool nulls[LOCK_WAIT_STATS_NUM_COUNTERS + 1] = { false };
+
+		Assert(funcctx->tuple_desc->natts == lengthof(values));
+
+		values[0] = CStringGetTextDatum(lock_names[funcctx->call_cntr]);
+		for (int i = 0; i < LOCK_WAIT_STATS_NUM_COUNTERS; i++)
+		{
+			values[i + 1] = Int64GetDatum((int64) pg_atomic_read_u64(&counters[i]));
+		}
+
+		HeapTuple tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+/*
+ * Add the counters of each lock as an object, the times are in microseconds.
+ * Nothing is added without the counters of the loader.
+ */
+void
+ts_lock_wait_stats_add_jsonb(JsonbParseState *state)
+{
+	static const char *const counter_names[LOCK_WAIT_STATS_NUM_COUNTERS] = {
+		[LOCK_WAIT_STATS_ACQUIRED] = "acquired",
+		[LOCK_WAIT_STATS_WAITS] = "waits",
+		[LOCK_WAIT_STATS_WAIT_TIME] = "wait_time_us",
+		[LOCK_WAIT_STATS_MAX_WAIT_TIME] = "max_wait_time_us",
+	};
+
+	pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	for (int i = 0; lock_wait_stats != NULL && i < LOCK_WAIT_STATS_NUM_LOCKS; i++)
+	{
+		JsonbValue key = {
+			.type = jbvString,
+			.val.string.val = (char *) lock_names[i],
+			.val.string.len = strlen(lock_names[i]),
+		};
+
+		pushJsonbValue(&state, WJB_KEY, &key);
+		pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+		for (int j = 0; j < LOCK_WAIT_STATS_NUM_COUNTERS; j++)
+			ts_jsonb_add_int64(state,
+							   counter_names[j],
+							   (int64) pg_atomic_read_u64(&lock_wait_stats->counters[i][j]));
+		pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+	}
+
+	pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+}
+
+/*
+ * Reset the counters of all locks. The counters are shared by all databases,
+ * so this requires superuser, like pg_stat_reset_shared().
+ */
+TS_FUNCTION_INFO_V1(ts_lock_wait_stats_reset);
+
+Datum
+ts_lock_wait_stats_reset(PG_FUNCTION_ARGS)
+{
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to reset the lock wait statistics")));
+
+	if (lock_wait_stats == NULL)
+		PG_RETURN_VOID();
+
+	for (int i = 0; i < LOCK_WAIT_STATS_NUM_LOCKS; i++)
+		for (int j = 0; j < LOCK_WAIT_STATS_NUM_COUNTERS; j++)
+			pg_atomic_write_u64(&lock_wait_stats->counters[i][j], 0);
+
+	PG_RETURN_VOID();
+}
+
+void
+_lock_wait_stats_init(void)
+{
+	LockWaitStatsRendezvous **rendezvous =
+		(LockWaitStatsRendezvous **) find_rendezvous_variable(RENDEZVOUS_LOCK_WAIT_STATS);
+
+	/* Is NULL if the loader doesn't allocate the counters. */
+	lock_wait_stats = *rendezvous;
+}
+
+void
+_lock_wait_stats_fini(void)
+{
+	lock_wait_stats = NULL;
+}
@@ -0,0 +1,44 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <portability/instr_time.h>
+#include <storage/lockdefs.h>
+#include <utils/jsonb.h>
+
+#include "export.h"
+
+/*
+ * The locks of the extension that writers queue on, shown by
+ * timescaledb_information.lock_wait_stats.
+ */
+typedef enum LockWaitStatsLock
+{
+	LOCK_WAIT_STATS_CHUNK_CREATE,			/* Lock on the hypertable to create chunks */
+	LOCK_WAIT_STATS_DIMENSION_SLICE,		/* Tuple locks on the dimension slices */
+	LOCK_WAIT_STATS_INVALIDATION_THRESHOLD,	/* Tuple lock on the invalidation threshold */
+	LOCK_WAIT_STATS_COMPRESSION,			/* Locks on the chunks to (de)compress them */
+	LOCK_WAIT_STATS_CATALOG_TUPLE,			/* Tuple locks on the other catalog tables */
+	LOCK_WAIT_STATS_NUM_LOCKS
+} LockWaitStatsLock;
+
+/* The counters of each lock */
+#define LOCK_WAIT_STATS_ACQUIRED 0
+#define LOCK_WAIT_STATS_WAITS 1 /* Acquisitions that could not be granted at once */
+#define LOCK_WAIT_STATS_WAIT_TIME 2 /* Microseconds */
+#define LOCK_WAIT_STATS_MAX_WAIT_TIME 3
+#define LOCK_WAIT_STATS_NUM_COUNTERS 4
+
+extern TSDLLEXPORT void ts_lock_wait_stats_report(LockWaitStatsLock lock,
+												  const instr_time *wait_start);
+extern TSDLLEXPORT void ts_lock_wait_stats_lock_relation(LockWaitStatsLock lock, Oid relid,
+														 LOCKMODE lockmode);
+extern LockWaitStatsLock ts_lock_wait_stats_catalog_tuple_lock(Oid relid);
+extern void ts_lock_wait_stats_add_jsonb(JsonbParseState *state);
+
+extern void _lock_wait_stats_init(void);
+extern void _lock_wait_stats_fini(void);
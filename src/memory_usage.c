@@ -0,0 +1,273 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * The memory used by the TimescaleDB subsystems in the current backend.
+ *
+ * The memory contexts of the subsystems are recognized by their names, which
+ * are registered below, so a new memory context should either reuse one of
+ * the names or be added to the list. The memory of the child contexts counts
+ * for the subsystem of the parent, and the memory of the contexts that don't
+ * belong to a subsystem, such as the ones of PostgreSQL, is reported as
+ * "other".
+ */
+#include <postgres.h>
+#include <access/htup_details.h>
+#include <funcapi.h>
+#include <nodes/memnodes.h>
+#include <utils/builtins.h>
+#include <utils/memutils.h>
+
+#include "export.h"
+#include "jsonb_utils.h"
+#include "memory_usage.h"
+
+typedef struct MemorySubsystem
+{
+	const char *name;
+	const char *const *context_names;
+} MemorySubsystem;
+
+static const char *const hypertable_cache_contexts[] = { "Hypertable cache", NULL };
+
+static const char *const chunk_cache_contexts[] = { "chunk cache", NULL };
+
+static const char *const metadata_cache_contexts[] = {
+	"Cache pins", "compression settings cache", "watermark cache", NULL
+};
+
+static const char *const chunk_insert_state_contexts[] = {
+	TS_CHUNK_INSERT_STATE_MEMORY_CONTEXT,
+	"Chunk foreign key cache",
+	NULL,
+};
+
+static const char *const copy_contexts[] = { "COPY", NULL };
+
+static const char *const compression_contexts[] = {
+	"compress chunk per-row",
+	"compressed column stats per batch",
+	"decompress chunk per-compressed row",
+	"jsonb shredding",
+	"CompressionJobCxt",
+	NULL,
+};
+
+static const char *const batch_contexts[] = {
+	"DecompressBatchState per-batch",
+	"DecompressBatchState bulk decompression",
+	"DecompressChunk batch cache",
+	"DecompressChunk cached column",
+	NULL,
+};
+
+static const char *const arrow_cache_contexts[] = { "Arrow data", NULL };
+
+static const char *const vector_agg_contexts[] = {
+	"VectorAgg grouping policy",
+	"VectorAgg heap batch",
+	"vector agg arguments",
+	NULL,
+};
+
+static const char *const continuous_agg_contexts[] = {
+	"ContinuousAggsTriggerCtx",
+	"Continuous aggregate invalidations",
+	"Hypertable invalidation log compaction",
+	NULL,
+};
+
+static const char *const scheduler_contexts[] = { "Scheduler", NULL };
+
+static const MemorySubsystem memory_subsystems[] = {
+	{ "hypertable_cache", hypertable_cache_contexts },
+	{ "chunk_cache", chunk_cache_contexts },
+	{ "metadata_caches", metadata_cache_contexts },
+	{ "chunk_insert_states", chunk_insert_state_contexts },
+	{ "copy", copy_contexts },
+	{ "compression", compression_contexts },
+	{ "batch_arrays", batch_contexts },
+	{ "arrow_cache", arrow_cache_contexts },
+	{ "vector_agg", vector_agg_contexts },
+	{ "continuous_aggs", continuous_agg_contexts },
+	{ "bgw_scheduler", scheduler_contexts },
+};
+
+/* The last entry of the usage is for the other contexts */
+#define NUM_MEMORY_SUBSYSTEMS lengthof(memory_subsystems)
+#define OTHER_MEMORY_SUBSYSTEM NUM_MEMORY_SUBSYSTEMS
+
+typedef struct MemoryUsage
+{
+	int64 contexts;
+	MemoryContextCounters counters;
+} MemoryUsage;
+
+static int
+memory_context_subsystem(MemoryContext context)
+{
+	for (size_t i = 0; i < NUM_MEMORY_SUBSYSTEMS; i++)
+	{
+		for (const char *const *name = memory_subsystems[i].context_names; *name != NULL; name++)
+		{
+			if (strcmp(context->name, *name) == 0)
+				return i;
+		}
+	}
+
+	return OTHER_MEMORY_SUBSYSTEM;
+}
+
+static void
+memory_context_count(MemoryContext context, MemoryContextCounters *counters, bool recurse)
+{
+	context->methods->stats(context, NULL, NULL, counters, false);
+
+	if (!recurse)
+		return;
+
+	for (MemoryContext child = context->firstchild; child != NULL; child = child->nextchild)
+		memory_context_count(child, counters, recurse);
+}
+
+static void
+memory_usage_walk(MemoryContext context, MemoryUsage *usage)
+{
+	const int subsystem = memory_context_subsystem(context);
+
+	usage[subsystem].contexts++;
+
+	/* The child contexts belong to the subsystem of their parent. */
+	if (subsystem != OTHER_MEMORY_SUBSYSTEM)
+	{
+		memory_context_count(context, &usage[subsystem].counters, true);
+		return;
+	}
+
+	memory_context_count(context, &usage[subsystem].counters, false);
+
+	for (MemoryContext child = context->firstchild; child != NULL; child = child->nextchild)
+		memory_usage_walk(child, usage);
+}
+
+/*
+ * The memory allocated in the direct children of the given context with the
+ * given name, including their own children.
+ */
+int64
+ts_memory_context_children_allocated(MemoryContext parent, const char *name)
+{
+	int64 bytes = 0;
+
+	for (MemoryContext child = parent->firstchild; child != NULL; child = child->nextchild)
+	{
+		if (strcmp(child->name, name) == 0)
+			bytes += MemoryContextMemAllocated(child, true);
+	}
+
+	return bytes;
+}
+
+static const char *
+memory_subsystem_name(int subsystem)
+{
+	return subsystem == OTHER_MEMORY_SUBSYSTEM ? "other" : memory_subsystems[subsystem].name;
+}
+
+/*
+ * Add the allocated and used memory of each subsystem in the current backend
+ * as an object.
+ */
+void
+ts_memory_usage_add_jsonb(JsonbParseState *state)
+{
+	MemoryUsage *usage = palloc0(sizeof(MemoryUsage) * (NUM_MEMORY_SUBSYSTEMS + 1));
+
+	memory_usage_walk(TopMemoryContext, usage);
+
+	pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	for (size_t i = 0; i <= NUM_MEMORY_SUBSYSTEMS; i++)
+	{
+		const MemoryUsage *mu = &usage[i];
+		const char *name = memory_subsystem_name(i);
+		JsonbValue key = {
+			.type = jbvString,
+			.val.string.val = (char *) name,
+			.val.string.len = strlen(name),
+		};
+
+		pushJsonbValue(&state, WJB_KEY, &key);
+		pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+		ts_jsonb_add_int64(state, "contexts", mu->contexts);
+		ts_jsonb_add_int64(state, "total_bytes", (int64) mu->counters.totalspace);
+		ts_jsonb_add_int64(state,
+						   "used_bytes",
+						   (int64) (mu->counters.totalspace - mu->counters.freespace));
+		pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+	}
+
+	pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+}
+
+/*
+ * Return the number of memory contexts and the allocated and used memory of
+ * each subsystem in the current backend.
+ */
+TS_FUNCTION_INFO_V1(ts_memory_usage);
+
+Datum
+ts_memory_usage(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	MemoryUsage *usage;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
+
+		usage = palloc0(sizeof(MemoryUsage) * (NUM_MEMORY_SUBSYSTEMS + 1));
+		memory_usage_walk(TopMemoryContext, usage);
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		funcctx->user_fctx = usage;
+		funcctx->max_calls = NUM_MEMORY_SUBSYSTEMS + 1;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	usage = funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		const MemoryUsage *mu = &usage[funcctx->call_cntr];
+		const char *name = memory_subsystem_name(funcctx->call_cntr);
+		Datum values[4] = {
+			CStringGetTextDatum(name),
+			Int64GetDatum(mu->contexts),
+			Int64GetDatum((int64) mu->counters.totalspace),
+			Int64GetDatum((int64) (mu->counters.totalspace - mu->counters.freespace)),
+		};
+		bool nulls[4] = { false };
+
+		Assert(funcctx->tuple_desc->natts == lengthof(values));
+
+		HeapTuple tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
@@ -0,0 +1,18 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <utils/jsonb.h>
+
+/*
+ * The names of the memory contexts that are looked up by name, and not only
+ * attributed to a subsystem by _timescaledb_debug.memory_usage().
+ */
+#define TS_CHUNK_INSERT_STATE_MEMORY_CONTEXT "chunk insert state memory context"
+
+extern int64 ts_memory_context_children_allocated(MemoryContext parent, const char *name);
+extern void ts_memory_usage_add_jsonb(JsonbParseState *state);
@@ -10,12 +10,14 @@
 #include <optimizer/paths.h>
 #include <optimizer/tlist.h>
 #include <utils/builtins.h>
+#include <utils/lsyscache.h>
 #include <utils/typcache.h>
 
 #include "func_cache.h"
 #include "guc.h"
 #include "nodes/chunk_append/chunk_append.h"
 #include "planner/planner.h"
+#include "ts_catalog/chunk_column_stats.h"
 
 static Var *find_equality_join_var(Var *sort_var, Index ht_relid, Oid eq_opr,
 								   List *join_conditions);
@@ -86,6 +88,112 @@ ts_chunk_append_path_copy(ChunkAppendPath *ca, List *subpaths, PathTarget *patht
 	return new;
 }
 
+static bool
+clause_references_partitioning_column(Node *clause, RelOptInfo *rel, Hypertable *ht)
+{
+	ListCell *lc;
+
+	foreach (lc, pull_var_clause(clause, 0))
+	{
+		Var *var = lfirst(lc);
+
+		/*
+		 * varattno 0 is whole row and varattno less than zero are system
+		 * columns so we skip those even though ts_is_partitioning_column
+		 * would return the correct answer for those as well
+		 */
+		if ((Index) var->varno == rel->relid && var->varattno > 0 &&
+			ts_is_partitioning_column(ht, var->varattno))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Check if the column has min/max ranges in chunk_column_stats. The executor
+ * adds these ranges to the chunk constraints, so runtime exclusion can use
+ * them like the dimension constraints.
+ */
+static bool
+is_chunk_skipping_column(const Hypertable *ht, AttrNumber attno)
+{
+	if (!ts_guc_enable_chunk_skipping || ht->range_space == NULL)
+		return false;
+
+	for (int i = 0; i < ht->range_space->num_range_cols; i++)
+	{
+		if (get_attnum(ht->main_table_relid, NameStr(ht->range_space->range_cols[i].column_name)) ==
+			attno)
+			return true;
+	}
+
+	return false;
+}
+
+static bool
+clause_references_exclusion_column(Node *clause, RelOptInfo *rel, Hypertable *ht)
+{
+	ListCell *lc;
+
+	if (clause_references_partitioning_column(clause, rel, ht))
+		return true;
+
+	foreach (lc, pull_var_clause(clause, 0))
+	{
+		Var *var = lfirst(lc);
+
+		if ((Index) var->varno == rel->relid && var->varattno > 0 &&
+			is_chunk_skipping_column(ht, var->varattno))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Estimate the share of the chunks that remain after the startup exclusion on
+ * the external parameters.
+ *
+ * A generic plan of a prepared statement includes all chunks, because the
+ * parameter values are not known when planning, and the chunks are excluded
+ * only at executor startup. If we cost it as a scan of every chunk, it never
+ * looks cheaper than the custom plans which only include the matching
+ * chunks, so plan_cache_mode = auto replans on every execution. The chunks
+ * matching a restriction on a partitioning column cover about the share of
+ * the hypertable selected by the restriction, plus a chunk at the boundary.
+ *
+ * The generic plan stays valid when new chunks are created, because creating
+ * a chunk invalidates the relcache entry of the hypertable and so the cached
+ * plans that use it.
+ */
+static double
+startup_exclusion_chunk_fraction(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht,
+								 int num_children)
+{
+	List *clauses = NIL;
+	ListCell *lc;
+
+	if (num_children <= 1)
+		return 1.0;
+
+	foreach (lc, rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (ts_contains_external_param((Node *) rinfo->clause) &&
+			clause_references_partitioning_column((Node *) rinfo->clause, rel, ht))
+			clauses = lappend(clauses, rinfo);
+	}
+
+	if (clauses == NIL)
+		return 1.0;
+
+	Selectivity selectivity = clauselist_selectivity(root, clauses, rel->relid, JOIN_INNER, NULL);
+
+	return Min(1.0, (selectivity * num_children + 1) / num_children);
+}
+
 Path *
 ts_chunk_append_path_create(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht, Path *subpath,
 							bool parallel_aware, bool ordered, List *nested_oids)
@@ -170,8 +278,6 @@ ts_chunk_append_path_create(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht,
 
 		if (ts_guc_enable_runtime_exclusion && ts_contains_join_param((Node *) rinfo->clause))
 		{
-			ListCell *lc_var;
-
 			/* We have two types of exclusion:
 			 *
 			 * Parent exclusion fires if the entire hypertable can be excluded.
@@ -187,26 +293,12 @@ ts_chunk_append_path_create(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht,
 			 * the range of the chunk. It is more widely applicable than the parent
 			 * exclusion but is also more expensive to evaluate since you have to perform
 			 * the check on every chunk. Child exclusion can only apply if one of the quals
-			 * involves a partitioning column.
+			 * involves a partitioning column, or a column with chunk skipping ranges.
 			 *
 			 */
 			path->runtime_exclusion_parent = true;
-			foreach (lc_var, pull_var_clause((Node *) rinfo->clause, 0))
-			{
-				Var *var = lfirst(lc_var);
-				/*
-				 * varattno 0 is whole row and varattno less than zero are
-				 * system columns so we skip those even though
-				 * ts_is_partitioning_column would return the correct
-				 * answer for those as well
-				 */
-				if ((Index) var->varno == rel->relid && var->varattno > 0 &&
-					ts_is_partitioning_column(ht, var->varattno))
-				{
-					path->runtime_exclusion_children = true;
-					break;
-				}
-			}
+			if (clause_references_exclusion_column((Node *) rinfo->clause, rel, ht))
+				path->runtime_exclusion_children = true;
 		}
 	}
 	/*
@@ -434,12 +526,19 @@ ts_chunk_append_path_create(PlannerInfo *root, RelOptInfo *rel, Hypertable *ht,
 		}
 	}
 
+	if (path->startup_exclusion && ts_guc_enable_startup_exclusion_costing)
+		total_cost *=
+			startup_exclusion_chunk_fraction(root, rel, ht, list_length(path->cpath.custom_paths));
+
 	path->cpath.path.rows = rows;
 	path->cpath.path.total_cost = total_cost;
 
 	if (path->cpath.custom_paths != NIL)
 		path->cpath.path.startup_cost = ((Path *) linitial(path->cpath.custom_paths))->startup_cost;
 
+	if (path->cpath.path.total_cost < path->cpath.path.startup_cost)
+		path->cpath.path.total_cost = path->cpath.path.startup_cost;
+
 	return &path->cpath.path;
 }
 
@@ -4,7 +4,10 @@
  * LICENSE-APACHE for a copy of the license.
  */
 #include <postgres.h>
+#include <access/stratnum.h>
+#include <access/table.h>
 #include <catalog/pg_collation.h>
+#include <common/hashfn.h>
 #include <executor/executor.h>
 #include <executor/nodeSubplan.h>
 #include <fmgr.h>
@@ -18,30 +21,42 @@
 #include <optimizer/prep.h>
 #include <optimizer/restrictinfo.h>
 #include <parser/parsetree.h>
+#include <port/atomics.h>
 #include <rewrite/rewriteManip.h>
+#include <storage/bufmgr.h>
 #include <utils/builtins.h>
+#include <utils/datum.h>
+#include <utils/hsearch.h>
+#include <utils/lsyscache.h>
 #include <utils/memutils.h>
 #include <utils/ruleutils.h>
 #include <utils/typcache.h>
 
 #include <math.h>
 
-#include "loader/lwlocks.h"
+#include "dimension_slice.h"
+#include "guc.h"
 #include "nodes/chunk_append/chunk_append.h"
 #include "planner/planner.h"
 #include "transform.h"
 #include "ts_catalog/chunk_column_stats.h"
+#include "utils.h"
 
 #define INVALID_SUBPLAN_INDEX (-1)
 #define NO_MATCHING_SUBPLANS (-2)
 
+/* The number of blocks of each relation of a subplan that are prefetched */
+#define CHUNK_APPEND_PREFETCH_BLOCKS 16
+
 typedef enum SubplanState
 {
 	SUBPLAN_STATE_INCLUDED = 1 << 0, /* Used and not removed by startup exclusion */
 	SUBPLAN_STATE_FINISHED = 1 << 1, /* The subplan is finished */
 } SubplanState;
 
-/* ParallelChunkAppendState is stored in shared memory to coordinate the parallel workers.
+/* ParallelChunkAppendState is stored in shared memory to coordinate the parallel workers. The
+ * workers only use atomic operations on it, so that switching to the next subplan doesn't have to
+ * wait for a lock when there are many small chunks.
  *
  * subplan_state is accessed by two different indexes. This is done because a C struct can have only
  * one FLEXIBLE_ARRAY_MEMBER, two pieces of information must be stored per subplan in shared memory,
@@ -55,9 +70,12 @@ typedef enum SubplanState
  */
 typedef struct ParallelChunkAppendState
 {
-	int next_plan;
+	/* The position of the next non-partial subplan to hand out in the parallel order */
+	pg_atomic_uint32 next_non_partial_plan;
+	/* Advanced by every choice of a partial subplan, to spread the workers over them */
+	pg_atomic_uint32 next_partial_plan;
 	int filtered_first_partial_plan;
-	uint32 subplan_state[FLEXIBLE_ARRAY_MEMBER]; /* See SubplanState */
+	pg_atomic_uint32 subplan_state[FLEXIBLE_ARRAY_MEMBER]; /* See SubplanState */
 } ParallelChunkAppendState;
 
 typedef struct ChunkAppendState
@@ -71,6 +89,8 @@ typedef struct ChunkAppendState
 	int first_partial_plan;
 	int filtered_first_partial_plan;
 	int current;
+	/* the last subplan whose relations were prefetched */
+	int prefetched_plan;
 
 	Oid ht_reloid;
 	bool startup_exclusion;
@@ -105,6 +125,27 @@ typedef struct ChunkAppendState
 	Bitmapset *valid_subplans;
 	Bitmapset *params;
 
+	/* range exclusion on the open dimensions, see make_range_exclusion() */
+	List *range_clauses;
+	int num_range_dimensions;
+	bool range_exclusion_complete;
+	List *initial_chunk_ranges;
+	List *filtered_chunk_ranges;
+	ExprState **range_values;
+	Oid *range_types;
+	int *range_dimensions;
+	StrategyNumber *range_strategies;
+	int64 *chunk_ranges; /* start and end of every dimension for every subplan */
+	bool *has_chunk_ranges;
+
+	/* results of runtime exclusion by the values of the parameters */
+	List *exclusion_params;
+	ExprState **exclusion_param_values;
+	int16 *exclusion_param_typlen;
+	bool *exclusion_param_typbyval;
+	HTAB *exclusion_results;
+	MemoryContext exclusion_results_ctx;
+
 	/* sort options if this append is ordered, only used for EXPLAIN */
 	List *sort_options;
 
@@ -113,9 +154,10 @@ typedef struct ChunkAppendState
 	int runtime_number_exclusions_parent;
 	int runtime_number_exclusions_children;
 
-	LWLock *lock;
 	ParallelContext *pcxt;
 	ParallelChunkAppendState *pstate;
+	/* filtered subplan indexes in the order they are handed out to the parallel workers */
+	int *parallel_order;
 	EState *estate;
 	int eflags;
 	void (*choose_next_subplan)(struct ChunkAppendState *);
@@ -153,13 +195,14 @@ static void do_startup_exclusion(ChunkAppendState *state);
 static Node *constify_param_mutator(Node *node, void *context);
 
 static void initialize_constraints(ChunkAppendState *state, List *initial_rt_indexes);
-static LWLock *chunk_append_get_lock_pointer(void);
 
 static void show_sort_group_keys(ChunkAppendState *planstate, List *ancestors, ExplainState *es);
 static void show_sortorder_options(StringInfo buf, Node *sortexpr, Oid sortOperator, Oid collation,
 								   bool nullsFirst);
 
 static void perform_plan_init(ChunkAppendState *state, EState *estate, int eflags);
+static void initialize_range_exclusion(ChunkAppendState *state);
+static void initialize_exclusion_results(ChunkAppendState *state);
 
 Node *
 ts_chunk_append_state_create(CustomScan *cscan)
@@ -176,6 +219,17 @@ ts_chunk_append_state_create(CustomScan *cscan)
 	state->sort_options = lfourth(cscan->custom_private);
 	state->initial_parent_clauses = lfirst(list_nth_cell(cscan->custom_private, 4));
 
+	List *range_exclusion_private = lfirst(list_nth_cell(cscan->custom_private, 5));
+	List *range_exclusion = linitial(range_exclusion_private);
+	if (range_exclusion != NIL)
+	{
+		state->range_clauses = linitial(range_exclusion);
+		state->num_range_dimensions = linitial_int(lsecond(range_exclusion));
+	}
+	state->initial_chunk_ranges = lsecond(range_exclusion_private);
+	state->range_exclusion_complete = (bool) linitial_int(lthird(range_exclusion_private));
+	state->exclusion_params = lfourth(range_exclusion_private);
+
 	state->startup_exclusion = (bool) linitial_int(settings);
 	state->runtime_exclusion_parent = (bool) lsecond_int(settings);
 	state->runtime_exclusion_children = (bool) lthird_int(settings);
@@ -184,9 +238,11 @@ ts_chunk_append_state_create(CustomScan *cscan)
 
 	state->filtered_subplans = state->initial_subplans;
 	state->filtered_ri_clauses = state->initial_ri_clauses;
+	state->filtered_chunk_ranges = state->initial_chunk_ranges;
 	state->filtered_first_partial_plan = state->first_partial_plan;
 
 	state->current = INVALID_SUBPLAN_INDEX;
+	state->prefetched_plan = INVALID_SUBPLAN_INDEX;
 	state->choose_next_subplan = choose_next_subplan_non_parallel;
 
 	state->exclusion_ctx = AllocSetContextCreate(CurrentMemoryContext,
@@ -202,6 +258,7 @@ do_startup_exclusion(ChunkAppendState *state)
 	List *filtered_children = NIL;
 	List *filtered_ri_clauses = NIL;
 	List *filtered_constraints = NIL;
+	List *filtered_chunk_ranges = NIL;
 	ListCell *lc_plan;
 	ListCell *lc_clauses;
 	ListCell *lc_constraints;
@@ -283,11 +340,15 @@ do_startup_exclusion(ChunkAppendState *state)
 		filtered_children = lappend(filtered_children, lfirst(lc_plan));
 		filtered_ri_clauses = lappend(filtered_ri_clauses, ri_clauses);
 		filtered_constraints = lappend(filtered_constraints, lfirst(lc_constraints));
+		if (state->initial_chunk_ranges != NIL)
+			filtered_chunk_ranges =
+				lappend(filtered_chunk_ranges, list_nth(state->initial_chunk_ranges, i));
 	}
 
 	state->filtered_subplans = filtered_children;
 	state->filtered_ri_clauses = filtered_ri_clauses;
 	state->filtered_constraints = filtered_constraints;
+	state->filtered_chunk_ranges = filtered_chunk_ranges;
 	state->filtered_first_partial_plan = filtered_first_partial_plan;
 
 	Assert(list_length(state->filtered_subplans) ==
@@ -335,13 +396,13 @@ chunk_append_begin(CustomScanState *node, EState *estate, int eflags)
 	 * The parallel workers use the information from shared memory to include the same plans as the
 	 * parallel leader. This ensures that all workers work on the same subplans and we have an
 	 * agreement about the number of subplans. This is necessary to ensure that the parallel workers
-	 * work correctly and that the next subplan to be processed in the shared memory
-	 * (pstate->next_plan) pointers to the same plan in all workers.
+	 * work correctly and that the positions of the next subplans to be processed in the shared
+	 * memory point to the same plans in all workers.
 	 *
 	 * If the workers perform the startup exclusion individually, they may choose different subplans
 	 * (e.g., due to a "constant" function that claims to be constant but returns different
 	 * results). In that case, we have a disagreement about the plans between the workers. This
-	 * would lead to hard-to-debug problems and out-of-bounds reads when pstate->next_plan is used
+	 * would lead to hard-to-debug problems and out-of-bounds reads when these positions are used
 	 * for subplan selection.
 	 *
 	 */
@@ -417,7 +478,270 @@ perform_plan_init(ChunkAppendState *state, EState *estate, int eflags)
 		 * make sure all params are initialized for runtime exclusion
 		 */
 		state->csstate.ss.ps.chgParam = bms_copy(state->subplanstates[0]->plan->allParam);
+
+		if (state->runtime_exclusion_children && state->range_clauses != NIL &&
+			state->filtered_chunk_ranges != NIL)
+			initialize_range_exclusion(state);
+
+		if (state->exclusion_params != NIL)
+			initialize_exclusion_results(state);
+	}
+}
+
+/*
+ * Prepare the comparison of the chunk ranges with the values of the range
+ * clauses, which is cheaper than proving that the clauses refute the chunk
+ * constraints for every chunk.
+ */
+static void
+initialize_range_exclusion(ChunkAppendState *state)
+{
+	const int num_clauses = list_length(state->range_clauses);
+	const int num_ranges = 2 * state->num_range_dimensions;
+	ListCell *lc;
+	int i;
+
+	Assert(list_length(state->filtered_chunk_ranges) == state->num_subplans);
+
+	state->range_values = palloc(sizeof(ExprState *) * num_clauses);
+	state->range_types = palloc(sizeof(Oid) * num_clauses);
+	state->range_dimensions = palloc(sizeof(int) * num_clauses);
+	state->range_strategies = palloc(sizeof(StrategyNumber) * num_clauses);
+
+	i = 0;
+	foreach (lc, state->range_clauses)
+	{
+		List *range_clause = lfirst(lc);
+		Expr *value = lthird(range_clause);
+
+		state->range_dimensions[i] = intVal(linitial(range_clause));
+		state->range_strategies[i] = intVal(lsecond(range_clause));
+		state->range_types[i] = exprType((Node *) value);
+		state->range_values[i] = ExecInitExpr(value, &state->csstate.ss.ps);
+		i++;
+	}
+
+	state->chunk_ranges = palloc(sizeof(int64) * num_ranges * state->num_subplans);
+	state->has_chunk_ranges = palloc0(sizeof(bool) * state->num_subplans);
+
+	i = 0;
+	foreach (lc, state->filtered_chunk_ranges)
+	{
+		List *ranges = lfirst(lc);
+
+		if (ranges != NIL)
+		{
+			Assert(list_length(ranges) == num_ranges);
+			for (int j = 0; j < num_ranges; j++)
+				state->chunk_ranges[i * num_ranges + j] =
+					DatumGetInt64(castNode(Const, list_nth(ranges, j))->constvalue);
+			state->has_chunk_ranges[i] = true;
+		}
+		i++;
+	}
+}
+
+/*
+ * Compute the ranges of the dimension values allowed by the range clauses as
+ * inclusive bounds. Returns false if we can't compute them for these values,
+ * and then the clauses have to be checked against every chunk. Sets *empty if
+ * the clauses allow no values.
+ */
+static bool
+compute_range_restriction(ChunkAppendState *state, int64 *lower, int64 *upper, bool *empty)
+{
+	ExprContext *econtext = state->csstate.ss.ps.ps_ExprContext;
+
+	for (int i = 0; i < state->num_range_dimensions; i++)
+	{
+		lower[i] = PG_INT64_MIN;
+		upper[i] = PG_INT64_MAX;
+	}
+	*empty = false;
+
+	for (int i = 0; i < list_length(state->range_clauses); i++)
+	{
+		const int dim = state->range_dimensions[i];
+		bool isnull;
+		Datum value = ExecEvalExprSwitchContext(state->range_values[i], econtext, &isnull);
+
+		/* The comparison operators are strict, so nothing matches a null */
+		if (isnull)
+		{
+			*empty = true;
+			continue;
+		}
+
+		const int64 internal = ts_time_value_to_internal_or_infinite(value, state->range_types[i]);
+
+		/* This is also the value for infinity, which is outside of all ranges */
+		if (internal == PG_INT64_MIN || internal == PG_INT64_MAX)
+			return false;
+
+		switch (state->range_strategies[i])
+		{
+			case BTLessStrategyNumber:
+				upper[dim] = Min(upper[dim], internal - 1);
+				break;
+			case BTLessEqualStrategyNumber:
+				upper[dim] = Min(upper[dim], internal);
+				break;
+			case BTEqualStrategyNumber:
+				lower[dim] = Max(lower[dim], internal);
+				upper[dim] = Min(upper[dim], internal);
+				break;
+			case BTGreaterEqualStrategyNumber:
+				lower[dim] = Max(lower[dim], internal);
+				break;
+			case BTGreaterStrategyNumber:
+				lower[dim] = Max(lower[dim], internal + 1);
+				break;
+			default:
+				pg_unreachable();
+		}
 	}
+
+	return true;
+}
+
+static bool
+chunk_excluded_by_ranges(const ChunkAppendState *state, int subplan, const int64 *lower,
+						 const int64 *upper)
+{
+	const int num_ranges = 2 * state->num_range_dimensions;
+	const int64 *ranges = &state->chunk_ranges[subplan * num_ranges];
+
+	for (int i = 0; i < state->num_range_dimensions; i++)
+	{
+		const int64 range_start = ranges[2 * i];
+		const int64 range_end = ranges[2 * i + 1];
+
+		/* The chunk has no constraint for an infinite bound of the range */
+		if (range_start != DIMENSION_SLICE_MINVALUE && upper[i] < range_start)
+			return true;
+
+		if (range_end != DIMENSION_SLICE_MAXVALUE && lower[i] >= range_end)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * The results of runtime exclusion only depend on the values of the
+ * parameters in the clauses, so we remember them for every combination of the
+ * values. This helps the inner side of a nested loop where the outer side has
+ * a small number of distinct values.
+ */
+#define EXCLUSION_RESULTS_MAX_ENTRIES 1024
+
+typedef struct ExclusionResultKey
+{
+	char *data;
+	int len;
+} ExclusionResultKey;
+
+typedef struct ExclusionResult
+{
+	ExclusionResultKey key;
+	Bitmapset *valid_subplans;
+	bool excluded_parent;
+	int num_excluded_children;
+} ExclusionResult;
+
+static uint32
+exclusion_result_hash(const void *key, Size keysize)
+{
+	const ExclusionResultKey *k = key;
+	return hash_bytes((const unsigned char *) k->data, k->len);
+}
+
+static int
+exclusion_result_match(const void *key1, const void *key2, Size keysize)
+{
+	const ExclusionResultKey *k1 = key1;
+	const ExclusionResultKey *k2 = key2;
+
+	if (k1->len != k2->len)
+		return 1;
+
+	return memcmp(k1->data, k2->data, k1->len);
+}
+
+static void
+initialize_exclusion_results(ChunkAppendState *state)
+{
+	const int num_params = list_length(state->exclusion_params);
+	ListCell *lc;
+	int i = 0;
+
+	state->exclusion_param_values = palloc(sizeof(ExprState *) * num_params);
+	state->exclusion_param_typlen = palloc(sizeof(int16) * num_params);
+	state->exclusion_param_typbyval = palloc(sizeof(bool) * num_params);
+
+	foreach (lc, state->exclusion_params)
+	{
+		Param *param = lfirst_node(Param, lc);
+
+		state->exclusion_param_values[i] = ExecInitExpr((Expr *) param, &state->csstate.ss.ps);
+		get_typlenbyval(param->paramtype,
+						&state->exclusion_param_typlen[i],
+						&state->exclusion_param_typbyval[i]);
+		i++;
+	}
+
+	state->exclusion_results_ctx = AllocSetContextCreate(CurrentMemoryContext,
+														 "ChunkAppend exclusion results",
+														 ALLOCSET_DEFAULT_SIZES);
+
+	HASHCTL ctl = {
+		.keysize = sizeof(ExclusionResultKey),
+		.entrysize = sizeof(ExclusionResult),
+		.hash = exclusion_result_hash,
+		.match = exclusion_result_match,
+		.hcxt = state->exclusion_results_ctx,
+	};
+	state->exclusion_results = hash_create("ChunkAppend exclusion results",
+										   64,
+										   &ctl,
+										   HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+}
+
+/*
+ * Serialize the current values of the parameters. Returns false if some
+ * value can't be compared by its binary representation.
+ */
+static bool
+make_exclusion_result_key(ChunkAppendState *state, StringInfo key)
+{
+	ExprContext *econtext = state->csstate.ss.ps.ps_ExprContext;
+
+	for (int i = 0; i < list_length(state->exclusion_params); i++)
+	{
+		bool isnull;
+		Datum value =
+			ExecEvalExprSwitchContext(state->exclusion_param_values[i], econtext, &isnull);
+
+		appendStringInfoChar(key, isnull ? 1 : 0);
+		if (isnull)
+			continue;
+
+		if (state->exclusion_param_typbyval[i])
+		{
+			appendBinaryStringInfo(key, (const char *) &value, sizeof(Datum));
+			continue;
+		}
+
+		/* The external and expanded values might change in place */
+		if (state->exclusion_param_typlen[i] == -1 && VARATT_IS_EXTERNAL(DatumGetPointer(value)))
+			return false;
+
+		const uint32 len = datumGetSize(value, false, state->exclusion_param_typlen[i]);
+		appendBinaryStringInfo(key, (const char *) &len, sizeof(len));
+		appendBinaryStringInfo(key, DatumGetPointer(value), len);
+	}
+
+	return true;
 }
 
 static bool
@@ -448,10 +772,14 @@ can_exclude_constraints_using_clauses(ChunkAppendState *state, List *constraints
  * build bitmap of valid subplans for runtime exclusion
  */
 static void
-initialize_runtime_exclusion(ChunkAppendState *state)
+compute_runtime_exclusion(ChunkAppendState *state)
 {
 	ListCell *lc_clauses, *lc_constraints;
 	int i = 0;
+	int64 *lower = NULL;
+	int64 *upper = NULL;
+	bool use_ranges = false;
+	bool empty = false;
 
 	PlannerGlobal glob = {
 		.boundParams = state->csstate.ss.ps.state->es_param_list_info,
@@ -460,15 +788,6 @@ initialize_runtime_exclusion(ChunkAppendState *state)
 		.glob = &glob,
 	};
 
-	state->runtime_initialized = true;
-
-	if (state->num_subplans == 0)
-	{
-		return;
-	}
-
-	state->runtime_number_loops++;
-
 	if (state->runtime_exclusion_parent)
 	{
 		/* try to exclude all the chunks using the parents clauses.
@@ -498,6 +817,13 @@ initialize_runtime_exclusion(ChunkAppendState *state)
 
 	Assert(state->num_subplans == list_length(state->filtered_ri_clauses));
 
+	if (state->range_values != NULL)
+	{
+		lower = palloc(sizeof(int64) * state->num_range_dimensions);
+		upper = palloc(sizeof(int64) * state->num_range_dimensions);
+		use_ranges = compute_range_restriction(state, lower, upper, &empty);
+	}
+
 	lc_clauses = list_head(state->filtered_ri_clauses);
 	lc_constraints = list_head(state->filtered_constraints);
 
@@ -515,11 +841,24 @@ initialize_runtime_exclusion(ChunkAppendState *state)
 		}
 		else
 		{
-			bool can_exclude = can_exclude_constraints_using_clauses(state,
-																	 lfirst(lc_constraints),
-																	 lfirst(lc_clauses),
-																	 &root,
-																	 ps);
+			bool can_exclude;
+
+			/*
+			 * Comparing the chunk ranges is enough when all the clauses with
+			 * parameters are range clauses, otherwise it only saves us the
+			 * proof for the chunks it excludes.
+			 */
+			if (use_ranges && state->has_chunk_ranges[i] &&
+				(empty || chunk_excluded_by_ranges(state, i, lower, upper)))
+				can_exclude = true;
+			else if (use_ranges && state->has_chunk_ranges[i] && state->range_exclusion_complete)
+				can_exclude = false;
+			else
+				can_exclude = can_exclude_constraints_using_clauses(state,
+																	lfirst(lc_constraints),
+																	lfirst(lc_clauses),
+																	&root,
+																	ps);
 
 			if (!can_exclude)
 				state->valid_subplans = bms_add_member(state->valid_subplans, i);
@@ -530,6 +869,77 @@ initialize_runtime_exclusion(ChunkAppendState *state)
 		lc_clauses = lnext(state->filtered_ri_clauses, lc_clauses);
 		lc_constraints = lnext(state->filtered_constraints, lc_constraints);
 	}
+
+	if (lower != NULL)
+	{
+		pfree(lower);
+		pfree(upper);
+	}
+}
+
+static void
+initialize_runtime_exclusion(ChunkAppendState *state)
+{
+	StringInfoData key = { 0 };
+	ExclusionResult *result;
+	bool found;
+
+	state->runtime_initialized = true;
+
+	if (state->num_subplans == 0)
+	{
+		return;
+	}
+
+	state->runtime_number_loops++;
+
+	if (state->exclusion_results == NULL)
+	{
+		compute_runtime_exclusion(state);
+		return;
+	}
+
+	initStringInfo(&key);
+	if (!make_exclusion_result_key(state, &key))
+	{
+		pfree(key.data);
+		compute_runtime_exclusion(state);
+		return;
+	}
+
+	ExclusionResultKey lookup_key = { .data = key.data, .len = key.len };
+	result = hash_search(state->exclusion_results, &lookup_key, HASH_FIND, NULL);
+	if (result != NULL)
+	{
+		pfree(key.data);
+		if (result->excluded_parent)
+			state->runtime_number_exclusions_parent++;
+		state->runtime_number_exclusions_children += result->num_excluded_children;
+		state->valid_subplans = bms_copy(result->valid_subplans);
+		return;
+	}
+
+	const int exclusions_parent = state->runtime_number_exclusions_parent;
+	const int exclusions_children = state->runtime_number_exclusions_children;
+
+	compute_runtime_exclusion(state);
+
+	if (hash_get_num_entries(state->exclusion_results) < EXCLUSION_RESULTS_MAX_ENTRIES)
+	{
+		MemoryContext old = MemoryContextSwitchTo(state->exclusion_results_ctx);
+
+		lookup_key.data = pnstrdup(key.data, key.len);
+		result = hash_search(state->exclusion_results, &lookup_key, HASH_ENTER, &found);
+		Assert(!found);
+		result->excluded_parent = state->runtime_number_exclusions_parent != exclusions_parent;
+		result->num_excluded_children =
+			state->runtime_number_exclusions_children - exclusions_children;
+		result->valid_subplans = bms_copy(state->valid_subplans);
+
+		MemoryContextSwitchTo(old);
+	}
+
+	pfree(key.data);
 }
 
 /*
@@ -618,92 +1028,252 @@ get_next_subplan(ChunkAppendState *state, int last_plan)
 	}
 }
 
+static void
+prefetch_relation(Relation rel)
+{
+	if (rel == NULL || !RELKIND_HAS_STORAGE(rel->rd_rel->relkind))
+		return;
+
+	const BlockNumber nblocks =
+		Min(RelationGetNumberOfBlocks(rel), (BlockNumber) CHUNK_APPEND_PREFETCH_BLOCKS);
+
+	for (BlockNumber blkno = 0; blkno < nblocks; blkno++)
+		PrefetchBuffer(rel, MAIN_FORKNUM, blkno);
+}
+
+/*
+ * Prefetch the first blocks of the relations that the scans of the subplan
+ * read, i.e., the tables, their TOAST tables, which hold most of the data of
+ * the compressed chunks, and the indexes.
+ */
+static bool
+prefetch_scan_relations(PlanState *planstate, void *context)
+{
+	if (planstate == NULL)
+		return false;
+
+	switch (nodeTag(planstate))
+	{
+		case T_IndexScanState:
+			prefetch_relation(castNode(IndexScanState, planstate)->iss_RelationDesc);
+			break;
+		case T_IndexOnlyScanState:
+			prefetch_relation(castNode(IndexOnlyScanState, planstate)->ioss_RelationDesc);
+			break;
+		case T_BitmapIndexScanState:
+			prefetch_relation(castNode(BitmapIndexScanState, planstate)->biss_RelationDesc);
+			break;
+		default:
+			break;
+	}
+
+	switch (nodeTag(planstate))
+	{
+		case T_SeqScanState:
+		case T_SampleScanState:
+		case T_IndexScanState:
+		case T_BitmapHeapScanState:
+		case T_TidScanState:
+		case T_TidRangeScanState:
+		case T_CustomScanState:
+		{
+			Relation rel = ((ScanState *) planstate)->ss_currentRelation;
+
+			if (rel == NULL || !RELKIND_HAS_STORAGE(rel->rd_rel->relkind))
+				break;
+
+			prefetch_relation(rel);
+
+			if (OidIsValid(rel->rd_rel->reltoastrelid))
+			{
+				Relation toastrel = table_open(rel->rd_rel->reltoastrelid, AccessShareLock);
+				prefetch_relation(toastrel);
+				table_close(toastrel, AccessShareLock);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+
+	return planstate_tree_walker(planstate, prefetch_scan_relations, context);
+}
+
+/*
+ * Issue read-ahead for the subplans that follow the current one, so that
+ * their first blocks are read while the current chunk is scanned instead of
+ * with a cold cache when the scan moves to the next chunk.
+ */
+static void
+prefetch_next_subplans(ChunkAppendState *state)
+{
+	int plan = state->current;
+
+	if (ts_guc_chunk_append_prefetch_depth == 0)
+		return;
+
+	for (int i = 0; i < ts_guc_chunk_append_prefetch_depth; i++)
+	{
+		plan = get_next_subplan(state, plan);
+
+		if (plan < 0)
+			break;
+
+		if (plan > state->prefetched_plan)
+		{
+			prefetch_scan_relations(state->subplanstates[plan], NULL);
+			state->prefetched_plan = plan;
+		}
+	}
+}
+
 static void
 choose_next_subplan_non_parallel(ChunkAppendState *state)
 {
 	state->current = get_next_subplan(state, state->current);
+	prefetch_next_subplans(state);
+}
+
+/*
+ * Check whether the subplan is not excluded at runtime.
+ */
+static bool
+is_valid_subplan(ChunkAppendState *state, int plan)
+{
+	if (!state->runtime_exclusion_parent && !state->runtime_exclusion_children)
+		return true;
+
+	if (!state->runtime_initialized)
+		initialize_runtime_exclusion(state);
+
+	return bms_is_member(plan, state->valid_subplans);
 }
 
+typedef struct SubplanCost
+{
+	int plan;
+	Cost cost;
+} SubplanCost;
+
+static int
+subplan_cost_cmp(const void *a, const void *b)
+{
+	const SubplanCost *ca = (const SubplanCost *) a;
+	const SubplanCost *cb = (const SubplanCost *) b;
+
+	if (ca->cost != cb->cost)
+		return ca->cost > cb->cost ? -1 : 1;
+
+	return ca->plan - cb->plan;
+}
+
+/*
+ * Order the subplans for the parallel workers: the non-partial subplans first,
+ * because only one worker can run each of them, and then the partial ones.
+ * Both groups are ordered by the estimated cost, largest first, so that a large
+ * subplan is not started late and doesn't leave the other workers idle at the
+ * end (the LPT scheduling). The order only depends on the plan, so it is the
+ * same in all workers.
+ */
 static void
-choose_next_subplan_for_worker(ChunkAppendState *state)
+compute_parallel_order(ChunkAppendState *state)
 {
-	ParallelChunkAppendState *pstate = state->pstate;
-	int next_plan;
-	int start;
+	SubplanCost *costs = palloc(sizeof(SubplanCost) * state->num_subplans);
+	const int first_partial = state->filtered_first_partial_plan;
 
-	LWLockAcquire(state->lock, LW_EXCLUSIVE);
+	for (int i = 0; i < state->num_subplans; i++)
+	{
+		costs[i].plan = i;
+		costs[i].cost = state->subplanstates[i]->plan->total_cost;
+	}
 
-	/* mark just completed subplan as finished */
-	if (state->current >= 0)
-		pstate->subplan_state[state->current] =
-			ts_set_flags_32(pstate->subplan_state[state->current], SUBPLAN_STATE_FINISHED);
+	qsort(costs, first_partial, sizeof(SubplanCost), subplan_cost_cmp);
+	qsort(costs + first_partial,
+		  state->num_subplans - first_partial,
+		  sizeof(SubplanCost),
+		  subplan_cost_cmp);
 
-	if (pstate->next_plan == INVALID_SUBPLAN_INDEX)
-		next_plan = get_next_subplan(state, INVALID_SUBPLAN_INDEX);
-	else
-		next_plan = pstate->next_plan;
+	state->parallel_order =
+		MemoryContextAlloc(state->csstate.ss.ps.state->es_query_cxt,
+						   sizeof(int) * Max(state->num_subplans, 1));
+	for (int i = 0; i < state->num_subplans; i++)
+		state->parallel_order[i] = costs[i].plan;
+
+	pfree(costs);
+}
 
-	if (next_plan == NO_MATCHING_SUBPLANS)
+static void
+choose_next_subplan_for_worker(ChunkAppendState *state)
+{
+	ParallelChunkAppendState *pstate = state->pstate;
+	const uint32 num_non_partial = state->filtered_first_partial_plan;
+	const uint32 num_partial = state->num_subplans - state->filtered_first_partial_plan;
+
+	if (state->num_subplans == 0)
 	{
-		/* all subplans are finished */
-		pstate->next_plan = NO_MATCHING_SUBPLANS;
 		state->current = NO_MATCHING_SUBPLANS;
-		LWLockRelease(state->lock);
 		return;
 	}
 
-	start = next_plan;
+	if (state->parallel_order == NULL)
+		compute_parallel_order(state);
+
+	/* mark just completed subplan as finished */
+	if (state->current >= 0)
+		pg_atomic_fetch_or_u32(&pstate->subplan_state[state->current], SUBPLAN_STATE_FINISHED);
 
-	/* skip finished subplans */
-	while (ts_flags_are_set_32(pstate->subplan_state[next_plan], SUBPLAN_STATE_FINISHED))
+	/*
+	 * Every non-partial subplan is handed out exactly once, taking the next
+	 * one in the parallel order. We read the position first, so that it doesn't
+	 * grow after all of them are handed out.
+	 */
+	while (pg_atomic_read_u32(&pstate->next_non_partial_plan) < num_non_partial)
 	{
-		next_plan = get_next_subplan(state, next_plan);
+		const uint32 pos = pg_atomic_fetch_add_u32(&pstate->next_non_partial_plan, 1);
+		if (pos >= num_non_partial)
+			break;
 
-		/* wrap around if we reach end of subplan list */
-		if (next_plan < 0)
-			next_plan = get_next_subplan(state, INVALID_SUBPLAN_INDEX);
+		const int plan = state->parallel_order[pos];
 
-		if (next_plan == start || next_plan < 0)
+		/* The plan does not get assigned another worker */
+		pg_atomic_fetch_or_u32(&pstate->subplan_state[plan], SUBPLAN_STATE_FINISHED);
+
+		if (is_valid_subplan(state, plan))
 		{
-			/*
-			 * back at start of search so all subplans are finished
-			 *
-			 * next_plan should not be < 0 because this means there
-			 * are no valid subplans and then the function would
-			 * have returned at the check before the while loop but
-			 * static analysis marked this so might as well include
-			 * that in the check
-			 */
-			Assert(next_plan >= 0);
-			pstate->next_plan = NO_MATCHING_SUBPLANS;
-			state->current = NO_MATCHING_SUBPLANS;
-			LWLockRelease(state->lock);
+			state->current = plan;
 			return;
 		}
 	}
 
-	Assert(next_plan >= 0 && next_plan < state->num_subplans);
-	state->current = next_plan;
-
 	/*
-	 * if this is not a partial plan we mark it as finished
-	 * immediately so it does not get assigned another worker
+	 * Several workers can run a partial subplan, until one of them finishes
+	 * it. Every choice starts at the next partial subplan, so that the workers
+	 * are spread over the unfinished ones, the largest first.
 	 */
-	if (next_plan < state->filtered_first_partial_plan)
-		pstate->subplan_state[next_plan] =
-			ts_set_flags_32(pstate->subplan_state[next_plan], SUBPLAN_STATE_FINISHED);
+	if (num_partial > 0)
+	{
+		const uint32 start = pg_atomic_fetch_add_u32(&pstate->next_partial_plan, 1);
 
-	/* advance next_plan for next worker */
-	pstate->next_plan = get_next_subplan(state, state->current);
-	/*
-	 * if we reach the end of the list of subplans we set next_plan
-	 * to INVALID_SUBPLAN_INDEX to allow rechecking unfinished subplans
-	 * on next call
-	 */
-	if (pstate->next_plan < 0)
-		pstate->next_plan = INVALID_SUBPLAN_INDEX;
+		for (uint32 i = 0; i < num_partial; i++)
+		{
+			const int plan = state->parallel_order[num_non_partial + (start + i) % num_partial];
+
+			if (pg_atomic_read_u32(&pstate->subplan_state[plan]) & SUBPLAN_STATE_FINISHED)
+				continue;
 
-	LWLockRelease(state->lock);
+			if (!is_valid_subplan(state, plan))
+			{
+				pg_atomic_fetch_or_u32(&pstate->subplan_state[plan], SUBPLAN_STATE_FINISHED);
+				continue;
+			}
+
+			state->current = plan;
+			return;
+		}
+	}
+
+	/* all subplans are finished */
+	state->current = NO_MATCHING_SUBPLANS;
 }
 
 /*
@@ -767,7 +1337,7 @@ chunk_append_estimate_dsm(CustomScanState *node, ParallelContext *pcxt)
 {
 	ChunkAppendState *state = (ChunkAppendState *) node;
 	return add_size(offsetof(ParallelChunkAppendState, subplan_state),
-					sizeof(uint32) * list_length(state->initial_subplans));
+					sizeof(pg_atomic_uint32) * list_length(state->initial_subplans));
 }
 
 /*
@@ -785,15 +1355,17 @@ init_pstate(ChunkAppendState *state, ParallelChunkAppendState *pstate)
 
 	memset(pstate, 0, state->csstate.pscan_len);
 
-	pstate->next_plan = INVALID_SUBPLAN_INDEX;
+	pg_atomic_init_u32(&pstate->next_non_partial_plan, 0);
+	pg_atomic_init_u32(&pstate->next_partial_plan, 0);
 	pstate->filtered_first_partial_plan = state->filtered_first_partial_plan;
 
 	/* Mark active subplans in parallel state */
-	int plan = -1;
-	while ((plan = bms_next_member(state->included_subplans_by_se, plan)) >= 0)
+	for (int plan = 0; plan < list_length(state->initial_subplans); plan++)
 	{
-		pstate->subplan_state[plan] =
-			ts_set_flags_32(pstate->subplan_state[plan], SUBPLAN_STATE_INCLUDED);
+		pg_atomic_init_u32(&pstate->subplan_state[plan],
+						   bms_is_member(plan, state->included_subplans_by_se) ?
+							   SUBPLAN_STATE_INCLUDED :
+							   0);
 	}
 }
 
@@ -812,8 +1384,6 @@ chunk_append_initialize_dsm(CustomScanState *node, ParallelContext *pcxt, void *
 	ParallelChunkAppendState *pstate = (ParallelChunkAppendState *) coordinate;
 	init_pstate(state, pstate);
 
-	state->lock = chunk_append_get_lock_pointer();
-
 	/*
 	 * Leader should use the same subplan selection as normal worker threads. If the user wishes to
 	 * disallow running plans on the leader they should do so via the parallel_leader_participation
@@ -867,10 +1437,11 @@ chunk_append_initialize_worker(CustomScanState *node, shm_toc *toc, void *coordi
 	List *filtered_subplans = NIL;
 	List *filtered_ri_clauses = NIL;
 	List *filtered_constraints = NIL;
+	List *filtered_chunk_ranges = NIL;
 
 	for (int plan = 0; plan < list_length(state->initial_subplans); plan++)
 	{
-		if (ts_flags_are_set_32(pstate->subplan_state[plan], SUBPLAN_STATE_INCLUDED))
+		if (pg_atomic_read_u32(&pstate->subplan_state[plan]) & SUBPLAN_STATE_INCLUDED)
 		{
 			filtered_subplans =
 				lappend(filtered_subplans, list_nth(state->filtered_subplans, plan));
@@ -878,17 +1449,20 @@ chunk_append_initialize_worker(CustomScanState *node, shm_toc *toc, void *coordi
 				lappend(filtered_ri_clauses, list_nth(state->filtered_ri_clauses, plan));
 			filtered_constraints =
 				lappend(filtered_constraints, list_nth(state->filtered_constraints, plan));
+			if (state->filtered_chunk_ranges != NIL)
+				filtered_chunk_ranges =
+					lappend(filtered_chunk_ranges, list_nth(state->filtered_chunk_ranges, plan));
 		}
 	}
 
 	state->filtered_subplans = filtered_subplans;
 	state->filtered_ri_clauses = filtered_ri_clauses;
 	state->filtered_constraints = filtered_constraints;
+	state->filtered_chunk_ranges = filtered_chunk_ranges;
 
 	Assert(list_length(state->filtered_subplans) == list_length(state->filtered_ri_clauses));
 	Assert(list_length(state->filtered_ri_clauses) == list_length(state->filtered_constraints));
 
-	state->lock = chunk_append_get_lock_pointer();
 	state->choose_next_subplan = choose_next_subplan_for_worker;
 	state->current = INVALID_SUBPLAN_INDEX;
 	state->pstate = pstate;
@@ -897,21 +1471,6 @@ chunk_append_initialize_worker(CustomScanState *node, shm_toc *toc, void *coordi
 	Assert(state->num_subplans == list_length(state->filtered_subplans));
 }
 
-/*
- * get a pointer to the LWLock used for coordinating
- * parallel workers
- */
-static LWLock *
-chunk_append_get_lock_pointer()
-{
-	LWLock **lock = (LWLock **) find_rendezvous_variable(RENDEZVOUS_CHUNK_APPEND_LWLOCK);
-
-	if (*lock == NULL)
-		elog(ERROR, "LWLock for coordinating parallel workers not initialized");
-
-	return *lock;
-}
-
 /*
  * Convert restriction clauses to constants expressions (i.e., if there are
  * mutable functions, they need to be evaluated to constants).  For instance,
@@ -19,13 +19,20 @@
 #include <optimizer/subselect.h>
 #include <optimizer/tlist.h>
 #include <parser/parsetree.h>
+#include <utils/lsyscache.h>
+#include <utils/typcache.h>
 
+#include "chunk.h"
 #include "guc.h"
+#include "hypercube.h"
 #include "import/planner.h"
 #include "nodes/chunk_append/chunk_append.h"
 #include "nodes/chunk_append/transform.h"
 #include "nodes/hypertable_modify.h"
 #include "nodes/vector_agg.h"
+#include "planner/planner.h"
+#include "time_utils.h"
+#include "utils.h"
 
 static Sort *make_sort(Plan *lefttree, int numCols, AttrNumber *sortColIdx, Oid *sortOperators,
 					   Oid *collations, bool *nullsFirst);
@@ -93,6 +100,232 @@ adjust_childscan(PlannerInfo *root, Plan *plan, Path *path, List *pathkeys, List
 	return plan;
 }
 
+/*
+ * Check if the clause compares an open dimension column with a value that
+ * doesn't change during one scan, like "time > $1", so that runtime exclusion
+ * can compare the value with the chunk ranges directly. Returns a list of the
+ * dimension position in dimension_ids, the btree strategy and the value
+ * expression, or NIL if the clause doesn't have this form.
+ */
+static List *
+make_range_exclusion_clause(Expr *clause, Index relid, const Hypertable *ht, List **dimension_ids)
+{
+	if (!IsA(clause, OpExpr) || list_length(castNode(OpExpr, clause)->args) != 2)
+		return NIL;
+
+	OpExpr *op = castNode(OpExpr, clause);
+	Node *left = linitial(op->args);
+	Node *right = lsecond(op->args);
+	Oid opno = op->opno;
+	Var *var;
+	Expr *value;
+
+	if (IsA(left, Var) && (IsA(right, Param) || IsA(right, Const)))
+	{
+		var = castNode(Var, left);
+		value = (Expr *) right;
+	}
+	else if (IsA(right, Var) && (IsA(left, Param) || IsA(left, Const)))
+	{
+		var = castNode(Var, right);
+		value = (Expr *) left;
+		opno = get_commutator(opno);
+	}
+	else
+		return NIL;
+
+	if ((Index) var->varno != relid || var->varattno <= 0 || !OidIsValid(opno) ||
+		exprType((Node *) value) != var->vartype ||
+		!(IS_INTEGER_TYPE(var->vartype) || IS_TIMESTAMP_TYPE(var->vartype)))
+		return NIL;
+
+	/*
+	 * The chunk ranges are in the internal representation of the column
+	 * values, so this doesn't work with the custom partitioning functions.
+	 */
+	const Dimension *dim = NULL;
+	for (int i = 0; i < ht->space->num_dimensions; i++)
+	{
+		if (ht->space->dimensions[i].column_attno == var->varattno)
+			dim = &ht->space->dimensions[i];
+	}
+
+	if (dim == NULL || dim->type != DIMENSION_TYPE_OPEN || dim->partitioning != NULL ||
+		ts_dimension_get_partition_type(dim) != var->vartype)
+		return NIL;
+
+	TypeCacheEntry *tce = lookup_type_cache(var->vartype, TYPECACHE_BTREE_OPFAMILY);
+	int strategy = get_op_opfamily_strategy(opno, tce->btree_opf);
+	if (strategy < BTLessStrategyNumber || strategy > BTGreaterStrategyNumber)
+		return NIL;
+
+	int position = list_length(*dimension_ids);
+	ListCell *lc;
+	foreach (lc, *dimension_ids)
+	{
+		if (lfirst_int(lc) == dim->fd.id)
+		{
+			position = foreach_current_index(lc);
+			break;
+		}
+	}
+
+	if (position == list_length(*dimension_ids))
+		*dimension_ids = lappend_int(*dimension_ids, dim->fd.id);
+
+	return list_make3(makeInteger(position), makeInteger(strategy), copyObject(value));
+}
+
+static bool
+collect_exec_params_walker(Node *node, List **params)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, Param) && castNode(Param, node)->paramkind == PARAM_EXEC)
+	{
+		ListCell *lc;
+		foreach (lc, *params)
+		{
+			if (castNode(Param, lfirst(lc))->paramid == castNode(Param, node)->paramid)
+				return false;
+		}
+		*params = lappend(*params, copyObject(node));
+		return false;
+	}
+
+	return expression_tree_walker(node, collect_exec_params_walker, params);
+}
+
+/*
+ * Check if the dimension slice of the OSM chunk can be used for the range
+ * exclusion. The OSM extension sets an invalid range when the chunk is
+ * empty, and marks the hypertable noncontiguous when the tiered data is not
+ * covered by the range, which is the same condition as for the plan-time
+ * exclusion in ts_hypertable_restrict_info_get_chunks().
+ */
+static bool
+osm_chunk_range_usable(const Hypertable *ht, const Chunk *chunk)
+{
+	Assert(IS_OSM_CHUNK(chunk));
+
+	if (ts_flags_are_set_32(ht->fd.status, HYPERTABLE_STATUS_OSM_CHUNK_NONCONTIGUOUS))
+		return false;
+
+	for (int i = 0; i < chunk->cube->num_slices; i++)
+	{
+		const DimensionSlice *slice = chunk->cube->slices[i];
+
+		if (ts_osm_chunk_range_is_invalid(slice->fd.range_start, slice->fd.range_end))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Prepare the range exclusion for the runtime exclusion of the chunks.
+ *
+ * Runtime exclusion has to prove for every chunk and every rescan that the
+ * chunk constraints are refuted by the clauses, which adds up for the inner
+ * side of a nested loop over many chunks. For the clauses comparing an open
+ * dimension with a parameter, we instead pass the dimension ranges of the
+ * chunks to the executor, and compare them with the parameter values.
+ *
+ * Returns a list of the range clauses, and a list of the chunk ranges for
+ * every child plan, which is a list of int8 constants with the start and end
+ * of every dimension in the order of the dimension positions, or NIL if the
+ * child is not a chunk scan. Sets *complete if all the clauses that use
+ * parameters are range clauses, so that the clauses don't have to be checked
+ * for the chunks with ranges.
+ */
+static List *
+make_range_exclusion(PlannerInfo *root, RelOptInfo *rel, List *clauses, List *custom_plans,
+					 List **chunk_ranges, bool *complete)
+{
+	Hypertable *ht =
+		ts_planner_get_hypertable(planner_rt_fetch(rel->relid, root)->relid, CACHE_FLAG_NONE);
+	List *range_clauses = NIL;
+	List *dimension_ids = NIL;
+	ListCell *lc;
+
+	*chunk_ranges = NIL;
+	*complete = true;
+
+	if (ht == NULL)
+		return NIL;
+
+	foreach (lc, clauses)
+	{
+		Expr *clause = castNode(RestrictInfo, lfirst(lc))->clause;
+		List *range_clause = make_range_exclusion_clause(clause, rel->relid, ht, &dimension_ids);
+
+		if (range_clause != NIL)
+			range_clauses = lappend(range_clauses, range_clause);
+		else if (ts_contains_join_param((Node *) clause) ||
+				 ts_contains_external_param((Node *) clause))
+			*complete = false;
+	}
+
+	if (range_clauses == NIL)
+		return NIL;
+
+	foreach (lc, custom_plans)
+	{
+		Scan *scan = ts_chunk_append_get_scan_plan(lfirst(lc));
+		List *ranges = NIL;
+
+		if (scan != NULL && scan->scanrelid > 0 && root->simple_rel_array[scan->scanrelid] != NULL)
+		{
+			RelOptInfo *chunk_rel = root->simple_rel_array[scan->scanrelid];
+			const Chunk *chunk = ts_planner_chunk_fetch(root, chunk_rel);
+
+			/*
+			 * The OSM chunks don't have the dimension constraints, but their
+			 * time range is tracked in the OSM slice, so we can exclude them
+			 * by the range if it is valid and covers all the tiered data.
+			 */
+			if (chunk != NULL && chunk->cube != NULL &&
+				(!IS_OSM_CHUNK(chunk) || osm_chunk_range_usable(ht, chunk)))
+			{
+				ListCell *lc_dim;
+				foreach (lc_dim, dimension_ids)
+				{
+					const DimensionSlice *slice =
+						ts_hypercube_get_slice_by_dimension_id(chunk->cube, lfirst_int(lc_dim));
+
+					if (slice == NULL)
+					{
+						ranges = NIL;
+						break;
+					}
+
+					ranges = lappend(ranges,
+									 makeConst(INT8OID,
+											   -1,
+											   InvalidOid,
+											   sizeof(int64),
+											   Int64GetDatum(slice->fd.range_start),
+											   false,
+											   FLOAT8PASSBYVAL));
+					ranges = lappend(ranges,
+									 makeConst(INT8OID,
+											   -1,
+											   InvalidOid,
+											   sizeof(int64),
+											   Int64GetDatum(slice->fd.range_end),
+											   false,
+											   FLOAT8PASSBYVAL));
+				}
+			}
+		}
+
+		*chunk_ranges = lappend(*chunk_ranges, ranges);
+	}
+
+	return list_make2(range_clauses, list_make1_int(list_length(dimension_ids)));
+}
+
 Plan *
 ts_chunk_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *path, List *tlist,
 							List *clauses, List *custom_plans)
@@ -284,6 +517,30 @@ ts_chunk_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *path
 		}
 	}
 
+	/*
+	 * Prepare the range exclusion, and collect the parameters that determine
+	 * the result of runtime exclusion, so that the executor can remember the
+	 * result for every combination of their values.
+	 */
+	List *range_exclusion = NIL;
+	List *chunk_ranges = NIL;
+	List *exclusion_params = NIL;
+	bool range_exclusion_complete = false;
+	if (capath->runtime_exclusion_children)
+		range_exclusion = make_range_exclusion(root,
+											   rel,
+											   clauses,
+											   custom_plans,
+											   &chunk_ranges,
+											   &range_exclusion_complete);
+	if ((capath->runtime_exclusion_parent || capath->runtime_exclusion_children) &&
+		!contain_volatile_functions((Node *) clauses))
+	{
+		foreach (lc_child, clauses)
+			collect_exec_params_walker((Node *) castNode(RestrictInfo, lfirst(lc_child))->clause,
+									   &exclusion_params);
+	}
+
 	if (capath->pushdown_limit && capath->limit_tuples > 0)
 		limit = capath->limit_tuples;
 
@@ -296,6 +553,11 @@ ts_chunk_append_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *path
 	custom_private = lappend(custom_private, chunk_rt_indexes);
 	custom_private = lappend(custom_private, sort_options);
 	custom_private = lappend(custom_private, parent_clauses);
+	custom_private = lappend(custom_private,
+							 list_make4(range_exclusion,
+										chunk_ranges,
+										list_make1_int(range_exclusion_complete),
+										exclusion_params));
 
 	cscan->custom_private = custom_private;
 
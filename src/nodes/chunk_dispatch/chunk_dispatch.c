@@ -11,6 +11,7 @@
 #include <nodes/makefuncs.h>
 #include <nodes/nodeFuncs.h>
 #include <nodes/nodes.h>
+#include <optimizer/optimizer.h>
 #include <parser/parsetree.h>
 #include <storage/lmgr.h>
 #include <storage/lockdefs.h>
@@ -21,14 +22,30 @@
 #include "chunk_dispatch.h"
 #include "chunk_insert_state.h"
 #include "dimension.h"
+#include "dimension_slice.h"
 #include "errors.h"
 #include "guc.h"
 #include "hypercube.h"
+#include "memory_usage.h"
 #include "nodes/hypertable_modify.h"
 #include "subspace_store.h"
+#include "trace.h"
 
 static Node *chunk_dispatch_state_create(CustomScan *cscan);
 
+/* The counters of the chunk insert state caches of all inserts in the backend */
+static CacheUsage chunk_insert_state_cache_usage = {
+	.name = "chunk_insert_state_cache",
+	.entries = -1,
+	.memory = -1,
+};
+
+void
+ts_chunk_dispatch_get_usage(CacheUsage *usage)
+{
+	*usage = chunk_insert_state_cache_usage;
+}
+
 ChunkDispatch *
 ts_chunk_dispatch_create(Hypertable *ht, EState *estate, int eflags)
 {
@@ -38,10 +55,17 @@ ts_chunk_dispatch_create(Hypertable *ht, EState *estate, int eflags)
 	cd->estate = estate;
 	cd->eflags = eflags;
 	cd->hypertable_result_rel_info = NULL;
-	cd->cache =
-		ts_subspace_store_init(ht->space, estate->es_query_cxt, ts_guc_max_open_chunks_per_insert);
+	cd->cache = ts_subspace_store_init(ht->space,
+									   estate->es_query_cxt,
+									   ts_guc_max_open_chunks_per_insert,
+									   &chunk_insert_state_cache_usage);
 	cd->prev_cis = NULL;
 	cd->prev_cis_oid = InvalidOid;
+	cd->multi_insert_states = NIL;
+	cd->direct_compress_states = NIL;
+	cd->multi_insert_nbytes = 0;
+	cd->copy_multi_insert = false;
+	cd->fk_key_cache = NULL;
 
 	return cd;
 }
@@ -58,6 +82,54 @@ destroy_chunk_insert_state(void *cis)
 	ts_chunk_insert_state_destroy((ChunkInsertState *) cis);
 }
 
+/*
+ * Close the chunks of the earliest time ranges until the memory of the open
+ * chunks is within timescaledb.max_open_chunks_memory_per_insert. This is
+ * checked before opening another chunk, so the memory is attributed by the
+ * name of the memory contexts of the chunk insert states, which includes the
+ * chunks of the other hypertables of the same statement.
+ */
+static void
+chunk_dispatch_limit_memory(ChunkDispatch *dispatch)
+{
+	const int64 limit = (int64) ts_guc_max_open_chunks_memory_per_insert * 1024;
+
+	if (limit == 0)
+		return;
+
+	while (ts_memory_context_children_allocated(dispatch->estate->es_query_cxt,
+												TS_CHUNK_INSERT_STATE_MEMORY_CONTEXT) > limit)
+	{
+		/* The previous chunk might be closed as well */
+		dispatch->prev_cis = NULL;
+		dispatch->prev_cis_oid = InvalidOid;
+
+		if (ts_subspace_store_evict_earliest(dispatch->cache) == 0)
+			break;
+	}
+}
+
+/*
+ * Check if the point is within the slices of the chunk. This is a few integer
+ * comparisons, which is cheaper than the subspace store lookup.
+ */
+static inline bool
+chunk_insert_state_contains_point(const ChunkInsertState *cis, const Point *point)
+{
+	Assert(cis->cube->num_slices == point->cardinality);
+
+	for (int i = 0; i < point->cardinality; i++)
+	{
+		const DimensionSlice *slice = cis->cube->slices[i];
+		const int64 coord = REMAP_LAST_COORDINATE(point->coordinates[i]);
+
+		if (coord < slice->fd.range_start || coord >= slice->fd.range_end)
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * Get the chunk insert state for the chunk that matches the given point in the
  * partitioned hyperspace.
@@ -81,6 +153,16 @@ ts_chunk_dispatch_get_chunk_insert_state(ChunkDispatch *dispatch, Point *point,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("direct insert into internal compressed hypertable is not supported")));
 
+	/*
+	 * With the usual time-ordered ingest, consecutive rows go into the same
+	 * chunk, so check the previous chunk before searching the subspace store.
+	 * The previous chunk insert state is always in the store, since the
+	 * entries are only evicted when adding a new one, which then becomes the
+	 * previous one.
+	 */
+	if (dispatch->prev_cis != NULL && chunk_insert_state_contains_point(dispatch->prev_cis, point))
+		return dispatch->prev_cis;
+
 	cis = ts_subspace_store_get(dispatch->cache, point);
 
 	/*
@@ -138,13 +220,21 @@ ts_chunk_dispatch_get_chunk_insert_state(ChunkDispatch *dispatch, Point *point,
 
 		if (!chunk)
 		{
+			TIMESCALEDB_CHUNK_DISPATCH_CREATE_START(dispatch->hypertable->fd.id);
 			chunk = ts_hypertable_create_chunk_for_point(dispatch->hypertable, point, &found);
+			TIMESCALEDB_CHUNK_DISPATCH_CREATE_DONE(dispatch->hypertable->fd.id,
+												   chunk ? chunk->fd.id : 0,
+												   chunk ? chunk->table_id : InvalidOid);
 		}
 
 		if (!chunk)
 			elog(ERROR, "no chunk found or created");
 
+		chunk_dispatch_limit_memory(dispatch);
 		cis = ts_chunk_insert_state_create(chunk->table_id, dispatch);
+		MemoryContextSwitchTo(cis->mctx);
+		cis->cube = ts_hypercube_copy(chunk->cube);
+		MemoryContextSwitchTo(GetPerTupleMemoryContext(dispatch->estate));
 		ts_subspace_store_add(dispatch->cache, chunk->cube, cis, destroy_chunk_insert_state);
 	}
 	else if (cis->rel->rd_id == dispatch->prev_cis_oid && cis == dispatch->prev_cis)
@@ -155,8 +245,13 @@ ts_chunk_dispatch_get_chunk_insert_state(ChunkDispatch *dispatch, Point *point,
 
 	MemoryContextSwitchTo(old_context);
 
-	if (cis_changed && on_chunk_changed)
-		on_chunk_changed(cis, data);
+	if (cis_changed)
+	{
+		TIMESCALEDB_CHUNK_DISPATCH_ROUTE(dispatch->hypertable->fd.id, cis->rel->rd_id);
+
+		if (on_chunk_changed)
+			on_chunk_changed(cis, data);
+	}
 
 	Assert(cis != NULL);
 	dispatch->prev_cis = cis;
@@ -214,6 +309,77 @@ ts_chunk_dispatch_decompress_batches_for_insert(ChunkDispatch *dispatch, ChunkIn
 	}
 }
 
+/*
+ * Insert all the rows buffered for the multi-inserts into their chunks.
+ */
+void
+ts_chunk_dispatch_flush_multi_insert(ChunkDispatch *dispatch)
+{
+	ListCell *lc;
+
+	foreach (lc, dispatch->multi_insert_states)
+		ts_chunk_insert_state_flush_multi_insert(lfirst(lc));
+
+	list_free(dispatch->multi_insert_states);
+	dispatch->multi_insert_states = NIL;
+	dispatch->multi_insert_nbytes = 0;
+}
+
+/*
+ * Compress the rows buffered for direct compression into their compressed
+ * chunks.
+ *
+ * This has to happen before the AFTER STATEMENT triggers fire, so that they
+ * see all the inserted rows, and not only when the chunk insert states are
+ * destroyed.
+ */
+void
+ts_chunk_dispatch_flush_direct_compress(ChunkDispatch *dispatch)
+{
+	ListCell *lc;
+
+	foreach (lc, dispatch->direct_compress_states)
+		ts_cm_functions->direct_compress_end(lfirst(lc));
+
+	list_free(dispatch->direct_compress_states);
+	dispatch->direct_compress_states = NIL;
+}
+
+/* list_sort comparator to sort the chunk insert states by buffered bytes, largest first */
+static int
+cmp_multi_insert_nbytes(const ListCell *a, const ListCell *b)
+{
+	const Size nbytes_a = ((const ChunkInsertState *) lfirst(a))->multi_insert->nbytes;
+	const Size nbytes_b = ((const ChunkInsertState *) lfirst(b))->multi_insert->nbytes;
+
+	if (nbytes_a > nbytes_b)
+		return -1;
+	if (nbytes_a < nbytes_b)
+		return 1;
+	return 0;
+}
+
+/*
+ * Flush the largest multi-insert buffers until the buffered rows take at most
+ * half of the memory budget.
+ *
+ * Flushing the largest buffers first frees the most memory with the fewest
+ * (and largest) multi-inserts, while the buffers of the chunks that get few
+ * rows can keep collecting them.
+ */
+void
+ts_chunk_dispatch_flush_largest_multi_insert(ChunkDispatch *dispatch)
+{
+	list_sort(dispatch->multi_insert_states, cmp_multi_insert_nbytes);
+
+	while (dispatch->multi_insert_states != NIL &&
+		   dispatch->multi_insert_nbytes > CHUNK_MULTI_INSERT_MAX_BYTES / 2)
+	{
+		ts_chunk_insert_state_flush_multi_insert(linitial(dispatch->multi_insert_states));
+		dispatch->multi_insert_states = list_delete_first(dispatch->multi_insert_states);
+	}
+}
+
 static CustomScanMethods chunk_dispatch_plan_methods = {
 	.CustomName = "ChunkDispatch",
 	.CreateCustomScanState = chunk_dispatch_state_create,
@@ -224,8 +390,8 @@ static CustomScanMethods chunk_dispatch_plan_methods = {
  * in a hypertable.
  *
  * Note that CustomScan nodes cannot be extended (by struct embedding) because
- * they might be copied, therefore we pass hypertable_relid in the
- * custom_private field.
+ * they might be copied, therefore we pass hypertable_relid and
+ * has_volatile_functions in the custom_private field.
  *
  * The chunk dispatch plan takes the original tuple-producing subplan, which
  * was part of a ModifyTable node, and imposes itself between the
@@ -251,7 +417,8 @@ chunk_dispatch_plan_create(PlannerInfo *root, RelOptInfo *relopt, CustomPath *be
 		cscan->scan.plan.plan_width += subplan->plan_width;
 	}
 
-	cscan->custom_private = list_make1_oid(cdpath->hypertable_relid);
+	cscan->custom_private = list_make2(list_make1_oid(cdpath->hypertable_relid),
+									   list_make1_int(cdpath->has_volatile_functions));
 	cscan->methods = &chunk_dispatch_plan_methods;
 	cscan->custom_plans = custom_plans;
 	cscan->scan.scanrelid = 0; /* Indicate this is not a real relation we are
@@ -291,6 +458,7 @@ ts_chunk_dispatch_path_create(PlannerInfo *root, ModifyTablePath *mtpath, Index
 	path->mtpath = mtpath;
 	path->hypertable_rti = hypertable_rti;
 	path->hypertable_relid = rte->relid;
+	path->has_volatile_functions = contain_volatile_functions_not_nextval((Node *) root->parse);
 
 	return &path->cpath.path;
 }
@@ -506,10 +674,11 @@ static Node *
 chunk_dispatch_state_create(CustomScan *cscan)
 {
 	ChunkDispatchState *state;
-	Oid hypertable_relid = linitial_oid(cscan->custom_private);
+	Oid hypertable_relid = linitial_oid(linitial(cscan->custom_private));
 
 	state = (ChunkDispatchState *) newNode(sizeof(ChunkDispatchState), T_CustomScanState);
 	state->hypertable_relid = hypertable_relid;
+	state->has_volatile_functions = linitial_int(lsecond(cscan->custom_private));
 	Assert(list_length(cscan->custom_plans) == 1);
 	state->subplan = linitial(cscan->custom_plans);
 	state->cscan_state.methods = &chunk_dispatch_state_methods;
@@ -40,6 +40,25 @@ typedef struct ChunkDispatch
 	ResultRelInfo *hypertable_result_rel_info;
 	ChunkInsertState *prev_cis;
 	Oid prev_cis_oid;
+
+	/*
+	 * The chunk insert states that have rows in their multi-insert buffers,
+	 * and the total size of these rows.
+	 */
+	List *multi_insert_states;
+	Size multi_insert_nbytes;
+
+	/* The chunk insert states that buffer their rows for direct compression */
+	List *direct_compress_states;
+
+	/* COPY buffers the rows for multi-inserts */
+	bool copy_multi_insert;
+
+	/*
+	 * The foreign keys found in the referenced tables by the batched foreign
+	 * key checks of all the chunks.
+	 */
+	struct ChunkFkKeyCache *fk_key_cache;
 } ChunkDispatch;
 
 typedef struct ChunkDispatchPath
@@ -48,6 +67,8 @@ typedef struct ChunkDispatchPath
 	ModifyTablePath *mtpath;
 	Index hypertable_rti;
 	Oid hypertable_relid;
+	/* The statement has volatile functions other than nextval() */
+	bool has_volatile_functions;
 } ChunkDispatchPath;
 
 typedef struct Cache Cache;
@@ -59,6 +80,12 @@ typedef struct ChunkDispatchState
 	Plan *subplan;
 	Cache *hypertable_cache;
 	Oid hypertable_relid;
+	/*
+	 * The statement has volatile functions other than nextval(). These might
+	 * query the hypertable, so they must see the inserted rows, and we can't
+	 * buffer the rows for multi-inserts.
+	 */
+	bool has_volatile_functions;
 	List *arbiter_indexes;
 	/*
 	 * Keep a pointer to the parent ModifyTableState executor node since we need
@@ -100,12 +127,16 @@ typedef void (*on_chunk_changed_func)(ChunkInsertState *state, void *data);
 
 extern ChunkDispatch *ts_chunk_dispatch_create(Hypertable *ht, EState *estate, int eflags);
 extern void ts_chunk_dispatch_destroy(ChunkDispatch *chunk_dispatch);
+extern void ts_chunk_dispatch_get_usage(CacheUsage *usage);
 extern ChunkInsertState *
 ts_chunk_dispatch_get_chunk_insert_state(ChunkDispatch *dispatch, Point *p,
 										 const on_chunk_changed_func on_chunk_changed, void *data);
 extern void ts_chunk_dispatch_decompress_batches_for_insert(ChunkDispatch *dispatch,
 															ChunkInsertState *cis,
 															TupleTableSlot *slot);
+extern void ts_chunk_dispatch_flush_multi_insert(ChunkDispatch *dispatch);
+extern void ts_chunk_dispatch_flush_largest_multi_insert(ChunkDispatch *dispatch);
+extern void ts_chunk_dispatch_flush_direct_compress(ChunkDispatch *dispatch);
 extern TupleTableSlot *ts_chunk_dispatch_prepare_tuple_routing(ChunkDispatchState *state,
 															   TupleTableSlot *slot);
 
@@ -0,0 +1,539 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Batched checks of the foreign keys of the rows inserted into the chunks.
+ *
+ * The foreign keys of a hypertable are cloned to its chunks, and PostgreSQL
+ * checks them with an AFTER ROW trigger, which runs a query on the referenced
+ * table for every inserted row at the end of the statement. When the rows are
+ * buffered for multi-inserts, we take over these checks instead: before a
+ * buffer is inserted, we look up the keys of its rows in the unique index of
+ * the referenced table, and lock the referenced rows FOR KEY SHARE, same as
+ * the trigger does. The locks are held until the end of the transaction, so
+ * the keys we found can't disappear, and we remember them for the rest of the
+ * statement. The referenced tables are usually small dimension tables, so
+ * most of the rows are checked with a hash table lookup.
+ *
+ * We only take over the simple cases and leave the rest to the triggers: the
+ * constraint must be MATCH SIMPLE and not deferrable, the referenced table
+ * must be a plain table, and the referencing and referenced columns must be
+ * compared with the same operators. On REPEATABLE READ and SERIALIZABLE
+ * isolation levels, the triggers also check the keys with the transaction
+ * snapshot, so we don't take over the checks there either.
+ */
+#include <postgres.h>
+#include <access/genam.h>
+#include <access/htup_details.h>
+#include <access/nbtree.h>
+#include <access/relation.h>
+#include <access/skey.h>
+#include <access/tupmacs.h>
+#include <access/xact.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_constraint.h>
+#include <catalog/pg_trigger.h>
+#include <common/hashfn.h>
+#include <lib/stringinfo.h>
+#include <miscadmin.h>
+#include <storage/lmgr.h>
+#include <utils/acl.h>
+#include <utils/fmgroids.h>
+#include <utils/hsearch.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+#include <utils/syscache.h>
+
+#include "chunk_dispatch.h"
+#include "chunk_fk_check.h"
+#include "scanner.h"
+
+/*
+ * Remember at most this many keys per statement, so that a statement
+ * referencing a large table doesn't use too much memory.
+ */
+#define CHUNK_FK_KEY_CACHE_MAX_ENTRIES 65536
+
+/*
+ * A foreign key constraint of the chunk that we check instead of the trigger.
+ *
+ * The scan keys are in the order of the index columns, as required for the
+ * btree index scans, and only need the arguments.
+ */
+typedef struct ChunkFkConstraint
+{
+	NameData conname;
+	Oid pk_relid;
+	Oid pk_indexid;
+	int nkeys;
+	AttrNumber fk_attnums[INDEX_MAX_KEYS]; /* Key columns of the chunk */
+	int scankey_keys[INDEX_MAX_KEYS];	   /* Key column of each scan key */
+	ScanKeyData scankeys[INDEX_MAX_KEYS];
+} ChunkFkConstraint;
+
+struct ChunkFkCheck
+{
+	Relation rel;
+	ChunkFkKeyCache *cache;
+	int nconstraints;
+	ChunkFkConstraint *constraints;
+	StringInfoData key; /* Buffer for serializing the keys */
+};
+
+/*
+ * The keys found in the referenced tables, serialized as the index Oid
+ * followed by the binary values of the key columns. The keys can be shared by
+ * all the chunks, since the chunks of a hypertable have the same foreign keys
+ * referencing the same indexes.
+ *
+ * Two equal keys can have different binary values, e.g., for numeric values
+ * with different scales, but then we only miss the cache and look up the key
+ * in the index again.
+ */
+struct ChunkFkKeyCache
+{
+	MemoryContext mcxt;
+	HTAB *keys;
+};
+
+typedef struct ChunkFkKey
+{
+	const char *data;
+	uint32 len;
+} ChunkFkKey;
+
+static uint32
+chunk_fk_key_hash(const void *key, Size keysize)
+{
+	const ChunkFkKey *fkkey = key;
+	return hash_bytes((const unsigned char *) fkkey->data, fkkey->len);
+}
+
+static int
+chunk_fk_key_match(const void *key1, const void *key2, Size keysize)
+{
+	const ChunkFkKey *a = key1;
+	const ChunkFkKey *b = key2;
+
+	if (a->len != b->len)
+		return 1;
+
+	return memcmp(a->data, b->data, a->len);
+}
+
+static ChunkFkKeyCache *
+chunk_fk_key_cache_create(MemoryContext parent)
+{
+	ChunkFkKeyCache *cache = MemoryContextAlloc(parent, sizeof(ChunkFkKeyCache));
+	HASHCTL ctl = {
+		.keysize = sizeof(ChunkFkKey),
+		.entrysize = sizeof(ChunkFkKey),
+		.hash = chunk_fk_key_hash,
+		.match = chunk_fk_key_match,
+	};
+
+	cache->mcxt = AllocSetContextCreate(parent, "Chunk foreign key cache", ALLOCSET_DEFAULT_SIZES);
+	ctl.hcxt = cache->mcxt;
+	cache->keys = hash_create("Chunk foreign key cache",
+							  128,
+							  &ctl,
+							  HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+
+	return cache;
+}
+
+/*
+ * Check if we can take over the checks of the foreign key trigger, and set up
+ * the constraint for them.
+ */
+static bool
+chunk_fk_constraint_init(const Trigger *trigger, ChunkFkConstraint *fk)
+{
+	AttrNumber conkey[INDEX_MAX_KEYS];
+	AttrNumber confkey[INDEX_MAX_KEYS];
+	Oid pf_eq_oprs[INDEX_MAX_KEYS];
+	Oid pp_eq_oprs[INDEX_MAX_KEYS];
+	Oid ff_eq_oprs[INDEX_MAX_KEYS];
+	int num_delete_set_cols;
+	AttrNumber delete_set_cols[INDEX_MAX_KEYS];
+	int nkeys;
+
+	if (trigger->tgfoid != F_RI_FKEY_CHECK_INS || trigger->tgenabled != TRIGGER_FIRES_ON_ORIGIN ||
+		trigger->tgdeferrable || trigger->tgqual != NULL)
+		return false;
+
+	HeapTuple tuple = SearchSysCache1(CONSTROID, ObjectIdGetDatum(trigger->tgconstraint));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for constraint %u", trigger->tgconstraint);
+
+	Form_pg_constraint con = (Form_pg_constraint) GETSTRUCT(tuple);
+	if (con->contype != CONSTRAINT_FOREIGN || con->confmatchtype != FKCONSTR_MATCH_SIMPLE ||
+		con->condeferrable || get_rel_relkind(con->confrelid) != RELKIND_RELATION)
+	{
+		ReleaseSysCache(tuple);
+		return false;
+	}
+
+	namestrcpy(&fk->conname, NameStr(con->conname));
+	fk->pk_relid = con->confrelid;
+	fk->pk_indexid = con->conindid;
+	DeconstructFkConstraintRow(tuple,
+							   &nkeys,
+							   conkey,
+							   confkey,
+							   pf_eq_oprs,
+							   pp_eq_oprs,
+							   ff_eq_oprs,
+							   &num_delete_set_cols,
+							   delete_set_cols);
+	ReleaseSysCache(tuple);
+
+	for (int i = 0; i < nkeys; i++)
+	{
+		if (pf_eq_oprs[i] != pp_eq_oprs[i])
+			return false;
+	}
+
+	/* The trigger would lock the referenced table the same way */
+	LockRelationOid(fk->pk_relid, RowShareLock);
+	Relation index = index_open(fk->pk_indexid, AccessShareLock);
+	bool supported = index->rd_rel->relam == BTREE_AM_OID &&
+					 IndexRelationGetNumberOfKeyAttributes(index) == nkeys;
+
+	for (int j = 0; supported && j < nkeys; j++)
+	{
+		int key = -1;
+
+		for (int i = 0; i < nkeys; i++)
+		{
+			if (confkey[i] == index->rd_index->indkey.values[j])
+				key = i;
+		}
+
+		if (key < 0)
+		{
+			supported = false;
+			break;
+		}
+
+		fk->scankey_keys[j] = key;
+		ScanKeyEntryInitialize(&fk->scankeys[j],
+							   0,
+							   j + 1,
+							   BTEqualStrategyNumber,
+							   InvalidOid,
+							   index->rd_indcollation[j],
+							   get_opcode(pp_eq_oprs[key]),
+							   (Datum) 0);
+	}
+
+	index_close(index, NoLock);
+
+	if (!supported)
+		return false;
+
+	fk->nkeys = nkeys;
+	memcpy(fk->fk_attnums, conkey, sizeof(AttrNumber) * nkeys);
+
+	return true;
+}
+
+/*
+ * Set up the batched foreign key checks for the rows inserted into the chunk.
+ *
+ * Returns NULL if there are no foreign keys that we can check. Otherwise, the
+ * trigger descriptor without the triggers of these foreign keys is returned
+ * in "trigdesc", for the caller to use if the rows are buffered.
+ */
+ChunkFkCheck *
+ts_chunk_fk_check_create(ChunkDispatch *dispatch, ResultRelInfo *relinfo, TriggerDesc **trigdesc)
+{
+	TriggerDesc *tg = relinfo->ri_TrigDesc;
+	ChunkFkCheck *check = NULL;
+	bool *checked;
+
+	if (tg == NULL || !tg->trig_insert_after_row || IsolationUsesXactSnapshot() ||
+		SessionReplicationRole == SESSION_REPLICATION_ROLE_REPLICA)
+		return NULL;
+
+	checked = palloc0(sizeof(bool) * tg->numtriggers);
+	for (int i = 0; i < tg->numtriggers; i++)
+	{
+		ChunkFkConstraint fk;
+
+		if (!chunk_fk_constraint_init(&tg->triggers[i], &fk))
+			continue;
+
+		if (check == NULL)
+		{
+			check = palloc0(sizeof(ChunkFkCheck));
+			check->rel = relinfo->ri_RelationDesc;
+			check->constraints = palloc(sizeof(ChunkFkConstraint) * tg->numtriggers);
+			initStringInfo(&check->key);
+		}
+
+		check->constraints[check->nconstraints++] = fk;
+		checked[i] = true;
+	}
+
+	if (check == NULL)
+	{
+		pfree(checked);
+		return NULL;
+	}
+
+	if (dispatch->fk_key_cache == NULL)
+		dispatch->fk_key_cache = chunk_fk_key_cache_create(dispatch->estate->es_query_cxt);
+	check->cache = dispatch->fk_key_cache;
+
+	/*
+	 * The foreign key triggers are AFTER ROW INSERT triggers, so only that
+	 * flag can change when we remove them.
+	 */
+	TriggerDesc *newtg = CopyTriggerDesc(tg);
+	int ntriggers = 0;
+
+	newtg->trig_insert_after_row = false;
+	for (int i = 0; i < tg->numtriggers; i++)
+	{
+		if (checked[i])
+			continue;
+
+		newtg->triggers[ntriggers] = newtg->triggers[i];
+		if (TRIGGER_TYPE_MATCHES(newtg->triggers[ntriggers].tgtype,
+								 TRIGGER_TYPE_ROW,
+								 TRIGGER_TYPE_AFTER,
+								 TRIGGER_TYPE_INSERT))
+			newtg->trig_insert_after_row = true;
+		ntriggers++;
+	}
+	newtg->numtriggers = ntriggers;
+	pfree(checked);
+
+	*trigdesc = newtg;
+	return check;
+}
+
+/*
+ * Serialize the key of the row for the cache lookup, and get the values of
+ * the key columns. Returns false if any key column is NULL, and then the row
+ * is not checked, following MATCH SIMPLE.
+ */
+static bool
+chunk_fk_get_key(ChunkFkCheck *check, const ChunkFkConstraint *fk, TupleTableSlot *slot,
+				 Datum *values, ChunkFkKey *key)
+{
+	TupleDesc tupdesc = slot->tts_tupleDescriptor;
+	StringInfo buf = &check->key;
+
+	resetStringInfo(buf);
+	appendBinaryStringInfo(buf, (const char *) &fk->pk_indexid, sizeof(Oid));
+
+	for (int i = 0; i < fk->nkeys; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, AttrNumberGetAttrOffset(fk->fk_attnums[i]));
+		bool isnull;
+
+		values[i] = slot_getattr(slot, fk->fk_attnums[i], &isnull);
+		if (isnull)
+			return false;
+
+		if (att->attbyval)
+		{
+			char data[sizeof(Datum)];
+
+			store_att_byval(data, values[i], att->attlen);
+			appendBinaryStringInfo(buf, data, att->attlen);
+		}
+		else if (att->attlen > 0)
+			appendBinaryStringInfo(buf, DatumGetPointer(values[i]), att->attlen);
+		else if (att->attlen == -1)
+		{
+			struct varlena *value = PG_DETOAST_DATUM_PACKED(values[i]);
+			uint32 len = VARSIZE_ANY_EXHDR(value);
+
+			appendBinaryStringInfo(buf, (const char *) &len, sizeof(len));
+			appendBinaryStringInfo(buf, VARDATA_ANY(value), len);
+		}
+		else
+		{
+			const char *value = DatumGetCString(values[i]);
+			appendBinaryStringInfo(buf, value, strlen(value) + 1);
+		}
+	}
+
+	key->data = buf->data;
+	key->len = buf->len;
+	return true;
+}
+
+static ScanTupleResult
+chunk_fk_key_found(TupleInfo *ti, void *data)
+{
+	bool *found = data;
+
+	switch (ti->lockresult)
+	{
+		case TM_Ok:
+			*found = true;
+			return SCAN_DONE;
+		case TM_Updated:
+		case TM_Deleted:
+			/*
+			 * The referenced row was changed concurrently, so look the key
+			 * up again with a new snapshot, same as the trigger would do in
+			 * READ COMMITTED mode.
+			 */
+			return SCAN_RESTART_WITH_NEW_SNAPSHOT;
+		default:
+			elog(ERROR, "unexpected tuple lock status: %u", ti->lockresult);
+			pg_unreachable();
+	}
+}
+
+/*
+ * Look up the key in the referenced table and lock the referenced row.
+ */
+static bool
+chunk_fk_key_exists(const ChunkFkConstraint *fk, const Datum *values)
+{
+	ScanKeyData scankeys[INDEX_MAX_KEYS];
+	ScanTupLock tuplock = {
+		.lockmode = LockTupleKeyShare,
+		.waitpolicy = LockWaitBlock,
+	};
+	bool found = false;
+
+	memcpy(scankeys, fk->scankeys, sizeof(ScanKeyData) * fk->nkeys);
+	for (int j = 0; j < fk->nkeys; j++)
+		scankeys[j].sk_argument = values[fk->scankey_keys[j]];
+
+	ScannerCtx scanctx = {
+		.table = fk->pk_relid,
+		.index = fk->pk_indexid,
+		.nkeys = fk->nkeys,
+		.scankey = scankeys,
+		.flags = SCANNER_F_KEEPLOCK,
+		.lockmode = RowShareLock,
+		.tuplock = &tuplock,
+		.snapshot = GetLatestSnapshot(),
+		.scandirection = ForwardScanDirection,
+		.data = &found,
+		.tuple_found = chunk_fk_key_found,
+	};
+
+	ts_scanner_scan(&scanctx);
+
+	return found;
+}
+
+/*
+ * Report the violation with the same error as the foreign key trigger.
+ */
+static void
+chunk_fk_report_violation(const ChunkFkCheck *check, const ChunkFkConstraint *fk,
+						  TupleTableSlot *slot)
+{
+	Relation rel = check->rel;
+	TupleDesc tupdesc = RelationGetDescr(rel);
+	StringInfoData names;
+	StringInfoData values;
+	bool has_perm = true;
+
+	/* Only show the key if the user can read all its columns */
+	if (pg_class_aclcheck(RelationGetRelid(rel), GetUserId(), ACL_SELECT) != ACLCHECK_OK)
+	{
+		for (int i = 0; i < fk->nkeys; i++)
+		{
+			if (pg_attribute_aclcheck(RelationGetRelid(rel),
+									  fk->fk_attnums[i],
+									  GetUserId(),
+									  ACL_SELECT) != ACLCHECK_OK)
+			{
+				has_perm = false;
+				break;
+			}
+		}
+	}
+
+	initStringInfo(&names);
+	initStringInfo(&values);
+	for (int i = 0; has_perm && i < fk->nkeys; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, AttrNumberGetAttrOffset(fk->fk_attnums[i]));
+		bool isnull;
+		Datum value = slot_getattr(slot, fk->fk_attnums[i], &isnull);
+		Oid typoutput;
+		bool typisvarlena;
+
+		Assert(!isnull);
+		getTypeOutputInfo(att->atttypid, &typoutput, &typisvarlena);
+		appendStringInfo(&names, "%s%s", i > 0 ? ", " : "", NameStr(att->attname));
+		appendStringInfo(&values,
+						 "%s%s",
+						 i > 0 ? ", " : "",
+						 OidOutputFunctionCall(typoutput, value));
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_FOREIGN_KEY_VIOLATION),
+			 errmsg("insert or update on table \"%s\" violates foreign key constraint \"%s\"",
+					RelationGetRelationName(rel),
+					NameStr(fk->conname)),
+			 has_perm ? errdetail("Key (%s)=(%s) is not present in table \"%s\".",
+								  names.data,
+								  values.data,
+								  get_rel_name(fk->pk_relid)) :
+						errdetail("Key is not present in table \"%s\".",
+								  get_rel_name(fk->pk_relid)),
+			 errtableconstraint(rel, NameStr(fk->conname))));
+}
+
+/*
+ * Check the foreign keys of the rows before they are inserted into the chunk.
+ *
+ * The distinct keys that are not in the cache yet are looked up in the
+ * referenced tables, once for the entire statement.
+ */
+void
+ts_chunk_fk_check_rows(ChunkFkCheck *check, TupleTableSlot **slots, int nslots)
+{
+	ChunkFkKeyCache *cache = check->cache;
+	Datum values[INDEX_MAX_KEYS];
+
+	for (int c = 0; c < check->nconstraints; c++)
+	{
+		const ChunkFkConstraint *fk = &check->constraints[c];
+
+		for (int row = 0; row < nslots; row++)
+		{
+			ChunkFkKey key;
+			bool found;
+
+			if (!chunk_fk_get_key(check, fk, slots[row], values, &key))
+				continue;
+
+			hash_search(cache->keys, &key, HASH_FIND, &found);
+			if (found)
+				continue;
+
+			if (!chunk_fk_key_exists(fk, values))
+				chunk_fk_report_violation(check, fk, slots[row]);
+
+			if (hash_get_num_entries(cache->keys) < CHUNK_FK_KEY_CACHE_MAX_ENTRIES)
+			{
+				char *data = MemoryContextAlloc(cache->mcxt, key.len);
+
+				memcpy(data, key.data, key.len);
+				key.data = data;
+				hash_search(cache->keys, &key, HASH_ENTER, NULL);
+			}
+		}
+	}
+}
@@ -0,0 +1,19 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <commands/trigger.h>
+#include <executor/tuptable.h>
+#include <nodes/execnodes.h>
+
+typedef struct ChunkDispatch ChunkDispatch;
+typedef struct ChunkFkCheck ChunkFkCheck;
+typedef struct ChunkFkKeyCache ChunkFkKeyCache;
+
+extern ChunkFkCheck *ts_chunk_fk_check_create(ChunkDispatch *dispatch, ResultRelInfo *relinfo,
+											  TriggerDesc **trigdesc);
+extern void ts_chunk_fk_check_rows(ChunkFkCheck *check, TupleTableSlot **slots, int nslots);
@@ -5,8 +5,12 @@
  */
 #include <postgres.h>
 #include <access/attnum.h>
+#include <access/htup_details.h>
+#include <access/tableam.h>
 #include <access/xact.h>
+#include <catalog/pg_trigger.h>
 #include <catalog/pg_type.h>
+#include <executor/executor.h>
 #include <executor/tuptable.h>
 #include <foreign/fdwapi.h>
 #include <miscadmin.h>
@@ -27,11 +31,14 @@
 
 #include "compat/compat.h"
 #include "chunk_dispatch.h"
+#include "chunk_fk_check.h"
 #include "chunk_index.h"
 #include "chunk_insert_state.h"
 #include "debug_point.h"
 #include "errors.h"
+#include "guc.h"
 #include "indexing.h"
+#include "memory_usage.h"
 #include "ts_catalog/continuous_agg.h"
 
 /* Just like ExecPrepareExpr except that it doesn't switch to the query memory context */
@@ -460,6 +467,201 @@ adjust_projections(ChunkInsertState *cis, const ChunkDispatch *dispatch, Oid row
 	}
 }
 
+/*
+ * Check whether the rows inserted into the chunk can be compressed directly
+ * into its compressed chunk. These rows are never stored in the uncompressed
+ * chunk, so nothing that needs to find them there can be involved: unique
+ * constraints, ON CONFLICT, RETURNING, AFTER ROW triggers, or the UPDATE and
+ * MERGE that move the rows between chunks.
+ */
+static bool
+chunk_insert_state_can_direct_compress(const ChunkInsertState *state,
+									   const ChunkDispatch *dispatch,
+									   OnConflictAction onconflict_action)
+{
+	const ResultRelInfo *relinfo = state->result_relation_info;
+	const TriggerDesc *tg = relinfo->ri_TrigDesc;
+
+	if (!ts_guc_enable_direct_compress_insert || ts_cm_functions->direct_compress_begin == NULL)
+		return false;
+
+	if (!state->chunk_compressed || state->use_tam ||
+		state->rel->rd_rel->relkind != RELKIND_RELATION)
+		return false;
+
+	if (chunk_dispatch_get_cmd_type(dispatch) != CMD_INSERT ||
+		onconflict_action != ONCONFLICT_NONE || chunk_dispatch_has_returning(dispatch))
+		return false;
+
+	if (tg != NULL && (tg->trig_insert_after_row || tg->trig_insert_new_table))
+		return false;
+
+	if (ts_indexing_relation_has_primary_or_unique_index(state->rel))
+		return false;
+
+	/* The chunk skipping ranges are only updated when compressing the chunk */
+	if (dispatch->hypertable->range_space != NULL)
+		return false;
+
+	return true;
+}
+
+/*
+ * Check whether the rows inserted into the chunk can be buffered and inserted
+ * with table_multi_insert(), like COPY does. The buffered rows are only
+ * inserted when the buffer is flushed, so nothing can look at them or expect
+ * them in the chunk while the statement is processing the following rows: ON
+ * CONFLICT, RETURNING, WITH CHECK OPTION, row triggers (including the foreign
+ * key triggers that we don't replace with the batched checks, and the
+ * deferrable unique constraint triggers), transition tables, volatile
+ * functions that might query the hypertable, or the UPDATE and MERGE that
+ * move the rows between chunks. COPY has its own buffers, so this is only
+ * used for INSERT.
+ */
+static bool
+chunk_insert_state_can_multi_insert(const ChunkInsertState *state, const ChunkDispatch *dispatch,
+									OnConflictAction onconflict_action)
+{
+	const ResultRelInfo *relinfo = state->result_relation_info;
+	const TriggerDesc *tg = relinfo->ri_TrigDesc;
+
+	if (dispatch->dispatch_state == NULL || dispatch->dispatch_state->mtstate == NULL ||
+		dispatch->dispatch_state->has_volatile_functions)
+		return false;
+
+	if (state->direct_compress != NULL || state->rel->rd_rel->relkind != RELKIND_RELATION)
+		return false;
+
+	if (chunk_dispatch_get_cmd_type(dispatch) != CMD_INSERT ||
+		onconflict_action != ONCONFLICT_NONE || chunk_dispatch_has_returning(dispatch) ||
+		relinfo->ri_WithCheckOptions != NIL)
+		return false;
+
+	if (tg != NULL && (tg->trig_insert_before_row || tg->trig_insert_after_row ||
+					   tg->trig_insert_instead_row || tg->trig_insert_new_table))
+		return false;
+
+	if (dispatch->dispatch_state->mtstate->mt_transition_capture != NULL)
+		return false;
+
+	return true;
+}
+
+/*
+ * Remove the continuous aggregate invalidation trigger from the trigger
+ * descriptor, so that the invalidations of the buffered rows can be recorded
+ * for the whole buffer instead of queueing an AFTER ROW trigger event for
+ * every row. The trigger only records the time values of the rows, so it
+ * doesn't matter that the rows are already in the chunk when the
+ * invalidations are recorded.
+ *
+ * Returns the id of the hypertable the trigger records the invalidations for,
+ * and the trigger descriptor without the trigger in "trigdesc", or 0 if the
+ * chunk has no such trigger that fires.
+ */
+static int32
+chunk_insert_state_remove_cagg_trigger(const TriggerDesc *tg, TriggerDesc **trigdesc)
+{
+	int32 hypertable_id = 0;
+	int index = -1;
+
+	if (tg == NULL || !tg->trig_insert_after_row ||
+		SessionReplicationRole == SESSION_REPLICATION_ROLE_REPLICA)
+		return 0;
+
+	for (int i = 0; i < tg->numtriggers; i++)
+	{
+		const Trigger *trigger = &tg->triggers[i];
+
+		if (strcmp(trigger->tgname, CAGGINVAL_TRIGGER_NAME) == 0 &&
+			trigger->tgenabled == TRIGGER_FIRES_ON_ORIGIN && trigger->tgnargs == 1 &&
+			trigger->tgqual == NULL)
+		{
+			hypertable_id = atoi(trigger->tgargs[0]);
+			index = i;
+			break;
+		}
+	}
+
+	if (index < 0 || hypertable_id <= 0)
+		return 0;
+
+	/* Same as for the foreign key triggers, only this flag can change */
+	TriggerDesc *newtg = CopyTriggerDesc((TriggerDesc *) tg);
+	int ntriggers = 0;
+
+	newtg->trig_insert_after_row = false;
+	for (int i = 0; i < tg->numtriggers; i++)
+	{
+		if (i == index)
+			continue;
+
+		newtg->triggers[ntriggers] = newtg->triggers[i];
+		if (TRIGGER_TYPE_MATCHES(newtg->triggers[ntriggers].tgtype,
+								 TRIGGER_TYPE_ROW,
+								 TRIGGER_TYPE_AFTER,
+								 TRIGGER_TYPE_INSERT))
+			newtg->trig_insert_after_row = true;
+		ntriggers++;
+	}
+	newtg->numtriggers = ntriggers;
+
+	*trigdesc = newtg;
+	return hypertable_id;
+}
+
+/*
+ * Set up the multi-insert buffer for INSERT, and the batched foreign key
+ * checks and continuous aggregate invalidations if the rows are buffered
+ * either by INSERT or COPY.
+ *
+ * The foreign key and invalidation triggers would prevent buffering the rows
+ * of an INSERT, so we check if the rows can be buffered without them, and
+ * keep the triggers if not. COPY inserts the rows of the chunks with BEFORE
+ * ROW triggers one by one, then we need the triggers as well.
+ */
+static void
+setup_multi_insert(ChunkInsertState *state, ChunkDispatch *dispatch,
+				   OnConflictAction onconflict_action)
+{
+	ResultRelInfo *relinfo = state->result_relation_info;
+	TriggerDesc *trigdesc = relinfo->ri_TrigDesc;
+	TriggerDesc *fk_trigdesc = NULL;
+	TriggerDesc *cagg_trigdesc = NULL;
+	ChunkFkCheck *fk_check = NULL;
+	int32 cagg_hypertable_id = 0;
+
+	if (dispatch->copy_multi_insert ||
+		(dispatch->dispatch_state != NULL && get_modifytable_state(dispatch) != NULL))
+	{
+		fk_check = ts_chunk_fk_check_create(dispatch, relinfo, &fk_trigdesc);
+
+		if (fk_check != NULL)
+			relinfo->ri_TrigDesc = fk_trigdesc;
+
+		cagg_hypertable_id =
+			chunk_insert_state_remove_cagg_trigger(relinfo->ri_TrigDesc, &cagg_trigdesc);
+
+		if (cagg_hypertable_id > 0)
+			relinfo->ri_TrigDesc = cagg_trigdesc;
+	}
+
+	if (chunk_insert_state_can_multi_insert(state, dispatch, onconflict_action))
+		state->multi_insert = palloc0(sizeof(ChunkMultiInsertBuffer));
+
+	if (fk_check == NULL && cagg_hypertable_id == 0)
+		return;
+
+	if (state->multi_insert != NULL ||
+		(dispatch->copy_multi_insert && !trigdesc->trig_insert_before_row))
+	{
+		state->fk_check = fk_check;
+		state->cagg_hypertable_id = cagg_hypertable_id;
+	}
+	else
+		relinfo->ri_TrigDesc = trigdesc;
+}
+
 /*
  * Create new insert chunk state.
  *
@@ -467,12 +669,12 @@ adjust_projections(ChunkInsertState *cis, const ChunkDispatch *dispatch, Oid row
  * ResultRelInfo should be similar to ExecInitModifyTable().
  */
 extern ChunkInsertState *
-ts_chunk_insert_state_create(Oid chunk_relid, const ChunkDispatch *dispatch)
+ts_chunk_insert_state_create(Oid chunk_relid, ChunkDispatch *dispatch)
 {
 	ChunkInsertState *state;
 	Relation rel, parent_rel;
 	MemoryContext cis_context = AllocSetContextCreate(dispatch->estate->es_query_cxt,
-													  "chunk insert state memory context",
+													  TS_CHUNK_INSERT_STATE_MEMORY_CONTEXT,
 													  ALLOCSET_DEFAULT_SIZES);
 	OnConflictAction onconflict_action = ts_chunk_dispatch_get_on_conflict_action(dispatch);
 	ResultRelInfo *relinfo;
@@ -498,12 +700,17 @@ ts_chunk_insert_state_create(Oid chunk_relid, const ChunkDispatch *dispatch)
 	 * chunk metadata before we got a lock, so re-read it.
 	 *
 	 * This works even in higher levels of isolation since catalog data is
-	 * always read from latest snapshot.
+	 * always read from latest snapshot. The cached chunk was invalidated
+	 * when we got the lock if the catalog has changed.
 	 */
 	chunk = ts_chunk_get_by_relid(chunk_relid, true);
 	Assert(chunk->relkind == RELKIND_RELATION || chunk->relkind == RELKIND_FOREIGN_TABLE);
 	ts_chunk_validate_chunk_status_for_operation(chunk, CHUNK_INSERT, true);
 
+	/* Identify the chunk in the memory context statistics */
+	MemoryContextSetIdentifier(cis_context,
+							   MemoryContextStrdup(cis_context, RelationGetRelationName(rel)));
+
 	MemoryContext old_mcxt = MemoryContextSwitchTo(cis_context);
 	relinfo = create_chunk_result_relation_info(dispatch, rel);
 	CheckValidResultRelCompat(relinfo, chunk_dispatch_get_cmd_type(dispatch), NIL);
@@ -565,6 +772,19 @@ ts_chunk_insert_state_create(Oid chunk_relid, const ChunkDispatch *dispatch)
 	state->hypertable_relid = chunk->hypertable_relid;
 	state->chunk_id = chunk->fd.id;
 
+	if (chunk_insert_state_can_direct_compress(state, dispatch, onconflict_action))
+		state->direct_compress = ts_cm_functions->direct_compress_begin(state);
+
+	/* The rows are inserted into the chunk if they can't be compressed directly */
+	if (state->direct_compress != NULL)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(state->estate->es_query_cxt);
+		dispatch->direct_compress_states = lappend(dispatch->direct_compress_states, state);
+		MemoryContextSwitchTo(oldcontext);
+	}
+	else
+		setup_multi_insert(state, dispatch, onconflict_action);
+
 	if (chunk->relkind == RELKIND_FOREIGN_TABLE)
 	{
 #if PG16_LT
@@ -634,12 +854,176 @@ ts_set_compression_status(ChunkInsertState *state, const Chunk *chunk)
 	}
 }
 
+/*
+ * Get the size of the row in the slot, for the memory accounting of the
+ * multi-insert buffers.
+ */
+Size
+ts_chunk_multi_insert_tuple_size(TupleTableSlot *slot)
+{
+	if (TTS_IS_HEAPTUPLE(slot) || TTS_IS_BUFFERTUPLE(slot))
+	{
+		const HeapTupleTableSlot *hslot = (const HeapTupleTableSlot *) slot;
+
+		if (hslot->tuple != NULL)
+			return HEAPTUPLESIZE + hslot->tuple->t_len;
+	}
+
+	slot_getallattrs(slot);
+	return HEAPTUPLESIZE + SizeofHeapTupleHeader +
+		   heap_compute_data_size(slot->tts_tupleDescriptor, slot->tts_values, slot->tts_isnull);
+}
+
+/*
+ * Buffer a row to insert into the chunk with table_multi_insert().
+ *
+ * The row is copied, so the slot can be reused for the next row. The buffer
+ * is flushed when it is full, and the largest buffers are flushed when the
+ * rows buffered over all the chunks take too much memory.
+ */
+void
+ts_chunk_insert_state_multi_insert(ChunkInsertState *state, TupleTableSlot *slot)
+{
+	ChunkMultiInsertBuffer *buffer = state->multi_insert;
+	ChunkDispatch *dispatch = state->cds->dispatch;
+
+	Assert(buffer != NULL);
+	Assert(buffer->nused < CHUNK_MULTI_INSERT_MAX_TUPLES);
+
+	if (buffer->nused == 0)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(state->estate->es_query_cxt);
+		dispatch->multi_insert_states = lappend(dispatch->multi_insert_states, state);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	/*
+	 * The slots are created on demand and kept for the next batches. They are
+	 * created in the chunk insert state memory context so that the copied
+	 * rows live until they are inserted.
+	 */
+	if (buffer->slots[buffer->nused] == NULL)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(state->mctx);
+		buffer->slots[buffer->nused] =
+			MakeSingleTupleTableSlot(RelationGetDescr(state->rel),
+									 table_slot_callbacks(state->rel));
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	TupleTableSlot *batchslot = buffer->slots[buffer->nused++];
+	ExecCopySlot(batchslot, slot);
+	batchslot->tts_tableOid = slot->tts_tableOid;
+
+	const Size nbytes = ts_chunk_multi_insert_tuple_size(batchslot);
+	buffer->nbytes += nbytes;
+	dispatch->multi_insert_nbytes += nbytes;
+
+	if (buffer->nused == CHUNK_MULTI_INSERT_MAX_TUPLES)
+	{
+		ts_chunk_insert_state_flush_multi_insert(state);
+		dispatch->multi_insert_states = list_delete_ptr(dispatch->multi_insert_states, state);
+	}
+	else if (dispatch->multi_insert_nbytes >= CHUNK_MULTI_INSERT_MAX_BYTES)
+		ts_chunk_dispatch_flush_largest_multi_insert(dispatch);
+}
+
+/*
+ * Insert the buffered rows into the chunk and create their index entries.
+ *
+ * Since the rows can't have row triggers, there is nothing else to do for
+ * them, except for the foreign key checks and continuous aggregate
+ * invalidations that we do instead of the triggers.
+ */
+void
+ts_chunk_insert_state_flush_multi_insert(ChunkInsertState *state)
+{
+	ChunkMultiInsertBuffer *buffer = state->multi_insert;
+	ResultRelInfo *rri = state->result_relation_info;
+	EState *estate = state->estate;
+
+	if (buffer == NULL || buffer->nused == 0)
+		return;
+
+	/* table_multi_insert() may leak memory, so use the per-tuple context */
+	MemoryContext oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+	if (state->fk_check != NULL)
+		ts_chunk_fk_check_rows(state->fk_check, buffer->slots, buffer->nused);
+
+	table_multi_insert(rri->ri_RelationDesc,
+					   buffer->slots,
+					   buffer->nused,
+					   estate->es_output_cid,
+					   0,
+					   NULL);
+
+	if (state->cagg_hypertable_id > 0)
+		ts_cm_functions->continuous_agg_invalidate_slots(state->cagg_hypertable_id,
+														 rri->ri_RelationDesc,
+														 buffer->slots,
+														 buffer->nused);
+
+	for (int i = 0; i < buffer->nused; i++)
+	{
+		if (rri->ri_NumIndices > 0)
+		{
+			List *recheckIndexes = ExecInsertIndexTuplesCompat(rri,
+															   buffer->slots[i],
+															   estate,
+															   false,
+															   false,
+															   NULL,
+															   NIL,
+															   false);
+			list_free(recheckIndexes);
+		}
+
+		ExecClearTuple(buffer->slots[i]);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	table_finish_bulk_insert(rri->ri_RelationDesc, 0);
+
+	state->cds->dispatch->multi_insert_nbytes -= buffer->nbytes;
+	buffer->nused = 0;
+	buffer->nbytes = 0;
+}
+
 extern void
 ts_chunk_insert_state_destroy(ChunkInsertState *state)
 {
 	ResultRelInfo *rri = state->result_relation_info;
 
-	if (state->chunk_compressed && !state->chunk_partial)
+	/*
+	 * The chunk can be closed before the end of the statement when too many
+	 * chunks are open, so insert the rows buffered for it first.
+	 */
+	if (state->multi_insert != NULL)
+	{
+		ChunkDispatch *dispatch = state->cds->dispatch;
+
+		ts_chunk_insert_state_flush_multi_insert(state);
+		dispatch->multi_insert_states = list_delete_ptr(dispatch->multi_insert_states, state);
+
+		for (int i = 0; i < CHUNK_MULTI_INSERT_MAX_TUPLES && state->multi_insert->slots[i] != NULL;
+			 i++)
+			ExecDropSingleTupleTableSlot(state->multi_insert->slots[i]);
+	}
+
+	/*
+	 * The directly compressed rows are only in the compressed chunk, so it
+	 * does not become partial, but its batches can now overlap.
+	 */
+	if (state->direct_compress != NULL)
+	{
+		ChunkDispatch *dispatch = state->cds->dispatch;
+
+		ts_cm_functions->direct_compress_end(state);
+		dispatch->direct_compress_states = list_delete_ptr(dispatch->direct_compress_states, state);
+	}
+	else if (state->chunk_compressed && !state->chunk_partial)
 	{
 		Oid chunk_relid = RelationGetRelid(state->result_relation_info->ri_RelationDesc);
 		Chunk *chunk = ts_chunk_get_by_relid(chunk_relid, true);
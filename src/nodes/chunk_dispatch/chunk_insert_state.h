@@ -15,6 +15,33 @@
 
 typedef struct TSCopyMultiInsertBuffer TSCopyMultiInsertBuffer;
 typedef struct ChunkDispatchState ChunkDispatchState;
+typedef struct CompressedInsertCheck CompressedInsertCheck;
+typedef struct ChunkFkCheck ChunkFkCheck;
+
+/*
+ * No more than this many rows are buffered for the multi-inserts of an INSERT
+ * statement into one chunk.
+ */
+#define CHUNK_MULTI_INSERT_MAX_TUPLES 1000
+
+/*
+ * Memory budget for the rows buffered for multi-inserts, over all the chunks,
+ * both for INSERT and COPY. When the buffered rows take more memory, the
+ * largest buffers are flushed until the rows take at most half of it.
+ */
+#define CHUNK_MULTI_INSERT_MAX_BYTES (1024 * 1024)
+
+/*
+ * Buffer of the rows that are inserted into the chunk with
+ * table_multi_insert() at the end of the statement, or when enough rows are
+ * buffered.
+ */
+typedef struct ChunkMultiInsertBuffer
+{
+	TupleTableSlot *slots[CHUNK_MULTI_INSERT_MAX_TUPLES];
+	int nused;	  /* Number of slots containing rows */
+	Size nbytes; /* Size of the buffered rows */
+} ChunkMultiInsertBuffer;
 
 typedef struct ChunkInsertState
 {
@@ -50,20 +77,52 @@ typedef struct ChunkInsertState
 	Oid hypertable_relid;
 	int32 chunk_id;
 	Oid user_id;
+	/* Slices of the chunk, to quickly check if the next row goes into it too */
+	Hypercube *cube;
 
 	/* for tracking compressed chunks */
 	bool chunk_compressed;
 	bool chunk_partial;
 
+	/*
+	 * Buffer of the rows that are compressed directly into the compressed
+	 * chunk instead of being inserted into the chunk, if enabled.
+	 */
+	DirectCompressState *direct_compress;
+
+	/*
+	 * Unique constraint metadata for the rows inserted into the compressed
+	 * chunk, set up for the first row.
+	 */
+	CompressedInsertCheck *compressed_insert_check;
+
+	/* Buffer of the rows to insert with table_multi_insert(), if possible */
+	ChunkMultiInsertBuffer *multi_insert;
+
+	/*
+	 * Foreign key checks of the buffered rows, done instead of the foreign
+	 * key triggers, if possible.
+	 */
+	ChunkFkCheck *fk_check;
+
+	/*
+	 * Id of the hypertable to record the continuous aggregate invalidations
+	 * of the buffered rows for, done instead of the invalidation trigger, or
+	 * 0 if the trigger is used.
+	 */
+	int32 cagg_hypertable_id;
+
 	/* Chunk uses our own table access method */
 	bool use_tam;
 } ChunkInsertState;
 
 typedef struct ChunkDispatch ChunkDispatch;
 
-extern ChunkInsertState *ts_chunk_insert_state_create(Oid chunk_relid,
-													  const ChunkDispatch *dispatch);
+extern ChunkInsertState *ts_chunk_insert_state_create(Oid chunk_relid, ChunkDispatch *dispatch);
 extern void ts_chunk_insert_state_destroy(ChunkInsertState *state);
+extern void ts_chunk_insert_state_multi_insert(ChunkInsertState *state, TupleTableSlot *slot);
+extern void ts_chunk_insert_state_flush_multi_insert(ChunkInsertState *state);
+extern Size ts_chunk_multi_insert_tuple_size(TupleTableSlot *slot);
 
 TSDLLEXPORT OnConflictAction
 ts_chunk_dispatch_get_on_conflict_action(const ChunkDispatch *dispatch);
@@ -43,6 +43,8 @@ static void ExecInitInsertProjection(ModifyTableState *mtstate, ResultRelInfo *r
 static void ExecInitUpdateProjection(ModifyTableState *mtstate, ResultRelInfo *resultRelInfo);
 static void ExecCheckPlanOutput(Relation resultRel, List *targetList);
 static TupleTableSlot *ExecGetInsertNewTuple(ResultRelInfo *relinfo, TupleTableSlot *planSlot);
+static void ExecInsertBuffered(ModifyTableContext *context, ChunkDispatchState *cds,
+							   TupleTableSlot *slot, bool canSetTag);
 static void ExecBatchInsert(ModifyTableState *mtstate, ResultRelInfo *resultRelInfo,
 							TupleTableSlot **slots, TupleTableSlot **planSlots, int numSlots,
 							EState *estate, bool canSetTag);
@@ -218,6 +220,8 @@ hypertable_modify_explain(CustomScanState *node, List *ancestors, ExplainState *
 		ExplainPropertyInteger("Tuples decompressed", NULL, state->tuples_decompressed, es);
 	if (state->batches_deleted > 0)
 		ExplainPropertyInteger("Batches deleted", NULL, state->batches_deleted, es);
+	if (state->batches_updated > 0)
+		ExplainPropertyInteger("Batches updated", NULL, state->batches_updated, es);
 }
 
 static CustomExecMethods hypertable_modify_state_methods = {
@@ -867,7 +871,13 @@ ExecModifyTable(CustomScanState *cs_node, PlanState *pstate)
 				if (unlikely(!resultRelInfo->ri_projectNewInfoValid))
 					ExecInitInsertProjection(node, resultRelInfo);
 				slot = ExecGetInsertNewTuple(resultRelInfo, context.planSlot);
-				slot = ExecInsert(&context, resultRelInfo, cds, slot, node->canSetTag);
+				if (cds->cis->multi_insert != NULL)
+				{
+					ExecInsertBuffered(&context, cds, slot, node->canSetTag);
+					slot = NULL;
+				}
+				else
+					slot = ExecInsert(&context, resultRelInfo, cds, slot, node->canSetTag);
 				break;
 			case CMD_UPDATE:
 				/* Initialize projection info if first time for this table */
@@ -931,6 +941,12 @@ ExecModifyTable(CustomScanState *cs_node, PlanState *pstate)
 	/*
 	 * Insert remaining tuples for batch insert.
 	 */
+	if (cds != NULL)
+	{
+		ts_chunk_dispatch_flush_multi_insert(cds->dispatch);
+		ts_chunk_dispatch_flush_direct_compress(cds->dispatch);
+	}
+
 	relinfos = estate->es_opened_result_relations;
 
 	if (ht_state->comp_chunks_processed)
@@ -1732,6 +1748,16 @@ ExecInsert(ModifyTableContext *context, ResultRelInfo *resultRelInfo, ChunkDispa
 
 			/* Since there was no insertion conflict, we're done */
 		}
+		else if (cds->cis->direct_compress != NULL)
+		{
+			/* buffer the tuple to be compressed into the compressed chunk */
+			ts_cm_functions->direct_compress_insert(cds->cis->direct_compress, slot);
+		}
+		else if (cds->cis->multi_insert != NULL)
+		{
+			/* buffer the tuple to be inserted with the next multi-insert */
+			ts_chunk_insert_state_multi_insert(cds->cis, slot);
+		}
 		else
 		{
 			/* insert the tuple normally */
@@ -1809,6 +1835,55 @@ ExecInsert(ModifyTableContext *context, ResultRelInfo *resultRelInfo, ChunkDispa
 	return result;
 }
 
+/*
+ * Insert the tuple into the multi-insert buffer of the chunk.
+ *
+ * This is ExecInsert() for the plain appends, reduced to the steps that the
+ * buffered rows can need. The chunk insert state only buffers the rows when
+ * there are no row triggers, ON CONFLICT, RETURNING, WITH CHECK OPTION or
+ * transition tables (see chunk_insert_state_can_multi_insert()), so we skip
+ * all their checks for every row. The tuple is copied into the buffer, so we
+ * don't materialize it first either.
+ */
+static void
+ExecInsertBuffered(ModifyTableContext *context, ChunkDispatchState *cds, TupleTableSlot *slot,
+				   bool canSetTag)
+{
+	EState *estate = context->estate;
+	ResultRelInfo *resultRelInfo;
+	Relation resultRelationDesc;
+
+	Assert(context->mtstate->operation == CMD_INSERT);
+	Assert(cds->cis->multi_insert != NULL);
+
+	slot = ts_chunk_dispatch_prepare_tuple_routing(cds, slot);
+	resultRelInfo = cds->rri;
+	resultRelationDesc = resultRelInfo->ri_RelationDesc;
+
+	Assert(resultRelInfo->ri_FdwRoutine == NULL);
+	Assert(resultRelInfo->ri_WithCheckOptions == NIL);
+	Assert(!resultRelationDesc->rd_rel->relispartition);
+
+	/*
+	 * Constraints and GENERATED expressions might reference the tableoid
+	 * column, so (re-)initialize tts_tableOid before evaluating them.
+	 */
+	slot->tts_tableOid = RelationGetRelid(resultRelationDesc);
+
+	if (resultRelationDesc->rd_att->constr)
+	{
+		if (resultRelationDesc->rd_att->constr->has_generated_stored)
+			ExecComputeStoredGenerated(resultRelInfo, estate, slot, CMD_INSERT);
+
+		ExecConstraints(resultRelInfo, slot, estate);
+	}
+
+	ts_chunk_insert_state_multi_insert(cds->cis, slot);
+
+	if (canSetTag)
+		(estate->es_processed)++;
+}
+
 /* ----------------------------------------------------------------
  *		ExecBatchInsert
  *
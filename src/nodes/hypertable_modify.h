@@ -36,6 +36,7 @@ typedef struct HypertableModifyState
 	int64 batches_decompressed;
 	int64 batches_filtered;
 	int64 batches_deleted;
+	int64 batches_updated;
 } HypertableModifyState;
 
 extern void ts_hypertable_modify_fixup_tlist(Plan *plan);
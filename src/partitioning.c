@@ -17,6 +17,7 @@
 #include <utils/cash.h>
 #include <utils/catcache.h>
 #include <utils/date.h>
+#include <utils/fmgroids.h>
 #include <utils/inet.h>
 #include <utils/jsonb.h>
 #include <utils/lsyscache.h>
@@ -25,6 +26,7 @@
 #include <utils/rangetypes.h>
 #include <utils/syscache.h>
 #include <utils/timestamp.h>
+#include <utils/uuid.h>
 
 #include "compat/compat.h"
 #include "partitioning.h"
@@ -100,6 +102,24 @@ ts_partitioning_func_get_closed_default(void)
 								   &argtype);
 }
 
+/*
+ * Get the default partitioning function of an open dimension on a column of
+ * the given type, or InvalidOid if the type needs no partitioning function.
+ * UUID columns are partitioned on the timestamp of their UUIDv7 values.
+ */
+Oid
+ts_partitioning_func_get_open_default(Oid argtype)
+{
+	if (argtype != UUIDOID)
+		return InvalidOid;
+
+	return ts_lookup_proc_filtered(DEFAULT_OPEN_PARTITIONING_FUNC_SCHEMA,
+								   DEFAULT_UUID_PARTITIONING_FUNC_NAME,
+								   NULL,
+								   open_dim_partitioning_func_filter,
+								   &argtype);
+}
+
 static bool
 ts_partitioning_func_is_closed_default(const char *schema, const char *funcname)
 {
@@ -167,6 +187,72 @@ find_text_coercion_func(Oid type)
 
 #define TYPECACHE_HASH_FLAGS (TYPECACHE_HASH_PROC | TYPECACHE_HASH_PROC_FINFO)
 
+/*
+ * Check if the hash function of a type can be computed inline by
+ * partition_hash_inline() instead of calling the default partitioning
+ * function through fmgr for every inserted row.
+ */
+static bool
+partition_hash_is_inlinable(Oid hash_proc)
+{
+	switch (hash_proc)
+	{
+		case F_HASHINT2:
+		case F_HASHINT4:
+		case F_HASHINT8:
+		case F_HASHOID:
+		case F_TIMESTAMP_HASH:
+		case F_UUID_HASH:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Compute the same hash as the given built-in hash function. The result
+ * must be identical to what ts_get_partition_hash() returns via the hash
+ * function, since it decides the partition of existing data.
+ */
+static int32
+partition_hash_inline(Oid hash_proc, Datum value)
+{
+	uint32 hash;
+
+	switch (hash_proc)
+	{
+		case F_HASHINT2:
+			hash = DatumGetUInt32(hash_uint32((int32) DatumGetInt16(value)));
+			break;
+		case F_HASHINT4:
+			hash = DatumGetUInt32(hash_uint32(DatumGetInt32(value)));
+			break;
+		case F_HASHOID:
+			hash = DatumGetUInt32(hash_uint32((uint32) DatumGetObjectId(value)));
+			break;
+		case F_HASHINT8:
+		case F_TIMESTAMP_HASH:
+		{
+			/* Same as hashint8(), timestamps are hashed as int8 */
+			int64 val = DatumGetInt64(value);
+			uint32 lohalf = (uint32) val;
+			uint32 hihalf = (uint32) (val >> 32);
+
+			lohalf ^= (val >= 0) ? hihalf : ~hihalf;
+			hash = DatumGetUInt32(hash_uint32(lohalf));
+			break;
+		}
+		case F_UUID_HASH:
+			hash = DatumGetUInt32(hash_any(DatumGetUUIDP(value)->data, UUID_LEN));
+			break;
+		default:
+			pg_unreachable();
+	}
+
+	/* Only positive numbers */
+	return (int32) (hash & 0x7fffffff);
+}
+
 PartitioningInfo *
 ts_partitioning_info_create(const char *schema, const char *partfunc, const char *partcol,
 							DimensionType dimtype, Oid relid)
@@ -200,8 +286,16 @@ ts_partitioning_info_create(const char *schema, const char *partfunc, const char
 	{
 		TypeCacheEntry *tce = lookup_type_cache(columntype, TYPECACHE_HASH_FLAGS);
 
-		if (!OidIsValid(tce->hash_proc) && ts_partitioning_func_is_closed_default(schema, partfunc))
-			elog(ERROR, "could not find hash function for type %s", format_type_be(columntype));
+		if (ts_partitioning_func_is_closed_default(schema, partfunc))
+		{
+			if (!OidIsValid(tce->hash_proc))
+				elog(ERROR,
+					 "could not find hash function for type %s",
+					 format_type_be(columntype));
+
+			if (partition_hash_is_inlinable(tce->hash_proc))
+				pinfo->inline_hash_proc = tce->hash_proc;
+		}
 	}
 
 	partitioning_func_set_func_fmgr(&pinfo->partfunc, columntype, dimtype);
@@ -239,6 +333,10 @@ ts_partitioning_func_apply(PartitioningInfo *pinfo, Oid collation, Datum value)
 	LOCAL_FCINFO(fcinfo, 1);
 	Datum result;
 
+	/* The default hash of common types does not need the function call */
+	if (OidIsValid(pinfo->inline_hash_proc))
+		return Int32GetDatum(partition_hash_inline(pinfo->inline_hash_proc, value));
+
 	InitFunctionCallInfoData(*fcinfo, &pinfo->partfunc.func_fmgr, 1, collation, NULL, NULL);
 
 	FC_SET_ARG(fcinfo, 0, value);
@@ -21,6 +21,8 @@
 
 #define DEFAULT_PARTITIONING_FUNC_SCHEMA FUNCTIONS_SCHEMA_NAME
 #define DEFAULT_PARTITIONING_FUNC_NAME "get_partition_hash"
+#define DEFAULT_OPEN_PARTITIONING_FUNC_SCHEMA FUNCTIONS_SCHEMA_NAME
+#define DEFAULT_UUID_PARTITIONING_FUNC_NAME "timestamptz_from_uuid_v7"
 
 typedef struct PartitioningFunc
 {
@@ -41,9 +43,16 @@ typedef struct PartitioningInfo
 	AttrNumber column_attnum;
 	DimensionType dimtype;
 	PartitioningFunc partfunc;
+
+	/*
+	 * Hash function computed inline instead of calling the default
+	 * partitioning function, or InvalidOid.
+	 */
+	Oid inline_hash_proc;
 } PartitioningInfo;
 
 extern Oid ts_partitioning_func_get_closed_default(void);
+extern Oid ts_partitioning_func_get_open_default(Oid argtype);
 extern bool ts_partitioning_func_is_valid(regproc funcoid, DimensionType dimtype, Oid argtype);
 
 extern PartitioningInfo *ts_partitioning_info_create(const char *schema, const char *partfunc,
@@ -0,0 +1,220 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * A local report of the statistics that are relevant for the performance,
+ * returned by get_performance_report() for monitoring, e.g., by scraping it
+ * into time-series metrics.
+ *
+ * The report contains the relation statistics of the telemetry report and
+ * metrics derived from them and from the other statistics of the extension.
+ * It is built without telemetry as well and never sends anything. The
+ * planner, cache and memory statistics are the ones of the current backend,
+ * the others are for the database or the server.
+ */
+#include <postgres.h>
+#include <executor/spi.h>
+#include <fmgr.h>
+#include <utils/builtins.h>
+#include <utils/guc.h>
+#include <utils/jsonb.h>
+
+#include "cache.h"
+#include "config.h"
+#include "export.h"
+#include "jsonb_utils.h"
+#include "lock_wait_stats.h"
+#include "memory_usage.h"
+#include "planner/planner_stats.h"
+#include "telemetry/stats.h"
+#include "utils.h"
+
+static void
+push_key(JsonbParseState *state, const char *name)
+{
+	JsonbValue key = {
+		.type = jbvString,
+		.val.string.val = pstrdup(name),
+		.val.string.len = strlen(name),
+	};
+
+	pushJsonbValue(&state, WJB_KEY, &key);
+}
+
+/*
+ * The share of the chunks that are compressed, the compression ratio of the
+ * compressed chunks, and the share of the size of the hypertables that is
+ * compressed data.
+ */
+static void
+add_compression_metrics(JsonbParseState *state, const HyperStats *hs)
+{
+	const int64 compressed_size =
+		hs->compressed_heap_size + hs->compressed_toast_size + hs->compressed_indexes_size;
+	const int64 uncompressed_size =
+		hs->uncompressed_heap_size + hs->uncompressed_toast_size + hs->uncompressed_indexes_size;
+	const int64 total_size = hs->storage.relsize.heap_size + hs->storage.relsize.toast_size +
+							 hs->storage.relsize.index_size;
+
+	pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	ts_jsonb_add_int64(state, "chunks", hs->child_count);
+	ts_jsonb_add_int64(state, "compressed_chunks", hs->compressed_chunk_count);
+	ts_jsonb_add_int64(state, "total_size", total_size);
+	ts_jsonb_add_int64(state, "compressed_size", compressed_size);
+	ts_jsonb_add_int64(state, "size_before_compression", uncompressed_size);
+
+	if (hs->child_count > 0)
+		ts_jsonb_add_float8(state,
+							"compressed_chunk_share",
+							(double) hs->compressed_chunk_count / hs->child_count);
+	if (total_size > 0)
+		ts_jsonb_add_float8(state, "compressed_data_share", (double) compressed_size / total_size);
+	if (compressed_size > 0)
+		ts_jsonb_add_float8(state,
+							"compression_ratio",
+							(double) uncompressed_size / compressed_size);
+
+	pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+}
+
+/*
+ * The runs and failures of the jobs of each type, and the jobs that are late,
+ * i.e., that should have started already but did not. A running job has no
+ * next start.
+ */
+static void
+add_job_metrics(JsonbParseState *state)
+{
+	MemoryContext orig_context = CurrentMemoryContext;
+	int res;
+
+	const char *command_string =
+		"SELECT ("
+		"	CASE "
+		"		WHEN j.proc_schema = \'_timescaledb_functions\' AND j.proc_name ~ "
+		"\'^policy_(retention|compression|reorder|refresh_continuous_aggregate|telemetry|job_stat_"
+		"history_retention)$\' "
+		"		THEN j.proc_name::TEXT "
+		"		ELSE \'user_defined_action\' "
+		"	END"
+		")  AS job_type, "
+		"	count(*) AS jobs, "
+		"	coalesce(sum(s.total_runs), 0)::BIGINT AS total_runs, "
+		"	coalesce(sum(s.total_failures), 0)::BIGINT AS total_failures, "
+		"	coalesce(sum(s.total_crashes), 0)::BIGINT AS total_crashes, "
+		"	count(*) FILTER (WHERE s.consecutive_failures > 0) AS failing_jobs, "
+		"	count(*) FILTER (WHERE l.late) AS late_jobs, "
+		"	coalesce(max(extract(epoch FROM now() - s.next_start)) FILTER (WHERE l.late), "
+		"0)::FLOAT8 AS max_lateness_seconds "
+		"FROM "
+		"	_timescaledb_config.bgw_job j "
+		"	LEFT JOIN _timescaledb_internal.bgw_job_stat s ON s.job_id = j.id "
+		"	CROSS JOIN LATERAL (SELECT j.scheduled AND s.next_start > \'-infinity\' "
+		"		AND s.next_start < now() AS late) l "
+		"GROUP BY job_type "
+		"ORDER BY job_type";
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "could not connect to SPI");
+
+	/* Lock down search_path */
+	int save_nestlevel = NewGUCNestLevel();
+	RestrictSearchPath();
+
+	res = SPI_execute(command_string, true /* read_only */, 0 /*count*/);
+	if (res < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR), (errmsg("could not get the job statistics"))));
+
+	MemoryContext spi_context = MemoryContextSwitchTo(orig_context);
+	pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	for (uint64 i = 0; i < SPI_processed; i++)
+	{
+		HeapTuple tuple = SPI_tuptable->vals[i];
+		TupleDesc tupdesc = SPI_tuptable->tupdesc;
+		int64 counts[6];
+		bool isnull;
+
+		Datum job_type = SPI_getbinval(tuple, tupdesc, 1, &isnull);
+		if (isnull)
+			elog(ERROR, "null job type returned");
+
+		for (int col = 0; col < (int) lengthof(counts); col++)
+		{
+			counts[col] = DatumGetInt64(SPI_getbinval(tuple, tupdesc, col + 2, &isnull));
+			if (isnull)
+				elog(ERROR, "null record field returned");
+		}
+		const double max_lateness = DatumGetFloat8(SPI_getbinval(tuple, tupdesc, 8, &isnull));
+
+		push_key(state, TextDatumGetCString(job_type));
+		pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+		ts_jsonb_add_int64(state, "jobs", counts[0]);
+		ts_jsonb_add_int64(state, "total_runs", counts[1]);
+		ts_jsonb_add_int64(state, "total_failures", counts[2]);
+		ts_jsonb_add_int64(state, "total_crashes", counts[3]);
+		if (counts[1] > 0)
+			ts_jsonb_add_float8(state,
+								"failure_ratio",
+								(double) (counts[2] + counts[3]) / counts[1]);
+		ts_jsonb_add_int64(state, "failing_jobs", counts[4]);
+		ts_jsonb_add_int64(state, "late_jobs", counts[5]);
+		ts_jsonb_add_float8(state, "max_lateness_seconds", max_lateness);
+		pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+	}
+
+	pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+	MemoryContextSwitchTo(spi_context);
+
+	/* Restore search_path */
+	AtEOXact_GUC(false, save_nestlevel);
+
+	res = SPI_finish();
+	Assert(res == SPI_OK_FINISH);
+}
+
+TS_FUNCTION_INFO_V1(ts_performance_report);
+
+Datum
+ts_performance_report(PG_FUNCTION_ARGS)
+{
+	JsonbParseState *state = NULL;
+	TelemetryStats relstats;
+
+	pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	ts_jsonb_add_str(state, "timescaledb_version", TIMESCALEDB_VERSION_MOD);
+
+	ts_telemetry_stats_gather(&relstats);
+	push_key(state, "relations");
+	ts_telemetry_stats_add_relations(state, &relstats);
+
+	push_key(state, "hypertable_compression");
+	add_compression_metrics(state, &relstats.hypertables);
+	push_key(state, "continuous_aggregate_compression");
+	add_compression_metrics(state, &relstats.continuous_aggs.hyp);
+
+	push_key(state, "jobs");
+	add_job_metrics(state);
+
+	push_key(state, "lock_waits");
+	ts_lock_wait_stats_add_jsonb(state);
+
+	push_key(state, "planner");
+	ts_planner_stats_add_jsonb(state);
+
+	push_key(state, "caches");
+	ts_cache_stats_add_jsonb(state);
+
+	push_key(state, "memory");
+	ts_memory_usage_add_jsonb(state);
+
+	JsonbValue *result = pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+
+	PG_RETURN_JSONB_P(JsonbValueToJsonb(result));
+}
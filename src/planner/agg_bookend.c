@@ -20,6 +20,16 @@
  * other aggregates (eg. MIN/MAX), we will skip optimization since we can't
  * optimize across different aggregate functions.
  *
+ * The subqueries are planned with query_planner(), so the hypertable is
+ * expanded again and the compressed chunks get the usual DecompressChunk
+ * paths. When the sort column matches the compression order by, these paths
+ * are ordered either by sorting the compressed chunk on the min/max metadata
+ * of the batches, or by a batch sorted merge, so the LIMIT 1 only decompresses
+ * the batches that can contain the first row. For other sort columns the
+ * whole chunk has to be decompressed and sorted, and the subquery competes on
+ * cost with the normal aggregation. Queries with GROUP BY are not handled,
+ * see the comment in ts_preprocess_first_last_aggregates().
+ *
  *	  Most of the code is borrowed from:
  *	  src/backend/optimizer/plan/planagg.c
  *
@@ -0,0 +1,490 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Chunkwise joins of hypertables with aligned chunks.
+ *
+ * An inner join of two hypertables that have the same dimensions, joined on
+ * all dimension columns, only joins rows of chunks with the same dimension
+ * slices. If the slices of the two hypertables are aligned, i.e., any two
+ * slices of a dimension are either the same or don't overlap, the join is
+ * planned as an Append of the joins of the matching chunk pairs, so that each
+ * join is small, e.g., fits its hash table into work_mem, and the joins can
+ * run in parallel. The chunks without a matching chunk on the other side
+ * cannot join any rows.
+ *
+ * Hypertables are not partitioned tables for the planner, so the partitionwise
+ * join of PostgreSQL doesn't apply, but the child joins are built the same way
+ * and the feature is enabled by the same enable_partitionwise_join setting.
+ */
+#include <postgres.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/appendinfo.h>
+#include <optimizer/cost.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
+#include <parser/parsetree.h>
+#include <port/pg_bitutils.h>
+#include <utils/typcache.h>
+
+#include "chunk.h"
+#include "compat/compat.h"
+#include "dimension.h"
+#include "dimension_slice.h"
+#include "guc.h"
+#include "hypercube.h"
+#include "hypertable.h"
+#include "planner/planner.h"
+
+typedef struct ChunkwiseJoinChild
+{
+	RelOptInfo *rel;
+	/* The range of the slice of the chunk in each dimension */
+	int64 *range_start;
+	int64 *range_end;
+} ChunkwiseJoinChild;
+
+typedef struct SliceRange
+{
+	int64 start;
+	int64 end;
+} SliceRange;
+
+/*
+ * Get the hypertable of a relation that is a hypertable expanded by us, or
+ * NULL otherwise.
+ */
+static Hypertable *
+get_expanded_hypertable(PlannerInfo *root, RelOptInfo *rel)
+{
+	Hypertable *ht;
+
+	if (rel->reloptkind != RELOPT_BASEREL || rel->fdw_private == NULL)
+		return NULL;
+
+	if (!planner_rt_fetch(rel->relid, root)->inh ||
+		ts_classify_relation(root, rel, &ht) != TS_REL_HYPERTABLE)
+		return NULL;
+
+	/* The translation of whole-row references to the chunks is not supported */
+	if (rel->attr_needed[InvalidAttrNumber - rel->min_attr] != NULL)
+		return NULL;
+
+	return ht;
+}
+
+static bool
+dimensions_are_compatible(const Hypertable *ht1, const Hypertable *ht2)
+{
+	if (ht1->space->num_dimensions != ht2->space->num_dimensions)
+		return false;
+
+	for (int i = 0; i < ht1->space->num_dimensions; i++)
+	{
+		const Dimension *dim1 = &ht1->space->dimensions[i];
+		const Dimension *dim2 = &ht2->space->dimensions[i];
+
+		if (dim1->type != dim2->type || dim1->fd.column_type != dim2->fd.column_type)
+			return false;
+
+		if (IS_CLOSED_DIMENSION(dim1) && dim1->fd.num_slices != dim2->fd.num_slices)
+			return false;
+
+		/* Equal values must be mapped to the same slice on both sides */
+		if ((dim1->partitioning == NULL) != (dim2->partitioning == NULL))
+			return false;
+
+		if (dim1->partitioning != NULL &&
+			(namestrcmp(&dim1->fd.partitioning_func_schema,
+						NameStr(dim2->fd.partitioning_func_schema)) != 0 ||
+			 namestrcmp(&dim1->fd.partitioning_func, NameStr(dim2->fd.partitioning_func)) != 0))
+			return false;
+	}
+
+	return true;
+}
+
+static bool
+is_var_of(const Node *node, Index varno, AttrNumber varattno)
+{
+	return IsA(node, Var) && castNode(Var, node)->varno == varno &&
+		   castNode(Var, node)->varattno == varattno && castNode(Var, node)->varlevelsup == 0;
+}
+
+/*
+ * Check that the join clauses contain an equality of the dimension columns of
+ * the two relations.
+ */
+static bool
+has_dimension_equijoin(List *restrictlist, Index relid1, const Dimension *dim1, Index relid2,
+					   const Dimension *dim2)
+{
+	TypeCacheEntry *tce = lookup_type_cache(dim1->fd.column_type, TYPECACHE_EQ_OPR);
+	ListCell *lc;
+
+	if (!OidIsValid(tce->eq_opr))
+		return false;
+
+	foreach (lc, restrictlist)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		if (rinfo->pseudoconstant || !IsA(rinfo->clause, OpExpr))
+			continue;
+
+		OpExpr *op = castNode(OpExpr, rinfo->clause);
+
+		if (op->opno != tce->eq_opr || list_length(op->args) != 2)
+			continue;
+
+		Node *left = linitial(op->args);
+		Node *right = lsecond(op->args);
+
+		if ((is_var_of(left, relid1, dim1->column_attno) &&
+			 is_var_of(right, relid2, dim2->column_attno)) ||
+			(is_var_of(left, relid2, dim2->column_attno) &&
+			 is_var_of(right, relid1, dim1->column_attno)))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Collect the chunks of the hypertable that are not excluded, with their
+ * slices. Returns NULL if a chunk has no slices, e.g., an OSM chunk.
+ */
+static ChunkwiseJoinChild *
+collect_children(PlannerInfo *root, RelOptInfo *rel, const Hypertable *ht, int *nchildren)
+{
+	const int ndims = ht->space->num_dimensions;
+	ChunkwiseJoinChild *children = palloc(sizeof(ChunkwiseJoinChild) * root->simple_rel_array_size);
+	ListCell *lc;
+
+	*nchildren = 0;
+
+	foreach (lc, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = lfirst_node(AppendRelInfo, lc);
+
+		if (appinfo->parent_relid != rel->relid)
+			continue;
+
+		RelOptInfo *childrel = find_base_rel(root, appinfo->child_relid);
+
+		if (IS_DUMMY_REL(childrel))
+			continue;
+
+		if (childrel->fdw_private == NULL || childrel->cheapest_total_path == NULL)
+			return NULL;
+
+		const Chunk *chunk = ts_get_private_reloptinfo(childrel)->cached_chunk_struct;
+
+		if (chunk == NULL || IS_OSM_CHUNK(chunk))
+			return NULL;
+
+		ChunkwiseJoinChild *child = &children[(*nchildren)++];
+
+		child->rel = childrel;
+		child->range_start = palloc(sizeof(int64) * ndims);
+		child->range_end = palloc(sizeof(int64) * ndims);
+
+		for (int i = 0; i < ndims; i++)
+		{
+			const DimensionSlice *slice =
+				ts_hypercube_get_slice_by_dimension_id(chunk->cube,
+													   ht->space->dimensions[i].fd.id);
+
+			if (slice == NULL)
+				return NULL;
+
+			child->range_start[i] = slice->fd.range_start;
+			child->range_end[i] = slice->fd.range_end;
+		}
+	}
+
+	return children;
+}
+
+static int
+slice_range_cmp(const void *left, const void *right)
+{
+	const SliceRange *l = left;
+	const SliceRange *r = right;
+
+	if (l->start != r->start)
+		return l->start < r->start ? -1 : 1;
+	if (l->end != r->end)
+		return l->end < r->end ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Check that any two slices of the dimension are either the same or don't
+ * overlap, so that the chunks that don't have the same slices cannot join.
+ */
+static bool
+slices_are_aligned(const ChunkwiseJoinChild *children1, int nchildren1,
+				   const ChunkwiseJoinChild *children2, int nchildren2, int dim)
+{
+	const int nranges = nchildren1 + nchildren2;
+	SliceRange *ranges = palloc(sizeof(SliceRange) * nranges);
+
+	for (int i = 0; i < nchildren1; i++)
+		ranges[i] = (SliceRange){ children1[i].range_start[dim], children1[i].range_end[dim] };
+	for (int i = 0; i < nchildren2; i++)
+		ranges[nchildren1 + i] =
+			(SliceRange){ children2[i].range_start[dim], children2[i].range_end[dim] };
+
+	qsort(ranges, nranges, sizeof(SliceRange), slice_range_cmp);
+
+	for (int i = 1; i < nranges; i++)
+	{
+		if (slice_range_cmp(&ranges[i - 1], &ranges[i]) != 0 &&
+			ranges[i].start < ranges[i - 1].end)
+		{
+			pfree(ranges);
+			return false;
+		}
+	}
+
+	pfree(ranges);
+	return true;
+}
+
+/* With aligned slices, the chunks have the same slices if they start together */
+static int
+child_cmp(const void *left, const void *right, void *arg)
+{
+	const ChunkwiseJoinChild *l = left;
+	const ChunkwiseJoinChild *r = right;
+	const int ndims = *(int *) arg;
+
+	for (int i = 0; i < ndims; i++)
+	{
+		if (l->range_start[i] != r->range_start[i])
+			return l->range_start[i] < r->range_start[i] ? -1 : 1;
+	}
+
+	return 0;
+}
+
+static SpecialJoinInfo *
+make_inner_sjinfo(Relids left_relids, Relids right_relids)
+{
+	SpecialJoinInfo *sjinfo = makeNode(SpecialJoinInfo);
+
+	sjinfo->min_lefthand = left_relids;
+	sjinfo->min_righthand = right_relids;
+	sjinfo->syn_lefthand = left_relids;
+	sjinfo->syn_righthand = right_relids;
+	sjinfo->jointype = JOIN_INNER;
+
+	return sjinfo;
+}
+
+/*
+ * Build the join of a pair of chunks, like try_partitionwise_join() does for
+ * partitions. Returns NULL if the join is known to be empty.
+ */
+static RelOptInfo *
+build_chunk_pair_join(PlannerInfo *root, RelOptInfo *joinrel, RelOptInfo *outer_child,
+					  RelOptInfo *inner_child, List *restrictlist)
+{
+	Relids relids = bms_union(outer_child->relids, inner_child->relids);
+	SpecialJoinInfo *sjinfo = make_inner_sjinfo(outer_child->relids, inner_child->relids);
+	AppendRelInfo **appinfos;
+	int nappinfos;
+
+	appinfos = find_appinfos_by_relids(root, relids, &nappinfos);
+	List *child_restrictlist =
+		(List *) adjust_appendrel_attrs(root, (Node *) restrictlist, nappinfos, appinfos);
+
+#if PG16_LT
+	RelOptInfo *child_joinrel = build_child_join_rel(root,
+													 outer_child,
+													 inner_child,
+													 joinrel,
+													 child_restrictlist,
+													 sjinfo,
+													 JOIN_INNER);
+#elif PG17_LT
+	RelOptInfo *child_joinrel =
+		build_child_join_rel(root, outer_child, inner_child, joinrel, child_restrictlist, sjinfo);
+#else
+	RelOptInfo *child_joinrel = build_child_join_rel(root,
+													 outer_child,
+													 inner_child,
+													 joinrel,
+													 child_restrictlist,
+													 sjinfo,
+													 nappinfos,
+													 appinfos);
+#endif
+
+	pfree(appinfos);
+
+	if (IS_DUMMY_REL(child_joinrel))
+		return NULL;
+
+	/* An inner join is planned with either side as the outer side */
+	add_paths_to_joinrel(root,
+						 child_joinrel,
+						 outer_child,
+						 inner_child,
+						 JOIN_INNER,
+						 sjinfo,
+						 child_restrictlist);
+	add_paths_to_joinrel(root,
+						 child_joinrel,
+						 inner_child,
+						 outer_child,
+						 JOIN_INNER,
+						 sjinfo,
+						 child_restrictlist);
+	set_cheapest(child_joinrel);
+
+	return child_joinrel;
+}
+
+/*
+ * Add the Append paths of the chunkwise join to the join of two hypertables,
+ * if their chunks are aligned.
+ */
+static void
+add_chunkwise_join_paths(PlannerInfo *root, RelOptInfo *joinrel, List *child_joinrels)
+{
+	List *subpaths = NIL;
+	List *partial_subpaths = NIL;
+	bool partial = joinrel->consider_parallel;
+	int parallel_workers = 0;
+	ListCell *lc;
+
+	foreach (lc, child_joinrels)
+	{
+		RelOptInfo *child_joinrel = lfirst(lc);
+
+		subpaths = lappend(subpaths, child_joinrel->cheapest_total_path);
+
+		if (partial && child_joinrel->partial_pathlist != NIL)
+		{
+			Path *path = linitial(child_joinrel->partial_pathlist);
+
+			partial_subpaths = lappend(partial_subpaths, path);
+			parallel_workers = Max(parallel_workers, path->parallel_workers);
+		}
+		else
+			partial = false;
+	}
+
+	add_path(joinrel,
+			 (Path *) create_append_path(root, joinrel, subpaths, NIL, NIL, NULL, 0, false, -1));
+
+	if (partial)
+	{
+		/* The same number of workers as for the Append of partitions */
+		parallel_workers =
+			Max(parallel_workers, pg_leftmost_one_pos32(list_length(child_joinrels)) + 1);
+		parallel_workers = Min(parallel_workers, max_parallel_workers_per_gather);
+
+		add_partial_path(joinrel,
+						 (Path *) create_append_path(root,
+													 joinrel,
+													 NIL,
+													 partial_subpaths,
+													 NIL,
+													 NULL,
+													 parallel_workers,
+													 enable_parallel_append,
+													 -1));
+	}
+}
+
+void
+ts_chunkwise_join_add_paths(PlannerInfo *root, RelOptInfo *joinrel, RelOptInfo *outerrel,
+							RelOptInfo *innerrel, JoinType jointype, JoinPathExtraData *extra)
+{
+	if (!enable_partitionwise_join || jointype != JOIN_INNER ||
+		extra->sjinfo->jointype != JOIN_INNER)
+		return;
+
+	Hypertable *outer_ht = get_expanded_hypertable(root, outerrel);
+	Hypertable *inner_ht = get_expanded_hypertable(root, innerrel);
+
+	if (outer_ht == NULL || inner_ht == NULL || !dimensions_are_compatible(outer_ht, inner_ht))
+		return;
+
+	int ndims = outer_ht->space->num_dimensions;
+
+	for (int i = 0; i < ndims; i++)
+	{
+		if (!has_dimension_equijoin(extra->restrictlist,
+									outerrel->relid,
+									&outer_ht->space->dimensions[i],
+									innerrel->relid,
+									&inner_ht->space->dimensions[i]))
+			return;
+	}
+
+	int nouter;
+	int ninner;
+	ChunkwiseJoinChild *outer_children = collect_children(root, outerrel, outer_ht, &nouter);
+	ChunkwiseJoinChild *inner_children = collect_children(root, innerrel, inner_ht, &ninner);
+
+	if (outer_children == NULL || inner_children == NULL || nouter == 0 || ninner == 0)
+		return;
+
+	for (int i = 0; i < ndims; i++)
+	{
+		if (!slices_are_aligned(outer_children, nouter, inner_children, ninner, i))
+			return;
+	}
+
+	qsort_arg(outer_children, nouter, sizeof(ChunkwiseJoinChild), child_cmp, &ndims);
+	qsort_arg(inner_children, ninner, sizeof(ChunkwiseJoinChild), child_cmp, &ndims);
+
+	/*
+	 * The join is called with both hypertables as the outer relation, the
+	 * chunk pairs are joined both ways on the first call.
+	 */
+	List *child_joinrels = NIL;
+	int inner = 0;
+	bool first_pair = true;
+
+	for (int outer = 0; outer < nouter && inner < ninner;)
+	{
+		const int cmp = child_cmp(&outer_children[outer], &inner_children[inner], &ndims);
+
+		if (cmp < 0)
+			outer++;
+		else if (cmp > 0)
+			inner++;
+		else
+		{
+			RelOptInfo *outer_child = outer_children[outer++].rel;
+			RelOptInfo *inner_child = inner_children[inner++].rel;
+
+			if (first_pair)
+			{
+				if (find_join_rel(root, bms_union(outer_child->relids, inner_child->relids)))
+					return;
+
+				/* Required by build_child_join_rel() */
+				joinrel->consider_partitionwise_join = true;
+				first_pair = false;
+			}
+
+			RelOptInfo *child_joinrel =
+				build_chunk_pair_join(root, joinrel, outer_child, inner_child, extra->restrictlist);
+
+			if (child_joinrel != NULL)
+				child_joinrels = lappend(child_joinrels, child_joinrel);
+		}
+	}
+
+	if (child_joinrels != NIL)
+		add_chunkwise_join_paths(root, joinrel, child_joinrels);
+}
@@ -57,6 +57,7 @@
 #include "partialize.h"
 #include "partitioning.h"
 #include "planner.h"
+#include "planner/planner_stats.h"
 #include "time_utils.h"
 #include "ts_catalog/array_utils.h"
 
@@ -1047,6 +1048,7 @@ ts_plan_expand_hypertable_chunks(Hypertable *ht, PlannerInfo *root, RelOptInfo *
 	chunks = get_chunks(&ctx, root, rel, ht, include_osm, &num_chunks);
 	/* Can have zero chunks. */
 	Assert(num_chunks == 0 || chunks != NULL);
+	ts_planner_stats_count_chunks(num_chunks);
 
 	/* nothing to do here if we have no chunks */
 	if (!num_chunks)
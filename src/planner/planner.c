@@ -4,11 +4,13 @@
  * LICENSE-APACHE for a copy of the license.
  */
 #include <postgres.h>
+#include <access/transam.h>
 #include <access/tsmapi.h>
 #include <access/xact.h>
 #include <catalog/namespace.h>
 #include <commands/extension.h>
 #include <executor/nodeAgg.h>
+#include <foreign/fdwapi.h>
 #include <miscadmin.h>
 #include <nodes/makefuncs.h>
 #include <nodes/nodeFuncs.h>
@@ -16,6 +18,7 @@
 #include <nodes/plannodes.h>
 #include <optimizer/appendinfo.h>
 #include <optimizer/clauses.h>
+#include <optimizer/cost.h>
 #include <optimizer/optimizer.h>
 #include <optimizer/pathnode.h>
 #include <optimizer/paths.h>
@@ -56,6 +59,7 @@
 #include "partitioning.h"
 #include "planner/partialize.h"
 #include "planner/planner.h"
+#include "planner/planner_stats.h"
 #include "sort_transform.h"
 #include "utils.h"
 
@@ -106,6 +110,7 @@ static planner_hook_type prev_planner_hook;
 static set_rel_pathlist_hook_type prev_set_rel_pathlist_hook;
 static get_relation_info_hook_type prev_get_relation_info_hook;
 static create_upper_paths_hook_type prev_create_upper_paths_hook;
+static set_join_pathlist_hook_type prev_set_join_pathlist_hook;
 static void cagg_reorder_groupby_clause(RangeTblEntry *subq_rte, Index rtno, List *outer_sortcl,
 										List *outer_tlist);
 
@@ -360,8 +365,12 @@ preprocess_query(Node *node, PreprocessQueryContext *context)
 		{
 			if (ts_guc_enable_now_constify)
 			{
+				instr_time start;
+
+				ts_planner_stats_begin(&start);
 				from->quals =
 					ts_constify_now(context->root, context->current_query->rtable, from->quals);
+				ts_planner_stats_end(TS_PLANNER_STAGE_CONSTIFY_NOW, &start);
 #ifdef TS_DEBUG
 				/*
 				 * only replace if GUC is also set. This is used for testing purposes only,
@@ -591,6 +600,40 @@ preprocess_fk_checks(Query *query, Cache *hcache, PreprocessQueryContext *contex
 	}
 }
 
+static bool
+is_extension_function(Oid func_id, void *context)
+{
+	return func_id >= FirstNormalObjectId;
+}
+
+/*
+ * Check if a query can use the TSL module, in which case the module has to be
+ * loaded before planning it. That is the case if the query reads from any
+ * relation, or calls a function that is not built in, which could be one of
+ * ours. Only queries like "SELECT 1" or "SELECT now()" don't.
+ */
+static bool
+query_can_use_tsl_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (check_functions_in_node(node, is_extension_function, context))
+		return true;
+
+	if (IsA(node, Query))
+	{
+		Query *query = castNode(Query, node);
+
+		if (query->rtable != NIL)
+			return true;
+
+		return query_tree_walker(query, query_can_use_tsl_walker, context, 0);
+	}
+
+	return expression_tree_walker(node, query_can_use_tsl_walker, context);
+}
+
 static PlannedStmt *
 timescaledb_planner(Query *parse, const char *query_string, int cursor_opts,
 					ParamListInfo bound_params)
@@ -602,6 +645,7 @@ timescaledb_planner(Query *parse, const char *query_string, int cursor_opts,
 	 * modified between setjmp/longjmp calls.
 	 */
 	volatile bool reset_baserel_info = false;
+	instr_time planner_start;
 
 	/*
 	 * If we are in an aborted transaction, reject all queries.
@@ -614,6 +658,8 @@ timescaledb_planner(Query *parse, const char *query_string, int cursor_opts,
 				 errmsg("current transaction is aborted, "
 						"commands ignored until end of transaction block")));
 
+	ts_planner_stats_begin(&planner_start);
+
 	planner_hcache_push();
 	if (ts_baserel_info == NULL)
 	{
@@ -624,6 +670,7 @@ timescaledb_planner(Query *parse, const char *query_string, int cursor_opts,
 		 * top-level call, hence this flag.
 		 */
 		reset_baserel_info = true;
+		ts_planner_stats_plan_begin();
 
 		/*
 		 * This is a per-query cache, so we create it in the current memory
@@ -653,16 +700,25 @@ timescaledb_planner(Query *parse, const char *query_string, int cursor_opts,
 
 		if (ts_extension_is_loaded_and_not_upgrading())
 		{
+			instr_time start;
+
+			/* Load the TSL module on the first query that can use it */
+			if (!ts_license_is_module_loading_enabled() &&
+				query_can_use_tsl_walker((Node *) parse, NULL))
+				ts_license_enable_module_loading();
+
 #ifdef USE_TELEMETRY
 			ts_telemetry_function_info_gather(parse);
 #endif
 			/*
 			 * Preprocess the hypertables in the query and warm up the caches.
 			 */
+			ts_planner_stats_begin(&start);
 			preprocess_query((Node *) parse, &context);
 
 			if (ts_guc_enable_optimizations)
 				ts_cm_functions->preprocess_query_tsl(parse, &cursor_opts);
+			ts_planner_stats_end(TS_PLANNER_STAGE_PREPROCESS, &start);
 		}
 
 		if (prev_planner_hook != NULL)
@@ -739,6 +795,13 @@ timescaledb_planner(Query *parse, const char *query_string, int cursor_opts,
 
 	planner_hcache_pop(true);
 
+	/* The nested calls are included in the time of the top-level call */
+	if (reset_baserel_info)
+	{
+		ts_planner_stats_end(TS_PLANNER_STAGE_PLANNER, &planner_start);
+		ts_planner_stats_plan_end();
+	}
+
 	return stmt;
 }
 
@@ -943,6 +1006,34 @@ ts_classify_relation(const PlannerInfo *root, const RelOptInfo *rel, Hypertable
 	return TS_REL_OTHER;
 }
 
+/*
+ * Check if some children of the Append can run asynchronously, like the
+ * foreign scan of a tiered (OSM) chunk.
+ */
+static bool
+append_has_async_capable_child(AppendPath *append)
+{
+	ListCell *lc;
+
+	if (!enable_async_append)
+		return false;
+
+	foreach (lc, append->subpaths)
+	{
+		Path *subpath = lfirst(lc);
+		RelOptInfo *childrel = subpath->parent;
+
+		if (IsA(subpath, ForeignPath) && childrel->fdwroutine != NULL &&
+			childrel->fdwroutine->IsForeignPathAsyncCapable != NULL &&
+			childrel->fdwroutine->IsForeignPathAsyncCapable((ForeignPath *) subpath))
+			return true;
+	}
+
+	return false;
+}
+
+static inline bool should_constraint_aware_append(PlannerInfo *root, Hypertable *ht, Path *path);
+
 static inline bool
 should_chunk_append(Hypertable *ht, PlannerInfo *root, RelOptInfo *rel, Path *path, bool ordered,
 					int order_attno)
@@ -965,6 +1056,7 @@ should_chunk_append(Hypertable *ht, PlannerInfo *root, RelOptInfo *rel, Path *pa
 			 */
 			{
 				AppendPath *append = castNode(AppendPath, path);
+				bool startup_exclusion = false;
 				ListCell *lc;
 
 				/* Don't create ChunkAppend with no children */
@@ -975,12 +1067,26 @@ should_chunk_append(Hypertable *ht, PlannerInfo *root, RelOptInfo *rel, Path *pa
 				{
 					RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
 
-					if (contain_mutable_functions((Node *) rinfo->clause) ||
-						ts_contains_external_param((Node *) rinfo->clause) ||
+					if (ts_contains_external_param((Node *) rinfo->clause) ||
 						ts_contains_join_param((Node *) rinfo->clause))
 						return true;
+
+					if (contain_mutable_functions((Node *) rinfo->clause))
+						startup_exclusion = true;
 				}
-				return false;
+
+				/*
+				 * ChunkAppend scans its children one by one, so the remote
+				 * scans of the tiered data would block the scans of the local
+				 * chunks. If only startup exclusion is needed, prefer the
+				 * constraint-aware append, which keeps the Append node and
+				 * so its asynchronous execution.
+				 */
+				if (startup_exclusion && append_has_async_capable_child(append) &&
+					should_constraint_aware_append(root, ht, path))
+					return false;
+
+				return startup_exclusion;
 				break;
 			}
 		case T_MergeAppendPath:
@@ -1176,6 +1282,8 @@ static void
 apply_optimizations(PlannerInfo *root, TsRelType reltype, RelOptInfo *rel, RangeTblEntry *rte,
 					Hypertable *ht)
 {
+	instr_time start;
+
 	if (!ts_guc_enable_optimizations)
 		return;
 
@@ -1187,6 +1295,8 @@ apply_optimizations(PlannerInfo *root, TsRelType reltype, RelOptInfo *rel, Range
 		case TS_REL_CHUNK_STANDALONE:
 		case TS_REL_CHUNK_CHILD:
 		{
+			ts_planner_stats_begin(&start);
+
 			/*
 			 * Since the sort optimization adds new paths to the rel it has
 			 * to happen before any optimizations that replace pathlist.
@@ -1225,6 +1335,8 @@ apply_optimizations(PlannerInfo *root, TsRelType reltype, RelOptInfo *rel, Range
 				if (ts_cm_functions->set_rel_pathlist_query != NULL)
 					ts_cm_functions->set_rel_pathlist_query(root, rel, rel->relid, rte, ht);
 			}
+
+			ts_planner_stats_end(TS_PLANNER_STAGE_CHUNK_PATHS, &start);
 			break;
 		}
 		default:
@@ -1243,6 +1355,8 @@ apply_optimizations(PlannerInfo *root, TsRelType reltype, RelOptInfo *rel, Range
 
 		Assert(ht != NULL);
 
+		ts_planner_stats_begin(&start);
+
 		foreach (lc, rel->pathlist)
 		{
 			Path **pathptr = (Path **) &lfirst(lc);
@@ -1285,6 +1399,8 @@ apply_optimizations(PlannerInfo *root, TsRelType reltype, RelOptInfo *rel, Range
 					break;
 			}
 		}
+
+		ts_planner_stats_end(TS_PLANNER_STAGE_CHUNK_APPEND, &start);
 	}
 }
 
@@ -1328,7 +1444,13 @@ timescaledb_set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, Index rti, Rang
 
 	/* Check for unexpanded hypertable */
 	if (!rte->inh && ts_rte_is_marked_for_expansion(rte))
+	{
+		instr_time start;
+
+		ts_planner_stats_begin(&start);
 		expand_hypertables(root, rel, rti, rte);
+		ts_planner_stats_end(TS_PLANNER_STAGE_EXPANSION, &start);
+	}
 
 	if (ts_guc_enable_optimizations)
 		ts_planner_constraint_cleanup(root, rel);
@@ -1677,8 +1799,14 @@ timescaledb_create_upper_paths_hook(PlannerInfo *root, UpperRelationKind stage,
 	}
 
 	if (ts_cm_functions->create_upper_paths_hook != NULL)
+	{
+		instr_time start;
+
+		ts_planner_stats_begin(&start);
 		ts_cm_functions
 			->create_upper_paths_hook(root, stage, input_rel, output_rel, reltype, ht, extra);
+		ts_planner_stats_end(TS_PLANNER_STAGE_UPPER_PATHS, &start);
+	}
 }
 
 static bool
@@ -1833,6 +1961,19 @@ cagg_reorder_groupby_clause(RangeTblEntry *subq_rte, Index rtno, List *outer_sor
 	}
 }
 
+static void
+timescaledb_set_join_pathlist(PlannerInfo *root, RelOptInfo *joinrel, RelOptInfo *outerrel,
+							  RelOptInfo *innerrel, JoinType jointype, JoinPathExtraData *extra)
+{
+	if (prev_set_join_pathlist_hook != NULL)
+		(*prev_set_join_pathlist_hook)(root, joinrel, outerrel, innerrel, jointype, extra);
+
+	if (!valid_hook_call() || !ts_guc_enable_optimizations)
+		return;
+
+	ts_chunkwise_join_add_paths(root, joinrel, outerrel, innerrel, jointype, extra);
+}
+
 void
 _planner_init(void)
 {
@@ -1846,6 +1987,10 @@ _planner_init(void)
 
 	prev_create_upper_paths_hook = create_upper_paths_hook;
 	create_upper_paths_hook = timescaledb_create_upper_paths_hook;
+	prev_set_join_pathlist_hook = set_join_pathlist_hook;
+	set_join_pathlist_hook = timescaledb_set_join_pathlist;
+
+	_planner_stats_init();
 }
 
 void
@@ -1855,4 +2000,7 @@ _planner_fini(void)
 	set_rel_pathlist_hook = prev_set_rel_pathlist_hook;
 	get_relation_info_hook = prev_get_relation_info_hook;
 	create_upper_paths_hook = prev_create_upper_paths_hook;
+	set_join_pathlist_hook = prev_set_join_pathlist_hook;
+
+	_planner_stats_fini();
 }
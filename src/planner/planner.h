@@ -39,6 +39,9 @@ typedef struct TimescaleDBPrivate
 
 	/* Cached equivalence members for compressed chunks. List of (EC, EM) Lists. */
 	List *compressed_ec_em_pairs;
+
+	/* Cached compression table of the hypertable, for its compressed chunks. */
+	Hypertable *compressed_hypertable;
 } TimescaleDBPrivate;
 
 extern TSDLLEXPORT bool ts_rte_is_hypertable(const RangeTblEntry *rte);
@@ -105,6 +108,9 @@ extern Expr *ts_transform_time_bucket_comparison(Expr *);
 extern Node *ts_constify_now(PlannerInfo *root, List *rtable, Node *node);
 extern void ts_planner_constraint_cleanup(PlannerInfo *root, RelOptInfo *rel);
 extern Node *ts_add_space_constraints(PlannerInfo *root, List *rtable, Node *node);
+extern void ts_chunkwise_join_add_paths(PlannerInfo *root, RelOptInfo *joinrel,
+										RelOptInfo *outerrel, RelOptInfo *innerrel,
+										JoinType jointype, JoinPathExtraData *extra);
 
 extern TSDLLEXPORT void ts_add_baserel_cache_entry_for_chunk(Oid chunk_reloid,
 															 Hypertable *hypertable);
@@ -0,0 +1,272 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Timing of the stages of the TimescaleDB planner hooks.
+ *
+ * The time is accumulated for the current backend, and is available through
+ * _timescaledb_debug.planner_stats(). EXPLAIN with the summary option shows
+ * the time spent in the stages while planning the explained query.
+ *
+ * The chunks of the expanded hypertables are counted even when the timing is
+ * off, for the average number of chunks per plan in the performance report.
+ */
+#include <postgres.h>
+
+#include <access/htup_details.h>
+#include <commands/explain.h>
+#include <funcapi.h>
+#include <utils/builtins.h>
+
+#include "import/ts_explain.h"
+#include "jsonb_utils.h"
+#include "planner/planner_stats.h"
+#include "utils.h"
+
+typedef struct TsPlannerStageStats
+{
+	int64 calls;
+	instr_time time;
+} TsPlannerStageStats;
+
+static const char *const planner_stage_names[TS_PLANNER_NUM_STAGES] = {
+	[TS_PLANNER_STAGE_PLANNER] = "planner",
+	[TS_PLANNER_STAGE_PREPROCESS] = "preprocess",
+	[TS_PLANNER_STAGE_CONSTIFY_NOW] = "constify_now",
+	[TS_PLANNER_STAGE_EXPANSION] = "expansion",
+	[TS_PLANNER_STAGE_CHUNK_APPEND] = "chunk_append",
+	[TS_PLANNER_STAGE_CHUNK_PATHS] = "chunk_paths",
+	[TS_PLANNER_STAGE_PARTIAL_AGG] = "partial_agg",
+	[TS_PLANNER_STAGE_UPPER_PATHS] = "upper_paths",
+};
+
+static TsPlannerStageStats planner_stats[TS_PLANNER_NUM_STAGES];
+
+typedef struct TsPlannerChunkStats
+{
+	int64 plans;	  /* Top-level plans that expanded a hypertable */
+	int64 expansions; /* Expanded hypertables */
+	int64 chunks;	  /* Chunks of the expanded hypertables */
+} TsPlannerChunkStats;
+
+static TsPlannerChunkStats planner_chunk_stats;
+static int64 plan_begin_expansions = 0;
+
+static ExplainOneQuery_hook_type prev_ExplainOneQuery_hook = NULL;
+
+void
+ts_planner_stats_end(TsPlannerStage stage, const instr_time *start)
+{
+	instr_time duration;
+
+	Assert(stage >= 0 && stage < TS_PLANNER_NUM_STAGES);
+
+	/* The timing was off at the start of the stage */
+	if (INSTR_TIME_IS_ZERO(*start))
+		return;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, *start);
+	INSTR_TIME_ADD(planner_stats[stage].time, duration);
+	planner_stats[stage].calls++;
+}
+
+/*
+ * Mark the begin and the end of a top-level call of the planner, the plan
+ * counts if a hypertable was expanded in between. A plan that fails is not
+ * counted.
+ */
+void
+ts_planner_stats_plan_begin(void)
+{
+	plan_begin_expansions = planner_chunk_stats.expansions;
+}
+
+void
+ts_planner_stats_plan_end(void)
+{
+	if (planner_chunk_stats.expansions > plan_begin_expansions)
+		planner_chunk_stats.plans++;
+}
+
+/*
+ * Count the chunks that remain of an expanded hypertable after chunk
+ * exclusion at planning time.
+ */
+void
+ts_planner_stats_count_chunks(unsigned int num_chunks)
+{
+	planner_chunk_stats.expansions++;
+	planner_chunk_stats.chunks += num_chunks;
+}
+
+/*
+ * Add the chunk counts and the planner stages of the current backend as an
+ * object.
+ */
+void
+ts_planner_stats_add_jsonb(JsonbParseState *state)
+{
+	const TsPlannerChunkStats *cs = &planner_chunk_stats;
+
+	pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	ts_jsonb_add_int64(state, "plans", cs->plans);
+	ts_jsonb_add_int64(state, "hypertable_expansions", cs->expansions);
+	ts_jsonb_add_int64(state, "chunks", cs->chunks);
+	if (cs->plans > 0)
+		ts_jsonb_add_float8(state, "avg_chunks_per_plan", (double) cs->chunks / cs->plans);
+
+	/* The timed stages, only if timescaledb.enable_planner_stats was on */
+	JsonbValue stages_key = {
+		.type = jbvString,
+		.val.string.val = "stages",
+		.val.string.len = strlen("stages"),
+	};
+	pushJsonbValue(&state, WJB_KEY, &stages_key);
+	pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	for (int i = 0; i < TS_PLANNER_NUM_STAGES; i++)
+	{
+		JsonbValue key = {
+			.type = jbvString,
+			.val.string.val = (char *) planner_stage_names[i],
+			.val.string.len = strlen(planner_stage_names[i]),
+		};
+
+		if (planner_stats[i].calls == 0)
+			continue;
+
+		pushJsonbValue(&state, WJB_KEY, &key);
+		pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+		ts_jsonb_add_int64(state, "calls", planner_stats[i].calls);
+		ts_jsonb_add_float8(state, "total_ms", INSTR_TIME_GET_MILLISEC(planner_stats[i].time));
+		pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+	}
+
+	pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+	pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+}
+
+/*
+ * Show the time spent in the planner stages while planning the explained
+ * query, next to the planning time of the summary.
+ */
+static void
+explain_planner_stats(Query *query, int cursorOptions, IntoClause *into, ExplainState *es,
+					  const char *queryString, ParamListInfo params, QueryEnvironment *queryEnv)
+{
+	TsPlannerStageStats stats_start[TS_PLANNER_NUM_STAGES];
+	bool has_stats = false;
+
+	memcpy(stats_start, planner_stats, sizeof(planner_stats));
+
+	if (prev_ExplainOneQuery_hook)
+		prev_ExplainOneQuery_hook(query, cursorOptions, into, es, queryString, params, queryEnv);
+	else
+		ts_standard_ExplainOneQuery(query, cursorOptions, into, es, queryString, params, queryEnv);
+
+	if (!es->summary || !ts_guc_enable_planner_stats)
+		return;
+
+	for (int i = 0; i < TS_PLANNER_NUM_STAGES; i++)
+		has_stats |= planner_stats[i].calls > stats_start[i].calls;
+
+	/* Nothing was planned, e.g. for EXPLAIN EXECUTE with a cached plan */
+	if (!has_stats)
+		return;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+		appendStringInfoString(es->str, "TimescaleDB Planning Time:");
+	else
+		ExplainOpenGroup("TimescaleDB Planning", "TimescaleDB Planning", true, es);
+
+	for (int i = 0; i < TS_PLANNER_NUM_STAGES; i++)
+	{
+		instr_time time = planner_stats[i].time;
+		double time_ms;
+
+		if (planner_stats[i].calls == stats_start[i].calls)
+			continue;
+
+		INSTR_TIME_SUBTRACT(time, stats_start[i].time);
+		time_ms = INSTR_TIME_GET_MILLISEC(time);
+
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+			appendStringInfo(es->str, " %s=%.3f", planner_stage_names[i], time_ms);
+		else
+			ExplainPropertyFloat(planner_stage_names[i], "ms", time_ms, 3, es);
+	}
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+		appendStringInfoString(es->str, " ms\n");
+	else
+		ExplainCloseGroup("TimescaleDB Planning", "TimescaleDB Planning", true, es);
+}
+
+/*
+ * Return the number of calls and the time spent in every planner stage in the
+ * current backend, accumulated since the backend start.
+ */
+TS_FUNCTION_INFO_V1(ts_planner_stats);
+
+Datum
+ts_planner_stats(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		funcctx->max_calls = TS_PLANNER_NUM_STAGES;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		const TsPlannerStageStats *stats = &planner_stats[funcctx->call_cntr];
+		Datum values[3] = {
+			CStringGetTextDatum(planner_stage_names[funcctx->call_cntr]),
+			Int64GetDatum(stats->calls),
+			Float8GetDatum(INSTR_TIME_GET_MILLISEC(stats->time)),
+		};
+		bool nulls[3] = { false };
+
+		Assert(funcctx->tuple_desc->natts == lengthof(values));
+
+		HeapTuple tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+void
+_planner_stats_init(void)
+{
+	prev_ExplainOneQuery_hook = ExplainOneQuery_hook;
+	ExplainOneQuery_hook = explain_planner_stats;
+}
+
+void
+_planner_stats_fini(void)
+{
+	ExplainOneQuery_hook = prev_ExplainOneQuery_hook;
+}
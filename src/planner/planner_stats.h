@@ -0,0 +1,50 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <portability/instr_time.h>
+#include <utils/jsonb.h>
+
+#include "export.h"
+#include "guc.h"
+
+/*
+ * The stages of the TimescaleDB planner hooks that we measure when
+ * timescaledb.enable_planner_stats is on. The stages can nest, e.g.
+ * preprocessing includes the constification of now(), and the planner
+ * calls made while planning are included in the stages of the outer call.
+ */
+typedef enum TsPlannerStage
+{
+	TS_PLANNER_STAGE_PLANNER,		   /* The top-level calls of the planner hook */
+	TS_PLANNER_STAGE_PREPROCESS,	   /* Preprocessing of the query */
+	TS_PLANNER_STAGE_CONSTIFY_NOW,	   /* Constification of now() in the quals */
+	TS_PLANNER_STAGE_EXPANSION,		   /* Expansion of the hypertables into chunks */
+	TS_PLANNER_STAGE_CHUNK_APPEND,	   /* Creation of ChunkAppend and similar paths */
+	TS_PLANNER_STAGE_CHUNK_PATHS,	   /* TSL paths for chunks, e.g. DecompressChunk */
+	TS_PLANNER_STAGE_PARTIAL_AGG,	   /* Pushdown of partial aggregation to the chunks */
+	TS_PLANNER_STAGE_UPPER_PATHS,	   /* TSL paths for the upper relations */
+	TS_PLANNER_NUM_STAGES
+} TsPlannerStage;
+
+static inline void
+ts_planner_stats_begin(instr_time *start)
+{
+	if (ts_guc_enable_planner_stats)
+		INSTR_TIME_SET_CURRENT(*start);
+	else
+		INSTR_TIME_SET_ZERO(*start);
+}
+
+extern TSDLLEXPORT void ts_planner_stats_end(TsPlannerStage stage, const instr_time *start);
+extern void ts_planner_stats_plan_begin(void);
+extern void ts_planner_stats_plan_end(void);
+extern void ts_planner_stats_count_chunks(unsigned int num_chunks);
+extern void ts_planner_stats_add_jsonb(JsonbParseState *state);
+
+extern void _planner_stats_init(void);
+extern void _planner_stats_fini(void);
@@ -72,6 +72,7 @@
 #include "hypertable.h"
 #include "hypertable_cache.h"
 #include "indexing.h"
+#include "license_guc.h"
 #include "partitioning.h"
 #include "process_utility.h"
 #include "scan_iterator.h"
@@ -79,6 +80,7 @@
 #include "trigger.h"
 #include "ts_catalog/array_utils.h"
 #include "ts_catalog/catalog.h"
+#include "ts_catalog/catalog_snapshot.h"
 #include "ts_catalog/chunk_column_stats.h"
 #include "ts_catalog/compression_settings.h"
 #include "ts_catalog/continuous_agg.h"
@@ -4975,6 +4977,21 @@ preprocess_execute(ProcessUtilityArgs *args)
 	return DDL_CONTINUE;
 }
 
+/*
+ * A prepared transaction might have changed the hypertable catalog, so the
+ * shared catalog snapshot is invalidated when COMMIT PREPARED commits.
+ */
+static DDLResult
+process_transaction(ProcessUtilityArgs *args)
+{
+	TransactionStmt *stmt = castNode(TransactionStmt, args->parsetree);
+
+	if (stmt->kind == TRANS_STMT_COMMIT_PREPARED)
+		ts_catalog_snapshot_changed();
+
+	return DDL_CONTINUE;
+}
+
 /*
  * Handle DDL commands before they have been processed by PostgreSQL.
  */
@@ -5065,6 +5082,10 @@ process_ddl_command_start(ProcessUtilityArgs *args)
 			check_read_only = false;
 			handler = process_explain_start;
 			break;
+		case T_TransactionStmt:
+			check_read_only = false;
+			handler = process_transaction;
+			break;
 
 		default:
 			handler = NULL;
@@ -5263,6 +5284,30 @@ process_ddl_sql_drop(EventTriggerDropObject *obj)
 	}
 }
 
+/*
+ * Check if a utility command can use the TSL module. Only the commands that
+ * connection poolers and drivers typically send when a connection is set up
+ * or reset can't.
+ */
+static bool
+utility_can_use_tsl(Node *parsetree)
+{
+	switch (nodeTag(parsetree))
+	{
+		case T_TransactionStmt:
+		case T_VariableSetStmt:
+		case T_VariableShowStmt:
+		case T_DiscardStmt:
+		case T_DeallocateStmt:
+		case T_ListenStmt:
+		case T_UnlistenStmt:
+		case T_NotifyStmt:
+			return false;
+		default:
+			return true;
+	}
+}
+
 /*
  * ProcessUtility hook for DDL commands that have not yet been processed by
  * PostgreSQL.
@@ -5309,6 +5354,10 @@ timescaledb_ddl_command_start(PlannedStmt *pstmt, const char *query_string, bool
 		return;
 	}
 
+	/* Load the TSL module on the first command that can use it */
+	if (!ts_license_is_module_loading_enabled() && utility_can_use_tsl(args.parsetree))
+		ts_license_enable_module_loading();
+
 	/*
 	 * Process Utility/DDL operation locally then pass it on for
 	 * execution in TSL.
@@ -0,0 +1,299 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Progress reporting of the long-running commands of the extension.
+ *
+ * This works like the progress reporting of the PostgreSQL commands, which
+ * can't be extended with new commands, using the slots that the loader
+ * allocates in shared memory. Without a loader that supports the slots, the
+ * commands don't report their progress.
+ */
+#include <postgres.h>
+#include <access/htup_details.h>
+#include <access/xact.h>
+#include <catalog/pg_authid.h>
+#include <catalog/pg_type.h>
+#include <funcapi.h>
+#include <miscadmin.h>
+#include <port/atomics.h>
+#include <storage/proc.h>
+#include <utils/acl.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+
+#include "compat/compat.h"
+#include "loader/progress.h"
+#include "progress.h"
+#include "utils.h"
+
+#if PG17_GE
+#define progress_proc_number() MyProcNumber
+#else
+#define progress_proc_number() (MyProc->pgprocno)
+#endif
+
+static const char *const progress_command_names[] = {
+	[TS_PROGRESS_COMMAND_CAGG_REFRESH] = "cagg refresh",
+};
+
+static TsProgressRendezvous *progress = NULL;
+
+/* The slot of the current backend, while a command is running */
+static TsProgressSlot *progress_slot = NULL;
+
+#define PROGRESS_BEGIN_WRITE(slot)                                                                 \
+	do                                                                                             \
+	{                                                                                              \
+		(slot)->changecount++;                                                                     \
+		pg_write_barrier();                                                                        \
+	} while (0)
+
+#define PROGRESS_END_WRITE(slot)                                                                   \
+	do                                                                                             \
+	{                                                                                              \
+		pg_write_barrier();                                                                        \
+		(slot)->changecount++;                                                                     \
+		Assert(((slot)->changecount & 1) == 0);                                                    \
+	} while (0)
+
+/*
+ * Start reporting the progress of a command in the current backend. A
+ * command that is already running in the backend, e.g., the refresh of a
+ * continuous aggregate that refreshes the continuous aggregates on top of it,
+ * is replaced.
+ */
+void
+ts_progress_start_command(TsProgressCommand command, Oid relid)
+{
+	TsProgressSlot *slot;
+
+	if (progress == NULL || MyProc == NULL || progress_proc_number() < 0 ||
+		progress_proc_number() >= progress->num_slots)
+		return;
+
+	slot = &progress->slots[progress_proc_number()];
+
+	PROGRESS_BEGIN_WRITE(slot);
+	slot->command = command;
+	slot->pid = MyProcPid;
+	slot->database_id = MyDatabaseId;
+	slot->userid = GetUserId();
+	slot->relid = relid;
+	MemSet(slot->params, 0, sizeof(slot->params));
+	PROGRESS_END_WRITE(slot);
+
+	progress_slot = slot;
+}
+
+void
+ts_progress_update_param(int index, int64 value)
+{
+	Assert(index >= 0 && index < TS_PROGRESS_NUM_PARAMS);
+
+	if (progress_slot == NULL)
+		return;
+
+	PROGRESS_BEGIN_WRITE(progress_slot);
+	progress_slot->params[index] = value;
+	PROGRESS_END_WRITE(progress_slot);
+}
+
+void
+ts_progress_incr_param(int index, int64 delta)
+{
+	Assert(index >= 0 && index < TS_PROGRESS_NUM_PARAMS);
+
+	if (progress_slot == NULL)
+		return;
+
+	PROGRESS_BEGIN_WRITE(progress_slot);
+	progress_slot->params[index] += delta;
+	PROGRESS_END_WRITE(progress_slot);
+}
+
+void
+ts_progress_end_command(void)
+{
+	if (progress_slot == NULL)
+		return;
+
+	PROGRESS_BEGIN_WRITE(progress_slot);
+	progress_slot->command = TS_PROGRESS_COMMAND_INVALID;
+	progress_slot->relid = InvalidOid;
+	PROGRESS_END_WRITE(progress_slot);
+
+	progress_slot = NULL;
+}
+
+/*
+ * Get a consistent copy of a slot written by another backend.
+ */
+static void
+progress_read_slot(const TsProgressSlot *slot, TsProgressSlot *copy)
+{
+	for (;;)
+	{
+		int before = *(volatile const int *) &slot->changecount;
+
+		pg_read_barrier();
+		memcpy(copy, slot, sizeof(*copy));
+		pg_read_barrier();
+
+		if (before == *(volatile const int *) &slot->changecount && (before & 1) == 0)
+			break;
+
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Return the progress of the commands with the given name that run in the
+ * backends of the current database. The relid and the parameters of the
+ * commands of other users are only shown to the members of
+ * pg_read_all_stats, the same as for the PostgreSQL commands.
+ */
+TS_FUNCTION_INFO_V1(ts_progress_info);
+
+Datum
+ts_progress_info(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	TsProgressSlot *slots;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		const char *command_name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+		TsProgressCommand command = TS_PROGRESS_COMMAND_INVALID;
+		MemoryContext oldcontext;
+		TupleDesc tupdesc;
+
+		for (size_t i = 0; i < lengthof(progress_command_names); i++)
+		{
+			if (progress_command_names[i] != NULL &&
+				pg_strcasecmp(command_name, progress_command_names[i]) == 0)
+				command = i;
+		}
+
+		if (command == TS_PROGRESS_COMMAND_INVALID)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid command name: \"%s\"", command_name)));
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+		/* Copy the slots of the command, so that all rows are read at once */
+		slots = palloc(sizeof(TsProgressSlot) * (progress == NULL ? 1 : progress->num_slots));
+		funcctx->max_calls = 0;
+
+		for (int i = 0; progress != NULL && i < progress->num_slots; i++)
+		{
+			TsProgressSlot *slot = &slots[funcctx->max_calls];
+
+			progress_read_slot(&progress->slots[i], slot);
+
+			if (slot->command == command && slot->database_id == MyDatabaseId)
+				funcctx->max_calls++;
+		}
+
+		funcctx->user_fctx = slots;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	slots = funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		const TsProgressSlot *slot = &slots[funcctx->call_cntr];
+		Datum values[4] = {
+			Int32GetDatum(slot->pid),
+			ObjectIdGetDatum(slot->database_id),
+		};
+		bool nulls[4] = { false };
+
+		Assert(funcctx->tuple_desc->natts == lengthof(values));
+
+		if (has_privs_of_role(GetUserId(), slot->userid) ||
+			has_privs_of_role(GetUserId(), ROLE_PG_READ_ALL_STATS))
+		{
+			Datum params[TS_PROGRESS_NUM_PARAMS];
+
+			for (int j = 0; j < TS_PROGRESS_NUM_PARAMS; j++)
+				params[j] = Int64GetDatum(slot->params[j]);
+
+			ArrayType *array = construct_array(params,
+											   TS_PROGRESS_NUM_PARAMS,
+											   INT8OID,
+											   sizeof(int64),
+											   FLOAT8PASSBYVAL,
+											   TYPALIGN_DOUBLE);
+
+			values[2] = ObjectIdGetDatum(slot->relid);
+			values[3] = PointerGetDatum(array);
+		}
+		else
+		{
+			nulls[2] = true;
+			nulls[3] = true;
+		}
+
+		HeapTuple tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+/*
+ * A command that fails doesn't end the reporting of its progress, so we end
+ * it when the transaction aborts.
+ */
+static void
+progress_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+			ts_progress_end_command();
+			break;
+		default:
+			break;
+	}
+}
+
+void
+_progress_init(void)
+{
+	TsProgressRendezvous **rendezvous =
+		(TsProgressRendezvous **) find_rendezvous_variable(RENDEZVOUS_PROGRESS);
+
+	/* The loader doesn't support progress reporting */
+	if (*rendezvous == NULL)
+		return;
+
+	progress = *rendezvous;
+	RegisterXactCallback(progress_xact_callback, NULL);
+}
+
+void
+_progress_fini(void)
+{
+	if (progress != NULL)
+		UnregisterXactCallback(progress_xact_callback, NULL);
+	progress = NULL;
+	progress_slot = NULL;
+}
@@ -0,0 +1,49 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include "export.h"
+
+/*
+ * The commands that report their progress, shown by
+ * _timescaledb_functions.get_progress_info().
+ */
+typedef enum TsProgressCommand
+{
+	TS_PROGRESS_COMMAND_INVALID = 0,
+	TS_PROGRESS_COMMAND_CAGG_REFRESH,
+} TsProgressCommand;
+
+/*
+ * Parameters of the refresh of a continuous aggregate. The relid is the
+ * continuous aggregate and the times are internal time values.
+ */
+#define PROGRESS_CAGG_REFRESH_PHASE 0
+#define PROGRESS_CAGG_REFRESH_BATCH 1
+#define PROGRESS_CAGG_REFRESH_BATCHES 2
+#define PROGRESS_CAGG_REFRESH_WINDOW_START 3
+#define PROGRESS_CAGG_REFRESH_WINDOW_END 4
+#define PROGRESS_CAGG_REFRESH_WINDOWS_TOTAL 5
+#define PROGRESS_CAGG_REFRESH_WINDOWS_DONE 6
+#define PROGRESS_CAGG_REFRESH_ROWS_DELETED 7
+#define PROGRESS_CAGG_REFRESH_ROWS_INSERTED 8
+#define PROGRESS_CAGG_REFRESH_INVALIDATION_TIME 9	 /* Microseconds */
+#define PROGRESS_CAGG_REFRESH_MATERIALIZATION_TIME 10 /* Microseconds */
+
+/* Phases of the refresh of a continuous aggregate */
+#define PROGRESS_CAGG_REFRESH_PHASE_HYPERTABLE_INVALIDATIONS 1
+#define PROGRESS_CAGG_REFRESH_PHASE_CAGG_INVALIDATIONS 2
+#define PROGRESS_CAGG_REFRESH_PHASE_MATERIALIZATION 3
+
+extern TSDLLEXPORT void ts_progress_start_command(TsProgressCommand command, Oid relid);
+extern TSDLLEXPORT void ts_progress_update_param(int index, int64 value);
+extern TSDLLEXPORT void ts_progress_incr_param(int index, int64 delta);
+extern TSDLLEXPORT void ts_progress_end_command(void);
+
+extern void _progress_init(void);
+extern void _progress_fini(void);
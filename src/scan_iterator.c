@@ -53,6 +53,31 @@ ts_scan_iterator_scan_key_init(ScanIterator *iterator, AttrNumber attributeNumbe
 	MemoryContextSwitchTo(oldmcxt);
 }
 
+/*
+ * Initialize a scan key that matches any of the given values, to find the
+ * tuples for all of them in a single index scan.
+ */
+void
+ts_scan_iterator_scan_key_init_int32_array(ScanIterator *iterator, AttrNumber attributeNumber,
+										   const int32 *values, int num_values)
+{
+	MemoryContext oldmcxt;
+
+	Assert(iterator->ctx.scankey == NULL || iterator->ctx.scankey == iterator->scankey);
+	Assert(OidIsValid(iterator->ctx.index));
+	iterator->ctx.scankey = iterator->scankey;
+
+	if (iterator->ctx.nkeys >= EMBEDDED_SCAN_KEY_SIZE)
+		elog(ERROR, "cannot scan more than %d keys", EMBEDDED_SCAN_KEY_SIZE);
+
+	oldmcxt = MemoryContextSwitchTo(iterator->ctx.internal.scan_mcxt);
+	ts_scanner_scan_key_init_int32_array(&iterator->scankey[iterator->ctx.nkeys++],
+										 attributeNumber,
+										 values,
+										 num_values);
+	MemoryContextSwitchTo(oldmcxt);
+}
+
 TSDLLEXPORT void
 ts_scan_iterator_rescan(ScanIterator *iterator)
 {
@@ -7,14 +7,17 @@
 #include <access/htup_details.h>
 #include <access/relscan.h>
 #include <access/xact.h>
+#include <catalog/pg_type.h>
 #include <executor/tuptable.h>
 #include <storage/bufmgr.h>
 #include <storage/lmgr.h>
 #include <storage/procarray.h>
+#include <utils/array.h>
 #include <utils/palloc.h>
 #include <utils/rel.h>
 #include <utils/snapmgr.h>
 
+#include "lock_wait_stats.h"
 #include "scanner.h"
 
 enum ScannerType
@@ -386,6 +389,54 @@ ts_scanner_close(ScannerCtx *ctx)
 	}
 }
 
+static TM_Result
+scanner_table_tuple_lock(ScannerCtx *ctx, LockWaitPolicy waitpolicy)
+{
+	TupleTableSlot *slot = ctx->internal.tinfo.slot;
+
+	Assert(ctx->snapshot);
+	return table_tuple_lock(ctx->tablerel,
+							&(slot->tts_tid),
+							ctx->snapshot,
+							slot,
+							GetCurrentCommandId(false),
+							ctx->tuplock->lockmode,
+							waitpolicy,
+							ctx->tuplock->lockflags,
+							&ctx->internal.tinfo.lockfd);
+}
+
+/*
+ * Lock the current tuple. A blocking lock is first tried without waiting, so
+ * that the waits for the catalog tuples are counted.
+ */
+static void
+scanner_lock_tuple(ScannerCtx *ctx)
+{
+	TupleInfo *ti = &ctx->internal.tinfo;
+	LockWaitStatsLock lock;
+	instr_time wait_start;
+
+	if (ctx->tuplock->waitpolicy != LockWaitBlock)
+	{
+		ti->lockresult = scanner_table_tuple_lock(ctx, ctx->tuplock->waitpolicy);
+		return;
+	}
+
+	lock = ts_lock_wait_stats_catalog_tuple_lock(ctx->table);
+	ti->lockresult = scanner_table_tuple_lock(ctx, LockWaitSkip);
+
+	if (ti->lockresult != TM_WouldBlock)
+	{
+		ts_lock_wait_stats_report(lock, NULL);
+		return;
+	}
+
+	INSTR_TIME_SET_CURRENT(wait_start);
+	ti->lockresult = scanner_table_tuple_lock(ctx, LockWaitBlock);
+	ts_lock_wait_stats_report(lock, &wait_start);
+}
+
 TSDLLEXPORT TupleInfo *
 ts_scanner_next(ScannerCtx *ctx)
 {
@@ -407,20 +458,7 @@ ts_scanner_next(ScannerCtx *ctx)
 			ictx->tinfo.count++;
 
 			if (ctx->tuplock)
-			{
-				TupleTableSlot *slot = ictx->tinfo.slot;
-
-				Assert(ctx->snapshot);
-				ictx->tinfo.lockresult = table_tuple_lock(ctx->tablerel,
-														  &(slot->tts_tid),
-														  ctx->snapshot,
-														  slot,
-														  GetCurrentCommandId(false),
-														  ctx->tuplock->lockmode,
-														  ctx->tuplock->waitpolicy,
-														  ctx->tuplock->lockflags,
-														  &ictx->tinfo.lockfd);
-			}
+				scanner_lock_tuple(ctx);
 
 			/* stop at a valid tuple */
 			return &ictx->tinfo;
@@ -534,3 +572,37 @@ ts_scanner_get_tupledesc(const TupleInfo *ti)
 {
 	return ti->slot->tts_tupleDescriptor;
 }
+
+/*
+ * Initialize a scan key that matches any of the given int32 values.
+ *
+ * This allows looking up many catalog tuples by id in a single index scan,
+ * instead of one scan or rescan per id. The btree index returns the matching
+ * tuples ordered by the key, and each tuple at most once even if the values
+ * contain duplicates. Only index scans support array scan keys.
+ *
+ * The array is allocated in the current memory context, which must outlive
+ * the scan.
+ */
+TSDLLEXPORT void
+ts_scanner_scan_key_init_int32_array(ScanKey key, AttrNumber attno, const int32 *values,
+									 int num_values)
+{
+	Datum *datums = palloc(sizeof(Datum) * num_values);
+	ArrayType *array;
+
+	for (int i = 0; i < num_values; i++)
+		datums[i] = Int32GetDatum(values[i]);
+
+	array = construct_array(datums, num_values, INT4OID, sizeof(int32), true, TYPALIGN_INT);
+	pfree(datums);
+
+	ScanKeyEntryInitialize(key,
+						   SK_SEARCHARRAY,
+						   attno,
+						   BTEqualStrategyNumber,
+						   InvalidOid,
+						   InvalidOid,
+						   F_INT4EQ,
+						   PointerGetDatum(array));
+}
@@ -160,3 +160,5 @@ extern TSDLLEXPORT ItemPointer ts_scanner_get_tuple_tid(TupleInfo *ti);
 extern TSDLLEXPORT HeapTuple ts_scanner_fetch_heap_tuple(const TupleInfo *ti, bool materialize,
 														 bool *should_free);
 extern TSDLLEXPORT TupleDesc ts_scanner_get_tupledesc(const TupleInfo *ti);
+extern TSDLLEXPORT void ts_scanner_scan_key_init_int32_array(ScanKey key, AttrNumber attno,
+															 const int32 *values, int num_values);
@@ -35,6 +35,7 @@ typedef struct SubspaceStore
 	/* limit growth of store by  limiting number of slices in first dimension,	0 for no limit */
 	uint16 max_items;
 	SubspaceStoreInternalNode *origin; /* origin of the tree */
+	CacheUsage *usage;				   /* Backend-wide counters of this kind of store, or NULL */
 } SubspaceStore;
 
 static inline SubspaceStoreInternalNode *
@@ -70,7 +71,8 @@ subspace_store_internal_node_descendants(SubspaceStoreInternalNode *node, int in
 }
 
 SubspaceStore *
-ts_subspace_store_init(const Hyperspace *space, MemoryContext mcxt, int16 max_items)
+ts_subspace_store_init(const Hyperspace *space, MemoryContext mcxt, int16 max_items,
+					   CacheUsage *usage)
 {
 	MemoryContext old = MemoryContextSwitchTo(mcxt);
 	SubspaceStore *sst = palloc(sizeof(SubspaceStore));
@@ -80,6 +82,7 @@ ts_subspace_store_init(const Hyperspace *space, MemoryContext mcxt, int16 max_it
 	/* max_items = 0 is treated as unlimited */
 	sst->max_items = max_items;
 	sst->mcxt = mcxt;
+	sst->usage = usage;
 	MemoryContextSwitchTo(old);
 	return sst;
 }
@@ -157,6 +160,9 @@ ts_subspace_store_add(SubspaceStore *subspace_store, const Hypercube *hypercube,
 			 * root.
 			 */
 			node->descendants -= items_removed;
+
+			if (subspace_store->usage != NULL)
+				subspace_store->usage->evictions += items_removed;
 		}
 
 		match = ts_dimension_vec_find_slice(node->vector, target->fd.range_start);
@@ -190,6 +196,31 @@ ts_subspace_store_add(SubspaceStore *subspace_store, const Hypercube *hypercube,
 	MemoryContextSwitchTo(old);
 }
 
+/*
+ * Remove the objects of the slice of the earliest time range, like when the
+ * store is full, e.g., to free their memory. Returns the number of objects
+ * removed, which is zero if the store is empty.
+ */
+size_t
+ts_subspace_store_evict_earliest(SubspaceStore *subspace_store)
+{
+	SubspaceStoreInternalNode *node = subspace_store->origin;
+
+	if (node->vector->num_slices == 0)
+		return 0;
+
+	MemoryContext old = MemoryContextSwitchTo(subspace_store->mcxt);
+	size_t items_removed = subspace_store_internal_node_descendants(node, 0);
+	ts_dimension_vec_remove_slice(&node->vector, 0);
+	node->descendants -= items_removed;
+	MemoryContextSwitchTo(old);
+
+	if (subspace_store->usage != NULL)
+		subspace_store->usage->evictions += items_removed;
+
+	return items_removed;
+}
+
 void *
 ts_subspace_store_get(const SubspaceStore *subspace_store, const Point *target)
 {
@@ -210,11 +241,19 @@ ts_subspace_store_get(const SubspaceStore *subspace_store, const Point *target)
 		match = ts_dimension_vec_find_slice(vec, target->coordinates[i]);
 
 		if (NULL == match)
+		{
+			if (subspace_store->usage != NULL)
+				subspace_store->usage->misses++;
 			return NULL;
+		}
 
 		vec = ((SubspaceStoreInternalNode *) match->storage)->vector;
 	}
 	Assert(match != NULL);
+
+	if (subspace_store->usage != NULL)
+		subspace_store->usage->hits++;
+
 	return match->storage;
 }
 
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <postgres.h>
+#include "cache.h"
 #include "dimension.h"
 
 /* A subspace store allows you to save data associated with
@@ -19,7 +20,7 @@ typedef struct Point Point;
 typedef struct SubspaceStore SubspaceStore;
 
 extern SubspaceStore *ts_subspace_store_init(const Hyperspace *space, MemoryContext mcxt,
-											 int16 max_items);
+											 int16 max_items, CacheUsage *usage);
 
 /* Store an object associate with the subspace represented by a hypercube */
 extern void ts_subspace_store_add(SubspaceStore *subspace_store, const Hypercube *hypercube,
@@ -29,5 +30,6 @@ extern void ts_subspace_store_add(SubspaceStore *subspace_store, const Hypercube
  * Return the object stored or NULL if this subspace is not in the store.
  */
 extern void *ts_subspace_store_get(const SubspaceStore *subspace_store, const Point *target);
+extern size_t ts_subspace_store_evict_earliest(SubspaceStore *subspace_store);
 extern void ts_subspace_store_free(SubspaceStore *subspace_store);
 extern MemoryContext ts_subspace_store_mcxt(const SubspaceStore *subspace_store);
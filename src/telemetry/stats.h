@@ -5,6 +5,7 @@
  */
 #pragma once
 #include <postgres.h>
+#include <utils/jsonb.h>
 
 #include "utils.h"
 
@@ -96,3 +97,5 @@ typedef struct TelemetryJobStats
 } TelemetryJobStats;
 
 extern void ts_telemetry_stats_gather(TelemetryStats *stats);
+extern void ts_telemetry_stats_add_relations(JsonbParseState *parse_state,
+											 const TelemetryStats *stats);
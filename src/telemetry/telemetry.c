@@ -591,123 +591,6 @@ format_iso8601(Datum value)
 		DirectFunctionCall2(timestamptz_to_char, value, CStringGetTextDatum(ISO8601_FORMAT)));
 }
 
-#define REQ_RELKIND_COUNT "num_relations"
-#define REQ_RELKIND_RELTUPLES "num_reltuples"
-
-#define REQ_RELKIND_HEAP_SIZE "heap_size"
-#define REQ_RELKIND_TOAST_SIZE "toast_size"
-#define REQ_RELKIND_INDEXES_SIZE "indexes_size"
-
-#define REQ_RELKIND_CHILDREN "num_children"
-#define REQ_RELKIND_REPLICA_CHUNKS "num_replica_chunks"
-#define REQ_RELKIND_COMPRESSED_CHUNKS "num_compressed_chunks"
-#define REQ_RELKIND_COMPRESSED_HYPERTABLES "num_compressed_hypertables"
-#define REQ_RELKIND_COMPRESSED_CAGGS "num_compressed_caggs"
-
-#define REQ_RELKIND_UNCOMPRESSED_HEAP_SIZE "uncompressed_heap_size"
-#define REQ_RELKIND_UNCOMPRESSED_TOAST_SIZE "uncompressed_toast_size"
-#define REQ_RELKIND_UNCOMPRESSED_INDEXES_SIZE "uncompressed_indexes_size"
-#define REQ_RELKIND_UNCOMPRESSED_ROWCOUNT "uncompressed_row_count"
-#define REQ_RELKIND_COMPRESSED_HEAP_SIZE "compressed_heap_size"
-#define REQ_RELKIND_COMPRESSED_TOAST_SIZE "compressed_toast_size"
-#define REQ_RELKIND_COMPRESSED_INDEXES_SIZE "compressed_indexes_size"
-#define REQ_RELKIND_COMPRESSED_ROWCOUNT "compressed_row_count"
-#define REQ_RELKIND_COMPRESSED_ROWCOUNT_FROZEN_IMMEDIATELY "compressed_row_count_frozen_immediately"
-
-#define REQ_RELKIND_CAGG_USES_REAL_TIME_AGGREGATION_COUNT "num_caggs_using_real_time_aggregation"
-#define REQ_RELKIND_CAGG_FINALIZED "num_caggs_finalized"
-#define REQ_RELKIND_CAGG_NESTED "num_caggs_nested"
-
-static JsonbValue *
-add_compression_stats_object(JsonbParseState *parse_state, StatsRelType reltype,
-							 const HyperStats *hs)
-{
-	JsonbValue name = {
-		.type = jbvString,
-		.val.string.val = pstrdup("compression"),
-		.val.string.len = strlen("compression"),
-	};
-	pushJsonbValue(&parse_state, WJB_KEY, &name);
-	pushJsonbValue(&parse_state, WJB_BEGIN_OBJECT, NULL);
-
-	ts_jsonb_add_int64(parse_state, REQ_RELKIND_COMPRESSED_CHUNKS, hs->compressed_chunk_count);
-
-	if (reltype == RELTYPE_CONTINUOUS_AGG)
-		ts_jsonb_add_int64(parse_state,
-						   REQ_RELKIND_COMPRESSED_CAGGS,
-						   hs->compressed_hypertable_count);
-	else
-		ts_jsonb_add_int64(parse_state,
-						   REQ_RELKIND_COMPRESSED_HYPERTABLES,
-						   hs->compressed_hypertable_count);
-
-	ts_jsonb_add_int64(parse_state, REQ_RELKIND_COMPRESSED_ROWCOUNT, hs->compressed_row_count);
-	ts_jsonb_add_int64(parse_state, REQ_RELKIND_COMPRESSED_HEAP_SIZE, hs->compressed_heap_size);
-	ts_jsonb_add_int64(parse_state, REQ_RELKIND_COMPRESSED_TOAST_SIZE, hs->compressed_toast_size);
-	ts_jsonb_add_int64(parse_state,
-					   REQ_RELKIND_COMPRESSED_INDEXES_SIZE,
-					   hs->compressed_indexes_size);
-	ts_jsonb_add_int64(parse_state,
-					   REQ_RELKIND_COMPRESSED_ROWCOUNT_FROZEN_IMMEDIATELY,
-					   hs->compressed_row_frozen_immediately_count);
-	ts_jsonb_add_int64(parse_state, REQ_RELKIND_UNCOMPRESSED_ROWCOUNT, hs->uncompressed_row_count);
-	ts_jsonb_add_int64(parse_state, REQ_RELKIND_UNCOMPRESSED_HEAP_SIZE, hs->uncompressed_heap_size);
-	ts_jsonb_add_int64(parse_state,
-					   REQ_RELKIND_UNCOMPRESSED_TOAST_SIZE,
-					   hs->uncompressed_toast_size);
-	ts_jsonb_add_int64(parse_state,
-					   REQ_RELKIND_UNCOMPRESSED_INDEXES_SIZE,
-					   hs->uncompressed_indexes_size);
-
-	return pushJsonbValue(&parse_state, WJB_END_OBJECT, NULL);
-}
-
-static JsonbValue *
-add_relkind_stats_object(JsonbParseState *parse_state, const char *relkindname,
-						 const BaseStats *stats, StatsRelType reltype, StatsType statstype)
-{
-	JsonbValue name = {
-		.type = jbvString,
-		.val.string.val = pstrdup(relkindname),
-		.val.string.len = strlen(relkindname),
-	};
-	pushJsonbValue(&parse_state, WJB_KEY, &name);
-	pushJsonbValue(&parse_state, WJB_BEGIN_OBJECT, NULL);
-
-	ts_jsonb_add_int64(parse_state, REQ_RELKIND_COUNT, stats->relcount);
-
-	if (statstype >= STATS_TYPE_STORAGE)
-	{
-		const StorageStats *ss = (const StorageStats *) stats;
-		ts_jsonb_add_int64(parse_state, REQ_RELKIND_RELTUPLES, stats->reltuples);
-		ts_jsonb_add_int64(parse_state, REQ_RELKIND_HEAP_SIZE, ss->relsize.heap_size);
-		ts_jsonb_add_int64(parse_state, REQ_RELKIND_TOAST_SIZE, ss->relsize.toast_size);
-		ts_jsonb_add_int64(parse_state, REQ_RELKIND_INDEXES_SIZE, ss->relsize.index_size);
-	}
-
-	if (statstype >= STATS_TYPE_HYPER)
-	{
-		const HyperStats *hs = (const HyperStats *) stats;
-		ts_jsonb_add_int64(parse_state, REQ_RELKIND_CHILDREN, hs->child_count);
-
-		if (reltype != RELTYPE_PARTITIONED_TABLE)
-			add_compression_stats_object(parse_state, reltype, hs);
-	}
-
-	if (statstype == STATS_TYPE_CAGG)
-	{
-		const CaggStats *cs = (const CaggStats *) stats;
-
-		ts_jsonb_add_int64(parse_state,
-						   REQ_RELKIND_CAGG_USES_REAL_TIME_AGGREGATION_COUNT,
-						   cs->uses_real_time_aggregation_count);
-		ts_jsonb_add_int64(parse_state, REQ_RELKIND_CAGG_FINALIZED, cs->finalized);
-		ts_jsonb_add_int64(parse_state, REQ_RELKIND_CAGG_NESTED, cs->nested);
-	}
-
-	return pushJsonbValue(&parse_state, WJB_END_OBJECT, NULL);
-}
-
 static void
 add_function_call_telemetry(JsonbParseState *state)
 {
@@ -758,12 +641,6 @@ add_replication_telemetry(JsonbParseState *state)
 }
 
 #define REQ_RELS "relations"
-#define REQ_RELS_TABLES "tables"
-#define REQ_RELS_PARTITIONED_TABLES "partitioned_tables"
-#define REQ_RELS_MATVIEWS "materialized_views"
-#define REQ_RELS_VIEWS "views"
-#define REQ_RELS_HYPERTABLES "hypertables"
-#define REQ_RELS_CONTINUOUS_AGGS "continuous_aggregates"
 #define REQ_FUNCTIONS_USED "functions_used"
 #define REQ_REPLICATION "replication"
 #define REQ_ACCESS_METHODS "access_methods"
@@ -921,41 +798,7 @@ build_telemetry_report()
 	key.val.string.val = REQ_RELS;
 	key.val.string.len = strlen(REQ_RELS);
 	pushJsonbValue(&parse_state, WJB_KEY, &key);
-	pushJsonbValue(&parse_state, WJB_BEGIN_OBJECT, NULL);
-
-	add_relkind_stats_object(parse_state,
-							 REQ_RELS_TABLES,
-							 &relstats.tables.base,
-							 RELTYPE_TABLE,
-							 STATS_TYPE_STORAGE);
-	add_relkind_stats_object(parse_state,
-							 REQ_RELS_PARTITIONED_TABLES,
-							 &relstats.partitioned_tables.storage.base,
-							 RELTYPE_PARTITIONED_TABLE,
-							 STATS_TYPE_HYPER);
-	add_relkind_stats_object(parse_state,
-							 REQ_RELS_MATVIEWS,
-							 &relstats.materialized_views.base,
-							 RELTYPE_MATVIEW,
-							 STATS_TYPE_STORAGE);
-	add_relkind_stats_object(parse_state,
-							 REQ_RELS_VIEWS,
-							 &relstats.views,
-							 RELTYPE_VIEW,
-							 STATS_TYPE_BASE);
-	add_relkind_stats_object(parse_state,
-							 REQ_RELS_HYPERTABLES,
-							 &relstats.hypertables.storage.base,
-							 RELTYPE_HYPERTABLE,
-							 STATS_TYPE_HYPER);
-
-	add_relkind_stats_object(parse_state,
-							 REQ_RELS_CONTINUOUS_AGGS,
-							 &relstats.continuous_aggs.hyp.storage.base,
-							 RELTYPE_CONTINUOUS_AGG,
-							 STATS_TYPE_CAGG);
-
-	pushJsonbValue(&parse_state, WJB_END_OBJECT, NULL);
+	ts_telemetry_stats_add_relations(parse_state, &relstats);
 
 	add_job_counts(parse_state);
 
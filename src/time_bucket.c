@@ -6,10 +6,12 @@
 #include <postgres.h>
 #include <catalog/pg_type.h>
 #include <fmgr.h>
+#include <pgtime.h>
 #include <utils/builtins.h>
 #include <utils/date.h>
 #include <utils/datetime.h>
 #include <utils/fmgrprotos.h>
+#include <utils/memutils.h>
 #include <utils/timestamp.h>
 
 #include "time_bucket.h"
@@ -134,6 +136,63 @@ ts_int64_bucket(PG_FUNCTION_ARGS)
 		(result) += (shift);                                                                       \
 	} while (0)
 
+TSDLLEXPORT void
+ts_time_bucket_out_of_range(void)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE), errmsg("timestamp out of range")));
+	pg_unreachable();
+}
+
+/*
+ * The shift of the buckets by the origin for ts_time_bucket_fixed(). The
+ * period and origin of a call site rarely change between the rows, so the
+ * division is cached in fn_extra.
+ */
+typedef struct TimeBucketShiftCache
+{
+	int64 period;
+	int64 origin;
+	int64 shift;
+} TimeBucketShiftCache;
+
+static int64
+time_bucket_fixed_shift(FunctionCallInfo fcinfo, int64 period, int64 origin)
+{
+	TimeBucketShiftCache *cache = NULL;
+
+	if (period <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("period must be greater than 0")));
+
+	/* There is no FmgrInfo when called through DirectFunctionCall */
+	if (fcinfo->flinfo != NULL)
+	{
+		cache = fcinfo->flinfo->fn_extra;
+		if (cache != NULL && cache->period == period && cache->origin == origin)
+			return cache->shift;
+
+		if (cache == NULL)
+		{
+			cache = MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, sizeof(TimeBucketShiftCache));
+			fcinfo->flinfo->fn_extra = cache;
+		}
+	}
+
+	/* Same as TMODULO in TIME_BUCKET_TS */
+	int64 shift = origin % period;
+
+	if (cache != NULL)
+	{
+		cache->period = period;
+		cache->origin = origin;
+		cache->shift = shift;
+	}
+
+	return shift;
+}
+
 static void
 validate_month_bucket(Interval *interval)
 {
@@ -205,7 +264,6 @@ ts_timestamp_bucket(PG_FUNCTION_ARGS)
 	 * with 2 parameters
 	 */
 	Timestamp origin = (PG_NARGS() > 2 ? PG_GETARG_TIMESTAMP(2) : DEFAULT_ORIGIN);
-	Timestamp result;
 
 	if (TIMESTAMP_NOT_FINITE(timestamp))
 		PG_RETURN_TIMESTAMP(timestamp);
@@ -227,10 +285,9 @@ ts_timestamp_bucket(PG_FUNCTION_ARGS)
 	else
 	{
 		int64 period = get_interval_period_timestamp_units(interval);
+		int64 shift = time_bucket_fixed_shift(fcinfo, period, origin);
 
-		TIME_BUCKET_TS(period, timestamp, result, origin);
-
-		PG_RETURN_TIMESTAMP(result);
+		PG_RETURN_TIMESTAMP(ts_time_bucket_fixed(period, shift, timestamp));
 	}
 }
 
@@ -267,7 +324,6 @@ ts_timestamptz_bucket(PG_FUNCTION_ARGS)
 	 * with 2 parameters
 	 */
 	TimestampTz origin = (PG_NARGS() > 2 ? PG_GETARG_TIMESTAMPTZ(2) : DEFAULT_ORIGIN);
-	TimestampTz result;
 
 	if (TIMESTAMP_NOT_FINITE(timestamp))
 		PG_RETURN_TIMESTAMPTZ(timestamp);
@@ -289,10 +345,9 @@ ts_timestamptz_bucket(PG_FUNCTION_ARGS)
 	else
 	{
 		int64 period = get_interval_period_timestamp_units(interval);
+		int64 shift = time_bucket_fixed_shift(fcinfo, period, origin);
 
-		TIME_BUCKET_TS(period, timestamp, result, origin);
-
-		PG_RETURN_TIMESTAMPTZ(result);
+		PG_RETURN_TIMESTAMPTZ(ts_time_bucket_fixed(period, shift, timestamp));
 	}
 }
 
@@ -316,6 +371,376 @@ ts_timestamptz_offset_bucket(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(timestamp);
 }
 
+/*
+ * Cache of the UTC offsets of a timezone around the recently converted
+ * timestamps, so that the conversions between timestamptz and the local
+ * timestamp are an addition of the offset instead of a lookup of the
+ * timezone rules.
+ *
+ * The cache holds the consecutive segments of UTC time between the DST
+ * transitions in a window around the converted timestamp. Each segment has a
+ * fixed offset. The local range of a segment leaves out the local times that
+ * are ambiguous or don't exist because of the neighboring transitions, so
+ * that the conversion of a local time in the range has a unique result.
+ * Everything else, including the zones given as abbreviations or offsets
+ * that we can't look up as a pg_tz, goes through the usual conversion.
+ */
+#define TZ_CACHE_MAX_SEGMENTS 16
+
+/* Seconds of UTC time around the converted timestamp to cache */
+#define TZ_CACHE_WINDOW ((pg_time_t) 366 * SECS_PER_DAY)
+
+/*
+ * Upper bound on the change of the UTC offset at a transition, for the
+ * segments where we don't know the offset before the segment.
+ */
+#define TZ_CACHE_MAX_OFFSET_CHANGE USECS_PER_DAY
+
+typedef struct TimezoneOffsetSegment
+{
+	TimestampTz utc_start;
+	TimestampTz utc_end;
+	Timestamp local_start;
+	Timestamp local_end;
+	int64 offset; /* local = utc + offset */
+	bool validated;
+} TimezoneOffsetSegment;
+
+struct TimezoneOffsetCache
+{
+	text *tzname;
+	pg_tz *tz; /* NULL if the cache is disabled */
+	int nsegments;
+	int current;
+	TimezoneOffsetSegment segments[TZ_CACHE_MAX_SEGMENTS];
+};
+
+TSDLLEXPORT TimezoneOffsetCache *
+ts_timezone_offset_cache_create(const text *tzname, MemoryContext mcxt)
+{
+	TimezoneOffsetCache *cache = MemoryContextAllocZero(mcxt, sizeof(TimezoneOffsetCache));
+	char tzname_buf[TZ_STRLEN_MAX + 1];
+
+	cache->tzname = MemoryContextAlloc(mcxt, VARSIZE_ANY(tzname));
+	memcpy(cache->tzname, tzname, VARSIZE_ANY(tzname));
+
+	if (VARSIZE_ANY_EXHDR(tzname) <= TZ_STRLEN_MAX)
+	{
+		text_to_cstring_buffer(tzname, tzname_buf, sizeof(tzname_buf));
+		cache->tz = pg_tzset(tzname_buf);
+	}
+
+	return cache;
+}
+
+static bool
+timezone_offset_cache_matches(const TimezoneOffsetCache *cache, const text *tzname)
+{
+	return VARSIZE_ANY_EXHDR(cache->tzname) == VARSIZE_ANY_EXHDR(tzname) &&
+		   memcmp(VARDATA_ANY(cache->tzname), VARDATA_ANY(tzname), VARSIZE_ANY_EXHDR(tzname)) == 0;
+}
+
+/*
+ * Get the cache for the timezone from the call site of the function.
+ */
+static TimezoneOffsetCache *
+timezone_offset_cache_get(FunctionCallInfo fcinfo, Datum tzname)
+{
+	TimezoneOffsetCache *cache;
+
+	if (fcinfo->flinfo == NULL)
+		return NULL;
+
+	cache = fcinfo->flinfo->fn_extra;
+
+	if (cache == NULL || !timezone_offset_cache_matches(cache, DatumGetTextPP(tzname)))
+	{
+		cache = ts_timezone_offset_cache_create(DatumGetTextPP(tzname), fcinfo->flinfo->fn_mcxt);
+		fcinfo->flinfo->fn_extra = cache;
+	}
+
+	return cache;
+}
+
+/*
+ * Fill the cache with the segments around the given UTC time.
+ */
+static pg_noinline bool
+timezone_offset_cache_fill(TimezoneOffsetCache *cache, TimestampTz ts)
+{
+	long before_gmtoff, after_gmtoff;
+	int before_isdst, after_isdst;
+	pg_time_t boundary;
+	int64 prev_offset = 0;
+	bool start_known = false;
+
+	if (cache->tz == NULL || !IS_VALID_TIMESTAMP(ts))
+		return false;
+
+	const pg_time_t t = timestamptz_to_time_t(ts);
+	pg_time_t probe = t - TZ_CACHE_WINDOW;
+
+	cache->nsegments = 0;
+	cache->current = 0;
+
+	while (cache->nsegments < TZ_CACHE_MAX_SEGMENTS)
+	{
+		TimezoneOffsetSegment *seg = &cache->segments[cache->nsegments];
+		int found = pg_next_dst_boundary(&probe,
+										 &before_gmtoff,
+										 &before_isdst,
+										 &boundary,
+										 &after_gmtoff,
+										 &after_isdst,
+										 cache->tz);
+
+		if (found < 0)
+		{
+			cache->nsegments = 0;
+			return false;
+		}
+
+		seg->offset = (int64) before_gmtoff * USECS_PER_SEC;
+		seg->utc_start = time_t_to_timestamptz(probe);
+		if (start_known)
+			seg->local_start = seg->utc_start + Max(seg->offset, prev_offset);
+		else
+			seg->local_start = seg->utc_start + seg->offset + TZ_CACHE_MAX_OFFSET_CHANGE;
+		seg->validated = false;
+		cache->nsegments++;
+
+		if (found == 0)
+		{
+			seg->utc_end = END_TIMESTAMP;
+			seg->local_end = END_TIMESTAMP;
+		}
+		else
+		{
+			seg->utc_end = time_t_to_timestamptz(boundary);
+			seg->local_end =
+				seg->utc_end + Min(seg->offset, (int64) after_gmtoff * USECS_PER_SEC);
+		}
+
+		/* Leave the conversions out of the valid range to the usual code */
+		seg->utc_start = Max(seg->utc_start, MIN_TIMESTAMP - Min(seg->offset, 0));
+		seg->utc_end = Min(seg->utc_end, END_TIMESTAMP - Max(seg->offset, 0));
+		seg->local_start = Max(seg->local_start, MIN_TIMESTAMP + Max(seg->offset, 0));
+		seg->local_end = Min(seg->local_end, END_TIMESTAMP + Min(seg->offset, 0));
+
+		if (found == 0 || boundary > t + TZ_CACHE_WINDOW)
+			break;
+
+		prev_offset = seg->offset;
+		probe = boundary;
+		start_known = true;
+	}
+
+	return true;
+}
+
+/*
+ * Check the offset of a segment against the usual conversion the first time
+ * it is used, to make sure that the name means the same zone for us and for
+ * timestamptz_zone(), which also accepts timezone abbreviations. Disables the
+ * cache if it doesn't.
+ */
+static pg_noinline bool
+timezone_offset_cache_validate(TimezoneOffsetCache *cache, TimezoneOffsetSegment *seg,
+							   TimestampTz ts)
+{
+	Timestamp local;
+
+	if (!IS_VALID_TIMESTAMP(ts))
+		return false;
+
+	local = DatumGetTimestamp(DirectFunctionCall2(timestamptz_zone,
+												  PointerGetDatum(cache->tzname),
+												  TimestampTzGetDatum(ts)));
+
+	if (local != ts + seg->offset)
+	{
+		cache->tz = NULL;
+		cache->nsegments = 0;
+		return false;
+	}
+
+	seg->validated = true;
+	return true;
+}
+
+static TimezoneOffsetSegment *
+timezone_offset_cache_find_utc(TimezoneOffsetCache *cache, TimestampTz ts)
+{
+	for (int i = 0; i < cache->nsegments; i++)
+	{
+		TimezoneOffsetSegment *seg = &cache->segments[i];
+
+		if (ts >= seg->utc_start && ts < seg->utc_end)
+		{
+			cache->current = i;
+			return seg;
+		}
+	}
+
+	return NULL;
+}
+
+static TimezoneOffsetSegment *
+timezone_offset_cache_find_local(TimezoneOffsetCache *cache, Timestamp local)
+{
+	for (int i = 0; i < cache->nsegments; i++)
+	{
+		TimezoneOffsetSegment *seg = &cache->segments[i];
+
+		if (local >= seg->local_start && local < seg->local_end)
+		{
+			cache->current = i;
+			return seg;
+		}
+	}
+
+	return NULL;
+}
+
+static pg_noinline Timestamp
+timezone_offset_cache_to_local_slow(TimezoneOffsetCache *cache, TimestampTz ts)
+{
+	TimezoneOffsetSegment *seg = NULL;
+
+	if (cache->tz != NULL && !TIMESTAMP_NOT_FINITE(ts))
+	{
+		seg = timezone_offset_cache_find_utc(cache, ts);
+
+		if (seg == NULL && timezone_offset_cache_fill(cache, ts))
+			seg = timezone_offset_cache_find_utc(cache, ts);
+
+		if (seg != NULL && (seg->validated || timezone_offset_cache_validate(cache, seg, ts)))
+			return ts + seg->offset;
+	}
+
+	return DatumGetTimestamp(DirectFunctionCall2(timestamptz_zone,
+												 PointerGetDatum(cache->tzname),
+												 TimestampTzGetDatum(ts)));
+}
+
+static pg_noinline TimestampTz
+timezone_offset_cache_to_utc_slow(TimezoneOffsetCache *cache, Timestamp local)
+{
+	TimezoneOffsetSegment *seg = NULL;
+
+	if (cache->tz != NULL && !TIMESTAMP_NOT_FINITE(local))
+	{
+		seg = timezone_offset_cache_find_local(cache, local);
+
+		/* The offset of any segment is a good enough guess for the window */
+		if (seg == NULL &&
+			timezone_offset_cache_fill(cache,
+									   local - (cache->nsegments > 0 ?
+													cache->segments[cache->current].offset :
+													0)))
+			seg = timezone_offset_cache_find_local(cache, local);
+
+		if (seg != NULL &&
+			(seg->validated || timezone_offset_cache_validate(cache, seg, local - seg->offset)))
+			return local - seg->offset;
+	}
+
+	return DatumGetTimestampTz(DirectFunctionCall2(timestamp_zone,
+												   PointerGetDatum(cache->tzname),
+												   TimestampGetDatum(local)));
+}
+
+/*
+ * Convert the timestamptz to the local timestamp in the timezone, same as
+ * timestamptz_zone().
+ */
+static inline Timestamp
+timezone_offset_cache_to_local(TimezoneOffsetCache *cache, TimestampTz ts)
+{
+	const TimezoneOffsetSegment *seg = &cache->segments[cache->current];
+
+	if (likely(cache->nsegments > 0 && seg->validated && ts >= seg->utc_start &&
+			   ts < seg->utc_end))
+		return ts + seg->offset;
+
+	return timezone_offset_cache_to_local_slow(cache, ts);
+}
+
+/*
+ * Convert the local timestamp in the timezone to timestamptz, same as
+ * timestamp_zone().
+ */
+static inline TimestampTz
+timezone_offset_cache_to_utc(TimezoneOffsetCache *cache, Timestamp local)
+{
+	const TimezoneOffsetSegment *seg = &cache->segments[cache->current];
+
+	if (likely(cache->nsegments > 0 && seg->validated && local >= seg->local_start &&
+			   local < seg->local_end))
+		return local - seg->offset;
+
+	return timezone_offset_cache_to_utc_slow(cache, local);
+}
+
+/*
+ * Bucket the timestamptz by a fixed-width period in the timezone, with the
+ * origin given as a local timestamp.
+ */
+static inline TimestampTz
+timezone_bucket_fixed(TimezoneOffsetCache *cache, int64 period, Timestamp origin,
+					  TimestampTz timestamp, const Interval *offset)
+{
+	Timestamp local;
+	Timestamp result;
+
+	if (TIMESTAMP_NOT_FINITE(timestamp))
+		return timestamp;
+
+	local = timezone_offset_cache_to_local(cache, timestamp);
+
+	if (offset != NULL)
+		local = DatumGetTimestamp(DirectFunctionCall2(timestamp_mi_interval,
+													  TimestampGetDatum(local),
+													  IntervalPGetDatum(offset)));
+
+	TIME_BUCKET_TS(period, local, result, origin);
+
+	if (offset != NULL)
+		result = DatumGetTimestamp(DirectFunctionCall2(timestamp_pl_interval,
+													   TimestampGetDatum(result),
+													   IntervalPGetDatum(offset)));
+
+	return timezone_offset_cache_to_utc(cache, result);
+}
+
+/*
+ * Vectorized time_bucket() by a fixed-width period in a timezone, with the
+ * default origin, for the rows that pass the filter. The results of the other
+ * rows are zeroed. The stride is 0 for a scalar argument and 1 for a vector
+ * one. The shift is the default origin modulo the period.
+ */
+TSDLLEXPORT void
+ts_timestamptz_timezone_bucket_vector(TimezoneOffsetCache *cache, int64 period, int64 shift,
+									  const int64 *values, int stride, const uint64 *filter,
+									  int n, int64 *result)
+{
+	if (period <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("period must be greater than 0")));
+
+	for (int row = 0; row < n; row++)
+	{
+		if (filter != NULL && !(filter[row / 64] & (UINT64CONST(1) << (row % 64))))
+		{
+			result[row] = 0;
+			continue;
+		}
+
+		result[row] = timezone_bucket_fixed(cache, period, shift, values[row * stride], NULL);
+	}
+}
+
 TS_FUNCTION_INFO_V1(ts_timestamptz_timezone_bucket);
 
 /*
@@ -344,6 +769,29 @@ ts_timestamptz_timezone_bucket(PG_FUNCTION_ARGS)
 	if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(2))
 		PG_RETURN_NULL();
 
+	/*
+	 * Fixed-width buckets use the cached offsets of the timezone, so that the
+	 * bucketing is integer arithmetic between the DST transitions.
+	 */
+	Interval *interval = DatumGetIntervalP(period);
+	TimezoneOffsetCache *cache =
+		interval->month == 0 ? timezone_offset_cache_get(fcinfo, tzname) : NULL;
+
+	if (cache != NULL)
+	{
+		int64 period_usecs = get_interval_period_timestamp_units(interval);
+		Timestamp origin = DEFAULT_ORIGIN;
+
+		if (have_origin)
+			origin = timezone_offset_cache_to_local(cache, PG_GETARG_TIMESTAMPTZ(3));
+
+		PG_RETURN_TIMESTAMPTZ(timezone_bucket_fixed(cache,
+													period_usecs,
+													origin,
+													DatumGetTimestampTz(timestamp),
+													have_offset ? PG_GETARG_INTERVAL_P(4) : NULL));
+	}
+
 	/* Convert to local timestamp according to timezone */
 	timestamp = DirectFunctionCall2(timestamptz_zone, tzname, timestamp);
 	if (have_offset)
@@ -722,12 +1170,17 @@ ts_time_bucket_ng_timezone(PG_FUNCTION_ARGS)
 	Datum interval = PG_GETARG_DATUM(0);
 	Datum timestamptz = PG_GETARG_DATUM(1);
 	Datum tzname = PG_GETARG_DATUM(2);
+	TimezoneOffsetCache *cache = timezone_offset_cache_get(fcinfo, tzname);
 
 	/*
 	 * Convert 'timestamptz' to TIMESTAMP at given 'tzname'.
 	 * The code is equal to 'timestamptz AT TIME ZONE tzname'.
 	 */
-	timestamp = DirectFunctionCall2(timestamptz_zone, tzname, timestamptz);
+	if (cache != NULL)
+		timestamp = TimestampGetDatum(
+			timezone_offset_cache_to_local(cache, DatumGetTimestampTz(timestamptz)));
+	else
+		timestamp = DirectFunctionCall2(timestamptz_zone, tzname, timestamptz);
 
 	/* Then treat resulting timestamp as a regular one */
 	result =
@@ -735,6 +1188,9 @@ ts_time_bucket_ng_timezone(PG_FUNCTION_ARGS)
 	if (TIMESTAMP_NOT_FINITE(result))
 		PG_RETURN_TIMESTAMP(result);
 
+	if (cache != NULL)
+		PG_RETURN_TIMESTAMPTZ(timezone_offset_cache_to_utc(cache, result));
+
 	PG_RETURN_DATUM(DirectFunctionCall2(timestamp_zone, tzname, TimestampGetDatum(result)));
 }
 
@@ -748,15 +1204,24 @@ ts_time_bucket_ng_timezone_origin(PG_FUNCTION_ARGS)
 	Datum timestamptz = PG_GETARG_DATUM(1);
 	Datum origintz = PG_GETARG_DATUM(2);
 	Datum tzname = PG_GETARG_DATUM(3);
+	TimezoneOffsetCache *cache = timezone_offset_cache_get(fcinfo, tzname);
 
 	/*
 	 * Convert 'origin' to TIMESTAMP at given 'tzname'.
 	 * The code is equal to 'origin AT TIME ZONE tzname'.
 	 */
-	origin = DirectFunctionCall2(timestamptz_zone, tzname, origintz);
+	if (cache != NULL)
+		origin = TimestampGetDatum(
+			timezone_offset_cache_to_local(cache, DatumGetTimestampTz(origintz)));
+	else
+		origin = DirectFunctionCall2(timestamptz_zone, tzname, origintz);
 
 	/* Same for 'timestamptz' */
-	timestamp = DirectFunctionCall2(timestamptz_zone, tzname, timestamptz);
+	if (cache != NULL)
+		timestamp = TimestampGetDatum(
+			timezone_offset_cache_to_local(cache, DatumGetTimestampTz(timestamptz)));
+	else
+		timestamp = DirectFunctionCall2(timestamptz_zone, tzname, timestamptz);
 
 	/* Then treat resulting 'timestamp' and 'origin' as a regular ones */
 	result = DatumGetTimestamp(
@@ -764,5 +1229,8 @@ ts_time_bucket_ng_timezone_origin(PG_FUNCTION_ARGS)
 	if (TIMESTAMP_NOT_FINITE(result))
 		PG_RETURN_TIMESTAMP(result);
 
+	if (cache != NULL)
+		PG_RETURN_TIMESTAMPTZ(timezone_offset_cache_to_utc(cache, result));
+
 	PG_RETURN_DATUM(DirectFunctionCall2(timestamp_zone, tzname, TimestampGetDatum(result)));
 }
@@ -7,6 +7,7 @@
 
 #include <postgres.h>
 #include <fmgr.h>
+#include <utils/timestamp.h>
 
 #include "export.h"
 
@@ -14,6 +15,9 @@
 #define TIME_BUCKET_NG_DEFAULT_ORIGIN_TIMESTAMP "2000-01-01 00:00:00"
 #define TIME_BUCKET_NG_DEFAULT_ORIGIN_DATE "2000-01-01"
 
+/* Cache of the UTC offsets of a timezone, see time_bucket.c */
+typedef struct TimezoneOffsetCache TimezoneOffsetCache;
+
 extern TSDLLEXPORT Datum ts_int16_bucket(PG_FUNCTION_ARGS);
 extern TSDLLEXPORT Datum ts_int32_bucket(PG_FUNCTION_ARGS);
 extern TSDLLEXPORT Datum ts_int64_bucket(PG_FUNCTION_ARGS);
@@ -30,3 +34,45 @@ extern TSDLLEXPORT Datum ts_time_bucket_ng_timestamp(PG_FUNCTION_ARGS);
 extern TSDLLEXPORT Datum ts_time_bucket_ng_timestamptz(PG_FUNCTION_ARGS);
 extern TSDLLEXPORT Datum ts_time_bucket_ng_timezone(PG_FUNCTION_ARGS);
 extern TSDLLEXPORT Datum ts_time_bucket_ng_timezone_origin(PG_FUNCTION_ARGS);
+extern TSDLLEXPORT TimezoneOffsetCache *ts_timezone_offset_cache_create(const text *tzname,
+																	  MemoryContext mcxt);
+extern TSDLLEXPORT void ts_time_bucket_out_of_range(void) pg_attribute_noreturn();
+extern TSDLLEXPORT void ts_timestamptz_timezone_bucket_vector(TimezoneOffsetCache *cache,
+															  int64 period, int64 shift,
+															  const int64 *values, int stride,
+															  const uint64 *filter, int n,
+															  int64 *result);
+
+/*
+ * Bucket a timestamp by a fixed-width period, like TIME_BUCKET_TS in
+ * time_bucket.c, but with the shift of the buckets by the origin already
+ * reduced modulo the period. The period must be positive. This is the kernel
+ * of time_bucket() that is shared by the scalar functions and the vectorized
+ * evaluation, so the per-row work is one division and the range check.
+ */
+static inline int64
+ts_time_bucket_fixed(int64 period, int64 shift, int64 timestamp)
+{
+	int64 result;
+
+	Assert(period > 0 && shift > -period && shift < period);
+
+	if (unlikely(TIMESTAMP_NOT_FINITE(timestamp)))
+		return timestamp;
+
+	if (unlikely((shift > 0 && timestamp < DT_NOBEGIN + shift) ||
+				 (shift < 0 && timestamp > DT_NOEND + shift)))
+		ts_time_bucket_out_of_range();
+
+	timestamp -= shift;
+
+	/*
+	 * Division truncates toward zero, so subtract another period for the
+	 * negative timestamps that are not on a bucket boundary.
+	 */
+	result = (timestamp / period) * period;
+	if (timestamp - result < 0)
+		result -= period;
+
+	return result + shift;
+}
@@ -0,0 +1,87 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include "config.h"
+
+/*
+ * The static trace points, like the ones of PostgreSQL in utils/probes.h. The
+ * header with the trace points is generated from probes.d when PostgreSQL is
+ * built with --enable-dtrace, otherwise the trace points compile to nothing.
+ */
+#ifdef TS_USE_DTRACE
+
+#include "probes.h"
+
+#else
+
+#define TIMESCALEDB_CHUNK_DISPATCH_ROUTE(INT1, INT2) \
+	do                                               \
+	{                                                \
+	} while (0)
+#define TIMESCALEDB_CHUNK_DISPATCH_ROUTE_ENABLED() (0)
+#define TIMESCALEDB_CHUNK_DISPATCH_CREATE_START(INT1) \
+	do                                                \
+	{                                                 \
+	} while (0)
+#define TIMESCALEDB_CHUNK_DISPATCH_CREATE_START_ENABLED() (0)
+#define TIMESCALEDB_CHUNK_DISPATCH_CREATE_DONE(INT1, INT2, INT3) \
+	do                                                           \
+	{                                                            \
+	} while (0)
+#define TIMESCALEDB_CHUNK_DISPATCH_CREATE_DONE_ENABLED() (0)
+#define TIMESCALEDB_COPY_FLUSH_START(INT1, INT2) \
+	do                                           \
+	{                                            \
+	} while (0)
+#define TIMESCALEDB_COPY_FLUSH_START_ENABLED() (0)
+#define TIMESCALEDB_COPY_FLUSH_DONE(INT1, INT2) \
+	do                                          \
+	{                                           \
+	} while (0)
+#define TIMESCALEDB_COPY_FLUSH_DONE_ENABLED() (0)
+#define TIMESCALEDB_COMPRESS_FLUSH_START(INT1) \
+	do                                         \
+	{                                          \
+	} while (0)
+#define TIMESCALEDB_COMPRESS_FLUSH_START_ENABLED() (0)
+#define TIMESCALEDB_COMPRESS_FLUSH_DONE(INT1) \
+	do                                        \
+	{                                         \
+	} while (0)
+#define TIMESCALEDB_COMPRESS_FLUSH_DONE_ENABLED() (0)
+#define TIMESCALEDB_DECOMPRESS_BATCH_START() \
+	do                                       \
+	{                                        \
+	} while (0)
+#define TIMESCALEDB_DECOMPRESS_BATCH_START_ENABLED() (0)
+#define TIMESCALEDB_DECOMPRESS_BATCH_DONE(INT1, INT2) \
+	do                                                \
+	{                                                 \
+	} while (0)
+#define TIMESCALEDB_DECOMPRESS_BATCH_DONE_ENABLED() (0)
+#define TIMESCALEDB_CAGG_MATERIALIZE_START(INT1, INT2, INT3) \
+	do                                                       \
+	{                                                        \
+	} while (0)
+#define TIMESCALEDB_CAGG_MATERIALIZE_START_ENABLED() (0)
+#define TIMESCALEDB_CAGG_MATERIALIZE_DONE(INT1, INT2) \
+	do                                                \
+	{                                                 \
+	} while (0)
+#define TIMESCALEDB_CAGG_MATERIALIZE_DONE_ENABLED() (0)
+#define TIMESCALEDB_BGW_JOB_START(INT1) \
+	do                                  \
+	{                                   \
+	} while (0)
+#define TIMESCALEDB_BGW_JOB_START_ENABLED() (0)
+#define TIMESCALEDB_BGW_JOB_DONE(INT1, INT2) \
+	do                                       \
+	{                                        \
+	} while (0)
+#define TIMESCALEDB_BGW_JOB_DONE_ENABLED() (0)
+
+#endif /* TS_USE_DTRACE */
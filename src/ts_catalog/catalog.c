@@ -4,6 +4,7 @@
  * LICENSE-APACHE for a copy of the license.
  */
 #include <postgres.h>
+#include <access/heapam.h>
 #include <access/htup_details.h>
 #include <access/xact.h>
 #include <catalog/indexing.h>
@@ -16,12 +17,18 @@
 #include <utils/inval.h>
 #include <utils/lsyscache.h>
 #include <utils/regproc.h>
+#include <utils/snapmgr.h>
 #include <utils/syscache.h>
 
 #include "compat/compat.h"
+#include "annotations.h"
 #include "cache_invalidate.h"
+#include "chunk_cache.h"
+#include "dimension.h"
 #include "extension.h"
+#include "hypertable.h"
 #include "ts_catalog/catalog.h"
+#include "ts_catalog/catalog_snapshot.h"
 #include "utils.h"
 
 static const TableInfoDef catalog_table_names[_MAX_CATALOG_TABLES + 1] = {
@@ -157,6 +164,7 @@ static const TableIndexDef catalog_table_index_definitions[_MAX_CATALOG_TABLES]
 			[CHUNK_COMPRESSED_CHUNK_ID_INDEX] = "chunk_compressed_chunk_id_idx",
 			[CHUNK_OSM_CHUNK_INDEX] = "chunk_osm_chunk_idx",
 			[CHUNK_HYPERTABLE_ID_CREATION_TIME_INDEX] = "chunk_hypertable_id_creation_time_idx",
+			[CHUNK_HYPERTABLE_ID_STATUS_INDEX] = "chunk_hypertable_id_status_idx",
 		},
 	},
 	[CHUNK_CONSTRAINT] = {
@@ -618,6 +626,138 @@ ts_catalog_restore_user(CatalogSecurityContext *sec_ctx)
 	SetUserIdAndSecContext(sec_ctx->saved_uid, sec_ctx->saved_security_context);
 }
 
+static int32
+catalog_tuple_get_int32(Relation rel, HeapTuple tuple, AttrNumber attno)
+{
+	bool isnull;
+	Datum datum = heap_getattr(tuple, attno, RelationGetDescr(rel), &isnull);
+
+	return isnull ? 0 : DatumGetInt32(datum);
+}
+
+/*
+ * Get the relid of the hypertable that a changed catalog tuple belongs to,
+ * for the catalog tables that only affect the cached data of one hypertable.
+ * Returns InvalidOid if the tuple is not in such a table or the hypertable
+ * is not found, e.g., when it was already dropped.
+ */
+static Oid
+catalog_tuple_get_hypertable_relid(CatalogTable table, Relation rel, HeapTuple tuple)
+{
+	int32 hypertable_id = 0;
+
+	switch (table)
+	{
+		case HYPERTABLE:
+		{
+			bool isnull;
+			Datum schema = heap_getattr(tuple,
+										Anum_hypertable_schema_name,
+										RelationGetDescr(rel),
+										&isnull);
+			Datum table_name =
+				heap_getattr(tuple, Anum_hypertable_table_name, RelationGetDescr(rel), &isnull);
+
+			/* The hypertable row might not be visible to a scan yet */
+			return ts_get_relation_relid(NameStr(*DatumGetName(schema)),
+										 NameStr(*DatumGetName(table_name)),
+										 true);
+		}
+		case DIMENSION:
+			hypertable_id = catalog_tuple_get_int32(rel, tuple, Anum_dimension_hypertable_id);
+			break;
+		case CHUNK:
+			hypertable_id = catalog_tuple_get_int32(rel, tuple, Anum_chunk_hypertable_id);
+			break;
+		case CHUNK_COLUMN_STATS:
+			hypertable_id =
+				catalog_tuple_get_int32(rel, tuple, Anum_chunk_column_stats_hypertable_id);
+			break;
+		case CHUNK_CONSTRAINT:
+			hypertable_id = ts_chunk_get_hypertable_id_by_id(
+				catalog_tuple_get_int32(rel, tuple, Anum_chunk_constraint_chunk_id));
+			break;
+		case DIMENSION_SLICE:
+			hypertable_id = ts_dimension_get_hypertable_id(
+				catalog_tuple_get_int32(rel, tuple, Anum_dimension_slice_dimension_id));
+			break;
+		default:
+			return InvalidOid;
+	}
+
+	if (hypertable_id <= 0)
+		return InvalidOid;
+
+	return ts_hypertable_id_to_relid(hypertable_id, true);
+}
+
+/*
+ * Invalidate the relcache of a relation referenced by a changed catalog
+ * tuple, if the relation still exists. Dropping a relation invalidates its
+ * relcache anyway.
+ */
+static void
+catalog_invalidate_relcache_by_oid_attr(Relation rel, HeapTuple tuple, AttrNumber attno)
+{
+	bool isnull;
+	Datum datum = heap_getattr(tuple, attno, RelationGetDescr(rel), &isnull);
+
+	if (!isnull && SearchSysCacheExists1(RELOID, datum))
+		CacheInvalidateRelcacheByRelid(DatumGetObjectId(datum));
+}
+
+/*
+ * Invalidate the caches for a changed catalog tuple.
+ *
+ * If the tuple belongs to a single hypertable, only the cached data of that
+ * hypertable is invalidated, through a relcache invalidation of the
+ * hypertable. Otherwise, this falls back to ts_catalog_invalidate_cache(),
+ * which invalidates the caches of all hypertables.
+ */
+static void
+catalog_invalidate_cache_for_tuple(Relation rel, HeapTuple tuple, CmdType operation)
+{
+	Catalog *catalog = ts_catalog_get();
+	CatalogTable table = catalog_get_table(catalog, RelationGetRelid(rel));
+	Oid hypertable_relid;
+
+	switch (table)
+	{
+		case CHUNK:
+		case CHUNK_CONSTRAINT:
+		case DIMENSION_SLICE:
+			/* These inserts don't invalidate the hypertable caches */
+			if (operation == CMD_INSERT)
+				break;
+			TS_FALLTHROUGH;
+		case HYPERTABLE:
+		case DIMENSION:
+		case CHUNK_COLUMN_STATS:
+			if (table == HYPERTABLE || table == DIMENSION)
+				ts_catalog_snapshot_changed();
+
+			hypertable_relid = catalog_tuple_get_hypertable_relid(table, rel, tuple);
+
+			if (OidIsValid(hypertable_relid))
+			{
+				CacheInvalidateRelcacheByRelid(hypertable_relid);
+				return;
+			}
+			break;
+		case COMPRESSION_SETTINGS:
+			/* The settings are cached by both the relid and the compressed relid */
+			catalog_invalidate_relcache_by_oid_attr(rel, tuple, Anum_compression_settings_relid);
+			catalog_invalidate_relcache_by_oid_attr(rel,
+													tuple,
+													Anum_compression_settings_compress_relid);
+			return;
+		default:
+			break;
+	}
+
+	ts_catalog_invalidate_cache(RelationGetRelid(rel), operation);
+}
+
 /*
  * Insert a new row into a catalog table.
  */
@@ -625,7 +765,7 @@ void
 ts_catalog_insert_only(Relation rel, HeapTuple tuple)
 {
 	CatalogTupleInsert(rel, tuple);
-	ts_catalog_invalidate_cache(RelationGetRelid(rel), CMD_INSERT);
+	catalog_invalidate_cache_for_tuple(rel, tuple, CMD_INSERT);
 }
 
 void
@@ -661,7 +801,7 @@ void
 ts_catalog_update_tid_only(Relation rel, ItemPointer tid, HeapTuple tuple)
 {
 	CatalogTupleUpdate(rel, tid, tuple);
-	ts_catalog_invalidate_cache(RelationGetRelid(rel), CMD_UPDATE);
+	catalog_invalidate_cache_for_tuple(rel, tuple, CMD_UPDATE);
 }
 
 void
@@ -681,8 +821,20 @@ ts_catalog_update(Relation rel, HeapTuple tuple)
 void
 ts_catalog_delete_tid_only(Relation rel, ItemPointer tid)
 {
+	HeapTupleData tuple = { .t_self = *tid };
+	Buffer buffer;
+
+	/* Read the deleted tuple to find the hypertable that it belongs to */
+	if (!heap_fetch(rel, SnapshotAny, &tuple, &buffer, false))
+	{
+		CatalogTupleDelete(rel, tid);
+		ts_catalog_invalidate_cache(RelationGetRelid(rel), CMD_DELETE);
+		return;
+	}
+
 	CatalogTupleDelete(rel, tid);
-	ts_catalog_invalidate_cache(RelationGetRelid(rel), CMD_DELETE);
+	catalog_invalidate_cache_for_tuple(rel, &tuple, CMD_DELETE);
+	ReleaseBuffer(buffer);
 }
 
 void
@@ -731,11 +883,24 @@ ts_catalog_invalidate_cache(Oid catalog_relid, CmdType operation)
 				relid = ts_catalog_get_cache_proxy_id(catalog, CACHE_TYPE_HYPERTABLE);
 				CacheInvalidateRelcacheByRelid(relid);
 			}
+			else if (table == CHUNK_CONSTRAINT)
+			{
+				/*
+				 * A new constraint might belong to a chunk that we cached.
+				 * Other backends can't see it before we commit, and the
+				 * constraints added to existing chunks also invalidate the
+				 * relcache of the chunk.
+				 */
+				ts_chunk_cache_invalidate(InvalidOid);
+			}
 			break;
 		case HYPERTABLE:
 		case DIMENSION:
+			ts_catalog_snapshot_changed();
+			TS_FALLTHROUGH;
 		case CONTINUOUS_AGG:
 		case CHUNK_COLUMN_STATS:
+		case COMPRESSION_SETTINGS:
 			relid = ts_catalog_get_cache_proxy_id(catalog, CACHE_TYPE_HYPERTABLE);
 			CacheInvalidateRelcacheByRelid(relid);
 			break;
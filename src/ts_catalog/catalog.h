@@ -401,6 +401,7 @@ enum
 	CHUNK_COMPRESSED_CHUNK_ID_INDEX,
 	CHUNK_OSM_CHUNK_INDEX,
 	CHUNK_HYPERTABLE_ID_CREATION_TIME_INDEX,
+	CHUNK_HYPERTABLE_ID_STATUS_INDEX,
 	_MAX_CHUNK_INDEX,
 };
 
@@ -437,6 +438,12 @@ enum Anum_chunk_hypertable_id_creation_time_idx
 	Anum_chunk_hypertable_id_creation_time_idx_creation_time,
 };
 
+enum Anum_chunk_hypertable_id_status_idx
+{
+	Anum_chunk_hypertable_id_status_idx_hypertable_id = 1,
+	Anum_chunk_hypertable_id_status_idx_status,
+};
+
 /************************************
  *
  * Chunk constraint table definitions
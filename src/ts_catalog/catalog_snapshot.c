@@ -0,0 +1,223 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+
+/*
+ * Shared snapshot of the hypertable and dimension catalogs.
+ *
+ * When timescaledb.catalog_snapshot_size is set, the loader allocates a
+ * shared hash table, and the backends add the hypertables that they read
+ * from the catalog to it. A backend that doesn't have a hypertable in its
+ * hypertable cache yet, e.g., a new backend, creates it from the snapshot
+ * instead of scanning the catalog.
+ *
+ * The snapshot is versioned by a shared catalog change counter. A backend
+ * that changes the hypertable or dimension catalog increments the counter
+ * when it commits, which makes all entries of the snapshot stale. The
+ * entries are stored with the counter that was read before reading the
+ * catalog, so an entry read while a concurrent change committed is stale as
+ * well. A transaction that changed the catalog doesn't use the snapshot,
+ * since it would not see its own changes.
+ */
+#include <postgres.h>
+#include <access/xact.h>
+#include <common/hashfn.h>
+#include <miscadmin.h>
+
+#include "config.h"
+#include "loader/catalog_snapshot.h"
+#include "ts_catalog/catalog.h"
+#include "ts_catalog/catalog_snapshot.h"
+
+StaticAssertDecl(sizeof(HypertableSnapshot) <= CATALOG_SNAPSHOT_DATA_SIZE,
+				 "hypertable snapshot does not fit into the catalog snapshot entry");
+
+static CatalogSnapshotRendezvous *catalog_snapshot = NULL;
+
+/*
+ * The layout of the entry data of this version of the extension. Different
+ * versions of the extension might use the snapshot of the same loader.
+ */
+static uint32 catalog_snapshot_layout = 0;
+
+/* The catalog was changed in the current transaction */
+static bool catalog_snapshot_changed_in_xact = false;
+
+uint64
+ts_catalog_snapshot_version(void)
+{
+	if (catalog_snapshot == NULL)
+		return 0;
+
+	return pg_atomic_read_u64(catalog_snapshot->version);
+}
+
+/*
+ * Create the hypertable from the snapshot, or return NULL if it is not in the
+ * snapshot or the snapshot is stale.
+ */
+Hypertable *
+ts_catalog_snapshot_get_hypertable(Oid relid, const char *schema, const char *table,
+								   MemoryContext mctx)
+{
+	CatalogSnapshotKey key = { .database_id = MyDatabaseId, .relid = relid };
+	CatalogSnapshotEntry *entry;
+	HypertableSnapshot snapshot;
+	bool found = false;
+
+	if (catalog_snapshot == NULL || catalog_snapshot_changed_in_xact)
+		return NULL;
+
+	LWLockAcquire(catalog_snapshot->lock, LW_SHARED);
+	entry = hash_search(catalog_snapshot->entries, &key, HASH_FIND, NULL);
+
+	if (entry != NULL && entry->layout == catalog_snapshot_layout &&
+		entry->version == pg_atomic_read_u64(catalog_snapshot->version))
+	{
+		memcpy(&snapshot, entry->data, sizeof(HypertableSnapshot));
+		found = true;
+	}
+
+	LWLockRelease(catalog_snapshot->lock);
+
+	if (!found)
+		return NULL;
+
+	/* The hypertable is looked up by its name in the catalog */
+	if (snapshot.catalog_relid != catalog_get_table_id(ts_catalog_get(), HYPERTABLE) ||
+		strncmp(NameStr(snapshot.fd.schema_name), schema, NAMEDATALEN) != 0 ||
+		strncmp(NameStr(snapshot.fd.table_name), table, NAMEDATALEN) != 0)
+		return NULL;
+
+	return ts_hypertable_from_snapshot(&snapshot, relid, mctx);
+}
+
+/*
+ * Remove the stale entries to make room for new entries. Needs an exclusive
+ * lock on the snapshot.
+ */
+static void
+catalog_snapshot_remove_stale(uint64 version)
+{
+	HASH_SEQ_STATUS status;
+	CatalogSnapshotEntry *entry;
+
+	hash_seq_init(&status, catalog_snapshot->entries);
+
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->version != version)
+			hash_search(catalog_snapshot->entries, &entry->key, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Add the hypertable read from the catalog to the snapshot, unless the
+ * catalog changed since the given version.
+ */
+void
+ts_catalog_snapshot_add_hypertable(Oid relid, const Hypertable *ht, uint64 version)
+{
+	CatalogSnapshotKey key = { .database_id = MyDatabaseId, .relid = relid };
+	CatalogSnapshotEntry *entry;
+	HypertableSnapshot snapshot = { 0 };
+
+	if (catalog_snapshot == NULL || catalog_snapshot_changed_in_xact ||
+		ht->space->num_dimensions > CATALOG_SNAPSHOT_MAX_DIMENSIONS)
+		return;
+
+	snapshot.catalog_relid = catalog_get_table_id(ts_catalog_get(), HYPERTABLE);
+	snapshot.fd = ht->fd;
+	snapshot.num_dimensions = ht->space->num_dimensions;
+
+	for (int i = 0; i < ht->space->num_dimensions; i++)
+	{
+		snapshot.dimensions[i].type = ht->space->dimensions[i].type;
+		snapshot.dimensions[i].fd = ht->space->dimensions[i].fd;
+	}
+
+	LWLockAcquire(catalog_snapshot->lock, LW_EXCLUSIVE);
+
+	if (version == pg_atomic_read_u64(catalog_snapshot->version))
+	{
+		entry = hash_search(catalog_snapshot->entries, &key, HASH_ENTER_NULL, NULL);
+
+		if (entry == NULL)
+		{
+			catalog_snapshot_remove_stale(version);
+			entry = hash_search(catalog_snapshot->entries, &key, HASH_ENTER_NULL, NULL);
+		}
+
+		/* The hypertable is not added if the snapshot is full */
+		if (entry != NULL)
+		{
+			entry->version = version;
+			entry->layout = catalog_snapshot_layout;
+			memcpy(entry->data, &snapshot, sizeof(HypertableSnapshot));
+		}
+	}
+
+	LWLockRelease(catalog_snapshot->lock);
+}
+
+/*
+ * Called when the hypertable or dimension catalog changes in the current
+ * transaction.
+ */
+void
+ts_catalog_snapshot_changed(void)
+{
+	if (catalog_snapshot != NULL)
+		catalog_snapshot_changed_in_xact = true;
+}
+
+static void
+catalog_snapshot_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+			/* The changes are visible to the other backends at this point */
+			if (catalog_snapshot_changed_in_xact)
+				pg_atomic_fetch_add_u64(catalog_snapshot->version, 1);
+			catalog_snapshot_changed_in_xact = false;
+			break;
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+		case XACT_EVENT_PREPARE:
+			/* A prepared transaction increments the counter on COMMIT PREPARED */
+			catalog_snapshot_changed_in_xact = false;
+			break;
+		default:
+			break;
+	}
+}
+
+void
+_catalog_snapshot_init(void)
+{
+	CatalogSnapshotRendezvous **rendezvous =
+		(CatalogSnapshotRendezvous **) find_rendezvous_variable(RENDEZVOUS_CATALOG_SNAPSHOT);
+
+	/* The snapshot is disabled, or the loader doesn't support it */
+	if (*rendezvous == NULL)
+		return;
+
+	catalog_snapshot = *rendezvous;
+	catalog_snapshot_layout =
+		hash_bytes((const unsigned char *) TIMESCALEDB_VERSION_MOD,
+				   strlen(TIMESCALEDB_VERSION_MOD)) ^
+		(uint32) sizeof(HypertableSnapshot);
+	RegisterXactCallback(catalog_snapshot_xact_callback, NULL);
+}
+
+void
+_catalog_snapshot_fini(void)
+{
+	if (catalog_snapshot != NULL)
+		UnregisterXactCallback(catalog_snapshot_xact_callback, NULL);
+	catalog_snapshot = NULL;
+}
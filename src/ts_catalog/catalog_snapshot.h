@@ -0,0 +1,43 @@
+/*
+ * This file and its contents are licensed under the Apache License 2.0.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-APACHE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include "dimension.h"
+#include "hypertable.h"
+
+/* Hypertables with more dimensions are not added to the snapshot */
+#define CATALOG_SNAPSHOT_MAX_DIMENSIONS 4
+
+typedef struct DimensionSnapshot
+{
+	DimensionType type;
+	FormData_dimension fd;
+} DimensionSnapshot;
+
+/*
+ * The data of a hypertable in the shared catalog snapshot. It only holds the
+ * catalog data, the data that refers to the local backend, e.g., the
+ * partitioning functions, is filled in when the hypertable is created from it.
+ */
+typedef struct HypertableSnapshot
+{
+	Oid catalog_relid; /* The hypertable catalog table, changes when the
+						* extension is recreated */
+	FormData_hypertable fd;
+	int16 num_dimensions;
+	DimensionSnapshot dimensions[CATALOG_SNAPSHOT_MAX_DIMENSIONS];
+} HypertableSnapshot;
+
+extern uint64 ts_catalog_snapshot_version(void);
+extern Hypertable *ts_catalog_snapshot_get_hypertable(Oid relid, const char *schema,
+													  const char *table, MemoryContext mctx);
+extern void ts_catalog_snapshot_add_hypertable(Oid relid, const Hypertable *ht, uint64 version);
+extern void ts_catalog_snapshot_changed(void);
+
+extern void _catalog_snapshot_init(void);
+extern void _catalog_snapshot_fini(void);
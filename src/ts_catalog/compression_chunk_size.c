@@ -43,3 +43,86 @@ ts_compression_chunk_size_delete(int32 uncompressed_chunk_id)
 
 	return count;
 }
+
+/*
+ * Get the number of rows of the compressed chunk before and after the
+ * compression. Returns false if the chunk has no compression statistics or
+ * the row counts are not known.
+ */
+TSDLLEXPORT bool
+ts_compression_chunk_size_get_row_counts(int32 uncompressed_chunk_id,
+										 int64 *numrows_pre_compression,
+										 int64 *numrows_post_compression)
+{
+	ScanIterator iterator =
+		ts_scan_iterator_create(COMPRESSION_CHUNK_SIZE, AccessShareLock, CurrentMemoryContext);
+	bool found = false;
+
+	init_scan_by_uncompressed_chunk_id(&iterator, uncompressed_chunk_id);
+	ts_scanner_foreach(&iterator)
+	{
+		TupleInfo *ti = ts_scan_iterator_tuple_info(&iterator);
+		bool pre_isnull;
+		bool post_isnull;
+		Datum pre = slot_getattr(ti->slot,
+								 Anum_compression_chunk_size_numrows_pre_compression,
+								 &pre_isnull);
+		Datum post = slot_getattr(ti->slot,
+								  Anum_compression_chunk_size_numrows_post_compression,
+								  &post_isnull);
+
+		if (!pre_isnull && !post_isnull)
+		{
+			*numrows_pre_compression = DatumGetInt64(pre);
+			*numrows_post_compression = DatumGetInt64(post);
+			found = true;
+		}
+		break;
+	}
+	ts_scan_iterator_close(&iterator);
+
+	return found;
+}
+
+/*
+ * Get the total size of a compressed chunk, including the toast and the
+ * indexes, before and after the compression. Returns false if the chunk has
+ * no compression statistics.
+ */
+TSDLLEXPORT bool
+ts_compression_chunk_size_get_sizes(int32 uncompressed_chunk_id, int64 *uncompressed_size,
+									int64 *compressed_size)
+{
+	ScanIterator iterator =
+		ts_scan_iterator_create(COMPRESSION_CHUNK_SIZE, AccessShareLock, CurrentMemoryContext);
+	bool found = false;
+
+	init_scan_by_uncompressed_chunk_id(&iterator, uncompressed_chunk_id);
+	ts_scanner_foreach(&iterator)
+	{
+		TupleInfo *ti = ts_scan_iterator_tuple_info(&iterator);
+		bool isnull;
+
+		*uncompressed_size = 0;
+		*compressed_size = 0;
+
+		for (AttrNumber attno = Anum_compression_chunk_size_uncompressed_heap_size;
+			 attno <= Anum_compression_chunk_size_compressed_index_size;
+			 attno++)
+		{
+			Datum value = slot_getattr(ti->slot, attno, &isnull);
+
+			Assert(!isnull);
+			if (attno < Anum_compression_chunk_size_compressed_heap_size)
+				*uncompressed_size += DatumGetInt64(value);
+			else
+				*compressed_size += DatumGetInt64(value);
+		}
+
+		found = true;
+		break;
+	}
+	ts_scan_iterator_close(&iterator);
+
+	return found;
+}
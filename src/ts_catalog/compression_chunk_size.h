@@ -9,3 +9,9 @@
 #include <postgres.h>
 
 extern TSDLLEXPORT int ts_compression_chunk_size_delete(int32 uncompressed_chunk_id);
+extern TSDLLEXPORT bool ts_compression_chunk_size_get_row_counts(int32 uncompressed_chunk_id,
+																 int64 *numrows_pre_compression,
+																 int64 *numrows_post_compression);
+extern TSDLLEXPORT bool ts_compression_chunk_size_get_sizes(int32 uncompressed_chunk_id,
+															int64 *uncompressed_size,
+															int64 *compressed_size);
@@ -6,6 +6,8 @@
 #include <postgres.h>
 #include <catalog/pg_inherits.h>
 #include <utils/builtins.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
 
 #include "scan_iterator.h"
 #include "scanner.h"
@@ -18,6 +20,266 @@ static ScanTupleResult compression_settings_tuple_update(TupleInfo *ti, void *da
 static HeapTuple compression_settings_formdata_make_tuple(const FormData_compression_settings *fd,
 														  TupleDesc desc);
 
+/*
+ * Backend-local cache of the compression settings, since they are read for
+ * every DML statement on a compressed chunk and when planning queries on
+ * compressed chunks.
+ *
+ * The entries are keyed by the relid of the settings, and a second table maps
+ * the compressed relids to the relids, so that a lookup by either relid is
+ * cached. Both tables also hold negative entries for relations without
+ * settings, with a NULL settings or an invalid relid.
+ *
+ * Changes to the settings invalidate the relcache of both the relid and the
+ * compressed relid. The invalidation of either removes the entry and its
+ * mapping, so an update that changes the compressed relid also removes the
+ * mapping of the old compressed relid.
+ */
+typedef struct CompressionSettingsCacheEntry
+{
+	Oid relid; /* Hash key */
+	CompressionSettings *settings;
+} CompressionSettingsCacheEntry;
+
+typedef struct CompressionSettingsCompressEntry
+{
+	Oid compress_relid; /* Hash key */
+	Oid relid;
+} CompressionSettingsCompressEntry;
+
+#define SETTINGS_CACHE_SIZE 4096
+
+static MemoryContext settings_cache_mcxt = NULL;
+static HTAB *settings_cache = NULL;
+static HTAB *settings_cache_by_compress_relid = NULL;
+
+/* Incremented on every invalidation, see ts_chunk_cache_add() */
+static uint64 settings_cache_generation = 0;
+
+static CacheUsage settings_cache_usage = {
+	.name = "compression_settings_cache",
+};
+
+static void
+settings_cache_create(void)
+{
+	HASHCTL ctl = {
+		.keysize = sizeof(Oid),
+		.entrysize = sizeof(CompressionSettingsCacheEntry),
+	};
+	HASHCTL compress_ctl = {
+		.keysize = sizeof(Oid),
+		.entrysize = sizeof(CompressionSettingsCompressEntry),
+	};
+
+	settings_cache_mcxt = AllocSetContextCreate(CacheMemoryContext,
+												"compression settings cache",
+												ALLOCSET_DEFAULT_SIZES);
+	ctl.hcxt = settings_cache_mcxt;
+	compress_ctl.hcxt = settings_cache_mcxt;
+	settings_cache = hash_create("compression settings cache",
+								 64,
+								 &ctl,
+								 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	settings_cache_by_compress_relid = hash_create("compression settings cache by compress relid",
+												   64,
+												   &compress_ctl,
+												   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+static void
+settings_cache_reset(void)
+{
+	MemoryContextDelete(settings_cache_mcxt);
+	settings_cache_mcxt = NULL;
+	settings_cache = NULL;
+	settings_cache_by_compress_relid = NULL;
+}
+
+static CompressionSettings *
+compression_settings_copy(const CompressionSettings *src)
+{
+	CompressionSettings *dst = palloc(sizeof(CompressionSettings));
+	FormData_compression_settings *fd = &dst->fd;
+
+	*dst = *src;
+
+	if (fd->segmentby)
+		fd->segmentby = DatumGetArrayTypePCopy(PointerGetDatum(fd->segmentby));
+	if (fd->orderby)
+		fd->orderby = DatumGetArrayTypePCopy(PointerGetDatum(fd->orderby));
+	if (fd->orderby_desc)
+		fd->orderby_desc = DatumGetArrayTypePCopy(PointerGetDatum(fd->orderby_desc));
+	if (fd->orderby_nullsfirst)
+		fd->orderby_nullsfirst = DatumGetArrayTypePCopy(PointerGetDatum(fd->orderby_nullsfirst));
+
+	return dst;
+}
+
+static void
+settings_cache_remove(Oid relid)
+{
+	CompressionSettingsCacheEntry *entry = hash_search(settings_cache, &relid, HASH_FIND, NULL);
+
+	if (entry == NULL)
+		return;
+
+	if (entry->settings != NULL && OidIsValid(entry->settings->fd.compress_relid))
+		hash_search(settings_cache_by_compress_relid,
+					&entry->settings->fd.compress_relid,
+					HASH_REMOVE,
+					NULL);
+
+	/* The settings are freed with the cache memory context */
+	hash_search(settings_cache, &relid, HASH_REMOVE, NULL);
+	settings_cache_usage.invalidations++;
+}
+
+/*
+ * Invalidate the cached settings of the relation, which is either the relid
+ * or the compressed relid of the settings, or all settings if the relid is
+ * invalid.
+ *
+ * Called from the relcache invalidation callback, so this must not access
+ * the catalogs.
+ */
+void
+ts_compression_settings_invalidate(Oid relid)
+{
+	CompressionSettingsCompressEntry *compress_entry;
+
+	settings_cache_generation++;
+
+	if (settings_cache == NULL)
+		return;
+
+	if (!OidIsValid(relid))
+	{
+		settings_cache_usage.invalidations += hash_get_num_entries(settings_cache);
+		settings_cache_reset();
+		return;
+	}
+
+	settings_cache_remove(relid);
+
+	compress_entry = hash_search(settings_cache_by_compress_relid, &relid, HASH_FIND, NULL);
+
+	if (compress_entry != NULL)
+	{
+		Oid settings_relid = compress_entry->relid;
+
+		hash_search(settings_cache_by_compress_relid, &relid, HASH_REMOVE, NULL);
+
+		if (OidIsValid(settings_relid))
+			settings_cache_remove(settings_relid);
+	}
+}
+
+/*
+ * Add the settings read from the catalog for the lookup relid, unless the
+ * cache was invalidated since the given generation.
+ */
+static void
+settings_cache_add(Oid lookup_relid, bool by_compress_relid, const CompressionSettings *settings,
+				   uint64 generation)
+{
+	CompressionSettingsCacheEntry *entry;
+	bool found;
+
+	if (generation != settings_cache_generation)
+		return;
+
+	/* Start over when the cache is full, the entries are cheap to re-read */
+	if (settings_cache != NULL && hash_get_num_entries(settings_cache) >= SETTINGS_CACHE_SIZE)
+	{
+		settings_cache_usage.evictions += hash_get_num_entries(settings_cache);
+		settings_cache_reset();
+	}
+
+	if (settings_cache == NULL)
+		settings_cache_create();
+
+	if (settings != NULL || !by_compress_relid)
+	{
+		Oid relid = settings != NULL ? settings->fd.relid : lookup_relid;
+
+		settings_cache_remove(relid);
+		entry = hash_search(settings_cache, &relid, HASH_ENTER, &found);
+		Assert(!found);
+		entry->settings = NULL;
+
+		if (settings != NULL)
+		{
+			MemoryContext old = MemoryContextSwitchTo(settings_cache_mcxt);
+			entry->settings = compression_settings_copy(settings);
+			MemoryContextSwitchTo(old);
+		}
+	}
+
+	if (settings != NULL && OidIsValid(settings->fd.compress_relid))
+	{
+		CompressionSettingsCompressEntry *compress_entry =
+			hash_search(settings_cache_by_compress_relid,
+						&settings->fd.compress_relid,
+						HASH_ENTER,
+						NULL);
+		compress_entry->relid = settings->fd.relid;
+	}
+	else if (by_compress_relid)
+	{
+		CompressionSettingsCompressEntry *compress_entry =
+			hash_search(settings_cache_by_compress_relid, &lookup_relid, HASH_ENTER, NULL);
+		compress_entry->relid = InvalidOid;
+	}
+}
+
+/*
+ * Find the cached settings of the relid. Returns true if the relid is cached,
+ * with a copy of the settings, or NULL if the relation has no settings.
+ */
+static bool
+settings_cache_get(Oid relid, bool by_compress_relid, CompressionSettings **settings)
+{
+	CompressionSettingsCacheEntry *entry;
+
+	if (settings_cache == NULL)
+		return false;
+
+	if (by_compress_relid)
+	{
+		CompressionSettingsCompressEntry *compress_entry =
+			hash_search(settings_cache_by_compress_relid, &relid, HASH_FIND, NULL);
+
+		if (compress_entry == NULL)
+			return false;
+
+		if (!OidIsValid(compress_entry->relid))
+		{
+			*settings = NULL;
+			return true;
+		}
+
+		relid = compress_entry->relid;
+	}
+
+	entry = hash_search(settings_cache, &relid, HASH_FIND, NULL);
+
+	if (entry == NULL)
+		return false;
+
+	*settings = entry->settings == NULL ? NULL : compression_settings_copy(entry->settings);
+	return true;
+}
+
+void
+ts_compression_settings_cache_get_usage(CacheUsage *usage)
+{
+	*usage = settings_cache_usage;
+	usage->entries = settings_cache == NULL ? 0 : hash_get_num_entries(settings_cache);
+	usage->memory =
+		settings_cache_mcxt == NULL ? 0 : MemoryContextMemAllocated(settings_cache_mcxt, true);
+}
+
 bool
 ts_compression_settings_equal(const CompressionSettings *left, const CompressionSettings *right)
 {
@@ -158,19 +420,32 @@ static CompressionSettings *
 compression_settings_get(Oid relid, bool by_compress_relid)
 {
 	CompressionSettings *settings = NULL;
+	uint64 generation;
+
+	if (settings_cache_get(relid, by_compress_relid, &settings))
+	{
+		settings_cache_usage.hits++;
+		return settings;
+	}
+
+	settings_cache_usage.misses++;
+	generation = settings_cache_generation;
+
 	ScanIterator iterator =
 		ts_scan_iterator_create(COMPRESSION_SETTINGS, AccessShareLock, CurrentMemoryContext);
 	compression_settings_iterator_init(&iterator, relid, by_compress_relid);
 
 	ts_scanner_start_scan(&iterator.ctx);
 	TupleInfo *ti = ts_scanner_next(&iterator.ctx);
-	if (!ti)
-		return NULL;
-
-	settings = palloc0(sizeof(CompressionSettings));
-	compression_settings_fill_from_tuple(settings, ti);
+	if (ti)
+	{
+		settings = palloc0(sizeof(CompressionSettings));
+		compression_settings_fill_from_tuple(settings, ti);
+	}
 	ts_scan_iterator_close(&iterator);
 
+	settings_cache_add(relid, by_compress_relid, settings, generation);
+
 	return settings;
 }
 
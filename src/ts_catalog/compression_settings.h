@@ -8,6 +8,7 @@
 #include <postgres.h>
 #include <catalog/pg_type.h>
 
+#include "cache.h"
 #include "ts_catalog/catalog.h"
 
 typedef struct CompressionSettings
@@ -31,5 +32,7 @@ TSDLLEXPORT bool ts_compression_settings_equal(const CompressionSettings *left,
 											   const CompressionSettings *right);
 
 TSDLLEXPORT int ts_compression_settings_update(CompressionSettings *settings);
+void ts_compression_settings_invalidate(Oid relid);
+void ts_compression_settings_cache_get_usage(CacheUsage *usage);
 TSDLLEXPORT void ts_compression_settings_rename_column_cascade(Oid parent_relid, const char *old,
 															   const char *new);
@@ -6,18 +6,36 @@
 
 /*
  * This file handles continuous aggs watermark functions.
+ *
+ * The watermarks of the real-time continuous aggregates are read by every
+ * query that plans or executes the union view, so the backends keep a small
+ * cache of the watermarks read from the catalog, keyed by the materialized
+ * hypertable id. An update of the watermark invalidates the relcache of the
+ * materialized hypertable, which drops the cached watermark of only that
+ * continuous aggregate in all backends, the same as the cached plans that
+ * constified the watermark.
+ *
+ * The watermark has to match the materialized data visible to the query, so
+ * the cache is only used with READ COMMITTED, where every statement takes a
+ * new snapshot. A cached watermark is never newer than the snapshot of the
+ * statement. An older watermark is still correct, since the real-time part of
+ * the query then covers more of the raw data. To not keep an old watermark
+ * after the invalidation, we only add watermarks read with a snapshot that
+ * sees all transactions that finished before the last invalidation.
  */
 
 #include <postgres.h>
+#include <access/transam.h>
 #include <access/xact.h>
 #include <fmgr.h>
 #include <miscadmin.h>
 #include <utils/acl.h>
+#include <utils/hsearch.h>
 #include <utils/inval.h>
+#include <utils/memutils.h>
 #include <utils/snapmgr.h>
 
 #include "debug_point.h"
-#include "guc.h"
 #include "hypertable.h"
 #include "ts_catalog/continuous_agg.h"
 #include "ts_catalog/continuous_aggs_watermark.h"
@@ -36,13 +54,179 @@ cagg_watermark_init_scan_by_mat_hypertable_id(ScanIterator *iterator, const int3
 								   Int32GetDatum(mat_hypertable_id));
 }
 
+#define WATERMARK_CACHE_SIZE 64
+
+typedef struct WatermarkCacheEntry
+{
+	int32 mat_hypertable_id; /* Hash key */
+	Oid mat_relid;
+	int64 watermark;
+} WatermarkCacheEntry;
+
+static MemoryContext watermark_cache_mcxt = NULL;
+static HTAB *watermark_cache = NULL;
+
+/*
+ * Incremented on every invalidation, to detect invalidations that happen
+ * while we read the watermark.
+ */
+static uint64 watermark_cache_generation = 0;
+
+/*
+ * The next transaction id at the last invalidation. The transaction that
+ * updated the watermark finished before, so a snapshot with a newer xmin
+ * sees the update.
+ */
+static TransactionId watermark_cache_inval_xid = InvalidTransactionId;
+
+static uint64 watermark_cache_hits = 0;
+static uint64 watermark_cache_misses = 0;
+static uint64 watermark_cache_invalidations = 0;
+
+/*
+ * Invalidate the cached watermark of the materialized hypertable with the
+ * relid, or all cached watermarks if the relid is invalid.
+ *
+ * Called from the relcache invalidation callback, so this must not access
+ * the catalogs.
+ */
+void
+ts_cagg_watermark_cache_invalidate(Oid relid)
+{
+	HASH_SEQ_STATUS status;
+	WatermarkCacheEntry *entry;
+
+	watermark_cache_generation++;
+	watermark_cache_inval_xid = XidFromFullTransactionId(ReadNextFullTransactionId());
+
+	if (watermark_cache == NULL)
+		return;
+
+	if (!OidIsValid(relid))
+	{
+		watermark_cache_invalidations += hash_get_num_entries(watermark_cache);
+		MemoryContextDelete(watermark_cache_mcxt);
+		watermark_cache_mcxt = NULL;
+		watermark_cache = NULL;
+		return;
+	}
+
+	/* Removing the current element is allowed during a sequential scan */
+	hash_seq_init(&status, watermark_cache);
+
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->mat_relid == relid)
+		{
+			hash_search(watermark_cache, &entry->mat_hypertable_id, HASH_REMOVE, NULL);
+			watermark_cache_invalidations++;
+		}
+	}
+}
+
+static bool
+watermark_cache_usable(void)
+{
+	return !IsolationUsesXactSnapshot() && !RecoveryInProgress();
+}
+
+static bool
+watermark_cache_get(int32 mat_hypertable_id, int64 *watermark)
+{
+	WatermarkCacheEntry *entry;
+
+	if (watermark_cache == NULL)
+	{
+		watermark_cache_misses++;
+		return false;
+	}
+
+	entry = hash_search(watermark_cache, &mat_hypertable_id, HASH_FIND, NULL);
+
+	if (entry == NULL)
+	{
+		watermark_cache_misses++;
+		return false;
+	}
+
+	watermark_cache_hits++;
+	*watermark = entry->watermark;
+	return true;
+}
+
+static void
+watermark_cache_add(int32 mat_hypertable_id, int64 watermark, Snapshot snapshot,
+					uint64 generation)
+{
+	WatermarkCacheEntry *entry;
+	Oid mat_relid;
+
+	if (generation != watermark_cache_generation)
+		return;
+
+	/* The snapshot might not see the update of the last invalidation */
+	if (TransactionIdIsValid(watermark_cache_inval_xid) &&
+		TransactionIdPrecedes(snapshot->xmin, watermark_cache_inval_xid))
+		return;
+
+	mat_relid = ts_hypertable_id_to_relid(mat_hypertable_id, true);
+
+	/* Looking up the relid might process invalidations */
+	if (!OidIsValid(mat_relid) || generation != watermark_cache_generation)
+		return;
+
+	if (watermark_cache == NULL)
+	{
+		HASHCTL ctl = {
+			.keysize = sizeof(int32),
+			.entrysize = sizeof(WatermarkCacheEntry),
+		};
+
+		watermark_cache_mcxt =
+			AllocSetContextCreate(CacheMemoryContext, "watermark cache", ALLOCSET_SMALL_SIZES);
+		ctl.hcxt = watermark_cache_mcxt;
+		watermark_cache = hash_create("watermark cache",
+									  WATERMARK_CACHE_SIZE,
+									  &ctl,
+									  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = hash_search(watermark_cache, &mat_hypertable_id, HASH_ENTER, NULL);
+	entry->mat_relid = mat_relid;
+	entry->watermark = watermark;
+}
+
+void
+ts_cagg_watermark_cache_get_usage(CacheUsage *usage)
+{
+	usage->name = "watermark_cache";
+	usage->entries = watermark_cache == NULL ? 0 : hash_get_num_entries(watermark_cache);
+	usage->hits = watermark_cache_hits;
+	usage->misses = watermark_cache_misses;
+	usage->evictions = 0;
+	usage->invalidations = watermark_cache_invalidations;
+	usage->memory =
+		watermark_cache_mcxt == NULL ? 0 : MemoryContextMemAllocated(watermark_cache_mcxt, true);
+}
+
 int64
 ts_cagg_watermark_get(int32 hypertable_id)
 {
 	PG_USED_FOR_ASSERTS_ONLY short count = 0;
 	Datum watermark = (Datum) 0;
 	bool value_isnull = true;
-	ScanIterator iterator =
+	bool use_cache = watermark_cache_usable();
+	uint64 generation = watermark_cache_generation;
+	int64 cached_watermark;
+	ScanIterator iterator;
+
+	if (use_cache && watermark_cache_get(hypertable_id, &cached_watermark))
+	{
+		watermark = Int64GetDatum(cached_watermark);
+		goto done;
+	}
+
+	iterator =
 		ts_scan_iterator_create(CONTINUOUS_AGGS_WATERMARK, AccessShareLock, CurrentMemoryContext);
 
 	/*
@@ -65,13 +249,21 @@ ts_cagg_watermark_get(int32 hypertable_id)
 		count++;
 	}
 	Assert(count <= 1);
-	ts_scan_iterator_close(&iterator);
 
 	if (value_isnull)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("watermark not defined for continuous aggregate: %d", hypertable_id)));
 
+	if (use_cache)
+		watermark_cache_add(hypertable_id,
+							DatumGetInt64(watermark),
+							iterator.ctx.snapshot,
+							generation);
+
+	ts_scan_iterator_close(&iterator);
+
+done:
 	/* Log the read watermark, needed for MVCC tap tests */
 	ereport(DEBUG5,
 			(errcode(ERRCODE_SUCCESSFUL_COMPLETION),
@@ -231,7 +423,6 @@ typedef struct WatermarkUpdate
 {
 	int64 watermark;
 	bool force_update;
-	bool invalidate_rel_cache;
 	Oid ht_relid;
 } WatermarkUpdate;
 
@@ -256,13 +447,10 @@ cagg_watermark_update_scan_internal(TupleInfo *ti, void *data)
 		 * constify_cagg_watermark() function. However, this function's value changes when we update
 		 * the Cagg (the volatility of the function is STABLE not IMMUTABLE). To ensure that caches,
 		 * such as the query plan cache, are properly evicted, we send an invalidation message for
-		 * the hypertable.
+		 * the hypertable. The invalidation also drops the cached watermark in the backends.
 		 */
-		if (watermark_update->invalidate_rel_cache)
-		{
-			DEBUG_WAITPOINT("cagg_watermark_update_internal_before_refresh");
-			CacheInvalidateRelcacheByRelid(watermark_update->ht_relid);
-		}
+		DEBUG_WAITPOINT("cagg_watermark_update_internal_before_refresh");
+		CacheInvalidateRelcacheByRelid(watermark_update->ht_relid);
 	}
 	else
 	{
@@ -282,13 +470,12 @@ cagg_watermark_update_scan_internal(TupleInfo *ti, void *data)
 
 static void
 cagg_watermark_update_internal(int32 mat_hypertable_id, Oid ht_relid, int64 new_watermark,
-							   bool force_update, bool invalidate_rel_cache)
+							   bool force_update)
 {
 	bool watermark_updated;
 	ScanKeyData scankey[1];
 	WatermarkUpdate data = { .watermark = new_watermark,
 							 .force_update = force_update,
-							 .invalidate_rel_cache = invalidate_rel_cache,
 							 .ht_relid = ht_relid };
 
 	ScanKeyInit(&scankey[0],
@@ -320,19 +507,15 @@ ts_cagg_watermark_update(Hypertable *mat_ht, int64 watermark, bool watermark_isn
 {
 	ContinuousAgg *cagg = ts_continuous_agg_find_by_mat_hypertable_id(mat_ht->fd.id, false);
 
-	/* If we have a real-time CAgg, it uses a watermark function. So, we have to invalidate the rel
-	 * cache to force a replanning of prepared statements. See cagg_watermark_update_internal for
-	 * more information. If the GUC enable_cagg_watermark_constify=false then it's not necessary
-	 * to invalidate relation cache. */
-	bool invalidate_rel_cache =
-		!cagg->data.materialized_only && ts_guc_enable_cagg_watermark_constify;
-
+	/* The update invalidates the rel cache of the materialized hypertable, also for
+	 * materialized-only CAggs and without constified watermarks, because the backends cache the
+	 * watermark and the CAgg might be changed to real-time later. See
+	 * cagg_watermark_update_internal for more information. */
 	watermark = cagg_compute_watermark(cagg, watermark, watermark_isnull);
 	cagg_watermark_update_internal(mat_ht->fd.id,
 								   mat_ht->main_table_relid,
 								   watermark,
-								   force_update,
-								   invalidate_rel_cache);
+								   force_update);
 }
 
 TSDLLEXPORT void
@@ -7,6 +7,7 @@
 
 #include <postgres.h>
 
+#include "cache.h"
 #include "export.h"
 #include "hypertable.h"
 
@@ -17,3 +18,5 @@ extern TSDLLEXPORT void ts_cagg_watermark_update(Hypertable *mat_ht, int64 water
 												 bool watermark_isnull, bool force_update);
 
 extern TSDLLEXPORT int64 ts_cagg_watermark_get(int32 hypertable_id);
+extern void ts_cagg_watermark_cache_invalidate(Oid relid);
+extern void ts_cagg_watermark_cache_get_usage(CacheUsage *usage);
@@ -54,3 +54,105 @@ ts_uuid_generate(PG_FUNCTION_ARGS)
 {
 	return UUIDPGetDatum(ts_uuid_create());
 }
+
+/*
+ * A UUIDv7 (RFC 9562) starts with a 48 bit big-endian Unix timestamp in
+ * milliseconds, followed by the version and variant fields and random
+ * bits. Since the uuid type compares bytewise, the values are ordered by
+ * their timestamp, which makes them usable as an open dimension.
+ */
+#define UUID_V7_UNIX_MS_MAX ((INT64CONST(1) << 48) - 1)
+#define UNIX_EPOCH_USECS ((int64) (POSTGRES_EPOCH_JDATE - UNIX_EPOCH_JDATE) * USECS_PER_DAY)
+
+bool
+ts_uuid_is_v7(const pg_uuid_t *uuid)
+{
+	return (uuid->data[6] & 0xf0) == 0x70 && (uuid->data[8] & 0xc0) == 0x80;
+}
+
+TimestampTz
+ts_uuid_v7_get_timestamp(const pg_uuid_t *uuid)
+{
+	int64 unix_ms = 0;
+
+	for (int i = 0; i < 6; i++)
+		unix_ms = (unix_ms << 8) | uuid->data[i];
+
+	return (unix_ms * 1000) - UNIX_EPOCH_USECS;
+}
+
+/*
+ * Create a UUIDv7 for the given timestamp, which is truncated to
+ * milliseconds. If "random" is false, all the random bits are zero, which
+ * gives the lowest UUIDv7 of the millisecond, usable as a range boundary.
+ */
+pg_uuid_t *
+ts_uuid_create_v7(TimestampTz ts, bool random)
+{
+	unsigned char *gen_uuid = palloc0(UUID_LEN);
+	int64 unix_ms;
+
+	if (TIMESTAMP_NOT_FINITE(ts) || ts < -UNIX_EPOCH_USECS)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				 errmsg("timestamp out of range for UUIDv7")));
+
+	unix_ms = (ts + UNIX_EPOCH_USECS) / 1000;
+
+	if (unix_ms > UUID_V7_UNIX_MS_MAX)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+				 errmsg("timestamp out of range for UUIDv7")));
+
+	if (random && !pg_strong_random(&gen_uuid[6], UUID_LEN - 6))
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR), errmsg("could not generate random values")));
+
+	for (int i = 5; i >= 0; i--)
+	{
+		gen_uuid[i] = (unsigned char) (unix_ms & 0xff);
+		unix_ms >>= 8;
+	}
+
+	gen_uuid[6] = (gen_uuid[6] & 0x0f) | 0x70; /* "version" field */
+	gen_uuid[8] = (gen_uuid[8] & 0x3f) | 0x80; /* "variant" field */
+
+	return (pg_uuid_t *) gen_uuid;
+}
+
+TS_FUNCTION_INFO_V1(ts_uuid_generate_v7);
+
+Datum
+ts_uuid_generate_v7(PG_FUNCTION_ARGS)
+{
+	return UUIDPGetDatum(ts_uuid_create_v7(GetCurrentTimestamp(), true));
+}
+
+TS_FUNCTION_INFO_V1(ts_uuid_v7_from_timestamptz);
+
+Datum
+ts_uuid_v7_from_timestamptz(PG_FUNCTION_ARGS)
+{
+	return UUIDPGetDatum(ts_uuid_create_v7(PG_GETARG_TIMESTAMPTZ(0), false));
+}
+
+/*
+ * Get the timestamp of a UUIDv7. This is the default partitioning function
+ * of open dimensions on uuid columns, so other UUID versions are rejected
+ * since they have no timestamp to partition on.
+ */
+TS_FUNCTION_INFO_V1(ts_timestamptz_from_uuid_v7);
+
+Datum
+ts_timestamptz_from_uuid_v7(PG_FUNCTION_ARGS)
+{
+	pg_uuid_t *uuid = PG_GETARG_UUID_P(0);
+
+	if (!ts_uuid_is_v7(uuid))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid UUID version"),
+				 errdetail("Only version 7 UUIDs have a timestamp.")));
+
+	PG_RETURN_TIMESTAMPTZ(ts_uuid_v7_get_timestamp(uuid));
+}
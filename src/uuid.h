@@ -6,6 +6,10 @@
 #pragma once
 
 #include <postgres.h>
+#include <datatype/timestamp.h>
 #include <utils/uuid.h>
 
 extern pg_uuid_t *ts_uuid_create(void);
+extern pg_uuid_t *ts_uuid_create_v7(TimestampTz ts, bool random);
+extern bool ts_uuid_is_v7(const pg_uuid_t *uuid);
+extern TimestampTz ts_uuid_v7_get_timestamp(const pg_uuid_t *uuid);
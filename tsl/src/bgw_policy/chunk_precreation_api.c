@@ -0,0 +1,362 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Policy that creates the chunks for the next time intervals ahead of the
+ * ingest. Creating a chunk takes locks on the hypertable and clones the
+ * constraints, indexes and triggers of the hypertable, and the concurrent
+ * inserts that need the same chunk wait for it. With the chunks created in
+ * advance, the inserts crossing the chunk boundaries only need to find them.
+ */
+
+#include <postgres.h>
+#include <miscadmin.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+
+#include <compat/compat.h>
+#include <dimension.h>
+#include <hypertable_cache.h>
+#include <jsonb_utils.h>
+
+#include "bgw/job.h"
+#include "bgw/job_stat.h"
+#include "bgw/timer.h"
+#include "bgw_policy/chunk_precreation_api.h"
+#include "bgw_policy/job.h"
+#include "bgw_policy/job_api.h"
+#include "errors.h"
+#include "guc.h"
+#include "hypertable.h"
+#include "time_utils.h"
+#include "utils.h"
+
+/*
+ * Default schedule interval for hypertables that don't have time-based
+ * chunk intervals. Otherwise, the policy runs twice per chunk interval.
+ */
+#define DEFAULT_SCHEDULE_INTERVAL                                                                  \
+	{                                                                                              \
+		.day = 1                                                                                   \
+	}
+
+/* Default number of chunk intervals to create ahead of the current one */
+#define DEFAULT_CHUNKS_AHEAD 2
+
+/* Default max runtime for a chunk precreation job is unlimited for now */
+#define DEFAULT_MAX_RUNTIME                                                                        \
+	DatumGetIntervalP(DirectFunctionCall3(interval_in, CStringGetDatum("0"), InvalidOid, -1))
+
+/* Default retry period for chunk precreation jobs is currently 5 minutes */
+#define DEFAULT_RETRY_PERIOD                                                                       \
+	DatumGetIntervalP(DirectFunctionCall3(interval_in, CStringGetDatum("5 min"), InvalidOid, -1))
+
+#define CONFIG_KEY_HYPERTABLE_ID "hypertable_id"
+#define CONFIG_KEY_CHUNKS_AHEAD "chunks_ahead"
+
+#define POLICY_PRECREATE_CHUNKS_PROC_NAME "policy_precreate_chunks"
+#define POLICY_PRECREATE_CHUNKS_CHECK_NAME "policy_precreate_chunks_check"
+
+int32
+policy_precreate_chunks_get_hypertable_id(const Jsonb *config)
+{
+	bool found;
+	int32 hypertable_id = ts_jsonb_get_int32_field(config, CONFIG_KEY_HYPERTABLE_ID, &found);
+
+	if (!found)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not find hypertable_id in config for job")));
+
+	return hypertable_id;
+}
+
+int32
+policy_precreate_chunks_get_chunks_ahead(const Jsonb *config)
+{
+	bool found;
+	int32 chunks_ahead = ts_jsonb_get_int32_field(config, CONFIG_KEY_CHUNKS_AHEAD, &found);
+
+	if (!found)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not find chunks_ahead in config for job")));
+
+	if (chunks_ahead < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid number of chunks to create ahead: %d", chunks_ahead),
+				 errhint("The number of chunks must be at least 1.")));
+
+	return chunks_ahead;
+}
+
+/*
+ * Check that we know which chunks come next for the hypertable.
+ *
+ * The chunks are created for all the partitions of the closed dimensions, but
+ * we can't know the future values of the additional open dimensions, and we
+ * need the current time of the time dimension.
+ */
+void
+policy_precreate_chunks_check_hypertable(const Hypertable *ht)
+{
+	if (TS_HYPERTABLE_IS_INTERNAL_COMPRESSION_TABLE(ht))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot add chunk precreation policy to compressed hypertable \"%s\"",
+						get_rel_name(ht->main_table_relid)),
+				 errhint("Please add the policy to the corresponding uncompressed hypertable "
+						 "instead.")));
+
+	if (hyperspace_get_open_dimension(ht->space, 1) != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot add chunk precreation policy to hypertable \"%s\"",
+						get_rel_name(ht->main_table_relid)),
+				 errdetail("The hypertable has more than one open dimension.")));
+
+	const Dimension *dim = hyperspace_get_open_dimension(ht->space, 0);
+	Oid partitioning_type = ts_dimension_get_partition_type(dim);
+
+	if (IS_INTEGER_TYPE(partitioning_type))
+	{
+		if (!OidIsValid(ts_get_integer_now_func(dim, false)))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("missing integer_now function for hypertable \"%s\"",
+							get_rel_name(ht->main_table_relid)),
+					 errhint("Set an integer_now function with set_integer_now_func().")));
+	}
+	else if (!IS_TIMESTAMP_TYPE(partitioning_type))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot add chunk precreation policy to hypertable \"%s\"",
+						get_rel_name(ht->main_table_relid)),
+				 errdetail("The time dimension has type %s, which is not supported.",
+						   format_type_be(partitioning_type))));
+}
+
+Datum
+policy_precreate_chunks_check(PG_FUNCTION_ARGS)
+{
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	if (PG_ARGISNULL(0))
+	{
+		ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg("config must not be NULL")));
+	}
+
+	policy_precreate_chunks_read_and_validate_config(PG_GETARG_JSONB_P(0), NULL);
+
+	PG_RETURN_VOID();
+}
+
+Datum
+policy_precreate_chunks_proc(PG_FUNCTION_ARGS)
+{
+	if (PG_NARGS() != 2 || PG_ARGISNULL(0) || PG_ARGISNULL(1))
+		PG_RETURN_VOID();
+
+	ts_feature_flag_check(FEATURE_POLICY);
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	policy_precreate_chunks_execute(PG_GETARG_INT32(0), PG_GETARG_JSONB_P(1));
+
+	PG_RETURN_VOID();
+}
+
+Datum
+policy_precreate_chunks_add(PG_FUNCTION_ARGS)
+{
+	/* behave like a strict function */
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(2))
+		PG_RETURN_NULL();
+
+	NameData application_name;
+	NameData proc_name, proc_schema, check_name, check_schema;
+	int32 job_id;
+	const Dimension *dim;
+	Interval schedule_interval = DEFAULT_SCHEDULE_INTERVAL;
+	Oid ht_oid = PG_GETARG_OID(0);
+	int32 chunks_ahead = PG_GETARG_INT32(1);
+	bool if_not_exists = PG_GETARG_BOOL(2);
+	Interval *user_schedule_interval = PG_ARGISNULL(3) ? NULL : PG_GETARG_INTERVAL_P(3);
+	Cache *hcache;
+	Hypertable *ht;
+	int32 hypertable_id;
+	Oid partitioning_type;
+	Oid owner_id;
+	List *jobs;
+	TimestampTz initial_start = PG_ARGISNULL(4) ? DT_NOBEGIN : PG_GETARG_TIMESTAMPTZ(4);
+	bool fixed_schedule = !PG_ARGISNULL(4);
+	text *timezone = PG_ARGISNULL(5) ? NULL : PG_GETARG_TEXT_PP(5);
+	char *valid_timezone = NULL;
+
+	ts_feature_flag_check(FEATURE_POLICY);
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	if (chunks_ahead < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid number of chunks to create ahead: %d", chunks_ahead),
+				 errhint("The number of chunks must be at least 1.")));
+
+	if (timezone != NULL)
+		valid_timezone = ts_bgw_job_validate_timezone(PG_GETARG_DATUM(5));
+
+	ht = ts_hypertable_cache_get_cache_and_entry(ht_oid, CACHE_FLAG_NONE, &hcache);
+	Assert(ht != NULL);
+	hypertable_id = ht->fd.id;
+
+	/* First verify that the hypertable corresponds to a valid table */
+	owner_id = ts_hypertable_permissions_check(ht_oid, GetUserId());
+
+	policy_precreate_chunks_check_hypertable(ht);
+
+	/* Verify that the hypertable owner can create a background worker */
+	ts_bgw_job_validate_job_owner(owner_id);
+
+	/* Make sure that an existing chunk precreation policy doesn't exist on this hypertable */
+	jobs = ts_bgw_job_find_by_proc_and_hypertable_id(POLICY_PRECREATE_CHUNKS_PROC_NAME,
+													 FUNCTIONS_SCHEMA_NAME,
+													 ht->fd.id);
+
+	/*
+	 * Run the policy twice per chunk interval by default, so that there are
+	 * always chunks ahead of the current one.
+	 */
+	dim = hyperspace_get_open_dimension(ht->space, 0);
+	Assert(dim);
+
+	partitioning_type = ts_dimension_get_partition_type(dim);
+	if (user_schedule_interval != NULL)
+		schedule_interval = *user_schedule_interval;
+	else if (IS_TIMESTAMP_TYPE(partitioning_type))
+	{
+		schedule_interval.time = dim->fd.interval_length / 2;
+		schedule_interval.day = 0;
+		schedule_interval.month = 0;
+	}
+
+	ts_cache_release(hcache);
+
+	if (jobs != NIL)
+	{
+		BgwJob *existing = linitial(jobs);
+		Assert(list_length(jobs) == 1);
+
+		if (!if_not_exists)
+			ereport(ERROR,
+					(errcode(ERRCODE_DUPLICATE_OBJECT),
+					 errmsg("chunk precreation policy already exists for hypertable \"%s\"",
+							get_rel_name(ht_oid))));
+
+		if (policy_precreate_chunks_get_chunks_ahead(existing->fd.config) != chunks_ahead)
+		{
+			ereport(WARNING,
+					(errmsg("chunk precreation policy already exists for hypertable \"%s\"",
+							get_rel_name(ht_oid)),
+					 errdetail("A policy already exists with different arguments."),
+					 errhint("Remove the existing policy before adding a new one.")));
+			PG_RETURN_INT32(-1);
+		}
+		/* If all arguments are the same, do nothing */
+		ereport(NOTICE,
+				(errmsg("chunk precreation policy already exists on hypertable \"%s\", skipping",
+						get_rel_name(ht_oid))));
+		PG_RETURN_INT32(-1);
+	}
+
+	/* if users pass in -infinity for initial_start, then use the current_timestamp instead */
+	if (fixed_schedule)
+	{
+		ts_bgw_job_validate_schedule_interval(&schedule_interval);
+		if (TIMESTAMP_NOT_FINITE(initial_start))
+			initial_start = ts_timer_get_current_timestamp();
+	}
+
+	/* Next, insert a new job into jobs table */
+	namestrcpy(&application_name, "Chunk Precreation Policy");
+	namestrcpy(&proc_name, POLICY_PRECREATE_CHUNKS_PROC_NAME);
+	namestrcpy(&proc_schema, FUNCTIONS_SCHEMA_NAME);
+	namestrcpy(&check_name, POLICY_PRECREATE_CHUNKS_CHECK_NAME);
+	namestrcpy(&check_schema, FUNCTIONS_SCHEMA_NAME);
+
+	JsonbParseState *parse_state = NULL;
+
+	pushJsonbValue(&parse_state, WJB_BEGIN_OBJECT, NULL);
+	ts_jsonb_add_int32(parse_state, CONFIG_KEY_HYPERTABLE_ID, hypertable_id);
+	ts_jsonb_add_int32(parse_state, CONFIG_KEY_CHUNKS_AHEAD, chunks_ahead);
+	JsonbValue *result = pushJsonbValue(&parse_state, WJB_END_OBJECT, NULL);
+	Jsonb *config = JsonbValueToJsonb(result);
+
+	job_id = ts_bgw_job_insert_relation(&application_name,
+										&schedule_interval,
+										DEFAULT_MAX_RUNTIME,
+										JOB_RETRY_UNLIMITED,
+										DEFAULT_RETRY_PERIOD,
+										&proc_schema,
+										&proc_name,
+										&check_schema,
+										&check_name,
+										owner_id,
+										true,
+										fixed_schedule,
+										hypertable_id,
+										config,
+										initial_start,
+										valid_timezone);
+
+	if (!TIMESTAMP_NOT_FINITE(initial_start))
+		ts_bgw_job_stat_upsert_next_start(job_id, initial_start);
+
+	PG_RETURN_INT32(job_id);
+}
+
+Datum
+policy_precreate_chunks_remove(PG_FUNCTION_ARGS)
+{
+	Oid hypertable_oid = PG_GETARG_OID(0);
+	bool if_exists = PG_GETARG_BOOL(1);
+	Hypertable *ht;
+	Cache *hcache;
+
+	ts_feature_flag_check(FEATURE_POLICY);
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	ht = ts_hypertable_cache_get_cache_and_entry(hypertable_oid, CACHE_FLAG_NONE, &hcache);
+
+	List *jobs = ts_bgw_job_find_by_proc_and_hypertable_id(POLICY_PRECREATE_CHUNKS_PROC_NAME,
+														   FUNCTIONS_SCHEMA_NAME,
+														   ht->fd.id);
+	ts_cache_release(hcache);
+
+	if (jobs == NIL)
+	{
+		if (!if_exists)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_OBJECT),
+					 errmsg("chunk precreation policy not found for hypertable \"%s\"",
+							get_rel_name(hypertable_oid))));
+		else
+		{
+			ereport(NOTICE,
+					(errmsg("chunk precreation policy not found for hypertable \"%s\", skipping",
+							get_rel_name(hypertable_oid))));
+			PG_RETURN_NULL();
+		}
+	}
+	Assert(list_length(jobs) == 1);
+	BgwJob *job = linitial(jobs);
+
+	ts_hypertable_permissions_check(hypertable_oid, GetUserId());
+
+	ts_bgw_job_delete_by_id(job->fd.id);
+
+	PG_RETURN_NULL();
+}
@@ -6,8 +6,10 @@
 
 #include <postgres.h>
 #include <access/xact.h>
+#include <catalog/pg_type.h>
 #include <fmgr.h>
 #include <miscadmin.h>
+#include <utils/array.h>
 #include <utils/builtins.h>
 
 #include "compression_api.h"
@@ -53,6 +55,73 @@ policy_compression_get_maxchunks_per_job(const Jsonb *config)
 	return (found && maxchunks > 0) ? maxchunks : 0;
 }
 
+/*
+ * Get the number of chunks that the compression policy compresses in
+ * parallel, or 0 if the chunks are compressed one by one.
+ */
+int32
+policy_compression_get_max_parallel_chunks(const Jsonb *config)
+{
+	bool found;
+	int32 max_parallel_chunks =
+		ts_jsonb_get_int32_field(config, POL_COMPRESSION_CONF_KEY_MAX_PARALLEL_CHUNKS, &found);
+
+	if (found && max_parallel_chunks < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid value for parameter %s",
+						POL_COMPRESSION_CONF_KEY_MAX_PARALLEL_CHUNKS),
+				 errhint("The number of chunks to compress in parallel must not be negative.")));
+
+	return (found && max_parallel_chunks > 1) ? max_parallel_chunks : 0;
+}
+
+/*
+ * Check if the compression policy selects the chunks by the expected benefit
+ * of compressing them, instead of by age, see policy_compression_execute().
+ */
+bool
+policy_compression_get_select_by_benefit(const Jsonb *config)
+{
+	char *chunk_selection =
+		ts_jsonb_get_str_field(config, POL_COMPRESSION_CONF_KEY_CHUNK_SELECTION);
+
+	if (chunk_selection == NULL || strcmp(chunk_selection, "age") == 0)
+		return false;
+
+	if (strcmp(chunk_selection, "benefit") != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid value for parameter %s", POL_COMPRESSION_CONF_KEY_CHUNK_SELECTION),
+				 errhint("The chunk selection must be \"age\" or \"benefit\".")));
+
+	return true;
+}
+
+/*
+ * Get the time after which the compression policy stops compressing chunks
+ * in a run, or NULL if there is no limit. The remaining chunks are
+ * compressed by the next runs.
+ */
+Interval *
+policy_compression_get_time_budget(const Jsonb *config)
+{
+	Interval *time_budget =
+		ts_jsonb_get_interval_field(config, POL_COMPRESSION_CONF_KEY_TIME_BUDGET);
+	Interval zero = { 0 };
+
+	if (time_budget != NULL &&
+		DatumGetBool(DirectFunctionCall2(interval_le,
+										 IntervalPGetDatum(time_budget),
+										 IntervalPGetDatum(&zero))))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid value for parameter %s", POL_COMPRESSION_CONF_KEY_TIME_BUDGET),
+				 errhint("The time budget must be positive.")));
+
+	return time_budget;
+}
+
 int32
 policy_compression_get_hypertable_id(const Jsonb *config)
 {
@@ -149,11 +218,79 @@ policy_compression_check(PG_FUNCTION_ARGS)
 	}
 
 	policy_compression_read_and_validate_config(PG_GETARG_JSONB_P(0), &policy_data);
+	policy_compression_get_max_parallel_chunks(PG_GETARG_JSONB_P(0));
+	policy_compression_get_select_by_benefit(PG_GETARG_JSONB_P(0));
+	policy_compression_get_time_budget(PG_GETARG_JSONB_P(0));
 	ts_cache_release(policy_data.hcache);
 
 	PG_RETURN_VOID();
 }
 
+/*
+ * Compress the given chunks of a compression policy in parallel workers.
+ *
+ * Called by the compression policy when max_parallel_chunks is set. Returns
+ * the number of chunks that failed to compress, or NULL if no worker could
+ * be started, in which case the policy compresses the chunks itself. No
+ * chunks are started after the deadline, if given.
+ */
+Datum
+policy_compression_execute_parallel(PG_FUNCTION_ARGS)
+{
+	int32 job_id = PG_GETARG_INT32(0);
+	ArrayType *chunks_array = PG_ARGISNULL(1) ? NULL : PG_GETARG_ARRAYTYPE_P(1);
+	int32 max_parallel_chunks = PG_ARGISNULL(2) ? 0 : PG_GETARG_INT32(2);
+	bool verbose_log = PG_ARGISNULL(3) ? false : PG_GETARG_BOOL(3);
+	bool useam_isnull = PG_ARGISNULL(4);
+	bool useam = useam_isnull ? false : PG_GETARG_BOOL(4);
+	TimestampTz deadline = PG_ARGISNULL(5) ? DT_NOEND : PG_GETARG_TIMESTAMPTZ(5);
+	Datum *chunks;
+	bool *nulls;
+	Oid *chunk_relids;
+	int nchunks;
+	int nrelids = 0;
+	int chunks_failed;
+
+	ts_feature_flag_check(FEATURE_POLICY);
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	if (chunks_array == NULL || max_parallel_chunks < 2)
+		PG_RETURN_NULL();
+
+	deconstruct_array(chunks_array,
+					  REGCLASSOID,
+					  sizeof(Oid),
+					  true,
+					  TYPALIGN_INT,
+					  &chunks,
+					  &nulls,
+					  &nchunks);
+
+	chunk_relids = palloc(sizeof(Oid) * nchunks);
+	for (int i = 0; i < nchunks; i++)
+	{
+		if (!nulls[i])
+			chunk_relids[nrelids++] = DatumGetObjectId(chunks[i]);
+	}
+
+	if (nrelids == 0)
+		PG_RETURN_INT32(0);
+
+	chunks_failed = policy_compression_execute_parallel_chunks(job_id,
+															   chunk_relids,
+															   nrelids,
+															   max_parallel_chunks,
+															   verbose_log,
+															   useam_isnull,
+															   useam,
+															   deadline);
+
+	if (chunks_failed < 0)
+		PG_RETURN_NULL();
+
+	PG_RETURN_INT32(chunks_failed);
+}
+
 /* compression policies are added to hypertables or continuous aggregates */
 Datum
 policy_compression_add_internal(Oid user_rel_oid, Datum compress_after_datum,
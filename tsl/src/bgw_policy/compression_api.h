@@ -17,9 +17,13 @@ extern Datum policy_compression_remove(PG_FUNCTION_ARGS);
 
 extern Datum policy_recompression_proc(PG_FUNCTION_ARGS);
 extern Datum policy_compression_check(PG_FUNCTION_ARGS);
+extern Datum policy_compression_execute_parallel(PG_FUNCTION_ARGS);
 
 int32 policy_compression_get_hypertable_id(const Jsonb *config);
 int32 policy_compression_get_maxchunks_per_job(const Jsonb *config);
+int32 policy_compression_get_max_parallel_chunks(const Jsonb *config);
+bool policy_compression_get_select_by_benefit(const Jsonb *config);
+Interval *policy_compression_get_time_budget(const Jsonb *config);
 int64 policy_recompression_get_recompress_after_int(const Jsonb *config);
 Interval *policy_recompression_get_recompress_after_interval(const Jsonb *config);
 
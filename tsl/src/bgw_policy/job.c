@@ -9,6 +9,8 @@
 #include <catalog/namespace.h>
 #include <catalog/pg_type.h>
 #include <commands/defrem.h>
+#include <executor/spi.h>
+#include <common/int.h>
 #include <extension.h>
 #include <funcapi.h>
 #include <hypertable_cache.h>
@@ -17,10 +19,15 @@
 #include <nodes/primnodes.h>
 #include <parser/parse_func.h>
 #include <parser/parser.h>
+#include <pgstat.h>
+#include <port/atomics.h>
+#include <storage/dsm.h>
+#include <utils/array.h>
 #include <tcop/pquery.h>
 #include <utils/builtins.h>
 #include <utils/guc.h>
 #include <utils/lsyscache.h>
+#include <utils/memutils.h>
 #include <utils/portal.h>
 #include <utils/snapmgr.h>
 #include <utils/syscache.h>
@@ -30,15 +37,19 @@
 #include "bgw/job.h"
 #include "bgw/job_stat.h"
 #include "bgw/timer.h"
+#include "bgw_policy/chunk_precreation_api.h"
 #include "bgw_policy/chunk_stats.h"
 #include "bgw_policy/compression_api.h"
 #include "bgw_policy/continuous_aggregate_api.h"
+#include "bgw_policy/merge_chunks_api.h"
+#include "bgw_policy/policies_v2.h"
 #include "bgw_policy/policy_utils.h"
 #include "bgw_policy/reorder_api.h"
 #include "bgw_policy/retention_api.h"
 #include "compression/api.h"
 #include "continuous_aggs/materialize.h"
 #include "continuous_aggs/refresh.h"
+#include "ts_catalog/compression_settings.h"
 #include "ts_catalog/continuous_agg.h"
 #ifdef USE_TELEMETRY
 #include "telemetry/telemetry.h"
@@ -54,7 +65,9 @@
 #include "errors.h"
 #include "guc.h"
 #include "job.h"
+#include "jsonb_utils.h"
 #include "reorder.h"
+#include "time_utils.h"
 #include "utils.h"
 
 #define REORDER_SKIP_RECENT_DIM_SLICES_N 3
@@ -305,6 +318,140 @@ policy_retention_execute(int32 job_id, Jsonb *config)
 	return true;
 }
 
+typedef struct RetentionBatchEntry
+{
+	int32 job_id;
+	PolicyRetentionData policy_data;
+} RetentionBatchEntry;
+
+static int
+retention_batch_entry_cmp(const void *left, const void *right)
+{
+	Oid left_relid = ((const RetentionBatchEntry *) left)->policy_data.object_relid;
+	Oid right_relid = ((const RetentionBatchEntry *) right)->policy_data.object_relid;
+
+	if (left_relid != right_relid)
+		return left_relid < right_relid ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * Gather the retention policies of the batch, i.e., the retention policies
+ * that are not scheduled themselves, on the objects with a relid greater than
+ * the given one, in the order of the relids.
+ */
+static RetentionBatchEntry *
+policy_retention_batch_gather(Oid after_relid, int *nentries)
+{
+	List *jobs = ts_bgw_job_find_by_proc(POLICY_RETENTION_PROC_NAME, FUNCTIONS_SCHEMA_NAME);
+	RetentionBatchEntry *entries = palloc(sizeof(RetentionBatchEntry) * (list_length(jobs) + 1));
+	ListCell *lc;
+	int n = 0;
+
+	foreach (lc, jobs)
+	{
+		BgwJob *job = lfirst(lc);
+		RetentionBatchEntry *entry = &entries[n];
+
+		if (job->fd.scheduled || job->fd.config == NULL)
+			continue;
+
+		policy_retention_read_and_validate_config(job->fd.config, &entry->policy_data);
+
+		if (entry->policy_data.object_relid <= after_relid)
+			continue;
+
+		entry->job_id = job->fd.id;
+		n++;
+	}
+
+	qsort(entries, n, sizeof(RetentionBatchEntry), retention_batch_entry_cmp);
+	*nentries = n;
+	return entries;
+}
+
+/*
+ * Apply the retention policies that are not scheduled themselves, so that
+ * the chunks of many hypertables are dropped by one job instead of a job per
+ * hypertable that runs at the same time as the others.
+ *
+ * The policies are gathered from the job catalog in one pass, and the chunks
+ * are dropped in the order of the relids of the hypertables, so that
+ * concurrent batches lock the hypertables in the same order. When called
+ * non-atomically, we commit after dropping the chunks of the hypertables that
+ * add up to max_chunks_per_batch chunks, to release the locks, and gather the
+ * remaining policies again in the new transaction.
+ */
+bool
+policy_retention_batch_execute(int32 job_id, Jsonb *config, bool nonatomic)
+{
+	int32 max_chunks_per_batch = policy_retention_batch_get_max_chunks_per_batch(config);
+	bool verbose_log = policy_get_verbose_log(config);
+	Oid last_relid = InvalidOid;
+	bool done = false;
+	int rc;
+
+	if (nonatomic && max_chunks_per_batch > 0)
+	{
+		rc = SPI_connect_ext(SPI_OPT_NONATOMIC);
+		if (rc != SPI_OK_CONNECT)
+			elog(ERROR, "SPI_connect failed: %s", SPI_result_code_string(rc));
+	}
+	else
+		max_chunks_per_batch = 0;
+
+	while (!done)
+	{
+		int nentries;
+		RetentionBatchEntry *entries = policy_retention_batch_gather(last_relid, &nentries);
+		int dropped_chunks = 0;
+
+		done = true;
+
+		for (int i = 0; i < nentries; i++)
+		{
+			PolicyRetentionData *policy_data = &entries[i].policy_data;
+
+			if (verbose_log)
+				log_retention_boundary(LOG, policy_data, "applying retention policy to hypertable");
+
+			dropped_chunks += chunk_invoke_drop_chunks(policy_data->object_relid,
+													   policy_data->boundary,
+													   policy_data->boundary_type,
+													   policy_data->use_creation_time);
+			last_relid = policy_data->object_relid;
+
+			if (max_chunks_per_batch > 0 && dropped_chunks >= max_chunks_per_batch &&
+				i < nentries - 1)
+			{
+				done = false;
+				break;
+			}
+		}
+
+		pfree(entries);
+
+		if (!done)
+		{
+			elog(DEBUG1,
+				 "retention batch of job %d dropped %d chunks, committing",
+				 job_id,
+				 dropped_chunks);
+			SPI_commit_and_chain();
+		}
+	}
+
+	if (max_chunks_per_batch > 0)
+	{
+		rc = SPI_finish();
+		if (rc != SPI_OK_FINISH)
+			elog(ERROR, "SPI_finish failed: %s", SPI_result_code_string(rc));
+	}
+
+	return true;
+}
+
 void
 policy_retention_read_and_validate_config(Jsonb *config, PolicyRetentionData *policy_data)
 {
@@ -414,6 +561,19 @@ policy_refresh_cagg_execute(int32 job_id, Jsonb *config)
 			 ts_internal_to_time_string(refresh_window->end, refresh_window->type));
 
 		context.processing_batch = ++processing_batch;
+
+		/* Show the progress of the batched refresh in pg_stat_activity */
+		if (context.callctx == CAGG_REFRESH_POLICY_BATCHED)
+		{
+			char *activity = psprintf("refreshing continuous aggregate \"%s\" (batch %d of %d)",
+									  NameStr(policy_data.cagg->data.user_view_name),
+									  context.processing_batch,
+									  context.number_of_batches);
+
+			pgstat_report_activity(STATE_RUNNING, activity);
+			pfree(activity);
+		}
+
 		continuous_agg_refresh_internal(policy_data.cagg,
 										refresh_window,
 										context,
@@ -432,6 +592,21 @@ policy_refresh_cagg_execute(int32 job_id, Jsonb *config)
 		}
 	}
 
+	/*
+	 * Refresh the continuous aggregates on top of this one with the same
+	 * window, unless some batches are left for the next run.
+	 */
+	if (ts_guc_enable_cagg_cascade_refresh && processing_batch == context.number_of_batches)
+	{
+		CaggRefreshContext cascade_context = { .callctx = CAGG_REFRESH_POLICY };
+
+		continuous_agg_refresh_cascade(policy_data.cagg,
+									   &policy_data.refresh_window,
+									   cascade_context,
+									   policy_data.refresh_window.start_isnull,
+									   policy_data.refresh_window.end_isnull);
+	}
+
 	if (!policy_data.include_tiered_data_isnull)
 	{
 		SetConfigOption("timescaledb.enable_tiered_reads",
@@ -452,8 +627,10 @@ policy_refresh_cagg_read_and_validate_config(Jsonb *config, PolicyContinuousAggD
 	Oid dim_type;
 	int64 refresh_start, refresh_end;
 	int32 buckets_per_batch, max_batches_per_execution;
+	int64 refresh_invalidated_rows;
 	bool start_isnull, end_isnull;
 	bool include_tiered_data, include_tiered_data_isnull;
+	bool found;
 
 	materialization_id = policy_continuous_aggregate_get_mat_hypertable_id(config);
 	mat_ht = ts_hypertable_get_by_id(materialization_id);
@@ -502,6 +679,16 @@ policy_refresh_cagg_read_and_validate_config(Jsonb *config, PolicyContinuousAggD
 				 errhint(
 					 "The max batches per execution should be greater than or equal to zero.")));
 
+	refresh_invalidated_rows =
+		ts_jsonb_get_int64_field(config, BGW_JOB_CONFIG_KEY_REFRESH_ON_INVALIDATED_ROWS, &found);
+
+	if (found && refresh_invalidated_rows <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid refresh on invalidated rows"),
+				 errdetail("refresh_on_invalidated_rows: " INT64_FORMAT, refresh_invalidated_rows),
+				 errhint("The refresh on invalidated rows should be greater than zero.")));
+
 	if (policy_data)
 	{
 		policy_data->refresh_window.type = dim_type;
@@ -617,6 +804,616 @@ policy_recompression_execute(int32 job_id, Jsonb *config)
 	return true;
 }
 
+/*
+ * State of a compression policy that compresses the chunks in parallel,
+ * shared with its helper workers in a dynamic shared memory segment. Each
+ * helper takes the next chunk of the list until all chunks are taken.
+ */
+typedef struct PolicyCompressionParallelState
+{
+	pg_atomic_uint32 next_chunk;
+	pg_atomic_uint32 chunks_failed;
+	bool verbose_log;
+	bool useam_isnull;
+	bool useam;
+	TimestampTz deadline; /* No chunks are started after this */
+	int nchunks;
+	Oid chunks[FLEXIBLE_ARRAY_MEMBER];
+} PolicyCompressionParallelState;
+
+/*
+ * Compress the chunks in up to max_workers helper workers, each chunk in its
+ * own transaction, so that the job and the helpers must not hold any locks
+ * on the chunks. The chunks are the same as the ones that the compression
+ * policy would compress one by one, so this has to care only about not
+ * compressing the same chunk twice.
+ *
+ * Returns the number of chunks that failed to compress, or -1 if no helper
+ * could be started, e.g., because there are no free background workers, in
+ * which case the caller has to compress the chunks. The chunks that were
+ * left after the deadline are not failed, they are compressed by the next
+ * run of the policy.
+ */
+int
+policy_compression_execute_parallel_chunks(int32 job_id, const Oid *chunks, int nchunks,
+										   int max_workers, bool verbose_log, bool useam_isnull,
+										   bool useam, TimestampTz deadline)
+{
+	Size size = add_size(offsetof(PolicyCompressionParallelState, chunks),
+						 mul_size(nchunks, sizeof(Oid)));
+	dsm_segment *seg = dsm_create(size, 0);
+	PolicyCompressionParallelState *state = dsm_segment_address(seg);
+	List *volatile helpers = NIL;
+	int chunks_failed;
+	uint32 chunks_taken;
+
+	pg_atomic_init_u32(&state->next_chunk, 0);
+	pg_atomic_init_u32(&state->chunks_failed, 0);
+	state->verbose_log = verbose_log;
+	state->useam_isnull = useam_isnull;
+	state->useam = useam;
+	state->deadline = deadline;
+	state->nchunks = nchunks;
+	memcpy(state->chunks, chunks, sizeof(Oid) * nchunks);
+
+	for (int i = 0; i < Min(max_workers, nchunks); i++)
+	{
+		BackgroundWorkerHandle *handle = ts_bgw_job_start_helper(job_id, dsm_segment_handle(seg));
+
+		if (handle == NULL)
+			break;
+
+		helpers = lappend(helpers, handle);
+	}
+
+	if (helpers == NIL)
+	{
+		elog(LOG, "job %d could not start workers to compress chunks in parallel", job_id);
+		dsm_detach(seg);
+		return -1;
+	}
+
+	elog(DEBUG1,
+		 "job %d compressing %d chunks in %d workers",
+		 job_id,
+		 nchunks,
+		 list_length(helpers));
+
+	PG_TRY();
+	{
+		while (helpers != NIL)
+		{
+			ts_bgw_job_wait_for_helper(linitial(helpers));
+			helpers = list_delete_first(helpers);
+		}
+	}
+	PG_CATCH();
+	{
+		ListCell *lc;
+
+		/* Don't leave the helpers running when the job is canceled */
+		foreach (lc, helpers)
+			ts_bgw_job_terminate_helper(lfirst(lc));
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	/* The chunks that were not taken by a helper, e.g., because the helpers
+	 * failed to start, count as failed, unless the deadline passed */
+	chunks_taken = Min(pg_atomic_read_u32(&state->next_chunk), (uint32) nchunks);
+	chunks_failed = pg_atomic_read_u32(&state->chunks_failed);
+
+	if (GetCurrentTimestamp() < deadline)
+		chunks_failed += nchunks - chunks_taken;
+	else if (chunks_taken < (uint32) nchunks)
+		elog(LOG,
+			 "job %d reached its time budget, %u chunks are left to compress",
+			 job_id,
+			 nchunks - chunks_taken);
+	dsm_detach(seg);
+
+	return chunks_failed;
+}
+
+/*
+ * Compress one chunk of a parallel compression policy as compress_chunk()
+ * would do it when called by the compression policy.
+ */
+static void
+policy_compression_helper_compress_chunk(PolicyCompressionParallelState *state, Oid chunk_relid)
+{
+	LOCAL_FCINFO(fcinfo, 4);
+
+	InitFunctionCallInfoData(*fcinfo, NULL, 4, InvalidOid, NULL, NULL);
+	fcinfo->args[0].value = ObjectIdGetDatum(chunk_relid);
+	fcinfo->args[0].isnull = false;
+	/* if_not_compressed */
+	fcinfo->args[1].value = BoolGetDatum(true);
+	fcinfo->args[1].isnull = false;
+	/* recompress */
+	fcinfo->args[2].value = BoolGetDatum(false);
+	fcinfo->args[2].isnull = false;
+	/* hypercore_use_access_method */
+	fcinfo->args[3].value = BoolGetDatum(state->useam);
+	fcinfo->args[3].isnull = state->useam_isnull;
+
+	tsl_compress_chunk(fcinfo);
+}
+
+/*
+ * Main function of the helper workers of a compression policy, see
+ * policy_compression_execute_parallel_chunks(). A chunk that fails to
+ * compress is reported as a warning and counted, the same as in the
+ * compression policy, and the helper continues with the next chunk.
+ */
+void
+policy_compression_helper_main(int32 job_id, dsm_handle handle)
+{
+	MemoryContext helper_mcxt =
+		AllocSetContextCreate(TopMemoryContext, "CompressionPolicyHelper", ALLOCSET_DEFAULT_SIZES);
+	PolicyCompressionParallelState *state;
+	dsm_segment *seg;
+
+	seg = dsm_attach(handle);
+
+	/* The job is gone already */
+	if (seg == NULL)
+		return;
+
+	dsm_pin_mapping(seg);
+	state = dsm_segment_address(seg);
+
+	for (;;)
+	{
+		uint32 next;
+		Oid chunk_relid;
+		Oid chunk_nspid;
+		char *chunk_name;
+
+		if (GetCurrentTimestamp() >= state->deadline)
+			break;
+
+		next = pg_atomic_fetch_add_u32(&state->next_chunk, 1);
+
+		if (next >= (uint32) state->nchunks)
+			break;
+
+		chunk_relid = state->chunks[next];
+		MemoryContextReset(helper_mcxt);
+
+		StartTransactionCommand();
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		/* The chunk might have been dropped since the job listed it */
+		chunk_nspid = get_rel_namespace(chunk_relid);
+		if (!OidIsValid(chunk_nspid))
+		{
+			PopActiveSnapshot();
+			CommitTransactionCommand();
+			continue;
+		}
+
+		chunk_name = MemoryContextStrdup(helper_mcxt,
+										 quote_qualified_identifier(get_namespace_name(chunk_nspid),
+																	get_rel_name(chunk_relid)));
+
+		PG_TRY();
+		{
+			policy_compression_helper_compress_chunk(state, chunk_relid);
+			PopActiveSnapshot();
+			CommitTransactionCommand();
+		}
+		PG_CATCH();
+		{
+			ErrorData *edata;
+
+			MemoryContextSwitchTo(helper_mcxt);
+			edata = CopyErrorData();
+			FlushErrorState();
+			AbortCurrentTransaction();
+
+			ereport(WARNING,
+					(errcode(edata->sqlerrcode),
+					 errmsg("compressing chunk \"%s\" failed when compression policy is executed",
+							chunk_name),
+					 errdetail("Message: (%s), Detail: (%s).",
+							   edata->message,
+							   edata->detail ? edata->detail : "")));
+			pg_atomic_fetch_add_u32(&state->chunks_failed, 1);
+		}
+		PG_END_TRY();
+
+		if (state->verbose_log)
+			elog(LOG, "job %d completed processing chunk %s", job_id, chunk_name);
+	}
+
+	dsm_detach(seg);
+}
+
+void
+policy_precreate_chunks_read_and_validate_config(Jsonb *config,
+												 PolicyPrecreateChunksData *policy_data)
+{
+	int32 htid = policy_precreate_chunks_get_hypertable_id(config);
+	int32 chunks_ahead = policy_precreate_chunks_get_chunks_ahead(config);
+	Hypertable *ht = ts_hypertable_get_by_id(htid);
+
+	if (!ht)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("configuration hypertable id %d not found", htid)));
+
+	policy_precreate_chunks_check_hypertable(ht);
+
+	if (policy_data)
+	{
+		policy_data->hypertable = ht;
+		policy_data->chunks_ahead = chunks_ahead;
+	}
+}
+
+/*
+ * Returns the current time as the internal time of the dimension.
+ */
+static int64
+get_open_dimension_now(const Dimension *dim)
+{
+	Oid partitioning_type = ts_dimension_get_partition_type(dim);
+
+	if (IS_INTEGER_TYPE(partitioning_type))
+		return ts_sub_integer_from_now(0, partitioning_type, ts_get_integer_now_func(dim, true));
+
+	return ts_time_value_to_internal(TimestampTzGetDatum(GetCurrentTransactionStartTimestamp()),
+									 TIMESTAMPTZOID);
+}
+
+/*
+ * Create the chunks that contain the given time, one for every combination
+ * of the partitions of the closed dimensions. Returns the number of created
+ * chunks.
+ */
+static int
+precreate_chunks_for_time(const Hypertable *ht, int64 time)
+{
+	const Hyperspace *hs = ht->space;
+	Point *point = ts_point_create(hs->num_dimensions);
+	int16 *partitions = palloc0(sizeof(int16) * hs->num_dimensions);
+	int created = 0;
+
+	for (;;)
+	{
+		int i;
+
+		point->num_coords = 0;
+		for (i = 0; i < hs->num_dimensions; i++)
+		{
+			const Dimension *dim = &hs->dimensions[i];
+
+			/* Use the start of the slice of the partition as the coordinate */
+			if (IS_OPEN_DIMENSION(dim))
+				point->coordinates[point->num_coords++] = time;
+			else
+				point->coordinates[point->num_coords++] =
+					partitions[i] * (DIMENSION_SLICE_CLOSED_MAX / dim->fd.num_slices);
+		}
+
+		/* Look for the chunk without locking first, same as the inserts */
+		if (ts_hypertable_find_chunk_for_point(ht, point) == NULL)
+		{
+			bool found;
+			Chunk *chunk = ts_hypertable_create_chunk_for_point(ht, point, &found);
+
+			if (!found)
+			{
+				elog(DEBUG1,
+					 "created chunk \"%s.%s\" ahead of time",
+					 NameStr(chunk->fd.schema_name),
+					 NameStr(chunk->fd.table_name));
+				created++;
+			}
+		}
+
+		/* Advance to the next combination of the closed dimension partitions */
+		for (i = 0; i < hs->num_dimensions; i++)
+		{
+			const Dimension *dim = &hs->dimensions[i];
+
+			if (IS_CLOSED_DIMENSION(dim) && ++partitions[i] < dim->fd.num_slices)
+				break;
+			partitions[i] = 0;
+		}
+
+		if (i == hs->num_dimensions)
+			break;
+	}
+
+	pfree(partitions);
+	pfree(point);
+
+	return created;
+}
+
+/*
+ * Create the chunks for the current chunk interval and the given number of
+ * intervals after it, unless they exist already.
+ */
+bool
+policy_precreate_chunks_execute(int32 job_id, Jsonb *config)
+{
+	PolicyPrecreateChunksData policy_data;
+	int created = 0;
+
+	policy_precreate_chunks_read_and_validate_config(config, &policy_data);
+
+	const Hypertable *ht = policy_data.hypertable;
+	const Dimension *dim = hyperspace_get_open_dimension(ht->space, 0);
+	const int64 max_time = ts_time_get_max(ts_dimension_get_partition_type(dim));
+	int64 time = get_open_dimension_now(dim);
+
+	for (int i = 0; i <= policy_data.chunks_ahead; i++)
+	{
+		created += precreate_chunks_for_time(ht, time);
+
+		if (pg_add_s64_overflow(time, dim->fd.interval_length, &time) || time > max_time)
+			break;
+	}
+
+	elog(DEBUG1,
+		 "job %d created %d chunks ahead of time for hypertable \"%s.%s\"",
+		 job_id,
+		 created,
+		 NameStr(ht->fd.schema_name),
+		 NameStr(ht->fd.table_name));
+
+	return true;
+}
+
+void
+policy_merge_chunks_read_and_validate_config(Jsonb *config, PolicyMergeChunksData *policy_data)
+{
+	int32 htid = policy_merge_chunks_get_hypertable_id(config);
+	int64 target_size = policy_merge_chunks_get_target_size(config);
+	Hypertable *ht = ts_hypertable_get_by_id(htid);
+
+	if (!ht)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("configuration hypertable id %d not found", htid)));
+
+	policy_merge_chunks_check_hypertable(ht);
+
+	if (policy_data)
+	{
+		policy_data->hypertable = ht;
+		policy_data->target_size = target_size;
+	}
+}
+
+typedef struct MergeCandidate
+{
+	Chunk *chunk;
+	int64 size;
+	CompressionSettings *settings; /* NULL for uncompressed chunks */
+} MergeCandidate;
+
+/*
+ * Order the candidates by the slices of the closed dimensions and then by the
+ * start of the time slice, so that the chunks that can be merged with each
+ * other follow each other.
+ */
+static int
+merge_candidate_cmp(const void *left, const void *right, void *arg)
+{
+	const Hypercube *lcube = ((const MergeCandidate *) left)->chunk->cube;
+	const Hypercube *rcube = ((const MergeCandidate *) right)->chunk->cube;
+	int time_index = *(int *) arg;
+
+	for (int i = 0; i < lcube->num_slices; i++)
+	{
+		const DimensionSlice *lslice = lcube->slices[i];
+		const DimensionSlice *rslice = rcube->slices[i];
+
+		if (i == time_index)
+			continue;
+
+		if (lslice->fd.range_start != rslice->fd.range_start)
+			return lslice->fd.range_start < rslice->fd.range_start ? -1 : 1;
+	}
+
+	if (lcube->slices[time_index]->fd.range_start != rcube->slices[time_index]->fd.range_start)
+		return lcube->slices[time_index]->fd.range_start <
+					   rcube->slices[time_index]->fd.range_start ?
+				   -1 :
+				   1;
+
+	return 0;
+}
+
+/*
+ * Check that the chunk can be appended to a merge that ends with the previous
+ * chunk: the time slices must follow each other, the other slices must be the
+ * same, and the chunks must have the same compression state and settings.
+ */
+static bool
+merge_candidates_adjacent(const MergeCandidate *prev, const MergeCandidate *next, int time_index)
+{
+	const Hypercube *pcube = prev->chunk->cube;
+	const Hypercube *ncube = next->chunk->cube;
+
+	for (int i = 0; i < pcube->num_slices; i++)
+	{
+		if (i == time_index)
+		{
+			if (pcube->slices[i]->fd.range_end != ncube->slices[i]->fd.range_start)
+				return false;
+		}
+		else if (!ts_dimension_slices_equal(pcube->slices[i], ncube->slices[i]))
+			return false;
+	}
+
+	if ((prev->settings == NULL) != (next->settings == NULL))
+		return false;
+
+	return prev->settings == NULL || ts_compression_settings_equal(prev->settings, next->settings);
+}
+
+/*
+ * Gather the chunks of the hypertable that are smaller than the target size
+ * and that ended before the current time, in the order of
+ * merge_candidate_cmp(). Chunks that merge_chunks() can't handle, and
+ * partially compressed chunks, are left out.
+ */
+static MergeCandidate *
+merge_chunks_gather(const Hypertable *ht, int64 target_size, int *time_index, int *ncandidates)
+{
+	const Dimension *dim = hyperspace_get_open_dimension(ht->space, 0);
+	int64 now = get_open_dimension_now(dim);
+	List *chunk_ids = ts_chunk_get_chunk_ids_by_hypertable_id(ht->fd.id);
+	MergeCandidate *candidates = palloc(sizeof(MergeCandidate) * (list_length(chunk_ids) + 1));
+	ListCell *lc;
+	int n = 0;
+
+	/* The slices of the hypercubes are in the order of the dimension ids */
+	*time_index = 0;
+	for (int i = 0; i < ht->space->num_dimensions; i++)
+	{
+		if (ht->space->dimensions[i].fd.id < dim->fd.id)
+			(*time_index)++;
+	}
+
+	foreach (lc, chunk_ids)
+	{
+		Chunk *chunk = ts_chunk_get_by_id(lfirst_int(lc), false);
+		MergeCandidate *candidate = &candidates[n];
+
+		if (chunk == NULL || chunk->fd.dropped || chunk->fd.osm_chunk ||
+			ts_chunk_is_frozen(chunk) || ts_chunk_is_partial(chunk) ||
+			chunk->cube->num_slices != ht->space->num_dimensions ||
+			chunk->cube->slices[*time_index]->fd.range_end > now)
+			continue;
+
+		candidate->chunk = chunk;
+		candidate->size = ts_relation_size_impl(chunk->table_id).total_size;
+		candidate->settings = NULL;
+
+		if (chunk->fd.compressed_chunk_id != INVALID_CHUNK_ID)
+		{
+			Oid crelid = ts_chunk_get_relid(chunk->fd.compressed_chunk_id, false);
+
+			candidate->size += ts_relation_size_impl(crelid).total_size;
+			candidate->settings = ts_compression_settings_get(chunk->table_id);
+
+			if (candidate->settings == NULL)
+				continue;
+		}
+
+		if (candidate->size >= target_size)
+			continue;
+
+		n++;
+	}
+
+	qsort_arg(candidates, n, sizeof(MergeCandidate), merge_candidate_cmp, time_index);
+	*ncandidates = n;
+	return candidates;
+}
+
+static void
+merge_chunks_run(int32 job_id, const MergeCandidate *run, int nchunks, int64 size)
+{
+	Datum *relids = palloc(sizeof(Datum) * nchunks);
+
+	for (int i = 0; i < nchunks; i++)
+		relids[i] = ObjectIdGetDatum(run[i].chunk->table_id);
+
+	ArrayType *chunks_array =
+		construct_array(relids, nchunks, REGCLASSOID, sizeof(Oid), true, TYPALIGN_INT);
+
+	elog(LOG,
+		 "job %d merging %d chunks starting with \"%s.%s\" into " INT64_FORMAT " bytes",
+		 job_id,
+		 nchunks,
+		 NameStr(run[0].chunk->fd.schema_name),
+		 NameStr(run[0].chunk->fd.table_name),
+		 size);
+
+	DirectFunctionCall1(chunk_merge_chunks, PointerGetDatum(chunks_array));
+	pfree(chunks_array);
+	pfree(relids);
+}
+
+/*
+ * Merge runs of adjacent chunks that are smaller than the target size, as
+ * long as the merged chunk stays within the target size. The runs don't
+ * overlap, so they are planned up front. When called non-atomically, we
+ * commit after every merge to release the locks on the merged chunks.
+ */
+bool
+policy_merge_chunks_execute(int32 job_id, Jsonb *config, bool nonatomic)
+{
+	PolicyMergeChunksData policy_data;
+	MergeCandidate *candidates;
+	int ncandidates;
+	int time_index;
+	int run_start = 0;
+	int64 run_size = 0;
+	int merged = 0;
+	int rc;
+
+	/* Allocate the candidates in the SPI procedure context to keep them across commits */
+	if (nonatomic)
+	{
+		rc = SPI_connect_ext(SPI_OPT_NONATOMIC);
+		if (rc != SPI_OK_CONNECT)
+			elog(ERROR, "SPI_connect failed: %s", SPI_result_code_string(rc));
+	}
+
+	policy_merge_chunks_read_and_validate_config(config, &policy_data);
+	candidates = merge_chunks_gather(policy_data.hypertable,
+									 policy_data.target_size,
+									 &time_index,
+									 &ncandidates);
+
+	for (int i = 0; i <= ncandidates; i++)
+	{
+		if (i < ncandidates && i > run_start &&
+			merge_candidates_adjacent(&candidates[i - 1], &candidates[i], time_index) &&
+			run_size + candidates[i].size <= policy_data.target_size)
+		{
+			run_size += candidates[i].size;
+			continue;
+		}
+
+		if (i - run_start > 1)
+		{
+			merge_chunks_run(job_id, &candidates[run_start], i - run_start, run_size);
+			merged += i - run_start;
+
+			if (nonatomic)
+				SPI_commit_and_chain();
+		}
+
+		run_start = i;
+		run_size = i < ncandidates ? candidates[i].size : 0;
+	}
+
+	elog(DEBUG1,
+		 "job %d merged %d chunks of hypertable \"%s.%s\"",
+		 job_id,
+		 merged,
+		 NameStr(policy_data.hypertable->fd.schema_name),
+		 NameStr(policy_data.hypertable->fd.table_name));
+
+	if (nonatomic)
+	{
+		rc = SPI_finish();
+		if (rc != SPI_OK_FINISH)
+			elog(ERROR, "SPI_finish failed: %s", SPI_result_code_string(rc));
+	}
+
+	return true;
+}
+
 static void
 job_execute_function(FuncExpr *funcexpr)
 {
@@ -48,6 +48,18 @@ typedef struct PolicyCompressionData
 	Cache *hcache;
 } PolicyCompressionData;
 
+typedef struct PolicyPrecreateChunksData
+{
+	Hypertable *hypertable;
+	int32 chunks_ahead;
+} PolicyPrecreateChunksData;
+
+typedef struct PolicyMergeChunksData
+{
+	Hypertable *hypertable;
+	int64 target_size;
+} PolicyMergeChunksData;
+
 /* Reorder function type. Necessary for testing */
 typedef void (*reorder_func)(Oid tableOid, Oid indexOid, bool verbose, Oid wait_id,
 							 Oid destination_tablespace, Oid index_tablespace);
@@ -55,8 +67,11 @@ typedef void (*reorder_func)(Oid tableOid, Oid indexOid, bool verbose, Oid wait_
 /* Functions exposed only for testing */
 extern bool policy_reorder_execute(int32 job_id, Jsonb *config);
 extern bool policy_retention_execute(int32 job_id, Jsonb *config);
+extern bool policy_retention_batch_execute(int32 job_id, Jsonb *config, bool nonatomic);
 extern bool policy_refresh_cagg_execute(int32 job_id, Jsonb *config);
 extern bool policy_recompression_execute(int32 job_id, Jsonb *config);
+extern bool policy_precreate_chunks_execute(int32 job_id, Jsonb *config);
+extern bool policy_merge_chunks_execute(int32 job_id, Jsonb *config, bool nonatomic);
 extern void policy_reorder_read_and_validate_config(Jsonb *config, PolicyReorderData *policy_data);
 extern void policy_retention_read_and_validate_config(Jsonb *config,
 													  PolicyRetentionData *policy_data);
@@ -66,4 +81,13 @@ extern void policy_compression_read_and_validate_config(Jsonb *config,
 														PolicyCompressionData *policy_data);
 extern void policy_recompression_read_and_validate_config(Jsonb *config,
 														  PolicyCompressionData *policy_data);
+extern void policy_precreate_chunks_read_and_validate_config(Jsonb *config,
+															 PolicyPrecreateChunksData *policy_data);
+extern void policy_merge_chunks_read_and_validate_config(Jsonb *config,
+														 PolicyMergeChunksData *policy_data);
+extern int policy_compression_execute_parallel_chunks(int32 job_id, const Oid *chunks,
+													  int nchunks, int max_workers,
+													  bool verbose_log, bool useam_isnull,
+													  bool useam, TimestampTz deadline);
+extern void policy_compression_helper_main(int32 job_id, dsm_handle handle);
 extern bool job_execute(BgwJob *job);
@@ -0,0 +1,339 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Policy that merges adjacent small chunks of a hypertable into chunks of a
+ * target size. Hypertables with a chunk interval that is too small for their
+ * data, or with sparse data, end up with many tiny chunks, and every chunk
+ * adds planning and execution overhead. The merge itself is done by
+ * merge_chunks(), which concatenates the compressed batches of compressed
+ * chunks without decompressing them and updates the dimension slices in the
+ * same transaction.
+ */
+
+#include <postgres.h>
+#include <miscadmin.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+
+#include <compat/compat.h>
+#include <dimension.h>
+#include <hypertable_cache.h>
+#include <jsonb_utils.h>
+
+#include "bgw/job.h"
+#include "bgw/job_stat.h"
+#include "bgw/timer.h"
+#include "bgw_policy/job.h"
+#include "bgw_policy/job_api.h"
+#include "bgw_policy/merge_chunks_api.h"
+#include "errors.h"
+#include "guc.h"
+#include "hypertable.h"
+#include "time_utils.h"
+#include "utils.h"
+
+#define DEFAULT_SCHEDULE_INTERVAL                                                                  \
+	{                                                                                              \
+		.day = 1                                                                                   \
+	}
+
+/* Default max runtime for a merge chunks job is unlimited for now */
+#define DEFAULT_MAX_RUNTIME                                                                        \
+	DatumGetIntervalP(DirectFunctionCall3(interval_in, CStringGetDatum("0"), InvalidOid, -1))
+
+/* Default retry period for merge chunks jobs is currently 1 hour */
+#define DEFAULT_RETRY_PERIOD                                                                       \
+	DatumGetIntervalP(DirectFunctionCall3(interval_in, CStringGetDatum("1 hour"), InvalidOid, -1))
+
+#define CONFIG_KEY_HYPERTABLE_ID "hypertable_id"
+#define CONFIG_KEY_TARGET_SIZE "target_size"
+
+#define POLICY_MERGE_CHUNKS_PROC_NAME "policy_merge_chunks"
+#define POLICY_MERGE_CHUNKS_CHECK_NAME "policy_merge_chunks_check"
+
+int32
+policy_merge_chunks_get_hypertable_id(const Jsonb *config)
+{
+	bool found;
+	int32 hypertable_id = ts_jsonb_get_int32_field(config, CONFIG_KEY_HYPERTABLE_ID, &found);
+
+	if (!found)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not find hypertable_id in config for job")));
+
+	return hypertable_id;
+}
+
+int64
+policy_merge_chunks_get_target_size(const Jsonb *config)
+{
+	bool found;
+	int64 target_size = ts_jsonb_get_int64_field(config, CONFIG_KEY_TARGET_SIZE, &found);
+
+	if (!found)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not find target_size in config for job")));
+
+	if (target_size <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid target size for merged chunks: " INT64_FORMAT, target_size),
+				 errhint("The target size must be greater than zero.")));
+
+	return target_size;
+}
+
+/*
+ * Check that we can tell which chunks are still receiving data.
+ *
+ * Only the chunks that end before the current time are merged, so integer
+ * time dimensions need an integer_now function.
+ */
+void
+policy_merge_chunks_check_hypertable(const Hypertable *ht)
+{
+	if (TS_HYPERTABLE_IS_INTERNAL_COMPRESSION_TABLE(ht))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot add merge chunks policy to compressed hypertable \"%s\"",
+						get_rel_name(ht->main_table_relid)),
+				 errhint("Please add the policy to the corresponding uncompressed hypertable "
+						 "instead.")));
+
+	const Dimension *dim = hyperspace_get_open_dimension(ht->space, 0);
+	Oid partitioning_type = ts_dimension_get_partition_type(dim);
+
+	if (IS_INTEGER_TYPE(partitioning_type))
+	{
+		if (!OidIsValid(ts_get_integer_now_func(dim, false)))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("missing integer_now function for hypertable \"%s\"",
+							get_rel_name(ht->main_table_relid)),
+					 errhint("Set an integer_now function with set_integer_now_func().")));
+	}
+	else if (!IS_TIMESTAMP_TYPE(partitioning_type))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot add merge chunks policy to hypertable \"%s\"",
+						get_rel_name(ht->main_table_relid)),
+				 errdetail("The time dimension has type %s, which is not supported.",
+						   format_type_be(partitioning_type))));
+}
+
+Datum
+policy_merge_chunks_check(PG_FUNCTION_ARGS)
+{
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	if (PG_ARGISNULL(0))
+	{
+		ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg("config must not be NULL")));
+	}
+
+	policy_merge_chunks_read_and_validate_config(PG_GETARG_JSONB_P(0), NULL);
+
+	PG_RETURN_VOID();
+}
+
+Datum
+policy_merge_chunks_proc(PG_FUNCTION_ARGS)
+{
+	bool nonatomic;
+
+	if (PG_NARGS() != 2 || PG_ARGISNULL(0) || PG_ARGISNULL(1))
+		PG_RETURN_VOID();
+
+	ts_feature_flag_check(FEATURE_POLICY);
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	/* We can only commit between the merges when called with CALL */
+	nonatomic = fcinfo->context != NULL && IsA(fcinfo->context, CallContext) &&
+				!castNode(CallContext, fcinfo->context)->atomic;
+
+	policy_merge_chunks_execute(PG_GETARG_INT32(0), PG_GETARG_JSONB_P(1), nonatomic);
+
+	PG_RETURN_VOID();
+}
+
+Datum
+policy_merge_chunks_add(PG_FUNCTION_ARGS)
+{
+	/* behave like a strict function */
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(1) || PG_ARGISNULL(2))
+		PG_RETURN_NULL();
+
+	NameData application_name;
+	NameData proc_name, proc_schema, check_name, check_schema;
+	int32 job_id;
+	Interval schedule_interval = DEFAULT_SCHEDULE_INTERVAL;
+	Oid ht_oid = PG_GETARG_OID(0);
+	int64 target_size = DatumGetInt64(DirectFunctionCall1(pg_size_bytes, PG_GETARG_DATUM(1)));
+	bool if_not_exists = PG_GETARG_BOOL(2);
+	Interval *user_schedule_interval = PG_ARGISNULL(3) ? NULL : PG_GETARG_INTERVAL_P(3);
+	Cache *hcache;
+	Hypertable *ht;
+	int32 hypertable_id;
+	Oid owner_id;
+	List *jobs;
+	TimestampTz initial_start = PG_ARGISNULL(4) ? DT_NOBEGIN : PG_GETARG_TIMESTAMPTZ(4);
+	bool fixed_schedule = !PG_ARGISNULL(4);
+	text *timezone = PG_ARGISNULL(5) ? NULL : PG_GETARG_TEXT_PP(5);
+	char *valid_timezone = NULL;
+
+	ts_feature_flag_check(FEATURE_POLICY);
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	if (target_size <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid target size for merged chunks: " INT64_FORMAT, target_size),
+				 errhint("The target size must be greater than zero.")));
+
+	if (timezone != NULL)
+		valid_timezone = ts_bgw_job_validate_timezone(PG_GETARG_DATUM(5));
+
+	ht = ts_hypertable_cache_get_cache_and_entry(ht_oid, CACHE_FLAG_NONE, &hcache);
+	Assert(ht != NULL);
+	hypertable_id = ht->fd.id;
+
+	/* First verify that the hypertable corresponds to a valid table */
+	owner_id = ts_hypertable_permissions_check(ht_oid, GetUserId());
+
+	policy_merge_chunks_check_hypertable(ht);
+
+	/* Verify that the hypertable owner can create a background worker */
+	ts_bgw_job_validate_job_owner(owner_id);
+
+	/* Make sure that an existing merge chunks policy doesn't exist on this hypertable */
+	jobs = ts_bgw_job_find_by_proc_and_hypertable_id(POLICY_MERGE_CHUNKS_PROC_NAME,
+													 FUNCTIONS_SCHEMA_NAME,
+													 ht->fd.id);
+
+	ts_cache_release(hcache);
+
+	if (user_schedule_interval != NULL)
+		schedule_interval = *user_schedule_interval;
+
+	if (jobs != NIL)
+	{
+		BgwJob *existing = linitial(jobs);
+		Assert(list_length(jobs) == 1);
+
+		if (!if_not_exists)
+			ereport(ERROR,
+					(errcode(ERRCODE_DUPLICATE_OBJECT),
+					 errmsg("merge chunks policy already exists for hypertable \"%s\"",
+							get_rel_name(ht_oid))));
+
+		if (policy_merge_chunks_get_target_size(existing->fd.config) != target_size)
+		{
+			ereport(WARNING,
+					(errmsg("merge chunks policy already exists for hypertable \"%s\"",
+							get_rel_name(ht_oid)),
+					 errdetail("A policy already exists with different arguments."),
+					 errhint("Remove the existing policy before adding a new one.")));
+			PG_RETURN_INT32(-1);
+		}
+		/* If all arguments are the same, do nothing */
+		ereport(NOTICE,
+				(errmsg("merge chunks policy already exists on hypertable \"%s\", skipping",
+						get_rel_name(ht_oid))));
+		PG_RETURN_INT32(-1);
+	}
+
+	/* if users pass in -infinity for initial_start, then use the current_timestamp instead */
+	if (fixed_schedule)
+	{
+		ts_bgw_job_validate_schedule_interval(&schedule_interval);
+		if (TIMESTAMP_NOT_FINITE(initial_start))
+			initial_start = ts_timer_get_current_timestamp();
+	}
+
+	/* Next, insert a new job into jobs table */
+	namestrcpy(&application_name, "Merge Chunks Policy");
+	namestrcpy(&proc_name, POLICY_MERGE_CHUNKS_PROC_NAME);
+	namestrcpy(&proc_schema, FUNCTIONS_SCHEMA_NAME);
+	namestrcpy(&check_name, POLICY_MERGE_CHUNKS_CHECK_NAME);
+	namestrcpy(&check_schema, FUNCTIONS_SCHEMA_NAME);
+
+	JsonbParseState *parse_state = NULL;
+
+	pushJsonbValue(&parse_state, WJB_BEGIN_OBJECT, NULL);
+	ts_jsonb_add_int32(parse_state, CONFIG_KEY_HYPERTABLE_ID, hypertable_id);
+	ts_jsonb_add_int64(parse_state, CONFIG_KEY_TARGET_SIZE, target_size);
+	JsonbValue *result = pushJsonbValue(&parse_state, WJB_END_OBJECT, NULL);
+	Jsonb *config = JsonbValueToJsonb(result);
+
+	job_id = ts_bgw_job_insert_relation(&application_name,
+										&schedule_interval,
+										DEFAULT_MAX_RUNTIME,
+										JOB_RETRY_UNLIMITED,
+										DEFAULT_RETRY_PERIOD,
+										&proc_schema,
+										&proc_name,
+										&check_schema,
+										&check_name,
+										owner_id,
+										true,
+										fixed_schedule,
+										hypertable_id,
+										config,
+										initial_start,
+										valid_timezone);
+
+	if (!TIMESTAMP_NOT_FINITE(initial_start))
+		ts_bgw_job_stat_upsert_next_start(job_id, initial_start);
+
+	PG_RETURN_INT32(job_id);
+}
+
+Datum
+policy_merge_chunks_remove(PG_FUNCTION_ARGS)
+{
+	Oid hypertable_oid = PG_GETARG_OID(0);
+	bool if_exists = PG_GETARG_BOOL(1);
+	Hypertable *ht;
+	Cache *hcache;
+
+	ts_feature_flag_check(FEATURE_POLICY);
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	ht = ts_hypertable_cache_get_cache_and_entry(hypertable_oid, CACHE_FLAG_NONE, &hcache);
+
+	List *jobs = ts_bgw_job_find_by_proc_and_hypertable_id(POLICY_MERGE_CHUNKS_PROC_NAME,
+														   FUNCTIONS_SCHEMA_NAME,
+														   ht->fd.id);
+	ts_cache_release(hcache);
+
+	if (jobs == NIL)
+	{
+		if (!if_exists)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_OBJECT),
+					 errmsg("merge chunks policy not found for hypertable \"%s\"",
+							get_rel_name(hypertable_oid))));
+		else
+		{
+			ereport(NOTICE,
+					(errmsg("merge chunks policy not found for hypertable \"%s\", skipping",
+							get_rel_name(hypertable_oid))));
+			PG_RETURN_NULL();
+		}
+	}
+	Assert(list_length(jobs) == 1);
+	BgwJob *job = linitial(jobs);
+
+	ts_hypertable_permissions_check(hypertable_oid, GetUserId());
+
+	ts_bgw_job_delete_by_id(job->fd.id);
+
+	PG_RETURN_NULL();
+}
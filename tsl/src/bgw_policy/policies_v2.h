@@ -30,15 +30,20 @@
 #define POL_COMPRESSION_CONF_KEY_MAXCHUNKS_TO_COMPRESS "maxchunks_to_compress"
 #define POL_COMPRESSION_CONF_KEY_COMPRESS_CREATED_BEFORE "compress_created_before"
 #define POL_COMPRESSION_CONF_KEY_USE_ACCESS_METHOD "hypercore_use_access_method"
+#define POL_COMPRESSION_CONF_KEY_MAX_PARALLEL_CHUNKS "max_parallel_chunks"
+#define POL_COMPRESSION_CONF_KEY_CHUNK_SELECTION "chunk_selection"
+#define POL_COMPRESSION_CONF_KEY_TIME_BUDGET "time_budget"
 
 #define POLICY_RECOMPRESSION_PROC_NAME "policy_recompression"
 #define POL_RECOMPRESSION_CONF_KEY_RECOMPRESS_AFTER "recompress_after"
 
 #define POLICY_RETENTION_PROC_NAME "policy_retention"
+#define POLICY_RETENTION_BATCH_PROC_NAME "policy_retention_batch"
 #define POLICY_RETENTION_CHECK_NAME "policy_retention_check"
 #define POL_RETENTION_CONF_KEY_HYPERTABLE_ID "hypertable_id"
 #define POL_RETENTION_CONF_KEY_DROP_AFTER "drop_after"
 #define POL_RETENTION_CONF_KEY_DROP_CREATED_BEFORE "drop_created_before"
+#define POL_RETENTION_BATCH_CONF_KEY_MAX_CHUNKS_PER_BATCH "max_chunks_per_batch"
 
 #define SHOW_POLICY_KEY_HYPERTABLE_ID "hypertable_id"
 #define SHOW_POLICY_KEY_POLICY_NAME "policy_name"
@@ -8,6 +8,7 @@
 #include <access/xact.h>
 #include <catalog/pg_type.h>
 #include <miscadmin.h>
+#include <nodes/parsenodes.h>
 #include <utils/builtins.h>
 #include <utils/lsyscache.h>
 #include <utils/syscache.h>
@@ -59,6 +60,62 @@ policy_retention_check(PG_FUNCTION_ARGS)
 	PG_RETURN_VOID();
 }
 
+/*
+ * Apply the retention policies that are not scheduled themselves in one job,
+ * see policy_retention_batch_execute().
+ */
+Datum
+policy_retention_batch_proc(PG_FUNCTION_ARGS)
+{
+	bool nonatomic;
+
+	if (PG_NARGS() != 2 || PG_ARGISNULL(0) || PG_ARGISNULL(1))
+		PG_RETURN_VOID();
+
+	ts_feature_flag_check(FEATURE_POLICY);
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	/* We can only commit between the batches when called with CALL */
+	nonatomic = fcinfo->context != NULL && IsA(fcinfo->context, CallContext) &&
+				!castNode(CallContext, fcinfo->context)->atomic;
+
+	policy_retention_batch_execute(PG_GETARG_INT32(0), PG_GETARG_JSONB_P(1), nonatomic);
+
+	PG_RETURN_VOID();
+}
+
+Datum
+policy_retention_batch_check(PG_FUNCTION_ARGS)
+{
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	if (PG_ARGISNULL(0))
+	{
+		ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg("config must not be NULL")));
+	}
+
+	policy_retention_batch_get_max_chunks_per_batch(PG_GETARG_JSONB_P(0));
+
+	PG_RETURN_VOID();
+}
+
+int32
+policy_retention_batch_get_max_chunks_per_batch(const Jsonb *config)
+{
+	bool found;
+	int32 max_chunks_per_batch =
+		ts_jsonb_get_int32_field(config, POL_RETENTION_BATCH_CONF_KEY_MAX_CHUNKS_PER_BATCH, &found);
+
+	if (found && max_chunks_per_batch < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid value for parameter %s",
+						POL_RETENTION_BATCH_CONF_KEY_MAX_CHUNKS_PER_BATCH),
+				 errhint("The number of chunks to drop per transaction must not be negative.")));
+
+	return found ? max_chunks_per_batch : 0;
+}
+
 int32
 policy_retention_get_hypertable_id(const Jsonb *config)
 {
@@ -12,11 +12,14 @@ extern Datum policy_retention_add(PG_FUNCTION_ARGS);
 extern Datum policy_retention_proc(PG_FUNCTION_ARGS);
 extern Datum policy_retention_check(PG_FUNCTION_ARGS);
 extern Datum policy_retention_remove(PG_FUNCTION_ARGS);
+extern Datum policy_retention_batch_proc(PG_FUNCTION_ARGS);
+extern Datum policy_retention_batch_check(PG_FUNCTION_ARGS);
 
 int32 policy_retention_get_hypertable_id(const Jsonb *config);
 int64 policy_retention_get_drop_after_int(const Jsonb *config);
 Interval *policy_retention_get_drop_after_interval(const Jsonb *config);
 Interval *policy_retention_get_drop_created_before_interval(const Jsonb *config);
+int32 policy_retention_batch_get_max_chunks_per_batch(const Jsonb *config);
 
 Datum policy_retention_add_internal(Oid ht_oid, Oid window_type, Datum window_datum,
 									Interval *created_before, Interval default_schedule_interval,
@@ -344,6 +344,83 @@ add_partially_aggregated_subpaths(PlannerInfo *root, PathTarget *input_target,
 	}
 }
 
+/*
+ * Use partial paths for the large chunks of a Parallel Append.
+ *
+ * Each non-partial subpath of a Parallel Append is executed by a single
+ * worker. When a chunk costs more than the share of the work of a worker,
+ * this worker is still busy with it after the others have finished. For such
+ * chunks, we use the cheapest partial path of the chunk instead, so that the
+ * workers share the blocks or the compressed batches of the chunk and each
+ * of them partially aggregates a slice of it. The partial aggregation states
+ * of the slices are combined by the finalize step like the ones of the other
+ * chunks.
+ *
+ * Returns the original path if no subpath was replaced.
+ */
+static AppendPath *
+distribute_large_chunks(AppendPath *append)
+{
+	double total_work = 0;
+	bool replaced = false;
+	List *nonpartial_subpaths = NIL;
+	List *partial_subpaths = NIL;
+	ListCell *lc;
+
+	if (!append->path.parallel_aware || append->first_partial_path == 0 ||
+		append->path.parallel_workers <= 0)
+		return append;
+
+	foreach (lc, append->subpaths)
+	{
+		Path *subpath = lfirst(lc);
+
+		if (foreach_current_index(lc) < append->first_partial_path)
+			total_work += subpath->total_cost;
+		else
+			total_work += subpath->total_cost * Max(subpath->parallel_workers, 1);
+	}
+
+	const double worker_share = total_work / append->path.parallel_workers;
+
+	foreach (lc, append->subpaths)
+	{
+		Path *subpath = lfirst(lc);
+
+		if (foreach_current_index(lc) >= append->first_partial_path)
+		{
+			partial_subpaths = lappend(partial_subpaths, subpath);
+			continue;
+		}
+
+		/* The partial_pathlist is sorted by total cost */
+		Path *partial_path = subpath->parent->partial_pathlist != NIL ?
+								 linitial(subpath->parent->partial_pathlist) :
+								 NULL;
+
+		if (subpath->total_cost > worker_share && partial_path != NULL &&
+			partial_path->param_info == NULL && partial_path->parallel_workers > 0)
+		{
+			partial_subpaths = lappend(partial_subpaths, partial_path);
+			replaced = true;
+		}
+		else
+			nonpartial_subpaths = lappend(nonpartial_subpaths, subpath);
+	}
+
+	if (!replaced)
+		return append;
+
+	AppendPath *new_append = makeNode(AppendPath);
+	memcpy(new_append, append, sizeof(AppendPath));
+	new_append->first_partial_path = list_length(nonpartial_subpaths);
+	new_append->subpaths = list_concat(nonpartial_subpaths, partial_subpaths);
+
+	cost_append(new_append);
+
+	return new_append;
+}
+
 /*
  * Generate a total aggregation path for partial aggregations.
  *
@@ -383,6 +460,16 @@ generate_agg_pushdown_path(PlannerInfo *root, Path *cheapest_total_path, RelOptI
 		return;
 	}
 
+	/*
+	 * In parallel plans, let the workers share the work on the large chunks
+	 * instead of having a single worker aggregate each of them.
+	 */
+	if (top_gather != NULL && IsA(top_append, AppendPath))
+	{
+		top_append = (Path *) distribute_large_chunks(castNode(AppendPath, top_append));
+		subpaths = castNode(AppendPath, top_append)->subpaths;
+	}
+
 	/* Generate agg paths on top of the append children */
 	List *sorted_subpaths = NIL;
 	List *hashed_subpaths = NIL;
@@ -602,7 +689,10 @@ tsl_pushdown_partial_agg(PlannerInfo *root, Hypertable *ht, RelOptInfo *input_re
 
 	/* Grouping sets are not supported by the partial aggregation pushdown */
 	if (parse->groupingSets)
+	{
+		elog(DEBUG2, "chunkwise aggregation not used: grouping sets are not supported");
 		return;
+	}
 
 	/* Don't replan aggregation if we already have a MinMaxAggPath (e.g., created by
 	 * ts_preprocess_first_last_aggregates) */
@@ -625,7 +715,13 @@ tsl_pushdown_partial_agg(PlannerInfo *root, Hypertable *ht, RelOptInfo *input_re
 
 	/* Don't replan aggregation if it contains already partials or non-serializable aggregates */
 	if (root->hasNonPartialAggs || root->hasNonSerialAggs)
+	{
+		elog(DEBUG2,
+			 "chunkwise aggregation not used: %s",
+			 root->hasNonPartialAggs ? "an aggregate has no combine function" :
+									   "an aggregate can't be serialized");
 		return;
+	}
 
 	double d_num_groups = existing_agg_path->numGroups;
 	Assert(d_num_groups > 0);
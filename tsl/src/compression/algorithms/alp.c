@@ -0,0 +1,719 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "alp.h"
+
+#include <math.h>
+
+#include <catalog/pg_type.h>
+#include <lib/stringinfo.h>
+#include <libpq/pqformat.h>
+#include <port/pg_bitutils.h>
+#include <utils/builtins.h>
+
+#include "adts/uint64_vec.h"
+#include "compression/arrow_c_data_interface.h"
+#include "compression/compression.h"
+#include "float_utils.h"
+#include "for.h"
+#include "simple8b_rle.h"
+#include "simple8b_rle_bitmap.h"
+
+/*
+ * ALP compressed data is stored as
+ *     AlpCompressed header
+ *     ForCompressed packed: the encoded integers, with the exceptions replaced
+ *         by some other encoded value not to widen the range
+ *     uint64 exception_values[num_exceptions]: the bits of the original values
+ *     uint16 exception_rows[num_exceptions]: padded to a multiple of 8 bytes
+ *     simple8b_rle nulls: 1 if the value is NULL, else 0, only if has_nulls
+ */
+typedef struct AlpCompressed
+{
+	CompressedDataHeaderFields;
+	uint8 has_nulls; /* 1 if this has a NULLs bitmap after the data, 0 otherwise */
+	uint8 exponent;
+	uint8 factor;
+	uint32 num_values;
+	uint32 num_exceptions;
+	char data[FLEXIBLE_ARRAY_MEMBER];
+} AlpCompressed;
+
+static void
+pg_attribute_unused() assertions(void)
+{
+	AlpCompressed test_val = { .vl_len_ = { 0 } };
+	/* make sure no padding bytes make it to disk */
+	StaticAssertStmt(sizeof(AlpCompressed) ==
+						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
+							 sizeof(test_val.has_nulls) + sizeof(test_val.exponent) +
+							 sizeof(test_val.factor) + sizeof(test_val.num_values) +
+							 sizeof(test_val.num_exceptions),
+					 "AlpCompressed wrong size");
+	StaticAssertStmt(sizeof(AlpCompressed) == 16, "AlpCompressed wrong size");
+}
+
+typedef struct AlpCompressor
+{
+	/* The bits of the float4 or float8 values. */
+	uint64_vec values;
+	Simple8bRleCompressor nulls;
+	Oid element_type;
+	bool has_nulls;
+} AlpCompressor;
+
+typedef struct ExtendedCompressor
+{
+	Compressor base;
+	AlpCompressor *internal;
+	Oid element_type;
+} ExtendedCompressor;
+
+typedef struct AlpDecompressionIterator
+{
+	DecompressionIterator base;
+	/* Decoded float4 or float8 values, depending on the element type. */
+	void *values;
+	uint32 num_values;
+	/* The number of values returned so far. */
+	uint32 num_returned;
+	Simple8bRleDecompressionIterator nulls;
+	bool has_nulls;
+} AlpDecompressionIterator;
+
+/*
+ * The largest decimal exponent we try. The powers of ten up to this are exact
+ * in double precision. For float4, the values have at most 9 significant
+ * decimal digits, so the larger exponents would only produce exceptions.
+ */
+#define ALP_MAX_EXPONENT_FLOAT8 18
+#define ALP_MAX_EXPONENT_FLOAT4 10
+
+/*
+ * The encoded values must be exact integers in double precision, so that the
+ * rounding is correct.
+ */
+#define ALP_ENCODING_LIMIT ((double) (1ULL << 52))
+
+/*
+ * The number of values we use to choose the exponent and factor.
+ */
+#define ALP_SAMPLE_SIZE 64
+
+/*
+ * The approximate size of an exception in bits: the original value and the row
+ * number.
+ */
+#define ALP_EXCEPTION_BITS (64 + 16)
+
+static const double alp_powers_of_ten[ALP_MAX_EXPONENT_FLOAT8 + 1] = {
+	1e0,  1e1,	1e2,  1e3,	1e4,  1e5,	1e6,  1e7,	1e8,  1e9,
+	1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+};
+
+static const double alp_negative_powers_of_ten[ALP_MAX_EXPONENT_FLOAT8 + 1] = {
+	1e0,   1e-1,  1e-2,	 1e-3,	1e-4,  1e-5,  1e-6,	 1e-7,	1e-8,  1e-9,
+	1e-10, 1e-11, 1e-12, 1e-13, 1e-14, 1e-15, 1e-16, 1e-17, 1e-18,
+};
+
+/*
+ * The decoding must give bitwise identical results in the compressor and in
+ * the bulk decompression kernel, so the latter must do the same operations in
+ * the same order.
+ */
+static pg_attribute_always_inline double
+alp_decode(int64 encoded, uint8 exponent, uint8 factor)
+{
+	return (double) encoded * alp_powers_of_ten[factor] * alp_negative_powers_of_ten[exponent];
+}
+
+/*
+ * Try to encode the given float4 or float8 value as an integer with the given
+ * exponent and factor. Returns false if it doesn't survive the round trip.
+ */
+static inline bool
+alp_encode(uint64 bits, bool is_float4, uint8 exponent, uint8 factor, int64 *encoded)
+{
+	const double value = is_float4 ? bits_get_float((uint32) bits) : bits_get_double(bits);
+	const double scaled =
+		value * alp_powers_of_ten[exponent] * alp_negative_powers_of_ten[factor];
+
+	/* This also rejects NaN and infinity. */
+	if (!(fabs(scaled) < ALP_ENCODING_LIMIT))
+		return false;
+
+	const int64 result = (int64) rint(scaled);
+	const double decoded = alp_decode(result, exponent, factor);
+	const uint64 decoded_bits =
+		is_float4 ? float_get_bits((float) decoded) : double_get_bits(decoded);
+
+	*encoded = result;
+	return decoded_bits == bits;
+}
+
+static inline uint8
+alp_bits_for_value(uint64 value)
+{
+	return value == 0 ? 0 : pg_leftmost_one_pos64(value) + 1;
+}
+
+/*
+ * Choose the exponent and factor that give the smallest estimated size for an
+ * evenly spaced sample of the values.
+ */
+static void
+alp_choose_exponent_and_factor(const uint64 *values, uint32 num_values, bool is_float4,
+							   uint8 *exponent, uint8 *factor)
+{
+	const uint8 max_exponent = is_float4 ? ALP_MAX_EXPONENT_FLOAT4 : ALP_MAX_EXPONENT_FLOAT8;
+	const uint32 step = Max(1, num_values / ALP_SAMPLE_SIZE);
+
+	uint64 best_cost = PG_UINT64_MAX;
+	*exponent = 0;
+	*factor = 0;
+	for (uint8 e = 0; e <= max_exponent; e++)
+	{
+		for (uint8 f = 0; f <= e; f++)
+		{
+			uint32 num_sampled = 0;
+			uint32 num_exceptions = 0;
+			int64 min = PG_INT64_MAX;
+			int64 max = PG_INT64_MIN;
+			for (uint32 i = 0; i < num_values; i += step)
+			{
+				int64 encoded;
+				num_sampled++;
+				if (alp_encode(values[i], is_float4, e, f, &encoded))
+				{
+					min = Min(min, encoded);
+					max = Max(max, encoded);
+				}
+				else
+				{
+					num_exceptions++;
+				}
+			}
+
+			const uint8 bits =
+				num_exceptions == num_sampled ? 0 : alp_bits_for_value((uint64) max - (uint64) min);
+			const uint64 cost =
+				(uint64) num_sampled * bits + (uint64) num_exceptions * ALP_EXCEPTION_BITS;
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				*exponent = e;
+				*factor = f;
+			}
+		}
+	}
+}
+
+static inline Size
+alp_exception_rows_bytes(uint32 num_exceptions)
+{
+	return TYPEALIGN(sizeof(uint64), sizeof(uint16) * num_exceptions);
+}
+
+static AlpCompressed *
+alp_compressed_build(uint8 exponent, uint8 factor, uint32 num_values, const void *packed,
+					 uint32 num_exceptions, const uint64 *exception_values,
+					 const uint16 *exception_rows, Simple8bRleSerialized *nulls)
+{
+	const Size packed_size = TYPEALIGN(sizeof(uint64), VARSIZE(packed));
+	const Size nulls_size = nulls != NULL ? simple8brle_serialized_total_size(nulls) : 0;
+	const Size compressed_size = sizeof(AlpCompressed) + packed_size +
+								 sizeof(uint64) * num_exceptions +
+								 alp_exception_rows_bytes(num_exceptions) + nulls_size;
+
+	if (!AllocSizeIsValid(compressed_size))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("compressed size exceeds the maximum allowed (%d)", (int) MaxAllocSize)));
+
+	char *compressed_data = palloc0(compressed_size);
+	AlpCompressed *compressed = (AlpCompressed *) compressed_data;
+	SET_VARSIZE(&compressed->vl_len_, compressed_size);
+	compressed->compression_algorithm = COMPRESSION_ALGORITHM_ALP;
+	compressed->has_nulls = nulls_size != 0 ? 1 : 0;
+	compressed->exponent = exponent;
+	compressed->factor = factor;
+	compressed->num_values = num_values;
+	compressed->num_exceptions = num_exceptions;
+
+	char *data = compressed->data;
+	memcpy(data, packed, VARSIZE(packed));
+	data += packed_size;
+
+	memcpy(data, exception_values, sizeof(uint64) * num_exceptions);
+	data += sizeof(uint64) * num_exceptions;
+
+	memcpy(data, exception_rows, sizeof(uint16) * num_exceptions);
+	data += alp_exception_rows_bytes(num_exceptions);
+
+	if (nulls_size > 0)
+	{
+		CheckCompressedData(nulls->num_elements > num_values);
+		bytes_serialize_simple8b_and_advance(data, nulls_size, nulls);
+	}
+
+	return compressed;
+}
+
+/*
+ * The parts of the compressed data after they have been validated.
+ */
+typedef struct AlpCompressedParts
+{
+	const AlpCompressed *header;
+	void *packed;
+	const uint64 *exception_values;
+	const uint16 *exception_rows;
+	Simple8bRleSerialized *nulls;
+} AlpCompressedParts;
+
+static AlpCompressedParts
+alp_compressed_parts(void *compressed)
+{
+	StringInfoData si = { .data = compressed, .len = VARSIZE(compressed) };
+	const AlpCompressed *header = consumeCompressedData(&si, sizeof(AlpCompressed));
+
+	CheckCompressedData(header->has_nulls == 0 || header->has_nulls == 1);
+	CheckCompressedData(header->exponent <= ALP_MAX_EXPONENT_FLOAT8);
+	CheckCompressedData(header->factor <= header->exponent);
+	CheckCompressedData(header->num_values > 0);
+	CheckCompressedData(header->num_values <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+	CheckCompressedData(header->num_exceptions <= header->num_values);
+
+	AlpCompressedParts parts = { .header = header };
+
+	/*
+	 * The packed integers are a nested FOR-compressed varlena. Its own contents
+	 * are validated by FOR when it is unpacked, here we only have to check that
+	 * it fits into our data.
+	 */
+	parts.packed = consumeCompressedData(&si, VARHDRSZ);
+	const Size packed_size = VARSIZE(parts.packed);
+	CheckCompressedData(packed_size >= VARHDRSZ);
+	consumeCompressedData(&si, TYPEALIGN(sizeof(uint64), packed_size) - VARHDRSZ);
+
+	parts.exception_values = consumeCompressedData(&si, sizeof(uint64) * header->num_exceptions);
+	parts.exception_rows =
+		consumeCompressedData(&si, alp_exception_rows_bytes(header->num_exceptions));
+
+	if (header->has_nulls)
+	{
+		parts.nulls = bytes_deserialize_simple8b_and_advance(&si);
+		CheckCompressedData(parts.nulls->num_elements > header->num_values);
+	}
+
+	return parts;
+}
+
+/*
+ * Declare the decoding functions for each element type.
+ */
+#define ELEMENT_TYPE float8
+#define ELEMENT_FROM_BITS(X) bits_get_double(X)
+#include "alp_impl.c"
+#undef ELEMENT_FROM_BITS
+#undef ELEMENT_TYPE
+
+#define ELEMENT_TYPE float4
+#define ELEMENT_FROM_BITS(X) bits_get_float((uint32) (X))
+#include "alp_impl.c"
+#undef ELEMENT_FROM_BITS
+#undef ELEMENT_TYPE
+
+bool
+alp_compressed_has_nulls(const CompressedDataHeader *header)
+{
+	const AlpCompressed *ac = (const AlpCompressed *) header;
+	return ac->has_nulls;
+}
+
+/*
+ * Compressor framework functions and definitions for the ALP algorithm.
+ */
+
+AlpCompressor *
+alp_compressor_alloc(Oid element_type)
+{
+	Assert(element_type == FLOAT4OID || element_type == FLOAT8OID);
+	AlpCompressor *compressor = palloc0(sizeof(*compressor));
+	uint64_vec_init(&compressor->values, CurrentMemoryContext, TARGET_COMPRESSED_BATCH_SIZE);
+	simple8brle_compressor_init(&compressor->nulls);
+	compressor->element_type = element_type;
+	return compressor;
+}
+
+void
+alp_compressor_append_null(AlpCompressor *compressor)
+{
+	compressor->has_nulls = true;
+	simple8brle_compressor_append(&compressor->nulls, 1);
+}
+
+void
+alp_compressor_append_value(AlpCompressor *compressor, uint64 float_bits)
+{
+	uint64_vec_append(&compressor->values, float_bits);
+	simple8brle_compressor_append(&compressor->nulls, 0);
+}
+
+void *
+alp_compressor_finish(AlpCompressor *compressor)
+{
+	Simple8bRleSerialized *nulls = simple8brle_compressor_finish(&compressor->nulls);
+
+	const uint32 num_values = compressor->values.num_elements;
+	if (num_values == 0)
+		return NULL;
+
+	Assert(num_values <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	const uint64 *values = compressor->values.data;
+	const bool is_float4 = compressor->element_type == FLOAT4OID;
+	uint8 exponent;
+	uint8 factor;
+	alp_choose_exponent_and_factor(values, num_values, is_float4, &exponent, &factor);
+
+	uint64 *encoded = palloc(sizeof(uint64) * num_values);
+	uint64 *exception_values = palloc(sizeof(uint64) * num_values);
+	uint16 *exception_rows = palloc(sizeof(uint16) * num_values);
+	uint32 num_exceptions = 0;
+	bool have_encoded = false;
+	int64 first_encoded = 0;
+	for (uint32 i = 0; i < num_values; i++)
+	{
+		int64 result;
+		if (alp_encode(values[i], is_float4, exponent, factor, &result))
+		{
+			encoded[i] = (uint64) result;
+			if (!have_encoded)
+			{
+				first_encoded = result;
+				have_encoded = true;
+			}
+		}
+		else
+		{
+			exception_values[num_exceptions] = values[i];
+			exception_rows[num_exceptions] = i;
+			num_exceptions++;
+		}
+	}
+
+	/*
+	 * The exceptions are patched after decoding, so we can store any value in
+	 * their place. Use one of the encoded values, so that the bit width of the
+	 * packed array doesn't grow.
+	 */
+	for (uint32 i = 0; i < num_exceptions; i++)
+	{
+		encoded[exception_rows[i]] = (uint64) first_encoded;
+	}
+
+	ForCompressed *packed = for_compressed_from_values(encoded, num_values, NULL);
+	AlpCompressed *compressed = alp_compressed_build(exponent,
+													 factor,
+													 num_values,
+													 packed,
+													 num_exceptions,
+													 exception_values,
+													 exception_rows,
+													 compressor->has_nulls ? nulls : NULL);
+
+	pfree(packed);
+	pfree(encoded);
+	pfree(exception_values);
+	pfree(exception_rows);
+	uint64_vec_free_data(&compressor->values);
+	return compressed;
+}
+
+static void
+alp_compressor_append_datum(Compressor *compressor, Datum val)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = alp_compressor_alloc(extended->element_type);
+
+	const uint64 bits = extended->element_type == FLOAT4OID ?
+							float_get_bits(DatumGetFloat4(val)) :
+							double_get_bits(DatumGetFloat8(val));
+	alp_compressor_append_value(extended->internal, bits);
+}
+
+static void
+alp_compressor_append_null_value(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = alp_compressor_alloc(extended->element_type);
+
+	alp_compressor_append_null(extended->internal);
+}
+
+static void *
+alp_compressor_finish_and_reset(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		return NULL;
+
+	void *compressed = alp_compressor_finish(extended->internal);
+	pfree(extended->internal);
+	extended->internal = NULL;
+	return compressed;
+}
+
+const Compressor alp_compressor = {
+	.append_val = alp_compressor_append_datum,
+	.append_null = alp_compressor_append_null_value,
+	.finish = alp_compressor_finish_and_reset,
+};
+
+Compressor *
+alp_compressor_for_type(Oid element_type)
+{
+	switch (element_type)
+	{
+		case FLOAT4OID:
+		case FLOAT8OID:
+		{
+			ExtendedCompressor *compressor = palloc(sizeof(*compressor));
+			*compressor = (ExtendedCompressor){
+				.base = alp_compressor,
+				.element_type = element_type,
+			};
+			return &compressor->base;
+		}
+		default:
+			elog(ERROR, "invalid type for ALP compressor \"%s\"", format_type_be(element_type));
+	}
+
+	pg_unreachable();
+}
+
+/*
+ * Decompression functions.
+ */
+
+static DecompressionIterator *
+alp_decompression_iterator_from_datum(Datum alp_compressed, Oid element_type, bool forward)
+{
+	void *detoasted = PG_DETOAST_DATUM(alp_compressed);
+	AlpCompressedParts parts = alp_compressed_parts(detoasted);
+	AlpDecompressionIterator *iter = palloc(sizeof(*iter));
+
+	/*
+	 * The row-by-row decompression is not performance-critical, so we just
+	 * decode all the values at once.
+	 */
+	const uint32 num_values = parts.header->num_values;
+	void *values;
+	switch (element_type)
+	{
+		case FLOAT8OID:
+			values = palloc(sizeof(float8) * num_values);
+			alp_decode_values_float8(&parts, values);
+			break;
+		case FLOAT4OID:
+			values = palloc(sizeof(float4) * num_values);
+			alp_decode_values_float4(&parts, values);
+			break;
+		default:
+			elog(ERROR,
+				 "invalid type requested from ALP decompression \"%s\"",
+				 format_type_be(element_type));
+			pg_unreachable();
+	}
+
+	*iter = (AlpDecompressionIterator){
+		.base = {
+			.compression_algorithm = COMPRESSION_ALGORITHM_ALP,
+			.forward = forward,
+			.element_type = element_type,
+			.try_next = forward ? alp_decompression_iterator_try_next_forward :
+								  alp_decompression_iterator_try_next_reverse,
+		},
+		.values = values,
+		.num_values = num_values,
+		.num_returned = 0,
+		.has_nulls = parts.header->has_nulls == 1,
+	};
+
+	if (iter->has_nulls)
+	{
+		if (forward)
+			simple8brle_decompression_iterator_init_forward(&iter->nulls, parts.nulls);
+		else
+			simple8brle_decompression_iterator_init_reverse(&iter->nulls, parts.nulls);
+	}
+
+	return &iter->base;
+}
+
+DecompressionIterator *
+alp_decompression_iterator_from_datum_forward(Datum alp_compressed, Oid element_type)
+{
+	return alp_decompression_iterator_from_datum(alp_compressed, element_type, true);
+}
+
+DecompressionIterator *
+alp_decompression_iterator_from_datum_reverse(Datum alp_compressed, Oid element_type)
+{
+	return alp_decompression_iterator_from_datum(alp_compressed, element_type, false);
+}
+
+static DecompressResult
+alp_decompression_iterator_try_next(AlpDecompressionIterator *iter)
+{
+	if (iter->has_nulls)
+	{
+		Simple8bRleDecompressResult result =
+			iter->base.forward ? simple8brle_decompression_iterator_try_next_forward(&iter->nulls) :
+								 simple8brle_decompression_iterator_try_next_reverse(&iter->nulls);
+		if (result.is_done)
+			return (DecompressResult){ .is_done = true };
+
+		if (result.val != 0)
+		{
+			CheckCompressedData(result.val == 1);
+			return (DecompressResult){ .is_null = true };
+		}
+	}
+
+	if (iter->num_returned >= iter->num_values)
+	{
+		/* The nulls bitmap must be consistent with the number of values. */
+		CheckCompressedData(!iter->has_nulls);
+		return (DecompressResult){ .is_done = true };
+	}
+
+	const uint32 index =
+		iter->base.forward ? iter->num_returned : iter->num_values - 1 - iter->num_returned;
+	iter->num_returned++;
+
+	if (iter->base.element_type == FLOAT4OID)
+		return (DecompressResult){ .val = Float4GetDatum(((float4 *) iter->values)[index]) };
+
+	return (DecompressResult){ .val = Float8GetDatum(((float8 *) iter->values)[index]) };
+}
+
+DecompressResult
+alp_decompression_iterator_try_next_forward(DecompressionIterator *iter)
+{
+	Assert(iter->compression_algorithm == COMPRESSION_ALGORITHM_ALP && iter->forward);
+	return alp_decompression_iterator_try_next((AlpDecompressionIterator *) iter);
+}
+
+DecompressResult
+alp_decompression_iterator_try_next_reverse(DecompressionIterator *iter)
+{
+	Assert(iter->compression_algorithm == COMPRESSION_ALGORITHM_ALP && !iter->forward);
+	return alp_decompression_iterator_try_next((AlpDecompressionIterator *) iter);
+}
+
+ArrowArray *
+alp_decompress_all(Datum compressed_data, Oid element_type, MemoryContext dest_mctx)
+{
+	switch (element_type)
+	{
+		case FLOAT8OID:
+			return alp_decompress_all_float8(compressed_data, dest_mctx);
+		case FLOAT4OID:
+			return alp_decompress_all_float4(compressed_data, dest_mctx);
+		default:
+			elog(ERROR,
+				 "type '%s' is not supported for ALP decompression",
+				 format_type_be(element_type));
+			pg_unreachable();
+	}
+}
+
+/*
+ * Send and receive functions.
+ */
+
+void
+alp_compressed_send(CompressedDataHeader *header, StringInfo buffer)
+{
+	AlpCompressedParts parts = alp_compressed_parts(header);
+	const AlpCompressed *data = parts.header;
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_ALP);
+
+	pq_sendbyte(buffer, data->has_nulls);
+	pq_sendbyte(buffer, data->exponent);
+	pq_sendbyte(buffer, data->factor);
+	pq_sendint32(buffer, data->num_values);
+	pq_sendint32(buffer, data->num_exceptions);
+
+	for_compressed_send(parts.packed, buffer);
+
+	for (uint32 i = 0; i < data->num_exceptions; i++)
+	{
+		pq_sendint64(buffer, parts.exception_values[i]);
+		pq_sendint16(buffer, parts.exception_rows[i]);
+	}
+
+	if (data->has_nulls)
+		simple8brle_serialized_send(buffer, parts.nulls);
+}
+
+Datum
+alp_compressed_recv(StringInfo buffer)
+{
+	const uint8 has_nulls = pq_getmsgbyte(buffer);
+	CheckCompressedData(has_nulls == 0 || has_nulls == 1);
+
+	const uint8 exponent = pq_getmsgbyte(buffer);
+	CheckCompressedData(exponent <= ALP_MAX_EXPONENT_FLOAT8);
+
+	const uint8 factor = pq_getmsgbyte(buffer);
+	CheckCompressedData(factor <= exponent);
+
+	const uint32 num_values = pq_getmsgint32(buffer);
+	CheckCompressedData(num_values > 0);
+	CheckCompressedData(num_values <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	const uint32 num_exceptions = pq_getmsgint32(buffer);
+	CheckCompressedData(num_exceptions <= num_values);
+
+	/*
+	 * The FOR recv function recompresses the packed integers, so we can trust
+	 * their layout. Check that they have the expected number of values.
+	 */
+	void *packed = DatumGetPointer(for_compressed_recv(buffer));
+	uint64 *encoded = palloc(sizeof(uint64) * num_values);
+	for_compressed_unpack(packed, num_values, encoded);
+	pfree(encoded);
+
+	uint64 *exception_values = palloc(sizeof(uint64) * (num_exceptions + 1));
+	uint16 *exception_rows = palloc(sizeof(uint16) * (num_exceptions + 1));
+	for (uint32 i = 0; i < num_exceptions; i++)
+	{
+		exception_values[i] = pq_getmsgint64(buffer);
+		exception_rows[i] = pq_getmsgint(buffer, 2);
+		CheckCompressedData(exception_rows[i] < num_values);
+	}
+
+	Simple8bRleSerialized *nulls = NULL;
+	if (has_nulls)
+	{
+		nulls = simple8brle_serialized_recv(buffer);
+		CheckCompressedData(nulls->num_elements > num_values);
+	}
+
+	PG_RETURN_POINTER(alp_compressed_build(exponent,
+										   factor,
+										   num_values,
+										   packed,
+										   num_exceptions,
+										   exception_values,
+										   exception_rows,
+										   nulls));
+}
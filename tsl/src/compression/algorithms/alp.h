@@ -0,0 +1,68 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+/*
+ * ALP (adaptive lossless floating point) compresses floats that are decimals
+ * with a small number of significant digits stored in a binary floating point
+ * format, e.g. sensor readings like 21.37. It is modeled after the paper
+ * "ALP: Adaptive Lossless floating-Point Compression" by Azim Afroozeh et. al.
+ *
+ * Such a value v can be represented exactly as an integer n and a pair of
+ * decimal scales: v == n * 10^f * 10^-e. For each batch, we choose the
+ * exponent e and the factor f that give the smallest size for a sample of
+ * values, encode each value as n = round(v * 10^e * 10^-f), and bit-pack these
+ * integers with the FOR algorithm. The values that don't survive the round
+ * trip (e.g. NaN, -0.0, or values with too many digits) are stored separately
+ * as exceptions, along with their row numbers.
+ *
+ * The decoding is an integer-to-float conversion and two multiplications, the
+ * same for all the values, so it is done by a branch-free loop that can be
+ * vectorized, followed by a separate loop that patches the exceptions.
+ *
+ * Currently this algorithm is not used by default, but is tried along with
+ * Gorilla for float columns, and the smaller result is kept for each batch.
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+
+#include "compression/compression.h"
+
+typedef struct AlpCompressor AlpCompressor;
+typedef struct AlpCompressed AlpCompressed;
+typedef struct AlpDecompressionIterator AlpDecompressionIterator;
+
+extern bool alp_compressed_has_nulls(const CompressedDataHeader *header);
+extern Compressor *alp_compressor_for_type(Oid element_type);
+extern AlpCompressor *alp_compressor_alloc(Oid element_type);
+extern void alp_compressor_append_null(AlpCompressor *compressor);
+extern void alp_compressor_append_value(AlpCompressor *compressor, uint64 float_bits);
+extern void *alp_compressor_finish(AlpCompressor *compressor);
+
+extern DecompressionIterator *alp_decompression_iterator_from_datum_forward(Datum alp_compressed,
+																			Oid element_type);
+extern DecompressionIterator *alp_decompression_iterator_from_datum_reverse(Datum alp_compressed,
+																			Oid element_type);
+extern DecompressResult alp_decompression_iterator_try_next_forward(DecompressionIterator *iter);
+extern DecompressResult alp_decompression_iterator_try_next_reverse(DecompressionIterator *iter);
+
+extern ArrowArray *alp_decompress_all(Datum compressed_data, Oid element_type,
+									  MemoryContext dest_mctx);
+
+extern void alp_compressed_send(CompressedDataHeader *header, StringInfo buffer);
+extern Datum alp_compressed_recv(StringInfo buf);
+
+#define ALP_ALGORITHM_DEFINITION                                                                   \
+	{                                                                                              \
+		.iterator_init_forward = alp_decompression_iterator_from_datum_forward,                    \
+		.iterator_init_reverse = alp_decompression_iterator_from_datum_reverse,                    \
+		.decompress_all = alp_decompress_all, .compressed_data_send = alp_compressed_send,         \
+		.compressed_data_recv = alp_compressed_recv,                                               \
+		.compressor_for_type = alp_compressor_for_type,                                            \
+		.compressed_data_storage = TOAST_STORAGE_EXTERNAL,                                         \
+	}
@@ -0,0 +1,145 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Decode and decompress the entire batch of ALP-compressed rows.
+ * Specialized for each supported data type.
+ */
+
+#define FUNCTION_NAME_HELPER(X, Y) X##_##Y
+#define FUNCTION_NAME(X, Y) FUNCTION_NAME_HELPER(X, Y)
+
+/*
+ * Decode the non-null values into the given buffer, which must have space for
+ * num_values elements.
+ */
+static void
+FUNCTION_NAME(alp_decode_values, ELEMENT_TYPE)(const AlpCompressedParts *parts,
+											   ELEMENT_TYPE *restrict decoded_values)
+{
+	const uint32 num_values = parts->header->num_values;
+	Assert(num_values <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	uint64 *restrict encoded = palloc(sizeof(uint64) * num_values);
+	for_compressed_unpack(parts->packed, num_values, encoded);
+
+	/*
+	 * The decoding is the same for every value, and has no branches, so this
+	 * loop can be vectorized. It must do the same operations as alp_decode().
+	 */
+	const double factor = alp_powers_of_ten[parts->header->factor];
+	const double exponent = alp_negative_powers_of_ten[parts->header->exponent];
+	for (uint32 i = 0; i < num_values; i++)
+	{
+		decoded_values[i] = (ELEMENT_TYPE) ((double) (int64) encoded[i] * factor * exponent);
+	}
+
+	/*
+	 * Patch the exceptions. They are rare, so we do this in a separate loop not
+	 * to hinder the vectorization of the main one.
+	 */
+	const uint32 num_exceptions = parts->header->num_exceptions;
+	bool have_incorrect_rows = false;
+	for (uint32 i = 0; i < num_exceptions; i++)
+	{
+		const uint16 row = parts->exception_rows[i];
+		have_incorrect_rows |= row >= num_values;
+		decoded_values[Min(row, num_values - 1)] = ELEMENT_FROM_BITS(parts->exception_values[i]);
+	}
+	CheckCompressedData(!have_incorrect_rows);
+
+	pfree(encoded);
+}
+
+static ArrowArray *
+FUNCTION_NAME(alp_decompress_all, ELEMENT_TYPE)(Datum compressed, MemoryContext dest_mctx)
+{
+	AlpCompressedParts parts = alp_compressed_parts(DatumGetPointer(compressed));
+	const bool has_nulls = parts.header->has_nulls == 1;
+
+	Simple8bRleBitmap nulls = { 0 };
+	if (has_nulls)
+	{
+		nulls = simple8brle_bitmap_decompress(parts.nulls);
+	}
+
+	const uint32 n_notnull = parts.header->num_values;
+	const uint32 n_total = has_nulls ? nulls.num_elements : n_notnull;
+	Assert(n_total >= n_notnull);
+	Assert(n_total <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	/*
+	 * Pad the number of elements to multiple of 64 bytes, so that we can work
+	 * in 64-byte blocks. We need additional padding at the end of buffer,
+	 * because the code that converts the elements to postgres Datum always
+	 * reads in 8 bytes.
+	 */
+	const uint32 n_total_padded = pad_to_multiple(64 / sizeof(ELEMENT_TYPE), n_total);
+	const int buffer_bytes = n_total_padded * sizeof(ELEMENT_TYPE) + 8;
+	ELEMENT_TYPE *restrict decompressed_values = MemoryContextAlloc(dest_mctx, buffer_bytes);
+
+	FUNCTION_NAME(alp_decode_values, ELEMENT_TYPE)(&parts, decompressed_values);
+
+	uint64 *restrict validity_bitmap = NULL;
+	if (has_nulls)
+	{
+		/* Now move the data to account for nulls, and fill the validity bitmap. */
+		const int validity_bitmap_bytes = sizeof(uint64) * ((n_total + 64 - 1) / 64);
+		validity_bitmap = MemoryContextAlloc(dest_mctx, validity_bitmap_bytes);
+
+		/*
+		 * First, mark all data as valid, we will fill the nulls later if needed.
+		 * Note that the validity bitmap size is a multiple of 64 bits. We have to
+		 * fill the tail bits with zeros, because the corresponding elements are not
+		 * valid.
+		 */
+		memset(validity_bitmap, 0xFF, validity_bitmap_bytes);
+		if (n_total % 64)
+		{
+			const uint64 tail_mask = ~0ULL >> (64 - n_total % 64);
+			validity_bitmap[n_total / 64] &= tail_mask;
+		}
+
+		/*
+		 * The number of not-null elements we have must be consistent with the
+		 * nulls bitmap.
+		 */
+		CheckCompressedData(n_notnull + simple8brle_bitmap_num_ones(&nulls) == n_total);
+
+		int current_notnull_element = n_notnull - 1;
+		for (int i = n_total - 1; i >= 0; i--)
+		{
+			Assert(i >= current_notnull_element);
+
+			if (simple8brle_bitmap_get_at(&nulls, i))
+			{
+				arrow_set_row_validity(validity_bitmap, i, false);
+			}
+			else
+			{
+				Assert(current_notnull_element >= 0);
+				decompressed_values[i] = decompressed_values[current_notnull_element];
+				current_notnull_element--;
+			}
+		}
+
+		Assert(current_notnull_element == -1);
+	}
+
+	/* Return the result. */
+	ArrowArray *result = MemoryContextAllocZero(dest_mctx, sizeof(ArrowArray) + sizeof(void *) * 2);
+	const void **buffers = (const void **) &result[1];
+	buffers[0] = validity_bitmap;
+	buffers[1] = decompressed_values;
+	result->n_buffers = 2;
+	result->buffers = buffers;
+	result->length = n_total;
+	result->null_count = n_total - n_notnull;
+	return result;
+}
+
+#undef FUNCTION_NAME
+#undef FUNCTION_NAME_HELPER
@@ -0,0 +1,370 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "block_codec.h"
+
+#include <catalog/pg_type.h>
+#include <lib/stringinfo.h>
+#include <libpq/pqformat.h>
+#include <utils/builtins.h>
+
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "array.h"
+#include "compression/compression.h"
+#include "dictionary.h"
+
+/*
+ * The block codec compressed data is stored as
+ *     BlockCodecCompressed header
+ *     the original compressed data, including its varlena header, compressed
+ *     with the codec, up to the end of data
+ */
+typedef struct BlockCodecCompressed
+{
+	CompressedDataHeaderFields;
+	uint8 codec;
+	/* The algorithm of the original compressed data. */
+	uint8 inner_algorithm;
+	uint8 has_nulls; /* 1 if the original data has nulls, 0 otherwise */
+	/* The size of the original compressed data. */
+	uint32 decoded_size;
+} BlockCodecCompressed;
+
+static void
+pg_attribute_unused() assertions(void)
+{
+	BlockCodecCompressed test_val = { .vl_len_ = { 0 } };
+	/* make sure no padding bytes make it to disk */
+	StaticAssertStmt(sizeof(BlockCodecCompressed) ==
+						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
+							 sizeof(test_val.codec) + sizeof(test_val.inner_algorithm) +
+							 sizeof(test_val.has_nulls) + sizeof(test_val.decoded_size),
+					 "BlockCodecCompressed wrong size");
+	StaticAssertStmt(sizeof(BlockCodecCompressed) == 12, "BlockCodecCompressed wrong size");
+}
+
+/*
+ * The data smaller than this is not worth compressing, it would most likely
+ * fit into the tuple anyway.
+ */
+#define BLOCK_CODEC_MIN_SIZE 128
+
+static void
+block_codec_check_supported(uint8 codec)
+{
+	CheckCompressedData(codec == BLOCK_CODEC_LZ4 || codec == BLOCK_CODEC_ZSTD);
+
+#ifndef USE_LZ4
+	if (codec == BLOCK_CODEC_LZ4)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("compression codec \"%s\" is not supported by this build", "lz4")));
+#endif
+
+#ifndef USE_ZSTD
+	if (codec == BLOCK_CODEC_ZSTD)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("compression codec \"%s\" is not supported by this build", "zstd")));
+#endif
+}
+
+static bool
+block_codec_can_wrap(const CompressedDataHeader *header)
+{
+	return header->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY ||
+		   header->compression_algorithm == COMPRESSION_ALGORITHM_DICTIONARY;
+}
+
+bool
+block_codec_compressed_has_nulls(const CompressedDataHeader *header)
+{
+	const BlockCodecCompressed *bc = (const BlockCodecCompressed *) header;
+	return bc->has_nulls;
+}
+
+/*
+ * Compress the given array or dictionary compressed data with the codec.
+ * Returns the original data if the codec doesn't apply or doesn't make it
+ * smaller, otherwise the original data is freed.
+ */
+void *
+block_codec_compress(void *compressed, CompressionBlockCodec codec)
+{
+	if (codec == BLOCK_CODEC_NONE || compressed == NULL)
+		return compressed;
+
+	const CompressedDataHeader *inner = (const CompressedDataHeader *) compressed;
+	const Size inner_size = VARSIZE(compressed);
+	if (!block_codec_can_wrap(inner) || inner_size < BLOCK_CODEC_MIN_SIZE)
+		return compressed;
+
+	block_codec_check_supported(codec);
+
+	/*
+	 * Allocate as much as the original data takes, if the codec needs more
+	 * than that, we won't use the result anyway.
+	 */
+	const Size capacity = inner_size - sizeof(BlockCodecCompressed);
+	char *result_data = palloc0(sizeof(BlockCodecCompressed) + capacity);
+	char *dest = result_data + sizeof(BlockCodecCompressed);
+	Size encoded_size = 0;
+	switch (codec)
+	{
+#ifdef USE_LZ4
+		case BLOCK_CODEC_LZ4:
+		{
+			const int len = LZ4_compress_default(compressed, dest, inner_size, capacity);
+			encoded_size = len > 0 ? len : 0;
+			break;
+		}
+#endif
+#ifdef USE_ZSTD
+		case BLOCK_CODEC_ZSTD:
+		{
+			const size_t len =
+				ZSTD_compress(dest, capacity, compressed, inner_size, ZSTD_CLEVEL_DEFAULT);
+			encoded_size = ZSTD_isError(len) ? 0 : len;
+			break;
+		}
+#endif
+		default:
+			pg_unreachable();
+	}
+
+	if (encoded_size == 0)
+	{
+		/* Doesn't fit into the original size. */
+		pfree(result_data);
+		return compressed;
+	}
+
+	BlockCodecCompressed *result = (BlockCodecCompressed *) result_data;
+	SET_VARSIZE(&result->vl_len_, sizeof(BlockCodecCompressed) + encoded_size);
+	result->compression_algorithm = COMPRESSION_ALGORITHM_BLOCK;
+	result->codec = codec;
+	result->inner_algorithm = inner->compression_algorithm;
+	result->has_nulls = inner->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY ?
+							array_compressed_has_nulls(inner) :
+							dictionary_compressed_has_nulls(inner);
+	result->decoded_size = inner_size;
+
+	pfree(compressed);
+	return result;
+}
+
+/*
+ * Decode the original compressed data into the current memory context.
+ */
+static void *
+block_codec_decode(const void *compressed)
+{
+	StringInfoData si = { .data = (char *) compressed, .len = VARSIZE(compressed) };
+	const BlockCodecCompressed *header = consumeCompressedData(&si, sizeof(BlockCodecCompressed));
+
+	CheckCompressedData(header->has_nulls == 0 || header->has_nulls == 1);
+	CheckCompressedData(header->inner_algorithm == COMPRESSION_ALGORITHM_ARRAY ||
+						header->inner_algorithm == COMPRESSION_ALGORITHM_DICTIONARY);
+	CheckCompressedData(header->decoded_size >= sizeof(CompressedDataHeader));
+	CheckCompressedData(AllocSizeIsValid(header->decoded_size));
+	block_codec_check_supported(header->codec);
+
+	const int encoded_size = si.len - si.cursor;
+	const char *encoded = consumeCompressedData(&si, encoded_size);
+	const uint32 decoded_size = header->decoded_size;
+	char *decoded = palloc(decoded_size);
+	switch (header->codec)
+	{
+#ifdef USE_LZ4
+		case BLOCK_CODEC_LZ4:
+		{
+			const int len = LZ4_decompress_safe(encoded, decoded, encoded_size, decoded_size);
+			CheckCompressedData(len >= 0 && (uint32) len == decoded_size);
+			break;
+		}
+#endif
+#ifdef USE_ZSTD
+		case BLOCK_CODEC_ZSTD:
+		{
+			const size_t len = ZSTD_decompress(decoded, decoded_size, encoded, encoded_size);
+			CheckCompressedData(!ZSTD_isError(len) && len == decoded_size);
+			break;
+		}
+#endif
+		default:
+			pg_unreachable();
+	}
+
+	/* The original data must be a plain varlena of the declared algorithm. */
+	CheckCompressedData(VARATT_IS_4B_U(decoded));
+	CheckCompressedData(VARSIZE(decoded) == decoded_size);
+	CheckCompressedData(((CompressedDataHeader *) decoded)->compression_algorithm ==
+						header->inner_algorithm);
+
+	return decoded;
+}
+
+/*
+ * The compressor that compresses the result of another one with the codec.
+ */
+typedef struct BlockCodecCompressor
+{
+	Compressor base;
+	Compressor *inner;
+	CompressionBlockCodec codec;
+} BlockCodecCompressor;
+
+static void
+block_codec_compressor_append_val(Compressor *compressor, Datum val)
+{
+	BlockCodecCompressor *block = (BlockCodecCompressor *) compressor;
+	block->inner->append_val(block->inner, val);
+}
+
+static void
+block_codec_compressor_append_null(Compressor *compressor)
+{
+	BlockCodecCompressor *block = (BlockCodecCompressor *) compressor;
+	block->inner->append_null(block->inner);
+}
+
+static void *
+block_codec_compressor_finish(Compressor *compressor)
+{
+	BlockCodecCompressor *block = (BlockCodecCompressor *) compressor;
+	return block_codec_compress(block->inner->finish(block->inner), block->codec);
+}
+
+static const Compressor block_codec_compressor = {
+	.append_val = block_codec_compressor_append_val,
+	.append_null = block_codec_compressor_append_null,
+	.finish = block_codec_compressor_finish,
+};
+
+Compressor *
+block_codec_compressor_wrap(Compressor *inner, CompressionBlockCodec codec)
+{
+	if (codec == BLOCK_CODEC_NONE)
+		return inner;
+
+	block_codec_check_supported(codec);
+
+	BlockCodecCompressor *compressor = palloc(sizeof(*compressor));
+	*compressor = (BlockCodecCompressor){
+		.base = block_codec_compressor,
+		.inner = inner,
+		.codec = codec,
+	};
+	return &compressor->base;
+}
+
+Compressor *
+block_codec_compressor_for_type(Oid element_type)
+{
+	return block_codec_compressor_wrap(array_compressor_for_type(element_type),
+									   ts_guc_compression_block_codec);
+}
+
+/*
+ * Decompression functions. We decode the original data, and then use the
+ * functions of its algorithm.
+ */
+
+static DecompressionIterator *
+block_codec_decompression_iterator_from_datum(Datum compressed, Oid element_type, bool reverse)
+{
+	void *decoded = block_codec_decode(PG_DETOAST_DATUM(compressed));
+	const CompressedDataHeader *header = (const CompressedDataHeader *) decoded;
+
+	/* The iterator references the decoded data, so we don't free it. */
+	return tsl_get_decompression_iterator_init(header->compression_algorithm,
+											   reverse)(PointerGetDatum(decoded), element_type);
+}
+
+DecompressionIterator *
+block_codec_decompression_iterator_from_datum_forward(Datum compressed, Oid element_type)
+{
+	return block_codec_decompression_iterator_from_datum(compressed, element_type, false);
+}
+
+DecompressionIterator *
+block_codec_decompression_iterator_from_datum_reverse(Datum compressed, Oid element_type)
+{
+	return block_codec_decompression_iterator_from_datum(compressed, element_type, true);
+}
+
+ArrowArray *
+block_codec_decompress_all(Datum compressed, Oid element_type, MemoryContext dest_mctx)
+{
+	Assert(element_type == TEXTOID);
+
+	/*
+	 * The decoded data is temporary, so we decode it into the current memory
+	 * context, and the decompression of the original algorithm puts the
+	 * results into the destination one.
+	 */
+	void *decoded = block_codec_decode(DatumGetPointer(compressed));
+	const CompressedDataHeader *header = (const CompressedDataHeader *) decoded;
+	DecompressAllFunction decompress_all =
+		tsl_get_decompress_all_function(header->compression_algorithm, element_type);
+	Assert(decompress_all != NULL);
+
+	ArrowArray *result = decompress_all(PointerGetDatum(decoded), element_type, dest_mctx);
+	pfree(decoded);
+	return result;
+}
+
+/*
+ * We send the original data in the format of its algorithm, and the receiver
+ * compresses it again.
+ */
+void
+block_codec_compressed_send(CompressedDataHeader *header, StringInfo buffer)
+{
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_BLOCK);
+	const BlockCodecCompressed *block = (const BlockCodecCompressed *) header;
+	CompressedDataHeader *decoded = block_codec_decode(header);
+
+	pq_sendbyte(buffer, block->codec);
+	pq_sendbyte(buffer, decoded->compression_algorithm);
+	if (decoded->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY)
+		array_compressed_send(decoded, buffer);
+	else
+		dictionary_compressed_send(decoded, buffer);
+
+	pfree(decoded);
+}
+
+Datum
+block_codec_compressed_recv(StringInfo buffer)
+{
+	const uint8 codec = pq_getmsgbyte(buffer);
+	CheckCompressedData(codec == BLOCK_CODEC_LZ4 || codec == BLOCK_CODEC_ZSTD);
+
+	const uint8 inner_algorithm = pq_getmsgbyte(buffer);
+	Datum inner;
+	switch (inner_algorithm)
+	{
+		case COMPRESSION_ALGORITHM_ARRAY:
+			inner = array_compressed_recv(buffer);
+			break;
+		case COMPRESSION_ALGORITHM_DICTIONARY:
+			inner = dictionary_compressed_recv(buffer);
+			break;
+		default:
+			CheckCompressedData(false);
+			pg_unreachable();
+	}
+
+	PG_RETURN_POINTER(block_codec_compress(DatumGetPointer(inner), codec));
+}
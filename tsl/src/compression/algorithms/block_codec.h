@@ -0,0 +1,53 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+/*
+ * The block codec compresses the entire array or dictionary compressed data
+ * with a general-purpose codec, LZ4 or ZSTD, depending on what PostgreSQL was
+ * built with. These algorithms store the values as is, so without the block
+ * codec, they rely on the TOAST compression, which is pglz by default. Doing
+ * this in the compressor lets us choose the codec, and decompress the data
+ * straight into the memory of the decompression, without the detoaster having
+ * to decompress it first.
+ *
+ * The result is stored as a separate compression algorithm that wraps the
+ * original compressed data, and uses its functions after decoding it.
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+
+#include "compression/compression.h"
+#include "guc.h"
+
+extern bool block_codec_compressed_has_nulls(const CompressedDataHeader *header);
+extern Compressor *block_codec_compressor_for_type(Oid element_type);
+extern Compressor *block_codec_compressor_wrap(Compressor *inner, CompressionBlockCodec codec);
+extern void *block_codec_compress(void *compressed, CompressionBlockCodec codec);
+
+extern DecompressionIterator *
+block_codec_decompression_iterator_from_datum_forward(Datum compressed, Oid element_type);
+extern DecompressionIterator *
+block_codec_decompression_iterator_from_datum_reverse(Datum compressed, Oid element_type);
+
+extern ArrowArray *block_codec_decompress_all(Datum compressed, Oid element_type,
+											  MemoryContext dest_mctx);
+
+extern void block_codec_compressed_send(CompressedDataHeader *header, StringInfo buffer);
+extern Datum block_codec_compressed_recv(StringInfo buf);
+
+#define BLOCK_CODEC_ALGORITHM_DEFINITION                                                           \
+	{                                                                                              \
+		.iterator_init_forward = block_codec_decompression_iterator_from_datum_forward,            \
+		.iterator_init_reverse = block_codec_decompression_iterator_from_datum_reverse,            \
+		.decompress_all = block_codec_decompress_all,                                              \
+		.compressed_data_send = block_codec_compressed_send,                                       \
+		.compressed_data_recv = block_codec_compressed_recv,                                       \
+		.compressor_for_type = block_codec_compressor_for_type,                                    \
+		.compressed_data_storage = TOAST_STORAGE_EXTERNAL,                                         \
+	}
@@ -10,6 +10,7 @@
 #include <catalog/pg_aggregate.h>
 #include <catalog/pg_type.h>
 #include <common/base64.h>
+#include <common/int.h>
 #include <funcapi.h>
 #include <lib/stringinfo.h>
 #include <stdbool.h>
@@ -21,8 +22,11 @@
 
 #include <utils.h>
 
+#include "adts/uint64_vec.h"
 #include "compression/arrow_c_data_interface.h"
 #include "compression/compression.h"
+#include "dictionary.h"
+#include "for.h"
 #include "simple8b_rle.h"
 #include "simple8b_rle_bitmap.h"
 
@@ -69,12 +73,25 @@ typedef struct DeltaDeltaCompressor
 	Simple8bRleCompressor delta_delta;
 	Simple8bRleCompressor nulls;
 	bool has_nulls;
+
+	/*
+	 * The original values, kept if we consider falling back to the FOR
+	 * algorithm at finish.
+	 */
+	bool try_for;
+	uint64_vec values;
 } DeltaDeltaCompressor;
 
 typedef struct ExtendedCompressor
 {
 	Compressor base;
 	DeltaDeltaCompressor *internal;
+	Oid element_type;
+	/*
+	 * The values are also compressed with the dictionary when it is enabled,
+	 * and we keep the better result for each batch.
+	 */
+	DictionaryCompressor *dictionary;
 } ExtendedCompressor;
 
 bool
@@ -84,14 +101,37 @@ deltadelta_compressed_has_nulls(const CompressedDataHeader *header)
 	return ddc->has_nulls;
 }
 
+static void
+deltadelta_extended_compressor_init(ExtendedCompressor *extended)
+{
+	extended->internal = delta_delta_compressor_alloc();
+
+	if (compression_candidate_enabled(COMPRESSION_ALGORITHM_DICTIONARY) &&
+		extended->element_type != BOOLOID)
+	{
+		extended->dictionary = dictionary_compressor_alloc(extended->element_type);
+	}
+}
+
+static void
+deltadelta_extended_compressor_append_candidates(ExtendedCompressor *extended, Datum val)
+{
+	if (extended->dictionary != NULL &&
+		!dictionary_compressor_candidate_append(extended->dictionary, val))
+	{
+		extended->dictionary = NULL;
+	}
+}
+
 static void
 deltadelta_compressor_append_bool(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = delta_delta_compressor_alloc();
+		deltadelta_extended_compressor_init(extended);
 
 	delta_delta_compressor_append_value(extended->internal, DatumGetBool(val) ? 1 : 0);
+	deltadelta_extended_compressor_append_candidates(extended, val);
 }
 
 static void
@@ -99,9 +139,10 @@ deltadelta_compressor_append_int16(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = delta_delta_compressor_alloc();
+		deltadelta_extended_compressor_init(extended);
 
 	delta_delta_compressor_append_value(extended->internal, DatumGetInt16(val));
+	deltadelta_extended_compressor_append_candidates(extended, val);
 }
 
 static void
@@ -109,9 +150,10 @@ deltadelta_compressor_append_int32(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = delta_delta_compressor_alloc();
+		deltadelta_extended_compressor_init(extended);
 
 	delta_delta_compressor_append_value(extended->internal, DatumGetInt32(val));
+	deltadelta_extended_compressor_append_candidates(extended, val);
 }
 
 static void
@@ -119,9 +161,10 @@ deltadelta_compressor_append_int64(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = delta_delta_compressor_alloc();
+		deltadelta_extended_compressor_init(extended);
 
 	delta_delta_compressor_append_value(extended->internal, DatumGetInt64(val));
+	deltadelta_extended_compressor_append_candidates(extended, val);
 }
 
 static void
@@ -129,9 +172,10 @@ deltadelta_compressor_append_date(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = delta_delta_compressor_alloc();
+		deltadelta_extended_compressor_init(extended);
 
 	delta_delta_compressor_append_value(extended->internal, DatumGetDateADT(val));
+	deltadelta_extended_compressor_append_candidates(extended, val);
 }
 
 static void
@@ -139,9 +183,10 @@ deltadelta_compressor_append_timestamp(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = delta_delta_compressor_alloc();
+		deltadelta_extended_compressor_init(extended);
 
 	delta_delta_compressor_append_value(extended->internal, DatumGetTimestamp(val));
+	deltadelta_extended_compressor_append_candidates(extended, val);
 }
 
 static void
@@ -149,9 +194,10 @@ deltadelta_compressor_append_timestamptz(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = delta_delta_compressor_alloc();
+		deltadelta_extended_compressor_init(extended);
 
 	delta_delta_compressor_append_value(extended->internal, DatumGetTimestampTz(val));
+	deltadelta_extended_compressor_append_candidates(extended, val);
 }
 
 static void
@@ -159,9 +205,11 @@ deltadelta_compressor_append_null_value(Compressor *compressor)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = delta_delta_compressor_alloc();
+		deltadelta_extended_compressor_init(extended);
 
 	delta_delta_compressor_append_null(extended->internal);
+	if (extended->dictionary != NULL)
+		dictionary_compressor_append_null(extended->dictionary);
 }
 
 static void *
@@ -171,6 +219,14 @@ deltadelta_compressor_finish_and_reset(Compressor *compressor)
 	void *compressed = delta_delta_compressor_finish(extended->internal);
 	pfree(extended->internal);
 	extended->internal = NULL;
+
+	if (extended->dictionary != NULL)
+	{
+		compressed = dictionary_compressor_finish_candidate(extended->dictionary, compressed);
+		pfree(extended->dictionary);
+		extended->dictionary = NULL;
+	}
+
 	return compressed;
 }
 
@@ -221,25 +277,32 @@ delta_delta_compressor_for_type(Oid element_type)
 	switch (element_type)
 	{
 		case BOOLOID:
-			*compressor = (ExtendedCompressor){ .base = deltadelta_bool_compressor };
+			*compressor = (ExtendedCompressor){ .base = deltadelta_bool_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		case INT2OID:
-			*compressor = (ExtendedCompressor){ .base = deltadelta_uint16_compressor };
+			*compressor = (ExtendedCompressor){ .base = deltadelta_uint16_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		case INT4OID:
-			*compressor = (ExtendedCompressor){ .base = deltadelta_uint32_compressor };
+			*compressor = (ExtendedCompressor){ .base = deltadelta_uint32_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		case INT8OID:
-			*compressor = (ExtendedCompressor){ .base = deltadelta_uint64_compressor };
+			*compressor = (ExtendedCompressor){ .base = deltadelta_uint64_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		case DATEOID:
-			*compressor = (ExtendedCompressor){ .base = deltadelta_date_compressor };
+			*compressor = (ExtendedCompressor){ .base = deltadelta_date_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		case TIMESTAMPOID:
-			*compressor = (ExtendedCompressor){ .base = deltadelta_timestamp_compressor };
+			*compressor = (ExtendedCompressor){ .base = deltadelta_timestamp_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		case TIMESTAMPTZOID:
-			*compressor = (ExtendedCompressor){ .base = deltadelta_timestamptz_compressor };
+			*compressor = (ExtendedCompressor){ .base = deltadelta_timestamptz_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		default:
 			elog(ERROR,
@@ -291,6 +354,11 @@ delta_delta_compressor_alloc(void)
 	DeltaDeltaCompressor *compressor = palloc0(sizeof(*compressor));
 	simple8brle_compressor_init(&compressor->delta_delta);
 	simple8brle_compressor_init(&compressor->nulls);
+
+	compressor->try_for = compression_candidate_enabled(COMPRESSION_ALGORITHM_FOR);
+	if (compressor->try_for)
+		uint64_vec_init(&compressor->values, CurrentMemoryContext, TARGET_COMPRESSED_BATCH_SIZE);
+
 	return compressor;
 }
 
@@ -348,6 +416,36 @@ delta_delta_compressor_finish(DeltaDeltaCompressor *compressor)
 	if (deltas == NULL)
 		return NULL;
 
+	/*
+	 * The delta-delta encoding doesn't help for the values that have a narrow
+	 * range but no monotonic pattern. Use the FOR algorithm if it gives a
+	 * better result. The nulls bitmap is the same for both, so we don't count
+	 * it.
+	 */
+	if (compressor->try_for)
+	{
+		const Size deltadelta_size =
+			sizeof(DeltaDeltaCompressed) + simple8brle_serialized_total_size(deltas);
+		const Size for_size =
+			for_compressed_size(compressor->values.data, compressor->values.num_elements);
+
+		void *for_compressed = NULL;
+		if (compression_candidate_is_better(COMPRESSION_ALGORITHM_FOR,
+											for_size,
+											COMPRESSION_ALGORITHM_DELTADELTA,
+											deltadelta_size))
+		{
+			for_compressed = for_compressed_from_values(compressor->values.data,
+														compressor->values.num_elements,
+														compressor->has_nulls ? nulls : NULL);
+		}
+
+		uint64_vec_free_data(&compressor->values);
+
+		if (for_compressed != NULL)
+			return for_compressed;
+	}
+
 	compressed = delta_delta_from_parts(compressor->prev_val,
 										compressor->prev_delta,
 										deltas,
@@ -400,6 +498,9 @@ delta_delta_compressor_append_value(DeltaDeltaCompressor *compressor, int64 next
 	compressor->prev_val = next_val;
 	compressor->prev_delta = delta;
 
+	if (compressor->try_for)
+		uint64_vec_append(&compressor->values, (uint64) next_val);
+
 	/* step 2: ZigZag encode */
 	encoded = zig_zag_encode(delta_delta);
 
@@ -617,6 +718,44 @@ delta_delta_decompress_all(Datum compressed_data, Oid element_type, MemoryContex
 	}
 }
 
+/*
+ * Check whether the values form an arithmetic sequence, i.e. go with a constant
+ * step, which is common for the timestamps that are collected with a fixed
+ * interval. Returns the first value and the step. The data with nulls or with
+ * a sequence that overflows int64 is not reported as arithmetic, so the values
+ * that are reported are also guaranteed to be monotonic.
+ */
+bool
+delta_delta_compressed_get_step(const CompressedDataHeader *header, int64 *first, int64 *step)
+{
+	StringInfoData si = { .data = (char *) header, .len = VARSIZE(header) };
+	DeltaDeltaCompressed *compressed = consumeCompressedData(&si, sizeof(DeltaDeltaCompressed));
+	Simple8bRleSerialized *deltas = bytes_deserialize_simple8b_and_advance(&si);
+
+	if (compressed->has_nulls != 0)
+		return false;
+
+	uint64 head_zigzag[2];
+	if (!simple8brle_serialized_zero_tail(deltas, 2, head_zigzag))
+		return false;
+
+	const uint64 first_value = zig_zag_decode(head_zigzag[0]);
+	const int64 step_value = (int64) (first_value + zig_zag_decode(head_zigzag[1]));
+
+	/*
+	 * The values are computed with wraparound, so check that the last one
+	 * fits, otherwise the sequence is not monotonic.
+	 */
+	int64 last_value;
+	if (pg_mul_s64_overflow(step_value, deltas->num_elements - 1, &last_value) ||
+		pg_add_s64_overflow(last_value, (int64) first_value, &last_value))
+		return false;
+
+	*first = (int64) first_value;
+	*step = step_value;
+	return true;
+}
+
 /* Functions for reverse iterator. */
 static DecompressResultInternal
 delta_delta_decompression_iterator_try_next_reverse_internal(DeltaDeltaDecompressionIterator *iter)
@@ -45,6 +45,8 @@ delta_delta_decompression_iterator_try_next_forward(DecompressionIterator *iter)
 
 extern ArrowArray *delta_delta_decompress_all(Datum compressed_data, Oid element_type,
 											  MemoryContext dest_mctx);
+extern bool delta_delta_compressed_get_step(const CompressedDataHeader *header, int64 *first,
+											int64 *step);
 
 extern DecompressResult
 delta_delta_decompression_iterator_try_next_reverse(DecompressionIterator *iter);
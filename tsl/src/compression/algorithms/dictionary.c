@@ -25,8 +25,12 @@
 #include "datum_serialize.h"
 #include "dictionary.h"
 #include "dictionary_hash.h"
+#include "fsst.h"
+#include "guc.h"
+#include "jsonb_shred.h"
 #include "simple8b_rle.h"
 #include "simple8b_rle_bitmap.h"
+#include "uuid_compress.h"
 
 /*
  * A compression bitmap is stored as
@@ -85,6 +89,8 @@ struct DictionaryDecompressionIterator
 typedef struct DictionaryCompressor
 {
 	dictionary_hash *dictionary_items;
+	/* Used instead of dictionary_items for the by-value types. */
+	dictionary_fixed_hash *fixed_items;
 	uint32 next_index;
 	Oid type;
 	int16 typlen;
@@ -163,7 +169,16 @@ dictionary_compressor_alloc(Oid type)
 	compressor->typbyval = tentry->typbyval;
 	compressor->typalign = tentry->typalign;
 
-	compressor->dictionary_items = dictionary_hash_alloc(tentry);
+	if (compressor->typbyval)
+	{
+		compressor->dictionary_items = NULL;
+		compressor->fixed_items = dictionary_fixed_create(CurrentMemoryContext, 10, NULL);
+	}
+	else
+	{
+		compressor->dictionary_items = dictionary_hash_alloc(tentry);
+		compressor->fixed_items = NULL;
+	}
 
 	simple8brle_compressor_init(&compressor->dictionary_indexes);
 	simple8brle_compressor_init(&compressor->nulls);
@@ -185,7 +200,10 @@ dictionary_compressor_append(DictionaryCompressor *compressor, Datum val)
 
 	Assert(compressor != NULL);
 
-	dict_item = dictionary_insert(compressor->dictionary_items, val, &found);
+	if (compressor->fixed_items != NULL)
+		dict_item = dictionary_fixed_insert(compressor->fixed_items, val, &found);
+	else
+		dict_item = dictionary_insert(compressor->dictionary_items, val, &found);
 
 	if (!found)
 	{
@@ -220,7 +238,6 @@ compressor_get_serialization_info(DictionaryCompressor *compressor)
 	Simple8bRleSerialized *dict_indexes =
 		simple8brle_compressor_finish(&compressor->dictionary_indexes);
 	Simple8bRleSerialized *nulls = simple8brle_compressor_finish(&compressor->nulls);
-	dictionary_iterator dictionary_item_iterator;
 
 	ArrayCompressor *array_comp = array_compressor_alloc(compressor->type);
 
@@ -240,15 +257,32 @@ compressor_get_serialization_info(DictionaryCompressor *compressor)
 		sizes.nulls_size = simple8brle_serialized_total_size(nulls);
 	sizes.total_size += sizes.nulls_size;
 
-	dictionary_start_iterate(compressor->dictionary_items, &dictionary_item_iterator);
 	sizes.num_distinct = 0;
-	for (DictionaryHashItem *dict_item =
-			 dictionary_iterate(compressor->dictionary_items, &dictionary_item_iterator);
-		 dict_item != NULL;
-		 dict_item = dictionary_iterate(compressor->dictionary_items, &dictionary_item_iterator))
+	if (compressor->fixed_items != NULL)
+	{
+		dictionary_fixed_iterator iterator;
+		dictionary_fixed_start_iterate(compressor->fixed_items, &iterator);
+		for (DictionaryHashItem *dict_item =
+				 dictionary_fixed_iterate(compressor->fixed_items, &iterator);
+			 dict_item != NULL;
+			 dict_item = dictionary_fixed_iterate(compressor->fixed_items, &iterator))
+		{
+			sizes.value_array[dict_item->index] = dict_item->key;
+			sizes.num_distinct += 1;
+		}
+	}
+	else
 	{
-		sizes.value_array[dict_item->index] = dict_item->key;
-		sizes.num_distinct += 1;
+		dictionary_iterator iterator;
+		dictionary_start_iterate(compressor->dictionary_items, &iterator);
+		for (DictionaryHashItem *dict_item =
+				 dictionary_iterate(compressor->dictionary_items, &iterator);
+			 dict_item != NULL;
+			 dict_item = dictionary_iterate(compressor->dictionary_items, &iterator))
+		{
+			sizes.value_array[dict_item->index] = dict_item->key;
+			sizes.num_distinct += 1;
+		}
 	}
 	for (uint32 i = 0; i < sizes.num_distinct; i++)
 	{
@@ -326,6 +360,52 @@ dictionary_compressed_to_array_compressed(DictionaryCompressed *compressed)
 	return array_compressor_finish(compressor);
 }
 
+static void *
+dictionary_compressed_to_fsst_compressed(DictionaryCompressed *compressed)
+{
+	FsstCompressor *compressor = fsst_compressor_alloc(compressed->element_type);
+	DictionaryDecompressionIterator iterator;
+	dictionary_decompression_iterator_init(&iterator,
+										   (void *) compressed,
+										   true,
+										   compressed->element_type);
+
+	for (DecompressResult res = dictionary_decompression_iterator_try_next_forward(&iterator.base);
+		 !res.is_done;
+		 res = dictionary_decompression_iterator_try_next_forward(&iterator.base))
+	{
+		if (res.is_null)
+			fsst_compressor_append_null(compressor);
+		else
+			fsst_compressor_append(compressor, res.val);
+	}
+
+	return fsst_compressor_finish(compressor);
+}
+
+static void *
+dictionary_compressed_to_uuid_compressed(DictionaryCompressed *compressed)
+{
+	UuidCompressor *compressor = uuid_compressor_alloc();
+	DictionaryDecompressionIterator iterator;
+	dictionary_decompression_iterator_init(&iterator,
+										   (void *) compressed,
+										   true,
+										   compressed->element_type);
+
+	for (DecompressResult res = dictionary_decompression_iterator_try_next_forward(&iterator.base);
+		 !res.is_done;
+		 res = dictionary_decompression_iterator_try_next_forward(&iterator.base))
+	{
+		if (res.is_null)
+			uuid_compressor_append_null(compressor);
+		else
+			uuid_compressor_append(compressor, res.val);
+	}
+
+	return uuid_compressor_finish(compressor);
+}
+
 void *
 dictionary_compressor_finish(DictionaryCompressor *compressor)
 {
@@ -344,10 +424,120 @@ dictionary_compressor_finish(DictionaryCompressor *compressor)
 	average_element_size = sizes.dictionary_size / sizes.num_distinct;
 	expected_array_size = average_element_size * sizes.dictionary_compressed_indexes->num_elements;
 	compressed = dictionary_compressed_from_serialization_info(sizes, compressor->type);
+	void *result = compressed;
 	if (expected_array_size < sizes.total_size)
-		return dictionary_compressed_to_array_compressed(compressed);
+	{
+		void *array_compressed = dictionary_compressed_to_array_compressed(compressed);
 
-	return compressed;
+		/*
+		 * The values are too distinct for the dictionary, but they might still
+		 * share a lot of substrings, so try FSST as well.
+		 */
+		if (compression_candidate_enabled(COMPRESSION_ALGORITHM_FSST) &&
+			(compressor->type == TEXTOID || compressor->type == VARCHAROID))
+		{
+			void *fsst_compressed = dictionary_compressed_to_fsst_compressed(compressed);
+			if (fsst_compressed != NULL &&
+				compression_candidate_is_better(COMPRESSION_ALGORITHM_FSST,
+												VARSIZE(fsst_compressed),
+												COMPRESSION_ALGORITHM_ARRAY,
+												VARSIZE(array_compressed)))
+				return fsst_compressed;
+		}
+
+		result = array_compressed;
+	}
+
+	/*
+	 * The version 7 UUIDs are mostly distinct, but their timestamps are close
+	 * to each other, so the UUID algorithm can be better even when the
+	 * dictionary is.
+	 */
+	if (compression_candidate_enabled(COMPRESSION_ALGORITHM_UUID) && compressor->type == UUIDOID)
+	{
+		const CompressedDataHeader *result_header = (const CompressedDataHeader *) result;
+		void *uuid_compressed = dictionary_compressed_to_uuid_compressed(compressed);
+		if (uuid_compressed != NULL &&
+			compression_candidate_is_better(COMPRESSION_ALGORITHM_UUID,
+											VARSIZE(uuid_compressed),
+											result_header->compression_algorithm,
+											VARSIZE(result)))
+			return uuid_compressed;
+	}
+
+	/*
+	 * The shredding of jsonb doesn't necessarily make the data smaller, but it
+	 * makes the filters on the shredded keys faster, so we use it whenever
+	 * some keys qualify.
+	 */
+	if (ts_guc_enable_jsonb_shredding && compressor->type == JSONBOID)
+	{
+		void *shredded = jsonb_shred_compress((const CompressedDataHeader *) result);
+		if (shredded != NULL)
+			return shredded;
+	}
+
+	return result;
+}
+
+/*
+ * The dictionary compressor can run alongside the default compressor of a
+ * fixed-width column, as a candidate for the columns that have only a few
+ * distinct values, like the enum-like integers or the float setpoints. When
+ * the values turn out to be more distinct than this, the candidate is dropped,
+ * so that we don't spend time on hashing them.
+ */
+#define DICTIONARY_CANDIDATE_MAX_DISTINCT 256
+
+/*
+ * Append a value to the candidate dictionary compressor. Returns false and
+ * frees the compressor if it is not worth trying anymore.
+ */
+bool
+dictionary_compressor_candidate_append(DictionaryCompressor *compressor, Datum val)
+{
+	dictionary_compressor_append(compressor, val);
+	if (compressor->next_index <= DICTIONARY_CANDIDATE_MAX_DISTINCT)
+		return true;
+
+	if (compressor->fixed_items != NULL)
+		dictionary_fixed_destroy(compressor->fixed_items);
+	else
+		dictionary_destroy(compressor->dictionary_items);
+	pfree(compressor);
+	return false;
+}
+
+/*
+ * Finish the candidate dictionary compressor, and return either the
+ * dictionary compressed data or the given compressed data of the default
+ * compressor, whichever is better. The other one is freed. We always produce
+ * the dictionary here and never fall back to the array, because the
+ * fixed-width columns support bulk decompression only for the former.
+ */
+void *
+dictionary_compressor_finish_candidate(DictionaryCompressor *compressor, void *compressed)
+{
+	if (compressed == NULL)
+	{
+		/* All values are null. */
+		return NULL;
+	}
+
+	DictionaryCompressorSerializationInfo sizes = compressor_get_serialization_info(compressor);
+	Assert(!sizes.is_all_null);
+
+	const CompressedDataHeader *header = (const CompressedDataHeader *) compressed;
+	if (!compression_candidate_is_better(COMPRESSION_ALGORITHM_DICTIONARY,
+										 sizes.total_size,
+										 header->compression_algorithm,
+										 VARSIZE(compressed)))
+	{
+		return compressed;
+	}
+
+	pfree(compressed);
+	return dictionary_compressed_from_serialization_info(sizes, compressor->type);
 }
 
 ////////////////////
@@ -410,26 +600,22 @@ dictionary_decompression_iterator_init(DictionaryDecompressionIterator *iter, co
 #include "simple8b_rle_decompress_all.h"
 #undef ELEMENT_TYPE
 
-ArrowArray *
-tsl_text_dictionary_decompress_all(Datum compressed, Oid element_type, MemoryContext dest_mctx)
+/*
+ * Decompress the dictionary indices of all rows, and the validity bitmap if
+ * we have nulls. The indices of the null rows are set to zero, so that they
+ * are valid. The data is consumed up to the dictionary items.
+ */
+static int16 *
+dictionary_decompress_indices(StringInfo si, const DictionaryCompressed *header,
+							  MemoryContext dest_mctx, uint32 *n_total_out, uint32 *n_notnull_out,
+							  uint64 **validity_bitmap_out)
 {
-	Assert(element_type == TEXTOID);
-
-	compressed = PointerGetDatum(PG_DETOAST_DATUM(compressed));
-
-	StringInfoData si = { .data = DatumGetPointer(compressed), .len = VARSIZE(compressed) };
-
-	const DictionaryCompressed *header = consumeCompressedData(&si, sizeof(DictionaryCompressed));
-
-	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_DICTIONARY);
-	CheckCompressedData(header->element_type == TEXTOID);
-
-	Simple8bRleSerialized *indices_serialized = bytes_deserialize_simple8b_and_advance(&si);
+	Simple8bRleSerialized *indices_serialized = bytes_deserialize_simple8b_and_advance(si);
 
 	Simple8bRleSerialized *nulls_serialized = NULL;
 	if (header->has_nulls)
 	{
-		nulls_serialized = bytes_deserialize_simple8b_and_advance(&si);
+		nulls_serialized = bytes_deserialize_simple8b_and_advance(si);
 	}
 
 	const uint32 n_notnull = indices_serialized->num_elements;
@@ -454,11 +640,6 @@ tsl_text_dictionary_decompress_all(Datum compressed, Oid element_type, MemoryCon
 	}
 	CheckCompressedData(!have_incorrect_index);
 
-	/* Decompress the actual values in the dictionary. */
-	ArrowArray *dict =
-		text_array_decompress_all_serialized_no_header(&si, /* has_nulls = */ false, dest_mctx);
-	CheckCompressedData(header->num_distinct == dict->length);
-
 	uint64 *restrict validity_bitmap = NULL;
 	if (header->has_nulls)
 	{
@@ -509,6 +690,41 @@ tsl_text_dictionary_decompress_all(Datum compressed, Oid element_type, MemoryCon
 		Assert(current_notnull_element == -1);
 	}
 
+	*n_total_out = n_total;
+	*n_notnull_out = n_notnull;
+	*validity_bitmap_out = validity_bitmap;
+	return indices;
+}
+
+ArrowArray *
+tsl_text_dictionary_decompress_all(Datum compressed, Oid element_type, MemoryContext dest_mctx)
+{
+	Assert(element_type == TEXTOID);
+
+	compressed = PointerGetDatum(PG_DETOAST_DATUM(compressed));
+
+	StringInfoData si = { .data = DatumGetPointer(compressed), .len = VARSIZE(compressed) };
+
+	const DictionaryCompressed *header = consumeCompressedData(&si, sizeof(DictionaryCompressed));
+
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_DICTIONARY);
+	CheckCompressedData(header->element_type == TEXTOID);
+
+	uint32 n_total;
+	uint32 n_notnull;
+	uint64 *validity_bitmap;
+	int16 *indices = dictionary_decompress_indices(&si,
+												   header,
+												   dest_mctx,
+												   &n_total,
+												   &n_notnull,
+												   &validity_bitmap);
+
+	/* Decompress the actual values in the dictionary. */
+	ArrowArray *dict =
+		text_array_decompress_all_serialized_no_header(&si, /* has_nulls = */ false, dest_mctx);
+	CheckCompressedData(header->num_distinct == dict->length);
+
 	ArrowArray *result =
 		MemoryContextAllocZero(dest_mctx, sizeof(ArrowArray) + (sizeof(void *) * 2));
 	const void **buffers = (const void **) &result[1];
@@ -522,6 +738,110 @@ tsl_text_dictionary_decompress_all(Datum compressed, Oid element_type, MemoryCon
 	return result;
 }
 
+/*
+ * Gather the values of all rows from the dictionary. This loop is simple
+ * enough to be vectorized with the gather instructions where we have them.
+ */
+#define DICTIONARY_GATHER(CTYPE)                                                                   \
+	do                                                                                             \
+	{                                                                                              \
+		const CTYPE *restrict dict_values = (const CTYPE *) dict;                                  \
+		CTYPE *restrict values_typed = (CTYPE *) values;                                           \
+		for (uint32 i = 0; i < n_total; i++)                                                       \
+		{                                                                                          \
+			values_typed[i] = dict_values[indices[i]];                                             \
+		}                                                                                          \
+	} while (0)
+
+/*
+ * Bulk decompression of the dictionary compressed fixed-width types, such as
+ * integers and floats. Unlike text, the result is a plain Arrow array
+ * of values, and not a dictionary-encoded one, because this is what the rest of
+ * the vectorized pipeline expects for these types. The predicates on these
+ * types are cheap anyway, computing them on the dictionary and translating the
+ * result would cost about as much as computing them for all rows.
+ */
+ArrowArray *
+tsl_fixed_dictionary_decompress_all(Datum compressed, Oid element_type, MemoryContext dest_mctx)
+{
+	int16 typlen;
+	bool typbyval;
+	get_typlenbyval(element_type, &typlen, &typbyval);
+	Assert(typlen == 2 || typlen == 4 || typlen == 8);
+
+	compressed = PointerGetDatum(PG_DETOAST_DATUM(compressed));
+
+	StringInfoData si = { .data = DatumGetPointer(compressed), .len = VARSIZE(compressed) };
+
+	const DictionaryCompressed *header = consumeCompressedData(&si, sizeof(DictionaryCompressed));
+
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_DICTIONARY);
+	CheckCompressedData(header->element_type == element_type);
+
+	uint32 n_total;
+	uint32 n_notnull;
+	uint64 *validity_bitmap;
+	int16 *indices = dictionary_decompress_indices(&si,
+												   header,
+												   dest_mctx,
+												   &n_total,
+												   &n_notnull,
+												   &validity_bitmap);
+
+	/*
+	 * Decompress the actual values in the dictionary. There are only a few of
+	 * them, so we use the row-by-row array iterator.
+	 */
+	char *dict = palloc(typlen * header->num_distinct);
+	DecompressionIterator *dictionary_iterator =
+		array_decompression_iterator_alloc_forward(&si, element_type, /* has_nulls */ false);
+	for (uint32 i = 0; i < header->num_distinct; i++)
+	{
+		DecompressResult res = array_decompression_iterator_try_next_forward(dictionary_iterator);
+		CheckCompressedData(!res.is_done && !res.is_null);
+		if (typbyval)
+			store_att_byval(&dict[typlen * i], res.val, typlen);
+		else
+			memcpy(&dict[typlen * i], DatumGetPointer(res.val), typlen);
+	}
+	CheckCompressedData(array_decompression_iterator_try_next_forward(dictionary_iterator).is_done);
+
+	/*
+	 * Pad the values to a multiple of 64 elements with zeros, and add 8 bytes
+	 * for the code that converts the elements to postgres Datum, like the
+	 * other fixed-width algorithms do.
+	 */
+	const Size values_bytes = typlen * pad_to_multiple(64, n_total) + 8;
+	char *restrict values = MemoryContextAlloc(dest_mctx, values_bytes);
+	memset(&values[typlen * n_total], 0, values_bytes - typlen * n_total);
+
+	switch (typlen)
+	{
+		case 2:
+			DICTIONARY_GATHER(uint16);
+			break;
+		case 4:
+			DICTIONARY_GATHER(uint32);
+			break;
+		default:
+			DICTIONARY_GATHER(uint64);
+			break;
+	}
+
+	ArrowArray *result =
+		MemoryContextAllocZero(dest_mctx, sizeof(ArrowArray) + (sizeof(void *) * 2));
+	const void **buffers = (const void **) &result[1];
+	buffers[0] = validity_bitmap;
+	buffers[1] = values;
+	result->n_buffers = 2;
+	result->buffers = buffers;
+	result->length = n_total;
+	result->null_count = n_total - n_notnull;
+	return result;
+}
+
+#undef DICTIONARY_GATHER
+
 DecompressionIterator *
 tsl_dictionary_decompression_iterator_from_datum_forward(Datum dictionary_compressed,
 														 Oid element_type)
@@ -29,6 +29,9 @@ extern DictionaryCompressor *dictionary_compressor_alloc(Oid type_to_compress);
 extern void dictionary_compressor_append_null(DictionaryCompressor *compressor);
 extern void dictionary_compressor_append(DictionaryCompressor *compressor, Datum val);
 extern void *dictionary_compressor_finish(DictionaryCompressor *compressor);
+extern bool dictionary_compressor_candidate_append(DictionaryCompressor *compressor, Datum val);
+extern void *dictionary_compressor_finish_candidate(DictionaryCompressor *compressor,
+													void *compressed);
 
 extern DecompressionIterator *
 tsl_dictionary_decompression_iterator_from_datum_forward(Datum dictionary_compressed,
@@ -54,6 +57,9 @@ ArrowArray *tsl_text_array_decompress_all(Datum compressed_array, Oid element_ty
 ArrowArray *tsl_text_dictionary_decompress_all(Datum compressed, Oid element_type,
 											   MemoryContext dest_mctx);
 
+ArrowArray *tsl_fixed_dictionary_decompress_all(Datum compressed, Oid element_type,
+												MemoryContext dest_mctx);
+
 #define DICTIONARY_ALGORITHM_DEFINITION                                                            \
 	{                                                                                              \
 		.iterator_init_forward = tsl_dictionary_decompression_iterator_from_datum_forward,         \
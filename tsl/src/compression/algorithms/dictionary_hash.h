@@ -108,3 +108,36 @@ dictionary_hash_alloc(TypeCacheEntry *tentry)
 
 	return dictionary_create(CurrentMemoryContext, 10, meta);
 }
+
+/*
+ * The hash table for the by-value types, such as integers and floats. The
+ * values are compared and hashed by their Datum bits, which avoids the function
+ * calls of the type's hash and equality functions for each row. This also
+ * keeps the values that are equal but not identical apart, like the -0 and +0
+ * floats, so that they are restored exactly.
+ */
+static inline uint32
+fixed_datum_hash(Datum key)
+{
+	/* The SplitMix64 finalizer. */
+	uint64 x = (uint64) key;
+	x ^= x >> 30;
+	x *= UINT64CONST(0xbf58476d1ce4e5b9);
+	x ^= x >> 27;
+	x *= UINT64CONST(0x94d049bb133111eb);
+	x ^= x >> 31;
+	return (uint32) x;
+}
+
+#define SH_PREFIX dictionary_fixed
+#define SH_ELEMENT_TYPE DictionaryHashItem
+#define SH_KEY_TYPE Datum
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) fixed_datum_hash(key)
+#define SH_EQUAL(tb, a, b) ((a) == (b))
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, entry) entry->hash
+#define SH_SCOPE static inline
+#define SH_DEFINE
+#define SH_DECLARE
+#include "lib/simplehash.h"
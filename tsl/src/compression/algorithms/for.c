@@ -0,0 +1,696 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "for.h"
+
+#include <catalog/pg_type.h>
+#include <lib/stringinfo.h>
+#include <libpq/pqformat.h>
+#include <port/pg_bitutils.h>
+#include <utils/builtins.h>
+#include <utils/date.h>
+#include <utils/timestamp.h>
+
+#include "adts/bit_array.h"
+#include "adts/uint64_vec.h"
+#include "compression/arrow_c_data_interface.h"
+#include "compression/compression.h"
+#include "simple8b_rle.h"
+#include "simple8b_rle_bitmap.h"
+
+/*
+ * FOR compressed data is stored as
+ *     ForCompressed header
+ *     uint64 packed[]: (value - reference) bit-packed with bits_per_value bits,
+ *         low-order bits first, followed by a padding word, so that every value
+ *         can be read from two consecutive words
+ *     uint64 exception_high_bits[num_exceptions]: value >> bits_per_value
+ *     uint16 exception_rows[num_exceptions]: padded to a multiple of 8 bytes
+ *     simple8b_rle nulls: 1 if the value is NULL, else 0, only if has_nulls
+ */
+typedef struct ForCompressed
+{
+	CompressedDataHeaderFields;
+	uint8 has_nulls; /* 1 if this has a NULLs bitmap after the data, 0 otherwise */
+	uint8 bits_per_value;
+	uint8 padding;
+	uint32 num_values;
+	uint32 num_exceptions;
+	uint64 reference;
+	char data[FLEXIBLE_ARRAY_MEMBER];
+} ForCompressed;
+
+static void
+pg_attribute_unused() assertions(void)
+{
+	ForCompressed test_val = { .vl_len_ = { 0 } };
+	/* make sure no padding bytes make it to disk */
+	StaticAssertStmt(sizeof(ForCompressed) ==
+						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
+							 sizeof(test_val.has_nulls) + sizeof(test_val.bits_per_value) +
+							 sizeof(test_val.padding) + sizeof(test_val.num_values) +
+							 sizeof(test_val.num_exceptions) + sizeof(test_val.reference),
+					 "ForCompressed wrong size");
+	StaticAssertStmt(sizeof(ForCompressed) == 24, "ForCompressed wrong size");
+}
+
+typedef struct ForCompressor
+{
+	uint64_vec values;
+	Simple8bRleCompressor nulls;
+	bool has_nulls;
+} ForCompressor;
+
+typedef struct ExtendedCompressor
+{
+	Compressor base;
+	ForCompressor *internal;
+	Oid element_type;
+} ExtendedCompressor;
+
+typedef struct ForDecompressionIterator
+{
+	DecompressionIterator base;
+	const uint64 *values;
+	uint32 num_values;
+	/* The number of values returned so far. */
+	uint32 num_returned;
+	Simple8bRleDecompressionIterator nulls;
+	bool has_nulls;
+} ForDecompressionIterator;
+
+/*
+ * The bit-packing parameters chosen for a given set of values.
+ */
+typedef struct ForLayout
+{
+	uint64 reference;
+	uint8 bits_per_value;
+	uint32 num_exceptions;
+	Size size;
+} ForLayout;
+
+static inline uint32
+for_num_packed_words(uint32 num_values, uint8 bits_per_value)
+{
+	/* One word of padding, see the format description above. */
+	return ((uint64) num_values * bits_per_value + 63) / 64 + 1;
+}
+
+static inline Size
+for_exception_rows_bytes(uint32 num_exceptions)
+{
+	return TYPEALIGN(sizeof(uint64), sizeof(uint16) * num_exceptions);
+}
+
+static inline Size
+for_data_size(uint32 num_values, uint8 bits_per_value, uint32 num_exceptions)
+{
+	return sizeof(ForCompressed) +
+		   sizeof(uint64) * for_num_packed_words(num_values, bits_per_value) +
+		   sizeof(uint64) * num_exceptions + for_exception_rows_bytes(num_exceptions);
+}
+
+static inline uint8
+for_bits_for_value(uint64 value)
+{
+	return value == 0 ? 0 : pg_leftmost_one_pos64(value) + 1;
+}
+
+/*
+ * Choose the reference value and the bit width that give the smallest
+ * compressed size.
+ */
+static ForLayout
+for_choose_layout(const uint64 *values, uint32 num_values)
+{
+	Assert(num_values > 0);
+
+	int64 min = (int64) values[0];
+	for (uint32 i = 1; i < num_values; i++)
+	{
+		min = Min(min, (int64) values[i]);
+	}
+
+	/*
+	 * Build the histogram of the bit widths of the differences. The values
+	 * with bit width higher than the chosen one become exceptions.
+	 */
+	uint32 num_values_with_bits[65] = { 0 };
+	for (uint32 i = 0; i < num_values; i++)
+	{
+		num_values_with_bits[for_bits_for_value(values[i] - (uint64) min)]++;
+	}
+
+	ForLayout best = {
+		.reference = (uint64) min,
+		.bits_per_value = 64,
+		.num_exceptions = 0,
+		.size = for_data_size(num_values, 64, 0),
+	};
+
+	uint32 num_exceptions = 0;
+	for (int bits = 63; bits >= 0; bits--)
+	{
+		num_exceptions += num_values_with_bits[bits + 1];
+		const Size size = for_data_size(num_values, bits, num_exceptions);
+		if (size < best.size)
+		{
+			best.bits_per_value = bits;
+			best.num_exceptions = num_exceptions;
+			best.size = size;
+		}
+	}
+
+	return best;
+}
+
+Size
+for_compressed_size(const uint64 *values, uint32 num_values)
+{
+	if (num_values == 0)
+		return 0;
+
+	return for_choose_layout(values, num_values).size;
+}
+
+ForCompressed *
+for_compressed_from_values(const uint64 *values, uint32 num_values, Simple8bRleSerialized *nulls)
+{
+	Assert(num_values > 0);
+	Assert(num_values <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	const ForLayout layout = for_choose_layout(values, num_values);
+	const uint8 bits = layout.bits_per_value;
+	const Size nulls_size = nulls != NULL ? simple8brle_serialized_total_size(nulls) : 0;
+	const Size compressed_size = layout.size + nulls_size;
+
+	if (!AllocSizeIsValid(compressed_size))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("compressed size exceeds the maximum allowed (%d)", (int) MaxAllocSize)));
+
+	char *compressed_data = palloc0(compressed_size);
+	ForCompressed *compressed = (ForCompressed *) compressed_data;
+	SET_VARSIZE(&compressed->vl_len_, compressed_size);
+	compressed->compression_algorithm = COMPRESSION_ALGORITHM_FOR;
+	compressed->has_nulls = nulls_size != 0 ? 1 : 0;
+	compressed->bits_per_value = bits;
+	compressed->num_values = num_values;
+	compressed->num_exceptions = layout.num_exceptions;
+	compressed->reference = layout.reference;
+
+	const uint32 num_packed_words = for_num_packed_words(num_values, bits);
+	uint64 *restrict packed = (uint64 *) compressed->data;
+	uint64 *restrict exception_high_bits = &packed[num_packed_words];
+	uint16 *restrict exception_rows = (uint16 *) &exception_high_bits[layout.num_exceptions];
+
+	const uint64 mask = bits == 0 ? 0 : (~0ULL >> (64 - bits));
+	uint32 current_exception = 0;
+	for (uint32 i = 0; i < num_values; i++)
+	{
+		const uint64 difference = values[i] - layout.reference;
+		const uint64 low_bits = difference & mask;
+		const uint64 bit_offset = (uint64) i * bits;
+		const uint32 word = bit_offset / 64;
+		const uint8 bit_in_word = bit_offset % 64;
+
+		packed[word] |= low_bits << bit_in_word;
+		if (bit_in_word + bits > 64)
+		{
+			packed[word + 1] |= low_bits >> (64 - bit_in_word);
+		}
+
+		if (for_bits_for_value(difference) > bits)
+		{
+			/* Can't have exceptions for the full bit width. */
+			Assert(bits < 64);
+			Assert(current_exception < layout.num_exceptions);
+			exception_high_bits[current_exception] = difference >> bits;
+			exception_rows[current_exception] = i;
+			current_exception++;
+		}
+	}
+	Assert(current_exception == layout.num_exceptions);
+
+	if (nulls_size > 0)
+	{
+		CheckCompressedData(nulls->num_elements > num_values);
+		bytes_serialize_simple8b_and_advance(compressed_data + layout.size, nulls_size, nulls);
+	}
+
+	return compressed;
+}
+
+/*
+ * The parts of the compressed data after they have been validated.
+ */
+typedef struct ForCompressedParts
+{
+	const ForCompressed *header;
+	const uint64 *packed;
+	const uint64 *exception_high_bits;
+	const uint16 *exception_rows;
+	Simple8bRleSerialized *nulls;
+} ForCompressedParts;
+
+static ForCompressedParts
+for_compressed_parts(void *compressed)
+{
+	StringInfoData si = { .data = compressed, .len = VARSIZE(compressed) };
+	const ForCompressed *header = consumeCompressedData(&si, sizeof(ForCompressed));
+
+	CheckCompressedData(header->has_nulls == 0 || header->has_nulls == 1);
+	CheckCompressedData(header->bits_per_value <= 64);
+	CheckCompressedData(header->num_values > 0);
+	CheckCompressedData(header->num_values <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+	CheckCompressedData(header->num_exceptions <= header->num_values);
+	CheckCompressedData(header->num_exceptions == 0 || header->bits_per_value < 64);
+
+	ForCompressedParts parts = { .header = header };
+	parts.packed =
+		consumeCompressedData(&si,
+							  sizeof(uint64) * for_num_packed_words(header->num_values,
+																	header->bits_per_value));
+	parts.exception_high_bits = consumeCompressedData(&si, sizeof(uint64) * header->num_exceptions);
+	parts.exception_rows =
+		consumeCompressedData(&si, for_exception_rows_bytes(header->num_exceptions));
+
+	if (header->has_nulls)
+	{
+		parts.nulls = bytes_deserialize_simple8b_and_advance(&si);
+		CheckCompressedData(parts.nulls->num_elements > header->num_values);
+	}
+
+	return parts;
+}
+
+/*
+ * Declare the bulk unpacking functions for each element type.
+ */
+#define ELEMENT_TYPE uint16
+#include "for_impl.c"
+#undef ELEMENT_TYPE
+
+#define ELEMENT_TYPE uint32
+#include "for_impl.c"
+#undef ELEMENT_TYPE
+
+#define ELEMENT_TYPE uint64
+#include "for_impl.c"
+#undef ELEMENT_TYPE
+
+/*
+ * Unpack the non-null values of a FOR-compressed datum that is embedded into
+ * the compressed data of some other algorithm. The caller must know the number
+ * of values in advance, and provide a buffer for them.
+ */
+void
+for_compressed_unpack(void *compressed, uint32 num_values, uint64 *restrict values)
+{
+	ForCompressedParts parts = for_compressed_parts(compressed);
+	CheckCompressedData(parts.header->num_values == num_values);
+	for_unpack_uint64(&parts, values);
+}
+
+bool
+for_compressed_has_nulls(const CompressedDataHeader *header)
+{
+	const ForCompressed *fc = (const ForCompressed *) header;
+	return fc->has_nulls;
+}
+
+/*
+ * Compressor framework functions and definitions for the FOR algorithm.
+ */
+
+ForCompressor *
+for_compressor_alloc(void)
+{
+	ForCompressor *compressor = palloc0(sizeof(*compressor));
+	uint64_vec_init(&compressor->values, CurrentMemoryContext, TARGET_COMPRESSED_BATCH_SIZE);
+	simple8brle_compressor_init(&compressor->nulls);
+	return compressor;
+}
+
+void
+for_compressor_append_null(ForCompressor *compressor)
+{
+	compressor->has_nulls = true;
+	simple8brle_compressor_append(&compressor->nulls, 1);
+}
+
+void
+for_compressor_append_value(ForCompressor *compressor, int64 next_val)
+{
+	uint64_vec_append(&compressor->values, (uint64) next_val);
+	simple8brle_compressor_append(&compressor->nulls, 0);
+}
+
+void *
+for_compressor_finish(ForCompressor *compressor)
+{
+	Simple8bRleSerialized *nulls = simple8brle_compressor_finish(&compressor->nulls);
+
+	if (compressor->values.num_elements == 0)
+		return NULL;
+
+	ForCompressed *compressed = for_compressed_from_values(compressor->values.data,
+														   compressor->values.num_elements,
+														   compressor->has_nulls ? nulls : NULL);
+
+	uint64_vec_free_data(&compressor->values);
+	return compressed;
+}
+
+static void
+for_compressor_append_datum(Compressor *compressor, Datum val)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = for_compressor_alloc();
+
+	int64 value;
+	switch (extended->element_type)
+	{
+		case INT2OID:
+			value = DatumGetInt16(val);
+			break;
+		case INT4OID:
+			value = DatumGetInt32(val);
+			break;
+		case DATEOID:
+			value = DatumGetDateADT(val);
+			break;
+		default:
+			/* INT8OID, TIMESTAMPOID, TIMESTAMPTZOID */
+			value = DatumGetInt64(val);
+			break;
+	}
+
+	for_compressor_append_value(extended->internal, value);
+}
+
+static void
+for_compressor_append_null_value(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = for_compressor_alloc();
+
+	for_compressor_append_null(extended->internal);
+}
+
+static void *
+for_compressor_finish_and_reset(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		return NULL;
+
+	void *compressed = for_compressor_finish(extended->internal);
+	pfree(extended->internal);
+	extended->internal = NULL;
+	return compressed;
+}
+
+const Compressor for_compressor = {
+	.append_val = for_compressor_append_datum,
+	.append_null = for_compressor_append_null_value,
+	.finish = for_compressor_finish_and_reset,
+};
+
+Compressor *
+for_compressor_for_type(Oid element_type)
+{
+	switch (element_type)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		{
+			ExtendedCompressor *compressor = palloc(sizeof(*compressor));
+			*compressor = (ExtendedCompressor){
+				.base = for_compressor,
+				.element_type = element_type,
+			};
+			return &compressor->base;
+		}
+		default:
+			elog(ERROR, "invalid type for FOR compressor \"%s\"", format_type_be(element_type));
+	}
+
+	pg_unreachable();
+}
+
+/*
+ * Decompression functions.
+ */
+
+static DecompressionIterator *
+for_decompression_iterator_from_datum(Datum for_compressed, Oid element_type, bool forward)
+{
+	void *detoasted = PG_DETOAST_DATUM(for_compressed);
+	ForCompressedParts parts = for_compressed_parts(detoasted);
+	ForDecompressionIterator *iter = palloc(sizeof(*iter));
+
+	/*
+	 * The row-by-row decompression is not performance-critical, so we just
+	 * unpack all the values at once.
+	 */
+	const uint32 num_values = parts.header->num_values;
+	uint64 *values = palloc(sizeof(uint64) * num_values);
+	for_unpack_uint64(&parts, values);
+
+	*iter = (ForDecompressionIterator){
+		.base = {
+			.compression_algorithm = COMPRESSION_ALGORITHM_FOR,
+			.forward = forward,
+			.element_type = element_type,
+			.try_next = forward ? for_decompression_iterator_try_next_forward :
+								  for_decompression_iterator_try_next_reverse,
+		},
+		.values = values,
+		.num_values = num_values,
+		.num_returned = 0,
+		.has_nulls = parts.header->has_nulls == 1,
+	};
+
+	if (iter->has_nulls)
+	{
+		if (forward)
+			simple8brle_decompression_iterator_init_forward(&iter->nulls, parts.nulls);
+		else
+			simple8brle_decompression_iterator_init_reverse(&iter->nulls, parts.nulls);
+	}
+
+	return &iter->base;
+}
+
+DecompressionIterator *
+for_decompression_iterator_from_datum_forward(Datum for_compressed, Oid element_type)
+{
+	return for_decompression_iterator_from_datum(for_compressed, element_type, true);
+}
+
+DecompressionIterator *
+for_decompression_iterator_from_datum_reverse(Datum for_compressed, Oid element_type)
+{
+	return for_decompression_iterator_from_datum(for_compressed, element_type, false);
+}
+
+static DecompressResult
+for_convert_to_datum(uint64 value, Oid element_type)
+{
+	switch (element_type)
+	{
+		case INT8OID:
+			return (DecompressResult){ .val = Int64GetDatum(value) };
+		case INT4OID:
+			return (DecompressResult){ .val = Int32GetDatum(value) };
+		case INT2OID:
+			return (DecompressResult){ .val = Int16GetDatum(value) };
+		case DATEOID:
+			return (DecompressResult){ .val = DateADTGetDatum(value) };
+		case TIMESTAMPTZOID:
+			return (DecompressResult){ .val = TimestampTzGetDatum(value) };
+		case TIMESTAMPOID:
+			return (DecompressResult){ .val = TimestampGetDatum(value) };
+		default:
+			elog(ERROR,
+				 "invalid type requested from FOR decompression \"%s\"",
+				 format_type_be(element_type));
+	}
+
+	pg_unreachable();
+}
+
+static DecompressResult
+for_decompression_iterator_try_next(ForDecompressionIterator *iter)
+{
+	if (iter->has_nulls)
+	{
+		Simple8bRleDecompressResult result =
+			iter->base.forward ? simple8brle_decompression_iterator_try_next_forward(&iter->nulls) :
+								 simple8brle_decompression_iterator_try_next_reverse(&iter->nulls);
+		if (result.is_done)
+			return (DecompressResult){ .is_done = true };
+
+		if (result.val != 0)
+		{
+			CheckCompressedData(result.val == 1);
+			return (DecompressResult){ .is_null = true };
+		}
+	}
+
+	if (iter->num_returned >= iter->num_values)
+	{
+		/* The nulls bitmap must be consistent with the number of values. */
+		CheckCompressedData(!iter->has_nulls);
+		return (DecompressResult){ .is_done = true };
+	}
+
+	const uint32 index =
+		iter->base.forward ? iter->num_returned : iter->num_values - 1 - iter->num_returned;
+	iter->num_returned++;
+
+	return for_convert_to_datum(iter->values[index], iter->base.element_type);
+}
+
+DecompressResult
+for_decompression_iterator_try_next_forward(DecompressionIterator *iter)
+{
+	Assert(iter->compression_algorithm == COMPRESSION_ALGORITHM_FOR && iter->forward);
+	return for_decompression_iterator_try_next((ForDecompressionIterator *) iter);
+}
+
+DecompressResult
+for_decompression_iterator_try_next_reverse(DecompressionIterator *iter)
+{
+	Assert(iter->compression_algorithm == COMPRESSION_ALGORITHM_FOR && !iter->forward);
+	return for_decompression_iterator_try_next((ForDecompressionIterator *) iter);
+}
+
+ArrowArray *
+for_decompress_all(Datum compressed_data, Oid element_type, MemoryContext dest_mctx)
+{
+	switch (element_type)
+	{
+		case INT8OID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return for_decompress_all_uint64(compressed_data, dest_mctx);
+		case INT4OID:
+		case DATEOID:
+			return for_decompress_all_uint32(compressed_data, dest_mctx);
+		case INT2OID:
+			return for_decompress_all_uint16(compressed_data, dest_mctx);
+		default:
+			elog(ERROR,
+				 "type '%s' is not supported for FOR decompression",
+				 format_type_be(element_type));
+			pg_unreachable();
+	}
+}
+
+/*
+ * Send and receive functions.
+ */
+
+void
+for_compressed_send(CompressedDataHeader *header, StringInfo buffer)
+{
+	ForCompressedParts parts = for_compressed_parts(header);
+	const ForCompressed *data = parts.header;
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_FOR);
+
+	pq_sendbyte(buffer, data->has_nulls);
+	pq_sendbyte(buffer, data->bits_per_value);
+	pq_sendint32(buffer, data->num_values);
+	pq_sendint32(buffer, data->num_exceptions);
+	pq_sendint64(buffer, data->reference);
+
+	const uint32 num_packed_words = for_num_packed_words(data->num_values, data->bits_per_value);
+	for (uint32 i = 0; i < num_packed_words; i++)
+		pq_sendint64(buffer, parts.packed[i]);
+
+	for (uint32 i = 0; i < data->num_exceptions; i++)
+	{
+		pq_sendint64(buffer, parts.exception_high_bits[i]);
+		pq_sendint16(buffer, parts.exception_rows[i]);
+	}
+
+	if (data->has_nulls)
+		simple8brle_serialized_send(buffer, parts.nulls);
+}
+
+Datum
+for_compressed_recv(StringInfo buffer)
+{
+	const uint8 has_nulls = pq_getmsgbyte(buffer);
+	CheckCompressedData(has_nulls == 0 || has_nulls == 1);
+
+	const uint8 bits_per_value = pq_getmsgbyte(buffer);
+	CheckCompressedData(bits_per_value <= 64);
+
+	const uint32 num_values = pq_getmsgint32(buffer);
+	CheckCompressedData(num_values > 0);
+	CheckCompressedData(num_values <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	const uint32 num_exceptions = pq_getmsgint32(buffer);
+	CheckCompressedData(num_exceptions <= num_values);
+	CheckCompressedData(num_exceptions == 0 || bits_per_value < 64);
+
+	const uint64 reference = pq_getmsgint64(buffer);
+
+	/*
+	 * Unpack the received values and recompress them, like the array recv
+	 * function does. This way we don't have to trust the layout of the
+	 * received data.
+	 */
+	const uint32 num_packed_words = for_num_packed_words(num_values, bits_per_value);
+	uint64 *packed = palloc(sizeof(uint64) * num_packed_words);
+	for (uint32 i = 0; i < num_packed_words; i++)
+		packed[i] = pq_getmsgint64(buffer);
+
+	uint64 *exception_high_bits = palloc(sizeof(uint64) * (num_exceptions + 1));
+	uint16 *exception_rows = palloc(sizeof(uint16) * (num_exceptions + 1));
+	for (uint32 i = 0; i < num_exceptions; i++)
+	{
+		exception_high_bits[i] = pq_getmsgint64(buffer);
+		exception_rows[i] = pq_getmsgint(buffer, 2);
+	}
+
+	Simple8bRleSerialized *nulls = NULL;
+	if (has_nulls)
+	{
+		nulls = simple8brle_serialized_recv(buffer);
+		CheckCompressedData(nulls->num_elements > num_values);
+	}
+
+	ForCompressed header = {
+		.has_nulls = has_nulls,
+		.bits_per_value = bits_per_value,
+		.num_values = num_values,
+		.num_exceptions = num_exceptions,
+		.reference = reference,
+	};
+	ForCompressedParts parts = {
+		.header = &header,
+		.packed = packed,
+		.exception_high_bits = exception_high_bits,
+		.exception_rows = exception_rows,
+		.nulls = nulls,
+	};
+
+	uint64 *values = palloc(sizeof(uint64) * num_values);
+	for_unpack_uint64(&parts, values);
+
+	PG_RETURN_POINTER(for_compressed_from_values(values, num_values, nulls));
+}
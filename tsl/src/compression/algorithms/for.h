@@ -0,0 +1,72 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+/*
+ * FOR (frame of reference) is used to encode integers or integer-like objects
+ * (e.g. timestamps) that have a narrow range of values, but no monotonic
+ * pattern that delta-of-delta encoding could exploit, for example status codes
+ * or small counters.
+ *
+ * The minimum value of the batch is stored as the reference, and the
+ * differences from it are bit-packed with a fixed bit width. The bit width is
+ * chosen so that the total size is minimal, and the values that don't fit
+ * into it are stored separately as patched exceptions (as in PFOR): the low
+ * bits are still stored in the packed array, and the high bits are stored
+ * along with the row number in the exception arrays.
+ *
+ * The fixed bit width means that every value can be unpacked independently of
+ * the others, so the bulk decompression is vectorizable.
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+
+#include "compression/compression.h"
+
+typedef struct ForCompressor ForCompressor;
+typedef struct ForCompressed ForCompressed;
+typedef struct ForDecompressionIterator ForDecompressionIterator;
+
+extern bool for_compressed_has_nulls(const CompressedDataHeader *header);
+extern Compressor *for_compressor_for_type(Oid element_type);
+extern ForCompressor *for_compressor_alloc(void);
+extern void for_compressor_append_null(ForCompressor *compressor);
+extern void for_compressor_append_value(ForCompressor *compressor, int64 next_val);
+extern void *for_compressor_finish(ForCompressor *compressor);
+
+/*
+ * These are used by other compressors that want to fall back to FOR when it
+ * gives a smaller result, or to bit-pack the integers they produce.
+ */
+extern Size for_compressed_size(const uint64 *values, uint32 num_values);
+extern ForCompressed *for_compressed_from_values(const uint64 *values, uint32 num_values,
+												 struct Simple8bRleSerialized *nulls);
+extern void for_compressed_unpack(void *compressed, uint32 num_values, uint64 *restrict values);
+
+extern DecompressionIterator *for_decompression_iterator_from_datum_forward(Datum for_compressed,
+																			Oid element_type);
+extern DecompressionIterator *for_decompression_iterator_from_datum_reverse(Datum for_compressed,
+																			Oid element_type);
+extern DecompressResult for_decompression_iterator_try_next_forward(DecompressionIterator *iter);
+extern DecompressResult for_decompression_iterator_try_next_reverse(DecompressionIterator *iter);
+
+extern ArrowArray *for_decompress_all(Datum compressed_data, Oid element_type,
+									  MemoryContext dest_mctx);
+
+extern void for_compressed_send(CompressedDataHeader *header, StringInfo buffer);
+extern Datum for_compressed_recv(StringInfo buf);
+
+#define FOR_ALGORITHM_DEFINITION                                                                   \
+	{                                                                                              \
+		.iterator_init_forward = for_decompression_iterator_from_datum_forward,                    \
+		.iterator_init_reverse = for_decompression_iterator_from_datum_reverse,                    \
+		.decompress_all = for_decompress_all, .compressed_data_send = for_compressed_send,         \
+		.compressed_data_recv = for_compressed_recv,                                               \
+		.compressor_for_type = for_compressor_for_type,                                            \
+		.compressed_data_storage = TOAST_STORAGE_EXTERNAL,                                         \
+	}
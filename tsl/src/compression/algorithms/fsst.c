@@ -0,0 +1,913 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "fsst.h"
+
+#include <catalog/pg_type.h>
+#include <lib/stringinfo.h>
+#include <libpq/pqformat.h>
+#include <utils/builtins.h>
+
+#include "adts/uint64_vec.h"
+#include "compression/arrow_c_data_interface.h"
+#include "compression/compression.h"
+#include "datum_serialize.h"
+#include "simple8b_rle.h"
+#include "simple8b_rle_bitmap.h"
+
+/*
+ * FSST compressed data is stored as
+ *     FsstCompressed header
+ *     uint64 symbols[num_symbols]: the bytes of each symbol, padded with zeros
+ *     uint8 symbol_lengths[num_symbols]: padded to a multiple of 8 bytes
+ *     simple8b_rle sizes: the number of code bytes of each non-null value
+ *     simple8b_rle nulls: 1 if the value is NULL, else 0, only if has_nulls
+ *     uint8 codes[]: the codes of all the values, up to the end of data
+ */
+typedef struct FsstCompressed
+{
+	CompressedDataHeaderFields;
+	uint8 has_nulls; /* 1 if this has a NULLs bitmap, 0 otherwise */
+	uint8 num_symbols;
+	uint8 padding;
+	Oid element_type;
+	/* The total length of all the decoded values. */
+	uint32 decoded_bytes;
+} FsstCompressed;
+
+static void
+pg_attribute_unused() assertions(void)
+{
+	FsstCompressed test_val = { .vl_len_ = { 0 } };
+	/* make sure no padding bytes make it to disk */
+	StaticAssertStmt(sizeof(FsstCompressed) ==
+						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
+							 sizeof(test_val.has_nulls) + sizeof(test_val.num_symbols) +
+							 sizeof(test_val.padding) + sizeof(test_val.element_type) +
+							 sizeof(test_val.decoded_bytes),
+					 "FsstCompressed wrong size");
+	StaticAssertStmt(sizeof(FsstCompressed) == 16, "FsstCompressed wrong size");
+}
+
+/*
+ * The code that is followed by a literal byte.
+ */
+#define FSST_ESCAPE 255
+#define FSST_MAX_SYMBOLS 255
+#define FSST_MAX_SYMBOL_LENGTH 8
+
+/*
+ * When building the symbol table, we count the symbols and the literal bytes
+ * together, the literal bytes have codes 0 to 255, and the symbols are offset
+ * by 256.
+ */
+#define FSST_CODE_SPACE 512
+
+/*
+ * The number of bytes of the input strings we use to build the symbol table,
+ * and the number of rounds of refinement of the table. The counters are
+ * uint16, so the sample must not be larger than that.
+ */
+#define FSST_SAMPLE_BYTES (16 * 1024)
+#define FSST_GENERATIONS 5
+
+StaticAssertDecl(FSST_SAMPLE_BYTES <= PG_UINT16_MAX, "FSST sample is too large for the counters");
+
+typedef struct FsstSymbolTable
+{
+	/*
+	 * The symbols are stored in the order of their codes, which is sorted by
+	 * the first byte, and then by length descending, so that the longest
+	 * match is found first. The symbol bytes are stored in memory order, and
+	 * the unused bytes are zero.
+	 */
+	uint64 symbols[FSST_MAX_SYMBOLS];
+	uint8 lengths[FSST_MAX_SYMBOLS];
+	uint8 num_symbols;
+
+	/*
+	 * The codes of the symbols that start with byte b are in the range
+	 * [first_code[b], first_code[b + 1]).
+	 */
+	uint16 first_code[256 + 1];
+} FsstSymbolTable;
+
+typedef struct FsstCandidate
+{
+	uint64 symbol;
+	uint64 gain;
+	uint8 length;
+} FsstCandidate;
+
+typedef struct FsstCompressor
+{
+	/* The bytes of all the non-null values, and the end offset of each one. */
+	StringInfoData bodies;
+	uint64_vec ends;
+	Simple8bRleCompressor nulls;
+	Oid element_type;
+	bool has_nulls;
+} FsstCompressor;
+
+typedef struct ExtendedCompressor
+{
+	Compressor base;
+	FsstCompressor *internal;
+	Oid element_type;
+} ExtendedCompressor;
+
+typedef struct FsstDecompressionIterator
+{
+	DecompressionIterator base;
+	/* The values are decoded all at once, in the Arrow format. */
+	ArrowArray *arrow;
+	/* The next row to return. */
+	int32 row;
+} FsstDecompressionIterator;
+
+static const uint8 fsst_mask_bytes[2 * FSST_MAX_SYMBOL_LENGTH] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+/*
+ * The mask that selects the first given number of bytes of a word in memory
+ * order, regardless of the endianness.
+ */
+static inline uint64
+fsst_prefix_mask(uint8 length)
+{
+	Assert(length <= FSST_MAX_SYMBOL_LENGTH);
+	uint64 mask;
+	memcpy(&mask, &fsst_mask_bytes[FSST_MAX_SYMBOL_LENGTH - length], sizeof(mask));
+	return mask;
+}
+
+static inline uint64
+fsst_load(const uint8 *str, uint32 remaining)
+{
+	uint64 word = 0;
+	memcpy(&word, str, Min(remaining, FSST_MAX_SYMBOL_LENGTH));
+	return word;
+}
+
+static inline uint8
+fsst_symbol_first_byte(uint64 symbol)
+{
+	return *(uint8 *) &symbol;
+}
+
+/*
+ * Find the longest symbol that is a prefix of the given string. Returns -1 if
+ * there is no such symbol.
+ */
+static inline int
+fsst_find_symbol(const FsstSymbolTable *table, const uint8 *str, uint32 remaining)
+{
+	Assert(remaining > 0);
+	const uint64 word = fsst_load(str, remaining);
+	const int end = table->first_code[str[0] + 1];
+	for (int code = table->first_code[str[0]]; code < end; code++)
+	{
+		const uint8 length = table->lengths[code];
+		if (length <= remaining && (word & fsst_prefix_mask(length)) == table->symbols[code])
+		{
+			return code;
+		}
+	}
+	return -1;
+}
+
+static int
+fsst_candidate_cmp_symbol(const void *a, const void *b)
+{
+	const FsstCandidate *ca = (const FsstCandidate *) a;
+	const FsstCandidate *cb = (const FsstCandidate *) b;
+	if (ca->length != cb->length)
+		return ca->length < cb->length ? -1 : 1;
+	return memcmp(&ca->symbol, &cb->symbol, sizeof(ca->symbol));
+}
+
+static int
+fsst_candidate_cmp_gain(const void *a, const void *b)
+{
+	const FsstCandidate *ca = (const FsstCandidate *) a;
+	const FsstCandidate *cb = (const FsstCandidate *) b;
+	if (ca->gain != cb->gain)
+		return ca->gain > cb->gain ? -1 : 1;
+	return fsst_candidate_cmp_symbol(a, b);
+}
+
+static int
+fsst_candidate_cmp_code(const void *a, const void *b)
+{
+	const FsstCandidate *ca = (const FsstCandidate *) a;
+	const FsstCandidate *cb = (const FsstCandidate *) b;
+	const uint8 first_a = fsst_symbol_first_byte(ca->symbol);
+	const uint8 first_b = fsst_symbol_first_byte(cb->symbol);
+	if (first_a != first_b)
+		return first_a < first_b ? -1 : 1;
+	if (ca->length != cb->length)
+		return ca->length > cb->length ? -1 : 1;
+	return memcmp(&ca->symbol, &cb->symbol, sizeof(ca->symbol));
+}
+
+/*
+ * Build the symbol table from the given symbols, assigning the codes in the
+ * order required for the lookup.
+ */
+static void
+fsst_table_build(FsstSymbolTable *table, FsstCandidate *symbols, int num_symbols)
+{
+	Assert(num_symbols <= FSST_MAX_SYMBOLS);
+	qsort(symbols, num_symbols, sizeof(*symbols), fsst_candidate_cmp_code);
+
+	memset(table, 0, sizeof(*table));
+	table->num_symbols = num_symbols;
+	for (int code = 0; code < num_symbols; code++)
+	{
+		table->symbols[code] = symbols[code].symbol;
+		table->lengths[code] = symbols[code].length;
+	}
+
+	int code = 0;
+	for (int byte = 0; byte <= 256; byte++)
+	{
+		while (code < num_symbols && fsst_symbol_first_byte(table->symbols[code]) < byte)
+		{
+			code++;
+		}
+		table->first_code[byte] = code;
+	}
+}
+
+/*
+ * Build the symbol table for the given values. We start from an empty table,
+ * and on each round, encode a sample of the values with the current table,
+ * and count how often each symbol or literal byte occurs, and how often each
+ * pair of them occurs one after another. The most beneficial of these symbols
+ * and the concatenations of the pairs make up the table for the next round.
+ */
+static void
+fsst_table_train(FsstSymbolTable *table, const uint8 *bodies, const uint64 *ends,
+				 uint32 num_values)
+{
+	Assert(num_values > 0);
+
+	/* Use evenly spaced values for the sample. */
+	const uint64 total_bytes = ends[num_values - 1];
+	const uint32 step = Max(1, Min(num_values, total_bytes / FSST_SAMPLE_BYTES));
+
+	uint16 *count1 = palloc(sizeof(uint16) * FSST_CODE_SPACE);
+	uint16 *count2 = palloc(sizeof(uint16) * FSST_CODE_SPACE * FSST_CODE_SPACE);
+	FsstCandidate *candidates =
+		palloc(sizeof(FsstCandidate) * (FSST_CODE_SPACE + FSST_SAMPLE_BYTES));
+
+	fsst_table_build(table, candidates, 0);
+
+	for (int generation = 0; generation < FSST_GENERATIONS; generation++)
+	{
+		memset(count1, 0, sizeof(uint16) * FSST_CODE_SPACE);
+		memset(count2, 0, sizeof(uint16) * FSST_CODE_SPACE * FSST_CODE_SPACE);
+
+		uint32 budget = FSST_SAMPLE_BYTES;
+		for (uint32 i = 0; i < num_values && budget > 0; i += step)
+		{
+			const uint64 start = i == 0 ? 0 : ends[i - 1];
+			const uint32 length = Min(ends[i] - start, budget);
+			const uint8 *str = &bodies[start];
+			budget -= length;
+
+			int prev = -1;
+			uint32 pos = 0;
+			while (pos < length)
+			{
+				const int code = fsst_find_symbol(table, &str[pos], length - pos);
+				const int pseudo_code = code >= 0 ? 256 + code : str[pos];
+				pos += code >= 0 ? table->lengths[code] : 1;
+
+				count1[pseudo_code]++;
+				if (prev >= 0)
+				{
+					count2[prev * FSST_CODE_SPACE + pseudo_code]++;
+				}
+				prev = pseudo_code;
+			}
+		}
+
+		/*
+		 * Collect the candidates for the next table. The gain of a symbol is
+		 * the number of input bytes it would cover in the sample.
+		 */
+		int num_candidates = 0;
+		for (int a = 0; a < FSST_CODE_SPACE; a++)
+		{
+			if (count1[a] == 0)
+				continue;
+
+			const uint64 symbol_a = a < 256 ? (uint64) 0 : table->symbols[a - 256];
+			const uint8 length_a = a < 256 ? 1 : table->lengths[a - 256];
+			uint8 bytes[2 * FSST_MAX_SYMBOL_LENGTH] = { 0 };
+			if (a < 256)
+				bytes[0] = a;
+			else
+				memcpy(bytes, &symbol_a, FSST_MAX_SYMBOL_LENGTH);
+
+			FsstCandidate *single = &candidates[num_candidates++];
+			single->symbol = 0;
+			memcpy(&single->symbol, bytes, length_a);
+			single->length = length_a;
+			single->gain = (uint64) count1[a] * length_a;
+
+			if (length_a == FSST_MAX_SYMBOL_LENGTH)
+				continue;
+
+			for (int b = 0; b < FSST_CODE_SPACE; b++)
+			{
+				const uint16 count = count2[a * FSST_CODE_SPACE + b];
+				if (count == 0)
+					continue;
+
+				const uint8 length_b = b < 256 ? 1 : table->lengths[b - 256];
+				if (b < 256)
+					bytes[length_a] = b;
+				else
+					memcpy(&bytes[length_a], &table->symbols[b - 256], FSST_MAX_SYMBOL_LENGTH);
+
+				const uint8 length = Min(length_a + length_b, FSST_MAX_SYMBOL_LENGTH);
+				FsstCandidate *pair = &candidates[num_candidates++];
+				pair->symbol = 0;
+				memcpy(&pair->symbol, bytes, length);
+				pair->length = length;
+				pair->gain = (uint64) count * length;
+			}
+		}
+		Assert(num_candidates <= FSST_CODE_SPACE + FSST_SAMPLE_BYTES);
+
+		/* Merge the same symbols that we got in different ways. */
+		qsort(candidates, num_candidates, sizeof(*candidates), fsst_candidate_cmp_symbol);
+		int num_unique = 0;
+		for (int i = 0; i < num_candidates; i++)
+		{
+			if (num_unique > 0 &&
+				fsst_candidate_cmp_symbol(&candidates[num_unique - 1], &candidates[i]) == 0)
+			{
+				candidates[num_unique - 1].gain += candidates[i].gain;
+			}
+			else
+			{
+				candidates[num_unique++] = candidates[i];
+			}
+		}
+
+		/* Keep the most beneficial ones. */
+		qsort(candidates, num_unique, sizeof(*candidates), fsst_candidate_cmp_gain);
+		fsst_table_build(table, candidates, Min(num_unique, FSST_MAX_SYMBOLS));
+	}
+
+	pfree(count1);
+	pfree(count2);
+	pfree(candidates);
+}
+
+/*
+ * Encode the string with the given table. The output must have space for
+ * twice the length of the string. Returns the number of code bytes.
+ */
+static uint32
+fsst_encode(const FsstSymbolTable *table, const uint8 *str, uint32 length, uint8 *restrict codes)
+{
+	uint32 num_codes = 0;
+	uint32 pos = 0;
+	while (pos < length)
+	{
+		const int code = fsst_find_symbol(table, &str[pos], length - pos);
+		if (code >= 0)
+		{
+			codes[num_codes++] = code;
+			pos += table->lengths[code];
+		}
+		else
+		{
+			codes[num_codes++] = FSST_ESCAPE;
+			codes[num_codes++] = str[pos];
+			pos++;
+		}
+	}
+	return num_codes;
+}
+
+static inline Size
+fsst_symbol_lengths_bytes(uint8 num_symbols)
+{
+	return TYPEALIGN(sizeof(uint64), num_symbols);
+}
+
+bool
+fsst_compressed_has_nulls(const CompressedDataHeader *header)
+{
+	const FsstCompressed *fc = (const FsstCompressed *) header;
+	return fc->has_nulls;
+}
+
+/*
+ * Compressor framework functions and definitions for the FSST algorithm.
+ */
+
+FsstCompressor *
+fsst_compressor_alloc(Oid element_type)
+{
+	Assert(element_type == TEXTOID || element_type == VARCHAROID);
+	FsstCompressor *compressor = palloc0(sizeof(*compressor));
+	initStringInfo(&compressor->bodies);
+	uint64_vec_init(&compressor->ends, CurrentMemoryContext, TARGET_COMPRESSED_BATCH_SIZE);
+	simple8brle_compressor_init(&compressor->nulls);
+	compressor->element_type = element_type;
+	return compressor;
+}
+
+void
+fsst_compressor_append_null(FsstCompressor *compressor)
+{
+	compressor->has_nulls = true;
+	simple8brle_compressor_append(&compressor->nulls, 1);
+}
+
+static void
+fsst_compressor_append_bytes(FsstCompressor *compressor, const char *data, int length)
+{
+	appendBinaryStringInfo(&compressor->bodies, data, length);
+	uint64_vec_append(&compressor->ends, compressor->bodies.len);
+	simple8brle_compressor_append(&compressor->nulls, 0);
+}
+
+void
+fsst_compressor_append(FsstCompressor *compressor, Datum val)
+{
+	struct varlena *detoasted = PG_DETOAST_DATUM_PACKED(val);
+	fsst_compressor_append_bytes(compressor, VARDATA_ANY(detoasted), VARSIZE_ANY_EXHDR(detoasted));
+	if (detoasted != DatumGetPointer(val))
+		pfree(detoasted);
+}
+
+void *
+fsst_compressor_finish(FsstCompressor *compressor)
+{
+	Simple8bRleSerialized *nulls = simple8brle_compressor_finish(&compressor->nulls);
+
+	const uint32 num_values = compressor->ends.num_elements;
+	if (num_values == 0)
+		return NULL;
+
+	const uint8 *bodies = (uint8 *) compressor->bodies.data;
+	const uint64 *ends = compressor->ends.data;
+	FsstSymbolTable *table = palloc(sizeof(*table));
+	fsst_table_train(table, bodies, ends, num_values);
+
+	/* Encode all the values. */
+	/* In the worst case, every byte is escaped. */
+	uint8 *codes =
+		MemoryContextAllocHuge(CurrentMemoryContext, 2 * (Size) compressor->bodies.len + 1);
+	Simple8bRleCompressor sizes_compressor;
+	simple8brle_compressor_init(&sizes_compressor);
+	uint64 num_codes = 0;
+	for (uint32 i = 0; i < num_values; i++)
+	{
+		const uint64 start = i == 0 ? 0 : ends[i - 1];
+		const uint32 size = fsst_encode(table, &bodies[start], ends[i] - start, &codes[num_codes]);
+		simple8brle_compressor_append(&sizes_compressor, size);
+		num_codes += size;
+	}
+	Simple8bRleSerialized *sizes = simple8brle_compressor_finish(&sizes_compressor);
+
+	const uint8 num_symbols = table->num_symbols;
+	const Size sizes_size = simple8brle_serialized_total_size(sizes);
+	const Size nulls_size = compressor->has_nulls ? simple8brle_serialized_total_size(nulls) : 0;
+	const Size compressed_size = sizeof(FsstCompressed) + sizeof(uint64) * num_symbols +
+								 fsst_symbol_lengths_bytes(num_symbols) + sizes_size + nulls_size +
+								 num_codes;
+
+	if (!AllocSizeIsValid(compressed_size))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("compressed size exceeds the maximum allowed (%d)", (int) MaxAllocSize)));
+
+	char *compressed_data = palloc0(compressed_size);
+	FsstCompressed *compressed = (FsstCompressed *) compressed_data;
+	SET_VARSIZE(&compressed->vl_len_, compressed_size);
+	compressed->compression_algorithm = COMPRESSION_ALGORITHM_FSST;
+	compressed->has_nulls = nulls_size != 0 ? 1 : 0;
+	compressed->num_symbols = num_symbols;
+	compressed->element_type = compressor->element_type;
+	compressed->decoded_bytes = compressor->bodies.len;
+
+	char *data = compressed_data + sizeof(FsstCompressed);
+	memcpy(data, table->symbols, sizeof(uint64) * num_symbols);
+	data += sizeof(uint64) * num_symbols;
+	memcpy(data, table->lengths, num_symbols);
+	data += fsst_symbol_lengths_bytes(num_symbols);
+	data = bytes_serialize_simple8b_and_advance(data, sizes_size, sizes);
+	if (nulls_size > 0)
+		data = bytes_serialize_simple8b_and_advance(data, nulls_size, nulls);
+	memcpy(data, codes, num_codes);
+	Assert((Size) (data + num_codes - compressed_data) == compressed_size);
+
+	pfree(table);
+	pfree(codes);
+	pfree(compressor->bodies.data);
+	uint64_vec_free_data(&compressor->ends);
+	return compressed;
+}
+
+static void
+fsst_compressor_append_datum(Compressor *compressor, Datum val)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = fsst_compressor_alloc(extended->element_type);
+
+	fsst_compressor_append(extended->internal, val);
+}
+
+static void
+fsst_compressor_append_null_value(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = fsst_compressor_alloc(extended->element_type);
+
+	fsst_compressor_append_null(extended->internal);
+}
+
+static void *
+fsst_compressor_finish_and_reset(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		return NULL;
+
+	void *compressed = fsst_compressor_finish(extended->internal);
+	pfree(extended->internal);
+	extended->internal = NULL;
+	return compressed;
+}
+
+const Compressor fsst_compressor = {
+	.append_val = fsst_compressor_append_datum,
+	.append_null = fsst_compressor_append_null_value,
+	.finish = fsst_compressor_finish_and_reset,
+};
+
+Compressor *
+fsst_compressor_for_type(Oid element_type)
+{
+	switch (element_type)
+	{
+		case TEXTOID:
+		case VARCHAROID:
+		{
+			ExtendedCompressor *compressor = palloc(sizeof(*compressor));
+			*compressor = (ExtendedCompressor){
+				.base = fsst_compressor,
+				.element_type = element_type,
+			};
+			return &compressor->base;
+		}
+		default:
+			elog(ERROR, "invalid type for FSST compressor \"%s\"", format_type_be(element_type));
+	}
+
+	pg_unreachable();
+}
+
+/*
+ * Decompression functions.
+ */
+
+/*
+ * The parts of the compressed data after they have been validated.
+ */
+typedef struct FsstCompressedParts
+{
+	const FsstCompressed *header;
+	const uint64 *symbols;
+	const uint8 *symbol_lengths;
+	Simple8bRleSerialized *sizes;
+	Simple8bRleSerialized *nulls;
+	const uint8 *codes;
+	uint32 num_codes;
+} FsstCompressedParts;
+
+static FsstCompressedParts
+fsst_compressed_parts(void *compressed)
+{
+	StringInfoData si = { .data = compressed, .len = VARSIZE(compressed) };
+	const FsstCompressed *header = consumeCompressedData(&si, sizeof(FsstCompressed));
+
+	CheckCompressedData(header->has_nulls == 0 || header->has_nulls == 1);
+	CheckCompressedData(header->num_symbols <= FSST_MAX_SYMBOLS);
+
+	FsstCompressedParts parts = { .header = header };
+	parts.symbols = consumeCompressedData(&si, sizeof(uint64) * header->num_symbols);
+	parts.symbol_lengths =
+		consumeCompressedData(&si, fsst_symbol_lengths_bytes(header->num_symbols));
+	parts.sizes = bytes_deserialize_simple8b_and_advance(&si);
+	CheckCompressedData(parts.sizes->num_elements > 0);
+	CheckCompressedData(parts.sizes->num_elements <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	if (header->has_nulls)
+	{
+		parts.nulls = bytes_deserialize_simple8b_and_advance(&si);
+		CheckCompressedData(parts.nulls->num_elements > parts.sizes->num_elements);
+		CheckCompressedData(parts.nulls->num_elements <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+	}
+
+	/* The codes take the rest of the data. */
+	parts.num_codes = si.len - si.cursor;
+	parts.codes = consumeCompressedData(&si, parts.num_codes);
+
+	/* Every code produces at most one symbol, this bounds the allocation. */
+	CheckCompressedData(header->decoded_bytes <= (uint64) parts.num_codes * FSST_MAX_SYMBOL_LENGTH);
+
+	return parts;
+}
+
+#define ELEMENT_TYPE uint32
+#include "simple8b_rle_decompress_all.h"
+#undef ELEMENT_TYPE
+
+static ArrowArray *
+fsst_decompress_parts(const FsstCompressedParts *parts, MemoryContext dest_mctx)
+{
+	/*
+	 * The decoding table has an entry for every possible code, the entries for
+	 * the invalid codes have zero length.
+	 */
+	uint64 symbols[256] = { 0 };
+	uint8 lengths[256] = { 0 };
+	for (int code = 0; code < parts->header->num_symbols; code++)
+	{
+		lengths[code] = parts->symbol_lengths[code];
+		CheckCompressedData(lengths[code] > 0 && lengths[code] <= FSST_MAX_SYMBOL_LENGTH);
+		symbols[code] = parts->symbols[code] & fsst_prefix_mask(lengths[code]);
+	}
+
+	uint32 n_notnull;
+	const uint32 *sizes = simple8brle_decompress_all_uint32(parts->sizes, &n_notnull);
+
+	const bool has_nulls = parts->header->has_nulls == 1;
+	Simple8bRleBitmap nulls = { 0 };
+	if (has_nulls)
+	{
+		nulls = simple8brle_bitmap_decompress(parts->nulls);
+	}
+
+	const uint32 n_total = has_nulls ? nulls.num_elements : n_notnull;
+	CheckCompressedData(n_total >= n_notnull);
+	CheckCompressedData(n_total <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+	if (has_nulls)
+	{
+		/*
+		 * The number of not-null elements we have must be consistent with the
+		 * nulls bitmap.
+		 */
+		CheckCompressedData(n_notnull + simple8brle_bitmap_num_ones(&nulls) == n_total);
+	}
+
+	/*
+	 * Each code stores a full word into the output, so we need some padding
+	 * after the end.
+	 */
+	const uint32 decoded_bytes = parts->header->decoded_bytes;
+	const Size bodies_bytes = pad_to_multiple(64, (Size) decoded_bytes + sizeof(uint64));
+	CheckCompressedData(AllocSizeIsValid(bodies_bytes));
+
+	uint32 *offsets =
+		(uint32 *) MemoryContextAlloc(dest_mctx,
+									  pad_to_multiple(64, sizeof(*offsets) * (n_total + 1)));
+	uint8 *arrow_bodies = (uint8 *) MemoryContextAlloc(dest_mctx, bodies_bytes);
+
+	const uint8 *codes = parts->codes;
+	const uint32 num_codes = parts->num_codes;
+	uint8 *restrict out = arrow_bodies;
+	const uint8 *out_end = arrow_bodies + decoded_bytes;
+	bool have_invalid_codes = false;
+	uint32 current_code = 0;
+	uint32 current_notnull_element = 0;
+	for (uint32 row = 0; row < n_total; row++)
+	{
+		offsets[row] = out - arrow_bodies;
+
+		if (has_nulls && simple8brle_bitmap_get_at(&nulls, row))
+		{
+			continue;
+		}
+
+		Assert(current_notnull_element < n_notnull);
+		const uint32 size = sizes[current_notnull_element++];
+		CheckCompressedData(size <= num_codes - current_code);
+		const uint32 end = current_code + size;
+		while (current_code < end)
+		{
+			/* We can always store a full word while we are inside the output. */
+			CheckCompressedData(out <= out_end);
+
+			const uint8 code = codes[current_code++];
+			if (code != FSST_ESCAPE)
+			{
+				have_invalid_codes |= lengths[code] == 0;
+				memcpy(out, &symbols[code], sizeof(uint64));
+				out += lengths[code];
+			}
+			else
+			{
+				CheckCompressedData(current_code < end);
+				*out = codes[current_code++];
+				out++;
+			}
+		}
+	}
+	offsets[n_total] = out - arrow_bodies;
+
+	CheckCompressedData(!have_invalid_codes);
+	CheckCompressedData(out == out_end);
+	CheckCompressedData(current_code == num_codes);
+
+	uint64 *restrict validity_bitmap = NULL;
+	if (has_nulls)
+	{
+		const int validity_bitmap_bytes = sizeof(uint64) * (pad_to_multiple(64, n_total) / 64);
+		validity_bitmap = MemoryContextAlloc(dest_mctx, validity_bitmap_bytes);
+
+		/*
+		 * Note that the validity bitmap size is a multiple of 64 bits. We have
+		 * to fill the tail bits with zeros, because the corresponding elements
+		 * are not valid.
+		 */
+		memset(validity_bitmap, 0xFF, validity_bitmap_bytes);
+		if (n_total % 64)
+		{
+			const uint64 tail_mask = ~0ULL >> (64 - n_total % 64);
+			validity_bitmap[n_total / 64] &= tail_mask;
+		}
+
+		for (uint32 row = 0; row < n_total; row++)
+		{
+			if (simple8brle_bitmap_get_at(&nulls, row))
+			{
+				arrow_set_row_validity(validity_bitmap, row, false);
+			}
+		}
+	}
+
+	ArrowArray *result =
+		MemoryContextAllocZero(dest_mctx, sizeof(ArrowArray) + (sizeof(void *) * 3));
+	const void **buffers = (const void **) &result[1];
+	buffers[0] = validity_bitmap;
+	buffers[1] = offsets;
+	buffers[2] = arrow_bodies;
+	result->n_buffers = 3;
+	result->buffers = buffers;
+	result->length = n_total;
+	result->null_count = n_total - n_notnull;
+	return result;
+}
+
+ArrowArray *
+fsst_decompress_all(Datum compressed_data, Oid element_type, MemoryContext dest_mctx)
+{
+	Assert(element_type == TEXTOID);
+	void *detoasted = PG_DETOAST_DATUM(compressed_data);
+	FsstCompressedParts parts = fsst_compressed_parts(detoasted);
+	return fsst_decompress_parts(&parts, dest_mctx);
+}
+
+static DecompressionIterator *
+fsst_decompression_iterator_from_datum(Datum fsst_compressed, Oid element_type, bool forward)
+{
+	void *detoasted = PG_DETOAST_DATUM(fsst_compressed);
+	FsstCompressedParts parts = fsst_compressed_parts(detoasted);
+	FsstDecompressionIterator *iter = palloc(sizeof(*iter));
+
+	/*
+	 * The row-by-row decompression is not performance-critical, so we just
+	 * decode all the values at once.
+	 */
+	ArrowArray *arrow = fsst_decompress_parts(&parts, CurrentMemoryContext);
+
+	*iter = (FsstDecompressionIterator){
+		.base = {
+			.compression_algorithm = COMPRESSION_ALGORITHM_FSST,
+			.forward = forward,
+			.element_type = element_type,
+			.try_next = fsst_decompression_iterator_try_next,
+		},
+		.arrow = arrow,
+		.row = forward ? 0 : arrow->length - 1,
+	};
+
+	return &iter->base;
+}
+
+DecompressionIterator *
+fsst_decompression_iterator_from_datum_forward(Datum fsst_compressed, Oid element_type)
+{
+	return fsst_decompression_iterator_from_datum(fsst_compressed, element_type, true);
+}
+
+DecompressionIterator *
+fsst_decompression_iterator_from_datum_reverse(Datum fsst_compressed, Oid element_type)
+{
+	return fsst_decompression_iterator_from_datum(fsst_compressed, element_type, false);
+}
+
+DecompressResult
+fsst_decompression_iterator_try_next(DecompressionIterator *base_iter)
+{
+	Assert(base_iter->compression_algorithm == COMPRESSION_ALGORITHM_FSST);
+	FsstDecompressionIterator *iter = (FsstDecompressionIterator *) base_iter;
+	const ArrowArray *arrow = iter->arrow;
+
+	if (iter->row < 0 || iter->row >= arrow->length)
+		return (DecompressResult){ .is_done = true };
+
+	const int32 row = iter->row;
+	iter->row += iter->base.forward ? 1 : -1;
+
+	if (!arrow_row_is_valid(arrow->buffers[0], row))
+		return (DecompressResult){ .is_null = true };
+
+	const uint32 *offsets = (const uint32 *) arrow->buffers[1];
+	const uint8 *bodies = (const uint8 *) arrow->buffers[2];
+	const uint32 length = offsets[row + 1] - offsets[row];
+	text *result = palloc(VARHDRSZ + length);
+	SET_VARSIZE(result, VARHDRSZ + length);
+	memcpy(VARDATA(result), &bodies[offsets[row]], length);
+	return (DecompressResult){ .val = PointerGetDatum(result) };
+}
+
+/*
+ * Send and receive functions. We send the decoded values, and the receiver
+ * builds the symbol table anew, like the array algorithm does.
+ */
+
+void
+fsst_compressed_send(CompressedDataHeader *header, StringInfo buffer)
+{
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_FSST);
+	FsstCompressedParts parts = fsst_compressed_parts(header);
+	ArrowArray *arrow = fsst_decompress_parts(&parts, CurrentMemoryContext);
+	const uint32 *offsets = (const uint32 *) arrow->buffers[1];
+	const char *bodies = (const char *) arrow->buffers[2];
+
+	pq_sendbyte(buffer, parts.header->has_nulls);
+	type_append_to_binary_string(parts.header->element_type, buffer);
+	pq_sendint32(buffer, arrow->length);
+	for (int row = 0; row < arrow->length; row++)
+	{
+		const bool isnull = !arrow_row_is_valid(arrow->buffers[0], row);
+		if (parts.header->has_nulls)
+			pq_sendbyte(buffer, isnull);
+
+		if (isnull)
+			continue;
+
+		const uint32 length = offsets[row + 1] - offsets[row];
+		pq_sendint32(buffer, length);
+		pq_sendbytes(buffer, &bodies[offsets[row]], length);
+	}
+}
+
+Datum
+fsst_compressed_recv(StringInfo buffer)
+{
+	const uint8 has_nulls = pq_getmsgbyte(buffer);
+	CheckCompressedData(has_nulls == 0 || has_nulls == 1);
+
+	const Oid element_type = binary_string_get_type(buffer);
+	CheckCompressedData(element_type == TEXTOID || element_type == VARCHAROID);
+
+	const uint32 num_rows = pq_getmsgint32(buffer);
+	CheckCompressedData(num_rows <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	FsstCompressor *compressor = fsst_compressor_alloc(element_type);
+	for (uint32 row = 0; row < num_rows; row++)
+	{
+		if (has_nulls && pq_getmsgbyte(buffer) != 0)
+		{
+			fsst_compressor_append_null(compressor);
+			continue;
+		}
+
+		const int length = pq_getmsgint32(buffer);
+		CheckCompressedData(length >= 0);
+		fsst_compressor_append_bytes(compressor, pq_getmsgbytes(buffer, length), length);
+	}
+
+	CheckCompressedData(has_nulls == compressor->has_nulls);
+	void *compressed = fsst_compressor_finish(compressor);
+	CheckCompressedData(compressed != NULL);
+	PG_RETURN_POINTER(compressed);
+}
@@ -0,0 +1,64 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+/*
+ * FSST (fast static symbol table) compresses strings that have too many
+ * distinct values for the dictionary compression, but still share a lot of
+ * substrings, e.g. URLs, log messages or device serials. It is modeled after
+ * the paper "FSST: Fast Random Access String Compression" by Peter Boncz et.
+ * al.
+ *
+ * For each batch, we build a table of up to 255 symbols of 1 to 8 bytes each,
+ * that cover the sample of the strings best. Each string is then encoded as a
+ * sequence of one-byte symbol codes, with an escape code followed by a literal
+ * byte for the bytes that are not covered by any symbol.
+ *
+ * The decoding is a table lookup and an unconditional 8-byte store for each
+ * code, so it is fast, and doesn't need the TOAST compression on top.
+ *
+ * Currently this algorithm is not used by default, but is tried for the text
+ * batches where the dictionary compressor would fall back to the array one.
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+
+#include "compression/compression.h"
+
+typedef struct FsstCompressor FsstCompressor;
+typedef struct FsstCompressed FsstCompressed;
+typedef struct FsstDecompressionIterator FsstDecompressionIterator;
+
+extern bool fsst_compressed_has_nulls(const CompressedDataHeader *header);
+extern Compressor *fsst_compressor_for_type(Oid element_type);
+extern FsstCompressor *fsst_compressor_alloc(Oid element_type);
+extern void fsst_compressor_append_null(FsstCompressor *compressor);
+extern void fsst_compressor_append(FsstCompressor *compressor, Datum val);
+extern void *fsst_compressor_finish(FsstCompressor *compressor);
+
+extern DecompressionIterator *fsst_decompression_iterator_from_datum_forward(Datum fsst_compressed,
+																			 Oid element_type);
+extern DecompressionIterator *fsst_decompression_iterator_from_datum_reverse(Datum fsst_compressed,
+																			 Oid element_type);
+extern DecompressResult fsst_decompression_iterator_try_next(DecompressionIterator *iter);
+
+extern ArrowArray *fsst_decompress_all(Datum compressed_data, Oid element_type,
+									   MemoryContext dest_mctx);
+
+extern void fsst_compressed_send(CompressedDataHeader *header, StringInfo buffer);
+extern Datum fsst_compressed_recv(StringInfo buf);
+
+#define FSST_ALGORITHM_DEFINITION                                                                  \
+	{                                                                                              \
+		.iterator_init_forward = fsst_decompression_iterator_from_datum_forward,                   \
+		.iterator_init_reverse = fsst_decompression_iterator_from_datum_reverse,                   \
+		.decompress_all = fsst_decompress_all, .compressed_data_send = fsst_compressed_send,       \
+		.compressed_data_recv = fsst_compressed_recv,                                              \
+		.compressor_for_type = fsst_compressor_for_type,                                           \
+		.compressed_data_storage = TOAST_STORAGE_EXTERNAL,                                         \
+	}
@@ -17,8 +17,10 @@
 #include "gorilla.h"
 
 #include "adts/bit_array.h"
+#include "alp.h"
 #include "compression/arrow_c_data_interface.h"
 #include "compression/compression.h"
+#include "dictionary.h"
 #include "float_utils.h"
 #include "simple8b_rle.h"
 #include "simple8b_rle_bitmap.h"
@@ -105,6 +107,14 @@ typedef struct ExtendedCompressor
 {
 	Compressor base;
 	GorillaCompressor *internal;
+	Oid element_type;
+	/*
+	 * For float columns, the values are also compressed with ALP and the
+	 * dictionary when they are enabled, and we keep the better result for each
+	 * batch.
+	 */
+	AlpCompressor *alp;
+	DictionaryCompressor *dictionary;
 } ExtendedCompressor;
 
 typedef struct GorillaDecompressionIterator
@@ -127,15 +137,48 @@ typedef struct GorillaDecompressionIterator
  ***  Compressor  ***
  ********************/
 
+static void
+gorilla_extended_compressor_init(ExtendedCompressor *extended)
+{
+	extended->internal = gorilla_compressor_alloc();
+
+	if (compression_candidate_enabled(COMPRESSION_ALGORITHM_ALP) &&
+		(extended->element_type == FLOAT4OID || extended->element_type == FLOAT8OID))
+	{
+		extended->alp = alp_compressor_alloc(extended->element_type);
+	}
+
+	if (compression_candidate_enabled(COMPRESSION_ALGORITHM_DICTIONARY) &&
+		(extended->element_type == FLOAT4OID || extended->element_type == FLOAT8OID))
+	{
+		extended->dictionary = dictionary_compressor_alloc(extended->element_type);
+	}
+}
+
+static void
+gorilla_extended_compressor_append_candidates(ExtendedCompressor *extended, uint64 value,
+											  Datum val)
+{
+	if (extended->alp != NULL)
+		alp_compressor_append_value(extended->alp, value);
+
+	if (extended->dictionary != NULL &&
+		!dictionary_compressor_candidate_append(extended->dictionary, val))
+	{
+		extended->dictionary = NULL;
+	}
+}
+
 static void
 gorilla_compressor_append_float(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	uint64 value = float_get_bits(DatumGetFloat4(val));
 	if (extended->internal == NULL)
-		extended->internal = gorilla_compressor_alloc();
+		gorilla_extended_compressor_init(extended);
 
 	gorilla_compressor_append_value(extended->internal, value);
+	gorilla_extended_compressor_append_candidates(extended, value, val);
 }
 
 static void
@@ -144,9 +187,10 @@ gorilla_compressor_append_double(Compressor *compressor, Datum val)
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	uint64 value = double_get_bits(DatumGetFloat8(val));
 	if (extended->internal == NULL)
-		extended->internal = gorilla_compressor_alloc();
+		gorilla_extended_compressor_init(extended);
 
 	gorilla_compressor_append_value(extended->internal, value);
+	gorilla_extended_compressor_append_candidates(extended, value, val);
 }
 
 static void
@@ -154,7 +198,7 @@ gorilla_compressor_append_int16(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = gorilla_compressor_alloc();
+		gorilla_extended_compressor_init(extended);
 
 	gorilla_compressor_append_value(extended->internal, (uint16) DatumGetInt16(val));
 }
@@ -164,7 +208,7 @@ gorilla_compressor_append_int32(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = gorilla_compressor_alloc();
+		gorilla_extended_compressor_init(extended);
 
 	gorilla_compressor_append_value(extended->internal, (uint32) DatumGetInt32(val));
 }
@@ -174,7 +218,7 @@ gorilla_compressor_append_int64(Compressor *compressor, Datum val)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = gorilla_compressor_alloc();
+		gorilla_extended_compressor_init(extended);
 
 	gorilla_compressor_append_value(extended->internal, DatumGetInt64(val));
 }
@@ -184,9 +228,13 @@ gorilla_compressor_append_null_value(Compressor *compressor)
 {
 	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
 	if (extended->internal == NULL)
-		extended->internal = gorilla_compressor_alloc();
+		gorilla_extended_compressor_init(extended);
 
 	gorilla_compressor_append_null(extended->internal);
+	if (extended->alp != NULL)
+		alp_compressor_append_null(extended->alp);
+	if (extended->dictionary != NULL)
+		dictionary_compressor_append_null(extended->dictionary);
 }
 
 static void *
@@ -196,6 +244,31 @@ gorilla_compressor_finish_and_reset(Compressor *compressor)
 	void *compressed = gorilla_compressor_finish(extended->internal);
 	pfree(extended->internal);
 	extended->internal = NULL;
+
+	if (extended->alp != NULL)
+	{
+		void *alp_compressed = alp_compressor_finish(extended->alp);
+		pfree(extended->alp);
+		extended->alp = NULL;
+
+		if (compressed != NULL && alp_compressed != NULL &&
+			compression_candidate_is_better(COMPRESSION_ALGORITHM_ALP,
+											VARSIZE(alp_compressed),
+											COMPRESSION_ALGORITHM_GORILLA,
+											VARSIZE(compressed)))
+		{
+			pfree(compressed);
+			compressed = alp_compressed;
+		}
+	}
+
+	if (extended->dictionary != NULL)
+	{
+		compressed = dictionary_compressor_finish_candidate(extended->dictionary, compressed);
+		pfree(extended->dictionary);
+		extended->dictionary = NULL;
+	}
+
 	return compressed;
 }
 
@@ -233,19 +306,24 @@ gorilla_compressor_for_type(Oid element_type)
 	switch (element_type)
 	{
 		case FLOAT4OID:
-			*compressor = (ExtendedCompressor){ .base = gorilla_float_compressor };
+			*compressor = (ExtendedCompressor){ .base = gorilla_float_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		case FLOAT8OID:
-			*compressor = (ExtendedCompressor){ .base = gorilla_double_compressor };
+			*compressor = (ExtendedCompressor){ .base = gorilla_double_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		case INT2OID:
-			*compressor = (ExtendedCompressor){ .base = gorilla_uint16_compressor };
+			*compressor = (ExtendedCompressor){ .base = gorilla_uint16_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		case INT4OID:
-			*compressor = (ExtendedCompressor){ .base = gorilla_uint32_compressor };
+			*compressor = (ExtendedCompressor){ .base = gorilla_uint32_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		case INT8OID:
-			*compressor = (ExtendedCompressor){ .base = gorilla_uint64_compressor };
+			*compressor = (ExtendedCompressor){ .base = gorilla_uint64_compressor,
+												.element_type = element_type };
 			return &compressor->base;
 		default:
 			elog(ERROR,
@@ -56,8 +56,6 @@ FUNCTION_NAME(gorilla_decompress_all, ELEMENT_TYPE)(CompressedGorillaData *goril
 		simple8brle_decompress_all_uint8(gorilla_data->num_bits_used_per_xor, &num_bit_widths);
 
 	BitArray xors_bitarray = gorilla_data->xors;
-	BitArrayIterator xors_iterator;
-	bit_array_iterator_init(&xors_iterator, &xors_bitarray);
 
 	/*
 	 * Now decompress the non-null data.
@@ -83,25 +81,85 @@ FUNCTION_NAME(gorilla_decompress_all, ELEMENT_TYPE)(CompressedGorillaData *goril
 	CheckCompressedData(n_different <= n_notnull);
 
 	/*
-	 * 1d) Unpack.
+	 * 1d) Unpack. We do this in several passes, so that the passes without
+	 * loop-carried dependencies can be vectorized by the compiler.
 	 *
 	 * Note that the bit widths change often, so there's no sense in
 	 * having a fast path for stretches of tag1 == 0.
+	 *
+	 * First, gather the bit width and the shift of every different element
+	 * from the tag1 prefix sums. The temporary arrays are too large for the
+	 * stack, so we allocate them in the current memory context, like the other
+	 * unpacked metadata arrays above.
 	 */
-	ELEMENT_TYPE prev = 0;
+	uint8 *restrict xor_bits = palloc(sizeof(uint8) * (n_different + 1));
+	uint8 *restrict xor_shifts = palloc(sizeof(uint8) * (n_different + 1));
+	bool have_wide_xors = false;
 	for (uint16 i = 0; i < n_different; i++)
 	{
-		const uint8 current_xor_bits = bit_widths[simple8brle_bitmap_prefix_sum(&tag1s, i) - 1];
-		const uint8 current_leading_zeros =
-			all_leading_zeros[simple8brle_bitmap_prefix_sum(&tag1s, i) - 1];
+		const uint16 metadata_index = simple8brle_bitmap_prefix_sum(&tag1s, i) - 1;
+		const uint8 current_xor_bits = bit_widths[metadata_index];
+		const uint8 current_leading_zeros = all_leading_zeros[metadata_index];
+		have_wide_xors |= current_xor_bits > 64;
 
 		/*
 		 * Truncate the shift here not to cause UB on the corrupt data.
 		 */
-		const uint8 shift = (64 - (current_xor_bits + current_leading_zeros)) & 63;
+		xor_bits[i] = current_xor_bits;
+		xor_shifts[i] = (64 - (current_xor_bits + current_leading_zeros)) & 63;
+	}
+	CheckCompressedData(!have_wide_xors);
+
+	/*
+	 * Compute the starting bit offset of every xor value in the packed xor
+	 * bit array. This is a prefix sum, but a cheap one.
+	 */
+	uint32 *restrict xor_offsets = palloc(sizeof(uint32) * (n_different + 1));
+	uint32 total_xor_bits = 0;
+	for (uint16 i = 0; i < n_different; i++)
+	{
+		xor_offsets[i] = total_xor_bits;
+		total_xor_bits += xor_bits[i];
+	}
+
+	/*
+	 * Sanity check: the xor values must fit into the bit array. After this
+	 * check, we don't need the per-element checks of the bit array iterator.
+	 */
+	const uint32 num_xor_buckets = bit_array_num_buckets(&xors_bitarray);
+	CheckCompressedData(total_xor_bits <= num_xor_buckets * (uint64) BITS_PER_BUCKET);
+
+	/*
+	 * If all xors are zero-width, the bit array might have no buckets at all.
+	 * Read from a dummy zero bucket in this case, so that the extraction loop
+	 * below doesn't need a special case.
+	 */
+	static const uint64 zero_bucket = 0;
+	const uint64 *xor_buckets =
+		num_xor_buckets > 0 ? bit_array_buckets(&xors_bitarray) : &zero_bucket;
+	const uint32 last_xor_bucket = num_xor_buckets > 0 ? num_xor_buckets - 1 : 0;
 
-		const uint64 current_xor = bit_array_iter_next(&xors_iterator, current_xor_bits);
-		prev ^= current_xor << shift;
+	/*
+	 * Now extract every xor value independently of the others. The bucket
+	 * reads are clamped to the end of the array, which only matters for the
+	 * zero-width values at the very end, or for the high-order part of the
+	 * last value.
+	 */
+	uint64 *restrict xor_values = palloc(sizeof(uint64) * (n_different + 1));
+	for (uint16 i = 0; i < n_different; i++)
+	{
+		xor_values[i] =
+			bit_array_unpack_at(xor_buckets, last_xor_bucket, xor_offsets[i], xor_bits[i])
+			<< xor_shifts[i];
+	}
+
+	/*
+	 * Finally, restore the values by applying the xors in sequence.
+	 */
+	ELEMENT_TYPE prev = 0;
+	for (uint16 i = 0; i < n_different; i++)
+	{
+		prev ^= xor_values[i];
 		decompressed_values[i] = prev;
 	}
 
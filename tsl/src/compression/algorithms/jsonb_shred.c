@@ -0,0 +1,758 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "jsonb_shred.h"
+
+#include <catalog/pg_type.h>
+#include <lib/stringinfo.h>
+#include <libpq/pqformat.h>
+#include <utils/builtins.h>
+#include <utils/hsearch.h>
+#include <utils/jsonb.h>
+#include <utils/memutils.h>
+
+#include "array.h"
+#include "compression/arrow_c_data_interface.h"
+#include "compression/compression.h"
+#include "debug_assert.h"
+#include "dictionary.h"
+
+/*
+ * The jsonb shredded data is stored as
+ *     JsonbShredCompressed header
+ *     the shredded keys, each as uint16 length followed by the key bytes
+ *     the residual jsonb values, array compressed, including the varlena
+ *         header
+ *     the text values of each shredded key, in the order of the keys, each
+ *         compressed with the dictionary compressor and including the varlena
+ *         header
+ * The nested compressed data starts at MAXALIGN offsets.
+ */
+typedef struct JsonbShredCompressed
+{
+	CompressedDataHeaderFields;
+	uint8 has_nulls; /* 1 if some rows are NULL, 0 otherwise */
+	uint16 num_keys;
+	/* 8-byte alignment sentinel for the following fields */
+	uint64 alignment_sentinel[FLEXIBLE_ARRAY_MEMBER];
+} JsonbShredCompressed;
+
+static void
+pg_attribute_unused() assertions(void)
+{
+	JsonbShredCompressed test_val = { .vl_len_ = { 0 } };
+	/* make sure no padding bytes make it to disk */
+	StaticAssertStmt(sizeof(JsonbShredCompressed) ==
+						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
+							 sizeof(test_val.has_nulls) + sizeof(test_val.num_keys),
+					 "JsonbShredCompressed wrong size");
+	StaticAssertStmt(sizeof(JsonbShredCompressed) == 8, "JsonbShredCompressed wrong size");
+}
+
+/*
+ * We shred at most this many keys, with names of at most this length. The
+ * long keys are unlikely to be used in filters.
+ */
+#define JSONB_SHRED_MAX_KEYS 16
+#define JSONB_SHRED_MAX_KEY_LENGTH 63
+
+/*
+ * The shredded keys. The names are not null-terminated.
+ */
+typedef struct JsonbShredKeys
+{
+	int num_keys;
+	const char *names[JSONB_SHRED_MAX_KEYS];
+	uint16 lengths[JSONB_SHRED_MAX_KEYS];
+} JsonbShredKeys;
+
+static int
+jsonb_shred_find_key(const JsonbShredKeys *keys, const char *name, int length)
+{
+	for (int i = 0; i < keys->num_keys; i++)
+	{
+		if (keys->lengths[i] == length && memcmp(keys->names[i], name, length) == 0)
+			return i;
+	}
+	return -1;
+}
+
+bool
+jsonb_shred_compressed_has_nulls(const CompressedDataHeader *header)
+{
+	const JsonbShredCompressed *shredded = (const JsonbShredCompressed *) header;
+	return shredded->has_nulls;
+}
+
+/*
+ * The jsonb values are compressed with the dictionary compressor, which does
+ * the shredding when it finishes.
+ */
+Compressor *
+jsonb_shred_compressor_for_type(Oid element_type)
+{
+	if (element_type != JSONBOID)
+		elog(ERROR,
+			 "invalid type for jsonb shredding compressor \"%s\"",
+			 format_type_be(element_type));
+
+	return dictionary_compressor_for_type(element_type);
+}
+
+/*
+ * The number of rows that have the key, and whether its value is a string in
+ * all of them.
+ */
+typedef struct JsonbShredKeyStats
+{
+	char name[JSONB_SHRED_MAX_KEY_LENGTH + 1];
+	uint32 num_rows;
+	bool all_strings;
+} JsonbShredKeyStats;
+
+static int
+jsonb_shred_key_stats_cmp_rows(const void *a, const void *b)
+{
+	const JsonbShredKeyStats *stats_a = *(JsonbShredKeyStats *const *) a;
+	const JsonbShredKeyStats *stats_b = *(JsonbShredKeyStats *const *) b;
+	if (stats_a->num_rows != stats_b->num_rows)
+		return stats_a->num_rows > stats_b->num_rows ? -1 : 1;
+	return strcmp(stats_a->name, stats_b->name);
+}
+
+static int
+jsonb_shred_key_stats_cmp_names(const void *a, const void *b)
+{
+	const JsonbShredKeyStats *stats_a = *(JsonbShredKeyStats *const *) a;
+	const JsonbShredKeyStats *stats_b = *(JsonbShredKeyStats *const *) b;
+	return strcmp(stats_a->name, stats_b->name);
+}
+
+/*
+ * Choose the keys to shred: the top-level keys that have a string value in at
+ * least half of the non-null rows, and don't have other values. The names
+ * are allocated in the current memory context.
+ */
+static JsonbShredKeys
+jsonb_shred_choose_keys(const CompressedDataHeader *compressed)
+{
+	HASHCTL ctl = {
+		.keysize = JSONB_SHRED_MAX_KEY_LENGTH + 1,
+		.entrysize = sizeof(JsonbShredKeyStats),
+		.hcxt = CurrentMemoryContext,
+	};
+	HTAB *key_stats =
+		hash_create("jsonb shredding keys", 64, &ctl, HASH_ELEM | HASH_STRINGS | HASH_CONTEXT);
+
+	DecompressionIterator *iter =
+		tsl_get_decompression_iterator_init(compressed->compression_algorithm,
+											/* reverse = */ false)(PointerGetDatum(compressed),
+																   JSONBOID);
+	uint32 num_notnull = 0;
+	for (DecompressResult res = iter->try_next(iter); !res.is_done; res = iter->try_next(iter))
+	{
+		if (res.is_null)
+			continue;
+
+		num_notnull++;
+
+		Jsonb *jb = DatumGetJsonbP(res.val);
+		if (!JB_ROOT_IS_OBJECT(jb))
+			continue;
+
+		JsonbIterator *it = JsonbIteratorInit(&jb->root);
+		JsonbValue v;
+		JsonbIteratorToken token;
+		bool skip_nested = false;
+		while ((token = JsonbIteratorNext(&it, &v, skip_nested)) != WJB_DONE)
+		{
+			skip_nested = true;
+			if (token != WJB_KEY || v.val.string.len > JSONB_SHRED_MAX_KEY_LENGTH)
+				continue;
+
+			char name[JSONB_SHRED_MAX_KEY_LENGTH + 1] = { 0 };
+			memcpy(name, v.val.string.val, v.val.string.len);
+			bool found;
+			JsonbShredKeyStats *stats = hash_search(key_stats, name, HASH_ENTER, &found);
+			if (!found)
+			{
+				stats->num_rows = 0;
+				stats->all_strings = true;
+			}
+
+			token = JsonbIteratorNext(&it, &v, skip_nested);
+			Assert(token == WJB_VALUE);
+			stats->num_rows++;
+			stats->all_strings &= v.type == jbvString;
+		}
+	}
+
+	JsonbShredKeyStats **candidates =
+		palloc(sizeof(JsonbShredKeyStats *) * Max(1, hash_get_num_entries(key_stats)));
+	int num_candidates = 0;
+	HASH_SEQ_STATUS status;
+	hash_seq_init(&status, key_stats);
+	for (JsonbShredKeyStats *stats = hash_seq_search(&status); stats != NULL;
+		 stats = hash_seq_search(&status))
+	{
+		if (stats->all_strings && 2 * stats->num_rows >= num_notnull)
+			candidates[num_candidates++] = stats;
+	}
+
+	/*
+	 * Keep the most frequent keys, and sort them by name, so that the result
+	 * doesn't depend on the order of the hash table.
+	 */
+	qsort(candidates, num_candidates, sizeof(*candidates), jsonb_shred_key_stats_cmp_rows);
+	num_candidates = Min(num_candidates, JSONB_SHRED_MAX_KEYS);
+	qsort(candidates, num_candidates, sizeof(*candidates), jsonb_shred_key_stats_cmp_names);
+
+	JsonbShredKeys keys = { .num_keys = num_candidates };
+	for (int i = 0; i < num_candidates; i++)
+	{
+		keys.names[i] = candidates[i]->name;
+		keys.lengths[i] = strlen(candidates[i]->name);
+	}
+	return keys;
+}
+
+/*
+ * Split the jsonb object into the residual object without the shredded keys,
+ * and the text values of the shredded keys.
+ */
+static Datum
+jsonb_shred_split(Jsonb *jb, const JsonbShredKeys *keys, text **values)
+{
+	JsonbParseState *state = NULL;
+	JsonbValue *result = NULL;
+	JsonbIterator *it = JsonbIteratorInit(&jb->root);
+	JsonbValue v;
+	JsonbIteratorToken token;
+	bool skip_nested = false;
+	while ((token = JsonbIteratorNext(&it, &v, skip_nested)) != WJB_DONE)
+	{
+		skip_nested = true;
+		if (token == WJB_KEY)
+		{
+			const int key = jsonb_shred_find_key(keys, v.val.string.val, v.val.string.len);
+			if (key >= 0)
+			{
+				token = JsonbIteratorNext(&it, &v, skip_nested);
+				Assert(token == WJB_VALUE && v.type == jbvString);
+				values[key] = cstring_to_text_with_len(v.val.string.val, v.val.string.len);
+				continue;
+			}
+		}
+
+		result = pushJsonbValue(&state, token, token < WJB_BEGIN_ARRAY ? &v : NULL);
+	}
+
+	Assert(result != NULL);
+	return JsonbPGetDatum(JsonbValueToJsonb(result));
+}
+
+static Size
+jsonb_shred_nested_offset(Size offset)
+{
+	return MAXALIGN(offset);
+}
+
+/*
+ * Shred the given array or dictionary compressed jsonb data. Returns NULL if
+ * no keys qualify for shredding.
+ */
+void *
+jsonb_shred_compress(const CompressedDataHeader *compressed)
+{
+	Assert(compressed->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY ||
+		   compressed->compression_algorithm == COMPRESSION_ALGORITHM_DICTIONARY);
+
+	MemoryContext result_context = CurrentMemoryContext;
+	MemoryContext work_context =
+		AllocSetContextCreate(CurrentMemoryContext, "jsonb shredding", ALLOCSET_DEFAULT_SIZES);
+	MemoryContext row_context =
+		AllocSetContextCreate(work_context, "jsonb shredding row", ALLOCSET_DEFAULT_SIZES);
+	MemoryContextSwitchTo(work_context);
+
+	const JsonbShredKeys keys = jsonb_shred_choose_keys(compressed);
+	if (keys.num_keys == 0)
+	{
+		MemoryContextSwitchTo(result_context);
+		MemoryContextDelete(work_context);
+		return NULL;
+	}
+
+	/*
+	 * The residual is compressed with the array compressor, because the
+	 * residual objects are mostly distinct, and the dictionary compressor
+	 * would try the shredding again.
+	 */
+	MemoryContextSwitchTo(result_context);
+	ArrayCompressor *residual_compressor = array_compressor_alloc(JSONBOID);
+	DictionaryCompressor *value_compressors[JSONB_SHRED_MAX_KEYS];
+	for (int i = 0; i < keys.num_keys; i++)
+		value_compressors[i] = dictionary_compressor_alloc(TEXTOID);
+	MemoryContextSwitchTo(work_context);
+
+	bool has_nulls = false;
+	DecompressionIterator *iter =
+		tsl_get_decompression_iterator_init(compressed->compression_algorithm,
+											/* reverse = */ false)(PointerGetDatum(compressed),
+																   JSONBOID);
+	for (DecompressResult res = iter->try_next(iter); !res.is_done; res = iter->try_next(iter))
+	{
+		MemoryContextReset(row_context);
+		MemoryContextSwitchTo(row_context);
+
+		Datum residual = res.val;
+		text *values[JSONB_SHRED_MAX_KEYS] = { 0 };
+		if (!res.is_null)
+		{
+			Jsonb *jb = DatumGetJsonbP(res.val);
+			if (JB_ROOT_IS_OBJECT(jb))
+				residual = jsonb_shred_split(jb, &keys, values);
+		}
+
+		/* The compressors copy the values. */
+		MemoryContextSwitchTo(result_context);
+		if (res.is_null)
+		{
+			has_nulls = true;
+			array_compressor_append_null(residual_compressor);
+		}
+		else
+			array_compressor_append(residual_compressor, residual);
+
+		for (int i = 0; i < keys.num_keys; i++)
+		{
+			if (values[i] == NULL)
+				dictionary_compressor_append_null(value_compressors[i]);
+			else
+				dictionary_compressor_append(value_compressors[i], PointerGetDatum(values[i]));
+		}
+		MemoryContextSwitchTo(work_context);
+	}
+
+	MemoryContextSwitchTo(result_context);
+	void *residual_compressed = array_compressor_finish(residual_compressor);
+	void *values_compressed[JSONB_SHRED_MAX_KEYS];
+	Ensure(residual_compressed != NULL, "jsonb shredding of all-null data");
+
+	Size total_size = sizeof(JsonbShredCompressed);
+	for (int i = 0; i < keys.num_keys; i++)
+		total_size += sizeof(uint16) + keys.lengths[i];
+	total_size = jsonb_shred_nested_offset(total_size) + VARSIZE(residual_compressed);
+	for (int i = 0; i < keys.num_keys; i++)
+	{
+		/* The shredded keys are present in at least one row. */
+		values_compressed[i] = dictionary_compressor_finish(value_compressors[i]);
+		Ensure(values_compressed[i] != NULL, "jsonb shredding of an all-null key");
+		total_size = jsonb_shred_nested_offset(total_size) + VARSIZE(values_compressed[i]);
+	}
+
+	if (!AllocSizeIsValid(total_size))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("compressed size exceeds the maximum allowed (%d)", (int) MaxAllocSize)));
+
+	char *result = palloc0(total_size);
+	JsonbShredCompressed *header = (JsonbShredCompressed *) result;
+	SET_VARSIZE(&header->vl_len_, total_size);
+	header->compression_algorithm = COMPRESSION_ALGORITHM_JSONB;
+	header->has_nulls = has_nulls;
+	header->num_keys = keys.num_keys;
+
+	Size offset = sizeof(JsonbShredCompressed);
+	for (int i = 0; i < keys.num_keys; i++)
+	{
+		const uint16 length = keys.lengths[i];
+		memcpy(&result[offset], &length, sizeof(length));
+		offset += sizeof(length);
+		memcpy(&result[offset], keys.names[i], length);
+		offset += length;
+	}
+
+	offset = jsonb_shred_nested_offset(offset);
+	memcpy(&result[offset], residual_compressed, VARSIZE(residual_compressed));
+	offset += VARSIZE(residual_compressed);
+	pfree(residual_compressed);
+
+	for (int i = 0; i < keys.num_keys; i++)
+	{
+		offset = jsonb_shred_nested_offset(offset);
+		memcpy(&result[offset], values_compressed[i], VARSIZE(values_compressed[i]));
+		offset += VARSIZE(values_compressed[i]);
+		pfree(values_compressed[i]);
+	}
+	Assert(offset == total_size);
+
+	MemoryContextDelete(work_context);
+	return result;
+}
+
+/*
+ * Decompression functions.
+ */
+
+/*
+ * The parts of the compressed data after they have been validated.
+ */
+typedef struct JsonbShredParts
+{
+	const JsonbShredCompressed *header;
+	JsonbShredKeys keys;
+	const CompressedDataHeader *residual;
+	const CompressedDataHeader *values[JSONB_SHRED_MAX_KEYS];
+} JsonbShredParts;
+
+static const CompressedDataHeader *
+jsonb_shred_consume_nested(StringInfo si)
+{
+	consumeCompressedData(si, jsonb_shred_nested_offset(si->cursor) - si->cursor);
+	CheckCompressedData(si->len - si->cursor >= (int) sizeof(CompressedDataHeader));
+
+	const CompressedDataHeader *nested = (const CompressedDataHeader *) (si->data + si->cursor);
+	CheckCompressedData(VARATT_IS_4B_U(nested));
+	CheckCompressedData(VARSIZE(nested) >= sizeof(CompressedDataHeader));
+	consumeCompressedData(si, VARSIZE(nested));
+	return nested;
+}
+
+static JsonbShredParts
+jsonb_shred_compressed_parts(void *compressed)
+{
+	StringInfoData si = { .data = compressed, .len = VARSIZE(compressed) };
+	const JsonbShredCompressed *header = consumeCompressedData(&si, sizeof(JsonbShredCompressed));
+
+	CheckCompressedData(header->has_nulls == 0 || header->has_nulls == 1);
+	CheckCompressedData(header->num_keys > 0 && header->num_keys <= JSONB_SHRED_MAX_KEYS);
+
+	JsonbShredParts parts = { .header = header, .keys = { .num_keys = header->num_keys } };
+	for (int i = 0; i < header->num_keys; i++)
+	{
+		uint16 length;
+		memcpy(&length, consumeCompressedData(&si, sizeof(length)), sizeof(length));
+		CheckCompressedData(length <= JSONB_SHRED_MAX_KEY_LENGTH);
+		parts.keys.lengths[i] = length;
+		parts.keys.names[i] = consumeCompressedData(&si, length);
+	}
+
+	parts.residual = jsonb_shred_consume_nested(&si);
+	CheckCompressedData(parts.residual->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY);
+	CheckCompressedData(array_compressed_has_nulls(parts.residual) == header->has_nulls);
+
+	for (int i = 0; i < header->num_keys; i++)
+	{
+		parts.values[i] = jsonb_shred_consume_nested(&si);
+		CheckCompressedData(parts.values[i]->compression_algorithm ==
+								COMPRESSION_ALGORITHM_DICTIONARY ||
+							parts.values[i]->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY ||
+							parts.values[i]->compression_algorithm == COMPRESSION_ALGORITHM_FSST);
+	}
+
+	CheckCompressedData(si.cursor == si.len);
+	return parts;
+}
+
+/*
+ * Put the values of the shredded keys back into the residual object.
+ */
+static Datum
+jsonb_shred_merge(Jsonb *residual, const JsonbShredKeys *keys, const DecompressResult *values)
+{
+	JsonbParseState *state = NULL;
+	JsonbValue *result = NULL;
+	JsonbIterator *it = JsonbIteratorInit(&residual->root);
+	JsonbValue v;
+	JsonbIteratorToken token;
+	bool skip_nested = false;
+	while ((token = JsonbIteratorNext(&it, &v, skip_nested)) != WJB_DONE)
+	{
+		skip_nested = true;
+		if (token == WJB_END_OBJECT)
+		{
+			/*
+			 * The nested objects are skipped, so this is the end of the
+			 * top-level object. The pairs are sorted when it is finished.
+			 */
+			for (int i = 0; i < keys->num_keys; i++)
+			{
+				if (values[i].is_null)
+					continue;
+
+				text *value_text = DatumGetTextPP(values[i].val);
+				JsonbValue key = {
+					.type = jbvString,
+					.val.string = { .len = keys->lengths[i], .val = (char *) keys->names[i] },
+				};
+				JsonbValue value = {
+					.type = jbvString,
+					.val.string = { .len = VARSIZE_ANY_EXHDR(value_text),
+									.val = VARDATA_ANY(value_text) },
+				};
+				pushJsonbValue(&state, WJB_KEY, &key);
+				pushJsonbValue(&state, WJB_VALUE, &value);
+			}
+		}
+
+		result = pushJsonbValue(&state, token, token < WJB_BEGIN_ARRAY ? &v : NULL);
+	}
+
+	Assert(result != NULL);
+	return JsonbPGetDatum(JsonbValueToJsonb(result));
+}
+
+typedef struct JsonbShredDecompressionIterator
+{
+	DecompressionIterator base;
+	JsonbShredKeys keys;
+	DecompressionIterator *residual;
+	DecompressionIterator *values[JSONB_SHRED_MAX_KEYS];
+	/* The merged value of the current row, it is valid until the next row. */
+	MemoryContext row_context;
+} JsonbShredDecompressionIterator;
+
+static DecompressResult
+jsonb_shred_decompression_iterator_try_next(DecompressionIterator *base_iter)
+{
+	Assert(base_iter->compression_algorithm == COMPRESSION_ALGORITHM_JSONB);
+	JsonbShredDecompressionIterator *iter = (JsonbShredDecompressionIterator *) base_iter;
+
+	DecompressResult residual = iter->residual->try_next(iter->residual);
+	DecompressResult values[JSONB_SHRED_MAX_KEYS];
+	bool have_values = false;
+	for (int i = 0; i < iter->keys.num_keys; i++)
+	{
+		values[i] = iter->values[i]->try_next(iter->values[i]);
+		CheckCompressedData(values[i].is_done == residual.is_done);
+		have_values |= !values[i].is_null;
+	}
+
+	if (residual.is_done)
+		return residual;
+
+	if (residual.is_null)
+	{
+		CheckCompressedData(!have_values);
+		return residual;
+	}
+
+	MemoryContextReset(iter->row_context);
+	MemoryContext old_context = MemoryContextSwitchTo(iter->row_context);
+	Jsonb *jb = DatumGetJsonbP(residual.val);
+	Datum result = residual.val;
+	if (JB_ROOT_IS_OBJECT(jb))
+		result = jsonb_shred_merge(jb, &iter->keys, values);
+	else
+		CheckCompressedData(!have_values);
+	MemoryContextSwitchTo(old_context);
+
+	return (DecompressResult){ .val = result };
+}
+
+static DecompressionIterator *
+jsonb_shred_decompression_iterator_from_datum(Datum compressed, Oid element_type, bool reverse)
+{
+	Assert(element_type == JSONBOID);
+	void *detoasted = PG_DETOAST_DATUM(compressed);
+	const JsonbShredParts parts = jsonb_shred_compressed_parts(detoasted);
+
+	JsonbShredDecompressionIterator *iter = palloc(sizeof(*iter));
+	*iter = (JsonbShredDecompressionIterator){
+		.base = {
+			.compression_algorithm = COMPRESSION_ALGORITHM_JSONB,
+			.forward = !reverse,
+			.element_type = element_type,
+			.try_next = jsonb_shred_decompression_iterator_try_next,
+		},
+		.keys = parts.keys,
+		.residual = tsl_get_decompression_iterator_init(parts.residual->compression_algorithm,
+														reverse)(PointerGetDatum(parts.residual),
+																 JSONBOID),
+		.row_context = AllocSetContextCreate(CurrentMemoryContext,
+											 "jsonb shredding row",
+											 ALLOCSET_SMALL_SIZES),
+	};
+
+	for (int i = 0; i < parts.keys.num_keys; i++)
+	{
+		iter->values[i] =
+			tsl_get_decompression_iterator_init(parts.values[i]->compression_algorithm,
+												reverse)(PointerGetDatum(parts.values[i]),
+														 TEXTOID);
+	}
+
+	return &iter->base;
+}
+
+DecompressionIterator *
+jsonb_shred_decompression_iterator_from_datum_forward(Datum compressed, Oid element_type)
+{
+	return jsonb_shred_decompression_iterator_from_datum(compressed, element_type, false);
+}
+
+DecompressionIterator *
+jsonb_shred_decompression_iterator_from_datum_reverse(Datum compressed, Oid element_type)
+{
+	return jsonb_shred_decompression_iterator_from_datum(compressed, element_type, true);
+}
+
+/*
+ * Compute "jsonb ->> key" for a single value. The result can be NULL, so we
+ * can't use DirectFunctionCall.
+ */
+Datum
+jsonb_field_text(Datum jsonb, Datum key, bool *isnull)
+{
+	LOCAL_FCINFO(fcinfo, 2);
+	InitFunctionCallInfoData(*fcinfo, NULL, 2, InvalidOid, NULL, NULL);
+	fcinfo->args[0].value = jsonb;
+	fcinfo->args[0].isnull = false;
+	fcinfo->args[1].value = key;
+	fcinfo->args[1].isnull = false;
+
+	Datum result = jsonb_object_field_text(fcinfo);
+	*isnull = fcinfo->isnull;
+	return result;
+}
+
+/*
+ * Decompress the "jsonb ->> key" text values of the entire batch of jsonb
+ * values compressed with any algorithm, for the vectorized filters. For the
+ * shredded keys, we just decompress their sub-column. Otherwise, we have to
+ * compute the field for each row, but for the shredded data, only the
+ * residual column has to be decompressed.
+ */
+ArrowArray *
+jsonb_field_text_decompress_all(Datum compressed, Datum key, MemoryContext dest_mctx)
+{
+	const CompressedDataHeader *header =
+		(const CompressedDataHeader *) PG_DETOAST_DATUM(compressed);
+	const CompressedDataHeader *rows = header;
+	if (header->compression_algorithm == COMPRESSION_ALGORITHM_JSONB)
+	{
+		const JsonbShredParts parts = jsonb_shred_compressed_parts((void *) header);
+		const text *key_text = DatumGetTextPP(key);
+		const int i =
+			jsonb_shred_find_key(&parts.keys, VARDATA_ANY(key_text), VARSIZE_ANY_EXHDR(key_text));
+		if (i >= 0)
+		{
+			DecompressAllFunction decompress_all =
+				tsl_get_decompress_all_function(parts.values[i]->compression_algorithm, TEXTOID);
+			Assert(decompress_all != NULL);
+			return decompress_all(PointerGetDatum(parts.values[i]), TEXTOID, dest_mctx);
+		}
+
+		/* The other keys can only be in the residual. */
+		rows = parts.residual;
+	}
+
+	DecompressionIterator *iter =
+		tsl_get_decompression_iterator_init(rows->compression_algorithm,
+											/* reverse = */ false)(PointerGetDatum(rows),
+																   JSONBOID);
+
+	uint32 capacity = TARGET_COMPRESSED_BATCH_SIZE;
+	uint32 *offsets = MemoryContextAlloc(dest_mctx, sizeof(uint32) * (capacity + 1));
+	uint64 *validity_bitmap =
+		MemoryContextAllocZero(dest_mctx, sizeof(uint64) * (pad_to_multiple(64, capacity) / 64));
+	StringInfoData bodies;
+	initStringInfo(&bodies);
+	uint32 n_total = 0;
+	uint32 n_notnull = 0;
+	for (DecompressResult res = iter->try_next(iter); !res.is_done; res = iter->try_next(iter))
+	{
+		CheckCompressedData(n_total < GLOBAL_MAX_ROWS_PER_COMPRESSION);
+		if (n_total == capacity)
+		{
+			const uint32 new_capacity = Min(2 * capacity, GLOBAL_MAX_ROWS_PER_COMPRESSION);
+			const Size validity_bytes = sizeof(uint64) * (pad_to_multiple(64, capacity) / 64);
+			const Size new_validity_bytes =
+				sizeof(uint64) * (pad_to_multiple(64, new_capacity) / 64);
+
+			offsets = repalloc(offsets, sizeof(uint32) * (new_capacity + 1));
+			validity_bitmap = repalloc(validity_bitmap, new_validity_bytes);
+			memset(&((uint8 *) validity_bitmap)[validity_bytes],
+				   0,
+				   new_validity_bytes - validity_bytes);
+			capacity = new_capacity;
+		}
+
+		offsets[n_total] = bodies.len;
+		bool isnull = res.is_null;
+		if (!isnull)
+		{
+			Datum field = jsonb_field_text(res.val, key, &isnull);
+			if (!isnull)
+			{
+				text *field_text = DatumGetTextPP(field);
+				appendBinaryStringInfo(&bodies,
+									   VARDATA_ANY(field_text),
+									   VARSIZE_ANY_EXHDR(field_text));
+				arrow_set_row_validity(validity_bitmap, n_total, true);
+				n_notnull++;
+			}
+		}
+		n_total++;
+	}
+	offsets[n_total] = bodies.len;
+
+	uint8 *arrow_bodies = MemoryContextAllocZero(dest_mctx, pad_to_multiple(64, bodies.len));
+	memcpy(arrow_bodies, bodies.data, bodies.len);
+	pfree(bodies.data);
+
+	ArrowArray *result =
+		MemoryContextAllocZero(dest_mctx, sizeof(ArrowArray) + (sizeof(void *) * 3));
+	const void **buffers = (const void **) &result[1];
+	buffers[0] = validity_bitmap;
+	buffers[1] = offsets;
+	buffers[2] = arrow_bodies;
+	result->n_buffers = 3;
+	result->buffers = buffers;
+	result->length = n_total;
+	result->null_count = n_total - n_notnull;
+	return result;
+}
+
+/*
+ * Send and receive functions. We send the merged values in the array format,
+ * and the receiver shreds them anew. The choice of the keys depends only on
+ * the values, so this gives the same result.
+ */
+
+void
+jsonb_shred_compressed_send(CompressedDataHeader *header, StringInfo buffer)
+{
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_JSONB);
+	DecompressionIterator *iter =
+		jsonb_shred_decompression_iterator_from_datum_forward(PointerGetDatum(header), JSONBOID);
+	ArrayCompressor *compressor = array_compressor_alloc(JSONBOID);
+	for (DecompressResult res = iter->try_next(iter); !res.is_done; res = iter->try_next(iter))
+	{
+		if (res.is_null)
+			array_compressor_append_null(compressor);
+		else
+			array_compressor_append(compressor, res.val);
+	}
+
+	CompressedDataHeader *merged = array_compressor_finish(compressor);
+	Assert(merged != NULL);
+	array_compressed_send(merged, buffer);
+	pfree(merged);
+}
+
+Datum
+jsonb_shred_compressed_recv(StringInfo buffer)
+{
+	const CompressedDataHeader *merged =
+		(const CompressedDataHeader *) DatumGetPointer(array_compressed_recv(buffer));
+	CheckCompressedData(merged != NULL);
+	CheckCompressedData(merged->compression_algorithm == COMPRESSION_ALGORITHM_ARRAY);
+
+	void *shredded = jsonb_shred_compress(merged);
+	CheckCompressedData(shredded != NULL);
+	PG_RETURN_POINTER(shredded);
+}
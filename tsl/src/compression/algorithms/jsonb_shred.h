@@ -0,0 +1,53 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+/*
+ * The jsonb shredding stores the top-level keys of jsonb objects that have a
+ * string value in most rows of the batch as separate text sub-columns, and
+ * the rest of each object as a residual jsonb value. The sub-columns are
+ * compressed with the dictionary algorithm, and the residual with the array
+ * algorithm. The decompression puts the keys back into the objects.
+ *
+ * This doesn't necessarily make the data smaller, but the filters like
+ * "jsonb_column ->> 'key' = 'value'" can read the sub-column of the key
+ * without decompressing and parsing the entire jsonb values. The shredding is
+ * tried by the dictionary compressor for the jsonb columns when
+ * timescaledb.enable_jsonb_shredding is enabled, and used whenever some keys
+ * qualify.
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+
+#include "compression/compression.h"
+
+extern bool jsonb_shred_compressed_has_nulls(const CompressedDataHeader *header);
+extern Compressor *jsonb_shred_compressor_for_type(Oid element_type);
+extern void *jsonb_shred_compress(const CompressedDataHeader *compressed);
+
+extern DecompressionIterator *
+jsonb_shred_decompression_iterator_from_datum_forward(Datum compressed, Oid element_type);
+extern DecompressionIterator *
+jsonb_shred_decompression_iterator_from_datum_reverse(Datum compressed, Oid element_type);
+
+extern Datum jsonb_field_text(Datum jsonb, Datum key, bool *isnull);
+extern ArrowArray *jsonb_field_text_decompress_all(Datum compressed, Datum key,
+												   MemoryContext dest_mctx);
+
+extern void jsonb_shred_compressed_send(CompressedDataHeader *header, StringInfo buffer);
+extern Datum jsonb_shred_compressed_recv(StringInfo buf);
+
+#define JSONB_SHRED_ALGORITHM_DEFINITION                                                           \
+	{                                                                                              \
+		.iterator_init_forward = jsonb_shred_decompression_iterator_from_datum_forward,            \
+		.iterator_init_reverse = jsonb_shred_decompression_iterator_from_datum_reverse,            \
+		.decompress_all = NULL, .compressed_data_send = jsonb_shred_compressed_send,               \
+		.compressed_data_recv = jsonb_shred_compressed_recv,                                       \
+		.compressor_for_type = jsonb_shred_compressor_for_type,                                    \
+		.compressed_data_storage = TOAST_STORAGE_EXTENDED,                                         \
+	}
@@ -160,6 +160,8 @@ static inline Simple8bRleSerialized *bytes_deserialize_simple8b_and_advance(Stri
 static inline size_t simple8brle_serialized_slot_size(const Simple8bRleSerialized *data);
 static inline size_t simple8brle_serialized_total_size(const Simple8bRleSerialized *data);
 static inline size_t simple8brle_compressor_compressed_size(Simple8bRleCompressor *compressor);
+static inline bool simple8brle_serialized_zero_tail(const Simple8bRleSerialized *data,
+													 uint32 head, uint64 *restrict head_values);
 
 /*********************
  ***  Private API  ***
@@ -293,6 +295,80 @@ simple8brle_serialized_total_size(const Simple8bRleSerialized *data)
 	return sizeof(*data) + simple8brle_serialized_slot_size(data);
 }
 
+/*
+ * Check that all the elements starting from the given position are zero,
+ * without decompressing the data. The elements before this position are
+ * returned in head_values. This allows to detect e.g. the constant step in the
+ * delta-delta encoding, where every delta-of-delta except the first two is
+ * zero and is normally stored as a single RLE block.
+ *
+ * This is conservative and returns false for anything unusual, the caller is
+ * expected to fall back to the normal decompression which does the full
+ * validation.
+ */
+static bool
+simple8brle_serialized_zero_tail(const Simple8bRleSerialized *data, uint32 head,
+								 uint64 *restrict head_values)
+{
+	if (data->num_elements < head)
+		return false;
+
+	const uint32 num_selector_slots =
+		simple8brle_num_selector_slots_for_num_blocks(data->num_blocks);
+	const uint64 *blocks = data->slots + num_selector_slots;
+	uint32 position = 0;
+	for (uint32 block_index = 0; block_index < data->num_blocks; block_index++)
+	{
+		const uint64 slot_value = data->slots[block_index / SIMPLE8B_SELECTORS_PER_SELECTOR_SLOT];
+		const uint8 selector_shift =
+			(block_index % SIMPLE8B_SELECTORS_PER_SELECTOR_SLOT) * SIMPLE8B_BITS_PER_SELECTOR;
+		const uint8 selector = (slot_value >> selector_shift) & 0xFULL;
+		const uint64 block_data = blocks[block_index];
+
+		if (selector == 0)
+			return false;
+
+		if (simple8brle_selector_is_rle(selector))
+		{
+			const uint64 value = simple8brle_rledata_value(block_data);
+			uint32 remaining = simple8brle_rledata_repeatcount(block_data);
+			if (remaining == 0)
+				return false;
+
+			for (; remaining > 0 && position < head; remaining--)
+				head_values[position++] = value;
+
+			if (remaining > 0 && value != 0)
+				return false;
+
+			position += remaining;
+		}
+		else
+		{
+			const uint32 bits_per_value = SIMPLE8B_BIT_LENGTH[selector];
+			const uint32 n_block_values = SIMPLE8B_NUM_ELEMENTS[selector];
+			const uint64 bitmask = simple8brle_selector_get_bitmask(selector);
+			uint32 i = 0;
+			for (; i < n_block_values && position < head; i++)
+				head_values[position++] = (block_data >> (bits_per_value * i)) & bitmask;
+
+			/*
+			 * The shift is less than 64 here, because the values of the block
+			 * fit into 64 bits. The unused bits are zero in valid data.
+			 */
+			if (i < n_block_values && (block_data >> (bits_per_value * i)) != 0)
+				return false;
+
+			position += n_block_values - i;
+		}
+
+		if (position >= data->num_elements)
+			return block_index == data->num_blocks - 1;
+	}
+
+	return false;
+}
+
 /*******************************
  ***  Simple8bRleCompressor  ***
  *******************************/
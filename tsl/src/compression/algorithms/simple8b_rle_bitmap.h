@@ -77,12 +77,11 @@ simple8brle_bitmap_prefixsums(Simple8bRleSerialized *compressed)
 	uint32 decompressed_index = 0;
 	for (uint32 block_index = 0; block_index < num_blocks; block_index++)
 	{
-		const uint32 selector_slot = block_index / SIMPLE8B_SELECTORS_PER_SELECTOR_SLOT;
-		const uint32 selector_pos_in_slot = block_index % SIMPLE8B_SELECTORS_PER_SELECTOR_SLOT;
-		const uint64 slot_value = compressed->slots[selector_slot];
-		const uint8 selector_shift = selector_pos_in_slot * SIMPLE8B_BITS_PER_SELECTOR;
-		const uint64 selector_mask = 0xFULL << selector_shift;
-		const uint8 selector_value = (slot_value & selector_mask) >> selector_shift;
+		const uint8 selector_value =
+			bit_array_unpack_at(compressed->slots,
+								num_selector_slots - 1,
+								(uint64) block_index * SIMPLE8B_BITS_PER_SELECTOR,
+								SIMPLE8B_BITS_PER_SELECTOR);
 		Assert(selector_value < 16);
 
 		uint64 block_data = compressed_data[block_index];
@@ -233,12 +232,11 @@ simple8brle_bitmap_decompress(Simple8bRleSerialized *compressed)
 	uint32 decompressed_index = 0;
 	for (uint32 block_index = 0; block_index < num_blocks; block_index++)
 	{
-		const uint32 selector_slot = block_index / SIMPLE8B_SELECTORS_PER_SELECTOR_SLOT;
-		const uint32 selector_pos_in_slot = block_index % SIMPLE8B_SELECTORS_PER_SELECTOR_SLOT;
-		const uint64 slot_value = compressed->slots[selector_slot];
-		const uint8 selector_shift = selector_pos_in_slot * SIMPLE8B_BITS_PER_SELECTOR;
-		const uint64 selector_mask = 0xFULL << selector_shift;
-		const uint8 selector_value = (slot_value & selector_mask) >> selector_shift;
+		const uint8 selector_value =
+			bit_array_unpack_at(compressed->slots,
+								num_selector_slots - 1,
+								(uint64) block_index * SIMPLE8B_BITS_PER_SELECTOR,
+								SIMPLE8B_BITS_PER_SELECTOR);
 		Assert(selector_value < 16);
 
 		uint64 block_data = compressed_data[block_index];
@@ -39,13 +39,12 @@ FUNCTION_NAME(simple8brle_decompress_all_buf,
 	const uint64 *slots = compressed->slots;
 	for (uint32 block_index = 0; block_index < num_blocks; block_index++)
 	{
-		const uint32 selector_slot = block_index / SIMPLE8B_SELECTORS_PER_SELECTOR_SLOT;
-		const uint32 selector_pos_in_slot = block_index % SIMPLE8B_SELECTORS_PER_SELECTOR_SLOT;
-		const uint64 slot_value = slots[selector_slot];
-		const uint8 selector_shift = selector_pos_in_slot * SIMPLE8B_BITS_PER_SELECTOR;
-		const uint64 selector_mask = 0xFULL << selector_shift;
-		const uint8 selector_value = (slot_value & selector_mask) >> selector_shift;
-		selector_values[block_index] = selector_value;
+		/* The selectors never span the slots, so this reads only one slot */
+		selector_values[block_index] =
+			bit_array_unpack_at(slots,
+								num_selector_slots - 1,
+								(uint64) block_index * SIMPLE8B_BITS_PER_SELECTOR,
+								SIMPLE8B_BITS_PER_SELECTOR);
 	}
 
 	/*
@@ -101,11 +100,10 @@ FUNCTION_NAME(simple8brle_decompress_all_buf,
 		CheckCompressedData(n_block_values <= n_buffer_elements);                                  \
 		CheckCompressedData(decompressed_index <= n_buffer_elements - n_block_values);             \
                                                                                                    \
-		const uint64 bitmask = simple8brle_selector_get_bitmask(X);                                \
-                                                                                                   \
 		for (uint16 i = 0; i < n_block_values; i++)                                                \
 		{                                                                                          \
-			const ELEMENT_TYPE value = (block_data >> (bits_per_value * i)) & bitmask;             \
+			const ELEMENT_TYPE value =                                                             \
+				bit_array_unpack_at(&block_data, 0, bits_per_value * i, bits_per_value);           \
 			decompressed_values[decompressed_index + i] = value;                                   \
 		}                                                                                          \
 		decompressed_index += n_block_values;                                                      \
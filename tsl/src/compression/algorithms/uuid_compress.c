@@ -0,0 +1,695 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "uuid_compress.h"
+
+#include <catalog/pg_type.h>
+#include <lib/stringinfo.h>
+#include <libpq/pqformat.h>
+#include <port/pg_bswap.h>
+#include <utils/builtins.h>
+#include <utils/uuid.h>
+
+#include "adts/uint64_vec.h"
+#include "compression/arrow_c_data_interface.h"
+#include "compression/compression.h"
+#include "dictionary.h"
+#include "simple8b_rle.h"
+#include "simple8b_rle_bitmap.h"
+
+/*
+ * UUID compressed data is stored as
+ *     UuidCompressed header
+ *     simple8b_rle timestamps: the zigzag-encoded delta of deltas of the
+ *         timestamps of the non-null values
+ *     simple8b_rle nulls: 1 if the value is NULL, else 0, only if has_nulls
+ *     uint64 random[]: the random bits of the non-null values, 74 bits per
+ *         value without gaps, padded to full words, up to the end of data
+ */
+typedef struct UuidCompressed
+{
+	CompressedDataHeaderFields;
+	uint8 has_nulls; /* 1 if this has a NULLs bitmap, 0 otherwise */
+	uint8 padding[2];
+} UuidCompressed;
+
+static void
+pg_attribute_unused() assertions(void)
+{
+	UuidCompressed test_val = { .vl_len_ = { 0 } };
+	/* make sure no padding bytes make it to disk */
+	StaticAssertStmt(sizeof(UuidCompressed) ==
+						 sizeof(test_val.vl_len_) + sizeof(test_val.compression_algorithm) +
+							 sizeof(test_val.has_nulls) + sizeof(test_val.padding),
+					 "UuidCompressed wrong size");
+	StaticAssertStmt(sizeof(UuidCompressed) == 8, "UuidCompressed wrong size");
+}
+
+/*
+ * The layout of the version 7 UUID, as big-endian integers:
+ *     high word: 48 bits of timestamp, 4 bits of version, 12 bits of rand_a
+ *     low word: 2 bits of variant, 62 bits of rand_b
+ */
+#define UUID_V7_RAND_A_BITS 12
+#define UUID_V7_RAND_B_BITS 62
+#define UUID_V7_RANDOM_BITS (UUID_V7_RAND_A_BITS + UUID_V7_RAND_B_BITS)
+#define UUID_V7_TIMESTAMP_SHIFT 16
+#define UUID_V7_VERSION_MASK (UINT64CONST(0xF) << UUID_V7_RAND_A_BITS)
+#define UUID_V7_VERSION (UINT64CONST(7) << UUID_V7_RAND_A_BITS)
+#define UUID_V7_VARIANT_MASK (UINT64CONST(0x3) << UUID_V7_RAND_B_BITS)
+#define UUID_V7_VARIANT (UINT64CONST(0x2) << UUID_V7_RAND_B_BITS)
+
+typedef struct UuidCompressor
+{
+	/* The high and low words of the non-null values, as big-endian integers. */
+	uint64_vec hi;
+	uint64_vec lo;
+	Simple8bRleCompressor nulls;
+	bool has_nulls;
+	/* Whether all the non-null values are version 7 UUIDs. */
+	bool all_v7;
+} UuidCompressor;
+
+typedef struct ExtendedCompressor
+{
+	Compressor base;
+	UuidCompressor *internal;
+} ExtendedCompressor;
+
+typedef struct UuidDecompressionIterator
+{
+	DecompressionIterator base;
+	/* The values are decoded all at once, in the Arrow format. */
+	ArrowArray *arrow;
+	/* The next row to return. */
+	int32 row;
+} UuidDecompressionIterator;
+
+static inline uint64
+uuid_zig_zag_encode(uint64 value)
+{
+	/* (value << 1) ^ (value >> 63), with the arithmetic shift */
+	return (value << 1) ^ (uint64) ((int64) value >> 63);
+}
+
+static inline uint64
+uuid_zig_zag_decode(uint64 value)
+{
+	return (value >> 1) ^ -(value & 1);
+}
+
+static inline bool
+uuid_is_v7(uint64 hi, uint64 lo)
+{
+	return (hi & UUID_V7_VERSION_MASK) == UUID_V7_VERSION &&
+		   (lo & UUID_V7_VARIANT_MASK) == UUID_V7_VARIANT;
+}
+
+static inline uint32
+uuid_random_words(uint32 num_values)
+{
+	return ((uint64) num_values * UUID_V7_RANDOM_BITS + 63) / 64;
+}
+
+/*
+ * Append the lower bits of the value at the given bit position. The output
+ * words must be zeroed.
+ */
+static inline void
+uuid_bits_write(uint64 *restrict words, uint64 position, uint64 value, int bits)
+{
+	Assert(bits > 0 && bits <= 64);
+	Assert(bits == 64 || value >> bits == 0);
+	const uint64 word = position / 64;
+	const int shift = position % 64;
+	words[word] |= value << shift;
+	if (shift + bits > 64)
+		words[word + 1] |= value >> (64 - shift);
+}
+
+static inline uint64
+uuid_bits_read(const uint64 *words, uint64 position, int bits)
+{
+	Assert(bits > 0 && bits < 64);
+	const uint64 word = position / 64;
+	const int shift = position % 64;
+	uint64 value = words[word] >> shift;
+	if (shift + bits > 64)
+		value |= words[word + 1] << (64 - shift);
+	return value & ((UINT64CONST(1) << bits) - 1);
+}
+
+bool
+uuid_compressed_has_nulls(const CompressedDataHeader *header)
+{
+	const UuidCompressed *uc = (const UuidCompressed *) header;
+	return uc->has_nulls;
+}
+
+/*
+ * Compressor framework functions and definitions for the UUID algorithm.
+ */
+
+UuidCompressor *
+uuid_compressor_alloc(void)
+{
+	UuidCompressor *compressor = palloc0(sizeof(*compressor));
+	uint64_vec_init(&compressor->hi, CurrentMemoryContext, TARGET_COMPRESSED_BATCH_SIZE);
+	uint64_vec_init(&compressor->lo, CurrentMemoryContext, TARGET_COMPRESSED_BATCH_SIZE);
+	simple8brle_compressor_init(&compressor->nulls);
+	compressor->all_v7 = true;
+	return compressor;
+}
+
+void
+uuid_compressor_append_null(UuidCompressor *compressor)
+{
+	compressor->has_nulls = true;
+	simple8brle_compressor_append(&compressor->nulls, 1);
+}
+
+static void
+uuid_compressor_append_bytes(UuidCompressor *compressor, const uint8 *bytes)
+{
+	uint64 hi;
+	uint64 lo;
+	memcpy(&hi, &bytes[0], sizeof(hi));
+	memcpy(&lo, &bytes[sizeof(hi)], sizeof(lo));
+	hi = pg_ntoh64(hi);
+	lo = pg_ntoh64(lo);
+
+	compressor->all_v7 &= uuid_is_v7(hi, lo);
+	uint64_vec_append(&compressor->hi, hi);
+	uint64_vec_append(&compressor->lo, lo);
+	simple8brle_compressor_append(&compressor->nulls, 0);
+}
+
+void
+uuid_compressor_append(UuidCompressor *compressor, Datum val)
+{
+	uuid_compressor_append_bytes(compressor, DatumGetUUIDP(val)->data);
+}
+
+/*
+ * Returns NULL if all the values are null, or if some of them are not version
+ * 7 UUIDs and can't be compressed with this algorithm.
+ */
+void *
+uuid_compressor_finish(UuidCompressor *compressor)
+{
+	Simple8bRleSerialized *nulls = simple8brle_compressor_finish(&compressor->nulls);
+
+	const uint32 num_values = compressor->hi.num_elements;
+	if (num_values == 0 || !compressor->all_v7)
+		return NULL;
+
+	const uint64 *hi = compressor->hi.data;
+	const uint64 *lo = compressor->lo.data;
+
+	Simple8bRleCompressor timestamps_compressor;
+	simple8brle_compressor_init(&timestamps_compressor);
+	const uint32 num_random_words = uuid_random_words(num_values);
+	uint64 *random = palloc0(sizeof(uint64) * num_random_words);
+	uint64 prev_timestamp = 0;
+	uint64 prev_delta = 0;
+	for (uint32 i = 0; i < num_values; i++)
+	{
+		const uint64 timestamp = hi[i] >> UUID_V7_TIMESTAMP_SHIFT;
+		const uint64 delta = timestamp - prev_timestamp;
+		simple8brle_compressor_append(&timestamps_compressor,
+									  uuid_zig_zag_encode(delta - prev_delta));
+		prev_timestamp = timestamp;
+		prev_delta = delta;
+
+		const uint64 position = (uint64) i * UUID_V7_RANDOM_BITS;
+		const uint64 rand_a = hi[i] & ((UINT64CONST(1) << UUID_V7_RAND_A_BITS) - 1);
+		const uint64 rand_b = lo[i] & ((UINT64CONST(1) << UUID_V7_RAND_B_BITS) - 1);
+		uuid_bits_write(random, position, rand_a, UUID_V7_RAND_A_BITS);
+		uuid_bits_write(random, position + UUID_V7_RAND_A_BITS, rand_b, UUID_V7_RAND_B_BITS);
+	}
+	Simple8bRleSerialized *timestamps = simple8brle_compressor_finish(&timestamps_compressor);
+
+	const Size timestamps_size = simple8brle_serialized_total_size(timestamps);
+	const Size nulls_size = compressor->has_nulls ? simple8brle_serialized_total_size(nulls) : 0;
+	const Size compressed_size = sizeof(UuidCompressed) + timestamps_size + nulls_size +
+								 sizeof(uint64) * num_random_words;
+
+	if (!AllocSizeIsValid(compressed_size))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("compressed size exceeds the maximum allowed (%d)", (int) MaxAllocSize)));
+
+	char *compressed_data = palloc0(compressed_size);
+	UuidCompressed *compressed = (UuidCompressed *) compressed_data;
+	SET_VARSIZE(&compressed->vl_len_, compressed_size);
+	compressed->compression_algorithm = COMPRESSION_ALGORITHM_UUID;
+	compressed->has_nulls = nulls_size != 0 ? 1 : 0;
+
+	char *data = compressed_data + sizeof(UuidCompressed);
+	data = bytes_serialize_simple8b_and_advance(data, timestamps_size, timestamps);
+	if (nulls_size > 0)
+		data = bytes_serialize_simple8b_and_advance(data, nulls_size, nulls);
+	memcpy(data, random, sizeof(uint64) * num_random_words);
+	Assert((Size) (data + sizeof(uint64) * num_random_words - compressed_data) == compressed_size);
+
+	pfree(random);
+	return compressed;
+}
+
+/*
+ * Compress the values that are not all version 7 UUIDs with the dictionary
+ * algorithm, which is the default one for UUIDs.
+ */
+static void *
+uuid_compressor_finish_dictionary(UuidCompressor *compressor)
+{
+	Simple8bRleSerialized *nulls_serialized = simple8brle_compressor_finish(&compressor->nulls);
+	Simple8bRleBitmap nulls = simple8brle_bitmap_decompress(nulls_serialized);
+	DictionaryCompressor *dictionary = dictionary_compressor_alloc(UUIDOID);
+	uint32 current_notnull_element = 0;
+	for (uint32 row = 0; row < nulls.num_elements; row++)
+	{
+		if (simple8brle_bitmap_get_at(&nulls, row))
+		{
+			dictionary_compressor_append_null(dictionary);
+			continue;
+		}
+
+		pg_uuid_t value;
+		const uint64 hi = pg_hton64(compressor->hi.data[current_notnull_element]);
+		const uint64 lo = pg_hton64(compressor->lo.data[current_notnull_element]);
+		memcpy(&value.data[0], &hi, sizeof(hi));
+		memcpy(&value.data[sizeof(hi)], &lo, sizeof(lo));
+		dictionary_compressor_append(dictionary, UUIDPGetDatum(&value));
+		current_notnull_element++;
+	}
+	Assert(current_notnull_element == compressor->hi.num_elements);
+
+	return dictionary_compressor_finish(dictionary);
+}
+
+static void
+uuid_compressor_append_datum(Compressor *compressor, Datum val)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = uuid_compressor_alloc();
+
+	uuid_compressor_append(extended->internal, val);
+}
+
+static void
+uuid_compressor_append_null_value(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		extended->internal = uuid_compressor_alloc();
+
+	uuid_compressor_append_null(extended->internal);
+}
+
+static void *
+uuid_compressor_finish_and_reset(Compressor *compressor)
+{
+	ExtendedCompressor *extended = (ExtendedCompressor *) compressor;
+	if (extended->internal == NULL)
+		return NULL;
+
+	void *compressed = extended->internal->all_v7 ?
+						   uuid_compressor_finish(extended->internal) :
+						   uuid_compressor_finish_dictionary(extended->internal);
+	uint64_vec_free_data(&extended->internal->hi);
+	uint64_vec_free_data(&extended->internal->lo);
+	pfree(extended->internal);
+	extended->internal = NULL;
+	return compressed;
+}
+
+const Compressor uuid_compressor = {
+	.append_val = uuid_compressor_append_datum,
+	.append_null = uuid_compressor_append_null_value,
+	.finish = uuid_compressor_finish_and_reset,
+};
+
+Compressor *
+uuid_compressor_for_type(Oid element_type)
+{
+	if (element_type != UUIDOID)
+		elog(ERROR, "invalid type for UUID compressor \"%s\"", format_type_be(element_type));
+
+	ExtendedCompressor *compressor = palloc(sizeof(*compressor));
+	*compressor = (ExtendedCompressor){
+		.base = uuid_compressor,
+	};
+	return &compressor->base;
+}
+
+/*
+ * Decompression functions.
+ */
+
+/*
+ * The parts of the compressed data after they have been validated.
+ */
+typedef struct UuidCompressedParts
+{
+	const UuidCompressed *header;
+	Simple8bRleSerialized *timestamps;
+	Simple8bRleSerialized *nulls;
+	/* Not necessarily aligned. */
+	const char *random;
+} UuidCompressedParts;
+
+static UuidCompressedParts
+uuid_compressed_parts(void *compressed)
+{
+	StringInfoData si = { .data = compressed, .len = VARSIZE(compressed) };
+	const UuidCompressed *header = consumeCompressedData(&si, sizeof(UuidCompressed));
+
+	CheckCompressedData(header->has_nulls == 0 || header->has_nulls == 1);
+
+	UuidCompressedParts parts = { .header = header };
+	parts.timestamps = bytes_deserialize_simple8b_and_advance(&si);
+	CheckCompressedData(parts.timestamps->num_elements > 0);
+	CheckCompressedData(parts.timestamps->num_elements <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	if (header->has_nulls)
+	{
+		parts.nulls = bytes_deserialize_simple8b_and_advance(&si);
+		CheckCompressedData(parts.nulls->num_elements > parts.timestamps->num_elements);
+		CheckCompressedData(parts.nulls->num_elements <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+	}
+
+	/* The random bits take the rest of the data. */
+	const uint32 random_bytes = sizeof(uint64) * uuid_random_words(parts.timestamps->num_elements);
+	CheckCompressedData((uint32) (si.len - si.cursor) == random_bytes);
+	parts.random = consumeCompressedData(&si, random_bytes);
+
+	return parts;
+}
+
+#define ELEMENT_TYPE uint64
+#include "simple8b_rle_decompress_all.h"
+#undef ELEMENT_TYPE
+
+static ArrowArray *
+uuid_decompress_parts(const UuidCompressedParts *parts, MemoryContext dest_mctx)
+{
+	uint32 n_notnull;
+	const uint64 *delta_deltas = simple8brle_decompress_all_uint64(parts->timestamps, &n_notnull);
+
+	const bool has_nulls = parts->header->has_nulls == 1;
+	Simple8bRleBitmap nulls = { 0 };
+	if (has_nulls)
+	{
+		nulls = simple8brle_bitmap_decompress(parts->nulls);
+	}
+
+	const uint32 n_total = has_nulls ? nulls.num_elements : n_notnull;
+	CheckCompressedData(n_total >= n_notnull);
+	CheckCompressedData(n_total <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+	if (has_nulls)
+	{
+		/*
+		 * The number of not-null elements we have must be consistent with the
+		 * nulls bitmap.
+		 */
+		CheckCompressedData(n_notnull + simple8brle_bitmap_num_ones(&nulls) == n_total);
+	}
+
+	/* Copy the random bits to have them aligned. */
+	const uint32 num_random_words = uuid_random_words(n_notnull);
+	uint64 *random = palloc(sizeof(uint64) * num_random_words);
+	memcpy(random, parts->random, sizeof(uint64) * num_random_words);
+
+	uint8 *restrict values =
+		MemoryContextAllocZero(dest_mctx, pad_to_multiple(64, (Size) UUID_LEN * n_total));
+
+	/*
+	 * The timestamps must fit into their 48 bits, we accumulate the higher
+	 * bits to check this once at the end.
+	 */
+	uint64 overflow_bits = 0;
+	uint64 timestamp = 0;
+	uint64 delta = 0;
+	uint32 current_notnull_element = 0;
+	for (uint32 row = 0; row < n_total; row++)
+	{
+		if (has_nulls && simple8brle_bitmap_get_at(&nulls, row))
+		{
+			continue;
+		}
+
+		Assert(current_notnull_element < n_notnull);
+		delta += uuid_zig_zag_decode(delta_deltas[current_notnull_element]);
+		timestamp += delta;
+		overflow_bits |= timestamp;
+
+		const uint64 position = (uint64) current_notnull_element * UUID_V7_RANDOM_BITS;
+		const uint64 rand_a = uuid_bits_read(random, position, UUID_V7_RAND_A_BITS);
+		const uint64 rand_b =
+			uuid_bits_read(random, position + UUID_V7_RAND_A_BITS, UUID_V7_RAND_B_BITS);
+		current_notnull_element++;
+
+		const uint64 hi =
+			pg_hton64((timestamp << UUID_V7_TIMESTAMP_SHIFT) | UUID_V7_VERSION | rand_a);
+		const uint64 lo = pg_hton64(UUID_V7_VARIANT | rand_b);
+		memcpy(&values[UUID_LEN * row], &hi, sizeof(hi));
+		memcpy(&values[UUID_LEN * row + sizeof(hi)], &lo, sizeof(lo));
+	}
+	Assert(current_notnull_element == n_notnull);
+	CheckCompressedData(overflow_bits >> (64 - UUID_V7_TIMESTAMP_SHIFT) == 0);
+
+	pfree(random);
+
+	uint64 *restrict validity_bitmap = NULL;
+	if (has_nulls)
+	{
+		const int validity_bitmap_bytes = sizeof(uint64) * (pad_to_multiple(64, n_total) / 64);
+		validity_bitmap = MemoryContextAlloc(dest_mctx, validity_bitmap_bytes);
+
+		/*
+		 * Note that the validity bitmap size is a multiple of 64 bits. We have
+		 * to fill the tail bits with zeros, because the corresponding elements
+		 * are not valid.
+		 */
+		memset(validity_bitmap, 0xFF, validity_bitmap_bytes);
+		if (n_total % 64)
+		{
+			const uint64 tail_mask = ~0ULL >> (64 - n_total % 64);
+			validity_bitmap[n_total / 64] &= tail_mask;
+		}
+
+		for (uint32 row = 0; row < n_total; row++)
+		{
+			if (simple8brle_bitmap_get_at(&nulls, row))
+			{
+				arrow_set_row_validity(validity_bitmap, row, false);
+			}
+		}
+	}
+
+	ArrowArray *result =
+		MemoryContextAllocZero(dest_mctx, sizeof(ArrowArray) + (sizeof(void *) * 2));
+	const void **buffers = (const void **) &result[1];
+	buffers[0] = validity_bitmap;
+	buffers[1] = values;
+	result->n_buffers = 2;
+	result->buffers = buffers;
+	result->length = n_total;
+	result->null_count = n_total - n_notnull;
+	return result;
+}
+
+ArrowArray *
+uuid_decompress_all(Datum compressed_data, Oid element_type, MemoryContext dest_mctx)
+{
+	Assert(element_type == UUIDOID);
+	void *detoasted = PG_DETOAST_DATUM(compressed_data);
+	UuidCompressedParts parts = uuid_compressed_parts(detoasted);
+	return uuid_decompress_parts(&parts, dest_mctx);
+}
+
+/*
+ * Decompress the UUIDs compressed with another algorithm, e.g. dictionary,
+ * into the same fixed-width Arrow array as the UUID algorithm produces. This
+ * goes through the row-by-row iterator, but lets us use the vectorized
+ * filters and grouping for all the UUID columns.
+ */
+ArrowArray *
+uuid_iterator_decompress_all(Datum compressed_data, Oid element_type, MemoryContext dest_mctx)
+{
+	Assert(element_type == UUIDOID);
+	const CompressedDataHeader *header =
+		(const CompressedDataHeader *) PG_DETOAST_DATUM(compressed_data);
+	DecompressionIterator *iter =
+		tsl_get_decompression_iterator_init(header->compression_algorithm,
+											/* reverse = */ false)(PointerGetDatum(header),
+																   element_type);
+
+	uint32 capacity = TARGET_COMPRESSED_BATCH_SIZE;
+	uint8 *values = MemoryContextAllocZero(dest_mctx, pad_to_multiple(64, UUID_LEN * capacity));
+	uint64 *validity_bitmap =
+		MemoryContextAllocZero(dest_mctx, sizeof(uint64) * (pad_to_multiple(64, capacity) / 64));
+	uint32 n_total = 0;
+	uint32 n_notnull = 0;
+	for (DecompressResult res = iter->try_next(iter); !res.is_done; res = iter->try_next(iter))
+	{
+		CheckCompressedData(n_total < GLOBAL_MAX_ROWS_PER_COMPRESSION);
+		if (n_total == capacity)
+		{
+			const uint32 new_capacity = Min(2 * capacity, GLOBAL_MAX_ROWS_PER_COMPRESSION);
+			const Size values_bytes = pad_to_multiple(64, UUID_LEN * capacity);
+			const Size new_values_bytes = pad_to_multiple(64, UUID_LEN * new_capacity);
+			const Size validity_bytes = sizeof(uint64) * (pad_to_multiple(64, capacity) / 64);
+			const Size new_validity_bytes =
+				sizeof(uint64) * (pad_to_multiple(64, new_capacity) / 64);
+
+			values = repalloc(values, new_values_bytes);
+			memset(&values[values_bytes], 0, new_values_bytes - values_bytes);
+			validity_bitmap = repalloc(validity_bitmap, new_validity_bytes);
+			memset(&((uint8 *) validity_bitmap)[validity_bytes],
+				   0,
+				   new_validity_bytes - validity_bytes);
+			capacity = new_capacity;
+		}
+
+		if (!res.is_null)
+		{
+			memcpy(&values[UUID_LEN * n_total], DatumGetUUIDP(res.val)->data, UUID_LEN);
+			arrow_set_row_validity(validity_bitmap, n_total, true);
+			n_notnull++;
+		}
+		n_total++;
+	}
+
+	ArrowArray *result =
+		MemoryContextAllocZero(dest_mctx, sizeof(ArrowArray) + (sizeof(void *) * 2));
+	const void **buffers = (const void **) &result[1];
+	buffers[0] = validity_bitmap;
+	buffers[1] = values;
+	result->n_buffers = 2;
+	result->buffers = buffers;
+	result->length = n_total;
+	result->null_count = n_total - n_notnull;
+	return result;
+}
+
+static DecompressionIterator *
+uuid_decompression_iterator_from_datum(Datum uuid_compressed, Oid element_type, bool forward)
+{
+	void *detoasted = PG_DETOAST_DATUM(uuid_compressed);
+	UuidCompressedParts parts = uuid_compressed_parts(detoasted);
+	UuidDecompressionIterator *iter = palloc(sizeof(*iter));
+
+	/*
+	 * The row-by-row decompression is not performance-critical, so we just
+	 * decode all the values at once.
+	 */
+	ArrowArray *arrow = uuid_decompress_parts(&parts, CurrentMemoryContext);
+
+	*iter = (UuidDecompressionIterator){
+		.base = {
+			.compression_algorithm = COMPRESSION_ALGORITHM_UUID,
+			.forward = forward,
+			.element_type = element_type,
+			.try_next = uuid_decompression_iterator_try_next,
+		},
+		.arrow = arrow,
+		.row = forward ? 0 : arrow->length - 1,
+	};
+
+	return &iter->base;
+}
+
+DecompressionIterator *
+uuid_decompression_iterator_from_datum_forward(Datum uuid_compressed, Oid element_type)
+{
+	return uuid_decompression_iterator_from_datum(uuid_compressed, element_type, true);
+}
+
+DecompressionIterator *
+uuid_decompression_iterator_from_datum_reverse(Datum uuid_compressed, Oid element_type)
+{
+	return uuid_decompression_iterator_from_datum(uuid_compressed, element_type, false);
+}
+
+DecompressResult
+uuid_decompression_iterator_try_next(DecompressionIterator *base_iter)
+{
+	Assert(base_iter->compression_algorithm == COMPRESSION_ALGORITHM_UUID);
+	UuidDecompressionIterator *iter = (UuidDecompressionIterator *) base_iter;
+	const ArrowArray *arrow = iter->arrow;
+
+	if (iter->row < 0 || iter->row >= arrow->length)
+		return (DecompressResult){ .is_done = true };
+
+	const int32 row = iter->row;
+	iter->row += iter->base.forward ? 1 : -1;
+
+	if (!arrow_row_is_valid(arrow->buffers[0], row))
+		return (DecompressResult){ .is_null = true };
+
+	/* The values live as long as the iterator, like for the array algorithm. */
+	const uint8 *values = (const uint8 *) arrow->buffers[1];
+	return (DecompressResult){ .val = PointerGetDatum(&values[UUID_LEN * row]) };
+}
+
+/*
+ * Send and receive functions. We send the decoded values, and the receiver
+ * compresses them anew.
+ */
+
+void
+uuid_compressed_send(CompressedDataHeader *header, StringInfo buffer)
+{
+	Assert(header->compression_algorithm == COMPRESSION_ALGORITHM_UUID);
+	UuidCompressedParts parts = uuid_compressed_parts(header);
+	ArrowArray *arrow = uuid_decompress_parts(&parts, CurrentMemoryContext);
+	const char *values = (const char *) arrow->buffers[1];
+
+	pq_sendbyte(buffer, parts.header->has_nulls);
+	pq_sendint32(buffer, arrow->length);
+	for (int row = 0; row < arrow->length; row++)
+	{
+		const bool isnull = !arrow_row_is_valid(arrow->buffers[0], row);
+		if (parts.header->has_nulls)
+			pq_sendbyte(buffer, isnull);
+
+		if (isnull)
+			continue;
+
+		pq_sendbytes(buffer, &values[UUID_LEN * row], UUID_LEN);
+	}
+}
+
+Datum
+uuid_compressed_recv(StringInfo buffer)
+{
+	const uint8 has_nulls = pq_getmsgbyte(buffer);
+	CheckCompressedData(has_nulls == 0 || has_nulls == 1);
+
+	const uint32 num_rows = pq_getmsgint32(buffer);
+	CheckCompressedData(num_rows <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	UuidCompressor *compressor = uuid_compressor_alloc();
+	for (uint32 row = 0; row < num_rows; row++)
+	{
+		if (has_nulls && pq_getmsgbyte(buffer) != 0)
+		{
+			uuid_compressor_append_null(compressor);
+			continue;
+		}
+
+		uuid_compressor_append_bytes(compressor, (const uint8 *) pq_getmsgbytes(buffer, UUID_LEN));
+	}
+
+	CheckCompressedData(has_nulls == compressor->has_nulls);
+	CheckCompressedData(compressor->all_v7);
+	void *compressed = uuid_compressor_finish(compressor);
+	CheckCompressedData(compressed != NULL);
+	PG_RETURN_POINTER(compressed);
+}
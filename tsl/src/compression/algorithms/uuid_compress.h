@@ -0,0 +1,65 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+/*
+ * The UUID algorithm compresses the version 7 UUIDs as defined by RFC 9562.
+ * These start with a 48-bit Unix timestamp in milliseconds, followed by the
+ * version and variant bits and 74 random bits. The timestamps of the rows
+ * inserted together are close to each other, so we store them with the
+ * delta-delta encoding, and bit-pack the random part. The version and variant
+ * bits are not stored, because they are the same for all the values.
+ *
+ * Other UUID versions don't have any structure we could use, so they are
+ * compressed with the dictionary algorithm as before. For the same reason,
+ * this algorithm is tried by the dictionary compressor, when the
+ * timescaledb.enable_uuid_compression is enabled.
+ *
+ * The UUIDs are decompressed into a fixed-width Arrow array of 16-byte
+ * values, regardless of the algorithm, so that they can be used by the
+ * vectorized filters and grouping.
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <lib/stringinfo.h>
+
+#include "compression/compression.h"
+
+typedef struct UuidCompressor UuidCompressor;
+typedef struct UuidCompressed UuidCompressed;
+typedef struct UuidDecompressionIterator UuidDecompressionIterator;
+
+extern bool uuid_compressed_has_nulls(const CompressedDataHeader *header);
+extern Compressor *uuid_compressor_for_type(Oid element_type);
+extern UuidCompressor *uuid_compressor_alloc(void);
+extern void uuid_compressor_append_null(UuidCompressor *compressor);
+extern void uuid_compressor_append(UuidCompressor *compressor, Datum val);
+extern void *uuid_compressor_finish(UuidCompressor *compressor);
+
+extern DecompressionIterator *uuid_decompression_iterator_from_datum_forward(Datum uuid_compressed,
+																			 Oid element_type);
+extern DecompressionIterator *uuid_decompression_iterator_from_datum_reverse(Datum uuid_compressed,
+																			 Oid element_type);
+extern DecompressResult uuid_decompression_iterator_try_next(DecompressionIterator *iter);
+
+extern ArrowArray *uuid_decompress_all(Datum compressed_data, Oid element_type,
+									   MemoryContext dest_mctx);
+extern ArrowArray *uuid_iterator_decompress_all(Datum compressed_data, Oid element_type,
+												MemoryContext dest_mctx);
+
+extern void uuid_compressed_send(CompressedDataHeader *header, StringInfo buffer);
+extern Datum uuid_compressed_recv(StringInfo buf);
+
+#define UUID_ALGORITHM_DEFINITION                                                                  \
+	{                                                                                              \
+		.iterator_init_forward = uuid_decompression_iterator_from_datum_forward,                   \
+		.iterator_init_reverse = uuid_decompression_iterator_from_datum_reverse,                   \
+		.decompress_all = uuid_decompress_all, .compressed_data_send = uuid_compressed_send,       \
+		.compressed_data_recv = uuid_compressed_recv,                                              \
+		.compressor_for_type = uuid_compressor_for_type,                                           \
+		.compressed_data_storage = TOAST_STORAGE_EXTERNAL,                                         \
+	}
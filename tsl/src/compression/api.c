@@ -50,6 +50,7 @@
 #include "hypercube.h"
 #include "hypertable.h"
 #include "hypertable_cache.h"
+#include "lock_wait_stats.h"
 #include "recompress.h"
 #include "scan_iterator.h"
 #include "scanner.h"
@@ -128,7 +129,7 @@ compression_chunk_size_catalog_insert(int32 src_chunk_id, const RelationSize *sr
 	table_close(rel, RowExclusiveLock);
 }
 
-static int
+int
 compression_chunk_size_catalog_update_merged(int32 chunk_id, const RelationSize *size,
 											 int32 merge_chunk_id, const RelationSize *merge_size,
 											 int64 merge_rowcnt_pre_compression,
@@ -406,7 +407,9 @@ compress_chunk_impl(Oid hypertable_relid, Oid chunk_relid)
 					get_rel_name(chunk_relid))));
 	LockRelationOid(cxt.srcht->main_table_relid, AccessShareLock);
 	LockRelationOid(cxt.compress_ht->main_table_relid, AccessShareLock);
-	LockRelationOid(cxt.srcht_chunk->table_id, ExclusiveLock);
+	ts_lock_wait_stats_lock_relation(LOCK_WAIT_STATS_COMPRESSION,
+									 cxt.srcht_chunk->table_id,
+									 ExclusiveLock);
 
 	/* acquire locks on catalog tables to keep till end of txn */
 	LockRelationOid(catalog_get_table_id(ts_catalog_get(), CHUNK), RowExclusiveLock);
@@ -567,6 +570,133 @@ compress_chunk_impl(Oid hypertable_relid, Oid chunk_relid)
 	return result_chunk_id;
 }
 
+/*
+ * Compress one slice of at most max_rows rows of a chunk.
+ *
+ * The first slice creates the compressed chunk, like compress_chunk_impl()
+ * does, and the chunk stays partial until the last slice has moved all rows
+ * out of the uncompressed chunk. Since every slice is compressed into new
+ * batches, batches of later slices can overlap with the batches of earlier
+ * slices, so the chunk is marked as unordered.
+ *
+ * Returns true if the chunk still has uncompressed rows.
+ */
+static bool
+compress_chunk_slice_impl(Oid hypertable_relid, Oid chunk_relid, int64 max_rows)
+{
+	CompressChunkCxt cxt = { 0 };
+	Chunk *chunk, *compress_ht_chunk;
+	Cache *hcache;
+	RelationSize before_size, after_size;
+	CompressionStats cstat;
+	bool has_more;
+	bool new_compressed_chunk;
+
+	hcache = ts_hypertable_cache_pin();
+	chunk = ts_chunk_get_by_relid(chunk_relid, true);
+
+	/* Only the first slice goes through the checks for uncompressed chunks */
+	if (!ts_chunk_is_compressed(chunk))
+		compresschunkcxt_init(&cxt, hcache, hypertable_relid, chunk_relid);
+	else
+	{
+		cxt.srcht = ts_hypertable_cache_get_entry(hcache, hypertable_relid, CACHE_FLAG_NONE);
+		ts_hypertable_permissions_check(cxt.srcht->main_table_relid, GetUserId());
+		cxt.compress_ht = ts_hypertable_get_by_id(cxt.srcht->fd.compressed_hypertable_id);
+		Ensure(cxt.compress_ht != NULL, "missing compress hypertable");
+		ts_hypertable_permissions_check(cxt.compress_ht->main_table_relid, GetUserId());
+		cxt.srcht_chunk = chunk;
+	}
+
+	LockRelationOid(cxt.srcht->main_table_relid, AccessShareLock);
+	LockRelationOid(cxt.compress_ht->main_table_relid, AccessShareLock);
+	ts_lock_wait_stats_lock_relation(LOCK_WAIT_STATS_COMPRESSION,
+									 cxt.srcht_chunk->table_id,
+									 ExclusiveLock);
+	LockRelationOid(catalog_get_table_id(ts_catalog_get(), CHUNK), RowExclusiveLock);
+
+	/* Re-read the chunk since another slice might have finished meanwhile */
+	chunk = ts_chunk_get_by_relid(chunk_relid, true);
+	new_compressed_chunk = !ts_chunk_is_compressed(chunk);
+
+	if (new_compressed_chunk)
+	{
+		ts_chunk_validate_chunk_status_for_operation(chunk, CHUNK_COMPRESS, true);
+
+		/* See compress_chunk_impl() for why a dummy parsetree is needed */
+		EventTriggerAlterTableStart(create_dummy_query());
+		compress_ht_chunk = create_compress_chunk(cxt.compress_ht, chunk, InvalidOid);
+		ts_chunk_set_compressed_chunk(chunk, compress_ht_chunk->fd.id);
+		EventTriggerAlterTableEnd();
+
+		if (cxt.srcht->range_space)
+			ts_chunk_column_stats_calculate(cxt.srcht, chunk);
+	}
+	else
+	{
+		if (!ts_chunk_is_partial(chunk))
+		{
+			ts_cache_release(hcache);
+			return false;
+		}
+		compress_ht_chunk = ts_chunk_get_by_id(chunk->fd.compressed_chunk_id, true);
+	}
+
+	/*
+	 * Freezing the compressed tuples is only possible when the compressed
+	 * chunk was created in this transaction, see compress_chunk_impl().
+	 */
+	before_size = ts_relation_size_impl(chunk->table_id);
+	cstat = compress_chunk_slice(chunk->table_id,
+								 compress_ht_chunk->table_id,
+								 max_rows,
+								 new_compressed_chunk ? HEAP_INSERT_FROZEN : 0,
+								 &has_more);
+	after_size = ts_relation_size_impl(compress_ht_chunk->table_id);
+
+	if (new_compressed_chunk)
+	{
+		compression_chunk_size_catalog_insert(chunk->fd.id,
+											  &before_size,
+											  compress_ht_chunk->fd.id,
+											  &after_size,
+											  cstat.rowcnt_pre_compression,
+											  cstat.rowcnt_post_compression,
+											  cstat.rowcnt_frozen);
+		ts_chunk_constraints_create(cxt.compress_ht, compress_ht_chunk);
+		ts_trigger_create_all_on_chunk(compress_ht_chunk);
+
+		if (has_more)
+			ts_chunk_set_partial(chunk);
+	}
+	else
+	{
+		/* The uncompressed size was accounted for by the first slice */
+		RelationSize no_size = { 0 };
+
+		compression_chunk_size_catalog_update_merged(chunk->fd.id,
+													 &no_size,
+													 compress_ht_chunk->fd.id,
+													 &after_size,
+													 cstat.rowcnt_pre_compression,
+													 cstat.rowcnt_post_compression);
+		if (cstat.rowcnt_post_compression > 0)
+			ts_chunk_set_unordered(chunk);
+
+		if (!has_more && ts_chunk_clear_status(chunk, CHUNK_STATUS_COMPRESSED_PARTIAL))
+			ereport(DEBUG1,
+					(errmsg("finished compressing chunk \"%s.%s\" in slices",
+							NameStr(chunk->fd.schema_name),
+							NameStr(chunk->fd.table_name))));
+	}
+
+	/* changed chunk status, so invalidate any plans involving this chunk */
+	CacheInvalidateRelcacheByRelid(chunk->table_id);
+
+	ts_cache_release(hcache);
+	return has_more;
+}
+
 static void
 decompress_chunk_impl(Chunk *uncompressed_chunk, bool if_compressed)
 {
@@ -630,8 +760,12 @@ decompress_chunk_impl(Chunk *uncompressed_chunk, bool if_compressed)
 	 *       chunk. See the comments in function about the concurrency of
 	 *       operations.
 	 */
-	LockRelationOid(uncompressed_chunk->table_id, ExclusiveLock);
-	LockRelationOid(compressed_chunk->table_id, ExclusiveLock);
+	ts_lock_wait_stats_lock_relation(LOCK_WAIT_STATS_COMPRESSION,
+									 uncompressed_chunk->table_id,
+									 ExclusiveLock);
+	ts_lock_wait_stats_lock_relation(LOCK_WAIT_STATS_COMPRESSION,
+									 compressed_chunk->table_id,
+									 ExclusiveLock);
 
 	/* acquire locks on catalog tables to keep till end of txn */
 	LockRelationOid(catalog_get_table_id(ts_catalog_get(), CHUNK), RowExclusiveLock);
@@ -670,8 +804,12 @@ decompress_chunk_impl(Chunk *uncompressed_chunk, bool if_compressed)
 	 * also requests an AccessExclusiveLock on the compressed_chunk. However,
 	 * this call makes the lock on the chunk explicit.
 	 */
-	LockRelationOid(uncompressed_chunk->table_id, AccessExclusiveLock);
-	LockRelationOid(compressed_chunk->table_id, AccessExclusiveLock);
+	ts_lock_wait_stats_lock_relation(LOCK_WAIT_STATS_COMPRESSION,
+									 uncompressed_chunk->table_id,
+									 AccessExclusiveLock);
+	ts_lock_wait_stats_lock_relation(LOCK_WAIT_STATS_COMPRESSION,
+									 compressed_chunk->table_id,
+									 AccessExclusiveLock);
 	ts_chunk_drop(compressed_chunk, DROP_RESTRICT, -1);
 	ts_cache_release(hcache);
 	write_logical_replication_msg_decompression_end();
@@ -715,7 +853,9 @@ tsl_create_compressed_chunk(PG_FUNCTION_ARGS)
 	/* Acquire locks on src and compress hypertable and src chunk */
 	LockRelationOid(cxt.srcht->main_table_relid, AccessShareLock);
 	LockRelationOid(cxt.compress_ht->main_table_relid, AccessShareLock);
-	LockRelationOid(cxt.srcht_chunk->table_id, ShareLock);
+	ts_lock_wait_stats_lock_relation(LOCK_WAIT_STATS_COMPRESSION,
+									 cxt.srcht_chunk->table_id,
+									 ShareLock);
 
 	/* Acquire locks on catalog tables to keep till end of txn */
 	LockRelationOid(catalog_get_table_id(ts_catalog_get(), CHUNK), RowExclusiveLock);
@@ -952,8 +1092,11 @@ tsl_compress_chunk_wrapper(Chunk *chunk, bool if_not_compressed, bool recompress
 			return uncompressed_chunk_id;
 		}
 
-		if (ts_guc_enable_segmentwise_recompression && valid_orderby_settings &&
-			ts_chunk_is_partial(chunk) && get_compressed_chunk_index_for_recompression(chunk))
+		/* A hypercore only merges its non-compressed rows into new batches, so
+		 * it needs neither orderby nor the index for recompression */
+		if (ts_guc_enable_segmentwise_recompression && ts_chunk_is_partial(chunk) &&
+			(ts_is_hypercore_am(chunk->amoid) ||
+			 (valid_orderby_settings && get_compressed_chunk_index_for_recompression(chunk))))
 		{
 			uncompressed_chunk_id = recompress_chunk_segmentwise_impl(chunk);
 		}
@@ -983,6 +1126,44 @@ tsl_compress_chunk_wrapper(Chunk *chunk, bool if_not_compressed, bool recompress
 	return uncompressed_chunk_id;
 }
 
+/*
+ * Compress at most slice_rows rows of a chunk and return whether the chunk
+ * has rows left to compress.
+ *
+ * Called in a loop by compress_chunk_incremental(), which commits after every
+ * slice, so that compressing a large chunk does not need the space for a
+ * second copy of the whole chunk.
+ */
+Datum
+tsl_compress_chunk_slice(PG_FUNCTION_ARGS)
+{
+	Oid chunk_relid = PG_GETARG_OID(0);
+	int64 slice_rows = PG_GETARG_INT64(1);
+	bool has_more;
+
+	ts_feature_flag_check(FEATURE_HYPERTABLE_COMPRESSION);
+	TS_PREVENT_FUNC_IF_READ_ONLY();
+
+	if (slice_rows <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("slice_rows must be greater than zero")));
+
+	Chunk *chunk = ts_chunk_get_by_relid(chunk_relid, true);
+
+	if (ts_is_hypercore_am(chunk->amoid))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot compress hypercore chunk \"%s\" in slices",
+						get_rel_name(chunk_relid))));
+
+	write_logical_replication_msg_compression_start();
+	has_more = compress_chunk_slice_impl(chunk->hypertable_relid, chunk_relid, slice_rows);
+	write_logical_replication_msg_compression_end();
+
+	PG_RETURN_BOOL(has_more);
+}
+
 Datum
 tsl_decompress_chunk(PG_FUNCTION_ARGS)
 {
@@ -13,6 +13,7 @@
 
 extern Datum tsl_create_compressed_chunk(PG_FUNCTION_ARGS);
 extern Datum tsl_compress_chunk(PG_FUNCTION_ARGS);
+extern Datum tsl_compress_chunk_slice(PG_FUNCTION_ARGS);
 extern Datum tsl_decompress_chunk(PG_FUNCTION_ARGS);
 extern Oid tsl_compress_chunk_wrapper(Chunk *chunk, bool if_not_compressed, bool recompress);
 
@@ -25,3 +26,8 @@ extern void compression_chunk_size_catalog_insert(int32 src_chunk_id, const Rela
 												  int64 rowcnt_pre_compression,
 												  int64 rowcnt_post_compression,
 												  int64 rowcnt_frozen);
+extern int compression_chunk_size_catalog_update_merged(int32 chunk_id, const RelationSize *size,
+														int32 merge_chunk_id,
+														const RelationSize *merge_size,
+														int64 merge_rowcnt_pre_compression,
+														int64 merge_rowcnt_post_compression);
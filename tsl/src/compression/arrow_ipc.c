@@ -0,0 +1,1184 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Export of hypertables and chunks in the Arrow IPC streaming format.
+ *
+ * The export returns the messages of an Arrow IPC stream: the schema, the
+ * record batches and the end-of-stream marker. Their concatenation is the
+ * stream, which the Arrow libraries read directly, without parsing the text
+ * output of the values. COPY TO has no extensible output formats, so this is
+ * a set-returning function.
+ *
+ * The compressed batches are decompressed with the bulk decompression into
+ * arrow arrays, and their buffers are copied to the record batches. The
+ * uncompressed rows are converted in blocks. The integer, float, boolean,
+ * date, timestamp and text columns are exported as the matching Arrow types,
+ * the other columns as their text output.
+ *
+ * The message metadata are flatbuffers, which are written here directly
+ * since the schema of the few tables that are needed is simple. See the
+ * Message.fbs and Schema.fbs files of the Arrow format specification.
+ *
+ * The flatbuffers and the buffers of the record batches are written in the
+ * host byte order, and the schema declares the stream as little-endian, so
+ * the export is not supported on big-endian platforms.
+ */
+#include <postgres.h>
+#include <access/detoast.h>
+#include <access/tableam.h>
+#include <catalog/pg_inherits.h>
+#include <catalog/pg_type.h>
+#include <common/int.h>
+#include <funcapi.h>
+#include <miscadmin.h>
+#include <utils/acl.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+#include <utils/date.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+#include <utils/timestamp.h>
+
+#include "arrow_c_data_interface.h"
+#include "arrow_ipc.h"
+#include "chunk.h"
+#include "compression.h"
+#include "create.h"
+#include "hypercore/arrow_array.h"
+#include "hypertable.h"
+#include "time_utils.h"
+#include "ts_catalog/array_utils.h"
+#include "ts_catalog/compression_settings.h"
+#include "utils.h"
+
+/* The target number of rows of a record batch */
+#define ARROW_IPC_RECORD_BATCH_ROWS 65536
+
+/* Values of the enums and unions of the Arrow flatbuffers schema */
+#define ARROW_METADATA_VERSION_V5 4
+#define ARROW_MESSAGE_HEADER_SCHEMA 1
+#define ARROW_MESSAGE_HEADER_RECORD_BATCH 3
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_FLOATING_POINT 3
+#define ARROW_TYPE_UTF8 5
+#define ARROW_TYPE_BOOL 6
+#define ARROW_TYPE_DATE 8
+#define ARROW_TYPE_TIMESTAMP 10
+#define ARROW_PRECISION_SINGLE 1
+#define ARROW_PRECISION_DOUBLE 2
+#define ARROW_DATE_UNIT_DAY 0
+#define ARROW_TIME_UNIT_MICROSECOND 2
+
+#define ARROW_IPC_CONTINUATION 0xFFFFFFFF
+
+typedef enum ArrowIpcType
+{
+	ARROW_IPC_INT,
+	ARROW_IPC_FLOAT,
+	ARROW_IPC_BOOL,
+	ARROW_IPC_DATE,
+	ARROW_IPC_TIMESTAMP,
+	ARROW_IPC_UTF8,
+} ArrowIpcType;
+
+typedef struct ArrowIpcColumn
+{
+	NameData name;
+	Oid typid;
+	int16 typlen;
+	ArrowIpcType type;
+	/* The width of the values of the fixed-width types, in bytes */
+	int width;
+	/* The column is exported as its text output */
+	bool use_output;
+	FmgrInfo output;
+
+	/* The attribute numbers of the column in the relation that is scanned */
+	AttrNumber attno;
+	bool segmentby;
+
+	/* The buffers of the current record batch */
+	StringInfoData validity;
+	StringInfoData values;
+	StringInfoData offsets;
+	int64 null_count;
+} ArrowIpcColumn;
+
+/* A relation to scan, either a compressed chunk or a table with rows */
+typedef struct ArrowIpcSource
+{
+	Oid relid;
+	bool compressed;
+	/* The relation that the column names refer to, for the segmentby columns */
+	Oid chunk_relid;
+} ArrowIpcSource;
+
+typedef struct ArrowIpcState
+{
+	int ncolumns;
+	ArrowIpcColumn *columns;
+	List *sources;
+	int next_source;
+
+	/* The scan of the current source */
+	Relation rel;
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+	bool compressed;
+	AttrNumber count_attno;
+
+	/* The number of rows in the current record batch */
+	int64 rows;
+	bool schema_sent;
+	bool done;
+
+	/* The scans live across the calls, the converted values only for one */
+	MemoryContext scan_ctx;
+	MemoryContext message_ctx;
+	MemoryContext decompress_ctx;
+	MemoryContext tmp_ctx;
+} ArrowIpcState;
+
+/*
+ * Flatbuffers writing.
+ *
+ * The buffer is written front to back. A table is written as its vtable,
+ * followed by the table, followed by the objects that the table refers to,
+ * so all offsets point forward as the format requires. The offsets are
+ * patched when the objects they refer to are written.
+ */
+static void
+fb_align(StringInfo buf, int alignment)
+{
+	while (buf->len % alignment != 0)
+		appendStringInfoChar(buf, '\0');
+}
+
+static void
+fb_patch_offset(StringInfo buf, int pos, int target)
+{
+	const uint32 offset = target - pos;
+
+	Assert(target > pos);
+	memcpy(&buf->data[pos], &offset, sizeof(offset));
+}
+
+/*
+ * Write a table with the fields of the given byte sizes and values, where
+ * the size of an absent field is zero. An offset field has size 4 and is
+ * patched later, so the positions of the fields are returned.
+ */
+static int
+fb_table(StringInfo buf, int nfields, const int *sizes, const int64 *values, int *positions)
+{
+	uint16 vtable[2 + 8];
+
+	Assert(nfields <= 8);
+
+	fb_align(buf, sizeof(uint16));
+	const int vtable_pos = buf->len;
+	appendBinaryStringInfo(buf, (char *) vtable, sizeof(uint16) * (2 + nfields));
+
+	fb_align(buf, sizeof(int64));
+	const int table_pos = buf->len;
+	const int32 vtable_offset = table_pos - vtable_pos;
+	appendBinaryStringInfo(buf, (char *) &vtable_offset, sizeof(vtable_offset));
+
+	vtable[0] = sizeof(uint16) * (2 + nfields);
+	for (int i = 0; i < nfields; i++)
+	{
+		vtable[2 + i] = 0;
+		if (sizes[i] == 0)
+			continue;
+
+		/* The values are little-endian, so the first bytes are the low ones */
+		fb_align(buf, sizes[i]);
+		vtable[2 + i] = buf->len - table_pos;
+		if (positions != NULL)
+			positions[i] = buf->len;
+		appendBinaryStringInfo(buf, (char *) &values[i], sizes[i]);
+	}
+	vtable[1] = buf->len - table_pos;
+	memcpy(&buf->data[vtable_pos], vtable, sizeof(uint16) * (2 + nfields));
+
+	return table_pos;
+}
+
+static int
+fb_string(StringInfo buf, const char *str)
+{
+	const uint32 len = strlen(str);
+
+	fb_align(buf, sizeof(uint32));
+	const int pos = buf->len;
+	appendBinaryStringInfo(buf, (char *) &len, sizeof(len));
+	appendBinaryStringInfo(buf, str, len + 1);
+
+	return pos;
+}
+
+/* Write a vector of offsets, the element i is at the returned position + 4 * (i + 1) */
+static int
+fb_offset_vector(StringInfo buf, int nelements)
+{
+	const uint32 len = nelements;
+
+	fb_align(buf, sizeof(uint32));
+	const int pos = buf->len;
+	appendBinaryStringInfo(buf, (char *) &len, sizeof(len));
+	for (int i = 0; i < nelements; i++)
+		appendBinaryStringInfo(buf, (char *) &len, sizeof(uint32));
+
+	return pos;
+}
+
+/* Write a vector of structs of two int64 values, which are aligned to 8 bytes */
+static int
+fb_int64_pair_vector(StringInfo buf, int nelements, const int64 *values)
+{
+	const uint32 len = nelements;
+
+	fb_align(buf, sizeof(uint32));
+	if ((buf->len + sizeof(uint32)) % sizeof(int64) != 0)
+		appendBinaryStringInfo(buf, "\0\0\0\0", sizeof(uint32));
+	const int pos = buf->len;
+	appendBinaryStringInfo(buf, (char *) &len, sizeof(len));
+	appendBinaryStringInfo(buf, (char *) values, sizeof(int64) * 2 * nelements);
+
+	return pos;
+}
+
+/*
+ * Write the Message table with the header of the given type. Returns the
+ * position of the header offset, to be patched with the header.
+ */
+static int
+fb_message(StringInfo buf, uint8 header_type, int64 body_length)
+{
+	const int sizes[] = { 2, 1, 4, 8 };
+	const int64 values[] = { ARROW_METADATA_VERSION_V5, header_type, 0, body_length };
+	int positions[lengthof(sizes)];
+
+	/* The root offset */
+	appendBinaryStringInfo(buf, "\0\0\0\0", sizeof(uint32));
+	fb_patch_offset(buf, 0, fb_table(buf, lengthof(sizes), sizes, values, positions));
+
+	return positions[2];
+}
+
+static int
+fb_field_type(StringInfo buf, const ArrowIpcColumn *column)
+{
+	switch (column->type)
+	{
+		case ARROW_IPC_INT:
+		{
+			const int sizes[] = { 4, 1 };
+			const int64 values[] = { column->width * 8, true };
+			return fb_table(buf, lengthof(sizes), sizes, values, NULL);
+		}
+		case ARROW_IPC_FLOAT:
+		{
+			const int sizes[] = { 2 };
+			const int64 values[] = { column->width == 4 ? ARROW_PRECISION_SINGLE :
+														  ARROW_PRECISION_DOUBLE };
+			return fb_table(buf, lengthof(sizes), sizes, values, NULL);
+		}
+		case ARROW_IPC_DATE:
+		{
+			const int sizes[] = { 2 };
+			const int64 values[] = { ARROW_DATE_UNIT_DAY };
+			return fb_table(buf, lengthof(sizes), sizes, values, NULL);
+		}
+		case ARROW_IPC_TIMESTAMP:
+		{
+			const bool with_timezone = column->typid == TIMESTAMPTZOID;
+			const int sizes[] = { 2, with_timezone ? 4 : 0 };
+			const int64 values[] = { ARROW_TIME_UNIT_MICROSECOND, 0 };
+			int positions[lengthof(sizes)];
+			const int pos = fb_table(buf, lengthof(sizes), sizes, values, positions);
+
+			if (with_timezone)
+				fb_patch_offset(buf, positions[1], fb_string(buf, "UTC"));
+			return pos;
+		}
+		case ARROW_IPC_BOOL:
+		case ARROW_IPC_UTF8:
+			return fb_table(buf, 0, NULL, NULL, NULL);
+	}
+
+	pg_unreachable();
+}
+
+static uint8
+arrow_type_id(ArrowIpcType type)
+{
+	switch (type)
+	{
+		case ARROW_IPC_INT:
+			return ARROW_TYPE_INT;
+		case ARROW_IPC_FLOAT:
+			return ARROW_TYPE_FLOATING_POINT;
+		case ARROW_IPC_BOOL:
+			return ARROW_TYPE_BOOL;
+		case ARROW_IPC_DATE:
+			return ARROW_TYPE_DATE;
+		case ARROW_IPC_TIMESTAMP:
+			return ARROW_TYPE_TIMESTAMP;
+		case ARROW_IPC_UTF8:
+			return ARROW_TYPE_UTF8;
+	}
+
+	pg_unreachable();
+}
+
+/*
+ * Frame the message metadata and the body as an encapsulated message. The
+ * metadata is padded so that the body is aligned to 8 bytes.
+ */
+static bytea *
+arrow_ipc_message(StringInfo metadata, StringInfo body)
+{
+	const uint32 continuation = ARROW_IPC_CONTINUATION;
+	StringInfoData result;
+
+	fb_align(metadata, sizeof(int64));
+	const int32 metadata_len = metadata->len;
+
+	initStringInfo(&result);
+	appendStringInfoSpaces(&result, VARHDRSZ);
+	appendBinaryStringInfo(&result, (char *) &continuation, sizeof(continuation));
+	appendBinaryStringInfo(&result, (char *) &metadata_len, sizeof(metadata_len));
+	appendBinaryStringInfo(&result, metadata->data, metadata->len);
+	if (body != NULL)
+		appendBinaryStringInfo(&result, body->data, body->len);
+	SET_VARSIZE(result.data, result.len);
+
+	return (bytea *) result.data;
+}
+
+static bytea *
+arrow_ipc_schema_message(const ArrowIpcState *state)
+{
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	const int header_pos = fb_message(&buf, ARROW_MESSAGE_HEADER_SCHEMA, 0);
+
+	/* Schema: endianness, fields */
+	const int schema_sizes[] = { 2, 4 };
+	const int64 schema_values[] = { 0, 0 };
+	int schema_positions[lengthof(schema_sizes)];
+	fb_patch_offset(&buf,
+					header_pos,
+					fb_table(&buf,
+							 lengthof(schema_sizes),
+							 schema_sizes,
+							 schema_values,
+							 schema_positions));
+
+	const int fields_pos = fb_offset_vector(&buf, state->ncolumns);
+	fb_patch_offset(&buf, schema_positions[1], fields_pos);
+
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		const ArrowIpcColumn *column = &state->columns[i];
+
+		/* Field: name, nullable, type_type, type, dictionary, children */
+		const int field_sizes[] = { 4, 1, 1, 4, 0, 4 };
+		const int64 field_values[] = { 0, true, arrow_type_id(column->type), 0, 0, 0 };
+		int field_positions[lengthof(field_sizes)];
+		const int field_pos = fb_table(&buf,
+									   lengthof(field_sizes),
+									   field_sizes,
+									   field_values,
+									   field_positions);
+
+		fb_patch_offset(&buf, fields_pos + sizeof(uint32) * (i + 1), field_pos);
+		fb_patch_offset(&buf, field_positions[0], fb_string(&buf, NameStr(column->name)));
+		fb_patch_offset(&buf, field_positions[3], fb_field_type(&buf, column));
+		fb_patch_offset(&buf, field_positions[5], fb_offset_vector(&buf, 0));
+	}
+
+	return arrow_ipc_message(&buf, NULL);
+}
+
+static void
+arrow_ipc_add_buffer(StringInfo body, int64 *buffers, int index, const StringInfo data)
+{
+	buffers[2 * index] = body->len;
+	buffers[2 * index + 1] = data->len;
+	appendBinaryStringInfo(body, data->data, data->len);
+	fb_align(body, sizeof(int64));
+}
+
+static int
+arrow_ipc_num_buffers(const ArrowIpcColumn *column)
+{
+	return column->type == ARROW_IPC_UTF8 ? 3 : 2;
+}
+
+static bytea *
+arrow_ipc_record_batch_message(ArrowIpcState *state)
+{
+	StringInfoData body;
+	StringInfoData buf;
+	StringInfoData empty;
+	int nbuffers = 0;
+
+	for (int i = 0; i < state->ncolumns; i++)
+		nbuffers += arrow_ipc_num_buffers(&state->columns[i]);
+
+	int64 *nodes = palloc(sizeof(int64) * 2 * state->ncolumns);
+	int64 *buffers = palloc(sizeof(int64) * 2 * nbuffers);
+
+	initStringInfo(&body);
+	initStringInfo(&empty);
+
+	nbuffers = 0;
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		ArrowIpcColumn *column = &state->columns[i];
+
+		nodes[2 * i] = state->rows;
+		nodes[2 * i + 1] = column->null_count;
+
+		/* The validity bitmap can be omitted if there are no nulls */
+		arrow_ipc_add_buffer(&body,
+							 buffers,
+							 nbuffers++,
+							 column->null_count > 0 ? &column->validity : &empty);
+		if (column->type == ARROW_IPC_UTF8)
+		{
+			arrow_ipc_add_buffer(&body, buffers, nbuffers++, &column->offsets);
+			arrow_ipc_add_buffer(&body, buffers, nbuffers++, &column->values);
+		}
+		else
+			arrow_ipc_add_buffer(&body, buffers, nbuffers++, &column->values);
+	}
+
+	initStringInfo(&buf);
+	const int header_pos = fb_message(&buf, ARROW_MESSAGE_HEADER_RECORD_BATCH, body.len);
+
+	/* RecordBatch: length, nodes, buffers */
+	const int sizes[] = { 8, 4, 4 };
+	const int64 values[] = { state->rows, 0, 0 };
+	int positions[lengthof(sizes)];
+	fb_patch_offset(&buf, header_pos, fb_table(&buf, lengthof(sizes), sizes, values, positions));
+	fb_patch_offset(&buf, positions[1], fb_int64_pair_vector(&buf, state->ncolumns, nodes));
+	fb_patch_offset(&buf, positions[2], fb_int64_pair_vector(&buf, nbuffers, buffers));
+
+	return arrow_ipc_message(&buf, &body);
+}
+
+static bytea *
+arrow_ipc_end_of_stream_message(void)
+{
+	const uint32 eos[] = { ARROW_IPC_CONTINUATION, 0 };
+	bytea *result = palloc(VARHDRSZ + sizeof(eos));
+
+	SET_VARSIZE(result, VARHDRSZ + sizeof(eos));
+	memcpy(VARDATA(result), eos, sizeof(eos));
+
+	return result;
+}
+
+/*
+ * Building the columns of a record batch.
+ */
+static void
+bitmap_append(StringInfo bitmap, int64 row, bool value)
+{
+	if (row % 8 == 0)
+		appendStringInfoChar(bitmap, '\0');
+	if (value)
+		bitmap->data[row / 8] |= 1 << (row % 8);
+}
+
+static void
+column_reset(ArrowIpcColumn *column)
+{
+	resetStringInfo(&column->validity);
+	resetStringInfo(&column->values);
+	resetStringInfo(&column->offsets);
+	column->null_count = 0;
+
+	if (column->type == ARROW_IPC_UTF8)
+	{
+		const int32 offset = 0;
+		appendBinaryStringInfo(&column->offsets, (char *) &offset, sizeof(offset));
+	}
+}
+
+static void
+column_append_utf8(ArrowIpcColumn *column, const char *data, int len)
+{
+	appendBinaryStringInfo(&column->values, data, len);
+	if (column->values.len > PG_INT32_MAX / 2)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("text data of column \"%s\" is too large for a record batch",
+						NameStr(column->name))));
+
+	const int32 offset = column->values.len;
+	appendBinaryStringInfo(&column->offsets, (char *) &offset, sizeof(offset));
+}
+
+static void
+column_append_null(ArrowIpcColumn *column, int64 row)
+{
+	bitmap_append(&column->validity, row, false);
+	column->null_count++;
+
+	switch (column->type)
+	{
+		case ARROW_IPC_BOOL:
+			bitmap_append(&column->values, row, false);
+			break;
+		case ARROW_IPC_UTF8:
+			column_append_utf8(column, NULL, 0);
+			break;
+		default:
+			appendStringInfoSpaces(&column->values, column->width);
+			break;
+	}
+}
+
+/* Convert the times from the Postgres epoch to the Unix epoch of Arrow */
+static int64
+timestamp_to_unix(int64 value)
+{
+	int64 result;
+
+	if (TIMESTAMP_NOT_FINITE(value))
+		return value;
+	if (pg_add_s64_overflow(value, TS_EPOCH_DIFF_MICROSECONDS, &result))
+		return PG_INT64_MAX;
+	return result;
+}
+
+static int32
+date_to_unix(int32 value)
+{
+	if (DATE_NOT_FINITE(value))
+		return value;
+	return value + TS_EPOCH_DIFF;
+}
+
+static void
+column_append_value(ArrowIpcColumn *column, int64 row, Datum value)
+{
+	bitmap_append(&column->validity, row, true);
+
+	if (column->use_output)
+	{
+		char *str = OutputFunctionCall(&column->output, value);
+		column_append_utf8(column, str, strlen(str));
+		pfree(str);
+		return;
+	}
+
+	switch (column->typid)
+	{
+		case BOOLOID:
+			bitmap_append(&column->values, row, DatumGetBool(value));
+			break;
+		case INT2OID:
+		{
+			const int16 v = DatumGetInt16(value);
+			appendBinaryStringInfo(&column->values, (char *) &v, sizeof(v));
+			break;
+		}
+		case INT4OID:
+		{
+			const int32 v = DatumGetInt32(value);
+			appendBinaryStringInfo(&column->values, (char *) &v, sizeof(v));
+			break;
+		}
+		case INT8OID:
+		{
+			const int64 v = DatumGetInt64(value);
+			appendBinaryStringInfo(&column->values, (char *) &v, sizeof(v));
+			break;
+		}
+		case FLOAT4OID:
+		{
+			const float4 v = DatumGetFloat4(value);
+			appendBinaryStringInfo(&column->values, (char *) &v, sizeof(v));
+			break;
+		}
+		case FLOAT8OID:
+		{
+			const float8 v = DatumGetFloat8(value);
+			appendBinaryStringInfo(&column->values, (char *) &v, sizeof(v));
+			break;
+		}
+		case DATEOID:
+		{
+			const int32 v = date_to_unix(DatumGetDateADT(value));
+			appendBinaryStringInfo(&column->values, (char *) &v, sizeof(v));
+			break;
+		}
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		{
+			const int64 v = timestamp_to_unix(DatumGetTimestamp(value));
+			appendBinaryStringInfo(&column->values, (char *) &v, sizeof(v));
+			break;
+		}
+		case TEXTOID:
+		{
+			text *t = DatumGetTextPP(value);
+			column_append_utf8(column, VARDATA_ANY(t), VARSIZE_ANY_EXHDR(t));
+			break;
+		}
+		default:
+			elog(ERROR,
+				 "unexpected type %u of column \"%s\"",
+				 column->typid,
+				 NameStr(column->name));
+	}
+}
+
+/*
+ * Append the rows of a decompressed batch. The buffers of the fixed-width
+ * and text columns are copied, the other columns are converted value by
+ * value.
+ */
+static void
+column_append_arrow(ArrowIpcColumn *column, int64 first_row, const ArrowArray *arrow,
+					bool raw_text)
+{
+	const uint64 *validity = arrow->buffers[0];
+	const int64 nrows = arrow->length;
+
+	if (column->use_output || column->type == ARROW_IPC_BOOL)
+	{
+		for (int64 i = 0; i < nrows; i++)
+		{
+			NullableDatum d = arrow_get_datum(arrow, column->typid, column->typlen, i);
+
+			if (d.isnull)
+				column_append_null(column, first_row + i);
+			else
+				column_append_value(column, first_row + i, d.value);
+		}
+		return;
+	}
+
+	for (int64 i = 0; i < nrows; i++)
+	{
+		const bool valid = arrow_row_is_valid(validity, i);
+
+		bitmap_append(&column->validity, first_row + i, valid);
+		if (!valid)
+			column->null_count++;
+	}
+
+	if (column->type == ARROW_IPC_UTF8)
+	{
+		const ArrowArray *values = arrow->dictionary != NULL ? arrow->dictionary : arrow;
+		const int16 *indexes = arrow->dictionary != NULL ? arrow->buffers[1] : NULL;
+		const uint32 *offsets = values->buffers[1];
+		const char *data = values->buffers[2];
+
+		for (int64 i = 0; i < nrows; i++)
+		{
+			const int64 index = indexes != NULL ? indexes[i] : i;
+
+			if (!arrow_row_is_valid(validity, i))
+			{
+				column_append_utf8(column, NULL, 0);
+			}
+			else if (raw_text)
+			{
+				column_append_utf8(column,
+								   &data[offsets[index]],
+								   offsets[index + 1] - offsets[index]);
+			}
+			else
+			{
+				/* The values that are not bulk decompressed have a header */
+				const char *value = &data[offsets[index]];
+				column_append_utf8(column, VARDATA_ANY(value), VARSIZE_ANY_EXHDR(value));
+			}
+		}
+		return;
+	}
+
+	/* The fixed-width types have the same layout as in Arrow */
+	Ensure(arrow->dictionary == NULL, "unexpected dictionary for fixed-width type");
+	const int start = column->values.len;
+	appendBinaryStringInfo(&column->values, arrow->buffers[1], nrows * column->width);
+
+	if (column->type == ARROW_IPC_TIMESTAMP)
+	{
+		int64 *values = (int64 *) &column->values.data[start];
+		for (int64 i = 0; i < nrows; i++)
+		{
+			if (arrow_row_is_valid(validity, i))
+				values[i] = timestamp_to_unix(values[i]);
+		}
+	}
+	else if (column->type == ARROW_IPC_DATE)
+	{
+		int32 *values = (int32 *) &column->values.data[start];
+		for (int64 i = 0; i < nrows; i++)
+		{
+			if (arrow_row_is_valid(validity, i))
+				values[i] = date_to_unix(values[i]);
+		}
+	}
+}
+
+/*
+ * Append the rows of the compressed batch in the slot.
+ */
+static void
+arrow_ipc_append_compressed_batch(ArrowIpcState *state, TupleTableSlot *slot)
+{
+	bool isnull;
+	const int32 count = DatumGetInt32(slot_getattr(slot, state->count_attno, &isnull));
+
+	Ensure(!isnull, "missing row count of compressed batch");
+
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		ArrowIpcColumn *column = &state->columns[i];
+		Datum value = (Datum) 0;
+
+		isnull = true;
+		if (column->attno != InvalidAttrNumber)
+			value = slot_getattr(slot, column->attno, &isnull);
+
+		if (column->segmentby || isnull)
+		{
+			for (int32 row = 0; row < count; row++)
+			{
+				if (isnull)
+					column_append_null(column, state->rows + row);
+				else
+					column_append_value(column, state->rows + row, value);
+			}
+			continue;
+		}
+
+		MemoryContext oldcontext = MemoryContextSwitchTo(state->decompress_ctx);
+		const CompressedDataHeader *header = (CompressedDataHeader *) PG_DETOAST_DATUM(value);
+		const bool raw_text =
+			tsl_get_decompress_all_function(header->compression_algorithm, column->typid) != NULL;
+		ArrowArray *arrow = arrow_from_compressed(PointerGetDatum(header),
+												  column->typid,
+												  state->decompress_ctx,
+												  state->tmp_ctx);
+		MemoryContextSwitchTo(oldcontext);
+
+		/* The batches of the NULL algorithm have only null values */
+		if (arrow == NULL)
+		{
+			for (int32 row = 0; row < count; row++)
+				column_append_null(column, state->rows + row);
+		}
+		else
+		{
+			Ensure(arrow->length == count, "unexpected length of the decompressed batch");
+			column_append_arrow(column, state->rows, arrow, raw_text);
+		}
+
+		MemoryContextReset(state->decompress_ctx);
+	}
+
+	state->rows += count;
+}
+
+static void
+arrow_ipc_append_row(ArrowIpcState *state, TupleTableSlot *slot)
+{
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		ArrowIpcColumn *column = &state->columns[i];
+		bool isnull = true;
+		Datum value = (Datum) 0;
+
+		if (column->attno != InvalidAttrNumber)
+			value = slot_getattr(slot, column->attno, &isnull);
+
+		if (isnull)
+			column_append_null(column, state->rows);
+		else
+			column_append_value(column, state->rows, value);
+	}
+
+	state->rows++;
+}
+
+/*
+ * Scanning the sources.
+ */
+static void
+arrow_ipc_close_source(ArrowIpcState *state)
+{
+	if (state->scan != NULL)
+	{
+		table_endscan(state->scan);
+		ExecDropSingleTupleTableSlot(state->slot);
+		table_close(state->rel, AccessShareLock);
+		state->scan = NULL;
+		state->slot = NULL;
+		state->rel = NULL;
+	}
+}
+
+static bool
+arrow_ipc_open_next_source(ArrowIpcState *state)
+{
+	if (state->next_source >= list_length(state->sources))
+		return false;
+
+	ArrowIpcSource *source = list_nth(state->sources, state->next_source++);
+	CompressionSettings *settings = NULL;
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->scan_ctx);
+
+	state->rel = table_open(source->relid, AccessShareLock);
+	state->slot = table_slot_create(state->rel, NULL);
+	state->scan = table_beginscan(state->rel, GetActiveSnapshot(), 0, NULL);
+	state->compressed = source->compressed;
+
+	if (source->compressed)
+	{
+		settings = ts_compression_settings_get(source->chunk_relid);
+		Ensure(settings != NULL, "missing compression settings of chunk");
+		state->count_attno = get_attnum(source->relid, COMPRESSION_COLUMN_METADATA_COUNT_NAME);
+		Ensure(state->count_attno != InvalidAttrNumber,
+			   "missing metadata column '%s' in compressed table",
+			   COMPRESSION_COLUMN_METADATA_COUNT_NAME);
+	}
+
+	for (int i = 0; i < state->ncolumns; i++)
+	{
+		ArrowIpcColumn *column = &state->columns[i];
+
+		column->attno = get_attnum(source->relid, NameStr(column->name));
+		column->segmentby =
+			settings != NULL && ts_array_is_member(settings->fd.segmentby, NameStr(column->name));
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	return true;
+}
+
+/*
+ * Fill the current record batch from the sources. Returns false if there
+ * are no rows left.
+ */
+static bool
+arrow_ipc_fill_record_batch(ArrowIpcState *state)
+{
+	state->rows = 0;
+	for (int i = 0; i < state->ncolumns; i++)
+		column_reset(&state->columns[i]);
+
+	while (state->rows < ARROW_IPC_RECORD_BATCH_ROWS)
+	{
+		if (state->scan == NULL && !arrow_ipc_open_next_source(state))
+			break;
+
+		if (!table_scan_getnextslot(state->scan, ForwardScanDirection, state->slot))
+		{
+			arrow_ipc_close_source(state);
+			continue;
+		}
+
+		if (state->compressed)
+			arrow_ipc_append_compressed_batch(state, state->slot);
+		else
+			arrow_ipc_append_row(state, state->slot);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	return state->rows > 0;
+}
+
+static void
+arrow_ipc_add_sources(List **sources, Oid relid)
+{
+	ArrowIpcSource *rows = palloc0(sizeof(ArrowIpcSource));
+	const Chunk *chunk = ts_chunk_get_by_relid(relid, false);
+
+	rows->relid = relid;
+	rows->chunk_relid = relid;
+
+	/* The OSM chunks are foreign tables, which are not exported */
+	if (chunk != NULL && IS_OSM_CHUNK(chunk))
+		return;
+
+	/*
+	 * The rows of a chunk with compressed data are in the compressed chunk,
+	 * and the rows that are not compressed yet in the chunk itself. The
+	 * hypercore table access method returns both.
+	 */
+	if (chunk != NULL && ts_chunk_is_compressed(chunk) &&
+		!ts_is_hypercore_am(ts_get_rel_am(chunk->table_id)))
+	{
+		ArrowIpcSource *compressed = palloc0(sizeof(ArrowIpcSource));
+		CompressionSettings *settings = ts_compression_settings_get(relid);
+
+		Ensure(settings != NULL && OidIsValid(settings->fd.compress_relid),
+			   "missing compressed chunk of chunk \"%s\"",
+			   get_rel_name(relid));
+		compressed->relid = settings->fd.compress_relid;
+		compressed->compressed = true;
+		compressed->chunk_relid = relid;
+		*sources = lappend(*sources, compressed);
+	}
+
+	*sources = lappend(*sources, rows);
+}
+
+static void
+arrow_ipc_init_columns(ArrowIpcState *state, Relation rel, ArrayType *column_names)
+{
+	TupleDesc tupdesc = RelationGetDescr(rel);
+
+	state->columns = palloc0(sizeof(ArrowIpcColumn) * tupdesc->natts);
+	state->ncolumns = 0;
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+		ArrowIpcColumn *column = &state->columns[state->ncolumns];
+
+		if (attr->attisdropped)
+			continue;
+
+		if (column_names != NULL && !ts_array_is_member(column_names, NameStr(attr->attname)))
+			continue;
+
+		namestrcpy(&column->name, NameStr(attr->attname));
+		column->typid = attr->atttypid;
+		column->typlen = attr->attlen;
+
+		switch (attr->atttypid)
+		{
+			case INT2OID:
+			case INT4OID:
+			case INT8OID:
+				column->type = ARROW_IPC_INT;
+				column->width = attr->attlen;
+				break;
+			case FLOAT4OID:
+			case FLOAT8OID:
+				column->type = ARROW_IPC_FLOAT;
+				column->width = attr->attlen;
+				break;
+			case BOOLOID:
+				column->type = ARROW_IPC_BOOL;
+				break;
+			case DATEOID:
+				column->type = ARROW_IPC_DATE;
+				column->width = sizeof(int32);
+				break;
+			case TIMESTAMPOID:
+			case TIMESTAMPTZOID:
+				column->type = ARROW_IPC_TIMESTAMP;
+				column->width = sizeof(int64);
+				break;
+			case TEXTOID:
+				column->type = ARROW_IPC_UTF8;
+				break;
+			default:
+			{
+				Oid output_func;
+				bool is_varlena;
+
+				getTypeOutputInfo(attr->atttypid, &output_func, &is_varlena);
+				fmgr_info(output_func, &column->output);
+				column->type = ARROW_IPC_UTF8;
+				column->use_output = true;
+				break;
+			}
+		}
+
+		initStringInfo(&column->validity);
+		initStringInfo(&column->values);
+		initStringInfo(&column->offsets);
+		state->ncolumns++;
+	}
+
+	if (column_names != NULL && state->ncolumns != ts_array_length(column_names))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				 errmsg("not all columns exist in relation \"%s\"", RelationGetRelationName(rel))));
+
+	if (state->ncolumns == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("no columns to export from relation \"%s\"",
+						RelationGetRelationName(rel))));
+}
+
+static ArrowIpcState *
+arrow_ipc_state_create(Oid relid, ArrayType *column_names, ArrayType *chunks)
+{
+	ArrowIpcState *state = palloc0(sizeof(ArrowIpcState));
+	Relation rel = table_open(relid, AccessShareLock);
+	AclResult aclresult = pg_class_aclcheck(relid, GetUserId(), ACL_SELECT);
+
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, get_relkind_objtype(rel->rd_rel->relkind), get_rel_name(relid));
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a table", RelationGetRelationName(rel))));
+
+	arrow_ipc_init_columns(state, rel, column_names);
+
+	if (ts_is_hypertable(relid))
+	{
+		List *chunk_relids = NIL;
+		ListCell *lc;
+
+		if (chunks != NULL)
+		{
+			ArrayIterator it = array_create_iterator(chunks, 0, NULL);
+			Datum datum;
+			bool isnull;
+
+			while (array_iterate(it, &datum, &isnull))
+			{
+				const Oid chunk_relid = DatumGetObjectId(datum);
+				const Chunk *chunk = isnull ? NULL : ts_chunk_get_by_relid(chunk_relid, false);
+
+				if (chunk == NULL || chunk->hypertable_relid != relid)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							 errmsg("\"%s\" is not a chunk of hypertable \"%s\"",
+									isnull ? "NULL" : get_rel_name(chunk_relid),
+									RelationGetRelationName(rel))));
+				LockRelationOid(chunk_relid, AccessShareLock);
+				chunk_relids = lappend_oid(chunk_relids, chunk_relid);
+			}
+			array_free_iterator(it);
+		}
+		else
+			chunk_relids = find_inheritance_children(relid, AccessShareLock);
+
+		foreach (lc, chunk_relids)
+			arrow_ipc_add_sources(&state->sources, lfirst_oid(lc));
+	}
+	else
+	{
+		if (chunks != NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("chunks can only be given for a hypertable")));
+		arrow_ipc_add_sources(&state->sources, relid);
+	}
+
+	table_close(rel, NoLock);
+
+	state->scan_ctx = CurrentMemoryContext;
+	state->message_ctx =
+		AllocSetContextCreate(CurrentMemoryContext, "arrow ipc message", ALLOCSET_DEFAULT_SIZES);
+	state->decompress_ctx = AllocSetContextCreate(CurrentMemoryContext,
+												  "arrow ipc decompression",
+												  ALLOCSET_DEFAULT_SIZES);
+	state->tmp_ctx =
+		AllocSetContextCreate(CurrentMemoryContext, "arrow ipc temporary", ALLOCSET_DEFAULT_SIZES);
+
+	return state;
+}
+
+/* Close the scan if the caller stops before all messages are returned. */
+static void
+arrow_ipc_shutdown(Datum arg)
+{
+	arrow_ipc_close_source((ArrowIpcState *) DatumGetPointer(arg));
+}
+
+/*
+ * export_arrow_ipc(relation regclass, columns name[], chunks regclass[])
+ *
+ * Return the messages of the Arrow IPC stream of the rows of the hypertable,
+ * chunk or table. The columns can be restricted to the given columns, and
+ * the chunks of a hypertable to the given chunks.
+ */
+Datum
+tsl_export_arrow_ipc(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	ArrowIpcState *state;
+
+#ifdef WORDS_BIGENDIAN
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("Arrow IPC export is not supported on big-endian platforms")));
+#endif
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+		if (PG_ARGISNULL(0))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("relation cannot be NULL")));
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		MemoryContext oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		state = arrow_ipc_state_create(PG_GETARG_OID(0),
+									   PG_ARGISNULL(1) ? NULL : PG_GETARG_ARRAYTYPE_P_COPY(1),
+									   PG_ARGISNULL(2) ? NULL : PG_GETARG_ARRAYTYPE_P_COPY(2));
+		funcctx->user_fctx = state;
+
+		if (rsinfo != NULL && IsA(rsinfo, ReturnSetInfo) && rsinfo->econtext != NULL)
+			RegisterExprContextCallback(rsinfo->econtext,
+										arrow_ipc_shutdown,
+										PointerGetDatum(state));
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	state = funcctx->user_fctx;
+
+	if (state->done)
+		SRF_RETURN_DONE(funcctx);
+
+	/*
+	 * The message is returned before the next call, so the memory of the
+	 * previous message and of the values converted for it can be reused. The
+	 * column buffers are in the multi-call context.
+	 */
+	MemoryContextReset(state->message_ctx);
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->message_ctx);
+	bytea *message;
+
+	if (!state->schema_sent)
+	{
+		message = arrow_ipc_schema_message(state);
+		state->schema_sent = true;
+	}
+	else
+	{
+		if (arrow_ipc_fill_record_batch(state))
+			message = arrow_ipc_record_batch_message(state);
+		else
+		{
+			message = arrow_ipc_end_of_stream_message();
+			state->done = true;
+		}
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	SRF_RETURN_NEXT(funcctx, PointerGetDatum(message));
+}
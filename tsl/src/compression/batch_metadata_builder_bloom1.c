@@ -0,0 +1,244 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#include <postgres.h>
+#include <port/pg_bitutils.h>
+#include <utils/builtins.h>
+#include <utils/typcache.h>
+
+#include "batch_metadata_builder_bloom1.h"
+
+#include "compression.h"
+
+/* The seed for the extended hash functions */
+#define BLOOM1_SEED 0
+
+typedef struct Bloom1MetadataBuilder
+{
+	BatchMetadataBuilder functions;
+
+	FmgrInfo *hash_finfo;
+	Oid collation;
+	bool empty;
+
+	int16 bloom_attr_offset;
+
+	/* The filter with the maximal size, folded when inserted into the row */
+	uint8 bits[BLOOM1_MAX_BITS / 8];
+
+	/* Preallocated buffer for the folded filter */
+	bytea *folded;
+} Bloom1MetadataBuilder;
+
+static void bloom1_update_val(void *builder_, Datum val);
+static void bloom1_update_null(void *builder_);
+static void bloom1_insert_to_compressed_row(void *builder_, RowCompressor *compressor);
+static void bloom1_reset(void *builder_, RowCompressor *compressor);
+
+bool
+bloom1_type_is_supported(Oid type_oid)
+{
+	TypeCacheEntry *type = lookup_type_cache(type_oid, TYPECACHE_HASH_EXTENDED_PROC);
+	return OidIsValid(type->hash_extended_proc);
+}
+
+uint64
+bloom1_hash_value(FmgrInfo *hash_finfo, Oid collation, Datum value)
+{
+	return DatumGetUInt64(
+		FunctionCall2Coll(hash_finfo, collation, value, UInt64GetDatum(BLOOM1_SEED)));
+}
+
+/*
+ * Get the bit for the given hash function, using the double hashing. The
+ * number of bits is a power of two, so the position in a folded filter is the
+ * position in the full-size filter modulo the folded size.
+ */
+static inline uint32
+bloom1_bit_position(uint64 hash, int hash_index, uint32 nbits)
+{
+	const uint32 h1 = (uint32) hash;
+	const uint32 h2 = ((uint32) (hash >> 32)) | 1;
+	return (h1 + hash_index * h2) & (nbits - 1);
+}
+
+bool
+bloom1_contains_hash(const bytea *bloom, uint64 hash)
+{
+	const uint8 *bits = (const uint8 *) VARDATA_ANY(bloom);
+	const uint32 nbytes = VARSIZE_ANY_EXHDR(bloom);
+	const uint32 nbits = nbytes * 8;
+
+	if (nbits < BLOOM1_MIN_BITS || nbits > BLOOM1_MAX_BITS || (nbits & (nbits - 1)) != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid bloom filter size %u", nbytes)));
+
+	for (int i = 0; i < BLOOM1_HASHES; i++)
+	{
+		const uint32 position = bloom1_bit_position(hash, i, nbits);
+		if (!(bits[position / 8] & (1 << (position % 8))))
+			return false;
+	}
+
+	return true;
+}
+
+BatchMetadataBuilder *
+batch_metadata_builder_bloom1_create(Oid type_oid, Oid collation, int bloom_attr_offset)
+{
+	Bloom1MetadataBuilder *builder = palloc0(sizeof(*builder));
+	TypeCacheEntry *type = lookup_type_cache(type_oid, TYPECACHE_HASH_EXTENDED_PROC_FINFO);
+
+	if (!OidIsValid(type->hash_extended_proc))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_FUNCTION),
+				 errmsg("could not identify an extended hash function for type %s",
+						format_type_be(type_oid))));
+
+	builder->functions = (BatchMetadataBuilder){
+		.update_val = bloom1_update_val,
+		.update_null = bloom1_update_null,
+		.insert_to_compressed_row = bloom1_insert_to_compressed_row,
+		.reset = bloom1_reset,
+	};
+	builder->hash_finfo = &type->hash_extended_proc_finfo;
+	builder->collation = collation;
+	builder->empty = true;
+	builder->bloom_attr_offset = bloom_attr_offset;
+	builder->folded = palloc0(VARHDRSZ + BLOOM1_MAX_BITS / 8);
+
+	return &builder->functions;
+}
+
+static void
+bloom1_update_val(void *builder_, Datum val)
+{
+	Bloom1MetadataBuilder *builder = (Bloom1MetadataBuilder *) builder_;
+	const uint64 hash = bloom1_hash_value(builder->hash_finfo, builder->collation, val);
+
+	for (int i = 0; i < BLOOM1_HASHES; i++)
+	{
+		const uint32 position = bloom1_bit_position(hash, i, BLOOM1_MAX_BITS);
+		builder->bits[position / 8] |= 1 << (position % 8);
+	}
+
+	builder->empty = false;
+}
+
+static void
+bloom1_update_null(void *builder_)
+{
+	/* The nulls are not stored in the filter, they never match an equality. */
+}
+
+/*
+ * Fold the filter in half while at most half of the bits of the result are
+ * set, to keep the false positive rate low.
+ */
+static bytea *
+bloom1_fold(Bloom1MetadataBuilder *builder)
+{
+	uint8 *folded = (uint8 *) VARDATA(builder->folded);
+	uint32 nbytes = BLOOM1_MAX_BITS / 8;
+
+	memcpy(folded, builder->bits, nbytes);
+
+	while (nbytes > BLOOM1_MIN_BITS / 8)
+	{
+		const uint32 half = nbytes / 2;
+		uint64 ones = 0;
+
+		for (uint32 i = 0; i < half; i++)
+			ones += pg_popcount32((uint32) (folded[i] | folded[i + half]));
+
+		if (ones * 2 > half * 8)
+			break;
+
+		for (uint32 i = 0; i < half; i++)
+			folded[i] |= folded[i + half];
+
+		nbytes = half;
+	}
+
+	SET_VARSIZE(builder->folded, VARHDRSZ + nbytes);
+	return builder->folded;
+}
+
+static void
+bloom1_insert_to_compressed_row(void *builder_, RowCompressor *compressor)
+{
+	Bloom1MetadataBuilder *builder = (Bloom1MetadataBuilder *) builder_;
+	Assert(builder->bloom_attr_offset >= 0);
+
+	/*
+	 * Like for the minmax metadata, there is no filter when all the values
+	 * are null, so that the equality conditions don't match the batch.
+	 */
+	if (builder->empty)
+	{
+		compressor->compressed_is_null[builder->bloom_attr_offset] = true;
+		compressor->compressed_values[builder->bloom_attr_offset] = 0;
+		return;
+	}
+
+	compressor->compressed_is_null[builder->bloom_attr_offset] = false;
+	compressor->compressed_values[builder->bloom_attr_offset] =
+		PointerGetDatum(bloom1_fold(builder));
+}
+
+static void
+bloom1_reset(void *builder_, RowCompressor *compressor)
+{
+	Bloom1MetadataBuilder *builder = (Bloom1MetadataBuilder *) builder_;
+
+	memset(builder->bits, 0, sizeof(builder->bits));
+	builder->empty = true;
+
+	compressor->compressed_is_null[builder->bloom_attr_offset] = true;
+	compressor->compressed_values[builder->bloom_attr_offset] = 0;
+}
+
+Datum
+bloom1_contains_hash_fmgr(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_BOOL(
+		bloom1_contains_hash(PG_GETARG_BYTEA_PP(0), (uint64) PG_GETARG_INT64(1)));
+}
+
+/*
+ * _timescaledb_functions.bloom1_contains(bloom bytea, value anyelement)
+ *
+ * Check whether the value might be in the batch with the given bloom filter.
+ */
+Datum
+tsl_bloom1_contains(PG_FUNCTION_ARGS)
+{
+	FmgrInfo *hash_finfo = fcinfo->flinfo->fn_extra;
+
+	if (hash_finfo == NULL)
+	{
+		Oid type_oid = get_fn_expr_argtype(fcinfo->flinfo, 1);
+		TypeCacheEntry *type;
+
+		if (!OidIsValid(type_oid))
+			elog(ERROR, "could not determine the type of the bloom filter value");
+
+		type = lookup_type_cache(type_oid, TYPECACHE_HASH_EXTENDED_PROC_FINFO);
+		if (!OidIsValid(type->hash_extended_proc))
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_FUNCTION),
+					 errmsg("could not identify an extended hash function for type %s",
+							format_type_be(type_oid))));
+
+		/* The type cache entries are never freed, so we can keep the pointer */
+		hash_finfo = &type->hash_extended_proc_finfo;
+		fcinfo->flinfo->fn_extra = hash_finfo;
+	}
+
+	PG_RETURN_BOOL(
+		bloom1_contains_hash(PG_GETARG_BYTEA_PP(0),
+							 bloom1_hash_value(hash_finfo, PG_GET_COLLATION(), PG_GETARG_DATUM(1))));
+}
@@ -0,0 +1,43 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+/*
+ * The bloom filter sparse index stores a bloom filter of the values of a
+ * column in each batch. It is stored in the "bloom1" metadata column of the
+ * compressed chunk as a bytea, and lets us skip the batches for equality
+ * conditions on the columns with many distinct values, where the minmax
+ * sparse index is useless.
+ *
+ * The bloom filter is built with the maximal size, and then folded in half
+ * while it stays sparse enough, so a batch with few distinct values gets a
+ * small filter. The number of bits is always a power of two, which makes the
+ * folding possible.
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+
+#include "batch_metadata_builder.h"
+
+/* Number of hash functions */
+#define BLOOM1_HASHES 6
+
+/* Minimal and maximal size of the filter in bits */
+#define BLOOM1_MIN_BITS 64
+#define BLOOM1_MAX_BITS 8192
+
+extern bool bloom1_type_is_supported(Oid type_oid);
+extern uint64 bloom1_hash_value(FmgrInfo *hash_finfo, Oid collation, Datum value);
+extern bool bloom1_contains_hash(const bytea *bloom, uint64 hash);
+
+/*
+ * The function to use in the scan keys on the bloom1 metadata column. The
+ * argument is the hash of the value, computed with bloom1_hash_value().
+ */
+extern Datum bloom1_contains_hash_fmgr(PG_FUNCTION_ARGS);
+
+extern Datum tsl_bloom1_contains(PG_FUNCTION_ARGS);
@@ -0,0 +1,211 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/heaptoast.h>
+#include <access/htup_details.h>
+#include <access/xact.h>
+#include <access/xlog.h>
+#include <access/xloginsert.h>
+#include <access/xlogrecord.h>
+#include <catalog/pg_am_d.h>
+#include <storage/bufmgr.h>
+#include <storage/bufpage.h>
+#include <storage/smgr.h>
+#include <utils/rel.h>
+
+#include "compat/compat.h"
+#include "bulk_page_writer.h"
+#include "guc.h"
+
+/*
+ * Compressing a chunk normally inserts the compressed tuples one by one
+ * through the shared buffers, so every tuple and every index entry gets its
+ * own WAL record. When the compressed chunk was created in the current
+ * transaction, nobody else can see it, and an abort removes its storage
+ * anyway. We can then fill the heap pages in local memory and write them
+ * directly to the storage, the same way as the heap rewrite of CLUSTER and
+ * the index builds do. The pages are WAL-logged as full-page images, up to
+ * XLR_MAX_BLOCK_ID pages per WAL record, which is less WAL and much less
+ * replay work on the standbys than the individual inserts. The indexes are
+ * rebuilt afterwards, which logs them in the same way.
+ *
+ * The TOAST values are still inserted into the TOAST table through the
+ * regular heap inserts, so they are WAL-logged one by one.
+ *
+ * Logical decoding can't decode the full-page images, so the writer is not
+ * used when it is enabled.
+ */
+struct BulkPageWriter
+{
+	Relation rel;
+	int insert_options;
+	TransactionId xid;
+	bool use_wal;
+
+	/* The block number of the next new page */
+	BlockNumber next_blkno;
+
+	/* The pages that are not written yet, the last one is being filled */
+	int npages;
+	BlockNumber blknos[XLR_MAX_BLOCK_ID];
+	Page pages[XLR_MAX_BLOCK_ID];
+};
+
+/*
+ * Check if the compressed tuples can be written to the relation directly.
+ */
+bool
+bulk_page_writer_possible(Relation rel)
+{
+	return ts_guc_enable_compression_bulk_wal && !XLogLogicalInfoActive() &&
+		   rel->rd_rel->relkind == RELKIND_RELATION && rel->rd_rel->relam == HEAP_TABLE_AM_OID &&
+		   rel->rd_createSubid != InvalidSubTransactionId && RelationGetNumberOfBlocks(rel) == 0;
+}
+
+BulkPageWriter *
+bulk_page_writer_begin(Relation rel, int insert_options)
+{
+	BulkPageWriter *writer = palloc0(sizeof(BulkPageWriter));
+
+	Assert(RelationGetNumberOfBlocks(rel) == 0);
+
+	writer->rel = rel;
+	writer->insert_options = insert_options;
+	writer->xid = GetCurrentTransactionId();
+	writer->use_wal = RelationNeedsWAL(rel);
+	writer->next_blkno = 0;
+
+	for (int i = 0; i < XLR_MAX_BLOCK_ID; i++)
+	{
+#if PG16_LT
+		writer->pages[i] = palloc(BLCKSZ);
+#else
+		writer->pages[i] = palloc_aligned(BLCKSZ, PG_IO_ALIGN_SIZE, 0);
+#endif
+	}
+
+	return writer;
+}
+
+/*
+ * WAL-log the pending pages with one record and write them to the storage.
+ */
+static void
+bulk_page_writer_flush(BulkPageWriter *writer)
+{
+	if (writer->npages == 0)
+		return;
+
+	if (writer->use_wal)
+	{
+#if PG16_LT
+		log_newpages(&writer->rel->rd_node,
+#else
+		log_newpages(&writer->rel->rd_locator,
+#endif
+					 MAIN_FORKNUM,
+					 writer->npages,
+					 writer->blknos,
+					 writer->pages,
+					 true);
+	}
+
+	for (int i = 0; i < writer->npages; i++)
+	{
+		PageSetChecksumInplace(writer->pages[i], writer->blknos[i]);
+
+		/*
+		 * We say skipFsync = true because there's no need for smgr to
+		 * schedule an fsync for this write; we'll do it ourselves in
+		 * bulk_page_writer_end().
+		 */
+		smgrextend(RelationGetSmgr(writer->rel),
+				   MAIN_FORKNUM,
+				   writer->blknos[i],
+				   writer->pages[i],
+				   true);
+	}
+
+	writer->npages = 0;
+}
+
+/*
+ * Add the tuple to the current page, and set its t_self. The tuple header is
+ * prepared the same way as in heap_insert().
+ */
+void
+bulk_page_writer_insert(BulkPageWriter *writer, HeapTuple tuple, CommandId cid)
+{
+	Relation rel = writer->rel;
+	HeapTupleHeader header = tuple->t_data;
+	HeapTuple heaptup = tuple;
+	Page page = writer->npages > 0 ? writer->pages[writer->npages - 1] : NULL;
+	Size save_free_space = RelationGetTargetPageFreeSpace(rel, HEAP_DEFAULT_FILLFACTOR);
+	OffsetNumber offnum;
+	Size len;
+
+	header->t_infomask &= ~(HEAP_XACT_MASK);
+	header->t_infomask2 &= ~(HEAP2_XACT_MASK);
+	header->t_infomask |= HEAP_XMAX_INVALID;
+	HeapTupleHeaderSetXmin(header, writer->xid);
+	if (writer->insert_options & HEAP_INSERT_FROZEN)
+		HeapTupleHeaderSetXminFrozen(header);
+	HeapTupleHeaderSetCmin(header, cid);
+	HeapTupleHeaderSetXmax(header, 0);
+	tuple->t_tableOid = RelationGetRelid(rel);
+
+	if (HeapTupleHasExternal(tuple) || tuple->t_len > TOAST_TUPLE_THRESHOLD)
+		heaptup = heap_toast_insert_or_update(rel, tuple, NULL, writer->insert_options);
+
+	len = MAXALIGN(heaptup->t_len);
+	if (len > MaxHeapTupleSize)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("row is too big: size %zu, maximum size %zu", len, MaxHeapTupleSize)));
+
+	/* Start a new page if the tuple doesn't fit into the current one */
+	if (page == NULL || len + save_free_space > PageGetHeapFreeSpace(page))
+	{
+		if (writer->npages == XLR_MAX_BLOCK_ID)
+			bulk_page_writer_flush(writer);
+
+		page = writer->pages[writer->npages];
+		writer->blknos[writer->npages] = writer->next_blkno++;
+		writer->npages++;
+		PageInit(page, BLCKSZ, 0);
+	}
+
+	offnum =
+		PageAddItem(page, (Item) heaptup->t_data, heaptup->t_len, InvalidOffsetNumber, false, true);
+	if (offnum == InvalidOffsetNumber)
+		elog(ERROR, "failed to add tuple to page");
+
+	ItemPointerSet(&heaptup->t_self, writer->blknos[writer->npages - 1], offnum);
+	((HeapTupleHeader) PageGetItem(page, PageGetItemId(page, offnum)))->t_ctid = heaptup->t_self;
+	tuple->t_self = heaptup->t_self;
+
+	if (heaptup != tuple)
+		heap_freetuple(heaptup);
+}
+
+void
+bulk_page_writer_end(BulkPageWriter *writer)
+{
+	bulk_page_writer_flush(writer);
+
+	/*
+	 * When we WAL-logged rel pages, we must nonetheless fsync them, since
+	 * the WAL replay only restores the pages written after the checkpoint.
+	 * Otherwise the pending syncs of the new storage take care of it.
+	 */
+	if (writer->use_wal)
+		smgrimmedsync(RelationGetSmgr(writer->rel), MAIN_FORKNUM);
+
+	for (int i = 0; i < XLR_MAX_BLOCK_ID; i++)
+		pfree(writer->pages[i]);
+	pfree(writer);
+}
@@ -0,0 +1,21 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <access/htup.h>
+#include <utils/rel.h>
+
+/*
+ * Writer of the heap pages of a new compressed chunk that bypasses the
+ * shared buffers and WAL-logs the pages as full-page images in batches.
+ */
+typedef struct BulkPageWriter BulkPageWriter;
+
+extern bool bulk_page_writer_possible(Relation rel);
+extern BulkPageWriter *bulk_page_writer_begin(Relation rel, int insert_options);
+extern void bulk_page_writer_insert(BulkPageWriter *writer, HeapTuple tuple, CommandId cid);
+extern void bulk_page_writer_end(BulkPageWriter *writer);
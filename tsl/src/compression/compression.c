@@ -4,7 +4,10 @@
  * LICENSE-TIMESCALE for a copy of the license.
  */
 #include <postgres.h>
+#include <access/detoast.h>
+#include <access/heapam.h>
 #include <access/skey.h>
+#include <access/toast_compression.h>
 #include <catalog/heap.h>
 #include <catalog/indexing.h>
 #include <catalog/pg_am.h>
@@ -13,20 +16,30 @@
 #include <storage/predicate.h>
 #include <utils/datum.h>
 #include <utils/snapmgr.h>
+#include <utils/sortsupport.h>
 #include <utils/syscache.h>
 #include <utils/typcache.h>
 
 #include "compat/compat.h"
 
+#include "algorithms/alp.h"
 #include "algorithms/array.h"
+#include "algorithms/block_codec.h"
 #include "algorithms/bool_compress.h"
 #include "algorithms/deltadelta.h"
 #include "algorithms/dictionary.h"
+#include "algorithms/for.h"
+#include "algorithms/fsst.h"
 #include "algorithms/gorilla.h"
+#include "algorithms/jsonb_shred.h"
 #include "algorithms/null.h"
+#include "algorithms/uuid_compress.h"
 #include "batch_metadata_builder.h"
+#include "bgw/job_profile.h"
+#include "bulk_page_writer.h"
 #include "chunk.h"
 #include "compression.h"
+#include "compression_parallel.h"
 #include "create.h"
 #include "custom_type_cache.h"
 #include "debug_assert.h"
@@ -34,6 +47,7 @@
 #include "guc.h"
 #include "hypercore/hypercore_handler.h"
 #include "nodes/chunk_dispatch/chunk_insert_state.h"
+#include "trace.h"
 #include "ts_catalog/array_utils.h"
 #include "ts_catalog/catalog.h"
 #include "ts_catalog/compression_chunk_size.h"
@@ -51,6 +65,12 @@ static const CompressionAlgorithmDefinition definitions[_END_COMPRESSION_ALGORIT
 	[COMPRESSION_ALGORITHM_DELTADELTA] = DELTA_DELTA_ALGORITHM_DEFINITION,
 	[COMPRESSION_ALGORITHM_BOOL] = BOOL_COMPRESS_ALGORITHM_DEFINITION,
 	[COMPRESSION_ALGORITHM_NULL] = NULL_COMPRESS_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_FOR] = FOR_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_ALP] = ALP_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_FSST] = FSST_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_BLOCK] = BLOCK_CODEC_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_UUID] = UUID_ALGORITHM_DEFINITION,
+	[COMPRESSION_ALGORITHM_JSONB] = JSONB_SHRED_ALGORITHM_DEFINITION,
 };
 
 static NameData compression_algorithm_name[] = {
@@ -61,6 +81,12 @@ static NameData compression_algorithm_name[] = {
 	[COMPRESSION_ALGORITHM_DELTADELTA] = { "DELTADELTA" },
 	[COMPRESSION_ALGORITHM_BOOL] = { "BOOL" },
 	[COMPRESSION_ALGORITHM_NULL] = { "NULL" },
+	[COMPRESSION_ALGORITHM_FOR] = { "FOR" },
+	[COMPRESSION_ALGORITHM_ALP] = { "ALP" },
+	[COMPRESSION_ALGORITHM_FSST] = { "FSST" },
+	[COMPRESSION_ALGORITHM_BLOCK] = { "BLOCK" },
+	[COMPRESSION_ALGORITHM_UUID] = { "UUID" },
+	[COMPRESSION_ALGORITHM_JSONB] = { "JSONB" },
 };
 
 Name
@@ -70,13 +96,41 @@ compression_get_algorithm_name(CompressionAlgorithm alg)
 }
 
 static Compressor *
-compressor_for_type(Oid type)
+compressor_for_type(Oid type, CompressionBlockCodec codec)
 {
 	CompressionAlgorithm algorithm = compression_get_default_algorithm(type);
 	if (algorithm >= _END_COMPRESSION_ALGORITHMS)
 		elog(ERROR, "invalid compression algorithm %d", algorithm);
 
-	return definitions[algorithm].compressor_for_type(type);
+	Compressor *compressor = definitions[algorithm].compressor_for_type(type);
+
+	/*
+	 * The array and dictionary algorithms store the values as is, so they
+	 * benefit from the general-purpose block codec.
+	 */
+	if (algorithm == COMPRESSION_ALGORITHM_ARRAY || algorithm == COMPRESSION_ALGORITHM_DICTIONARY)
+		compressor = block_codec_compressor_wrap(compressor, codec);
+
+	return compressor;
+}
+
+/*
+ * Get the block codec for the given column. The compression method set for
+ * the column with ALTER TABLE ... SET COMPRESSION takes precedence over the
+ * GUC.
+ */
+static CompressionBlockCodec
+column_block_codec(Form_pg_attribute attr)
+{
+	switch (attr->attcompression)
+	{
+		case TOAST_LZ4_COMPRESSION:
+			return BLOCK_CODEC_LZ4;
+		case TOAST_PGLZ_COMPRESSION:
+			return BLOCK_CODEC_NONE;
+		default:
+			return ts_guc_compression_block_codec;
+	}
 }
 
 DecompressionInitializer
@@ -97,10 +151,37 @@ tsl_get_decompress_all_function(CompressionAlgorithm algorithm, Oid type)
 	if (algorithm >= _END_COMPRESSION_ALGORITHMS)
 		elog(ERROR, "invalid compression algorithm %d", algorithm);
 
-	if (type != TEXTOID &&
+	if (type == UUIDOID &&
 		(algorithm == COMPRESSION_ALGORITHM_DICTIONARY || algorithm == COMPRESSION_ALGORITHM_ARRAY))
 	{
-		/* Bulk decompression of array and dictionary is only supported for text. */
+		/*
+		 * The UUIDs that are not compressed with the UUID algorithm are
+		 * decompressed into the same fixed-width Arrow array row by row. The
+		 * block codec wraps the array and dictionary, and uses this as well.
+		 */
+		return uuid_iterator_decompress_all;
+	}
+
+	if (algorithm == COMPRESSION_ALGORITHM_DICTIONARY &&
+		(compression_get_default_algorithm(type) == COMPRESSION_ALGORITHM_DELTADELTA ||
+		 compression_get_default_algorithm(type) == COMPRESSION_ALGORITHM_GORILLA))
+	{
+		/*
+		 * The dictionary is a candidate for the integer and float columns
+		 * with few distinct values.
+		 */
+		return tsl_fixed_dictionary_decompress_all;
+	}
+
+	if (type != TEXTOID && type != UUIDOID &&
+		(algorithm == COMPRESSION_ALGORITHM_DICTIONARY ||
+		 algorithm == COMPRESSION_ALGORITHM_ARRAY || algorithm == COMPRESSION_ALGORITHM_FSST ||
+		 algorithm == COMPRESSION_ALGORITHM_BLOCK))
+	{
+		/*
+		 * Bulk decompression of array, dictionary and FSST is only supported
+		 * for text. The block codec wraps the array and dictionary.
+		 */
 		return NULL;
 	}
 
@@ -108,6 +189,9 @@ tsl_get_decompress_all_function(CompressionAlgorithm algorithm, Oid type)
 }
 
 static Tuplesortstate *compress_chunk_sort_relation(CompressionSettings *settings, Relation in_rel);
+static bool compress_chunk_presorted_scan(RowCompressor *row_compressor,
+										  CompressionSettings *settings, Relation in_rel,
+										  ScanDirection direction, CommandId mycid);
 static void row_compressor_process_ordered_slot(RowCompressor *row_compressor, TupleTableSlot *slot,
 												CommandId mycid);
 static void row_compressor_update_group(RowCompressor *row_compressor, TupleTableSlot *row);
@@ -178,7 +262,10 @@ truncate_relation(Oid table_oid)
 
 	ReindexParams params = { 0 };
 	ReindexParams *options = &params;
+	instr_time start;
+	ts_job_phase_start(&start);
 	reindex_relation_compat(NULL, table_oid, REINDEX_REL_PROCESS_TOAST, options);
+	ts_job_phase_end("index_rebuild", &start);
 	rel = table_open(table_oid, AccessExclusiveLock);
 	CommandCounterIncrement();
 	table_close(rel, NoLock);
@@ -263,6 +350,7 @@ compress_chunk(Oid in_table, Oid out_table, int insert_options)
 	HeapTuple in_table_tp = NULL, index_tp = NULL;
 	Form_pg_attribute in_table_attr_tp, index_attr_tp;
 	CompressionStats cstat;
+	instr_time phase_start;
 	/* Might be merging into an existing chunk, so get compression settings
 	 * from that chunk */
 	CompressionSettings *settings = ts_compression_settings_get_by_compress_relid(out_table);
@@ -312,7 +400,8 @@ compress_chunk(Oid in_table, Oid out_table, int insert_options)
 	 * data, but for now just avoid it altogether since compression indexscan
 	 * isn't enabled by default anyway.
 	 */
-	if (ts_guc_enable_compression_indexscan && !REL_IS_HYPERCORE(in_rel))
+	if ((ts_guc_enable_compression_indexscan || ts_guc_enable_compression_presorted_scan) &&
+		!REL_IS_HYPERCORE(in_rel))
 	{
 		List *in_rel_index_oids = RelationGetIndexList(in_rel);
 		foreach (lc, in_rel_index_oids)
@@ -458,7 +547,32 @@ compress_chunk(Oid in_table, Oid out_table, int insert_options)
 						true /*need_bistate*/,
 						insert_options);
 
-	if (matched_index_rel != NULL)
+	if (bulk_page_writer_possible(out_rel))
+		row_compressor.page_writer = bulk_page_writer_begin(out_rel, insert_options);
+
+	/*
+	 * The scans in index order compress the rows as they are read, only the
+	 * tuplesort has a separate sort phase.
+	 */
+	ts_job_phase_start(&phase_start);
+
+	/*
+	 * If the matching index is the clustered index, the rows might already be
+	 * stored in the right order, e.g. by reorder_chunk(), so try reading them
+	 * in physical order, which avoids both the sort and the random I/O of the
+	 * index scan.
+	 */
+	if (matched_index_rel != NULL && ts_guc_enable_compression_presorted_scan &&
+		matched_index_rel->rd_index->indisclustered &&
+		compress_chunk_presorted_scan(&row_compressor,
+									  settings,
+									  in_rel,
+									  indexscan_direction,
+									  mycid))
+	{
+		index_close(matched_index_rel, AccessShareLock);
+	}
+	else if (matched_index_rel != NULL && ts_guc_enable_compression_indexscan)
 	{
 		int64 nrows_processed = 0;
 
@@ -495,16 +609,58 @@ compress_chunk(Oid in_table, Oid out_table, int insert_options)
 	}
 	else
 	{
+		if (matched_index_rel != NULL)
+			index_close(matched_index_rel, AccessShareLock);
+
 		elog(ts_guc_debug_compression_path_info ? INFO : DEBUG1,
 			 "using tuplesort to scan rows from \"%s\" for compression",
 			 RelationGetRelationName(in_rel));
 
-		Tuplesortstate *sorted_rel = compress_chunk_sort_relation(settings, in_rel);
-		row_compressor_append_sorted_rows(&row_compressor, sorted_rel, in_desc, in_rel);
-		tuplesort_end(sorted_rel);
+		int nworkers = compression_parallel_sort_plan_workers(in_rel);
+		CompressionParallelSort *parallel_sort = NULL;
+
+		if (nworkers > 0)
+			parallel_sort = compression_parallel_sort_begin(settings, in_rel, nworkers);
+
+		if (parallel_sort != NULL)
+		{
+			ts_job_phase_end("sort", &phase_start);
+			ts_job_phase_start(&phase_start);
+			row_compressor_append_sorted_rows(&row_compressor,
+											  parallel_sort->sortstate,
+											  in_desc,
+											  in_rel);
+			compression_parallel_sort_end(parallel_sort);
+		}
+		else
+		{
+			Tuplesortstate *sorted_rel = compress_chunk_sort_relation(settings, in_rel);
+			ts_job_phase_end("sort", &phase_start);
+			ts_job_phase_start(&phase_start);
+			row_compressor_append_sorted_rows(&row_compressor, sorted_rel, in_desc, in_rel);
+			tuplesort_end(sorted_rel);
+		}
+	}
+
+	if (row_compressor.page_writer != NULL)
+	{
+		ReindexParams params = { 0 };
+
+		bulk_page_writer_end(row_compressor.page_writer);
+		row_compressor.page_writer = NULL;
+		row_compressor_close(&row_compressor);
+		ts_job_phase_end("compress", &phase_start);
+
+		ts_job_phase_start(&phase_start);
+		reindex_relation_compat(NULL, out_table, 0, &params);
+		ts_job_phase_end("index_rebuild", &phase_start);
+	}
+	else
+	{
+		row_compressor_close(&row_compressor);
+		ts_job_phase_end("compress", &phase_start);
 	}
 
-	row_compressor_close(&row_compressor);
 	if (!ts_guc_enable_delete_after_compression)
 	{
 		DEBUG_WAITPOINT("compression_done_before_truncate_uncompressed");
@@ -521,6 +677,15 @@ compress_chunk(Oid in_table, Oid out_table, int insert_options)
 	table_close(in_rel, NoLock);
 	cstat.rowcnt_pre_compression = row_compressor.rowcnt_pre_compression;
 	cstat.rowcnt_post_compression = row_compressor.num_compressed_rows;
+	cstat.memory_limited_batches = row_compressor.num_memory_limited_batches;
+	cstat.peak_batch_memory = row_compressor.peak_batch_memory;
+
+	elog(DEBUG1,
+		 "compressed \"%s\" with peak batch memory %zu bytes, " INT64_FORMAT
+		 " batches cut at the memory limit",
+		 get_rel_name(in_table),
+		 row_compressor.peak_batch_memory,
+		 row_compressor.num_memory_limited_batches);
 
 	if ((insert_options & HEAP_INSERT_FROZEN) == HEAP_INSERT_FROZEN)
 		cstat.rowcnt_frozen = row_compressor.num_compressed_rows;
@@ -530,10 +695,174 @@ compress_chunk(Oid in_table, Oid out_table, int insert_options)
 	return cstat;
 }
 
-Tuplesortstate *
-compression_create_tuplesort_state(CompressionSettings *settings, Relation rel)
+/*
+ * The uncompressed chunk and the block at which the previous slice of it
+ * stopped. The rows in the blocks after it were compressed and deleted by
+ * the previous slices, so the next slice does not read their dead tuples
+ * again, which would make compressing a chunk in slices quadratic. The
+ * state is only kept in the backend that runs compress_chunk_incremental().
+ */
+static Oid slice_relid = InvalidOid;
+static BlockNumber slice_stop_block = InvalidBlockNumber;
+
+/*
+ * Move the rows in the blocks [startblk, startblk + numblks) into the
+ * tuplesort and delete them, starting from the last block, until nrows
+ * reaches max_rows. Returns whether rows were left, and sets stop_block to
+ * the block of the first row that was left.
+ */
+static bool
+compress_chunk_slice_scan(Relation in_rel, TableScanDesc scan, TupleTableSlot *slot,
+						  Snapshot snapshot, Tuplesortstate *sortstate, BlockNumber startblk,
+						  BlockNumber numblks, int64 max_rows, int64 *nrows,
+						  BlockNumber *stop_block)
+{
+	table_rescan(scan, NULL);
+	heap_setscanlimits(scan, startblk, numblks);
+
+	while (table_scan_getnextslot(scan, BackwardScanDirection, slot))
+	{
+		if (*nrows >= max_rows)
+		{
+			*stop_block = ItemPointerGetBlockNumber(&slot->tts_tid);
+			return true;
+		}
+
+		tuplesort_puttupleslot(sortstate, slot);
+		simple_table_tuple_delete(in_rel, &slot->tts_tid, snapshot);
+		(*nrows)++;
+	}
+
+	return false;
+}
+
+/*
+ * Compress at most max_rows rows of the uncompressed chunk into the compressed
+ * chunk, and delete them from the uncompressed chunk. The rows are read from
+ * the end of the heap, so that vacuum can truncate the emptied pages and give
+ * the space back between the slices. The uncompressed chunk is truncated
+ * after the last slice unless timescaledb.enable_delete_after_compression is
+ * set, like in compress_chunk().
+ *
+ * A slice continues at the block where the previous slice of the chunk
+ * stopped. Rows inserted by concurrent transactions can end up in the blocks
+ * after it, so before reporting that no rows are left, the blocks after it
+ * are scanned once more.
+ *
+ * Sets has_more to whether the uncompressed chunk still has rows.
+ */
+CompressionStats
+compress_chunk_slice(Oid in_table, Oid out_table, int64 max_rows, int insert_options,
+					 bool *has_more)
+{
+	CompressionSettings *settings = ts_compression_settings_get_by_compress_relid(out_table);
+	CompressionStats cstat = { 0 };
+	RowCompressor row_compressor;
+	Tuplesortstate *sortstate;
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+	Snapshot snapshot;
+	BlockNumber nblocks;
+	BlockNumber limit;
+	BlockNumber stop_block = InvalidBlockNumber;
+	int64 nrows = 0;
+
+	/* The same locks as in compress_chunk() */
+	Relation in_rel = table_open(in_table, ExclusiveLock);
+	Relation out_rel = table_open(out_table, RowExclusiveLock);
+
+	Ensure(in_rel->rd_rel->relkind == RELKIND_RELATION, "compress_chunk called on non-relation");
+	Ensure(!REL_IS_HYPERCORE(in_rel), "cannot compress hypercore chunks in slices");
+
+	/* The blocks up to the stop block of the previous slice have rows left */
+	nblocks = RelationGetNumberOfBlocks(in_rel);
+	limit = nblocks;
+	if (slice_relid == in_table && slice_stop_block < nblocks)
+		limit = slice_stop_block + 1;
+
+	snapshot = RegisterSnapshot(GetLatestSnapshot());
+	sortstate = compression_create_tuplesort_state(settings, in_rel);
+	/* The scan limits need a scan without synchronized scanning */
+	scan = table_beginscan_strat(in_rel, snapshot, 0, NULL, true, false);
+	slot = table_slot_create(in_rel, NULL);
+
+	*has_more = compress_chunk_slice_scan(in_rel,
+										  scan,
+										  slot,
+										  snapshot,
+										  sortstate,
+										  0,
+										  limit,
+										  max_rows,
+										  &nrows,
+										  &stop_block);
+
+	if (!*has_more && limit < nblocks)
+		*has_more = compress_chunk_slice_scan(in_rel,
+											  scan,
+											  slot,
+											  snapshot,
+											  sortstate,
+											  limit,
+											  nblocks - limit,
+											  max_rows,
+											  &nrows,
+											  &stop_block);
+
+	slice_relid = *has_more ? in_table : InvalidOid;
+	slice_stop_block = stop_block;
+
+	table_endscan(scan);
+	ExecDropSingleTupleTableSlot(slot);
+	tuplesort_performsort(sortstate);
+
+	row_compressor_init(settings,
+						&row_compressor,
+						in_rel,
+						out_rel,
+						RelationGetDescr(out_rel)->natts,
+						true /*need_bistate*/,
+						insert_options);
+	row_compressor_append_sorted_rows(&row_compressor,
+									  sortstate,
+									  RelationGetDescr(in_rel),
+									  in_rel);
+	row_compressor_close(&row_compressor);
+	tuplesort_end(sortstate);
+	UnregisterSnapshot(snapshot);
+
+	elog(DEBUG1,
+		 "compressed slice of " INT64_FORMAT " rows from \"%s\"%s",
+		 nrows,
+		 RelationGetRelationName(in_rel),
+		 *has_more ? "" : ", no rows left");
+
+	if (!*has_more && !ts_guc_enable_delete_after_compression)
+		truncate_relation(in_table);
+
+	table_close(out_rel, NoLock);
+	table_close(in_rel, NoLock);
+
+	cstat.rowcnt_pre_compression = row_compressor.rowcnt_pre_compression;
+	cstat.rowcnt_post_compression = row_compressor.num_compressed_rows;
+	if ((insert_options & HEAP_INSERT_FROZEN) == HEAP_INSERT_FROZEN)
+		cstat.rowcnt_frozen = row_compressor.num_compressed_rows;
+	cstat.memory_limited_batches = row_compressor.num_memory_limited_batches;
+	cstat.peak_batch_memory = row_compressor.peak_batch_memory;
+
+	return cstat;
+}
+
+/*
+ * Get the sort keys used to order the rows of a relation for compression: the
+ * segmentby columns followed by the orderby columns. The arrays are allocated
+ * in the current memory context. Returns the number of keys.
+ */
+int
+compression_get_sort_keys(CompressionSettings *settings, Relation rel, AttrNumber **sort_keys_out,
+						  Oid **sort_operators_out, Oid **sort_collations_out,
+						  bool **nulls_first_out)
 {
-	TupleDesc tupdesc = RelationGetDescr(rel);
 	int num_segmentby = ts_array_length(settings->fd.segmentby);
 	int num_orderby = ts_array_length(settings->fd.orderby);
 	int n_keys = num_segmentby + num_orderby;
@@ -566,6 +895,28 @@ compression_create_tuplesort_state(CompressionSettings *settings, Relation rel)
 													 &nulls_first[n]);
 	}
 
+	*sort_keys_out = sort_keys;
+	*sort_operators_out = sort_operators;
+	*sort_collations_out = sort_collations;
+	*nulls_first_out = nulls_first;
+	return n_keys;
+}
+
+Tuplesortstate *
+compression_create_tuplesort_state(CompressionSettings *settings, Relation rel)
+{
+	TupleDesc tupdesc = RelationGetDescr(rel);
+	AttrNumber *sort_keys;
+	Oid *sort_operators;
+	Oid *sort_collations;
+	bool *nulls_first;
+	int n_keys = compression_get_sort_keys(settings,
+										   rel,
+										   &sort_keys,
+										   &sort_operators,
+										   &sort_collations,
+										   &nulls_first);
+
 	/* Make a copy of the tuple descriptor so that it is allocated on the same
 	 * memory context as the tuple sort instead of pointing into the relcache
 	 * entry that could be blown away. */
@@ -612,6 +963,187 @@ compress_chunk_sort_relation(CompressionSettings *settings, Relation in_rel)
 	return tuplesortstate;
 }
 
+/*
+ * The presorted scan gives up when more than a thousand rows, and more than
+ * one sixteenth of the rows, are out of order, because these rows have to be
+ * sorted separately.
+ */
+#define PRESORTED_SCAN_MIN_OUT_OF_ORDER 1000
+#define PRESORTED_SCAN_MAX_OUT_OF_ORDER_FRACTION 16
+
+static int
+presorted_scan_compare(SortSupport sortkeys, int n_keys, TupleTableSlot *a, TupleTableSlot *b)
+{
+	for (int i = 0; i < n_keys; i++)
+	{
+		SortSupport ssup = &sortkeys[i];
+		bool isnull_a, isnull_b;
+		Datum value_a = slot_getattr(a, ssup->ssup_attno, &isnull_a);
+		Datum value_b = slot_getattr(b, ssup->ssup_attno, &isnull_b);
+		int cmp = ApplySortComparator(value_a, isnull_a, value_b, isnull_b, ssup);
+
+		if (cmp != 0)
+			return cmp;
+	}
+
+	return 0;
+}
+
+/*
+ * Check whether the next row of the physical order is in the compression
+ * order, i.e. not smaller than the last row that was. In this case, it
+ * becomes the new last row.
+ */
+static bool
+presorted_scan_row_is_in_order(SortSupport sortkeys, int n_keys, TupleTableSlot *slot,
+							   TupleTableSlot *last_in_order)
+{
+	if (!TTS_EMPTY(last_in_order) &&
+		presorted_scan_compare(sortkeys, n_keys, slot, last_in_order) < 0)
+		return false;
+
+	ExecCopySlot(last_in_order, slot);
+	return true;
+}
+
+/*
+ * Compress the rows of the relation in the physical order, if they are
+ * mostly sorted in the compression order already.
+ *
+ * The first pass over the relation checks the order of the rows, and puts
+ * the rows that are out of order into a tuplesort. If there are too many of
+ * them, we give up and return false, and the caller has to sort the relation
+ * as usual. The second pass merges the rows that are in order with the
+ * sorted rest, and feeds them to the row compressor. Both passes use the
+ * same snapshot and no synchronized scans, so they see the same rows in the
+ * same order.
+ */
+static bool
+compress_chunk_presorted_scan(RowCompressor *row_compressor, CompressionSettings *settings,
+							  Relation in_rel, ScanDirection direction, CommandId mycid)
+{
+	AttrNumber *sort_keys;
+	Oid *sort_operators;
+	Oid *sort_collations;
+	bool *nulls_first;
+	int n_keys = compression_get_sort_keys(settings,
+										   in_rel,
+										   &sort_keys,
+										   &sort_operators,
+										   &sort_collations,
+										   &nulls_first);
+	SortSupport sortkeys = palloc0(sizeof(SortSupportData) * n_keys);
+	Snapshot snapshot = RegisterSnapshot(GetLatestSnapshot());
+	TupleTableSlot *slot = table_slot_create(in_rel, NULL);
+	TupleTableSlot *last_in_order = table_slot_create(in_rel, NULL);
+	TupleTableSlot *out_of_order_slot = table_slot_create(in_rel, NULL);
+	Tuplesortstate *out_of_order = compression_create_tuplesort_state(settings, in_rel);
+	TableScanDesc scan;
+	int64 nrows = 0;
+	int64 nrows_out_of_order = 0;
+	int64 nrows_merged = 0;
+	bool is_presorted = true;
+
+	for (int i = 0; i < n_keys; i++)
+	{
+		SortSupport ssup = &sortkeys[i];
+
+		ssup->ssup_cxt = CurrentMemoryContext;
+		ssup->ssup_collation = sort_collations[i];
+		ssup->ssup_nulls_first = nulls_first[i];
+		ssup->ssup_attno = sort_keys[i];
+		PrepareSortSupportFromOrderingOp(sort_operators[i], ssup);
+	}
+
+	scan = table_beginscan_strat(in_rel, snapshot, 0, NULL, true, false);
+	while (table_scan_getnextslot(scan, direction, slot))
+	{
+		nrows++;
+		if (presorted_scan_row_is_in_order(sortkeys, n_keys, slot, last_in_order))
+			continue;
+
+		tuplesort_puttupleslot(out_of_order, slot);
+		nrows_out_of_order++;
+		if (nrows_out_of_order > PRESORTED_SCAN_MIN_OUT_OF_ORDER &&
+			nrows_out_of_order > nrows / PRESORTED_SCAN_MAX_OUT_OF_ORDER_FRACTION)
+		{
+			is_presorted = false;
+			break;
+		}
+	}
+	table_endscan(scan);
+
+	if (!is_presorted)
+	{
+		elog(DEBUG1,
+			 "rows of \"%s\" are not sorted for compression",
+			 RelationGetRelationName(in_rel));
+	}
+	else
+	{
+		bool have_out_of_order;
+
+		elog(ts_guc_debug_compression_path_info ? INFO : DEBUG1,
+			 "using presorted scan of \"%s\" for compression with " INT64_FORMAT
+			 " rows out of order",
+			 RelationGetRelationName(in_rel),
+			 nrows_out_of_order);
+
+		tuplesort_performsort(out_of_order);
+		have_out_of_order =
+			tuplesort_gettupleslot(out_of_order, true, false, out_of_order_slot, NULL);
+
+		ExecClearTuple(last_in_order);
+		scan = table_beginscan_strat(in_rel, snapshot, 0, NULL, true, false);
+		while (table_scan_getnextslot(scan, direction, slot))
+		{
+			/* The rows that are out of order come from the tuplesort */
+			if (!presorted_scan_row_is_in_order(sortkeys, n_keys, slot, last_in_order))
+				continue;
+
+			while (have_out_of_order &&
+				   presorted_scan_compare(sortkeys, n_keys, out_of_order_slot, slot) < 0)
+			{
+				row_compressor_process_ordered_slot(row_compressor, out_of_order_slot, mycid);
+				nrows_merged++;
+				have_out_of_order =
+					tuplesort_gettupleslot(out_of_order, true, false, out_of_order_slot, NULL);
+			}
+
+			row_compressor_process_ordered_slot(row_compressor, slot, mycid);
+		}
+		table_endscan(scan);
+
+		while (have_out_of_order)
+		{
+			row_compressor_process_ordered_slot(row_compressor, out_of_order_slot, mycid);
+			nrows_merged++;
+			have_out_of_order =
+				tuplesort_gettupleslot(out_of_order, true, false, out_of_order_slot, NULL);
+		}
+
+		Ensure(nrows_merged == nrows_out_of_order,
+			   "unexpected number of rows out of order in \"%s\"",
+			   RelationGetRelationName(in_rel));
+
+		if (row_compressor->rows_compressed_into_current_value > 0)
+			row_compressor_flush(row_compressor, mycid, true);
+
+		elog(DEBUG1,
+			 "finished compressing " INT64_FORMAT " rows from \"%s\"",
+			 nrows,
+			 RelationGetRelationName(in_rel));
+	}
+
+	tuplesort_end(out_of_order);
+	ExecDropSingleTupleTableSlot(out_of_order_slot);
+	ExecDropSingleTupleTableSlot(last_in_order);
+	ExecDropSingleTupleTableSlot(slot);
+	UnregisterSnapshot(snapshot);
+
+	return is_presorted;
+}
+
 void
 compress_chunk_populate_sort_info_for_column(const CompressionSettings *settings, Oid table,
 											 const char *attname, AttrNumber *att_nums,
@@ -770,9 +1302,28 @@ build_column_map(const CompressionSettings *settings, Relation uncompressed_tabl
 			Ensure(!is_orderby || batch_minmax_builder != NULL,
 				   "orderby columns must have minmax metadata");
 
+			AttrNumber bloom_attr_number =
+				compressed_column_metadata_attno(settings,
+												 uncompressed_table->rd_id,
+												 attr->attnum,
+												 compressed_table->rd_id,
+												 "bloom1");
+			BatchMetadataBuilder *batch_bloom1_builder = NULL;
+			if (bloom_attr_number != InvalidAttrNumber)
+			{
+				Ensure(batch_minmax_builder == NULL,
+					   "column cannot have both minmax and bloom1 metadata");
+				batch_bloom1_builder =
+					batch_metadata_builder_bloom1_create(attr->atttypid,
+														 attr->attcollation,
+														 AttrNumberGetAttrOffset(
+															 bloom_attr_number));
+			}
+
 			*column = (PerColumn){
-				.compressor = compressor_for_type(attr->atttypid),
-				.metadata_builder = batch_minmax_builder,
+				.compressor = compressor_for_type(attr->atttypid, column_block_codec(attr)),
+				.metadata_builder = batch_minmax_builder != NULL ? batch_minmax_builder :
+																   batch_bloom1_builder,
 				.segmentby_column_index = -1,
 			};
 		}
@@ -822,8 +1373,11 @@ row_compressor_init(const CompressionSettings *settings, RowCompressor *row_comp
 		.compressed_values = palloc(sizeof(Datum) * num_columns_in_compressed_table),
 		.compressed_is_null = palloc(sizeof(bool) * num_columns_in_compressed_table),
 		.rows_compressed_into_current_value = 0,
+		.max_batch_rows = (uint32) ts_guc_compression_batch_size_limit,
 		.rowcnt_pre_compression = 0,
 		.num_compressed_rows = 0,
+		.num_memory_limited_batches = 0,
+		.peak_batch_memory = 0,
 		.first_iteration = true,
 		.insert_options = insert_options,
 	};
@@ -881,9 +1435,39 @@ row_compressor_append_sorted_rows(RowCompressor *row_compressor, Tuplesortstate
 	ExecDropSingleTupleTableSlot(slot);
 }
 
-static void
-row_compressor_process_ordered_slot(RowCompressor *row_compressor, TupleTableSlot *slot,
-									CommandId mycid)
+/*
+ * Check whether the compressors use more memory for the current batch than
+ * allowed by the batch memory limit. The compressors accumulate the values of
+ * the batch in the per-row memory context, which is reset on every flush, so
+ * its size is the memory used by the batch.
+ */
+static bool
+row_compressor_batch_memory_is_full(RowCompressor *row_compressor)
+{
+	Size allocated;
+
+	if (row_compressor->rows_compressed_into_current_value == 0)
+		return false;
+
+	allocated = MemoryContextMemAllocated(row_compressor->per_row_ctx, true);
+	if (allocated > row_compressor->peak_batch_memory)
+		row_compressor->peak_batch_memory = allocated;
+
+	return ts_guc_compression_batch_memory_limit > 0 &&
+		   allocated >= (Size) ts_guc_compression_batch_memory_limit * 1024;
+}
+
+/*
+ * Add a row to the compressed batch, flushing the current batch first if the
+ * row doesn't fit into it. The rows have to be added in the compression
+ * order.
+ *
+ * Unlike row_compressor_process_ordered_slot(), the slot is not cleared, so
+ * the caller can still use the row.
+ */
+void
+row_compressor_append_ordered_slot(RowCompressor *row_compressor, TupleTableSlot *slot,
+								   CommandId mycid)
 {
 	MemoryContext old_ctx;
 	slot_getallattrs(slot);
@@ -894,8 +1478,14 @@ row_compressor_process_ordered_slot(RowCompressor *row_compressor, TupleTableSlo
 		row_compressor->first_iteration = false;
 	}
 	bool changed_groups = row_compressor_new_row_is_in_new_group(row_compressor, slot);
-	bool compressed_row_is_full = row_compressor->rows_compressed_into_current_value >=
-								  (uint32) ts_guc_compression_batch_size_limit;
+	bool compressed_row_is_full =
+		row_compressor->rows_compressed_into_current_value >= row_compressor->max_batch_rows;
+	bool memory_is_full = row_compressor_batch_memory_is_full(row_compressor);
+	if (memory_is_full && !compressed_row_is_full && !changed_groups)
+	{
+		compressed_row_is_full = true;
+		row_compressor->num_memory_limited_batches++;
+	}
 	if (compressed_row_is_full || changed_groups)
 	{
 		if (row_compressor->rows_compressed_into_current_value > 0)
@@ -906,9 +1496,26 @@ row_compressor_process_ordered_slot(RowCompressor *row_compressor, TupleTableSlo
 
 	row_compressor_append_row(row_compressor, slot);
 	MemoryContextSwitchTo(old_ctx);
+}
+
+static void
+row_compressor_process_ordered_slot(RowCompressor *row_compressor, TupleTableSlot *slot,
+									CommandId mycid)
+{
+	row_compressor_append_ordered_slot(row_compressor, slot, mycid);
 	ExecClearTuple(slot);
 }
 
+/*
+ * Flush the last batch after all the rows are added.
+ */
+void
+row_compressor_finish(RowCompressor *row_compressor, CommandId mycid)
+{
+	if (row_compressor->rows_compressed_into_current_value > 0)
+		row_compressor_flush(row_compressor, mycid, true);
+}
+
 static void
 row_compressor_update_group(RowCompressor *row_compressor, TupleTableSlot *row)
 {
@@ -1004,11 +1611,65 @@ row_compressor_append_row(RowCompressor *row_compressor, TupleTableSlot *row)
 	row_compressor->rows_compressed_into_current_value += 1;
 }
 
+/*
+ * Make the heap store the compressed columns of the batch out of line.
+ *
+ * The heap moves columns to the TOAST table only for tuples that are larger
+ * than TOAST_TUPLE_THRESHOLD or that have external values. Then it moves
+ * them until the tuple fits the toast_tuple_target of the compressed chunk,
+ * which is small (see set_toast_tuple_target_on_chunk()). To get there also
+ * for smaller tuples, the biggest compressed column is passed as an indirect
+ * pointer. The heap copies in-memory external values back before toasting,
+ * so nothing is left behind in the TOAST table.
+ *
+ * Returns the attribute offset of the replaced column, or -1 if there is no
+ * compressed column in the batch.
+ */
+static int
+row_compressor_force_toast(RowCompressor *row_compressor, struct varlena *indirect)
+{
+	int biggest_col = -1;
+	Size biggest_size = 0;
+
+	for (int col = 0; col < row_compressor->n_input_columns; col++)
+	{
+		const PerColumn *column = &row_compressor->per_column[col];
+		const int16 compressed_col = row_compressor->uncompressed_col_to_compressed_col[col];
+
+		if (column->compressor == NULL || row_compressor->compressed_is_null[compressed_col])
+			continue;
+
+		const Size size =
+			VARSIZE_ANY(DatumGetPointer(row_compressor->compressed_values[compressed_col]));
+
+		if (size > biggest_size)
+		{
+			biggest_col = compressed_col;
+			biggest_size = size;
+		}
+	}
+
+	if (biggest_col >= 0)
+	{
+		struct varatt_indirect redirect_pointer = {
+			.pointer = (struct varlena *) DatumGetPointer(
+				row_compressor->compressed_values[biggest_col]),
+		};
+
+		SET_VARTAG_EXTERNAL(indirect, VARTAG_INDIRECT);
+		memcpy(VARDATA_EXTERNAL(indirect), &redirect_pointer, sizeof(redirect_pointer));
+	}
+
+	return biggest_col;
+}
+
 static void
 row_compressor_flush(RowCompressor *row_compressor, CommandId mycid, bool changed_groups)
 {
 	HeapTuple compressed_tuple;
 
+	TIMESCALEDB_COMPRESS_FLUSH_START(row_compressor->rows_compressed_into_current_value);
+
 	for (int col = 0; col < row_compressor->n_input_columns; col++)
 	{
 		PerColumn *column = &row_compressor->per_column[col];
@@ -1057,20 +1718,52 @@ row_compressor_flush(RowCompressor *row_compressor, CommandId mycid, bool change
 		Int32GetDatum(row_compressor->rows_compressed_into_current_value);
 	row_compressor->compressed_is_null[row_compressor->count_metadata_column_offset] = false;
 
+	int indirect_col = -1;
+	Datum indirect_value = 0;
+	union
+	{
+		struct varlena hdr;
+		char data[INDIRECT_POINTER_SIZE];
+	} indirect;
+
+	if (ts_guc_compression_force_toast)
+	{
+		indirect_col = row_compressor_force_toast(row_compressor, &indirect.hdr);
+		if (indirect_col >= 0)
+		{
+			indirect_value = row_compressor->compressed_values[indirect_col];
+			row_compressor->compressed_values[indirect_col] = PointerGetDatum(&indirect);
+		}
+	}
+
 	compressed_tuple = heap_form_tuple(RelationGetDescr(row_compressor->compressed_table),
 									   row_compressor->compressed_values,
 									   row_compressor->compressed_is_null);
-	Assert(row_compressor->bistate != NULL);
-	heap_insert(row_compressor->compressed_table,
-				compressed_tuple,
-				mycid,
-				row_compressor->insert_options /*=options*/,
-				row_compressor->bistate);
-	if (row_compressor->resultRelInfo->ri_NumIndices > 0)
+
+	/* The compressed value is freed below */
+	if (indirect_col >= 0)
+		row_compressor->compressed_values[indirect_col] = indirect_value;
+
+	if (row_compressor->page_writer != NULL)
 	{
-		ts_catalog_index_insert(row_compressor->resultRelInfo, compressed_tuple);
+		/* The indexes are rebuilt after all pages are written */
+		bulk_page_writer_insert(row_compressor->page_writer, compressed_tuple, mycid);
+	}
+	else
+	{
+		Assert(row_compressor->bistate != NULL);
+		heap_insert(row_compressor->compressed_table,
+					compressed_tuple,
+					mycid,
+					row_compressor->insert_options /*=options*/,
+					row_compressor->bistate);
+		if (row_compressor->resultRelInfo->ri_NumIndices > 0)
+		{
+			ts_catalog_index_insert(row_compressor->resultRelInfo, compressed_tuple);
+		}
 	}
 
+	row_compressor->flushed_tid = compressed_tuple->t_self;
 	heap_freetuple(compressed_tuple);
 
 	/* free the compressed values now that we're done with them (the old compressor is freed in
@@ -1107,6 +1800,8 @@ row_compressor_flush(RowCompressor *row_compressor, CommandId mycid, bool change
 		row_compressor->on_flush(row_compressor,
 								 row_compressor->rows_compressed_into_current_value);
 
+	TIMESCALEDB_COMPRESS_FLUSH_DONE(row_compressor->rows_compressed_into_current_value);
+
 	row_compressor->rowcnt_pre_compression += row_compressor->rows_compressed_into_current_value;
 	row_compressor->num_compressed_rows++;
 	row_compressor->rows_compressed_into_current_value = 0;
@@ -1219,7 +1914,8 @@ build_decompressor(Relation in_rel, Relation out_rel)
 		.out_rel = out_rel,
 		.indexstate = CatalogOpenIndexes(out_rel),
 
-		.mycid = GetCurrentCommandId(true),
+		/* The parallel workers of decompress_chunk() only read */
+		.mycid = GetCurrentCommandId(!IsParallelWorker()),
 		.bistate = GetBulkInsertState(),
 
 		.compressed_datums = palloc(sizeof(Datum) * in_desc->natts),
@@ -1236,6 +1932,7 @@ build_decompressor(Relation in_rel, Relation out_rel)
 
 		.decompressed_slots =
 			(TupleTableSlot **) palloc0(sizeof(void *) * TARGET_COMPRESSED_BATCH_SIZE),
+		.num_decompressed_slots = TARGET_COMPRESSED_BATCH_SIZE,
 	};
 
 	create_per_compressed_column(&decompressor);
@@ -1291,6 +1988,26 @@ decompress_chunk(Oid in_table, Oid out_table)
 	Relation in_rel = table_open(in_table, ExclusiveLock);
 	int64 nrows_processed = 0;
 
+	/*
+	 * The parallel decompression inserts only into the heap, so the indexes
+	 * are rebuilt at the end, which can use a parallel index build as well.
+	 */
+	int nworkers = compression_parallel_decompress_plan_workers(in_rel, out_rel);
+
+	if (nworkers > 0 && compression_parallel_decompress(in_rel, out_rel, nworkers))
+	{
+		ReindexParams params = { 0 };
+		instr_time start;
+
+		table_close(out_rel, NoLock);
+		table_close(in_rel, NoLock);
+
+		ts_job_phase_start(&start);
+		reindex_relation_compat(NULL, out_table, 0, &params);
+		ts_job_phase_end("index_rebuild", &start);
+		return;
+	}
+
 	RowDecompressor decompressor = build_decompressor(in_rel, out_rel);
 	TupleTableSlot *slot = table_slot_create(in_rel, NULL);
 	TableScanDesc scan = table_beginscan(in_rel, GetLatestSnapshot(), 0, (ScanKey) NULL);
@@ -1472,6 +2189,22 @@ decompress_batch(RowDecompressor *decompressor)
 	CheckCompressedData(n_batch_rows > 0);
 	CheckCompressedData(n_batch_rows <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
 
+	/*
+	 * The batches can be larger than the default batch size when compressed
+	 * with a larger compression_batch_size_limit.
+	 */
+	if (n_batch_rows > decompressor->num_decompressed_slots)
+	{
+		const int old_num_slots = decompressor->num_decompressed_slots;
+
+		decompressor->decompressed_slots =
+			repalloc(decompressor->decompressed_slots, sizeof(void *) * n_batch_rows);
+		memset(&decompressor->decompressed_slots[old_num_slots],
+			   0,
+			   sizeof(void *) * (n_batch_rows - old_num_slots));
+		decompressor->num_decompressed_slots = n_batch_rows;
+	}
+
 	/*
 	 * Decompress all compressed columns for each row of the batch.
 	 */
@@ -1608,6 +2341,27 @@ row_decompressor_decompress_row_to_table(RowDecompressor *decompressor)
 	return n_batch_rows;
 }
 
+/*
+ * Decompress the current compressed batch and send the rows to the
+ * receiver. Used by the parallel workers of decompress_chunk(), which pass
+ * the rows to the leader for inserting them.
+ */
+int
+row_decompressor_decompress_row_to_dest(RowDecompressor *decompressor, DestReceiver *dest)
+{
+	const int n_batch_rows = decompress_batch(decompressor);
+
+	MemoryContext old_ctx = MemoryContextSwitchTo(decompressor->per_compressed_row_ctx);
+
+	for (int row = 0; row < n_batch_rows; row++)
+		dest->receiveSlot(decompressor->decompressed_slots[row], dest);
+
+	MemoryContextSwitchTo(old_ctx);
+	row_decompressor_reset(decompressor);
+
+	return n_batch_rows;
+}
+
 void
 row_decompressor_decompress_row_to_tuplesort(RowDecompressor *decompressor,
 											 Tuplesortstate *tuplesortstate)
@@ -1845,6 +2599,24 @@ tsl_compressed_data_info(PG_FUNCTION_ARGS)
 		case COMPRESSION_ALGORITHM_NULL:
 			has_nulls = true;
 			break;
+		case COMPRESSION_ALGORITHM_FOR:
+			has_nulls = for_compressed_has_nulls(header);
+			break;
+		case COMPRESSION_ALGORITHM_ALP:
+			has_nulls = alp_compressed_has_nulls(header);
+			break;
+		case COMPRESSION_ALGORITHM_FSST:
+			has_nulls = fsst_compressed_has_nulls(header);
+			break;
+		case COMPRESSION_ALGORITHM_BLOCK:
+			has_nulls = block_codec_compressed_has_nulls(header);
+			break;
+		case COMPRESSION_ALGORITHM_UUID:
+			has_nulls = uuid_compressed_has_nulls(header);
+			break;
+		case COMPRESSION_ALGORITHM_JSONB:
+			has_nulls = jsonb_shred_compressed_has_nulls(header);
+			break;
 		default:
 			elog(ERROR, "unknown compression algorithm %d", header->compression_algorithm);
 			break;
@@ -1889,6 +2661,24 @@ tsl_compressed_data_has_nulls(PG_FUNCTION_ARGS)
 		case COMPRESSION_ALGORITHM_NULL:
 			has_nulls = true;
 			break;
+		case COMPRESSION_ALGORITHM_FOR:
+			has_nulls = for_compressed_has_nulls(header);
+			break;
+		case COMPRESSION_ALGORITHM_ALP:
+			has_nulls = alp_compressed_has_nulls(header);
+			break;
+		case COMPRESSION_ALGORITHM_FSST:
+			has_nulls = fsst_compressed_has_nulls(header);
+			break;
+		case COMPRESSION_ALGORITHM_BLOCK:
+			has_nulls = block_codec_compressed_has_nulls(header);
+			break;
+		case COMPRESSION_ALGORITHM_UUID:
+			has_nulls = uuid_compressed_has_nulls(header);
+			break;
+		case COMPRESSION_ALGORITHM_JSONB:
+			has_nulls = jsonb_shred_compressed_has_nulls(header);
+			break;
 		default:
 			elog(ERROR, "unknown compression algorithm %d", header->compression_algorithm);
 			break;
@@ -1905,6 +2695,24 @@ compression_get_toast_storage(CompressionAlgorithm algorithm)
 	return definitions[algorithm].compressed_data_storage;
 }
 
+/*
+ * Get the storage of the compressed data of the given column of the
+ * uncompressed relation. The data wrapped by the block codec is already
+ * compressed, so we don't want TOAST to compress it again.
+ */
+CompressionStorage
+compression_get_column_toast_storage(Form_pg_attribute attr)
+{
+	CompressionAlgorithm algorithm = compression_get_default_algorithm(attr->atttypid);
+
+	if ((algorithm == COMPRESSION_ALGORITHM_ARRAY ||
+		 algorithm == COMPRESSION_ALGORITHM_DICTIONARY) &&
+		column_block_codec(attr) != BLOCK_CODEC_NONE)
+		return compression_get_toast_storage(COMPRESSION_ALGORITHM_BLOCK);
+
+	return compression_get_toast_storage(algorithm);
+}
+
 /*
  * Return a default compression algorithm suitable
  * for the type. The actual algorithm used for a
@@ -1951,6 +2759,99 @@ compression_get_default_algorithm(Oid typeoid)
 	}
 }
 
+/*
+ * Whether the compressor should try the given candidate algorithm for a
+ * batch, in addition to the default algorithm for the type.
+ */
+bool
+compression_candidate_enabled(CompressionAlgorithm algorithm)
+{
+	if (ts_guc_enable_adaptive_compression)
+		return true;
+
+	switch (algorithm)
+	{
+		case COMPRESSION_ALGORITHM_FOR:
+			return ts_guc_enable_for_compression;
+		case COMPRESSION_ALGORITHM_ALP:
+			return ts_guc_enable_alp_compression;
+		case COMPRESSION_ALGORITHM_FSST:
+			return ts_guc_enable_fsst_compression;
+		case COMPRESSION_ALGORITHM_UUID:
+			return ts_guc_enable_uuid_compression;
+		case COMPRESSION_ALGORITHM_DICTIONARY:
+			/*
+			 * The dictionary is the default algorithm for the other types, so
+			 * this is only about the fixed-width ones.
+			 */
+			return ts_guc_enable_fixed_dictionary_compression;
+		default:
+			return true;
+	}
+}
+
+/*
+ * The relative cost of decompressing the data of each algorithm, as a
+ * percentage of the size that we are willing to trade for it with the
+ * balanced objective. These are rough numbers from the bulk decompression
+ * benchmarks, they only have to put the algorithms in the right order.
+ */
+static const uint32 compression_algorithm_decompression_cost[] = {
+	[_INVALID_COMPRESSION_ALGORITHM] = 0,
+	[COMPRESSION_ALGORITHM_ARRAY] = 10,
+	[COMPRESSION_ALGORITHM_DICTIONARY] = 10,
+	[COMPRESSION_ALGORITHM_GORILLA] = 40,
+	[COMPRESSION_ALGORITHM_DELTADELTA] = 20,
+	[COMPRESSION_ALGORITHM_BOOL] = 0,
+	[COMPRESSION_ALGORITHM_NULL] = 0,
+	[COMPRESSION_ALGORITHM_FOR] = 5,
+	[COMPRESSION_ALGORITHM_ALP] = 15,
+	[COMPRESSION_ALGORITHM_FSST] = 40,
+	[COMPRESSION_ALGORITHM_BLOCK] = 30,
+	[COMPRESSION_ALGORITHM_UUID] = 20,
+	[COMPRESSION_ALGORITHM_JSONB] = 40,
+};
+
+StaticAssertDecl(lengthof(compression_algorithm_decompression_cost) ==
+					 _END_COMPRESSION_ALGORITHMS,
+				 "missing decompression cost for a compression algorithm");
+
+/*
+ * Whether the candidate compressed data of a batch is better than the current
+ * one, according to timescaledb.compression_objective. With the size
+ * objective, this is just the comparison of sizes. The other objectives
+ * penalize the size by the decompression cost of the algorithm, so that a
+ * faster algorithm can win even if its result is somewhat larger.
+ */
+bool
+compression_candidate_is_better(CompressionAlgorithm candidate, Size candidate_size,
+								CompressionAlgorithm current, Size current_size)
+{
+	Assert(candidate > 0 && candidate < _END_COMPRESSION_ALGORITHMS);
+	Assert(current > 0 && current < _END_COMPRESSION_ALGORITHMS);
+
+	uint64 weight;
+	switch (ts_guc_compression_objective)
+	{
+		case COMPRESSION_OBJECTIVE_BALANCED:
+			weight = 1;
+			break;
+		case COMPRESSION_OBJECTIVE_SPEED:
+			weight = 4;
+			break;
+		default:
+			weight = 0;
+			break;
+	}
+
+	const uint64 candidate_score =
+		(uint64) candidate_size *
+		(100 + weight * compression_algorithm_decompression_cost[candidate]);
+	const uint64 current_score =
+		(uint64) current_size * (100 + weight * compression_algorithm_decompression_cost[current]);
+	return candidate_score < current_score;
+}
+
 const CompressionAlgorithmDefinition *
 algorithm_definition(CompressionAlgorithm algo)
 {
@@ -11,9 +11,11 @@
 #include <fmgr.h>
 #include <lib/stringinfo.h>
 #include <nodes/execnodes.h>
+#include <tcop/dest.h>
 #include <utils/relcache.h>
 
 typedef struct BulkInsertStateData *BulkInsertState;
+typedef struct BulkPageWriter BulkPageWriter;
 
 #include "compat/compat.h"
 #include "batch_metadata_builder_minmax.h"
@@ -151,6 +153,7 @@ typedef struct RowDecompressor
 	int64 batches_deleted;
 
 	TupleTableSlot **decompressed_slots;
+	int num_decompressed_slots;
 	int unprocessed_tuples;
 
 	Detoaster detoaster;
@@ -195,6 +198,12 @@ typedef enum CompressionAlgorithm
 	COMPRESSION_ALGORITHM_DELTADELTA,
 	COMPRESSION_ALGORITHM_BOOL,
 	COMPRESSION_ALGORITHM_NULL,
+	COMPRESSION_ALGORITHM_FOR,
+	COMPRESSION_ALGORITHM_ALP,
+	COMPRESSION_ALGORITHM_FSST,
+	COMPRESSION_ALGORITHM_BLOCK,
+	COMPRESSION_ALGORITHM_UUID,
+	COMPRESSION_ALGORITHM_JSONB,
 
 	/* When adding an algorithm also add a static assert statement below */
 	/* end of real values */
@@ -207,6 +216,9 @@ typedef struct CompressionStats
 	int64 rowcnt_pre_compression;
 	int64 rowcnt_post_compression;
 	int64 rowcnt_frozen;
+	/* number of batches cut at the memory limit, and the largest batch memory */
+	int64 memory_limited_batches;
+	Size peak_batch_memory;
 } CompressionStats;
 
 typedef struct PerColumn
@@ -214,8 +226,8 @@ typedef struct PerColumn
 	/* the compressor to use for regular columns, NULL for segmenters */
 	Compressor *compressor;
 	/*
-	 * Information on the metadata we'll store for this column (currently only min/max).
-	 * Only used for order-by columns right now, will be {-1, NULL} for others.
+	 * Information on the metadata we'll store for this column, either min/max
+	 * or a bloom filter. NULL for the columns without sparse indexes.
 	 */
 	BatchMetadataBuilder *metadata_builder;
 
@@ -232,6 +244,8 @@ typedef struct RowCompressor
 	/* the table we're writing the compressed data to */
 	Relation compressed_table;
 	BulkInsertState bistate;
+	/* writes the pages of a new compressed table directly, or NULL */
+	BulkPageWriter *page_writer;
 	/* segment by index Oid if any */
 	Oid index_oid;
 	/* relation info necessary to update indexes on compressed table */
@@ -254,6 +268,8 @@ typedef struct RowCompressor
 
 	/* the number of uncompressed rows compressed into the current compressed row */
 	uint32 rows_compressed_into_current_value;
+	/* the max number of uncompressed rows per compressed row */
+	uint32 max_batch_rows;
 	/* a unique monotonically increasing (according to order by) id for each compressed row */
 	int32 sequence_num;
 
@@ -262,10 +278,15 @@ typedef struct RowCompressor
 	bool *compressed_is_null;
 	int64 rowcnt_pre_compression;
 	int64 num_compressed_rows;
+	/* number of batches cut at the memory limit, and the largest batch memory */
+	int64 num_memory_limited_batches;
+	Size peak_batch_memory;
 	/* flag for checking if we are working on the first tuple */
 	bool first_iteration;
 	/* the heap insert options */
 	int insert_options;
+	/* TID of the last compressed tuple inserted */
+	ItemPointerData flushed_tid;
 
 	/* Callback called on every flush. The ntuples argument is the number of
 	 * tuples flushed. Typically used for progress reporting. */
@@ -293,6 +314,8 @@ typedef struct BatchFilter
 	bool is_null_check;
 	bool is_null;
 	bool is_array_op;
+	/* The column is the bloom filter sparse index, check the value against it */
+	bool is_bloom1;
 } BatchFilter;
 
 extern Datum tsl_compressed_data_decompress_forward(PG_FUNCTION_ARGS);
@@ -319,21 +342,33 @@ pg_attribute_unused() assert_num_compression_algorithms_sane(void)
 	StaticAssertStmt(COMPRESSION_ALGORITHM_DELTADELTA == 4, "algorithm index has changed");
 	StaticAssertStmt(COMPRESSION_ALGORITHM_BOOL == 5, "algorithm index has changed");
 	StaticAssertStmt(COMPRESSION_ALGORITHM_NULL == 6, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_FOR == 7, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_ALP == 8, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_FSST == 9, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_BLOCK == 10, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_UUID == 11, "algorithm index has changed");
+	StaticAssertStmt(COMPRESSION_ALGORITHM_JSONB == 12, "algorithm index has changed");
 
 	/*
 	 * This should change when adding a new algorithm after adding the new
 	 * algorithm to the assert list above. This statement prevents adding a
 	 * new algorithm without updating the asserts above
 	 */
-	StaticAssertStmt(_END_COMPRESSION_ALGORITHMS == 7,
+	StaticAssertStmt(_END_COMPRESSION_ALGORITHMS == 13,
 					 "number of algorithms have changed, the asserts should be updated");
 }
 
 extern Name compression_get_algorithm_name(CompressionAlgorithm alg);
 extern CompressionStorage compression_get_toast_storage(CompressionAlgorithm algo);
+extern CompressionStorage compression_get_column_toast_storage(Form_pg_attribute attr);
 extern CompressionAlgorithm compression_get_default_algorithm(Oid typeoid);
+extern bool compression_candidate_enabled(CompressionAlgorithm algorithm);
+extern bool compression_candidate_is_better(CompressionAlgorithm candidate, Size candidate_size,
+											CompressionAlgorithm current, Size current_size);
 
 extern CompressionStats compress_chunk(Oid in_table, Oid out_table, int insert_options);
+extern CompressionStats compress_chunk_slice(Oid in_table, Oid out_table, int64 max_rows,
+											 int insert_options, bool *has_more);
 extern void decompress_chunk(Oid in_table, Oid out_table);
 
 extern DecompressionIterator *(*tsl_get_decompression_iterator_init(
@@ -344,7 +379,7 @@ extern DecompressAllFunction tsl_get_decompress_all_function(CompressionAlgorith
 
 typedef struct Chunk Chunk;
 typedef struct ChunkInsertState ChunkInsertState;
-extern void decompress_batches_for_insert(const ChunkInsertState *cis, TupleTableSlot *slot);
+extern void decompress_batches_for_insert(ChunkInsertState *cis, TupleTableSlot *slot);
 typedef struct HypertableModifyState HypertableModifyState;
 extern bool decompress_target_segments(HypertableModifyState *ht_state);
 /* CompressSingleRowState methods */
@@ -358,12 +393,17 @@ extern TupleTableSlot *compress_row_exec(CompressSingleRowState *cr, TupleTableS
 extern void compress_row_end(CompressSingleRowState *cr);
 extern void compress_row_destroy(CompressSingleRowState *cr);
 extern int row_decompressor_decompress_row_to_table(RowDecompressor *row_decompressor);
+extern int row_decompressor_decompress_row_to_dest(RowDecompressor *row_decompressor,
+												   DestReceiver *dest);
 extern void row_decompressor_decompress_row_to_tuplesort(RowDecompressor *row_decompressor,
 														 Tuplesortstate *tuplesortstate);
 extern void compress_chunk_populate_sort_info_for_column(const CompressionSettings *settings,
 														 Oid table, const char *attname,
 														 AttrNumber *att_nums, Oid *sort_operator,
 														 Oid *collation, bool *nulls_first);
+extern int compression_get_sort_keys(CompressionSettings *settings, Relation rel,
+									 AttrNumber **sort_keys_out, Oid **sort_operators_out,
+									 Oid **sort_collations_out, bool **nulls_first_out);
 extern Tuplesortstate *compression_create_tuplesort_state(CompressionSettings *settings,
 														  Relation rel);
 extern void row_compressor_init(const CompressionSettings *settings, RowCompressor *row_compressor,
@@ -375,6 +415,9 @@ extern void row_compressor_close(RowCompressor *row_compressor);
 extern void row_compressor_append_sorted_rows(RowCompressor *row_compressor,
 											  Tuplesortstate *sorted_rel, TupleDesc sorted_desc,
 											  Relation in_rel);
+extern void row_compressor_append_ordered_slot(RowCompressor *row_compressor,
+											   TupleTableSlot *slot, CommandId mycid);
+extern void row_compressor_finish(RowCompressor *row_compressor, CommandId mycid);
 extern Oid get_compressed_chunk_index(ResultRelInfo *resultRelInfo,
 									  const CompressionSettings *settings);
 
@@ -427,4 +470,6 @@ struct decompress_batches_stats
 	int64 batches_filtered;
 	int64 batches_decompressed;
 	int64 tuples_decompressed;
+	int64 batches_updated;
+	int64 tuples_updated;
 };
@@ -5,10 +5,14 @@
  */
 #include <postgres.h>
 #include <access/genam.h>
+#include <access/hash.h>
+#include <access/htup_details.h>
 #include <access/sdir.h>
+#include <access/sysattr.h>
 #include <access/tableam.h>
 #include <access/valid.h>
 #include <catalog/pg_am.h>
+#include <nodes/makefuncs.h>
 #include <nodes/nodeFuncs.h>
 #include <optimizer/optimizer.h>
 #include <parser/parse_coerce.h>
@@ -20,6 +24,7 @@
 #include <utils/typcache.h>
 
 #include <compat/compat.h>
+#include <compression/arrow_c_data_interface.h>
 #include <compression/compression.h>
 #include <compression/compression_dml.h>
 #include <compression/create.h>
@@ -28,22 +33,42 @@
 #include <indexing.h>
 #include <nodes/chunk_dispatch/chunk_dispatch.h>
 #include <nodes/chunk_dispatch/chunk_insert_state.h>
+#include <nodes/decompress_chunk/vector_quals.h>
 #include <nodes/hypertable_modify.h>
 #include <ts_catalog/array_utils.h>
+#include <ts_catalog/catalog.h>
+
+/*
+ * The new values of the segmentby columns for the direct update of the
+ * compressed batches.
+ */
+typedef struct BatchUpdateValues
+{
+	int num_columns;
+	/* Attribute numbers of the updated columns in the compressed chunk */
+	AttrNumber *attnos;
+	Datum *values;
+	bool *isnull;
+} BatchUpdateValues;
 
 static struct decompress_batches_stats
 decompress_batches_scan(Relation in_rel, Relation out_rel, Relation index_rel, Snapshot snapshot,
 						ScanKeyData *index_scankeys, int num_index_scankeys,
 						ScanKeyData *heap_scankeys, int num_heap_scankeys,
-						ScanKeyData *mem_scankeys, int num_mem_scankeys,
+						ScanKeyData *mem_scankeys, int num_mem_scankeys, List *vector_quals,
 						tuple_filtering_constraints *constraints, bool *skip_current_tuple,
-						bool delete_only, Bitmapset *null_columns, List *is_nulls);
+						bool delete_only, BatchUpdateValues *update_values,
+						Bitmapset *null_columns, List *is_nulls);
 
 static bool batch_matches(RowDecompressor *decompressor, ScanKeyData *scankeys, int num_scankeys,
 						  tuple_filtering_constraints *constraints, bool *skip_current_tuple);
+static bool batch_keys_may_match(RowDecompressor *decompressor, ScanKeyData *scankeys,
+								 int num_scankeys);
+static bool batch_vector_quals_match(RowDecompressor *decompressor, List *vector_quals);
 static void process_predicates(Chunk *ch, CompressionSettings *settings, List *predicates,
 							   ScanKeyData **mem_scankeys, int *num_mem_scankeys,
-							   List **heap_filters, List **index_filters, List **is_null);
+							   List **vector_quals, List **heap_filters, List **index_filters,
+							   List **is_null);
 static Relation find_matching_index(Relation comp_chunk_rel, List **index_filters,
 									List **heap_filters);
 static tuple_filtering_constraints *
@@ -53,6 +78,10 @@ static BatchFilter *make_batchfilter(char *column_name, StrategyNumber strategy,
 									 bool is_null, bool is_array_op);
 static inline TM_Result delete_compressed_tuple(RowDecompressor *decompressor, Snapshot snapshot,
 												HeapTuple compressed_tuple);
+static TM_Result update_compressed_tuple(RowDecompressor *decompressor, Snapshot snapshot,
+										 HeapTuple compressed_tuple,
+										 BatchUpdateValues *update_values,
+										 CatalogIndexState indexstate);
 static void report_error(TM_Result result);
 
 static bool key_column_is_null(tuple_filtering_constraints *constraints, Relation chunk_rel,
@@ -60,9 +89,52 @@ static bool key_column_is_null(tuple_filtering_constraints *constraints, Relatio
 static bool can_delete_without_decompression(HypertableModifyState *ht_state,
 											 CompressionSettings *settings, Chunk *chunk,
 											 List *predicates);
+static bool predicates_use_only_segmentby(CompressionSettings *settings, Chunk *chunk,
+										  List *predicates);
+static BatchUpdateValues *get_direct_batch_update_values(HypertableModifyState *ht_state,
+														 CompressionSettings *settings,
+														 Chunk *chunk, Relation chunk_rel,
+														 Relation comp_chunk_rel,
+														 Plan *scan_plan, EState *estate,
+														 List *predicates);
+
+/*
+ * The unique constraints and the compression settings of a chunk, for
+ * checking the rows inserted into the compressed chunk. They don't change
+ * during the statement, so we look them up for the first row, instead of
+ * opening all the indexes and scanning the settings catalog for every row.
+ */
+struct CompressedInsertCheck
+{
+	bool has_unique_index;
+	tuple_filtering_constraints *constraints;
+	CompressionSettings *settings;
+};
+
+static CompressedInsertCheck *
+get_compressed_insert_check(ChunkInsertState *cis)
+{
+	if (cis->compressed_insert_check == NULL)
+	{
+		MemoryContext old_mcxt = MemoryContextSwitchTo(cis->mctx);
+		CompressedInsertCheck *check = palloc0(sizeof(CompressedInsertCheck));
+
+		check->has_unique_index = ts_indexing_relation_has_primary_or_unique_index(cis->rel);
+		if (check->has_unique_index)
+		{
+			check->constraints = get_batch_keys_for_unique_constraints(cis, cis->rel);
+			check->settings = ts_compression_settings_get(RelationGetRelid(cis->rel));
+		}
+
+		MemoryContextSwitchTo(old_mcxt);
+		cis->compressed_insert_check = check;
+	}
+
+	return cis->compressed_insert_check;
+}
 
 void
-decompress_batches_for_insert(const ChunkInsertState *cis, TupleTableSlot *slot)
+decompress_batches_for_insert(ChunkInsertState *cis, TupleTableSlot *slot)
 {
 	/*
 	 * This is supposed to be called with the actual tuple that is being
@@ -71,8 +143,9 @@ decompress_batches_for_insert(const ChunkInsertState *cis, TupleTableSlot *slot)
 	Assert(!TTS_EMPTY(slot));
 
 	Relation out_rel = cis->rel;
+	CompressedInsertCheck *check = get_compressed_insert_check(cis);
 
-	if (!ts_indexing_relation_has_primary_or_unique_index(out_rel))
+	if (!check->has_unique_index)
 	{
 		/*
 		 * If there are no unique constraints there is nothing to do here.
@@ -86,7 +159,7 @@ decompress_batches_for_insert(const ChunkInsertState *cis, TupleTableSlot *slot)
 				 errmsg("inserting into compressed chunk with unique constraints disabled"),
 				 errhint("Set timescaledb.enable_dml_decompression to TRUE.")));
 
-	tuple_filtering_constraints *constraints = get_batch_keys_for_unique_constraints(cis, out_rel);
+	tuple_filtering_constraints *constraints = check->constraints;
 	if (key_column_is_null(constraints, out_rel, cis->hypertable_relid, slot))
 	{
 		/* When any key column is NULL and NULLs are distinct there is no
@@ -96,7 +169,7 @@ decompress_batches_for_insert(const ChunkInsertState *cis, TupleTableSlot *slot)
 		return;
 	}
 
-	CompressionSettings *settings = ts_compression_settings_get(RelationGetRelid(cis->rel));
+	CompressionSettings *settings = check->settings;
 	Assert(settings && OidIsValid(settings->fd.compress_relid));
 	Relation in_rel = relation_open(settings->fd.compress_relid, RowExclusiveLock);
 	Bitmapset *index_columns = NULL;
@@ -180,9 +253,11 @@ decompress_batches_for_insert(const ChunkInsertState *cis, TupleTableSlot *slot)
 									num_heap_scankeys,
 									mem_scankeys,
 									num_mem_scankeys,
+									NIL,
 									constraints,
 									&skip_current_tuple,
 									false,
+									NULL,
 									null_columns, /* no null column check for non-segmentby
 											 columns */
 									NIL);
@@ -216,7 +291,8 @@ decompress_batches_for_insert(const ChunkInsertState *cis, TupleTableSlot *slot)
  */
 static bool
 decompress_batches_for_update_delete(HypertableModifyState *ht_state, Chunk *chunk,
-									 List *predicates, EState *estate, bool has_joins)
+									 List *predicates, Plan *scan_plan, EState *estate,
+									 bool has_joins)
 {
 	/* process each chunk with its corresponding predicates */
 
@@ -237,6 +313,7 @@ decompress_batches_for_update_delete(HypertableModifyState *ht_state, Chunk *chu
 	struct decompress_batches_stats stats;
 	int num_mem_scankeys = 0;
 	ScanKeyData *mem_scankeys = NULL;
+	List *vector_quals = NIL;
 
 	CompressionSettings *settings = ts_compression_settings_get(chunk->table_id);
 	bool delete_only = ht_state->mt->operation == CMD_DELETE && !has_joins &&
@@ -247,6 +324,7 @@ decompress_batches_for_update_delete(HypertableModifyState *ht_state, Chunk *chu
 					   predicates,
 					   &mem_scankeys,
 					   &num_mem_scankeys,
+					   &vector_quals,
 					   &heap_filters,
 					   &index_filters,
 					   &is_null);
@@ -254,6 +332,21 @@ decompress_batches_for_update_delete(HypertableModifyState *ht_state, Chunk *chu
 	chunk_rel = table_open(chunk->table_id, RowExclusiveLock);
 	comp_chunk_rel = table_open(settings->fd.compress_relid, RowExclusiveLock);
 
+	BatchUpdateValues *update_values = NULL;
+	bool update_only = false;
+	if (ht_state->mt->operation == CMD_UPDATE && !has_joins)
+	{
+		update_values = get_direct_batch_update_values(ht_state,
+													   settings,
+													   chunk,
+													   chunk_rel,
+													   comp_chunk_rel,
+													   scan_plan,
+													   estate,
+													   predicates);
+		update_only = update_values != NULL;
+	}
+
 	if (index_filters)
 	{
 		matching_index_rel = find_matching_index(comp_chunk_rel, &index_filters, &heap_filters);
@@ -265,15 +358,27 @@ decompress_batches_for_update_delete(HypertableModifyState *ht_state, Chunk *chu
 												heap_filters,
 												&num_scankeys,
 												&null_columns,
-												&delete_only);
+												update_only ? &update_only : &delete_only);
 	}
 
+	/* Not all the filters could be applied to the compressed batches */
+	if (!update_only)
+		update_values = NULL;
+
 	if (matching_index_rel)
 	{
 		index_scankeys =
 			build_index_scankeys(matching_index_rel, index_filters, &num_index_scankeys);
 	}
 
+	/*
+	 * When all the row filters are vectorized, the vectorized filters alone
+	 * tell whether a batch has matching rows, so we don't have to test every
+	 * row of the batch.
+	 */
+	if (vector_quals != NIL && list_length(vector_quals) == num_mem_scankeys)
+		num_mem_scankeys = 0;
+
 	stats = decompress_batches_scan(comp_chunk_rel,
 									chunk_rel,
 									matching_index_rel,
@@ -284,9 +389,11 @@ decompress_batches_for_update_delete(HypertableModifyState *ht_state, Chunk *chu
 									num_scankeys,
 									mem_scankeys,
 									num_mem_scankeys,
+									vector_quals,
 									NULL,
 									NULL,
 									delete_only,
+									update_values,
 									null_columns,
 									is_null);
 
@@ -315,10 +422,17 @@ decompress_batches_for_update_delete(HypertableModifyState *ht_state, Chunk *chu
 		pfree(filter);
 	}
 	ht_state->batches_deleted += stats.batches_deleted;
+	ht_state->batches_updated += stats.batches_updated;
 	ht_state->batches_filtered += stats.batches_filtered;
 	ht_state->batches_decompressed += stats.batches_decompressed;
 	ht_state->tuples_decompressed += stats.tuples_decompressed;
 
+	/*
+	 * The rows of the batches updated in place are not seen by the
+	 * ModifyTable node, so count them here.
+	 */
+	estate->es_processed += stats.tuples_updated;
+
 	return stats.batches_decompressed > 0;
 }
 
@@ -395,13 +509,15 @@ static struct decompress_batches_stats
 decompress_batches_scan(Relation in_rel, Relation out_rel, Relation index_rel, Snapshot snapshot,
 						ScanKeyData *index_scankeys, int num_index_scankeys,
 						ScanKeyData *heap_scankeys, int num_heap_scankeys,
-						ScanKeyData *mem_scankeys, int num_mem_scankeys,
+						ScanKeyData *mem_scankeys, int num_mem_scankeys, List *vector_quals,
 						tuple_filtering_constraints *constraints, bool *skip_current_tuple,
-						bool delete_only, Bitmapset *null_columns, List *is_nulls)
+						bool delete_only, BatchUpdateValues *update_values,
+						Bitmapset *null_columns, List *is_nulls)
 {
 	HeapTuple compressed_tuple;
 	RowDecompressor decompressor;
 	bool decompressor_initialized = false;
+	CatalogIndexState update_indexstate = NULL;
 	bool valid = false;
 	int num_scanned_rows = 0;
 	int num_filtered_rows = 0;
@@ -501,6 +617,13 @@ decompress_batches_scan(Relation in_rel, Relation out_rel, Relation index_rel, S
 						  decompressor.compressed_datums,
 						  decompressor.compressed_is_nulls);
 
+		if (vector_quals != NIL && !batch_vector_quals_match(&decompressor, vector_quals))
+		{
+			row_decompressor_reset(&decompressor);
+			stats.batches_filtered++;
+			continue;
+		}
+
 		if (num_mem_scankeys && !batch_matches(&decompressor,
 											   mem_scankeys,
 											   num_mem_scankeys,
@@ -519,6 +642,35 @@ decompress_batches_scan(Relation in_rel, Relation out_rel, Relation index_rel, S
 			ExecDropSingleTupleTableSlot(slot);
 			return stats;
 		}
+
+		if (update_values)
+		{
+			/* The batches are updated in place, without decompressing them */
+			if (update_indexstate == NULL)
+				update_indexstate = CatalogOpenIndexes(in_rel);
+
+			result = update_compressed_tuple(&decompressor,
+											 snapshot,
+											 compressed_tuple,
+											 update_values,
+											 update_indexstate);
+			if (result == TM_Deleted && !IsolationUsesXactSnapshot())
+				continue;
+			if (result != TM_Ok)
+			{
+				CatalogCloseIndexes(update_indexstate);
+				row_decompressor_close(&decompressor);
+				decompress_batch_endscan(scan);
+				report_error(result);
+				return stats;
+			}
+
+			stats.batches_updated++;
+			stats.tuples_updated += DatumGetInt32(
+				decompressor.compressed_datums[decompressor.count_compressed_attindex]);
+			continue;
+		}
+
 		write_logical_replication_msg_decompression_start();
 		result = delete_compressed_tuple(&decompressor, snapshot, compressed_tuple);
 		/* skip reporting error if isolation level is < Repeatable Read
@@ -552,6 +704,8 @@ decompress_batches_scan(Relation in_rel, Relation out_rel, Relation index_rel, S
 	}
 	ExecDropSingleTupleTableSlot(slot);
 	decompress_batch_endscan(scan);
+	if (update_indexstate)
+		CatalogCloseIndexes(update_indexstate);
 	if (decompressor_initialized)
 	{
 		row_decompressor_close(&decompressor);
@@ -586,10 +740,328 @@ slot_keys_test(TupleTableSlot *slot, int nkeys, ScanKey keys)
 	return true;
 }
 
+/*
+ * Check whether the values of a column in the bulk decompressed form can be
+ * compared bitwise with the scan key value.
+ */
+static bool
+key_column_is_bitwise_comparable(Oid typid)
+{
+	switch (typid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Probe the key columns of the compressed batch without decompressing the
+ * entire batch. Only the key columns are bulk decompressed, and searched for
+ * the key values. The rows that match all the key columns are tracked in a
+ * bitmap, so that the batch can be skipped if no row matches.
+ *
+ * Returns false if the batch definitely has no matching rows. The key
+ * columns that can't be probed this way are left for the full check in
+ * batch_matches().
+ */
+static bool
+batch_keys_may_match(RowDecompressor *decompressor, ScanKeyData *scankeys, int num_scankeys)
+{
+	const int n_batch_rows =
+		DatumGetInt32(decompressor->compressed_datums[decompressor->count_compressed_attindex]);
+	CheckCompressedData(n_batch_rows > 0);
+	CheckCompressedData(n_batch_rows <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	const int num_words = (n_batch_rows + 63) / 64;
+	uint64 *matches = NULL;
+
+	MemoryContext old_ctx = MemoryContextSwitchTo(decompressor->per_compressed_row_ctx);
+
+	for (int key = 0; key < num_scankeys; key++)
+	{
+		ScanKey scankey = &scankeys[key];
+
+		/*
+		 * Only the plain equality keys can be probed. The NULL keys only
+		 * appear when the NULLs are not distinct.
+		 */
+		if (scankey->sk_flags != 0 || scankey->sk_strategy != BTEqualStrategyNumber)
+			continue;
+
+		PerCompressedColumn *column_info = NULL;
+		int input_column;
+		for (input_column = 0; input_column < decompressor->num_compressed_columns; input_column++)
+		{
+			if (decompressor->per_compressed_cols[input_column].decompressed_column_offset ==
+				AttrNumberGetAttrOffset(scankey->sk_attno))
+			{
+				column_info = &decompressor->per_compressed_cols[input_column];
+				break;
+			}
+		}
+
+		/* The column with the default value is checked in batch_matches() */
+		if (column_info == NULL || !column_info->is_compressed ||
+			decompressor->compressed_is_nulls[input_column] ||
+			!key_column_is_bitwise_comparable(column_info->decompressed_type) ||
+			(OidIsValid(scankey->sk_subtype) &&
+			 scankey->sk_subtype != column_info->decompressed_type))
+			continue;
+
+		Datum compressed_datum = PointerGetDatum(
+			detoaster_detoast_attr_copy((struct varlena *) DatumGetPointer(
+											decompressor->compressed_datums[input_column]),
+										&decompressor->detoaster,
+										CurrentMemoryContext));
+		CompressedDataHeader *header = (CompressedDataHeader *) DatumGetPointer(compressed_datum);
+		CheckCompressedData(header->compression_algorithm < _END_COMPRESSION_ALGORITHMS);
+
+		/* All values are NULL, so no row can match a non-null key */
+		if (header->compression_algorithm == COMPRESSION_ALGORITHM_NULL)
+		{
+			MemoryContextSwitchTo(old_ctx);
+			return false;
+		}
+
+		DecompressAllFunction decompress_all =
+			tsl_get_decompress_all_function(header->compression_algorithm,
+											column_info->decompressed_type);
+		if (decompress_all == NULL)
+			continue;
+
+		ArrowArray *arrow = decompress_all(compressed_datum,
+										   column_info->decompressed_type,
+										   CurrentMemoryContext);
+		if (arrow == NULL || arrow->dictionary != NULL)
+			continue;
+		CheckCompressedData(arrow->length == n_batch_rows);
+
+		const uint64 *validity = arrow->buffers[0];
+		const int16 typlen = get_typlen(column_info->decompressed_type);
+
+		if (matches == NULL)
+		{
+			matches = palloc(sizeof(uint64) * num_words);
+			memset(matches, 0xFF, sizeof(uint64) * num_words);
+		}
+
+		/* Build the bitmap of the rows that match the key value */
+		uint64 any_match = 0;
+		for (int word = 0; word < num_words; word++)
+		{
+			uint64 word_matches = 0;
+			const int end = Min(64, n_batch_rows - word * 64);
+			switch (typlen)
+			{
+				case 2:
+				{
+					const int16 *values = ((const int16 *) arrow->buffers[1]) + word * 64;
+					const int16 key_value = DatumGetInt16(scankey->sk_argument);
+					for (int i = 0; i < end; i++)
+						word_matches |= ((uint64) (values[i] == key_value)) << i;
+					break;
+				}
+				case 4:
+				{
+					const int32 *values = ((const int32 *) arrow->buffers[1]) + word * 64;
+					const int32 key_value = DatumGetInt32(scankey->sk_argument);
+					for (int i = 0; i < end; i++)
+						word_matches |= ((uint64) (values[i] == key_value)) << i;
+					break;
+				}
+				case 8:
+				{
+					const int64 *values = ((const int64 *) arrow->buffers[1]) + word * 64;
+					const int64 key_value = DatumGetInt64(scankey->sk_argument);
+					for (int i = 0; i < end; i++)
+						word_matches |= ((uint64) (values[i] == key_value)) << i;
+					break;
+				}
+				default:
+					pg_unreachable();
+			}
+			if (validity != NULL)
+				word_matches &= validity[word];
+			matches[word] &= word_matches;
+			any_match |= matches[word];
+		}
+
+		if (any_match == 0)
+		{
+			MemoryContextSwitchTo(old_ctx);
+			return false;
+		}
+	}
+
+	MemoryContextSwitchTo(old_ctx);
+	return true;
+}
+
+/*
+ * The state of the vectorized filters over a compressed batch that is being
+ * deleted or updated.
+ */
+typedef struct DMLVectorQualState
+{
+	VectorQualState vqstate;
+	RowDecompressor *decompressor;
+
+	/* The bulk decompressed columns, indexed by the chunk attribute offset */
+	const ArrowArray **arrows;
+	bool *is_default_value;
+} DMLVectorQualState;
+
+static const ArrowArray *
+dml_vector_qual_get_arrow_array(VectorQualState *vqstate, Expr *expr, bool *is_default_value)
+{
+	DMLVectorQualState *state = (DMLVectorQualState *) vqstate;
+	const int attoff = AttrNumberGetAttrOffset(castNode(Var, expr)->varattno);
+
+	Assert(state->arrows[attoff] != NULL);
+	*is_default_value = state->is_default_value[attoff];
+	return state->arrows[attoff];
+}
+
+/*
+ * Bulk decompress the column of the batch that is referenced by a vectorized
+ * filter. Returns false if the column can't be bulk decompressed in this
+ * batch.
+ */
+static bool
+dml_vector_qual_decompress_column(DMLVectorQualState *state, AttrNumber attno)
+{
+	RowDecompressor *decompressor = state->decompressor;
+	const int attoff = AttrNumberGetAttrOffset(attno);
+
+	if (state->arrows[attoff] != NULL)
+		return true;
+
+	PerCompressedColumn *column_info = NULL;
+	int input_column;
+	for (input_column = 0; input_column < decompressor->num_compressed_columns; input_column++)
+	{
+		if (decompressor->per_compressed_cols[input_column].decompressed_column_offset == attoff)
+		{
+			column_info = &decompressor->per_compressed_cols[input_column];
+			break;
+		}
+	}
+
+	if (column_info == NULL || !column_info->is_compressed)
+		return false;
+
+	/* The column has a default value for the entire batch */
+	if (decompressor->compressed_is_nulls[input_column])
+	{
+		bool isnull;
+		Datum value = getmissingattr(decompressor->out_desc, attno, &isnull);
+
+		state->arrows[attoff] =
+			make_single_value_arrow(column_info->decompressed_type, value, isnull);
+		state->is_default_value[attoff] = true;
+		return true;
+	}
+
+	Datum compressed_datum = PointerGetDatum(
+		detoaster_detoast_attr_copy((struct varlena *) DatumGetPointer(
+										decompressor->compressed_datums[input_column]),
+									&decompressor->detoaster,
+									CurrentMemoryContext));
+	CompressedDataHeader *header = (CompressedDataHeader *) DatumGetPointer(compressed_datum);
+	CheckCompressedData(header->compression_algorithm < _END_COMPRESSION_ALGORITHMS);
+
+	if (header->compression_algorithm == COMPRESSION_ALGORITHM_NULL)
+	{
+		state->arrows[attoff] =
+			make_single_value_arrow(column_info->decompressed_type, (Datum) 0, true);
+		state->is_default_value[attoff] = true;
+		return true;
+	}
+
+	DecompressAllFunction decompress_all =
+		tsl_get_decompress_all_function(header->compression_algorithm,
+										column_info->decompressed_type);
+	if (decompress_all == NULL)
+		return false;
+
+	ArrowArray *arrow =
+		decompress_all(compressed_datum, column_info->decompressed_type, CurrentMemoryContext);
+	if (arrow == NULL)
+		return false;
+	CheckCompressedData(arrow->length == state->vqstate.num_results);
+
+	state->arrows[attoff] = arrow;
+	return true;
+}
+
+/*
+ * Compute the vectorized filters of a DELETE or UPDATE over the bulk
+ * decompressed columns of the batch, the same way as the DecompressChunk
+ * node does, without decompressing the batch row by row.
+ *
+ * Returns false if no row of the batch matches. If some column can't be
+ * bulk decompressed, the batch is assumed to match, and is filtered only by
+ * the row by row check in batch_matches(), if any.
+ */
+static bool
+batch_vector_quals_match(RowDecompressor *decompressor, List *vector_quals)
+{
+	const int n_batch_rows =
+		DatumGetInt32(decompressor->compressed_datums[decompressor->count_compressed_attindex]);
+	CheckCompressedData(n_batch_rows > 0);
+	CheckCompressedData(n_batch_rows <= GLOBAL_MAX_ROWS_PER_COMPRESSION);
+
+	MemoryContext old_ctx = MemoryContextSwitchTo(decompressor->per_compressed_row_ctx);
+
+	const int natts = decompressor->out_desc->natts;
+	DMLVectorQualState state = {
+		.vqstate = {
+			.vectorized_quals_constified = vector_quals,
+			.num_results = n_batch_rows,
+			.per_vector_mcxt = decompressor->per_compressed_row_ctx,
+			.get_arrow_array = dml_vector_qual_get_arrow_array,
+		},
+		.decompressor = decompressor,
+		.arrows = palloc0(sizeof(ArrowArray *) * natts),
+		.is_default_value = palloc0(sizeof(bool) * natts),
+	};
+
+	ListCell *lc;
+	foreach (lc, vector_quals)
+	{
+		Var *var = linitial_node(Var, castNode(OpExpr, lfirst(lc))->args);
+
+		if (!dml_vector_qual_decompress_column(&state, var->varattno))
+		{
+			MemoryContextSwitchTo(old_ctx);
+			return true;
+		}
+	}
+
+	VectorQualSummary summary = vector_qual_compute(&state.vqstate);
+
+	MemoryContextSwitchTo(old_ctx);
+	return summary != NoRowsPass;
+}
+
 static bool
 batch_matches(RowDecompressor *decompressor, ScanKeyData *scankeys, int num_scankeys,
 			  tuple_filtering_constraints *constraints, bool *skip_current_tuple)
 {
+	/*
+	 * Most of the inserted rows don't conflict with the compressed data, so
+	 * probe the key columns first, before decompressing the entire batch.
+	 */
+	if (!batch_keys_may_match(decompressor, scankeys, num_scankeys))
+		return false;
+
 	int num_tuples = decompress_batch(decompressor);
 
 	bool valid = false;
@@ -730,6 +1202,7 @@ decompress_chunk_walker(PlanState *ps, struct decompress_chunk_context *ctx)
 				batches_decompressed = decompress_batches_for_update_delete(ctx->ht_state,
 																			current_chunk,
 																			predicates,
+																			ps->plan,
 																			ps->state,
 																			ctx->has_joins);
 				ctx->batches_decompressed |= batches_decompressed;
@@ -874,8 +1347,8 @@ get_batch_keys_for_unique_constraints(const ChunkInsertState *cis, Relation rela
  */
 static void
 process_predicates(Chunk *ch, CompressionSettings *settings, List *predicates,
-				   ScanKeyData **mem_scankeys, int *num_mem_scankeys, List **heap_filters,
-				   List **index_filters, List **is_null)
+				   ScanKeyData **mem_scankeys, int *num_mem_scankeys, List **vector_quals,
+				   List **heap_filters, List **index_filters, List **is_null)
 {
 	ListCell *lc;
 	if (ts_guc_enable_dml_decompression_tuple_filtering)
@@ -980,6 +1453,24 @@ process_predicates(Chunk *ch, CompressionSettings *settings, List *predicates,
 										   arg_value->constcollid,
 										   opcode,
 										   arg_value->constisnull ? 0 : arg_value->constvalue);
+
+					/*
+					 * The same filter computed over the bulk decompressed
+					 * batch, see batch_vector_quals_match().
+					 */
+					if (!arg_value->constisnull && get_vector_const_predicate(opcode) != NULL &&
+						(!OidIsValid(collation) || get_collation_isdeterministic(collation)))
+					{
+						OpExpr *vector_qual = (OpExpr *) make_opclause(opno,
+																	   BOOLOID,
+																	   false,
+																	   (Expr *) copyObject(var),
+																	   (Expr *) arg_value,
+																	   InvalidOid,
+																	   collation);
+						vector_qual->opfuncid = opcode;
+						*vector_quals = lappend(*vector_quals, vector_qual);
+					}
 				}
 
 				int min_attno = compressed_column_metadata_attno(settings,
@@ -1071,6 +1562,44 @@ process_predicates(Chunk *ch, CompressionSettings *settings, List *predicates,
 							break;
 					}
 				}
+
+				int bloom_attno = compressed_column_metadata_attno(settings,
+																   ch->table_id,
+																   var->varattno,
+																   settings->fd.compress_relid,
+																   "bloom1");
+
+				if (bloom_attno != InvalidAttrNumber && !arg_value->constisnull &&
+					var->varcollid == collation)
+				{
+					/*
+					 * col = value implies that the value is in the bloom
+					 * filter, if the value is hashed compatibly to the column.
+					 */
+					TypeCacheEntry *hash_tce =
+						lookup_type_cache(var->vartype, TYPECACHE_HASH_OPFAMILY);
+					if (OidIsValid(hash_tce->hash_opf) &&
+						get_op_opfamily_strategy(opno, hash_tce->hash_opf) ==
+							HTEqualStrategyNumber &&
+						lookup_type_cache(arg_value->consttype, TYPECACHE_HASH_OPFAMILY)
+								->hash_opf == hash_tce->hash_opf)
+					{
+						BatchFilter *bloom_filter =
+							make_batchfilter(get_attname(settings->fd.compress_relid,
+														 bloom_attno,
+														 false),
+											 InvalidStrategy,
+											 collation,
+											 InvalidOid,
+											 arg_value,
+											 false, /* is_null_check */
+											 false, /* is_null */
+											 false	/* is_array_op */
+							);
+						bloom_filter->is_bloom1 = true;
+						*heap_filters = lappend(*heap_filters, bloom_filter);
+					}
+				}
 			}
 			break;
 			case T_ScalarArrayOpExpr:
@@ -1339,6 +1868,63 @@ delete_compressed_tuple(RowDecompressor *decompressor, Snapshot snapshot,
 	return result;
 }
 
+/*
+ * Replace the segmentby values of the compressed tuple. The other columns,
+ * including the compressed data which might be TOASTed, are kept as is.
+ */
+static TM_Result
+update_compressed_tuple(RowDecompressor *decompressor, Snapshot snapshot,
+						HeapTuple compressed_tuple, BatchUpdateValues *update_values,
+						CatalogIndexState indexstate)
+{
+	const int natts = decompressor->in_desc->natts;
+	Datum *values = palloc0(sizeof(Datum) * natts);
+	bool *isnull = palloc0(sizeof(bool) * natts);
+	bool *replace = palloc0(sizeof(bool) * natts);
+	TM_FailureData tmfd;
+	LockTupleMode lockmode;
+#if PG16_LT
+	bool update_indexes;
+#else
+	TU_UpdateIndexes update_indexes;
+#endif
+
+	for (int i = 0; i < update_values->num_columns; i++)
+	{
+		const int offset = AttrNumberGetAttrOffset(update_values->attnos[i]);
+		values[offset] = update_values->values[i];
+		isnull[offset] = update_values->isnull[i];
+		replace[offset] = true;
+	}
+
+	HeapTuple new_tuple =
+		heap_modify_tuple(compressed_tuple, decompressor->in_desc, values, isnull, replace);
+	TupleTableSlot *new_slot = MakeSingleTupleTableSlot(decompressor->in_desc, &TTSOpsHeapTuple);
+	ExecStoreHeapTuple(new_tuple, new_slot, /* should_free = */ true);
+
+	TM_Result result = table_tuple_update(decompressor->in_rel,
+										  &compressed_tuple->t_self,
+										  new_slot,
+										  decompressor->mycid,
+										  snapshot,
+										  InvalidSnapshot,
+										  true,
+										  &tmfd,
+										  &lockmode,
+										  &update_indexes);
+
+	/* The index insert is skipped for the HOT updates */
+	if (result == TM_Ok)
+		ts_catalog_index_insert(indexstate, ExecFetchSlotHeapTuple(new_slot, false, NULL));
+
+	ExecDropSingleTupleTableSlot(new_slot);
+	pfree(values);
+	pfree(isnull);
+	pfree(replace);
+
+	return result;
+}
+
 static void
 report_error(TM_Result result)
 {
@@ -1439,6 +2025,18 @@ can_delete_without_decompression(HypertableModifyState *ht_state, CompressionSet
 		}
 	}
 
+	return predicates_use_only_segmentby(settings, chunk, predicates);
+}
+
+/*
+ * Check that all the predicates compare the segmentby columns to constants,
+ * so that they can be fully evaluated on the compressed batches.
+ */
+static bool
+predicates_use_only_segmentby(CompressionSettings *settings, Chunk *chunk, List *predicates)
+{
+	ListCell *lc;
+
 	foreach (lc, predicates)
 	{
 		Node *node = lfirst(lc);
@@ -1462,3 +2060,149 @@ can_delete_without_decompression(HypertableModifyState *ht_state, CompressionSet
 	}
 	return true;
 }
+
+/*
+ * Get the new value of an updated column for the chunk scan, if it is a
+ * constant. The value is either computed by the subplan of the ModifyTable
+ * directly, or by the chunk scans below an Append node.
+ */
+static Const *
+get_update_value_const(Plan *subplan, Plan *scan_plan, TargetEntry *tle)
+{
+	if (IsA(tle->expr, Const))
+		return castNode(Const, tle->expr);
+
+	if (!IsA(tle->expr, Var) || castNode(Var, tle->expr)->varno != OUTER_VAR)
+		return NULL;
+
+	List *child_plans = NIL;
+	if (IsA(subplan, Append))
+		child_plans = castNode(Append, subplan)->appendplans;
+	else if (IsA(subplan, MergeAppend))
+		child_plans = castNode(MergeAppend, subplan)->mergeplans;
+	else if (IsA(subplan, CustomScan))
+		child_plans = castNode(CustomScan, subplan)->custom_plans;
+
+	/* The children of the append produce the columns in the same order */
+	if (!list_member_ptr(child_plans, scan_plan))
+		return NULL;
+
+	AttrNumber resno = castNode(Var, tle->expr)->varattno;
+	if (resno < 1 || resno > list_length(scan_plan->targetlist))
+		return NULL;
+
+	TargetEntry *scan_tle = list_nth_node(TargetEntry, scan_plan->targetlist, resno - 1);
+	return IsA(scan_tle->expr, Const) ? castNode(Const, scan_tle->expr) : NULL;
+}
+
+/*
+ * Check whether the UPDATE can be done by setting the segmentby values of the
+ * compressed batches in place, and get the new values for it.
+ *
+ * This is possible when the UPDATE only sets segmentby columns to constants,
+ * the WHERE clause is fully evaluated on the segmentby columns, and nothing
+ * else needs to see the individual rows: triggers, RETURNING, constraints,
+ * generated columns or unique indexes.
+ *
+ * Returns NULL if the batches have to be decompressed.
+ */
+static BatchUpdateValues *
+get_direct_batch_update_values(HypertableModifyState *ht_state, CompressionSettings *settings,
+							   Chunk *chunk, Relation chunk_rel, Relation comp_chunk_rel,
+							   Plan *scan_plan, EState *estate, List *predicates)
+{
+	ModifyTable *mt = ht_state->mt;
+
+	if (!ts_guc_enable_compressed_direct_batch_update)
+		return NULL;
+
+	if (mt->returningLists || mt->onConflictAction != ONCONFLICT_NONE ||
+		list_length(mt->updateColnosLists) < 1)
+		return NULL;
+
+	ModifyTableState *ps =
+		linitial_node(ModifyTableState, castNode(CustomScanState, ht_state)->custom_ps);
+	TriggerDesc *trigdescs[] = { ps->rootResultRelInfo ? ps->rootResultRelInfo->ri_TrigDesc : NULL,
+								 chunk_rel->trigdesc };
+	for (int i = 0; i < (int) lengthof(trigdescs); i++)
+	{
+		TriggerDesc *trigdesc = trigdescs[i];
+		if (trigdesc && (trigdesc->trig_update_before_row || trigdesc->trig_update_after_row ||
+						 trigdesc->trig_update_instead_row))
+			return NULL;
+	}
+
+	if (!predicates_use_only_segmentby(settings, chunk, predicates))
+		return NULL;
+
+	/* The new values could conflict with the other rows */
+	if (ts_indexing_relation_has_primary_or_unique_index(chunk_rel))
+		return NULL;
+
+	TupleConstr *constr = RelationGetDescr(chunk_rel)->constr;
+	if (constr && constr->has_generated_stored)
+		return NULL;
+
+	Plan *subplan = outerPlan(&mt->plan);
+	List *update_colnos = linitial(mt->updateColnosLists);
+	Oid result_relid =
+		rt_fetch(linitial_int(mt->resultRelations), estate->es_range_table)->relid;
+	Bitmapset *updated_attnos = NULL;
+	BatchUpdateValues *update_values = palloc0(sizeof(BatchUpdateValues));
+	update_values->attnos = palloc(sizeof(AttrNumber) * list_length(update_colnos));
+	update_values->values = palloc(sizeof(Datum) * list_length(update_colnos));
+	update_values->isnull = palloc(sizeof(bool) * list_length(update_colnos));
+
+	/* The values of the updated columns are the first entries of the subplan */
+	ListCell *lc_colno;
+	ListCell *lc_tle = list_head(subplan->targetlist);
+	foreach (lc_colno, update_colnos)
+	{
+		if (lc_tle == NULL)
+			return NULL;
+
+		TargetEntry *tle = lfirst_node(TargetEntry, lc_tle);
+		lc_tle = lnext(subplan->targetlist, lc_tle);
+		if (tle->resjunk)
+			return NULL;
+
+		char *attname = get_attname(result_relid, lfirst_int(lc_colno), false);
+		if (!ts_array_is_member(settings->fd.segmentby, attname))
+			return NULL;
+
+		AttrNumber chunk_attno = get_attnum(chunk->table_id, attname);
+		Form_pg_attribute attr =
+			TupleDescAttr(RelationGetDescr(chunk_rel), AttrNumberGetAttrOffset(chunk_attno));
+
+		Const *value = get_update_value_const(subplan, scan_plan, tle);
+		if (value == NULL || value->consttype != attr->atttypid ||
+			(value->constisnull && attr->attnotnull))
+			return NULL;
+
+		const int i = update_values->num_columns++;
+		update_values->attnos[i] = get_attnum(comp_chunk_rel->rd_id, attname);
+		update_values->values[i] = value->constvalue;
+		update_values->isnull[i] = value->constisnull;
+		Ensure(update_values->attnos[i] != InvalidAttrNumber,
+			   "segmentby column \"%s\" not found in compressed chunk",
+			   attname);
+
+		updated_attnos =
+			bms_add_member(updated_attnos, chunk_attno - FirstLowInvalidHeapAttributeNumber);
+	}
+
+	/*
+	 * The check constraints on the updated columns would have to be checked
+	 * for the new values. This includes the dimension constraints of the
+	 * chunk, so the rows never have to move to another chunk.
+	 */
+	for (int i = 0; constr && i < constr->num_check; i++)
+	{
+		Bitmapset *check_attnos = NULL;
+		pull_varattnos(stringToNode(constr->check[i].ccbin), 1, &check_attnos);
+		if (bms_overlap(check_attnos, updated_attnos))
+			return NULL;
+	}
+
+	return update_values;
+}
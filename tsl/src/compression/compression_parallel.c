@@ -0,0 +1,644 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/parallel.h>
+#include <access/relscan.h>
+#include <access/tableam.h>
+#include <access/xact.h>
+#include <executor/tqueue.h>
+#include <executor/tuptable.h>
+#include <miscadmin.h>
+#include <optimizer/paths.h>
+#include <pgstat.h>
+#include <storage/bufmgr.h>
+#include <storage/condition_variable.h>
+#include <storage/latch.h>
+#include <storage/proc.h>
+#include <storage/shm_mq.h>
+#include <storage/shm_toc.h>
+#include <storage/spin.h>
+#include <utils/snapmgr.h>
+#include <utils/tuplesort.h>
+
+#include "compression.h"
+#include "compression_parallel.h"
+#include "extension_constants.h"
+#include "guc.h"
+#include "hypercore/hypercore_handler.h"
+
+/* Keys of the shared memory table of contents */
+#define PARALLEL_KEY_COMPRESSION_SHARED UINT64CONST(0xC000000000000001)
+#define PARALLEL_KEY_SORT_KEYS UINT64CONST(0xC000000000000002)
+#define PARALLEL_KEY_TABLE_SCAN UINT64CONST(0xC000000000000003)
+#define PARALLEL_KEY_TUPLESORT UINT64CONST(0xC000000000000004)
+#define PARALLEL_KEY_DECOMPRESSION_SHARED UINT64CONST(0xC000000000000005)
+#define PARALLEL_KEY_TUPLE_QUEUE UINT64CONST(0xC000000000000006)
+
+/* Size of the queue of decompressed rows of each parallel worker */
+#define DECOMPRESSION_TUPLE_QUEUE_SIZE 65536
+
+/* Number of rows that the leader inserts at a time */
+#define DECOMPRESSION_INSERT_BATCH_ROWS 1000
+
+/*
+ * State shared between the leader and the parallel workers.
+ */
+typedef struct CompressionParallelShared
+{
+	Oid relid;
+	int n_keys;
+
+	/* Sort memory of each participant in kilobytes */
+	int sortmem;
+
+	/* Signaled when a participant has finished its sort */
+	ConditionVariable workersdonecv;
+
+	/* Protects the fields below */
+	slock_t mutex;
+	int nparticipantsdone;
+} CompressionParallelShared;
+
+typedef struct CompressionParallelSortKey
+{
+	AttrNumber attnum;
+	Oid sort_operator;
+	Oid collation;
+	bool nulls_first;
+} CompressionParallelSortKey;
+
+/*
+ * State shared between the leader and the parallel workers of the
+ * decompression.
+ */
+typedef struct DecompressionParallelShared
+{
+	Oid in_relid;
+	Oid out_relid;
+} DecompressionParallelShared;
+
+static int
+plan_workers(Relation rel, int max_workers)
+{
+	int nworkers = Min(max_workers, max_parallel_maintenance_workers);
+
+	if (nworkers <= 0 || !IsUnderPostmaster || IsInParallelMode())
+		return 0;
+
+	/* The workers cannot read the local buffers of the leader */
+	if (RelationUsesLocalBuffers(rel))
+		return 0;
+
+	/* The hypercore scans need to skip the already compressed data */
+	if (REL_IS_HYPERCORE(rel))
+		return 0;
+
+	return nworkers;
+}
+
+/*
+ * Decide how many parallel workers to use for sorting the rows of the given
+ * relation. Returns 0 if the serial sort should be used.
+ */
+int
+compression_parallel_sort_plan_workers(Relation rel)
+{
+	int nworkers = plan_workers(rel, ts_guc_compression_parallel_workers);
+
+	/* Not worth starting the workers for small chunks */
+	if (nworkers > 0 && RelationGetNumberOfBlocks(rel) < (BlockNumber) min_parallel_table_scan_size)
+		return 0;
+
+	return nworkers;
+}
+
+/*
+ * Scan the share of the rows of this participant and sort them. Used both by
+ * the parallel workers and by the leader.
+ */
+static void
+compression_parallel_scan_and_sort(CompressionParallelShared *shared,
+								   CompressionParallelSortKey *keys, ParallelTableScanDesc pscan,
+								   Sharedsort *sharedsort, Relation rel)
+{
+	SortCoordinate coordinate = palloc0(sizeof(SortCoordinateData));
+	AttrNumber *sort_keys = palloc(sizeof(*sort_keys) * shared->n_keys);
+	Oid *sort_operators = palloc(sizeof(*sort_operators) * shared->n_keys);
+	Oid *sort_collations = palloc(sizeof(*sort_collations) * shared->n_keys);
+	bool *nulls_first = palloc(sizeof(*nulls_first) * shared->n_keys);
+	Tuplesortstate *sortstate;
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+
+	for (int i = 0; i < shared->n_keys; i++)
+	{
+		sort_keys[i] = keys[i].attnum;
+		sort_operators[i] = keys[i].sort_operator;
+		sort_collations[i] = keys[i].collation;
+		nulls_first[i] = keys[i].nulls_first;
+	}
+
+	coordinate->isWorker = true;
+	coordinate->nParticipants = -1;
+	coordinate->sharedsort = sharedsort;
+
+	sortstate = tuplesort_begin_heap(CreateTupleDescCopy(RelationGetDescr(rel)),
+									 shared->n_keys,
+									 sort_keys,
+									 sort_operators,
+									 sort_collations,
+									 nulls_first,
+									 shared->sortmem,
+									 coordinate,
+									 TUPLESORT_NONE);
+
+	scan = table_beginscan_parallel(rel, pscan);
+	slot = table_slot_create(rel, NULL);
+
+	while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+		tuplesort_puttupleslot(sortstate, slot);
+
+	table_endscan(scan);
+	ExecDropSingleTupleTableSlot(slot);
+
+	tuplesort_performsort(sortstate);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->nparticipantsdone++;
+	SpinLockRelease(&shared->mutex);
+	ConditionVariableSignal(&shared->workersdonecv);
+
+	/* The sorted run stays in the shared file set for the leader to merge */
+	tuplesort_end(sortstate);
+}
+
+/*
+ * Start the parallel sort of the rows of the relation. The returned merged
+ * tuplesort is already sorted and can be read by the row compressor.
+ *
+ * Returns NULL if the parallel sort could not be set up, in which case the
+ * caller should use the serial sort.
+ */
+CompressionParallelSort *
+compression_parallel_sort_begin(CompressionSettings *settings, Relation rel, int nworkers)
+{
+	CompressionParallelSort *parallel_sort;
+	ParallelContext *pcxt;
+	Snapshot snapshot;
+	CompressionParallelShared *shared;
+	CompressionParallelSortKey *keys;
+	ParallelTableScanDesc pscan;
+	Sharedsort *sharedsort;
+	SortCoordinate coordinate;
+	AttrNumber *sort_keys;
+	Oid *sort_operators;
+	Oid *sort_collations;
+	bool *nulls_first;
+	Size estshared, estkeys, estscan, estsort;
+	int nparticipants;
+	int n_keys = compression_get_sort_keys(settings,
+										   rel,
+										   &sort_keys,
+										   &sort_operators,
+										   &sort_collations,
+										   &nulls_first);
+
+	/*
+	 * The leader inserts into the compressed chunk while the parallel mode is
+	 * active, so it needs a transaction id, and these cannot be assigned in
+	 * the parallel mode.
+	 */
+	(void) GetCurrentTransactionId();
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext(EXTENSION_TSL_SO, "compression_parallel_sort_main", nworkers);
+
+	/* The leader takes part in the scan as well */
+	nparticipants = nworkers + 1;
+	snapshot = RegisterSnapshot(GetLatestSnapshot());
+
+	estshared = sizeof(CompressionParallelShared);
+	estkeys = sizeof(CompressionParallelSortKey) * n_keys;
+	estscan = table_parallelscan_estimate(rel, snapshot);
+	estsort = tuplesort_estimate_shared(nparticipants);
+	shm_toc_estimate_chunk(&pcxt->estimator, estshared);
+	shm_toc_estimate_chunk(&pcxt->estimator, estkeys);
+	shm_toc_estimate_chunk(&pcxt->estimator, estscan);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+	shm_toc_estimate_keys(&pcxt->estimator, 4);
+
+	InitializeParallelDSM(pcxt);
+
+	/* No dynamic shared memory available, so use the serial sort */
+	if (pcxt->seg == NULL)
+	{
+		UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	shared = shm_toc_allocate(pcxt->toc, estshared);
+	shared->relid = RelationGetRelid(rel);
+	shared->n_keys = n_keys;
+	shared->sortmem = maintenance_work_mem / nparticipants;
+	ConditionVariableInit(&shared->workersdonecv);
+	SpinLockInit(&shared->mutex);
+	shared->nparticipantsdone = 0;
+
+	keys = shm_toc_allocate(pcxt->toc, estkeys);
+	for (int i = 0; i < n_keys; i++)
+	{
+		keys[i].attnum = sort_keys[i];
+		keys[i].sort_operator = sort_operators[i];
+		keys[i].collation = sort_collations[i];
+		keys[i].nulls_first = nulls_first[i];
+	}
+
+	pscan = shm_toc_allocate(pcxt->toc, estscan);
+	table_parallelscan_initialize(rel, pscan, snapshot);
+
+	sharedsort = shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, nparticipants, pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_COMPRESSION_SHARED, shared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_SORT_KEYS, keys);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TABLE_SCAN, pscan);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLESORT, sharedsort);
+
+	LaunchParallelWorkers(pcxt);
+
+	elog(DEBUG1,
+		 "sorting rows from \"%s\" with %d parallel workers",
+		 RelationGetRelationName(rel),
+		 pcxt->nworkers_launched);
+
+	/* Only the launched workers and the leader will finish their sorts */
+	nparticipants = pcxt->nworkers_launched + 1;
+
+	compression_parallel_scan_and_sort(shared, keys, pscan, sharedsort, rel);
+
+	/* Make sure that we don't wait below for a worker that failed to start */
+	WaitForParallelWorkersToAttach(pcxt);
+
+	for (;;)
+	{
+		SpinLockAcquire(&shared->mutex);
+		if (shared->nparticipantsdone == nparticipants)
+		{
+			SpinLockRelease(&shared->mutex);
+			break;
+		}
+		SpinLockRelease(&shared->mutex);
+
+		ConditionVariableSleep(&shared->workersdonecv, WAIT_EVENT_PARALLEL_FINISH);
+	}
+	ConditionVariableCancelSleep();
+
+	/* Merge the sorted runs of all the participants */
+	coordinate = palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = false;
+	coordinate->nParticipants = nparticipants;
+	coordinate->sharedsort = sharedsort;
+
+	parallel_sort = palloc0(sizeof(CompressionParallelSort));
+	parallel_sort->pcxt = pcxt;
+	parallel_sort->snapshot = snapshot;
+	parallel_sort->sortstate = tuplesort_begin_heap(CreateTupleDescCopy(RelationGetDescr(rel)),
+													n_keys,
+													sort_keys,
+													sort_operators,
+													sort_collations,
+													nulls_first,
+													maintenance_work_mem,
+													coordinate,
+													TUPLESORT_NONE);
+	tuplesort_performsort(parallel_sort->sortstate);
+
+	return parallel_sort;
+}
+
+/*
+ * Finish the parallel sort after the merged tuplesort has been read.
+ */
+void
+compression_parallel_sort_end(CompressionParallelSort *parallel_sort)
+{
+	tuplesort_end(parallel_sort->sortstate);
+	WaitForParallelWorkersToFinish(parallel_sort->pcxt);
+	UnregisterSnapshot(parallel_sort->snapshot);
+	DestroyParallelContext(parallel_sort->pcxt);
+	ExitParallelMode();
+	pfree(parallel_sort);
+}
+
+void
+compression_parallel_sort_main(dsm_segment *seg, shm_toc *toc)
+{
+	CompressionParallelShared *shared =
+		shm_toc_lookup(toc, PARALLEL_KEY_COMPRESSION_SHARED, false);
+	CompressionParallelSortKey *keys = shm_toc_lookup(toc, PARALLEL_KEY_SORT_KEYS, false);
+	ParallelTableScanDesc pscan = shm_toc_lookup(toc, PARALLEL_KEY_TABLE_SCAN, false);
+	Sharedsort *sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_TUPLESORT, false);
+	Relation rel;
+
+	tuplesort_attach_shared(sharedsort, seg);
+
+	/* The lock group of the leader already holds a lock on the relation */
+	rel = table_open(shared->relid, AccessShareLock);
+	compression_parallel_scan_and_sort(shared, keys, pscan, sharedsort, rel);
+	table_close(rel, AccessShareLock);
+}
+
+/*
+ * Decide how many parallel workers to use for decompressing the compressed
+ * chunk "in_rel" into "out_rel". Returns 0 if the serial decompression
+ * should be used.
+ */
+int
+compression_parallel_decompress_plan_workers(Relation in_rel, Relation out_rel)
+{
+	int nworkers = plan_workers(in_rel, ts_guc_decompression_parallel_workers);
+
+	if (nworkers <= 0 || RelationUsesLocalBuffers(out_rel) || REL_IS_HYPERCORE(out_rel))
+		return 0;
+
+	/* Most of the compressed data is in the TOAST table */
+	BlockNumber nblocks = RelationGetNumberOfBlocks(in_rel);
+
+	if (OidIsValid(in_rel->rd_rel->reltoastrelid))
+	{
+		Relation toast_rel = table_open(in_rel->rd_rel->reltoastrelid, AccessShareLock);
+		nblocks += RelationGetNumberOfBlocks(toast_rel);
+		table_close(toast_rel, AccessShareLock);
+	}
+
+	/* Not worth starting the workers for small chunks */
+	if (nblocks < (BlockNumber) min_parallel_table_scan_size)
+		return 0;
+
+	return nworkers;
+}
+
+/*
+ * Insert the buffered rows into the relation.
+ */
+static void
+decompression_parallel_flush(Relation out_rel, TupleTableSlot **slots, int nslots, CommandId mycid,
+							 BulkInsertState bistate, MemoryContext rows_mcxt)
+{
+	if (nslots == 0)
+		return;
+
+	table_multi_insert(out_rel, slots, nslots, mycid, /* options = */ 0, bistate);
+
+	for (int i = 0; i < nslots; i++)
+		ExecClearTuple(slots[i]);
+
+	MemoryContextReset(rows_mcxt);
+}
+
+/*
+ * Decompress the compressed chunk "in_rel" into "out_rel" with parallel
+ * workers.
+ *
+ * The workers take the compressed tuples from a parallel scan of the
+ * compressed chunk, decompress them, and send the rows to the leader
+ * through a tuple queue, since the parallel workers cannot insert. The
+ * leader only inserts the rows into the heap of "out_rel", without updating
+ * the indexes, so the caller has to rebuild the indexes.
+ *
+ * Returns false if the parallel decompression could not be set up, in which
+ * case nothing was decompressed and the caller should use the serial
+ * decompression.
+ */
+bool
+compression_parallel_decompress(Relation in_rel, Relation out_rel, int nworkers)
+{
+	ParallelContext *pcxt;
+	Snapshot snapshot;
+	DecompressionParallelShared *shared;
+	ParallelTableScanDesc pscan;
+	char *tqueuespace;
+	shm_mq_handle **mqhs;
+	TupleQueueReader **readers;
+	int nreaders;
+	int64 nrows = 0;
+
+	/* The leader inserts while the parallel mode is active */
+	(void) GetCurrentTransactionId();
+	const CommandId mycid = GetCurrentCommandId(true);
+
+	EnterParallelMode();
+	pcxt =
+		CreateParallelContext(EXTENSION_TSL_SO, "compression_parallel_decompress_main", nworkers);
+	snapshot = RegisterSnapshot(GetLatestSnapshot());
+
+	const Size estshared = sizeof(DecompressionParallelShared);
+	const Size estscan = table_parallelscan_estimate(in_rel, snapshot);
+	const Size estqueues = mul_size(DECOMPRESSION_TUPLE_QUEUE_SIZE, pcxt->nworkers);
+	shm_toc_estimate_chunk(&pcxt->estimator, estshared);
+	shm_toc_estimate_chunk(&pcxt->estimator, estscan);
+	shm_toc_estimate_chunk(&pcxt->estimator, estqueues);
+	shm_toc_estimate_keys(&pcxt->estimator, 3);
+
+	InitializeParallelDSM(pcxt);
+
+	/* No dynamic shared memory available, so use the serial decompression */
+	if (pcxt->seg == NULL)
+	{
+		UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	shared = shm_toc_allocate(pcxt->toc, estshared);
+	shared->in_relid = RelationGetRelid(in_rel);
+	shared->out_relid = RelationGetRelid(out_rel);
+
+	pscan = shm_toc_allocate(pcxt->toc, estscan);
+	table_parallelscan_initialize(in_rel, pscan, snapshot);
+
+	tqueuespace = shm_toc_allocate(pcxt->toc, estqueues);
+	mqhs = palloc(sizeof(shm_mq_handle *) * pcxt->nworkers);
+
+	for (int i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq *mq = shm_mq_create(tqueuespace + ((Size) i * DECOMPRESSION_TUPLE_QUEUE_SIZE),
+								   (Size) DECOMPRESSION_TUPLE_QUEUE_SIZE);
+
+		shm_mq_set_receiver(mq, MyProc);
+		mqhs[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_DECOMPRESSION_SHARED, shared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TABLE_SCAN, pscan);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_TUPLE_QUEUE, tqueuespace);
+
+	LaunchParallelWorkers(pcxt);
+
+	elog(DEBUG1,
+		 "decompressing \"%s\" with %d parallel workers",
+		 RelationGetRelationName(in_rel),
+		 pcxt->nworkers_launched);
+
+	/* Without workers, the rows would never arrive */
+	if (pcxt->nworkers_launched == 0)
+	{
+		UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	nreaders = pcxt->nworkers_launched;
+	readers = palloc(sizeof(TupleQueueReader *) * nreaders);
+	for (int i = 0; i < nreaders; i++)
+	{
+		/* Notice the workers that die before attaching to the queue */
+		shm_mq_set_handle(mqhs[i], pcxt->worker[i].bgwhandle);
+		readers[i] = CreateTupleQueueReader(mqhs[i]);
+	}
+
+	TupleTableSlot **slots = palloc(sizeof(TupleTableSlot *) * DECOMPRESSION_INSERT_BATCH_ROWS);
+	for (int i = 0; i < DECOMPRESSION_INSERT_BATCH_ROWS; i++)
+		slots[i] = MakeSingleTupleTableSlot(RelationGetDescr(out_rel), &TTSOpsMinimalTuple);
+
+	BulkInsertState bistate = GetBulkInsertState();
+	MemoryContext rows_mcxt =
+		AllocSetContextCreate(CurrentMemoryContext, "decompressed rows", ALLOCSET_DEFAULT_SIZES);
+	int nslots = 0;
+
+	/*
+	 * Read the rows from the queues in turn, like Gather does, and insert
+	 * them in batches.
+	 */
+	while (nreaders > 0)
+	{
+		bool got_rows = false;
+
+		for (int i = 0; i < nreaders; i++)
+		{
+			bool done = false;
+			MinimalTuple tuple;
+
+			while (nslots < DECOMPRESSION_INSERT_BATCH_ROWS &&
+				   (tuple = TupleQueueReaderNext(readers[i], true, &done)) != NULL)
+			{
+				MemoryContext oldmcxt = MemoryContextSwitchTo(rows_mcxt);
+				ExecStoreMinimalTuple(heap_copy_minimal_tuple(tuple), slots[nslots++], false);
+				MemoryContextSwitchTo(oldmcxt);
+				got_rows = true;
+			}
+
+			if (nslots == DECOMPRESSION_INSERT_BATCH_ROWS)
+			{
+				decompression_parallel_flush(out_rel, slots, nslots, mycid, bistate, rows_mcxt);
+				nrows += nslots;
+				nslots = 0;
+			}
+
+			if (done)
+			{
+				DestroyTupleQueueReader(readers[i]);
+				readers[i] = readers[--nreaders];
+				i--;
+			}
+		}
+
+		if (!got_rows && nreaders > 0)
+		{
+			/* Insert what we have while waiting for the workers */
+			decompression_parallel_flush(out_rel, slots, nslots, mycid, bistate, rows_mcxt);
+			nrows += nslots;
+			nslots = 0;
+
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_EXIT_ON_PM_DEATH,
+							 0,
+							 WAIT_EVENT_EXECUTE_GATHER);
+			ResetLatch(MyLatch);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	decompression_parallel_flush(out_rel, slots, nslots, mycid, bistate, rows_mcxt);
+	nrows += nslots;
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	elog(DEBUG1,
+		 "finished decompressing " INT64_FORMAT " rows from \"%s\"",
+		 nrows,
+		 RelationGetRelationName(in_rel));
+
+	for (int i = 0; i < DECOMPRESSION_INSERT_BATCH_ROWS; i++)
+		ExecDropSingleTupleTableSlot(slots[i]);
+	pfree(slots);
+	FreeBulkInsertState(bistate);
+	MemoryContextDelete(rows_mcxt);
+
+	UnregisterSnapshot(snapshot);
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return true;
+}
+
+void
+compression_parallel_decompress_main(dsm_segment *seg, shm_toc *toc)
+{
+	DecompressionParallelShared *shared =
+		shm_toc_lookup(toc, PARALLEL_KEY_DECOMPRESSION_SHARED, false);
+	ParallelTableScanDesc pscan = shm_toc_lookup(toc, PARALLEL_KEY_TABLE_SCAN, false);
+	char *tqueuespace = shm_toc_lookup(toc, PARALLEL_KEY_TUPLE_QUEUE, false);
+	shm_mq *mq =
+		(shm_mq *) (tqueuespace + ((Size) ParallelWorkerNumber * DECOMPRESSION_TUPLE_QUEUE_SIZE));
+
+	shm_mq_set_sender(mq, MyProc);
+	shm_mq_handle *mqh = shm_mq_attach(mq, seg, NULL);
+	DestReceiver *dest = CreateTupleQueueDestReceiver(mqh);
+
+	/* The lock group of the leader already holds locks on the relations */
+	Relation in_rel = table_open(shared->in_relid, AccessShareLock);
+	Relation out_rel = table_open(shared->out_relid, AccessShareLock);
+	RowDecompressor decompressor = build_decompressor(in_rel, out_rel);
+	TableScanDesc scan = table_beginscan_parallel(in_rel, pscan);
+	TupleTableSlot *slot = table_slot_create(in_rel, NULL);
+
+	dest->rStartup(dest, CMD_SELECT, decompressor.out_desc);
+
+	while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+	{
+		bool should_free;
+		HeapTuple tuple = ExecFetchSlotHeapTuple(slot, false, &should_free);
+
+		heap_deform_tuple(tuple,
+						  decompressor.in_desc,
+						  decompressor.compressed_datums,
+						  decompressor.compressed_is_nulls);
+
+		if (should_free)
+			heap_freetuple(tuple);
+
+		row_decompressor_decompress_row_to_dest(&decompressor, dest);
+	}
+
+	dest->rShutdown(dest);
+	dest->rDestroy(dest);
+
+	table_endscan(scan);
+	ExecDropSingleTupleTableSlot(slot);
+	row_decompressor_close(&decompressor);
+
+	table_close(out_rel, AccessShareLock);
+	table_close(in_rel, AccessShareLock);
+}
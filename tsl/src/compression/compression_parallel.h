@@ -0,0 +1,50 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+/*
+ * Parallel sort of the rows of a chunk for compression.
+ *
+ * The parallel workers scan the chunk with a parallel table scan, and each
+ * of them sorts its share of the rows. The leader takes part in the scan as
+ * well, and then merges the sorted runs of all participants. The merged
+ * tuplesort is consumed by the row compressor in the leader, the same way as
+ * the serial tuplesort, because the parallel workers are not allowed to
+ * insert into the compressed chunk.
+ *
+ * Parallel decompression of a chunk works the other way around. The parallel
+ * workers scan the compressed chunk with a parallel table scan, decompress
+ * the batches, and send the rows to the leader through tuple queues. The
+ * leader inserts the rows into the non-compressed chunk.
+ */
+
+#include <postgres.h>
+#include <access/parallel.h>
+#include <utils/rel.h>
+#include <utils/snapshot.h>
+#include <utils/tuplesort.h>
+
+#include "export.h"
+#include "ts_catalog/compression_settings.h"
+
+typedef struct CompressionParallelSort
+{
+	ParallelContext *pcxt;
+	Snapshot snapshot;
+	Tuplesortstate *sortstate;
+} CompressionParallelSort;
+
+extern int compression_parallel_sort_plan_workers(Relation rel);
+extern CompressionParallelSort *compression_parallel_sort_begin(CompressionSettings *settings,
+																Relation rel, int nworkers);
+extern void compression_parallel_sort_end(CompressionParallelSort *parallel_sort);
+
+extern int compression_parallel_decompress_plan_workers(Relation in_rel, Relation out_rel);
+extern bool compression_parallel_decompress(Relation in_rel, Relation out_rel, int nworkers);
+
+/* Entry points of the parallel workers, looked up by name */
+extern PGDLLEXPORT void compression_parallel_sort_main(dsm_segment *seg, shm_toc *toc);
+extern PGDLLEXPORT void compression_parallel_decompress_main(dsm_segment *seg, shm_toc *toc);
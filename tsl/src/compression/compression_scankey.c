@@ -10,12 +10,16 @@
 #include <parser/parse_relation.h>
 #include <utils/typcache.h>
 
+#include "batch_metadata_builder_bloom1.h"
 #include "compression.h"
 #include "compression_dml.h"
 #include "create.h"
 #include "ts_catalog/array_utils.h"
 
 static Oid deduce_filter_subtype(BatchFilter *filter, Oid att_typoid);
+static bool create_bloom1_scankey(Relation in_rel, char *bloom_col_name, Oid value_type,
+								  Oid collation, Datum value, ScanKeyData *scankeys,
+								  int *num_scankeys);
 static bool create_segment_filter_scankey(Relation in_rel, char *segment_filter_col_name,
 										  StrategyNumber strategy, Oid subtype, Oid opcode,
 										  ScanKeyData *scankeys, int *num_scankeys,
@@ -181,9 +185,9 @@ build_heap_scankeys(Oid hypertable_relid, Relation in_rel, Relation out_rel,
 			 * In this we can add 2 ScanKeys with range constraints
 			 * utilizing batch metadata.
 			 * 3. Column is neither segmentby nor orderby
-			 * In this case we cannot utilize this column for
-			 * batch filtering as the values are compressed and
-			 * we have no metadata.
+			 * In this case we can only utilize the sparse index
+			 * metadata of the column, either the min/max range or
+			 * the bloom filter, if the column has any.
 			 */
 			if (ts_array_is_member(settings->fd.segmentby, attname))
 			{
@@ -234,6 +238,65 @@ build_heap_scankeys(Oid hypertable_relid, Relation in_rel, Relation out_rel,
 											  false /* is_null_check */
 				);
 			}
+			else if (!isnull && !ts_array_is_member(settings->fd.segmentby, attname))
+			{
+				/* The NULL values are not visible in the sparse index metadata either */
+				int min_attno = compressed_column_metadata_attno(settings,
+																 out_rel->rd_id,
+																 attno,
+																 in_rel->rd_id,
+																 "min");
+				int max_attno = compressed_column_metadata_attno(settings,
+																 out_rel->rd_id,
+																 attno,
+																 in_rel->rd_id,
+																 "max");
+				int bloom_attno = compressed_column_metadata_attno(settings,
+																   out_rel->rd_id,
+																   attno,
+																   in_rel->rd_id,
+																   "bloom1");
+
+				if (min_attno != InvalidAttrNumber && max_attno != InvalidAttrNumber)
+				{
+					create_segment_filter_scankey(in_rel,
+												  get_attname(in_rel->rd_id, min_attno, false),
+												  BTLessEqualStrategyNumber,
+												  InvalidOid,
+												  InvalidOid,
+												  scankeys,
+												  &key_index,
+												  null_columns,
+												  value,
+												  false,
+												  false /* is_null_check */
+					);
+					create_segment_filter_scankey(in_rel,
+												  get_attname(in_rel->rd_id, max_attno, false),
+												  BTGreaterEqualStrategyNumber,
+												  InvalidOid,
+												  InvalidOid,
+												  scankeys,
+												  &key_index,
+												  null_columns,
+												  value,
+												  false,
+												  false /* is_null_check */
+					);
+				}
+				else if (bloom_attno != InvalidAttrNumber)
+				{
+					Form_pg_attribute attr =
+						TupleDescAttr(RelationGetDescr(out_rel), AttrNumberGetAttrOffset(attno));
+					create_bloom1_scankey(in_rel,
+										  get_attname(in_rel->rd_id, bloom_attno, false),
+										  attr->atttypid,
+										  attr->attcollation,
+										  value,
+										  scankeys,
+										  &key_index);
+				}
+			}
 		}
 	}
 
@@ -460,6 +523,23 @@ build_update_delete_scankeys(Relation in_rel, List *heap_filters, int *num_scank
 							NameStr(filter->column_name),
 							RelationGetRelationName(in_rel))));
 
+		/*
+		 * The bloom filter is only on the non-segmentby columns, so the direct
+		 * DELETE is already disabled for these filters.
+		 */
+		if (filter->is_bloom1)
+		{
+			Assert(filter->value != NULL && !filter->value->constisnull);
+			create_bloom1_scankey(in_rel,
+								  NameStr(filter->column_name),
+								  filter->value->consttype,
+								  filter->collation,
+								  filter->value->constvalue,
+								  scankeys,
+								  &key_index);
+			continue;
+		}
+
 		bool added = create_segment_filter_scankey(in_rel,
 												   NameStr(filter->column_name),
 												   filter->strategy,
@@ -572,6 +652,45 @@ create_segment_filter_scankey(Relation in_rel, char *segment_filter_col_name,
 	return true;
 }
 
+/*
+ * The bloom filter can't be checked with an operator, so we hash the value
+ * here, and use a scankey function that checks the hash against the filter.
+ */
+static bool
+create_bloom1_scankey(Relation in_rel, char *bloom_col_name, Oid value_type, Oid collation,
+					  Datum value, ScanKeyData *scankeys, int *num_scankeys)
+{
+	AttrNumber bloom_attno = get_attnum(in_rel->rd_id, bloom_col_name);
+	Assert(bloom_attno != InvalidAttrNumber);
+	if (bloom_attno == InvalidAttrNumber)
+		return false;
+
+	TypeCacheEntry *tce = lookup_type_cache(value_type, TYPECACHE_HASH_EXTENDED_PROC_FINFO);
+	if (!OidIsValid(tce->hash_extended_proc))
+		return false;
+
+	uint64 hash = bloom1_hash_value(&tce->hash_extended_proc_finfo, collation, value);
+
+	FmgrInfo finfo = {
+		.fn_addr = bloom1_contains_hash_fmgr,
+		.fn_oid = InvalidOid,
+		.fn_nargs = 2,
+		.fn_strict = true,
+		.fn_mcxt = CurrentMemoryContext,
+	};
+
+	ScanKeyEntryInitializeWithInfo(&scankeys[(*num_scankeys)++],
+								   0,
+								   bloom_attno,
+								   InvalidStrategy,
+								   INT8OID,
+								   collation,
+								   &finfo,
+								   Int64GetDatum((int64) hash));
+
+	return true;
+}
+
 /*
  * Get the subtype for an indexscan from the provided filter. We also
  * need to handle array constants appropriately.
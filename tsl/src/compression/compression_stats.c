@@ -0,0 +1,710 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#include <postgres.h>
+#include <access/detoast.h>
+#include <access/htup_details.h>
+#include <access/tableam.h>
+#include <access/xact.h>
+#include <catalog/objectaddress.h>
+#include <catalog/pg_type.h>
+#include <common/pg_prng.h>
+#include <funcapi.h>
+#include <miscadmin.h>
+#include <portability/instr_time.h>
+#include <utils/acl.h>
+#include <utils/builtins.h>
+#include <utils/fmgroids.h>
+#include <utils/formatting.h>
+#include <utils/inval.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+
+#include "chunk.h"
+#include "compression.h"
+#include "compression_stats.h"
+#include "create.h"
+#include "custom_type_cache.h"
+#include "ts_catalog/array_utils.h"
+#include "ts_catalog/catalog.h"
+#include "ts_catalog/compression_settings.h"
+#include "ts_catalog/metadata.h"
+
+/* compressed_column_stats record attribute numbers */
+enum Anum_compressed_column_stats
+{
+	Anum_compressed_column_stats_column_name = 1,
+	Anum_compressed_column_stats_algorithm,
+	Anum_compressed_column_stats_batches,
+	Anum_compressed_column_stats_rows,
+	Anum_compressed_column_stats_compressed_bytes,
+	Anum_compressed_column_stats_null_fraction,
+	Anum_compressed_column_stats_avg_batch_rows,
+	Anum_compressed_column_stats_decode_ns_per_row,
+	_Anum_compressed_column_stats_max,
+};
+
+#define Natts_compressed_column_stats (_Anum_compressed_column_stats_max - 1)
+
+/* calibrate_decompression_cost record attribute numbers */
+enum Anum_decompression_cost
+{
+	Anum_decompression_cost_algorithm = 1,
+	Anum_decompression_cost_decode_ns_per_row,
+	Anum_decompression_cost_cost_per_row,
+	_Anum_decompression_cost_max,
+};
+
+#define Natts_decompression_cost (_Anum_decompression_cost_max - 1)
+
+typedef struct AlgorithmStats
+{
+	int64 batches;
+	int64 rows;
+	int64 null_rows;
+	int64 compressed_bytes;
+	int64 decode_ns;
+} AlgorithmStats;
+
+typedef struct ColumnStats
+{
+	NameData column_name;
+	Oid typid;
+	AttrNumber compressed_attno;
+	AlgorithmStats algorithms[_END_COMPRESSION_ALGORITHMS];
+} ColumnStats;
+
+/*
+ * Decompress the batch and return the number of null values in it. This is
+ * the same work that the scans do, so the time it takes is the decode cost of
+ * the batch. The bulk decompression is used if the scans would use it.
+ */
+static int64
+batch_count_nulls(CompressedDataHeader *header, Oid typid, MemoryContext mctx)
+{
+	DecompressAllFunction decompress_all =
+		tsl_get_decompress_all_function(header->compression_algorithm, typid);
+	DecompressionIterator *iter;
+	int64 null_rows = 0;
+
+	if (decompress_all != NULL)
+	{
+		ArrowArray *arrow = decompress_all(PointerGetDatum(header), typid, mctx);
+		return arrow->null_count;
+	}
+
+	iter = tsl_get_decompression_iterator_init(header->compression_algorithm,
+											   false)(PointerGetDatum(header), typid);
+	for (DecompressResult res = iter->try_next(iter); !res.is_done; res = iter->try_next(iter))
+	{
+		if (res.is_null)
+			null_rows++;
+	}
+
+	return null_rows;
+}
+
+static void
+column_stats_add_batch(ColumnStats *column, Datum value, bool isnull, int32 batch_rows,
+					   MemoryContext per_batch_ctx)
+{
+	CompressedDataHeader *header;
+	AlgorithmStats *stats;
+	instr_time start;
+	instr_time duration;
+
+	/* A batch where all values are null has no compressed data */
+	if (isnull)
+	{
+		stats = &column->algorithms[COMPRESSION_ALGORITHM_NULL];
+		stats->batches++;
+		stats->rows += batch_rows;
+		stats->null_rows += batch_rows;
+		return;
+	}
+
+	MemoryContext old_ctx = MemoryContextSwitchTo(per_batch_ctx);
+
+	header = (CompressedDataHeader *) PG_DETOAST_DATUM(value);
+	if (header->compression_algorithm >= _END_COMPRESSION_ALGORITHMS)
+		elog(ERROR, "invalid compression algorithm %d", header->compression_algorithm);
+
+	stats = &column->algorithms[header->compression_algorithm];
+	stats->batches++;
+	stats->rows += batch_rows;
+	stats->compressed_bytes += toast_datum_size(value);
+
+	if (header->compression_algorithm == COMPRESSION_ALGORITHM_NULL)
+	{
+		stats->null_rows += batch_rows;
+	}
+	else
+	{
+		INSTR_TIME_SET_CURRENT(start);
+		stats->null_rows += batch_count_nulls(header, column->typid, per_batch_ctx);
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+		stats->decode_ns += (int64) (INSTR_TIME_GET_DOUBLE(duration) * 1e9);
+	}
+
+	MemoryContextSwitchTo(old_ctx);
+	MemoryContextReset(per_batch_ctx);
+}
+
+/*
+ * Collect the statistics of the compressed columns of the chunk by scanning
+ * its compressed chunk. Returns the list of the result tuples.
+ */
+static List *
+compressed_column_stats_collect(Oid chunk_relid, TupleDesc tupdesc)
+{
+	CompressionSettings *settings = ts_compression_settings_get(chunk_relid);
+	Oid compressed_data_type_oid = ts_custom_type_cache_get(CUSTOM_TYPE_COMPRESSED_DATA)->type_oid;
+	Relation chunk_rel;
+	Relation compressed_rel;
+	TupleDesc chunk_desc;
+	ColumnStats *columns;
+	int num_columns = 0;
+	AttrNumber count_attno;
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+	MemoryContext per_batch_ctx;
+	List *result = NIL;
+
+	if (settings == NULL || !OidIsValid(settings->fd.compress_relid))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("chunk \"%s\" is not compressed", get_rel_name(chunk_relid))));
+
+	chunk_rel = table_open(chunk_relid, AccessShareLock);
+	compressed_rel = table_open(settings->fd.compress_relid, AccessShareLock);
+	chunk_desc = RelationGetDescr(chunk_rel);
+
+	count_attno = get_attnum(settings->fd.compress_relid, COMPRESSION_COLUMN_METADATA_COUNT_NAME);
+	if (count_attno == InvalidAttrNumber)
+		elog(ERROR,
+			 "missing metadata column '%s' in compressed table",
+			 COMPRESSION_COLUMN_METADATA_COUNT_NAME);
+
+	columns = palloc0(sizeof(ColumnStats) * chunk_desc->natts);
+	for (int i = 0; i < chunk_desc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(chunk_desc, i);
+		AttrNumber compressed_attno;
+
+		if (attr->attisdropped ||
+			ts_array_is_member(settings->fd.segmentby, NameStr(attr->attname)))
+			continue;
+
+		compressed_attno = get_attnum(settings->fd.compress_relid, NameStr(attr->attname));
+		if (compressed_attno == InvalidAttrNumber ||
+			TupleDescAttr(RelationGetDescr(compressed_rel),
+						  AttrNumberGetAttrOffset(compressed_attno))
+					->atttypid != compressed_data_type_oid)
+			elog(ERROR,
+				 "expected column '%s' to be a compressed data type",
+				 NameStr(attr->attname));
+
+		namestrcpy(&columns[num_columns].column_name, NameStr(attr->attname));
+		columns[num_columns].typid = attr->atttypid;
+		columns[num_columns].compressed_attno = compressed_attno;
+		num_columns++;
+	}
+
+	per_batch_ctx = AllocSetContextCreate(CurrentMemoryContext,
+										  "compressed column stats per batch",
+										  ALLOCSET_DEFAULT_SIZES);
+	slot = table_slot_create(compressed_rel, NULL);
+	scan = table_beginscan(compressed_rel, GetActiveSnapshot(), 0, NULL);
+
+	while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+	{
+		bool isnull;
+		int32 batch_rows = DatumGetInt32(slot_getattr(slot, count_attno, &isnull));
+
+		Ensure(!isnull, "missing row count of compressed batch");
+
+		for (int i = 0; i < num_columns; i++)
+		{
+			Datum value = slot_getattr(slot, columns[i].compressed_attno, &isnull);
+			column_stats_add_batch(&columns[i], value, isnull, batch_rows, per_batch_ctx);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	table_endscan(scan);
+	ExecDropSingleTupleTableSlot(slot);
+	MemoryContextDelete(per_batch_ctx);
+
+	for (int i = 0; i < num_columns; i++)
+	{
+		for (int alg = 0; alg < _END_COMPRESSION_ALGORITHMS; alg++)
+		{
+			const AlgorithmStats *stats = &columns[i].algorithms[alg];
+			Datum values[Natts_compressed_column_stats];
+			bool nulls[Natts_compressed_column_stats] = { false };
+
+			if (stats->batches == 0)
+				continue;
+
+			values[AttrNumberGetAttrOffset(Anum_compressed_column_stats_column_name)] =
+				NameGetDatum(&columns[i].column_name);
+			values[AttrNumberGetAttrOffset(Anum_compressed_column_stats_algorithm)] =
+				NameGetDatum(compression_get_algorithm_name(alg));
+			values[AttrNumberGetAttrOffset(Anum_compressed_column_stats_batches)] =
+				Int64GetDatum(stats->batches);
+			values[AttrNumberGetAttrOffset(Anum_compressed_column_stats_rows)] =
+				Int64GetDatum(stats->rows);
+			values[AttrNumberGetAttrOffset(Anum_compressed_column_stats_compressed_bytes)] =
+				Int64GetDatum(stats->compressed_bytes);
+			values[AttrNumberGetAttrOffset(Anum_compressed_column_stats_avg_batch_rows)] =
+				Float8GetDatum((double) stats->rows / stats->batches);
+
+			if (stats->rows > 0)
+			{
+				values[AttrNumberGetAttrOffset(Anum_compressed_column_stats_null_fraction)] =
+					Float8GetDatum((double) stats->null_rows / stats->rows);
+				values[AttrNumberGetAttrOffset(Anum_compressed_column_stats_decode_ns_per_row)] =
+					Float8GetDatum((double) stats->decode_ns / stats->rows);
+			}
+			else
+			{
+				nulls[AttrNumberGetAttrOffset(Anum_compressed_column_stats_null_fraction)] = true;
+				nulls[AttrNumberGetAttrOffset(Anum_compressed_column_stats_decode_ns_per_row)] =
+					true;
+			}
+
+			result = lappend(result, heap_form_tuple(tupdesc, values, nulls));
+		}
+	}
+
+	table_close(compressed_rel, AccessShareLock);
+	table_close(chunk_rel, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * _timescaledb_functions.compressed_column_stats(chunk regclass)
+ *
+ * Return the statistics of the compressed columns of a chunk, one row for
+ * each column and compression algorithm used by its batches. The batches
+ * are decompressed to count the nulls and to measure the decode time, so this
+ * reads the whole compressed chunk.
+ */
+Datum
+tsl_compressed_column_stats(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	List *tuples;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		Oid chunk_relid = PG_GETARG_OID(0);
+		MemoryContext oldcontext;
+		TupleDesc tupdesc;
+		Chunk *chunk;
+		AclResult aclresult;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in "
+							"context that cannot accept type record")));
+
+		chunk = ts_chunk_get_by_relid(chunk_relid, false);
+		if (chunk == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("\"%s\" is not a chunk", get_rel_name(chunk_relid))));
+
+		aclresult = pg_class_aclcheck(chunk_relid, GetUserId(), ACL_SELECT);
+		if (aclresult != ACLCHECK_OK)
+			aclcheck_error(aclresult, get_relkind_objtype(get_rel_relkind(chunk_relid)),
+						   get_rel_name(chunk_relid));
+
+		if (!ts_chunk_is_compressed(chunk))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("chunk \"%s\" is not compressed", get_rel_name(chunk_relid))));
+
+		funcctx->user_fctx =
+			compressed_column_stats_collect(chunk_relid, BlessTupleDesc(tupdesc));
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	tuples = funcctx->user_fctx;
+
+	if (funcctx->call_cntr >= (uint64) list_length(tuples))
+		SRF_RETURN_DONE(funcctx);
+
+	SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(list_nth(tuples, funcctx->call_cntr)));
+}
+
+/*
+ * The cost of decoding one row of a compressed column, by compression
+ * algorithm, in units of cpu_operator_cost. The defaults are typical for the
+ * bulk decompression on current x86-64 servers. The measurements of
+ * calibrate_decompression_cost() are stored in the metadata table and take
+ * precedence over the defaults.
+ */
+static const double default_decode_cost[_END_COMPRESSION_ALGORITHMS] = {
+	[COMPRESSION_ALGORITHM_ARRAY] = 1.0,
+	[COMPRESSION_ALGORITHM_DICTIONARY] = 0.5,
+	[COMPRESSION_ALGORITHM_GORILLA] = 0.3,
+	[COMPRESSION_ALGORITHM_DELTADELTA] = 0.2,
+	[COMPRESSION_ALGORITHM_BOOL] = 0.05,
+	[COMPRESSION_ALGORITHM_NULL] = 0,
+	[COMPRESSION_ALGORITHM_FOR] = 0.2,
+	[COMPRESSION_ALGORITHM_ALP] = 0.3,
+	[COMPRESSION_ALGORITHM_FSST] = 1.0,
+	[COMPRESSION_ALGORITHM_BLOCK] = 1.0,
+	[COMPRESSION_ALGORITHM_UUID] = 0.5,
+	[COMPRESSION_ALGORITHM_JSONB] = 1.0,
+};
+
+#define DECODE_COST_METADATA_KEY_PREFIX "decompression_cost_"
+
+/*
+ * The decode costs of the current backend, loaded from the metadata table on
+ * first use and invalidated with the relcache of the metadata table.
+ */
+static double decode_cost[_END_COMPRESSION_ALGORITHMS];
+static bool decode_cost_valid = false;
+static Oid decode_cost_metadata_relid = InvalidOid;
+
+static char *
+decode_cost_metadata_key(CompressionAlgorithm algorithm)
+{
+	const char *name = NameStr(*compression_get_algorithm_name(algorithm));
+
+	return psprintf(DECODE_COST_METADATA_KEY_PREFIX "%s", asc_tolower(name, strlen(name)));
+}
+
+/*
+ * Get the cost of decoding one row of a column compressed with the given
+ * algorithm, in units of cpu_operator_cost.
+ */
+double
+compression_decode_cost_per_row(CompressionAlgorithm algorithm)
+{
+	if (algorithm <= _INVALID_COMPRESSION_ALGORITHM || algorithm >= _END_COMPRESSION_ALGORITHMS)
+		elog(ERROR, "invalid compression algorithm %d", algorithm);
+
+	if (!decode_cost_valid)
+	{
+		for (int algo = 1; algo < _END_COMPRESSION_ALGORITHMS; algo++)
+		{
+			bool isnull;
+			Datum value = ts_metadata_get_value(decode_cost_metadata_key(algo), FLOAT8OID, &isnull);
+
+			decode_cost[algo] = isnull ? default_decode_cost[algo] : DatumGetFloat8(value);
+		}
+
+		decode_cost_metadata_relid = catalog_get_table_id(ts_catalog_get(), METADATA);
+		decode_cost_valid = true;
+	}
+
+	return decode_cost[algorithm];
+}
+
+static void
+decode_cost_relcache_callback(Datum arg, Oid relid)
+{
+	if (!OidIsValid(relid) || relid == decode_cost_metadata_relid)
+		decode_cost_valid = false;
+}
+
+/*
+ * The data that the decode cost is calibrated with, for each algorithm that
+ * can be measured with the synthetic data. The number of distinct values is
+ * zero if all values are distinct.
+ */
+typedef struct DecodeCostSample
+{
+	CompressionAlgorithm algorithm;
+	Oid typid;
+	int distinct_values;
+} DecodeCostSample;
+
+static const DecodeCostSample decode_cost_samples[] = {
+	{ COMPRESSION_ALGORITHM_DELTADELTA, INT8OID, 0 },
+	{ COMPRESSION_ALGORITHM_FOR, INT8OID, 0 },
+	{ COMPRESSION_ALGORITHM_GORILLA, FLOAT8OID, 0 },
+	{ COMPRESSION_ALGORITHM_ALP, FLOAT8OID, 0 },
+	{ COMPRESSION_ALGORITHM_BOOL, BOOLOID, 2 },
+	{ COMPRESSION_ALGORITHM_DICTIONARY, TEXTOID, 16 },
+	{ COMPRESSION_ALGORITHM_ARRAY, TEXTOID, 0 },
+	{ COMPRESSION_ALGORITHM_FSST, TEXTOID, 0 },
+};
+
+/* The number of batches that are decompressed in each round of the calibration */
+#define DECODE_COST_BATCHES 100
+#define DECODE_COST_ROUNDS 10
+
+/*
+ * Make the value of the given row of the sample data. The integers look like
+ * timestamps, the floats like sensor readings, and the texts like device
+ * names or log messages.
+ */
+static Datum
+decode_cost_sample_value(const DecodeCostSample *sample, int64 row, pg_prng_state *prng)
+{
+	const int64 value = sample->distinct_values > 0 ?
+							(int64) pg_prng_uint64_range(prng, 0, sample->distinct_values - 1) :
+							row;
+
+	switch (sample->typid)
+	{
+		case INT8OID:
+			return Int64GetDatum(value * 1000000 + (int64) pg_prng_uint64_range(prng, 0, 999));
+		case FLOAT8OID:
+			return Float8GetDatum(20.0 + (double) pg_prng_uint64_range(prng, 0, 1000) / 100);
+		case BOOLOID:
+			return BoolGetDatum(value != 0);
+		default:
+			Assert(sample->typid == TEXTOID);
+			if (sample->distinct_values > 0)
+				return PointerGetDatum(cstring_to_text(psprintf("device-%03d", (int) value)));
+			return PointerGetDatum(cstring_to_text(
+				psprintf("request %lld took %u ms",
+						 (long long) value,
+						 (unsigned) pg_prng_uint64_range(prng, 0, 9999))));
+	}
+}
+
+/*
+ * Compress the sample data with the algorithm of the sample. Returns NULL if
+ * the algorithm does not compress the data.
+ */
+static CompressedDataHeader **
+decode_cost_compress_sample(const DecodeCostSample *sample)
+{
+	const CompressionAlgorithmDefinition *def = algorithm_definition(sample->algorithm);
+	CompressedDataHeader **batches = palloc0(sizeof(CompressedDataHeader *) * DECODE_COST_BATCHES);
+	pg_prng_state prng;
+
+	pg_prng_seed(&prng, 0);
+
+	for (int batch = 0; batch < DECODE_COST_BATCHES; batch++)
+	{
+		Compressor *compressor = def->compressor_for_type(sample->typid);
+
+		for (int row = 0; row < TARGET_COMPRESSED_BATCH_SIZE; row++)
+		{
+			const int64 sample_row = (int64) batch * TARGET_COMPRESSED_BATCH_SIZE + row;
+			compressor->append_val(compressor, decode_cost_sample_value(sample, sample_row, &prng));
+		}
+
+		batches[batch] = compressor->finish(compressor);
+		if (batches[batch] == NULL || batches[batch]->compression_algorithm != sample->algorithm)
+			return NULL;
+	}
+
+	return batches;
+}
+
+/*
+ * The time of decompressing one row of the sample, in nanoseconds, which is
+ * the minimum over the rounds to exclude the interruptions.
+ */
+static double
+decode_cost_measure_sample(const DecodeCostSample *sample, CompressedDataHeader **batches,
+						   MemoryContext per_batch_ctx)
+{
+	double min_seconds = -1;
+
+	for (int round = 0; round < DECODE_COST_ROUNDS; round++)
+	{
+		instr_time start;
+		instr_time duration;
+		MemoryContext old_ctx = MemoryContextSwitchTo(per_batch_ctx);
+
+		INSTR_TIME_SET_CURRENT(start);
+		for (int batch = 0; batch < DECODE_COST_BATCHES; batch++)
+		{
+			batch_count_nulls(batches[batch], sample->typid, per_batch_ctx);
+			MemoryContextReset(per_batch_ctx);
+		}
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+
+		MemoryContextSwitchTo(old_ctx);
+
+		if (min_seconds < 0 || INSTR_TIME_GET_DOUBLE(duration) < min_seconds)
+			min_seconds = INSTR_TIME_GET_DOUBLE(duration);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	return min_seconds * 1e9 / ((double) DECODE_COST_BATCHES * TARGET_COMPRESSED_BATCH_SIZE);
+}
+
+/*
+ * The time of one operator call, in nanoseconds, which is what the
+ * cpu_operator_cost stands for. This is measured with the int8 comparison,
+ * over the same number of rows as the decompression.
+ */
+static double
+decode_cost_measure_operator(void)
+{
+	const int64 calls = (int64) DECODE_COST_BATCHES * TARGET_COMPRESSED_BATCH_SIZE;
+	double min_seconds = -1;
+	FmgrInfo flinfo;
+	int64 passed = 0;
+
+	fmgr_info(F_INT8LT, &flinfo);
+
+	for (int round = 0; round < DECODE_COST_ROUNDS; round++)
+	{
+		instr_time start;
+		instr_time duration;
+
+		INSTR_TIME_SET_CURRENT(start);
+		for (int64 i = 0; i < calls; i++)
+		{
+			if (DatumGetBool(FunctionCall2(&flinfo, Int64GetDatum(i), Int64GetDatum(calls / 2))))
+				passed++;
+		}
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+
+		if (min_seconds < 0 || INSTR_TIME_GET_DOUBLE(duration) < min_seconds)
+			min_seconds = INSTR_TIME_GET_DOUBLE(duration);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/* Use the result so that the calls can't be optimized away. */
+	if (passed != (int64) DECODE_COST_ROUNDS * (calls / 2))
+		elog(ERROR, "unexpected result of the operator calls");
+
+	return min_seconds * 1e9 / calls;
+}
+
+/*
+ * _timescaledb_functions.calibrate_decompression_cost(store bool)
+ *
+ * Measure the decode cost of the compression algorithms on the current
+ * hardware, relative to the cost of an operator call, by decompressing
+ * synthetic batches. The planner uses these costs for the decompression of
+ * the compressed chunks. If requested, the costs are stored in the metadata
+ * table of the database, which requires superuser because they affect the
+ * plans of all users. The algorithms that can't be measured with the
+ * synthetic data keep their default cost.
+ */
+Datum
+tsl_calibrate_decompression_cost(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	List *tuples;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		const bool store = PG_GETARG_BOOL(0);
+		MemoryContext oldcontext;
+		TupleDesc tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in "
+							"context that cannot accept type record")));
+
+		if (store && !superuser())
+			ereport(ERROR,
+					(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+					 errmsg("must be superuser to store the decompression costs")));
+
+		tupdesc = BlessTupleDesc(tupdesc);
+		tuples = NIL;
+
+		MemoryContext per_sample_ctx = AllocSetContextCreate(CurrentMemoryContext,
+															 "decompression cost per sample",
+															 ALLOCSET_DEFAULT_SIZES);
+		MemoryContext per_batch_ctx = AllocSetContextCreate(CurrentMemoryContext,
+															"decompression cost per batch",
+															ALLOCSET_DEFAULT_SIZES);
+		const double operator_ns = decode_cost_measure_operator();
+
+		for (int i = 0; i < (int) lengthof(decode_cost_samples); i++)
+		{
+			const DecodeCostSample *sample = &decode_cost_samples[i];
+			Datum values[Natts_decompression_cost];
+			bool nulls[Natts_decompression_cost] = { false };
+
+			MemoryContextReset(per_sample_ctx);
+			MemoryContext sample_oldcontext = MemoryContextSwitchTo(per_sample_ctx);
+			CompressedDataHeader **batches = decode_cost_compress_sample(sample);
+			MemoryContextSwitchTo(sample_oldcontext);
+
+			if (batches == NULL)
+				continue;
+
+			const double decode_ns = decode_cost_measure_sample(sample, batches, per_batch_ctx);
+			const double cost = operator_ns > 0 ? decode_ns / operator_ns :
+												  default_decode_cost[sample->algorithm];
+
+			if (store)
+			{
+				const char *key = decode_cost_metadata_key(sample->algorithm);
+
+				/* The insert doesn't replace an existing value */
+				ts_metadata_drop(key);
+				CommandCounterIncrement();
+				ts_metadata_insert(key, Float8GetDatum(cost), FLOAT8OID, false);
+			}
+
+			values[AttrNumberGetAttrOffset(Anum_decompression_cost_algorithm)] =
+				NameGetDatum(compression_get_algorithm_name(sample->algorithm));
+			values[AttrNumberGetAttrOffset(Anum_decompression_cost_decode_ns_per_row)] =
+				Float8GetDatum(decode_ns);
+			values[AttrNumberGetAttrOffset(Anum_decompression_cost_cost_per_row)] =
+				Float8GetDatum(cost);
+			tuples = lappend(tuples, heap_form_tuple(tupdesc, values, nulls));
+		}
+
+		MemoryContextDelete(per_batch_ctx);
+		MemoryContextDelete(per_sample_ctx);
+
+		/* Make the other backends reload the costs */
+		if (store)
+			CacheInvalidateRelcacheByRelid(catalog_get_table_id(ts_catalog_get(), METADATA));
+
+		funcctx->user_fctx = tuples;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	tuples = funcctx->user_fctx;
+
+	if (funcctx->call_cntr >= (uint64) list_length(tuples))
+		SRF_RETURN_DONE(funcctx);
+
+	SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(list_nth(tuples, funcctx->call_cntr)));
+}
+
+void
+_compression_stats_init(void)
+{
+	static bool relcache_callback_registered = false;
+
+	/* There is no way to unregister a relcache callback, so only register it once. */
+	if (!relcache_callback_registered)
+	{
+		CacheRegisterRelcacheCallback(decode_cost_relcache_callback, PointerGetDatum(NULL));
+		relcache_callback_registered = true;
+	}
+}
@@ -0,0 +1,16 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <fmgr.h>
+
+#include "compression.h"
+
+extern Datum tsl_compressed_column_stats(PG_FUNCTION_ARGS);
+extern Datum tsl_calibrate_decompression_cost(PG_FUNCTION_ARGS);
+extern double compression_decode_cost_per_row(CompressionAlgorithm algorithm);
+extern void _compression_stats_init(void);
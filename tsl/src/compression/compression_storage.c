@@ -11,6 +11,7 @@
  */
 
 #include <postgres.h>
+#include <access/htup_details.h>
 #include <access/reloptions.h>
 #include <access/xact.h>
 #include <catalog/indexing.h>
@@ -251,11 +252,14 @@ modify_compressed_toast_table_storage(CompressionSettings *settings, List *colde
 			 * hypertable but they do not have compresseddata datatype
 			 * and therefore would be skipped.
 			 */
-			attno = get_attnum(settings->fd.relid, cd->colname);
-			Assert(attno != InvalidAttrNumber);
-			Oid typid = get_atttype(settings->fd.relid, attno);
+			HeapTuple tuple = SearchSysCacheAttName(settings->fd.relid, cd->colname);
+			Ensure(HeapTupleIsValid(tuple),
+				   "column \"%s\" not found in relation %u",
+				   cd->colname,
+				   settings->fd.relid);
 			CompressionStorage stor =
-				compression_get_toast_storage(compression_get_default_algorithm(typid));
+				compression_get_column_toast_storage((Form_pg_attribute) GETSTRUCT(tuple));
+			ReleaseSysCache(tuple);
 			if (stor != TOAST_STORAGE_EXTERNAL)
 			/* external is default storage for toast columns */
 			{
@@ -38,11 +38,13 @@
 #include "chunk.h"
 #include "chunk_index.h"
 #include "compression.h"
+#include "compression/batch_metadata_builder_bloom1.h"
 #include "compression/compression_storage.h"
 #include "compression_with_clause.h"
 #include "create.h"
 #include "custom_type_cache.h"
 #include "guc.h"
+#include "hypercore/hypercore_sparse.h"
 #include "hypertable_cache.h"
 #include "trigger.h"
 #include "ts_catalog/array_utils.h"
@@ -52,7 +54,7 @@
 #include "utils.h"
 #include <executor/spi.h>
 
-static const char *sparse_index_types[] = { "min", "max" };
+static const char *sparse_index_types[] = { "min", "max", "bloom1" };
 
 #ifdef USE_ASSERT_CHECKING
 static bool
@@ -182,11 +184,15 @@ build_columndefs(CompressionSettings *settings, Oid src_relid)
 	Relation rel = table_open(src_relid, AccessShareLock);
 
 	Bitmapset *btree_columns = NULL;
+	Bitmapset *hash_columns = NULL;
 	if (ts_guc_auto_sparse_indexes)
 	{
+		const Oid hypercore_sparse_am_oid = get_am_oid(HYPERCORE_SPARSE_AM_NAME, true);
+
 		/*
 		 * Check which columns have btree indexes. We will create sparse minmax
-		 * indexes for them in compressed chunk.
+		 * indexes for them in compressed chunk. For the columns with hash
+		 * indexes, we create the bloom filter sparse indexes instead.
 		 */
 		ListCell *lc;
 		List *index_oids = RelationGetIndexList(rel);
@@ -205,9 +211,22 @@ build_columndefs(CompressionSettings *settings, Oid src_relid)
 			 * We can be smarter here, e.g. for 'BRIN', sparse minmax can be similar
 			 * to 'BRIN' with range opclass, but not for bloom filter opclass. For GIN,
 			 * sparse minmax is useless because it doesn't help satisfy text search
-			 * queries, and so on. Currently we check only the simplest btree case.
+			 * queries, and so on. Currently we check only the simplest btree case,
+			 * and the hash indexes which satisfy only the equality tests, same as
+			 * the sparse bloom filter. The hypercore sparse indexes are keyed on
+			 * the min metadata, so they are handled like btree.
 			 */
-			if (index_info->ii_Am != BTREE_AM_OID)
+			if (index_info->ii_Am == HASH_AM_OID)
+			{
+				AttrNumber attno = index_info->ii_IndexAttrNumbers[0];
+				if (attno != InvalidAttrNumber)
+				{
+					hash_columns = bms_add_member(hash_columns, attno);
+				}
+				continue;
+			}
+
+			if (index_info->ii_Am != BTREE_AM_OID && index_info->ii_Am != hypercore_sparse_am_oid)
 			{
 				continue;
 			}
@@ -316,6 +335,21 @@ build_columndefs(CompressionSettings *settings, Oid src_relid)
 										  attr->attcollation));
 			}
 		}
+		else if (bms_is_member(attr->attnum, hash_columns) &&
+				 bloom1_type_is_supported(attr->atttypid))
+		{
+			/*
+			 * The bloom filter is a bytea, and uses the extended hash function
+			 * of the column type, which the hash indexes normally have.
+			 */
+			compressed_column_defs =
+				lappend(compressed_column_defs,
+						makeColumnDef(compressed_column_metadata_name_v2("bloom1",
+																		 NameStr(attr->attname)),
+									  BYTEAOID,
+									  /* typmod = */ -1,
+									  /* collOid = */ InvalidOid));
+		}
 
 		compressed_column_defs = lappend(compressed_column_defs,
 										 makeColumnDef(NameStr(attr->attname),
@@ -0,0 +1,115 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#include <postgres.h>
+#include <access/table.h>
+#include <utils/inval.h>
+#include <utils/rel.h>
+#include <utils/tuplesort.h>
+
+#include "api.h"
+#include "chunk.h"
+#include "compression.h"
+#include "direct_compress.h"
+#include "ts_catalog/compression_settings.h"
+
+struct DirectCompressState
+{
+	CompressionSettings *settings;
+	Tuplesortstate *sortstate;
+	int64 nrows;
+};
+
+DirectCompressState *
+direct_compress_begin(ChunkInsertState *cis)
+{
+	CompressionSettings *settings = ts_compression_settings_get(RelationGetRelid(cis->rel));
+	DirectCompressState *state;
+
+	/* The chunk might be compressed without separate settings in rare cases */
+	if (settings == NULL || !OidIsValid(settings->fd.compress_relid))
+		return NULL;
+
+	state = palloc0(sizeof(DirectCompressState));
+	state->settings = settings;
+	state->sortstate = compression_create_tuplesort_state(settings, cis->rel);
+
+	elog(DEBUG1,
+		 "compressing rows inserted into \"%s\" directly",
+		 RelationGetRelationName(cis->rel));
+
+	return state;
+}
+
+void
+direct_compress_insert(DirectCompressState *state, TupleTableSlot *slot)
+{
+	tuplesort_puttupleslot(state->sortstate, slot);
+	state->nrows++;
+}
+
+/*
+ * Compress the buffered rows into the compressed chunk. The rows are already
+ * sorted, so all the rows of a segment go into the same batches, which are
+ * split at the batch size limit like in the regular compression.
+ */
+void
+direct_compress_end(ChunkInsertState *cis)
+{
+	DirectCompressState *state = cis->direct_compress;
+	Relation compressed_rel;
+	RowCompressor row_compressor;
+	Chunk *chunk;
+
+	cis->direct_compress = NULL;
+
+	if (state->nrows == 0)
+	{
+		tuplesort_end(state->sortstate);
+		return;
+	}
+
+	tuplesort_performsort(state->sortstate);
+
+	compressed_rel = table_open(state->settings->fd.compress_relid, RowExclusiveLock);
+	row_compressor_init(state->settings,
+						&row_compressor,
+						cis->rel,
+						compressed_rel,
+						RelationGetDescr(compressed_rel)->natts,
+						true /*need_bistate*/,
+						0 /*insert_options*/);
+	row_compressor_append_sorted_rows(&row_compressor,
+									  state->sortstate,
+									  RelationGetDescr(cis->rel),
+									  cis->rel);
+	const int64 rowcnt_pre_compression = row_compressor.rowcnt_pre_compression;
+	const int64 rowcnt_post_compression = row_compressor.num_compressed_rows;
+	row_compressor_close(&row_compressor);
+	tuplesort_end(state->sortstate);
+	table_close(compressed_rel, NoLock);
+
+	chunk = ts_chunk_get_by_relid(RelationGetRelid(cis->rel), true);
+
+	/*
+	 * Update the compression stats like compress_chunk does. The rows were
+	 * never stored in the uncompressed chunk, so its size does not change.
+	 */
+	RelationSize no_size = { 0 };
+	RelationSize compressed_size = ts_relation_size_impl(state->settings->fd.compress_relid);
+	compression_chunk_size_catalog_update_merged(chunk->fd.id,
+												 &no_size,
+												 chunk->fd.compressed_chunk_id,
+												 &compressed_size,
+												 rowcnt_pre_compression,
+												 rowcnt_post_compression);
+
+	if (!ts_chunk_is_unordered(chunk))
+	{
+		ts_chunk_set_unordered(chunk);
+		/* changed chunk status, so invalidate any plans involving this chunk */
+		CacheInvalidateRelcacheByRelid(RelationGetRelid(cis->rel));
+	}
+}
@@ -0,0 +1,26 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+/*
+ * Direct compression of the rows inserted into compressed chunks.
+ *
+ * Instead of inserting the rows into the uncompressed chunk, which makes the
+ * chunk partial until it is recompressed, the rows are buffered in a
+ * tuplesort per chunk insert state, sorted by the segmentby and orderby
+ * columns, and written as new batches to the compressed chunk when the chunk
+ * insert state is destroyed. The new batches can overlap the existing ones,
+ * so the chunk is marked as unordered.
+ */
+
+#include <postgres.h>
+#include <executor/tuptable.h>
+
+#include "nodes/chunk_dispatch/chunk_insert_state.h"
+
+extern DirectCompressState *direct_compress_begin(ChunkInsertState *cis);
+extern void direct_compress_insert(DirectCompressState *state, TupleTableSlot *slot);
+extern void direct_compress_end(ChunkInsertState *cis);
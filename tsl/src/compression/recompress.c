@@ -5,8 +5,12 @@
  */
 
 #include <postgres.h>
+#include <access/genam.h>
+#include <catalog/index.h>
+#include <executor/executor.h>
 #include <parser/parse_coerce.h>
 #include <parser/parse_relation.h>
+#include <utils/datum.h>
 #include <utils/inval.h>
 #include <utils/lsyscache.h>
 #include <utils/rel.h>
@@ -19,8 +23,11 @@
 #include "compression_dml.h"
 #include "create.h"
 #include "debug_assert.h"
+#include "debug_point.h"
 #include "guc.h"
+#include "hypercore/arrow_tts.h"
 #include "hypercore/hypercore_handler.h"
+#include "hypercore/hypercore_sparse.h"
 #include "hypercore/utils.h"
 #include "indexing.h"
 #include "recompress.h"
@@ -50,6 +57,12 @@ static bool check_changed_group(CompressedSegmentInfo *current_segment, TupleTab
 								int nsegmentby_cols);
 static void recompress_segment(Tuplesortstate *tuplesortstate, Relation compressed_chunk_rel,
 							   RowCompressor *row_compressor);
+static bool create_batch_range_scankey(CompressionSettings *settings, Relation index_rel,
+									   Relation compressed_chunk_rel, ScanKey range_scankey);
+static bool has_concurrent_dml(Chunk *uncompressed_chunk);
+static void try_clear_partial_status(Chunk *uncompressed_chunk, Relation uncompressed_chunk_rel,
+									 bool has_unique_constraints);
+static Oid recompress_hypercore_merge_impl(Chunk *uncompressed_chunk);
 /*
  * Recompress an existing chunk by decompressing the batches
  * that are affected by the addition of newer data. The existing
@@ -88,7 +101,7 @@ tsl_recompress_chunk_segmentwise(PG_FUNCTION_ARGS)
 							"timescaledb.enable_segmentwise_recompression to on")));
 		}
 		CompressionSettings *settings = ts_compression_settings_get(uncompressed_chunk_id);
-		if (!settings->fd.orderby)
+		if (!settings->fd.orderby && !ts_is_hypercore_am(chunk->amoid))
 		{
 			ereport(ERROR,
 					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
@@ -121,6 +134,10 @@ recompress_chunk_segmentwise_impl(Chunk *uncompressed_chunk)
 			 NameStr(uncompressed_chunk->fd.schema_name),
 			 NameStr(uncompressed_chunk->fd.table_name));
 
+	/* A hypercore only needs its non-compressed rows to be merged */
+	if (ts_is_hypercore_am(uncompressed_chunk->amoid))
+		return recompress_hypercore_merge_impl(uncompressed_chunk);
+
 	/* need it to find the segby cols from the catalog */
 	Chunk *compressed_chunk = ts_chunk_get_by_id(uncompressed_chunk->fd.compressed_chunk_id, true);
 	CompressionSettings *settings = ts_compression_settings_get(uncompressed_chunk->table_id);
@@ -143,9 +160,6 @@ recompress_chunk_segmentwise_impl(Chunk *uncompressed_chunk)
 
 	bool has_unique_constraints =
 		ts_indexing_relation_has_primary_or_unique_index(uncompressed_chunk_rel);
-	int count;
-	LOCKTAG locktag;
-	SET_LOCKTAG_RELATION(locktag, MyDatabaseId, uncompressed_chunk_id);
 
 	/*
 	 * Recompression does not block inserts but it can interfere with
@@ -156,23 +170,12 @@ recompress_chunk_segmentwise_impl(Chunk *uncompressed_chunk)
 	 * If there are unique constraints and multiple INSERTs happening at start
 	 * we want to just bail out so not to cause wasted work and bloat.
 	 */
-	if (has_unique_constraints)
+	if (has_unique_constraints && has_concurrent_dml(uncompressed_chunk))
 	{
-		GetLockConflicts(&locktag, ExclusiveLock, &count);
-
-		if (count > 1)
-		{
-			elog(WARNING,
-				 "skipping recompression of chunk %s.%s due to unique constraints and concurrent "
-				 "DML",
-				 NameStr(uncompressed_chunk->fd.schema_name),
-				 NameStr(uncompressed_chunk->fd.table_name));
-
-			table_close(uncompressed_chunk_rel, NoLock);
-			table_close(compressed_chunk_rel, NoLock);
+		table_close(uncompressed_chunk_rel, NoLock);
+		table_close(compressed_chunk_rel, NoLock);
 
-			PG_RETURN_OID(uncompressed_chunk_id);
-		}
+		PG_RETURN_OID(uncompressed_chunk_id);
 	}
 
 	/*
@@ -267,10 +270,16 @@ recompress_chunk_segmentwise_impl(Chunk *uncompressed_chunk)
 					NameStr(uncompressed_chunk->fd.table_name))));
 
 	/* Setting up scankeys */
-	ScanKeyData *index_scankeys = palloc(sizeof(ScanKeyData) * num_segmentby);
+	ScanKeyData *index_scankeys = palloc(sizeof(ScanKeyData) * (num_segmentby + 1));
 	ScanKeyData *orderby_scankeys = palloc(sizeof(ScanKeyData) * num_orderby * 2);
 	create_segmentby_scankeys(settings, index_rel, compressed_chunk_rel, index_scankeys);
 	create_orderby_scankeys(settings, index_rel, compressed_chunk_rel, orderby_scankeys);
+	bool have_range_scankey = create_batch_range_scankey(settings,
+														 index_rel,
+														 compressed_chunk_rel,
+														 &index_scankeys[num_segmentby]);
+	const int first_orderby_offset = current_segment[num_segmentby].decompressed_chunk_offset;
+	Datum range_first_value = (Datum) 0;
 
 	/* Used for sorting and iterating over all the uncompressed tuples that have
 	 * to be recompressed. These tuples are sorted based on the segmentby and
@@ -311,6 +320,10 @@ recompress_chunk_segmentwise_impl(Chunk *uncompressed_chunk)
 	HeapTuple compressed_tuple;
 	IndexScanDesc index_scan =
 		index_beginscan(compressed_chunk_rel, index_rel, snapshot, num_segmentby, 0);
+	IndexScanDesc range_index_scan =
+		have_range_scankey ?
+			index_beginscan(compressed_chunk_rel, index_rel, snapshot, num_segmentby + 1, 0) :
+			NULL;
 
 	bool found_tuple = fetch_uncompressed_chunk_into_tuplesort(input_tuplesortstate,
 															   uncompressed_chunk_rel,
@@ -340,13 +353,47 @@ recompress_chunk_segmentwise_impl(Chunk *uncompressed_chunk)
 								num_orderby,
 								orderby_scankeys);
 
-		index_rescan(index_scan, index_scankeys, num_segmentby, NULL, 0);
+		/*
+		 * The uncompressed tuples of the segment are sorted, so the batches
+		 * that end before the first tuple cannot overlap with any of them.
+		 * These batches are kept as they are, so we filter them out already
+		 * in the index, without fetching them from the heap. The NULL values
+		 * are not in the batch metadata, so we can't do this for them.
+		 */
+		IndexScanDesc segment_index_scan = index_scan;
+		if (have_range_scankey)
+		{
+			bool is_null;
+			Datum first_value = slot_getattr(uncompressed_slot,
+											 AttrOffsetGetAttrNumber(first_orderby_offset),
+											 &is_null);
+			if (!is_null)
+			{
+				/*
+				 * The uncompressed slot moves on during the index scan, so
+				 * the index scan needs its own copy of the value.
+				 */
+				Form_pg_attribute attr = TupleDescAttr(uncompressed_rel_tupdesc,
+													   first_orderby_offset);
+				if (!attr->attbyval && range_first_value != (Datum) 0)
+					pfree(DatumGetPointer(range_first_value));
+				range_first_value = datumCopy(first_value, attr->attbyval, attr->attlen);
+				index_scankeys[num_segmentby].sk_argument = range_first_value;
+				segment_index_scan = range_index_scan;
+			}
+		}
+
+		index_rescan(segment_index_scan,
+					 index_scankeys,
+					 segment_index_scan->numberOfKeys,
+					 NULL,
+					 0);
 
 		bool done_with_segment = false;
 		bool tuples_for_recompression = false;
 		enum Batch_match_result result;
 
-		while (index_getnext_slot(index_scan, ForwardScanDirection, compressed_slot))
+		while (index_getnext_slot(segment_index_scan, ForwardScanDirection, compressed_slot))
 		{
 			/* Check if the uncompressed tuple is before, inside, or after the compressed batch */
 			result = match_tuple_batch(compressed_slot,
@@ -499,6 +546,8 @@ finish:
 	ExecDropSingleTupleTableSlot(uncompressed_slot);
 	ExecDropSingleTupleTableSlot(compressed_slot);
 	index_endscan(index_scan);
+	if (range_index_scan)
+		index_endscan(range_index_scan);
 	UnregisterSnapshot(snapshot);
 	index_close(index_rel, NoLock);
 	row_decompressor_close(&decompressor);
@@ -510,23 +559,50 @@ finish:
 	pfree(index_scankeys);
 	pfree(orderby_scankeys);
 
-	/* Need to rebuild indexes if the relation is using hypercore
-	 * TAM. Alternatively, we could insert into indexes when inserting into
-	 * the compressed rel. */
-	if (uncompressed_chunk_rel->rd_tableam == hypercore_routine())
-	{
-		ReindexParams params = {
-			.options = 0,
-			.tablespaceOid = InvalidOid,
-		};
+	try_clear_partial_status(uncompressed_chunk, uncompressed_chunk_rel, has_unique_constraints);
+
+	table_close(uncompressed_chunk_rel, NoLock);
+	table_close(compressed_chunk_rel, NoLock);
+
+	PG_RETURN_OID(uncompressed_chunk_id);
+}
+
+/*
+ * Check if there is concurrent DML on the chunk, in which case recompression
+ * of a chunk with unique constraints is skipped.
+ */
+static bool
+has_concurrent_dml(Chunk *uncompressed_chunk)
+{
+	int count;
+	LOCKTAG locktag;
+	SET_LOCKTAG_RELATION(locktag, MyDatabaseId, uncompressed_chunk->table_id);
 
-#if PG17_GE
-		reindex_relation(NULL, RelationGetRelid(uncompressed_chunk_rel), 0, &params);
-#else
-		reindex_relation(RelationGetRelid(uncompressed_chunk_rel), 0, &params);
-#endif
+	GetLockConflicts(&locktag, ExclusiveLock, &count);
+
+	if (count > 1)
+	{
+		elog(WARNING,
+			 "skipping recompression of chunk %s.%s due to unique constraints and concurrent "
+			 "DML",
+			 NameStr(uncompressed_chunk->fd.schema_name),
+			 NameStr(uncompressed_chunk->fd.table_name));
+		return true;
 	}
 
+	return false;
+}
+
+/*
+ * Clear the partial status of the chunk if recompression left no
+ * non-compressed rows in it.
+ */
+static void
+try_clear_partial_status(Chunk *uncompressed_chunk, Relation uncompressed_chunk_rel,
+						 bool has_unique_constraints)
+{
+	Oid uncompressed_chunk_id = uncompressed_chunk->table_id;
+
 	/* If we can quickly upgrade the lock, lets try updating the chunk status to fully
 	 * compressed. But we need to check if there are any uncompressed tuples in the
 	 * relation since somebody might have inserted new tuples while we were recompressing.
@@ -583,11 +659,6 @@ finish:
 				 errmsg("aborting recompression due to concurrent DML on uncompressed "
 						"data, retrying with next policy run")));
 	}
-
-	table_close(uncompressed_chunk_rel, NoLock);
-	table_close(compressed_chunk_rel, NoLock);
-
-	PG_RETURN_OID(uncompressed_chunk_id);
 }
 
 static void
@@ -843,6 +914,42 @@ create_orderby_scankeys(CompressionSettings *settings, Relation index_rel,
 	}
 }
 
+/*
+ * Create the index scankey that filters out the batches that end before the
+ * given value of the first orderby column, i.e. the max metadata is less than
+ * the value, or for descending order the min metadata is greater than it.
+ *
+ * Returns false if the index doesn't have the metadata column.
+ */
+static bool
+create_batch_range_scankey(CompressionSettings *settings, Relation index_rel,
+						   Relation compressed_chunk_rel, ScanKey range_scankey)
+{
+	bool is_desc = ts_array_get_element_bool(settings->fd.orderby_desc, 1);
+	AttrNumber in_attnum = get_attnum(compressed_chunk_rel->rd_id,
+									  is_desc ? column_segment_min_name(1) :
+												column_segment_max_name(1));
+	if (in_attnum == InvalidAttrNumber)
+		return false;
+
+	for (int i = ts_array_length(settings->fd.segmentby); i < index_rel->rd_index->indnkeyatts;
+		 i++)
+	{
+		if (index_rel->rd_index->indkey.values[i] != in_attnum)
+			continue;
+
+		AttrNumber idx_attnum = AttrOffsetGetAttrNumber(i);
+		init_scankey(range_scankey,
+					 idx_attnum,
+					 attnumTypeId(index_rel, idx_attnum),
+					 attnumCollationId(index_rel, idx_attnum),
+					 is_desc ? BTLessEqualStrategyNumber : BTGreaterEqualStrategyNumber);
+		return true;
+	}
+
+	return false;
+}
+
 /* Deleting a tuple for recompression if we can.
  * If there is an unexpected result, we should just abort the operation completely.
  * There are potential optimizations that can be done here in certain scenarios.
@@ -866,3 +973,455 @@ delete_tuple_for_recompression(Relation rel, ItemPointer tid, Snapshot snapshot)
 
 	return result == TM_Ok;
 }
+
+/*
+ * An index of the hypercore that gets entries for the merged rows.
+ *
+ * Segmentby and sparse indexes have one entry per compressed tuple instead of
+ * one per row, see hypercore_index_build_callback(). A sparse index on a
+ * non-segmentby column is keyed on the min metadata of the batch.
+ */
+typedef struct MergeIndex
+{
+	Relation indexrel;
+	IndexInfo *indexinfo;
+	ExprState *predicate;
+	bool index_segments;
+	AttrNumber min_cattno;
+} MergeIndex;
+
+/*
+ * State for merging the non-compressed rows of a hypercore into its
+ * compressed relation. The row compressor must be the first member, so that
+ * the flush callback can get to the rest of the state.
+ */
+typedef struct HypercoreMergeState
+{
+	RowCompressor row_compressor;
+	Relation rel;
+	EState *estate;
+	int num_indexes;
+	MergeIndex *indexes;
+	/* Copies of the rows in the batch that is being compressed */
+	MemoryContext batch_mcxt;
+	MinimalTuple *batch_rows;
+	int num_batch_rows;
+	TupleTableSlot *row_slot;
+	TupleTableSlot *compressed_slot;
+	int64 num_merged_rows;
+} HypercoreMergeState;
+
+static void
+merge_open_indexes(HypercoreMergeState *state)
+{
+	const HypercoreInfo *hsinfo = RelationGetHypercoreInfo(state->rel);
+	List *indexoids = RelationGetIndexList(state->rel);
+	ListCell *lc;
+
+	state->num_indexes = 0;
+	state->indexes = palloc(sizeof(MergeIndex) * Max(list_length(indexoids), 1));
+
+	foreach (lc, indexoids)
+	{
+		Relation indexrel = index_open(lfirst_oid(lc), RowExclusiveLock);
+		IndexInfo *indexinfo = BuildIndexInfo(indexrel);
+		const bool is_sparse_index = hypercore_sparse_index_is_sparse(indexrel);
+		MergeIndex *index = &state->indexes[state->num_indexes++];
+		bool is_segmentby_index = true;
+
+		for (int i = 0; i < indexinfo->ii_NumIndexAttrs; i++)
+		{
+			const AttrNumber attno = indexinfo->ii_IndexAttrNumbers[i];
+
+			if (attno == InvalidAttrNumber ||
+				!hsinfo->columns[AttrNumberGetAttrOffset(attno)].is_segmentby)
+				is_segmentby_index = false;
+		}
+
+		*index = (MergeIndex){
+			.indexrel = indexrel,
+			.indexinfo = indexinfo,
+			.predicate = ExecPrepareQual(indexinfo->ii_Predicate, state->estate),
+			.index_segments = is_segmentby_index || is_sparse_index,
+			.min_cattno = InvalidAttrNumber,
+		};
+
+		if (is_sparse_index && !is_segmentby_index)
+		{
+			const AttrNumber attno = indexinfo->ii_IndexAttrNumbers[0];
+			const ColumnCompressionSettings *column =
+				&hsinfo->columns[AttrNumberGetAttrOffset(attno)];
+
+			if (!hypercore_column_has_minmax(column))
+				ereport(ERROR,
+						errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("column \"%s\" has no min/max metadata for a sparse index",
+							   NameStr(column->attname)));
+
+			index->min_cattno = column->cattnum_min;
+		}
+	}
+
+	list_free(indexoids);
+}
+
+static void
+merge_close_indexes(HypercoreMergeState *state)
+{
+	for (int i = 0; i < state->num_indexes; i++)
+		index_close(state->indexes[i].indexrel, NoLock);
+}
+
+/*
+ * Insert the index entries for the rows of the flushed batch.
+ *
+ * The rows get the encoded TIDs of their positions in the new compressed
+ * tuple, the same as when building the index, so the indexes don't have to
+ * be rebuilt. The index entries of the deleted non-compressed rows are
+ * removed by vacuum.
+ */
+static void
+on_merge_flush(RowCompressor *rowcompress, uint64 ntuples)
+{
+	HypercoreMergeState *state = (HypercoreMergeState *) rowcompress;
+	ExprContext *econtext = GetPerTupleExprContext(state->estate);
+	Datum values[INDEX_MAX_KEYS];
+	bool isnull[INDEX_MAX_KEYS];
+	bool have_compressed_tuple = false;
+
+	Assert(ntuples == (uint64) state->num_batch_rows);
+
+	for (int i = 0; i < state->num_indexes; i++)
+	{
+		const MergeIndex *index = &state->indexes[i];
+		const uint64 num_rows = index->index_segments ? 1 : ntuples;
+
+		for (uint64 row = 0; row < num_rows; row++)
+		{
+			ItemPointerData tid;
+
+			ResetExprContext(econtext);
+			ExecStoreMinimalTuple(state->batch_rows[row], state->row_slot, false);
+			econtext->ecxt_scantuple = state->row_slot;
+
+			if (!ExecQual(index->predicate, econtext))
+				continue;
+
+			FormIndexDatum(index->indexinfo, state->row_slot, state->estate, values, isnull);
+
+			if (AttributeNumberIsValid(index->min_cattno))
+			{
+				if (!have_compressed_tuple)
+				{
+					if (!table_tuple_fetch_row_version(rowcompress->compressed_table,
+													   &rowcompress->flushed_tid,
+													   SnapshotAny,
+													   state->compressed_slot))
+						elog(ERROR, "could not fetch the new compressed tuple");
+					have_compressed_tuple = true;
+				}
+
+				values[0] = slot_getattr(state->compressed_slot, index->min_cattno, &isnull[0]);
+			}
+
+			hypercore_tid_encode(&tid, &rowcompress->flushed_tid, row + 1);
+			index_insert(index->indexrel,
+						 values,
+						 isnull,
+						 &tid,
+						 state->rel,
+						 UNIQUE_CHECK_NO,
+						 false,
+						 index->indexinfo);
+		}
+	}
+
+	ExecClearTuple(state->row_slot);
+	ExecClearTuple(state->compressed_slot);
+	MemoryContextReset(state->batch_mcxt);
+	state->num_merged_rows += ntuples;
+	state->num_batch_rows = 0;
+}
+
+/*
+ * Add a row to the compressed batch and keep a copy of it for the index
+ * inserts when the batch is flushed. The row compressor flushes the previous
+ * batch before it adds a row that doesn't fit into it, so the row is copied
+ * only after that.
+ */
+static void
+merge_append_row(HypercoreMergeState *state, TupleTableSlot *slot, CommandId cid)
+{
+	row_compressor_append_ordered_slot(&state->row_compressor, slot, cid);
+
+	MemoryContext oldmcxt = MemoryContextSwitchTo(state->batch_mcxt);
+	Assert(state->num_batch_rows < state->row_compressor.max_batch_rows);
+	state->batch_rows[state->num_batch_rows++] = ExecCopySlotMinimalTuple(slot);
+	MemoryContextSwitchTo(oldmcxt);
+}
+
+/*
+ * Decompress the partial batches of the segment into the tuplesort and
+ * delete them, so that they are compressed again together with the new rows
+ * of the segment. Returns whether any batches were found.
+ *
+ * The partial batches are typically the last batches created by the previous
+ * merge, so this keeps the segments from filling up with small batches when
+ * new rows are merged often.
+ */
+static bool
+merge_fetch_partial_batches(HypercoreMergeState *state, IndexScanDesc index_scan,
+							ScanKey index_scankeys, RowDecompressor *decompressor,
+							Tuplesortstate *segment_tuplesort, Snapshot snapshot)
+{
+	Relation crel = state->row_compressor.compressed_table;
+	TupleTableSlot *compressed_slot = state->compressed_slot;
+	const AttrNumber count_attno =
+		AttrOffsetGetAttrNumber(state->row_compressor.count_metadata_column_offset);
+	bool found = false;
+
+	index_rescan(index_scan, index_scankeys, index_scan->numberOfKeys, NULL, 0);
+
+	while (index_getnext_slot(index_scan, ForwardScanDirection, compressed_slot))
+	{
+		bool isnull;
+		const int32 count = DatumGetInt32(slot_getattr(compressed_slot, count_attno, &isnull));
+
+		Assert(!isnull);
+		if ((uint32) count >= state->row_compressor.max_batch_rows)
+			continue;
+
+		bool should_free;
+		HeapTuple compressed_tuple = ExecFetchSlotHeapTuple(compressed_slot, false, &should_free);
+
+		heap_deform_tuple(compressed_tuple,
+						  RelationGetDescr(crel),
+						  decompressor->compressed_datums,
+						  decompressor->compressed_is_nulls);
+		row_decompressor_decompress_row_to_tuplesort(decompressor, segment_tuplesort);
+
+		if (!delete_tuple_for_recompression(crel, &compressed_slot->tts_tid, snapshot))
+			ereport(ERROR,
+					(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+					 errmsg("aborting recompression due to concurrent updates on "
+							"compressed data, retrying with next policy run")));
+
+		if (should_free)
+			heap_freetuple(compressed_tuple);
+
+		found = true;
+	}
+
+	ExecClearTuple(compressed_slot);
+
+	return found;
+}
+
+/*
+ * Recompress a hypercore chunk by merging its non-compressed rows into the
+ * compressed relation.
+ *
+ * The non-compressed rows are sorted, compressed per segment, and appended
+ * to the compressed relation as new batches. The partial batches of the
+ * segments are merged with the new rows to get full batches. Other batches
+ * are kept as they are, so unlike segmentwise recompression, this does not
+ * decompress the batches that overlap with the new rows. A hypercore doesn't
+ * need the batches of a segment to be ordered, since it doesn't use them for
+ * ordered scans.
+ *
+ * The index entries of the merged rows are inserted when their batch is
+ * flushed, so the indexes don't have to be rebuilt. The locks are the same
+ * as for segmentwise recompression, so concurrent reads and inserts are not
+ * blocked.
+ *
+ * Vacuum does not run the merge because the transactions of lazy vacuum are
+ * ignored when computing the xmin horizons, so they must not write any
+ * tuples. Instead, it is run by the compression policy and compress_chunk()
+ * for partial hypercore chunks.
+ */
+static Oid
+recompress_hypercore_merge_impl(Chunk *uncompressed_chunk)
+{
+	Oid uncompressed_chunk_id = uncompressed_chunk->table_id;
+	Chunk *compressed_chunk = ts_chunk_get_by_id(uncompressed_chunk->fd.compressed_chunk_id, true);
+	CompressionSettings *settings = ts_compression_settings_get(uncompressed_chunk_id);
+	const int num_segmentby = ts_array_length(settings->fd.segmentby);
+
+	LOCKMODE recompression_lockmode =
+		ts_guc_enable_exclusive_locking_recompression ? ExclusiveLock : ShareUpdateExclusiveLock;
+	Relation uncompressed_chunk_rel = table_open(uncompressed_chunk_id, recompression_lockmode);
+	Relation compressed_chunk_rel = table_open(compressed_chunk->table_id, recompression_lockmode);
+
+	bool has_unique_constraints =
+		ts_indexing_relation_has_primary_or_unique_index(uncompressed_chunk_rel);
+
+	/* See recompress_chunk_segmentwise_impl() */
+	if (has_unique_constraints && has_concurrent_dml(uncompressed_chunk))
+	{
+		table_close(uncompressed_chunk_rel, NoLock);
+		table_close(compressed_chunk_rel, NoLock);
+		return uncompressed_chunk_id;
+	}
+
+	Hypertable *ht = ts_hypertable_get_by_id(uncompressed_chunk->fd.hypertable_id);
+	if (ht->range_space)
+		ts_chunk_column_stats_calculate(ht, uncompressed_chunk);
+
+	TupleDesc tupdesc = RelationGetDescr(uncompressed_chunk_rel);
+	CompressedSegmentInfo *current_segment =
+		palloc0(sizeof(CompressedSegmentInfo) * Max(num_segmentby, 1));
+
+	for (int i = 0; i < num_segmentby; i++)
+	{
+		const char *attname = ts_array_get_element_text(settings->fd.segmentby, i + 1);
+		AttrNumber attno = get_attnum(uncompressed_chunk_id, attname);
+
+		current_segment[i].decompressed_chunk_offset = AttrNumberGetAttrOffset(attno);
+		current_segment[i].segment_info =
+			segment_info_new(TupleDescAttr(tupdesc, current_segment[i].decompressed_chunk_offset));
+	}
+
+	const int max_batch_rows = hypercore_batch_size_limit();
+	HypercoreMergeState state = {
+		.rel = uncompressed_chunk_rel,
+		.estate = CreateExecutorState(),
+		.batch_mcxt = AllocSetContextCreate(CurrentMemoryContext,
+											"Hypercore merge batch",
+											ALLOCSET_DEFAULT_SIZES),
+		.batch_rows = palloc(sizeof(MinimalTuple) * max_batch_rows),
+		.num_batch_rows = 0,
+		.row_slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsMinimalTuple),
+		.compressed_slot = table_slot_create(compressed_chunk_rel, NULL),
+		.num_merged_rows = 0,
+	};
+
+	row_compressor_init(settings,
+						&state.row_compressor,
+						uncompressed_chunk_rel,
+						compressed_chunk_rel,
+						RelationGetDescr(compressed_chunk_rel)->natts,
+						true /*need_bistate*/,
+						0 /*insert options*/);
+	state.row_compressor.max_batch_rows = max_batch_rows;
+	state.row_compressor.on_flush = on_merge_flush;
+	merge_open_indexes(&state);
+
+	/* The partial batches of a segment are found with the segmentby index of
+	 * the compressed relation. Without segmentby columns, all batches are in
+	 * the same segment and only the new rows are compressed. */
+	Relation index_rel = NULL;
+	IndexScanDesc index_scan = NULL;
+	ScanKeyData *index_scankeys = NULL;
+	RowDecompressor decompressor = { 0 };
+	Snapshot snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	if (num_segmentby > 0 && OidIsValid(state.row_compressor.index_oid))
+	{
+		index_rel = index_open(state.row_compressor.index_oid, RowExclusiveLock);
+		index_scankeys = palloc(sizeof(ScanKeyData) * num_segmentby);
+		create_segmentby_scankeys(settings, index_rel, compressed_chunk_rel, index_scankeys);
+		index_scan = index_beginscan(compressed_chunk_rel, index_rel, snapshot, num_segmentby, 0);
+		decompressor = build_decompressor(compressed_chunk_rel, uncompressed_chunk_rel);
+	}
+
+	Tuplesortstate *input_tuplesort =
+		compression_create_tuplesort_state(settings, uncompressed_chunk_rel);
+	Tuplesortstate *segment_tuplesort =
+		compression_create_tuplesort_state(settings, uncompressed_chunk_rel);
+	TupleTableSlot *slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsMinimalTuple);
+	TupleTableSlot *segment_slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsMinimalTuple);
+	CommandId cid = GetCurrentCommandId(true);
+	bool found_tuple = fetch_uncompressed_chunk_into_tuplesort(input_tuplesort,
+															   uncompressed_chunk_rel,
+															   snapshot);
+
+	if (found_tuple)
+	{
+		tuplesort_performsort(input_tuplesort);
+		found_tuple = tuplesort_gettupleslot(input_tuplesort, true, false, slot, NULL);
+	}
+
+	while (found_tuple)
+	{
+		update_current_segment(current_segment, slot, num_segmentby);
+		row_compressor_reset(&state.row_compressor);
+
+		bool merge_batches = false;
+
+		if (index_scan != NULL)
+		{
+			update_segmentby_scankeys(slot, current_segment, num_segmentby, index_scankeys);
+			merge_batches = merge_fetch_partial_batches(&state,
+														index_scan,
+														index_scankeys,
+														&decompressor,
+														segment_tuplesort,
+														snapshot);
+		}
+
+		if (merge_batches)
+		{
+			/* Sort the new rows of the segment together with the rows of the
+			 * partial batches */
+			do
+			{
+				tuplesort_puttupleslot(segment_tuplesort, slot);
+				found_tuple = tuplesort_gettupleslot(input_tuplesort, true, false, slot, NULL);
+			} while (found_tuple && !check_changed_group(current_segment, slot, num_segmentby));
+
+			tuplesort_performsort(segment_tuplesort);
+			while (tuplesort_gettupleslot(segment_tuplesort, true, false, segment_slot, NULL))
+				merge_append_row(&state, segment_slot, cid);
+
+			tuplesort_reset(segment_tuplesort);
+		}
+		else
+		{
+			/* The new rows are already sorted, so compress them directly */
+			do
+			{
+				merge_append_row(&state, slot, cid);
+				found_tuple = tuplesort_gettupleslot(input_tuplesort, true, false, slot, NULL);
+			} while (found_tuple && !check_changed_group(current_segment, slot, num_segmentby));
+		}
+
+		row_compressor_finish(&state.row_compressor, cid);
+		CommandCounterIncrement();
+	}
+
+	elog(DEBUG1,
+		 "recompressed " INT64_FORMAT " rows of \"%s\" into new batches",
+		 state.num_merged_rows,
+		 get_rel_name(uncompressed_chunk_id));
+
+	ExecDropSingleTupleTableSlot(slot);
+	ExecDropSingleTupleTableSlot(segment_slot);
+	tuplesort_end(input_tuplesort);
+	tuplesort_end(segment_tuplesort);
+
+	if (index_scan != NULL)
+	{
+		index_endscan(index_scan);
+		index_close(index_rel, NoLock);
+		row_decompressor_close(&decompressor);
+		pfree(index_scankeys);
+	}
+
+	UnregisterSnapshot(snapshot);
+	merge_close_indexes(&state);
+	row_compressor_close(&state.row_compressor);
+	ExecDropSingleTupleTableSlot(state.row_slot);
+	ExecDropSingleTupleTableSlot(state.compressed_slot);
+	FreeExecutorState(state.estate);
+	MemoryContextDelete(state.batch_mcxt);
+	pfree(current_segment);
+
+	DEBUG_WAITPOINT("hypercore_merge_before_status_update");
+
+	try_clear_partial_status(uncompressed_chunk, uncompressed_chunk_rel, has_unique_constraints);
+
+	table_close(uncompressed_chunk_rel, NoLock);
+	table_close(compressed_chunk_rel, NoLock);
+
+	return uncompressed_chunk_id;
+}
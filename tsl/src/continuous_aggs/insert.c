@@ -17,6 +17,7 @@
 #include <storage/lmgr.h>
 #include <utils/builtins.h>
 #include <utils/hsearch.h>
+#include <utils/inval.h>
 #include <utils/rel.h>
 #include <utils/relcache.h>
 #include <utils/snapmgr.h>
@@ -25,6 +26,7 @@
 
 #include "compat/compat.h"
 
+#include "bgw/invalidation_wakeup.h"
 #include "chunk.h"
 #include "debug_point.h"
 #include "dimension.h"
@@ -43,23 +45,35 @@
 
 /*
  * When tuples in a hypertable that has a continuous aggregate are modified, the
- * lowest modified value and the greatest modified value must be tracked over
- * the course of a transaction or statement. At the end of the statement these
- * values will be inserted into the proper cache invalidation log table for
- * their associated hypertable if they are below the speculative materialization
- * watermark (or, if in REPEATABLE_READ isolation level or higher, they will be
- * inserted no matter what as we cannot see if a materialization transaction has
- * started and moved the watermark during our transaction in that case).
+ * ranges of the modified values must be tracked over the course of a
+ * transaction or statement. At the end of the statement these ranges will be
+ * inserted into the proper cache invalidation log table for their associated
+ * hypertable if they are below the speculative materialization watermark (or,
+ * if in REPEATABLE_READ isolation level or higher, they will be inserted no
+ * matter what as we cannot see if a materialization transaction has started
+ * and moved the watermark during our transaction in that case).
  *
  * We accomplish this at the transaction level by keeping a hash table of each
- * hypertable that has been modified in the transaction and the lowest and
- * greatest modified values. The hashtable will be updated via a trigger that
- * will be called for every row that is inserted, updated or deleted. We use a
- * hashtable because we need to keep track of this on a per hypertable basis and
- * multiple can have tuples modified during a single transaction. (And if we
- * move to per-chunk cache-invalidation it makes it even easier).
+ * hypertable that has been modified in the transaction and the modified
+ * ranges. The hashtable will be updated via a trigger that will be called for
+ * every row that is inserted, updated or deleted. We use a hashtable because
+ * we need to keep track of this on a per hypertable basis and multiple can
+ * have tuples modified during a single transaction. (And if we move to
+ * per-chunk cache-invalidation it makes it even easier).
  *
+ * We keep a few disjoint ranges per hypertable rather than only the lowest
+ * and the greatest modified value, so that a transaction that modifies a few
+ * old rows together with the recent ones doesn't invalidate everything in
+ * between. When there are too many ranges, the two closest ones are merged.
  */
+#define CA_CACHE_INVAL_MAX_RANGES 16
+
+typedef struct ContinuousAggsInvalRange
+{
+	int64 start;
+	int64 end;
+} ContinuousAggsInvalRange;
+
 typedef struct ContinuousAggsCacheInvalEntry
 {
 	int32 hypertable_id;
@@ -67,9 +81,12 @@ typedef struct ContinuousAggsCacheInvalEntry
 	Dimension hypertable_open_dimension;
 	Oid previous_chunk_relid;
 	AttrNumber previous_chunk_open_dimension;
-	bool value_is_set;
-	int64 lowest_modified_value;
-	int64 greatest_modified_value;
+	int num_ranges;
+	int last_range; /* The range of the last modified value */
+	/* The number of modified rows, for the event-driven refresh policies */
+	uint64 num_rows;
+	/* Sorted by start, with room for one range before merging */
+	ContinuousAggsInvalRange ranges[CA_CACHE_INVAL_MAX_RANGES + 1];
 } ContinuousAggsCacheInvalEntry;
 
 static int64 get_lowest_invalidated_time_for_hypertable(Oid hypertable_relid);
@@ -79,6 +96,12 @@ static int64 get_lowest_invalidated_time_for_hypertable(Oid hypertable_relid);
 static HTAB *continuous_aggs_cache_inval_htab = NULL;
 static MemoryContext continuous_aggs_trigger_mctx = NULL;
 
+/*
+ * The hypertables that had queries rewritten to continuous aggregates in
+ * this backend, see continuous_agg_note_query_rewrite().
+ */
+static List *continuous_aggs_rewritten_hypertables = NIL;
+
 static int64 tuple_get_time(Dimension *d, HeapTuple tuple, AttrNumber col, TupleDesc tupdesc);
 static inline void cache_inval_entry_init(ContinuousAggsCacheInvalEntry *cache_entry,
 										  int32 hypertable_id);
@@ -114,14 +137,10 @@ cache_inval_init()
 };
 
 static int64
-tuple_get_time(Dimension *d, HeapTuple tuple, AttrNumber col, TupleDesc tupdesc)
+datum_get_time(Dimension *d, Datum datum, bool isnull, AttrNumber col, TupleDesc tupdesc)
 {
-	Datum datum;
-	bool isnull;
 	Oid dimtype;
 
-	datum = heap_getattr(tuple, col, tupdesc, &isnull);
-
 	if (NULL != d->partitioning)
 	{
 		Oid collation = TupleDescAttr(tupdesc, col)->attcollation;
@@ -142,6 +161,15 @@ tuple_get_time(Dimension *d, HeapTuple tuple, AttrNumber col, TupleDesc tupdesc)
 	return ts_time_value_to_internal(datum, dimtype);
 }
 
+static int64
+tuple_get_time(Dimension *d, HeapTuple tuple, AttrNumber col, TupleDesc tupdesc)
+{
+	bool isnull;
+	Datum datum = heap_getattr(tuple, col, tupdesc, &isnull);
+
+	return datum_get_time(d, datum, isnull, col, tupdesc);
+}
+
 static inline void
 cache_inval_entry_init(ContinuousAggsCacheInvalEntry *cache_entry, int32 hypertable_id)
 {
@@ -167,9 +195,14 @@ cache_inval_entry_init(ContinuousAggsCacheInvalEntry *cache_entry, int32 hyperta
 		cache_entry->hypertable_open_dimension.partitioning = open_dim_part_info;
 	}
 	cache_entry->previous_chunk_relid = InvalidOid;
-	cache_entry->value_is_set = false;
-	cache_entry->lowest_modified_value = INVAL_POS_INFINITY;
-	cache_entry->greatest_modified_value = INVAL_NEG_INFINITY;
+	cache_entry->num_ranges = 0;
+	cache_entry->last_range = 0;
+	cache_entry->num_rows = 0;
+
+	/* The plans rewritten before the modification must not be used again */
+	if (list_member_int(continuous_aggs_rewritten_hypertables, hypertable_id))
+		CacheInvalidateRelcacheByRelid(cache_entry->hypertable_relid);
+
 	ts_cache_release(ht_cache);
 }
 
@@ -201,18 +234,100 @@ cache_entry_switch_to_chunk(ContinuousAggsCacheInvalEntry *cache_entry, Oid chun
 	}
 }
 
+/*
+ * Merge the two ranges with the smallest gap between them.
+ */
+static void
+cache_entry_merge_closest_ranges(ContinuousAggsCacheInvalEntry *cache_entry)
+{
+	ContinuousAggsInvalRange *ranges = cache_entry->ranges;
+	uint64 closest_gap = PG_UINT64_MAX;
+	int closest = 0;
+
+	Assert(cache_entry->num_ranges > 1);
+
+	for (int i = 0; i < cache_entry->num_ranges - 1; i++)
+	{
+		/* The ranges are disjoint, so the unsigned difference doesn't overflow */
+		uint64 gap = (uint64) ranges[i + 1].start - (uint64) ranges[i].end;
+
+		if (gap < closest_gap)
+		{
+			closest_gap = gap;
+			closest = i;
+		}
+	}
+
+	ranges[closest].end = ranges[closest + 1].end;
+	memmove(&ranges[closest + 1],
+			&ranges[closest + 2],
+			sizeof(ContinuousAggsInvalRange) * (cache_entry->num_ranges - closest - 2));
+	cache_entry->num_ranges--;
+
+	if (cache_entry->last_range > closest)
+		cache_entry->last_range--;
+}
+
 static inline void
 update_cache_entry(ContinuousAggsCacheInvalEntry *cache_entry, int64 timeval)
 {
-	cache_entry->value_is_set = true;
-	if (timeval < cache_entry->lowest_modified_value)
-		cache_entry->lowest_modified_value = timeval;
-	if (timeval > cache_entry->greatest_modified_value)
-		cache_entry->greatest_modified_value = timeval;
+	ContinuousAggsInvalRange *ranges = cache_entry->ranges;
+	int i;
+
+	cache_entry->num_rows++;
+
+	/* The rows are usually modified in time order, so try the last range first */
+	if (cache_entry->num_ranges > 0 && timeval >= ranges[cache_entry->last_range].start &&
+		timeval <= ranges[cache_entry->last_range].end)
+		return;
+
+	/* Find the first range that doesn't end before the value */
+	for (i = 0; i < cache_entry->num_ranges && ranges[i].end < timeval; i++)
+		;
+
+	if (i < cache_entry->num_ranges && timeval >= ranges[i].start)
+	{
+		cache_entry->last_range = i;
+		return;
+	}
+
+	/* Extend the adjacent ranges, or add a new range for the value */
+	if (i > 0 && ranges[i - 1].end + 1 == timeval)
+	{
+		ranges[i - 1].end = timeval;
+		cache_entry->last_range = i - 1;
+
+		if (i < cache_entry->num_ranges && timeval + 1 == ranges[i].start)
+		{
+			ranges[i - 1].end = ranges[i].end;
+			memmove(&ranges[i],
+					&ranges[i + 1],
+					sizeof(ContinuousAggsInvalRange) * (cache_entry->num_ranges - i - 1));
+			cache_entry->num_ranges--;
+		}
+	}
+	else if (i < cache_entry->num_ranges && timeval + 1 == ranges[i].start)
+	{
+		ranges[i].start = timeval;
+		cache_entry->last_range = i;
+	}
+	else
+	{
+		memmove(&ranges[i + 1],
+				&ranges[i],
+				sizeof(ContinuousAggsInvalRange) * (cache_entry->num_ranges - i));
+		ranges[i].start = timeval;
+		ranges[i].end = timeval;
+		cache_entry->num_ranges++;
+		cache_entry->last_range = i;
+
+		if (cache_entry->num_ranges > CA_CACHE_INVAL_MAX_RANGES)
+			cache_entry_merge_closest_ranges(cache_entry);
+	}
 }
 
 /*
- * Trigger to store what the max/min updated values are for a function.
+ * Trigger to store the ranges of the modified values of a hypertable.
  * This is used by continuous aggregates to ensure that the aggregated values
  * are updated correctly. Upon creating a continuous aggregate for a hypertable,
  * this trigger should be registered, if it does not already exist.
@@ -256,13 +371,11 @@ continuous_agg_trigfn(PG_FUNCTION_ARGS)
  * (for updates: this is the row before modification)
  * chunk_newtuple is the tuple from trigdata->tg_newtuple.
  */
-void
-execute_cagg_trigger(int32 hypertable_id, Relation chunk_rel, HeapTuple chunk_tuple,
-					 HeapTuple chunk_newtuple, bool update)
+static ContinuousAggsCacheInvalEntry *
+get_cache_entry_for_chunk(int32 hypertable_id, Relation chunk_rel)
 {
 	ContinuousAggsCacheInvalEntry *cache_entry;
 	bool found;
-	int64 timeval;
 	Oid chunk_relid = chunk_rel->rd_id;
 	/* On first call, init the mctx and hash table */
 	if (!continuous_aggs_cache_inval_htab)
@@ -278,6 +391,17 @@ execute_cagg_trigger(int32 hypertable_id, Relation chunk_rel, HeapTuple chunk_tu
 	if (cache_entry->previous_chunk_relid != chunk_relid)
 		cache_entry_switch_to_chunk(cache_entry, chunk_relid, chunk_rel);
 
+	return cache_entry;
+}
+
+void
+execute_cagg_trigger(int32 hypertable_id, Relation chunk_rel, HeapTuple chunk_tuple,
+					 HeapTuple chunk_newtuple, bool update)
+{
+	ContinuousAggsCacheInvalEntry *cache_entry;
+	int64 timeval;
+
+	cache_entry = get_cache_entry_for_chunk(hypertable_id, chunk_rel);
 	timeval = tuple_get_time(&cache_entry->hypertable_open_dimension,
 							 chunk_tuple,
 							 cache_entry->previous_chunk_open_dimension,
@@ -297,12 +421,41 @@ execute_cagg_trigger(int32 hypertable_id, Relation chunk_rel, HeapTuple chunk_tu
 	update_cache_entry(cache_entry, timeval);
 }
 
+/*
+ * Record the invalidations of the rows inserted into a chunk with
+ * table_multi_insert(), instead of running the trigger for every row. This
+ * saves the trigger event that is queued and fetched for every row, and
+ * allows the rows to be buffered in the first place.
+ */
+void
+continuous_agg_invalidate_slots(int32 hypertable_id, Relation chunk_rel, TupleTableSlot **slots,
+								int nslots)
+{
+	ContinuousAggsCacheInvalEntry *cache_entry =
+		get_cache_entry_for_chunk(hypertable_id, chunk_rel);
+	AttrNumber col = cache_entry->previous_chunk_open_dimension;
+	TupleDesc tupdesc = RelationGetDescr(chunk_rel);
+
+	for (int i = 0; i < nslots; i++)
+	{
+		bool isnull;
+		Datum datum = slot_getattr(slots[i], col, &isnull);
+
+		update_cache_entry(cache_entry,
+						   datum_get_time(&cache_entry->hypertable_open_dimension,
+										  datum,
+										  isnull,
+										  col,
+										  tupdesc));
+	}
+}
+
 static void
 cache_inval_entry_write(ContinuousAggsCacheInvalEntry *entry)
 {
-	int64 liv;
+	int64 liv = INVAL_POS_INFINITY;
 
-	if (!entry->value_is_set)
+	if (entry->num_ranges == 0)
 		return;
 
 	/* The materialization worker uses a READ COMMITTED isolation level by default. Therefore, if we
@@ -312,22 +465,47 @@ cache_inval_entry_write(ContinuousAggsCacheInvalEntry *entry)
 	 * threshold. The materializer can handle invalidations that are beyond the threshold
 	 * gracefully.
 	 */
-	if (IsolationUsesXactSnapshot())
+	bool use_threshold = !IsolationUsesXactSnapshot();
+
+	if (use_threshold)
+		liv = get_lowest_invalidated_time_for_hypertable(entry->hypertable_relid);
+
+	/* The ranges are sorted, so the ones below the threshold are a prefix */
+	int i;
+	for (i = 0; i < entry->num_ranges; i++)
 	{
+		if (use_threshold && entry->ranges[i].start >= liv)
+			break;
+
 		invalidation_hyper_log_add_entry(entry->hypertable_id,
-										 entry->lowest_modified_value,
-										 entry->greatest_modified_value);
-		return;
+										 entry->ranges[i].start,
+										 entry->ranges[i].end);
 	}
 
-	liv = get_lowest_invalidated_time_for_hypertable(entry->hypertable_relid);
-
-	if (entry->lowest_modified_value < liv)
-		invalidation_hyper_log_add_entry(entry->hypertable_id,
-										 entry->lowest_modified_value,
-										 entry->greatest_modified_value);
+	/*
+	 * Queries on the hypertable are only rewritten to continuous aggregates
+	 * without pending invalidations, so invalidate the plans cached for them
+	 * in the other backends.
+	 */
+	if (i > 0)
+		CacheInvalidateRelcacheByRelid(entry->hypertable_relid);
 };
 
+/*
+ * Count the modified rows for the event-driven refresh policies once the
+ * transaction committed, see invalidation_wakeup.c.
+ */
+static void
+cache_inval_htab_wakeup(void)
+{
+	HASH_SEQ_STATUS hash_seq;
+	ContinuousAggsCacheInvalEntry *current_entry;
+
+	hash_seq_init(&hash_seq, continuous_aggs_cache_inval_htab);
+	while ((current_entry = hash_seq_search(&hash_seq)) != NULL)
+		ts_invalidation_wakeup_add_rows(current_entry->hypertable_id, current_entry->num_rows);
+}
+
 static void
 cache_inval_cleanup(void)
 {
@@ -405,8 +583,11 @@ continuous_agg_xact_invalidation_callback(XactEvent event, void *arg)
 		case XACT_EVENT_PARALLEL_PRE_COMMIT:
 			cache_inval_htab_write();
 			break;
-		case XACT_EVENT_PREPARE:
 		case XACT_EVENT_COMMIT:
+			cache_inval_htab_wakeup();
+			cache_inval_cleanup();
+			break;
+		case XACT_EVENT_PREPARE:
 		case XACT_EVENT_PARALLEL_COMMIT:
 		case XACT_EVENT_ABORT:
 		case XACT_EVENT_PARALLEL_ABORT:
@@ -429,6 +610,36 @@ _continuous_aggs_cache_inval_fini(void)
 	UnregisterXactCallback(continuous_agg_xact_invalidation_callback, NULL);
 }
 
+/*
+ * Note that a query on the hypertable was rewritten to a continuous
+ * aggregate. The rewrite cannot be used once the hypertable is modified, so
+ * the first modification of the hypertable in a transaction invalidates the
+ * plans on it. The invalidations of the other transactions do that when they
+ * are written to the log, see cache_inval_entry_write().
+ */
+void
+continuous_agg_note_query_rewrite(int32 hypertable_id)
+{
+	MemoryContext oldmcxt = MemoryContextSwitchTo(TopMemoryContext);
+	continuous_aggs_rewritten_hypertables =
+		list_append_unique_int(continuous_aggs_rewritten_hypertables, hypertable_id);
+	MemoryContextSwitchTo(oldmcxt);
+}
+
+/*
+ * Check if the current transaction modified the hypertable. The
+ * invalidations are only written to the log at commit, so until then they
+ * exist only in the cache.
+ */
+bool
+continuous_agg_xact_has_invalidations(int32 hypertable_id)
+{
+	if (!continuous_aggs_cache_inval_htab)
+		return false;
+
+	return hash_search(continuous_aggs_cache_inval_htab, &hypertable_id, HASH_FIND, NULL) != NULL;
+}
+
 static ScanTupleResult
 invalidation_tuple_found(TupleInfo *ti, void *min)
 {
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <postgres.h>
+#include <executor/tuptable.h>
 
 extern Datum continuous_agg_trigfn(PG_FUNCTION_ARGS);
 
@@ -13,3 +14,7 @@ extern void _continuous_aggs_cache_inval_init(void);
 extern void _continuous_aggs_cache_inval_fini(void);
 extern void execute_cagg_trigger(int32 hypertable_id, Relation chunk_rel, HeapTuple chunk_tuple,
 								 HeapTuple chunk_newtuple, bool update);
+extern void continuous_agg_invalidate_slots(int32 hypertable_id, Relation chunk_rel,
+											TupleTableSlot **slots, int nslots);
+extern bool continuous_agg_xact_has_invalidations(int32 hypertable_id);
+extern void continuous_agg_note_query_rewrite(int32 hypertable_id);
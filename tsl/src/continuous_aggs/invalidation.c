@@ -11,6 +11,7 @@
 #include <nodes/makefuncs.h>
 #include <nodes/memnodes.h>
 #include <storage/lockdefs.h>
+#include <tcop/utility.h>
 #include <utils/builtins.h>
 #include <utils/memutils.h>
 #include <utils/palloc.h>
@@ -20,6 +21,7 @@
 #include <extension.h>
 #include <fmgr.h>
 #include <funcapi.h>
+#include <guc.h>
 #include <hypertable_cache.h>
 #include <parser/parse_func.h>
 #include <scan_iterator.h>
@@ -31,6 +33,7 @@
 #include "compat/compat.h"
 #include "continuous_aggs/materialize.h"
 #include "invalidation.h"
+#include "invalidation_threshold.h"
 #include "refresh.h"
 #include "ts_catalog/catalog.h"
 #include "ts_catalog/continuous_agg.h"
@@ -214,11 +217,9 @@ invalidation_cagg_log_add_entry(int32 cagg_hyper_id, int64 start, int64 end)
 	table_close(rel, NoLock);
 }
 
-void
-invalidation_hyper_log_add_entry(int32 hyper_id, int64 start, int64 end)
+static void
+invalidation_hyper_log_insert(Relation rel, int32 hyper_id, int64 start, int64 end)
 {
-	Relation rel = open_invalidation_log(LOG_HYPER, RowExclusiveLock);
-	CatalogSecurityContext sec_ctx;
 	Datum values[Natts_continuous_aggs_hypertable_invalidation_log];
 	bool nulls[Natts_continuous_aggs_hypertable_invalidation_log] = { false };
 
@@ -232,8 +233,17 @@ invalidation_hyper_log_add_entry(int32 hyper_id, int64 start, int64 end)
 		Anum_continuous_aggs_hypertable_invalidation_log_greatest_modified_value)] =
 		Int64GetDatum(end);
 
-	ts_catalog_database_info_become_owner(ts_catalog_database_info_get(), &sec_ctx);
 	ts_catalog_insert_values(rel, RelationGetDescr(rel), values, nulls);
+}
+
+void
+invalidation_hyper_log_add_entry(int32 hyper_id, int64 start, int64 end)
+{
+	Relation rel = open_invalidation_log(LOG_HYPER, RowExclusiveLock);
+	CatalogSecurityContext sec_ctx;
+
+	ts_catalog_database_info_become_owner(ts_catalog_database_info_get(), &sec_ctx);
+	invalidation_hyper_log_insert(rel, hyper_id, start, end);
 	ts_catalog_restore_user(&sec_ctx);
 	table_close(rel, NoLock);
 	elog(DEBUG1,
@@ -676,6 +686,20 @@ cut_and_insert_new_cagg_invalidation(const CaggInvalidationState *state, const I
 	ts_catalog_restore_user(&sec_ctx);
 }
 
+/*
+ * Replace an entry in the hypertable invalidation log with the merged
+ * entry.
+ */
+static void
+rewrite_hyper_invalidation(Relation rel, const Invalidation *entry)
+{
+	ts_catalog_delete_tid_only(rel, &entry->tid);
+	invalidation_hyper_log_insert(rel,
+								  entry->hyper_id,
+								  entry->lowest_modified_value,
+								  entry->greatest_modified_value);
+}
+
 /*
  * Process invalidations in the hypertable invalidation log.
  *
@@ -773,6 +797,118 @@ move_invalidations_from_hyper_to_cagg_log(const CaggInvalidationState *state)
 	}
 }
 
+/*
+ * Compact the hypertable invalidation log of a hypertable.
+ *
+ * Overlapping and adjacent entries are merged into one entry, the same way
+ * as when the entries are moved to the continuous aggregate invalidation
+ * log. The entries are not expanded to bucket boundaries, since the
+ * continuous aggregates on the hypertable can have different buckets. Under
+ * backfill the log can grow to a lot of small overlapping entries between
+ * refreshes, and compacting it keeps the cost of the next refresh
+ * proportional to the number of invalidated regions.
+ *
+ * The invalidation threshold is locked to serialize with refreshes, which
+ * move the entries out of the log. Inserts that run concurrently only add new
+ * entries, which are not visible to the snapshot used for the scan.
+ *
+ * Returns the number of entries removed from the log.
+ */
+int64
+invalidation_hyper_log_compact(int32 hyper_id)
+{
+	Relation rel;
+	Snapshot snapshot;
+	ScanIterator iterator;
+	MemoryContext per_tuple_mctx;
+	CatalogSecurityContext sec_ctx;
+	Invalidation mergedentry;
+	int64 num_removed = 0;
+
+	if (!invalidation_threshold_lock(hyper_id))
+		return 0;
+
+	rel = open_invalidation_log(LOG_HYPER, RowExclusiveLock);
+	per_tuple_mctx = AllocSetContextCreate(CurrentMemoryContext,
+										   "Hypertable invalidation log compaction",
+										   ALLOCSET_DEFAULT_SIZES);
+	snapshot = RegisterSnapshot(GetLatestSnapshot());
+	invalidation_entry_reset(&mergedentry);
+	hypertable_invalidation_scan_init(&iterator, hyper_id, RowExclusiveLock);
+	iterator.ctx.snapshot = snapshot;
+
+	ts_catalog_database_info_become_owner(ts_catalog_database_info_get(), &sec_ctx);
+
+	ts_scanner_foreach(&iterator)
+	{
+		TupleInfo *ti = ts_scan_iterator_tuple_info(&iterator);
+		MemoryContext oldmctx = MemoryContextSwitchTo(per_tuple_mctx);
+		Invalidation logentry;
+
+		INVALIDATION_ENTRY_SET(&logentry,
+							   ti,
+							   hypertable_id,
+							   Form_continuous_aggs_hypertable_invalidation_log);
+
+		if (!IS_VALID_INVALIDATION(&mergedentry))
+			mergedentry = logentry;
+		else if (invalidation_entry_try_merge(&mergedentry, &logentry))
+		{
+			/* The entry is covered by the merged entry now */
+			ts_catalog_delete_tid_only(rel, &logentry.tid);
+			num_removed++;
+		}
+		else
+		{
+			if (mergedentry.is_modified)
+				rewrite_hyper_invalidation(rel, &mergedentry);
+			mergedentry = logentry;
+		}
+
+		MemoryContextSwitchTo(oldmctx);
+		MemoryContextReset(per_tuple_mctx);
+	}
+
+	ts_scan_iterator_close(&iterator);
+
+	if (IS_VALID_INVALIDATION(&mergedentry) && mergedentry.is_modified)
+		rewrite_hyper_invalidation(rel, &mergedentry);
+
+	ts_catalog_restore_user(&sec_ctx);
+	UnregisterSnapshot(snapshot);
+	MemoryContextDelete(per_tuple_mctx);
+	table_close(rel, NoLock);
+
+	elog(DEBUG1,
+		 "hypertable log for hypertable %d compacted, removed " INT64_FORMAT " entries",
+		 hyper_id,
+		 num_removed);
+
+	return num_removed;
+}
+
+/*
+ * SQL function to compact the hypertable invalidation log of a hypertable.
+ */
+Datum
+continuous_agg_compact_invalidation_log(PG_FUNCTION_ARGS)
+{
+	Oid relid = PG_GETARG_OID(0);
+	Cache *hcache;
+	Hypertable *ht;
+	int64 num_removed;
+
+	ts_feature_flag_check(FEATURE_CAGG);
+	PreventCommandIfReadOnly("cagg_compact_invalidation_log()");
+
+	ht = ts_hypertable_cache_get_cache_and_entry(relid, CACHE_FLAG_NONE, &hcache);
+	ts_hypertable_permissions_check(relid, GetUserId());
+	num_removed = invalidation_hyper_log_compact(ht->fd.id);
+	ts_cache_release(hcache);
+
+	PG_RETURN_INT64(num_removed);
+}
+
 static void
 cagg_invalidations_scan_by_hypertable_init(ScanIterator *iterator, int32 cagg_hyper_id,
 										   LOCKMODE lockmode)
@@ -791,6 +927,55 @@ cagg_invalidations_scan_by_hypertable_init(ScanIterator *iterator, int32 cagg_hy
 		Int32GetDatum(cagg_hyper_id));
 }
 
+/*
+ * Check if there are invalidations below the watermark of a continuous
+ * aggregate that are not refreshed yet, in which case the materialized data
+ * can differ from the data in the raw hypertable.
+ */
+bool
+invalidation_pending_below_watermark(const ContinuousAgg *cagg, int64 watermark)
+{
+	ScanIterator iterator;
+	bool found = false;
+
+	hypertable_invalidation_scan_init(&iterator, cagg->data.raw_hypertable_id, AccessShareLock);
+	ts_scan_iterator_scan_key_init(
+		&iterator,
+		Anum_continuous_aggs_hypertable_invalidation_log_idx_lowest_modified_value,
+		BTLessStrategyNumber,
+		F_INT8LT,
+		Int64GetDatum(watermark));
+
+	ts_scanner_foreach(&iterator)
+	{
+		found = true;
+		break;
+	}
+	ts_scan_iterator_close(&iterator);
+
+	if (found)
+		return true;
+
+	cagg_invalidations_scan_by_hypertable_init(&iterator,
+											   cagg->data.mat_hypertable_id,
+											   AccessShareLock);
+	ts_scan_iterator_scan_key_init(
+		&iterator,
+		Anum_continuous_aggs_materialization_invalidation_log_idx_lowest_modified_value,
+		BTLessStrategyNumber,
+		F_INT8LT,
+		Int64GetDatum(watermark));
+
+	ts_scanner_foreach(&iterator)
+	{
+		found = true;
+		break;
+	}
+	ts_scan_iterator_close(&iterator);
+
+	return found;
+}
+
 /*
  * Cut an invalidation and return the part, if any, that remains within the
  * refresh window.
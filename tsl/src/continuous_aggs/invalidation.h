@@ -38,6 +38,9 @@ typedef struct Hypertable Hypertable;
 
 extern void invalidation_cagg_log_add_entry(int32 cagg_hyper_id, int64 start, int64 end);
 extern void invalidation_hyper_log_add_entry(int32 hyper_id, int64 start, int64 end);
+extern int64 invalidation_hyper_log_compact(int32 hyper_id);
+extern bool invalidation_pending_below_watermark(const ContinuousAgg *cagg, int64 watermark);
+extern Datum continuous_agg_compact_invalidation_log(PG_FUNCTION_ARGS);
 extern void continuous_agg_invalidate_raw_ht(const Hypertable *raw_ht, int64 start, int64 end);
 extern void continuous_agg_invalidate_mat_ht(const Hypertable *raw_ht, const Hypertable *mat_ht,
 											 int64 start, int64 end);
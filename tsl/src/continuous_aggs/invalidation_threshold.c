@@ -210,6 +210,72 @@ invalidation_threshold_set_or_get(const ContinuousAgg *cagg,
 	return updatectx.computed_invalidation_threshold;
 }
 
+static ScanTupleResult
+invalidation_threshold_scan_lock(TupleInfo *ti, void *const data)
+{
+	int32 raw_hypertable_id = *((int32 *) data);
+
+	if (ti->lockresult == TM_Updated)
+		return SCAN_RESTART_WITH_NEW_SNAPSHOT;
+
+	if (ti->lockresult != TM_Ok)
+	{
+		elog(ERROR,
+			 "unable to lock invalidation threshold tuple for hypertable %d (lock result %d)",
+			 raw_hypertable_id,
+			 ti->lockresult);
+
+		pg_unreachable();
+	}
+
+	return SCAN_DONE;
+}
+
+/*
+ * Lock the invalidation threshold of a hypertable without moving it.
+ *
+ * Refreshes hold the same tuple lock, taken by
+ * invalidation_threshold_set_or_get(), while processing the hypertable
+ * invalidation log, so this serializes other changes to the log with the
+ * refreshes. The lock is held until the end of the transaction.
+ *
+ * Returns false if the hypertable has no invalidation threshold, i.e., it
+ * has never had a continuous aggregate.
+ */
+bool
+invalidation_threshold_lock(int32 raw_hypertable_id)
+{
+	ScanKeyData scankey[1];
+	Catalog *catalog = ts_catalog_get();
+	ScanTupLock scantuplock = {
+		.waitpolicy = LockWaitBlock,
+		.lockmode = LockTupleExclusive,
+	};
+	ScannerCtx scanctx = {
+		.table = catalog_get_table_id(catalog, CONTINUOUS_AGGS_INVALIDATION_THRESHOLD),
+		.index =
+			catalog_get_index(catalog, CONTINUOUS_AGGS_INVALIDATION_THRESHOLD, BGW_JOB_PKEY_IDX),
+		.nkeys = 1,
+		.scankey = scankey,
+		.data = &raw_hypertable_id,
+		.tuple_found = invalidation_threshold_scan_lock,
+		.lockmode = RowExclusiveLock,
+		.scandirection = ForwardScanDirection,
+		.result_mctx = CurrentMemoryContext,
+		.tuplock = &scantuplock,
+		.flags = SCANNER_F_KEEPLOCK,
+		.snapshot = GetLatestSnapshot(),
+	};
+
+	ScanKeyInit(&scankey[0],
+				Anum_continuous_aggs_invalidation_threshold_hypertable_id,
+				BTEqualStrategyNumber,
+				F_INT4EQ,
+				Int32GetDatum(raw_hypertable_id));
+
+	return ts_scanner_scan_one(&scanctx, false, CAGG_INVALIDATION_THRESHOLD_NAME);
+}
+
 /*
  * Compute a new invalidation threshold.
  *
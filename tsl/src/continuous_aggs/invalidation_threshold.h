@@ -16,3 +16,4 @@ extern int64 invalidation_threshold_set_or_get(const ContinuousAgg *cagg,
 extern int64 invalidation_threshold_compute(const ContinuousAgg *cagg,
 											const InternalTimeRange *refresh_window);
 extern void invalidation_threshold_initialize(const ContinuousAgg *cagg);
+extern bool invalidation_threshold_lock(int32 raw_hypertable_id);
@@ -5,27 +5,39 @@
  */
 #include <postgres.h>
 
+#include <access/tableam.h>
 #include <executor/spi.h>
 #include <fmgr.h>
 #include <lib/stringinfo.h>
 #include <utils/builtins.h>
 #include <utils/date.h>
 #include <utils/guc.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
 #include <utils/palloc.h>
 #include <utils/rel.h>
 #include <utils/relcache.h>
 #include <utils/snapmgr.h>
 #include <utils/timestamp.h>
 
+#include "bgw/job_profile.h"
+#include "chunk.h"
 #include "compat/compat.h"
+#include "compression/api.h"
+#include "compression/create.h"
 #include "debug_assert.h"
+#include "dimension_slice.h"
 #include "guc.h"
 #include "materialize.h"
+#include "progress.h"
 #include "scan_iterator.h"
 #include "scanner.h"
 #include "time_utils.h"
+#include "trace.h"
+#include "ts_catalog/compression_settings.h"
 #include "ts_catalog/continuous_agg.h"
 #include "ts_catalog/continuous_aggs_watermark.h"
+#include "utils.h"
 
 #define CONTINUOUS_AGG_CHUNK_ID_COL_NAME "chunk_id"
 
@@ -65,6 +77,7 @@ typedef struct MaterializationContext
 	SchemaAndName materialization_table;
 	NameData *time_column_name;
 	TimeRange materialization_range;
+	InternalTimeRange internal_materialization_range;
 	char *chunk_condition;
 } MaterializationContext;
 
@@ -72,10 +85,19 @@ typedef char *(*MaterializationCreateStatement)(MaterializationContext *context)
 typedef void (*MaterializationEmitError)(MaterializationContext *context);
 typedef void (*MaterializationEmitProgress)(MaterializationContext *context, uint64 rows_processed);
 
+/*
+ * The prepared plans are kept across the refresh windows and invalidation
+ * ranges of a refresh, and across the batches of a refresh policy, so that
+ * the statements are not parsed and analyzed again for every window. A plan
+ * is prepared again when the statement changes, e.g., when refreshing
+ * another continuous aggregate.
+ */
 typedef struct MaterializationPlan
 {
 	SPIPlanPtr plan;
+	char *query; /* The statement of the prepared plan */
 	bool read_only;
+	const char *phase; /* The phase of the job execution that is timed */
 	MaterializationCreateStatement create_statement;
 	MaterializationEmitError emit_error;
 	MaterializationEmitProgress emit_progress;
@@ -100,19 +122,24 @@ static void emit_materialization_merge_progress(MaterializationContext *context,
 												uint64 rows_processed);
 
 static MaterializationPlan materialization_plans[_MAX_MATERIALIZATION_PLAN_TYPES + 1] = {
-	[PLAN_TYPE_INSERT] = { .create_statement = create_materialization_insert_statement,
+	[PLAN_TYPE_INSERT] = { .phase = "insert",
+						   .create_statement = create_materialization_insert_statement,
 						   .emit_error = emit_materialization_insert_error,
 						   .emit_progress = emit_materialization_insert_progress },
-	[PLAN_TYPE_DELETE] = { .create_statement = create_materialization_delete_statement,
+	[PLAN_TYPE_DELETE] = { .phase = "delete",
+						   .create_statement = create_materialization_delete_statement,
 						   .emit_error = emit_materialization_delete_error,
 						   .emit_progress = emit_materialization_delete_progress },
 	[PLAN_TYPE_EXISTS] = { .read_only = true,
+						   .phase = "merge",
 						   .create_statement = create_materialization_exists_statement,
 						   .emit_error = emit_materialization_exists_error },
-	[PLAN_TYPE_MERGE] = { .create_statement = create_materialization_merge_statement,
+	[PLAN_TYPE_MERGE] = { .phase = "merge",
+						  .create_statement = create_materialization_merge_statement,
 						  .emit_error = emit_materialization_merge_error,
 						  .emit_progress = emit_materialization_merge_progress },
-	[PLAN_TYPE_MERGE_DELETE] = { .create_statement = create_materialization_merge_delete_statement,
+	[PLAN_TYPE_MERGE_DELETE] = { .phase = "delete",
+								 .create_statement = create_materialization_merge_delete_statement,
 								 .emit_error = emit_materialization_delete_error,
 								 .emit_progress = emit_materialization_delete_progress },
 };
@@ -126,6 +153,8 @@ static void free_materialization_plan(MaterializationContext *context,
 static void free_materialization_plans(MaterializationContext *context);
 
 static void update_watermark(MaterializationContext *context);
+static List *discard_compressed_materializations(MaterializationContext *context);
+static void compress_materializations(List *chunk_relids);
 static void execute_materializations(MaterializationContext *context);
 
 /* API to update materializations from refresh code */
@@ -147,6 +176,7 @@ continuous_agg_update_materialization(Hypertable *mat_ht, const ContinuousAgg *c
 		.materialization_table = materialization_table,
 		.time_column_name = (NameData *) time_column_name,
 		.materialization_range = internal_time_range_to_time_range(new_materialization_range),
+		.internal_materialization_range = new_materialization_range,
 		/*
 		 * chunk_id is valid if the materializaion update should be done only on the given chunk.
 		 * This is used currently for refresh on chunk drop only. In other cases, manual
@@ -198,15 +228,18 @@ continuous_agg_update_materialization(Hypertable *mat_ht, const ContinuousAgg *c
 	{
 		context.materialization_range =
 			internal_time_range_to_time_range(combined_materialization_range);
+		context.internal_materialization_range = combined_materialization_range;
 		execute_materializations(&context);
 	}
 	else
 	{
 		context.materialization_range = internal_time_range_to_time_range(invalidation_range);
+		context.internal_materialization_range = invalidation_range;
 		execute_materializations(&context);
 
 		context.materialization_range =
 			internal_time_range_to_time_range(new_materialization_range);
+		context.internal_materialization_range = new_materialization_range;
 		execute_materializations(&context);
 	}
 
@@ -594,6 +627,7 @@ emit_materialization_merge_error(MaterializationContext *context)
 static void
 emit_materialization_insert_progress(MaterializationContext *context, uint64 rows_processed)
 {
+	ts_progress_incr_param(PROGRESS_CAGG_REFRESH_ROWS_INSERTED, rows_processed);
 	elog(LOG,
 		 "inserted " UINT64_FORMAT " row(s) into materialization table \"%s.%s\"",
 		 rows_processed,
@@ -604,6 +638,7 @@ emit_materialization_insert_progress(MaterializationContext *context, uint64 row
 static void
 emit_materialization_delete_progress(MaterializationContext *context, uint64 rows_processed)
 {
+	ts_progress_incr_param(PROGRESS_CAGG_REFRESH_ROWS_DELETED, rows_processed);
 	elog(LOG,
 		 "deleted " UINT64_FORMAT " row(s) from materialization table \"%s.%s\"",
 		 rows_processed,
@@ -614,6 +649,8 @@ emit_materialization_delete_progress(MaterializationContext *context, uint64 row
 static void
 emit_materialization_merge_progress(MaterializationContext *context, uint64 rows_processed)
 {
+	/* The merged rows are inserted or updated */
+	ts_progress_incr_param(PROGRESS_CAGG_REFRESH_ROWS_INSERTED, rows_processed);
 	elog(LOG,
 		 "merged " UINT64_FORMAT " row(s) into materialization table \"%s.%s\"",
 		 rows_processed,
@@ -628,21 +665,31 @@ create_materialization_plan(MaterializationContext *context, MaterializationPlan
 	Assert(plan_type < _MAX_MATERIALIZATION_PLAN_TYPES);
 
 	MaterializationPlan *materialization = &materialization_plans[plan_type];
+	char *query = materialization->create_statement(context);
+
+	if (materialization->plan != NULL && strcmp(materialization->query, query) != 0)
+		free_materialization_plan(context, plan_type);
 
 	if (materialization->plan == NULL)
 	{
-		char *query = materialization->create_statement(context);
 		Oid types[] = { context->materialization_range.type, context->materialization_range.type };
 
+		/*
+		 * Always use custom plans, so that the chunks outside of the window
+		 * are excluded when planning, as they were before reusing the plans.
+		 * Reusing the plan still saves parsing and analyzing the statement.
+		 */
 		elog(DEBUG2, "%s: %s", __func__, query);
-		materialization->plan = SPI_prepare(query, 2, types);
+		materialization->plan = SPI_prepare_cursor(query, 2, types, CURSOR_OPT_CUSTOM_PLAN);
 		if (materialization->plan == NULL)
 			elog(ERROR, "%s: SPI_prepare failed: %s", __func__, query);
 
 		SPI_keepplan(materialization->plan);
-		pfree(query);
+		materialization->query = MemoryContextStrdup(TopMemoryContext, query);
 	}
 
+	pfree(query);
+
 	return materialization;
 }
 
@@ -652,8 +699,11 @@ execute_materialization_plan(MaterializationContext *context, MaterializationPla
 	MaterializationPlan *materialization = create_materialization_plan(context, plan_type);
 	Datum values[] = { context->materialization_range.start, context->materialization_range.end };
 	char nulls[] = { false, false };
+	instr_time start;
 
+	ts_job_phase_start(&start);
 	int res = SPI_execute_plan(materialization->plan, values, nulls, materialization->read_only, 0);
+	ts_job_phase_end(materialization->phase, &start);
 
 	if (res < 0 && materialization->emit_error != NULL)
 	{
@@ -676,7 +726,9 @@ free_materialization_plan(MaterializationContext *context, MaterializationPlanTy
 	if (materialization->plan != NULL)
 	{
 		SPI_freeplan(materialization->plan);
+		pfree(materialization->query);
 		materialization->plan = NULL;
+		materialization->query = NULL;
 	}
 }
 
@@ -739,11 +791,123 @@ update_watermark(MaterializationContext *context)
 	}
 }
 
+/*
+ * Discard the compressed batches of the compressed chunks of the
+ * materialization hypertable that the materialization range covers
+ * completely. The DELETE of the range would otherwise decompress all the
+ * batches only to delete the decompressed rows.
+ *
+ * Returns the relids of the chunks, to compress the new materializations of
+ * the chunks after the INSERT.
+ */
+static List *
+discard_compressed_materializations(MaterializationContext *context)
+{
+	const Dimension *dim = hyperspace_get_open_dimension(context->mat_ht->space, 0);
+	InternalTimeRange range = context->internal_materialization_range;
+	List *chunk_relids = NIL;
+	List *chunk_ids;
+	ListCell *lc;
+
+	if (dim == NULL || range.start >= range.end)
+		return NIL;
+
+	chunk_ids = ts_dimension_slice_get_compressed_chunkids_in_range(dim->fd.id,
+																	range.start,
+																	range.end);
+
+	foreach (lc, chunk_ids)
+	{
+		Chunk *chunk = ts_chunk_get_by_id(lfirst_int(lc), false);
+		int64 rows_deleted = 0;
+
+		if (chunk == NULL || chunk->fd.compressed_chunk_id == INVALID_CHUNK_ID ||
+			ts_chunk_is_frozen(chunk) || ts_is_hypercore_am(chunk->amoid))
+			continue;
+
+		/* Lock the chunk before the compressed chunk, as the DML on the chunk does */
+		LockRelationOid(chunk->table_id, RowExclusiveLock);
+
+		Oid compressed_relid = ts_chunk_get_relid(chunk->fd.compressed_chunk_id, false);
+		Relation rel = table_open(compressed_relid, RowExclusiveLock);
+		AttrNumber count_attno =
+			get_attnum(compressed_relid, COMPRESSION_COLUMN_METADATA_COUNT_NAME);
+		Snapshot snapshot = GetLatestSnapshot();
+		TupleTableSlot *slot = table_slot_create(rel, NULL);
+		TableScanDesc scan = table_beginscan(rel, snapshot, 0, NULL);
+
+		Ensure(count_attno != InvalidAttrNumber,
+			   "missing count metadata column in compressed chunk \"%s\"",
+			   get_rel_name(compressed_relid));
+
+		while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+		{
+			bool isnull;
+			Datum count = slot_getattr(slot, count_attno, &isnull);
+
+			if (!isnull)
+				rows_deleted += DatumGetInt32(count);
+
+			simple_table_tuple_delete(rel, &slot->tts_tid, snapshot);
+		}
+
+		table_endscan(scan);
+		ExecDropSingleTupleTableSlot(slot);
+		table_close(rel, NoLock);
+
+		elog(DEBUG2,
+			 "discarded " INT64_FORMAT " compressed row(s) of chunk \"%s.%s\"",
+			 rows_deleted,
+			 NameStr(chunk->fd.schema_name),
+			 NameStr(chunk->fd.table_name));
+
+		ts_progress_incr_param(PROGRESS_CAGG_REFRESH_ROWS_DELETED, rows_deleted);
+		chunk_relids = lappend_oid(chunk_relids, chunk->table_id);
+	}
+
+	if (chunk_relids != NIL)
+		CommandCounterIncrement();
+
+	return chunk_relids;
+}
+
+/*
+ * Compress the new materializations of the chunks whose compressed batches
+ * were discarded. The compressed chunks are empty, so the segmentwise
+ * recompression only compresses the inserted rows. Chunks that would need a
+ * full recompression are left to the compression policy.
+ */
+static void
+compress_materializations(List *chunk_relids)
+{
+	ListCell *lc;
+
+	foreach (lc, chunk_relids)
+	{
+		Chunk *chunk = ts_chunk_get_by_relid(lfirst_oid(lc), true);
+		CompressionSettings *settings;
+
+		if (!ts_chunk_needs_recompression(chunk) || !ts_guc_enable_segmentwise_recompression)
+			continue;
+
+		settings = ts_compression_settings_get(chunk->table_id);
+
+		if (settings == NULL || settings->fd.orderby == NULL)
+			continue;
+
+		tsl_compress_chunk_wrapper(chunk, true, false);
+	}
+}
+
 static void
 execute_materializations(MaterializationContext *context)
 {
 	volatile uint64 rows_processed = 0;
 
+	TIMESCALEDB_CAGG_MATERIALIZE_START(context->mat_ht->fd.id,
+									   context->internal_materialization_range.start,
+									   context->internal_materialization_range.end);
+
 	PG_TRY();
 	{
 		/* MERGE statement is available starting on PG15 and we'll support it only in the new format
@@ -769,12 +933,37 @@ execute_materializations(MaterializationContext *context)
 		}
 		else
 		{
-			rows_processed += execute_materialization_plan(context, PLAN_TYPE_DELETE);
+			/*
+			 * New buckets of append-only data have nothing materialized yet,
+			 * so only the aggregates of the new rows have to be inserted. Skip
+			 * the delete then, which is expensive if the range is in
+			 * compressed chunks of the materialization hypertable.
+			 */
+			List *compressed_chunk_relids = NIL;
+
+			if (execute_materialization_plan(context, PLAN_TYPE_EXISTS) > 0)
+			{
+				/*
+				 * The compressed batches of the chunks that the range covers
+				 * completely are deleted anyway, so drop them without
+				 * decompressing them first.
+				 */
+				if (ts_guc_enable_compressed_cagg_refresh &&
+					TS_HYPERTABLE_HAS_COMPRESSION_ENABLED(context->mat_ht) &&
+					context->chunk_condition[0] == '\0')
+					compressed_chunk_relids = discard_compressed_materializations(context);
+
+				rows_processed += execute_materialization_plan(context, PLAN_TYPE_DELETE);
+			}
+			else
+				elog(DEBUG2,
+					 "no rows to delete on materialization table \"%s.%s\"",
+					 NameStr(*context->materialization_table.schema),
+					 NameStr(*context->materialization_table.name));
+
 			rows_processed += execute_materialization_plan(context, PLAN_TYPE_INSERT);
+			compress_materializations(compressed_chunk_relids);
 		}
-
-		/* Free all cached plans */
-		free_materialization_plans(context);
 	}
 	PG_CATCH();
 	{
@@ -784,6 +973,8 @@ execute_materializations(MaterializationContext *context)
 	}
 	PG_END_TRY();
 
+	TIMESCALEDB_CAGG_MATERIALIZE_DONE(context->mat_ht->fd.id, rows_processed);
+
 	/* Get the max(time_dimension) of the materialized data */
 	if (rows_processed > 0)
 	{
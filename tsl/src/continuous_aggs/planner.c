@@ -5,15 +5,24 @@
  */
 #include <postgres.h>
 
+#include <miscadmin.h>
 #include <nodes/makefuncs.h>
 #include <nodes/nodeFuncs.h>
 #include <nodes/nodes.h>
 #include <nodes/pg_list.h>
 #include <parser/parse_func.h>
+#include <utils/acl.h>
+#include <utils/rls.h>
 
+#include "bgw/job.h"
+#include "bgw_policy/policies_v2.h"
+#include "chunk.h"
 #include "continuous_aggs/common.h"
+#include "continuous_aggs/insert.h"
+#include "continuous_aggs/invalidation.h"
 #include "planner.h"
 #include "ts_catalog/continuous_aggs_watermark.h"
+#include "utils.h"
 
 /*
  * The watermark function of a CAgg query is embedded into further functions. It
@@ -49,6 +58,7 @@ typedef struct
 	List *watermark_functions;		  // List of watermark functions (3)
 	List *relids;					  // List of used relids by the query
 	bool valid_query;				  // Is the query valid a valid CAgg query or not
+	const char *invalid_reason;		  // Why the watermarks are not constified
 } ConstifyWatermarkContext;
 
 /* Oid of the watermark function. It can be stored into a static variable because it will not
@@ -82,6 +92,9 @@ constify_cagg_watermark_walker(Node *node, ConstifyWatermarkContext *context)
 				(castNode(Const, linitial(funcExpr->args))->constisnull))
 			{
 				context->valid_query = false;
+				context->invalid_reason = context->parent_coalesce_expr == NULL ?
+											  "the watermark is not used in a COALESCE" :
+											  "the watermark argument is not a constant";
 				return false;
 			}
 
@@ -111,6 +124,8 @@ constify_cagg_watermark_walker(Node *node, ConstifyWatermarkContext *context)
 						linitial(((FuncExpr *) coalesce_arg)->args) != node)
 					{
 						context->valid_query = false;
+						context->invalid_reason =
+							"the watermark is wrapped in an unknown expression";
 						return false;
 					}
 
@@ -285,7 +300,12 @@ replace_watermark_with_const(ConstifyWatermarkContext *context)
 		 * range table and no invalidations would be processed. So, not replacing the function
 		 * invocation. */
 		if (watermark_const == NULL)
+		{
+			elog(DEBUG2,
+				 "watermark of hypertable %d not constified: the hypertable is not in the query",
+				 watermark_hypertable_id);
 			continue;
+		}
 
 		/* Replace cagg_watermark FuncExpr node by a Const node */
 		if (IsA(lfirst(parent_lc), FuncExpr))
@@ -351,9 +371,13 @@ constify_cagg_watermark(Query *parse)
 	/* Walk through the query and collect function information */
 	constify_cagg_watermark_walker(node, &context);
 
-	/* Replace watermark functions with const value if the query might belong to the CAgg query */
+	/* Replace watermark functions with const value if the query might belong to the CAgg query.
+	 * Without the constants, the real-time part of the query can't exclude the chunks at planning
+	 * time or push the watermark qual down into the compressed scans, so report why. */
 	if (context.valid_query)
 		replace_watermark_with_const(&context);
+	else
+		elog(DEBUG2, "watermark not constified: %s", context.invalid_reason);
 }
 
 /*
@@ -460,3 +484,393 @@ cagg_sort_pushdown(Query *parse, int *cursor_opts)
 	}
 	ts_cache_release(cache);
 }
+
+/*
+ * Rewrite of aggregate queries on a hypertable to a continuous aggregate.
+ *
+ * A query like
+ *
+ *     SELECT time_bucket('1 hour', time), avg(value) FROM metrics GROUP BY 1;
+ *
+ * computes the same result as the real-time continuous aggregate that is
+ * defined by the same query, as long as the materialized part of the
+ * continuous aggregate is up to date. The real-time part covers everything
+ * above the watermark. So we can replace the hypertable with the user view
+ * of the continuous aggregate, and the aggregation with plain references to
+ * its columns.
+ *
+ * We only do this when the result is exactly the same:
+ *
+ *   - the grouping of the query is the same as the grouping of the
+ *     continuous aggregate, so the groups are the same;
+ *   - all the aggregates and grouping expressions the query uses are output
+ *     columns of the continuous aggregate;
+ *   - the WHERE and HAVING clauses only use the grouping expressions and
+ *     the aggregates, so filtering the groups is the same as filtering the
+ *     rows before grouping;
+ *   - there are no invalidations below the watermark, neither in the logs nor
+ *     in the current transaction;
+ *   - the hypertable has no retention policy and no dropped chunks, whose
+ *     groups can still be in the continuous aggregate.
+ *
+ * The hypertable stays in the range table, but not in the join tree, so that
+ * the permissions on it are still checked and the plan is invalidated by the
+ * changes to it.
+ */
+typedef struct CaggQueryRewriteContext
+{
+	/* The output columns of the continuous aggregate */
+	List *cagg_tlist;
+	TupleDesc cagg_tupdesc;
+	/* The range table index of the user view in the rewritten query */
+	Index cagg_varno;
+	bool failed;
+} CaggQueryRewriteContext;
+
+/*
+ * Replace the expressions that are output columns of the continuous
+ * aggregate with references to these columns. Any other reference to the
+ * hypertable or aggregate means that the query can't be answered by the
+ * continuous aggregate.
+ */
+static Node *
+cagg_query_rewrite_mutator(Node *node, CaggQueryRewriteContext *context)
+{
+	ListCell *lc;
+
+	if (node == NULL || context->failed)
+		return node;
+
+	foreach (lc, context->cagg_tlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+		if (equal(node, tle->expr))
+		{
+			Form_pg_attribute attr = TupleDescAttr(context->cagg_tupdesc, tle->resno - 1);
+
+			return (Node *) makeVar(context->cagg_varno,
+									tle->resno,
+									attr->atttypid,
+									attr->atttypmod,
+									attr->attcollation,
+									0);
+		}
+	}
+
+	if (IsA(node, Var) || IsA(node, Aggref))
+	{
+		context->failed = true;
+		return node;
+	}
+
+	return expression_tree_mutator(node, cagg_query_rewrite_mutator, context);
+}
+
+/*
+ * Check if the grouping of the query is the same as the grouping of the
+ * direct query of the continuous aggregate.
+ */
+static bool
+cagg_query_rewrite_same_grouping(Query *parse, Query *direct_query)
+{
+	ListCell *lc;
+	Bitmapset *matched = NULL;
+	bool same = true;
+
+	foreach (lc, parse->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, parse->targetList);
+		ListCell *lc2;
+		bool found = false;
+
+		foreach (lc2, direct_query->groupClause)
+		{
+			SortGroupClause *cagg_sgc = lfirst_node(SortGroupClause, lc2);
+			TargetEntry *cagg_tle = get_sortgroupclause_tle(cagg_sgc, direct_query->targetList);
+
+			if (sgc->eqop == cagg_sgc->eqop && equal(tle->expr, cagg_tle->expr))
+			{
+				matched = bms_add_member(matched, cagg_tle->ressortgroupref);
+				found = true;
+				break;
+			}
+		}
+
+		if (!found)
+		{
+			same = false;
+			break;
+		}
+	}
+
+	same = same && bms_num_members(matched) == list_length(direct_query->groupClause);
+	bms_free(matched);
+
+	return same;
+}
+
+/*
+ * Get the direct query of a continuous aggregate if its definition is simple
+ * enough for the rewrite, that is, an aggregation of only the hypertable
+ * without any filters.
+ */
+static Query *
+cagg_query_rewrite_get_direct_query(const ContinuousAgg *cagg, Oid ht_relid)
+{
+	Oid direct_view_oid = ts_get_relation_relid(NameStr(cagg->data.direct_view_schema),
+												NameStr(cagg->data.direct_view_name),
+												false);
+	Relation direct_view_rel = relation_open(direct_view_oid, AccessShareLock);
+	Query *direct_query = copyObject(get_view_query(direct_view_rel));
+	RangeTblEntry *rte;
+
+	/* Keep lock until end of transaction. */
+	relation_close(direct_view_rel, NoLock);
+
+	RemoveRangeTableEntries(direct_query);
+
+	if (list_length(direct_query->rtable) != 1 ||
+		list_length(direct_query->jointree->fromlist) != 1 || direct_query->jointree->quals ||
+		direct_query->havingQual || direct_query->groupingSets || direct_query->distinctClause ||
+		!direct_query->hasAggs || direct_query->groupClause == NIL)
+		return NULL;
+
+	rte = linitial_node(RangeTblEntry, direct_query->rtable);
+	if (rte->rtekind != RTE_RELATION || rte->relid != ht_relid ||
+		!IsA(linitial(direct_query->jointree->fromlist), RangeTblRef))
+		return NULL;
+
+	return direct_query;
+}
+
+/*
+ * Try to rewrite the query to use the given continuous aggregate. Returns
+ * false, and leaves the query as is, if the continuous aggregate can't give
+ * the same result.
+ */
+static bool
+cagg_query_rewrite_to_cagg(Query *parse, const ContinuousAgg *cagg, Oid ht_relid)
+{
+	CaggQueryRewriteContext context = { 0 };
+	Query *direct_query;
+	Oid user_view_oid;
+	Relation user_view_rel;
+	RangeTblEntry *rte;
+	RangeTblRef *rtr;
+	List *target_list;
+	Node *quals;
+	Node *having;
+	Bitmapset *selected_cols = NULL;
+	ListCell *lc;
+	List *rewritten;
+	Query *query;
+	int64 watermark;
+
+	if (!ContinuousAggIsFinalized(cagg) || cagg->data.materialized_only ||
+		ContinuousAggIsHierarchical(cagg))
+		return false;
+
+	user_view_oid = ts_get_relation_relid(NameStr(cagg->data.user_view_schema),
+										  NameStr(cagg->data.user_view_name),
+										  false);
+	if (pg_class_aclcheck(user_view_oid, GetUserId(), ACL_SELECT) != ACLCHECK_OK)
+		return false;
+
+	direct_query = cagg_query_rewrite_get_direct_query(cagg, ht_relid);
+	if (direct_query == NULL || !cagg_query_rewrite_same_grouping(parse, direct_query))
+		return false;
+
+	/*
+	 * The materialized data of dropped chunks is kept until the dropped range
+	 * is refreshed, which the refresh windows of hypertables with retention
+	 * usually exclude, so the continuous aggregate can have groups that are
+	 * no longer in the hypertable. To not depend on the invalidations of the
+	 * dropped ranges, the rewrite is not done for hypertables with a
+	 * retention policy or with dropped chunks.
+	 */
+	if (ts_chunk_exists_dropped(cagg->data.raw_hypertable_id) ||
+		ts_bgw_job_find_by_proc_and_hypertable_id(POLICY_RETENTION_PROC_NAME,
+												  FUNCTIONS_SCHEMA_NAME,
+												  cagg->data.raw_hypertable_id) != NIL)
+	{
+		elog(DEBUG2,
+			 "query not rewritten to continuous aggregate \"%s\": dropped chunks",
+			 NameStr(cagg->data.user_view_name));
+		return false;
+	}
+
+	watermark = ts_cagg_watermark_get(cagg->data.mat_hypertable_id);
+	if (invalidation_pending_below_watermark(cagg, watermark))
+	{
+		elog(DEBUG2,
+			 "query not rewritten to continuous aggregate \"%s\": pending invalidations",
+			 NameStr(cagg->data.user_view_name));
+		return false;
+	}
+
+	/* The columns of the user view are the output columns of the direct query */
+	user_view_rel = relation_open(user_view_oid, AccessShareLock);
+	context.cagg_tupdesc = RelationGetDescr(user_view_rel);
+	context.cagg_varno = list_length(parse->rtable) + 1;
+
+	foreach (lc, direct_query->targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+		if (tle->resjunk)
+			continue;
+
+		if (tle->resno > context.cagg_tupdesc->natts ||
+			TupleDescAttr(context.cagg_tupdesc, tle->resno - 1)->atttypid !=
+				exprType((Node *) tle->expr))
+		{
+			context.failed = true;
+			break;
+		}
+
+		context.cagg_tlist = lappend(context.cagg_tlist, tle);
+	}
+
+	/* Map the query to the output columns, the HAVING clause becomes a WHERE clause */
+	target_list = (List *) cagg_query_rewrite_mutator((Node *) parse->targetList, &context);
+	quals = cagg_query_rewrite_mutator(parse->jointree->quals, &context);
+	having = cagg_query_rewrite_mutator(parse->havingQual, &context);
+
+	if (context.failed)
+	{
+		relation_close(user_view_rel, NoLock);
+		return false;
+	}
+
+	/* Replace the hypertable in the join tree with the user view */
+	rte = makeNode(RangeTblEntry);
+	rte->rtekind = RTE_RELATION;
+	rte->relid = user_view_oid;
+	rte->relkind = RELKIND_VIEW;
+	rte->rellockmode = AccessShareLock;
+	rte->alias = NULL;
+	rte->eref = makeAlias(NameStr(cagg->data.user_view_name), NIL);
+	for (int i = 0; i < context.cagg_tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(context.cagg_tupdesc, i);
+
+		rte->eref->colnames =
+			lappend(rte->eref->colnames, makeString(pstrdup(NameStr(attr->attname))));
+	}
+	rte->inh = false;
+	rte->inFromCl = true;
+	relation_close(user_view_rel, NoLock);
+
+	pull_varattnos((Node *) target_list, context.cagg_varno, &selected_cols);
+	pull_varattnos(quals, context.cagg_varno, &selected_cols);
+	pull_varattnos(having, context.cagg_varno, &selected_cols);
+
+#if PG16_LT
+	rte->requiredPerms = ACL_SELECT;
+	rte->checkAsUser = InvalidOid;
+	rte->selectedCols = selected_cols;
+#else
+	RTEPermissionInfo *perminfo = addRTEPermissionInfo(&parse->rteperminfos, rte);
+	perminfo->requiredPerms = ACL_SELECT;
+	perminfo->selectedCols = selected_cols;
+#endif
+
+	parse->rtable = lappend(parse->rtable, rte);
+	rtr = makeNode(RangeTblRef);
+	rtr->rtindex = context.cagg_varno;
+	parse->jointree->fromlist = list_make1(rtr);
+	parse->jointree->quals = (Node *) make_and_qual(quals, having);
+	parse->targetList = target_list;
+	parse->havingQual = NULL;
+	parse->groupClause = NIL;
+	parse->groupDistinct = false;
+	parse->hasAggs = false;
+
+	/* Expand the user view the same way as the rewriter does for the query on it */
+	rewritten = QueryRewrite(parse);
+	Ensure(list_length(rewritten) == 1, "unexpected number of queries after the rewrite");
+	query = linitial_node(Query, rewritten);
+	if (query != parse)
+		*parse = *query;
+
+	elog(DEBUG2,
+		 "query rewritten to continuous aggregate \"%s\"",
+		 NameStr(cagg->data.user_view_name));
+
+	return true;
+}
+
+/*
+ * Answer an aggregate query on a hypertable from a real-time continuous
+ * aggregate with the same definition, see above.
+ */
+void
+cagg_query_rewrite(Query *parse)
+{
+	RangeTblEntry *rte;
+	Cache *hcache;
+	Hypertable *ht;
+	List *caggs;
+	ListCell *lc;
+
+	if (parse->commandType != CMD_SELECT || parse->querySource != QSRC_ORIGINAL ||
+		!parse->canSetTag || parse->utilityStmt || !parse->hasAggs || parse->groupClause == NIL ||
+		parse->groupingSets || parse->distinctClause || parse->hasWindowFuncs ||
+		parse->hasTargetSRFs || parse->hasSubLinks || parse->cteList || parse->setOperations ||
+		parse->rowMarks || list_length(parse->rtable) != 1 ||
+		list_length(parse->jointree->fromlist) != 1 ||
+		!IsA(linitial(parse->jointree->fromlist), RangeTblRef))
+		return;
+
+	/* Per-row volatile functions could give different results per group */
+	if (contain_volatile_functions((Node *) parse->targetList) ||
+		contain_volatile_functions(parse->jointree->quals) ||
+		contain_volatile_functions(parse->havingQual))
+		return;
+
+	rte = linitial_node(RangeTblEntry, parse->rtable);
+	if (rte->rtekind != RTE_RELATION || rte->tablesample || rte->securityQuals ||
+		(!rte->inh && !ts_rte_is_marked_for_expansion(rte)))
+		return;
+
+	/* Row level security filters the rows before they are aggregated */
+	if (check_enable_rls(rte->relid, InvalidOid, true) != RLS_NONE)
+		return;
+
+	ht = ts_hypertable_cache_get_cache_and_entry(rte->relid, CACHE_FLAG_MISSING_OK, &hcache);
+	if (ht == NULL)
+	{
+		ts_cache_release(hcache);
+		return;
+	}
+
+	/* The invalidations of the current transaction are not in the logs yet */
+	if (continuous_agg_xact_has_invalidations(ht->fd.id))
+	{
+		ts_cache_release(hcache);
+		return;
+	}
+
+	/*
+	 * The checks for pending invalidations are only done here, so a plan of
+	 * the rewritten query must be invalidated when the hypertable gets new
+	 * invalidations. The plan depends on the hypertable, whose range table
+	 * entry stays in the query, and the relcache invalidations of the
+	 * hypertable are sent when the invalidations are logged. Within this
+	 * transaction, the invalidations are only in the cache, see
+	 * continuous_agg_note_query_rewrite().
+	 */
+	caggs = ts_continuous_aggs_find_by_raw_table_id(ht->fd.id);
+	foreach (lc, caggs)
+	{
+		if (cagg_query_rewrite_to_cagg(parse, lfirst(lc), ht->main_table_relid))
+		{
+			continuous_agg_note_query_rewrite(ht->fd.id);
+			break;
+		}
+	}
+
+	ts_cache_release(hcache);
+}
@@ -11,5 +11,6 @@
 
 void constify_cagg_watermark(Query *parse);
 void cagg_sort_pushdown(Query *parse, int *cursor_opts);
+void cagg_query_rewrite(Query *parse);
 
 #endif
@@ -9,6 +9,7 @@
 #include <executor/spi.h>
 #include <fmgr.h>
 #include <miscadmin.h>
+#include <portability/instr_time.h>
 #include <storage/lmgr.h>
 #include <utils/acl.h>
 #include <utils/builtins.h>
@@ -18,6 +19,7 @@
 #include <utils/lsyscache.h>
 #include <utils/snapmgr.h>
 
+#include "bgw/job_profile.h"
 #include "dimension.h"
 #include "dimension_slice.h"
 #include "guc.h"
@@ -27,6 +29,7 @@
 #include "invalidation_threshold.h"
 #include "materialize.h"
 #include "process_utility.h"
+#include "progress.h"
 #include "refresh.h"
 #include "time_bucket.h"
 #include "time_utils.h"
@@ -421,6 +424,9 @@ continuous_agg_refresh_execute(const CaggRefreshState *refresh,
 
 	Assert(time_dim != NULL);
 
+	ts_progress_update_param(PROGRESS_CAGG_REFRESH_WINDOW_START, bucketed_refresh_window->start);
+	ts_progress_update_param(PROGRESS_CAGG_REFRESH_WINDOW_END, bucketed_refresh_window->end);
+
 	continuous_agg_update_materialization(refresh->cagg_ht,
 										  &refresh->cagg,
 										  refresh->partial_view,
@@ -429,6 +435,22 @@ continuous_agg_refresh_execute(const CaggRefreshState *refresh,
 										  *bucketed_refresh_window,
 										  unused_invalidation_range,
 										  chunk_id);
+
+	ts_progress_incr_param(PROGRESS_CAGG_REFRESH_WINDOWS_DONE, 1);
+}
+
+/*
+ * Add the time since the start to a progress parameter of the refresh, in
+ * microseconds.
+ */
+static void
+refresh_progress_add_time(int index, const instr_time *start)
+{
+	instr_time duration;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, *start);
+	ts_progress_incr_param(index, (int64) INSTR_TIME_GET_MICROSEC(duration));
 }
 
 static void
@@ -730,6 +752,7 @@ process_cagg_invalidations_and_refresh(const ContinuousAgg *cagg,
 	Oid hyper_relid = ts_hypertable_id_to_relid(cagg->data.mat_hypertable_id, false);
 	bool do_merged_refresh = false;
 	InternalTimeRange merged_refresh_window;
+	instr_time start;
 
 	/* Lock the continuous aggregate's materialized hypertable to protect
 	 * against concurrent refreshes. Only concurrent reads will be
@@ -740,6 +763,11 @@ process_cagg_invalidations_and_refresh(const ContinuousAgg *cagg,
 	 * windows.
 	 */
 	LockRelationOid(hyper_relid, ExclusiveLock);
+
+	ts_progress_update_param(PROGRESS_CAGG_REFRESH_PHASE,
+							 PROGRESS_CAGG_REFRESH_PHASE_CAGG_INVALIDATIONS);
+	INSTR_TIME_SET_CURRENT(start);
+
 	const CaggsInfo all_caggs_info =
 		ts_continuous_agg_get_all_caggs_info(cagg->data.raw_hypertable_id);
 	invalidations = invalidation_process_cagg_log(cagg,
@@ -751,6 +779,9 @@ process_cagg_invalidations_and_refresh(const ContinuousAgg *cagg,
 												  context,
 												  force);
 
+	refresh_progress_add_time(PROGRESS_CAGG_REFRESH_INVALIDATION_TIME, &start);
+	ts_job_phase_end("invalidation_processing", &start);
+
 	if (invalidations != NULL || do_merged_refresh)
 	{
 		if (context.callctx == CAGG_REFRESH_CREATION)
@@ -762,6 +793,14 @@ process_cagg_invalidations_and_refresh(const ContinuousAgg *cagg,
 							 "aggregate on creation.")));
 		}
 
+		ts_progress_update_param(PROGRESS_CAGG_REFRESH_WINDOWS_TOTAL,
+								 do_merged_refresh ?
+									 1 :
+									 tuplestore_tuple_count(invalidations->tupstore));
+		ts_progress_update_param(PROGRESS_CAGG_REFRESH_PHASE,
+								 PROGRESS_CAGG_REFRESH_PHASE_MATERIALIZATION);
+		INSTR_TIME_SET_CURRENT(start);
+
 		continuous_agg_refresh_with_window(cagg,
 										   refresh_window,
 										   invalidations,
@@ -769,6 +808,9 @@ process_cagg_invalidations_and_refresh(const ContinuousAgg *cagg,
 										   do_merged_refresh,
 										   merged_refresh_window,
 										   context);
+
+		refresh_progress_add_time(PROGRESS_CAGG_REFRESH_MATERIALIZATION_TIME, &start);
+
 		if (invalidations)
 			invalidation_store_free(invalidations);
 		return true;
@@ -787,6 +829,7 @@ continuous_agg_refresh_internal(const ContinuousAgg *cagg,
 	InternalTimeRange refresh_window = *refresh_window_arg;
 	int64 invalidation_threshold;
 	bool nonatomic = ts_process_utility_is_context_nonatomic();
+	instr_time start;
 
 	/* Reset the saved ProcessUtilityContext value promptly before
 	 * calling Prevent* checks so the potential unsupported (atomic)
@@ -846,6 +889,18 @@ continuous_agg_refresh_internal(const ContinuousAgg *cagg,
 				 errdetail("The refresh window must cover at least one bucket of data."),
 				 errhint("Align the refresh window with the bucket"
 						 " time zone or use at least two buckets.")));
+	ts_progress_start_command(TS_PROGRESS_COMMAND_CAGG_REFRESH, cagg->relid);
+
+	if (context.callctx == CAGG_REFRESH_POLICY_BATCHED)
+	{
+		ts_progress_update_param(PROGRESS_CAGG_REFRESH_BATCH, context.processing_batch);
+		ts_progress_update_param(PROGRESS_CAGG_REFRESH_BATCHES, context.number_of_batches);
+	}
+
+	ts_progress_update_param(PROGRESS_CAGG_REFRESH_PHASE,
+							 PROGRESS_CAGG_REFRESH_PHASE_HYPERTABLE_INVALIDATIONS);
+	INSTR_TIME_SET_CURRENT(start);
+
 	/*
 	 * Perform the refresh across two transactions.
 	 *
@@ -889,6 +944,7 @@ continuous_agg_refresh_internal(const ContinuousAgg *cagg,
 		 invalidation_threshold == ts_time_get_min(refresh_window.type)))
 	{
 		emit_up_to_date_notice(cagg, context);
+		ts_progress_end_command();
 
 		/* Restore search_path */
 		AtEOXact_GUC(false, save_nestlevel);
@@ -904,6 +960,8 @@ continuous_agg_refresh_internal(const ContinuousAgg *cagg,
 	const CaggsInfo all_caggs_info =
 		ts_continuous_agg_get_all_caggs_info(cagg->data.raw_hypertable_id);
 	invalidation_process_hypertable_log(cagg, refresh_window.type, &all_caggs_info);
+	refresh_progress_add_time(PROGRESS_CAGG_REFRESH_INVALIDATION_TIME, &start);
+	ts_job_phase_end("invalidation_processing", &start);
 
 	/* Commit and Start a new transaction */
 	SPI_commit_and_chain();
@@ -917,6 +975,8 @@ continuous_agg_refresh_internal(const ContinuousAgg *cagg,
 												force))
 		emit_up_to_date_notice(cagg, context);
 
+	ts_progress_end_command();
+
 	/* Restore search_path */
 	AtEOXact_GUC(false, save_nestlevel);
 
@@ -925,6 +985,52 @@ continuous_agg_refresh_internal(const ContinuousAgg *cagg,
 		elog(ERROR, "SPI_finish failed: %s", SPI_result_code_string(rc));
 }
 
+/*
+ * Refresh the continuous aggregates on top of the continuous aggregate, and
+ * the ones on top of those, with the same refresh window.
+ *
+ * The refresh of the lower level wrote the invalidations of the upper levels
+ * to the hypertable invalidation log of its materialization hypertable, so
+ * the refresh of an upper level picks them up right away instead of at the
+ * next run of its own policy. The invalidations still go through the logs,
+ * since every refresh commits the processed invalidations together with the
+ * materialization, which has to survive a failure of the upper levels.
+ */
+void
+continuous_agg_refresh_cascade(const ContinuousAgg *cagg, const InternalTimeRange *refresh_window,
+							   const CaggRefreshContext context, const bool start_isnull,
+							   const bool end_isnull)
+{
+	List *caggs = ts_continuous_aggs_find_by_raw_table_id(cagg->data.mat_hypertable_id);
+	ListCell *lc;
+
+	foreach (lc, caggs)
+	{
+		const ContinuousAgg *upper_cagg = lfirst(lc);
+
+		/* The bucket of the lower level should have the type of its time column */
+		if (upper_cagg->partition_type != refresh_window->type)
+			continue;
+
+		elog(DEBUG1,
+			 "cascading refresh from continuous aggregate \"%s\" to \"%s\"",
+			 NameStr(cagg->data.user_view_name),
+			 NameStr(upper_cagg->data.user_view_name));
+
+		continuous_agg_refresh_internal(upper_cagg,
+										refresh_window,
+										context,
+										start_isnull,
+										end_isnull,
+										false);
+		continuous_agg_refresh_cascade(upper_cagg,
+									   refresh_window,
+									   context,
+									   start_isnull,
+									   end_isnull);
+	}
+}
+
 static void
 debug_refresh_window(const ContinuousAgg *cagg, const InternalTimeRange *refresh_window,
 					 const char *msg)
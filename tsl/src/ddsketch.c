@@ -0,0 +1,700 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * The quantile_sketch() aggregate and approx_quantile() function based on the
+ * DDSketch. This file has the sketch itself and the usual aggregate support
+ * functions, the vectorized implementation is in
+ * nodes/vector_agg/function/quantile_sketch.c.
+ */
+
+#include <postgres.h>
+
+#include <float.h>
+#include <math.h>
+
+#include <utils/memutils.h>
+
+#include "compression/arrow_c_data_interface.h"
+#include "ddsketch.h"
+
+#define DDS_FORMAT_VERSION 1
+
+/*
+ * The bucket i holds the absolute values in (gamma^(i-1), gamma^i].
+ */
+#define DDS_GAMMA ((1.0 + DDS_RELATIVE_ACCURACY) / (1.0 - DDS_RELATIVE_ACCURACY))
+
+/* The bucket indexes of all finite double values are well within this. */
+#define DDS_MAX_INDEX (1 << 20)
+
+/*
+ * The header of the serialized sketch. It is followed by the counts of the
+ * positive buckets and then the negative buckets. The counts are uint64 and
+ * the varlena data is not necessarily aligned, so we copy it when reading.
+ */
+typedef struct DDSketchSerialized
+{
+	int32 vl_len_;
+	uint8 version;
+	uint8 padding[3];
+	float8 relative_accuracy;
+	uint64 zero_count;
+	float8 min;
+	float8 max;
+	int32 positive_min_index;
+	int32 positive_buckets;
+	int32 negative_min_index;
+	int32 negative_buckets;
+} DDSketchSerialized;
+
+static double dds_inverse_log_gamma = 0;
+
+static pg_attribute_always_inline int32
+dds_bucket_index(double abs_value)
+{
+	if (unlikely(dds_inverse_log_gamma == 0))
+	{
+		dds_inverse_log_gamma = 1.0 / log(DDS_GAMMA);
+	}
+
+	return (int32) ceil(log(abs_value) * dds_inverse_log_gamma);
+}
+
+/*
+ * The value of the bucket that has the relative error of at most
+ * DDS_RELATIVE_ACCURACY for all the values in it.
+ */
+static double
+dds_bucket_value(int32 index)
+{
+	return 2.0 * pow(DDS_GAMMA, index) / (1.0 + DDS_GAMMA);
+}
+
+static pg_attribute_always_inline void
+dds_check_value(double value)
+{
+	if (unlikely(isnan(value) || isinf(value)))
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("cannot add a NaN or infinite value to a quantile sketch")));
+	}
+}
+
+/*
+ * Must be called before the new values are counted, because the sketch
+ * might be empty.
+ */
+static pg_attribute_always_inline void
+dds_update_extremes(DDSketch *sketch, double min, double max)
+{
+	if (dds_count(sketch) == 0)
+	{
+		sketch->min = min;
+		sketch->max = max;
+		return;
+	}
+
+	sketch->min = Min(sketch->min, min);
+	sketch->max = Max(sketch->max, max);
+}
+
+/*
+ * Make the store hold the buckets from lo to hi and the existing ones. If
+ * this range is too wide, the lowest buckets are collapsed. The caller must
+ * account for this by clamping the indexes it adds, see dds_store_lowest_index().
+ */
+static void
+dds_store_ensure(DDSketchStore *store, int32 lo, int32 hi, MemoryContext mctx)
+{
+	if (store->count > 0)
+	{
+		lo = Min(lo, store->min_index);
+		hi = Max(hi, store->max_index);
+	}
+
+	lo = Max(lo, hi - DDS_MAX_BUCKETS + 1);
+
+	if (store->counts != NULL && lo >= store->offset && hi < store->offset + store->capacity &&
+		(store->count == 0 || store->min_index >= lo))
+	{
+		/* The buckets fit and no existing buckets have to be collapsed. */
+		return;
+	}
+
+	const int32 needed = hi - lo + 1;
+	int32 capacity = Max(store->capacity, 64);
+	while (capacity < needed)
+	{
+		capacity *= 2;
+	}
+	capacity = Min(capacity, DDS_MAX_BUCKETS);
+
+	/*
+	 * Leave the free buckets on both sides, because the values usually come
+	 * in both directions, but don't go below the collapsing bound.
+	 */
+	const int32 offset = Max(lo - (capacity - needed) / 2, hi - DDS_MAX_BUCKETS + 1);
+	Assert(offset <= lo && hi < offset + capacity);
+
+	uint64 *counts = MemoryContextAllocZero(mctx, sizeof(uint64) * capacity);
+	if (store->count > 0)
+	{
+		for (int32 i = store->min_index; i <= store->max_index; i++)
+		{
+			counts[Max(i, lo) - offset] += store->counts[i - store->offset];
+		}
+		store->min_index = Max(store->min_index, lo);
+	}
+
+	if (store->counts != NULL)
+	{
+		pfree(store->counts);
+	}
+
+	store->counts = counts;
+	store->capacity = capacity;
+	store->offset = offset;
+}
+
+/*
+ * The lowest bucket index that the store can have after adding the buckets up
+ * to the given one. The lower indexes are collapsed into it.
+ */
+static pg_attribute_always_inline int32
+dds_store_lowest_index(const DDSketchStore *store, int32 hi)
+{
+	if (store->count > 0)
+	{
+		hi = Max(hi, store->max_index);
+	}
+	return hi - DDS_MAX_BUCKETS + 1;
+}
+
+static pg_attribute_always_inline void
+dds_store_update_range(DDSketchStore *store, int32 lo, int32 hi, uint64 n)
+{
+	if (store->count == 0)
+	{
+		store->min_index = lo;
+		store->max_index = hi;
+	}
+	else
+	{
+		store->min_index = Min(store->min_index, lo);
+		store->max_index = Max(store->max_index, hi);
+	}
+	store->count += n;
+}
+
+static void
+dds_store_add(DDSketchStore *store, int32 index, uint64 n, MemoryContext mctx)
+{
+	index = Max(index, dds_store_lowest_index(store, index));
+	dds_store_ensure(store, index, index, mctx);
+	store->counts[index - store->offset] += n;
+	dds_store_update_range(store, index, index, n);
+}
+
+/*
+ * Add the bucket indexes computed for a part of a batch to the store. The
+ * range of the store is adjusted only once.
+ */
+static void
+dds_store_add_indexes(DDSketchStore *store, const int32 *indexes, int n, int32 lo, int32 hi,
+					  MemoryContext mctx)
+{
+	if (n == 0)
+	{
+		return;
+	}
+
+	const int32 lowest = dds_store_lowest_index(store, hi);
+	lo = Max(lo, lowest);
+	dds_store_ensure(store, lo, hi, mctx);
+
+	uint64 *restrict counts = store->counts;
+	const int32 offset = store->offset;
+	for (int i = 0; i < n; i++)
+	{
+		counts[Max(indexes[i], lowest) - offset]++;
+	}
+
+	dds_store_update_range(store, lo, hi, n);
+}
+
+void
+dds_add(DDSketch *sketch, double value, uint64 n, MemoryContext mctx)
+{
+	dds_check_value(value);
+	dds_update_extremes(sketch, value, value);
+
+	if (value >= DBL_MIN)
+	{
+		dds_store_add(&sketch->positive, dds_bucket_index(value), n, mctx);
+	}
+	else if (value <= -DBL_MIN)
+	{
+		dds_store_add(&sketch->negative, dds_bucket_index(-value), n, mctx);
+	}
+	else
+	{
+		sketch->zero_count += n;
+	}
+}
+
+/*
+ * Add the values of a batch that pass the filter. The bucket indexes are
+ * computed in a separate loop, and the stores are extended once per group of
+ * rows, not for every value.
+ */
+#define DDS_ROWS_PER_STEP 256
+
+void
+dds_add_values(DDSketch *sketch, const double *values, const uint64 *filter, int n,
+			   MemoryContext mctx)
+{
+	for (int start = 0; start < n; start += DDS_ROWS_PER_STEP)
+	{
+		const int end = Min(start + DDS_ROWS_PER_STEP, n);
+
+		int32 positive_indexes[DDS_ROWS_PER_STEP];
+		int32 negative_indexes[DDS_ROWS_PER_STEP];
+		int num_positive = 0;
+		int num_negative = 0;
+		int num_zero = 0;
+		int32 positive_lo = PG_INT32_MAX;
+		int32 positive_hi = PG_INT32_MIN;
+		int32 negative_lo = PG_INT32_MAX;
+		int32 negative_hi = PG_INT32_MIN;
+		double min = DBL_MAX;
+		double max = -DBL_MAX;
+
+		for (int row = start; row < end; row++)
+		{
+			if (!arrow_row_is_valid(filter, row))
+			{
+				continue;
+			}
+
+			const double value = values[row];
+			dds_check_value(value);
+			min = Min(min, value);
+			max = Max(max, value);
+
+			if (value >= DBL_MIN)
+			{
+				const int32 index = dds_bucket_index(value);
+				positive_indexes[num_positive++] = index;
+				positive_lo = Min(positive_lo, index);
+				positive_hi = Max(positive_hi, index);
+			}
+			else if (value <= -DBL_MIN)
+			{
+				const int32 index = dds_bucket_index(-value);
+				negative_indexes[num_negative++] = index;
+				negative_lo = Min(negative_lo, index);
+				negative_hi = Max(negative_hi, index);
+			}
+			else
+			{
+				num_zero++;
+			}
+		}
+
+		if (num_positive + num_negative + num_zero == 0)
+		{
+			continue;
+		}
+
+		dds_update_extremes(sketch, min, max);
+		sketch->zero_count += num_zero;
+		dds_store_add_indexes(&sketch->positive,
+							  positive_indexes,
+							  num_positive,
+							  positive_lo,
+							  positive_hi,
+							  mctx);
+		dds_store_add_indexes(&sketch->negative,
+							  negative_indexes,
+							  num_negative,
+							  negative_lo,
+							  negative_hi,
+							  mctx);
+	}
+}
+
+static void
+dds_store_merge(DDSketchStore *into, const DDSketchStore *from, MemoryContext mctx)
+{
+	if (from->count == 0)
+	{
+		return;
+	}
+
+	const int32 lowest = dds_store_lowest_index(into, from->max_index);
+	const int32 lo = Max(from->min_index, lowest);
+	dds_store_ensure(into, lo, from->max_index, mctx);
+
+	for (int32 i = from->min_index; i <= from->max_index; i++)
+	{
+		into->counts[Max(i, lowest) - into->offset] += from->counts[i - from->offset];
+	}
+
+	dds_store_update_range(into, lo, from->max_index, from->count);
+}
+
+void
+dds_merge(DDSketch *into, const DDSketch *from, MemoryContext mctx)
+{
+	if (dds_count(from) == 0)
+	{
+		return;
+	}
+
+	dds_update_extremes(into, from->min, from->max);
+	into->zero_count += from->zero_count;
+	dds_store_merge(&into->positive, &from->positive, mctx);
+	dds_store_merge(&into->negative, &from->negative, mctx);
+}
+
+static int32
+dds_store_buckets(const DDSketchStore *store)
+{
+	return store->count > 0 ? store->max_index - store->min_index + 1 : 0;
+}
+
+bytea *
+dds_serialize(const DDSketch *sketch)
+{
+	const int32 positive_buckets = dds_store_buckets(&sketch->positive);
+	const int32 negative_buckets = dds_store_buckets(&sketch->negative);
+	const Size size =
+		sizeof(DDSketchSerialized) + sizeof(uint64) * (positive_buckets + negative_buckets);
+
+	DDSketchSerialized *serialized = palloc0(size);
+	SET_VARSIZE(serialized, size);
+	serialized->version = DDS_FORMAT_VERSION;
+	serialized->relative_accuracy = DDS_RELATIVE_ACCURACY;
+	serialized->zero_count = sketch->zero_count;
+	serialized->min = sketch->min;
+	serialized->max = sketch->max;
+	serialized->positive_min_index = sketch->positive.min_index;
+	serialized->positive_buckets = positive_buckets;
+	serialized->negative_min_index = sketch->negative.min_index;
+	serialized->negative_buckets = negative_buckets;
+
+	uint64 *counts = (uint64 *) (serialized + 1);
+	if (positive_buckets > 0)
+	{
+		memcpy(counts,
+			   &sketch->positive.counts[sketch->positive.min_index - sketch->positive.offset],
+			   sizeof(uint64) * positive_buckets);
+	}
+	if (negative_buckets > 0)
+	{
+		memcpy(counts + positive_buckets,
+			   &sketch->negative.counts[sketch->negative.min_index - sketch->negative.offset],
+			   sizeof(uint64) * negative_buckets);
+	}
+
+	return (bytea *) serialized;
+}
+
+static void
+dds_deserialize_store(DDSketchStore *store, const char *data, int32 min_index, int32 buckets,
+					  MemoryContext mctx)
+{
+	if (buckets == 0)
+	{
+		return;
+	}
+
+	store->counts = MemoryContextAlloc(mctx, sizeof(uint64) * buckets);
+	memcpy(store->counts, data, sizeof(uint64) * buckets);
+	store->capacity = buckets;
+	store->offset = min_index;
+	store->min_index = min_index;
+	store->max_index = min_index + buckets - 1;
+
+	for (int32 i = 0; i < buckets; i++)
+	{
+		store->count += store->counts[i];
+	}
+}
+
+void
+dds_deserialize(const bytea *serialized, DDSketch *sketch, MemoryContext mctx)
+{
+	DDSketchSerialized header;
+
+	if (VARSIZE_ANY_EXHDR(serialized) < sizeof(DDSketchSerialized) - VARHDRSZ)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED), errmsg("invalid size of the quantile sketch")));
+	}
+
+	/* Copy the header, because the varlena data might be not aligned for it. */
+	memcpy((char *) &header + VARHDRSZ,
+		   VARDATA_ANY(serialized),
+		   sizeof(DDSketchSerialized) - VARHDRSZ);
+
+	if (header.version != DDS_FORMAT_VERSION ||
+		header.relative_accuracy != DDS_RELATIVE_ACCURACY || header.positive_buckets < 0 ||
+		header.positive_buckets > DDS_MAX_BUCKETS || header.negative_buckets < 0 ||
+		header.negative_buckets > DDS_MAX_BUCKETS ||
+		abs(header.positive_min_index) > DDS_MAX_INDEX ||
+		abs(header.negative_min_index) > DDS_MAX_INDEX)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED), errmsg("invalid format of the quantile sketch")));
+	}
+
+	const Size expected_size = sizeof(DDSketchSerialized) - VARHDRSZ +
+							   sizeof(uint64) * (header.positive_buckets + header.negative_buckets);
+	if (VARSIZE_ANY_EXHDR(serialized) != expected_size)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED), errmsg("invalid size of the quantile sketch")));
+	}
+
+	memset(sketch, 0, sizeof(DDSketch));
+	sketch->zero_count = header.zero_count;
+	sketch->min = header.min;
+	sketch->max = header.max;
+
+	const char *counts =
+		(const char *) VARDATA_ANY(serialized) + sizeof(DDSketchSerialized) - VARHDRSZ;
+	dds_deserialize_store(&sketch->positive,
+						  counts,
+						  header.positive_min_index,
+						  header.positive_buckets,
+						  mctx);
+	dds_deserialize_store(&sketch->negative,
+						  counts + sizeof(uint64) * header.positive_buckets,
+						  header.negative_min_index,
+						  header.negative_buckets,
+						  mctx);
+}
+
+/*
+ * Estimate the value at the given fraction of the sorted values. The values
+ * are ordered from the largest negative buckets to the largest positive ones.
+ */
+double
+dds_quantile(const DDSketch *sketch, double fraction)
+{
+	const uint64 count = dds_count(sketch);
+	Assert(count > 0);
+
+	/* The extremes are known exactly. */
+	if (fraction == 0)
+	{
+		return sketch->min;
+	}
+	if (fraction == 1)
+	{
+		return sketch->max;
+	}
+
+	const double rank = fraction * (count - 1);
+	double result;
+	uint64 seen = 0;
+
+	const DDSketchStore *negative = &sketch->negative;
+	if (negative->count > 0)
+	{
+		for (int32 i = negative->max_index; i >= negative->min_index; i--)
+		{
+			seen += negative->counts[i - negative->offset];
+			if (seen > rank)
+			{
+				result = -dds_bucket_value(i);
+				return Max(sketch->min, Min(result, sketch->max));
+			}
+		}
+	}
+
+	seen += sketch->zero_count;
+	if (seen > rank)
+	{
+		return 0;
+	}
+
+	const DDSketchStore *positive = &sketch->positive;
+	for (int32 i = positive->min_index; i <= positive->max_index; i++)
+	{
+		seen += positive->counts[i - positive->offset];
+		if (seen > rank)
+		{
+			result = dds_bucket_value(i);
+			return Max(sketch->min, Min(result, sketch->max));
+		}
+	}
+
+	return sketch->max;
+}
+
+static MemoryContext
+dds_get_aggcontext(FunctionCallInfo fcinfo, const char *funcname)
+{
+	MemoryContext aggcontext;
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+	{
+		/* Cannot be called directly because of internal-type argument. */
+		elog(ERROR, "%s called in non-aggregate context", funcname);
+	}
+	return aggcontext;
+}
+
+static DDSketch *
+dds_state_create(MemoryContext aggcontext)
+{
+	return MemoryContextAllocZero(aggcontext, sizeof(DDSketch));
+}
+
+/*
+ * quantile_sketch(double precision) transition function.
+ */
+Datum
+tsl_ddsketch_sfunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext = dds_get_aggcontext(fcinfo, "ddsketch_sfunc");
+	DDSketch *state = PG_ARGISNULL(0) ? NULL : (DDSketch *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+	{
+		/* The nulls are not counted. */
+		if (state == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state);
+	}
+
+	if (state == NULL)
+	{
+		state = dds_state_create(aggcontext);
+	}
+
+	dds_add(state, PG_GETARG_FLOAT8(1), 1, aggcontext);
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * quantile_sketch_rollup(bytea) transition function, merges the sketches
+ * computed previously, e.g. by a continuous aggregate.
+ */
+Datum
+tsl_ddsketch_rollup_sfunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext = dds_get_aggcontext(fcinfo, "ddsketch_rollup_sfunc");
+	DDSketch *state = PG_ARGISNULL(0) ? NULL : (DDSketch *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+	{
+		if (state == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state);
+	}
+
+	if (state == NULL)
+	{
+		state = dds_state_create(aggcontext);
+	}
+
+	DDSketch other;
+	dds_deserialize(PG_GETARG_BYTEA_PP(1), &other, CurrentMemoryContext);
+	dds_merge(state, &other, aggcontext);
+
+	PG_RETURN_POINTER(state);
+}
+
+Datum
+tsl_ddsketch_combinefunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext = dds_get_aggcontext(fcinfo, "ddsketch_combinefunc");
+	DDSketch *state1 = PG_ARGISNULL(0) ? NULL : (DDSketch *) PG_GETARG_POINTER(0);
+	DDSketch *state2 = PG_ARGISNULL(1) ? NULL : (DDSketch *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	if (state1 == NULL)
+	{
+		/* The first state must be in the aggregate context. */
+		state1 = dds_state_create(aggcontext);
+	}
+
+	dds_merge(state1, state2, aggcontext);
+
+	PG_RETURN_POINTER(state1);
+}
+
+Datum
+tsl_ddsketch_serializefunc(PG_FUNCTION_ARGS)
+{
+	dds_get_aggcontext(fcinfo, "ddsketch_serializefunc");
+	DDSketch *state = (DDSketch *) PG_GETARG_POINTER(0);
+	PG_RETURN_BYTEA_P(dds_serialize(state));
+}
+
+Datum
+tsl_ddsketch_deserializefunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext = dds_get_aggcontext(fcinfo, "ddsketch_deserializefunc");
+	DDSketch *state = dds_state_create(aggcontext);
+	dds_deserialize(PG_GETARG_BYTEA_PP(0), state, aggcontext);
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * Returns the serialized sketch, to be used with approx_quantile() or stored
+ * and merged later with quantile_sketch_rollup().
+ */
+Datum
+tsl_ddsketch_finalfunc(PG_FUNCTION_ARGS)
+{
+	dds_get_aggcontext(fcinfo, "ddsketch_finalfunc");
+
+	if (PG_ARGISNULL(0))
+	{
+		PG_RETURN_NULL();
+	}
+
+	DDSketch *state = (DDSketch *) PG_GETARG_POINTER(0);
+	PG_RETURN_BYTEA_P(dds_serialize(state));
+}
+
+/*
+ * approx_quantile(sketch bytea, fraction double precision)
+ */
+Datum
+tsl_approx_quantile(PG_FUNCTION_ARGS)
+{
+	const double fraction = PG_GETARG_FLOAT8(1);
+
+	if (fraction < 0 || fraction > 1 || isnan(fraction))
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("quantile value %g is not between 0 and 1", fraction)));
+	}
+
+	DDSketch sketch;
+	dds_deserialize(PG_GETARG_BYTEA_PP(0), &sketch, CurrentMemoryContext);
+
+	if (dds_count(&sketch) == 0)
+	{
+		PG_RETURN_NULL();
+	}
+
+	PG_RETURN_FLOAT8(dds_quantile(&sketch, fraction));
+}
@@ -0,0 +1,78 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <fmgr.h>
+
+/*
+ * The DDSketch quantile sketch for quantile_sketch() and approx_quantile().
+ * The values are counted in the logarithmically sized buckets, so that the
+ * quantile estimates have the relative error within DDS_RELATIVE_ACCURACY.
+ * The sketches are exactly mergeable, so the partial aggregation results of
+ * chunks and parallel workers can be combined without losing accuracy.
+ *
+ * The positive and negative values are counted in separate stores, by the
+ * bucket index of the absolute value. A store holds up to DDS_MAX_BUCKETS
+ * consecutive buckets, which covers about 18 orders of magnitude. If the
+ * values span a wider range, the lowest buckets are collapsed into one, so
+ * the accuracy is lost for the values closest to zero.
+ *
+ * The same sketch is built by the usual aggregate transition function and by
+ * the vectorized aggregation, and they use the same serialized format for
+ * the partial aggregation results.
+ */
+#define DDS_RELATIVE_ACCURACY 0.01
+#define DDS_MAX_BUCKETS 2048
+
+typedef struct DDSketchStore
+{
+	/* The counts of the buckets starting with the offset index. */
+	uint64 *counts;
+	int32 capacity;
+	int32 offset;
+
+	/* The range of the nonempty buckets, valid when the count is not zero. */
+	int32 min_index;
+	int32 max_index;
+	uint64 count;
+} DDSketchStore;
+
+typedef struct DDSketch
+{
+	/* The values too close to zero to have a bucket. */
+	uint64 zero_count;
+
+	/* The exact extremes, to clamp the estimates. */
+	double min;
+	double max;
+
+	DDSketchStore positive;
+	DDSketchStore negative;
+} DDSketch;
+
+static inline uint64
+dds_count(const DDSketch *sketch)
+{
+	return sketch->zero_count + sketch->positive.count + sketch->negative.count;
+}
+
+/* The sketch is zero-initialized, and the stores are allocated on demand. */
+extern void dds_add(DDSketch *sketch, double value, uint64 n, MemoryContext mctx);
+extern void dds_add_values(DDSketch *sketch, const double *values, const uint64 *filter, int n,
+						   MemoryContext mctx);
+extern void dds_merge(DDSketch *into, const DDSketch *from, MemoryContext mctx);
+extern bytea *dds_serialize(const DDSketch *sketch);
+extern void dds_deserialize(const bytea *serialized, DDSketch *sketch, MemoryContext mctx);
+extern double dds_quantile(const DDSketch *sketch, double fraction);
+
+extern Datum tsl_ddsketch_sfunc(PG_FUNCTION_ARGS);
+extern Datum tsl_ddsketch_rollup_sfunc(PG_FUNCTION_ARGS);
+extern Datum tsl_ddsketch_combinefunc(PG_FUNCTION_ARGS);
+extern Datum tsl_ddsketch_serializefunc(PG_FUNCTION_ARGS);
+extern Datum tsl_ddsketch_deserializefunc(PG_FUNCTION_ARGS);
+extern Datum tsl_ddsketch_finalfunc(PG_FUNCTION_ARGS);
+extern Datum tsl_approx_quantile(PG_FUNCTION_ARGS);
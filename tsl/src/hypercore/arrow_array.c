@@ -54,19 +54,25 @@ arrow_private_cstring_to_text_datum(ArrowPrivate *ap, const uint8 *data, size_t
 }
 
 static ArrowPrivate *
-arrow_private_create(ArrowArray *array, Oid typid)
+arrow_private_create_typbyval(ArrowArray *array, bool typbyval)
 {
 	ArrowPrivate *private = array->private_data;
 
 	Assert(NULL == array->private_data);
 	private = palloc0(sizeof(ArrowPrivate));
 	private->mcxt = CurrentMemoryContext;
-	private->typbyval = get_typbyval(typid);
+	private->typbyval = typbyval;
 	array->private_data = private;
 
 	return private;
 }
 
+static ArrowPrivate *
+arrow_private_create(ArrowArray *array, Oid typid)
+{
+	return arrow_private_create_typbyval(array, get_typbyval(typid));
+}
+
 static inline ArrowPrivate *
 arrow_private_get(const ArrowArray *array)
 {
@@ -528,3 +534,188 @@ arrow_create_with_buffers(MemoryContext mcxt, int n_buffers)
 
 	return array;
 }
+
+/*
+ * Serialized form of an arrow array, used by the shared arrow cache.
+ *
+ * The header is followed by the buffers, each padded to MAXALIGN, and then by
+ * the serialized dictionary, if any. We store both the number of bytes we
+ * copy from a buffer and the number of bytes we have to allocate for it,
+ * because the vectorized code reads the padding after the last row.
+ */
+#define ARROW_SERIALIZED_MAX_BUFFERS 3
+
+typedef struct ArrowSerializedHeader
+{
+	int64 length;
+	int64 null_count;
+	int32 n_buffers;
+	bool has_validity;
+	bool has_dictionary;
+	uint32 buffer_bytes[ARROW_SERIALIZED_MAX_BUFFERS];
+	uint32 alloc_bytes[ARROW_SERIALIZED_MAX_BUFFERS];
+} ArrowSerializedHeader;
+
+static bool
+arrow_serializable(const ArrowArray *array)
+{
+	if (array->children != NULL || array->buffers[1] == NULL)
+		return false;
+
+	if (array->dictionary != NULL)
+		return array->n_buffers == 2 && array->dictionary->dictionary == NULL;
+
+	return array->n_buffers == 2 || array->n_buffers == ARROW_SERIALIZED_MAX_BUFFERS;
+}
+
+static void
+arrow_serialized_header_init(ArrowSerializedHeader *header, const ArrowArray *array, int16 typlen)
+{
+	const uint32 padded_rows = pad_to_multiple(64, array->length);
+
+	memset(header, 0, sizeof(*header));
+	header->length = array->length;
+	header->null_count = array->null_count;
+	header->n_buffers = array->n_buffers;
+	header->has_validity = array->buffers[0] != NULL;
+	header->has_dictionary = array->dictionary != NULL;
+
+	if (header->has_validity)
+	{
+		header->buffer_bytes[0] = sizeof(uint64) * (padded_rows / 64);
+		header->alloc_bytes[0] = header->buffer_bytes[0];
+	}
+
+	if (array->dictionary != NULL)
+	{
+		/* The int16 indexes into the dictionary. */
+		header->buffer_bytes[1] = sizeof(int16) * array->length;
+		header->alloc_bytes[1] = sizeof(int16) * padded_rows;
+	}
+	else if (array->n_buffers == 3)
+	{
+		/* The offsets and the bodies of the variable-length values. */
+		const uint32 *offsets = array->buffers[1];
+		header->buffer_bytes[1] = sizeof(uint32) * (array->length + 1);
+		header->alloc_bytes[1] = pad_to_multiple(64, header->buffer_bytes[1]);
+		header->buffer_bytes[2] = offsets[array->length];
+		header->alloc_bytes[2] = pad_to_multiple(64, header->buffer_bytes[2]);
+	}
+	else
+	{
+		/*
+		 * Same as for the bulk decompression, the code that converts the
+		 * elements to Datums can read 8 bytes after the last row.
+		 */
+		Assert(typlen > 0);
+		header->buffer_bytes[1] = typlen * array->length;
+		header->alloc_bytes[1] = typlen * padded_rows + 8;
+	}
+}
+
+/*
+ * Get the size of the serialized arrow array, or zero if the array can't be
+ * serialized.
+ */
+Size
+arrow_serialized_size(const ArrowArray *array, int16 typlen)
+{
+	ArrowSerializedHeader header;
+
+	if (!arrow_serializable(array))
+		return 0;
+
+	arrow_serialized_header_init(&header, array, typlen);
+
+	Size size = MAXALIGN(sizeof(header));
+	for (int i = 0; i < header.n_buffers; i++)
+		size += MAXALIGN(header.buffer_bytes[i]);
+
+	if (array->dictionary != NULL)
+	{
+		const Size dictionary_size = arrow_serialized_size(array->dictionary, typlen);
+		if (dictionary_size == 0)
+			return 0;
+		size += dictionary_size;
+	}
+
+	return size;
+}
+
+/*
+ * Serialize the arrow array into the given memory, which must have the size
+ * returned by arrow_serialized_size(). Returns the end of the serialized data.
+ */
+char *
+arrow_serialize(const ArrowArray *array, int16 typlen, char *dest)
+{
+	ArrowSerializedHeader header;
+
+	Assert(arrow_serializable(array));
+	arrow_serialized_header_init(&header, array, typlen);
+
+	memcpy(dest, &header, sizeof(header));
+	dest += MAXALIGN(sizeof(header));
+
+	for (int i = 0; i < header.n_buffers; i++)
+	{
+		if (i == 0 && !header.has_validity)
+			continue;
+
+		memcpy(dest, array->buffers[i], header.buffer_bytes[i]);
+		dest += MAXALIGN(header.buffer_bytes[i]);
+	}
+
+	if (array->dictionary != NULL)
+		dest = arrow_serialize(array->dictionary, typlen, dest);
+
+	return dest;
+}
+
+static ArrowArray *
+arrow_deserialize_buffers(const char **src, MemoryContext mcxt)
+{
+	ArrowSerializedHeader header;
+
+	memcpy(&header, *src, sizeof(header));
+	*src += MAXALIGN(sizeof(header));
+
+	ArrowArray *array = arrow_create_with_buffers(mcxt, header.n_buffers);
+	array->length = header.length;
+	array->null_count = header.null_count;
+	array->release = arrow_release_buffers;
+
+	for (int i = 0; i < header.n_buffers; i++)
+	{
+		if (i == 0 && !header.has_validity)
+			continue;
+
+		void *buffer = MemoryContextAlloc(mcxt, header.alloc_bytes[i]);
+		memcpy(buffer, *src, header.buffer_bytes[i]);
+		array->buffers[i] = buffer;
+		*src += MAXALIGN(header.buffer_bytes[i]);
+	}
+
+	if (header.has_dictionary)
+		array->dictionary = arrow_deserialize_buffers(src, mcxt);
+
+	return array;
+}
+
+/*
+ * Create an arrow array from its serialized form, with the data allocated in
+ * the given memory context, same as for arrow_from_compressed(). We take
+ * typbyval instead of the type, so that this does no catalog lookups, and can
+ * be used while holding a lock.
+ */
+ArrowArray *
+arrow_deserialize(const char *src, bool typbyval, MemoryContext mcxt)
+{
+	ArrowArray *array = arrow_deserialize_buffers(&src, mcxt);
+
+	MemoryContext oldcxt = MemoryContextSwitchTo(mcxt);
+	arrow_private_create_typbyval(array, typbyval);
+	MemoryContextSwitchTo(oldcxt);
+
+	return array;
+}
@@ -15,3 +15,6 @@ extern NullableDatum arrow_get_datum(const ArrowArray *array, Oid typid, int16 t
 									 uint16 index);
 extern ArrowArray *arrow_from_compressed(Datum compressed, Oid typid, MemoryContext dest_mcxt,
 										 MemoryContext tmp_mcxt);
+extern Size arrow_serialized_size(const ArrowArray *array, int16 typlen);
+extern char *arrow_serialize(const ArrowArray *array, int16 typlen, char *dest);
+extern ArrowArray *arrow_deserialize(const char *src, bool typbyval, MemoryContext mcxt);
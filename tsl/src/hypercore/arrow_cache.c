@@ -20,10 +20,15 @@
 #include "arrow_array.h"
 #include "arrow_cache.h"
 #include "arrow_cache_explain.h"
+#include "arrow_shared_cache.h"
 #include "arrow_tts.h"
 #include "compression/compression.h"
 
-#define ARROW_DECOMPRESSION_CACHE_LRU_ENTRIES 100
+/*
+ * The share of the cache that the probation list can use before its entries
+ * are evicted in preference to the protected ones.
+ */
+#define ARROW_CACHE_PROBATION_FRACTION 4
 
 typedef struct ArrowColumnKey
 {
@@ -43,8 +48,19 @@ typedef struct ArrowColumnCacheEntry
 	dlist_node node; /* List link in LRU list. */
 	ArrowArray **arrow_arrays;
 	int16 num_arrays; /* Number of entries in arrow_arrays */
+	bool protected;	  /* In the protected list, otherwise in probation */
+	size_t nbytes;	  /* Bytes used by the arrow arrays */
 } ArrowColumnCacheEntry;
 
+/*
+ * The key of an entry recently evicted from the probation list.
+ */
+typedef struct ArrowColumnGhostEntry
+{
+	ArrowColumnKey key;
+	dlist_node node;
+} ArrowColumnGhostEntry;
+
 void
 arrow_column_cache_init(ArrowColumnCache *acache, MemoryContext mcxt)
 {
@@ -64,28 +80,77 @@ arrow_column_cache_init(ArrowColumnCache *acache, MemoryContext mcxt)
 													   /* initBlockSize = */ 64 * 1024,
 													   /* maxBlockSize = */ 64 * 1024);
 	acache->maxsize = ts_guc_hypercore_arrow_cache_max_entries;
+	acache->maxbytes = (size_t) ts_guc_hypercore_arrow_cache_max_memory * 1024;
 
 	ctl.keysize = sizeof(ArrowColumnKey);
 	ctl.entrysize = sizeof(ArrowColumnCacheEntry);
 	ctl.hcxt = acache->mcxt;
 	acache->htab =
 		hash_create("Arrow column data cache", 32, &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-	acache->arrow_column_cache_lru_count = 0;
-	dlist_init(&acache->arrow_column_cache_lru);
+	dlist_init(&acache->probation_lru);
+	dlist_init(&acache->protected_lru);
+	acache->num_entries = 0;
+	acache->num_probation_entries = 0;
+	acache->total_bytes = 0;
+	acache->probation_bytes = 0;
+	acache->hits = 0;
+	acache->misses = 0;
+	acache->decompressed_rows = 0;
+
+	ctl.entrysize = sizeof(ArrowColumnGhostEntry);
+	acache->ghost_htab = hash_create("Arrow column data cache ghosts",
+									 32,
+									 &ctl,
+									 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	dlist_init(&acache->ghost_lru);
+	acache->num_ghosts = 0;
 }
 
 void
 arrow_column_cache_release(ArrowColumnCache *acache)
 {
 	hash_destroy(acache->htab);
+	hash_destroy(acache->ghost_htab);
 	MemoryContextDelete(acache->mcxt);
 }
 
+/*
+ * The memory used by the buffers of the decompressed arrow array.
+ */
+static size_t
+arrow_array_bytes(const ArrowArray *array, int16 typlen)
+{
+	const size_t padded_rows = pad_to_multiple(64, array->length);
+	size_t bytes = sizeof(ArrowArray);
+
+	if (array->buffers[0] != NULL)
+		bytes += padded_rows / 8;
+
+	if (array->dictionary != NULL)
+	{
+		/* The buffer of int16 indexes into the dictionary. */
+		bytes += sizeof(int16) * padded_rows;
+		bytes += arrow_array_bytes(array->dictionary, typlen);
+	}
+	else if (array->n_buffers == 3)
+	{
+		/* The offsets and the bodies of the variable-length values. */
+		const uint32 *offsets = array->buffers[1];
+		bytes += sizeof(uint32) * (array->length + 1) + offsets[array->length];
+	}
+	else
+	{
+		bytes += typlen * padded_rows;
+	}
+
+	return bytes;
+}
+
 static void
-decompress_one_attr(const ArrowTupleTableSlot *aslot, ArrowColumnCacheEntry *entry,
-					AttrNumber attno, AttrNumber cattno)
+decompress_one_attr(ArrowTupleTableSlot *aslot, ArrowColumnCacheEntry *entry, AttrNumber attno,
+					AttrNumber cattno)
 {
-	const ArrowColumnCache *acache = &aslot->arrow_cache;
+	ArrowColumnCache *acache = &aslot->arrow_cache;
 	const TupleDesc tupdesc = aslot->base.base.tts_tupleDescriptor;
 	const TupleDesc PG_USED_FOR_ASSERTS_ONLY compressed_tupdesc =
 		aslot->compressed_slot->tts_tupleDescriptor;
@@ -131,12 +196,47 @@ decompress_one_attr(const ArrowTupleTableSlot *aslot, ArrowColumnCacheEntry *ent
 		if (!isnull)
 		{
 			const Form_pg_attribute attr = TupleDescAttr(tupdesc, attoff);
-			entry->arrow_arrays[attoff] = arrow_from_compressed(value,
-																attr->atttypid,
-																acache->mcxt,
-																acache->decompression_mcxt);
+			ArrowSharedCacheKey shared_key;
+			const bool use_shared_cache =
+				arrow_shared_cache_enabled() &&
+				arrow_shared_cache_make_key(aslot->compressed_slot, cattno, &shared_key);
+			ArrowArray *array = NULL;
+
+			/*
+			 * Try the cache shared by all backends before decompressing, and
+			 * add the decompressed array there.
+			 */
+			if (use_shared_cache)
+				array = arrow_shared_cache_lookup(&shared_key, attr->atttypid, acache->mcxt);
+
+			if (array != NULL)
+			{
+				DECOMPRESS_CACHE_STATS_INCREMENT(shared_hits);
+			}
+			else
+			{
+				array = arrow_from_compressed(value,
+											  attr->atttypid,
+											  acache->mcxt,
+											  acache->decompression_mcxt);
+				if (use_shared_cache && array != NULL)
+					arrow_shared_cache_insert(&shared_key, array, attr->attlen);
+
+				DECOMPRESS_CACHE_STATS_INCREMENT(decompressions);
+				if (array != NULL)
+					acache->decompressed_rows += array->length;
+			}
 
-			DECOMPRESS_CACHE_STATS_INCREMENT(decompressions);
+			entry->arrow_arrays[attoff] = array;
+
+			if (array != NULL)
+			{
+				const size_t nbytes = arrow_array_bytes(array, attr->attlen);
+				entry->nbytes += nbytes;
+				acache->total_bytes += nbytes;
+				if (!entry->protected)
+					acache->probation_bytes += nbytes;
+			}
 		}
 	}
 }
@@ -163,10 +263,119 @@ arrow_cache_clear_entry(ArrowColumnCacheEntry *restrict entry)
 	entry->arrow_arrays = NULL;
 }
 
+/*
+ * Remember the key of an entry evicted from the probation list. The ghost
+ * list holds about as many keys as the cache holds entries, so we recognize
+ * the entries that are requested again within twice the cache size.
+ */
+static void
+arrow_cache_add_ghost(ArrowColumnCache *acache, const ArrowColumnKey *key)
+{
+	bool found;
+	ArrowColumnGhostEntry *ghost = hash_search(acache->ghost_htab, key, HASH_ENTER, &found);
+
+	if (found)
+	{
+		dlist_move_tail(&acache->ghost_lru, &ghost->node);
+		return;
+	}
+
+	dlist_push_tail(&acache->ghost_lru, &ghost->node);
+	++acache->num_ghosts;
+
+	while (acache->num_ghosts > Max(acache->num_entries, 1))
+	{
+		ArrowColumnGhostEntry *oldest =
+			dlist_container(ArrowColumnGhostEntry, node, dlist_pop_head_node(&acache->ghost_lru));
+		if (!hash_search(acache->ghost_htab, &oldest->key, HASH_REMOVE, NULL))
+			elog(ERROR, "ghost list for compressed rows corrupt");
+		--acache->num_ghosts;
+	}
+}
+
+/*
+ * Check if the key was recently evicted from the probation list, and forget
+ * it if it was.
+ */
+static bool
+arrow_cache_remove_ghost(ArrowColumnCache *acache, const ArrowColumnKey *key)
+{
+	ArrowColumnGhostEntry *ghost = hash_search(acache->ghost_htab, key, HASH_REMOVE, NULL);
+
+	if (ghost == NULL)
+		return false;
+
+	dlist_delete(&ghost->node);
+	--acache->num_ghosts;
+	return true;
+}
+
+static bool
+arrow_cache_probation_over_limit(const ArrowColumnCache *acache)
+{
+	if (acache->num_probation_entries > acache->maxsize / ARROW_CACHE_PROBATION_FRACTION)
+		return true;
+
+	return acache->maxbytes > 0 &&
+		   acache->probation_bytes > acache->maxbytes / ARROW_CACHE_PROBATION_FRACTION;
+}
+
+/*
+ * Evict one entry. The probation entries are evicted first when they use more
+ * than their share of the cache, or when there are no protected entries.
+ */
+static void
+arrow_cache_evict_one(ArrowColumnCache *acache)
+{
+	const bool from_probation = !dlist_is_empty(&acache->probation_lru) &&
+								(dlist_is_empty(&acache->protected_lru) ||
+								 arrow_cache_probation_over_limit(acache));
+	dlist_head *lru = from_probation ? &acache->probation_lru : &acache->protected_lru;
+	ArrowColumnCacheEntry *entry =
+		dlist_container(ArrowColumnCacheEntry, node, dlist_pop_head_node(lru));
+	const ArrowColumnKey key = entry->key;
+
+	Assert(entry->protected != from_probation);
+
+	--acache->num_entries;
+	acache->total_bytes -= entry->nbytes;
+	if (from_probation)
+	{
+		--acache->num_probation_entries;
+		acache->probation_bytes -= entry->nbytes;
+	}
+
+	/*
+	 * Free allocated memory in the entry.
+	 *
+	 * The entry itself is managed by the hash table and might be recycled so
+	 * should not be freed here.
+	 */
+	arrow_cache_clear_entry(entry);
+
+	if (!hash_search(acache->htab, &key, HASH_REMOVE, NULL))
+		elog(ERROR, "LRU cache for compressed rows corrupt");
+
+	if (from_probation)
+		arrow_cache_add_ghost(acache, &key);
+
+	DECOMPRESS_CACHE_STATS_INCREMENT(evictions);
+}
+
+static bool
+arrow_cache_is_full(const ArrowColumnCache *acache)
+{
+	if (acache->num_entries >= acache->maxsize)
+		return true;
+
+	return acache->maxbytes > 0 && acache->total_bytes >= acache->maxbytes;
+}
+
 /*
  * Lookup the Arrow cache entry for the tuple.
  *
- * If the entry does not exist, a new entry is created via LRU eviction.
+ * If the entry does not exist, a new entry is created, evicting the old
+ * entries until the cache is within its limits.
  */
 static ArrowColumnCacheEntry *
 arrow_cache_get_entry_resolve(ArrowColumnCache *acache, const TupleDesc tupdesc,
@@ -177,66 +386,58 @@ arrow_cache_get_entry_resolve(ArrowColumnCache *acache, const TupleDesc tupdesc,
 
 	ArrowColumnCacheEntry *restrict entry = hash_search(acache->htab, &key, HASH_FIND, &found);
 
-	/* If entry was not found, we might have to prune the LRU list before
-	 * allocating a new entry */
-	if (!found)
+	if (found)
 	{
-		DECOMPRESS_CACHE_STATS_INCREMENT(misses);
+		DECOMPRESS_CACHE_STATS_INCREMENT(hits);
+		acache->hits++;
 
-		if (acache->arrow_column_cache_lru_count >= acache->maxsize)
-		{
-			/* If we don't have room in the cache for the new entry, pick the
-			 * least recently used and remove it. */
-			entry = dlist_container(ArrowColumnCacheEntry,
-									node,
-									dlist_pop_head_node(&acache->arrow_column_cache_lru));
-			if (!hash_search(acache->htab, &entry->key, HASH_REMOVE, NULL))
-				elog(ERROR, "LRU cache for compressed rows corrupt");
-			--acache->arrow_column_cache_lru_count;
+		/*
+		 * The repeated requests for a probation entry are usually the rows of
+		 * the same compressed tuple, so they don't say anything about the
+		 * future requests, and the entry is not moved.
+		 */
+		if (entry->protected)
+			dlist_move_tail(&acache->protected_lru, &entry->node);
 
-			/*
-			 * Free allocated memory in the entry.
-			 *
-			 * The entry itself is managed by the hash table and might be
-			 * recycled so should not be freed here.
-			 */
-			arrow_cache_clear_entry(entry);
+		return entry;
+	}
 
-			DECOMPRESS_CACHE_STATS_INCREMENT(evictions);
-		}
+	DECOMPRESS_CACHE_STATS_INCREMENT(misses);
+	acache->misses++;
+
+	/*
+	 * The arrays of the new entry are decompressed after we add it, so we
+	 * can't know its size, and the cache might go over its memory limit until
+	 * the next eviction.
+	 */
+	while (acache->num_entries > 0 && arrow_cache_is_full(acache))
+		arrow_cache_evict_one(acache);
+
+	/* Allocate a new entry in the hash table. */
+	entry = hash_search(acache->htab, &key, HASH_ENTER, &found);
+	Assert(!found);
 
-		/* Allocate a new entry in the hash table. */
-		entry = hash_search(acache->htab, &key, HASH_ENTER, &found);
-		dlist_push_tail(&acache->arrow_column_cache_lru, &entry->node);
-		++acache->arrow_column_cache_lru_count;
-		Assert(!found);
+	entry->protected = arrow_cache_remove_ghost(acache, &key);
+	entry->nbytes = 0;
+	if (entry->protected)
+	{
+		dlist_push_tail(&acache->protected_lru, &entry->node);
 	}
 	else
 	{
-		DECOMPRESS_CACHE_STATS_INCREMENT(hits);
-		dlist_move_tail(&acache->arrow_column_cache_lru, &entry->node);
+		dlist_push_tail(&acache->probation_lru, &entry->node);
+		++acache->num_probation_entries;
 	}
-
-	Assert(entry);
+	++acache->num_entries;
 
 	/*
-	 * Entry might be new so fill in default values.
-	 *
 	 * We allocate space for (pointers to) *all* columns in the tuple
 	 * descriptor but we might not use all.
 	 */
-	if (!found)
-	{
-		entry->num_arrays = tupdesc->natts;
-		entry->arrow_arrays =
-			(ArrowArray **) MemoryContextAllocZero(acache->mcxt,
-												   sizeof(ArrowArray *) * entry->num_arrays);
-	}
-	else
-	{
-		/* Move the entry found to the front of the LRU list */
-		dlist_move_tail(&acache->arrow_column_cache_lru, &entry->node);
-	}
+	entry->num_arrays = tupdesc->natts;
+	entry->arrow_arrays =
+		(ArrowArray **) MemoryContextAllocZero(acache->mcxt,
+											   sizeof(ArrowArray *) * entry->num_arrays);
 
 	return entry;
 }
@@ -46,14 +46,36 @@
 
 #include "compression/arrow_c_data_interface.h"
 
+/*
+ * The cache is bounded both by the number of entries and by the memory used
+ * by the decompressed arrow arrays. The replacement follows 2Q: the new
+ * entries go to the probation list, and only the entries that are requested
+ * again after being evicted from there go to the protected list. We recognize
+ * them by the ghost list of recently evicted keys. This way, a sequential
+ * pass over many compressed tuples cannot evict the ones that are repeatedly
+ * visited, e.g. by an index scan.
+ */
 typedef struct ArrowColumnCache
 {
 	MemoryContext mcxt;
-	MemoryContext decompression_mcxt;	 /* Temporary data during decompression */
-	size_t arrow_column_cache_lru_count; /* Arrow column cache LRU list count */
-	dlist_head arrow_column_cache_lru;	 /* Arrow column cache LRU list */
-	HTAB *htab;							 /* Arrow column cache */
-	size_t maxsize;
+	MemoryContext decompression_mcxt; /* Temporary data during decompression */
+	HTAB *htab;						  /* Arrow column cache */
+	dlist_head probation_lru;		  /* Entries seen once, evicted first */
+	dlist_head protected_lru;		  /* Entries seen again after eviction */
+	size_t num_entries;
+	size_t num_probation_entries;
+	size_t total_bytes;
+	size_t probation_bytes;
+	HTAB *ghost_htab; /* Keys recently evicted from the probation list */
+	dlist_head ghost_lru;
+	size_t num_ghosts;
+	size_t maxsize;	 /* Max number of entries */
+	size_t maxbytes; /* Max bytes of arrow arrays, or 0 for no limit */
+
+	/* Statistics of this cache, for the cumulative compressed scan statistics */
+	uint64 hits;
+	uint64 misses;
+	uint64 decompressed_rows;
 } ArrowColumnCache;
 
 typedef struct ArrowTupleTableSlot ArrowTupleTableSlot;
@@ -6,62 +6,22 @@
 
 #include <postgres.h>
 
+#include <access/htup_details.h>
 #include <commands/defrem.h>
 #include <commands/explain.h>
-#include <tcop/tcopprot.h>
+#include <funcapi.h>
 #include <utils/varlena.h>
 
 #include <compat/compat.h>
 #include "arrow_cache_explain.h"
+#include "import/ts_explain.h"
 
 bool decompress_cache_print = false;
 struct DecompressCacheStats decompress_cache_stats;
+struct DecompressCacheStats decompress_cache_total_stats;
 static ExplainOneQuery_hook_type prev_ExplainOneQuery_hook = NULL;
 static bool ExplainOneQuery_hook_initialized = false;
 
-#if PG17_LT
-/*
- * Copied from backend/commands/explain.c since there is no such function for
- * ExplainOneQuery. Also using the naming convention for other similar
- * functions, such as standard_ExecutorStart, hence the weird case usage.
- */
-static void
-standard_ExplainOneQuery(Query *query, int cursorOptions, IntoClause *into, ExplainState *es,
-						 const char *queryString, ParamListInfo params, QueryEnvironment *queryEnv)
-{
-	PlannedStmt *plan;
-	instr_time planstart, planduration;
-	BufferUsage bufusage_start, bufusage;
-
-	if (es->buffers)
-		bufusage_start = pgBufferUsage;
-	INSTR_TIME_SET_CURRENT(planstart);
-
-	/* plan the query */
-	plan = pg_plan_query(query, queryString, cursorOptions, params);
-
-	INSTR_TIME_SET_CURRENT(planduration);
-	INSTR_TIME_SUBTRACT(planduration, planstart);
-
-	/* calc differences of buffer counters. */
-	if (es->buffers)
-	{
-		memset(&bufusage, 0, sizeof(BufferUsage));
-		BufferUsageAccumDiff(&bufusage, &pgBufferUsage, &bufusage_start);
-	}
-
-	/* run it (if needed) and produce output */
-	ExplainOnePlan(plan,
-				   into,
-				   es,
-				   queryString,
-				   params,
-				   queryEnv,
-				   &planduration,
-				   (es->buffers ? &bufusage : NULL));
-}
-#endif
-
 static inline void
 append_if_positive(StringInfo info, const char *key, long long val)
 {
@@ -76,7 +36,7 @@ explain_decompression(Query *query, int cursorOptions, IntoClause *into, Explain
 	if (prev_ExplainOneQuery_hook)
 		prev_ExplainOneQuery_hook(query, cursorOptions, into, es, queryString, params, queryEnv);
 	else
-		standard_ExplainOneQuery(query, cursorOptions, into, es, queryString, params, queryEnv);
+		ts_standard_ExplainOneQuery(query, cursorOptions, into, es, queryString, params, queryEnv);
 
 	if (decompress_cache_print)
 	{
@@ -84,7 +44,8 @@ explain_decompression(Query *query, int cursorOptions, IntoClause *into, Explain
 										 decompress_cache_stats.decompress_calls > 0;
 		const bool has_cache_data = decompress_cache_stats.hits > 0 ||
 									decompress_cache_stats.misses > 0 ||
-									decompress_cache_stats.evictions > 0;
+									decompress_cache_stats.evictions > 0 ||
+									decompress_cache_stats.shared_hits > 0;
 		if (has_decompress_data || has_cache_data)
 		{
 			if (es->format == EXPLAIN_FORMAT_TEXT)
@@ -95,6 +56,7 @@ explain_decompression(Query *query, int cursorOptions, IntoClause *into, Explain
 				append_if_positive(es->str, "hits", decompress_cache_stats.hits);
 				append_if_positive(es->str, "misses", decompress_cache_stats.misses);
 				append_if_positive(es->str, "evictions", decompress_cache_stats.evictions);
+				append_if_positive(es->str, "shared_hits", decompress_cache_stats.shared_hits);
 				if (has_decompress_data)
 					appendStringInfoString(es->str, ", decompress");
 				append_if_positive(es->str, "count", decompress_cache_stats.decompressions);
@@ -107,6 +69,11 @@ explain_decompression(Query *query, int cursorOptions, IntoClause *into, Explain
 				ExplainPropertyInteger("hits", NULL, decompress_cache_stats.hits, es);
 				ExplainPropertyInteger("misses", NULL, decompress_cache_stats.misses, es);
 				ExplainPropertyInteger("evictions", NULL, decompress_cache_stats.evictions, es);
+				if (decompress_cache_stats.shared_hits > 0)
+					ExplainPropertyInteger("shared_hits",
+										   NULL,
+										   decompress_cache_stats.shared_hits,
+										   es);
 				ExplainCloseGroup("Array Cache", "Arrow Array Cache", true, es);
 
 				ExplainOpenGroup("Array Decompress", "Arrow Array Decompress", true, es);
@@ -132,6 +99,38 @@ tsl_process_explain_def(DefElem *opt)
 	return false; /* Keep this option  */
 }
 
+/*
+ * Return the arrow cache statistics of the current backend, accumulated for
+ * all queries since the backend start.
+ */
+Datum
+tsl_hypercore_arrow_cache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupdesc;
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+						"that cannot accept type record")));
+
+	tupdesc = BlessTupleDesc(tupdesc);
+
+	Datum values[6] = {
+		Int64GetDatum(decompress_cache_total_stats.hits),
+		Int64GetDatum(decompress_cache_total_stats.misses),
+		Int64GetDatum(decompress_cache_total_stats.evictions),
+		Int64GetDatum(decompress_cache_total_stats.shared_hits),
+		Int64GetDatum(decompress_cache_total_stats.decompressions),
+		Int64GetDatum(decompress_cache_total_stats.decompress_calls),
+	};
+	bool nulls[6] = { false };
+
+	Assert(tupdesc->natts == lengthof(values));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 void
 _arrow_cache_explain_init(void)
 {
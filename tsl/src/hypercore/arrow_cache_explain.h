@@ -7,6 +7,7 @@
 
 #include <postgres.h>
 
+#include <fmgr.h>
 #include <nodes/parsenodes.h>
 
 void _arrow_cache_explain_init(void);
@@ -16,6 +17,7 @@ struct DecompressCacheStats
 	size_t hits;
 	size_t misses;
 	size_t evictions;
+	size_t shared_hits; /* Arrays found in the shared cache */
 	size_t decompressions;
 	size_t decompress_calls;
 };
@@ -23,8 +25,16 @@ struct DecompressCacheStats
 extern bool decompress_cache_print;
 extern struct DecompressCacheStats decompress_cache_stats;
 
+/* The statistics accumulated since the backend start, for all queries. */
+extern struct DecompressCacheStats decompress_cache_total_stats;
+
 #define DECOMPRESS_CACHE_STATS_INCREMENT(FIELD)                                                    \
-	if (decompress_cache_print)                                                                    \
-	decompress_cache_stats.FIELD++
+	do                                                                                             \
+	{                                                                                              \
+		decompress_cache_total_stats.FIELD++;                                                      \
+		if (decompress_cache_print)                                                                \
+			decompress_cache_stats.FIELD++;                                                        \
+	} while (0)
 
 extern bool tsl_process_explain_def(DefElem *opt);
+extern Datum tsl_hypercore_arrow_cache_stats(PG_FUNCTION_ARGS);
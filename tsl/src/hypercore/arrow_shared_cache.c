@@ -0,0 +1,332 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Cache of the decompressed arrow arrays shared by all backends.
+ *
+ * It is a second tier below the per-slot arrow cache, so that the backends
+ * reading the same recent compressed tuples don't have to decompress them
+ * separately. The cache lives in a named DSM segment of a fixed size, which
+ * is created by the first backend that uses it, so it does not require
+ * preloading the library. The DSM registry is only available since
+ * PostgreSQL 17, on older versions the shared cache is disabled.
+ *
+ * The segment consists of a set-associative directory of the entries and a
+ * ring buffer that holds the serialized arrays. The new arrays are appended
+ * to the ring buffer, overwriting the oldest ones, so the eviction is FIFO
+ * and requires no bookkeeping: a directory entry is valid while its data is
+ * within the last "data_size" bytes written to the ring. When all the ways of
+ * a directory set are used, the oldest entry of the set is replaced.
+ *
+ * A lookup copies the array from the ring buffer under a shared lock, and an
+ * insert copies it into the ring buffer under an exclusive lock.
+ */
+
+#include <postgres.h>
+
+#include <access/htup_details.h>
+#include <common/hashfn.h>
+#include <storage/lwlock.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/relcache.h>
+
+#include <compat/compat.h>
+#if PG17_GE
+#include <storage/dsm_registry.h>
+#endif
+
+#include "arrow_array.h"
+#include "arrow_shared_cache.h"
+#include "config.h"
+#include "guc.h"
+
+#if PG17_GE
+
+/*
+ * The segment layout changes between the versions, so each version of the
+ * extension uses its own segment.
+ */
+#define ARROW_SHARED_CACHE_NAME "timescaledb arrow cache " TIMESCALEDB_VERSION_MOD
+#define ARROW_SHARED_CACHE_TRANCHE_NAME "timescaledb_arrow_cache"
+
+/* The number of entries in one directory set. */
+#define ARROW_SHARED_CACHE_WAYS 4
+
+/*
+ * The estimated average size of the serialized arrays, which determines the
+ * number of entries in the directory.
+ */
+#define ARROW_SHARED_CACHE_AVG_ENTRY_BYTES 4096
+
+/*
+ * We don't cache the arrays that would take more than this share of the ring
+ * buffer, so that one array can't evict the entire cache.
+ */
+#define ARROW_SHARED_CACHE_MAX_ENTRY_FRACTION 4
+
+typedef struct ArrowSharedCacheEntry
+{
+	ArrowSharedCacheKey key;
+	uint32 len; /* Length of the data, or 0 if the entry is unused */
+	uint64 pos; /* Position of the data in the ring buffer */
+} ArrowSharedCacheEntry;
+
+typedef struct ArrowSharedCache
+{
+	LWLock lock;
+	int tranche_id;
+	uint32 num_sets;
+	Size data_offset; /* Offset of the ring buffer from the start */
+	Size data_size;	  /* Size of the ring buffer */
+	uint64 write_pos; /* Number of bytes written to the ring buffer */
+	ArrowSharedCacheEntry entries[FLEXIBLE_ARRAY_MEMBER];
+} ArrowSharedCache;
+
+static ArrowSharedCache *shared_cache = NULL;
+
+static Size
+arrow_shared_cache_segment_size(void)
+{
+	return (Size) ts_guc_hypercore_shared_arrow_cache_size * 1024;
+}
+
+static void
+arrow_shared_cache_init(void *ptr)
+{
+	ArrowSharedCache *cache = ptr;
+	const Size segment_size = arrow_shared_cache_segment_size();
+	const uint32 num_sets =
+		Max(1, segment_size / (ARROW_SHARED_CACHE_AVG_ENTRY_BYTES * ARROW_SHARED_CACHE_WAYS));
+	const Size directory_size =
+		offsetof(ArrowSharedCache, entries) +
+		sizeof(ArrowSharedCacheEntry) * ARROW_SHARED_CACHE_WAYS * num_sets;
+
+	cache->tranche_id = LWLockNewTrancheId();
+	LWLockInitialize(&cache->lock, cache->tranche_id);
+	cache->num_sets = num_sets;
+	cache->data_offset = MAXALIGN(directory_size);
+	cache->data_size =
+		segment_size > cache->data_offset ? MAXALIGN_DOWN(segment_size - cache->data_offset) : 0;
+	cache->write_pos = 0;
+	memset(cache->entries, 0, sizeof(ArrowSharedCacheEntry) * ARROW_SHARED_CACHE_WAYS * num_sets);
+}
+
+/*
+ * Check if the shared cache is enabled, and attach to it if we haven't yet.
+ */
+bool
+arrow_shared_cache_enabled(void)
+{
+	if (shared_cache != NULL)
+		return true;
+
+	if (ts_guc_hypercore_shared_arrow_cache_size == 0)
+		return false;
+
+	bool found;
+	shared_cache = GetNamedDSMSegment(ARROW_SHARED_CACHE_NAME,
+									  arrow_shared_cache_segment_size(),
+									  arrow_shared_cache_init,
+									  &found);
+	LWLockRegisterTranche(shared_cache->tranche_id, ARROW_SHARED_CACHE_TRANCHE_NAME);
+
+	return true;
+}
+
+bool
+arrow_shared_cache_make_key(TupleTableSlot *compressed_slot, AttrNumber cattno,
+							ArrowSharedCacheKey *key)
+{
+	if (!OidIsValid(compressed_slot->tts_tableOid) ||
+		!ItemPointerIsValid(&compressed_slot->tts_tid))
+		return false;
+
+	/* We need the tuple header for the xmin, see below */
+	if (!TTS_IS_BUFFERTUPLE(compressed_slot) && !TTS_IS_HEAPTUPLE(compressed_slot))
+		return false;
+
+	const HeapTuple tuple = ((HeapTupleTableSlot *) compressed_slot)->tuple;
+	if (tuple == NULL || tuple->t_data == NULL)
+		return false;
+
+	/*
+	 * We look up the relation every time instead of remembering the
+	 * relfilenode, because it changes when the relation is truncated, even
+	 * in the same transaction.
+	 */
+	Relation rel = RelationIdGetRelation(compressed_slot->tts_tableOid);
+	if (!RelationIsValid(rel))
+		return false;
+
+	memset(key, 0, sizeof(*key));
+	key->spcoid = rel->rd_locator.spcOid;
+	key->dboid = rel->rd_locator.dbOid;
+	key->relfilenode = rel->rd_locator.relNumber;
+	RelationClose(rel);
+
+	key->ctid = compressed_slot->tts_tid;
+	key->attno = cattno;
+
+	/*
+	 * Use the raw xmin, which is kept when the tuple is frozen. The xmin
+	 * returned for the system column is FrozenTransactionId for all frozen
+	 * tuples, so a frozen tuple stored at the TID of another frozen tuple
+	 * would get the same key.
+	 */
+	key->xmin = HeapTupleHeaderGetRawXmin(tuple->t_data);
+
+	return true;
+}
+
+static inline ArrowSharedCacheEntry *
+arrow_shared_cache_get_set(const ArrowSharedCacheKey *key)
+{
+	const uint32 hash = hash_bytes((const unsigned char *) key, sizeof(*key));
+	return &shared_cache->entries[(hash % shared_cache->num_sets) * ARROW_SHARED_CACHE_WAYS];
+}
+
+/*
+ * Check if the data of the entry was not yet overwritten in the ring buffer.
+ */
+static inline bool
+arrow_shared_cache_entry_valid(const ArrowSharedCacheEntry *entry)
+{
+	return entry->len > 0 && shared_cache->write_pos - entry->pos <= shared_cache->data_size;
+}
+
+static ArrowSharedCacheEntry *
+arrow_shared_cache_find(const ArrowSharedCacheKey *key)
+{
+	ArrowSharedCacheEntry *set = arrow_shared_cache_get_set(key);
+
+	for (int i = 0; i < ARROW_SHARED_CACHE_WAYS; i++)
+	{
+		ArrowSharedCacheEntry *entry = &set[i];
+		if (arrow_shared_cache_entry_valid(entry) &&
+			memcmp(&entry->key, key, sizeof(*key)) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static inline char *
+arrow_shared_cache_data(uint64 pos)
+{
+	return (char *) shared_cache + shared_cache->data_offset + pos % shared_cache->data_size;
+}
+
+/*
+ * Look up the array in the shared cache, and copy it into the given memory
+ * context if found.
+ */
+ArrowArray *
+arrow_shared_cache_lookup(const ArrowSharedCacheKey *key, Oid typid, MemoryContext mcxt)
+{
+	const bool typbyval = get_typbyval(typid);
+	ArrowArray *array = NULL;
+
+	Assert(shared_cache != NULL);
+
+	LWLockAcquire(&shared_cache->lock, LW_SHARED);
+	const ArrowSharedCacheEntry *entry = arrow_shared_cache_find(key);
+	if (entry != NULL)
+		array = arrow_deserialize(arrow_shared_cache_data(entry->pos), typbyval, mcxt);
+	LWLockRelease(&shared_cache->lock);
+
+	return array;
+}
+
+/*
+ * Add the decompressed array to the shared cache, evicting the oldest data.
+ */
+void
+arrow_shared_cache_insert(const ArrowSharedCacheKey *key, const ArrowArray *array, int16 typlen)
+{
+	Assert(shared_cache != NULL);
+
+	const Size len = arrow_serialized_size(array, typlen);
+	if (len == 0 || len > shared_cache->data_size / ARROW_SHARED_CACHE_MAX_ENTRY_FRACTION)
+		return;
+
+	LWLockAcquire(&shared_cache->lock, LW_EXCLUSIVE);
+
+	/* Another backend might have added it while we were decompressing. */
+	if (arrow_shared_cache_find(key) != NULL)
+	{
+		LWLockRelease(&shared_cache->lock);
+		return;
+	}
+
+	/*
+	 * The data is stored contiguously, so if it doesn't fit before the end of
+	 * the ring buffer, we skip to the start.
+	 */
+	const Size offset = shared_cache->write_pos % shared_cache->data_size;
+	if (offset + len > shared_cache->data_size)
+		shared_cache->write_pos += shared_cache->data_size - offset;
+
+	const uint64 pos = shared_cache->write_pos;
+	shared_cache->write_pos += len;
+
+	/*
+	 * Use an unused or overwritten entry of the set, or replace the oldest
+	 * one. Check the validity after advancing the write position, because
+	 * the new data might have overwritten the data of some entries.
+	 */
+	ArrowSharedCacheEntry *set = arrow_shared_cache_get_set(key);
+	ArrowSharedCacheEntry *victim = &set[0];
+	for (int i = 0; i < ARROW_SHARED_CACHE_WAYS; i++)
+	{
+		ArrowSharedCacheEntry *entry = &set[i];
+
+		if (!arrow_shared_cache_entry_valid(entry))
+		{
+			victim = entry;
+			break;
+		}
+
+		if (entry->pos < victim->pos)
+			victim = entry;
+	}
+
+	victim->key = *key;
+	victim->pos = pos;
+	victim->len = len;
+	arrow_serialize(array, typlen, arrow_shared_cache_data(pos));
+
+	LWLockRelease(&shared_cache->lock);
+}
+
+#else
+
+bool
+arrow_shared_cache_enabled(void)
+{
+	return false;
+}
+
+bool
+arrow_shared_cache_make_key(TupleTableSlot *compressed_slot, AttrNumber cattno,
+							ArrowSharedCacheKey *key)
+{
+	return false;
+}
+
+ArrowArray *
+arrow_shared_cache_lookup(const ArrowSharedCacheKey *key, Oid typid, MemoryContext mcxt)
+{
+	pg_unreachable();
+}
+
+void
+arrow_shared_cache_insert(const ArrowSharedCacheKey *key, const ArrowArray *array, int16 typlen)
+{
+	pg_unreachable();
+}
+
+#endif
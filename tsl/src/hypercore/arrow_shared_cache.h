@@ -0,0 +1,42 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+
+#include <access/attnum.h>
+#include <executor/tuptable.h>
+
+#include "compression/arrow_c_data_interface.h"
+
+/*
+ * Key of a decompressed column in the shared arrow cache.
+ *
+ * An update of a compressed tuple, like the in-place update of the segmentby
+ * columns, creates a new tuple version at a new TID. A TID is only reused
+ * for a new tuple after the old one is vacuumed, so the raw xmin of the
+ * compressed tuple, which is kept when the tuple is frozen, tells apart the
+ * tuples stored at the same TID. The relfilenode tells apart the tuples after
+ * the relation is rewritten. This way, the stale entries are never found and
+ * we don't need any explicit invalidation.
+ */
+typedef struct ArrowSharedCacheKey
+{
+	Oid spcoid;
+	Oid dboid;
+	Oid relfilenode;	  /* Compressed relation */
+	ItemPointerData ctid; /* Compressed tuple */
+	AttrNumber attno;	  /* Column in the compressed relation */
+	TransactionId xmin;	  /* Version of the compressed tuple */
+} ArrowSharedCacheKey;
+
+extern bool arrow_shared_cache_enabled(void);
+extern bool arrow_shared_cache_make_key(TupleTableSlot *compressed_slot, AttrNumber cattno,
+										ArrowSharedCacheKey *key);
+extern ArrowArray *arrow_shared_cache_lookup(const ArrowSharedCacheKey *key, Oid typid,
+											 MemoryContext mcxt);
+extern void arrow_shared_cache_insert(const ArrowSharedCacheKey *key, const ArrowArray *array,
+									  int16 typlen);
@@ -845,13 +845,14 @@ arrow_slot_set_referenced_attrs(TupleTableSlot *slot, Bitmapset *attrs)
 }
 
 void
-arrow_slot_set_index_attrs(TupleTableSlot *slot, Bitmapset *attrs)
+arrow_slot_set_index_attrs(TupleTableSlot *slot, Bitmapset *attrs, bool is_sparse)
 {
 	Assert(TTS_IS_ARROWTUPLE(slot));
 
 	ArrowTupleTableSlot *aslot = (ArrowTupleTableSlot *) slot;
 	MemoryContext oldmcxt = MemoryContextSwitchTo(aslot->arrow_cache.mcxt);
 	aslot->index_attrs = bms_copy(attrs);
+	aslot->index_is_sparse = is_sparse;
 	MemoryContextSwitchTo(oldmcxt);
 }
 
@@ -77,6 +77,7 @@ typedef struct ArrowTupleTableSlot
 	bool *segmentby_attrs;
 	bool *valid_attrs;		 /* Per-column validity up to "tts_nvalid" */
 	Bitmapset *index_attrs;	 /* Columns in index during index scan */
+	bool index_is_sparse;	 /* Index scan uses a hypercore_sparse index */
 	int16 *attrs_offset_map; /* Offset number mappings between the
 							  * non-compressed and compressed
 							  * relation */
@@ -140,6 +141,12 @@ extern TupleTableSlot *ExecStoreArrowTuple(TupleTableSlot *slot, uint16 tuple_in
 #define OFFSET_LIMIT ((uint64) 1UL << OFFSET_BITS)
 #define OFFSET_MASK (OFFSET_LIMIT - 1)
 
+/*
+ * The max number of rows in a compressed tuple of a hypercore. The tuple
+ * index starts at MinTupleIndex and has to fit into the TINDEX bits.
+ */
+#define MaxHypercoreBatchRows ((int) OFFSET_LIMIT - MinTupleIndex)
+
 static inline void
 hypercore_tid_encode(ItemPointerData *out_tid, const ItemPointerData *in_tid, uint16 tuple_index)
 {
@@ -179,7 +186,7 @@ static inline void
 hypercore_tid_set_tuple_index(ItemPointerData *tid, uint32 tuple_index)
 {
 	/* Assert that we do not overflow the increment: we only have 10 bits for the tuple index */
-	Assert(tuple_index < 1024);
+	Assert(tuple_index <= MaxHypercoreBatchRows);
 	ItemPointerSetOffsetNumber(tid, tuple_index);
 }
 
@@ -422,6 +429,6 @@ extern const ArrowArray *arrow_slot_get_array(TupleTableSlot *slot, AttrNumber a
 
 extern bool is_compressed_col(const TupleDesc tupdesc, AttrNumber attno);
 extern void arrow_slot_set_referenced_attrs(TupleTableSlot *slot, Bitmapset *attrs);
-extern void arrow_slot_set_index_attrs(TupleTableSlot *slot, Bitmapset *attrs);
+extern void arrow_slot_set_index_attrs(TupleTableSlot *slot, Bitmapset *attrs, bool is_sparse);
 
 extern Datum tsl_is_compressed_tid(PG_FUNCTION_ARGS);
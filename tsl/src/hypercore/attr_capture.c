@@ -18,6 +18,7 @@
 
 #include "arrow_tts.h"
 #include "attr_capture.h"
+#include "hypercore_sparse.h"
 #include <utils.h>
 
 struct CaptureAttributesContext
@@ -105,7 +106,8 @@ collect_targets(List *targetlist, struct CaptureAttributesContext *context)
  * indexes compressed segments/tuples). When a segmentby index is identified
  * by hypercore, it will "unwrap" the compressed tuples on-the-fly into
  * individual (uncompressed) tuples even though the index only references the
- * compressed segments.
+ * compressed segments. The same is done for sparse indexes, which are
+ * captured together with the attributes.
  */
 static void
 capture_index_attributes(ScanState *state, Relation indexrel)
@@ -126,7 +128,9 @@ capture_index_attributes(ScanState *state, Relation indexrel)
 		attrs = bms_add_member(attrs, attno);
 	}
 
-	arrow_slot_set_index_attrs(state->ss_ScanTupleSlot, attrs);
+	arrow_slot_set_index_attrs(state->ss_ScanTupleSlot,
+							   attrs,
+							   hypercore_sparse_index_is_sparse(indexrel));
 }
 
 static void
@@ -5,6 +5,7 @@
  */
 #include <postgres.h>
 #include <access/attnum.h>
+#include <access/genam.h>
 #include <access/heapam.h>
 #include <access/hio.h>
 #include <access/htup_details.h>
@@ -15,6 +16,7 @@
 #include <access/stratnum.h>
 #include <access/tableam.h>
 #include <access/transam.h>
+#include <access/visibilitymap.h>
 #include <access/xact.h>
 #include <catalog/heap.h>
 #include <catalog/index.h>
@@ -53,6 +55,7 @@
 #include <utils/rel.h>
 #include <utils/sampling.h>
 #include <utils/snapmgr.h>
+#include <utils/sortsupport.h>
 #include <utils/syscache.h>
 #include <utils/tuplesort.h>
 #include <utils/typcache.h>
@@ -69,10 +72,12 @@
 #include "extension.h"
 #include "guc.h"
 #include "hypercore_handler.h"
+#include "hypercore_sparse.h"
 #include "relstats.h"
 #include "trigger.h"
 #include "ts_catalog/array_utils.h"
 #include "ts_catalog/catalog.h"
+#include "ts_catalog/chunk_column_stats.h"
 #include "ts_catalog/compression_chunk_size.h"
 #include "ts_catalog/compression_settings.h"
 
@@ -85,6 +90,9 @@ static void convert_to_hypercore_finish(Oid relid);
 static List *partially_compressed_relids = NIL; /* Relids that needs to have
 												 * updated status set at end of
 												 * transaction */
+static List *directly_compressed_relids = NIL;	/* Relids that got compressed
+												 * tuples from inserts */
+static struct ConversionState *conversionstate; /* See ConversionState */
 /*
  * For COPY <hypercore_rel> TO commands, track the relid of the hypercore
  * being copied from. It is needed to filter out compressed data in the COPY
@@ -122,6 +130,30 @@ hypercore_set_truncate_compressed(bool onoff)
 	return old_value;
 }
 
+/*
+ * Get the max number of rows per compressed batch when compressing data of
+ * a hypercore.
+ *
+ * The rows of a compressed tuple are addressed by the tuple index of the
+ * encoded TIDs, which fits only MaxHypercoreBatchRows rows, so larger
+ * settings of the batch size limit cannot be used with hypercore.
+ */
+int
+hypercore_batch_size_limit(void)
+{
+	if (ts_guc_compression_batch_size_limit > MaxHypercoreBatchRows)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("compression batch size limit %d is too large for hypercore",
+						ts_guc_compression_batch_size_limit),
+				 errdetail("Hypercore can address at most %d rows per compressed batch.",
+						   MaxHypercoreBatchRows),
+				 errhint("Set timescaledb.compression_batch_size_limit to %d or less.",
+						 MaxHypercoreBatchRows)));
+
+	return ts_guc_compression_batch_size_limit;
+}
+
 #define HYPERCORE_AM_INFO_SIZE(natts)                                                              \
 	(sizeof(HypercoreInfo) + (sizeof(ColumnCompressionSettings) * (natts)))
 
@@ -363,6 +395,25 @@ hypercore_slot_callbacks(Relation relation)
 
 #define pgstat_count_hypercore_getnext(rel) pgstat_count_heap_getnext(rel)
 
+/*
+ * Shared state of a parallel scan of a hypercore.
+ *
+ * The compressed and the non-compressed relation have separate parallel
+ * block scans, so the participants split the compressed relation by its own
+ * blocks, independently of the size of the non-compressed relation. Every
+ * participant first takes blocks from the compressed relation and then
+ * continues with the non-compressed one, so the participants that finish the
+ * decompression work early pick up the non-compressed blocks, and all of them
+ * finish at about the same time.
+ *
+ * The compressed relations are small in blocks, since most of the compressed
+ * data is in TOAST, and heap hands out their blocks one at a time unless the
+ * relation has thousands of blocks, and ramps down to one block at a time at
+ * the end of the scan. So a block of compressed tuples is the unit of work,
+ * which is about as fine as we can get without reading the tuples. We can't
+ * weight the blocks by their "_ts_meta_count", since that would require
+ * reading them before handing them out.
+ */
 typedef struct HypercoreParallelScanDescData
 {
 	ParallelBlockTableScanDescData pscandesc;
@@ -397,10 +448,15 @@ typedef struct HypercoreScanDescData
 	HypercoreScanState hs_scan_state;
 	bool reset;
 	bool skip_compressed; /* Skip compressed data when scanning */
+	/* Fraction of the rows in compressed tuples that ANALYZE samples, or 0 if
+	 * not yet known */
+	double analyze_row_fraction;
 #if PG17_GE
 	/* These fields are only used for ANALYZE */
 	ReadStream *canalyze_read_stream;
 	ReadStream *uanalyze_read_stream;
+	BlockNumber canalyze_nblocks; /* Sampled blocks of compressed relation */
+	int analyze_targrows;
 #endif
 } HypercoreScanDescData;
 
@@ -997,11 +1053,243 @@ hypercore_get_latest_tid(TableScanDesc sscan, ItemPointer tid)
 	}
 }
 
+/*
+ * Check if the index only has segmentby columns.
+ *
+ * The indexes on segmentby columns store only one reference per compressed
+ * tuple, see convert_index_only_scans().
+ */
+static bool
+index_is_segmentby_index(const HypercoreInfo *hsinfo, Oid indexrelid)
+{
+	Relation irel = index_open(indexrelid, AccessShareLock);
+	const int2vector *indkeys = &irel->rd_index->indkey;
+	bool is_segmentby_index = true;
+
+	for (int i = 0; i < indkeys->dim1; i++)
+	{
+		const AttrNumber attno = indkeys->values[i];
+
+		if (attno == InvalidAttrNumber ||
+			!hsinfo->columns[AttrNumberGetAttrOffset(attno)].is_segmentby)
+		{
+			is_segmentby_index = false;
+			break;
+		}
+	}
+
+	index_close(irel, AccessShareLock);
+	return is_segmentby_index;
+}
+
+/*
+ * Check if the index is a sparse index, which also stores only one reference
+ * per compressed tuple.
+ */
+static bool
+index_is_sparse_index(Oid indexrelid)
+{
+	Relation irel = index_open(indexrelid, AccessShareLock);
+	const bool is_sparse_index = hypercore_sparse_index_is_sparse(irel);
+
+	index_close(irel, AccessShareLock);
+	return is_sparse_index;
+}
+
+/*
+ * The rows per batch when compressing a multi-insert.
+ *
+ * Unlike explicit compression, this is only an optimization, so a batch
+ * size limit larger than hypercore supports is capped instead of raising an
+ * error.
+ */
+static int
+multi_insert_batch_rows(void)
+{
+	return Min(ts_guc_compression_batch_size_limit, MaxHypercoreBatchRows);
+}
+
+/*
+ * Check if the rows of a multi-insert can be written directly as compressed
+ * tuples instead of going to the non-compressed relation.
+ *
+ * This is the case when the rows are in the compression order and each
+ * segment in them has enough rows to fill a batch. Otherwise, we would either
+ * have to sort the rows, or create small batches, which are better
+ * recompressed later together with the other rows of the segment.
+ *
+ * The executor inserts index tuples for every row using the TID of the row,
+ * so the encoded TIDs of the rows in the compressed tuples work for all
+ * indexes, except the segmentby and sparse indexes that need only one
+ * reference per compressed tuple. If there are any of these, the rows go to
+ * the non-compressed relation.
+ */
+static bool
+multi_insert_can_compress(Relation relation, const CompressionSettings *settings,
+						  TupleTableSlot **slots, int ntuples)
+{
+	const int batch_rows = multi_insert_batch_rows();
+	const HypercoreInfo *hsinfo = RelationGetHypercoreInfo(relation);
+	List *indexlist = RelationGetIndexList(relation);
+	ListCell *lc;
+
+	foreach (lc, indexlist)
+	{
+		if (index_is_segmentby_index(hsinfo, lfirst_oid(lc)) ||
+			index_is_sparse_index(lfirst_oid(lc)))
+			return false;
+	}
+
+	AttrNumber *sort_keys;
+	Oid *sort_operators;
+	Oid *sort_collations;
+	bool *nulls_first;
+	const int num_segmentby = ts_array_length(settings->fd.segmentby);
+	const int n_keys = compression_get_sort_keys((CompressionSettings *) settings,
+												 relation,
+												 &sort_keys,
+												 &sort_operators,
+												 &sort_collations,
+												 &nulls_first);
+	SortSupport sortkeys = palloc0(sizeof(SortSupportData) * n_keys);
+
+	for (int i = 0; i < n_keys; i++)
+	{
+		SortSupport ssup = &sortkeys[i];
+
+		ssup->ssup_cxt = CurrentMemoryContext;
+		ssup->ssup_collation = sort_collations[i];
+		ssup->ssup_nulls_first = nulls_first[i];
+		ssup->ssup_attno = sort_keys[i];
+		PrepareSortSupportFromOrderingOp(sort_operators[i], ssup);
+	}
+
+	/* Check the order of the rows and the number of rows in each segment. */
+	int segment_rows = 1;
+
+	for (int row = 1; row < ntuples; row++)
+	{
+		for (int i = 0; i < n_keys; i++)
+		{
+			SortSupport ssup = &sortkeys[i];
+			bool isnull_prev, isnull_curr;
+			Datum prev = slot_getattr(slots[row - 1], ssup->ssup_attno, &isnull_prev);
+			Datum curr = slot_getattr(slots[row], ssup->ssup_attno, &isnull_curr);
+			const int cmp = ApplySortComparator(prev, isnull_prev, curr, isnull_curr, ssup);
+
+			if (cmp > 0)
+				return false;
+
+			if (cmp < 0)
+			{
+				if (i < num_segmentby)
+				{
+					if (segment_rows < batch_rows)
+						return false;
+					segment_rows = 0;
+				}
+				break;
+			}
+		}
+
+		segment_rows++;
+	}
+
+	return segment_rows >= batch_rows;
+}
+
+/*
+ * State for writing the rows of a multi-insert directly as compressed
+ * tuples. The row compressor must be the first member, so that the flush
+ * callback can get to the rest of the state.
+ */
+typedef struct MultiInsertCompressState
+{
+	RowCompressor row_compressor;
+	TupleTableSlot **slots;
+	Oid relid;
+	int next_slot;
+} MultiInsertCompressState;
+
+/*
+ * Give the rows of the flushed batch their TIDs in the compressed tuple,
+ * which the executor uses to insert index tuples for them.
+ */
+static void
+on_multi_insert_flush(RowCompressor *rowcompress, uint64 ntuples)
+{
+	MultiInsertCompressState *state = (MultiInsertCompressState *) rowcompress;
+
+	for (uint64 i = 0; i < ntuples; i++)
+	{
+		TupleTableSlot *slot = state->slots[state->next_slot++];
+
+		hypercore_tid_encode(&slot->tts_tid, &rowcompress->flushed_tid, i + 1);
+		slot->tts_tableOid = state->relid;
+	}
+}
+
+static void
+multi_insert_compressed(Relation relation, const CompressionSettings *settings,
+						TupleTableSlot **slots, int ntuples, CommandId cid)
+{
+	const HypercoreInfo *hsinfo = RelationGetHypercoreInfo(relation);
+	Relation crel = table_open(hsinfo->compressed_relid, RowExclusiveLock);
+	MultiInsertCompressState state = {
+		.slots = slots,
+		.relid = RelationGetRelid(relation),
+		.next_slot = 0,
+	};
+
+	row_compressor_init(settings,
+						&state.row_compressor,
+						relation,
+						crel,
+						RelationGetDescr(crel)->natts,
+						true /*need_bistate*/,
+						0 /*insert_options*/);
+	state.row_compressor.max_batch_rows = multi_insert_batch_rows();
+	state.row_compressor.on_flush = on_multi_insert_flush;
+
+	for (int i = 0; i < ntuples; i++)
+		row_compressor_append_ordered_slot(&state.row_compressor, slots[i], cid);
+
+	row_compressor_finish(&state.row_compressor, cid);
+	Assert(state.next_slot == ntuples);
+	row_compressor_close(&state.row_compressor);
+	table_close(crel, NoLock);
+
+	MemoryContext oldmcxt = MemoryContextSwitchTo(CurTransactionContext);
+	directly_compressed_relids =
+		list_append_unique_oid(directly_compressed_relids, RelationGetRelid(relation));
+	MemoryContextSwitchTo(oldmcxt);
+}
+
+/*
+ * Insert multiple rows, e.g., for COPY.
+ *
+ * Large batches of rows that are already in the compression order, which is
+ * typical for backfilling historical data, are compressed right away and
+ * written into the compressed relation. This way, the data doesn't have to
+ * be written to the non-compressed relation first and then rewritten by
+ * recompression. All other rows go to the non-compressed relation.
+ */
 static void
 hypercore_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples, CommandId cid,
 					   int options, BulkInsertStateData *bistate)
 {
-	/* Inserts only supported in non-compressed relation, so simply forward to the heap AM */
+	if (conversionstate == NULL && ntuples >= multi_insert_batch_rows())
+	{
+		const CompressionSettings *settings =
+			ts_compression_settings_get(RelationGetRelid(relation));
+
+		if (settings != NULL && multi_insert_can_compress(relation, settings, slots, ntuples))
+		{
+			multi_insert_compressed(relation, settings, slots, ntuples, cid);
+			return;
+		}
+	}
+
 	const TableAmRoutine *oldtam = switch_to_heapam(relation);
 	relation->rd_tableam->multi_insert(relation, slots, ntuples, cid, options, bistate);
 	relation->rd_tableam = oldtam;
@@ -1019,6 +1307,18 @@ enum SegmentbyIndexStatus
 	SEGMENTBY_INDEX_TRUE = 1,
 };
 
+/*
+ * Number of the recently fetched compressed tuples that an index scan keeps,
+ * see IndexFetchComprData.
+ */
+#define COMPRESSED_FETCH_WINDOW_SIZE 8
+
+typedef struct CompressedFetchWindowEntry
+{
+	ItemPointerData tid; /* TID in the compressed relation */
+	HeapTuple tuple;	 /* Copy of the compressed tuple, or NULL if unused */
+} CompressedFetchWindowEntry;
+
 typedef struct IndexFetchComprData
 {
 	IndexFetchTableData h_base; /* AM independent part of the descriptor */
@@ -1032,6 +1332,21 @@ typedef struct IndexFetchComprData
 	bool call_again;		  /* Used to remember the previous value of call_again in
 							   * index_fetch_tuple */
 	bool internal_call_again; /* Call again passed on to compressed heap */
+
+	/*
+	 * Window of the recently fetched compressed tuples. An index scan on a
+	 * non-segmentby column often jumps between the same few compressed
+	 * tuples, e.g., when the rows of several segments are returned in time
+	 * order. With an MVCC snapshot, the visibility of these tuples does not
+	 * change during the scan, so we can return them from the window instead
+	 * of fetching them again from the compressed relation, and the arrow
+	 * cache then finds their decompressed data.
+	 */
+	MemoryContext window_mcxt;
+	CompressedFetchWindowEntry window[COMPRESSED_FETCH_WINDOW_SIZE];
+	int window_next; /* Next entry to replace */
+	Snapshot window_snapshot;
+	CommandId window_curcid;
 } IndexFetchComprData;
 
 /* ------------------------------------------------------------------------
@@ -1050,6 +1365,9 @@ hypercore_index_fetch_begin(Relation rel)
 	cscan->h_base.rel = rel;
 	cscan->compr_rel = crel;
 	cscan->compr_hscan = crel->rd_tableam->index_fetch_begin(crel);
+	cscan->window_mcxt = AllocSetContextCreate(CurrentMemoryContext,
+											   "compressed fetch window",
+											   ALLOCSET_DEFAULT_SIZES);
 
 	const TableAmRoutine *oldtam = switch_to_heapam(rel);
 	cscan->uncompr_hscan = rel->rd_tableam->index_fetch_begin(rel);
@@ -1060,6 +1378,78 @@ hypercore_index_fetch_begin(Relation rel)
 	return &cscan->h_base;
 }
 
+static void
+compressed_fetch_window_reset(IndexFetchComprData *cscan)
+{
+	MemoryContextReset(cscan->window_mcxt);
+	memset(cscan->window, 0, sizeof(cscan->window));
+	cscan->window_next = 0;
+	cscan->window_snapshot = NULL;
+}
+
+/*
+ * Check if the window can be used with the snapshot of this fetch, and reset
+ * it if the snapshot changed.
+ */
+static bool
+compressed_fetch_window_usable(IndexFetchComprData *cscan, Snapshot snapshot)
+{
+	if (!IsMVCCSnapshot(snapshot))
+		return false;
+
+	if (cscan->window_snapshot != snapshot || cscan->window_curcid != snapshot->curcid)
+	{
+		compressed_fetch_window_reset(cscan);
+		cscan->window_snapshot = snapshot;
+		cscan->window_curcid = snapshot->curcid;
+	}
+
+	return true;
+}
+
+/*
+ * Store the compressed tuple with the given TID into the slot if it is in the
+ * window.
+ */
+static bool
+compressed_fetch_window_lookup(IndexFetchComprData *cscan, ItemPointer tid, TupleTableSlot *slot)
+{
+	for (int i = 0; i < COMPRESSED_FETCH_WINDOW_SIZE; i++)
+	{
+		const CompressedFetchWindowEntry *entry = &cscan->window[i];
+
+		if (entry->tuple != NULL && ItemPointerEquals(&entry->tid, tid))
+		{
+			ExecForceStoreHeapTuple(entry->tuple, slot, false);
+			slot->tts_tid = *tid;
+			slot->tts_tableOid = RelationGetRelid(cscan->compr_rel);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Remember the compressed tuple just fetched into the slot, replacing the
+ * oldest one.
+ */
+static void
+compressed_fetch_window_add(IndexFetchComprData *cscan, ItemPointer tid, TupleTableSlot *slot)
+{
+	CompressedFetchWindowEntry *entry = &cscan->window[cscan->window_next];
+	MemoryContext oldmcxt = MemoryContextSwitchTo(cscan->window_mcxt);
+
+	if (entry->tuple != NULL)
+		heap_freetuple(entry->tuple);
+
+	entry->tuple = ExecCopySlotHeapTuple(slot);
+	entry->tid = *tid;
+	cscan->window_next = (cscan->window_next + 1) % COMPRESSED_FETCH_WINDOW_SIZE;
+
+	MemoryContextSwitchTo(oldmcxt);
+}
+
 static void
 hypercore_index_fetch_reset(IndexFetchTableData *scan)
 {
@@ -1070,6 +1460,7 @@ hypercore_index_fetch_reset(IndexFetchTableData *scan)
 	 * used for the index scan when resetting the scan, but we need to reset
 	 * the tid since we are restarting an index scan. */
 	ItemPointerSetInvalid(&cscan->tid);
+	compressed_fetch_window_reset(cscan);
 
 	cscan->compr_rel->rd_tableam->index_fetch_reset(cscan->compr_hscan);
 
@@ -1087,6 +1478,7 @@ hypercore_index_fetch_end(IndexFetchTableData *scan)
 	Relation crel = cscan->compr_rel;
 	crel->rd_tableam->index_fetch_end(cscan->compr_hscan);
 	table_close(crel, AccessShareLock);
+	MemoryContextDelete(cscan->window_mcxt);
 
 	const TableAmRoutine *oldtam = switch_to_heapam(rel);
 	rel->rd_tableam->index_fetch_end(cscan->uncompr_hscan);
@@ -1104,6 +1496,9 @@ hypercore_index_fetch_end(IndexFetchTableData *scan)
  * of the scan (using the executor start hook) and stored in the
  * ArrowTupleTableSlot.
  *
+ * Scans on sparse indexes are handled as segmentby index scans since the
+ * sparse indexes also have only one TID per compressed tuple.
+ *
  * For EXPLAINs (without ANALYZE), the index attributes in the slot might not
  * be set because the index is never really opened. For such a case, when
  * nothing is actually scanned, it is OK to return "false" even though the
@@ -1124,6 +1519,8 @@ is_segmentby_index_scan(IndexFetchComprData *cscan, TupleTableSlot *slot)
 
 		if (bms_is_empty(aslot->index_attrs))
 			segindex = SEGMENTBY_INDEX_FALSE;
+		else if (aslot->index_is_sparse)
+			segindex = SEGMENTBY_INDEX_TRUE;
 		else
 		{
 			/* True unless we discover that there is one attribute in the index
@@ -1153,11 +1550,12 @@ is_segmentby_index_scan(IndexFetchComprData *cscan, TupleTableSlot *slot)
  * The TID points to a tuple either in the regular (non-compressed) or the
  * compressed relation. The data is fetched from the identified relation.
  *
- * If the index only indexes segmentby column(s), the index is itself
- * "compressed" and there is only one TID per compressed segment/tuple. In
- * that case, the "call_again" parameter is used to make sure the index scan
- * calls this function until all the rows in a compressed tuple is
- * returned. This "unwrapping" only happens in the case of segmentby indexes.
+ * If the index only indexes segmentby column(s), or is a sparse index, the
+ * index is itself "compressed" and there is only one TID per compressed
+ * segment/tuple. In that case, the "call_again" parameter is used to make
+ * sure the index scan calls this function until all the rows in a compressed
+ * tuple is returned. This "unwrapping" only happens in the case of segmentby
+ * and sparse indexes.
  */
 static bool
 hypercore_index_fetch_tuple(struct IndexFetchTableData *scan, ItemPointer tid, Snapshot snapshot,
@@ -1226,9 +1624,9 @@ hypercore_index_fetch_tuple(struct IndexFetchTableData *scan, ItemPointer tid, S
 	 * decompressing the same compressed tuple multiple times. This happens,
 	 * for example, when there's a segmentby column and orderby on
 	 * time. Returning data in time order requires interleaving rows from two
-	 * or more compressed tuples with different segmenby values. It is
-	 * possible to optimize that case further by retaining a window/cache of
-	 * decompressed tuples, keyed on TID.
+	 * or more compressed tuples with different segmenby values. For that
+	 * case, we retain a window of the recently fetched compressed tuples
+	 * below, and the arrow cache retains their decompressed data.
 	 */
 	if (!TTS_EMPTY(child_slot) && !TTS_EMPTY(slot) && ItemPointerIsValid(&cscan->tid) &&
 		ItemPointerEquals(&cscan->tid, &decoded_tid))
@@ -1241,12 +1639,29 @@ hypercore_index_fetch_tuple(struct IndexFetchTableData *scan, ItemPointer tid, S
 		return true;
 	}
 
-	bool result = crel->rd_tableam->index_fetch_tuple(cscan->compr_hscan,
-													  &decoded_tid,
-													  snapshot,
-													  child_slot,
-													  &cscan->internal_call_again,
-													  all_dead);
+	const bool use_window = !is_segmentby_index && compressed_fetch_window_usable(cscan, snapshot);
+	bool result;
+
+	if (use_window && compressed_fetch_window_lookup(cscan, &decoded_tid, child_slot))
+	{
+		/* With an MVCC snapshot, the heap never asks to call again. */
+		cscan->internal_call_again = false;
+		if (all_dead)
+			*all_dead = false;
+		result = true;
+	}
+	else
+	{
+		result = crel->rd_tableam->index_fetch_tuple(cscan->compr_hscan,
+													 &decoded_tid,
+													 snapshot,
+													 child_slot,
+													 &cscan->internal_call_again,
+													 all_dead);
+
+		if (result && use_window)
+			compressed_fetch_window_add(cscan, &decoded_tid, child_slot);
+	}
 
 	if (result)
 	{
@@ -2140,6 +2555,50 @@ on_compression_progress(RowCompressor *rowcompress, uint64 ntuples)
 	pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_TUPLES_WRITTEN, ntuples);
 }
 
+/*
+ * Mark all pages of a relation as all-visible and all-frozen in the
+ * visibility map.
+ *
+ * This is only valid for a relation that was created in the current
+ * transaction and filled with frozen tuples, like the new compressed
+ * relation in compress_and_swap_heap(). Vacuum skips the all-frozen pages,
+ * so it doesn't read the compressed data again until it is modified.
+ */
+static void
+relation_set_all_frozen(Relation rel)
+{
+	const BlockNumber nblocks = RelationGetNumberOfBlocks(rel);
+	Buffer vmbuffer = InvalidBuffer;
+
+	for (BlockNumber blkno = 0; blkno < nblocks; blkno++)
+	{
+		Buffer buffer = ReadBuffer(rel, blkno);
+		Page page;
+
+		visibilitymap_pin(rel, blkno, &vmbuffer);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		if (!PageIsNew(page) && !PageIsAllVisible(page))
+		{
+			PageSetAllVisible(page);
+			MarkBufferDirty(buffer);
+			visibilitymap_set(rel,
+							  blkno,
+							  buffer,
+							  InvalidXLogRecPtr,
+							  vmbuffer,
+							  InvalidTransactionId,
+							  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+		}
+
+		UnlockReleaseBuffer(buffer);
+	}
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+}
+
 /*
  * Rewrite a relation and compress at the same time.
  *
@@ -2181,12 +2640,25 @@ compress_and_swap_heap(Relation rel, Tuplesortstate *tuplesort, TransactionId *x
 						true /*need_bistate*/,
 						HEAP_INSERT_FROZEN);
 
+	row_compressor.max_batch_rows = hypercore_batch_size_limit();
 	row_compressor.on_flush = on_compression_progress;
 	row_compressor_append_sorted_rows(&row_compressor, tuplesort, tupdesc, old_compressed_rel);
 	reltuples = row_compressor.num_compressed_rows;
 	relpages = RelationGetNumberOfBlocks(new_compressed_rel);
 	row_compressor_close(&row_compressor);
 
+	/* The compressed tuples, and their TOAST values, are inserted frozen into
+	 * the new relations, so the pages can be marked frozen right away. */
+	relation_set_all_frozen(new_compressed_rel);
+
+	if (OidIsValid(new_compressed_rel->rd_rel->reltoastrelid))
+	{
+		Relation toastrel =
+			table_open(new_compressed_rel->rd_rel->reltoastrelid, AccessExclusiveLock);
+		relation_set_all_frozen(toastrel);
+		table_close(toastrel, NoLock);
+	}
+
 	table_close(new_compressed_rel, NoLock);
 	table_close(old_compressed_rel, NoLock);
 
@@ -2206,6 +2678,7 @@ compress_and_swap_heap(Relation rel, Tuplesortstate *tuplesort, TransactionId *x
 
 	relform->relpages = relpages;
 	relform->reltuples = reltuples;
+	relform->relallvisible = relpages;
 
 	CatalogTupleUpdate(relRelation, &reltup->t_self, reltup);
 
@@ -2476,9 +2949,9 @@ hypercore_relation_copy_for_cluster(Relation OldHypercore, Relation NewCompressi
  * handling, which is triggered via a proxy index (hypercore_proxy) that relays the
  * clean up to the "correct" hypercore indexes. (See hypercore_proxy.c)
  *
- * For future: It would make sense to (re-)compress all non-compressed data as
- * part of vacuum since (re-)compression is a kind of cleanup but also leaves
- * a lot of garbage.
+ * The non-compressed data is not merged into the compressed relation as part
+ * of vacuum, since a lazy vacuum must not write tuples. It is merged by
+ * recompression instead, see recompress_hypercore_merge_impl().
  */
 static void
 hypercore_vacuum_rel(Relation rel, VacuumParams *params, BufferAccessStrategy bstrategy)
@@ -2586,7 +3059,8 @@ hypercore_scan_analyze_next_block(TableScanDesc scan, BlockNumber blockno,
 }
 #else
 static ReadStream *
-hypercore_setup_read_stream(Relation rel, BufferAccessStrategy bstrategy)
+hypercore_setup_read_stream(Relation rel, BufferAccessStrategy bstrategy, BlockNumber *nblocks_out,
+							int *targrows_out)
 {
 	Assert(rel != NULL);
 	BlockSampler block_sampler = palloc(sizeof(BlockSamplerData));
@@ -2596,6 +3070,11 @@ hypercore_setup_read_stream(Relation rel, BufferAccessStrategy bstrategy)
 	const BlockNumber nblocks = BlockSampler_Init(block_sampler, totalblocks, targrows, randseed);
 	pgstat_progress_update_param(PROGRESS_ANALYZE_BLOCKS_TOTAL, nblocks);
 
+	if (nblocks_out)
+		*nblocks_out = nblocks;
+	if (targrows_out)
+		*targrows_out = targrows;
+
 	TS_DEBUG_LOG("set up ReadStream for %s (%d), filenode: %d, pages: %d",
 				 RelationGetRelationName(rel),
 				 RelationGetRelid(rel),
@@ -2632,13 +3111,16 @@ hypercore_scan_analyze_next_block(TableScanDesc scan, ReadStream *stream)
 	if (!cscan->canalyze_read_stream)
 	{
 		Assert(cscan->compressed_rel);
-		cscan->canalyze_read_stream = hypercore_setup_read_stream(cscan->compressed_rel, bstrategy);
+		cscan->canalyze_read_stream = hypercore_setup_read_stream(cscan->compressed_rel,
+																  bstrategy,
+																  &cscan->canalyze_nblocks,
+																  &cscan->analyze_targrows);
 	}
 
 	if (!cscan->uanalyze_read_stream)
 	{
 		const TableAmRoutine *oldtam = switch_to_heapam(scan->rs_rd);
-		cscan->uanalyze_read_stream = hypercore_setup_read_stream(scan->rs_rd, bstrategy);
+		cscan->uanalyze_read_stream = hypercore_setup_read_stream(scan->rs_rd, bstrategy, NULL, NULL);
 		scan->rs_rd->rd_tableam = oldtam;
 	}
 
@@ -2669,6 +3151,63 @@ hypercore_scan_analyze_next_block(TableScanDesc scan, ReadStream *stream)
 }
 #endif
 
+/*
+ * Over-sample compressed rows by this factor, so that an overestimate of the
+ * number of rows in the sampled blocks doesn't leave the sample short.
+ */
+#define ANALYZE_COMPRESSED_OVERSAMPLING 2.0
+
+/*
+ * Compute the fraction of rows to sample from the compressed tuples.
+ *
+ * ANALYZE samples "targrows" blocks of the compressed relation, and every
+ * compressed tuple holds up to a thousand rows, so returning all the rows of
+ * the sampled compressed tuples would decompress and copy orders of
+ * magnitude more rows than the sample needs. Instead, every row of a
+ * compressed tuple is sampled with the same probability, which keeps the
+ * sample uniform over the compressed rows.
+ *
+ * The probability is estimated when the first compressed tuple is read, from
+ * the number of sampled blocks, the number of tuples on the first sampled
+ * page, and the number of rows in the first tuple. Before PG17, we don't know
+ * the number of sampled blocks, so all rows are sampled.
+ */
+static void
+analyze_init_row_fraction(HypercoreScanDesc scan, uint16 total_row_count)
+{
+	scan->analyze_row_fraction = 1.0;
+
+#if PG17_GE
+	const HeapScanDesc chscan = (HeapScanDesc) scan->cscan_desc;
+	const OffsetNumber tuples_per_page = PageGetMaxOffsetNumber(BufferGetPage(chscan->rs_cbuf));
+	const double expected_rows = (double) scan->canalyze_nblocks * tuples_per_page * total_row_count;
+
+	if (expected_rows > 0)
+		scan->analyze_row_fraction =
+			Min(1.0, ANALYZE_COMPRESSED_OVERSAMPLING * scan->analyze_targrows / expected_rows);
+#endif
+
+	TS_DEBUG_LOG("sampling fraction %g of compressed rows", scan->analyze_row_fraction);
+}
+
+/*
+ * Get the number of rows to skip before the next sampled row of a
+ * compressed tuple.
+ *
+ * The gaps between the rows sampled with the same probability follow the
+ * geometric distribution, so we can draw them directly instead of drawing a
+ * random number for every row.
+ */
+static double
+analyze_rows_to_skip(const HypercoreScanDesc scan)
+{
+	if (scan->analyze_row_fraction >= 1.0)
+		return 0;
+
+	const double u = pg_prng_double(&pg_global_prng_state);
+	return floor(log(1.0 - u) / log(1.0 - scan->analyze_row_fraction));
+}
+
 /*
  * Get the next tuple to sample during ANALYZE.
  *
@@ -2676,19 +3215,16 @@ hypercore_scan_analyze_next_block(TableScanDesc scan, ReadStream *stream)
  * relations, it is necessary to determine from which relation to return a
  * tuple. This is driven by scan_analyze_next_block() above.
  *
- * When sampling from the compressed relation, a compressed segment is read
- * and it is then necessary to return all tuples in the segment.
- *
- * NOTE: the function currently relies on heapAM's scan_analyze_next_tuple()
- * to read compressed segments. This can lead to misrepresenting liverows and
- * deadrows numbers since heap AM might skip tuples that are dead or
- * concurrently inserted, but still count them in liverows or deadrows. Each
- * compressed tuple represents many rows, but heapAM only counts each
- * compressed tuple as one row. The only way to fix this is to either check
- * the diff between the count before and after calling the heap AM function
- * and then estimate the actual number of rows from that, or, reimplement the
- * heapam_scan_analyze_next_tuple() function so that it can properly account
- * for compressed tuples.
+ * When sampling from the compressed relation, a compressed tuple is read
+ * using heapAM's scan_analyze_next_tuple() and then a random subset of its
+ * rows is returned (see analyze_init_row_fraction()). The rows that are not
+ * sampled are skipped without decompressing them. HeapAM counts each
+ * compressed tuple as one live row, so the remaining rows of the compressed
+ * tuple are added to the live rows, which ANALYZE uses to estimate the total
+ * number of rows in the relation.
+ *
+ * NOTE: dead compressed tuples are still counted as one dead row each, since
+ * heapAM skips them without returning them to us.
  */
 static bool
 hypercore_scan_analyze_next_tuple(TableScanDesc scan, TransactionId OldestXmin, double *liverows,
@@ -2696,7 +3232,6 @@ hypercore_scan_analyze_next_tuple(TableScanDesc scan, TransactionId OldestXmin,
 {
 	HypercoreScanDescData *cscan = (HypercoreScanDescData *) scan;
 	HeapScanDesc chscan = (HeapScanDesc) cscan->cscan_desc;
-	uint16 tuple_index;
 	bool result;
 
 	/*
@@ -2706,16 +3241,16 @@ hypercore_scan_analyze_next_tuple(TableScanDesc scan, TransactionId OldestXmin,
 	 */
 	if (chscan->rs_cbuf != InvalidBuffer)
 	{
-		/* Keep on returning tuples from the compressed segment until it is
-		 * consumed */
-		if (!TTS_EMPTY(slot))
+		/* Keep on returning the sampled rows of the compressed tuple until it
+		 * is consumed */
+		if (!TTS_EMPTY(slot) && arrow_slot_row_index(slot) != InvalidTupleIndex)
 		{
-			tuple_index = arrow_slot_row_index(slot);
+			const double skip = analyze_rows_to_skip(cscan);
+			const int remaining = arrow_slot_total_row_count(slot) - arrow_slot_row_index(slot);
 
-			if (tuple_index != InvalidTupleIndex && !arrow_slot_is_last(slot))
+			if (skip < remaining)
 			{
-				ExecIncrArrowTuple(slot, 1);
-				*liverows += 1;
+				ExecIncrArrowTuple(slot, (uint16) skip + 1);
 				return true;
 			}
 		}
@@ -2723,33 +3258,50 @@ hypercore_scan_analyze_next_tuple(TableScanDesc scan, TransactionId OldestXmin,
 		TupleTableSlot *child_slot =
 			arrow_slot_get_compressed_slot(slot, RelationGetDescr(cscan->compressed_rel));
 
-		result = cscan->compressed_rel->rd_tableam->scan_analyze_next_tuple(cscan->cscan_desc,
-																			OldestXmin,
-																			liverows,
-																			deadrows,
-																			child_slot);
-		/* Need to pick a row from the segment to sample. Might as well pick
-		 * the first one, but might consider picking a random one. */
-		tuple_index = 1;
-	}
-	else
-	{
-		TupleTableSlot *child_slot = arrow_slot_get_noncompressed_slot(slot);
-		Relation rel = scan->rs_rd;
-		const TableAmRoutine *oldtam = switch_to_heapam(rel);
-		result = rel->rd_tableam->scan_analyze_next_tuple(cscan->uscan_desc,
-														  OldestXmin,
-														  liverows,
-														  deadrows,
-														  child_slot);
-		rel->rd_tableam = oldtam;
-		tuple_index = InvalidTupleIndex;
+		while (cscan->compressed_rel->rd_tableam->scan_analyze_next_tuple(cscan->cscan_desc,
+																		   OldestXmin,
+																		   liverows,
+																		   deadrows,
+																		   child_slot))
+		{
+			slot->tts_tableOid = RelationGetRelid(scan->rs_rd);
+			ExecStoreArrowTuple(slot, 1);
+
+			const uint16 total_row_count = arrow_slot_total_row_count(slot);
+			*liverows += total_row_count - 1;
+
+			if (cscan->analyze_row_fraction == 0)
+				analyze_init_row_fraction(cscan, total_row_count);
+
+			/* Skip the compressed tuples without any sampled rows */
+			const double skip = analyze_rows_to_skip(cscan);
+
+			if (skip < total_row_count)
+			{
+				if (skip > 0)
+					ExecIncrArrowTuple(slot, (uint16) skip);
+				return true;
+			}
+		}
+
+		ExecClearTuple(slot);
+		return false;
 	}
 
+	TupleTableSlot *child_slot = arrow_slot_get_noncompressed_slot(slot);
+	Relation rel = scan->rs_rd;
+	const TableAmRoutine *oldtam = switch_to_heapam(rel);
+	result = rel->rd_tableam->scan_analyze_next_tuple(cscan->uscan_desc,
+													  OldestXmin,
+													  liverows,
+													  deadrows,
+													  child_slot);
+	rel->rd_tableam = oldtam;
+
 	if (result)
 	{
 		slot->tts_tableOid = RelationGetRelid(scan->rs_rd);
-		ExecStoreArrowTuple(slot, tuple_index);
+		ExecStoreArrowTuple(slot, InvalidTupleIndex);
 	}
 	else
 		ExecClearTuple(slot);
@@ -2781,6 +3333,7 @@ typedef struct IndexBuildCallbackState
 	Bitmapset *segmentby_cols;
 	Bitmapset *orderby_cols;
 	bool is_segmentby_index;
+	bool is_sparse_index;
 	MemoryContext decompression_mcxt;
 	MemoryContext batch_mcxt;
 	ArrowArray **arrow_columns;
@@ -2800,7 +3353,8 @@ typedef struct IndexBuildCallbackState
  * Note that, when the index covers only segmentby columns and the value is
  * the same for all original rows in the segment, the index storage is
  * optimized to only index the compressed row and then unwrapping it during
- * scanning instead.
+ * scanning instead. Sparse indexes (see hypercore_sparse.c) also index only
+ * the compressed row, keyed on the min metadata of the column.
  */
 static void
 hypercore_index_build_callback(Relation index, ItemPointer tid, Datum *values, bool *isnull,
@@ -2835,20 +3389,21 @@ hypercore_index_build_callback(Relation index, ItemPointer tid, Datum *values, b
 	 *
 	 * We need to figure out the number of rows in the segment, which is
 	 * usually given by the "count" column (num_actual_rows). But for
-	 * segmentby indexes, we only index whole segments (so num_rows = 1).
+	 * segmentby and sparse indexes, we only index whole segments (so
+	 * num_rows = 1).
 	 *
 	 * For non-segmentby indexes, we need to go through all attribute values
 	 * and decompress segments into multiple rows in columnar arrow array
 	 * format.
 	 */
-	if (icstate->is_segmentby_index)
+	if (icstate->is_segmentby_index || icstate->is_sparse_index)
 	{
 		/* A segment index will index only the full segment. */
 		num_rows = 1;
 
 #ifdef USE_ASSERT_CHECKING
 		/* A segment index can only index segmentby columns */
-		for (int i = 0; i < natts; i++)
+		for (int i = 0; i < natts && !icstate->is_sparse_index; i++)
 		{
 			const AttrNumber attno = icstate->index_info->ii_IndexAttrNumbers[i];
 			Assert(bms_is_member(attno, segmentby_cols));
@@ -2893,8 +3448,8 @@ hypercore_index_build_callback(Relation index, ItemPointer tid, Datum *values, b
 		}
 	}
 
-	Assert((!icstate->is_segmentby_index && num_rows > 0) ||
-		   (icstate->is_segmentby_index && num_rows == 1));
+	const bool index_segments = icstate->is_segmentby_index || icstate->is_sparse_index;
+	Assert((!index_segments && num_rows > 0) || (index_segments && num_rows == 1));
 
 	/*
 	 * Phase 2: Loop over all "unwrapped" rows in the arrow arrays, build
@@ -2903,25 +3458,31 @@ hypercore_index_build_callback(Relation index, ItemPointer tid, Datum *values, b
 
 	/* Table slot for predicate checks. We need to re-create a slot in table
 	 * format to be able to do predicate checks once we have decompressed the
-	 * values. */
+	 * values. Without a predicate, the slot is not used, and we skip the
+	 * per-row work of filling it in. */
 	TupleTableSlot *slot = icstate->slot;
+	const bool has_predicate = icstate->predicate != NULL;
 
 	for (int rownum = 0; rownum < num_rows; rownum++)
 	{
 		/* The slot is a table slot, not index slot. But we only fill in the
 		 * columns needed for the index and predicate checks. Therefore, make sure
 		 * other columns are initialized to "null" */
-		MemSet(slot->tts_isnull, true, sizeof(bool) * slot->tts_tupleDescriptor->natts);
-		ExecClearTuple(slot);
+		if (has_predicate)
+		{
+			MemSet(slot->tts_isnull, true, sizeof(bool) * slot->tts_tupleDescriptor->natts);
+			ExecClearTuple(slot);
+		}
 
 		for (int colnum = 0; colnum < natts; colnum++)
 		{
 			const AttrNumber attno = icstate->index_info->ii_IndexAttrNumbers[colnum];
 
-			if (bms_is_member(attno, segmentby_cols))
+			if (icstate->is_sparse_index || bms_is_member(attno, segmentby_cols))
 			{
-				/* Segmentby columns are not compressed, so the datum in the
-				 * values array is already set and valid */
+				/* Segmentby columns and the min metadata of sparse indexes
+				 * are not compressed, so the datum in the values array is
+				 * already set and valid */
 			}
 			else if (icstate->arrow_columns[colnum] != NULL)
 			{
@@ -2942,23 +3503,26 @@ hypercore_index_build_callback(Relation index, ItemPointer tid, Datum *values, b
 			}
 
 			/* Fill in the values in the table slot for predicate checks */
-			slot->tts_values[AttrNumberGetAttrOffset(attno)] = values[colnum];
-			slot->tts_isnull[AttrNumberGetAttrOffset(attno)] = isnull[colnum];
+			if (has_predicate)
+			{
+				slot->tts_values[AttrNumberGetAttrOffset(attno)] = values[colnum];
+				slot->tts_isnull[AttrNumberGetAttrOffset(attno)] = isnull[colnum];
+			}
 		}
 
 		ItemPointerData index_tid;
 		hypercore_tid_encode(&index_tid, tid, rownum + 1);
-		Assert(!icstate->is_segmentby_index || rownum == 0);
-
-		/* Reset memory for predicate checks */
-		MemoryContextReset(icstate->econtext->ecxt_per_tuple_memory);
+		Assert(!index_segments || rownum == 0);
 
 		/*
 		 * In a partial index, discard tuples that don't satisfy the
 		 * predicate.
 		 */
-		if (icstate->predicate)
+		if (has_predicate)
 		{
+			/* Reset memory for predicate checks */
+			MemoryContextReset(icstate->econtext->ecxt_per_tuple_memory);
+
 			/* Mark the slot as valid */
 			ExecStoreVirtualTuple(slot);
 
@@ -3000,6 +3564,13 @@ hypercore_index_build_callback(Relation index, ItemPointer tid, Datum *values, b
  * non-indexed predicate columns will be included in the values array passed
  * on to the "our" index build callback. Then we can reconstruct a table tuple
  * from those values in order to do the predicate check.
+ *
+ * Parallel index builds pass the scan begun by table_beginscan_parallel(),
+ * which holds parallel heap scans of both the compressed and the
+ * non-compressed relation (see hypercore_parallelscan_initialize()). Every
+ * participant first takes blocks of the compressed relation from the shared
+ * parallel scan, so the workers decompress disjoint sets of compressed
+ * tuples, and then continues with the non-compressed relation.
  */
 static double
 hypercore_index_build_range_scan(Relation relation, Relation indexRelation, IndexInfo *indexInfo,
@@ -3143,6 +3714,7 @@ hypercore_index_build_range_scan(Relation relation, Relation indexRelation, Inde
 		.arrow_columns =
 			(ArrowArray **) palloc(sizeof(ArrowArray *) * RelationGetDescr(relation)->natts),
 		.is_segmentby_index = true,
+		.is_sparse_index = hypercore_sparse_index_is_sparse(indexRelation),
 	};
 
 	/* IndexInfo copy to use when processing compressed relation. It will be
@@ -3157,7 +3729,22 @@ hypercore_index_build_range_scan(Relation relation, Relation indexRelation, Inde
 	for (int i = 0; i < indexInfo->ii_NumIndexAttrs; i++)
 	{
 		const AttrNumber attno = indexInfo->ii_IndexAttrNumbers[i];
-		const AttrNumber cattno = hsinfo->columns[AttrNumberGetAttrOffset(attno)].cattnum;
+		const ColumnCompressionSettings *column = &hsinfo->columns[AttrNumberGetAttrOffset(attno)];
+		AttrNumber cattno = column->cattnum;
+
+		/* A sparse index on a non-segmentby column indexes the min value of
+		 * the segment, so it needs the min/max metadata */
+		if (icstate.is_sparse_index && !column->is_segmentby)
+		{
+			if (!hypercore_column_has_minmax(column))
+				ereport(ERROR,
+						errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("column \"%s\" has no min/max metadata for a sparse index",
+							   NameStr(column->attname)),
+						errhint("Add the column to \"timescaledb.compress_orderby\" or create "
+								"the sparse index before the chunk is compressed."));
+			cattno = column->cattnum_min;
+		}
 
 		compress_iinfo.ii_IndexAttrNumbers[i] = cattno;
 		icstate.arrow_columns[i] = NULL;
@@ -3684,6 +4271,8 @@ convert_to_hypercore(Oid relid)
 		return;
 	}
 
+	/* Check the batch size limit before all the data is sorted */
+	(void) hypercore_batch_size_limit();
 	conversionstate = conversionstate_create(hcinfo, relation);
 	table_close(relation, NoLock);
 }
@@ -3714,6 +4303,15 @@ hypercore_xact_event(XactEvent event, void *arg)
 				ts_chunk_set_partial(chunk);
 				table_close(rel, NoLock);
 			}
+
+			/* The compressed tuples written by inserts can have values outside
+			 * of the ranges in the chunk column stats. Setting the chunk
+			 * partial above does the same. */
+			foreach (lc, directly_compressed_relids)
+			{
+				Chunk *chunk = ts_chunk_get_by_relid(lfirst_oid(lc), true);
+				ts_chunk_column_stats_set_invalid(chunk->fd.hypertable_id, chunk->fd.id);
+			}
 			break;
 		}
 		default:
@@ -3725,6 +4323,12 @@ hypercore_xact_event(XactEvent event, void *arg)
 		list_free(partially_compressed_relids);
 		partially_compressed_relids = NIL;
 	}
+
+	if (directly_compressed_relids != NIL)
+	{
+		list_free(directly_compressed_relids);
+		directly_compressed_relids = NIL;
+	}
 }
 
 static void
@@ -3777,6 +4381,7 @@ convert_to_hypercore_finish(Oid relid)
 						RelationGetDescr(compressed_rel)->natts,
 						true /*need_bistate*/,
 						HEAP_INSERT_FROZEN);
+	row_compressor.max_batch_rows = hypercore_batch_size_limit();
 
 	row_compressor_append_sorted_rows(&row_compressor,
 									  conversionstate->tuplesortstate,
@@ -3866,6 +4471,13 @@ hypercore_alter_access_method_finish(Oid relid, bool to_other_am)
  * the heap tuple (since the scan returns directly from the index), and there
  * is no opportunity to unwrap the tuple. Therefore, turn IndexOnlyScans into
  * regular IndexScans on segmentby indexes.
+ *
+ * Index-only scans on other indexes are kept. The visibility map never
+ * covers the encoded TIDs of compressed rows, so the executor fetches the
+ * table tuple for every compressed row to check its visibility. This only
+ * reads the compressed tuple and doesn't decompress anything, since the
+ * values are returned from the index tuple. The consecutive rows of the same
+ * compressed tuple don't fetch it again (see hypercore_index_fetch_tuple()).
  */
 static void
 convert_index_only_scans(const HypercoreInfo *hsinfo, List *pathlist)
@@ -0,0 +1,196 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#include <postgres.h>
+#include <access/amapi.h>
+#include <access/genam.h>
+#include <access/nbtree.h>
+#include <access/relscan.h>
+#include <access/skey.h>
+#include <nodes/execnodes.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+
+#include <compat/compat.h>
+#include "hypercore/hypercore_sparse.h"
+
+/**
+ * Hypercore sparse index AM (hypercore_sparse).
+ *
+ * A regular index on a hypercore has one entry for every row, also for the
+ * rows in compressed tuples, so the index can be almost as large as the
+ * non-compressed table. A sparse index instead has one entry per compressed
+ * tuple (batch), which is what the segmentby indexes do already, see
+ * hypercore_index_build_callback(). An index scan returns the TID of the
+ * compressed tuple and the hypercore TAM unwraps it into all its rows in
+ * hypercore_index_fetch_tuple().
+ *
+ * The entry of a batch is keyed on the min value of the indexed column in
+ * the batch, which is taken from the min/max metadata of the compressed
+ * relation. The rows of the non-compressed relation have one entry per row,
+ * keyed on the value itself, which is the min of a batch of one row.
+ *
+ * The index is a btree internally, and this AM only wraps the btree
+ * callbacks to make the scans lossy. A batch with the min "m" can contain
+ * matches for "col = x" and "col <= x" only if "m <= x", and for "col < x"
+ * only if "m < x", so the equality keys are turned into "<=" keys and the
+ * upper bounds are kept. The lower bounds cannot be answered from the min,
+ * so they only exclude the entries with a null key (batches with only
+ * nulls). All returned rows are rechecked against the original quals by the
+ * index scan node.
+ *
+ * The index supports only one column without predicates or expressions, and
+ * neither ordered, index-only, nor bitmap scans.
+ */
+
+/*
+ * Translate a scan key on the indexed column into a key on the batch min.
+ */
+static void
+sparse_translate_key(Relation indexrel, const ScanKey key, ScanKey newkey)
+{
+	*newkey = *key;
+
+	/* Null tests are kept and a null argument never matches */
+	if (key->sk_flags & (SK_ISNULL | SK_SEARCHNULL | SK_SEARCHNOTNULL))
+		return;
+
+	if (!(key->sk_flags & SK_ROW_HEADER))
+	{
+		switch (key->sk_strategy)
+		{
+			case BTLessStrategyNumber:
+			case BTLessEqualStrategyNumber:
+				return;
+			case BTEqualStrategyNumber:
+			{
+				const Oid lefttype = indexrel->rd_opcintype[0];
+				const Oid righttype = OidIsValid(key->sk_subtype) ? key->sk_subtype : lefttype;
+				const Oid opno = get_opfamily_member(indexrel->rd_opfamily[0],
+													 lefttype,
+													 righttype,
+													 BTLessEqualStrategyNumber);
+
+				if (!OidIsValid(opno))
+					elog(ERROR,
+						 "missing operator %d(%u,%u) in opfamily %u",
+						 BTLessEqualStrategyNumber,
+						 lefttype,
+						 righttype,
+						 indexrel->rd_opfamily[0]);
+
+				ScanKeyEntryInitialize(newkey,
+									   key->sk_flags,
+									   key->sk_attno,
+									   BTLessEqualStrategyNumber,
+									   key->sk_subtype,
+									   key->sk_collation,
+									   get_opcode(opno),
+									   key->sk_argument);
+				return;
+			}
+			default:
+				break;
+		}
+	}
+
+	/* Lower bounds and row comparisons only exclude the null keys. The key
+	 * is replaced instead of removed since btree expects the number of keys
+	 * given to ambeginscan. */
+	ScanKeyEntryInitialize(newkey,
+						   SK_ISNULL | SK_SEARCHNOTNULL,
+						   key->sk_attno,
+						   InvalidStrategy,
+						   InvalidOid,
+						   InvalidOid,
+						   InvalidOid,
+						   (Datum) 0);
+}
+
+static void
+hypercore_sparse_rescan(IndexScanDesc scan, ScanKey scankey, int nscankeys, ScanKey orderbys,
+						int norderbys)
+{
+	ScanKey keys = NULL;
+
+	if (scankey != NULL && nscankeys > 0)
+	{
+		keys = palloc(sizeof(ScanKeyData) * nscankeys);
+
+		for (int i = 0; i < nscankeys; i++)
+			sparse_translate_key(scan->indexRelation, &scankey[i], &keys[i]);
+	}
+
+	btrescan(scan, keys, nscankeys, orderbys, norderbys);
+
+	if (keys != NULL)
+		pfree(keys);
+}
+
+static bool
+hypercore_sparse_gettuple(IndexScanDesc scan, ScanDirection dir)
+{
+	const bool found = btgettuple(scan, dir);
+
+	/* The index only tells which batches can contain matches */
+	scan->xs_recheck = true;
+
+	return found;
+}
+
+static IndexBuildResult *
+hypercore_sparse_build(Relation rel, Relation index, IndexInfo *indexInfo)
+{
+	if (indexInfo->ii_Predicate != NIL)
+		ereport(ERROR,
+				errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("partial indexes not supported by the \"%s\" access method",
+					   HYPERCORE_SPARSE_AM_NAME));
+
+	if (indexInfo->ii_IndexAttrNumbers[0] == InvalidAttrNumber)
+		ereport(ERROR,
+				errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				errmsg("expression indexes not supported by the \"%s\" access method",
+					   HYPERCORE_SPARSE_AM_NAME));
+
+	return btbuild(rel, index, indexInfo);
+}
+
+/*
+ * Check if the index uses the hypercore_sparse access method.
+ */
+bool
+hypercore_sparse_index_is_sparse(Relation indexrel)
+{
+	return indexrel->rd_indam != NULL && indexrel->rd_indam->amrescan == hypercore_sparse_rescan;
+}
+
+Datum
+hypercore_sparse_handler(PG_FUNCTION_ARGS)
+{
+	IndexAmRoutine *amroutine =
+		(IndexAmRoutine *) DatumGetPointer(DirectFunctionCall1(bthandler, PointerGetDatum(NULL)));
+
+	/* The keys are batch mins, so there is no order, uniqueness, or values to
+	 * return, and the scan keys have to be translated for all scans. */
+	amroutine->amcanorder = false;
+	amroutine->amcanbackward = false;
+	amroutine->amcanunique = false;
+	amroutine->amcanmulticol = false;
+	amroutine->amsearcharray = false;
+	amroutine->amsearchnulls = false;
+	amroutine->amclusterable = false;
+	amroutine->amcaninclude = false;
+
+	amroutine->ambuild = hypercore_sparse_build;
+	amroutine->amrescan = hypercore_sparse_rescan;
+	amroutine->amgettuple = hypercore_sparse_gettuple;
+	amroutine->amcanreturn = NULL;
+	amroutine->amgetbitmap = NULL;
+	amroutine->ammarkpos = NULL;
+	amroutine->amrestrpos = NULL;
+
+	PG_RETURN_POINTER(amroutine);
+}
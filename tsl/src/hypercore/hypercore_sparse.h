@@ -0,0 +1,15 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <utils/rel.h>
+
+#define HYPERCORE_SPARSE_AM_NAME "hypercore_sparse"
+
+extern Datum hypercore_sparse_handler(PG_FUNCTION_ARGS);
+extern bool hypercore_sparse_index_is_sparse(Relation indexrel);
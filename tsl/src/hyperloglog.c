@@ -0,0 +1,283 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * The approx_count_distinct() aggregate based on the HyperLogLog sketch. This
+ * file has the usual aggregate support functions, the vectorized
+ * implementation is in nodes/vector_agg/function/approx_count_distinct.c.
+ */
+
+#include <postgres.h>
+
+#include <math.h>
+
+#include <common/hashfn.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+
+#include "hyperloglog.h"
+
+#ifdef TS_USE_UMASH
+#include "import/umash.h"
+#endif
+
+/* The seed for the hash functions, also used to derive the UMASH parameters. */
+#define HLL_SEED UINT64CONST(0x5bd1e9955bd1e995)
+
+#define HLL_FORMAT_VERSION 1
+
+typedef struct HllSerialized
+{
+	int32 vl_len_;
+	uint8 version;
+	uint8 hash_kind;
+	uint8 precision;
+	uint8 padding;
+	uint8 registers[FLEXIBLE_ARRAY_MEMBER];
+} HllSerialized;
+
+#define HLL_SERIALIZED_SIZE (offsetof(HllSerialized, registers) + HLL_REGISTERS)
+
+typedef struct HllTransState
+{
+	/* The argument type, not known for the deserialized states. */
+	Oid typid;
+	int16 typlen;
+	bool typbyval;
+
+	uint8 registers[HLL_REGISTERS];
+} HllTransState;
+
+uint64
+hll_hash_bytes(const void *data, size_t len)
+{
+#ifdef TS_USE_UMASH
+	static struct umash_params *params = NULL;
+	if (unlikely(params == NULL))
+	{
+		struct umash_params *new_params =
+			MemoryContextAllocZero(TopMemoryContext, sizeof(struct umash_params));
+		umash_params_derive(new_params, HLL_SEED, NULL);
+		params = new_params;
+	}
+	return umash_full(params, HLL_SEED, /* which = */ 0, data, len);
+#else
+	return DatumGetUInt64(hash_bytes_extended(data, len, HLL_SEED));
+#endif
+}
+
+uint64
+hll_hash_datum(Datum value, int16 typlen, bool typbyval)
+{
+	if (typbyval)
+	{
+		char bytes[sizeof(Datum)];
+		store_att_byval(bytes, value, typlen);
+		return hll_hash_bytes(bytes, typlen);
+	}
+
+	if (typlen > 0)
+	{
+		return hll_hash_bytes(DatumGetPointer(value), typlen);
+	}
+
+	if (typlen == -1)
+	{
+		/* Hash the varlena data without the header, which can be short or long. */
+		struct varlena *detoasted = PG_DETOAST_DATUM_PACKED(value);
+		const uint64 hash = hll_hash_bytes(VARDATA_ANY(detoasted), VARSIZE_ANY_EXHDR(detoasted));
+		if ((Pointer) detoasted != DatumGetPointer(value))
+		{
+			pfree(detoasted);
+		}
+		return hash;
+	}
+
+	Assert(typlen == -2);
+	return hll_hash_bytes(DatumGetCString(value), strlen(DatumGetCString(value)));
+}
+
+bytea *
+hll_serialize(const uint8 *registers)
+{
+	HllSerialized *serialized = palloc0(HLL_SERIALIZED_SIZE);
+	SET_VARSIZE(serialized, HLL_SERIALIZED_SIZE);
+	serialized->version = HLL_FORMAT_VERSION;
+	serialized->hash_kind = HLL_HASH_KIND;
+	serialized->precision = HLL_PRECISION;
+	if (registers != NULL)
+	{
+		memcpy(serialized->registers, registers, HLL_REGISTERS);
+	}
+	return (bytea *) serialized;
+}
+
+static HllTransState *
+hll_state_create(MemoryContext aggcontext)
+{
+	HllTransState *state = MemoryContextAllocZero(aggcontext, sizeof(HllTransState));
+	state->typid = InvalidOid;
+	return state;
+}
+
+static MemoryContext
+hll_get_aggcontext(FunctionCallInfo fcinfo, const char *funcname)
+{
+	MemoryContext aggcontext;
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+	{
+		/* Cannot be called directly because of internal-type argument. */
+		elog(ERROR, "%s called in non-aggregate context", funcname);
+	}
+	return aggcontext;
+}
+
+/*
+ * approx_count_distinct(anyelement) transition function.
+ */
+Datum
+tsl_hll_sfunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext = hll_get_aggcontext(fcinfo, "hll_sfunc");
+	HllTransState *state = PG_ARGISNULL(0) ? NULL : (HllTransState *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+	{
+		/* The nulls are not counted. */
+		if (state == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state);
+	}
+
+	if (state == NULL)
+	{
+		state = hll_state_create(aggcontext);
+	}
+
+	if (!OidIsValid(state->typid))
+	{
+		state->typid = get_fn_expr_argtype(fcinfo->flinfo, 1);
+		if (!OidIsValid(state->typid))
+			elog(ERROR, "could not determine the argument type of approx_count_distinct()");
+		get_typlenbyval(state->typid, &state->typlen, &state->typbyval);
+	}
+
+	hll_add_hash(state->registers,
+				 hll_hash_datum(PG_GETARG_DATUM(1), state->typlen, state->typbyval));
+
+	PG_RETURN_POINTER(state);
+}
+
+Datum
+tsl_hll_combinefunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext = hll_get_aggcontext(fcinfo, "hll_combinefunc");
+	HllTransState *state1 = PG_ARGISNULL(0) ? NULL : (HllTransState *) PG_GETARG_POINTER(0);
+	HllTransState *state2 = PG_ARGISNULL(1) ? NULL : (HllTransState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	if (state1 == NULL)
+	{
+		/* The first state must be in the aggregate context. */
+		state1 = hll_state_create(aggcontext);
+		*state1 = *state2;
+		PG_RETURN_POINTER(state1);
+	}
+
+	for (int i = 0; i < HLL_REGISTERS; i++)
+	{
+		state1->registers[i] = Max(state1->registers[i], state2->registers[i]);
+	}
+
+	PG_RETURN_POINTER(state1);
+}
+
+Datum
+tsl_hll_serializefunc(PG_FUNCTION_ARGS)
+{
+	hll_get_aggcontext(fcinfo, "hll_serializefunc");
+	HllTransState *state = (HllTransState *) PG_GETARG_POINTER(0);
+	PG_RETURN_BYTEA_P(hll_serialize(state->registers));
+}
+
+Datum
+tsl_hll_deserializefunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext = hll_get_aggcontext(fcinfo, "hll_deserializefunc");
+	/* The unpacked varlena is aligned, so we can read the header in place. */
+	const HllSerialized *serialized = (const HllSerialized *) PG_GETARG_BYTEA_P(0);
+
+	if (VARSIZE(serialized) != HLL_SERIALIZED_SIZE)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid size of the approx_count_distinct() state")));
+	}
+
+	if (serialized->version != HLL_FORMAT_VERSION || serialized->precision != HLL_PRECISION)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid format of the approx_count_distinct() state")));
+	}
+
+	if (serialized->hash_kind != HLL_HASH_KIND)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot use approx_count_distinct() state computed with a different hash "
+						"function"),
+				 errdetail("The state was computed by a build of TimescaleDB that uses a "
+						   "different hash function.")));
+	}
+
+	HllTransState *state = hll_state_create(aggcontext);
+	memcpy(state->registers, serialized->registers, HLL_REGISTERS);
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * Estimate the number of distinct values, with the small range correction
+ * from the original HyperLogLog paper. With the 64-bit hashes, we don't need
+ * the large range correction.
+ */
+Datum
+tsl_hll_finalfunc(PG_FUNCTION_ARGS)
+{
+	hll_get_aggcontext(fcinfo, "hll_finalfunc");
+
+	if (PG_ARGISNULL(0))
+	{
+		PG_RETURN_INT64(0);
+	}
+
+	HllTransState *state = (HllTransState *) PG_GETARG_POINTER(0);
+
+	const double m = HLL_REGISTERS;
+	double sum = 0;
+	int zero_registers = 0;
+	for (int i = 0; i < HLL_REGISTERS; i++)
+	{
+		sum += ldexp(1.0, -state->registers[i]);
+		zero_registers += state->registers[i] == 0;
+	}
+
+	const double alpha = 0.7213 / (1.0 + 1.079 / m);
+	double estimate = alpha * m * m / sum;
+	if (estimate <= 2.5 * m && zero_registers > 0)
+	{
+		estimate = m * log(m / zero_registers);
+	}
+
+	PG_RETURN_INT64((int64) rint(estimate));
+}
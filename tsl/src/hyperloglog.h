@@ -0,0 +1,74 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <port/pg_bitutils.h>
+
+/*
+ * The HyperLogLog sketch for approx_count_distinct(). It has 2^HLL_PRECISION
+ * one-byte registers, which gives the standard error of about 1.6%. The
+ * values are hashed by their binary representation, so the distinct values
+ * that compare equal but have different representations, e.g. numeric 1.0
+ * and 1.00, are counted separately.
+ *
+ * The same sketch is built by the usual aggregate transition function and by
+ * the vectorized aggregation, and they use the same serialized format for
+ * the partial aggregation results.
+ */
+#define HLL_PRECISION 12
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+
+/*
+ * We use UMASH for hashing when it is available, and the Postgres hash
+ * function otherwise. The kind of the hash function is recorded in the
+ * serialized sketch, because the sketches built with different hash
+ * functions can't be combined.
+ */
+#define HLL_HASH_UMASH 1
+#define HLL_HASH_POSTGRES 2
+
+#ifdef TS_USE_UMASH
+#define HLL_HASH_KIND HLL_HASH_UMASH
+#else
+#define HLL_HASH_KIND HLL_HASH_POSTGRES
+#endif
+
+extern uint64 hll_hash_bytes(const void *data, size_t len);
+
+/*
+ * Hash a Datum of the given type. The by-value types are hashed by the bytes
+ * of their in-memory representation, the same as they are stored in the
+ * arrow arrays.
+ */
+extern uint64 hll_hash_datum(Datum value, int16 typlen, bool typbyval);
+
+extern bytea *hll_serialize(const uint8 *registers);
+
+static inline void
+hll_add_hash(uint8 *restrict registers, uint64 hash)
+{
+	const uint32 index = hash >> (64 - HLL_PRECISION);
+
+	/*
+	 * The rank is the position of the leftmost one bit in the rest of the
+	 * hash. The guard bit limits the rank and makes the word nonzero.
+	 */
+	const uint64 word = (hash << HLL_PRECISION) | (UINT64CONST(1) << (HLL_PRECISION - 1));
+	const uint8 rank = 64 - pg_leftmost_one_pos64(word);
+
+	if (rank > registers[index])
+	{
+		registers[index] = rank;
+	}
+}
+
+extern Datum tsl_hll_sfunc(PG_FUNCTION_ARGS);
+extern Datum tsl_hll_combinefunc(PG_FUNCTION_ARGS);
+extern Datum tsl_hll_serializefunc(PG_FUNCTION_ARGS);
+extern Datum tsl_hll_deserializefunc(PG_FUNCTION_ARGS);
+extern Datum tsl_hll_finalfunc(PG_FUNCTION_ARGS);
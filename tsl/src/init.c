@@ -7,10 +7,12 @@
 #include <fmgr.h>
 #include <storage/ipc.h>
 
+#include "bgw_policy/chunk_precreation_api.h"
 #include "bgw_policy/compression_api.h"
 #include "bgw_policy/continuous_aggregate_api.h"
 #include "bgw_policy/job.h"
 #include "bgw_policy/job_api.h"
+#include "bgw_policy/merge_chunks_api.h"
 #include "bgw_policy/policies_v2.h"
 #include "bgw_policy/reorder_api.h"
 #include "bgw_policy/retention_api.h"
@@ -22,8 +24,12 @@
 #include "compression/algorithms/dictionary.h"
 #include "compression/algorithms/gorilla.h"
 #include "compression/api.h"
+#include "compression/arrow_ipc.h"
+#include "compression/batch_metadata_builder_bloom1.h"
 #include "compression/compression.h"
+#include "compression/compression_stats.h"
 #include "compression/create.h"
+#include "compression/direct_compress.h"
 #include "compression/recompress.h"
 #include "config.h"
 #include "continuous_aggs/create.h"
@@ -34,17 +40,23 @@
 #include "continuous_aggs/repair.h"
 #include "continuous_aggs/utils.h"
 #include "cross_module_fn.h"
+#include "ddsketch.h"
 #include "export.h"
 #include "hypercore/arrow_cache_explain.h"
 #include "hypercore/arrow_tts.h"
 #include "hypercore/attr_capture.h"
 #include "hypercore/hypercore_handler.h"
 #include "hypercore/hypercore_proxy.h"
+#include "hypercore/hypercore_sparse.h"
 #include "hypertable.h"
+#include "hyperloglog.h"
 #include "license_guc.h"
 #include "nodes/columnar_scan/columnar_scan.h"
 #include "nodes/decompress_chunk/planner.h"
+#include "nodes/gapfill/gapfill.h"
 #include "nodes/gapfill/gapfill_functions.h"
+#include "nodes/partial_agg_cache/partial_agg_cache.h"
+#include "nodes/runtime_filter/runtime_filter.h"
 #include "nodes/skip_scan/skip_scan.h"
 #include "nodes/vector_agg/plan.h"
 #include "partialize_finalize.h"
@@ -92,6 +104,7 @@ CrossModuleFunctions tsl_cm_functions = {
 	.policy_compression_remove = policy_compression_remove,
 	.policy_recompression_proc = policy_recompression_proc,
 	.policy_compression_check = policy_compression_check,
+	.policy_compression_execute_parallel = policy_compression_execute_parallel,
 	.policy_refresh_cagg_add = policy_refresh_cagg_add,
 	.policy_refresh_cagg_proc = policy_refresh_cagg_proc,
 	.policy_refresh_cagg_check = policy_refresh_cagg_check,
@@ -104,6 +117,16 @@ CrossModuleFunctions tsl_cm_functions = {
 	.policy_retention_proc = policy_retention_proc,
 	.policy_retention_check = policy_retention_check,
 	.policy_retention_remove = policy_retention_remove,
+	.policy_retention_batch_proc = policy_retention_batch_proc,
+	.policy_retention_batch_check = policy_retention_batch_check,
+	.policy_precreate_chunks_add = policy_precreate_chunks_add,
+	.policy_precreate_chunks_proc = policy_precreate_chunks_proc,
+	.policy_precreate_chunks_check = policy_precreate_chunks_check,
+	.policy_precreate_chunks_remove = policy_precreate_chunks_remove,
+	.policy_merge_chunks_add = policy_merge_chunks_add,
+	.policy_merge_chunks_proc = policy_merge_chunks_proc,
+	.policy_merge_chunks_check = policy_merge_chunks_check,
+	.policy_merge_chunks_remove = policy_merge_chunks_remove,
 
 	.job_add = job_add,
 	.job_alter = job_alter,
@@ -111,6 +134,7 @@ CrossModuleFunctions tsl_cm_functions = {
 	.job_delete = job_delete,
 	.job_run = job_run,
 	.job_execute = job_execute,
+	.bgw_job_helper_main = policy_compression_helper_main,
 
 	/* gapfill */
 	.gapfill_marker = gapfill_marker,
@@ -143,12 +167,14 @@ CrossModuleFunctions tsl_cm_functions = {
 	.continuous_agg_call_invalidation_trigger = execute_cagg_trigger,
 	.continuous_agg_refresh = continuous_agg_refresh,
 	.continuous_agg_invalidate_raw_ht = continuous_agg_invalidate_raw_ht,
+	.continuous_agg_invalidate_slots = continuous_agg_invalidate_slots,
 	.continuous_agg_invalidate_mat_ht = continuous_agg_invalidate_mat_ht,
 	.continuous_agg_update_options = continuous_agg_update_options,
 	.continuous_agg_validate_query = continuous_agg_validate_query,
 	.continuous_agg_get_bucket_function = continuous_agg_get_bucket_function,
 	.continuous_agg_get_bucket_function_info = continuous_agg_get_bucket_function_info,
 	.continuous_agg_migrate_to_time_bucket = continuous_agg_migrate_to_time_bucket,
+	.continuous_agg_compact_invalidation_log = continuous_agg_compact_invalidation_log,
 	.cagg_try_repair = tsl_cagg_try_repair,
 
 	/* Compression */
@@ -160,6 +186,21 @@ CrossModuleFunctions tsl_cm_functions = {
 	.compressed_data_out = tsl_compressed_data_out,
 	.compressed_data_info = tsl_compressed_data_info,
 	.compressed_data_has_nulls = tsl_compressed_data_has_nulls,
+	.bloom1_contains = tsl_bloom1_contains,
+	.compressed_column_stats = tsl_compressed_column_stats,
+	.calibrate_decompression_cost = tsl_calibrate_decompression_cost,
+	.hll_sfunc = tsl_hll_sfunc,
+	.hll_combinefunc = tsl_hll_combinefunc,
+	.hll_serializefunc = tsl_hll_serializefunc,
+	.hll_deserializefunc = tsl_hll_deserializefunc,
+	.hll_finalfunc = tsl_hll_finalfunc,
+	.ddsketch_sfunc = tsl_ddsketch_sfunc,
+	.ddsketch_rollup_sfunc = tsl_ddsketch_rollup_sfunc,
+	.ddsketch_combinefunc = tsl_ddsketch_combinefunc,
+	.ddsketch_serializefunc = tsl_ddsketch_serializefunc,
+	.ddsketch_deserializefunc = tsl_ddsketch_deserializefunc,
+	.ddsketch_finalfunc = tsl_ddsketch_finalfunc,
+	.approx_quantile = tsl_approx_quantile,
 	.deltadelta_compressor_append = tsl_deltadelta_compressor_append,
 	.deltadelta_compressor_finish = tsl_deltadelta_compressor_finish,
 	.gorilla_compressor_append = tsl_gorilla_compressor_append,
@@ -175,12 +216,19 @@ CrossModuleFunctions tsl_cm_functions = {
 	.process_rename_cmd = tsl_process_rename_cmd,
 	.compress_chunk = tsl_compress_chunk,
 	.decompress_chunk = tsl_decompress_chunk,
+	.export_arrow_ipc = tsl_export_arrow_ipc,
+	.compress_chunk_slice = tsl_compress_chunk_slice,
 	.decompress_batches_for_insert = decompress_batches_for_insert,
 	.decompress_target_segments = decompress_target_segments,
+	.direct_compress_begin = direct_compress_begin,
+	.direct_compress_insert = direct_compress_insert,
+	.direct_compress_end = direct_compress_end,
 	.hypercore_handler = hypercore_handler,
 	.hypercore_proxy_handler = hypercore_proxy_handler,
+	.hypercore_sparse_handler = hypercore_sparse_handler,
 	.hypercore_decompress_update_segment = hypercore_decompress_update_segment,
 	.is_compressed_tid = tsl_is_compressed_tid,
+	.hypercore_arrow_cache_stats = tsl_hypercore_arrow_cache_stats,
 	.ddl_command_start = tsl_ddl_command_start,
 	.ddl_command_end = tsl_ddl_command_end,
 	.show_chunk = chunk_show,
@@ -216,8 +264,12 @@ ts_module_init(PG_FUNCTION_ARGS)
 	_continuous_aggs_cache_inval_init();
 	_decompress_chunk_init();
 	_columnar_scan_init();
+	_compression_stats_init();
+	_gapfill_init();
 	_arrow_cache_explain_init();
 	_attr_capture_init();
+	_partial_agg_cache_init();
+	_runtime_filter_init();
 	_skip_scan_init();
 	_vector_agg_init();
 
@@ -25,12 +25,16 @@
 #include <parser/parsetree.h>
 #include <planner.h>
 #include <planner/planner.h>
+#include <utils/array.h>
+#include <utils/lsyscache.h>
 #include <utils/palloc.h>
 #include <utils/rel.h>
 #include <utils/snapmgr.h>
 #include <utils/typcache.h>
 
+#include "chunk.h"
 #include "columnar_scan.h"
+#include "compressed_scan_stats.h"
 #include "compression/compression.h"
 #include "guc.h"
 #include "hypercore/arrow_tts.h"
@@ -148,6 +152,33 @@ process_segmentby_quals(QualProcessState *qpc, List *quals)
 	}
 }
 
+/*
+ * Check if the expression can be used as the argument of a scankey.
+ *
+ * External parameters, e.g., in generic plans of prepared statements, are
+ * replaced by their values before creating the scankeys at execution time
+ * (see columnar_scan_begin()), so the scankeys only get constants.
+ */
+static bool
+is_scankey_argument(const Expr *expr)
+{
+	return IsA(expr, Const) ||
+		   (IsA(expr, Param) && castNode(Param, expr)->paramkind == PARAM_EXTERN);
+}
+
+/*
+ * Get the constant argument of a scankey when creating the scankeys at
+ * execution time.
+ */
+static Const *
+get_scankey_argument(Expr *expr)
+{
+	if (!IsA(expr, Const))
+		elog(ERROR, "could not evaluate scankey argument");
+
+	return castNode(Const, expr);
+}
+
 /*
  * Process OP-like expression.
  *
@@ -226,12 +257,8 @@ process_opexpr(QualProcessState *qpi, OpExpr *opexpr)
 
 	Assert(expr != NULL);
 
-	if (IsA(expr, Const))
-	{
-		Const *c = castNode(Const, expr);
-		scanvalue = c->constvalue;
+	if (is_scankey_argument(expr))
 		argfound = true;
-	}
 
 	const ColumnCompressionSettings *ccs =
 		&qpi->hcinfo->columns[AttrNumberGetAttrOffset(relvar->varattno)];
@@ -259,8 +286,11 @@ process_opexpr(QualProcessState *qpi, OpExpr *opexpr)
 
 			if (qpi->scankeys != NULL)
 			{
+				const Const *c = get_scankey_argument(expr);
+
+				scanvalue = c->constvalue;
 				ScanKeyEntryInitialize(&qpi->scankeys[qpi->nscankeys++],
-									   0,
+									   c->constisnull ? SK_ISNULL : 0,
 									   relvar->varattno,
 									   op_strategy,
 									   op_righttype,
@@ -278,6 +308,123 @@ process_opexpr(QualProcessState *qpi, OpExpr *opexpr)
 	return true;
 }
 
+/*
+ * State of a scankey for "segmentby_col = ANY(array)".
+ */
+typedef struct ScanKeyAnyState
+{
+	FmgrInfo opfn; /* Function of the operator */
+	int nelems;
+	Datum *elems;
+	bool *nulls;
+} ScanKeyAnyState;
+
+/*
+ * Scankey function for "segmentby_col = ANY(array)".
+ *
+ * Heap scankeys don't support arrays, so the scankey instead uses this
+ * function, and its argument is the ScanKeyAnyState with the array elements.
+ */
+static Datum
+scankey_any_match(PG_FUNCTION_ARGS)
+{
+	const Datum value = PG_GETARG_DATUM(0);
+	ScanKeyAnyState *state = (ScanKeyAnyState *) PG_GETARG_POINTER(1);
+
+	for (int i = 0; i < state->nelems; i++)
+	{
+		/* The operator is strict, so the null elements never match */
+		if (state->nulls[i])
+			continue;
+
+		if (DatumGetBool(
+				FunctionCall2Coll(&state->opfn, PG_GET_COLLATION(), value, state->elems[i])))
+			PG_RETURN_BOOL(true);
+	}
+
+	PG_RETURN_BOOL(false);
+}
+
+/*
+ * Process "segmentby_col = ANY(array)" expression.
+ *
+ * This is common with lists of devices or tenants, e.g., "device_id IN (1,
+ * 3)". Since the value of the segmentby column is the same for the entire
+ * compressed tuple, the scankey filters out the non-matching compressed
+ * tuples before they are returned by the scan of the compressed relation.
+ *
+ * Returns true if the qual should be kept as a regular qual filter in the
+ * scan, or false if it should not be kept.
+ */
+static bool
+process_saopexpr(QualProcessState *qpi, ScalarArrayOpExpr *saop)
+{
+	Expr *leftop = linitial(saop->args);
+	Expr *rightop = lsecond(saop->args);
+
+	if (!saop->useOr || !OidIsValid(saop->opfuncid) || !op_strict(saop->opno))
+		return true;
+
+	if (IsA(leftop, RelabelType))
+		leftop = ((RelabelType *) leftop)->arg;
+
+	if (!match_relvar(leftop, qpi->relid) || !is_scankey_argument(rightop))
+		return true;
+
+	const Var *relvar = castNode(Var, leftop);
+	const ColumnCompressionSettings *ccs =
+		&qpi->hcinfo->columns[AttrNumberGetAttrOffset(relvar->varattno)];
+
+	if (!ccs->is_segmentby)
+		return true;
+
+	if (qpi->scankeys != NULL)
+	{
+		const Const *c = get_scankey_argument(rightop);
+		ScanKeyAnyState *state = palloc0(sizeof(ScanKeyAnyState));
+		FmgrInfo finfo = {
+			.fn_addr = scankey_any_match,
+			.fn_oid = InvalidOid,
+			.fn_nargs = 2,
+			.fn_strict = true,
+			.fn_mcxt = CurrentMemoryContext,
+		};
+
+		fmgr_info(saop->opfuncid, &state->opfn);
+
+		if (!c->constisnull)
+		{
+			ArrayType *arr = DatumGetArrayTypeP(c->constvalue);
+			int16 elmlen;
+			bool elmbyval;
+			char elmalign;
+
+			get_typlenbyvalalign(ARR_ELEMTYPE(arr), &elmlen, &elmbyval, &elmalign);
+			deconstruct_array(arr,
+							  ARR_ELEMTYPE(arr),
+							  elmlen,
+							  elmbyval,
+							  elmalign,
+							  &state->elems,
+							  &state->nulls,
+							  &state->nelems);
+		}
+
+		ScanKeyEntryInitializeWithInfo(&qpi->scankeys[qpi->nscankeys++],
+									   c->constisnull ? SK_ISNULL : 0,
+									   relvar->varattno,
+									   InvalidStrategy,
+									   InvalidOid,
+									   saop->inputcollid,
+									   &finfo,
+									   PointerGetDatum(state));
+	}
+
+	qpi->scankey_quals = lappend(qpi->scankey_quals, saop);
+
+	return false;
+}
+
 /*
  * Utility function to extract quals that can be used as scankeys.
 
@@ -311,10 +458,11 @@ process_scan_key_quals(QualProcessState *qpi, const List *quals)
 					break;
 				case T_ScalarArrayOpExpr:
 					/*
-					 * Currently cannot pushing down "foo IN (1, 3)". The
-					 * expression can be transformed into a scankey, but it
-					 * only works for index scans.
+					 * "foo IN (1, 3)"
+					 *
+					 * Only pushed down for segmentby columns.
 					 */
+					keep_qual = process_saopexpr(qpi, castNode(ScalarArrayOpExpr, qual));
 					break;
 				case T_NullTest:
 					/*
@@ -755,22 +903,31 @@ columnar_scan_begin(CustomScanState *state, EState *estate, int eflags)
 	state->ss.ps.qual = ExecInitQual(state->ss.ps.plan->qual, (PlanState *) state);
 #endif
 	List *vectorized_quals_constified = NIL;
+	PlannerGlobal glob = {
+		.boundParams = state->ss.ps.state->es_param_list_info,
+	};
+	PlannerInfo root = {
+		.glob = &glob,
+	};
+	ListCell *lc;
 
 	if (cstate->nscankeys > 0)
 	{
 		const HypercoreInfo *hsinfo = RelationGetHypercoreInfo(state->ss.ss_currentRelation);
 		Scan *scan = (Scan *) state->ss.ps.plan;
+		List *scankey_quals_constified = NIL;
+
+		/* Replace the external parameters with their values */
+		foreach (lc, cstate->scankey_quals)
+		{
+			Node *constified = estimate_expression_value(&root, (Node *) lfirst(lc));
+			scankey_quals_constified = lappend(scankey_quals_constified, constified);
+		}
+
 		cstate->scankeys =
-			create_scankeys_from_quals(hsinfo, scan->scanrelid, cstate->scankey_quals);
+			create_scankeys_from_quals(hsinfo, scan->scanrelid, scankey_quals_constified);
 	}
 
-	PlannerGlobal glob = {
-		.boundParams = state->ss.ps.state->es_param_list_info,
-	};
-	PlannerInfo root = {
-		.glob = &glob,
-	};
-	ListCell *lc;
 	foreach (lc, cstate->vectorized_quals_orig)
 	{
 		Node *constified = estimate_expression_value(&root, (Node *) lfirst(lc));
@@ -801,11 +958,43 @@ columnar_scan_begin(CustomScanState *state, EState *estate, int eflags)
 		state->ss.ps.plan->qual = list_concat(state->ss.ps.plan->qual, cstate->segmentby_quals);
 }
 
+/*
+ * Add the work of the arrow cache of the scan to the cumulative statistics of
+ * the hypertable. The batches and filters are not counted, the table access
+ * method reads the compressed tuples.
+ */
+static void
+columnar_scan_report_stats(CustomScanState *state)
+{
+	TupleTableSlot *slot = state->ss.ss_ScanTupleSlot;
+	int64 counters[COMPRESSED_SCAN_STATS_NUM_COUNTERS] = { 0 };
+
+	if (state->ss.ss_currentScanDesc == NULL || slot == NULL || !TTS_IS_ARROWTUPLE(slot))
+		return;
+
+	const ArrowColumnCache *acache = &((ArrowTupleTableSlot *) slot)->arrow_cache;
+	if (acache->hits == 0 && acache->misses == 0)
+		return;
+
+	const int32 hypertable_id =
+		ts_chunk_get_hypertable_id_by_reloid(RelationGetRelid(state->ss.ss_currentRelation));
+	if (hypertable_id == 0)
+		return;
+
+	counters[COMPRESSED_SCAN_STATS_SCANS] = 1;
+	counters[COMPRESSED_SCAN_STATS_DECOMPRESSED_ROWS] = acache->decompressed_rows;
+	counters[COMPRESSED_SCAN_STATS_CACHE_HITS] = acache->hits;
+	counters[COMPRESSED_SCAN_STATS_CACHE_MISSES] = acache->misses;
+	ts_compressed_scan_stats_report(hypertable_id, NULL, counters);
+}
+
 static void
 columnar_scan_end(CustomScanState *state)
 {
 	TableScanDesc scandesc = state->ss.ss_currentScanDesc;
 
+	columnar_scan_report_stats(state);
+
 	/*
 	 * Free the exprcontext. Not needed for PG17.
 	 */
@@ -0,0 +1,144 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include <postgres.h>
+
+#include <utils/memutils.h>
+
+#include "batch_cache.h"
+
+typedef struct DecompressBatchCacheKey
+{
+	ItemPointerData compressed_tid;
+	int column_index;
+} DecompressBatchCacheKey;
+
+typedef struct DecompressBatchCacheEntry
+{
+	DecompressBatchCacheKey key;
+	dlist_node node; /* List link in the LRU list. */
+
+	/* The memory context that holds the arrow array and all its buffers. */
+	MemoryContext mcxt;
+	Size bytes;
+
+	ArrowArray *arrow;
+	bool arithmetic_sequence;
+} DecompressBatchCacheEntry;
+
+DecompressBatchCache *
+decompress_batch_cache_create(MemoryContext parent, Size max_bytes)
+{
+	MemoryContext mcxt =
+		AllocSetContextCreate(parent, "DecompressChunk batch cache", ALLOCSET_DEFAULT_SIZES);
+	DecompressBatchCache *cache = MemoryContextAllocZero(mcxt, sizeof(DecompressBatchCache));
+
+	HASHCTL ctl = {
+		.keysize = sizeof(DecompressBatchCacheKey),
+		.entrysize = sizeof(DecompressBatchCacheEntry),
+		.hcxt = mcxt,
+	};
+
+	cache->mcxt = mcxt;
+	cache->htab = hash_create("DecompressChunk batch cache",
+							  64,
+							  &ctl,
+							  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	dlist_init(&cache->lru);
+	cache->max_bytes = max_bytes;
+
+	return cache;
+}
+
+/*
+ * Find the cached decompressed column. Returns NULL if it is not in the cache.
+ */
+ArrowArray *
+decompress_batch_cache_lookup(DecompressBatchCache *cache, ItemPointer compressed_tid,
+							  int column_index, bool *arithmetic_sequence)
+{
+	DecompressBatchCacheKey key;
+
+	/* Zero the padding, since the key is hashed as a blob. */
+	memset(&key, 0, sizeof(key));
+	key.compressed_tid = *compressed_tid;
+	key.column_index = column_index;
+
+	DecompressBatchCacheEntry *entry = hash_search(cache->htab, &key, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		cache->misses++;
+		return NULL;
+	}
+
+	cache->hits++;
+	dlist_move_tail(&cache->lru, &entry->node);
+	*arithmetic_sequence = entry->arithmetic_sequence;
+	return entry->arrow;
+}
+
+/*
+ * Add the decompressed column to the cache. The arrow_context must contain
+ * only this arrow array, and is a child of the per-batch memory context. If
+ * the column fits into the cache, the context is moved to the cache memory
+ * context. Otherwise, it is left as is and goes away with the batch.
+ */
+void
+decompress_batch_cache_insert(DecompressBatchCache *cache, ItemPointer compressed_tid,
+							  int column_index, MemoryContext arrow_context, ArrowArray *arrow,
+							  bool arithmetic_sequence)
+{
+	const Size bytes = MemoryContextMemAllocated(arrow_context, /* recurse = */ true);
+	if (bytes > cache->max_bytes)
+	{
+		return;
+	}
+
+	/*
+	 * Evict the least recently used entries until the new one fits. The
+	 * other columns of the current batch might be in use, so we don't evict
+	 * them.
+	 */
+	while (cache->used_bytes + bytes > cache->max_bytes && !dlist_is_empty(&cache->lru))
+	{
+		DecompressBatchCacheEntry *victim =
+			dlist_head_element(DecompressBatchCacheEntry, node, &cache->lru);
+		if (ItemPointerEquals(&victim->key.compressed_tid, compressed_tid))
+		{
+			break;
+		}
+
+		dlist_delete(&victim->node);
+		MemoryContextDelete(victim->mcxt);
+		cache->used_bytes -= victim->bytes;
+		cache->evictions++;
+
+		if (!hash_search(cache->htab, &victim->key, HASH_REMOVE, NULL))
+			elog(ERROR, "LRU cache for decompressed batches corrupt");
+	}
+
+	if (cache->used_bytes + bytes > cache->max_bytes)
+	{
+		return;
+	}
+
+	DecompressBatchCacheKey key;
+	memset(&key, 0, sizeof(key));
+	key.compressed_tid = *compressed_tid;
+	key.column_index = column_index;
+
+	bool found;
+	DecompressBatchCacheEntry *entry = hash_search(cache->htab, &key, HASH_ENTER, &found);
+	Assert(!found);
+
+	MemoryContextSetParent(arrow_context, cache->mcxt);
+	entry->mcxt = arrow_context;
+	entry->bytes = bytes;
+	entry->arrow = arrow;
+	entry->arithmetic_sequence = arithmetic_sequence;
+	dlist_push_tail(&cache->lru, &entry->node);
+	cache->used_bytes += bytes;
+}
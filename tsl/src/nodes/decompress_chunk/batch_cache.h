@@ -0,0 +1,42 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <lib/ilist.h>
+#include <storage/itemptr.h>
+#include <utils/hsearch.h>
+
+#include "compression/arrow_c_data_interface.h"
+
+/*
+ * The cache of the decompressed columns of compressed batches, which is kept
+ * across the rescans of a DecompressChunk node, e.g. on the inner side of a
+ * nested loop join. The entries are keyed by the TID of the compressed tuple
+ * and the index of the column, and are evicted in the LRU order when the
+ * total memory used by the cached columns exceeds the limit.
+ */
+typedef struct DecompressBatchCache
+{
+	MemoryContext mcxt;
+	HTAB *htab;
+	dlist_head lru; /* Least recently used entries go first. */
+	Size max_bytes;
+	Size used_bytes;
+
+	/* Statistics for EXPLAIN ANALYZE. */
+	uint64 hits;
+	uint64 misses;
+	uint64 evictions;
+} DecompressBatchCache;
+
+extern DecompressBatchCache *decompress_batch_cache_create(MemoryContext parent, Size max_bytes);
+extern ArrowArray *decompress_batch_cache_lookup(DecompressBatchCache *cache,
+												 ItemPointer compressed_tid, int column_index,
+												 bool *arithmetic_sequence);
+extern void decompress_batch_cache_insert(DecompressBatchCache *cache, ItemPointer compressed_tid,
+										  int column_index, MemoryContext arrow_context,
+										  ArrowArray *arrow, bool arithmetic_sequence);
@@ -4,7 +4,6 @@
  * LICENSE-TIMESCALE for a copy of the license.
  */
 #include <postgres.h>
-#include <lib/binaryheap.h>
 #include <nodes/bitmapset.h>
 
 #include "compression/compression.h"
@@ -18,10 +17,28 @@ typedef struct
 	bool null;
 } HeapEntryColumn;
 
-typedef struct BatchQueueHeap
+typedef struct BatchQueueHeap BatchQueueHeap;
+
+typedef void (*TournamentUpdateFunc)(BatchQueueHeap *queue, int batch_index, bool active);
+
+struct BatchQueueHeap
 {
 	BatchQueue queue;
-	binaryheap *merge_heap; /* Binary heap of slot indices */
+
+	/*
+	 * The batches are merged using a tournament tree of batch indices, which
+	 * needs only one comparison per level to replace the top tuple, unlike the
+	 * sift-down in a binary heap that needs two. The tree has a leaf for every
+	 * batch state in the batch array, so the capacity is the number of batch
+	 * states which is always a power of two. The root is tournament[1], the
+	 * children of the node i are 2i and 2i + 1, and the leaf of the batch b is
+	 * tournament[capacity + b]. Every entry is the index of the batch with the
+	 * smallest current tuple in the respective subtree, or -1 if there are no
+	 * active batches in it.
+	 */
+	int *tournament;
+	int tournament_capacity;
+	TournamentUpdateFunc tournament_update;
 
 	/*
 	 * Requested sort order of the heap.
@@ -30,11 +47,9 @@ typedef struct BatchQueueHeap
 	SortSupport sortkeys;
 
 	/*
-	 * This is the actual entries of the heap we're going to compare. We're using
-	 * these minimal structures for better memory locality instead of addressing
-	 * the entire compressed batches. Would be even better to put them into the
-	 * heap inline, but unfortunately the Postgres binary heap doesn't support
-	 * this.
+	 * This is the actual entries of the tournament we're going to compare. We're
+	 * using these minimal structures for better memory locality instead of
+	 * addressing the entire compressed batches.
 	 *
 	 * For each batch, we have nkeys of HeapEntryColumn values, which contain
 	 * the latest decompressed values.
@@ -46,7 +61,7 @@ typedef struct BatchQueueHeap
 	 */
 	TupleTableSlot *last_batch_first_tuple_slot;
 	HeapEntryColumn *last_batch_first_tuple_entry;
-} BatchQueueHeap;
+};
 
 /*
  * Compare heap entries for two batches. This function is used for comparing the
@@ -80,16 +95,11 @@ compare_entries(HeapEntryColumn *entryA, HeapEntryColumn *entryB, const SortSupp
  * for comparison of the first tuple, like tuplesort.
  */
 static pg_attribute_always_inline int32
-compare_heap_pos_impl(Datum a, Datum b, void *arg,
-					  int32 (*apply_first_datum_comparator)(Datum, bool, Datum, bool, SortSupport))
+compare_batches_impl(BatchQueueHeap *queue, int batchA, int batchB,
+					 int32 (*apply_first_datum_comparator)(Datum, bool, Datum, bool, SortSupport))
 {
-	BatchQueueHeap *queue = (BatchQueueHeap *) arg;
-	PG_USED_FOR_ASSERTS_ONLY BatchArray *batch_array = &queue->queue.batch_array;
-	int batchA = DatumGetInt32(a);
-	Assert(batchA <= batch_array->n_batch_states);
-
-	int batchB = DatumGetInt32(b);
-	Assert(batchB <= batch_array->n_batch_states);
+	Assert(batchA < queue->queue.batch_array.n_batch_states);
+	Assert(batchB < queue->queue.batch_array.n_batch_states);
 
 	const int nkeys = queue->nkeys;
 	SortSupport sortkeys = queue->sortkeys;
@@ -104,7 +114,6 @@ compare_heap_pos_impl(Datum a, Datum b, void *arg,
 											   &sortkeys[0]);
 	if (compare != 0)
 	{
-		INVERT_COMPARE_RESULT(compare);
 		return compare;
 	}
 
@@ -118,7 +127,6 @@ compare_heap_pos_impl(Datum a, Datum b, void *arg,
 
 		if (compare != 0)
 		{
-			INVERT_COMPARE_RESULT(compare);
 			return compare;
 		}
 	}
@@ -126,45 +134,123 @@ compare_heap_pos_impl(Datum a, Datum b, void *arg,
 	return 0;
 }
 
-static int32
-compare_heap_pos_generic(Datum a, Datum b, void *arg)
+/*
+ * Play one match of the tournament. The batch index -1 means there is no active
+ * batch in the subtree.
+ */
+static pg_attribute_always_inline int
+tournament_winner(BatchQueueHeap *queue, int batchA, int batchB,
+				  int32 (*apply_first_datum_comparator)(Datum, bool, Datum, bool, SortSupport))
 {
-	return compare_heap_pos_impl(a, b, arg, ApplySortComparator);
+	if (batchA < 0)
+	{
+		return batchB;
+	}
+
+	if (batchB < 0)
+	{
+		return batchA;
+	}
+
+	return compare_batches_impl(queue, batchA, batchB, apply_first_datum_comparator) <= 0 ?
+			   batchA :
+			   batchB;
 }
 
-static int32
-compare_heap_pos_int32(Datum a, Datum b, void *arg)
+/*
+ * Set the leaf of the given batch, and replay the matches on the path from it
+ * to the root.
+ */
+static pg_attribute_always_inline void
+tournament_update_impl(BatchQueueHeap *queue, int batch_index, bool active,
+					   int32 (*apply_first_datum_comparator)(Datum, bool, Datum, bool,
+															 SortSupport))
 {
-	return compare_heap_pos_impl(a, b, arg, ApplyInt32SortComparator);
+	int *tournament = queue->tournament;
+	Assert(batch_index < queue->tournament_capacity);
+
+	int node = queue->tournament_capacity + batch_index;
+	tournament[node] = active ? batch_index : -1;
+
+	for (node = node / 2; node >= 1; node = node / 2)
+	{
+		tournament[node] = tournament_winner(queue,
+											 tournament[2 * node],
+											 tournament[2 * node + 1],
+											 apply_first_datum_comparator);
+	}
+}
+
+static void
+tournament_update_generic(BatchQueueHeap *queue, int batch_index, bool active)
+{
+	tournament_update_impl(queue, batch_index, active, ApplySortComparator);
+}
+
+static void
+tournament_update_int32(BatchQueueHeap *queue, int batch_index, bool active)
+{
+	tournament_update_impl(queue, batch_index, active, ApplyInt32SortComparator);
 }
 
 #if SIZEOF_DATUM >= 8
-static int32
-compare_heap_pos_signed(Datum a, Datum b, void *arg)
+static void
+tournament_update_signed(BatchQueueHeap *queue, int batch_index, bool active)
 {
-	return compare_heap_pos_impl(a, b, arg, ApplySignedSortComparator);
+	tournament_update_impl(queue, batch_index, active, ApplySignedSortComparator);
 }
 #endif
 
-/* Add a new datum to the heap and perform an automatic resizing if needed. In contrast to
- * the binaryheap_add_unordered() function, the capacity of the heap is automatically
- * increased if needed.
+static inline int
+tournament_top(BatchQueueHeap *queue)
+{
+	return queue->tournament[1];
+}
+
+/*
+ * Resize the tournament to match the current number of batch states, keeping
+ * the active batches. This happens rarely, because the batch array grows by
+ * doubling, so we just replay all the matches.
  */
-static pg_nodiscard binaryheap *
-binaryheap_add_unordered_autoresize(binaryheap *heap, Datum d)
+static void
+tournament_resize(BatchQueueHeap *queue)
 {
-	/* Resize heap if needed */
-	if (heap->bh_size >= heap->bh_space)
+	const int old_capacity = queue->tournament_capacity;
+	const int new_capacity = queue->queue.batch_array.n_batch_states;
+	Assert(new_capacity > old_capacity);
+	Assert((new_capacity & (new_capacity - 1)) == 0);
+
+	int *new_tournament = palloc(sizeof(int) * 2 * new_capacity);
+	for (int i = 0; i < 2 * new_capacity; i++)
+	{
+		new_tournament[i] = -1;
+	}
+
+	for (int i = 0; i < old_capacity; i++)
+	{
+		new_tournament[new_capacity + i] = queue->tournament[old_capacity + i];
+	}
+
+	for (int node = new_capacity - 1; node >= 1; node--)
 	{
-		heap->bh_space = heap->bh_space * 2;
-		Size new_size = offsetof(binaryheap, bh_nodes) + (sizeof(Datum) * heap->bh_space);
-		heap = (binaryheap *) repalloc(heap, new_size);
+		new_tournament[node] = tournament_winner(queue,
+												 new_tournament[2 * node],
+												 new_tournament[2 * node + 1],
+												 ApplySortComparator);
 	}
 
-	/* Insert new element */
-	binaryheap_add(heap, d);
+	pfree(queue->tournament);
+	queue->tournament = new_tournament;
+	queue->tournament_capacity = new_capacity;
+}
 
-	return heap;
+static void
+tournament_reset(BatchQueueHeap *queue)
+{
+	for (int i = 0; i < 2 * queue->tournament_capacity; i++)
+	{
+		queue->tournament[i] = -1;
+	}
 }
 
 static void
@@ -173,13 +259,13 @@ batch_queue_heap_pop(BatchQueue *bq, DecompressContext *dcontext)
 	BatchQueueHeap *queue = (BatchQueueHeap *) bq;
 	BatchArray *batch_array = &bq->batch_array;
 
-	if (binaryheap_empty(queue->merge_heap))
+	const int top_batch_index = tournament_top(queue);
+	if (top_batch_index < 0)
 	{
-		/* Allow this function to be called on the initial empty heap. */
+		/* Allow this function to be called on the initial empty queue. */
 		return;
 	}
 
-	const int top_batch_index = DatumGetInt32(binaryheap_first(queue->merge_heap));
 	DecompressBatchState *top_batch = batch_array_get_at(batch_array, top_batch_index);
 
 	compressed_batch_advance(dcontext, top_batch);
@@ -188,7 +274,7 @@ batch_queue_heap_pop(BatchQueue *bq, DecompressContext *dcontext)
 	if (TupIsNull(top_tuple))
 	{
 		/* Batch is exhausted, recycle batch_state */
-		(void) binaryheap_remove_first(queue->merge_heap);
+		queue->tournament_update(queue, top_batch_index, /* active = */ false);
 		batch_array_clear_at(batch_array, top_batch_index);
 	}
 	else
@@ -211,8 +297,8 @@ batch_queue_heap_pop(BatchQueue *bq, DecompressContext *dcontext)
 				top_tuple->tts_isnull[attr];
 		}
 
-		/* Place this batch on the heap according to its new decompressed tuple. */
-		binaryheap_replace_first(queue->merge_heap, Int32GetDatum(top_batch_index));
+		/* Replay the tournament according to its new decompressed tuple. */
+		queue->tournament_update(queue, top_batch_index, /* active = */ true);
 	}
 }
 
@@ -221,12 +307,12 @@ batch_queue_heap_needs_next_batch(BatchQueue *_queue)
 {
 	BatchQueueHeap *queue = (BatchQueueHeap *) _queue;
 
-	if (binaryheap_empty(queue->merge_heap))
+	const int top_batch_index = tournament_top(queue);
+	if (top_batch_index < 0)
 	{
 		return true;
 	}
 
-	const int top_batch_index = DatumGetInt32(binaryheap_first(queue->merge_heap));
 	const int comparison_result =
 		compare_entries(&queue->heap_entries[queue->nkeys * top_batch_index],
 						queue->last_batch_first_tuple_entry,
@@ -263,6 +349,7 @@ batch_queue_heap_push_batch(BatchQueue *_queue, DecompressContext *dcontext,
 		queue->heap_entries =
 			repalloc(queue->heap_entries,
 					 sizeof(HeapEntryColumn) * queue->nkeys * batch_array->n_batch_states);
+		tournament_resize(queue);
 	}
 	DecompressBatchState *batch_state = batch_array_get_at(batch_array, new_batch_index);
 
@@ -313,9 +400,9 @@ batch_queue_heap_push_batch(BatchQueue *_queue, DecompressContext *dcontext,
 	}
 
 	/*
-	 * Put the batch on the heap.
+	 * Put the batch into the tournament.
 	 */
-	queue->merge_heap = binaryheap_add_unordered_autoresize(queue->merge_heap, new_batch_index);
+	queue->tournament_update(queue, new_batch_index, /* active = */ true);
 }
 
 static TupleTableSlot *
@@ -324,12 +411,12 @@ batch_queue_heap_top_tuple(BatchQueue *bq)
 	BatchQueueHeap *bqh = (BatchQueueHeap *) bq;
 	BatchArray *batch_array = &bq->batch_array;
 
-	if (binaryheap_empty(bqh->merge_heap))
+	const int top_batch_index = tournament_top(bqh);
+	if (top_batch_index < 0)
 	{
 		return NULL;
 	}
 
-	const int top_batch_index = DatumGetInt32(binaryheap_first(bqh->merge_heap));
 	DecompressBatchState *top_batch = batch_array_get_at(batch_array, top_batch_index);
 	TupleTableSlot *top_tuple = compressed_batch_current_tuple(top_batch);
 	Assert(!TupIsNull(top_tuple));
@@ -340,11 +427,11 @@ static void
 batch_queue_heap_reset(BatchQueue *bq)
 {
 	BatchQueueHeap *bqh = (BatchQueueHeap *) bq;
-	binaryheap_reset(bqh->merge_heap);
+	tournament_reset(bqh);
 }
 
 /*
- * Free the binary heap.
+ * Free the tournament tree.
  */
 static void
 batch_queue_heap_free(BatchQueue *_queue)
@@ -352,12 +439,12 @@ batch_queue_heap_free(BatchQueue *_queue)
 	BatchQueueHeap *queue = (BatchQueueHeap *) _queue;
 	BatchArray *batch_array = &queue->queue.batch_array;
 
-	elog(DEBUG3, "heap has capacity of %d", queue->merge_heap->bh_space);
+	elog(DEBUG3, "tournament has capacity of %d", queue->tournament_capacity);
 	elog(DEBUG3, "created batch states %d", batch_array->n_batch_states);
 	batch_array_clear_all(batch_array);
 	pfree(queue->heap_entries);
-	binaryheap_free(queue->merge_heap);
-	queue->merge_heap = NULL;
+	pfree(queue->tournament);
+	queue->tournament = NULL;
 	pfree(queue->sortkeys);
 	ExecDropSingleTupleTableSlot(queue->last_batch_first_tuple_slot);
 	pfree(queue->last_batch_first_tuple_entry);
@@ -436,19 +523,21 @@ batch_queue_heap_create(int num_compressed_cols, const List *sortinfo,
 	 * batch sorted merge doesn't use, so we use a generic comparator in this
 	 * case.
 	 */
-	binaryheap_comparator comparator = compare_heap_pos_generic;
+	queue->tournament_update = tournament_update_generic;
 	if (queue->sortkeys[0].comparator == ssup_datum_int32_cmp)
 	{
-		comparator = compare_heap_pos_int32;
+		queue->tournament_update = tournament_update_int32;
 	}
 #if SIZEOF_DATUM >= 8
 	else if (queue->sortkeys[0].comparator == ssup_datum_signed_cmp)
 	{
-		comparator = compare_heap_pos_signed;
+		queue->tournament_update = tournament_update_signed;
 	}
 #endif
 
-	queue->merge_heap = binaryheap_allocate(INITIAL_BATCH_CAPACITY, comparator, queue);
+	queue->tournament_capacity = INITIAL_BATCH_CAPACITY;
+	queue->tournament = palloc(sizeof(int) * 2 * queue->tournament_capacity);
+	tournament_reset(queue);
 	queue->last_batch_first_tuple_slot = MakeSingleTupleTableSlot(result_tupdesc, &TTSOpsVirtual);
 	queue->last_batch_first_tuple_entry = palloc(sizeof(HeapEntryColumn) * queue->nkeys);
 	queue->queue.funcs = funcs;
@@ -6,12 +6,17 @@
 
 #include <postgres.h>
 
+#include <executor/instrument.h>
 #include <executor/tuptable.h>
 #include <nodes/bitmapset.h>
 #include <utils/builtins.h>
 #include <utils/date.h>
+#include <utils/memutils.h>
 #include <utils/timestamp.h>
+#include <utils/uuid.h>
 
+#include "compression/algorithms/deltadelta.h"
+#include "compression/algorithms/jsonb_shred.h"
 #include "compression/arrow_c_data_interface.h"
 #include "compression/compression.h"
 #include "debug_assert.h"
@@ -19,6 +24,7 @@
 #include "nodes/decompress_chunk/compressed_batch.h"
 #include "nodes/decompress_chunk/vector_predicates.h"
 #include "nodes/decompress_chunk/vector_quals.h"
+#include "trace.h"
 
 /*
  * Create a single-value ArrowArray of an arithmetic type. This is a specialized
@@ -72,6 +78,10 @@ make_single_value_arrow_arithmetic(Oid arithmetic_type, Datum datum, bool isnull
 		FOR_TYPE(TIMESTAMPTZOID, TimestampTz, DatumGetTimestampTz);
 		FOR_TYPE(TIMESTAMPOID, Timestamp, DatumGetTimestamp);
 		FOR_TYPE(DATEOID, DateADT, DatumGetDateADT);
+		case UUIDOID:
+			/* The UUIDs use the same fixed-width layout, but are by-reference. */
+			memcpy(with_buffers->values_buffer, DatumGetUUIDP(datum)->data, UUID_LEN);
+			break;
 		default:
 			elog(ERROR, "unexpected column type '%s'", format_type_be(arithmetic_type));
 			pg_unreachable();
@@ -157,6 +167,78 @@ get_max_text_datum_size(ArrowArray *text_array)
 	return maxbytes;
 }
 
+/*
+ * Set up the column values for reading the decompressed arrow array.
+ */
+static void
+set_arrow_column_values(DecompressBatchState *batch_state, CompressedColumnValues *column_values,
+						int value_bytes, ArrowArray *arrow)
+{
+	/* Should have been filled from the count metadata column. */
+	Assert(batch_state->total_batch_rows != 0);
+	if (batch_state->total_batch_rows != arrow->length)
+	{
+		elog(ERROR, "compressed column out of sync with batch counter");
+	}
+
+	column_values->arrow = arrow;
+
+	if (value_bytes > 0)
+	{
+		/* Fixed-width column. */
+		column_values->decompression_type = value_bytes;
+		column_values->buffers[0] = arrow->buffers[0];
+		column_values->buffers[1] = arrow->buffers[1];
+		column_values->buffers[2] = NULL;
+		column_values->buffers[3] = NULL;
+	}
+	else
+	{
+		/*
+		 * Text column. Pre-allocate memory for its text Datum in the
+		 * decompressed scan slot. We can't put direct references to Arrow
+		 * memory there, because it doesn't have the varlena headers that
+		 * Postgres expects for text.
+		 */
+		const int maxbytes =
+			VARHDRSZ + (arrow->dictionary ? get_max_text_datum_size(arrow->dictionary) :
+											get_max_text_datum_size(arrow));
+
+		*column_values->output_value =
+			PointerGetDatum(MemoryContextAlloc(batch_state->per_batch_context, maxbytes));
+
+		/*
+		 * Set up the datum conversion based on whether we use the dictionary.
+		 */
+		if (arrow->dictionary == NULL)
+		{
+			column_values->decompression_type = DT_ArrowText;
+			column_values->buffers[0] = arrow->buffers[0];
+			column_values->buffers[1] = arrow->buffers[1];
+			column_values->buffers[2] = arrow->buffers[2];
+			column_values->buffers[3] = NULL;
+		}
+		else
+		{
+			column_values->decompression_type = DT_ArrowTextDict;
+			column_values->buffers[0] = arrow->buffers[0];
+			column_values->buffers[1] = arrow->dictionary->buffers[1];
+			column_values->buffers[2] = arrow->dictionary->buffers[2];
+			column_values->buffers[3] = arrow->buffers[1];
+		}
+	}
+}
+
+/*
+ * Whether to measure the times of the decompression work for EXPLAIN ANALYZE.
+ */
+static inline bool
+decompress_stats_timing(const DecompressContext *dcontext)
+{
+	return ts_guc_enable_decompression_stats && dcontext->ps != NULL &&
+		   dcontext->ps->instrument != NULL && dcontext->ps->instrument->need_timer;
+}
+
 static void
 decompress_column(DecompressContext *dcontext, DecompressBatchState *batch_state,
 				  TupleTableSlot *compressed_slot, int i)
@@ -164,6 +246,7 @@ decompress_column(DecompressContext *dcontext, DecompressBatchState *batch_state
 	CompressionColumnDescription *column_description = &dcontext->compressed_chunk_columns[i];
 	CompressedColumnValues *column_values = &batch_state->compressed_columns[i];
 	column_values->arrow = NULL;
+	column_values->arithmetic_sequence = false;
 	const AttrNumber attr = AttrNumberGetAttrOffset(column_description->custom_scan_attno);
 	column_values->output_value = &compressed_batch_current_tuple(batch_state)->tts_values[attr];
 	column_values->output_isnull = &compressed_batch_current_tuple(batch_state)->tts_isnull[attr];
@@ -192,11 +275,47 @@ decompress_column(DecompressContext *dcontext, DecompressBatchState *batch_state
 		return;
 	}
 
+	/*
+	 * The column might be already decompressed by a previous scan of the same
+	 * compressed tuple, if we cache the batches across rescans.
+	 */
+	const bool use_batch_cache = dcontext->batch_cache != NULL &&
+								 dcontext->enable_bulk_decompression &&
+								 column_description->bulk_decompression_supported &&
+								 ItemPointerIsValid(&compressed_slot->tts_tid);
+	if (use_batch_cache)
+	{
+		bool arithmetic_sequence = false;
+		ArrowArray *cached = decompress_batch_cache_lookup(dcontext->batch_cache,
+														   &compressed_slot->tts_tid,
+														   i,
+														   &arithmetic_sequence);
+		if (cached != NULL)
+		{
+			set_arrow_column_values(batch_state, column_values, value_bytes, cached);
+			column_values->arithmetic_sequence = arithmetic_sequence;
+			return;
+		}
+	}
+
 	/* Detoast the compressed datum. */
+	const bool timing = decompress_stats_timing(dcontext);
+	instr_time start = { 0 };
+	instr_time end;
+	if (timing)
+		INSTR_TIME_SET_CURRENT(start);
+
 	value = PointerGetDatum(detoaster_detoast_attr_copy((struct varlena *) DatumGetPointer(value),
 														&dcontext->detoaster,
 														batch_state->per_batch_context));
 
+	if (timing)
+	{
+		INSTR_TIME_SET_CURRENT(end);
+		INSTR_TIME_ACCUM_DIFF(dcontext->stats.detoast_time, end, start);
+	}
+	dcontext->stats.bytes_detoasted += VARSIZE_ANY(DatumGetPointer(value));
+
 	CompressedDataHeader *header = (CompressedDataHeader *) value;
 
 	/* First check if this is a block of NULL values. */
@@ -210,6 +329,7 @@ decompress_column(DecompressContext *dcontext, DecompressBatchState *batch_state
 
 	/* Decompress the entire batch if it is supported. */
 	ArrowArray *arrow = NULL;
+	bool arithmetic_sequence = false;
 	if (dcontext->enable_bulk_decompression && column_description->bulk_decompression_supported)
 	{
 		if (dcontext->bulk_decompression_context == NULL)
@@ -223,22 +343,66 @@ decompress_column(DecompressContext *dcontext, DecompressBatchState *batch_state
 											column_description->typid);
 		Assert(decompress_all != NULL);
 
+		/*
+		 * For caching, the decompressed column must have its own memory
+		 * context, so that it can be moved into the cache.
+		 */
+		MemoryContext arrow_context = batch_state->per_batch_context;
+		if (use_batch_cache)
+		{
+			arrow_context = AllocSetContextCreate(batch_state->per_batch_context,
+												  "DecompressChunk cached column",
+												  ALLOCSET_START_SMALL_SIZES);
+		}
+
 		MemoryContext context_before_decompression =
 			MemoryContextSwitchTo(dcontext->bulk_decompression_context);
 
-		arrow = decompress_all(PointerGetDatum(header),
-							   column_description->typid,
-							   batch_state->per_batch_context);
+		if (timing)
+			INSTR_TIME_SET_CURRENT(start);
+
+		arrow = decompress_all(PointerGetDatum(header), column_description->typid, arrow_context);
+
+		if (timing)
+		{
+			INSTR_TIME_SET_CURRENT(end);
+			INSTR_TIME_ACCUM_DIFF(dcontext->stats.decompress_time, end, start);
+		}
 
 		MemoryContextSwitchTo(context_before_decompression);
 
 		MemoryContextReset(dcontext->bulk_decompression_context);
+
+		if (arrow != NULL)
+		{
+			dcontext->stats.bulk_rows += arrow->length;
+			dcontext->stats.column_rows[i] += arrow->length;
+
+			int64 first;
+			int64 step;
+			arithmetic_sequence =
+				value_bytes > 0 &&
+				header->compression_algorithm == COMPRESSION_ALGORITHM_DELTADELTA &&
+				delta_delta_compressed_get_step(header, &first, &step);
+
+			if (use_batch_cache)
+			{
+				decompress_batch_cache_insert(dcontext->batch_cache,
+											  &compressed_slot->tts_tid,
+											  i,
+											  arrow_context,
+											  arrow,
+											  arithmetic_sequence);
+			}
+		}
 	}
 
 	if (arrow == NULL)
 	{
 		/* As a fallback, decompress row-by-row. */
 		column_values->decompression_type = DT_Iterator;
+		dcontext->stats.iterator_rows += batch_state->total_batch_rows;
+		dcontext->stats.column_rows[i] += batch_state->total_batch_rows;
 		MemoryContext old_context = MemoryContextSwitchTo(batch_state->per_batch_context);
 		column_values->buffers[0] =
 			tsl_get_decompression_iterator_init(header->compression_algorithm,
@@ -248,77 +412,17 @@ decompress_column(DecompressContext *dcontext, DecompressBatchState *batch_state
 		return;
 	}
 
-	/* Should have been filled from the count metadata column. */
-	Assert(batch_state->total_batch_rows != 0);
-	if (batch_state->total_batch_rows != arrow->length)
-	{
-		elog(ERROR, "compressed column out of sync with batch counter");
-	}
-
-	column_values->arrow = arrow;
-
-	if (value_bytes > 0)
-	{
-		/* Fixed-width column. */
-		column_values->decompression_type = value_bytes;
-		column_values->buffers[0] = arrow->buffers[0];
-		column_values->buffers[1] = arrow->buffers[1];
-		column_values->buffers[2] = NULL;
-		column_values->buffers[3] = NULL;
-	}
-	else
-	{
-		/*
-		 * Text column. Pre-allocate memory for its text Datum in the
-		 * decompressed scan slot. We can't put direct references to Arrow
-		 * memory there, because it doesn't have the varlena headers that
-		 * Postgres expects for text.
-		 */
-		const int maxbytes =
-			VARHDRSZ + (arrow->dictionary ? get_max_text_datum_size(arrow->dictionary) :
-											get_max_text_datum_size(arrow));
-
-		*column_values->output_value =
-			PointerGetDatum(MemoryContextAlloc(batch_state->per_batch_context, maxbytes));
-
-		/*
-		 * Set up the datum conversion based on whether we use the dictionary.
-		 */
-		if (arrow->dictionary == NULL)
-		{
-			column_values->decompression_type = DT_ArrowText;
-			column_values->buffers[0] = arrow->buffers[0];
-			column_values->buffers[1] = arrow->buffers[1];
-			column_values->buffers[2] = arrow->buffers[2];
-			column_values->buffers[3] = NULL;
-		}
-		else
-		{
-			column_values->decompression_type = DT_ArrowTextDict;
-			column_values->buffers[0] = arrow->buffers[0];
-			column_values->buffers[1] = arrow->dictionary->buffers[1];
-			column_values->buffers[2] = arrow->dictionary->buffers[2];
-			column_values->buffers[3] = arrow->buffers[1];
-		}
-	}
+	set_arrow_column_values(batch_state, column_values, value_bytes, arrow);
+	column_values->arithmetic_sequence = arithmetic_sequence;
 }
 
 /*
- * Get the arrow array for the compressed batch via the VectorQualState.
- *
- * This is a DecompressChunk-specific implementation of the
- * VectorQualState->get_arrow_array() function used to interface with the
- * vector qual code across different scan nodes.
+ * Find the compressed column referenced by the Var of a vectorized qual.
  */
-const ArrowArray *
-compressed_batch_get_arrow_array(VectorQualState *vqstate, Expr *expr, bool *is_default_value)
+static int
+compressed_batch_find_column(const DecompressContext *dcontext, const Var *var)
 {
-	CompressedBatchVectorQualState *cbvqstate = (CompressedBatchVectorQualState *) vqstate;
-	DecompressContext *dcontext = cbvqstate->dcontext;
-	DecompressBatchState *batch_state = cbvqstate->batch_state;
 	CompressionColumnDescription *column_description = NULL;
-	TupleTableSlot *compressed_slot = vqstate->slot;
-	const Var *var = castNode(Var, expr);
 	int column_index = 0;
 
 	for (; column_index < dcontext->num_data_columns; column_index++)
@@ -359,6 +463,122 @@ compressed_batch_get_arrow_array(VectorQualState *vqstate, Expr *expr, bool *is_
 	Assert(column_description != NULL);
 	Assert(column_description->typid == var->vartype);
 
+	return column_index;
+}
+
+/*
+ * Get the arrow array of the "jsonb_column ->> 'key'" field for the vectorized
+ * quals. This doesn't require decompressing the jsonb column, and if the
+ * column is shredded, reads only the sub-column of the key.
+ */
+static const ArrowArray *
+compressed_batch_get_jsonb_field_arrow_array(CompressedBatchVectorQualState *cbvqstate,
+											 OpExpr *field, bool *is_default_value)
+{
+	DecompressContext *dcontext = cbvqstate->dcontext;
+	DecompressBatchState *batch_state = cbvqstate->batch_state;
+	Const *key = castNode(Const, lsecond(field->args));
+	const int column_index =
+		compressed_batch_find_column(dcontext, castNode(Var, linitial(field->args)));
+	CompressionColumnDescription *column_description =
+		&dcontext->compressed_chunk_columns[column_index];
+
+	bool isnull;
+	Datum value =
+		slot_getattr(cbvqstate->vqstate.slot, column_description->compressed_scan_attno, &isnull);
+
+	if (isnull)
+	{
+		/*
+		 * The column has a default value for the entire batch, compute its
+		 * field.
+		 */
+		Datum field_value = (Datum) 0;
+		Datum default_value = getmissingattr(dcontext->uncompressed_chunk_tdesc,
+											 column_description->uncompressed_chunk_attno,
+											 &isnull);
+		if (!isnull)
+			field_value = jsonb_field_text(default_value, key->constvalue, &isnull);
+
+		*is_default_value = true;
+		return make_single_value_arrow(TEXTOID, field_value, isnull);
+	}
+
+	/* Detoast the compressed datum. */
+	const bool timing = decompress_stats_timing(dcontext);
+	instr_time start = { 0 };
+	instr_time end;
+	if (timing)
+		INSTR_TIME_SET_CURRENT(start);
+
+	value = PointerGetDatum(detoaster_detoast_attr_copy((struct varlena *) DatumGetPointer(value),
+														&dcontext->detoaster,
+														batch_state->per_batch_context));
+
+	if (timing)
+	{
+		INSTR_TIME_SET_CURRENT(end);
+		INSTR_TIME_ACCUM_DIFF(dcontext->stats.detoast_time, end, start);
+	}
+	dcontext->stats.bytes_detoasted += VARSIZE_ANY(DatumGetPointer(value));
+
+	const CompressedDataHeader *header = (const CompressedDataHeader *) value;
+	if (header->compression_algorithm == COMPRESSION_ALGORITHM_NULL)
+	{
+		*is_default_value = true;
+		return make_single_value_arrow(TEXTOID, (Datum) 0, /* isnull = */ true);
+	}
+
+	if (dcontext->bulk_decompression_context == NULL)
+	{
+		dcontext->bulk_decompression_context =
+			create_bulk_decompression_mctx(MemoryContextGetParent(batch_state->per_batch_context));
+	}
+
+	MemoryContext context_before_decompression =
+		MemoryContextSwitchTo(dcontext->bulk_decompression_context);
+
+	ArrowArray *arrow =
+		jsonb_field_text_decompress_all(value, key->constvalue, batch_state->per_batch_context);
+
+	MemoryContextSwitchTo(context_before_decompression);
+
+	MemoryContextReset(dcontext->bulk_decompression_context);
+
+	if (batch_state->total_batch_rows != arrow->length)
+	{
+		elog(ERROR, "compressed column out of sync with batch counter");
+	}
+
+	*is_default_value = false;
+	return arrow;
+}
+
+/*
+ * Get the arrow array for the compressed batch via the VectorQualState.
+ *
+ * This is a DecompressChunk-specific implementation of the
+ * VectorQualState->get_arrow_array() function used to interface with the
+ * vector qual code across different scan nodes.
+ */
+const ArrowArray *
+compressed_batch_get_arrow_array(VectorQualState *vqstate, Expr *expr, bool *is_default_value)
+{
+	CompressedBatchVectorQualState *cbvqstate = (CompressedBatchVectorQualState *) vqstate;
+	DecompressContext *dcontext = cbvqstate->dcontext;
+	DecompressBatchState *batch_state = cbvqstate->batch_state;
+	TupleTableSlot *compressed_slot = vqstate->slot;
+
+	if (!IsA(expr, Var))
+	{
+		return compressed_batch_get_jsonb_field_arrow_array(cbvqstate,
+															castNode(OpExpr, expr),
+															is_default_value);
+	}
+
+	const int column_index = compressed_batch_find_column(dcontext, castNode(Var, expr));
+	CompressionColumnDescription *column_description =
+		&dcontext->compressed_chunk_columns[column_index];
 	CompressedColumnValues *column_values = &batch_state->compressed_columns[column_index];
 
 	if (column_values->decompression_type == DT_Invalid)
@@ -410,6 +630,26 @@ compressed_batch_get_arrow_array(VectorQualState *vqstate, Expr *expr, bool *is_
 	return vector;
 }
 
+/*
+ * Tell whether the decompressed values of the column are known to be
+ * monotonic. This is the VectorQualState->is_monotonic() function for the
+ * compressed batch, and it is used after the column is decompressed by
+ * compressed_batch_get_arrow_array().
+ */
+bool
+compressed_batch_is_monotonic(VectorQualState *vqstate, Expr *expr)
+{
+	CompressedBatchVectorQualState *cbvqstate = (CompressedBatchVectorQualState *) vqstate;
+	if (!IsA(expr, Var))
+	{
+		/* The jsonb fields are not ordered. */
+		return false;
+	}
+
+	const int column_index = compressed_batch_find_column(cbvqstate->dcontext, castNode(Var, expr));
+	return cbvqstate->batch_state->compressed_columns[column_index].arithmetic_sequence;
+}
+
 /*
  * When we have a dictionary-encoded Arrow Array, and have run a predicate on
  * the dictionary, this function is used to translate the dictionary predicate
@@ -489,13 +729,25 @@ compute_plain_qual(VectorQualState *vqstate, TupleTableSlot *slot, Node *qual,
 	}
 
 	/*
-	 * For now, we support NullTest, "Var ? Const" predicates and
-	 * ScalarArrayOperations.
+	 * For now, we support NullTest, "Var ? Const" predicates, IS [NOT]
+	 * DISTINCT FROM and ScalarArrayOperations. IS NOT DISTINCT FROM is
+	 * represented as NOT over IS DISTINCT FROM.
 	 */
+	bool not_distinct = false;
+	if (IsA(qual, BoolExpr))
+	{
+		BoolExpr *boolexpr = castNode(BoolExpr, qual);
+		Ensure(boolexpr->boolop == NOT_EXPR && IsA(linitial(boolexpr->args), DistinctExpr),
+			   "expected IS NOT DISTINCT FROM");
+		not_distinct = true;
+		qual = linitial(boolexpr->args);
+	}
+
 	List *args = NULL;
 	RegProcedure vector_const_opcode = InvalidOid;
 	ScalarArrayOpExpr *saop = NULL;
 	OpExpr *opexpr = NULL;
+	OpExpr *distinct = NULL;
 	NullTest *nulltest = NULL;
 	if (IsA(qual, NullTest))
 	{
@@ -508,6 +760,13 @@ compute_plain_qual(VectorQualState *vqstate, TupleTableSlot *slot, Node *qual,
 		args = saop->args;
 		vector_const_opcode = get_opcode(saop->opno);
 	}
+	else if (IsA(qual, DistinctExpr))
+	{
+		/* DistinctExpr has the same layout as OpExpr, with the equality operator. */
+		distinct = (OpExpr *) qual;
+		args = distinct->args;
+		vector_const_opcode = get_opcode(distinct->opno);
+	}
 	else
 	{
 		Ensure(IsA(qual, OpExpr), "expected OpExpr");
@@ -535,12 +794,42 @@ compute_plain_qual(VectorQualState *vqstate, TupleTableSlot *slot, Node *qual,
 		predicate_result = default_value_predicate_result;
 	}
 
+	/*
+	 * IS DISTINCT FROM is not strict, so the constant can be null, and then it
+	 * is a null test.
+	 */
+	bool distinct_from_null = false;
+	if (distinct)
+	{
+		Ensure(IsA(lsecond(args), Const),
+			   "failed to evaluate runtime constant in vectorized filter");
+		distinct_from_null = castNode(Const, lsecond(args))->constisnull;
+	}
+
 	if (nulltest)
 	{
 		vector_nulltest(vector, nulltest->nulltesttype, predicate_result);
 	}
+	else if (distinct_from_null)
+	{
+		vector_nulltest(vector, not_distinct ? IS_NULL : IS_NOT_NULL, predicate_result);
+	}
 	else
 	{
+		/*
+		 * IS DISTINCT FROM a non-null constant passes the rows that are not
+		 * equal to it, including the null rows, so we compute the equality
+		 * into a separate bitmap and AND its complement to the result.
+		 * IS NOT DISTINCT FROM a non-null constant is the same as equality.
+		 */
+		uint64 equal_result[(GLOBAL_MAX_ROWS_PER_COMPRESSION + 63) / 64];
+		uint64 *const result_before_distinct = predicate_result;
+		if (distinct && !not_distinct)
+		{
+			memset(equal_result, 0xFF, ((vector->length + 63) / 64) * 8);
+			predicate_result = equal_result;
+		}
+
 		/*
 		 * Find the vector_const predicate.
 		 */
@@ -578,17 +867,35 @@ compute_plain_qual(VectorQualState *vqstate, TupleTableSlot *slot, Node *qual,
 			vector_nodict = vector;
 		}
 
+		/*
+		 * The ordering predicates on monotonic values, like the timestamps
+		 * going with a fixed step, are computed with a binary search.
+		 */
+		const bool monotonic = opexpr != NULL && !default_value && vector->dictionary == NULL &&
+							   vector->null_count == 0 && vqstate->is_monotonic != NULL &&
+							   vector_const_predicate_is_ordering(vector_const_opcode) &&
+							   vqstate->is_monotonic(vqstate, expr);
+
 		/*
 		 * At last, compute the predicate.
 		 */
 		if (saop)
 		{
 			vector_array_predicate(vector_const_predicate,
+								   vector_const_opcode,
 								   saop->useOr,
 								   vector_nodict,
 								   constnode->constvalue,
 								   predicate_result_nodict);
 		}
+		else if (monotonic)
+		{
+			vector_monotonic_predicate(vector_const_predicate,
+									   vector_nodict,
+									   get_typlen(castNode(Var, expr)->vartype),
+									   constnode->constvalue,
+									   predicate_result_nodict);
+		}
 		else
 		{
 			vector_const_predicate(vector_nodict, constnode->constvalue, predicate_result_nodict);
@@ -623,6 +930,15 @@ compute_plain_qual(VectorQualState *vqstate, TupleTableSlot *slot, Node *qual,
 		{
 			Assert(vector->null_count == 0);
 		}
+
+		if (predicate_result != result_before_distinct)
+		{
+			for (size_t i = 0; i < n_vector_result_words; i++)
+			{
+				result_before_distinct[i] &= ~predicate_result[i];
+			}
+			predicate_result = result_before_distinct;
+		}
 	}
 
 	/* Translate the result if the column had a default value. */
@@ -711,8 +1027,9 @@ static void
 compute_one_qual(VectorQualState *vqstate, TupleTableSlot *compressed_slot, Node *qual,
 				 uint64 *restrict result)
 {
-	if (!IsA(qual, BoolExpr))
+	if (!IsA(qual, BoolExpr) || castNode(BoolExpr, qual)->boolop == NOT_EXPR)
 	{
+		/* The only NOT we vectorize is IS NOT DISTINCT FROM, a plain qual. */
 		compute_plain_qual(vqstate, compressed_slot, qual, result);
 		return;
 	}
@@ -725,8 +1042,8 @@ compute_one_qual(VectorQualState *vqstate, TupleTableSlot *compressed_slot, Node
 	}
 
 	/*
-	 * Postgres removes NOT for operators we can vectorize, so we don't support
-	 * NOT and consider it non-vectorizable at planning time. So only OR is left.
+	 * Postgres removes NOT for the other operators we can vectorize, so we
+	 * consider it non-vectorizable at planning time. So only OR is left.
 	 */
 	Ensure(boolexpr->boolop == OR_EXPR, "expected OR");
 	compute_qual_disjunction(vqstate, compressed_slot, boolexpr->args, result);
@@ -799,6 +1116,48 @@ compressed_batch_discard_tuples(DecompressBatchState *batch_state)
 	}
 }
 
+/*
+ * Prefetch the toasted compressed datums of the columns that we are going to
+ * decompress, up to the prefetch distance ahead of the current column. The
+ * distance is determined by the effective_io_concurrency of the toast table.
+ * Returns the index of the next column that is not prefetched yet.
+ */
+static int
+prefetch_toasted_columns(DecompressContext *dcontext, DecompressBatchState *batch_state,
+						 TupleTableSlot *compressed_slot, int next_prefetch_column,
+						 int current_column)
+{
+	Detoaster *detoaster = &dcontext->detoaster;
+	const int num_data_columns = dcontext->num_data_columns;
+
+	/*
+	 * The current column is read synchronously anyway. Note that the prefetch
+	 * distance becomes known after the toast table is opened when reading the
+	 * first toasted column.
+	 */
+	next_prefetch_column = Max(next_prefetch_column, current_column + 1);
+	while (next_prefetch_column < num_data_columns &&
+		   next_prefetch_column <= current_column + detoaster->prefetch_distance)
+	{
+		const int i = next_prefetch_column++;
+		if (batch_state->compressed_columns[i].decompression_type != DT_Invalid)
+		{
+			continue;
+		}
+
+		CompressionColumnDescription *column_description = &dcontext->compressed_chunk_columns[i];
+		bool isnull;
+		Datum value =
+			slot_getattr(compressed_slot, column_description->compressed_scan_attno, &isnull);
+		if (!isnull)
+		{
+			detoaster_prefetch((struct varlena *) DatumGetPointer(value), detoaster);
+		}
+	}
+
+	return next_prefetch_column;
+}
+
 /*
  * Initializes the zero-initialized batch state. We do this on demand, because
  * it involves the creation of memory context and tuple slots, which are
@@ -809,6 +1168,7 @@ compressed_batch_lazy_init(DecompressContext *dcontext, DecompressBatchState *ba
 {
 	/* Init memory context */
 	batch_state->per_batch_context = create_per_batch_mctx(dcontext);
+	batch_state->per_batch_context_size = dcontext->per_batch_context_size;
 	Assert(batch_state->per_batch_context != NULL);
 
 	/* Get a reference to the decompressed scan TupleTableSlot */
@@ -854,6 +1214,79 @@ compressed_batch_lazy_init(DecompressContext *dcontext, DecompressBatchState *ba
 	slot->tts_ops->init(slot);
 }
 
+/*
+ * The upper limit for the keeper block of the per-batch context, so that a
+ * single unusually large batch doesn't pin a lot of memory for the rest of
+ * the scan.
+ */
+#define PER_BATCH_CONTEXT_MAX_SIZE (8 * 1024 * 1024)
+
+/*
+ * Prepare the per-batch context for the next batch.
+ *
+ * Resetting the context frees all its blocks except the keeper block, so if
+ * the decompressed columns of a batch don't fit into the keeper block, every
+ * batch mallocs and frees the same amount of memory again. To avoid this, we
+ * remember the largest amount of memory a batch needed, and recreate the
+ * context with a keeper block of this size when it grows. After a few batches
+ * the size settles, and the buffers of the following batches reuse the same
+ * memory. They are allocated without zeroing, because the bulk decompression
+ * functions overwrite the entire buffers anyway.
+ */
+static void
+compressed_batch_recycle_context(DecompressContext *dcontext, DecompressBatchState *batch_state)
+{
+	if (!dcontext->enable_bulk_decompression)
+	{
+		MemoryContextReset(batch_state->per_batch_context);
+		return;
+	}
+
+	const Size allocated = MemoryContextMemAllocated(batch_state->per_batch_context,
+													 /* recurse = */ false);
+	if (allocated > dcontext->per_batch_context_size)
+	{
+		dcontext->per_batch_context_size =
+			Min(TYPEALIGN(64 * 1024, allocated), PER_BATCH_CONTEXT_MAX_SIZE);
+	}
+
+	if (batch_state->per_batch_context_size >= dcontext->per_batch_context_size)
+	{
+		MemoryContextReset(batch_state->per_batch_context);
+		return;
+	}
+
+	MemoryContext old_context =
+		MemoryContextSwitchTo(MemoryContextGetParent(batch_state->per_batch_context));
+	MemoryContextDelete(batch_state->per_batch_context);
+	batch_state->per_batch_context = create_per_batch_mctx(dcontext);
+	batch_state->per_batch_context_size = dcontext->per_batch_context_size;
+	MemoryContextSwitchTo(old_context);
+}
+
+/*
+ * Read the batch min and max of the given column from the compressed tuple
+ * instead of decompressing it.
+ */
+static void
+read_minmax_metadata(const CompressionColumnDescription *column_description,
+					 CompressedColumnValues *column_values, TupleTableSlot *compressed_slot)
+{
+	Assert(column_description->type == COMPRESSED_COLUMN);
+	Assert(column_description->by_value);
+	Assert(column_description->min_metadata_attno != InvalidAttrNumber);
+	Assert(column_description->max_metadata_attno != InvalidAttrNumber);
+
+	bool min_isnull;
+	bool max_isnull;
+	column_values->decompression_type = DT_MinMaxMetadata;
+	column_values->metadata_min =
+		slot_getattr(compressed_slot, column_description->min_metadata_attno, &min_isnull);
+	column_values->metadata_max =
+		slot_getattr(compressed_slot, column_description->max_metadata_attno, &max_isnull);
+	column_values->metadata_isnull = min_isnull || max_isnull;
+}
+
 /*
  * Initialize the batch decompression state with the new compressed  tuple.
  */
@@ -864,6 +1297,8 @@ compressed_batch_set_compressed_tuple(DecompressContext *dcontext,
 {
 	Assert(TupIsNull(compressed_batch_current_tuple(batch_state)));
 
+	TIMESCALEDB_DECOMPRESS_BATCH_START();
+
 	/*
 	 * The batch states are initialized on demand, because creating the memory
 	 * context and the tuple table slots is expensive.
@@ -877,8 +1312,9 @@ compressed_batch_set_compressed_tuple(DecompressContext *dcontext,
 
 	batch_state->total_batch_rows = 0;
 	batch_state->next_batch_row = 0;
+	dcontext->stats.batches++;
 
-	MemoryContextReset(batch_state->per_batch_context);
+	compressed_batch_recycle_context(dcontext, batch_state);
 
 	for (int i = 0; i < dcontext->num_columns_with_metadata; i++)
 	{
@@ -986,14 +1422,41 @@ compressed_batch_set_compressed_tuple(DecompressContext *dcontext,
 			.per_vector_mcxt = batch_state->per_batch_context,
 			.slot = compressed_slot,
 			.get_arrow_array = compressed_batch_get_arrow_array,
+			.is_monotonic = compressed_batch_is_monotonic,
 		},
 		.batch_state = batch_state,
 		.dcontext = dcontext,
 	};
 	VectorQualState *vqstate = &cbvqstate.vqstate;
 
-	VectorQualSummary vector_qual_summary =
-		vqstate->vectorized_quals_constified != NIL ? vector_qual_compute(vqstate) : AllRowsPass;
+	VectorQualSummary vector_qual_summary = AllRowsPass;
+	if (vqstate->vectorized_quals_constified != NIL)
+	{
+		if (decompress_stats_timing(dcontext))
+		{
+			/*
+			 * The quals decompress the columns they need, don't count that
+			 * time twice.
+			 */
+			instr_time start;
+			instr_time end;
+			instr_time nested = dcontext->stats.detoast_time;
+			INSTR_TIME_ADD(nested, dcontext->stats.decompress_time);
+
+			INSTR_TIME_SET_CURRENT(start);
+			vector_qual_summary = vector_qual_compute(vqstate);
+			INSTR_TIME_SET_CURRENT(end);
+
+			INSTR_TIME_ACCUM_DIFF(dcontext->stats.qual_time, end, start);
+			INSTR_TIME_ADD(dcontext->stats.qual_time, nested);
+			INSTR_TIME_SUBTRACT(dcontext->stats.qual_time, dcontext->stats.detoast_time);
+			INSTR_TIME_SUBTRACT(dcontext->stats.qual_time, dcontext->stats.decompress_time);
+		}
+		else
+		{
+			vector_qual_summary = vector_qual_compute(vqstate);
+		}
+	}
 
 	batch_state->vector_qual_result = vqstate->vector_qual_result;
 
@@ -1005,14 +1468,48 @@ compressed_batch_set_compressed_tuple(DecompressContext *dcontext,
 		 * the end.
 		 * Note that this optimization can't work with "batch sorted merge",
 		 * because the latter always has to read the first row of the batch for
-		 * its sorting needs, so it always has to read and decompress all
-		 * columns. This can be improved by only decompressing the columns
-		 * needed for sorting.
+		 * its sorting needs. That case is handled below.
 		 */
 		compressed_batch_discard_tuples(batch_state);
 
 		InstrCountTuples2(dcontext->ps, 1);
 		InstrCountFiltered1(dcontext->ps, batch_state->total_batch_rows);
+		dcontext->stats.batches_filtered++;
+	}
+	else if (vector_qual_summary == NoRowsPass)
+	{
+		/*
+		 * The batch sorted merge only looks at the sort keys of the first
+		 * tuple of a batch that doesn't pass the vectorized quals, so we only
+		 * have to decompress the sort key columns. The rest of the columns
+		 * are set to null, so that the first tuple doesn't reference the
+		 * values from the previous batch that were freed on context reset.
+		 */
+		const int num_data_columns = dcontext->num_data_columns;
+		for (int i = 0; i < num_data_columns; i++)
+		{
+			CompressedColumnValues *column_values = &batch_state->compressed_columns[i];
+			if (column_values->decompression_type != DT_Invalid)
+			{
+				continue;
+			}
+
+			CompressionColumnDescription *column_description =
+				&dcontext->compressed_chunk_columns[i];
+			if (column_description->is_batch_sort_key)
+			{
+				decompress_column(dcontext, batch_state, compressed_slot, i);
+				Assert(column_values->decompression_type != DT_Invalid);
+				continue;
+			}
+
+			AttrNumber attr = AttrNumberGetAttrOffset(column_description->custom_scan_attno);
+			column_values->decompression_type = DT_Scalar;
+			column_values->output_value = &decompressed_tuple->tts_values[attr];
+			column_values->output_isnull = &decompressed_tuple->tts_isnull[attr];
+			*column_values->output_value = (Datum) 0;
+			*column_values->output_isnull = true;
+		}
 	}
 	else
 	{
@@ -1021,11 +1518,40 @@ compressed_batch_set_compressed_tuple(DecompressContext *dcontext,
 		 * we have to decompress the rest of the compressed columns.
 		 */
 		const int num_data_columns = dcontext->num_data_columns;
+		if (vector_qual_summary == AllRowsPass)
+		{
+			/*
+			 * For the columns where only the min and max are needed, the
+			 * batch metadata is enough when all rows pass.
+			 */
+			for (int i = 0; i < num_data_columns; i++)
+			{
+				CompressedColumnValues *column_values = &batch_state->compressed_columns[i];
+				CompressionColumnDescription *column_description =
+					&dcontext->compressed_chunk_columns[i];
+				if (column_values->decompression_type == DT_Invalid &&
+					column_description->use_minmax_metadata)
+				{
+					read_minmax_metadata(column_description, column_values, compressed_slot);
+				}
+			}
+		}
+
+		int next_prefetch_column = 0;
 		for (int i = 0; i < num_data_columns; i++)
 		{
 			CompressedColumnValues *column_values = &batch_state->compressed_columns[i];
 			if (column_values->decompression_type == DT_Invalid)
 			{
+				/*
+				 * Keep the toast blocks of the next few columns in flight
+				 * while we are detoasting and decompressing this one.
+				 */
+				next_prefetch_column = prefetch_toasted_columns(dcontext,
+																batch_state,
+																compressed_slot,
+																next_prefetch_column,
+																i);
 				decompress_column(dcontext, batch_state, compressed_slot, i);
 				Assert(column_values->decompression_type != DT_Invalid);
 			}
@@ -1041,6 +1567,8 @@ compressed_batch_set_compressed_tuple(DecompressContext *dcontext,
 			vqstate->vector_qual_result = NULL;
 		}
 	}
+
+	TIMESCALEDB_DECOMPRESS_BATCH_DONE(batch_state->total_batch_rows, vector_qual_summary);
 }
 
 static void
@@ -1283,10 +1811,10 @@ compressed_batch_save_first_tuple(DecompressContext *dcontext, DecompressBatchSt
 	Assert(TupIsNull(compressed_batch_current_tuple(batch_state)));
 
 	/*
-	 * Check that we have decompressed all columns even if the vector quals
+	 * Check that we have initialized all columns even if the vector quals
 	 * didn't pass for the entire batch. We need them because we're asked
-	 * to save the first tuple. This doesn't actually happen yet, because the
-	 * vectorized decompression is disabled with sorted merge.
+	 * to save the first tuple. If no rows pass the vector quals, only the
+	 * sort key columns are decompressed and the rest are null.
 	 */
 #ifdef USE_ASSERT_CHECKING
 	const int num_data_columns = dcontext->num_data_columns;
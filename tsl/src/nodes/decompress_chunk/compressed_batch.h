@@ -15,6 +15,12 @@ typedef struct ArrowArray ArrowArray;
 /* How to obtain the decompressed datum for individual row. */
 typedef enum
 {
+	/*
+	 * The column is not decompressed, only its batch min and max metadata are
+	 * available. Used for vectorized min() and max() aggregates.
+	 */
+	DT_MinMaxMetadata = -5,
+
 	DT_ArrowTextDict = -4,
 
 	DT_ArrowText = -3,
@@ -61,6 +67,21 @@ typedef struct CompressedColumnValues
 	 * amount of indirections. However, it is used for vectorized filters.
 	 */
 	ArrowArray *arrow;
+
+	/*
+	 * The arrow array has no nulls, and the values go with a constant step,
+	 * so they are monotonic. This is common for the timestamps collected with
+	 * a fixed interval.
+	 */
+	bool arithmetic_sequence;
+
+	/*
+	 * The batch min and max metadata for DT_MinMaxMetadata columns. They are
+	 * null when all values of the column in the batch are null.
+	 */
+	Datum metadata_min;
+	Datum metadata_max;
+	bool metadata_isnull;
 } CompressedColumnValues;
 
 /*
@@ -98,6 +119,9 @@ typedef struct DecompressBatchState
 	uint16 next_batch_row;
 	MemoryContext per_batch_context;
 
+	/* The keeper block size the per-batch context was created with. */
+	Size per_batch_context_size;
+
 	/*
 	 * Arrow-style bitmap that says whether the vector quals passed for a given
 	 * row. Indexed same as arrow arrays, w/o accounting for the reverse scan
@@ -137,6 +161,9 @@ extern void compressed_batch_save_first_tuple(DecompressContext *dcontext,
  *
  * If bulk decompression is not used, use the default size for batch context.
  * This reduces memory usage and improves performance with batch sorted merge.
+ *
+ * With bulk decompression, the keeper block of the per-batch context is sized
+ * after the largest batch seen so far, see compressed_batch_recycle_context().
  */
 #define create_bulk_decompression_mctx(parent_mctx)                                                \
 	GenerationContextCreate(parent_mctx,                                                           \
@@ -148,7 +175,7 @@ extern void compressed_batch_save_first_tuple(DecompressContext *dcontext,
 #define create_per_batch_mctx(dcontext)                                                            \
 	GenerationContextCreate(CurrentMemoryContext,                                                  \
 							"DecompressBatchState per-batch",                                      \
-							0,                                                                     \
+							dcontext->per_batch_context_size,                                      \
 							dcontext->enable_bulk_decompression ? 64 * 1024 : 8 * 1024,            \
 							dcontext->enable_bulk_decompression ? 64 * 1024 : 8 * 1024);
 
@@ -192,3 +219,4 @@ typedef struct CompressedBatchVectorQualState
 
 const ArrowArray *compressed_batch_get_arrow_array(VectorQualState *vqstate, Expr *expr,
 												   bool *is_default_value);
+bool compressed_batch_is_monotonic(VectorQualState *vqstate, Expr *expr);
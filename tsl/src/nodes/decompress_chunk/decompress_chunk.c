@@ -17,6 +17,7 @@
 #include <optimizer/optimizer.h>
 #include <optimizer/pathnode.h>
 #include <optimizer/paths.h>
+#include <optimizer/plancat.h>
 #include <parser/parse_relation.h>
 #include <parser/parsetree.h>
 #include <planner/planner.h>
@@ -28,6 +29,7 @@
 
 #include "compat/compat.h"
 #include "compression/compression.h"
+#include "compression/compression_stats.h"
 #include "compression/create.h"
 #include "cross_module_fn.h"
 #include "custom_type_cache.h"
@@ -38,6 +40,7 @@
 #include "nodes/decompress_chunk/planner.h"
 #include "nodes/decompress_chunk/qual_pushdown.h"
 #include "ts_catalog/array_utils.h"
+#include "ts_catalog/compression_chunk_size.h"
 #include "utils.h"
 
 static CustomPathMethods decompress_chunk_path_methods = {
@@ -69,8 +72,11 @@ static DecompressChunkPath *decompress_chunk_path_create(PlannerInfo *root,
 														 int parallel_workers,
 														 Path *compressed_path);
 
+static bool add_parallel_batch_distribution_path(PlannerInfo *root, RelOptInfo *chunk_rel,
+												 const CompressionInfo *info);
+
 static void decompress_chunk_add_plannerinfo(PlannerInfo *root, CompressionInfo *info,
-											 const Chunk *chunk, RelOptInfo *chunk_rel,
+											 const Hypertable *ht, RelOptInfo *chunk_rel,
 											 bool needs_sequence_num);
 
 static SortInfo build_sortinfo(PlannerInfo *root, const Chunk *chunk, RelOptInfo *chunk_rel,
@@ -420,6 +426,23 @@ build_compressioninfo(PlannerInfo *root, const Hypertable *ht, const Chunk *chun
 
 	info->chunk_const_segmentby = find_const_segmentby(chunk_rel, info);
 
+	/*
+	 * Use the actual average batch size from the compression statistics of
+	 * the chunk. The batches are smaller than the target size, e.g., when
+	 * the segments have few rows.
+	 */
+	int64 numrows_pre_compression;
+	int64 numrows_post_compression;
+	info->rows_per_batch = TARGET_COMPRESSED_BATCH_SIZE;
+	if (ts_compression_chunk_size_get_row_counts(chunk->fd.id,
+												 &numrows_pre_compression,
+												 &numrows_post_compression) &&
+		numrows_pre_compression > 0 && numrows_post_compression > 0)
+	{
+		const double rows_per_batch = (double) numrows_pre_compression / numrows_post_compression;
+		info->rows_per_batch = Min(Max(rows_per_batch, 1.0), GLOBAL_MAX_ROWS_PER_COMPRESSION);
+	}
+
 	/*
 	 * If the chunk is member of hypertable expansion or a UNION, find its
 	 * parent relation ids. We will use it later to filter out some parameterized
@@ -437,18 +460,55 @@ build_compressioninfo(PlannerInfo *root, const Hypertable *ht, const Chunk *chun
  * calculate cost for DecompressChunkPath
  *
  * since we have to read whole batch before producing tuple
- * we put cost of 1 tuple of compressed_scan as startup cost
+ * we put cost of 1 tuple of compressed_scan and the decoding
+ * of one batch as startup cost
  */
 static void
-cost_decompress_chunk(PlannerInfo *root, Path *path, Path *compressed_path)
+cost_decompress_chunk(PlannerInfo *root, const CompressionInfo *info, Path *path,
+					  Path *compressed_path)
 {
+	path->rows = compressed_path->rows * info->rows_per_batch;
+
 	/* startup_cost is cost before fetching first tuple */
 	if (compressed_path->rows > 0)
-		path->startup_cost = compressed_path->total_cost / compressed_path->rows;
+		path->startup_cost = compressed_path->total_cost / compressed_path->rows +
+							 info->rows_per_batch * info->decompression_cost_per_row;
 
 	/* total_cost is cost for fetching all tuples */
-	path->total_cost = compressed_path->total_cost + path->rows * cpu_tuple_cost;
-	path->rows = compressed_path->rows * TARGET_COMPRESSED_BATCH_SIZE;
+	path->total_cost = compressed_path->total_cost +
+					   path->rows * (cpu_tuple_cost + info->decompression_cost_per_row);
+}
+
+/*
+ * Estimate the cost of decoding one row of the compressed columns that are
+ * read from the compressed chunk. The columns are costed by the default
+ * compression algorithm of their type, with the decode costs that are
+ * calibrated for the current hardware.
+ */
+static double
+estimate_decompression_cost_per_row(const CompressionInfo *info)
+{
+	double cost = 0;
+	ListCell *lc;
+
+	foreach (lc, info->compressed_rel->reltarget->exprs)
+	{
+		Var *var = lfirst(lc);
+
+		if (!IsA(var, Var) ||
+			!bms_is_member(var->varattno, info->compressed_attnos_in_compressed_chunk))
+			continue;
+
+		char *column_name = get_attname(info->compressed_rte->relid, var->varattno, false);
+		Oid typid = get_atttype(info->chunk_rte->relid,
+								get_attnum(info->chunk_rte->relid, column_name));
+		if (!OidIsValid(typid))
+			continue;
+
+		cost += compression_decode_cost_per_row(compression_get_default_algorithm(typid));
+	}
+
+	return cost * cpu_operator_cost;
 }
 
 /* Smoothstep function S1 (the h01 cubic Hermite spline). */
@@ -477,9 +537,9 @@ smoothstep(double x, double start, double end)
  * of the affected batches needs to be decompressed. Without the optimization, the entire batches
  * are decompressed, sorted, and then the top elements are taken from the result.
  *
- * The idea is to do something similar to the MergeAppend node; a BinaryHeap is used
- * to merge the per segment by column sorted individual batches into a sorted result. So, we end
- * up which a data flow which looks as follows:
+ * The idea is to do something similar to the MergeAppend node; a priority queue (a tournament
+ * tree, see batch_queue_heap.c) is used to merge the per segment by column sorted individual
+ * batches into a sorted result. So, we end up which a data flow which looks as follows:
  *
  * DecompressChunk
  *   * Decompress Batch 1
@@ -599,7 +659,7 @@ cost_batch_sorted_merge(PlannerInfo *root, const CompressionInfo *compression_in
 	 * compressed chunk is never projected so we can't use it for that.
 	 */
 	const double work_mem_bytes = work_mem * 1024.0;
-	const double needed_memory_bytes = open_batches_clamped * TARGET_COMPRESSED_BATCH_SIZE *
+	const double needed_memory_bytes = open_batches_clamped * dcpath->info->rows_per_batch *
 									   dcpath->custom_path.path.pathtarget->width;
 
 	/*
@@ -819,7 +879,7 @@ ts_decompress_chunk_generate_paths(PlannerInfo *root, RelOptInfo *chunk_rel, con
 	/* add RangeTblEntry and RelOptInfo for compressed chunk */
 	decompress_chunk_add_plannerinfo(root,
 									 compression_info,
-									 chunk,
+									 ht,
 									 chunk_rel,
 									 sort_info.needs_sequence_num);
 
@@ -838,7 +898,7 @@ ts_decompress_chunk_generate_paths(PlannerInfo *root, RelOptInfo *chunk_rel, con
 	/* translate chunk_rel->baserestrictinfo */
 	pushdown_quals(root, compression_info->settings, chunk_rel, compressed_rel, consider_partial);
 	set_baserel_size_estimates(root, compressed_rel);
-	double new_row_estimate = compressed_rel->rows * TARGET_COMPRESSED_BATCH_SIZE;
+	double new_row_estimate = compressed_rel->rows * compression_info->rows_per_batch;
 
 	if (!compression_info->single_chunk)
 	{
@@ -1009,7 +1069,10 @@ ts_decompress_chunk_generate_paths(PlannerInfo *root, RelOptInfo *chunk_rel, con
 						  work_mem,
 						  -1);
 
-				cost_decompress_chunk(root, &path_copy->custom_path.path, &sort_path);
+				cost_decompress_chunk(root,
+									  path_copy->info,
+									  &path_copy->custom_path.path,
+									  &sort_path);
 			}
 
 			chunk_path = &path_copy->custom_path.path;
@@ -1112,6 +1175,15 @@ ts_decompress_chunk_generate_paths(PlannerInfo *root, RelOptInfo *chunk_rel, con
 	/* create parallel paths */
 	if (compressed_rel->consider_parallel)
 	{
+		/*
+		 * With the batch-level work distribution, the partial paths that split
+		 * the compressed chunk scan by pages are replaced with the path where
+		 * the workers claim individual compressed batches.
+		 */
+		const bool use_batch_distribution =
+			ts_guc_enable_parallel_batch_distribution && !consider_partial &&
+			add_parallel_batch_distribution_path(root, chunk_rel, compression_info);
+
 		foreach (lc, compressed_rel->partial_pathlist)
 		{
 			Path *compressed_path = lfirst(lc);
@@ -1131,6 +1203,28 @@ ts_decompress_chunk_generate_paths(PlannerInfo *root, RelOptInfo *chunk_rel, con
 														 compressed_path->parallel_workers,
 														 compressed_path);
 
+			/*
+			 * Create a partial path for the batch sorted merge. Each worker
+			 * merges the batches from its part of the compressed chunk scan,
+			 * and the results are combined by a Gather Merge node above.
+			 */
+			if (ts_guc_enable_parallel_batch_distribution && sort_info.use_batch_sorted_merge &&
+				!consider_partial)
+			{
+				DecompressChunkPath *batch_merge_path =
+					copy_decompress_chunk_path((DecompressChunkPath *) path);
+
+				batch_merge_path->reverse = sort_info.reverse;
+				batch_merge_path->batch_sorted_merge = true;
+				batch_merge_path->custom_path.path.pathkeys = root->query_pathkeys;
+				cost_batch_sorted_merge(root, compression_info, batch_merge_path, compressed_path);
+
+				add_partial_path(chunk_rel, &batch_merge_path->custom_path.path);
+			}
+
+			if (use_batch_distribution)
+				continue;
+
 			if (consider_partial)
 			{
 				Bitmapset *req_outer = PATH_REQ_OUTER(path);
@@ -1768,8 +1862,37 @@ compressed_rel_setup_equivalence_classes(PlannerInfo *root, CompressionInfo *inf
  * create RangeTblEntry and RelOptInfo for the compressed chunk
  * and add it to PlannerInfo
  */
+/*
+ * Get the internal compression table of the hypertable.
+ *
+ * All the compressed chunks of a hypertable belong to its compression table,
+ * so we look it up once for all the chunks of the hypertable relation instead
+ * of looking up every compressed chunk in the catalog.
+ */
+static Hypertable *
+get_compressed_hypertable(const CompressionInfo *info, const Hypertable *ht)
+{
+	TimescaleDBPrivate *private = info->ht_rel->fdw_private;
+
+	if (private != NULL && private->compressed_hypertable != NULL)
+		return private->compressed_hypertable;
+
+	Hypertable *compressed_ht =
+		ts_planner_get_hypertable(ts_hypertable_id_to_relid(ht->fd.compressed_hypertable_id,
+															false),
+								  CACHE_FLAG_NONE);
+	Ensure(compressed_ht != NULL,
+		   "compression table for hypertable \"%s\" not found",
+		   get_rel_name(ht->main_table_relid));
+
+	if (private != NULL)
+		private->compressed_hypertable = compressed_ht;
+
+	return compressed_ht;
+}
+
 static void
-decompress_chunk_add_plannerinfo(PlannerInfo *root, CompressionInfo *info, const Chunk *chunk,
+decompress_chunk_add_plannerinfo(PlannerInfo *root, CompressionInfo *info, const Hypertable *ht,
 								 RelOptInfo *chunk_rel, bool needs_sequence_num)
 {
 	Index compressed_index = root->simple_rel_array_size;
@@ -1778,11 +1901,8 @@ decompress_chunk_add_plannerinfo(PlannerInfo *root, CompressionInfo *info, const
 	 * Add the compressed chunk to the baserel cache. Note that it belongs to
 	 * a different hypertable, the internal compression table.
 	 */
-	const Chunk *compressed_chunk = ts_chunk_get_by_relid(info->settings->fd.compress_relid, true);
 	ts_add_baserel_cache_entry_for_chunk(info->settings->fd.compress_relid,
-										 ts_planner_get_hypertable(compressed_chunk
-																	   ->hypertable_relid,
-																   CACHE_FLAG_NONE));
+										 get_compressed_hypertable(info, ht));
 
 	expand_planner_arrays(root, 1);
 	info->compressed_rte = decompress_chunk_make_rte(info->settings->fd.compress_relid,
@@ -1836,6 +1956,7 @@ decompress_chunk_add_plannerinfo(PlannerInfo *root, CompressionInfo *info, const
 	table_close(r, NoLock);
 
 	compressed_rel_setup_reltarget(compressed_rel, info, needs_sequence_num);
+	info->decompression_cost_per_row = estimate_decompression_cost_per_row(info);
 	compressed_rel_setup_equivalence_classes(root, info);
 	/* translate chunk_rel->joininfo for compressed_rel */
 	compressed_rel_setup_joininfo(compressed_rel, info);
@@ -1864,6 +1985,65 @@ decompress_chunk_add_plannerinfo(PlannerInfo *root, CompressionInfo *info, const
 	}
 }
 
+/*
+ * Add a parallel-aware partial path that uses the batch-level work
+ * distribution. Each participant runs a full non-parallel scan of the
+ * compressed chunk, but decompresses only the compressed batches it has
+ * claimed in the shared state first, so the decompression work is split by
+ * batches instead of by the pages of the compressed chunk. This is more even
+ * when a few segments hold most rows.
+ *
+ * The batches are identified by the TIDs of the compressed tuples, so we need
+ * the compressed scan to return the heap tuples without projection. Returns
+ * false if the path was not created.
+ */
+static bool
+add_parallel_batch_distribution_path(PlannerInfo *root, RelOptInfo *chunk_rel,
+									 const CompressionInfo *info)
+{
+	RelOptInfo *compressed_rel = info->compressed_rel;
+
+	/* The compressed scan gets a physical tlist unless there are dropped columns. */
+	if (compressed_rel->pages == 0 || build_physical_tlist(root, compressed_rel) == NIL)
+		return false;
+
+	const int parallel_workers = compute_parallel_worker(compressed_rel,
+														 compressed_rel->pages,
+														 -1,
+														 max_parallel_workers_per_gather);
+	if (parallel_workers <= 0)
+		return false;
+
+	Path *compressed_path = create_seqscan_path(root, compressed_rel, NULL, 0);
+	if (!compressed_path->parallel_safe)
+		return false;
+
+	DecompressChunkPath *path =
+		decompress_chunk_path_create(root, info, parallel_workers, compressed_path);
+	path->custom_path.path.parallel_aware = true;
+
+	/*
+	 * Every participant reads the entire compressed chunk, but decompresses
+	 * only a part of the batches. The leader contribution is estimated the
+	 * same way as in the Postgres get_parallel_divisor().
+	 */
+	double parallel_divisor = parallel_workers;
+	if (parallel_leader_participation)
+	{
+		const double leader_contribution = 1.0 - (0.3 * parallel_workers);
+		if (leader_contribution > 0)
+			parallel_divisor += leader_contribution;
+	}
+	path->custom_path.path.rows = clamp_row_est(path->custom_path.path.rows / parallel_divisor);
+	path->custom_path.path.total_cost =
+		compressed_path->total_cost +
+		path->custom_path.path.rows * (cpu_tuple_cost + info->decompression_cost_per_row);
+
+	add_partial_path(chunk_rel, &path->custom_path.path);
+
+	return true;
+}
+
 static DecompressChunkPath *
 decompress_chunk_path_create(PlannerInfo *root, const CompressionInfo *info, int parallel_workers,
 							 Path *compressed_path)
@@ -1912,7 +2092,7 @@ decompress_chunk_path_create(PlannerInfo *root, const CompressionInfo *info, int
 	path->custom_path.custom_paths = list_make1(compressed_path);
 	path->reverse = false;
 	path->required_compressed_pathkeys = NIL;
-	cost_decompress_chunk(root, &path->custom_path.path, compressed_path);
+	cost_decompress_chunk(root, info, &path->custom_path.path, compressed_path);
 
 	return path;
 }
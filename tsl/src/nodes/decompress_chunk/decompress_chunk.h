@@ -41,6 +41,11 @@ typedef struct CompressionInfo
 	/* compressed chunk attribute numbers for columns that are compressed */
 	Bitmapset *compressed_attnos_in_compressed_chunk;
 
+	/* average number of rows in a compressed batch */
+	double rows_per_batch;
+	/* cost of decoding the compressed columns that are read, per row */
+	double decompression_cost_per_row;
+
 	bool single_chunk;	  /* query on explicit chunk */
 	bool has_seq_num;	  /* legacy sequence number support */
 	Relids parent_relids; /* relids of the parent hypertable and UNION */
@@ -11,8 +11,10 @@
 #include <executor/tuptable.h>
 #include <nodes/execnodes.h>
 #include <nodes/pg_list.h>
+#include <portability/instr_time.h>
 
 #include "batch_array.h"
+#include "batch_cache.h"
 #include "detoaster.h"
 
 typedef enum CompressionColumnType
@@ -50,8 +52,64 @@ typedef struct CompressionColumnDescription
 	AttrNumber compressed_scan_attno;
 
 	bool bulk_decompression_supported;
+
+	/*
+	 * Whether this column is one of the sort keys of batch sorted merge. These
+	 * columns are needed for the first tuple of the batch even if the entire
+	 * batch doesn't pass the vectorized quals.
+	 */
+	bool is_batch_sort_key;
+
+	/*
+	 * Attnos of the min and max metadata of this column in the input
+	 * compressed chunk scan, or InvalidAttrNumber if there is no such metadata.
+	 */
+	AttrNumber min_metadata_attno;
+	AttrNumber max_metadata_attno;
+
+	/*
+	 * The consumer of the batches only needs the min and max of this column,
+	 * so for the batches that entirely pass the vectorized quals, we read the
+	 * metadata instead of decompressing the column. Set by the vectorized
+	 * aggregation node.
+	 */
+	bool use_minmax_metadata;
 } CompressionColumnDescription;
 
+/*
+ * The counters of the decompression work shown in EXPLAIN ANALYZE when
+ * timescaledb.enable_decompression_stats is set, and added to the cumulative
+ * statistics when the node ends. The times are only measured for EXPLAIN
+ * ANALYZE, and only when the node is timed.
+ */
+typedef struct DecompressStats
+{
+	/* The compressed batches that were read. */
+	int64 batches;
+
+	/* The batches that entirely didn't pass the vectorized quals. */
+	int64 batches_filtered;
+
+	/* The size of the detoasted compressed column values. */
+	int64 bytes_detoasted;
+
+	/*
+	 * The number of decompressed rows summed over the columns, for the bulk
+	 * decompression and for the row-by-row decompression iterators.
+	 */
+	int64 bulk_rows;
+	int64 iterator_rows;
+
+	/* The number of decompressed rows for each data column. */
+	int64 *column_rows;
+
+	instr_time detoast_time;
+	instr_time decompress_time;
+
+	/* Excludes the detoasting and decompression of the columns it needs. */
+	instr_time qual_time;
+} DecompressStats;
+
 typedef struct DecompressContext
 {
 	/*
@@ -82,6 +140,21 @@ typedef struct DecompressContext
 	 */
 	MemoryContext bulk_decompression_context;
 
+	/*
+	 * The largest amount of memory that the per-batch context of a batch had
+	 * to allocate so far. The per-batch contexts are recreated with a keeper
+	 * block of this size, so that the decompressed column buffers of the next
+	 * batches are carved out of the same memory after the context reset,
+	 * without going to malloc for every batch.
+	 */
+	Size per_batch_context_size;
+
+	/*
+	 * The cache of decompressed columns that is kept across rescans, or NULL
+	 * if it is not used.
+	 */
+	DecompressBatchCache *batch_cache;
+
 	TupleTableSlot *custom_scan_slot;
 
 	/*
@@ -95,6 +168,8 @@ typedef struct DecompressContext
 	PlanState *ps; /* Set for filtering and instrumentation */
 
 	Detoaster detoaster;
+
+	DecompressStats stats;
 } DecompressContext;
 
 #endif /* TIMESCALEDB_DECOMPRESS_CONTEXT_H */
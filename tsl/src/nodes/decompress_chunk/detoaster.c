@@ -15,10 +15,12 @@
 #include <access/table.h>
 #include <access/tableam.h>
 #include <access/toast_internals.h>
+#include <storage/bufmgr.h>
 #include <utils/expandeddatum.h>
 #include <utils/fmgroids.h>
 #include <utils/rel.h>
 #include <utils/relcache.h>
+#include <utils/spccache.h>
 
 #include <compat/compat.h>
 #include "debug_assert.h"
@@ -28,6 +30,51 @@
 #define TS_VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer)                                            \
 	(((int32) VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer)) < (toast_pointer).va_rawsize - VARHDRSZ)
 
+/*
+ * Open the toast relation and its valid index, and keep them in the Detoaster
+ * for reuse over many input tuples.
+ */
+static void
+detoaster_open(Detoaster *detoaster, Oid toastrelid)
+{
+	if (detoaster->toastrel != NULL)
+	{
+		Ensure(detoaster->toastrel->rd_id == toastrelid,
+			   "unexpected toast pointer relid %d, expected %d",
+			   toastrelid,
+			   detoaster->toastrel->rd_id);
+		return;
+	}
+
+	MemoryContext old_mctx = MemoryContextSwitchTo(detoaster->mctx);
+	detoaster->toastrel = table_open(toastrelid, AccessShareLock);
+
+	int num_indexes;
+	Relation *toastidxs;
+	/* Look for the valid index of toast relation */
+	const int validIndex =
+		toast_open_indexes(detoaster->toastrel, AccessShareLock, &toastidxs, &num_indexes);
+	detoaster->index = toastidxs[validIndex];
+	for (int i = 0; i < num_indexes; i++)
+	{
+		if (i != validIndex)
+		{
+			index_close(toastidxs[i], AccessShareLock);
+		}
+	}
+
+	init_toast_snapshot(&detoaster->SnapshotToast);
+
+#ifdef USE_PREFETCH
+	detoaster->prefetch_distance =
+		get_tablespace_io_concurrency(detoaster->toastrel->rd_rel->reltablespace);
+#else
+	detoaster->prefetch_distance = 0;
+#endif
+
+	MemoryContextSwitchTo(old_mctx);
+}
+
 /*
  * Fetch a TOAST slice from a heap table.
  *
@@ -44,24 +91,11 @@ ts_fetch_toast(Detoaster *detoaster, struct varatt_external *toast_pointer, stru
 	/*
 	 * Open the toast relation and its indexes
 	 */
-	if (detoaster->toastrel == NULL)
+	detoaster_open(detoaster, toast_pointer->va_toastrelid);
+
+	if (detoaster->toastscan == NULL)
 	{
 		MemoryContext old_mctx = MemoryContextSwitchTo(detoaster->mctx);
-		detoaster->toastrel = table_open(toast_pointer->va_toastrelid, AccessShareLock);
-
-		int num_indexes;
-		Relation *toastidxs;
-		/* Look for the valid index of toast relation */
-		const int validIndex =
-			toast_open_indexes(detoaster->toastrel, AccessShareLock, &toastidxs, &num_indexes);
-		detoaster->index = toastidxs[validIndex];
-		for (int i = 0; i < num_indexes; i++)
-		{
-			if (i != validIndex)
-			{
-				index_close(toastidxs[i], AccessShareLock);
-			}
-		}
 
 		/* Set up a scan key to fetch from the index. */
 		ScanKeyInit(&detoaster->toastkey,
@@ -71,7 +105,6 @@ ts_fetch_toast(Detoaster *detoaster, struct varatt_external *toast_pointer, stru
 					ObjectIdGetDatum(valueid));
 
 		/* Prepare for scan */
-		init_toast_snapshot(&detoaster->SnapshotToast);
 		detoaster->toastscan = systable_beginscan_ordered(detoaster->toastrel,
 														  detoaster->index,
 														  &detoaster->SnapshotToast,
@@ -81,10 +114,6 @@ ts_fetch_toast(Detoaster *detoaster, struct varatt_external *toast_pointer, stru
 	}
 	else
 	{
-		Ensure(detoaster->toastrel->rd_id == toast_pointer->va_toastrelid,
-			   "unexpected toast pointer relid %d, expected %d",
-			   toast_pointer->va_toastrelid,
-			   detoaster->toastrel->rd_id);
 		detoaster->toastkey.sk_argument = ObjectIdGetDatum(valueid);
 		index_rescan(detoaster->toastscan->iscan, &detoaster->toastkey, 1, NULL, 0);
 	}
@@ -220,6 +249,10 @@ void
 detoaster_init(Detoaster *detoaster, MemoryContext mctx)
 {
 	detoaster->toastrel = NULL;
+	detoaster->index = NULL;
+	detoaster->toastscan = NULL;
+	detoaster->prefetch_scan = NULL;
+	detoaster->prefetch_distance = 0;
 	detoaster->mctx = mctx;
 }
 
@@ -229,7 +262,16 @@ detoaster_close(Detoaster *detoaster)
 	/* Close toast table */
 	if (detoaster->toastrel != NULL)
 	{
-		systable_endscan_ordered(detoaster->toastscan);
+		if (detoaster->toastscan != NULL)
+		{
+			systable_endscan_ordered(detoaster->toastscan);
+			detoaster->toastscan = NULL;
+		}
+		if (detoaster->prefetch_scan != NULL)
+		{
+			index_endscan(detoaster->prefetch_scan);
+			detoaster->prefetch_scan = NULL;
+		}
 		table_close(detoaster->toastrel, AccessShareLock);
 		index_close(detoaster->index, AccessShareLock);
 		detoaster->toastrel = NULL;
@@ -273,6 +315,73 @@ ts_toast_fetch_datum(struct varlena *attr, Detoaster *detoaster, MemoryContext d
 	return result;
 }
 
+/*
+ * Issue the prefetch requests for the toast heap blocks of the given datum, so
+ * that they are read asynchronously while we are busy detoasting and
+ * decompressing other datums. The datum is fetched later as usual by
+ * detoaster_detoast_attr_copy().
+ *
+ * We only use the toast index to find the heap block numbers here, so the
+ * toast heap itself is not read synchronously. Does nothing for the datums
+ * that are not stored out-of-line, and for the tablespaces with zero
+ * effective_io_concurrency.
+ */
+void
+detoaster_prefetch(struct varlena *attr, Detoaster *detoaster)
+{
+#ifdef USE_PREFETCH
+	if (!VARATT_IS_EXTERNAL_ONDISK(attr))
+	{
+		return;
+	}
+
+	struct varatt_external toast_pointer;
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+	detoaster_open(detoaster, toast_pointer.va_toastrelid);
+
+	if (detoaster->prefetch_distance <= 0)
+	{
+		return;
+	}
+
+	ScanKeyData prefetch_key;
+	ScanKeyInit(&prefetch_key,
+				(AttrNumber) 1,
+				BTEqualStrategyNumber,
+				F_OIDEQ,
+				ObjectIdGetDatum(toast_pointer.va_valueid));
+
+	if (detoaster->prefetch_scan == NULL)
+	{
+		MemoryContext old_mctx = MemoryContextSwitchTo(detoaster->mctx);
+		detoaster->prefetch_scan = index_beginscan(detoaster->toastrel,
+												   detoaster->index,
+												   &detoaster->SnapshotToast,
+												   1,
+												   0);
+		MemoryContextSwitchTo(old_mctx);
+	}
+	index_rescan(detoaster->prefetch_scan, &prefetch_key, 1, NULL, 0);
+
+	/*
+	 * The chunks of one toast value are usually stored in the consecutive
+	 * heap tuples, so we only have to prefetch when the block changes.
+	 */
+	BlockNumber last_block = InvalidBlockNumber;
+	ItemPointer tid;
+	while ((tid = index_getnext_tid(detoaster->prefetch_scan, ForwardScanDirection)) != NULL)
+	{
+		const BlockNumber block = ItemPointerGetBlockNumber(tid);
+		if (block != last_block)
+		{
+			PrefetchBuffer(detoaster->toastrel, MAIN_FORKNUM, block);
+			last_block = block;
+		}
+	}
+#endif
+}
+
 #include <access/toast_compression.h>
 
 static struct varlena *
@@ -23,9 +23,23 @@ typedef struct Detoaster
 	SnapshotData SnapshotToast;
 	ScanKeyData toastkey;
 	SysScanDesc toastscan;
+
+	/*
+	 * A separate index-only scan of the toast index that is used to find the
+	 * heap blocks of a toast value for prefetching, without reading them.
+	 */
+	IndexScanDesc prefetch_scan;
+
+	/*
+	 * How many toast values ahead of the current one we can prefetch. This is
+	 * the effective_io_concurrency of the toast table tablespace, and zero
+	 * means that the prefetching is disabled.
+	 */
+	int prefetch_distance;
 } Detoaster;
 
 void detoaster_init(Detoaster *detoaster, MemoryContext mctx);
 void detoaster_close(Detoaster *detoaster);
 struct varlena *detoaster_detoast_attr_copy(struct varlena *attr, Detoaster *detoaster,
 											MemoryContext dest_mctx);
+void detoaster_prefetch(struct varlena *attr, Detoaster *detoaster);
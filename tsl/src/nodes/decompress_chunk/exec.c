@@ -5,6 +5,8 @@
  */
 
 #include <postgres.h>
+#include <access/htup_details.h>
+#include <access/parallel.h>
 #include <access/sysattr.h>
 #include <executor/executor.h>
 #include <miscadmin.h>
@@ -13,7 +15,11 @@
 #include <nodes/nodeFuncs.h>
 #include <optimizer/optimizer.h>
 #include <parser/parsetree.h>
+#include <port/atomics.h>
 #include <rewrite/rewriteManip.h>
+#include <storage/bufmgr.h>
+#include <storage/shm_toc.h>
+#include <utils/builtins.h>
 #include <utils/datum.h>
 #include <utils/memutils.h>
 #include <utils/typcache.h>
@@ -21,6 +27,7 @@
 #include <tcop/tcopprot.h>
 
 #include "compat/compat.h"
+#include "compressed_scan_stats.h"
 #include "compression/arrow_c_data_interface.h"
 #include "compression/compression.h"
 #include "guc.h"
@@ -31,11 +38,19 @@
 #include "nodes/decompress_chunk/decompress_chunk.h"
 #include "nodes/decompress_chunk/exec.h"
 #include "nodes/decompress_chunk/planner.h"
+#include "nodes/runtime_filter/runtime_filter.h"
 
 static void decompress_chunk_begin(CustomScanState *node, EState *estate, int eflags);
 static void decompress_chunk_end(CustomScanState *node);
 static void decompress_chunk_rescan(CustomScanState *node);
 static void decompress_chunk_explain(CustomScanState *node, List *ancestors, ExplainState *es);
+static Size decompress_chunk_estimate_dsm(CustomScanState *node, ParallelContext *pcxt);
+static void decompress_chunk_initialize_dsm(CustomScanState *node, ParallelContext *pcxt,
+											void *coordinate);
+static void decompress_chunk_reinitialize_dsm(CustomScanState *node, ParallelContext *pcxt,
+											  void *coordinate);
+static void decompress_chunk_initialize_worker(CustomScanState *node, shm_toc *toc,
+											   void *coordinate);
 
 static CustomExecMethods decompress_chunk_state_methods = {
 	.BeginCustomScan = decompress_chunk_begin,
@@ -43,8 +58,26 @@ static CustomExecMethods decompress_chunk_state_methods = {
 	.EndCustomScan = decompress_chunk_end,
 	.ReScanCustomScan = decompress_chunk_rescan,
 	.ExplainCustomScan = decompress_chunk_explain,
+	.EstimateDSMCustomScan = decompress_chunk_estimate_dsm,
+	.InitializeDSMCustomScan = decompress_chunk_initialize_dsm,
+	.ReInitializeDSMCustomScan = decompress_chunk_reinitialize_dsm,
+	.InitializeWorkerCustomScan = decompress_chunk_initialize_worker,
 };
 
+/*
+ * The shared state for the batch-level work distribution between the parallel
+ * workers. Every participant scans the entire compressed chunk, and
+ * decompresses only the batches for which it was the first to set the claim
+ * bit. The bits are indexed by the TIDs of the compressed tuples.
+ */
+typedef struct DecompressChunkParallelState
+{
+	BlockNumber nblocks;
+	pg_atomic_uint32 claimed[FLEXIBLE_ARRAY_MEMBER];
+} DecompressChunkParallelState;
+
+#define CLAIM_BITS_PER_BLOCK MaxHeapTuplesPerPage
+
 /*
  * Build the sortkeys data structure from the list structure in the
  * custom_private field of the custom scan. This sort info is used to sort
@@ -69,6 +102,10 @@ decompress_chunk_state_create(CustomScan *cscan)
 	chunk_state->bulk_decompression_column =
 		list_nth(cscan->custom_private, DCP_BulkDecompressionColumn);
 	chunk_state->sortinfo = list_nth(cscan->custom_private, DCP_SortInfo);
+	List *minmax_metadata = list_nth(cscan->custom_private, DCP_MinMaxMetadata);
+	chunk_state->min_metadata_column = linitial(minmax_metadata);
+	chunk_state->max_metadata_column = lsecond(minmax_metadata);
+	chunk_state->runtime_filter_info = list_nth(cscan->custom_private, DCP_RuntimeFilters);
 
 	chunk_state->custom_scan_tlist = cscan->custom_scan_tlist;
 
@@ -83,6 +120,20 @@ decompress_chunk_state_create(CustomScan *cscan)
 		list_nth_int(settings, DCS_EnableBulkDecompression);
 	chunk_state->has_row_marks = list_nth_int(settings, DCS_HasRowMarks);
 
+	List *topn_info = list_nth(cscan->custom_private, DCP_TopNInfo);
+	if (topn_info != NIL)
+	{
+		List *topn_settings = linitial(topn_info);
+		List *topn_ops = lsecond(topn_info);
+		chunk_state->topn_limit = linitial_int(topn_settings);
+		chunk_state->topn_value_attno = lsecond_int(topn_settings);
+		chunk_state->topn_metadata_attno = lthird_int(topn_settings);
+		chunk_state->topn_sortkey.ssup_nulls_first = lfourth_int(topn_settings);
+		chunk_state->topn_sortkey.ssup_collation = lsecond_oid(topn_ops);
+		chunk_state->topn_sortkey.ssup_cxt = CurrentMemoryContext;
+		PrepareSortSupportFromOrderingOp(linitial_oid(topn_ops), &chunk_state->topn_sortkey);
+	}
+
 	Assert(IsA(cscan->custom_exprs, List));
 	Assert(list_length(cscan->custom_exprs) == 1);
 	chunk_state->vectorized_quals_original = linitial(cscan->custom_exprs);
@@ -155,6 +206,212 @@ constify_tableoid(List *node, Index chunk_index, Oid chunk_relid)
 pg_attribute_always_inline static TupleTableSlot *
 decompress_chunk_exec_impl(DecompressChunkState *chunk_state, const BatchQueueFunctions *funcs);
 
+/*
+ * The top-N heap has the worst of the best values on top.
+ */
+static int
+topn_heap_compare(Datum a, Datum b, void *arg)
+{
+	DecompressChunkState *chunk_state = (DecompressChunkState *) arg;
+	return ApplySortComparator(a, false, b, false, &chunk_state->topn_sortkey);
+}
+
+/*
+ * Remember the sort column value of the returned row for the top-N pruning.
+ */
+static void
+topn_remember_value(DecompressChunkState *chunk_state, TupleTableSlot *slot)
+{
+	bool isnull;
+	Datum value = slot_getattr(slot, chunk_state->topn_value_attno, &isnull);
+	if (isnull)
+	{
+		/* The nulls sort last when we prune, so they can't improve the bound. */
+		return;
+	}
+
+	binaryheap *heap = chunk_state->topn_heap;
+	if (heap->bh_size < chunk_state->topn_limit)
+	{
+		binaryheap_add(heap, value);
+	}
+	else if (ApplySortComparator(value,
+								 false,
+								 binaryheap_first(heap),
+								 false,
+								 &chunk_state->topn_sortkey) < 0)
+	{
+		binaryheap_replace_first(heap, value);
+	}
+}
+
+/*
+ * Check whether the compressed batch can't have any rows that enter the top-N
+ * result, because its best possible value according to the min/max metadata
+ * sorts strictly after the N best values we have already returned.
+ */
+static bool
+topn_can_skip_batch(DecompressChunkState *chunk_state, TupleTableSlot *compressed_slot)
+{
+	binaryheap *heap = chunk_state->topn_heap;
+	if (heap->bh_size < chunk_state->topn_limit)
+	{
+		return false;
+	}
+
+	bool isnull;
+	Datum best_value = slot_getattr(compressed_slot, chunk_state->topn_metadata_attno, &isnull);
+	return ApplySortComparator(best_value,
+							   isnull,
+							   binaryheap_first(heap),
+							   false,
+							   &chunk_state->topn_sortkey) > 0;
+}
+
+/*
+ * Set up the runtime join filters published by the hash joins above us.
+ */
+static void
+runtime_filters_init(DecompressChunkState *chunk_state)
+{
+	DecompressContext *dcontext = &chunk_state->decompress_context;
+	CustomScan *cscan = castNode(CustomScan, chunk_state->csstate.ss.ps.plan);
+
+	chunk_state->vectorized_quals_static = dcontext->vectorized_quals_constified;
+	chunk_state->num_runtime_filters = list_length(chunk_state->runtime_filter_info);
+	chunk_state->runtime_filters =
+		palloc0(sizeof(DecompressChunkRuntimeFilter) * chunk_state->num_runtime_filters);
+
+	for (int i = 0; i < chunk_state->num_runtime_filters; i++)
+	{
+		List *info = list_nth(chunk_state->runtime_filter_info, i);
+		DecompressChunkRuntimeFilter *rf = &chunk_state->runtime_filters[i];
+		rf->paramid = linitial_int(info);
+		const AttrNumber custom_scan_attno = lsecond_int(info);
+
+		const CompressionColumnDescription *column = NULL;
+		for (int j = 0; j < dcontext->num_data_columns; j++)
+		{
+			if (dcontext->compressed_chunk_columns[j].custom_scan_attno == custom_scan_attno)
+			{
+				column = &dcontext->compressed_chunk_columns[j];
+				break;
+			}
+		}
+		Ensure(column != NULL, "runtime filter column %d not found", custom_scan_attno);
+
+		if (column->type == SEGMENTBY_COLUMN)
+		{
+			rf->min_attno = column->compressed_scan_attno;
+			rf->max_attno = column->compressed_scan_attno;
+		}
+		else
+		{
+			rf->min_attno = column->min_metadata_attno;
+			rf->max_attno = column->max_metadata_attno;
+		}
+
+		Form_pg_attribute attr =
+			TupleDescAttr(dcontext->custom_scan_slot->tts_tupleDescriptor,
+						  AttrNumberGetAttrOffset(custom_scan_attno));
+		rf->var = makeVar(cscan->custom_scan_tlist != NIL ? INDEX_VAR : cscan->scan.scanrelid,
+						  custom_scan_attno,
+						  attr->atttypid,
+						  attr->atttypmod,
+						  attr->attcollation,
+						  /* varlevelsup = */ 0);
+	}
+}
+
+/*
+ * Pick up the runtime filters that were published, republished or reset since
+ * the last batch, and rebuild the vectorized quals accordingly.
+ */
+static void
+runtime_filters_update(DecompressChunkState *chunk_state)
+{
+	ParamExecData *params = chunk_state->csstate.ss.ps.state->es_param_exec_vals;
+	bool changed = false;
+	for (int i = 0; i < chunk_state->num_runtime_filters; i++)
+	{
+		DecompressChunkRuntimeFilter *rf = &chunk_state->runtime_filters[i];
+		const ParamExecData *param = &params[rf->paramid];
+		RuntimeFilter *filter =
+			param->isnull ? NULL : (RuntimeFilter *) DatumGetPointer(param->value);
+		const uint64 version = filter != NULL ? filter->version : 0;
+		if (filter != rf->filter || version != rf->version)
+		{
+			rf->filter = filter;
+			rf->version = version;
+			changed = true;
+		}
+	}
+
+	if (!changed)
+	{
+		return;
+	}
+
+	DecompressContext *dcontext = &chunk_state->decompress_context;
+	List *quals = list_copy(chunk_state->vectorized_quals_static);
+	for (int i = 0; i < chunk_state->num_runtime_filters; i++)
+	{
+		DecompressChunkRuntimeFilter *rf = &chunk_state->runtime_filters[i];
+		if (rf->filter != NULL && !rf->filter->empty)
+		{
+			quals = list_concat(quals, runtime_filter_make_quals(rf->filter, rf->var));
+		}
+	}
+	dcontext->vectorized_quals_constified = quals;
+}
+
+/*
+ * Check whether the compressed batch can't have any rows that pass the runtime
+ * join filters, according to its min/max metadata or segmentby value. The
+ * batches that do pass are filtered by the vectorized quals built from the
+ * filters.
+ */
+static bool
+runtime_filters_can_skip_batch(DecompressChunkState *chunk_state, TupleTableSlot *compressed_slot)
+{
+	runtime_filters_update(chunk_state);
+
+	for (int i = 0; i < chunk_state->num_runtime_filters; i++)
+	{
+		DecompressChunkRuntimeFilter *rf = &chunk_state->runtime_filters[i];
+		if (rf->filter == NULL)
+		{
+			continue;
+		}
+
+		if (rf->filter->empty)
+		{
+			return true;
+		}
+
+		if (rf->min_attno == InvalidAttrNumber || rf->max_attno == InvalidAttrNumber)
+		{
+			continue;
+		}
+
+		bool min_isnull;
+		bool max_isnull;
+		Datum min = slot_getattr(compressed_slot, rf->min_attno, &min_isnull);
+		Datum max = slot_getattr(compressed_slot, rf->max_attno, &max_isnull);
+		if (min_isnull || max_isnull)
+		{
+			continue;
+		}
+
+		if (runtime_filter_excludes_range(rf->filter, min, max))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static TupleTableSlot *
 decompress_chunk_exec_fifo(CustomScanState *node)
 {
@@ -268,6 +525,7 @@ decompress_chunk_begin(CustomScanState *node, EState *estate, int eflags)
 	dcontext->num_columns_with_metadata = num_columns_with_metadata;
 	dcontext->compressed_chunk_columns =
 		palloc0(sizeof(CompressionColumnDescription) * num_columns_with_metadata);
+	dcontext->stats.column_rows = palloc0(sizeof(int64) * Max(num_data_columns, 1));
 	dcontext->custom_scan_slot = node->ss.ss_ScanTupleSlot;
 	dcontext->uncompressed_chunk_tdesc = RelationGetDescr(node->ss.ss_currentRelation);
 	dcontext->ps = &node->ss.ps;
@@ -287,7 +545,9 @@ decompress_chunk_begin(CustomScanState *node, EState *estate, int eflags)
 			.compressed_scan_attno = AttrOffsetGetAttrNumber(compressed_index),
 			.custom_scan_attno = list_nth_int(chunk_state->decompression_map, compressed_index),
 			.bulk_decompression_supported =
-				list_nth_int(chunk_state->bulk_decompression_column, compressed_index)
+				list_nth_int(chunk_state->bulk_decompression_column, compressed_index),
+			.min_metadata_attno = list_nth_int(chunk_state->min_metadata_column, compressed_index),
+			.max_metadata_attno = list_nth_int(chunk_state->max_metadata_column, compressed_index),
 		};
 
 		if (column.custom_scan_attno == 0)
@@ -310,6 +570,10 @@ decompress_chunk_begin(CustomScanState *node, EState *estate, int eflags)
 			else
 				column.type = COMPRESSED_COLUMN;
 
+			if (dcontext->batch_sorted_merge)
+				column.is_batch_sort_key =
+					list_member_oid(linitial(chunk_state->sortinfo), column.custom_scan_attno);
+
 			if (cscan->custom_scan_tlist == NIL)
 			{
 				column.uncompressed_chunk_attno = column.custom_scan_attno;
@@ -400,6 +664,17 @@ decompress_chunk_begin(CustomScanState *node, EState *estate, int eflags)
 			lappend(dcontext->vectorized_quals_constified, constified);
 	}
 
+	if (chunk_state->topn_limit > 0)
+	{
+		chunk_state->topn_heap =
+			binaryheap_allocate(chunk_state->topn_limit, topn_heap_compare, chunk_state);
+	}
+
+	if (chunk_state->runtime_filter_info != NIL)
+	{
+		runtime_filters_init(chunk_state);
+	}
+
 	detoaster_init(&dcontext->detoaster, CurrentMemoryContext);
 }
 
@@ -428,6 +703,25 @@ decompress_chunk_exec_impl(DecompressChunkState *chunk_state, const BatchQueueFu
 			break;
 		}
 
+		if (!decompress_chunk_claim_batch(chunk_state, subslot))
+		{
+			/* Another parallel participant decompresses this batch. */
+			continue;
+		}
+
+		if (chunk_state->topn_limit > 0 && topn_can_skip_batch(chunk_state, subslot))
+		{
+			InstrCountTuples2(dcontext->ps, 1);
+			continue;
+		}
+
+		if (chunk_state->num_runtime_filters > 0 &&
+			runtime_filters_can_skip_batch(chunk_state, subslot))
+		{
+			InstrCountTuples2(dcontext->ps, 1);
+			continue;
+		}
+
 		bqfuncs->push_batch(bq, dcontext, subslot);
 	}
 	TupleTableSlot *result_slot = bqfuncs->top_tuple(bq);
@@ -444,6 +738,11 @@ decompress_chunk_exec_impl(DecompressChunkState *chunk_state, const BatchQueueFu
 				 errmsg("locking compressed tuples is not supported")));
 	}
 
+	if (chunk_state->topn_limit > 0)
+	{
+		topn_remember_value(chunk_state, result_slot);
+	}
+
 	if (chunk_state->csstate.ss.ps.ps_ProjInfo)
 	{
 		ExprContext *econtext = chunk_state->csstate.ss.ps.ps_ExprContext;
@@ -454,20 +753,126 @@ decompress_chunk_exec_impl(DecompressChunkState *chunk_state, const BatchQueueFu
 	return result_slot;
 }
 
+/*
+ * Check whether we can cache the decompressed batches across rescans. We
+ * identify the batches by the TID of the compressed tuple, so the compressed
+ * child has to be a plain scan of the compressed chunk. Batch sorted merge
+ * keeps many batches open at the same time, and would need pinning the cache
+ * entries, so it is not supported.
+ */
+static bool
+can_use_batch_cache(DecompressChunkState *chunk_state)
+{
+	DecompressContext *dcontext = &chunk_state->decompress_context;
+	PlanState *child = linitial(chunk_state->csstate.custom_ps);
+
+	if (!ts_guc_enable_decompression_cache || !dcontext->enable_bulk_decompression ||
+		dcontext->batch_sorted_merge)
+		return false;
+
+	if (chunk_state->csstate.ss.ps.state->es_plannedstmt->commandType != CMD_SELECT)
+		return false;
+
+	if (child->ps_ProjInfo != NULL)
+		return false;
+
+	switch (nodeTag(child->plan))
+	{
+		case T_SeqScan:
+		case T_IndexScan:
+		case T_BitmapHeapScan:
+			return true;
+		default:
+			return false;
+	}
+}
+
 static void
 decompress_chunk_rescan(CustomScanState *node)
 {
 	DecompressChunkState *chunk_state = (DecompressChunkState *) node;
+	DecompressContext *dcontext = &chunk_state->decompress_context;
 	BatchQueue *bq = chunk_state->batch_queue;
 
 	bq->funcs->reset(bq);
 
+	/*
+	 * We are rescanned, so the same batches are likely to be decompressed
+	 * again. Start caching them, within the work_mem limit.
+	 */
+	if (dcontext->batch_cache == NULL && can_use_batch_cache(chunk_state))
+	{
+		dcontext->batch_cache = decompress_batch_cache_create(node->ss.ps.state->es_query_cxt,
+															  work_mem * (Size) 1024);
+	}
+
+	if (chunk_state->topn_heap != NULL)
+		binaryheap_reset(chunk_state->topn_heap);
+
 	if (node->ss.ps.chgParam != NULL)
 		UpdateChangedParamSet(linitial(node->custom_ps), node->ss.ps.chgParam);
 
 	ExecReScan(linitial(node->custom_ps));
 }
 
+/*
+ * Add the counters of the decompression work to the cumulative statistics of
+ * the hypertable and its columns.
+ */
+static void
+decompress_chunk_report_stats(DecompressChunkState *chunk_state)
+{
+	const DecompressContext *dcontext = &chunk_state->decompress_context;
+	const DecompressStats *stats = &dcontext->stats;
+	int64 counters[COMPRESSED_SCAN_STATS_NUM_COUNTERS] = { 0 };
+
+	/* Also the case for EXPLAIN without ANALYZE. */
+	if (stats->batches == 0)
+	{
+		return;
+	}
+
+	counters[COMPRESSED_SCAN_STATS_SCANS] = 1;
+	counters[COMPRESSED_SCAN_STATS_BATCHES] = stats->batches;
+	counters[COMPRESSED_SCAN_STATS_BATCHES_FILTERED] = stats->batches_filtered;
+	counters[COMPRESSED_SCAN_STATS_DECOMPRESSED_ROWS] = stats->bulk_rows + stats->iterator_rows;
+	counters[COMPRESSED_SCAN_STATS_ITERATOR_ROWS] = stats->iterator_rows;
+	counters[COMPRESSED_SCAN_STATS_DETOASTED_BYTES] = stats->bytes_detoasted;
+	if (dcontext->vectorized_quals_constified != NIL)
+	{
+		counters[COMPRESSED_SCAN_STATS_VECTOR_QUAL_BATCHES] = stats->batches;
+	}
+	if (chunk_state->csstate.ss.ps.qual != NULL)
+	{
+		counters[COMPRESSED_SCAN_STATS_ROW_QUAL_BATCHES] = stats->batches;
+	}
+	if (dcontext->batch_cache != NULL)
+	{
+		counters[COMPRESSED_SCAN_STATS_CACHE_HITS] = dcontext->batch_cache->hits;
+		counters[COMPRESSED_SCAN_STATS_CACHE_MISSES] = dcontext->batch_cache->misses;
+	}
+	ts_compressed_scan_stats_report(chunk_state->hypertable_id, NULL, counters);
+
+	/* The column names of the chunk are the same as for the hypertable. */
+	for (int i = 0; i < dcontext->num_data_columns; i++)
+	{
+		const CompressionColumnDescription *column = &dcontext->compressed_chunk_columns[i];
+		if (column->type != COMPRESSED_COLUMN || stats->column_rows[i] == 0)
+		{
+			continue;
+		}
+
+		int64 column_counters[COMPRESSED_SCAN_STATS_NUM_COUNTERS] = { 0 };
+		column_counters[COMPRESSED_SCAN_STATS_DECOMPRESSED_ROWS] = stats->column_rows[i];
+		ts_compressed_scan_stats_report(
+			chunk_state->hypertable_id,
+			NameStr(TupleDescAttr(dcontext->uncompressed_chunk_tdesc,
+								  AttrNumberGetAttrOffset(column->uncompressed_chunk_attno))
+						->attname),
+			column_counters);
+	}
+}
+
 /* End the decompress operation and free the requested resources */
 static void
 decompress_chunk_end(CustomScanState *node)
@@ -475,12 +880,216 @@ decompress_chunk_end(CustomScanState *node)
 	DecompressChunkState *chunk_state = (DecompressChunkState *) node;
 	BatchQueue *bq = chunk_state->batch_queue;
 
+	decompress_chunk_report_stats(chunk_state);
+
 	bq->funcs->free(bq);
 	ExecEndNode(linitial(node->custom_ps));
 
 	detoaster_close(&chunk_state->decompress_context.detoaster);
 }
 
+/*
+ * Claim the compressed batch for decompression in the parallel-aware plans
+ * with the batch-level work distribution. Returns false if the batch was
+ * already claimed by another participant and has to be skipped. Always
+ * returns true for the plans that are not parallel-aware.
+ */
+bool
+decompress_chunk_claim_batch(DecompressChunkState *chunk_state, TupleTableSlot *compressed_slot)
+{
+	DecompressChunkParallelState *pstate = chunk_state->parallel_state;
+	if (pstate == NULL)
+	{
+		return true;
+	}
+
+	Ensure(ItemPointerIsValid(&compressed_slot->tts_tid),
+		   "no TID for the compressed tuple in parallel decompression");
+	const BlockNumber block = ItemPointerGetBlockNumber(&compressed_slot->tts_tid);
+	const OffsetNumber offset = ItemPointerGetOffsetNumber(&compressed_slot->tts_tid);
+	Ensure(block < pstate->nblocks && offset >= FirstOffsetNumber &&
+			   offset <= CLAIM_BITS_PER_BLOCK,
+		   "unexpected compressed tuple TID (%u,%u) in parallel decompression",
+		   block,
+		   offset);
+
+	const uint64 bit = (uint64) block * CLAIM_BITS_PER_BLOCK + (offset - FirstOffsetNumber);
+	const uint32 mask = 1U << (bit % 32);
+	const uint32 old_word = pg_atomic_fetch_or_u32(&pstate->claimed[bit / 32], mask);
+	return (old_word & mask) == 0;
+}
+
+/*
+ * The compressed scan of the parallel-aware plan is a plain sequential scan,
+ * see add_parallel_batch_distribution_path().
+ */
+static Relation
+get_compressed_relation(CustomScanState *node)
+{
+	PlanState *child = linitial(node->custom_ps);
+	Ensure(IsA(child, SeqScanState),
+		   "unexpected compressed scan node %d in parallel decompression",
+		   nodeTag(child));
+	return ((ScanState *) child)->ss_currentRelation;
+}
+
+static Size
+parallel_state_size(BlockNumber nblocks)
+{
+	const uint64 nbits = (uint64) nblocks * CLAIM_BITS_PER_BLOCK;
+	return add_size(offsetof(DecompressChunkParallelState, claimed),
+					mul_size(sizeof(pg_atomic_uint32), (nbits + 31) / 32));
+}
+
+static void
+init_parallel_state(DecompressChunkParallelState *pstate, BlockNumber nblocks)
+{
+	pstate->nblocks = nblocks;
+	const Size nwords = (parallel_state_size(nblocks) -
+						 offsetof(DecompressChunkParallelState, claimed)) /
+						sizeof(pg_atomic_uint32);
+	for (Size i = 0; i < nwords; i++)
+	{
+		pg_atomic_init_u32(&pstate->claimed[i], 0);
+	}
+}
+
+/*
+ * Estimate the size of the shared claim bitmap. The snapshot of the query is
+ * already taken, so all the compressed tuples visible to the participants are
+ * in the blocks that exist now.
+ */
+static Size
+decompress_chunk_estimate_dsm(CustomScanState *node, ParallelContext *pcxt)
+{
+	return parallel_state_size(RelationGetNumberOfBlocks(get_compressed_relation(node)));
+}
+
+static void
+decompress_chunk_initialize_dsm(CustomScanState *node, ParallelContext *pcxt, void *coordinate)
+{
+	DecompressChunkState *chunk_state = (DecompressChunkState *) node;
+	DecompressChunkParallelState *pstate = (DecompressChunkParallelState *) coordinate;
+
+	/*
+	 * The leader claims the batches in the same way as the workers. The state
+	 * size was determined by the estimate above, so use the same number of
+	 * blocks even if the relation has grown since then.
+	 */
+	const Size nwords = (node->pscan_len - offsetof(DecompressChunkParallelState, claimed)) /
+						sizeof(pg_atomic_uint32);
+	init_parallel_state(pstate, (BlockNumber) ((nwords * 32) / CLAIM_BITS_PER_BLOCK));
+	chunk_state->parallel_state = pstate;
+}
+
+static void
+decompress_chunk_reinitialize_dsm(CustomScanState *node, ParallelContext *pcxt, void *coordinate)
+{
+	DecompressChunkParallelState *pstate = (DecompressChunkParallelState *) coordinate;
+	init_parallel_state(pstate, pstate->nblocks);
+}
+
+static void
+decompress_chunk_initialize_worker(CustomScanState *node, shm_toc *toc, void *coordinate)
+{
+	DecompressChunkState *chunk_state = (DecompressChunkState *) node;
+
+	Assert(IsParallelWorker());
+	Assert(node->ss.ps.plan->parallel_aware);
+	Assert(coordinate != NULL);
+
+	chunk_state->parallel_state = (DecompressChunkParallelState *) coordinate;
+}
+
+/*
+ * Show the counters of the decompression work for EXPLAIN ANALYZE, if enabled
+ * by timescaledb.enable_decompression_stats.
+ */
+static void
+decompress_chunk_explain_stats(DecompressChunkState *chunk_state, ExplainState *es)
+{
+	const DecompressContext *dcontext = &chunk_state->decompress_context;
+	const DecompressStats *stats = &dcontext->stats;
+	const bool text_format = es->format == EXPLAIN_FORMAT_TEXT;
+
+	ExplainPropertyInteger("Batches Fetched", NULL, stats->batches, es);
+
+	/*
+	 * The batches that don't match the filters on the batch metadata are
+	 * removed by the filter of the compressed chunk scan.
+	 */
+	PlanState *compressed_scan = linitial(chunk_state->csstate.custom_ps);
+	if (compressed_scan->plan->qual != NIL && compressed_scan->instrument != NULL)
+	{
+		ExplainPropertyFloat("Batches Pruned by Metadata",
+							 NULL,
+							 compressed_scan->instrument->nfiltered1,
+							 0,
+							 es);
+	}
+
+	if (stats->bytes_detoasted > 0 || !text_format)
+	{
+		ExplainPropertyInteger("Detoasted", "bytes", stats->bytes_detoasted, es);
+	}
+
+	if (stats->bulk_rows > 0 || !text_format)
+	{
+		ExplainPropertyInteger("Bulk Decompressed Rows", NULL, stats->bulk_rows, es);
+	}
+
+	if (stats->iterator_rows > 0 || !text_format)
+	{
+		ExplainPropertyInteger("Row-by-Row Decompressed Rows", NULL, stats->iterator_rows, es);
+	}
+
+	/* The decompressed rows per column, the segmentby columns are not decompressed. */
+	TupleDesc desc = dcontext->custom_scan_slot->tts_tupleDescriptor;
+	StringInfoData column_rows;
+	initStringInfo(&column_rows);
+	for (int i = 0; i < dcontext->num_data_columns; i++)
+	{
+		const CompressionColumnDescription *column = &dcontext->compressed_chunk_columns[i];
+		if (column->type != COMPRESSED_COLUMN || column->custom_scan_attno <= 0)
+		{
+			continue;
+		}
+
+		appendStringInfo(&column_rows,
+						 "%s%s: " INT64_FORMAT,
+						 column_rows.len > 0 ? ", " : "",
+						 quote_identifier(
+							 NameStr(TupleDescAttr(desc, column->custom_scan_attno - 1)->attname)),
+						 stats->column_rows[i]);
+	}
+	if (column_rows.len > 0)
+	{
+		ExplainPropertyText("Decompressed Rows by Column", column_rows.data, es);
+	}
+
+	if (es->timing)
+	{
+		ExplainPropertyFloat("Detoast Time",
+							 "ms",
+							 INSTR_TIME_GET_MILLISEC(stats->detoast_time),
+							 3,
+							 es);
+		ExplainPropertyFloat("Bulk Decompression Time",
+							 "ms",
+							 INSTR_TIME_GET_MILLISEC(stats->decompress_time),
+							 3,
+							 es);
+		if (chunk_state->vectorized_quals_original != NIL)
+		{
+			ExplainPropertyFloat("Vectorized Filter Time",
+								 "ms",
+								 INSTR_TIME_GET_MILLISEC(stats->qual_time),
+								 3,
+								 es);
+		}
+	}
+}
+
 /*
  * Output additional information for EXPLAIN of a custom-scan plan node.
  */
@@ -515,6 +1124,11 @@ decompress_chunk_explain(CustomScanState *node, List *ancestors, ExplainState *e
 							 es);
 	}
 
+	if (es->analyze && ts_guc_enable_decompression_stats)
+	{
+		decompress_chunk_explain_stats(chunk_state, es);
+	}
+
 	if (es->verbose || es->format != EXPLAIN_FORMAT_TEXT)
 	{
 		if (dcontext->batch_sorted_merge)
@@ -528,5 +1142,17 @@ decompress_chunk_explain(CustomScanState *node, List *ancestors, ExplainState *e
 								chunk_state->decompress_context.enable_bulk_decompression,
 								es);
 		}
+
+		if (es->analyze && dcontext->batch_cache != NULL)
+		{
+			ExplainPropertyInteger("Decompression Cache Hits",
+								   NULL,
+								   dcontext->batch_cache->hits,
+								   es);
+			ExplainPropertyInteger("Decompression Cache Misses",
+								   NULL,
+								   dcontext->batch_cache->misses,
+								   es);
+		}
 	}
 }
@@ -9,17 +9,44 @@
 
 #include "batch_queue.h"
 #include "decompress_context.h"
+#include <lib/binaryheap.h>
 #include <nodes/extensible.h>
+#include <utils/sortsupport.h>
 
 #define DECOMPRESS_CHUNK_COUNT_ID -9
 #define DECOMPRESS_CHUNK_SEQUENCE_NUM_ID -10
 
+/*
+ * A runtime join filter published by a hash join above this node, see
+ * nodes/runtime_filter/runtime_filter.c.
+ */
+typedef struct DecompressChunkRuntimeFilter
+{
+	int paramid;
+
+	/* The filtered column, and a Var referencing it for the vectorized quals. */
+	Var *var;
+
+	/*
+	 * Attnos of the batch min and max of the filtered column in the compressed
+	 * scan tuple. For segmentby columns, both are the column itself.
+	 */
+	AttrNumber min_attno;
+	AttrNumber max_attno;
+
+	/* The currently applied filter and its version. */
+	struct RuntimeFilter *filter;
+	uint64 version;
+} DecompressChunkRuntimeFilter;
+
 typedef struct DecompressChunkState
 {
 	CustomScanState csstate;
 	List *decompression_map;
 	List *is_segmentby_column;
 	List *bulk_decompression_column;
+	List *min_metadata_column;
+	List *max_metadata_column;
 	List *custom_scan_tlist;
 	bool has_row_marks;
 
@@ -42,9 +69,39 @@ typedef struct DecompressChunkState
 	 * evaluate to constant false, hence the flag.
 	 */
 	List *vectorized_quals_original;
+
+	/*
+	 * The shared state for the batch-level work distribution in the
+	 * parallel-aware plans. NULL otherwise.
+	 */
+	struct DecompressChunkParallelState *parallel_state;
+
+	/*
+	 * Pruning of the compressed batches that can't enter the top-N result of
+	 * an ORDER BY ... LIMIT query, see build_topn_info(). The heap contains the
+	 * best topn_limit values of the first sort column among the returned rows,
+	 * with the worst of them on top. The limit is zero if this is disabled.
+	 */
+	int topn_limit;
+	AttrNumber topn_value_attno;
+	AttrNumber topn_metadata_attno;
+	SortSupportData topn_sortkey;
+	binaryheap *topn_heap;
+
+	/*
+	 * The runtime join filters, and the vectorized quals of the plan which we
+	 * combine with the quals built from the filters when they change.
+	 */
+	List *runtime_filter_info;
+	int num_runtime_filters;
+	DecompressChunkRuntimeFilter *runtime_filters;
+	List *vectorized_quals_static;
 } DecompressChunkState;
 
 extern Node *decompress_chunk_state_create(CustomScan *cscan);
 
+extern bool decompress_chunk_claim_batch(DecompressChunkState *chunk_state,
+										 TupleTableSlot *compressed_slot);
+
 TupleTableSlot *decompress_chunk_exec_vector_agg_impl(CustomScanState *vector_agg_state,
 													  DecompressChunkState *decompress_state);
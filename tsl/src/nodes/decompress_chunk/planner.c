@@ -5,7 +5,10 @@
  */
 
 #include <postgres.h>
+#include <access/htup_details.h>
+#include <access/stratnum.h>
 #include <access/sysattr.h>
+#include <catalog/pg_attribute.h>
 #include <catalog/pg_namespace.h>
 #include <catalog/pg_operator.h>
 #include <nodes/bitmapset.h>
@@ -22,6 +25,9 @@
 #include <parser/parse_relation.h>
 #include <parser/parsetree.h>
 #include <utils/builtins.h>
+#include <utils/fmgroids.h>
+#include <utils/lsyscache.h>
+#include <utils/syscache.h>
 #include <utils/typcache.h>
 
 #include "compression/compression.h"
@@ -35,6 +41,7 @@
 #include "nodes/decompress_chunk/exec.h"
 #include "nodes/decompress_chunk/planner.h"
 #include "nodes/decompress_chunk/vector_quals.h"
+#include "nodes/skip_scan/skip_scan.h"
 #include "nodes/vector_agg/exec.h"
 #include "ts_catalog/array_utils.h"
 #include "vector_predicates.h"
@@ -70,6 +77,8 @@ check_for_system_columns(Bitmapset *attrs_used)
 typedef struct
 {
 	bool bulk_decompression_possible;
+	/* Whether the vectorized filters can read the ->> fields of this jsonb column. */
+	bool jsonb_fields_possible;
 	int custom_scan_attno;
 } UncompressedColumnInfo;
 
@@ -146,6 +155,15 @@ typedef struct
 	 */
 	List *bulk_decompression_column;
 
+	/*
+	 * Same structure as above, the positions in the compressed scan targetlist
+	 * of the min and max metadata columns of this column, or zero if it
+	 * doesn't have them. Used to compute min() and max() from the metadata
+	 * alone for the batches that don't need filtering.
+	 */
+	List *min_metadata_column;
+	List *max_metadata_column;
+
 } DecompressionMapContext;
 
 static bool *
@@ -162,6 +180,30 @@ build_vector_attrs_array(const UncompressedColumnInfo *colinfo, const Compressio
 	return vector_attrs;
 }
 
+/*
+ * Build the array of the jsonb columns which fields can be used in the
+ * vectorized filters. Returns NULL when there are none.
+ */
+static bool *
+build_jsonb_field_attrs_array(const UncompressedColumnInfo *colinfo, const CompressionInfo *info)
+{
+	const AttrNumber arrlen = info->chunk_rel->max_attr + 1;
+	bool *jsonb_field_attrs = NULL;
+
+	for (AttrNumber attno = 0; attno < arrlen; attno++)
+	{
+		if (!colinfo[attno].jsonb_fields_possible)
+			continue;
+
+		if (jsonb_field_attrs == NULL)
+			jsonb_field_attrs = palloc0(sizeof(bool) * arrlen);
+
+		jsonb_field_attrs[attno] = true;
+	}
+
+	return jsonb_field_attrs;
+}
+
 /*
  * Try to make the custom scan targetlist that follows the order of the
  * pathtarget. This would allow us to avoid a projection from scan tuple to
@@ -238,6 +280,25 @@ follow_uncompressed_output_tlist(const DecompressionMapContext *context)
 	return result;
 }
 
+/*
+ * Find the position of the given compressed chunk attribute in the compressed
+ * scan targetlist. Returns InvalidAttrNumber if the attribute is not scanned.
+ */
+static AttrNumber
+find_compressed_scan_resno(List *compressed_scan_tlist, AttrNumber compressed_chunk_attno)
+{
+	ListCell *lc;
+	foreach (lc, compressed_scan_tlist)
+	{
+		TargetEntry *target = lfirst_node(TargetEntry, lc);
+		if (IsA(target->expr, Var) && castNode(Var, target->expr)->varattno == compressed_chunk_attno)
+		{
+			return target->resno;
+		}
+	}
+	return InvalidAttrNumber;
+}
+
 /*
  * Given the compressed output targetlist and the bitmapset of the needed
  * columns, determine which compressed chunk column become which uncompressed
@@ -395,6 +456,13 @@ build_decompression_map(DecompressionMapContext *context, List *compressed_scan_
 				NULL;
 		context->have_bulk_decompression_columns |= bulk_decompression_possible;
 
+		/*
+		 * The fields of the compressed jsonb columns can be read from their
+		 * shredded sub-columns by the vectorized filters.
+		 */
+		const bool jsonb_fields_possible = ts_guc_enable_jsonb_shredding && !is_segment &&
+										   destination_attno > 0 && typoid == JSONBOID;
+
 		/*
 		 * Save information about decompressed columns in uncompressed chunk
 		 * for planning of vectorized filters.
@@ -403,6 +471,7 @@ build_decompression_map(DecompressionMapContext *context, List *compressed_scan_
 		{
 			context->uncompressed_attno_info[uncompressed_chunk_attno] = (UncompressedColumnInfo){
 				.bulk_decompression_possible = bulk_decompression_possible,
+				.jsonb_fields_possible = jsonb_fields_possible,
 				.custom_scan_attno = InvalidAttrNumber,
 			};
 		}
@@ -515,6 +584,29 @@ build_decompression_map(DecompressionMapContext *context, List *compressed_scan_
 		context->bulk_decompression_column =
 			lappend_int(context->bulk_decompression_column,
 						compressed_info->bulk_decompression_possible);
+
+		AttrNumber min_metadata_resno = InvalidAttrNumber;
+		AttrNumber max_metadata_resno = InvalidAttrNumber;
+		if (compressed_info->bulk_decompression_possible)
+		{
+			const AttrNumber uncompressed_chunk_attno = compressed_info->uncompressed_chunk_attno;
+			const AttrNumber min_attno = compressed_column_metadata_attno(info->settings,
+																		  info->chunk_rte->relid,
+																		  uncompressed_chunk_attno,
+																		  info->compressed_rte->relid,
+																		  "min");
+			const AttrNumber max_attno = compressed_column_metadata_attno(info->settings,
+																		  info->chunk_rte->relid,
+																		  uncompressed_chunk_attno,
+																		  info->compressed_rte->relid,
+																		  "max");
+			min_metadata_resno = find_compressed_scan_resno(compressed_scan_tlist, min_attno);
+			max_metadata_resno = find_compressed_scan_resno(compressed_scan_tlist, max_attno);
+		}
+		context->min_metadata_column =
+			lappend_int(context->min_metadata_column, min_metadata_resno);
+		context->max_metadata_column =
+			lappend_int(context->max_metadata_column, max_metadata_resno);
 	}
 }
 
@@ -661,6 +753,42 @@ is_not_runtime_constant(Node *node)
 	return result;
 }
 
+/*
+ * Check if the expression is a "jsonb_column ->> 'key'" field of a compressed
+ * jsonb column, which the vectorized filters can read from its shredded
+ * sub-column. Returns the Var of the column if so, NULL otherwise.
+ */
+static Var *
+get_jsonb_field_var(Node *node, const VectorQualInfo *vqinfo)
+{
+	if (vqinfo->jsonb_field_attrs == NULL || !IsA(node, OpExpr))
+	{
+		return NULL;
+	}
+
+	OpExpr *opexpr = castNode(OpExpr, node);
+	if (get_opcode(opexpr->opno) != F_JSONB_OBJECT_FIELD_TEXT || list_length(opexpr->args) != 2)
+	{
+		return NULL;
+	}
+
+	Node *column = linitial(opexpr->args);
+	Node *key = lsecond(opexpr->args);
+	if (!IsA(column, Var) || !IsA(key, Const) || castNode(Const, key)->constisnull)
+	{
+		return NULL;
+	}
+
+	Var *var = castNode(Var, column);
+	if ((Index) var->varno != vqinfo->rti || var->varattno <= 0 ||
+		var->varattno > vqinfo->maxattno || !vqinfo->jsonb_field_attrs[var->varattno])
+	{
+		return NULL;
+	}
+
+	return var;
+}
+
 /*
  * Try to check if the current qual is vectorizable, and if needed make a
  * commuted copy. If not, return NULL.
@@ -679,9 +807,30 @@ vector_qual_make(Node *qual, const VectorQualInfo *vqinfo)
 		{
 			/*
 			 * NOT should be removed by Postgres for all operators we can
-			 * vectorize (see prepqual.c), so we don't support it.
+			 * vectorize (see prepqual.c). The exception is IS NOT DISTINCT
+			 * FROM, which is represented as NOT over IS DISTINCT FROM, and
+			 * which we evaluate as a single predicate.
 			 */
-			return NULL;
+			Node *arg = linitial(boolexpr->args);
+			if (!IsA(arg, DistinctExpr))
+			{
+				return NULL;
+			}
+
+			Node *vectorized_arg = vector_qual_make(arg, vqinfo);
+			if (vectorized_arg == NULL)
+			{
+				return NULL;
+			}
+
+			if (vectorized_arg == arg)
+			{
+				return (Node *) boolexpr;
+			}
+
+			BoolExpr *boolexpr_copy = (BoolExpr *) copyObject(boolexpr);
+			boolexpr_copy->args = list_make1(vectorized_arg);
+			return (Node *) boolexpr_copy;
 		}
 
 		bool need_copy = false;
@@ -716,7 +865,9 @@ vector_qual_make(Node *qual, const VectorQualInfo *vqinfo)
 
 	/*
 	 * Among the simple predicates, we vectorize some "Var op Const" binary
-	 * predicates, scalar array operations with these predicates, and null test.
+	 * predicates, IS DISTINCT FROM with these predicates, scalar array
+	 * operations with these predicates, and null test. DistinctExpr has the
+	 * same layout as OpExpr, so we handle them together.
 	 */
 	NullTest *nulltest = NULL;
 	OpExpr *opexpr = NULL;
@@ -724,9 +875,9 @@ vector_qual_make(Node *qual, const VectorQualInfo *vqinfo)
 	Node *arg1 = NULL;
 	Node *arg2 = NULL;
 	Oid opno = InvalidOid;
-	if (IsA(qual, OpExpr))
+	if (IsA(qual, OpExpr) || IsA(qual, DistinctExpr))
 	{
-		opexpr = castNode(OpExpr, qual);
+		opexpr = (OpExpr *) qual;
 		opno = opexpr->opno;
 		if (list_length(opexpr->args) != 2)
 		{
@@ -753,7 +904,7 @@ vector_qual_make(Node *qual, const VectorQualInfo *vqinfo)
 		return NULL;
 	}
 
-	if (opexpr && IsA(arg2, Var))
+	if (opexpr && (IsA(arg2, Var) || get_jsonb_field_var(arg2, vqinfo) != NULL))
 	{
 		/*
 		 * Try to commute the operator if we have Var on the right.
@@ -778,14 +929,15 @@ vector_qual_make(Node *qual, const VectorQualInfo *vqinfo)
 	}
 
 	/*
-	 * We can vectorize the operation where the left side is a Var.
+	 * We can vectorize the operation where the left side is a Var, or a field
+	 * of a compressed jsonb column.
 	 */
-	if (!IsA(arg1, Var))
+	Var *var = IsA(arg1, Var) ? castNode(Var, arg1) : get_jsonb_field_var(arg1, vqinfo);
+	if (var == NULL)
 	{
 		return NULL;
 	}
 
-	Var *var = castNode(Var, arg1);
 	if ((Index) var->varno != vqinfo->rti)
 	{
 		/*
@@ -807,7 +959,7 @@ vector_qual_make(Node *qual, const VectorQualInfo *vqinfo)
 	 * ExecQual is performed before ExecProject and operates on the decompressed
 	 * scan slot, so the qual attnos are the uncompressed chunk attnos.
 	 */
-	if (!vqinfo->vector_attrs[var->varattno])
+	if (IsA(arg1, Var) && !vqinfo->vector_attrs[var->varattno])
 	{
 		/* This column doesn't support bulk decompression. */
 		return NULL;
@@ -838,7 +990,8 @@ vector_qual_make(Node *qual, const VectorQualInfo *vqinfo)
 		return NULL;
 	}
 
-	if (OidIsValid(var->varcollid) && !get_collation_isdeterministic(var->varcollid))
+	const Oid collation = exprCollation(arg1);
+	if (OidIsValid(collation) && !get_collation_isdeterministic(collation))
 	{
 		/*
 		 * Can't vectorize string equality with a nondeterministic collation.
@@ -886,6 +1039,8 @@ find_vectorized_quals(DecompressionMapContext *context, DecompressChunkPath *pat
 	VectorQualInfo vqi = {
 		.maxattno = path->info->chunk_rel->max_attr,
 		.vector_attrs = build_vector_attrs_array(context->uncompressed_attno_info, path->info),
+		.jsonb_field_attrs =
+			build_jsonb_field_attrs_array(context->uncompressed_attno_info, path->info),
 		.rti = path->info->chunk_rel->relid,
 	};
 
@@ -914,6 +1069,8 @@ find_vectorized_quals(DecompressionMapContext *context, DecompressChunkPath *pat
 	}
 
 	pfree(vqi.vector_attrs);
+	if (vqi.jsonb_field_attrs != NULL)
+		pfree(vqi.jsonb_field_attrs);
 }
 
 /*
@@ -1000,6 +1157,112 @@ find_var_subexpression(void *expr, Index varno)
 	return NULL;
 }
 
+/*
+ * Check whether we can prune the compressed batches that can't enter the
+ * top-N result of an ORDER BY ... LIMIT query. This is the case when our output
+ * is unordered and goes into a Sort with the limit bound, and we have min/max
+ * metadata for the first sort column. The executor keeps a bounded heap of the
+ * best N values of this column among the returned rows, and skips the
+ * compressed batches whose metadata is strictly worse than the N-th one.
+ *
+ * Returns NIL if this is not possible, or the list of the parameters required
+ * by the executor otherwise.
+ */
+static List *
+build_topn_info(PlannerInfo *root, const DecompressChunkPath *dcpath,
+				const DecompressionMapContext *context, List *compressed_scan_tlist)
+{
+	const CompressionInfo *info = dcpath->info;
+
+	if (dcpath->batch_sorted_merge || dcpath->custom_path.path.pathkeys != NIL ||
+		root->sort_pathkeys == NIL)
+		return NIL;
+
+	/*
+	 * Same as the hard limit check for ChunkAppend: the limit doesn't apply to
+	 * our output if there is grouping, joins, or SRFs in the tlist. We also
+	 * have to keep the N values in memory.
+	 */
+	Query *parse = root->parse;
+	if (root->limit_tuples <= 0 || root->limit_tuples > PG_INT32_MAX ||
+		root->limit_tuples * sizeof(Datum) > work_mem * 1024.0 || parse->groupClause ||
+		parse->groupingSets || parse->distinctClause || parse->hasAggs ||
+		parse->hasWindowFuncs || root->hasHavingQual || parse->hasTargetSRFs ||
+		list_length(parse->jointree->fromlist) != 1 ||
+		!IsA(linitial(parse->jointree->fromlist), RangeTblRef))
+		return NIL;
+
+	PathKey *pk = linitial_node(PathKey, root->sort_pathkeys);
+	Var *var = NULL;
+	ListCell *lc;
+	foreach (lc, pk->pk_eclass->ec_members)
+	{
+		EquivalenceMember *em = lfirst(lc);
+		if (!em->em_is_const && IsA(em->em_expr, Var) &&
+			(Index) castNode(Var, em->em_expr)->varno == info->chunk_rel->relid &&
+			castNode(Var, em->em_expr)->varattno > 0)
+		{
+			var = castNode(Var, em->em_expr);
+			break;
+		}
+	}
+
+	/* We keep the bound values without copying, so require a by-value type. */
+	if (var == NULL || !get_typbyval(var->vartype))
+		return NIL;
+
+	const int decompressed_scan_attno =
+		context->uncompressed_attno_info[var->varattno].custom_scan_attno;
+	if (decompressed_scan_attno <= 0)
+		return NIL;
+
+	/*
+	 * The min/max metadata doesn't tell whether a batch has nulls, so the nulls
+	 * must either sort last or be impossible.
+	 */
+	if (pk->pk_nulls_first)
+	{
+		HeapTuple tuple = SearchSysCache2(ATTNUM,
+										  ObjectIdGetDatum(info->chunk_rte->relid),
+										  Int16GetDatum(var->varattno));
+		if (!HeapTupleIsValid(tuple))
+			return NIL;
+		const bool notnull = ((Form_pg_attribute) GETSTRUCT(tuple))->attnotnull;
+		ReleaseSysCache(tuple);
+		if (!notnull)
+			return NIL;
+	}
+
+	/*
+	 * The best possible value of a batch is its min for ascending order and
+	 * its max for descending order.
+	 */
+	const int metadata_attno =
+		compressed_column_metadata_attno(info->settings,
+										 info->chunk_rte->relid,
+										 var->varattno,
+										 info->compressed_rte->relid,
+										 pk->pk_strategy == BTLessStrategyNumber ? "min" : "max");
+	if (metadata_attno == InvalidAttrNumber)
+		return NIL;
+
+	const AttrNumber metadata_resno =
+		find_compressed_scan_resno(compressed_scan_tlist, metadata_attno);
+	if (metadata_resno == InvalidAttrNumber)
+		return NIL;
+
+	Oid sortop =
+		get_opfamily_member(pk->pk_opfamily, var->vartype, var->vartype, pk->pk_strategy);
+	if (!OidIsValid(sortop))
+		return NIL;
+
+	return list_make2(list_make4_int((int) root->limit_tuples,
+									 decompressed_scan_attno,
+									 metadata_resno,
+									 pk->pk_nulls_first),
+					  list_make2_oid(sortop, var->varcollid));
+}
+
 Plan *
 decompress_chunk_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *path,
 							 List *output_targetlist, List *clauses, List *custom_plans)
@@ -1008,12 +1271,24 @@ decompress_chunk_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *pat
 	CustomScan *decompress_plan = makeNode(CustomScan);
 	Scan *compressed_scan = linitial(custom_plans);
 	Path *compressed_path = linitial(path->custom_paths);
+	CustomScan *skip_scan = NULL;
 	List *settings;
 	ListCell *lc;
 
 	Assert(list_length(custom_plans) == 1);
 	Assert(list_length(path->custom_paths) == 1);
 
+	/*
+	 * The compressed scan can be a SkipScan over an index scan on the
+	 * compressed chunk. The SkipScan passes through the tuples of the index
+	 * scan, so we look at the index scan for the clauses and the targetlist.
+	 */
+	if (tsl_is_skip_scan_path(compressed_path))
+	{
+		skip_scan = castNode(CustomScan, compressed_scan);
+		compressed_path = linitial(castNode(CustomPath, compressed_path)->custom_paths);
+	}
+
 	decompress_plan->flags = path->flags;
 	decompress_plan->methods = &decompress_chunk_plan_methods;
 	decompress_plan->scan.scanrelid = dcpath->info->chunk_rel->relid;
@@ -1096,6 +1371,9 @@ decompress_chunk_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *pat
 		}
 	}
 
+	if (skip_scan)
+		tsl_skip_scan_set_targetlist(skip_scan, compressed_scan->plan.targetlist);
+
 	/*
 	 * Determine which columns we have to decompress.
 	 * output_targetlist is sometimes empty, e.g. for a direct select from
@@ -1382,6 +1660,12 @@ decompress_chunk_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *pat
 	lfirst(list_nth_cell(decompress_plan->custom_private, DCP_BulkDecompressionColumn)) =
 		context.bulk_decompression_column;
 	lfirst(list_nth_cell(decompress_plan->custom_private, DCP_SortInfo)) = sort_options;
+	lfirst(list_nth_cell(decompress_plan->custom_private, DCP_TopNInfo)) =
+		build_topn_info(root, dcpath, &context, compressed_scan->plan.targetlist);
+	lfirst(list_nth_cell(decompress_plan->custom_private, DCP_MinMaxMetadata)) =
+		list_make2(context.min_metadata_column, context.max_metadata_column);
+	/* Filled in by the plan postprocessing, see runtime_filter.c */
+	lfirst(list_nth_cell(decompress_plan->custom_private, DCP_RuntimeFilters)) = NIL;
 
 	/*
 	 * We might be using a custom scan tuple if it allows us to avoid the
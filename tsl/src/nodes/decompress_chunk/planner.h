@@ -25,6 +25,9 @@ typedef enum
 	DCP_IsSegmentbyColumn = 2,
 	DCP_BulkDecompressionColumn = 3,
 	DCP_SortInfo = 4,
+	DCP_TopNInfo = 5,
+	DCP_MinMaxMetadata = 6,
+	DCP_RuntimeFilters = 7,
 	DCP_Count
 } DecompressChunkPrivateIndex;
 
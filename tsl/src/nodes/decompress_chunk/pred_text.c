@@ -7,6 +7,7 @@
 #include "pred_text.h"
 
 #include <miscadmin.h>
+#include <port/pg_bitutils.h>
 
 #include "compat/compat.h"
 
@@ -157,15 +158,227 @@ vector_const_like_impl(const ArrowArray *arrow, const Datum constdatum, uint64 *
 #undef INNER_LOOP
 }
 
+/*
+ * The LIKE patterns that are a literal with wildcards only at the start or at
+ * the end, which we match without the general matcher. UTF8 is
+ * self-synchronizing, so a bytewise match of the literal is also a match of
+ * the characters.
+ */
+typedef enum LikeLiteralPattern
+{
+	LIKE_LITERAL_NONE,	   /* any other pattern */
+	LIKE_LITERAL_PREFIX,   /* 'literal%' */
+	LIKE_LITERAL_SUFFIX,   /* '%literal' */
+	LIKE_LITERAL_CONTAINS, /* '%literal%' */
+} LikeLiteralPattern;
+
+static LikeLiteralPattern
+like_literal_pattern(const char *pattern, size_t patternlen, const char **literal,
+					 size_t *literallen)
+{
+	size_t start = 0;
+	size_t end = patternlen;
+
+	while (start < end && pattern[start] == '%')
+		start++;
+
+	while (end > start && pattern[end - 1] == '%')
+		end--;
+
+	/* The literal must not have wildcards or escapes */
+	for (size_t i = start; i < end; i++)
+	{
+		if (pattern[i] == '%' || pattern[i] == '_' || pattern[i] == '\\')
+			return LIKE_LITERAL_NONE;
+	}
+
+	*literal = &pattern[start];
+	*literallen = end - start;
+
+	if (start > 0 && (end < patternlen || start == patternlen))
+		return LIKE_LITERAL_CONTAINS;
+	if (start > 0)
+		return LIKE_LITERAL_SUFFIX;
+	if (end < patternlen)
+		return LIKE_LITERAL_PREFIX;
+	return LIKE_LITERAL_NONE;
+}
+
+static void
+vector_const_like_prefix_suffix(const ArrowArray *arrow, const char *literal, size_t literallen,
+								bool suffix, bool should_match, uint64 *restrict result)
+{
+	const uint32 *offsets = (uint32 *) arrow->buffers[1];
+	const char *restrict values = arrow->buffers[2];
+
+	const size_t n = arrow->length;
+	for (size_t outer = 0; outer < n / 64; outer++)
+	{
+		uint64 word = 0;
+		for (size_t inner = 0; inner < 64; inner++)
+		{
+			const size_t row = (outer * 64) + inner;
+			const size_t bit_index = inner;
+#define INNER_LOOP                                                                                 \
+	const uint32 start = offsets[row];                                                             \
+	const uint32 end = offsets[row + 1];                                                           \
+	Assert(end >= start);                                                                          \
+	const uint32 veclen = end - start;                                                             \
+	const uint32 compare_start = suffix ? end - literallen : start;                                \
+	bool ismatch =                                                                                 \
+		veclen >= literallen && memcmp(&values[compare_start], literal, literallen) == 0;          \
+	word |= ((uint64) (ismatch == should_match)) << bit_index;
+
+			INNER_LOOP
+		}
+		result[outer] &= word;
+	}
+
+	if (n % 64)
+	{
+		uint64 word = 0;
+		for (size_t row = (n / 64) * 64; row < n; row++)
+		{
+			const size_t bit_index = row % 64;
+			INNER_LOOP
+		}
+		result[n / 64] &= word;
+	}
+
+#undef INNER_LOOP
+}
+
+/*
+ * Match '%literal%' in one pass over the data buffer of all rows. We first
+ * find the candidate positions where both the first and the last bytes of
+ * the literal match in a branchless loop over 64 positions, which the
+ * compiler can vectorize. Only the candidates are then mapped to rows with
+ * the offsets, and checked fully. After a match, the rest of the row is
+ * skipped.
+ */
+static void
+vector_const_like_contains(const ArrowArray *arrow, const char *literal, size_t literallen,
+						   bool should_match, uint64 *restrict result)
+{
+	const uint32 *offsets = (uint32 *) arrow->buffers[1];
+	const uint8 *restrict values = arrow->buffers[2];
+	const size_t n = arrow->length;
+	const size_t n_words = (n + 63) / 64;
+	uint64 *restrict matches = palloc0(sizeof(uint64) * n_words);
+
+	if (literallen == 0)
+	{
+		/* Everything contains the empty string */
+		memset(matches, 0xFF, sizeof(uint64) * n_words);
+	}
+	else
+	{
+		const uint8 first = literal[0];
+		const uint8 last = literal[literallen - 1];
+		const uint32 data_end = offsets[n];
+		uint32 pos = offsets[0];
+		uint32 skip_until = 0;
+		size_t row = 0;
+
+		while (pos + literallen <= data_end)
+		{
+			const uint32 block = Min(64, data_end - literallen + 1 - pos);
+			uint64 candidates = 0;
+
+			for (uint32 i = 0; i < block; i++)
+			{
+				const bool candidate =
+					(values[pos + i] == first) & (values[pos + i + literallen - 1] == last);
+				candidates |= ((uint64) candidate) << i;
+			}
+
+			while (candidates != 0)
+			{
+				const uint32 candidate_pos = pos + pg_rightmost_one_pos64(candidates);
+
+				candidates &= candidates - 1;
+
+				if (candidate_pos < skip_until)
+					continue;
+
+				while (offsets[row + 1] <= candidate_pos)
+					row++;
+
+				/* The candidate spans the end of the row */
+				if (candidate_pos + literallen > offsets[row + 1])
+					continue;
+
+				if (literallen > 2 &&
+					memcmp(&values[candidate_pos + 1], &literal[1], literallen - 2) != 0)
+					continue;
+
+				matches[row / 64] |= UINT64CONST(1) << (row % 64);
+				skip_until = offsets[row + 1];
+			}
+
+			pos = Max(pos + block, skip_until);
+		}
+	}
+
+	for (size_t i = 0; i < n_words; i++)
+		result[i] &= should_match ? matches[i] : ~matches[i];
+
+	/* The bits past the last row were not set for the non-matching rows */
+	if (!should_match && n % 64)
+		result[n / 64] &= ~0ULL >> (64 - n % 64);
+
+	pfree(matches);
+}
+
+static void
+vector_const_like_dispatch(const ArrowArray *arrow, const Datum constdatum,
+						   uint64 *restrict result, bool should_match)
+{
+	text *consttext = (text *) DatumGetPointer(constdatum);
+	const char *literal = NULL;
+	size_t literallen = 0;
+
+	Assert(!arrow->dictionary);
+
+	switch (like_literal_pattern(VARDATA_ANY(consttext),
+								 VARSIZE_ANY_EXHDR(consttext),
+								 &literal,
+								 &literallen))
+	{
+		case LIKE_LITERAL_PREFIX:
+			vector_const_like_prefix_suffix(arrow,
+											literal,
+											literallen,
+											/* suffix = */ false,
+											should_match,
+											result);
+			break;
+		case LIKE_LITERAL_SUFFIX:
+			vector_const_like_prefix_suffix(arrow,
+											literal,
+											literallen,
+											/* suffix = */ true,
+											should_match,
+											result);
+			break;
+		case LIKE_LITERAL_CONTAINS:
+			vector_const_like_contains(arrow, literal, literallen, should_match, result);
+			break;
+		case LIKE_LITERAL_NONE:
+			vector_const_like_impl(arrow, constdatum, result, UTF8_MatchText, should_match);
+			break;
+	}
+}
+
 void
 vector_const_textlike_utf8(const ArrowArray *arrow, const Datum constdatum, uint64 *restrict result)
 {
-	vector_const_like_impl(arrow, constdatum, result, UTF8_MatchText, /* should_match = */ true);
+	vector_const_like_dispatch(arrow, constdatum, result, /* should_match = */ true);
 }
 
 void
 vector_const_textnlike_utf8(const ArrowArray *arrow, const Datum constdatum,
 							uint64 *restrict result)
 {
-	vector_const_like_impl(arrow, constdatum, result, UTF8_MatchText, /* should_match = */ false);
+	vector_const_like_dispatch(arrow, constdatum, result, /* should_match = */ false);
 }
@@ -0,0 +1,69 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+#include "pred_uuid.h"
+
+#include <utils/uuid.h>
+
+/*
+ * The UUIDs are stored as a fixed-width Arrow array of 16-byte values. They
+ * are compared as two 8-byte words, which is enough for the equality.
+ */
+static pg_attribute_always_inline void
+vector_const_uuid_comparison(const ArrowArray *arrow, const Datum constdatum, bool needequal,
+							 uint64 *restrict result)
+{
+	Assert(!arrow->dictionary);
+
+	const pg_uuid_t *constuuid = DatumGetUUIDP(constdatum);
+	uint64 const_words[2];
+	memcpy(const_words, constuuid->data, UUID_LEN);
+
+	const uint64 *values = (const uint64 *) arrow->buffers[1];
+
+	const size_t n = arrow->length;
+	for (size_t outer = 0; outer < n / 64; outer++)
+	{
+		uint64 word = 0;
+		for (size_t inner = 0; inner < 64; inner++)
+		{
+			const size_t row = (outer * 64) + inner;
+			const size_t bit_index = inner;
+#define INNER_LOOP                                                                                 \
+	const bool isequal =                                                                           \
+		((values[2 * row] ^ const_words[0]) | (values[2 * row + 1] ^ const_words[1])) == 0;       \
+	word |= ((uint64) (isequal == needequal)) << bit_index;
+
+			INNER_LOOP
+		}
+		result[outer] &= word;
+	}
+
+	if (n % 64)
+	{
+		uint64 word = 0;
+		for (size_t row = (n / 64) * 64; row < n; row++)
+		{
+			const size_t bit_index = row % 64;
+			INNER_LOOP
+		}
+		result[n / 64] &= word;
+	}
+
+#undef INNER_LOOP
+}
+
+void
+vector_const_uuideq(const ArrowArray *arrow, const Datum constdatum, uint64 *restrict result)
+{
+	vector_const_uuid_comparison(arrow, constdatum, /* needequal = */ true, result);
+}
+
+void
+vector_const_uuidne(const ArrowArray *arrow, const Datum constdatum, uint64 *restrict result)
+{
+	vector_const_uuid_comparison(arrow, constdatum, /* needequal = */ false, result);
+}
@@ -5,19 +5,211 @@
  */
 
 #include <postgres.h>
+#include <utils/fmgroids.h>
+#include <utils/memutils.h>
 
 #include "compression/arrow_c_data_interface.h"
 #include "compression/compression.h"
 #include "src/utils.h"
 #include "vector_predicates.h"
 
+/*
+ * The minimal number of array elements for which "= ANY" is computed with a
+ * binary search in the sorted array instead of one pass over the vector per
+ * element.
+ */
+#define SORTED_ARRAY_MIN_ELEMENTS 32
+
+/*
+ * The sorted non-null elements of the recently used arrays. The array is
+ * the same for every batch of a query, so we keep a copy of it to find the
+ * entry, and sort it only once. Comparing the copy costs much less than
+ * sorting.
+ */
+typedef struct SortedArrayCacheEntry
+{
+	ArrayType *array;
+	int64 *values;
+	int num_values;
+} SortedArrayCacheEntry;
+
+#define SORTED_ARRAY_CACHE_SIZE 4
+
+static MemoryContext sorted_array_cache_mcxt = NULL;
+static SortedArrayCacheEntry sorted_array_cache[SORTED_ARRAY_CACHE_SIZE];
+static int sorted_array_cache_next = 0;
+
+static int
+int64_cmp(const void *a, const void *b)
+{
+	const int64 x = *(const int64 *) a;
+	const int64 y = *(const int64 *) b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Check if the equality function compares the integer representation of
+ * the values of the same fixed-width type.
+ */
+static bool
+sorted_array_supported(RegProcedure opcode)
+{
+	switch (opcode)
+	{
+		case F_INT2EQ:
+		case F_INT4EQ:
+		case F_INT8EQ:
+		case F_DATE_EQ:
+		case F_TIMESTAMP_EQ:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static const SortedArrayCacheEntry *
+sorted_array_get(ArrayType *arr, int16 typlen)
+{
+	const Size arr_size = VARSIZE(arr);
+
+	for (int i = 0; i < SORTED_ARRAY_CACHE_SIZE; i++)
+	{
+		const SortedArrayCacheEntry *entry = &sorted_array_cache[i];
+
+		if (entry->array != NULL && VARSIZE(entry->array) == arr_size &&
+			memcmp(entry->array, arr, arr_size) == 0)
+			return entry;
+	}
+
+	if (sorted_array_cache_mcxt == NULL)
+		sorted_array_cache_mcxt = AllocSetContextCreate(TopMemoryContext,
+														"Vectorized array predicate cache",
+														ALLOCSET_SMALL_SIZES);
+
+	SortedArrayCacheEntry *entry = &sorted_array_cache[sorted_array_cache_next];
+	sorted_array_cache_next = (sorted_array_cache_next + 1) % SORTED_ARRAY_CACHE_SIZE;
+
+	if (entry->array != NULL)
+	{
+		pfree(entry->array);
+		pfree(entry->values);
+		entry->array = NULL;
+	}
+
+	const size_t nitems = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
+	const uint64 *array_null_bitmap = (uint64 *) ARR_NULLBITMAP(arr);
+	const char *array_data = (const char *) ARR_DATA_PTR(arr);
+	int64 *values = MemoryContextAlloc(sorted_array_cache_mcxt, sizeof(int64) * nitems);
+	int num_values = 0;
+
+	/* The null elements can be skipped for ANY, see vector_array_predicate() */
+	for (size_t array_index = 0; array_index < nitems; array_index++)
+	{
+		if (array_null_bitmap != NULL && !arrow_row_is_valid(array_null_bitmap, array_index))
+			continue;
+
+		const Datum value = ts_fetch_att(array_data, /* typbyval = */ true, typlen);
+		array_data += typlen;
+
+		switch (typlen)
+		{
+			case 2:
+				values[num_values++] = DatumGetInt16(value);
+				break;
+			case 4:
+				values[num_values++] = DatumGetInt32(value);
+				break;
+			default:
+				Assert(typlen == 8);
+				values[num_values++] = DatumGetInt64(value);
+				break;
+		}
+	}
+
+	qsort(values, num_values, sizeof(int64), int64_cmp);
+
+	entry->array = MemoryContextAlloc(sorted_array_cache_mcxt, arr_size);
+	memcpy(entry->array, arr, arr_size);
+	entry->values = values;
+	entry->num_values = num_values;
+
+	return entry;
+}
+
+/*
+ * Compute "= ANY" for the integer types with a branch-free binary search of
+ * every row value in the sorted array elements, in one pass over the vector.
+ */
+#define SORTED_ARRAY_SEARCH(TYPE)                                                                  \
+	do                                                                                             \
+	{                                                                                              \
+		const TYPE *restrict vector_values = (const TYPE *) vector->buffers[1];                    \
+		for (size_t outer = 0; outer < result_words; outer++)                                      \
+		{                                                                                          \
+			const size_t end = Min(n_rows, (outer + 1) * 64);                                      \
+			uint64 word = 0;                                                                       \
+			for (size_t row = outer * 64; row < end; row++)                                        \
+			{                                                                                      \
+				const int64 value = vector_values[row];                                            \
+				size_t lo = 0;                                                                     \
+				size_t len = num_values;                                                           \
+				while (len > 1)                                                                    \
+				{                                                                                  \
+					const size_t half = len / 2;                                                   \
+					lo = (sorted[lo + half] <= value) ? lo + half : lo;                            \
+					len -= half;                                                                   \
+				}                                                                                  \
+				word |= ((uint64) (sorted[lo] == value)) << (row % 64);                            \
+			}                                                                                      \
+			final_result[outer] &= word;                                                           \
+		}                                                                                          \
+	} while (0)
+
+static void
+vector_sorted_array_predicate(const ArrowArray *vector, const SortedArrayCacheEntry *entry,
+							  int16 typlen, uint64 *restrict final_result)
+{
+	const size_t n_rows = vector->length;
+	const size_t result_words = (n_rows + 63) / 64;
+	const int64 *restrict sorted = entry->values;
+	const size_t num_values = entry->num_values;
+
+	if (num_values == 0)
+	{
+		/* Only null elements, no rows pass */
+		for (size_t i = 0; i < result_words; i++)
+			final_result[i] = 0;
+		return;
+	}
+
+	switch (typlen)
+	{
+		case 2:
+			SORTED_ARRAY_SEARCH(int16);
+			break;
+		case 4:
+			SORTED_ARRAY_SEARCH(int32);
+			break;
+		default:
+			Assert(typlen == 8);
+			SORTED_ARRAY_SEARCH(int64);
+			break;
+	}
+}
+
+#undef SORTED_ARRAY_SEARCH
+
 /*
  * Vectorized implementation of ScalarArrayOpExpr. Applies scalar_predicate for
  * vector and each element of array, combines the result according to "is_or"
  * flag. Written along the lines of ExecEvalScalarArrayOp().
+ *
+ * Large "= ANY" arrays of integer types are instead searched for every row,
+ * see vector_sorted_array_predicate().
  */
 void
-vector_array_predicate(VectorPredicate *vector_const_predicate, bool is_or,
+vector_array_predicate(VectorPredicate *vector_const_predicate, RegProcedure opcode, bool is_or,
 					   const ArrowArray *vector, Datum array, uint64 *restrict final_result)
 {
 	const size_t n_rows = vector->length;
@@ -50,6 +242,13 @@ vector_array_predicate(VectorPredicate *vector_const_predicate, bool is_or,
 	const size_t nitems = ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
 	const uint64 *array_null_bitmap = (uint64 *) ARR_NULLBITMAP(arr);
 
+	if (is_or && nitems >= SORTED_ARRAY_MIN_ELEMENTS && sorted_array_supported(opcode) &&
+		typbyval && (typlen == 2 || typlen == 4 || typlen == 8))
+	{
+		vector_sorted_array_predicate(vector, sorted_array_get(arr, typlen), typlen, final_result);
+		return;
+	}
+
 	for (size_t array_index = 0; array_index < nitems; array_index++)
 	{
 		if (array_null_bitmap != NULL && !arrow_row_is_valid(array_null_bitmap, array_index))
@@ -113,9 +312,10 @@ vector_array_predicate(VectorPredicate *vector_const_predicate, bool is_or,
 		}
 
 		/*
-		 * The bitmaps are small, no more than 15 qwords for our maximal
-		 * compressed batch size of 1000 rows, so we can check for early exit
-		 * after every row.
+		 * The bitmaps are small, no more than 512 qwords for our maximal
+		 * compressed batch size of INT16_MAX rows, which is 1/64 of the work
+		 * of the predicate itself, so we can check for early exit after
+		 * every array element.
 		 */
 		VectorQualSummary summary = get_vector_qual_summary(array_result, n_rows);
 		if (summary == (is_or ? AllRowsPass : NoRowsPass))
@@ -4,6 +4,7 @@
  */
 
 #include <postgres.h>
+#include <access/hash.h>
 #include <nodes/makefuncs.h>
 #include <nodes/nodeFuncs.h>
 #include <optimizer/optimizer.h>
@@ -16,6 +17,7 @@
 #include "compression/create.h"
 #include "custom_type_cache.h"
 #include "decompress_chunk.h"
+#include "extension_constants.h"
 #include "qual_pushdown.h"
 #include "ts_catalog/array_utils.h"
 
@@ -309,6 +311,105 @@ pushdown_op_to_segment_meta_min_max(QualPushdownContext *context, List *expr_arg
 	}
 }
 
+static AttrNumber
+expr_fetch_bloom1_metadata(QualPushdownContext *context, Expr *expr)
+{
+	if (!IsA(expr, Var))
+		return InvalidAttrNumber;
+
+	Var *var = castNode(Var, expr);
+
+	if ((Index) var->varno != context->chunk_rel->relid || var->varattno <= 0)
+		return InvalidAttrNumber;
+
+	return compressed_column_metadata_attno(context->settings,
+											context->chunk_rte->relid,
+											var->varattno,
+											context->compressed_rte->relid,
+											"bloom1");
+}
+
+/*
+ * Push down the equality conditions to the bloom filter sparse index, as
+ * _timescaledb_functions.bloom1_contains(bloom, expr).
+ */
+static Expr *
+pushdown_op_to_segment_meta_bloom1(QualPushdownContext *context, List *expr_args, Oid op_oid,
+								   Oid op_collation)
+{
+	Expr *leftop, *rightop;
+
+	if (list_length(expr_args) != 2)
+		return NULL;
+
+	leftop = linitial(expr_args);
+	rightop = lsecond(expr_args);
+
+	if (IsA(leftop, RelabelType))
+		leftop = ((RelabelType *) leftop)->arg;
+	if (IsA(rightop, RelabelType))
+		rightop = ((RelabelType *) rightop)->arg;
+
+	AttrNumber bloom_attno = expr_fetch_bloom1_metadata(context, leftop);
+	if (bloom_attno == InvalidAttrNumber)
+	{
+		/* The equality is symmetric, so we don't need the commutator. */
+		Expr *tmp = leftop;
+		leftop = rightop;
+		rightop = tmp;
+
+		bloom_attno = expr_fetch_bloom1_metadata(context, leftop);
+	}
+
+	if (bloom_attno == InvalidAttrNumber)
+		return NULL;
+
+	Var *var_with_bloom = castNode(Var, leftop);
+
+	if (!OidIsValid(op_oid) || !op_strict(op_oid))
+		return NULL;
+
+	/* The hash functions must follow the same equality semantics as the operator. */
+	if (var_with_bloom->varcollid != op_collation)
+		return NULL;
+
+	TypeCacheEntry *tce = lookup_type_cache(var_with_bloom->vartype, TYPECACHE_HASH_OPFAMILY);
+	if (!OidIsValid(tce->hash_opf) ||
+		get_op_opfamily_strategy(op_oid, tce->hash_opf) != HTEqualStrategyNumber)
+		return NULL;
+
+	Expr *expr = get_pushdownsafe_expr(context, rightop);
+	if (expr == NULL)
+		return NULL;
+
+	/*
+	 * The value is hashed with the hash function of its own type, which has
+	 * to be compatible with the one of the column. This is guaranteed inside
+	 * the same hash operator family.
+	 */
+	Oid expr_type_id = exprType((Node *) expr);
+	if (expr_type_id != var_with_bloom->vartype &&
+		lookup_type_cache(expr_type_id, TYPECACHE_HASH_OPFAMILY)->hash_opf != tce->hash_opf)
+		return NULL;
+
+	Oid argtypes[] = { BYTEAOID, ANYELEMENTOID };
+	Oid func_oid = LookupFuncName(list_make2(makeString(FUNCTIONS_SCHEMA_NAME),
+											 makeString("bloom1_contains")),
+								  lengthof(argtypes),
+								  argtypes,
+								  false);
+
+	Var *bloom_var =
+		makeVar(context->compressed_rel->relid, bloom_attno, BYTEAOID, -1, InvalidOid, 0);
+
+	return (Expr *) makeFuncExpr(func_oid,
+								 BOOLOID,
+								 list_make2(bloom_var, copyObject(expr)),
+								 /* funccollid = */ InvalidOid,
+								 var_with_bloom->varcollid,
+								 COERCE_EXPLICIT_CALL);
+}
+
 static Node *
 modify_expression(Node *node, QualPushdownContext *context)
 {
@@ -326,6 +427,11 @@ modify_expression(Node *node, QualPushdownContext *context)
 															   opexpr->args,
 															   opexpr->opno,
 															   opexpr->inputcollid);
+				if (pd == NULL)
+					pd = pushdown_op_to_segment_meta_bloom1(context,
+															opexpr->args,
+															opexpr->opno,
+															opexpr->inputcollid);
 				if (pd != NULL)
 				{
 					context->needs_recheck = true;
@@ -29,6 +29,7 @@
 #include "pred_vector_const_arithmetic_all.c"
 
 #include "pred_text.h"
+#include "pred_uuid.h"
 
 /*
  * Look up the vectorized implementation for a Postgres predicate, specified by
@@ -49,6 +50,12 @@ get_vector_const_predicate(Oid pg_predicate)
 		case F_TEXTNE:
 			return vector_const_textne;
 
+		case F_UUID_EQ:
+			return vector_const_uuideq;
+
+		case F_UUID_NE:
+			return vector_const_uuidne;
+
 		default:
 			/*
 			 * More checks below, this branch is to placate the static analyzers.
@@ -76,6 +83,132 @@ get_vector_const_predicate(Oid pg_predicate)
 	return NULL;
 }
 
+/*
+ * Check whether the predicate is an ordering comparison of integer-like types,
+ * so that its result for a monotonic vector is a contiguous range of rows.
+ */
+bool
+vector_const_predicate_is_ordering(Oid pg_predicate)
+{
+#define ORDERING_PREDICATES(X)                                                                     \
+	case X##LT:                                                                                    \
+	case X##LE:                                                                                    \
+	case X##GT:                                                                                    \
+	case X##GE
+
+	switch (pg_predicate)
+	{
+		ORDERING_PREDICATES(F_INT8):
+		ORDERING_PREDICATES(F_TIMESTAMPTZ_):
+		ORDERING_PREDICATES(F_TIMESTAMP_):
+		ORDERING_PREDICATES(F_INT84):
+		ORDERING_PREDICATES(F_INT82):
+		ORDERING_PREDICATES(F_INT48):
+		ORDERING_PREDICATES(F_INT4):
+		ORDERING_PREDICATES(F_INT42):
+		ORDERING_PREDICATES(F_INT28):
+		ORDERING_PREDICATES(F_INT24):
+		ORDERING_PREDICATES(F_INT2):
+		ORDERING_PREDICATES(F_DATE_):
+			return true;
+		default:
+			return false;
+	}
+#undef ORDERING_PREDICATES
+}
+
+/*
+ * Compute the vector-const predicate for a single row of a fixed-width vector.
+ */
+static bool
+vector_const_predicate_row(VectorPredicate *vector_const_predicate, const ArrowArray *vector,
+						   int value_bytes, int64 row, Datum constdatum)
+{
+	const void *buffers[2] = { NULL, ((const char *) vector->buffers[1]) + row * value_bytes };
+	const ArrowArray single_row = {
+		.length = 1,
+		.null_count = 0,
+		.n_buffers = 2,
+		.buffers = buffers,
+	};
+	uint64 result = 1;
+	vector_const_predicate(&single_row, constdatum, &result);
+	return result & 1;
+}
+
+/*
+ * Compute an ordering predicate for a vector of monotonic values without nulls,
+ * e.g. the timestamps that go with a fixed step. The rows that pass form a
+ * contiguous range, so it is enough to find its bound with a binary search.
+ */
+void
+vector_monotonic_predicate(VectorPredicate *vector_const_predicate, const ArrowArray *vector,
+						   int value_bytes, Datum constdatum, uint64 *restrict result)
+{
+	Assert(vector->null_count == 0);
+	Assert(vector->dictionary == NULL);
+
+	const int64 n = vector->length;
+	if (n == 0)
+	{
+		return;
+	}
+
+	const bool first_passes =
+		vector_const_predicate_row(vector_const_predicate, vector, value_bytes, 0, constdatum);
+	const bool last_passes =
+		vector_const_predicate_row(vector_const_predicate, vector, value_bytes, n - 1, constdatum);
+
+	if (first_passes && last_passes)
+	{
+		/* All rows pass. */
+		return;
+	}
+
+	/* The range of rows that pass is [begin, end). */
+	int64 begin = 0;
+	int64 end = 0;
+	if (first_passes != last_passes)
+	{
+		/*
+		 * Find the first row that has a different result than the first row.
+		 * The predicate result for "low" is the same as for the first row,
+		 * and for "high" it is different.
+		 */
+		int64 low = 0;
+		int64 high = n - 1;
+		while (high - low > 1)
+		{
+			const int64 mid = low + (high - low) / 2;
+			if (vector_const_predicate_row(vector_const_predicate,
+										   vector,
+										   value_bytes,
+										   mid,
+										   constdatum) == first_passes)
+			{
+				low = mid;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+
+		begin = first_passes ? 0 : high;
+		end = first_passes ? high : n;
+	}
+
+	const size_t n_words = (n + 63) / 64;
+	for (size_t i = 0; i < n_words; i++)
+	{
+		const int64 word_begin = Min(Max(begin - (int64) i * 64, 0), 64);
+		const int64 word_end = Min(Max(end - (int64) i * 64, 0), 64);
+		const uint64 below_end = word_end == 64 ? ~0ULL : (1ULL << word_end) - 1;
+		const uint64 below_begin = word_begin == 64 ? ~0ULL : (1ULL << word_begin) - 1;
+		result[i] &= below_end & ~below_begin;
+	}
+}
+
 void
 vector_nulltest(const ArrowArray *arrow, int test_type, uint64 *restrict result)
 {
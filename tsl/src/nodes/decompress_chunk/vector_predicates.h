@@ -13,8 +13,14 @@ typedef void(VectorPredicate)(const ArrowArray *, Datum, uint64 *restrict);
 
 VectorPredicate *get_vector_const_predicate(Oid pg_predicate);
 
-void vector_array_predicate(VectorPredicate *vector_const_predicate, bool is_or,
-							const ArrowArray *vector, Datum array, uint64 *restrict final_result);
+bool vector_const_predicate_is_ordering(Oid pg_predicate);
+
+void vector_monotonic_predicate(VectorPredicate *vector_const_predicate, const ArrowArray *vector,
+								int value_bytes, Datum constdatum, uint64 *restrict result);
+
+void vector_array_predicate(VectorPredicate *vector_const_predicate, RegProcedure opcode,
+							bool is_or, const ArrowArray *vector, Datum array,
+							uint64 *restrict final_result);
 
 void vector_nulltest(const ArrowArray *arrow, int test_type, uint64 *restrict result);
 
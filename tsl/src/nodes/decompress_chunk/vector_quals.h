@@ -35,6 +35,13 @@ typedef struct VectorQualInfo
 	bool *vector_attrs;
 	bool *segmentby_attrs;
 
+	/*
+	 * Optional array indexed by uncompressed attno indicating whether the
+	 * "->>" fields of a jsonb attribute can be used in the vectorized quals.
+	 * Can be NULL if there are no such attributes.
+	 */
+	bool *jsonb_field_attrs;
+
 	/* Max attribute number found in arrays above */
 	AttrNumber maxattno;
 } VectorQualInfo;
@@ -62,6 +69,15 @@ typedef struct VectorQualState
 	 */
 	const ArrowArray *(*get_arrow_array)(struct VectorQualState *vqstate, Expr *expr,
 										 bool *is_default_value);
+
+	/*
+	 * Optional interface function, can be NULL.
+	 *
+	 * Tells whether the values of the arrow array returned by get_arrow_array()
+	 * for this column are known to be monotonic, so that the ordering
+	 * predicates can be computed with a binary search.
+	 */
+	bool (*is_monotonic)(struct VectorQualState *vqstate, Expr *expr);
 } VectorQualState;
 
 extern Node *vector_qual_make(Node *qual, const VectorQualInfo *vqinfo);
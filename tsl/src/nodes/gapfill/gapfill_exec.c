@@ -11,6 +11,7 @@
 #include <catalog/pg_cast.h>
 #include <catalog/pg_collation.h>
 #include <catalog/pg_type.h>
+#include <common/int.h>
 #include <miscadmin.h>
 #include <nodes/extensible.h>
 #include <nodes/makefuncs.h>
@@ -49,6 +50,9 @@ typedef union GapFillColumnStateUnion
 	GapFillLocfColumnState *locf;
 } GapFillColumnStateUnion;
 
+/* maximum number of gap tuples generated in one run */
+#define GAPFILL_RUN_SIZE 1000
+
 #define foreach_column(column, index, state)                                                       \
 	Assert((state)->ncolumns > 0);                                                                 \
 	for ((index) = 0, (column) = (state)->columns[index];                                          \
@@ -61,7 +65,8 @@ static void gapfill_rescan(CustomScanState *node);
 static TupleTableSlot *gapfill_exec(CustomScanState *node);
 
 static void gapfill_state_reset_group(GapFillState *state, TupleTableSlot *slot);
-static TupleTableSlot *gapfill_state_gaptuple_create(GapFillState *state, int64 time);
+static void gapfill_state_gaptuple_run_create(GapFillState *state);
+static TupleTableSlot *gapfill_state_gaptuple_next(GapFillState *state);
 static bool gapfill_state_is_new_group(GapFillState *state, TupleTableSlot *slot);
 static void gapfill_state_set_next(GapFillState *state, TupleTableSlot *subslot);
 static TupleTableSlot *gapfill_state_return_subplan_slot(GapFillState *state);
@@ -506,6 +511,15 @@ collect_boundary_expressions(Node *node, Var *ts_var)
 	return context.quals;
 }
 
+/*
+ * Derive a missing start or finish from the WHERE clause.
+ *
+ * Note that this only works in one direction: explicit start and finish
+ * arguments cannot be turned into restrictions on the time column, because
+ * they only bound the generated buckets. Subplan tuples before start and
+ * after finish are still returned by the node, so filtering them out at the
+ * scan would change the result.
+ */
 static int64
 infer_gapfill_boundary(GapFillState *state, GapFillBoundary boundary)
 {
@@ -636,6 +650,19 @@ gapfill_advance_timestamp(GapFillState *state)
 {
 	Datum next;
 
+	/* buckets of fixed width do not need any interval arithmetic */
+	if (state->gapfill_step > 0)
+	{
+		if (pg_add_s64_overflow(state->next_timestamp,
+								state->gapfill_step,
+								&state->next_timestamp) ||
+			!IS_VALID_TIMESTAMP(state->next_timestamp))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+					 errmsg("timestamp out of range")));
+		return;
+	}
+
 	switch (state->gapfill_typid)
 	{
 		case DATEOID:
@@ -776,6 +803,26 @@ gapfill_begin(CustomScanState *node, EState *estate, int eflags)
 	state->next_timestamp = state->gapfill_start;
 	state->next_offset = state->gapfill_interval;
 
+	/*
+	 * Intervals without months are a fixed number of microseconds wide for
+	 * timestamps, and for timestamptz unless days have to be added in a
+	 * specific timezone. Those buckets are found by plain addition.
+	 */
+	state->gapfill_step = 0;
+	if (state->gapfill_interval && state->gapfill_interval->month == 0 &&
+		!TIMESTAMP_NOT_FINITE(state->gapfill_start) &&
+		(state->gapfill_typid == TIMESTAMPOID ||
+		 (state->gapfill_typid == TIMESTAMPTZOID &&
+		  (!state->have_timezone || state->gapfill_interval->day == 0))))
+	{
+		int64 step;
+
+		if (pg_mul_s64_overflow(state->gapfill_interval->day, USECS_PER_DAY, &step) ||
+			pg_add_s64_overflow(step, state->gapfill_interval->time, &step))
+			step = 0;
+		state->gapfill_step = step;
+	}
+
 	/* gap fill end */
 	if (is_const_null(get_finish_arg(state)))
 		state->gapfill_end = infer_gapfill_boundary(state, GAPFILL_END);
@@ -828,6 +875,31 @@ gapfill_begin(CustomScanState *node, EState *estate, int eflags)
 										&state->csstate.ss.ps,
 										NULL);
 
+	/*
+	 * When every column of the projection is either a plain reference to the
+	 * same column of the gap tuple or a NULL constant, the projected tuple
+	 * equals the gap tuple and the projection can be skipped.
+	 */
+	state->gaptuple_projection = false;
+	for (i = 0; i < state->ncolumns; i++)
+	{
+		Expr *expr = castNode(TargetEntry, list_nth(targetlist, i))->expr;
+
+		if (state->columns[i]->ctype == NULL_COLUMN && is_const_null(expr))
+			continue;
+
+		if (IsA(expr, Var) && castNode(Var, expr)->varno == INDEX_VAR &&
+			castNode(Var, expr)->varattno == AttrOffsetGetAttrNumber(i))
+			continue;
+
+		state->gaptuple_projection = true;
+		break;
+	}
+
+	state->run_times = palloc(sizeof(int64) * GAPFILL_RUN_SIZE);
+	state->run_length = 0;
+	state->run_next = 0;
+
 	state->csstate.custom_ps = list_make1(ExecInitNode(state->subplan, estate, eflags));
 }
 
@@ -892,9 +964,7 @@ gapfill_exec(CustomScanState *node)
 		if (state->next_timestamp < state->gapfill_end)
 		{
 			Assert(state->state != FETCHED_NONE);
-			slot = gapfill_state_gaptuple_create(state, state->next_timestamp);
-			gapfill_advance_timestamp(state);
-			return slot;
+			return gapfill_state_gaptuple_next(state);
 		}
 
 		/* return any remaining subplan tuples after gapfill_end */
@@ -936,6 +1006,8 @@ gapfill_rescan(CustomScanState *node)
 		ExecReScan(linitial(node->custom_ps));
 	}
 	((GapFillState *) node)->state = FETCHED_NONE;
+	((GapFillState *) node)->run_length = 0;
+	((GapFillState *) node)->run_next = 0;
 }
 
 static void
@@ -975,15 +1047,34 @@ gapfill_state_reset_group(GapFillState *state, TupleTableSlot *slot)
 }
 
 /*
- * Create generated tuple according to column state
+ * Start a run of gap tuples at next_timestamp
+ *
+ * The run covers all missing buckets up to the next tuple of the subplan or
+ * gapfill_end, limited to GAPFILL_RUN_SIZE tuples. Apart from the time and
+ * interpolate columns every column has the same value for all tuples of a
+ * run, so those are filled into the scan slot here and left untouched while
+ * the run is returned.
  */
-static TupleTableSlot *
-gapfill_state_gaptuple_create(GapFillState *state, int64 time)
+static void
+gapfill_state_gaptuple_run_create(GapFillState *state)
 {
 	TupleTableSlot *slot = state->scanslot;
 	GapFillColumnStateUnion column;
+	int64 start = state->next_timestamp;
 	int i;
 
+	state->run_length = 0;
+	state->run_next = 0;
+	do
+	{
+		state->run_times[state->run_length++] = state->next_timestamp;
+		gapfill_advance_timestamp(state);
+	} while (state->run_length < GAPFILL_RUN_SIZE && state->next_timestamp < state->gapfill_end &&
+			 !(FETCHED_ONE == state->state && state->subslot_time == state->next_timestamp));
+
+	state->run_end = state->next_timestamp;
+	state->next_timestamp = start;
+
 	ExecClearTuple(slot);
 
 	/*
@@ -995,7 +1086,7 @@ gapfill_state_gaptuple_create(GapFillState *state, int64 time)
 		switch (column.base->ctype)
 		{
 			case TIME_COLUMN:
-				slot->tts_values[i] = gapfill_internal_get_datum(time, state->gapfill_typid);
+				slot->tts_values[i] = gapfill_internal_get_datum(start, state->gapfill_typid);
 				slot->tts_isnull[i] = false;
 				break;
 			case GROUP_COLUMN:
@@ -1017,29 +1108,61 @@ gapfill_state_gaptuple_create(GapFillState *state, int64 time)
 	 */
 	ExecStoreVirtualTuple(slot);
 
+	/*
+	 * locf only changes when a subplan tuple is returned and only does its
+	 * lookup for the first tuple of a run, so one value serves the whole run
+	 */
 	foreach_column(column.base, i, state)
 	{
-		switch (column.base->ctype)
-		{
-			case LOCF_COLUMN:
-				gapfill_locf_calculate(column.locf,
-									   state,
-									   time,
-									   &slot->tts_values[i],
-									   &slot->tts_isnull[i]);
-				break;
-			case INTERPOLATE_COLUMN:
-				gapfill_interpolate_calculate(column.interpolate,
-											  state,
-											  time,
-											  &slot->tts_values[i],
-											  &slot->tts_isnull[i]);
-				break;
-			default:
-				break;
-		}
+		if (LOCF_COLUMN == column.base->ctype)
+			gapfill_locf_calculate(column.locf,
+								   state,
+								   start,
+								   &slot->tts_values[i],
+								   &slot->tts_isnull[i]);
+	}
+}
+
+/*
+ * Return the next gap tuple of the current run, starting a new run if
+ * necessary
+ */
+static TupleTableSlot *
+gapfill_state_gaptuple_next(GapFillState *state)
+{
+	TupleTableSlot *slot = state->scanslot;
+	GapFillColumnStateUnion column;
+	int64 time;
+	int i;
+
+	if (state->run_next >= state->run_length)
+		gapfill_state_gaptuple_run_create(state);
+
+	time = state->run_times[state->run_next++];
+	state->next_timestamp =
+		state->run_next < state->run_length ? state->run_times[state->run_next] : state->run_end;
+
+	/*
+	 * The slot still holds the previous tuple of the run, so only the columns
+	 * that differ between the tuples of a run need to be set.
+	 */
+	Assert(!TTS_EMPTY(slot));
+	slot->tts_values[state->time_index] = gapfill_internal_get_datum(time, state->gapfill_typid);
+	slot->tts_isnull[state->time_index] = false;
+
+	foreach_column(column.base, i, state)
+	{
+		if (INTERPOLATE_COLUMN == column.base->ctype)
+			gapfill_interpolate_calculate(column.interpolate,
+										  state,
+										  time,
+										  &slot->tts_values[i],
+										  &slot->tts_isnull[i]);
 	}
 
+	if (!state->gaptuple_projection)
+		return slot;
+
 	ResetExprContext(state->pi->pi_exprContext);
 	state->pi->pi_exprContext->ecxt_scantuple = slot;
 	return ExecProject(state->pi);
@@ -101,6 +101,8 @@ typedef struct GapFillState
 	int64 gapfill_period;
 	/* bucket width when bucketing by month */
 	Interval *gapfill_interval;
+	/* distance between buckets of an interval with fixed width, 0 otherwise */
+	int64 gapfill_step;
 
 	int64 next_timestamp;
 	/* interval offset for next_timestamp from gapfill_start */
@@ -119,6 +121,17 @@ typedef struct GapFillState
 	ProjectionInfo *pi;
 	TupleTableSlot *scanslot;
 	GapFillFetchState state;
+
+	/*
+	 * Gap tuples are generated in runs: the timestamps of the missing buckets
+	 * up to the next subplan tuple are computed in one pass and the columns
+	 * that are constant within a run are filled into scanslot only once.
+	 */
+	int64 *run_times;
+	int run_length;
+	int run_next;
+	int64 run_end;			  /* next_timestamp after the last tuple of the run */
+	bool gaptuple_projection; /* gap tuples need to be projected */
 } GapFillState;
 
 Node *gapfill_state_create(CustomScan *);
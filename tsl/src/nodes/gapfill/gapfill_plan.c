@@ -20,12 +20,23 @@
 
 #include "gapfill.h"
 #include "gapfill_internal.h"
+#include "utils.h"
 
 static CustomScanMethods gapfill_plan_methods = {
 	.CustomName = "GapFill",
 	.CreateCustomScanState = gapfill_state_create,
 };
 
+/*
+ * Register the plan methods so GapFill nodes can be passed on to parallel
+ * workers.
+ */
+void
+_gapfill_init(void)
+{
+	TryRegisterCustomScanMethods(&gapfill_plan_methods);
+}
+
 typedef struct gapfill_walker_context
 {
 	union
@@ -335,11 +346,6 @@ gapfill_path_create(PlannerInfo *root, Path *subpath, FuncExpr *func)
 	path->cpath.path.pathtype = T_CustomScan;
 	path->cpath.methods = &gapfill_path_methods;
 
-	/*
-	 * parallel_safe must be false because it is not safe to execute this node
-	 * in parallel, but it is safe for child nodes to be parallel
-	 */
-	Assert(!path->cpath.path.parallel_safe);
 	path->cpath.path.rows = subpath->rows;
 	path->cpath.path.parent = subpath->parent;
 	path->cpath.path.param_info = subpath->param_info;
@@ -398,6 +404,20 @@ gapfill_path_create(PlannerInfo *root, Path *subpath, FuncExpr *func)
 			create_sort_path(root, subpath->parent, subpath, new_order, root->limit_tuples);
 	}
 
+	/*
+	 * The node is never parallel aware, because gap filling needs all tuples
+	 * of a group in one process and partial input does not guarantee that.
+	 * It can still run inside a worker when it consumes complete input there,
+	 * as long as everything it evaluates is parallel safe: the gapfill call
+	 * with its boundaries, the locf/interpolate lookups in the targetlist and
+	 * the WHERE clause used to infer missing boundaries.
+	 */
+	path->cpath.path.parallel_safe =
+		subpath->parallel_safe && is_parallel_safe(root, (Node *) func->args) &&
+		is_parallel_safe(root, (Node *) path->cpath.path.pathtarget->exprs) &&
+		is_parallel_safe(root, root->parse->jointree->quals);
+	path->cpath.path.parallel_workers = 0;
+
 	path->cpath.path.startup_cost = subpath->startup_cost;
 	path->cpath.path.total_cost = subpath->total_cost;
 	path->cpath.path.pathkeys = subpath->pathkeys;
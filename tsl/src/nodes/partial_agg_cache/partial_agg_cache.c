@@ -0,0 +1,980 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Cache of the per-chunk partial aggregates.
+ *
+ * The dashboards rerun the same aggregation queries over the same data, and
+ * most of the chunks there are compressed and don't change anymore. With the
+ * chunkwise aggregation, each of them has its own partial aggregation node,
+ * and we insert the PartialAggCache node above it. On the first execution,
+ * it passes the partial aggregates through and keeps a copy of them in a
+ * backend-local cache. The next execution of the same plan returns the cached
+ * tuples without running the aggregation.
+ *
+ * The cache key is the compressed relation and the fingerprint of the plan
+ * below, which is its text form without the costs, node ids and the parts
+ * that depend on the position in the query. So the fingerprint covers the
+ * aggregates, the grouping and all the quals.
+ *
+ * The partial aggregation must read only the compressed relation of the
+ * chunk, through the DecompressChunk node, and must not depend on the
+ * parameters or on the mutable functions. Then its result is determined by
+ * the compressed tuples that are visible to the query snapshot. Before using
+ * the cached result, we check that this set of tuple versions is the same as
+ * when the result was computed. A tuple version is identified by the file of
+ * the relation, its TID and its xmin, and for the tuples inserted by the
+ * current transaction also by its command id. We compare the number of the
+ * visible versions and a hash of them. Any change of the compressed data,
+ * including the recompression or the decompression of the chunk and also the
+ * changes that are not yet committed or not visible to the snapshot, changes
+ * this set. This check has to read the tuple headers of the compressed
+ * relation, which is much cheaper than detoasting and decompressing the
+ * batches. The non-compressed rows of a partially compressed chunk are read
+ * by a separate scan that is not cached.
+ *
+ * The cached tuples are copied for each execution, so that the evictions
+ * don't affect a running query. The size of the cache is limited by the
+ * partial_agg_cache_size setting, and the least recently used entries are
+ * evicted first.
+ */
+#include <postgres.h>
+
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/tableam.h>
+#include <access/xact.h>
+#include <catalog/pg_am.h>
+#include <commands/explain.h>
+#include <common/hashfn.h>
+#include <executor/executor.h>
+#include <lib/ilist.h>
+#include <lib/stringinfo.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/clauses.h>
+#include <optimizer/optimizer.h>
+#include <parser/parsetree.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+
+#include "compat/compat.h"
+#include "partial_agg_cache.h"
+
+#include "guc.h"
+#include "nodes/vector_agg.h"
+
+/*
+ * The set of the compressed tuple versions visible to a snapshot.
+ */
+typedef struct PartialAggDataFingerprint
+{
+	uint64 ntuples;
+	uint64 hash;
+} PartialAggDataFingerprint;
+
+typedef struct PartialAggCacheKey
+{
+	Oid compressed_relid;
+	uint32 plan_hash;
+} PartialAggCacheKey;
+
+typedef struct PartialAggCacheEntry
+{
+	PartialAggCacheKey key;
+	dlist_node node; /* List link in the LRU list. */
+
+	/* The memory context that holds the plan fingerprint and the tuples. */
+	MemoryContext mcxt;
+	Size bytes;
+
+	const char *plan_fingerprint;
+	PartialAggDataFingerprint data;
+	int ntuples;
+	MinimalTuple *tuples;
+} PartialAggCacheEntry;
+
+typedef struct PartialAggCache
+{
+	MemoryContext mcxt;
+	HTAB *htab;
+	dlist_head lru;
+	Size used_bytes;
+} PartialAggCache;
+
+static PartialAggCache *partial_agg_cache = NULL;
+
+typedef struct PartialAggCacheState
+{
+	CustomScanState csstate;
+	PartialAggCacheKey key;
+	const char *plan_fingerprint;
+
+	/* The data fingerprint doesn't change during the query. */
+	bool have_data;
+	PartialAggDataFingerprint data;
+
+	bool started;
+
+	/* Returning the cached tuples instead of the tuples of the child node. */
+	bool replay;
+
+	/*
+	 * The copy of the cached tuples when replaying, or the collected child
+	 * tuples. The collected tuples are allocated in collect_mcxt, which is
+	 * NULL if we don't collect them.
+	 */
+	MemoryContext replay_mcxt;
+	MemoryContext collect_mcxt;
+	TupleTableSlot *replay_slot;
+	int ntuples;
+	int tuples_capacity;
+	int next_tuple;
+	MinimalTuple *tuples;
+
+	int64 hits;
+	int64 misses;
+} PartialAggCacheState;
+
+static Node *partial_agg_cache_state_create(CustomScan *cscan);
+
+static CustomScanMethods partial_agg_cache_plan_methods = {
+	.CustomName = PARTIAL_AGG_CACHE_NODE_NAME,
+	.CreateCustomScanState = partial_agg_cache_state_create,
+};
+
+void
+_partial_agg_cache_init(void)
+{
+	TryRegisterCustomScanMethods(&partial_agg_cache_plan_methods);
+}
+
+static Size
+partial_agg_cache_max_bytes(void)
+{
+	return (Size) ts_guc_partial_agg_cache_size * 1024;
+}
+
+static void
+partial_agg_cache_remove(PartialAggCacheEntry *entry)
+{
+	dlist_delete(&entry->node);
+	MemoryContextDelete(entry->mcxt);
+	partial_agg_cache->used_bytes -= entry->bytes;
+
+	if (!hash_search(partial_agg_cache->htab, &entry->key, HASH_REMOVE, NULL))
+		elog(ERROR, "partial aggregate cache corrupt");
+}
+
+/*
+ * Find the cached result for the given plan and data. The stale result for
+ * the same plan is removed.
+ */
+static PartialAggCacheEntry *
+partial_agg_cache_lookup(PartialAggCacheState *state)
+{
+	if (partial_agg_cache == NULL)
+	{
+		return NULL;
+	}
+
+	PartialAggCacheEntry *entry =
+		hash_search(partial_agg_cache->htab, &state->key, HASH_FIND, NULL);
+	if (entry == NULL || strcmp(entry->plan_fingerprint, state->plan_fingerprint) != 0)
+	{
+		return NULL;
+	}
+
+	if (entry->data.ntuples != state->data.ntuples || entry->data.hash != state->data.hash)
+	{
+		partial_agg_cache_remove(entry);
+		return NULL;
+	}
+
+	dlist_move_tail(&partial_agg_cache->lru, &entry->node);
+	return entry;
+}
+
+/*
+ * Move the collected tuples into the cache, if they fit. This replaces the
+ * previous result for the same key.
+ */
+static void
+partial_agg_cache_insert(PartialAggCacheState *state)
+{
+	MemoryContext mcxt = state->collect_mcxt;
+	state->collect_mcxt = NULL;
+
+	const char *plan_fingerprint = MemoryContextStrdup(mcxt, state->plan_fingerprint);
+	const Size bytes = MemoryContextMemAllocated(mcxt, /* recurse = */ true);
+	const Size max_bytes = partial_agg_cache_max_bytes();
+	if (bytes > max_bytes)
+	{
+		MemoryContextDelete(mcxt);
+		return;
+	}
+
+	if (partial_agg_cache == NULL)
+	{
+		MemoryContext cache_mcxt = AllocSetContextCreate(TopMemoryContext,
+														 "Partial aggregate cache",
+														 ALLOCSET_DEFAULT_SIZES);
+		PartialAggCache *cache = MemoryContextAllocZero(cache_mcxt, sizeof(PartialAggCache));
+
+		HASHCTL ctl = {
+			.keysize = sizeof(PartialAggCacheKey),
+			.entrysize = sizeof(PartialAggCacheEntry),
+			.hcxt = cache_mcxt,
+		};
+
+		cache->mcxt = cache_mcxt;
+		cache->htab = hash_create("Partial aggregate cache",
+								  64,
+								  &ctl,
+								  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+		dlist_init(&cache->lru);
+		partial_agg_cache = cache;
+	}
+
+	PartialAggCacheEntry *entry =
+		hash_search(partial_agg_cache->htab, &state->key, HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		partial_agg_cache_remove(entry);
+	}
+
+	/* The setting might have been decreased, so we can evict several entries. */
+	while (partial_agg_cache->used_bytes + bytes > max_bytes &&
+		   !dlist_is_empty(&partial_agg_cache->lru))
+	{
+		partial_agg_cache_remove(
+			dlist_head_element(PartialAggCacheEntry, node, &partial_agg_cache->lru));
+	}
+
+	bool found;
+	entry = hash_search(partial_agg_cache->htab, &state->key, HASH_ENTER, &found);
+	Assert(!found);
+
+	MemoryContextSetParent(mcxt, partial_agg_cache->mcxt);
+	entry->mcxt = mcxt;
+	entry->bytes = bytes;
+	entry->plan_fingerprint = plan_fingerprint;
+	entry->data = state->data;
+	entry->ntuples = state->ntuples;
+	entry->tuples = state->tuples;
+	dlist_push_tail(&partial_agg_cache->lru, &entry->node);
+	partial_agg_cache->used_bytes += bytes;
+
+	state->tuples = NULL;
+	state->ntuples = 0;
+	state->tuples_capacity = 0;
+}
+
+/*
+ * Compute the fingerprint of the compressed tuple versions visible to the
+ * snapshot. The scan is not synchronized, so that the tuples are always
+ * visited in the physical order.
+ *
+ * The TIDs and xmins can repeat in a new file of the relation, e.g. after a
+ * TRUNCATE and new inserts in the same transaction, so the hash starts from
+ * the relation file. The current transaction can also replace its own tuples
+ * several times, so its tuples include their command ids.
+ */
+static bool
+compute_data_fingerprint(Oid relid, Snapshot snapshot, PartialAggDataFingerprint *data)
+{
+	Relation rel = table_open(relid, AccessShareLock);
+
+	if (rel->rd_rel->relam != HEAP_TABLE_AM_OID)
+	{
+		table_close(rel, AccessShareLock);
+		return false;
+	}
+
+	TableScanDesc scan = table_beginscan_strat(rel,
+											   snapshot,
+											   0,
+											   NULL,
+											   /* allow_strat = */ true,
+											   /* allow_sync = */ false);
+	TupleTableSlot *slot = table_slot_create(rel, NULL);
+
+#if PG16_LT
+	const RelFileNode *locator = &rel->rd_node;
+#else
+	const RelFileLocator *locator = &rel->rd_locator;
+#endif
+
+	data->ntuples = 0;
+	data->hash = hash_bytes_extended((const unsigned char *) locator, sizeof(*locator), 0);
+	while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+	{
+		bool should_free;
+		HeapTuple tuple = ExecFetchSlotHeapTuple(slot, /* materialize = */ false, &should_free);
+		const TransactionId xmin = HeapTupleHeaderGetRawXmin(tuple->t_data);
+		const uint32 version[4] = {
+			ItemPointerGetBlockNumber(&tuple->t_self),
+			ItemPointerGetOffsetNumber(&tuple->t_self),
+			xmin,
+			TransactionIdIsCurrentTransactionId(xmin) ?
+				HeapTupleHeaderGetRawCommandId(tuple->t_data) :
+				InvalidCommandId,
+		};
+
+		data->hash = hash_combine64(data->hash,
+									hash_bytes_extended((const unsigned char *) version,
+														sizeof(version),
+														0));
+		data->ntuples++;
+
+		Assert(!should_free);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	table_endscan(scan);
+	table_close(rel, AccessShareLock);
+
+	return true;
+}
+
+static void
+partial_agg_cache_start(PartialAggCacheState *state)
+{
+	EState *estate = state->csstate.ss.ps.state;
+
+	state->started = true;
+	state->ntuples = 0;
+	state->next_tuple = 0;
+
+	if (partial_agg_cache_max_bytes() == 0 || !IsMVCCSnapshot(estate->es_snapshot))
+	{
+		return;
+	}
+
+	if (!state->have_data)
+	{
+		if (!compute_data_fingerprint(state->key.compressed_relid,
+									  estate->es_snapshot,
+									  &state->data))
+		{
+			return;
+		}
+		state->have_data = true;
+	}
+
+	PartialAggCacheEntry *entry = partial_agg_cache_lookup(state);
+	if (entry != NULL)
+	{
+		MemoryContext old = MemoryContextSwitchTo(state->replay_mcxt);
+		state->tuples = palloc(sizeof(MinimalTuple) * Max(entry->ntuples, 1));
+		for (int i = 0; i < entry->ntuples; i++)
+		{
+			state->tuples[i] = heap_copy_minimal_tuple(entry->tuples[i]);
+		}
+		MemoryContextSwitchTo(old);
+
+		state->ntuples = entry->ntuples;
+		state->replay = true;
+		state->hits++;
+		return;
+	}
+
+	state->misses++;
+	state->collect_mcxt = AllocSetContextCreate(estate->es_query_cxt,
+												"PartialAggCache tuples",
+												ALLOCSET_DEFAULT_SIZES);
+	state->tuples_capacity = 16;
+	state->tuples =
+		MemoryContextAlloc(state->collect_mcxt, sizeof(MinimalTuple) * state->tuples_capacity);
+}
+
+static void
+partial_agg_cache_collect(PartialAggCacheState *state, TupleTableSlot *slot)
+{
+	MemoryContext old = MemoryContextSwitchTo(state->collect_mcxt);
+
+	if (state->ntuples == state->tuples_capacity)
+	{
+		state->tuples_capacity *= 2;
+		state->tuples = repalloc(state->tuples, sizeof(MinimalTuple) * state->tuples_capacity);
+	}
+	state->tuples[state->ntuples++] = ExecCopySlotMinimalTuple(slot);
+
+	MemoryContextSwitchTo(old);
+
+	/* Stop collecting when the result is not going to fit into the cache. */
+	if (MemoryContextMemAllocated(state->collect_mcxt, /* recurse = */ true) >
+		partial_agg_cache_max_bytes())
+	{
+		MemoryContextDelete(state->collect_mcxt);
+		state->collect_mcxt = NULL;
+		state->tuples = NULL;
+		state->ntuples = 0;
+		state->tuples_capacity = 0;
+	}
+}
+
+static void
+partial_agg_cache_begin(CustomScanState *node, EState *estate, int eflags)
+{
+	PartialAggCacheState *state = (PartialAggCacheState *) node;
+	CustomScan *cscan = castNode(CustomScan, node->ss.ps.plan);
+
+	node->custom_ps = list_make1(ExecInitNode(linitial(cscan->custom_plans), estate, eflags));
+
+	/*
+	 * We return either the tuples of the child node as is, or the cached
+	 * minimal tuples in our own slot, so our result slot ops are not fixed.
+	 */
+	node->ss.ps.scanopsfixed = false;
+	node->ss.ps.resultopsfixed = false;
+
+	memset(&state->key, 0, sizeof(state->key));
+	state->key.compressed_relid = linitial_oid(linitial(cscan->custom_private));
+	state->plan_fingerprint = strVal(lsecond(cscan->custom_private));
+	state->key.plan_hash = hash_bytes((const unsigned char *) state->plan_fingerprint,
+									  strlen(state->plan_fingerprint));
+
+	state->replay_mcxt = AllocSetContextCreate(CurrentMemoryContext,
+											   "PartialAggCache replay",
+											   ALLOCSET_DEFAULT_SIZES);
+	state->replay_slot = ExecInitExtraTupleSlot(estate,
+												node->ss.ss_ScanTupleSlot->tts_tupleDescriptor,
+												&TTSOpsMinimalTuple);
+}
+
+static TupleTableSlot *
+partial_agg_cache_exec(CustomScanState *node)
+{
+	PartialAggCacheState *state = (PartialAggCacheState *) node;
+
+	if (!state->started)
+	{
+		partial_agg_cache_start(state);
+	}
+
+	if (state->replay)
+	{
+		if (state->next_tuple >= state->ntuples)
+		{
+			return NULL;
+		}
+
+		return ExecStoreMinimalTuple(state->tuples[state->next_tuple++],
+									 state->replay_slot,
+									 /* shouldFree = */ false);
+	}
+
+	TupleTableSlot *slot = ExecProcNode(linitial(node->custom_ps));
+
+	if (TupIsNull(slot))
+	{
+		if (state->collect_mcxt != NULL)
+		{
+			partial_agg_cache_insert(state);
+		}
+		return NULL;
+	}
+
+	if (state->collect_mcxt != NULL)
+	{
+		partial_agg_cache_collect(state, slot);
+	}
+
+	return slot;
+}
+
+static void
+partial_agg_cache_rescan(CustomScanState *node)
+{
+	PartialAggCacheState *state = (PartialAggCacheState *) node;
+
+	/* The plan doesn't depend on parameters, so we can replay our copy. */
+	if (state->replay)
+	{
+		state->next_tuple = 0;
+		return;
+	}
+
+	if (state->collect_mcxt != NULL)
+	{
+		MemoryContextDelete(state->collect_mcxt);
+		state->collect_mcxt = NULL;
+	}
+	state->tuples = NULL;
+	state->ntuples = 0;
+	state->tuples_capacity = 0;
+	state->started = false;
+
+	ExecReScan(linitial(node->custom_ps));
+}
+
+static void
+partial_agg_cache_end(CustomScanState *node)
+{
+	ExecEndNode(linitial(node->custom_ps));
+}
+
+static void
+partial_agg_cache_explain(CustomScanState *node, List *ancestors, ExplainState *es)
+{
+	PartialAggCacheState *state = (PartialAggCacheState *) node;
+
+	if (es->analyze)
+	{
+		ExplainPropertyInteger("Cache Hits", NULL, state->hits, es);
+		ExplainPropertyInteger("Cache Misses", NULL, state->misses, es);
+	}
+}
+
+static CustomExecMethods partial_agg_cache_exec_methods = {
+	.CustomName = PARTIAL_AGG_CACHE_NODE_NAME,
+	.BeginCustomScan = partial_agg_cache_begin,
+	.ExecCustomScan = partial_agg_cache_exec,
+	.EndCustomScan = partial_agg_cache_end,
+	.ReScanCustomScan = partial_agg_cache_rescan,
+	.ExplainCustomScan = partial_agg_cache_explain,
+};
+
+static Node *
+partial_agg_cache_state_create(CustomScan *cscan)
+{
+	PartialAggCacheState *state =
+		(PartialAggCacheState *) newNode(sizeof(PartialAggCacheState), T_CustomScanState);
+	state->csstate.methods = &partial_agg_cache_exec_methods;
+	return (Node *) state;
+}
+
+/*
+ * Planning.
+ */
+
+typedef struct PartialAggCachePlanContext
+{
+	PlannedStmt *stmt;
+	int last_plan_node_id;
+} PartialAggCachePlanContext;
+
+/*
+ * The range table indexes of the chunk and its compressed relation that the
+ * partial aggregation reads.
+ */
+typedef struct CacheableSubtreeInfo
+{
+	Index chunk_rti;
+	Index compressed_rti;
+} CacheableSubtreeInfo;
+
+static int
+max_plan_node_id(Plan *plan)
+{
+	if (plan == NULL)
+	{
+		return 0;
+	}
+
+	int result = plan->plan_node_id;
+	result = Max(result, max_plan_node_id(plan->lefttree));
+	result = Max(result, max_plan_node_id(plan->righttree));
+
+	List *children = NIL;
+	if (IsA(plan, Append))
+	{
+		children = castNode(Append, plan)->appendplans;
+	}
+	else if (IsA(plan, MergeAppend))
+	{
+		children = castNode(MergeAppend, plan)->mergeplans;
+	}
+	else if (IsA(plan, CustomScan))
+	{
+		children = castNode(CustomScan, plan)->custom_plans;
+	}
+	else if (IsA(plan, SubqueryScan))
+	{
+		children = list_make1(castNode(SubqueryScan, plan)->subplan);
+	}
+
+	ListCell *lc;
+	foreach (lc, children)
+	{
+		result = Max(result, max_plan_node_id(lfirst(lc)));
+	}
+
+	return result;
+}
+
+static bool
+is_cacheable_expr(Node *node)
+{
+	return !contain_mutable_functions(node) && !contain_subplans(node);
+}
+
+static bool
+is_partial_agg(Plan *plan)
+{
+	if (IsA(plan, Agg))
+	{
+		Agg *agg = castNode(Agg, plan);
+		return agg->aggsplit == AGGSPLIT_INITIAL_SERIAL && agg->groupingSets == NIL;
+	}
+
+	return IsA(plan, CustomScan) &&
+		   strcmp(castNode(CustomScan, plan)->methods->CustomName, VECTOR_AGG_NODE_NAME) == 0;
+}
+
+/*
+ * Check that the result of the plan is determined by the visible tuples of
+ * a single compressed relation, which is read through a DecompressChunk node.
+ * We allow only the plan nodes that we know and that have no other inputs.
+ */
+static bool
+is_cacheable_subtree(Plan *plan, bool below_decompress_chunk, CacheableSubtreeInfo *info)
+{
+	if (plan == NULL)
+	{
+		return true;
+	}
+
+	if (plan->parallel_aware || !bms_is_empty(plan->allParam) || plan->initPlan != NIL ||
+		!is_cacheable_expr((Node *) plan->targetlist) || !is_cacheable_expr((Node *) plan->qual))
+	{
+		return false;
+	}
+
+	List *children = NIL;
+	Index scanrelid = 0;
+	switch (nodeTag(plan))
+	{
+		case T_Agg:
+		case T_Sort:
+		case T_IncrementalSort:
+			break;
+		case T_Result:
+			if (!is_cacheable_expr(castNode(Result, plan)->resconstantqual))
+			{
+				return false;
+			}
+			break;
+		case T_CustomScan:
+		{
+			CustomScan *custom = castNode(CustomScan, plan);
+			if (below_decompress_chunk || !is_cacheable_expr((Node *) custom->custom_exprs))
+			{
+				return false;
+			}
+
+			if (strcmp(custom->methods->CustomName, "DecompressChunk") == 0)
+			{
+				if (info->chunk_rti != 0 || list_length(custom->custom_plans) != 1)
+				{
+					return false;
+				}
+				info->chunk_rti = custom->scan.scanrelid;
+				below_decompress_chunk = true;
+			}
+			else if (strcmp(custom->methods->CustomName, VECTOR_AGG_NODE_NAME) != 0)
+			{
+				return false;
+			}
+			children = custom->custom_plans;
+			break;
+		}
+		case T_SeqScan:
+			scanrelid = castNode(SeqScan, plan)->scan.scanrelid;
+			break;
+		case T_IndexScan:
+		{
+			IndexScan *scan = castNode(IndexScan, plan);
+			if (!is_cacheable_expr((Node *) scan->indexqual) ||
+				!is_cacheable_expr((Node *) scan->indexorderby))
+			{
+				return false;
+			}
+			scanrelid = scan->scan.scanrelid;
+			break;
+		}
+		case T_BitmapHeapScan:
+		{
+			BitmapHeapScan *scan = castNode(BitmapHeapScan, plan);
+			if (!is_cacheable_expr((Node *) scan->bitmapqualorig))
+			{
+				return false;
+			}
+			scanrelid = scan->scan.scanrelid;
+			break;
+		}
+		case T_BitmapIndexScan:
+		{
+			BitmapIndexScan *scan = castNode(BitmapIndexScan, plan);
+			if (!is_cacheable_expr((Node *) scan->indexqual))
+			{
+				return false;
+			}
+			scanrelid = scan->scan.scanrelid;
+			break;
+		}
+		default:
+			return false;
+	}
+
+	/* The scans are allowed only on the compressed relation. */
+	if (scanrelid != 0)
+	{
+		if (!below_decompress_chunk)
+		{
+			return false;
+		}
+
+		if (info->compressed_rti == 0)
+		{
+			info->compressed_rti = scanrelid;
+		}
+		else if (info->compressed_rti != scanrelid)
+		{
+			return false;
+		}
+	}
+
+	if (!is_cacheable_subtree(plan->lefttree, below_decompress_chunk, info) ||
+		!is_cacheable_subtree(plan->righttree, below_decompress_chunk, info))
+	{
+		return false;
+	}
+
+	ListCell *lc;
+	foreach (lc, children)
+	{
+		if (!is_cacheable_subtree(lfirst(lc), below_decompress_chunk, info))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+clear_plan_costs(Plan *plan)
+{
+	if (plan == NULL)
+	{
+		return;
+	}
+
+	plan->startup_cost = 0;
+	plan->total_cost = 0;
+	plan->plan_rows = 0;
+	plan->plan_width = 0;
+	plan->plan_node_id = 0;
+
+	clear_plan_costs(plan->lefttree);
+	clear_plan_costs(plan->righttree);
+
+	if (IsA(plan, CustomScan))
+	{
+		ListCell *lc;
+		foreach (lc, castNode(CustomScan, plan)->custom_plans)
+		{
+			clear_plan_costs(lfirst(lc));
+		}
+	}
+}
+
+/*
+ * Build the plan fingerprint from its text form. We remove the costs, the
+ * locations in the query text, and the range table indexes of the chunk and
+ * the compressed relation, which depend on the other chunks in the query.
+ */
+static char *
+make_plan_fingerprint(Plan *plan, const CacheableSubtreeInfo *info)
+{
+	static const char *const normalized_fields[] = {
+		" :location ",
+		" :varno ",
+		" :varnosyn ",
+		" :scanrelid ",
+	};
+
+	Plan *copy = copyObject(plan);
+	clear_plan_costs(copy);
+	const char *str = nodeToString(copy);
+
+	StringInfoData buf;
+	initStringInfo(&buf);
+	while (*str != '\0')
+	{
+		const char *field = NULL;
+		if (*str == ' ')
+		{
+			for (size_t i = 0; i < lengthof(normalized_fields); i++)
+			{
+				if (strncmp(str, normalized_fields[i], strlen(normalized_fields[i])) == 0)
+				{
+					field = normalized_fields[i];
+					break;
+				}
+			}
+		}
+
+		if (field == NULL)
+		{
+			appendStringInfoChar(&buf, *str++);
+			continue;
+		}
+
+		char *end;
+		const long value = strtol(str + strlen(field), &end, 10);
+		str = end;
+
+		if (field == normalized_fields[0])
+		{
+			continue;
+		}
+
+		appendStringInfoString(&buf, field);
+		if (value == (long) info->chunk_rti)
+		{
+			appendStringInfoString(&buf, "chunk");
+		}
+		else if (value == (long) info->compressed_rti)
+		{
+			appendStringInfoString(&buf, "compressed");
+		}
+		else
+		{
+			appendStringInfo(&buf, "%ld", value);
+		}
+	}
+
+	return buf.data;
+}
+
+static Plan *
+make_partial_agg_cache_plan(PartialAggCachePlanContext *context, Plan *child,
+							const CacheableSubtreeInfo *info)
+{
+	RangeTblEntry *rte = rt_fetch(info->compressed_rti, context->stmt->rtable);
+
+	CustomScan *cscan = makeNode(CustomScan);
+	cscan->methods = &partial_agg_cache_plan_methods;
+	cscan->custom_plans = list_make1(child);
+	cscan->custom_private =
+		list_make2(list_make1_oid(rte->relid), makeString(make_plan_fingerprint(child, info)));
+
+	/*
+	 * This is called after set_plan_refs(), so the output targetlist must
+	 * reference the custom scan targetlist, which is the same as the child
+	 * targetlist because we return the child tuples as is.
+	 */
+	cscan->custom_scan_tlist = copyObject(child->targetlist);
+	ListCell *lc;
+	foreach (lc, cscan->custom_scan_tlist)
+	{
+		TargetEntry *scan_entry = lfirst_node(TargetEntry, lc);
+		Var *var = makeVar(INDEX_VAR,
+						   scan_entry->resno,
+						   exprType((Node *) scan_entry->expr),
+						   exprTypmod((Node *) scan_entry->expr),
+						   exprCollation((Node *) scan_entry->expr),
+						   /* varlevelsup = */ 0);
+		cscan->scan.plan.targetlist =
+			lappend(cscan->scan.plan.targetlist,
+					makeTargetEntry((Expr *) var,
+									scan_entry->resno,
+									scan_entry->resname,
+									scan_entry->resjunk));
+	}
+
+	cscan->scan.plan.startup_cost = child->startup_cost;
+	cscan->scan.plan.total_cost = child->total_cost;
+	cscan->scan.plan.plan_rows = child->plan_rows;
+	cscan->scan.plan.plan_width = child->plan_width;
+	cscan->scan.plan.parallel_aware = false;
+	cscan->scan.plan.parallel_safe = child->parallel_safe;
+
+	if (context->last_plan_node_id == 0)
+	{
+		context->last_plan_node_id = max_plan_node_id(context->stmt->planTree);
+		foreach (lc, context->stmt->subplans)
+		{
+			context->last_plan_node_id =
+				Max(context->last_plan_node_id, max_plan_node_id(lfirst(lc)));
+		}
+	}
+	cscan->scan.plan.plan_node_id = ++context->last_plan_node_id;
+
+	return &cscan->scan.plan;
+}
+
+static Plan *
+insert_partial_agg_cache_walker(PartialAggCachePlanContext *context, Plan *plan)
+{
+	if (plan == NULL)
+	{
+		return NULL;
+	}
+
+	if (is_partial_agg(plan))
+	{
+		CacheableSubtreeInfo info = { 0 };
+		if (is_cacheable_subtree(plan, false, &info) && info.chunk_rti != 0 &&
+			info.compressed_rti != 0)
+		{
+			return make_partial_agg_cache_plan(context, plan, &info);
+		}
+		return plan;
+	}
+
+	plan->lefttree = insert_partial_agg_cache_walker(context, plan->lefttree);
+	plan->righttree = insert_partial_agg_cache_walker(context, plan->righttree);
+
+	List *children = NIL;
+	if (IsA(plan, Append))
+	{
+		children = castNode(Append, plan)->appendplans;
+	}
+	else if (IsA(plan, MergeAppend))
+	{
+		children = castNode(MergeAppend, plan)->mergeplans;
+	}
+	else if (IsA(plan, CustomScan))
+	{
+		CustomScan *custom = castNode(CustomScan, plan);
+		if (strcmp("ChunkAppend", custom->methods->CustomName) == 0)
+		{
+			children = custom->custom_plans;
+		}
+	}
+	else if (IsA(plan, SubqueryScan))
+	{
+		SubqueryScan *subquery = castNode(SubqueryScan, plan);
+		subquery->subplan = insert_partial_agg_cache_walker(context, subquery->subplan);
+	}
+
+	ListCell *lc;
+	foreach (lc, children)
+	{
+		lfirst(lc) = insert_partial_agg_cache_walker(context, lfirst(lc));
+	}
+
+	return plan;
+}
+
+/*
+ * Insert the PartialAggCache nodes above the per-chunk partial aggregations
+ * of the compressed chunks. The modification is done in place.
+ */
+Plan *
+try_insert_partial_agg_cache(PlannedStmt *stmt, Plan *plan)
+{
+	PartialAggCachePlanContext context = { .stmt = stmt };
+	return insert_partial_agg_cache_walker(&context, plan);
+}
@@ -0,0 +1,14 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <nodes/plannodes.h>
+
+#define PARTIAL_AGG_CACHE_NODE_NAME "PartialAggCache"
+
+extern void _partial_agg_cache_init(void);
+extern Plan *try_insert_partial_agg_cache(PlannedStmt *stmt, Plan *plan);
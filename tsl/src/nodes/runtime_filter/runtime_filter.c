@@ -0,0 +1,851 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Runtime join filters.
+ *
+ * When a compressed chunk is on the probe (outer) side of a hash join, most of
+ * its rows might be rejected by the join after we have spent the effort to
+ * decompress them. This is typical for the star schema joins against a small
+ * filtered dimension table. To avoid this, we insert the RuntimeFilter node
+ * between the Hash node and its input. It passes the tuples through unchanged
+ * and collects the range and, if there are only a few of them, the set of the
+ * join keys. When the Hash node has read all its input, the filter is
+ * published through a PARAM_EXEC parameter, and the DecompressChunk nodes on
+ * the probe side apply it as vectorized quals and use it to skip the
+ * compressed batches by their min/max metadata or segmentby value.
+ *
+ * The filter is an optimization and can be applied to any subset of the probe
+ * side rows, so it is fine that the hash join might read the first probe side
+ * tuple before building the hash table.
+ *
+ * Only the DecompressChunk nodes use the filter. The hypercore tables are read
+ * with ColumnarScan, which is not a filter target, so the joins against them
+ * are not filtered.
+ */
+#include <postgres.h>
+
+#include <access/stratnum.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_type.h>
+#include <commands/defrem.h>
+#include <executor/executor.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <parser/parsetree.h>
+#include <utils/array.h>
+#include <utils/lsyscache.h>
+
+#include "runtime_filter.h"
+
+#include "nodes/decompress_chunk/planner.h"
+#include "nodes/decompress_chunk/vector_predicates.h"
+
+typedef struct RuntimeFilterKey
+{
+	/* Attno of the join key in the input tuple of the Hash node. */
+	AttrNumber attno;
+	int paramid;
+	RuntimeFilter *filter;
+} RuntimeFilterKey;
+
+typedef struct RuntimeFilterState
+{
+	CustomScanState csstate;
+	int num_keys;
+	RuntimeFilterKey *keys;
+	bool published;
+} RuntimeFilterState;
+
+static Node *runtime_filter_state_create(CustomScan *cscan);
+
+static CustomScanMethods runtime_filter_plan_methods = {
+	.CustomName = RUNTIME_FILTER_NODE_NAME,
+	.CreateCustomScanState = runtime_filter_state_create,
+};
+
+void
+_runtime_filter_init(void)
+{
+	TryRegisterCustomScanMethods(&runtime_filter_plan_methods);
+}
+
+static int
+runtime_filter_compare(const void *a, const void *b, void *arg)
+{
+	return ApplySortComparator(*(const Datum *) a,
+							   false,
+							   *(const Datum *) b,
+							   false,
+							   (SortSupport) arg);
+}
+
+/*
+ * Sort and deduplicate the collected keys.
+ */
+static void
+runtime_filter_compact(RuntimeFilter *filter)
+{
+	if (filter->nvalues <= 1)
+	{
+		return;
+	}
+
+	qsort_arg(filter->values,
+			  filter->nvalues,
+			  sizeof(Datum),
+			  runtime_filter_compare,
+			  &filter->sortkey);
+
+	int distinct = 1;
+	for (int i = 1; i < filter->nvalues; i++)
+	{
+		if (ApplySortComparator(filter->values[distinct - 1],
+								false,
+								filter->values[i],
+								false,
+								&filter->sortkey) != 0)
+		{
+			filter->values[distinct++] = filter->values[i];
+		}
+	}
+	filter->nvalues = distinct;
+}
+
+static void
+runtime_filter_add(RuntimeFilter *filter, Datum value)
+{
+	if (filter->empty)
+	{
+		filter->min = value;
+		filter->max = value;
+		filter->empty = false;
+	}
+	else if (ApplySortComparator(value, false, filter->min, false, &filter->sortkey) < 0)
+	{
+		filter->min = value;
+	}
+	else if (ApplySortComparator(value, false, filter->max, false, &filter->sortkey) > 0)
+	{
+		filter->max = value;
+	}
+
+	if (!filter->have_values)
+	{
+		return;
+	}
+
+	if (filter->nvalues == filter->values_capacity)
+	{
+		/*
+		 * The buffer is several times larger than the maximum number of the
+		 * distinct values, so the compaction is amortized.
+		 */
+		runtime_filter_compact(filter);
+		if (filter->nvalues > RUNTIME_FILTER_MAX_VALUES)
+		{
+			filter->have_values = false;
+			return;
+		}
+	}
+
+	filter->values[filter->nvalues++] = value;
+}
+
+static void
+runtime_filter_reset(RuntimeFilterState *state)
+{
+	ParamExecData *params = state->csstate.ss.ps.state->es_param_exec_vals;
+	for (int i = 0; i < state->num_keys; i++)
+	{
+		RuntimeFilterKey *key = &state->keys[i];
+		key->filter->empty = true;
+		key->filter->have_values = true;
+		key->filter->nvalues = 0;
+
+		params[key->paramid].execPlan = NULL;
+		params[key->paramid].value = (Datum) 0;
+		params[key->paramid].isnull = true;
+	}
+	state->published = false;
+}
+
+static void
+runtime_filter_publish(RuntimeFilterState *state)
+{
+	ParamExecData *params = state->csstate.ss.ps.state->es_param_exec_vals;
+	for (int i = 0; i < state->num_keys; i++)
+	{
+		RuntimeFilterKey *key = &state->keys[i];
+		RuntimeFilter *filter = key->filter;
+
+		if (filter->have_values)
+		{
+			runtime_filter_compact(filter);
+			filter->have_values = filter->nvalues <= RUNTIME_FILTER_MAX_VALUES;
+		}
+		filter->version++;
+
+		params[key->paramid].value = PointerGetDatum(filter);
+		params[key->paramid].isnull = false;
+	}
+	state->published = true;
+}
+
+static void
+runtime_filter_begin(CustomScanState *node, EState *estate, int eflags)
+{
+	RuntimeFilterState *state = (RuntimeFilterState *) node;
+	CustomScan *cscan = castNode(CustomScan, node->ss.ps.plan);
+
+	node->custom_ps = list_make1(ExecInitNode(linitial(cscan->custom_plans), estate, eflags));
+
+	/*
+	 * We return the tuples of the child node as is, so our result slot ops are
+	 * not fixed. See the same code in ChunkAppend.
+	 */
+	node->ss.ps.scanopsfixed = false;
+	node->ss.ps.resultopsfixed = false;
+
+	state->num_keys = list_length(cscan->custom_private);
+	state->keys = palloc0(sizeof(RuntimeFilterKey) * state->num_keys);
+	for (int i = 0; i < state->num_keys; i++)
+	{
+		List *key_info = list_nth(cscan->custom_private, i);
+		List *key_settings = linitial(key_info);
+		List *key_ops = lsecond(key_info);
+
+		RuntimeFilterKey *key = &state->keys[i];
+		key->attno = linitial_int(key_settings);
+		key->paramid = lsecond_int(key_settings);
+
+		RuntimeFilter *filter = palloc0(sizeof(RuntimeFilter));
+		filter->typid = linitial_oid(key_ops);
+		filter->collation = lsecond_oid(key_ops);
+		filter->eq_opno = lthird_oid(key_ops);
+		filter->ge_opno = lfourth_oid(key_ops);
+		filter->le_opno = list_nth_oid(key_ops, 4);
+		filter->sortkey.ssup_cxt = CurrentMemoryContext;
+		filter->sortkey.ssup_collation = filter->collation;
+		filter->sortkey.ssup_nulls_first = false;
+		PrepareSortSupportFromOrderingOp(list_nth_oid(key_ops, 5), &filter->sortkey);
+		filter->values_capacity = RUNTIME_FILTER_MAX_VALUES * 4;
+		filter->values = palloc(sizeof(Datum) * filter->values_capacity);
+		key->filter = filter;
+	}
+
+	runtime_filter_reset(state);
+}
+
+static TupleTableSlot *
+runtime_filter_exec(CustomScanState *node)
+{
+	RuntimeFilterState *state = (RuntimeFilterState *) node;
+	TupleTableSlot *slot = ExecProcNode(linitial(node->custom_ps));
+
+	if (TupIsNull(slot))
+	{
+		if (!state->published)
+		{
+			runtime_filter_publish(state);
+		}
+		return NULL;
+	}
+
+	/* The join keys are by-value, so we don't have to copy them. */
+	for (int i = 0; i < state->num_keys; i++)
+	{
+		RuntimeFilterKey *key = &state->keys[i];
+		bool isnull;
+		Datum value = slot_getattr(slot, key->attno, &isnull);
+		if (!isnull)
+		{
+			runtime_filter_add(key->filter, value);
+		}
+	}
+
+	return slot;
+}
+
+static void
+runtime_filter_rescan(CustomScanState *node)
+{
+	RuntimeFilterState *state = (RuntimeFilterState *) node;
+
+	runtime_filter_reset(state);
+
+	if (node->ss.ps.chgParam != NULL)
+		UpdateChangedParamSet(linitial(node->custom_ps), node->ss.ps.chgParam);
+
+	ExecReScan(linitial(node->custom_ps));
+}
+
+static void
+runtime_filter_end(CustomScanState *node)
+{
+	ExecEndNode(linitial(node->custom_ps));
+}
+
+static CustomExecMethods runtime_filter_exec_methods = {
+	.CustomName = RUNTIME_FILTER_NODE_NAME,
+	.BeginCustomScan = runtime_filter_begin,
+	.ExecCustomScan = runtime_filter_exec,
+	.EndCustomScan = runtime_filter_end,
+	.ReScanCustomScan = runtime_filter_rescan,
+};
+
+static Node *
+runtime_filter_state_create(CustomScan *cscan)
+{
+	RuntimeFilterState *state =
+		(RuntimeFilterState *) newNode(sizeof(RuntimeFilterState), T_CustomScanState);
+	state->csstate.methods = &runtime_filter_exec_methods;
+	return (Node *) state;
+}
+
+/*
+ * Build the vectorized quals for the given probe side variable.
+ */
+List *
+runtime_filter_make_quals(const RuntimeFilter *filter, Var *var)
+{
+	Assert(!filter->empty);
+
+	int16 typlen;
+	bool typbyval;
+	char typalign;
+	get_typlenbyvalalign(filter->typid, &typlen, &typbyval, &typalign);
+	Assert(typbyval);
+
+	if (filter->have_values && filter->nvalues == 1)
+	{
+		Expr *eq = make_opclause(filter->eq_opno,
+								 BOOLOID,
+								 /* opretset = */ false,
+								 (Expr *) var,
+								 (Expr *) makeConst(filter->typid,
+													-1,
+													filter->collation,
+													typlen,
+													filter->values[0],
+													/* constisnull = */ false,
+													typbyval),
+								 InvalidOid,
+								 filter->collation);
+		set_opfuncid(castNode(OpExpr, eq));
+		return list_make1(eq);
+	}
+
+	if (filter->have_values)
+	{
+		ArrayType *array =
+			construct_array(filter->values, filter->nvalues, filter->typid, typlen, typbyval, typalign);
+
+		ScalarArrayOpExpr *saop = makeNode(ScalarArrayOpExpr);
+		saop->opno = filter->eq_opno;
+		saop->opfuncid = get_opcode(filter->eq_opno);
+		saop->useOr = true;
+		saop->inputcollid = filter->collation;
+		saop->args = list_make2(var,
+								makeConst(get_array_type(filter->typid),
+										  -1,
+										  InvalidOid,
+										  -1,
+										  PointerGetDatum(array),
+										  /* constisnull = */ false,
+										  /* constbyval = */ false));
+		saop->location = -1;
+		return list_make1(saop);
+	}
+
+	List *quals = NIL;
+	Datum bounds[2] = { filter->min, filter->max };
+	Oid opnos[2] = { filter->ge_opno, filter->le_opno };
+	for (int i = 0; i < 2; i++)
+	{
+		Expr *qual = make_opclause(opnos[i],
+								   BOOLOID,
+								   /* opretset = */ false,
+								   (Expr *) copyObject(var),
+								   (Expr *) makeConst(filter->typid,
+													  -1,
+													  filter->collation,
+													  typlen,
+													  bounds[i],
+													  /* constisnull = */ false,
+													  typbyval),
+								   InvalidOid,
+								   filter->collation);
+		set_opfuncid(castNode(OpExpr, qual));
+		quals = lappend(quals, qual);
+	}
+	return quals;
+}
+
+/*
+ * Check whether none of the join keys fall into the given closed range.
+ */
+bool
+runtime_filter_excludes_range(RuntimeFilter *filter, Datum min, Datum max)
+{
+	if (filter->empty)
+	{
+		return true;
+	}
+
+	if (ApplySortComparator(max, false, filter->min, false, &filter->sortkey) < 0 ||
+		ApplySortComparator(min, false, filter->max, false, &filter->sortkey) > 0)
+	{
+		return true;
+	}
+
+	if (!filter->have_values)
+	{
+		return false;
+	}
+
+	/* Find the first key that is not less than the range start. */
+	int low = 0;
+	int high = filter->nvalues;
+	while (low < high)
+	{
+		const int mid = low + (high - low) / 2;
+		if (ApplySortComparator(filter->values[mid], false, min, false, &filter->sortkey) < 0)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	return low == filter->nvalues ||
+		   ApplySortComparator(filter->values[low], false, max, false, &filter->sortkey) > 0;
+}
+
+/*
+ * Planning.
+ */
+
+typedef struct RuntimeFilterPlanContext
+{
+	PlannedStmt *stmt;
+	int last_plan_node_id;
+} RuntimeFilterPlanContext;
+
+static bool
+contains_special_vars_walker(Node *node, void *context)
+{
+	if (node == NULL)
+	{
+		return false;
+	}
+
+	if (IsA(node, Var))
+	{
+		return IS_SPECIAL_VARNO(castNode(Var, node)->varno);
+	}
+
+	return expression_tree_walker(node, contains_special_vars_walker, context);
+}
+
+static int
+max_plan_node_id(Plan *plan)
+{
+	if (plan == NULL)
+	{
+		return 0;
+	}
+
+	int result = plan->plan_node_id;
+	result = Max(result, max_plan_node_id(plan->lefttree));
+	result = Max(result, max_plan_node_id(plan->righttree));
+
+	List *children = NIL;
+	if (IsA(plan, Append))
+	{
+		children = castNode(Append, plan)->appendplans;
+	}
+	else if (IsA(plan, MergeAppend))
+	{
+		children = castNode(MergeAppend, plan)->mergeplans;
+	}
+	else if (IsA(plan, CustomScan))
+	{
+		children = castNode(CustomScan, plan)->custom_plans;
+	}
+	else if (IsA(plan, SubqueryScan))
+	{
+		children = list_make1(castNode(SubqueryScan, plan)->subplan);
+	}
+
+	ListCell *lc;
+	foreach (lc, children)
+	{
+		result = Max(result, max_plan_node_id(lfirst(lc)));
+	}
+
+	return result;
+}
+
+/*
+ * Whether the given DecompressChunk output column can be filtered with
+ * vectorized quals.
+ */
+static bool
+is_vector_filter_column(const CustomScan *decompress_chunk, AttrNumber custom_scan_attno)
+{
+	List *settings = list_nth(decompress_chunk->custom_private, DCP_Settings);
+	List *decompression_map = list_nth(decompress_chunk->custom_private, DCP_DecompressionMap);
+	List *is_segmentby_column = list_nth(decompress_chunk->custom_private, DCP_IsSegmentbyColumn);
+	List *bulk_decompression_column =
+		list_nth(decompress_chunk->custom_private, DCP_BulkDecompressionColumn);
+
+	for (int i = 0; i < list_length(decompression_map); i++)
+	{
+		if (list_nth_int(decompression_map, i) != custom_scan_attno)
+		{
+			continue;
+		}
+
+		return list_nth_int(is_segmentby_column, i) ||
+			   (list_nth_int(bulk_decompression_column, i) &&
+				list_nth_int(settings, DCS_EnableBulkDecompression));
+	}
+
+	return false;
+}
+
+/*
+ * Find the DecompressChunk nodes that produce the given output column of the
+ * probe side plan. We only look through the nodes that pass the tuples of
+ * their children through. Note that we can't cross the Gather nodes, because
+ * the parallel workers don't see the parameters set by the leader. The
+ * ColumnarScan nodes of the hypercore tables are not targets.
+ */
+static void
+find_runtime_filter_targets(Plan *plan, AttrNumber attno, List **scans, List **attnos)
+{
+	TargetEntry *target = get_tle_by_resno(plan->targetlist, attno);
+	if (target == NULL || !IsA(target->expr, Var))
+	{
+		return;
+	}
+	Var *var = castNode(Var, target->expr);
+
+	List *children = NIL;
+	switch (nodeTag(plan))
+	{
+		case T_CustomScan:
+		{
+			CustomScan *custom = castNode(CustomScan, plan);
+			if (strcmp(custom->methods->CustomName, "DecompressChunk") == 0)
+			{
+				if (var->varno != INDEX_VAR && (Index) var->varno != custom->scan.scanrelid)
+				{
+					return;
+				}
+
+				if (is_vector_filter_column(custom, var->varattno))
+				{
+					*scans = lappend(*scans, custom);
+					*attnos = lappend_int(*attnos, var->varattno);
+				}
+				return;
+			}
+
+			if (strcmp(custom->methods->CustomName, "ChunkAppend") != 0 ||
+				var->varno != INDEX_VAR)
+			{
+				return;
+			}
+			children = custom->custom_plans;
+			break;
+		}
+		case T_Append:
+			children = castNode(Append, plan)->appendplans;
+			break;
+		case T_MergeAppend:
+			children = castNode(MergeAppend, plan)->mergeplans;
+			break;
+		case T_Sort:
+		case T_IncrementalSort:
+		case T_Material:
+		case T_Result:
+			if (plan->lefttree == NULL)
+			{
+				return;
+			}
+			children = list_make1(plan->lefttree);
+			break;
+		default:
+			return;
+	}
+
+	if (var->varno != OUTER_VAR && var->varno != INDEX_VAR)
+	{
+		return;
+	}
+
+	ListCell *lc;
+	foreach (lc, children)
+	{
+		find_runtime_filter_targets(lfirst(lc), var->varattno, scans, attnos);
+	}
+}
+
+/*
+ * Check the hash clause and determine the operators for the runtime filter.
+ * Returns NIL if it can't be used for filtering.
+ */
+static List *
+get_runtime_filter_ops(OpExpr *clause, Var **outer, Var **inner)
+{
+	if (list_length(clause->args) != 2 || !IsA(linitial(clause->args), Var) ||
+		!IsA(lsecond(clause->args), Var))
+	{
+		return NIL;
+	}
+
+	*outer = linitial_node(Var, clause->args);
+	*inner = lsecond_node(Var, clause->args);
+	if ((*outer)->varno != OUTER_VAR || (*inner)->varno != INNER_VAR)
+	{
+		return NIL;
+	}
+
+	/* We keep the keys without copying, so require a by-value type. */
+	const Oid typid = (*outer)->vartype;
+	if ((*inner)->vartype != typid || !get_typbyval(typid))
+	{
+		return NIL;
+	}
+
+	const Oid opclass = GetDefaultOpClass(typid, BTREE_AM_OID);
+	if (!OidIsValid(opclass))
+	{
+		return NIL;
+	}
+
+	const Oid opfamily = get_opclass_family(opclass);
+	if (get_opfamily_member(opfamily, typid, typid, BTEqualStrategyNumber) != clause->opno)
+	{
+		return NIL;
+	}
+
+	const Oid ge_opno = get_opfamily_member(opfamily, typid, typid, BTGreaterEqualStrategyNumber);
+	const Oid le_opno = get_opfamily_member(opfamily, typid, typid, BTLessEqualStrategyNumber);
+	const Oid lt_opno = get_opfamily_member(opfamily, typid, typid, BTLessStrategyNumber);
+	if (!OidIsValid(ge_opno) || !OidIsValid(le_opno) || !OidIsValid(lt_opno))
+	{
+		return NIL;
+	}
+
+	if (get_vector_const_predicate(get_opcode(clause->opno)) == NULL ||
+		get_vector_const_predicate(get_opcode(ge_opno)) == NULL ||
+		get_vector_const_predicate(get_opcode(le_opno)) == NULL)
+	{
+		return NIL;
+	}
+
+	List *ops = list_make4_oid(typid, clause->inputcollid, clause->opno, ge_opno);
+	ops = lappend_oid(ops, le_opno);
+	ops = lappend_oid(ops, lt_opno);
+	return ops;
+}
+
+static Plan *
+make_runtime_filter_plan(RuntimeFilterPlanContext *context, Plan *child, List *keys)
+{
+	CustomScan *cscan = makeNode(CustomScan);
+	cscan->methods = &runtime_filter_plan_methods;
+	cscan->custom_plans = list_make1(child);
+	cscan->custom_private = keys;
+
+	/*
+	 * This is called after set_plan_refs(), so the output targetlist must
+	 * reference the custom scan targetlist, which is the same as the child
+	 * targetlist because we return the child tuples as is.
+	 */
+	cscan->custom_scan_tlist = copyObject(child->targetlist);
+	ListCell *lc;
+	foreach (lc, cscan->custom_scan_tlist)
+	{
+		TargetEntry *scan_entry = lfirst_node(TargetEntry, lc);
+		Var *var = makeVar(INDEX_VAR,
+						   scan_entry->resno,
+						   exprType((Node *) scan_entry->expr),
+						   exprTypmod((Node *) scan_entry->expr),
+						   exprCollation((Node *) scan_entry->expr),
+						   /* varlevelsup = */ 0);
+		cscan->scan.plan.targetlist =
+			lappend(cscan->scan.plan.targetlist,
+					makeTargetEntry((Expr *) var,
+									scan_entry->resno,
+									scan_entry->resname,
+									scan_entry->resjunk));
+	}
+
+	cscan->scan.plan.startup_cost = child->startup_cost;
+	cscan->scan.plan.total_cost = child->total_cost;
+	cscan->scan.plan.plan_rows = child->plan_rows;
+	cscan->scan.plan.plan_width = child->plan_width;
+	cscan->scan.plan.parallel_aware = false;
+	cscan->scan.plan.parallel_safe = child->parallel_safe;
+	cscan->scan.plan.extParam = bms_copy(child->extParam);
+	cscan->scan.plan.allParam = bms_copy(child->allParam);
+
+	if (context->last_plan_node_id == 0)
+	{
+		context->last_plan_node_id = max_plan_node_id(context->stmt->planTree);
+		foreach (lc, context->stmt->subplans)
+		{
+			context->last_plan_node_id =
+				Max(context->last_plan_node_id, max_plan_node_id(lfirst(lc)));
+		}
+	}
+	cscan->scan.plan.plan_node_id = ++context->last_plan_node_id;
+
+	return &cscan->scan.plan;
+}
+
+static void
+add_runtime_filters_to_hash_join(RuntimeFilterPlanContext *context, HashJoin *hash_join)
+{
+	/*
+	 * We can only remove the probe side rows that can't have matches, so the
+	 * probe side must not be preserved by the join.
+	 */
+	if (hash_join->join.jointype != JOIN_INNER && hash_join->join.jointype != JOIN_SEMI &&
+		hash_join->join.jointype != JOIN_RIGHT)
+	{
+		return;
+	}
+
+	/*
+	 * The shared hash table of the Parallel Hash is built by several
+	 * processes, each of them sees only a part of the keys. Also, the hashed
+	 * side must not depend on parameters, because the lazy rescan on parameter
+	 * change might happen after the probe side has already read a batch with
+	 * the previous filter.
+	 */
+	Hash *hash = castNode(Hash, innerPlan(hash_join));
+	Plan *build_input = outerPlan(hash);
+	if (hash->plan.parallel_aware || !bms_is_empty(hash->plan.allParam) ||
+		contains_special_vars_walker((Node *) build_input->targetlist, NULL))
+	{
+		return;
+	}
+
+	List *keys = NIL;
+	ListCell *lc;
+	foreach (lc, hash_join->hashclauses)
+	{
+		if (!IsA(lfirst(lc), OpExpr))
+		{
+			continue;
+		}
+
+		Var *outer = NULL;
+		Var *inner = NULL;
+		List *ops = get_runtime_filter_ops(lfirst_node(OpExpr, lc), &outer, &inner);
+		if (ops == NIL)
+		{
+			continue;
+		}
+
+		/* The Hash node has a dummy targetlist referencing its input. */
+		TargetEntry *hash_entry = get_tle_by_resno(hash->plan.targetlist, inner->varattno);
+		if (hash_entry == NULL || !IsA(hash_entry->expr, Var) ||
+			castNode(Var, hash_entry->expr)->varno != OUTER_VAR)
+		{
+			continue;
+		}
+		const AttrNumber build_attno = castNode(Var, hash_entry->expr)->varattno;
+
+		List *scans = NIL;
+		List *attnos = NIL;
+		find_runtime_filter_targets(outerPlan(hash_join), outer->varattno, &scans, &attnos);
+		if (scans == NIL)
+		{
+			continue;
+		}
+
+		context->stmt->paramExecTypes = lappend_oid(context->stmt->paramExecTypes, INTERNALOID);
+		const int paramid = list_length(context->stmt->paramExecTypes) - 1;
+
+		for (int i = 0; i < list_length(scans); i++)
+		{
+			CustomScan *decompress_chunk = list_nth(scans, i);
+			ListCell *filters_cell =
+				list_nth_cell(decompress_chunk->custom_private, DCP_RuntimeFilters);
+			lfirst(filters_cell) =
+				lappend(lfirst(filters_cell), list_make2_int(paramid, list_nth_int(attnos, i)));
+		}
+
+		keys = lappend(keys, list_make2(list_make2_int(build_attno, paramid), ops));
+	}
+
+	if (keys != NIL)
+	{
+		hash->plan.lefttree = make_runtime_filter_plan(context, build_input, keys);
+	}
+}
+
+static void
+insert_runtime_filters_walker(RuntimeFilterPlanContext *context, Plan *plan)
+{
+	if (plan == NULL)
+	{
+		return;
+	}
+
+	insert_runtime_filters_walker(context, plan->lefttree);
+	insert_runtime_filters_walker(context, plan->righttree);
+
+	List *children = NIL;
+	if (IsA(plan, Append))
+	{
+		children = castNode(Append, plan)->appendplans;
+	}
+	else if (IsA(plan, MergeAppend))
+	{
+		children = castNode(MergeAppend, plan)->mergeplans;
+	}
+	else if (IsA(plan, CustomScan))
+	{
+		children = castNode(CustomScan, plan)->custom_plans;
+	}
+	else if (IsA(plan, SubqueryScan))
+	{
+		children = list_make1(castNode(SubqueryScan, plan)->subplan);
+	}
+
+	ListCell *lc;
+	foreach (lc, children)
+	{
+		insert_runtime_filters_walker(context, lfirst(lc));
+	}
+
+	if (IsA(plan, HashJoin))
+	{
+		add_runtime_filters_to_hash_join(context, castNode(HashJoin, plan));
+	}
+}
+
+/*
+ * Insert the RuntimeFilter nodes below the Hash nodes of the hash joins that
+ * have DecompressChunk on their probe side. The modification is done in place.
+ */
+Plan *
+try_insert_runtime_filters(PlannedStmt *stmt, Plan *plan)
+{
+	RuntimeFilterPlanContext context = { .stmt = stmt };
+	insert_runtime_filters_walker(&context, plan);
+	return plan;
+}
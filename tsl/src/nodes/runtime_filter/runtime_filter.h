@@ -0,0 +1,63 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <nodes/plannodes.h>
+#include <nodes/primnodes.h>
+#include <utils/sortsupport.h>
+
+#define RUNTIME_FILTER_NODE_NAME "RuntimeFilter"
+
+/*
+ * The maximum number of distinct join keys for which we build an IN-list
+ * filter. With more keys, only their range is used.
+ */
+#define RUNTIME_FILTER_MAX_VALUES 64
+
+/*
+ * The filter for the probe side of a hash join, built from the join keys of
+ * its hashed side. It is published through a PARAM_EXEC parameter when the
+ * hashed side is read completely, and the parameter is null while the filter
+ * is not ready.
+ */
+typedef struct RuntimeFilter
+{
+	/* Incremented every time the filter is republished after a rescan. */
+	uint64 version;
+
+	Oid typid;
+	Oid collation;
+
+	/* The operators for the vectorized quals on the probe side. */
+	Oid eq_opno;
+	Oid ge_opno;
+	Oid le_opno;
+
+	/* Comparator for the key type, for the range and the batch metadata. */
+	SortSupportData sortkey;
+
+	/* No non-null keys, so the probe side can't have any matches. */
+	bool empty;
+
+	Datum min;
+	Datum max;
+
+	/*
+	 * The sorted distinct keys, if there are at most RUNTIME_FILTER_MAX_VALUES
+	 * of them. Otherwise, have_values is false.
+	 */
+	bool have_values;
+	int nvalues;
+	int values_capacity;
+	Datum *values;
+} RuntimeFilter;
+
+extern void _runtime_filter_init(void);
+extern Plan *try_insert_runtime_filters(PlannedStmt *stmt, Plan *plan);
+
+extern List *runtime_filter_make_quals(const RuntimeFilter *filter, Var *var);
+extern bool runtime_filter_excludes_range(RuntimeFilter *filter, Datum min, Datum max);
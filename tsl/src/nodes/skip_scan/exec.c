@@ -5,17 +5,31 @@
  */
 
 /*
- * SkipScan is an optimized form of SELECT DISTINCT ON (column)
+ * SkipScan is an optimized form of SELECT DISTINCT ON (columns)
  * Conceptually, a SkipScan is a regular IndexScan with an additional skip-qual like
  *     WHERE column > [previous value of column]
  *
- * Implementing this qual is complicated by two factors:
- *   1. The first time through the SkipScan there is no previous value for the
- *      DISTINCT column.
+ * For DISTINCT on several columns the SkipScan is a loose index scan over
+ * the prefix of the index formed by the distinct columns. After finding a
+ * tuple with the distinct values (a1, b1), the next search advances the
+ * rightmost key
+ *     WHERE a = a1 AND b > b1
+ * and if there is no such tuple, it advances the key to the left of it and
+ * does not restrict the keys to the right
+ *     WHERE a > a1
+ * until there are no keys left to advance.
+ *
+ * Implementing these quals is complicated by two factors:
+ *   1. The first time through the SkipScan there are no previous values for
+ *      the DISTINCT columns.
  *   2. NULL values don't behave nicely with ordering operators.
  *
- * To get around these issues, we have to special case those two cases. All in
- * all, the SkipScan's state machine evolves according to the following flowchart
+ * To get around these issues, every skip key is in one of the modes of
+ * SkipKeyMode. A key of a column with a NULL previous value stays on it with
+ * IS NULL, and advances with IS NOT NULL for NULLS FIRST ordering. For NULLS
+ * LAST ordering nothing follows NULL, and after the values of the column we
+ * search for NULL. All in all, advancing a single key evolves according to
+ * the following flowchart
  *
  *                        start
  *                          |
@@ -38,12 +52,21 @@
  *                    |   DONE    |
  *                    \===========/
  *
+ * where the first search does not restrict the key at all, and DONE means
+ * advancing the key to the left of it or ending the scan.
+ *
+ * The skip keys which do not restrict the search are removed from the scan
+ * keys of the child scan. A btree scan fixes the number of scan keys when it
+ * begins, so the child scan is restarted when the number of keys changes,
+ * which happens only when the search moves to another key.
  */
 
 #include <postgres.h>
 #include <access/genam.h>
+#include <access/stratnum.h>
 #include <nodes/extensible.h>
 #include <nodes/pg_list.h>
+#include <storage/bufmgr.h>
 #include <utils/datum.h>
 
 #include "guc.h"
@@ -52,13 +75,43 @@
 typedef enum SkipScanStage
 {
 	SS_BEGIN = 0,
-	SS_NULLS_FIRST,
-	SS_NOT_NULL,
-	SS_VALUES,
-	SS_NULLS_LAST,
+	SS_SEARCH,
 	SS_END,
 } SkipScanStage;
 
+typedef enum SkipKeyMode
+{
+	SKIP_KEY_ANY = 0, /* the key does not restrict the search */
+	SKIP_KEY_EQ,	  /* column = prev, or column IS NULL for NULL prev */
+	SKIP_KEY_AFTER,	  /* values after prev in scan direction */
+	SKIP_KEY_NOT_NULL,
+	SKIP_KEY_NULL,
+} SkipKeyMode;
+
+typedef struct SkipKeyState
+{
+	/* Position of the skip key in the scan keys of the child scan */
+	int key_pos;
+	SkipKeyMode mode;
+
+	/* Strategy and function of the skip qual to search after prev */
+	StrategyNumber after_strategy;
+	FmgrInfo after_func;
+	/* Equality function to stay on prev */
+	Oid eq_funcid;
+	FmgrInfo eq_func;
+
+	Datum prev_datum;
+	bool prev_is_null;
+
+	/* Info about the column we are performing DISTINCT on */
+	bool distinct_by_val;
+	int distinct_col_attnum;
+	int distinct_typ_len;
+	int sk_attno;
+	bool nulls_first;
+} SkipKeyState;
+
 typedef struct SkipScanState
 {
 	CustomScanState cscan_state;
@@ -71,31 +124,30 @@ typedef struct SkipScanState
 	/* Pointers into the Index(Only)Scan */
 	int *num_scan_keys;
 	ScanKey *scan_keys;
-	ScanKey skip_key;
+	int *num_runtime_keys;
+	bool *runtime_keys_ready;
 
-	Datum prev_datum;
-	bool prev_is_null;
+	/* All scan keys of the child scan, including the skip keys */
+	ScanKey all_keys;
+	int num_all_keys;
+	/* Scan keys of the current search, without the unused skip keys */
+	ScanKey search_keys;
 
-	/* Info about the type we are performing DISTINCT on */
-	bool distinct_by_val;
-	int distinct_col_attnum;
-	int distinct_typ_len;
-	int sk_attno;
+	/* Skip keys in the order of the index columns */
+	SkipKeyState *skip_keys;
+	int num_skip_keys;
+
+	/* Skip key advanced by the current search, -1 for the first search */
+	int level;
 
 	SkipScanStage stage;
 
-	bool nulls_first;
 	/* rescan required before getting next tuple */
 	bool needs_rescan;
 
 	void *idx_scan;
 } SkipScanState;
 
-static bool has_nulls_first(SkipScanState *state);
-static bool has_nulls_last(SkipScanState *state);
-static void skip_scan_rescan_index(SkipScanState *state);
-static void skip_scan_switch_stage(SkipScanState *state, SkipScanStage new_stage);
-
 static void
 skip_scan_begin(CustomScanState *node, EState *estate, int eflags)
 {
@@ -110,6 +162,8 @@ skip_scan_begin(CustomScanState *node, EState *estate, int eflags)
 		IndexScanState *idx = castNode(IndexScanState, state->idx);
 		state->scan_keys = &idx->iss_ScanKeys;
 		state->num_scan_keys = &idx->iss_NumScanKeys;
+		state->num_runtime_keys = &idx->iss_NumRuntimeKeys;
+		state->runtime_keys_ready = &idx->iss_RuntimeKeysReady;
 		state->scan_desc = &idx->iss_ScanDesc;
 	}
 	else if (IsA(state->idx_scan, IndexOnlyScan))
@@ -117,6 +171,8 @@ skip_scan_begin(CustomScanState *node, EState *estate, int eflags)
 		IndexOnlyScanState *idx = castNode(IndexOnlyScanState, state->idx);
 		state->scan_keys = &idx->ioss_ScanKeys;
 		state->num_scan_keys = &idx->ioss_NumScanKeys;
+		state->num_runtime_keys = &idx->ioss_NumRuntimeKeys;
+		state->runtime_keys_ready = &idx->ioss_RuntimeKeysReady;
 		state->scan_desc = &idx->ioss_ScanDesc;
 	}
 	else
@@ -126,115 +182,263 @@ skip_scan_begin(CustomScanState *node, EState *estate, int eflags)
 	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
 		return;
 
-	/* find position of our skip key
+	/*
+	 * The runtime keys of the child scan are evaluated into its original scan
+	 * keys, so we keep those and pass a copy without the unused skip keys to
+	 * the child scan.
+	 */
+	state->all_keys = *state->scan_keys;
+	state->num_all_keys = *state->num_scan_keys;
+	state->search_keys = palloc(sizeof(ScanKeyData) * Max(state->num_all_keys, 1));
+
+	/* find position of our skip keys
 	 * skip key is put as first key for the respective column in sort_indexquals
 	 */
-	ScanKey data = *state->scan_keys;
-	for (int i = 0; i < *state->num_scan_keys; i++)
+	for (int i = 0; i < state->num_skip_keys; i++)
 	{
-		if (data[i].sk_flags == SK_ISNULL && data[i].sk_attno == state->sk_attno)
+		SkipKeyState *key = &state->skip_keys[i];
+
+		key->key_pos = -1;
+		for (int j = 0; j < state->num_all_keys; j++)
 		{
-			state->skip_key = &data[i];
-			break;
+			ScanKey data = &state->all_keys[j];
+
+			if (data->sk_flags == SK_ISNULL && data->sk_attno == key->sk_attno)
+			{
+				key->key_pos = j;
+				key->after_strategy = data->sk_strategy;
+				key->after_func = data->sk_func;
+				break;
+			}
 		}
+		if (key->key_pos < 0)
+			elog(ERROR, "ScanKey for skip qual not found");
+
+		fmgr_info(key->eq_funcid, &key->eq_func);
 	}
-	if (!state->skip_key)
-		elog(ERROR, "ScanKey for skip qual not found");
 }
 
-static bool
-has_nulls_first(SkipScanState *state)
+/*
+ * Update the scan key of the skip key according to its mode
+ */
+static void
+skip_key_set_mode(SkipScanState *state, SkipKeyState *key, SkipKeyMode mode)
 {
-	return state->nulls_first;
+	ScanKey skey = &state->all_keys[key->key_pos];
+
+	switch (mode)
+	{
+		case SKIP_KEY_EQ:
+			if (key->prev_is_null)
+			{
+				skey->sk_flags = SK_ISNULL | SK_SEARCHNULL;
+				skey->sk_argument = 0;
+			}
+			else
+			{
+				skey->sk_flags = 0;
+				skey->sk_strategy = BTEqualStrategyNumber;
+				skey->sk_func = key->eq_func;
+				skey->sk_argument = key->prev_datum;
+			}
+			break;
+
+		case SKIP_KEY_AFTER:
+			Assert(!key->prev_is_null);
+			skey->sk_flags = 0;
+			skey->sk_strategy = key->after_strategy;
+			skey->sk_func = key->after_func;
+			skey->sk_argument = key->prev_datum;
+			break;
+
+		case SKIP_KEY_NOT_NULL:
+			skey->sk_flags = SK_ISNULL | SK_SEARCHNOTNULL;
+			skey->sk_argument = 0;
+			break;
+
+		case SKIP_KEY_NULL:
+			skey->sk_flags = SK_ISNULL | SK_SEARCHNULL;
+			skey->sk_argument = 0;
+			break;
+
+		case SKIP_KEY_ANY:
+			break;
+	}
+
+	key->mode = mode;
+	state->needs_rescan = true;
 }
 
+/*
+ * Set up the first search, which does not restrict any of the skip keys
+ */
+static void
+skip_scan_search_first(SkipScanState *state)
+{
+	for (int i = 0; i < state->num_skip_keys; i++)
+		skip_key_set_mode(state, &state->skip_keys[i], SKIP_KEY_ANY);
+
+	state->level = -1;
+}
+
+/*
+ * Set up the search for values after the previous value of the skip key at
+ * the given level. The keys to the left of it stay on their previous values
+ * and the keys to the right of it do not restrict the search. Returns false
+ * if nothing can follow the previous value of the key.
+ */
 static bool
-has_nulls_last(SkipScanState *state)
+skip_scan_search_after(SkipScanState *state, int level)
 {
-	return !has_nulls_first(state);
+	SkipKeyState *key = &state->skip_keys[level];
+	SkipKeyMode mode;
+
+	if (!key->prev_is_null)
+		mode = SKIP_KEY_AFTER;
+	else if (key->nulls_first)
+		mode = SKIP_KEY_NOT_NULL;
+	else
+		return false;
+
+	for (int i = 0; i < level; i++)
+		skip_key_set_mode(state, &state->skip_keys[i], SKIP_KEY_EQ);
+	for (int i = level + 1; i < state->num_skip_keys; i++)
+		skip_key_set_mode(state, &state->skip_keys[i], SKIP_KEY_ANY);
+	skip_key_set_mode(state, key, mode);
+
+	state->level = level;
+	return true;
 }
 
-static void
-skip_scan_rescan_index(SkipScanState *state)
+/*
+ * Set up the next search advancing the skip key at the given level or, if
+ * nothing can follow that key, one of the keys to the left of it. Returns
+ * false if there is nothing left to search for.
+ */
+static bool
+skip_scan_search_next(SkipScanState *state, int level)
 {
-	/* if the scan in the child scan has not been
-	 * setup yet which is true before the first tuple
-	 * has been retrieved from child scan we cannot
-	 * trigger rescan but since the child scan
-	 * has not been initialized it will pick up
-	 * any ScanKey changes we did */
-	if (*state->scan_desc)
-		index_rescan(*state->scan_desc,
-					 *state->scan_keys,
-					 *state->num_scan_keys,
-					 NULL /*orderbys*/,
-					 0 /*norderbys*/);
-	state->needs_rescan = false;
+	for (; level >= 0; level--)
+	{
+		if (skip_scan_search_after(state, level))
+			return true;
+	}
+
+	return false;
 }
 
 /*
- * Update skip scankey flags according to stage
+ * Set up the next search after the current one found no tuples
  */
-static void
-skip_scan_switch_stage(SkipScanState *state, SkipScanStage new_stage)
+static bool
+skip_scan_search_failed(SkipScanState *state)
 {
-	Assert(new_stage > state->stage);
+	if (state->level < 0)
+		return false;
 
-	switch (new_stage)
+	SkipKeyState *key = &state->skip_keys[state->level];
+
+	/* with NULLS LAST the NULLs follow the values */
+	if (key->mode == SKIP_KEY_AFTER && !key->nulls_first)
 	{
-		case SS_NOT_NULL:
-			state->skip_key->sk_flags = SK_ISNULL | SK_SEARCHNOTNULL;
-			state->skip_key->sk_argument = 0;
-			state->needs_rescan = true;
-			break;
+		skip_key_set_mode(state, key, SKIP_KEY_NULL);
+		return true;
+	}
 
-		case SS_VALUES:
-			state->skip_key->sk_flags = 0;
-			state->needs_rescan = true;
-			break;
+	return skip_scan_search_next(state, state->level - 1);
+}
 
-		case SS_NULLS_LAST:
-		case SS_NULLS_FIRST:
-			state->skip_key->sk_flags = SK_ISNULL | SK_SEARCHNULL;
-			state->skip_key->sk_argument = 0;
-			state->needs_rescan = true;
-			break;
+static void
+skip_scan_end_index_scan(SkipScanState *state)
+{
+	if (IsA(state->idx, IndexOnlyScanState))
+	{
+		IndexOnlyScanState *idx = castNode(IndexOnlyScanState, state->idx);
 
-		case SS_BEGIN:
-		case SS_END:
-			break;
+		if (idx->ioss_VMBuffer != InvalidBuffer)
+		{
+			ReleaseBuffer(idx->ioss_VMBuffer);
+			idx->ioss_VMBuffer = InvalidBuffer;
+		}
 	}
 
-	state->stage = new_stage;
+	index_endscan(*state->scan_desc);
+	*state->scan_desc = NULL;
 }
 
 static void
-skip_scan_update_key(SkipScanState *state, TupleTableSlot *slot)
+skip_scan_rescan_index(SkipScanState *state)
 {
-	if (!state->prev_is_null && !state->distinct_by_val)
+	int num_keys = 0;
+
+	/*
+	 * The runtime keys are evaluated into the original scan keys when the
+	 * child scan is rescanned, so they have to be ready before we copy the
+	 * scan keys for the search.
+	 */
+	if (*state->num_runtime_keys != 0 && !*state->runtime_keys_ready)
+		ExecReScan(&state->idx->ps);
+
+	for (int i = 0; i < state->num_all_keys; i++)
 	{
-		Assert(state->stage == SS_VALUES);
-		pfree(DatumGetPointer(state->prev_datum));
+		bool unused = false;
+
+		for (int j = 0; j < state->num_skip_keys; j++)
+		{
+			if (state->skip_keys[j].key_pos == i)
+			{
+				unused = state->skip_keys[j].mode == SKIP_KEY_ANY;
+				break;
+			}
+		}
+
+		if (!unused)
+			state->search_keys[num_keys++] = state->all_keys[i];
 	}
 
+	/* the number of scan keys cannot change while the scan is running */
+	if (*state->scan_desc && num_keys != *state->num_scan_keys)
+		skip_scan_end_index_scan(state);
+
+	*state->scan_keys = state->search_keys;
+	*state->num_scan_keys = num_keys;
+
+	/* if the scan in the child scan has not been
+	 * setup yet which is true before the first tuple
+	 * has been retrieved from child scan or after we
+	 * ended it we cannot trigger rescan but since the
+	 * child scan has not been initialized it will pick
+	 * up any ScanKey changes we did */
+	if (*state->scan_desc)
+		index_rescan(*state->scan_desc,
+					 *state->scan_keys,
+					 *state->num_scan_keys,
+					 NULL /*orderbys*/,
+					 0 /*norderbys*/);
+	state->needs_rescan = false;
+}
+
+static void
+skip_scan_update_keys(SkipScanState *state, TupleTableSlot *slot)
+{
 	MemoryContext old_ctx = MemoryContextSwitchTo(state->ctx);
-	state->prev_datum = slot_getattr(slot, state->distinct_col_attnum, &state->prev_is_null);
-	if (state->prev_is_null)
-	{
-		state->skip_key->sk_flags = SK_ISNULL;
-		state->skip_key->sk_argument = 0;
-	}
-	else
+
+	for (int i = 0; i < state->num_skip_keys; i++)
 	{
-		state->prev_datum =
-			datumCopy(state->prev_datum, state->distinct_by_val, state->distinct_typ_len);
-		state->skip_key->sk_argument = state->prev_datum;
+		SkipKeyState *key = &state->skip_keys[i];
+
+		if (!key->prev_is_null && !key->distinct_by_val)
+			pfree(DatumGetPointer(key->prev_datum));
+
+		key->prev_datum = slot_getattr(slot, key->distinct_col_attnum, &key->prev_is_null);
+		if (key->prev_is_null)
+			key->prev_datum = 0;
+		else
+			key->prev_datum =
+				datumCopy(key->prev_datum, key->distinct_by_val, key->distinct_typ_len);
 	}
 
 	MemoryContextSwitchTo(old_ctx);
-
-	/* we need to do a rescan whenever we modify the ScanKey */
-	state->needs_rescan = true;
 }
 
 static TupleTableSlot *
@@ -259,64 +463,34 @@ skip_scan_exec(CustomScanState *node)
 		switch (state->stage)
 		{
 			case SS_BEGIN:
-				if (has_nulls_first(state))
-					skip_scan_switch_stage(state, SS_NULLS_FIRST);
-				else
-					skip_scan_switch_stage(state, SS_NOT_NULL);
-
-				break;
-
-			case SS_NULLS_FIRST:
-				result = state->idx->ps.ExecProcNode(&state->idx->ps);
-
-				/*
-				 * if we found a NULL value we return it, otherwise
-				 * we restart the scan looking for non-NULL
-				 */
-				skip_scan_switch_stage(state, SS_NOT_NULL);
-				if (!TupIsNull(result))
-					return result;
-
+				skip_scan_search_first(state);
+				state->stage = SS_SEARCH;
 				break;
 
-			case SS_NOT_NULL:
-			case SS_VALUES:
+			case SS_SEARCH:
 				result = state->idx->ps.ExecProcNode(&state->idx->ps);
 
 				if (!TupIsNull(result))
 				{
 					/*
-					 * if we found a tuple we update the skip scan key
-					 * and look for values greater than the value we just
-					 * found. If this is the first non-NULL value we
-					 * also switch stage to look for values greater than
-					 * that in subsequent calls.
+					 * if we found a tuple we update the skip keys
+					 * and look for distinct values after the ones we
+					 * just found, advancing the rightmost key first.
 					 */
-					if (state->stage == SS_NOT_NULL)
-						skip_scan_switch_stage(state, SS_VALUES);
+					skip_scan_update_keys(state, result);
+					if (!skip_scan_search_next(state, state->num_skip_keys - 1))
+						state->stage = SS_END;
 
-					skip_scan_update_key(state, result);
 					return result;
 				}
-				else
-				{
-					/*
-					 * if there are no more values that satisfy
-					 * the skip constraint we are either done
-					 * for NULLS FIRST ordering or need to check
-					 * for NULLs if we have NULLS LAST ordering
-					 */
-					if (has_nulls_last(state))
-						skip_scan_switch_stage(state, SS_NULLS_LAST);
-					else
-						skip_scan_switch_stage(state, SS_END);
-				}
-				break;
 
-			case SS_NULLS_LAST:
-				result = state->idx->ps.ExecProcNode(&state->idx->ps);
-				skip_scan_switch_stage(state, SS_END);
-				return result;
+				/*
+				 * if there are no more values that satisfy the
+				 * search we look for NULLs with NULLS LAST ordering
+				 * or advance the keys to the left
+				 */
+				if (!skip_scan_search_failed(state))
+					state->stage = SS_END;
 				break;
 
 			case SS_END:
@@ -337,20 +511,17 @@ static void
 skip_scan_rescan(CustomScanState *node)
 {
 	SkipScanState *state = (SkipScanState *) node;
-	/* reset stage so we can assert in skip_scan_switch_stage that stage always moves forward */
-	state->stage = SS_BEGIN;
 
-	/* Switching state here instead of in the main loop
-	 * means we dont have to call skip_scan_rescan_index
-	 * as ExecReScan on the child scan takes care of that. */
-	if (has_nulls_first(state))
-		skip_scan_switch_stage(state, SS_NULLS_FIRST);
-	else
-		skip_scan_switch_stage(state, SS_NOT_NULL);
+	state->stage = SS_BEGIN;
 
-	state->prev_is_null = true;
-	state->prev_datum = 0;
+	for (int i = 0; i < state->num_skip_keys; i++)
+	{
+		state->skip_keys[i].prev_is_null = true;
+		state->skip_keys[i].prev_datum = 0;
+	}
 
+	/* ExecReScan on the child scan evaluates its runtime keys, the
+	 * search keys are updated when we set up the first search. */
 	state->needs_rescan = false;
 	ExecReScan(&state->idx->ps);
 	MemoryContextReset(state->ctx);
@@ -368,17 +539,31 @@ Node *
 tsl_skip_scan_state_create(CustomScan *cscan)
 {
 	SkipScanState *state = (SkipScanState *) newNode(sizeof(SkipScanState), T_CustomScanState);
+	List *attnums = linitial(cscan->custom_private);
+	List *by_vals = lsecond(cscan->custom_private);
+	List *typ_lens = lthird(cscan->custom_private);
+	List *nulls_first = lfourth(cscan->custom_private);
+	List *sk_attnos = list_nth(cscan->custom_private, 4);
+	List *eq_funcids = list_nth(cscan->custom_private, 6);
 
 	state->idx_scan = linitial(cscan->custom_plans);
 	state->stage = SS_BEGIN;
 
-	state->distinct_col_attnum = linitial_int(cscan->custom_private);
-	state->distinct_by_val = lsecond_int(cscan->custom_private);
-	state->distinct_typ_len = lthird_int(cscan->custom_private);
-	state->nulls_first = lfourth_int(cscan->custom_private);
-	state->sk_attno = list_nth_int(cscan->custom_private, 4);
+	state->num_skip_keys = list_length(attnums);
+	state->skip_keys = palloc0(sizeof(SkipKeyState) * state->num_skip_keys);
+	for (int i = 0; i < state->num_skip_keys; i++)
+	{
+		SkipKeyState *key = &state->skip_keys[i];
+
+		key->distinct_col_attnum = list_nth_int(attnums, i);
+		key->distinct_by_val = list_nth_int(by_vals, i);
+		key->distinct_typ_len = list_nth_int(typ_lens, i);
+		key->nulls_first = list_nth_int(nulls_first, i);
+		key->sk_attno = list_nth_int(sk_attnos, i);
+		key->eq_funcid = list_nth_oid(eq_funcids, i);
+		key->prev_is_null = true;
+	}
 
-	state->prev_is_null = true;
 	state->cscan_state.methods = &skip_scan_state_methods;
 	return (Node *) state;
 }
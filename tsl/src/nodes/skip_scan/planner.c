@@ -26,21 +26,23 @@
 #include <utils/typcache.h>
 
 #include "compat/compat.h"
+#include "compression/compression.h"
 #include "guc.h"
 #include "nodes/chunk_append/chunk_append.h"
 #include "nodes/constraint_aware_append/constraint_aware_append.h"
+#include "nodes/decompress_chunk/decompress_chunk.h"
 #include "nodes/skip_scan/skip_scan.h"
 #include <import/planner.h>
 
 #include <math.h>
 
-typedef struct SkipScanPath
+/* One of the distinct columns the SkipScan skips over */
+typedef struct SkipScanKey
 {
-	CustomPath cpath;
-	IndexPath *index_path;
-
 	/* Index clause which we'll use to skip past elements we've already seen */
 	RestrictInfo *skip_clause;
+	/* Function of the equality operator to stay on an element we've seen */
+	Oid eq_funcid;
 	/* attribute number of the distinct column on the table/chunk */
 	AttrNumber distinct_attno;
 	/* The column offset on the index we are calling DISTINCT on */
@@ -49,24 +51,33 @@ typedef struct SkipScanPath
 	bool distinct_by_val;
 	/* Var referencing the distinct column on the relation */
 	Var *distinct_var;
+} SkipScanKey;
+
+typedef struct SkipScanPath
+{
+	CustomPath cpath;
+	IndexPath *index_path;
+
+	/* SkipScanKeys of the distinct columns in the order of the index columns */
+	List *skip_keys;
 } SkipScanPath;
 
 typedef struct DistinctPathInfo
 {
 	UpperRelationKind stage; /* What kind of Upper distinct path we are dealing with */
 	Path *unique_path;		 /* If not NULL, valid Upper distinct path */
-	Expr *distinct_expr;	 /* If not NULL, valid distinct expression for Upper distinct path */
+	List *distinct_exprs;	 /* If not NIL, valid distinct expressions for Upper distinct path */
 } DistinctPathInfo;
 
 static int get_idx_key(IndexOptInfo *idxinfo, AttrNumber attno);
 static List *sort_indexquals(IndexOptInfo *indexinfo, List *quals);
 static OpExpr *fix_indexqual(IndexOptInfo *index, RestrictInfo *rinfo, AttrNumber scankey_attno);
-static bool build_skip_qual(PlannerInfo *root, SkipScanPath *skip_scan_path, IndexPath *index_path,
-							Var *var);
+static SkipScanKey *build_skip_key(PlannerInfo *root, IndexPath *index_path, Var *var);
 static List *build_subpath(PlannerInfo *root, List *subpaths, DistinctPathInfo *dpinfo,
 						   List *top_pathkeys);
-static Var *get_distinct_var(PlannerInfo *root, DistinctPathInfo *dpinfo, IndexPath *index_path,
-							 SkipScanPath *skip_scan_path);
+static Var *get_distinct_var(PlannerInfo *root, Expr *tlexpr, RelOptInfo *rel);
+static Path *skip_scan_decompress_path_create(PlannerInfo *root, DecompressChunkPath *dcpath,
+											  DistinctPathInfo *dpinfo);
 static TargetEntry *tlist_member_match_var(Var *var, List *targetlist);
 
 /**************************
@@ -91,8 +102,25 @@ skip_scan_plan_create(PlannerInfo *root, RelOptInfo *relopt, CustomPath *best_pa
 	SkipScanPath *path = (SkipScanPath *) best_path;
 	CustomScan *skip_plan = makeNode(CustomScan);
 	IndexPath *index_path = path->index_path;
+	List *skip_quals = NIL;
+	List *resnos = NIL;
+	List *by_vals = NIL;
+	List *typ_lens = NIL;
+	List *nulls_firsts = NIL;
+	List *scankey_attnos = NIL;
+	List *distinct_attnos = NIL;
+	List *eq_funcids = NIL;
+	ListCell *lc;
 
-	OpExpr *op = fix_indexqual(index_path->indexinfo, path->skip_clause, path->scankey_attno);
+	foreach (lc, path->skip_keys)
+	{
+		SkipScanKey *key = lfirst(lc);
+
+		skip_quals = lappend(skip_quals,
+							 fix_indexqual(index_path->indexinfo,
+										   key->skip_clause,
+										   key->scankey_attno));
+	}
 
 	Plan *plan = linitial(custom_plans);
 	if (IsA(plan, IndexScan))
@@ -100,17 +128,19 @@ skip_scan_plan_create(PlannerInfo *root, RelOptInfo *relopt, CustomPath *best_pa
 		IndexScan *idx_plan = castNode(IndexScan, plan);
 		skip_plan->scan = idx_plan->scan;
 
-		/* we prepend skip qual here so sort_indexquals will put it as first qual for that column */
+		/* we prepend skip quals here so sort_indexquals will put them as first qual for their
+		 * column */
 		idx_plan->indexqual =
-			sort_indexquals(index_path->indexinfo, lcons(op, idx_plan->indexqual));
+			sort_indexquals(index_path->indexinfo, list_concat(skip_quals, idx_plan->indexqual));
 	}
 	else if (IsA(plan, IndexOnlyScan))
 	{
 		IndexOnlyScan *idx_plan = castNode(IndexOnlyScan, plan);
 		skip_plan->scan = idx_plan->scan;
-		/* we prepend skip qual here so sort_indexquals will put it as first qual for that column */
+		/* we prepend skip quals here so sort_indexquals will put them as first qual for their
+		 * column */
 		idx_plan->indexqual =
-			sort_indexquals(index_path->indexinfo, lcons(op, idx_plan->indexqual));
+			sort_indexquals(index_path->indexinfo, list_concat(skip_quals, idx_plan->indexqual));
 	}
 	else
 		elog(ERROR, "unsupported subplan type for SkipScan: %s", ts_get_node_name((Node *) plan));
@@ -121,21 +151,80 @@ skip_scan_plan_create(PlannerInfo *root, RelOptInfo *relopt, CustomPath *best_pa
 	skip_plan->scan.plan.type = T_CustomScan;
 	skip_plan->methods = &skip_scan_plan_methods;
 	skip_plan->custom_plans = custom_plans;
-	/* get position of skipped column in tuples produced by child scan */
-	TargetEntry *tle = tlist_member_match_var(path->distinct_var, plan->targetlist);
 
-	bool nulls_first = index_path->indexinfo->nulls_first[path->scankey_attno - 1];
-	if (index_path->indexscandir == BackwardScanDirection)
-		nulls_first = !nulls_first;
+	foreach (lc, path->skip_keys)
+	{
+		SkipScanKey *key = lfirst(lc);
+
+		/* get position of skipped column in tuples produced by child scan */
+		TargetEntry *tle = tlist_member_match_var(key->distinct_var, plan->targetlist);
+
+		bool nulls_first = index_path->indexinfo->nulls_first[key->scankey_attno - 1];
+		if (index_path->indexscandir == BackwardScanDirection)
+			nulls_first = !nulls_first;
+
+		resnos = lappend_int(resnos, tle->resno);
+		by_vals = lappend_int(by_vals, key->distinct_by_val);
+		typ_lens = lappend_int(typ_lens, key->distinct_typ_len);
+		nulls_firsts = lappend_int(nulls_firsts, nulls_first);
+		scankey_attnos = lappend_int(scankey_attnos, key->scankey_attno);
+		/* attribute number of the distinct column for tsl_skip_scan_set_targetlist */
+		distinct_attnos = lappend_int(distinct_attnos, key->distinct_attno);
+		eq_funcids = lappend_oid(eq_funcids, key->eq_funcid);
+	}
 
-	skip_plan->custom_private = list_make5_int(tle->resno,
-											   path->distinct_by_val,
-											   path->distinct_typ_len,
-											   nulls_first,
-											   path->scankey_attno);
+	/* one list per property of the skip keys, in the order of the index columns */
+	skip_plan->custom_private =
+		list_make5(resnos, by_vals, typ_lens, nulls_firsts, scankey_attnos);
+	skip_plan->custom_private = lappend(skip_plan->custom_private, distinct_attnos);
+	skip_plan->custom_private = lappend(skip_plan->custom_private, eq_funcids);
 	return &skip_plan->scan.plan;
 }
 
+/*
+ * Replace the targetlist of a SkipScan plan and its child scan.
+ *
+ * This is used by DecompressChunk, which sets the targetlist of its
+ * compressed scan after the child plans are created. SkipScan passes the
+ * tuples of the child scan through, so both need the same targetlist and
+ * the positions of the distinct columns have to be looked up again.
+ */
+void
+tsl_skip_scan_set_targetlist(CustomScan *skip_plan, List *tlist)
+{
+	Plan *child = linitial(skip_plan->custom_plans);
+	List *resnos = linitial(skip_plan->custom_private);
+	List *distinct_attnos = list_nth(skip_plan->custom_private, 5);
+	ListCell *lc_resno, *lc_attno;
+
+	Assert(skip_plan->methods == &skip_scan_plan_methods);
+
+	child->targetlist = tlist;
+	skip_plan->scan.plan.targetlist = tlist;
+	skip_plan->custom_scan_tlist = list_copy(tlist);
+
+	forboth (lc_resno, resnos, lc_attno, distinct_attnos)
+	{
+		AttrNumber distinct_attno = lfirst_int(lc_attno);
+		ListCell *lc;
+
+		lfirst_int(lc_resno) = InvalidAttrNumber;
+		foreach (lc, tlist)
+		{
+			TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+			if (IsA(tle->expr, Var) && castNode(Var, tle->expr)->varattno == distinct_attno)
+			{
+				lfirst_int(lc_resno) = tle->resno;
+				break;
+			}
+		}
+
+		if (lfirst_int(lc_resno) == InvalidAttrNumber)
+			elog(ERROR, "distinct column not found in the targetlist of SkipScan");
+	}
+}
+
 /*************************
  * SkipScanPath Creation *
  *************************/
@@ -144,6 +233,13 @@ static CustomPathMethods skip_scan_path_methods = {
 	.PlanCustomPath = skip_scan_plan_create,
 };
 
+bool
+tsl_is_skip_scan_path(Path *path)
+{
+	return IsA(path, CustomPath) &&
+		   castNode(CustomPath, path)->methods == &skip_scan_path_methods;
+}
+
 #if PG16_GE
 typedef struct FindAggrefsContext
 {
@@ -165,15 +261,14 @@ find_aggrefs_walker(Node *node, FindAggrefsContext *context)
 	return expression_tree_walker(node, find_aggrefs_walker, context);
 }
 #endif
-/* We can get upper path Distinct expression once for upper path,
+/* We can get upper path Distinct expressions once for upper path,
  * rather than repeat this check for each child path of an upper path input
  */
-static Expr *
-get_upper_distinct_expr(PlannerInfo *root, UpperRelationKind stage)
+static List *
+get_upper_distinct_exprs(PlannerInfo *root, UpperRelationKind stage)
 {
 	ListCell *lc;
-	int num_vars = 0;
-	Expr *tlexpr = NULL;
+	List *exprs = NIL;
 
 	if (stage == UPPERREL_DISTINCT && root->parse->distinctClause)
 	{
@@ -187,14 +282,15 @@ get_upper_distinct_expr(PlannerInfo *root, UpperRelationKind stage)
 			if (IsA(estimate_expression_value(root, expr), Const))
 				continue;
 
-			num_vars++;
-			if (num_vars > 1)
-				return NULL;
-
 			/* We ignore binary-compatible relabeling */
-			tlexpr = (Expr *) expr;
-			while (tlexpr && IsA(tlexpr, RelabelType))
-				tlexpr = ((RelabelType *) tlexpr)->arg;
+			while (expr && IsA(expr, RelabelType))
+				expr = (Node *) ((RelabelType *) expr)->arg;
+
+			/* SkipScan on expressions not supported */
+			if (!expr || !IsA(expr, Var))
+				return NIL;
+
+			exprs = lappend(exprs, expr);
 		}
 	}
 #if PG16_GE
@@ -202,6 +298,7 @@ get_upper_distinct_expr(PlannerInfo *root, UpperRelationKind stage)
 	{
 		/* Find all non-nested Aggrefs in the query target list */
 		FindAggrefsContext agg_ctx = { NULL };
+		Expr *tlexpr = NULL;
 		find_aggrefs_walker((Node *) root->parse->targetList, &agg_ctx);
 
 		foreach (lc, agg_ctx.aggrefs)
@@ -223,11 +320,11 @@ get_upper_distinct_expr(PlannerInfo *root, UpperRelationKind stage)
 
 				/* Don't support no-var arguments */
 				if (!IsA(expr, Var))
-					return NULL;
+					return NIL;
 
 				/* Don't support multiple distinct aggs over different columns */
 				if (tlexpr && !tlist_member_match_var((Var *) tlexpr, agg->args))
-					return NULL;
+					return NIL;
 
 				/* If Distinct agg path has a groupby column, it needs to match Distinct agg column
 				 */
@@ -239,30 +336,24 @@ get_upper_distinct_expr(PlannerInfo *root, UpperRelationKind stage)
 						(SortGroupClause *) linitial(root->processed_groupClause);
 					Expr *gbykey = (Expr *) get_sortgroupclause_expr(sortcl, root->processed_tlist);
 					if (!equal(gbykey, expr))
-						return NULL;
+						return NIL;
 				}
 				/* Found a valid distinct agg over a valid Var */
 				if (!tlexpr)
 				{
 					tlexpr = expr;
-					num_vars = 1;
+					exprs = list_make1(tlexpr);
 				}
 			}
 			else
 			{
-				return NULL;
+				return NIL;
 			}
 		}
 	}
 #endif
-	if (num_vars != 1)
-		return NULL;
-
-	/* SkipScan on expressions not supported */
-	if (!tlexpr || !IsA(tlexpr, Var))
-		return NULL;
 
-	return tlexpr;
+	return exprs;
 }
 
 static void
@@ -287,16 +378,13 @@ obtain_upper_distinct_path(PlannerInfo *root, RelOptInfo *output_rel, DistinctPa
 			{
 				UpperUniquePath *unique = (UpperUniquePath *) lfirst_node(UpperUniquePath, lc);
 
-				/* currently we do not handle DISTINCT on more than one key. To do so,
-				 * we would need to break down the SkipScan into subproblems: first
-				 * find the minimal tuple then for each prefix find all unique suffix
-				 * tuples. For instance, if we are searching over (int, int), we would
-				 * first find (0, 0) then find (0, N) for all N in the domain, then
-				 * find (1, N), then (2, N), etc
+				/* DISTINCT on more than one key is broken down by the SkipScan
+				 * into subproblems: first find the minimal tuple then for each
+				 * prefix find all unique suffix tuples. For instance, if we are
+				 * searching over (int, int), we first find (0, 0) then find
+				 * (0, N) for all N in the domain, then find (1, N), then (2, N),
+				 * etc
 				 */
-				if (unique->numkeys > 1)
-					return;
-
 				dpinfo->unique_path = (Path *) unique;
 				break;
 			}
@@ -341,9 +429,9 @@ obtain_upper_distinct_path(PlannerInfo *root, RelOptInfo *output_rel, DistinctPa
 	if (!dpinfo->unique_path)
 		return;
 
-	/* Check if we have valid distinct expression to source from the underlying index */
-	dpinfo->distinct_expr = get_upper_distinct_expr(root, dpinfo->stage);
-	if (!dpinfo->distinct_expr)
+	/* Check if we have valid distinct expressions to source from the underlying index */
+	dpinfo->distinct_exprs = get_upper_distinct_exprs(root, dpinfo->stage);
+	if (dpinfo->distinct_exprs == NIL)
 	{
 		dpinfo->unique_path = NULL;
 		return;
@@ -371,6 +459,8 @@ obtain_upper_distinct_path(PlannerInfo *root, RelOptInfo *output_rel, DistinctPa
 
 static SkipScanPath *skip_scan_path_create(PlannerInfo *root, IndexPath *index_path,
 										   DistinctPathInfo *dpinfo);
+static SkipScanPath *skip_scan_path_create_for_vars(PlannerInfo *root, IndexPath *index_path,
+													DistinctPathInfo *dpinfo, List *vars);
 
 /*
  * Create SkipScan paths based on existing Unique paths.
@@ -407,7 +497,7 @@ void
 tsl_skip_scan_paths_add(PlannerInfo *root, RelOptInfo *input_rel, RelOptInfo *output_rel,
 						UpperRelationKind stage)
 {
-	DistinctPathInfo dpinfo = { stage, NULL, NULL };
+	DistinctPathInfo dpinfo = { stage, NULL, NIL };
 	obtain_upper_distinct_path(root, output_rel, &dpinfo);
 	if (!dpinfo.unique_path)
 		return;
@@ -471,6 +561,14 @@ tsl_skip_scan_paths_add(PlannerInfo *root, RelOptInfo *input_rel, RelOptInfo *ou
 			if (!subpath)
 				continue;
 		}
+		else if (ts_is_decompress_chunk_path(subpath))
+		{
+			DecompressChunkPath *dcpath = (DecompressChunkPath *) subpath;
+
+			subpath = skip_scan_decompress_path_create(root, dcpath, &dpinfo);
+			if (!subpath)
+				continue;
+		}
 		else if (IsA(subpath, MergeAppendPath))
 		{
 			MergeAppendPath *merge_path = castNode(MergeAppendPath, subpath);
@@ -591,6 +689,39 @@ tsl_skip_scan_paths_add(PlannerInfo *root, RelOptInfo *input_rel, RelOptInfo *ou
 
 static SkipScanPath *
 skip_scan_path_create(PlannerInfo *root, IndexPath *index_path, DistinctPathInfo *dpinfo)
+{
+	List *vars = NIL;
+	ListCell *lc;
+
+	foreach (lc, dpinfo->distinct_exprs)
+	{
+		Var *var = get_distinct_var(root, lfirst(lc), index_path->path.parent);
+
+		if (!var)
+			return NULL;
+
+		vars = lappend(vars, var);
+	}
+
+	return skip_scan_path_create_for_vars(root, index_path, dpinfo, vars);
+}
+
+static int
+skip_scan_key_cmp(const ListCell *a, const ListCell *b)
+{
+	const SkipScanKey *key_a = lfirst(a);
+	const SkipScanKey *key_b = lfirst(b);
+
+	return key_a->scankey_attno - key_b->scankey_attno;
+}
+
+/*
+ * Create a SkipScanPath over an IndexPath for the distinct columns referenced
+ * by vars, which have to be Vars of the relation scanned by the index.
+ */
+static SkipScanPath *
+skip_scan_path_create_for_vars(PlannerInfo *root, IndexPath *index_path, DistinctPathInfo *dpinfo,
+							   List *vars)
 {
 	double startup = index_path->path.startup_cost;
 	double total = index_path->path.total_cost;
@@ -636,28 +767,28 @@ skip_scan_path_create(PlannerInfo *root, IndexPath *index_path, DistinctPathInfo
 	 * free so reusing the IndexPath here is safe. */
 	skip_scan_path->index_path = index_path;
 
-	Var *var = get_distinct_var(root, dpinfo, index_path, skip_scan_path);
+	ListCell *lc;
+	foreach (lc, vars)
+	{
+		/* build skip qual this may fail if we cannot look up the operator */
+		SkipScanKey *key = build_skip_key(root, index_path, lfirst_node(Var, lc));
 
-	if (!var)
-		return NULL;
+		if (!key)
+			return NULL;
 
-	skip_scan_path->distinct_var = var;
+		skip_scan_path->skip_keys = lappend(skip_scan_path->skip_keys, key);
+	}
 
-	/* build skip qual this may fail if we cannot look up the operator */
-	if (!build_skip_qual(root, skip_scan_path, index_path, var))
-		return NULL;
+	/* the SkipScan advances the skip keys in the order of the index columns */
+	list_sort(skip_scan_path->skip_keys, skip_scan_key_cmp);
 
 	return skip_scan_path;
 }
 
 /* Extract the Var to use for the SkipScan and do attno mapping if required. */
 static Var *
-get_distinct_var(PlannerInfo *root, DistinctPathInfo *dpinfo, IndexPath *index_path,
-				 SkipScanPath *skip_scan_path)
+get_distinct_var(PlannerInfo *root, Expr *tlexpr, RelOptInfo *rel)
 {
-	RelOptInfo *rel = index_path->path.parent;
-	Expr *tlexpr = dpinfo->distinct_expr;
-
 	if (!tlexpr || !IsA(tlexpr, Var))
 		return NULL;
 
@@ -719,7 +850,135 @@ get_distinct_var(PlannerInfo *root, DistinctPathInfo *dpinfo, IndexPath *index_p
 }
 
 /*
- * Creates SkipScanPath for each path of subpaths that is an IndexPath
+ * Map a distinct column to the compressed chunk. SkipScan over a compressed
+ * scan is only possible on segmentby columns, because only those are stored
+ * uncompressed and covered by the index of the compressed chunk.
+ */
+static Var *
+get_compressed_distinct_var(PlannerInfo *root, Expr *tlexpr, const CompressionInfo *info)
+{
+	Var *var = get_distinct_var(root, tlexpr, info->chunk_rel);
+
+	if (!var || !bms_is_member(var->varattno, info->chunk_segmentby_attnos))
+		return NULL;
+
+	char *attname = get_attname(info->chunk_rte->relid, var->varattno, false);
+	AttrNumber compressed_attno = get_attnum(info->compressed_rte->relid, attname);
+
+	if (compressed_attno == InvalidAttrNumber)
+		return NULL;
+
+	var = copyObject(var);
+	var->varno = info->compressed_rel->relid;
+	var->varattno = compressed_attno;
+
+	return var;
+}
+
+/*
+ * Check that all the filters of the decompressed chunk reference only
+ * segmentby columns. Such filters either pass or reject all the rows of
+ * all the batches of a segment, so skipping all batches but the first one
+ * of a segment cannot skip any rows that would pass the filters.
+ */
+static bool
+has_only_segmentby_filters(const CompressionInfo *info)
+{
+	ListCell *lc;
+
+	foreach (lc, info->chunk_rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		Bitmapset *attnos = NULL;
+		int i = -1;
+
+		pull_varattnos((Node *) rinfo->clause, info->chunk_rel->relid, &attnos);
+
+		while ((i = bms_next_member(attnos, i)) >= 0)
+		{
+			AttrNumber attno = i + FirstLowInvalidHeapAttributeNumber;
+
+			if (!bms_is_member(attno, info->chunk_segmentby_attnos))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Create a DecompressChunk path that decompresses only the first batch of
+ * every distinct segment, e.g. for the latest row per segmentby value:
+ *
+ *  Unique
+ *    ->  Custom Scan (DecompressChunk) on _hyper_1_1_chunk
+ *          ->  Custom Scan (SkipScan) on compress_hyper_2_2_chunk
+ *                ->  Index Scan using compress_hyper_2_2_chunk_idx on compress_hyper_2_2_chunk
+ *
+ * The SkipScan runs over the index of the compressed chunk and skips to the
+ * next segmentby value after the first batch of a segment. This is only
+ * correct if the compressed scan returns the batches in the order required
+ * by DecompressChunk, so the first batch of a segment contains its first
+ * decompressed rows, i.e. the batches are ordered by the orderby metadata
+ * or sequence number and are not merged by a batch sorted merge.
+ *
+ * Returns NULL if a SkipScan is not applicable to the path.
+ */
+static Path *
+skip_scan_decompress_path_create(PlannerInfo *root, DecompressChunkPath *dcpath,
+								 DistinctPathInfo *dpinfo)
+{
+	const CompressionInfo *info = dcpath->info;
+	Path *compressed_path = linitial(dcpath->custom_path.custom_paths);
+
+	if (!ts_guc_enable_compressed_skip_scan)
+		return NULL;
+
+	if (dcpath->batch_sorted_merge || dcpath->custom_path.path.param_info != NULL ||
+		!IsA(compressed_path, IndexPath))
+		return NULL;
+
+	if (!pathkeys_contained_in(dcpath->required_compressed_pathkeys, compressed_path->pathkeys))
+		return NULL;
+
+	if (!has_only_segmentby_filters(info))
+		return NULL;
+
+	List *vars = NIL;
+	ListCell *lc;
+	foreach (lc, dpinfo->distinct_exprs)
+	{
+		Var *var = get_compressed_distinct_var(root, lfirst(lc), info);
+
+		if (!var)
+			return NULL;
+
+		vars = lappend(vars, var);
+	}
+
+	SkipScanPath *skip_path =
+		skip_scan_path_create_for_vars(root, castNode(IndexPath, compressed_path), dpinfo, vars);
+	if (!skip_path)
+		return NULL;
+
+	DecompressChunkPath *new_path = copy_decompress_chunk_path(dcpath);
+	Path *path = &new_path->custom_path.path;
+
+	new_path->custom_path.custom_paths = list_make1(skip_path);
+
+	/* We decompress one batch per distinct value */
+	path->rows = skip_path->cpath.path.rows * new_path->info->rows_per_batch;
+	path->startup_cost = skip_path->cpath.path.startup_cost;
+	path->total_cost =
+		skip_path->cpath.path.total_cost +
+		path->rows * (cpu_tuple_cost + new_path->info->decompression_cost_per_row);
+
+	return path;
+}
+
+/*
+ * Creates SkipScanPath for each path of subpaths that is an IndexPath or a
+ * DecompressChunkPath over an IndexPath on the compressed chunk
  * If no subpath can be changed to SkipScanPath returns NULL
  * otherwise returns list of new paths
  */
@@ -748,6 +1007,20 @@ build_subpath(PlannerInfo *root, List *subpaths, DistinctPathInfo *dpinfo, List
 				has_skip_path = true;
 			}
 		}
+		else if (ts_is_decompress_chunk_path(child))
+		{
+			if (top_pathkeys && !pathkeys_contained_in(top_pathkeys, child->pathkeys))
+				continue;
+
+			Path *skip_path =
+				skip_scan_decompress_path_create(root, (DecompressChunkPath *) child, dpinfo);
+
+			if (skip_path)
+			{
+				child = skip_path;
+				has_skip_path = true;
+			}
+		}
 
 		new_paths = lappend(new_paths, child);
 	}
@@ -761,8 +1034,8 @@ build_subpath(PlannerInfo *root, List *subpaths, DistinctPathInfo *dpinfo, List
 	return new_paths;
 }
 
-static bool
-build_skip_qual(PlannerInfo *root, SkipScanPath *skip_scan_path, IndexPath *index_path, Var *var)
+static SkipScanKey *
+build_skip_key(PlannerInfo *root, IndexPath *index_path, Var *var)
 {
 	IndexOptInfo *info = index_path->indexinfo;
 	Oid column_type = exprType((Node *) var);
@@ -787,13 +1060,15 @@ build_skip_qual(PlannerInfo *root, SkipScanPath *skip_scan_path, IndexPath *inde
 	 */
 	int idx_key = get_idx_key(info, var->varattno);
 	if (idx_key < 0)
-		return false;
+		return NULL;
 
-	skip_scan_path->distinct_attno = var->varattno;
-	skip_scan_path->distinct_by_val = tce->typbyval;
-	skip_scan_path->distinct_typ_len = tce->typlen;
+	SkipScanKey *key = palloc0(sizeof(SkipScanKey));
+	key->distinct_var = var;
+	key->distinct_attno = var->varattno;
+	key->distinct_by_val = tce->typbyval;
+	key->distinct_typ_len = tce->typlen;
 	/* sk_attno of the skip qual */
-	skip_scan_path->scankey_attno = idx_key + 1;
+	key->scankey_attno = idx_key + 1;
 
 	int16 strategy = info->reverse_sort[idx_key] ? BTLessStrategyNumber : BTGreaterStrategyNumber;
 	if (index_path->indexscandir == BackwardScanDirection)
@@ -815,13 +1090,22 @@ build_skip_qual(PlannerInfo *root, SkipScanPath *skip_scan_path, IndexPath *inde
 			comparator =
 				get_opfamily_member(info->sortopfamily[idx_key], opcintype, opcintype, strategy);
 			if (!OidIsValid(comparator))
-				return false;
+				return NULL;
 			need_coerce = true;
 		}
 		else
-			return false; /* cannot use this index */
+			return NULL; /* cannot use this index */
 	}
 
+	/* The equality operator keeps the skip key on a previous value while the
+	 * SkipScan advances the keys of the following index columns. */
+	Oid eq_type = need_coerce ? opcintype : column_type;
+	Oid eq_op =
+		get_opfamily_member(info->sortopfamily[idx_key], eq_type, eq_type, BTEqualStrategyNumber);
+	if (!OidIsValid(eq_op))
+		return NULL;
+	key->eq_funcid = get_opcode(eq_op);
+
 	Const *prev_val = makeNullConst(need_coerce ? opcintype : column_type, -1, column_collation);
 	Expr *current_val = (Expr *) makeVar(info->rel->relid /*varno*/,
 										 var->varattno /*varattno*/,
@@ -851,9 +1135,9 @@ build_skip_qual(PlannerInfo *root, SkipScanPath *skip_scan_path, IndexPath *inde
 										  info->indexcollations[idx_key] /*inputcollid*/);
 	set_opfuncid(castNode(OpExpr, comparison_expr));
 
-	skip_scan_path->skip_clause = make_simple_restrictinfo(root, comparison_expr);
+	key->skip_clause = make_simple_restrictinfo(root, comparison_expr);
 
-	return true;
+	return key;
 }
 
 static int
@@ -11,4 +11,6 @@
 extern void tsl_skip_scan_paths_add(PlannerInfo *root, RelOptInfo *input_rel,
 									RelOptInfo *output_rel, UpperRelationKind stage);
 extern Node *tsl_skip_scan_state_create(CustomScan *cscan);
+extern bool tsl_is_skip_scan_path(Path *path);
+extern void tsl_skip_scan_set_targetlist(CustomScan *skip_plan, List *tlist);
 extern void _skip_scan_init(void);
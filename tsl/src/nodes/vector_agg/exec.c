@@ -6,6 +6,7 @@
 
 #include <postgres.h>
 
+#include <access/sysattr.h>
 #include <commands/explain.h>
 #include <executor/executor.h>
 #include <executor/tuptable.h>
@@ -14,10 +15,16 @@
 #include <nodes/nodeFuncs.h>
 #include <nodes/pg_list.h>
 #include <optimizer/optimizer.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
 
 #include "nodes/vector_agg/exec.h"
 
+#include "chunk.h"
+#include "compressed_scan_stats.h"
 #include "compression/arrow_c_data_interface.h"
+#include "guc.h"
 #include "hypercore/arrow_tts.h"
 #include "hypercore/vector_quals.h"
 #include "nodes/columnar_scan/columnar_scan.h"
@@ -25,7 +32,19 @@
 #include "nodes/decompress_chunk/exec.h"
 #include "nodes/decompress_chunk/vector_quals.h"
 #include "nodes/vector_agg.h"
+#include "nodes/vector_agg/heap_batch.h"
 #include "nodes/vector_agg/plan.h"
+#include "nodes/vector_agg/vector_slot.h"
+
+/*
+ * Whether the child node is a plain scan of an uncompressed heap relation. We
+ * build the batches from its tuples ourselves.
+ */
+static inline bool
+is_heap_scan_state(const CustomScanState *state)
+{
+	return !IsA(state->ss.ps.plan, CustomScan);
+}
 
 static int
 get_input_offset_decompress_chunk(const DecompressChunkState *decompress_state, const Var *var)
@@ -61,6 +80,62 @@ get_input_offset_decompress_chunk(const DecompressChunkState *decompress_state,
 	return index;
 }
 
+/*
+ * Let DecompressChunk read the batch min/max metadata instead of decompressing
+ * the columns that are only used as arguments of min() and max(). This is
+ * possible for the batches that entirely pass the vectorized quals, the other
+ * batches are decompressed as usual.
+ */
+static void
+use_minmax_metadata_decompress_chunk(DecompressChunkState *decompress_state,
+									 VectorAggState *vector_agg_state)
+{
+	DecompressContext *dcontext = &decompress_state->decompress_context;
+
+	/*
+	 * The FILTER clauses and the argument expressions can reference any
+	 * column, so don't bother looking into them.
+	 */
+	for (int i = 0; i < vector_agg_state->num_agg_defs; i++)
+	{
+		const VectorAggDef *def = &vector_agg_state->agg_defs[i];
+		if (def->filter_clauses != NIL || def->argument_expr != NULL)
+		{
+			return;
+		}
+	}
+
+	for (int column_index = 0; column_index < dcontext->num_data_columns; column_index++)
+	{
+		CompressionColumnDescription *column = &dcontext->compressed_chunk_columns[column_index];
+		if (column->type != COMPRESSED_COLUMN || !column->by_value ||
+			column->min_metadata_attno == InvalidAttrNumber ||
+			column->max_metadata_attno == InvalidAttrNumber)
+		{
+			continue;
+		}
+
+		bool only_minmax = true;
+		bool have_minmax = false;
+		for (int i = 0; i < vector_agg_state->num_agg_defs; i++)
+		{
+			const VectorAggDef *def = &vector_agg_state->agg_defs[i];
+			if (def->input_offset == column_index || def->second_input_offset == column_index)
+			{
+				have_minmax = true;
+				only_minmax &= def->func.batch_metadata != VAMD_None;
+			}
+		}
+
+		for (int i = 0; i < vector_agg_state->num_grouping_columns; i++)
+		{
+			only_minmax &= vector_agg_state->grouping_columns[i].input_offset != column_index;
+		}
+
+		column->use_minmax_metadata = have_minmax && only_minmax;
+	}
+}
+
 static void
 get_column_storage_properties_decompress_chunk(const DecompressChunkState *state, int input_offset,
 											   GroupingColumn *result)
@@ -75,14 +150,14 @@ get_column_storage_properties_decompress_chunk(const DecompressChunkState *state
  * Given a Var reference, get the offset of the corresponding attribute in the
  * input tuple.
  *
- * For a node returning arrow slots, this is just the attribute number in the
- * Var. But if the node is DecompressChunk, it is necessary to translate
- * between the compressed and non-compressed columns.
+ * For a node returning arrow slots or a heap scan, this is just the attribute
+ * number in the Var. But if the node is DecompressChunk, it is necessary to
+ * translate between the compressed and non-compressed columns.
  */
 static int
 get_input_offset(const CustomScanState *state, const Var *var)
 {
-	if (TTS_IS_ARROWTUPLE(state->ss.ss_ScanTupleSlot))
+	if (TTS_IS_ARROWTUPLE(state->ss.ss_ScanTupleSlot) || is_heap_scan_state(state))
 		return AttrNumberGetAttrOffset(var->varattno);
 
 	return get_input_offset_decompress_chunk((const DecompressChunkState *) state, var);
@@ -92,15 +167,15 @@ get_input_offset(const CustomScanState *state, const Var *var)
  * Get the type length and "byval" properties for the grouping column given by
  * the input offset.
  *
- * For a node returning arrow slots, the properties can be read directly from
- * the scanned relation's tuple descriptor. For DecompressChunk, the input
- * offset references the compressed relation.
+ * For a node returning arrow slots or a heap scan, the properties can be read
+ * directly from the scanned relation's tuple descriptor. For DecompressChunk,
+ * the input offset references the compressed relation.
  */
 static void
 get_column_storage_properties(const CustomScanState *state, int input_offset,
 							  GroupingColumn *result)
 {
-	if (TTS_IS_ARROWTUPLE(state->ss.ss_ScanTupleSlot))
+	if (TTS_IS_ARROWTUPLE(state->ss.ss_ScanTupleSlot) || is_heap_scan_state(state))
 	{
 		const TupleDesc tupdesc = RelationGetDescr(state->ss.ss_currentRelation);
 		result->by_value = TupleDescAttr(tupdesc, input_offset)->attbyval;
@@ -158,14 +233,14 @@ vector_agg_begin(CustomScanState *node, EState *estate, int eflags)
 	for (int i = 0; i < tlist_length; i++)
 	{
 		TargetEntry *tlentry = list_nth_node(TargetEntry, aggregated_tlist, i);
-		if (IsA(tlentry->expr, Aggref))
+		bool partialized;
+		if (vector_agg_get_aggref(tlentry->expr, &partialized) != NULL)
 		{
 			agg_functions_counter++;
 		}
 		else
 		{
-			/* This is a grouping column. */
-			Assert(IsA(tlentry->expr, Var));
+			/* This is a grouping column or expression. */
 			grouping_column_counter++;
 		}
 	}
@@ -191,53 +266,135 @@ vector_agg_begin(CustomScanState *node, EState *estate, int eflags)
 	for (int i = 0; i < tlist_length; i++)
 	{
 		TargetEntry *tlentry = list_nth_node(TargetEntry, aggregated_tlist, i);
-		if (IsA(tlentry->expr, Aggref))
+		bool partialized;
+		Aggref *aggref = vector_agg_get_aggref(tlentry->expr, &partialized);
+		if (aggref != NULL)
 		{
 			/* This is an aggregate function. */
 			VectorAggDef *def = &vector_agg_state->agg_defs[agg_functions_counter++];
 			def->output_offset = i;
 
-			Aggref *aggref = castNode(Aggref, tlentry->expr);
+			/*
+			 * The partialize_agg() function outputs the partial aggregate
+			 * state as bytea, using the send function of the state type when
+			 * the state is not serialized to bytea already.
+			 */
+			def->partialize_send_fn = InvalidOid;
+			if (partialized && exprType((Node *) aggref) != BYTEAOID)
+			{
+				bool is_varlena;
+				getTypeBinaryOutputInfo(exprType((Node *) aggref),
+										&def->partialize_send_fn,
+										&is_varlena);
+			}
 
-			VectorAggFunctions *func = get_vector_aggregate(aggref->aggfnoid);
+			VectorAggFunctions *func =
+				get_vector_aggregate(aggref->aggfnoid,
+									 aggref->aggargtypes != NIL ? linitial_oid(aggref->aggargtypes) :
+																  InvalidOid);
 			Assert(func != NULL);
 			def->func = *func;
+			def->second_input_offset = -1;
 
-			if (list_length(aggref->args) > 0)
+			if (def->func.agg_prepare != NULL)
 			{
-				Assert(list_length(aggref->args) == 1);
+				bool prepared PG_USED_FOR_ASSERTS_ONLY = def->func.agg_prepare(&def->func, aggref);
+				Assert(prepared);
+			}
+
+			if (list_length(aggref->args) == 2)
+			{
+				/*
+				 * The two-argument functions like first(value, time). Both
+				 * arguments are bare column references.
+				 */
+				Assert(aggref->aggsplit == AGGSPLIT_INITIAL_SERIAL);
+				Assert(def->func.agg_vector2 != NULL);
+
+				Var *value = castNode(Var, castNode(TargetEntry, linitial(aggref->args))->expr);
+				Var *cmp = castNode(Var, castNode(TargetEntry, lsecond(aggref->args))->expr);
+				def->input_offset = get_input_offset(childstate, value);
+				def->second_input_offset = get_input_offset(childstate, cmp);
+				def->argument_types = palloc0(sizeof(VectorAggArgumentTypes));
+				vector_agg_argument_types_init(def->argument_types,
+											   value->vartype,
+											   cmp->vartype);
+			}
+			else if (list_length(aggref->args) > 0)
+			{
+				/* The other arguments are constant parameters of the function. */
+				Assert(list_length(aggref->args) == 1 || def->func.agg_prepare != NULL);
 
 				/* The aggregate should be a partial aggregate */
 				Assert(aggref->aggsplit == AGGSPLIT_INITIAL_SERIAL);
 
-				Var *var = castNode(Var, castNode(TargetEntry, linitial(aggref->args))->expr);
-				def->input_offset = get_input_offset(childstate, var);
+				Expr *argument = castNode(TargetEntry, linitial(aggref->args))->expr;
+				if (IsA(argument, Var))
+				{
+					def->input_offset = get_input_offset(childstate, castNode(Var, argument));
+				}
+				else
+				{
+					/* A vectorizable expression, computed for every batch. */
+					def->input_offset = -1;
+					def->argument_expr = vector_expr_create(argument, get_input_offset, childstate);
+				}
 			}
 			else
 			{
 				def->input_offset = -1;
 			}
 
+			def->same_filter_def = -1;
 			if (aggref->aggfilter != NULL)
 			{
 				Node *constified = estimate_expression_value(&root, (Node *) aggref->aggfilter);
 				def->filter_clauses = list_make1(constified);
+
+				/*
+				 * The queries often compute several aggregates with the same
+				 * FILTER clause, so compute it only once per batch.
+				 */
+				for (int j = 0; j < agg_functions_counter - 1; j++)
+				{
+					const VectorAggDef *other = &vector_agg_state->agg_defs[j];
+					if (other->same_filter_def < 0 &&
+						equal(other->filter_clauses, def->filter_clauses))
+					{
+						def->same_filter_def = j;
+						break;
+					}
+				}
 			}
 		}
 		else
 		{
 			/* This is a grouping column. */
-			Assert(IsA(tlentry->expr, Var));
-
 			GroupingColumn *col = &vector_agg_state->grouping_columns[grouping_column_counter++];
 			col->output_offset = i;
 
-			Var *var = castNode(Var, tlentry->expr);
-			col->input_offset = get_input_offset(childstate, var);
-			get_column_storage_properties(childstate, col->input_offset, col);
+			if (IsA(tlentry->expr, Var))
+			{
+				Var *var = castNode(Var, tlentry->expr);
+				col->input_offset = get_input_offset(childstate, var);
+				get_column_storage_properties(childstate, col->input_offset, col);
+			}
+			else
+			{
+				/* A vectorizable expression, computed for every batch. */
+				col->input_offset = -1;
+				col->expr = vector_expr_create(tlentry->expr, get_input_offset, childstate);
+				get_typlenbyval(exprType((Node *) tlentry->expr),
+								&col->value_bytes,
+								&col->by_value);
+			}
 		}
 	}
 
+	vector_agg_state->argument_context = AllocSetContextCreate(CurrentMemoryContext,
+															   "vector agg arguments",
+															   ALLOCSET_DEFAULT_SIZES);
+
 	/*
 	 * Create the grouping policy chosen at plan time.
 	 */
@@ -253,6 +410,23 @@ vector_agg_begin(CustomScanState *node, EState *estate, int eflags)
 										 vector_agg_state->agg_defs,
 										 vector_agg_state->num_grouping_columns,
 										 vector_agg_state->grouping_columns);
+
+		if (!TTS_IS_ARROWTUPLE(childstate->ss.ss_ScanTupleSlot) && !is_heap_scan_state(childstate))
+		{
+			use_minmax_metadata_decompress_chunk((DecompressChunkState *) childstate,
+												 vector_agg_state);
+		}
+	}
+	else if (grouping_type == VAGT_Sorted)
+	{
+		/*
+		 * Streaming grouping of the input sorted by the grouping columns.
+		 */
+		vector_agg_state->grouping =
+			create_grouping_policy_sorted(vector_agg_state->num_agg_defs,
+										  vector_agg_state->agg_defs,
+										  vector_agg_state->num_grouping_columns,
+										  vector_agg_state->grouping_columns);
 	}
 	else
 	{
@@ -266,11 +440,68 @@ vector_agg_begin(CustomScanState *node, EState *estate, int eflags)
 										vector_agg_state->grouping_columns,
 										grouping_type);
 	}
+
+	if (is_heap_scan_state(childstate))
+	{
+		/*
+		 * Read only the columns that are referenced by the aggregated
+		 * targetlist, including the FILTER clauses.
+		 */
+		const Index scanrelid = ((Scan *) childstate->ss.ps.plan)->scanrelid;
+		Bitmapset *referenced = NULL;
+		pull_varattnos((Node *) aggregated_tlist, scanrelid, &referenced);
+
+		Bitmapset *attnos = NULL;
+		int attno = -1;
+		while ((attno = bms_next_member(referenced, attno)) >= 0)
+		{
+			/* The system columns are not vectorizable, so they can't be here. */
+			Assert(attno + FirstLowInvalidHeapAttributeNumber > 0);
+			attnos = bms_add_member(attnos, attno + FirstLowInvalidHeapAttributeNumber);
+		}
+
+		vector_agg_state->heap_batch =
+			heap_batch_create(RelationGetDescr(childstate->ss.ss_currentRelation),
+							  attnos,
+							  TARGET_COMPRESSED_BATCH_SIZE);
+	}
+}
+
+/*
+ * Add the batches that were aggregated to the cumulative statistics of the
+ * hypertable of the compressed chunk scan. The scan itself reports the rest.
+ */
+static void
+vector_agg_report_stats(VectorAggState *state)
+{
+	CustomScanState *childstate = linitial(state->custom.custom_ps);
+	int64 counters[COMPRESSED_SCAN_STATS_NUM_COUNTERS] = { 0 };
+	int32 hypertable_id;
+
+	if (state->aggregated_batches == 0 || is_heap_scan_state(childstate))
+		return;
+
+	if (is_columnar_scan(childstate->ss.ps.plan))
+	{
+		const Oid chunk_relid = RelationGetRelid(childstate->ss.ss_currentRelation);
+		hypertable_id = ts_chunk_get_hypertable_id_by_reloid(chunk_relid);
+	}
+	else
+	{
+		hypertable_id = ((DecompressChunkState *) childstate)->hypertable_id;
+	}
+
+	if (hypertable_id == 0)
+		return;
+
+	counters[COMPRESSED_SCAN_STATS_VECTOR_AGG_BATCHES] = state->aggregated_batches;
+	ts_compressed_scan_stats_report(hypertable_id, NULL, counters);
 }
 
 static void
 vector_agg_end(CustomScanState *node)
 {
+	vector_agg_report_stats((VectorAggState *) node);
 	ExecEndNode(linitial(node->custom_ps));
 }
 
@@ -285,6 +516,11 @@ vector_agg_rescan(CustomScanState *node)
 	VectorAggState *state = (VectorAggState *) node;
 	state->input_ended = false;
 
+	if (state->heap_batch != NULL)
+	{
+		heap_batch_reset(state->heap_batch);
+	}
+
 	state->grouping->gp_reset(state->grouping);
 }
 
@@ -327,6 +563,12 @@ compressed_batch_get_next_slot(VectorAggState *vector_agg_state)
 			return NULL;
 		}
 
+		if (!decompress_chunk_claim_batch(decompress_state, compressed_slot))
+		{
+			/* Another parallel participant aggregates this batch. */
+			continue;
+		}
+
 		compressed_batch_set_compressed_tuple(dcontext, batch_state, compressed_slot);
 
 		/* If the entire batch is filtered out, then immediately read the next
@@ -400,6 +642,28 @@ arrow_get_next_slot(VectorAggState *vector_agg_state)
 	return slot;
 }
 
+/*
+ * Get the next slot to aggregate for an uncompressed heap relation.
+ *
+ * Implements "get next slot" on top of a plain scan node. The tuples returned
+ * by it are collected into a batch that looks the same as a compressed batch
+ * to the grouping policies.
+ */
+static TupleTableSlot *
+heap_batch_get_next_slot(VectorAggState *vector_agg_state)
+{
+	HeapBatchState *heap_batch = vector_agg_state->heap_batch;
+	ScanState *scanstate = (ScanState *) linitial(vector_agg_state->custom.custom_ps);
+
+	if (!heap_batch_fill(heap_batch, scanstate))
+	{
+		vector_agg_state->input_ended = true;
+		return NULL;
+	}
+
+	return &heap_batch->batch->decompressed_scan_slot_data.base;
+}
+
 /*
  * Initialize vector quals for a compressed batch.
  *
@@ -421,6 +685,7 @@ compressed_batch_init_vector_quals(VectorAggState *agg_state, VectorAggDef *agg_
 					.per_vector_mcxt = batch_state->per_batch_context,
 					.slot = decompress_state->csstate.ss.ss_ScanTupleSlot,
 					.get_arrow_array = compressed_batch_get_arrow_array,
+					.is_monotonic = compressed_batch_is_monotonic,
 				},
 				.batch_state = batch_state,
 				.dcontext = dcontext,
@@ -429,6 +694,29 @@ compressed_batch_init_vector_quals(VectorAggState *agg_state, VectorAggDef *agg_
 	return &agg_state->vqual_state.vqstate;
 }
 
+/*
+ * Initialize FILTER vector quals for a batch of heap tuples.
+ */
+static VectorQualState *
+heap_batch_init_vector_quals(VectorAggState *agg_state, VectorAggDef *agg_def,
+							 TupleTableSlot *slot)
+{
+	DecompressBatchState *batch_state = (DecompressBatchState *) slot;
+
+	agg_state->vqual_state = (CompressedBatchVectorQualState) {
+				.vqstate = {
+					.vectorized_quals_constified = agg_def->filter_clauses,
+					.num_results = batch_state->total_batch_rows,
+					.per_vector_mcxt = batch_state->per_batch_context,
+					.slot = slot,
+					.get_arrow_array = heap_batch_get_arrow_array,
+				},
+				.batch_state = batch_state,
+			};
+
+	return &agg_state->vqual_state.vqstate;
+}
+
 /*
  * Initialize FILTER vector quals for an arrow tuple slot.
  *
@@ -441,6 +729,29 @@ arrow_init_vector_quals(VectorAggState *agg_state, VectorAggDef *agg_def, TupleT
 	return &agg_state->vqual_state.vqstate;
 }
 
+/*
+ * Convert the partial aggregate states of the aggregates wrapped in
+ * partialize_agg() to bytea, as the function does.
+ */
+static void
+partialize_aggregated_slot(VectorAggState *vector_agg_state, TupleTableSlot *aggregated_slot)
+{
+	for (int i = 0; i < vector_agg_state->num_agg_defs; i++)
+	{
+		const VectorAggDef *agg_def = &vector_agg_state->agg_defs[i];
+		const int offset = agg_def->output_offset;
+
+		if (!OidIsValid(agg_def->partialize_send_fn) || aggregated_slot->tts_isnull[offset])
+		{
+			continue;
+		}
+
+		aggregated_slot->tts_values[offset] =
+			PointerGetDatum(OidSendFunctionCall(agg_def->partialize_send_fn,
+												aggregated_slot->tts_values[offset]));
+	}
+}
+
 static TupleTableSlot *
 vector_agg_exec(CustomScanState *node)
 {
@@ -457,6 +768,10 @@ vector_agg_exec(CustomScanState *node)
 	GroupingPolicy *grouping = vector_agg_state->grouping;
 	MemoryContext old_context = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
 	bool have_partial = grouping->gp_do_emit(grouping, aggregated_slot);
+	if (have_partial)
+	{
+		partialize_aggregated_slot(vector_agg_state, aggregated_slot);
+	}
 	MemoryContextSwitchTo(old_context);
 	if (have_partial)
 	{
@@ -477,7 +792,14 @@ vector_agg_exec(CustomScanState *node)
 	 * Have no more partial aggregation results and still have input, have to
 	 * reset the grouping policy and start a new cycle of partial aggregation.
 	 */
-	grouping->gp_reset(grouping);
+	if (grouping->gp_next_cycle != NULL)
+	{
+		grouping->gp_next_cycle(grouping);
+	}
+	else
+	{
+		grouping->gp_reset(grouping);
+	}
 
 	/*
 	 * Now we loop through the input compressed tuples, until they end or until
@@ -502,6 +824,8 @@ vector_agg_exec(CustomScanState *node)
 		if (vector_agg_state->input_ended)
 			break;
 
+		vector_agg_state->aggregated_batches++;
+
 		/*
 		 * Compute the vectorized filters for the aggregate function FILTER
 		 * clauses.
@@ -515,12 +839,68 @@ vector_agg_exec(CustomScanState *node)
 				continue;
 			}
 
+			if (agg_def->same_filter_def >= 0)
+			{
+				agg_def->filter_result =
+					vector_agg_state->agg_defs[agg_def->same_filter_def].filter_result;
+				continue;
+			}
+
 			VectorQualState *vqstate =
 				vector_agg_state->init_vector_quals(vector_agg_state, agg_def, slot);
 			vector_qual_compute(vqstate);
 			agg_def->filter_result = vqstate->vector_qual_result;
 		}
 
+		/*
+		 * Compute the grouping expressions and the aggregate function arguments
+		 * that are expressions. They are computed only for the rows that pass
+		 * the filters, so that we don't get errors for the rows that are not
+		 * aggregated.
+		 */
+		MemoryContextReset(vector_agg_state->argument_context);
+		for (int i = 0; i < vector_agg_state->num_grouping_columns; i++)
+		{
+			GroupingColumn *col = &vector_agg_state->grouping_columns[i];
+			if (col->expr == NULL)
+			{
+				continue;
+			}
+
+			uint16 total_batch_rows = 0;
+			const uint64 *vector_qual_result =
+				vector_slot_get_qual_result(slot, &total_batch_rows);
+			MemoryContext old = MemoryContextSwitchTo(vector_agg_state->argument_context);
+			vector_expr_compute(col->expr, slot, vector_qual_result, total_batch_rows, &col->values);
+			MemoryContextSwitchTo(old);
+		}
+
+		for (int i = 0; i < naggs; i++)
+		{
+			VectorAggDef *agg_def = &vector_agg_state->agg_defs[i];
+			if (agg_def->argument_expr == NULL)
+			{
+				continue;
+			}
+
+			uint16 total_batch_rows = 0;
+			const uint64 *vector_qual_result =
+				vector_slot_get_qual_result(slot, &total_batch_rows);
+			MemoryContext old = MemoryContextSwitchTo(vector_agg_state->argument_context);
+			const size_t num_words = (total_batch_rows + 63) / 64;
+			const uint64 *filter = arrow_combine_validity(num_words,
+														  palloc(sizeof(uint64) * num_words),
+														  vector_qual_result,
+														  agg_def->filter_result,
+														  NULL);
+			vector_expr_compute(agg_def->argument_expr,
+								slot,
+								filter,
+								total_batch_rows,
+								&agg_def->argument_values);
+			MemoryContextSwitchTo(old);
+		}
+
 		/*
 		 * Finally, pass the compressed batch to the grouping policy.
 		 */
@@ -532,6 +912,10 @@ vector_agg_exec(CustomScanState *node)
 	 */
 	old_context = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
 	have_partial = grouping->gp_do_emit(grouping, aggregated_slot);
+	if (have_partial)
+	{
+		partialize_aggregated_slot(vector_agg_state, aggregated_slot);
+	}
 	MemoryContextSwitchTo(old_context);
 	if (have_partial)
 	{
@@ -566,6 +950,16 @@ vector_agg_explain(CustomScanState *node, List *ancestors, ExplainState *es)
 	{
 		ExplainPropertyText("Grouping Policy", state->grouping->gp_explain(state->grouping), es);
 	}
+
+	/*
+	 * The statistics of the grouping are enabled together with the statistics
+	 * of the decompression.
+	 */
+	if (es->analyze && ts_guc_enable_decompression_stats &&
+		state->grouping->gp_explain_stats != NULL)
+	{
+		state->grouping->gp_explain_stats(state->grouping, es);
+	}
 }
 
 static struct CustomExecMethods exec_methods = {
@@ -581,7 +975,7 @@ Node *
 vector_agg_state_create(CustomScan *cscan)
 {
 	VectorAggState *state = (VectorAggState *) newNode(sizeof(VectorAggState), T_CustomScanState);
-	CustomScan *childscan = castNode(CustomScan, linitial(cscan->custom_plans));
+	Plan *childplan = linitial(cscan->custom_plans);
 
 	state->custom.methods = &exec_methods;
 
@@ -589,8 +983,9 @@ vector_agg_state_create(CustomScan *cscan)
 	 * Initialize VectorAggState to process vector slots from different
 	 * subnodes.
 	 *
-	 * VectorAgg supports two child nodes: ColumnarScan (producing arrow tuple
-	 * table slots) and DecompressChunk (producing compressed batches).
+	 * VectorAgg supports three kinds of child nodes: ColumnarScan (producing
+	 * arrow tuple table slots), DecompressChunk (producing compressed batches)
+	 * and the plain scans of uncompressed heap relations.
 	 *
 	 * When the child is ColumnarScan, VectorAgg expects Arrow slots that
 	 * carry arrow arrays. ColumnarScan performs standard qual filtering and
@@ -602,18 +997,28 @@ vector_agg_state_create(CustomScan *cscan)
 	 * handle batch decompression and vectorized qual filtering itself, in its
 	 * own "get next slot" implementation.
 	 *
+	 * When the child is a heap scan, VectorAgg reads the tuples from it and
+	 * copies them into a batch of arrow arrays. The child node evaluates its
+	 * quals as usual.
+	 *
 	 * The vector qual init functions are needed to implement vectorized
-	 * aggregate function FILTER clauses for arrow tuple table slots and
-	 * compressed batches, respectively.
+	 * aggregate function FILTER clauses for arrow tuple table slots,
+	 * compressed batches and heap batches, respectively.
 	 */
-	if (is_columnar_scan(&childscan->scan.plan))
+	if (!IsA(childplan, CustomScan))
+	{
+		state->get_next_slot = heap_batch_get_next_slot;
+		state->init_vector_quals = heap_batch_init_vector_quals;
+	}
+	else if (is_columnar_scan(childplan))
 	{
 		state->get_next_slot = arrow_get_next_slot;
 		state->init_vector_quals = arrow_init_vector_quals;
 	}
 	else
 	{
-		Assert(strcmp(childscan->methods->CustomName, "DecompressChunk") == 0);
+		Assert(strcmp(castNode(CustomScan, childplan)->methods->CustomName, "DecompressChunk") ==
+			   0);
 		state->get_next_slot = compressed_batch_get_next_slot;
 		state->init_vector_quals = compressed_batch_init_vector_quals;
 	}
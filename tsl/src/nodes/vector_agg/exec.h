@@ -13,6 +13,7 @@
 
 #include "function/functions.h"
 #include "grouping_policy.h"
+#include "vector_expr.h"
 
 typedef struct VectorAggDef
 {
@@ -21,6 +22,34 @@ typedef struct VectorAggDef
 	int output_offset;
 	List *filter_clauses;
 	uint64 *filter_result;
+
+	/*
+	 * The index of a previous aggregate definition with the same FILTER
+	 * clause, so that its filter result can be reused, or -1.
+	 */
+	int same_filter_def;
+
+	/*
+	 * The argument expression if it is not a bare column reference, and its
+	 * values computed for the current batch.
+	 */
+	VectorExpr *argument_expr;
+	CompressedColumnValues argument_values;
+
+	/*
+	 * For the two-argument aggregate functions like first(value, time), the
+	 * input offset of the second argument, and the types of both arguments.
+	 * The second argument is -1 for the other functions.
+	 */
+	int second_input_offset;
+	VectorAggArgumentTypes *argument_types;
+
+	/*
+	 * For the aggregates wrapped in partialize_agg(), the send function that
+	 * converts the partial aggregate state to bytea, or InvalidOid if the
+	 * state needs no conversion.
+	 */
+	Oid partialize_send_fn;
 } VectorAggDef;
 
 typedef struct GroupingColumn
@@ -30,6 +59,14 @@ typedef struct GroupingColumn
 
 	int16 value_bytes;
 	bool by_value;
+
+	/*
+	 * The grouping expression if it is not a bare column reference, like
+	 * time_bucket() over the time column, and its values computed for the
+	 * current batch. The input offset is -1 in this case.
+	 */
+	VectorExpr *expr;
+	CompressedColumnValues values;
 } GroupingColumn;
 
 typedef struct VectorAggState
@@ -51,6 +88,18 @@ typedef struct VectorAggState
 
 	GroupingPolicy *grouping;
 
+	/*
+	 * Memory context for the computed aggregate function arguments, reset for
+	 * every batch.
+	 */
+	MemoryContext argument_context;
+
+	/*
+	 * The batch of tuples when the child node is a scan of an uncompressed
+	 * heap relation, NULL otherwise.
+	 */
+	struct HeapBatchState *heap_batch;
+
 	/*
 	 * State to compute vector quals for FILTER clauses.
 	 */
@@ -67,6 +116,12 @@ typedef struct VectorAggState
 	 * child node type.
 	 */
 	TupleTableSlot *(*get_next_slot)(struct VectorAggState *vector_agg_state);
+
+	/*
+	 * The number of compressed batches or arrow slots aggregated, for the
+	 * cumulative compressed scan statistics.
+	 */
+	int64 aggregated_batches;
 } VectorAggState;
 
 extern Node *vector_agg_state_create(CustomScan *cscan);
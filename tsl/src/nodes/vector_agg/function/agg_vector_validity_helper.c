@@ -8,7 +8,13 @@
  * Generate a separate implementation of aggregating an ArrowArray for the
  * common cases where we have no nulls and/or all rows pass the filter. It
  * avoids branches so can be more easily vectorized.
+ *
+ * The including file can define AGG_VECTOR_TARGET to compile these functions
+ * for several instruction sets.
  */
+#ifndef AGG_VECTOR_TARGET
+#define AGG_VECTOR_TARGET
+#endif
 
 static pg_attribute_always_inline void
 FUNCTION_NAME(vector_impl_arrow)(void *agg_state, const ArrowArray *vector, const uint64 *filter,
@@ -19,14 +25,14 @@ FUNCTION_NAME(vector_impl_arrow)(void *agg_state, const ArrowArray *vector, cons
 	FUNCTION_NAME(vector_impl)(agg_state, n, values, filter, agg_extra_mctx);
 }
 
-static pg_noinline void
+static pg_noinline AGG_VECTOR_TARGET void
 FUNCTION_NAME(vector_all_valid)(void *agg_state, const ArrowArray *vector,
 								MemoryContext agg_extra_mctx)
 {
 	FUNCTION_NAME(vector_impl_arrow)(agg_state, vector, NULL, agg_extra_mctx);
 }
 
-static pg_noinline void
+static pg_noinline AGG_VECTOR_TARGET void
 FUNCTION_NAME(vector_one_validity)(void *agg_state, const ArrowArray *vector, const uint64 *filter,
 								   MemoryContext agg_extra_mctx)
 {
@@ -48,3 +54,5 @@ FUNCTION_NAME(vector)(void *agg_state, const ArrowArray *vector, const uint64 *f
 		FUNCTION_NAME(vector_one_validity)(agg_state, vector, filter, agg_extra_mctx);
 	}
 }
+
+#undef AGG_VECTOR_TARGET
@@ -0,0 +1,289 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Vectorized implementation of approx_count_distinct(). The argument must be
+ * of a fixed-width by-value type, or a varlena type if it is a segmentby
+ * column. The partial results are the serialized HyperLogLog sketches in the
+ * format of hll_serializefunc(), so they are combined by the Postgres final
+ * aggregation.
+ */
+
+#include <postgres.h>
+
+#include <catalog/pg_type.h>
+#include <nodes/makefuncs.h>
+#include <parser/parse_func.h>
+#include <utils/lsyscache.h>
+
+#include "extension.h"
+#include "functions.h"
+#include "hyperloglog.h"
+
+typedef struct
+{
+	/*
+	 * The registers of the sketch are allocated when we see the first value,
+	 * because they are large, and many aggregate states might be empty in the
+	 * hash aggregation.
+	 */
+	uint8 *registers;
+} HllState;
+
+static void
+hll_init(void *restrict agg_states, int n)
+{
+	HllState *states = (HllState *) agg_states;
+	for (int i = 0; i < n; i++)
+	{
+		states[i].registers = NULL;
+	}
+}
+
+static pg_attribute_always_inline uint8 *
+hll_get_registers(HllState *state, MemoryContext agg_extra_mctx)
+{
+	if (unlikely(state->registers == NULL))
+	{
+		state->registers = MemoryContextAllocZero(agg_extra_mctx, HLL_REGISTERS);
+	}
+	return state->registers;
+}
+
+static void
+hll_emit(void *agg_state, Datum *out_result, bool *out_isnull)
+{
+	HllState *state = (HllState *) agg_state;
+	*out_result = PointerGetDatum(hll_serialize(state->registers));
+	*out_isnull = false;
+}
+
+/*
+ * For a scalar argument, e.g. a segmentby column, the sketch is updated once
+ * per batch and not once per row, because the repeated values don't change it.
+ */
+static pg_attribute_always_inline void
+hll_scalar_impl(void *agg_state, Datum constvalue, bool constisnull, int n, int16 typlen,
+				bool typbyval, MemoryContext agg_extra_mctx)
+{
+	if (constisnull || n == 0)
+	{
+		return;
+	}
+
+	HllState *state = (HllState *) agg_state;
+	hll_add_hash(hll_get_registers(state, agg_extra_mctx),
+				 hll_hash_datum(constvalue, typlen, typbyval));
+}
+
+static pg_attribute_always_inline void
+hll_many_scalar_impl(void *restrict agg_states, const uint32 *offsets, const uint64 *filter,
+					 int start_row, int end_row, Datum constvalue, bool constisnull, int16 typlen,
+					 bool typbyval, MemoryContext agg_extra_mctx)
+{
+	if (constisnull)
+	{
+		return;
+	}
+
+	HllState *states = (HllState *) agg_states;
+	const uint64 hash = hll_hash_datum(constvalue, typlen, typbyval);
+
+	/*
+	 * The neighbouring rows often belong to the same group, and updating its
+	 * sketch again with the same value is a no-op.
+	 */
+	uint32 previous_offset = 0;
+	for (int row = start_row; row < end_row; row++)
+	{
+		if (!arrow_row_is_valid(filter, row) || offsets[row] == previous_offset)
+		{
+			continue;
+		}
+
+		previous_offset = offsets[row];
+		hll_add_hash(hll_get_registers(&states[offsets[row]], agg_extra_mctx), hash);
+	}
+}
+
+#define HLL_FIXED_FUNCTIONS(CTYPE)                                                                 \
+	static void hll_vector_##CTYPE(void *agg_state,                                                \
+								   const ArrowArray *vector,                                       \
+								   const uint64 *filter,                                           \
+								   MemoryContext agg_extra_mctx)                                   \
+	{                                                                                              \
+		uint8 *restrict registers = hll_get_registers((HllState *) agg_state, agg_extra_mctx);     \
+		const CTYPE *values = vector->buffers[1];                                                  \
+		const int n = vector->length;                                                              \
+		for (int row = 0; row < n; row++)                                                          \
+		{                                                                                          \
+			if (arrow_row_is_valid(filter, row))                                                   \
+			{                                                                                      \
+				hll_add_hash(registers, hll_hash_bytes(&values[row], sizeof(CTYPE)));              \
+			}                                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static void hll_many_vector_##CTYPE(void *restrict agg_states,                                 \
+										const uint32 *offsets,                                     \
+										const uint64 *filter,                                      \
+										int start_row,                                             \
+										int end_row,                                               \
+										const ArrowArray *vector,                                  \
+										MemoryContext agg_extra_mctx)                              \
+	{                                                                                              \
+		HllState *states = (HllState *) agg_states;                                                \
+		const CTYPE *values = vector->buffers[1];                                                  \
+		for (int row = start_row; row < end_row; row++)                                            \
+		{                                                                                          \
+			if (arrow_row_is_valid(filter, row))                                                   \
+			{                                                                                      \
+				hll_add_hash(hll_get_registers(&states[offsets[row]], agg_extra_mctx),             \
+							 hll_hash_bytes(&values[row], sizeof(CTYPE)));                         \
+			}                                                                                      \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static void hll_scalar_##CTYPE(void *agg_state,                                                \
+								   Datum constvalue,                                               \
+								   bool constisnull,                                               \
+								   int n,                                                          \
+								   MemoryContext agg_extra_mctx)                                   \
+	{                                                                                              \
+		hll_scalar_impl(agg_state,                                                                 \
+						constvalue,                                                                \
+						constisnull,                                                               \
+						n,                                                                         \
+						sizeof(CTYPE),                                                             \
+						true,                                                                      \
+						agg_extra_mctx);                                                           \
+	}                                                                                              \
+                                                                                                   \
+	static void hll_many_scalar_##CTYPE(void *restrict agg_states,                                 \
+										const uint32 *offsets,                                     \
+										const uint64 *filter,                                      \
+										int start_row,                                             \
+										int end_row,                                               \
+										Datum constvalue,                                          \
+										bool constisnull,                                          \
+										MemoryContext agg_extra_mctx)                              \
+	{                                                                                              \
+		hll_many_scalar_impl(agg_states,                                                           \
+							 offsets,                                                              \
+							 filter,                                                               \
+							 start_row,                                                            \
+							 end_row,                                                              \
+							 constvalue,                                                           \
+							 constisnull,                                                          \
+							 sizeof(CTYPE),                                                        \
+							 true,                                                                 \
+							 agg_extra_mctx);                                                      \
+	}                                                                                              \
+                                                                                                   \
+	static VectorAggFunctions hll_agg_##CTYPE = {                                                  \
+		.state_bytes = sizeof(HllState),                                                           \
+		.agg_init = hll_init,                                                                      \
+		.agg_emit = hll_emit,                                                                      \
+		.agg_vector = hll_vector_##CTYPE,                                                          \
+		.agg_many_vector = hll_many_vector_##CTYPE,                                                \
+		.agg_scalar = hll_scalar_##CTYPE,                                                          \
+		.agg_many_scalar = hll_many_scalar_##CTYPE,                                                \
+	};
+
+HLL_FIXED_FUNCTIONS(int16)
+HLL_FIXED_FUNCTIONS(int32)
+HLL_FIXED_FUNCTIONS(int64)
+
+#undef HLL_FIXED_FUNCTIONS
+
+/*
+ * The varlena arguments are supported only for the segmentby columns, which
+ * are always scalar.
+ */
+static void
+hll_scalar_varlena(void *agg_state, Datum constvalue, bool constisnull, int n,
+				   MemoryContext agg_extra_mctx)
+{
+	hll_scalar_impl(agg_state, constvalue, constisnull, n, -1, false, agg_extra_mctx);
+}
+
+static void
+hll_many_scalar_varlena(void *restrict agg_states, const uint32 *offsets, const uint64 *filter,
+						int start_row, int end_row, Datum constvalue, bool constisnull,
+						MemoryContext agg_extra_mctx)
+{
+	hll_many_scalar_impl(agg_states,
+						 offsets,
+						 filter,
+						 start_row,
+						 end_row,
+						 constvalue,
+						 constisnull,
+						 -1,
+						 false,
+						 agg_extra_mctx);
+}
+
+static VectorAggFunctions hll_agg_varlena = {
+	.state_bytes = sizeof(HllState),
+	.agg_init = hll_init,
+	.agg_emit = hll_emit,
+	.agg_scalar = hll_scalar_varlena,
+	.agg_many_scalar = hll_many_scalar_varlena,
+	.scalar_argument_only = true,
+};
+
+static Oid approx_count_distinct_oid = InvalidOid;
+
+/*
+ * Return the vectorized implementation if the given aggregate function is
+ * approx_count_distinct() and it supports the argument type.
+ */
+VectorAggFunctions *
+get_vector_approx_count_distinct_aggregate(Oid aggfnoid, Oid argtype)
+{
+	if (!OidIsValid(approx_count_distinct_oid))
+	{
+		Oid argtypes[] = { ANYELEMENTOID };
+		List *qualified_name = list_make2(makeString(ts_extension_schema_name()),
+										  makeString("approx_count_distinct"));
+		approx_count_distinct_oid = LookupFuncName(qualified_name,
+												   lengthof(argtypes),
+												   argtypes,
+												   /* missing_ok = */ true);
+	}
+
+	if (aggfnoid != approx_count_distinct_oid || !OidIsValid(argtype))
+	{
+		return NULL;
+	}
+
+	int16 typlen;
+	bool typbyval;
+	get_typlenbyval(argtype, &typlen, &typbyval);
+
+	if (typbyval)
+	{
+		switch (typlen)
+		{
+			case 2:
+				return &hll_agg_int16;
+			case 4:
+				return &hll_agg_int32;
+			case 8:
+				return &hll_agg_int64;
+			default:
+				return NULL;
+		}
+	}
+
+	if (typlen == -1)
+	{
+		return &hll_agg_varlena;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,508 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Vectorized implementation of the bookend aggregate functions first(value,
+ * time) and last(value, time). The comparison argument must be of an integer
+ * based type like timestamptz, and the value argument of a fixed-width by-value
+ * type or text. The partial results use the same serialization format as
+ * ts_bookend_serializefunc(), so that they can be combined by the Postgres
+ * final aggregation.
+ */
+
+#include <postgres.h>
+
+#include <catalog/pg_type.h>
+#include <libpq/pqformat.h>
+#include <nodes/makefuncs.h>
+#include <parser/parse_func.h>
+#include <utils/datum.h>
+#include <utils/lsyscache.h>
+
+#include "extension.h"
+#include "functions.h"
+#include "nodes/decompress_chunk/compressed_batch.h"
+
+typedef struct
+{
+	/* Whether we have seen any rows. */
+	bool isvalid;
+	bool value_isnull;
+	bool cmp_isnull;
+	Datum value;
+	int64 cmp;
+} BookendState;
+
+static void
+bookend_init(void *restrict agg_states, int n)
+{
+	BookendState *states = (BookendState *) agg_states;
+	for (int i = 0; i < n; i++)
+	{
+		states[i].isvalid = false;
+		states[i].value_isnull = true;
+		states[i].cmp_isnull = true;
+		states[i].value = 0;
+		states[i].cmp = 0;
+	}
+}
+
+static pg_attribute_always_inline int64
+bookend_cmp_from_datum(Datum datum, int cmp_bytes)
+{
+	switch (cmp_bytes)
+	{
+		case 2:
+			return DatumGetInt16(datum);
+		case 4:
+			return DatumGetInt32(datum);
+		default:
+			Assert(cmp_bytes == 8);
+			return DatumGetInt64(datum);
+	}
+}
+
+static Datum
+bookend_cmp_to_datum(int64 cmp, int cmp_bytes)
+{
+	switch (cmp_bytes)
+	{
+		case 2:
+			return Int16GetDatum((int16) cmp);
+		case 4:
+			return Int32GetDatum((int32) cmp);
+		default:
+			Assert(cmp_bytes == 8);
+			return Int64GetDatum(cmp);
+	}
+}
+
+/*
+ * Read the comparison argument at the given row. Returns false if it is null.
+ */
+static pg_attribute_always_inline bool
+bookend_cmp_get(const CompressedColumnValues *arg, int cmp_bytes, int row, int64 *restrict result)
+{
+	if (arg->decompression_type == DT_Scalar)
+	{
+		*result = bookend_cmp_from_datum(*arg->output_value, cmp_bytes);
+		return !*arg->output_isnull;
+	}
+
+	Assert(arg->decompression_type == cmp_bytes);
+	if (!arrow_row_is_valid(arg->buffers[0], row))
+	{
+		return false;
+	}
+
+	switch (cmp_bytes)
+	{
+		case 2:
+			*result = ((const int16 *) arg->buffers[1])[row];
+			break;
+		case 4:
+			*result = ((const int32 *) arg->buffers[1])[row];
+			break;
+		default:
+			*result = ((const int64 *) arg->buffers[1])[row];
+			break;
+	}
+	return true;
+}
+
+/*
+ * Read the value argument at the given row into the aggregate function state,
+ * copying it into the given memory context if it is by-reference.
+ */
+static void
+bookend_store_value(BookendState *restrict state, const VectorAggArgumentTypes *types,
+					const CompressedColumnValues *arg, int row, MemoryContext agg_extra_mctx)
+{
+	if (!types->typbyval[0] && !state->value_isnull)
+	{
+		pfree(DatumGetPointer(state->value));
+	}
+
+	state->value_isnull = true;
+	state->value = 0;
+
+	switch ((int) arg->decompression_type)
+	{
+		case DT_Scalar:
+			if (!*arg->output_isnull)
+			{
+				MemoryContext old = MemoryContextSwitchTo(agg_extra_mctx);
+				state->value = datumCopy(*arg->output_value, types->typbyval[0], types->typlen[0]);
+				state->value_isnull = false;
+				MemoryContextSwitchTo(old);
+			}
+			break;
+		case DT_ArrowText:
+		case DT_ArrowTextDict:
+		{
+			if (!arrow_row_is_valid(arg->buffers[0], row))
+			{
+				break;
+			}
+
+			const int index = arg->decompression_type == DT_ArrowTextDict ?
+								  ((const int16 *) arg->buffers[3])[row] :
+								  row;
+			const uint32 start = ((const uint32 *) arg->buffers[1])[index];
+			const int32 bytes = ((const uint32 *) arg->buffers[1])[index + 1] - start;
+
+			text *result = MemoryContextAlloc(agg_extra_mctx, VARHDRSZ + bytes);
+			SET_VARSIZE(result, VARHDRSZ + bytes);
+			memcpy(VARDATA(result), &((const char *) arg->buffers[2])[start], bytes);
+			state->value = PointerGetDatum(result);
+			state->value_isnull = false;
+			break;
+		}
+		case 2:
+			if (arrow_row_is_valid(arg->buffers[0], row))
+			{
+				state->value = Int16GetDatum(((const int16 *) arg->buffers[1])[row]);
+				state->value_isnull = false;
+			}
+			break;
+		case 4:
+			if (arrow_row_is_valid(arg->buffers[0], row))
+			{
+				state->value = Int32GetDatum(((const int32 *) arg->buffers[1])[row]);
+				state->value_isnull = false;
+			}
+			break;
+		case 8:
+			if (arrow_row_is_valid(arg->buffers[0], row))
+			{
+				state->value = Int64GetDatum(((const int64 *) arg->buffers[1])[row]);
+				state->value_isnull = false;
+			}
+			break;
+		default:
+			elog(ERROR, "unexpected decompression type %d", arg->decompression_type);
+	}
+}
+
+/*
+ * Whether the new comparison value should replace the current one. The ties
+ * keep the earlier row, like the Postgres implementation does.
+ */
+static pg_attribute_always_inline bool
+bookend_better(bool is_first, int64 new_cmp, int64 current_cmp)
+{
+	return is_first ? new_cmp < current_cmp : new_cmp > current_cmp;
+}
+
+/*
+ * If the comparison argument is a monotonic arithmetic sequence without nulls,
+ * the best row is either the first or the last row that passes the filter.
+ */
+static pg_attribute_always_inline int
+bookend_find_row_monotonic(const CompressedColumnValues *cmp_arg, const uint64 *filter, int n,
+						   bool is_first, int cmp_bytes, int64 *restrict best_cmp)
+{
+	int first_row = 0;
+	while (first_row < n && !arrow_row_is_valid(filter, first_row))
+	{
+		first_row++;
+	}
+
+	if (first_row == n)
+	{
+		return -1;
+	}
+
+	int last_row = n - 1;
+	while (!arrow_row_is_valid(filter, last_row))
+	{
+		last_row--;
+	}
+
+	int64 first_cmp;
+	int64 last_cmp;
+	bookend_cmp_get(cmp_arg, cmp_bytes, first_row, &first_cmp);
+	bookend_cmp_get(cmp_arg, cmp_bytes, last_row, &last_cmp);
+
+	if (bookend_better(is_first, last_cmp, first_cmp))
+	{
+		*best_cmp = last_cmp;
+		return last_row;
+	}
+
+	*best_cmp = first_cmp;
+	return first_row;
+}
+
+static pg_attribute_always_inline void
+bookend_vector_impl(BookendState *restrict state, const VectorAggArgumentTypes *types,
+					const CompressedColumnValues *value_arg,
+					const CompressedColumnValues *cmp_arg, const uint64 *filter, int n,
+					bool is_first, int cmp_bytes, MemoryContext agg_extra_mctx)
+{
+	bool have_row = state->isvalid;
+	bool best_cmp_valid = state->isvalid && !state->cmp_isnull;
+	int64 best_cmp = state->cmp;
+	int best_row = -1;
+
+	if (cmp_arg->arithmetic_sequence && (!have_row || best_cmp_valid))
+	{
+		int64 batch_cmp = 0;
+		const int row =
+			bookend_find_row_monotonic(cmp_arg, filter, n, is_first, cmp_bytes, &batch_cmp);
+		if (row >= 0 && (!have_row || bookend_better(is_first, batch_cmp, best_cmp)))
+		{
+			best_row = row;
+			best_cmp = batch_cmp;
+			best_cmp_valid = true;
+		}
+	}
+	else
+	{
+		for (int row = 0; row < n; row++)
+		{
+			if (!arrow_row_is_valid(filter, row))
+			{
+				continue;
+			}
+
+			int64 cmp = 0;
+			const bool cmp_valid = bookend_cmp_get(cmp_arg, cmp_bytes, row, &cmp);
+			if (!have_row ||
+				(cmp_valid && (!best_cmp_valid || bookend_better(is_first, cmp, best_cmp))))
+			{
+				have_row = true;
+				best_row = row;
+				best_cmp = cmp;
+				best_cmp_valid = cmp_valid;
+			}
+		}
+	}
+
+	if (best_row < 0)
+	{
+		return;
+	}
+
+	bookend_store_value(state, types, value_arg, best_row, agg_extra_mctx);
+	state->isvalid = true;
+	state->cmp = best_cmp;
+	state->cmp_isnull = !best_cmp_valid;
+}
+
+static pg_attribute_always_inline void
+bookend_many_vector_impl(BookendState *restrict states, const VectorAggArgumentTypes *types,
+						 const uint32 *offsets, const uint64 *filter, int start_row, int end_row,
+						 const CompressedColumnValues *value_arg,
+						 const CompressedColumnValues *cmp_arg, bool is_first, int cmp_bytes,
+						 MemoryContext agg_extra_mctx)
+{
+	for (int row = start_row; row < end_row; row++)
+	{
+		if (!arrow_row_is_valid(filter, row))
+		{
+			continue;
+		}
+
+		BookendState *restrict state = &states[offsets[row]];
+		int64 cmp = 0;
+		const bool cmp_valid = bookend_cmp_get(cmp_arg, cmp_bytes, row, &cmp);
+		if (!state->isvalid ||
+			(cmp_valid && (state->cmp_isnull || bookend_better(is_first, cmp, state->cmp))))
+		{
+			bookend_store_value(state, types, value_arg, row, agg_extra_mctx);
+			state->isvalid = true;
+			state->cmp = cmp;
+			state->cmp_isnull = !cmp_valid;
+		}
+	}
+}
+
+/*
+ * Generate the implementations specialized for the width of the comparison
+ * argument.
+ */
+#define BOOKEND_FUNCTIONS(NAME, IS_FIRST)                                                          \
+	static void NAME##_vector(void *restrict agg_state,                                           \
+							  const VectorAggArgumentTypes *types,                                 \
+							  const CompressedColumnValues *value_arg,                             \
+							  const CompressedColumnValues *cmp_arg,                               \
+							  const uint64 *filter,                                                \
+							  int n,                                                               \
+							  MemoryContext agg_extra_mctx)                                        \
+	{                                                                                              \
+		switch (types->typlen[1])                                                                  \
+		{                                                                                          \
+			case 2:                                                                                \
+				bookend_vector_impl(agg_state, types, value_arg, cmp_arg, filter, n, IS_FIRST, 2, \
+									agg_extra_mctx);                                               \
+				break;                                                                             \
+			case 4:                                                                                \
+				bookend_vector_impl(agg_state, types, value_arg, cmp_arg, filter, n, IS_FIRST, 4, \
+									agg_extra_mctx);                                               \
+				break;                                                                             \
+			default:                                                                               \
+				bookend_vector_impl(agg_state, types, value_arg, cmp_arg, filter, n, IS_FIRST, 8, \
+									agg_extra_mctx);                                               \
+				break;                                                                             \
+		}                                                                                          \
+	}                                                                                              \
+                                                                                                   \
+	static void NAME##_many_vector(void *restrict agg_states,                                     \
+								   const VectorAggArgumentTypes *types,                            \
+								   const uint32 *offsets,                                          \
+								   const uint64 *filter,                                           \
+								   int start_row,                                                  \
+								   int end_row,                                                    \
+								   const CompressedColumnValues *value_arg,                        \
+								   const CompressedColumnValues *cmp_arg,                          \
+								   MemoryContext agg_extra_mctx)                                   \
+	{                                                                                              \
+		switch (types->typlen[1])                                                                  \
+		{                                                                                          \
+			case 2:                                                                                \
+				bookend_many_vector_impl(agg_states, types, offsets, filter, start_row, end_row,   \
+										 value_arg, cmp_arg, IS_FIRST, 2, agg_extra_mctx);         \
+				break;                                                                             \
+			case 4:                                                                                \
+				bookend_many_vector_impl(agg_states, types, offsets, filter, start_row, end_row,   \
+										 value_arg, cmp_arg, IS_FIRST, 4, agg_extra_mctx);         \
+				break;                                                                             \
+			default:                                                                               \
+				bookend_many_vector_impl(agg_states, types, offsets, filter, start_row, end_row,   \
+										 value_arg, cmp_arg, IS_FIRST, 8, agg_extra_mctx);         \
+				break;                                                                             \
+		}                                                                                          \
+	}
+
+BOOKEND_FUNCTIONS(first, true)
+BOOKEND_FUNCTIONS(last, false)
+
+#undef BOOKEND_FUNCTIONS
+
+static void
+bookend_serialize_polydatum(StringInfo buf, VectorAggArgumentTypes *types, int i, Datum value,
+							bool isnull)
+{
+	/* See polydatum_serialize(). */
+	pq_sendstring(buf, types->typnamespace[i]);
+	pq_sendstring(buf, types->typname[i]);
+
+	if (isnull)
+	{
+		pq_sendint32(buf, -1);
+		return;
+	}
+
+	bytea *outputbytes = SendFunctionCall(&types->send_proc[i], value);
+	pq_sendint32(buf, VARSIZE(outputbytes) - VARHDRSZ);
+	pq_sendbytes(buf, VARDATA(outputbytes), VARSIZE(outputbytes) - VARHDRSZ);
+}
+
+static void
+bookend_emit(void *restrict agg_state, VectorAggArgumentTypes *types, Datum *out_result,
+			 bool *out_isnull)
+{
+	BookendState *state = (BookendState *) agg_state;
+
+	/*
+	 * Without any input rows, the Postgres transition state stays null, and so
+	 * does the partial result.
+	 */
+	if (!state->isvalid)
+	{
+		*out_result = 0;
+		*out_isnull = true;
+		return;
+	}
+
+	StringInfoData buf;
+	pq_begintypsend(&buf);
+	bookend_serialize_polydatum(&buf, types, 0, state->value, state->value_isnull);
+	bookend_serialize_polydatum(&buf,
+								types,
+								1,
+								bookend_cmp_to_datum(state->cmp, types->typlen[1]),
+								state->cmp_isnull);
+	*out_result = PointerGetDatum(pq_endtypsend(&buf));
+	*out_isnull = false;
+}
+
+static VectorAggFunctions first_agg = {
+	.state_bytes = sizeof(BookendState),
+	.agg_init = bookend_init,
+	.agg_vector2 = first_vector,
+	.agg_many_vector2 = first_many_vector,
+	.agg_emit2 = bookend_emit,
+};
+
+static VectorAggFunctions last_agg = {
+	.state_bytes = sizeof(BookendState),
+	.agg_init = bookend_init,
+	.agg_vector2 = last_vector,
+	.agg_many_vector2 = last_many_vector,
+	.agg_emit2 = bookend_emit,
+};
+
+static Oid first_func_oid = InvalidOid;
+static Oid last_func_oid = InvalidOid;
+
+static Oid
+lookup_bookend_func(char *name)
+{
+	Oid argtypes[] = { ANYELEMENTOID, ANYOID };
+	List *qualified_name = list_make2(makeString(ts_extension_schema_name()), makeString(name));
+	return LookupFuncName(qualified_name, lengthof(argtypes), argtypes, /* missing_ok = */ true);
+}
+
+/*
+ * Return the vectorized implementation if the given aggregate function is
+ * first() or last().
+ */
+VectorAggFunctions *
+get_vector_bookend_aggregate(Oid aggfnoid)
+{
+	if (!OidIsValid(first_func_oid))
+		first_func_oid = lookup_bookend_func("first");
+	if (!OidIsValid(last_func_oid))
+		last_func_oid = lookup_bookend_func("last");
+
+	if (aggfnoid == first_func_oid)
+		return &first_agg;
+	if (aggfnoid == last_func_oid)
+		return &last_agg;
+	return NULL;
+}
+
+/*
+ * Whether the vectorized first() and last() support the given argument types.
+ */
+bool
+vector_bookend_supports_types(Oid value_type, Oid cmp_type)
+{
+	switch (cmp_type)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			break;
+		default:
+			return false;
+	}
+
+	if (value_type == TEXTOID)
+	{
+		return true;
+	}
+
+	int16 typlen;
+	bool typbyval;
+	get_typlenbyval(value_type, &typlen, &typbyval);
+	return typbyval && (typlen == 2 || typlen == 4 || typlen == 8);
+}
@@ -8,11 +8,15 @@
 
 #include <postgres.h>
 
+#include <access/htup_details.h>
+#include <catalog/pg_type.h>
 #include <common/int.h>
 #include <utils/date.h>
 #include <utils/float.h>
 #include <utils/fmgroids.h>
 #include <utils/fmgrprotos.h>
+#include <utils/lsyscache.h>
+#include <utils/syscache.h>
 
 #include "functions.h"
 
@@ -195,11 +199,42 @@ VectorAggFunctions count_any_agg = {
 
 /*
  * Return the vector aggregate definition corresponding to the given
- * PG aggregate function Oid.
+ * PG aggregate function Oid and the type of its first argument, which is
+ * InvalidOid for count(*).
  */
 VectorAggFunctions *
-get_vector_aggregate(Oid aggfnoid)
+get_vector_aggregate(Oid aggfnoid, Oid argtype)
 {
+	/*
+	 * The bookend aggregates first() and last(), approx_count_distinct(),
+	 * quantile_sketch() and histogram() are defined by our extension, so they
+	 * don't have fixed oids.
+	 */
+	VectorAggFunctions *bookend = get_vector_bookend_aggregate(aggfnoid);
+	if (bookend != NULL)
+	{
+		return bookend;
+	}
+
+	VectorAggFunctions *approx_count_distinct =
+		get_vector_approx_count_distinct_aggregate(aggfnoid, argtype);
+	if (approx_count_distinct != NULL)
+	{
+		return approx_count_distinct;
+	}
+
+	VectorAggFunctions *quantile_sketch = get_vector_quantile_sketch_aggregate(aggfnoid);
+	if (quantile_sketch != NULL)
+	{
+		return quantile_sketch;
+	}
+
+	VectorAggFunctions *histogram = get_vector_histogram_aggregate(aggfnoid);
+	if (histogram != NULL)
+	{
+		return histogram;
+	}
+
 	switch (aggfnoid)
 	{
 		case F_COUNT_:
@@ -218,3 +253,31 @@ get_vector_aggregate(Oid aggfnoid)
 			return NULL;
 	}
 }
+
+/*
+ * Fill the argument type information for a two-argument aggregate function.
+ */
+void
+vector_agg_argument_types_init(VectorAggArgumentTypes *types, Oid type1, Oid type2)
+{
+	const Oid typids[2] = { type1, type2 };
+	for (int i = 0; i < 2; i++)
+	{
+		types->typid[i] = typids[i];
+		get_typlenbyval(typids[i], &types->typlen[i], &types->typbyval[i]);
+
+		/* See polydatum_serialize_type(). */
+		HeapTuple tup = SearchSysCache1(TYPEOID, ObjectIdGetDatum(typids[i]));
+		if (!HeapTupleIsValid(tup))
+			elog(ERROR, "cache lookup failed for type %u", typids[i]);
+		Form_pg_type type_tuple = (Form_pg_type) GETSTRUCT(tup);
+		types->typnamespace[i] = get_namespace_name(type_tuple->typnamespace);
+		types->typname[i] = pstrdup(NameStr(type_tuple->typname));
+		ReleaseSysCache(tup);
+
+		Oid send_func;
+		bool is_varlena;
+		getTypeBinaryOutputInfo(typids[i], &send_func, &is_varlena);
+		fmgr_info(send_func, &types->send_proc[i]);
+	}
+}
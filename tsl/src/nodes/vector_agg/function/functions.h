@@ -6,8 +6,57 @@
 
 #pragma once
 
+#include <postgres.h>
+#include <fmgr.h>
+#include <nodes/primnodes.h>
+
 #include <compression/arrow_c_data_interface.h>
 
+struct CompressedColumnValues;
+
+/*
+ * The simple aggregate functions over one arrow array, such as sum() and
+ * min(), are additionally compiled for the wider vector instruction sets, and
+ * the variant supported by the CPU is selected at load time. The other
+ * functions are not, because the fused multiply-add instructions available
+ * there would change the floating point results depending on the CPU.
+ */
+#ifdef TS_USE_TARGET_CLONES
+#define TS_VECTOR_AGG_TARGET_CLONES __attribute__((target_clones("default", "avx2", "avx512f")))
+#else
+#define TS_VECTOR_AGG_TARGET_CLONES
+#endif
+
+/*
+ * The types of the arguments of a two-argument aggregate function such as
+ * first(value, time). They are needed to copy the values into the aggregate
+ * function state, and to serialize the partial aggregation result.
+ */
+typedef struct VectorAggArgumentTypes
+{
+	Oid typid[2];
+	int16 typlen[2];
+	bool typbyval[2];
+
+	/* For serializing the partial result. */
+	char *typnamespace[2];
+	char *typname[2];
+	FmgrInfo send_proc[2];
+} VectorAggArgumentTypes;
+
+/*
+ * Which batch metadata can replace the aggregate function argument for the
+ * batches where all rows pass the filters.
+ */
+typedef enum
+{
+	VAMD_None = 0,
+	VAMD_Min,
+	VAMD_Max,
+} VectorAggMetadata;
+
+typedef struct VectorAggFunctions VectorAggFunctions;
+
 /*
  * Function table for a vectorized implementation of an aggregate function.
  *
@@ -18,7 +67,7 @@
  * state (no grouping keys), and to multiple aggregate function states laid out
  * contiguously in memory.
  */
-typedef struct
+struct VectorAggFunctions
 {
 	/* Size of the aggregate function state. */
 	size_t state_bytes;
@@ -55,6 +104,83 @@ typedef struct
 
 	/* Emit a partial aggregation result. */
 	void (*agg_emit)(void *restrict agg_state, Datum *out_result, bool *out_isnull);
-} VectorAggFunctions;
 
-VectorAggFunctions *get_vector_aggregate(Oid aggfnoid);
+	/*
+	 * The min() and max() of a batch can be computed from its min/max
+	 * metadata without decompressing it.
+	 */
+	VectorAggMetadata batch_metadata;
+
+	/*
+	 * The function supports only the scalar arguments, i.e. the segmentby
+	 * columns, and the vector functions above are not set.
+	 */
+	bool scalar_argument_only;
+
+	/*
+	 * The aggregate functions with two arguments, such as first(value, time),
+	 * use these functions instead of the one-argument ones above. The
+	 * arguments can be arrow arrays or scalars. The rows where the arguments
+	 * are null are not excluded by the filter, so they have to be handled by
+	 * the function itself.
+	 */
+	void (*agg_vector2)(void *restrict agg_state, const VectorAggArgumentTypes *types,
+						const struct CompressedColumnValues *arg1,
+						const struct CompressedColumnValues *arg2, const uint64 *filter, int n,
+						MemoryContext agg_extra_mctx);
+
+	void (*agg_many_vector2)(void *restrict agg_states, const VectorAggArgumentTypes *types,
+							 const uint32 *offsets, const uint64 *filter, int start_row,
+							 int end_row, const struct CompressedColumnValues *arg1,
+							 const struct CompressedColumnValues *arg2,
+							 MemoryContext agg_extra_mctx);
+
+	void (*agg_emit2)(void *restrict agg_state, VectorAggArgumentTypes *types, Datum *out_result,
+					  bool *out_isnull);
+
+	/*
+	 * The aggregate functions with constant parameters after the first
+	 * argument, such as histogram(value, min, max, nbuckets), read them from
+	 * the aggregate function call into agg_params. This is done for the copy
+	 * of this table in the aggregate definition. Returns false when the
+	 * parameters are not supported by the vectorized implementation.
+	 */
+	bool (*agg_prepare)(VectorAggFunctions *func, const Aggref *aggref);
+	const void *agg_params;
+
+	/* Used instead of agg_init for the functions with parameters. */
+	void (*agg_init_params)(void *restrict agg_states, int n, const void *params);
+
+	/*
+	 * The function is not strict, so the rows where the argument is null are
+	 * not excluded by the filter, and the function has to check the validity
+	 * bitmap of the argument itself.
+	 */
+	bool nonstrict;
+};
+
+/*
+ * Initialize the n aggregate function states stored contiguously at the given
+ * pointer.
+ */
+static inline void
+vector_agg_init_states(const VectorAggFunctions *func, void *restrict agg_states, int n)
+{
+	if (func->agg_init_params != NULL)
+	{
+		func->agg_init_params(agg_states, n, func->agg_params);
+	}
+	else
+	{
+		func->agg_init(agg_states, n);
+	}
+}
+
+VectorAggFunctions *get_vector_aggregate(Oid aggfnoid, Oid argtype);
+
+extern VectorAggFunctions *get_vector_bookend_aggregate(Oid aggfnoid);
+extern bool vector_bookend_supports_types(Oid value_type, Oid cmp_type);
+extern VectorAggFunctions *get_vector_approx_count_distinct_aggregate(Oid aggfnoid, Oid argtype);
+extern VectorAggFunctions *get_vector_quantile_sketch_aggregate(Oid aggfnoid);
+extern VectorAggFunctions *get_vector_histogram_aggregate(Oid aggfnoid);
+extern void vector_agg_argument_types_init(VectorAggArgumentTypes *types, Oid type1, Oid type2);
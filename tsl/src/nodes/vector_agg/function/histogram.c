@@ -0,0 +1,409 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Vectorized implementation of histogram(double precision, double precision,
+ * double precision, integer). The bucket boundaries and the number of buckets
+ * must be constants. The partial results are serialized in the format of
+ * ts_hist_serializefunc(), so they are combined by the Postgres final
+ * aggregation.
+ */
+
+#include <postgres.h>
+
+#include <math.h>
+
+#include <catalog/pg_type.h>
+#include <libpq/pqformat.h>
+#include <nodes/makefuncs.h>
+#include <parser/parse_func.h>
+#include <utils/memutils.h>
+
+#include "compat/compat.h"
+#include "extension.h"
+#include "functions.h"
+
+typedef struct HistogramParams
+{
+	double min;
+	double max;
+	int32 nbuckets;
+
+	/*
+	 * The bounds are so far apart that their difference overflows, so the
+	 * bucket is computed from the halved values, like width_bucket_float8()
+	 * does.
+	 */
+	bool halved;
+} HistogramParams;
+
+typedef struct HistogramState
+{
+	const HistogramParams *params;
+
+	/*
+	 * The counts for the nbuckets buckets and the two buckets for the values
+	 * outside of the range, allocated when the first row is added.
+	 */
+	int64 *counts;
+} HistogramState;
+
+/* The rows are processed in blocks of one word of the filter bitmap. */
+#define HISTOGRAM_BLOCK_ROWS 64
+
+static bool
+histogram_prepare(VectorAggFunctions *func, const Aggref *aggref)
+{
+	Const *params[3];
+
+	Assert(list_length(aggref->args) == 4);
+	for (int i = 0; i < 3; i++)
+	{
+		Expr *expr = castNode(TargetEntry, list_nth(aggref->args, i + 1))->expr;
+		if (!IsA(expr, Const) || castNode(Const, expr)->constisnull)
+		{
+			return false;
+		}
+		params[i] = castNode(Const, expr);
+	}
+
+	const double min = DatumGetFloat8(params[0]->constvalue);
+	const double max = DatumGetFloat8(params[1]->constvalue);
+	const int32 nbuckets = DatumGetInt32(params[2]->constvalue);
+
+	/*
+	 * The other parameters lead to errors in ts_hist_sfunc() or
+	 * width_bucket_float8(), so leave them to the Postgres aggregation. This
+	 * also excludes NaN bounds.
+	 */
+	if (!(min < max) || isinf(min) || isinf(max) || nbuckets <= 0 ||
+		(Size) nbuckets + 2 > MaxAllocSize / sizeof(int64))
+	{
+		return false;
+	}
+
+	HistogramParams *result = palloc(sizeof(HistogramParams));
+	result->min = min;
+	result->max = max;
+	result->nbuckets = nbuckets;
+	result->halved = isinf(max - min);
+	func->agg_params = result;
+	return true;
+}
+
+static void
+histogram_init(void *restrict agg_states, int n, const void *params)
+{
+	HistogramState *states = (HistogramState *) agg_states;
+	for (int i = 0; i < n; i++)
+	{
+		states[i].params = (const HistogramParams *) params;
+		states[i].counts = NULL;
+	}
+}
+
+static void
+histogram_emit(void *agg_state, Datum *out_result, bool *out_isnull)
+{
+	HistogramState *state = (HistogramState *) agg_state;
+
+	/*
+	 * The Postgres aggregation has a null state when no rows are aggregated,
+	 * e.g. because of the FILTER clause, so do the same.
+	 */
+	if (state->counts == NULL)
+	{
+		*out_result = (Datum) 0;
+		*out_isnull = true;
+		return;
+	}
+
+	const int32 nbuckets = state->params->nbuckets + 2;
+	StringInfoData buf;
+
+	pq_begintypsend(&buf);
+	pq_sendint32(&buf, nbuckets);
+	for (int32 i = 0; i < nbuckets; i++)
+	{
+		/* ts_hist_sfunc() does not let a bucket count exceed this. */
+		if (state->counts[i] > PG_INT32_MAX - 1)
+			elog(ERROR, "overflow in histogram");
+
+		pq_sendint32(&buf, (int32) state->counts[i]);
+	}
+
+	*out_result = PointerGetDatum(pq_endtypsend(&buf));
+	*out_isnull = false;
+}
+
+static pg_attribute_always_inline int64 *
+histogram_counts(HistogramState *state, MemoryContext agg_extra_mctx)
+{
+	if (unlikely(state->counts == NULL))
+	{
+		state->counts = MemoryContextAllocZero(agg_extra_mctx,
+											   sizeof(int64) * (state->params->nbuckets + 2));
+	}
+	return state->counts;
+}
+
+static pg_noinline void
+histogram_nan_error(void)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_ARGUMENT_FOR_WIDTH_BUCKET_FUNCTION),
+			 errmsg("operand, lower bound, and upper bound cannot be NaN")));
+	pg_unreachable();
+}
+
+/*
+ * Compute width_bucket_float8() with the given parameters. Must give the same
+ * results for the finite bounds with min < max that are allowed by
+ * histogram_prepare(), and is written without branches so that the compiler
+ * can vectorize the loops over the rows. The result for NaN is arbitrary, the
+ * callers have to check for it.
+ */
+static pg_attribute_always_inline int32
+histogram_bucket(double value, double min, double max, int32 nbuckets, bool halved)
+{
+	const double quotient =
+		halved ? (value / 2 - min / 2) / (max / 2 - min / 2) : (value - min) / (max - min);
+	double scaled = nbuckets * quotient;
+
+	/*
+	 * The values outside of the range are handled below, this only guards
+	 * the conversion of the out of range values to integer. The quotient
+	 * could also round to 1.0, which width_bucket_float8() clamps as well.
+	 */
+	scaled = scaled >= 0 ? scaled : 0;
+	scaled = scaled < nbuckets - 1 ? scaled : nbuckets - 1;
+	const int32 bucket = ((int32) scaled) + 1;
+
+	return value < min ? 0 : (value >= max ? nbuckets + 1 : bucket);
+}
+
+/*
+ * Compute the buckets for a block of rows. The null rows are counted as zero,
+ * because ts_hist_sfunc() is not strict and reads the value of a null argument
+ * as zero.
+ */
+static pg_attribute_always_inline void
+histogram_block_buckets(const HistogramParams *params, const double *values,
+						const uint64 *validity, int start_row, int end_row, int32 *buckets)
+{
+	const double min = params->min;
+	const double max = params->max;
+	const int32 nbuckets = params->nbuckets;
+
+	Assert(end_row - start_row <= HISTOGRAM_BLOCK_ROWS);
+
+#define BUCKETS_LOOP(HALVED)                                                                       \
+	for (int row = start_row; row < end_row; row++)                                                \
+	{                                                                                              \
+		const double value = arrow_row_is_valid(validity, row) ? values[row] : 0;                  \
+		buckets[row - start_row] = histogram_bucket(value, min, max, nbuckets, HALVED);            \
+	}
+
+	if (params->halved)
+	{
+		BUCKETS_LOOP(true);
+	}
+	else
+	{
+		BUCKETS_LOOP(false);
+	}
+#undef BUCKETS_LOOP
+}
+
+static void
+histogram_vector(void *agg_state, const ArrowArray *vector, const uint64 *filter,
+				 MemoryContext agg_extra_mctx)
+{
+	HistogramState *state = (HistogramState *) agg_state;
+	const double *values = vector->buffers[1];
+	const uint64 *validity = vector->buffers[0];
+	const int n = vector->length;
+	int32 buckets[HISTOGRAM_BLOCK_ROWS];
+	int64 *counts = NULL;
+
+	for (int block_start = 0; block_start < n; block_start += HISTOGRAM_BLOCK_ROWS)
+	{
+		const int block_end = Min(n, block_start + HISTOGRAM_BLOCK_ROWS);
+		const uint64 block_filter = filter != NULL ? filter[block_start / 64] : ~UINT64CONST(0);
+		if (block_filter == 0)
+		{
+			continue;
+		}
+
+		histogram_block_buckets(state->params, values, validity, block_start, block_end, buckets);
+
+		if (counts == NULL)
+		{
+			counts = histogram_counts(state, agg_extra_mctx);
+		}
+
+		for (int row = block_start; row < block_end; row++)
+		{
+			if (!arrow_row_is_valid(filter, row))
+			{
+				continue;
+			}
+
+			if (unlikely(isnan(values[row])) && arrow_row_is_valid(validity, row))
+			{
+				histogram_nan_error();
+			}
+
+			counts[buckets[row - block_start]]++;
+		}
+	}
+}
+
+static void
+histogram_many_vector(void *restrict agg_states, const uint32 *offsets, const uint64 *filter,
+					  int start_row, int end_row, const ArrowArray *vector,
+					  MemoryContext agg_extra_mctx)
+{
+	HistogramState *states = (HistogramState *) agg_states;
+	const double *values = vector->buffers[1];
+	const uint64 *validity = vector->buffers[0];
+	int32 buckets[HISTOGRAM_BLOCK_ROWS];
+
+	for (int block_start = start_row; block_start < end_row; block_start += HISTOGRAM_BLOCK_ROWS)
+	{
+		const int block_end = Min(end_row, block_start + HISTOGRAM_BLOCK_ROWS);
+		bool computed = false;
+
+		for (int row = block_start; row < block_end; row++)
+		{
+			if (!arrow_row_is_valid(filter, row))
+			{
+				continue;
+			}
+
+			HistogramState *state = &states[offsets[row]];
+			if (!computed)
+			{
+				/* All states of an aggregate definition have the same parameters. */
+				histogram_block_buckets(state->params,
+										values,
+										validity,
+										block_start,
+										block_end,
+										buckets);
+				computed = true;
+			}
+
+			if (unlikely(isnan(values[row])) && arrow_row_is_valid(validity, row))
+			{
+				histogram_nan_error();
+			}
+
+			histogram_counts(state, agg_extra_mctx)[buckets[row - block_start]]++;
+		}
+	}
+}
+
+static pg_attribute_always_inline int32
+histogram_scalar_bucket(const HistogramParams *params, Datum constvalue, bool constisnull)
+{
+	/* See histogram_block_buckets() for the nulls. */
+	const double value = constisnull ? 0 : DatumGetFloat8(constvalue);
+	if (isnan(value))
+	{
+		histogram_nan_error();
+	}
+
+	return histogram_bucket(value, params->min, params->max, params->nbuckets, params->halved);
+}
+
+static void
+histogram_scalar(void *agg_state, Datum constvalue, bool constisnull, int n,
+				 MemoryContext agg_extra_mctx)
+{
+	HistogramState *state = (HistogramState *) agg_state;
+
+	if (n == 0)
+	{
+		return;
+	}
+
+	const int32 bucket = histogram_scalar_bucket(state->params, constvalue, constisnull);
+	histogram_counts(state, agg_extra_mctx)[bucket] += n;
+}
+
+static void
+histogram_many_scalar(void *restrict agg_states, const uint32 *offsets, const uint64 *filter,
+					  int start_row, int end_row, Datum constvalue, bool constisnull,
+					  MemoryContext agg_extra_mctx)
+{
+	HistogramState *states = (HistogramState *) agg_states;
+	int32 bucket = -1;
+
+	for (int row = start_row; row < end_row; row++)
+	{
+		if (!arrow_row_is_valid(filter, row))
+		{
+			continue;
+		}
+
+		HistogramState *state = &states[offsets[row]];
+		if (bucket < 0)
+		{
+			bucket = histogram_scalar_bucket(state->params, constvalue, constisnull);
+		}
+
+		histogram_counts(state, agg_extra_mctx)[bucket]++;
+	}
+}
+
+static VectorAggFunctions histogram_agg = {
+	.state_bytes = sizeof(HistogramState),
+	.agg_prepare = histogram_prepare,
+	.agg_init_params = histogram_init,
+	.agg_emit = histogram_emit,
+	.agg_vector = histogram_vector,
+	.agg_many_vector = histogram_many_vector,
+	.agg_scalar = histogram_scalar,
+	.agg_many_scalar = histogram_many_scalar,
+	.nonstrict = true,
+};
+
+static Oid histogram_oid = InvalidOid;
+
+/*
+ * Return the vectorized implementation if the given aggregate function is
+ * histogram(double precision, double precision, double precision, integer).
+ */
+VectorAggFunctions *
+get_vector_histogram_aggregate(Oid aggfnoid)
+{
+#if PG16_LT
+	/*
+	 * The bucket computation follows width_bucket_float8() of PG16 and later,
+	 * which differs from the earlier versions.
+	 */
+	return NULL;
+#else
+	if (!OidIsValid(histogram_oid))
+	{
+		Oid argtypes[] = { FLOAT8OID, FLOAT8OID, FLOAT8OID, INT4OID };
+		List *qualified_name =
+			list_make2(makeString(ts_extension_schema_name()), makeString("histogram"));
+		histogram_oid = LookupFuncName(qualified_name,
+									   lengthof(argtypes),
+									   argtypes,
+									   /* missing_ok = */ true);
+	}
+
+	if (aggfnoid != histogram_oid)
+	{
+		return NULL;
+	}
+
+	return &histogram_agg;
+#endif
+}
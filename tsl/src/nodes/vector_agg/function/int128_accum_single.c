@@ -38,11 +38,26 @@ FUNCTION_NAME(init)(void *restrict agg_states, int n)
 	}
 }
 
+/*
+ * Write the serialized state directly, in the format of numeric_poly_serialize()
+ * or int8_avg_serialize(), instead of converting the sums to NumericVar first.
+ */
 static void
 FUNCTION_NAME(emit)(void *agg_state, Datum *out_result, bool *out_isnull)
 {
 	FUNCTION_NAME(state) *state = (FUNCTION_NAME(state) *) agg_state;
+	StringInfoData buf;
+
+	pq_begintypsend(&buf);
+	pq_sendint64(&buf, state->N);
+	int128_serialize_numericvar(&buf, state->sumX);
+#ifdef NEED_SUMX2
+	int128_serialize_numericvar(&buf, state->sumX2);
+#endif
+	bytea *serialized = pq_endtypsend(&buf);
 
+#ifdef USE_ASSERT_CHECKING
+	/* Check that the format is the same as the one of the Postgres function. */
 	PgInt128AggState result = {
 		.N = state->N,
 		.sumX = state->sumX,
@@ -63,11 +78,17 @@ FUNCTION_NAME(emit)(void *agg_state, Datum *out_result, bool *out_isnull)
 	fcinfo->args[0].isnull = false;
 
 #ifdef NEED_SUMX2
-	*out_result = numeric_poly_serialize(fcinfo);
+	bytea *expected = DatumGetByteaPP(numeric_poly_serialize(fcinfo));
 #else
-	*out_result = int8_avg_serialize(fcinfo);
+	bytea *expected = DatumGetByteaPP(int8_avg_serialize(fcinfo));
+#endif
+	Assert(VARSIZE_ANY_EXHDR(expected) == VARSIZE_ANY_EXHDR(serialized));
+	Assert(memcmp(VARDATA_ANY(expected), VARDATA_ANY(serialized), VARSIZE_ANY_EXHDR(expected)) ==
+		   0);
+	pfree(expected);
 #endif
 
+	*out_result = PointerGetDatum(serialized);
 	*out_isnull = false;
 }
 
@@ -10,6 +10,7 @@
 
 #include <postgres.h>
 
+#include <libpq/pqformat.h>
 #include <nodes/execnodes.h>
 #include <utils/fmgroids.h>
 #include <utils/fmgrprotos.h>
@@ -30,6 +31,42 @@ typedef struct
 	int128 sumX;	/* sum of processed numbers */
 	int128 sumX2;	/* sum of squares of processed numbers */
 } PgInt128AggState;
+
+/*
+ * The NumericVar constants used by the serialization. Copied from numeric.c.
+ */
+#define PG_NUMERIC_NBASE 10000
+#define PG_NUMERIC_POS 0x0000
+#define PG_NUMERIC_NEG 0x4000
+
+/*
+ * Serialize the int128 in the same format as numericvar_serialize() of the
+ * int128_to_numericvar() result in numeric.c, without building the
+ * NumericVar: the base 10000 digits with the most significant first and the
+ * trailing zero digits not stripped, weight ndigits - 1 and display scale 0.
+ * Zero has no digits and weight 0.
+ */
+static void
+int128_serialize_numericvar(StringInfo buf, int128 value)
+{
+	/* An int128 has at most 39 decimal digits */
+	int16 digits[10];
+	int ndigits = 0;
+	uint128 uvalue = value < 0 ? -(uint128) value : (uint128) value;
+
+	while (uvalue != 0)
+	{
+		digits[ndigits++] = (int16) (uvalue % PG_NUMERIC_NBASE);
+		uvalue /= PG_NUMERIC_NBASE;
+	}
+
+	pq_sendint32(buf, ndigits);
+	pq_sendint32(buf, ndigits > 0 ? ndigits - 1 : 0);
+	pq_sendint32(buf, value < 0 ? PG_NUMERIC_NEG : PG_NUMERIC_POS);
+	pq_sendint32(buf, 0);
+	for (int i = ndigits - 1; i >= 0; i--)
+		pq_sendint16(buf, digits[i]);
+}
 #endif
 
 /*
@@ -17,25 +17,54 @@ FUNCTION_NAME(vector_impl)(void *agg_state, int n, const CTYPE *values, const ui
 	Int24SumState *state = (Int24SumState *) agg_state;
 
 	/*
-	 * We accumulate the sum as int64, so we can sum INT_MAX = 2^31 - 1
-	 * at least 2^31 times without incurring an overflow of the int64
-	 * accumulator. The same is true for negative numbers. The
-	 * compressed batch size is currently capped at 1000 rows, but even
-	 * if it's changed in the future, it's unlikely that we support
-	 * batches larger than 65536 rows, not to mention 2^31. Therefore,
-	 * we don't need to check for overflows within the loop, which would
-	 * slow down the calculation.
+	 * We accumulate the sum as int64, and the magnitude of every value is at
+	 * most 2^31, so summing up to 2^32 values can't overflow the int64
+	 * accumulator. The compressed batches have at most
+	 * GLOBAL_MAX_ROWS_PER_COMPRESSION = INT16_MAX rows, so the sum of a batch
+	 * is less than 2^15 * 2^31 = 2^46 in magnitude, and even n = INT_MAX
+	 * would be safe. Therefore, we don't need to check for overflows within
+	 * the loop, which would slow down the calculation, only when adding the
+	 * batch sum to the result.
 	 */
 	Assert(n <= INT_MAX);
 
 	/*
-	 * Note that we use a simplest loop here, there are many possibilities of
-	 * optimizing this function (for example, this loop is not unrolled by
-	 * clang-16).
+	 * Process the rows by the 64-row validity words. For the words where all
+	 * rows pass, we don't have to look at the individual bits, and the loop
+	 * is a plain widening sum. The words where no rows pass are skipped.
 	 */
 	int64 batch_sum = 0;
 	bool have_result = false;
-	for (int row = 0; row < n; row++)
+	const int full_words = n / 64;
+	for (int word = 0; word < full_words; word++)
+	{
+		const uint64 validity = filter == NULL ? ~0ULL : filter[word];
+		if (validity == 0)
+		{
+			continue;
+		}
+
+		have_result = true;
+
+		int64 word_sum = 0;
+		if (validity == ~0ULL)
+		{
+			for (int row = word * 64; row < (word + 1) * 64; row++)
+			{
+				word_sum += values[row];
+			}
+		}
+		else
+		{
+			for (int row = word * 64; row < (word + 1) * 64; row++)
+			{
+				word_sum += values[row] * (int64) ((validity >> (row % 64)) & 1);
+			}
+		}
+		batch_sum += word_sum;
+	}
+
+	for (int row = full_words * 64; row < n; row++)
 	{
 		const bool row_ok = arrow_row_is_valid(filter, row);
 		batch_sum += values[row] * row_ok;
@@ -63,6 +92,7 @@ typedef Int24SumState FUNCTION_NAME(state);
 
 #include "agg_many_vector_helper.c"
 #include "agg_scalar_helper.c"
+#define AGG_VECTOR_TARGET TS_VECTOR_AGG_TARGET_CLONES
 #include "agg_vector_validity_helper.c"
 
 VectorAggFunctions FUNCTION_NAME(argdef) = {
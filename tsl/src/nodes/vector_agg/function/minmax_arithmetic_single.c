@@ -15,22 +15,79 @@ FUNCTION_NAME(vector_impl)(void *agg_state, int n, const CTYPE *values, const ui
 {
 	MinMaxState *state = (MinMaxState *) agg_state;
 
+	/*
+	 * The rows are split between several independent accumulators, so that
+	 * the loop has no dependency between the consecutive rows, and can be
+	 * vectorized using the blend instructions. The accumulators are combined
+	 * in the end using the same predicate, which handles the NaNs in an
+	 * order-independent way.
+	 */
+#define UNROLL_SIZE ((int) (512 / 8 / sizeof(CTYPE)))
+	StaticAssertStmt(64 % UNROLL_SIZE == 0, "the unrolled rows must fit into a validity word");
+
+	CTYPE result_accu[UNROLL_SIZE] = { 0 };
+	bool isvalid_accu[UNROLL_SIZE] = { 0 };
+
+	/*
+	 * Note that we have to properly handle NaNs and Infinities for floats.
+	 */
+#define INNER_LOOP(ROW_VALID)                                                                      	const CTYPE new_value = values[row];                                                           	const bool do_replace =                                                                        		(ROW_VALID) && (!isvalid_accu[inner] || PREDICATE(result_accu[inner], new_value));         	result_accu[inner] = do_replace ? new_value : result_accu[inner];                              	isvalid_accu[inner] = isvalid_accu[inner] || do_replace;
+
+	/*
+	 * Process the rows by the 64-row validity words, skipping the words where
+	 * no rows pass, and not looking at the individual bits for the words where
+	 * all rows pass.
+	 */
+	const int full_words = n / 64;
+	for (int word = 0; word < full_words; word++)
+	{
+		const uint64 validity = filter == NULL ? ~0ULL : filter[word];
+		if (validity == 0)
+		{
+			continue;
+		}
+
+		if (validity == ~0ULL)
+		{
+			for (int outer = word * 64; outer < (word + 1) * 64; outer += UNROLL_SIZE)
+			{
+				for (int inner = 0; inner < UNROLL_SIZE; inner++)
+				{
+					const int row = outer + inner;
+					INNER_LOOP(true)
+				}
+			}
+		}
+		else
+		{
+			for (int outer = word * 64; outer < (word + 1) * 64; outer += UNROLL_SIZE)
+			{
+				for (int inner = 0; inner < UNROLL_SIZE; inner++)
+				{
+					const int row = outer + inner;
+					INNER_LOOP((validity >> (row % 64)) & 1)
+				}
+			}
+		}
+	}
+
+	for (int row = full_words * 64; row < n; row++)
+	{
+		const int inner = 0;
+		INNER_LOOP(arrow_row_is_valid(filter, row))
+	}
+#undef INNER_LOOP
+
 	CTYPE outer_result = state->isvalid ? DATUM_TO_CTYPE(state->value) : 0;
 	bool outer_isvalid = state->isvalid;
-	for (int row = 0; row < n; row++)
+	for (int i = 0; i < UNROLL_SIZE; i++)
 	{
-		const CTYPE new_value = values[row];
-		const bool new_value_ok = arrow_row_is_valid(filter, row);
-
-		/*
-		 * Note that we have to properly handle NaNs and Infinities for floats.
-		 */
 		const bool do_replace =
-			new_value_ok && (unlikely(!outer_isvalid) || PREDICATE(outer_result, new_value));
-
-		outer_result = do_replace ? new_value : outer_result;
+			isvalid_accu[i] && (!outer_isvalid || PREDICATE(outer_result, result_accu[i]));
+		outer_result = do_replace ? result_accu[i] : outer_result;
 		outer_isvalid = outer_isvalid || do_replace;
 	}
+#undef UNROLL_SIZE
 
 	state->isvalid = outer_isvalid;
 
@@ -59,6 +116,7 @@ FUNCTION_NAME(one)(void *restrict agg_state, const CTYPE value)
 
 #include "agg_many_vector_helper.c"
 #include "agg_scalar_helper.c"
+#define AGG_VECTOR_TARGET TS_VECTOR_AGG_TARGET_CLONES
 #include "agg_vector_validity_helper.c"
 
 VectorAggFunctions FUNCTION_NAME(argdef) = {
@@ -68,6 +126,7 @@ VectorAggFunctions FUNCTION_NAME(argdef) = {
 	.agg_scalar = FUNCTION_NAME(scalar),
 	.agg_vector = FUNCTION_NAME(vector),
 	.agg_many_vector = FUNCTION_NAME(many_vector),
+	.batch_metadata = BATCH_METADATA,
 };
 #endif
 
@@ -53,4 +53,5 @@
 #include "minmax_arithmetic_single.c"
 
 #undef PREDICATE
+#undef BATCH_METADATA
 #undef AGG_NAME
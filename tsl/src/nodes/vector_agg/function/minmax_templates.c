@@ -51,11 +51,13 @@ minmax_emit(void *agg_state, Datum *out_result, bool *out_isnull)
  * NaN handled similar to equivalent PG functions.
  */
 #define AGG_NAME MIN
+#define BATCH_METADATA VAMD_Min
 #define PREDICATE(CURRENT, NEW)                                                                    \
 	(unlikely(!isnan((double) (NEW))) && (isnan((double) (CURRENT)) || (CURRENT) > (NEW)))
 #include "minmax_arithmetic_types.c"
 
 #define AGG_NAME MAX
+#define BATCH_METADATA VAMD_Max
 #define PREDICATE(CURRENT, NEW)                                                                    \
 	(unlikely(!isnan((double) (CURRENT))) && (isnan((double) (NEW)) || (CURRENT) < (NEW)))
 #include "minmax_arithmetic_types.c"
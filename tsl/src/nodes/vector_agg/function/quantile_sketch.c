@@ -0,0 +1,146 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Vectorized implementation of quantile_sketch(double precision). The partial
+ * results are the serialized DDSketches in the format of
+ * ddsketch_serializefunc(), so they are combined by the Postgres final
+ * aggregation.
+ */
+
+#include <postgres.h>
+
+#include <catalog/pg_type.h>
+#include <nodes/makefuncs.h>
+#include <parser/parse_func.h>
+
+#include "ddsketch.h"
+#include "extension.h"
+#include "functions.h"
+
+static void
+quantile_sketch_init(void *restrict agg_states, int n)
+{
+	memset(agg_states, 0, sizeof(DDSketch) * n);
+}
+
+static void
+quantile_sketch_emit(void *agg_state, Datum *out_result, bool *out_isnull)
+{
+	DDSketch *state = (DDSketch *) agg_state;
+
+	/*
+	 * The Postgres aggregation has a null state when no rows are aggregated,
+	 * e.g. because of the FILTER clause, so do the same.
+	 */
+	if (dds_count(state) == 0)
+	{
+		*out_result = (Datum) 0;
+		*out_isnull = true;
+		return;
+	}
+
+	*out_result = PointerGetDatum(dds_serialize(state));
+	*out_isnull = false;
+}
+
+static void
+quantile_sketch_vector(void *agg_state, const ArrowArray *vector, const uint64 *filter,
+					   MemoryContext agg_extra_mctx)
+{
+	dds_add_values((DDSketch *) agg_state,
+				   (const double *) vector->buffers[1],
+				   filter,
+				   vector->length,
+				   agg_extra_mctx);
+}
+
+static void
+quantile_sketch_many_vector(void *restrict agg_states, const uint32 *offsets, const uint64 *filter,
+							int start_row, int end_row, const ArrowArray *vector,
+							MemoryContext agg_extra_mctx)
+{
+	DDSketch *states = (DDSketch *) agg_states;
+	const double *values = vector->buffers[1];
+	for (int row = start_row; row < end_row; row++)
+	{
+		if (arrow_row_is_valid(filter, row))
+		{
+			dds_add(&states[offsets[row]], values[row], 1, agg_extra_mctx);
+		}
+	}
+}
+
+static void
+quantile_sketch_scalar(void *agg_state, Datum constvalue, bool constisnull, int n,
+					   MemoryContext agg_extra_mctx)
+{
+	if (constisnull || n == 0)
+	{
+		return;
+	}
+
+	dds_add((DDSketch *) agg_state, DatumGetFloat8(constvalue), n, agg_extra_mctx);
+}
+
+static void
+quantile_sketch_many_scalar(void *restrict agg_states, const uint32 *offsets, const uint64 *filter,
+							int start_row, int end_row, Datum constvalue, bool constisnull,
+							MemoryContext agg_extra_mctx)
+{
+	if (constisnull)
+	{
+		return;
+	}
+
+	DDSketch *states = (DDSketch *) agg_states;
+	const double value = DatumGetFloat8(constvalue);
+	for (int row = start_row; row < end_row; row++)
+	{
+		if (arrow_row_is_valid(filter, row))
+		{
+			dds_add(&states[offsets[row]], value, 1, agg_extra_mctx);
+		}
+	}
+}
+
+static VectorAggFunctions quantile_sketch_agg = {
+	.state_bytes = sizeof(DDSketch),
+	.agg_init = quantile_sketch_init,
+	.agg_emit = quantile_sketch_emit,
+	.agg_vector = quantile_sketch_vector,
+	.agg_many_vector = quantile_sketch_many_vector,
+	.agg_scalar = quantile_sketch_scalar,
+	.agg_many_scalar = quantile_sketch_many_scalar,
+};
+
+static Oid quantile_sketch_oid = InvalidOid;
+
+/*
+ * Return the vectorized implementation if the given aggregate function is
+ * quantile_sketch(double precision).
+ */
+VectorAggFunctions *
+get_vector_quantile_sketch_aggregate(Oid aggfnoid)
+{
+	if (!OidIsValid(quantile_sketch_oid))
+	{
+		Oid argtypes[] = { FLOAT8OID };
+		List *qualified_name = list_make2(makeString(ts_extension_schema_name()),
+										  makeString("quantile_sketch"));
+		quantile_sketch_oid = LookupFuncName(qualified_name,
+											 lengthof(argtypes),
+											 argtypes,
+											 /* missing_ok = */ true);
+	}
+
+	if (aggfnoid != quantile_sketch_oid)
+	{
+		return NULL;
+	}
+
+	return &quantile_sketch_agg;
+}
@@ -29,55 +29,90 @@ FUNCTION_NAME(vector_impl)(void *agg_state, int n, const CTYPE *values, const ui
 	 * Vector registers can be up to 512 bits wide.
 	 */
 #define UNROLL_SIZE ((int) (512 / 8 / sizeof(CTYPE)))
+	StaticAssertStmt(64 % UNROLL_SIZE == 0, "the unrolled rows must fit into a validity word");
 
-	bool have_result_accu[UNROLL_SIZE] = { 0 };
+	bool have_result = false;
 	double sum_accu[UNROLL_SIZE] = { 0 };
-	for (int outer = 0; outer < UNROLL_SIZE * (n / UNROLL_SIZE); outer += UNROLL_SIZE)
+
+	/*
+	 * We're using a trick with bitmasking the numbers that don't pass the
+	 * filter, to allow for branchless code generation. This is analogous to
+	 * integer version where we just multiply the integers by bool, but for
+	 * floats we can't use multiplication because of infinities and NaNs.
+	 */
+#define INNER_LOOP(ROW_VALID)                                                                      	union                                                                                          	{                                                                                              		CTYPE f;                                                                                   		MASKTYPE m;                                                                                	} u = { .f = values[row] };                                                                    	u.m &= (ROW_VALID) ? ~(MASKTYPE) 0 : (MASKTYPE) 0;                                             	*dest += u.f;
+
+	/*
+	 * Process the rows by the 64-row validity words. The words where all rows
+	 * or no rows pass are common, and for them we don't have to look at the
+	 * individual bits. The row is always added to the accumulator number
+	 * row % UNROLL_SIZE, so the result doesn't depend on the filter.
+	 */
+	const int full_words = n / 64;
+	for (int word = 0; word < full_words; word++)
+	{
+		const uint64 validity = filter == NULL ? ~0ULL : filter[word];
+		if (validity == 0)
+		{
+			continue;
+		}
+
+		have_result = true;
+
+		if (validity == ~0ULL)
+		{
+			for (int outer = word * 64; outer < (word + 1) * 64; outer += UNROLL_SIZE)
+			{
+				for (int inner = 0; inner < UNROLL_SIZE; inner++)
+				{
+					sum_accu[inner] += values[outer + inner];
+				}
+			}
+		}
+		else
+		{
+			for (int outer = word * 64; outer < (word + 1) * 64; outer += UNROLL_SIZE)
+			{
+				for (int inner = 0; inner < UNROLL_SIZE; inner++)
+				{
+					const int row = outer + inner;
+					double *dest = &sum_accu[inner];
+					INNER_LOOP((validity >> (row % 64)) & 1)
+				}
+			}
+		}
+	}
+
+	for (int outer = full_words * 64; outer < UNROLL_SIZE * (n / UNROLL_SIZE);
+		 outer += UNROLL_SIZE)
 	{
 		for (int inner = 0; inner < UNROLL_SIZE; inner++)
 		{
 			const int row = outer + inner;
+			const bool row_valid = arrow_row_is_valid(filter, row);
 			double *dest = &sum_accu[inner];
-			bool *have_result = &have_result_accu[inner];
-			/*
-			 * We're using a trick with bitmasking the numbers that don't
-			 * pass the filter, to allow for branchless code generation. This is
-			 * analogous to integer version where we just multiply the integers
-			 * by bool, but for floats we can't use multiplication because of
-			 * infinities and NaNs.
-			 */
-#define INNER_LOOP                                                                                 \
-	const bool row_valid = arrow_row_is_valid(filter, row);                                        \
-	union                                                                                          \
-	{                                                                                              \
-		CTYPE f;                                                                                   \
-		MASKTYPE m;                                                                                \
-	} u = { .f = values[row] };                                                                    \
-	u.m &= row_valid ? ~(MASKTYPE) 0 : (MASKTYPE) 0;                                               \
-	*dest += u.f;                                                                                  \
-	*have_result = *have_result || row_valid;
-
-			INNER_LOOP
+			INNER_LOOP(row_valid)
+			have_result = have_result || row_valid;
 		}
 	}
 
 	for (int row = UNROLL_SIZE * (n / UNROLL_SIZE); row < n; row++)
 	{
+		const bool row_valid = arrow_row_is_valid(filter, row);
 		double *dest = &sum_accu[0];
-		bool *have_result = &have_result_accu[0];
-		INNER_LOOP
+		INNER_LOOP(row_valid)
+		have_result = have_result || row_valid;
 	}
 
 	for (int i = 1; i < UNROLL_SIZE; i++)
 	{
 		sum_accu[0] += sum_accu[i];
-		have_result_accu[0] = have_result_accu[0] || have_result_accu[i];
 	}
 #undef UNROLL_SIZE
 #undef INNER_LOOP
 
 	FloatSumState *state = (FloatSumState *) agg_state;
-	state->isvalid = state->isvalid || have_result_accu[0];
+	state->isvalid = state->isvalid || have_result;
 	state->result += sum_accu[0];
 }
 
@@ -93,6 +128,7 @@ FUNCTION_NAME(one)(void *restrict agg_state, const CTYPE value)
 
 #include "agg_many_vector_helper.c"
 #include "agg_scalar_helper.c"
+#define AGG_VECTOR_TARGET TS_VECTOR_AGG_TARGET_CLONES
 #include "agg_vector_validity_helper.c"
 
 VectorAggFunctions FUNCTION_NAME(argdef) = {
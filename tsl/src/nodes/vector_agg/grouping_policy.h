@@ -16,6 +16,8 @@ typedef struct VectorAggDef VectorAggDef;
 
 typedef struct GroupingColumn GroupingColumn;
 
+typedef struct ExplainState ExplainState;
+
 /*
  * This is a common interface for grouping policies which define how the rows
  * are grouped for aggregation -- e.g. there can be an implementation for no
@@ -29,6 +31,14 @@ typedef struct GroupingPolicy
 	 */
 	void (*gp_reset)(GroupingPolicy *gp);
 
+	/*
+	 * Start the next cycle of partial aggregation after the partial results
+	 * were emitted and the input continues. Can be NULL, then gp_reset is
+	 * used. The policies that keep a part of the aggregation state for the
+	 * subsequent input, like an unfinished group, use this to keep it.
+	 */
+	void (*gp_next_cycle)(GroupingPolicy *gp);
+
 	/*
 	 * Aggregate a single compressed batch.
 	 */
@@ -53,6 +63,12 @@ typedef struct GroupingPolicy
 	 * Description of this grouping policy for the EXPLAIN output.
 	 */
 	char *(*gp_explain)(GroupingPolicy *gp);
+
+	/*
+	 * Show the statistics of the grouping for EXPLAIN ANALYZE. Can be NULL if
+	 * the policy has no statistics.
+	 */
+	void (*gp_explain_stats)(GroupingPolicy *gp, ExplainState *es);
 } GroupingPolicy;
 
 /*
@@ -63,10 +79,13 @@ typedef enum
 {
 	VAGT_Invalid,
 	VAGT_Batch,
+	VAGT_Sorted,
 	VAGT_HashSingleFixed2,
 	VAGT_HashSingleFixed4,
 	VAGT_HashSingleFixed8,
+	VAGT_HashSingleFixed16,
 	VAGT_HashSingleText,
+	VAGT_HashPackedFixed16,
 	VAGT_HashSerialized,
 } VectorAggGroupingType;
 
@@ -74,6 +93,10 @@ extern GroupingPolicy *create_grouping_policy_batch(int num_agg_defs, VectorAggD
 													int num_grouping_columns,
 													GroupingColumn *grouping_columns);
 
+extern GroupingPolicy *create_grouping_policy_sorted(int num_agg_defs, VectorAggDef *agg_defs,
+													 int num_grouping_columns,
+													 GroupingColumn *grouping_columns);
+
 extern GroupingPolicy *create_grouping_policy_hash(int num_agg_defs, VectorAggDef *agg_defs,
 												   int num_grouping_columns,
 												   GroupingColumn *grouping_columns,
@@ -69,8 +69,9 @@ create_grouping_policy_batch(int num_agg_defs, VectorAggDef *agg_defs, int num_g
 	policy->num_agg_defs = num_agg_defs;
 	policy->agg_defs = agg_defs;
 
-	policy->agg_extra_mctx =
-		AllocSetContextCreate(CurrentMemoryContext, "agg extra", ALLOCSET_DEFAULT_SIZES);
+	policy->agg_extra_mctx = AllocSetContextCreate(CurrentMemoryContext,
+												   "VectorAgg grouping policy",
+												   ALLOCSET_DEFAULT_SIZES);
 
 	policy->agg_states = (void **) palloc(sizeof(*policy->agg_states) * policy->num_agg_defs);
 	for (int i = 0; i < policy->num_agg_defs; i++)
@@ -100,7 +101,7 @@ gp_batch_reset(GroupingPolicy *obj)
 	{
 		VectorAggDef *agg_def = &policy->agg_defs[i];
 		void *agg_state = policy->agg_states[i];
-		agg_def->func.agg_init(agg_state, 1);
+		vector_agg_init_states(&agg_def->func, agg_state, 1);
 	}
 
 	const int ngrp = policy->num_grouping_columns;
@@ -113,6 +114,50 @@ gp_batch_reset(GroupingPolicy *obj)
 	policy->have_results = false;
 }
 
+/*
+ * Compute an aggregate function with two arguments, like first(value, time).
+ * The nulls in the arguments are handled by the function itself.
+ */
+static void
+compute_two_argument_aggregate(GroupingPolicyBatch *policy, TupleTableSlot *vector_slot,
+							   VectorAggDef *agg_def, void *agg_state,
+							   MemoryContext agg_extra_mctx)
+{
+	uint16 total_batch_rows = 0;
+	const uint64 *vector_qual_result = vector_slot_get_qual_result(vector_slot, &total_batch_rows);
+
+	/*
+	 * Copy the column values, because the arrow tuple table slot reuses the
+	 * same storage for all columns.
+	 */
+	const CompressedColumnValues value_arg =
+		*vector_slot_get_compressed_column_values(vector_slot,
+												  AttrOffsetGetAttrNumber(agg_def->input_offset));
+	const CompressedColumnValues cmp_arg = *vector_slot_get_compressed_column_values(
+		vector_slot,
+		AttrOffsetGetAttrNumber(agg_def->second_input_offset));
+
+	Assert(value_arg.decompression_type != DT_Invalid);
+	Assert(value_arg.decompression_type != DT_Iterator);
+	Assert(cmp_arg.decompression_type != DT_Invalid);
+	Assert(cmp_arg.decompression_type != DT_Iterator);
+
+	const size_t num_words = (total_batch_rows + 63) / 64;
+	const uint64 *filter = arrow_combine_validity(num_words,
+												  policy->tmp_filter,
+												  vector_qual_result,
+												  agg_def->filter_result,
+												  NULL);
+
+	agg_def->func.agg_vector2(agg_state,
+							  agg_def->argument_types,
+							  &value_arg,
+							  &cmp_arg,
+							  filter,
+							  total_batch_rows,
+							  agg_extra_mctx);
+}
+
 static void
 compute_single_aggregate(GroupingPolicyBatch *policy, TupleTableSlot *vector_slot,
 						 VectorAggDef *agg_def, void *agg_state, MemoryContext agg_extra_mctx)
@@ -128,15 +173,37 @@ compute_single_aggregate(GroupingPolicyBatch *policy, TupleTableSlot *vector_slo
 	 * We have functions with one argument, and one function with no arguments
 	 * (count(*)). Collect the arguments.
 	 */
-	if (agg_def->input_offset >= 0)
+	if (agg_def->argument_expr != NULL || agg_def->input_offset >= 0)
 	{
-		const AttrNumber attnum = AttrOffsetGetAttrNumber(agg_def->input_offset);
 		const CompressedColumnValues *values =
-			vector_slot_get_compressed_column_values(vector_slot, attnum);
+			agg_def->argument_expr != NULL ?
+				&agg_def->argument_values :
+				vector_slot_get_compressed_column_values(vector_slot,
+														 AttrOffsetGetAttrNumber(
+															 agg_def->input_offset));
 
 		Assert(values->decompression_type != DT_Invalid);
 		Assert(values->decompression_type != DT_Iterator);
 
+		if (values->decompression_type == DT_MinMaxMetadata)
+		{
+			/*
+			 * All rows of the batch pass, and min() or max() of the batch is
+			 * given by its metadata.
+			 */
+			Assert(vector_qual_result == NULL);
+			Assert(agg_def->filter_result == NULL);
+			Assert(agg_def->func.batch_metadata != VAMD_None);
+			agg_def->func.agg_scalar(agg_state,
+									 agg_def->func.batch_metadata == VAMD_Max ?
+										 values->metadata_max :
+										 values->metadata_min,
+									 values->metadata_isnull,
+									 1,
+									 agg_extra_mctx);
+			return;
+		}
+
 		if (values->arrow != NULL)
 		{
 			arg_arrow = values->arrow;
@@ -151,14 +218,16 @@ compute_single_aggregate(GroupingPolicyBatch *policy, TupleTableSlot *vector_slo
 	}
 
 	/*
-	 * Compute the unified validity bitmap.
+	 * Compute the unified validity bitmap. The nulls are passed to the
+	 * functions that are not strict.
 	 */
 	const size_t num_words = (total_batch_rows + 63) / 64;
-	const uint64 *filter = arrow_combine_validity(num_words,
-												  policy->tmp_filter,
-												  vector_qual_result,
-												  agg_def->filter_result,
-												  arg_validity_bitmap);
+	const uint64 *filter =
+		arrow_combine_validity(num_words,
+							   policy->tmp_filter,
+							   vector_qual_result,
+							   agg_def->filter_result,
+							   agg_def->func.nonstrict ? NULL : arg_validity_bitmap);
 
 	/*
 	 * Now call the function.
@@ -218,7 +287,22 @@ gp_batch_add_batch(GroupingPolicy *gp, TupleTableSlot *vector_slot)
 	{
 		VectorAggDef *agg_def = &policy->agg_defs[i];
 		void *agg_state = policy->agg_states[i];
-		compute_single_aggregate(policy, vector_slot, agg_def, agg_state, policy->agg_extra_mctx);
+		if (agg_def->func.agg_vector2 != NULL)
+		{
+			compute_two_argument_aggregate(policy,
+										   vector_slot,
+										   agg_def,
+										   agg_state,
+										   policy->agg_extra_mctx);
+		}
+		else
+		{
+			compute_single_aggregate(policy,
+									 vector_slot,
+									 agg_def,
+									 agg_state,
+									 policy->agg_extra_mctx);
+		}
 	}
 
 	/*
@@ -276,9 +360,19 @@ gp_batch_do_emit(GroupingPolicy *gp, TupleTableSlot *aggregated_slot)
 	{
 		VectorAggDef *agg_def = &policy->agg_defs[i];
 		void *agg_state = policy->agg_states[i];
-		agg_def->func.agg_emit(agg_state,
-							   &aggregated_slot->tts_values[agg_def->output_offset],
-							   &aggregated_slot->tts_isnull[agg_def->output_offset]);
+		if (agg_def->func.agg_emit2 != NULL)
+		{
+			agg_def->func.agg_emit2(agg_state,
+									agg_def->argument_types,
+									&aggregated_slot->tts_values[agg_def->output_offset],
+									&aggregated_slot->tts_isnull[agg_def->output_offset]);
+		}
+		else
+		{
+			agg_def->func.agg_emit(agg_state,
+								   &aggregated_slot->tts_values[agg_def->output_offset],
+								   &aggregated_slot->tts_isnull[agg_def->output_offset]);
+		}
 	}
 
 	const int ngrp = policy->num_grouping_columns;
@@ -13,8 +13,11 @@
 
 #include <access/attnum.h>
 #include <access/tupdesc.h>
+#include <commands/explain.h>
+#include <executor/nodeHash.h>
 #include <executor/tuptable.h>
 #include <nodes/pg_list.h>
+#include <utils/memutils.h>
 
 #include "grouping_policy.h"
 
@@ -36,11 +39,20 @@
 extern HashingStrategy single_fixed_2_strategy;
 extern HashingStrategy single_fixed_4_strategy;
 extern HashingStrategy single_fixed_8_strategy;
+extern HashingStrategy single_fixed_16_strategy;
+extern HashingStrategy packed_fixed_16_strategy;
 #ifdef TS_USE_UMASH
 extern HashingStrategy single_text_strategy;
 extern HashingStrategy serialized_strategy;
 #endif
 
+/*
+ * The minimal average number of input rows per grouping key for which we
+ * consider the partial aggregation to be effective, and grow the hash table
+ * beyond the cache-friendly size.
+ */
+#define HASH_MIN_ROWS_PER_KEY 4
+
 static const GroupingPolicy grouping_policy_hash_functions;
 
 GroupingPolicy *
@@ -53,8 +65,9 @@ create_grouping_policy_hash(int num_agg_defs, VectorAggDef *agg_defs, int num_gr
 	policy->num_grouping_columns = num_grouping_columns;
 	policy->grouping_columns = grouping_columns;
 
-	policy->agg_extra_mctx =
-		AllocSetContextCreate(CurrentMemoryContext, "agg extra", ALLOCSET_DEFAULT_SIZES);
+	policy->agg_extra_mctx = AllocSetContextCreate(CurrentMemoryContext,
+												   "VectorAgg grouping policy",
+												   ALLOCSET_DEFAULT_SIZES);
 	policy->num_allocated_per_key_agg_states = TARGET_COMPRESSED_BATCH_SIZE;
 
 	policy->num_agg_defs = num_agg_defs;
@@ -82,6 +95,12 @@ create_grouping_policy_hash(int num_agg_defs, VectorAggDef *agg_defs, int num_gr
 			policy->hashing = single_text_strategy;
 			break;
 #endif
+		case VAGT_HashPackedFixed16:
+			policy->hashing = packed_fixed_16_strategy;
+			break;
+		case VAGT_HashSingleFixed16:
+			policy->hashing = single_fixed_16_strategy;
+			break;
 		case VAGT_HashSingleFixed8:
 			policy->hashing = single_fixed_8_strategy;
 			break;
@@ -112,14 +131,65 @@ gp_hash_reset(GroupingPolicy *obj)
 
 	policy->returning_results = false;
 
+	policy->stat_cycles_keys += policy->hashing.last_used_key_index;
 	policy->hashing.reset(&policy->hashing);
 
+	policy->stat_cycles_input_total_rows += policy->stat_input_total_rows;
+	policy->stat_cycles_input_valid_rows += policy->stat_input_valid_rows;
+	policy->stat_cycles_bulk_filtered_rows += policy->stat_bulk_filtered_rows;
+	policy->stat_cycles_consecutive_keys += policy->stat_consecutive_keys;
 	policy->stat_input_valid_rows = 0;
 	policy->stat_input_total_rows = 0;
 	policy->stat_bulk_filtered_rows = 0;
 	policy->stat_consecutive_keys = 0;
 }
 
+/*
+ * Compute an aggregate function with two arguments, like first(value, time).
+ * The nulls in the arguments are handled by the function itself.
+ */
+static void
+compute_two_argument_aggregate(GroupingPolicyHash *policy, TupleTableSlot *vector_slot,
+							   int start_row, int end_row, const VectorAggDef *agg_def,
+							   void *agg_states)
+{
+	uint16 total_batch_rows = 0;
+	const uint64 *vector_qual_result = vector_slot_get_qual_result(vector_slot, &total_batch_rows);
+
+	/*
+	 * Copy the column values, because the arrow tuple table slot reuses the
+	 * same storage for all columns.
+	 */
+	const CompressedColumnValues value_arg =
+		*vector_slot_get_compressed_column_values(vector_slot,
+												  AttrOffsetGetAttrNumber(agg_def->input_offset));
+	const CompressedColumnValues cmp_arg = *vector_slot_get_compressed_column_values(
+		vector_slot,
+		AttrOffsetGetAttrNumber(agg_def->second_input_offset));
+
+	Assert(value_arg.decompression_type != DT_Invalid);
+	Assert(value_arg.decompression_type != DT_Iterator);
+	Assert(cmp_arg.decompression_type != DT_Invalid);
+	Assert(cmp_arg.decompression_type != DT_Iterator);
+
+	const size_t num_words = (total_batch_rows + 63) / 64;
+	const uint64 *filter = arrow_combine_validity(num_words,
+												  policy->tmp_filter,
+												  agg_def->filter_result,
+												  vector_qual_result,
+												  NULL);
+
+	agg_def->func.agg_many_vector2(agg_states,
+								   agg_def->argument_types,
+								   policy->key_index_for_row,
+								   filter,
+								   start_row,
+								   end_row,
+								   &value_arg,
+								   &cmp_arg,
+								   policy->agg_extra_mctx);
+}
+
 static void
 compute_single_aggregate(GroupingPolicyHash *policy, TupleTableSlot *vector_slot, int start_row,
 						 int end_row, const VectorAggDef *agg_def, void *agg_states)
@@ -137,11 +207,14 @@ compute_single_aggregate(GroupingPolicyHash *policy, TupleTableSlot *vector_slot
 	 * We have functions with one argument, and one function with no arguments
 	 * (count(*)). Collect the arguments.
 	 */
-	if (agg_def->input_offset >= 0)
+	if (agg_def->argument_expr != NULL || agg_def->input_offset >= 0)
 	{
-		const AttrNumber attnum = AttrOffsetGetAttrNumber(agg_def->input_offset);
 		const CompressedColumnValues *values =
-			vector_slot_get_compressed_column_values(vector_slot, attnum);
+			agg_def->argument_expr != NULL ?
+				&agg_def->argument_values :
+				vector_slot_get_compressed_column_values(vector_slot,
+														 AttrOffsetGetAttrNumber(
+															 agg_def->input_offset));
 
 		Assert(values->decompression_type != DT_Invalid);
 		Assert(values->decompression_type != DT_Iterator);
@@ -160,14 +233,16 @@ compute_single_aggregate(GroupingPolicyHash *policy, TupleTableSlot *vector_slot
 	}
 
 	/*
-	 * Compute the unified validity bitmap.
+	 * Compute the unified validity bitmap. The nulls are passed to the
+	 * functions that are not strict.
 	 */
 	const size_t num_words = (total_batch_rows + 63) / 64;
-	const uint64 *filter = arrow_combine_validity(num_words,
-												  policy->tmp_filter,
-												  agg_def->filter_result,
-												  vector_qual_result,
-												  arg_validity_bitmap);
+	const uint64 *filter =
+		arrow_combine_validity(num_words,
+							   policy->tmp_filter,
+							   agg_def->filter_result,
+							   vector_qual_result,
+							   agg_def->func.nonstrict ? NULL : arg_validity_bitmap);
 
 	/*
 	 * Now call the function.
@@ -264,7 +339,8 @@ add_one_range(GroupingPolicyHash *policy, TupleTableSlot *vector_slot, const int
 			void *first_uninitialized_state =
 				agg_def->func.state_bytes * (last_initialized_key_index + 1) +
 				(char *) policy->per_agg_per_key_states[agg_index];
-			agg_def->func.agg_init(first_uninitialized_state,
+			vector_agg_init_states(&agg_def->func,
+								   first_uninitialized_state,
 								   policy->hashing.last_used_key_index -
 									   last_initialized_key_index);
 		}
@@ -272,12 +348,24 @@ add_one_range(GroupingPolicyHash *policy, TupleTableSlot *vector_slot, const int
 		/*
 		 * Add this batch to the states of this aggregate function.
 		 */
-		compute_single_aggregate(policy,
-								 vector_slot,
-								 start_row,
-								 end_row,
-								 agg_def,
-								 policy->per_agg_per_key_states[agg_index]);
+		if (agg_def->func.agg_many_vector2 != NULL)
+		{
+			compute_two_argument_aggregate(policy,
+										   vector_slot,
+										   start_row,
+										   end_row,
+										   agg_def,
+										   policy->per_agg_per_key_states[agg_index]);
+		}
+		else
+		{
+			compute_single_aggregate(policy,
+									 vector_slot,
+									 start_row,
+									 end_row,
+									 agg_def,
+									 policy->per_agg_per_key_states[agg_index]);
+		}
 	}
 
 	/*
@@ -335,6 +423,13 @@ gp_hash_add_batch(GroupingPolicy *gp, TupleTableSlot *vector_slot)
 	{
 		const GroupingColumn *def = &policy->grouping_columns[i];
 
+		if (def->expr != NULL)
+		{
+			/* The grouping expression is computed by the vector agg node. */
+			policy->current_batch_grouping_column_values[i] = def->values;
+			continue;
+		}
+
 		policy->current_batch_grouping_column_values[i] =
 			*vector_slot_get_compressed_column_values(vector_slot,
 													  AttrOffsetGetAttrNumber(def->input_offset));
@@ -419,6 +514,22 @@ gp_hash_add_batch(GroupingPolicy *gp, TupleTableSlot *vector_slot)
 	policy->stat_input_valid_rows += arrow_num_valid(filter, n);
 }
 
+/*
+ * The memory used by the hash table and the aggregate function states.
+ */
+static uint64
+gp_hash_used_bytes(GroupingPolicyHash *policy, uint64 hash_table_bytes)
+{
+	uint64 total_bytes = hash_table_bytes;
+	for (int i = 0; i < policy->num_agg_defs; i++)
+	{
+		total_bytes +=
+			policy->num_allocated_per_key_agg_states * policy->agg_defs[i].func.state_bytes;
+	}
+	total_bytes += MemoryContextMemAllocated(policy->agg_extra_mctx, /* recurse = */ true);
+	return total_bytes;
+}
+
 static bool
 gp_hash_should_emit(GroupingPolicy *gp)
 {
@@ -430,17 +541,45 @@ gp_hash_should_emit(GroupingPolicy *gp)
 		 * The max valid key index is UINT32_MAX, so we have to spill if the next
 		 * batch can possibly lead to key index overflow.
 		 */
+		policy->stat_spills_key_index++;
 		return true;
 	}
 
 	/*
-	 * Don't grow the hash table cardinality too much, otherwise we become bound
-	 * by memory reads. In general, when this first stage of grouping doesn't
-	 * significantly reduce the cardinality, it becomes pure overhead and the
-	 * work will be done by the final Postgres aggregation, so we should bail
-	 * out early here.
+	 * Small hash tables fit into the cache, so we can always grow them.
+	 */
+	const uint64 hash_table_bytes = policy->hashing.get_size_bytes(&policy->hashing);
+	if (hash_table_bytes <= 512 * 1024)
+	{
+		return false;
+	}
+
+	/*
+	 * Don't grow the hash table cardinality too much if it doesn't pay off,
+	 * otherwise we become bound by memory reads. In general, when this first
+	 * stage of grouping doesn't significantly reduce the cardinality, it
+	 * becomes pure overhead and the work will be done by the final Postgres
+	 * aggregation, so we should bail out early here.
 	 */
-	return policy->hashing.get_size_bytes(&policy->hashing) > 512 * 1024;
+	const uint64 num_keys = policy->hashing.last_used_key_index;
+	if (policy->stat_input_valid_rows < HASH_MIN_ROWS_PER_KEY * num_keys)
+	{
+		policy->stat_spills_low_reduction++;
+		return true;
+	}
+
+	/*
+	 * The grouping does reduce the cardinality, so let the hash table grow up
+	 * to the hash memory limit, like the Postgres hash aggregation does. This
+	 * lets the high-cardinality groupings produce fewer partial results.
+	 */
+	if (gp_hash_used_bytes(policy, hash_table_bytes) > get_hash_memory_limit())
+	{
+		policy->stat_spills_memory++;
+		return true;
+	}
+
+	return false;
 }
 
 static bool
@@ -456,6 +595,12 @@ gp_hash_do_emit(GroupingPolicy *gp, TupleTableSlot *aggregated_slot)
 		const float keys = policy->hashing.last_used_key_index;
 		if (keys > 0)
 		{
+			const uint64 used_bytes =
+				gp_hash_used_bytes(policy, policy->hashing.get_size_bytes(&policy->hashing));
+			policy->stat_emits++;
+			policy->stat_max_keys = Max(policy->stat_max_keys, policy->hashing.last_used_key_index);
+			policy->stat_max_bytes = Max(policy->stat_max_bytes, used_bytes);
+
 			DEBUG_LOG("spill after %ld input, %ld valid, %ld bulk filtered, %ld cons, %.0f keys, "
 					  "%f ratio, %ld curctx bytes, %ld aggstate bytes",
 					  policy->stat_input_total_rows,
@@ -487,9 +632,19 @@ gp_hash_do_emit(GroupingPolicy *gp, TupleTableSlot *aggregated_slot)
 		const VectorAggDef *agg_def = &policy->agg_defs[i];
 		void *agg_states = policy->per_agg_per_key_states[i];
 		void *agg_state = current_key * agg_def->func.state_bytes + (char *) agg_states;
-		agg_def->func.agg_emit(agg_state,
-							   &aggregated_slot->tts_values[agg_def->output_offset],
-							   &aggregated_slot->tts_isnull[agg_def->output_offset]);
+		if (agg_def->func.agg_emit2 != NULL)
+		{
+			agg_def->func.agg_emit2(agg_state,
+									agg_def->argument_types,
+									&aggregated_slot->tts_values[agg_def->output_offset],
+									&aggregated_slot->tts_isnull[agg_def->output_offset]);
+		}
+		else
+		{
+			agg_def->func.agg_emit(agg_state,
+								   &aggregated_slot->tts_values[agg_def->output_offset],
+								   &aggregated_slot->tts_isnull[agg_def->output_offset]);
+		}
 	}
 
 	policy->hashing.emit_key(policy, current_key, aggregated_slot);
@@ -506,10 +661,70 @@ gp_hash_explain(GroupingPolicy *gp)
 	return psprintf("hashed with %s key", policy->hashing.explain_name);
 }
 
+static void
+gp_hash_explain_stats(GroupingPolicy *gp, ExplainState *es)
+{
+	GroupingPolicyHash *policy = (GroupingPolicyHash *) gp;
+	const uint64 spills = policy->stat_spills_key_index + policy->stat_spills_low_reduction +
+						  policy->stat_spills_memory;
+
+	ExplainPropertyText("Hashing Strategy", policy->hashing.explain_name, es);
+	ExplainPropertyInteger("Input Rows",
+						   NULL,
+						   policy->stat_cycles_input_total_rows + policy->stat_input_total_rows,
+						   es);
+	ExplainPropertyInteger("Aggregated Rows",
+						   NULL,
+						   policy->stat_cycles_input_valid_rows + policy->stat_input_valid_rows,
+						   es);
+	ExplainPropertyInteger("Rows Skipped in Bulk",
+						   NULL,
+						   policy->stat_cycles_bulk_filtered_rows + policy->stat_bulk_filtered_rows,
+						   es);
+	ExplainPropertyInteger("Consecutive Same Keys",
+						   NULL,
+						   policy->stat_cycles_consecutive_keys + policy->stat_consecutive_keys,
+						   es);
+
+	ExplainPropertyInteger("Grouping Keys",
+						   NULL,
+						   policy->stat_cycles_keys + policy->hashing.last_used_key_index,
+						   es);
+	ExplainPropertyInteger("Max Grouping Keys", NULL, policy->stat_max_keys, es);
+	ExplainPropertyInteger("Partial Emits", NULL, policy->stat_emits, es);
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		StringInfoData str;
+		initStringInfo(&str);
+		appendStringInfo(&str, UINT64_FORMAT, spills);
+		if (spills > 0)
+		{
+			appendStringInfo(&str,
+							 " (memory limit: " UINT64_FORMAT ", low reduction: " UINT64_FORMAT
+							 ", key index limit: " UINT64_FORMAT ")",
+							 policy->stat_spills_memory,
+							 policy->stat_spills_low_reduction,
+							 policy->stat_spills_key_index);
+		}
+		ExplainPropertyText("Spills", str.data, es);
+	}
+	else
+	{
+		ExplainPropertyInteger("Spills", NULL, spills, es);
+		ExplainPropertyInteger("Memory Limit Spills", NULL, policy->stat_spills_memory, es);
+		ExplainPropertyInteger("Low Reduction Spills", NULL, policy->stat_spills_low_reduction, es);
+		ExplainPropertyInteger("Key Index Limit Spills", NULL, policy->stat_spills_key_index, es);
+	}
+
+	ExplainPropertyInteger("Peak Memory Usage", "kB", (policy->stat_max_bytes + 1023) / 1024, es);
+}
+
 static const GroupingPolicy grouping_policy_hash_functions = {
 	.gp_reset = gp_hash_reset,
 	.gp_add_batch = gp_hash_add_batch,
 	.gp_should_emit = gp_hash_should_emit,
 	.gp_do_emit = gp_hash_do_emit,
 	.gp_explain = gp_hash_explain,
+	.gp_explain_stats = gp_hash_explain_stats,
 };
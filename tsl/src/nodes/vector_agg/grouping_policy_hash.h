@@ -122,12 +122,34 @@ typedef struct GroupingPolicyHash
 	uint32 last_returned_key;
 
 	/*
-	 * Some statistics for debugging.
+	 * Some statistics for debugging, for the current partial aggregation
+	 * cycle.
 	 */
 	uint64 stat_input_total_rows;
 	uint64 stat_input_valid_rows;
 	uint64 stat_bulk_filtered_rows;
 	uint64 stat_consecutive_keys;
+
+	/*
+	 * The statistics summed over the previous partial aggregation cycles, and
+	 * the statistics of all cycles, for EXPLAIN ANALYZE.
+	 */
+	uint64 stat_cycles_input_total_rows;
+	uint64 stat_cycles_input_valid_rows;
+	uint64 stat_cycles_bulk_filtered_rows;
+	uint64 stat_cycles_consecutive_keys;
+	uint64 stat_cycles_keys;
+	uint64 stat_max_keys;
+	uint64 stat_max_bytes;
+	uint64 stat_emits;
+
+	/*
+	 * The partial results emitted before the end of the input, by the reason
+	 * in gp_hash_should_emit().
+	 */
+	uint64 stat_spills_key_index;
+	uint64 stat_spills_low_reduction;
+	uint64 stat_spills_memory;
 } GroupingPolicyHash;
 
 //#define DEBUG_PRINT(...) fprintf(stderr, __VA_ARGS__)
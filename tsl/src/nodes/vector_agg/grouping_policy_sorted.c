@@ -0,0 +1,644 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * This grouping policy groups the rows of an input that is sorted by the
+ * grouping columns, like the GroupAggregate does. The rows with the same
+ * grouping key are consecutive, so a group is finished as soon as the key
+ * changes, and is emitted immediately after the batch that finished it. Only
+ * the last group of the batch can continue into the next batch, so we keep it
+ * open until then. This uses no hash table, the memory is bounded by the
+ * number of groups in one batch, and the output keeps the input order.
+ *
+ * Currently it supports the fixed-size by-value grouping columns, both the
+ * compressed and the segmentby ones, and the computed grouping expressions
+ * like time_bucket().
+ */
+
+#include <postgres.h>
+
+#include <access/attnum.h>
+#include <executor/tuptable.h>
+#include <nodes/pg_list.h>
+#include <utils/memutils.h>
+
+#include "grouping_policy.h"
+
+#include "nodes/vector_agg/exec.h"
+#include "nodes/vector_agg/vector_slot.h"
+
+/*
+ * Which groups the policy is currently returning.
+ */
+typedef enum
+{
+	/* Not returning results, aggregating the input. */
+	SGE_None = 0,
+	/* Returning the finished groups, the last one is kept open. */
+	SGE_Finished,
+	/* The input has ended, returning all groups. */
+	SGE_All,
+	/* Returned the groups, nothing more until the next cycle. */
+	SGE_Done,
+} SortedGroupingEmit;
+
+typedef struct
+{
+	GroupingPolicy funcs;
+
+	int num_agg_defs;
+	const VectorAggDef *restrict agg_defs;
+
+	int num_grouping_columns;
+	const GroupingColumn *restrict grouping_columns;
+
+	/*
+	 * The values of the grouping columns picked from the compressed batch and
+	 * arranged in the order of grouping column definitions.
+	 */
+	CompressedColumnValues *restrict current_batch_grouping_column_values;
+
+	/*
+	 * The index of the group for every row of the current batch.
+	 */
+	uint32 *restrict group_for_row;
+	uint64 num_group_for_row;
+
+	/*
+	 * Temporary storage for combined bitmap of batch filter, aggregate
+	 * FILTER clause and aggregate argument validity.
+	 */
+	uint64 *tmp_filter;
+	uint64 num_tmp_filter_words;
+
+	/*
+	 * The aggregate function states and the grouping keys of the groups,
+	 * laid out contiguously by the group index. The last of the groups is the
+	 * open one that can be continued by the next batch.
+	 */
+	void **per_agg_per_group_states;
+	Datum *group_values;
+	bool *group_isnull;
+	uint32 num_groups;
+	uint32 num_allocated_groups;
+
+	/*
+	 * A memory context for aggregate functions to allocate additional data,
+	 * i.e. if they store strings or float8 datum on 32-bit systems. The open
+	 * group can refer to it, so it is valid until the reset of the grouping
+	 * policy, not just until the next partial aggregation cycle.
+	 */
+	MemoryContext agg_extra_mctx;
+
+	SortedGroupingEmit emitting;
+	uint32 next_emitted_group;
+} GroupingPolicySorted;
+
+static const GroupingPolicy grouping_policy_sorted_functions;
+
+GroupingPolicy *
+create_grouping_policy_sorted(int num_agg_defs, VectorAggDef *agg_defs, int num_grouping_columns,
+							  GroupingColumn *grouping_columns)
+{
+	GroupingPolicySorted *policy = palloc0(sizeof(GroupingPolicySorted));
+	policy->funcs = grouping_policy_sorted_functions;
+
+	policy->num_grouping_columns = num_grouping_columns;
+	policy->grouping_columns = grouping_columns;
+
+	policy->num_agg_defs = num_agg_defs;
+	policy->agg_defs = agg_defs;
+
+	policy->agg_extra_mctx = AllocSetContextCreate(CurrentMemoryContext,
+												   "VectorAgg grouping policy",
+												   ALLOCSET_DEFAULT_SIZES);
+
+	policy->num_allocated_groups = TARGET_COMPRESSED_BATCH_SIZE + 1;
+	policy->per_agg_per_group_states =
+		palloc(sizeof(*policy->per_agg_per_group_states) * num_agg_defs);
+	for (int i = 0; i < num_agg_defs; i++)
+	{
+		policy->per_agg_per_group_states[i] =
+			palloc(agg_defs[i].func.state_bytes * policy->num_allocated_groups);
+	}
+	policy->group_values =
+		palloc(sizeof(Datum) * num_grouping_columns * policy->num_allocated_groups);
+	policy->group_isnull =
+		palloc(sizeof(bool) * num_grouping_columns * policy->num_allocated_groups);
+
+	policy->current_batch_grouping_column_values =
+		palloc(sizeof(CompressedColumnValues) * num_grouping_columns);
+
+	return &policy->funcs;
+}
+
+static void
+gp_sorted_reset(GroupingPolicy *obj)
+{
+	GroupingPolicySorted *policy = (GroupingPolicySorted *) obj;
+
+	MemoryContextReset(policy->agg_extra_mctx);
+
+	policy->num_groups = 0;
+	policy->emitting = SGE_None;
+	policy->next_emitted_group = 0;
+}
+
+/*
+ * Start the next partial aggregation cycle after the finished groups were
+ * emitted. The open group was moved to the start by gp_sorted_do_emit() and is
+ * kept.
+ */
+static void
+gp_sorted_next_cycle(GroupingPolicy *obj)
+{
+	GroupingPolicySorted *policy = (GroupingPolicySorted *) obj;
+
+	Assert(policy->num_groups <= 1);
+	policy->emitting = SGE_None;
+	policy->next_emitted_group = 0;
+}
+
+/*
+ * Make sure we have storage for the given number of groups.
+ */
+static void
+gp_sorted_ensure_groups(GroupingPolicySorted *policy, uint32 num_groups)
+{
+	if (num_groups <= policy->num_allocated_groups)
+	{
+		return;
+	}
+
+	const uint32 new_groups = num_groups * 2 + 1;
+	for (int i = 0; i < policy->num_agg_defs; i++)
+	{
+		policy->per_agg_per_group_states[i] =
+			repalloc(policy->per_agg_per_group_states[i],
+					 policy->agg_defs[i].func.state_bytes * new_groups);
+	}
+	policy->group_values =
+		repalloc(policy->group_values, sizeof(Datum) * policy->num_grouping_columns * new_groups);
+	policy->group_isnull =
+		repalloc(policy->group_isnull, sizeof(bool) * policy->num_grouping_columns * new_groups);
+	policy->num_allocated_groups = new_groups;
+}
+
+/*
+ * Get the value of a grouping column for the given row.
+ */
+static pg_attribute_always_inline void
+get_grouping_value(const CompressedColumnValues *values, int row, Datum *value, bool *isnull)
+{
+	if (values->decompression_type == DT_Scalar)
+	{
+		*value = *values->output_value;
+		*isnull = *values->output_isnull;
+		return;
+	}
+
+	*isnull = !arrow_row_is_valid(values->buffers[0], row);
+	if (*isnull)
+	{
+		*value = 0;
+		return;
+	}
+
+	switch ((int) values->decompression_type)
+	{
+		case 2:
+			*value = Int16GetDatum(((const int16 *) values->buffers[1])[row]);
+			break;
+		case 4:
+			*value = Int32GetDatum(((const int32 *) values->buffers[1])[row]);
+			break;
+		case 8:
+			*value = Int64GetDatum(((const int64 *) values->buffers[1])[row]);
+			break;
+		default:
+			Ensure(false,
+				   "unexpected decompression type %d for sorted grouping",
+				   values->decompression_type);
+			break;
+	}
+}
+
+/*
+ * Assign the group indexes to the rows of the batch, starting a new group
+ * every time the grouping key changes. The rows that don't pass the filter
+ * are assigned to the current group, and are skipped by the aggregate
+ * functions later. Returns the index of the first new group.
+ */
+static uint32
+gp_sorted_fill_groups(GroupingPolicySorted *policy, const uint64 *filter, int n)
+{
+	const int ngrp = policy->num_grouping_columns;
+	const uint32 first_new_group = policy->num_groups;
+
+	gp_sorted_ensure_groups(policy, policy->num_groups + n);
+
+	/* The current group, or -1 if the input had no groups yet. */
+	int64 current_group = (int64) policy->num_groups - 1;
+	Datum *restrict group_values = policy->group_values;
+	bool *restrict group_isnull = policy->group_isnull;
+
+	for (int row = 0; row < n; row++)
+	{
+		if (!arrow_row_is_valid(filter, row))
+		{
+			policy->group_for_row[row] = current_group < 0 ? 0 : current_group;
+			continue;
+		}
+
+		bool same_key = current_group >= 0;
+		Datum row_values[INDEX_MAX_KEYS];
+		bool row_isnull[INDEX_MAX_KEYS];
+		for (int i = 0; i < ngrp; i++)
+		{
+			get_grouping_value(&policy->current_batch_grouping_column_values[i],
+							   row,
+							   &row_values[i],
+							   &row_isnull[i]);
+
+			if (same_key)
+			{
+				const int64 offset = current_group * ngrp + i;
+				same_key = row_isnull[i] == group_isnull[offset] &&
+						   (row_isnull[i] || row_values[i] == group_values[offset]);
+			}
+		}
+
+		if (!same_key)
+		{
+			current_group++;
+			for (int i = 0; i < ngrp; i++)
+			{
+				group_values[current_group * ngrp + i] = row_values[i];
+				group_isnull[current_group * ngrp + i] = row_isnull[i];
+			}
+		}
+
+		policy->group_for_row[row] = current_group;
+	}
+
+	policy->num_groups = current_group + 1;
+	return first_new_group;
+}
+
+/*
+ * Compute an aggregate function with two arguments, like first(value, time).
+ * The nulls in the arguments are handled by the function itself.
+ */
+static void
+compute_two_argument_aggregate(GroupingPolicySorted *policy, TupleTableSlot *vector_slot,
+							   const VectorAggDef *agg_def, void *agg_states)
+{
+	uint16 total_batch_rows = 0;
+	const uint64 *vector_qual_result = vector_slot_get_qual_result(vector_slot, &total_batch_rows);
+
+	/*
+	 * Copy the column values, because the arrow tuple table slot reuses the
+	 * same storage for all columns.
+	 */
+	const CompressedColumnValues value_arg =
+		*vector_slot_get_compressed_column_values(vector_slot,
+												  AttrOffsetGetAttrNumber(agg_def->input_offset));
+	const CompressedColumnValues cmp_arg = *vector_slot_get_compressed_column_values(
+		vector_slot,
+		AttrOffsetGetAttrNumber(agg_def->second_input_offset));
+
+	Assert(value_arg.decompression_type != DT_Invalid);
+	Assert(value_arg.decompression_type != DT_Iterator);
+	Assert(cmp_arg.decompression_type != DT_Invalid);
+	Assert(cmp_arg.decompression_type != DT_Iterator);
+
+	const size_t num_words = (total_batch_rows + 63) / 64;
+	const uint64 *filter = arrow_combine_validity(num_words,
+												  policy->tmp_filter,
+												  agg_def->filter_result,
+												  vector_qual_result,
+												  NULL);
+
+	agg_def->func.agg_many_vector2(agg_states,
+								   agg_def->argument_types,
+								   policy->group_for_row,
+								   filter,
+								   0,
+								   total_batch_rows,
+								   &value_arg,
+								   &cmp_arg,
+								   policy->agg_extra_mctx);
+}
+
+static void
+compute_single_aggregate(GroupingPolicySorted *policy, TupleTableSlot *vector_slot,
+						 const VectorAggDef *agg_def, void *agg_states)
+{
+	const ArrowArray *arg_arrow = NULL;
+	const uint64 *arg_validity_bitmap = NULL;
+	Datum arg_datum = 0;
+	bool arg_isnull = true;
+	uint16 total_batch_rows = 0;
+	const uint32 *offsets = policy->group_for_row;
+	MemoryContext agg_extra_mctx = policy->agg_extra_mctx;
+	const uint64 *vector_qual_result = vector_slot_get_qual_result(vector_slot, &total_batch_rows);
+
+	/*
+	 * We have functions with one argument, and one function with no arguments
+	 * (count(*)). Collect the arguments.
+	 */
+	if (agg_def->argument_expr != NULL || agg_def->input_offset >= 0)
+	{
+		const CompressedColumnValues *values =
+			agg_def->argument_expr != NULL ?
+				&agg_def->argument_values :
+				vector_slot_get_compressed_column_values(vector_slot,
+														 AttrOffsetGetAttrNumber(
+															 agg_def->input_offset));
+
+		Assert(values->decompression_type != DT_Invalid);
+		Assert(values->decompression_type != DT_Iterator);
+
+		if (values->arrow != NULL)
+		{
+			arg_arrow = values->arrow;
+			arg_validity_bitmap = values->buffers[0];
+		}
+		else
+		{
+			Assert(values->decompression_type == DT_Scalar);
+			arg_datum = *values->output_value;
+			arg_isnull = *values->output_isnull;
+		}
+	}
+
+	/*
+	 * Compute the unified validity bitmap. The nulls are passed to the
+	 * functions that are not strict.
+	 */
+	const size_t num_words = (total_batch_rows + 63) / 64;
+	const uint64 *filter =
+		arrow_combine_validity(num_words,
+							   policy->tmp_filter,
+							   agg_def->filter_result,
+							   vector_qual_result,
+							   agg_def->func.nonstrict ? NULL : arg_validity_bitmap);
+
+	/*
+	 * Now call the function.
+	 */
+	if (arg_arrow != NULL)
+	{
+		/* Arrow argument. */
+		agg_def->func.agg_many_vector(agg_states,
+									  offsets,
+									  filter,
+									  0,
+									  total_batch_rows,
+									  arg_arrow,
+									  agg_extra_mctx);
+	}
+	else if (agg_def->func.agg_many_scalar != NULL)
+	{
+		/*
+		 * Scalar argument, or count(*). The latter has an optimized
+		 * implementation.
+		 */
+		agg_def->func.agg_many_scalar(agg_states,
+									  offsets,
+									  filter,
+									  0,
+									  total_batch_rows,
+									  arg_datum,
+									  arg_isnull,
+									  agg_extra_mctx);
+	}
+	else
+	{
+		for (int i = 0; i < total_batch_rows; i++)
+		{
+			if (!arrow_row_is_valid(filter, i))
+			{
+				continue;
+			}
+
+			void *state = (offsets[i] * agg_def->func.state_bytes + (char *) agg_states);
+			agg_def->func.agg_scalar(state, arg_datum, arg_isnull, 1, agg_extra_mctx);
+		}
+	}
+}
+
+static void
+gp_sorted_add_batch(GroupingPolicy *gp, TupleTableSlot *vector_slot)
+{
+	GroupingPolicySorted *policy = (GroupingPolicySorted *) gp;
+	uint16 n;
+	const uint64 *restrict filter = vector_slot_get_qual_result(vector_slot, &n);
+
+	Assert(policy->emitting == SGE_None);
+
+	if ((size_t) n > policy->num_group_for_row)
+	{
+		if (policy->group_for_row != NULL)
+		{
+			pfree(policy->group_for_row);
+		}
+		policy->num_group_for_row = n;
+		policy->group_for_row =
+			palloc(sizeof(policy->group_for_row[0]) * policy->num_group_for_row);
+	}
+
+	const size_t num_words = (n + 63) / 64;
+	if (num_words > policy->num_tmp_filter_words)
+	{
+		if (policy->tmp_filter != NULL)
+		{
+			pfree(policy->tmp_filter);
+		}
+		policy->tmp_filter = palloc(sizeof(*policy->tmp_filter) * (num_words * 2 + 1));
+		policy->num_tmp_filter_words = (num_words * 2 + 1);
+	}
+
+	/*
+	 * Arrange the input compressed columns in the order of grouping columns.
+	 */
+	for (int i = 0; i < policy->num_grouping_columns; i++)
+	{
+		const GroupingColumn *def = &policy->grouping_columns[i];
+
+		if (def->expr != NULL)
+		{
+			/* The grouping expression is computed by the vector agg node. */
+			policy->current_batch_grouping_column_values[i] = def->values;
+			continue;
+		}
+
+		policy->current_batch_grouping_column_values[i] =
+			*vector_slot_get_compressed_column_values(vector_slot,
+													  AttrOffsetGetAttrNumber(def->input_offset));
+	}
+
+	/*
+	 * Find the group boundaries, and initialize the aggregate function states
+	 * for the new groups.
+	 */
+	const uint32 first_new_group = gp_sorted_fill_groups(policy, filter, n);
+	if (policy->num_groups == 0)
+	{
+		/* No rows passed the filter and no group is open. */
+		return;
+	}
+
+	for (int i = 0; i < policy->num_agg_defs; i++)
+	{
+		const VectorAggDef *agg_def = &policy->agg_defs[i];
+		void *agg_states = policy->per_agg_per_group_states[i];
+
+		if (policy->num_groups > first_new_group)
+		{
+			vector_agg_init_states(&agg_def->func,
+								   agg_def->func.state_bytes * first_new_group +
+									   (char *) agg_states,
+								   policy->num_groups - first_new_group);
+		}
+
+		if (agg_def->func.agg_many_vector2 != NULL)
+		{
+			compute_two_argument_aggregate(policy, vector_slot, agg_def, agg_states);
+		}
+		else
+		{
+			compute_single_aggregate(policy, vector_slot, agg_def, agg_states);
+		}
+	}
+}
+
+static bool
+gp_sorted_should_emit(GroupingPolicy *gp)
+{
+	GroupingPolicySorted *policy = (GroupingPolicySorted *) gp;
+
+	/*
+	 * All groups except the last one are finished, so we can emit them right
+	 * away.
+	 */
+	if (policy->num_groups > 1)
+	{
+		policy->emitting = SGE_Finished;
+		return true;
+	}
+
+	return false;
+}
+
+static bool
+gp_sorted_do_emit(GroupingPolicy *gp, TupleTableSlot *aggregated_slot)
+{
+	GroupingPolicySorted *policy = (GroupingPolicySorted *) gp;
+
+	if (policy->emitting == SGE_Done)
+	{
+		return false;
+	}
+
+	if (policy->emitting == SGE_None)
+	{
+		/*
+		 * We are asked to emit the results without gp_sorted_should_emit()
+		 * requesting it, so the input has ended, and the open group is
+		 * finished as well.
+		 */
+		policy->emitting = SGE_All;
+		policy->next_emitted_group = 0;
+	}
+
+	const uint32 groups_end =
+		policy->emitting == SGE_All ? policy->num_groups : policy->num_groups - 1;
+	if (policy->next_emitted_group >= groups_end)
+	{
+		if (policy->emitting == SGE_Finished)
+		{
+			/*
+			 * Move the open group to the start, so that the next batches
+			 * continue it.
+			 */
+			const uint32 open_group = policy->num_groups - 1;
+			for (int i = 0; i < policy->num_agg_defs; i++)
+			{
+				const size_t state_bytes = policy->agg_defs[i].func.state_bytes;
+				char *agg_states = policy->per_agg_per_group_states[i];
+				memmove(agg_states, agg_states + open_group * state_bytes, state_bytes);
+			}
+
+			const int ngrp = policy->num_grouping_columns;
+			for (int i = 0; i < ngrp; i++)
+			{
+				policy->group_values[i] = policy->group_values[open_group * ngrp + i];
+				policy->group_isnull[i] = policy->group_isnull[open_group * ngrp + i];
+			}
+			policy->num_groups = 1;
+		}
+		else
+		{
+			policy->num_groups = 0;
+		}
+
+		policy->emitting = SGE_Done;
+		return false;
+	}
+
+	const uint32 current_group = policy->next_emitted_group++;
+
+	const int naggs = policy->num_agg_defs;
+	for (int i = 0; i < naggs; i++)
+	{
+		const VectorAggDef *agg_def = &policy->agg_defs[i];
+		void *agg_states = policy->per_agg_per_group_states[i];
+		void *agg_state = current_group * agg_def->func.state_bytes + (char *) agg_states;
+		if (agg_def->func.agg_emit2 != NULL)
+		{
+			agg_def->func.agg_emit2(agg_state,
+									agg_def->argument_types,
+									&aggregated_slot->tts_values[agg_def->output_offset],
+									&aggregated_slot->tts_isnull[agg_def->output_offset]);
+		}
+		else
+		{
+			agg_def->func.agg_emit(agg_state,
+								   &aggregated_slot->tts_values[agg_def->output_offset],
+								   &aggregated_slot->tts_isnull[agg_def->output_offset]);
+		}
+	}
+
+	const int ngrp = policy->num_grouping_columns;
+	for (int i = 0; i < ngrp; i++)
+	{
+		const GroupingColumn *col = &policy->grouping_columns[i];
+		Assert(col->output_offset >= 0);
+
+		aggregated_slot->tts_values[col->output_offset] =
+			policy->group_values[current_group * ngrp + i];
+		aggregated_slot->tts_isnull[col->output_offset] =
+			policy->group_isnull[current_group * ngrp + i];
+	}
+
+	return true;
+}
+
+static char *
+gp_sorted_explain(GroupingPolicy *gp)
+{
+	return "streaming over sorted input";
+}
+
+static const GroupingPolicy grouping_policy_sorted_functions = {
+	.gp_reset = gp_sorted_reset,
+	.gp_next_cycle = gp_sorted_next_cycle,
+	.gp_add_batch = gp_sorted_add_batch,
+	.gp_should_emit = gp_sorted_should_emit,
+	.gp_do_emit = gp_sorted_do_emit,
+	.gp_explain = gp_sorted_explain,
+};
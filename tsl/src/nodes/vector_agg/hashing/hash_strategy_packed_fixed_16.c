@@ -0,0 +1,155 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Implementation of column hashing for multiple fixed-size by-value columns,
+ * such as (tenant_id, metric_id). The values of the columns are packed into a
+ * 16-byte key together with the null bitmap, so that we can use the same cheap
+ * hashing as for the single fixed-size columns instead of serializing the key.
+ */
+
+#include <postgres.h>
+
+#include "compression/arrow_c_data_interface.h"
+#include "hash64.h"
+#include "nodes/decompress_chunk/compressed_batch.h"
+#include "nodes/vector_agg/exec.h"
+#include "nodes/vector_agg/grouping_policy_hash.h"
+#include "template_helper.h"
+
+#include "batch_hashing_params.h"
+
+#define EXPLAIN_NAME "packed 16-byte"
+#define KEY_VARIANT packed_fixed_16
+#define OUTPUT_KEY_TYPE PackedFixed16Key
+#define HASH_TABLE_KEY_TYPE PackedFixed16Key
+
+/*
+ * The column values are stored one after another starting from the first
+ * byte, and the last byte is the null bitmap. The bytes of the null columns
+ * and the unused bytes are zero, so the keys can be compared as two words.
+ * See get_vectorized_grouping_type() for the limits.
+ */
+typedef struct PackedFixed16Key
+{
+	uint64 first;
+	uint64 second;
+} PackedFixed16Key;
+
+StaticAssertDecl(sizeof(PackedFixed16Key) == 16, "packed key must be 16 bytes");
+
+#define PACKED_KEY_BYTES(KEY) ((uint8 *) &(KEY))
+#define PACKED_KEY_NULL_BITMAP_BYTE 15
+
+static void
+packed_fixed_16_key_hashing_init(HashingStrategy *hashing)
+{
+}
+
+static void
+packed_fixed_16_key_hashing_prepare_for_batch(GroupingPolicyHash *policy,
+											  TupleTableSlot *vector_slot)
+{
+}
+
+static pg_attribute_always_inline void
+packed_fixed_16_key_hashing_get_key(BatchHashingParams params, int row,
+									void *restrict output_key_ptr,
+									void *restrict hash_table_key_ptr, bool *restrict valid)
+{
+	PackedFixed16Key *restrict output_key = (PackedFixed16Key *) output_key_ptr;
+	PackedFixed16Key *restrict hash_table_key = (PackedFixed16Key *) hash_table_key_ptr;
+
+	PackedFixed16Key key = { 0 };
+	uint8 null_bitmap = 0;
+	int offset = 0;
+	for (int column_index = 0; column_index < params.num_grouping_columns; column_index++)
+	{
+		const CompressedColumnValues *column_values = &params.grouping_column_values[column_index];
+		const int value_bytes = params.policy->grouping_columns[column_index].value_bytes;
+		Assert(offset + value_bytes <= PACKED_KEY_NULL_BITMAP_BYTE);
+
+		if (column_values->decompression_type == DT_Scalar)
+		{
+			if (*column_values->output_isnull)
+			{
+				null_bitmap |= 1 << column_index;
+			}
+			else
+			{
+				/* Same as the serialized keys, assumes little-endian Datum. */
+				memcpy(&PACKED_KEY_BYTES(key)[offset], column_values->output_value, value_bytes);
+			}
+		}
+		else
+		{
+			Assert(column_values->decompression_type == value_bytes);
+			if (!arrow_row_is_valid(column_values->buffers[0], row))
+			{
+				null_bitmap |= 1 << column_index;
+			}
+			else
+			{
+				memcpy(&PACKED_KEY_BYTES(key)[offset],
+					   value_bytes * row + (const uint8 *) column_values->buffers[1],
+					   value_bytes);
+			}
+		}
+
+		offset += value_bytes;
+	}
+	PACKED_KEY_BYTES(key)[PACKED_KEY_NULL_BITMAP_BYTE] = null_bitmap;
+
+	/*
+	 * The multi-column key is always considered non-null, the null flags for
+	 * the individual columns are part of the key.
+	 */
+	*valid = true;
+	*output_key = key;
+	*hash_table_key = key;
+}
+
+static pg_attribute_always_inline void
+packed_fixed_16_key_hashing_store_new(HashingStrategy *restrict hashing, uint32 new_key_index,
+									  PackedFixed16Key output_key)
+{
+	PackedFixed16Key *stored = MemoryContextAlloc(hashing->key_body_mctx, sizeof(PackedFixed16Key));
+	*stored = output_key;
+	hashing->output_keys[new_key_index] = PointerGetDatum(stored);
+}
+
+static void
+packed_fixed_16_emit_key(GroupingPolicyHash *policy, uint32 current_key,
+						 TupleTableSlot *aggregated_slot)
+{
+	const uint8 *key = (const uint8 *) DatumGetPointer(policy->hashing.output_keys[current_key]);
+	const uint8 null_bitmap = key[PACKED_KEY_NULL_BITMAP_BYTE];
+
+	int offset = 0;
+	for (int column_index = 0; column_index < policy->num_grouping_columns; column_index++)
+	{
+		const GroupingColumn *col = &policy->grouping_columns[column_index];
+		Assert(col->by_value);
+		Assert((size_t) col->value_bytes <= sizeof(Datum));
+
+		const bool isnull = (null_bitmap >> column_index) & 1;
+		aggregated_slot->tts_isnull[col->output_offset] = isnull;
+
+		Datum *output = &aggregated_slot->tts_values[col->output_offset];
+		*output = 0;
+		if (!isnull)
+		{
+			memcpy(output, &key[offset], col->value_bytes);
+		}
+
+		offset += col->value_bytes;
+	}
+}
+
+#define KEY_EQUAL(a, b) ((a).first == (b).first && (a).second == (b).second)
+#define KEY_HASH(X) HASH64((X).first ^ hash64_splitmix((X).second))
+
+#include "hash_strategy_impl.c"
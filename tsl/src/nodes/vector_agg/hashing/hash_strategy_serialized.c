@@ -88,7 +88,7 @@ serialized_key_hashing_get_key(BatchHashingParams params, int row, void *restric
 			if (!*column_values->output_isnull)
 			{
 				const GroupingColumn *def = &params.policy->grouping_columns[column_index];
-				if (def->by_value)
+				if (def->value_bytes > 0)
 				{
 					num_bytes += def->value_bytes;
 				}
@@ -220,6 +220,15 @@ serialized_key_hashing_get_key(BatchHashingParams params, int row, void *restric
 
 					offset += def->value_bytes;
 				}
+				else if (def->value_bytes > 0)
+				{
+					/* Fixed-size by-reference type, e.g. UUID. */
+					memcpy(&serialized_key_storage[offset],
+						   DatumGetPointer(*column_values->output_value),
+						   def->value_bytes);
+
+					offset += def->value_bytes;
+				}
 				else
 				{
 					/*
@@ -283,6 +292,11 @@ serialized_key_hashing_get_key(BatchHashingParams params, int row, void *restric
 						   row + (int64 *) column_values->buffers[1],
 						   8);
 					break;
+				case 16:
+					memcpy(&serialized_key_storage[offset],
+						   16 * row + (uint8 *) column_values->buffers[1],
+						   16);
+					break;
 				default:
 					pg_unreachable();
 					break;
@@ -417,14 +431,22 @@ serialized_emit_key(GroupingPolicyHash *policy, uint32 current_key, TupleTableSl
 		}
 
 		Datum *output = &aggregated_slot->tts_values[col->output_offset];
-		if (col->value_bytes > 0)
+		if (col->value_bytes > 0 && col->by_value)
 		{
-			Assert(col->by_value);
 			Assert((size_t) col->value_bytes <= sizeof(Datum));
 			*output = 0;
 			memcpy(output, ptr, col->value_bytes);
 			ptr += col->value_bytes;
 		}
+		else if (col->value_bytes > 0)
+		{
+			/*
+			 * Fixed-size by-reference type. These are UUIDs that don't require
+			 * alignment, so we can reference the key directly.
+			 */
+			*output = PointerGetDatum(ptr);
+			ptr += col->value_bytes;
+		}
 		else
 		{
 			Assert(col->value_bytes == -1);
@@ -0,0 +1,105 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Implementation of column hashing for a single fixed size 16-byte column,
+ * such as UUID. These types are passed by reference, so unlike the smaller
+ * fixed-size keys, the output keys are stored in the key body memory context.
+ */
+
+#include <postgres.h>
+
+#include "compression/arrow_c_data_interface.h"
+#include "hash64.h"
+#include "nodes/decompress_chunk/compressed_batch.h"
+#include "nodes/vector_agg/exec.h"
+#include "nodes/vector_agg/grouping_policy_hash.h"
+#include "template_helper.h"
+
+#include "batch_hashing_params.h"
+
+#define EXPLAIN_NAME "single 16-byte"
+#define KEY_VARIANT single_fixed_16
+#define OUTPUT_KEY_TYPE Fixed16Key
+#define HASH_TABLE_KEY_TYPE Fixed16Key
+
+/*
+ * The bytes of the value in memory order. We don't care about the byte order
+ * of the halves, because we only compare them for equality.
+ */
+typedef struct Fixed16Key
+{
+	uint64 first;
+	uint64 second;
+} Fixed16Key;
+
+static void
+single_fixed_16_key_hashing_init(HashingStrategy *hashing)
+{
+}
+
+static void
+single_fixed_16_key_hashing_prepare_for_batch(GroupingPolicyHash *policy,
+											  TupleTableSlot *vector_slot)
+{
+}
+
+static pg_attribute_always_inline void
+single_fixed_16_key_hashing_get_key(BatchHashingParams params, int row,
+									void *restrict output_key_ptr,
+									void *restrict hash_table_key_ptr, bool *restrict valid)
+{
+	Fixed16Key *restrict output_key = (Fixed16Key *) output_key_ptr;
+	Fixed16Key *restrict hash_table_key = (Fixed16Key *) hash_table_key_ptr;
+
+	if (unlikely(params.single_grouping_column.decompression_type == DT_Scalar))
+	{
+		*valid = !*params.single_grouping_column.output_isnull;
+		if (*valid)
+		{
+			memcpy(output_key,
+				   DatumGetPointer(*params.single_grouping_column.output_value),
+				   sizeof(*output_key));
+		}
+	}
+	else if (params.single_grouping_column.decompression_type == sizeof(Fixed16Key))
+	{
+		const uint8 *values = params.single_grouping_column.buffers[1];
+		*valid = arrow_row_is_valid(params.single_grouping_column.buffers[0], row);
+		memcpy(output_key, &values[sizeof(Fixed16Key) * row], sizeof(*output_key));
+	}
+	else
+	{
+		pg_unreachable();
+	}
+
+	*hash_table_key = *output_key;
+}
+
+static pg_attribute_always_inline void
+single_fixed_16_key_hashing_store_new(HashingStrategy *restrict hashing, uint32 new_key_index,
+									  Fixed16Key output_key)
+{
+	Fixed16Key *stored = MemoryContextAlloc(hashing->key_body_mctx, sizeof(Fixed16Key));
+	*stored = output_key;
+	hashing->output_keys[new_key_index] = PointerGetDatum(stored);
+}
+
+static void
+single_fixed_16_emit_key(GroupingPolicyHash *policy, uint32 current_key,
+						 TupleTableSlot *aggregated_slot)
+{
+	hash_strategy_output_key_single_emit(policy, current_key, aggregated_slot);
+}
+
+/*
+ * The hash function of the second half is not linear, so that we don't get
+ * collisions for the keys that differ in the same bits of both halves.
+ */
+#define KEY_EQUAL(a, b) ((a).first == (b).first && (a).second == (b).second)
+#define KEY_HASH(X) HASH64((X).first ^ hash64_splitmix((X).second))
+
+#include "hash_strategy_impl.c"
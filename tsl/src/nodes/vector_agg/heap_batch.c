@@ -0,0 +1,270 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Building the batches of uncompressed heap tuples for the vectorized
+ * aggregation. The tuples are read from the child scan node, and their
+ * referenced columns are copied into the arrow arrays, so that the grouping
+ * policies can work with them the same way as with the decompressed batches.
+ */
+
+#include <postgres.h>
+
+#include <executor/executor.h>
+#include <executor/tuptable.h>
+#include <nodes/bitmapset.h>
+#include <utils/memutils.h>
+
+#include "compression/arrow_c_data_interface.h"
+#include "heap_batch.h"
+
+/*
+ * The bodies of the text values are stored without the varlena header, same
+ * as in the decompressed text arrow arrays. The buffer is allocated for each
+ * batch, starting from the size used by the previous one.
+ */
+#define HEAP_BATCH_INITIAL_BODIES_BYTES (16 * 1024)
+
+HeapBatchState *
+heap_batch_create(TupleDesc tupdesc, const Bitmapset *attnos, int max_rows)
+{
+	HeapBatchState *heap_batch = palloc0(sizeof(HeapBatchState));
+	heap_batch->max_rows = max_rows;
+	heap_batch->num_columns = bms_num_members(attnos);
+	heap_batch->columns = palloc0(sizeof(HeapBatchColumn) * heap_batch->num_columns);
+	heap_batch->batch = palloc0(sizeof(DecompressBatchState) +
+								sizeof(CompressedColumnValues) * tupdesc->natts);
+
+	/*
+	 * We use the AllocSet context here and not the Generation context like
+	 * the compressed batches, because the text bodies buffer is grown by
+	 * reallocation.
+	 */
+	heap_batch->batch->per_batch_context =
+		AllocSetContextCreate(CurrentMemoryContext, "VectorAgg heap batch", ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * The arrow arrays have the values for the padding rows up to the multiple
+	 * of 64, and the value buffers have the 64-byte padding, so that the
+	 * vectorized functions can process them in full words.
+	 */
+	const int padded_rows = pad_to_multiple(64, max_rows);
+
+	int column_index = 0;
+	int attno = -1;
+	while ((attno = bms_next_member(attnos, attno)) >= 0)
+	{
+		HeapBatchColumn *column = &heap_batch->columns[column_index++];
+		const Form_pg_attribute attr = TupleDescAttr(tupdesc, AttrNumberGetAttrOffset(attno));
+
+		column->attoff = AttrNumberGetAttrOffset(attno);
+		column->typlen = attr->attlen;
+		column->arrow.buffers = column->arrow_buffers;
+		column->arrow.buffers[0] = palloc0(sizeof(uint64) * padded_rows / 64);
+
+		if (column->typlen > 0)
+		{
+			Assert(attr->attbyval);
+			column->arrow.n_buffers = 2;
+			column->arrow.buffers[1] = palloc0(column->typlen * padded_rows + 64);
+		}
+		else
+		{
+			Assert(column->typlen == -1);
+			column->arrow.n_buffers = 3;
+			column->arrow.buffers[1] = palloc0(sizeof(uint32) * (padded_rows + 1));
+			column->bodies_bytes = HEAP_BATCH_INITIAL_BODIES_BYTES;
+		}
+
+		heap_batch->max_attno = Max(heap_batch->max_attno, attno);
+	}
+
+	return heap_batch;
+}
+
+/*
+ * Append the text value to the text arrow array under construction.
+ */
+static void
+heap_batch_append_text(HeapBatchColumn *column, int row, Datum datum, MemoryContext mcxt)
+{
+	uint32 *offsets = (uint32 *) column->arrow.buffers[1];
+	const uint32 start = offsets[row];
+
+	MemoryContext old = MemoryContextSwitchTo(mcxt);
+	struct varlena *detoasted = PG_DETOAST_DATUM_PACKED(datum);
+	MemoryContextSwitchTo(old);
+
+	const Size len = VARSIZE_ANY_EXHDR(detoasted);
+	if (len > PG_UINT32_MAX - start)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("text values in a batch are too large for vectorized aggregation")));
+	}
+
+	if (start + len + 64 > column->bodies_bytes)
+	{
+		column->bodies_bytes = Max(column->bodies_bytes * 2, start + len + 64);
+		column->arrow.buffers[2] = repalloc_huge((void *) column->arrow.buffers[2],
+												 column->bodies_bytes);
+	}
+
+	memcpy((char *) column->arrow.buffers[2] + start, VARDATA_ANY(detoasted), len);
+	offsets[row + 1] = start + len;
+
+	if ((Pointer) detoasted != DatumGetPointer(datum))
+	{
+		pfree(detoasted);
+	}
+}
+
+/*
+ * Read the next batch of tuples from the child scan node. The previous batch
+ * is discarded. Returns false if the child scan has no more tuples.
+ */
+bool
+heap_batch_fill(HeapBatchState *heap_batch, ScanState *scanstate)
+{
+	DecompressBatchState *batch = heap_batch->batch;
+
+	MemoryContextReset(batch->per_batch_context);
+	batch->total_batch_rows = 0;
+	batch->next_batch_row = 0;
+
+	if (heap_batch->input_ended)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < heap_batch->num_columns; i++)
+	{
+		HeapBatchColumn *column = &heap_batch->columns[i];
+		memset((void *) column->arrow.buffers[0],
+			   0,
+			   sizeof(uint64) * pad_to_multiple(64, heap_batch->max_rows) / 64);
+
+		if (column->typlen < 0)
+		{
+			((uint32 *) column->arrow.buffers[1])[0] = 0;
+			column->arrow.buffers[2] =
+				MemoryContextAllocHuge(batch->per_batch_context, column->bodies_bytes);
+		}
+	}
+
+	int row = 0;
+	while (row < heap_batch->max_rows)
+	{
+		/*
+		 * The child node evaluates its quals and might project, but we take
+		 * the heap tuple from its scan slot. It stays valid until the next
+		 * call of the child node.
+		 */
+		TupleTableSlot *slot = ExecProcNode(&scanstate->ps);
+		if (TupIsNull(slot))
+		{
+			/*
+			 * We can't call the child node again after it has ended, so
+			 * remember this until the current batch is aggregated.
+			 */
+			heap_batch->input_ended = true;
+			break;
+		}
+
+		TupleTableSlot *scan_slot = scanstate->ss_ScanTupleSlot;
+		slot_getsomeattrs(scan_slot, heap_batch->max_attno);
+
+		for (int i = 0; i < heap_batch->num_columns; i++)
+		{
+			HeapBatchColumn *column = &heap_batch->columns[i];
+			const bool isnull = scan_slot->tts_isnull[column->attoff];
+			const Datum datum = scan_slot->tts_values[column->attoff];
+
+			arrow_set_row_validity((uint64 *) column->arrow.buffers[0], row, !isnull);
+
+			if (column->typlen > 0)
+			{
+				char *value = (char *) column->arrow.buffers[1] + row * column->typlen;
+				if (isnull)
+				{
+					memset(value, 0, column->typlen);
+				}
+				else
+				{
+					store_att_byval(value, datum, column->typlen);
+				}
+			}
+			else if (isnull)
+			{
+				uint32 *offsets = (uint32 *) column->arrow.buffers[1];
+				offsets[row + 1] = offsets[row];
+			}
+			else
+			{
+				heap_batch_append_text(column, row, datum, batch->per_batch_context);
+			}
+		}
+
+		row++;
+	}
+
+	if (row == 0)
+	{
+		return false;
+	}
+
+	/* The child node has already filtered the rows. */
+	batch->total_batch_rows = row;
+	batch->vector_qual_result = NULL;
+
+	for (int i = 0; i < heap_batch->num_columns; i++)
+	{
+		HeapBatchColumn *column = &heap_batch->columns[i];
+		column->arrow.length = row;
+		column->arrow.null_count = row - arrow_num_valid(column->arrow.buffers[0], row);
+
+		CompressedColumnValues *values = &batch->compressed_columns[column->attoff];
+		*values = (CompressedColumnValues){
+			.decompression_type = column->typlen > 0 ? column->typlen : DT_ArrowText,
+			.buffers = { column->arrow.buffers[0],
+						 column->arrow.buffers[1],
+						 column->typlen > 0 ? NULL : column->arrow.buffers[2],
+						 NULL },
+			.arrow = &column->arrow,
+		};
+	}
+
+	return true;
+}
+
+/*
+ * Get the arrow array for the vectorized quals of the aggregate FILTER
+ * clauses. The heap batches have only the plain column references there.
+ */
+const ArrowArray *
+heap_batch_get_arrow_array(VectorQualState *vqstate, Expr *expr, bool *is_default_value)
+{
+	CompressedBatchVectorQualState *cbvqstate = (CompressedBatchVectorQualState *) vqstate;
+	const Var *var = castNode(Var, expr);
+	const CompressedColumnValues *values =
+		&cbvqstate->batch_state->compressed_columns[AttrNumberGetAttrOffset(var->varattno)];
+
+	Ensure(values->arrow != NULL, "column %d is not read into the heap batch", var->varattno);
+
+	*is_default_value = false;
+	return values->arrow;
+}
+
+/*
+ * Prepare for reading the child scan node again after a rescan.
+ */
+void
+heap_batch_reset(HeapBatchState *heap_batch)
+{
+	MemoryContextReset(heap_batch->batch->per_batch_context);
+	heap_batch->batch->total_batch_rows = 0;
+	heap_batch->input_ended = false;
+}
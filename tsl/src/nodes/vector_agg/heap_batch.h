@@ -0,0 +1,58 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <access/tupdesc.h>
+#include <nodes/execnodes.h>
+
+#include "nodes/decompress_chunk/compressed_batch.h"
+
+/*
+ * A batch of uncompressed heap tuples, copied into the arrow arrays so that
+ * the vectorized aggregation can process them the same way as the compressed
+ * batches.
+ */
+typedef struct HeapBatchColumn
+{
+	/* The attribute offset in the heap relation. */
+	int attoff;
+	int16 typlen;
+
+	ArrowArray arrow;
+	const void *arrow_buffers[3];
+
+	/* The size of the text bodies buffer. */
+	Size bodies_bytes;
+} HeapBatchColumn;
+
+typedef struct HeapBatchState
+{
+	int max_rows;
+
+	int num_columns;
+	HeapBatchColumn *columns;
+
+	/* The last referenced attribute number, to deform the tuples up to it. */
+	AttrNumber max_attno;
+
+	/* The child scan has returned all its tuples. */
+	bool input_ended;
+
+	/*
+	 * The batch in the form understood by the grouping policies. The
+	 * compressed_columns are indexed by the attribute offset in the heap
+	 * relation, and only the referenced ones are filled.
+	 */
+	DecompressBatchState *batch;
+} HeapBatchState;
+
+extern HeapBatchState *heap_batch_create(TupleDesc tupdesc, const Bitmapset *attnos,
+										 int max_rows);
+extern bool heap_batch_fill(HeapBatchState *heap_batch, ScanState *scanstate);
+extern void heap_batch_reset(HeapBatchState *heap_batch);
+extern const ArrowArray *heap_batch_get_arrow_array(VectorQualState *vqstate, Expr *expr,
+													bool *is_default_value);
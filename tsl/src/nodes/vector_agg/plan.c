@@ -11,17 +11,23 @@
 #include <nodes/makefuncs.h>
 #include <nodes/nodeFuncs.h>
 #include <nodes/plannodes.h>
+#include <parser/parse_func.h>
 #include <parser/parsetree.h>
 #include <utils/fmgroids.h>
+#include <utils/lsyscache.h>
+#include <utils/regproc.h>
 
 #include "plan.h"
 
 #include "exec.h"
+#include "extension_constants.h"
+#include "guc.h"
 #include "import/list.h"
 #include "nodes/columnar_scan/columnar_scan.h"
 #include "nodes/decompress_chunk/vector_quals.h"
 #include "nodes/vector_agg.h"
 #include "utils.h"
+#include "vector_expr.h"
 
 static struct CustomScanMethods scan_methods = { .CustomName = VECTOR_AGG_NODE_NAME,
 												 .CreateCustomScanState = vector_agg_state_create };
@@ -78,8 +84,8 @@ resolve_outer_special_vars_mutator(Node *node, void *context)
 	}
 
 	Var *var = castNode(Var, node);
-	CustomScan *custom = castNode(CustomScan, context);
-	if ((Index) var->varno == (Index) custom->scan.scanrelid)
+	Scan *scan = (Scan *) context;
+	if ((Index) var->varno == (Index) scan->scanrelid)
 	{
 		/*
 		 * This is already the uncompressed chunk var. We can see it referenced
@@ -94,17 +100,18 @@ resolve_outer_special_vars_mutator(Node *node, void *context)
 		 * Reference into the output targetlist of the child scan node.
 		 */
 		TargetEntry *decompress_chunk_tentry =
-			castNode(TargetEntry, list_nth(custom->scan.plan.targetlist, var->varattno - 1));
+			castNode(TargetEntry, list_nth(scan->plan.targetlist, var->varattno - 1));
 
 		return resolve_outer_special_vars_mutator((Node *) decompress_chunk_tentry->expr, context);
 	}
 
-	if (var->varno == INDEX_VAR)
+	if (var->varno == INDEX_VAR && IsA(scan, CustomScan))
 	{
 		/*
 		 * This is a reference into the custom scan targetlist, we have to resolve
 		 * it as well.
 		 */
+		CustomScan *custom = castNode(CustomScan, scan);
 		var = castNode(Var,
 					   castNode(TargetEntry, list_nth(custom->custom_scan_tlist, var->varattno - 1))
 						   ->expr);
@@ -200,6 +207,49 @@ vector_agg_plan_create(Plan *childplan, Agg *agg, List *resolved_targetlist,
 	return (Plan *) vector_agg;
 }
 
+static Oid partialize_agg_func_oid = InvalidOid;
+
+/*
+ * Return the aggregate of the aggregated targetlist entry, or NULL if the
+ * entry is a grouping column. The aggregate can be wrapped in the
+ * partialize_agg() function that the continuous aggregates in the old format
+ * use to materialize the partial aggregate states. It is computed as part of
+ * the vectorized aggregation, so that the refresh of these aggregates can be
+ * vectorized as well.
+ */
+Aggref *
+vector_agg_get_aggref(Expr *expr, bool *partialized)
+{
+	*partialized = false;
+
+	if (IsA(expr, Aggref))
+		return castNode(Aggref, expr);
+
+	if (!IsA(expr, FuncExpr))
+		return NULL;
+
+	FuncExpr *func = castNode(FuncExpr, expr);
+	if (list_length(func->args) != 1 || !IsA(linitial(func->args), Aggref))
+		return NULL;
+
+	if (!OidIsValid(partialize_agg_func_oid))
+	{
+		Oid argtypes[] = { ANYELEMENTOID };
+		List *qualified_name =
+			list_make2(makeString(FUNCTIONS_SCHEMA_NAME), makeString("partialize_agg"));
+		partialize_agg_func_oid = LookupFuncName(qualified_name,
+												 lengthof(argtypes),
+												 argtypes,
+												 /* missing_ok = */ true);
+	}
+
+	if (func->funcid != partialize_agg_func_oid)
+		return NULL;
+
+	*partialized = true;
+	return linitial_node(Aggref, func->args);
+}
+
 /*
  * Whether the expression can be used for vectorized processing: must be a Var
  * that refers to either a bulk-decompressed or a segmentby column.
@@ -226,6 +276,65 @@ is_vector_var(const VectorQualInfo *vqinfo, Expr *expr)
 	return vqinfo->vector_attrs && vqinfo->vector_attrs[var->varattno];
 }
 
+/*
+ * Whether the expression can be computed by the vectorized expression
+ * evaluation: an arithmetic expression over vector columns and constants. The
+ * types of the function arguments are checked by
+ * vector_expr_function_is_supported().
+ */
+static bool
+is_vector_expr(const VectorQualInfo *vqinfo, Expr *expr)
+{
+	if (IsA(expr, Var))
+	{
+		return is_vector_var(vqinfo, expr);
+	}
+
+	if (IsA(expr, Const))
+	{
+		return true;
+	}
+
+	Oid funcid;
+	List *args;
+	if (IsA(expr, OpExpr))
+	{
+		OpExpr *opexpr = castNode(OpExpr, expr);
+		funcid = OidIsValid(opexpr->opfuncid) ? opexpr->opfuncid : get_opcode(opexpr->opno);
+		args = opexpr->args;
+	}
+	else if (IsA(expr, FuncExpr))
+	{
+		FuncExpr *funcexpr = castNode(FuncExpr, expr);
+		if (funcexpr->funcretset || funcexpr->funcvariadic)
+		{
+			return false;
+		}
+		funcid = funcexpr->funcid;
+		args = funcexpr->args;
+	}
+	else
+	{
+		return false;
+	}
+
+	if (!vector_expr_function_is_supported(funcid, exprType((Node *) expr), args))
+	{
+		return false;
+	}
+
+	ListCell *lc;
+	foreach (lc, args)
+	{
+		if (!is_vector_expr(vqinfo, lfirst(lc)))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /*
  * Whether we can vectorize this particular aggregate.
  */
@@ -261,7 +370,11 @@ can_vectorize_aggref(const VectorQualInfo *vqi, Aggref *aggref)
 		aggref->aggfilter = (Expr *) aggfilter_vectorized;
 	}
 
-	if (get_vector_aggregate(aggref->aggfnoid) == NULL)
+	const VectorAggFunctions *func =
+		get_vector_aggregate(aggref->aggfnoid,
+							 aggref->aggargtypes != NIL ? linitial_oid(aggref->aggargtypes) :
+														  InvalidOid);
+	if (func == NULL)
 	{
 		/*
 		 * We don't have a vectorized implementation for this particular
@@ -276,18 +389,94 @@ can_vectorize_aggref(const VectorQualInfo *vqi, Aggref *aggref)
 		return true;
 	}
 
-	/* The function must have one argument, check it. */
-	Assert(list_length(aggref->args) == 1);
+	if (func->agg_prepare != NULL)
+	{
+		/*
+		 * The arguments after the first one are constant parameters, check
+		 * that the vectorized implementation supports them.
+		 */
+		VectorAggFunctions prepared = *func;
+		if (!prepared.agg_prepare(&prepared, aggref))
+		{
+			return false;
+		}
+	}
+	else if (list_length(aggref->args) == 2)
+	{
+		/*
+		 * The two-argument functions like first(value, time) support only
+		 * the bare columns of some types.
+		 */
+		TargetEntry *value = castNode(TargetEntry, linitial(aggref->args));
+		TargetEntry *cmp = castNode(TargetEntry, lsecond(aggref->args));
+		return IsA(value->expr, Var) && IsA(cmp->expr, Var) &&
+			   is_vector_expr(vqi, value->expr) && is_vector_expr(vqi, cmp->expr) &&
+			   vector_bookend_supports_types(exprType((Node *) value->expr),
+											 exprType((Node *) cmp->expr));
+	}
+
+	/* Check the first argument, which is the only one if there are no parameters. */
+	Assert(list_length(aggref->args) == 1 || func->agg_prepare != NULL);
 	TargetEntry *argument = castNode(TargetEntry, linitial(aggref->args));
 
-	return is_vector_var(vqi, argument->expr);
+	if (func->scalar_argument_only)
+	{
+		/* The argument must be a segmentby column. */
+		return is_vector_var(vqi, argument->expr) &&
+			   vqi->segmentby_attrs[castNode(Var, argument->expr)->varattno];
+	}
+
+	/*
+	 * The argument is either a bare column or an arithmetic expression that
+	 * we can compute for the entire batch. A bare constant is not supported,
+	 * because its type is not checked by the expression functions.
+	 */
+	return !IsA(argument->expr, Const) && is_vector_expr(vqi, argument->expr);
+}
+
+/*
+ * Account for a grouping column of the given type in the packed fixed-size
+ * grouping key.
+ */
+static void
+add_packed_key_column(Oid type, bool *fits, int *value_bytes)
+{
+	int16 typlen;
+	bool typbyval;
+	get_typlenbyval(type, &typlen, &typbyval);
+
+	if (!typbyval || (typlen != 2 && typlen != 4 && typlen != 8))
+	{
+		*fits = false;
+		return;
+	}
+
+	*value_bytes += typlen;
+	*fits = *fits && *value_bytes <= 15;
+}
+
+/*
+ * Check if the values of the grouping column can be compared as Datums by the
+ * sorted grouping policy, see grouping_policy_sorted.c.
+ */
+static bool
+is_fixed_by_value_key_column(Oid type)
+{
+	int16 typlen;
+	bool typbyval;
+	get_typlenbyval(type, &typlen, &typbyval);
+
+	return typbyval && (typlen == 2 || typlen == 4 || typlen == 8);
 }
 
 /*
  * What vectorized grouping strategy we can use for the given grouping columns.
+ * The input_sorted tells that the rows come sorted by the grouping columns in
+ * the order the vectorized aggregation reads them.
  */
 static VectorAggGroupingType
-get_vectorized_grouping_type(const VectorQualInfo *vqinfo, Agg *agg, List *resolved_targetlist)
+get_vectorized_grouping_type(const VectorQualInfo *vqinfo, Agg *agg, List *resolved_targetlist,
+							 bool input_sorted)
 {
 	/*
 	 * The Agg->numCols value can be less than the number of the non-aggregated
@@ -298,13 +487,26 @@ get_vectorized_grouping_type(const VectorQualInfo *vqinfo, Agg *agg, List *resol
 	 */
 	int num_grouping_columns = 0;
 	bool all_segmentby = true;
-	Var *single_grouping_var = NULL;
+	Oid single_grouping_type = InvalidOid;
+
+	/*
+	 * Whether the grouping columns can be packed into a 16-byte key, see
+	 * hash_strategy_packed_fixed_16.c. The last byte of the key is the null
+	 * bitmap, so we can have up to 15 bytes of values, which is at most 7
+	 * columns.
+	 */
+	bool packed_key_fits = true;
+	int packed_key_value_bytes = 0;
+
+	/* Whether the sorted grouping policy supports all grouping columns. */
+	bool all_fixed_by_value = true;
 
 	ListCell *lc;
 	foreach (lc, resolved_targetlist)
 	{
 		TargetEntry *target_entry = lfirst_node(TargetEntry, lc);
-		if (IsA(target_entry->expr, Aggref))
+		bool partialized;
+		if (vector_agg_get_aggref(target_entry->expr, &partialized) != NULL)
 		{
 			continue;
 		}
@@ -312,11 +514,24 @@ get_vectorized_grouping_type(const VectorQualInfo *vqinfo, Agg *agg, List *resol
 		if (!IsA(target_entry->expr, Var))
 		{
 			/*
-			 * We shouldn't see anything except Vars or Aggrefs in the
-			 * aggregated targetlists. Just say it's not vectorizable, because
-			 * here we are working with arbitrary plans that we don't control.
+			 * Besides the bare columns, we can group by the expressions that
+			 * the vectorized expression evaluation can compute, most notably
+			 * time_bucket() with a fixed-width bucket. Anything else is not
+			 * vectorizable, because here we are working with arbitrary plans
+			 * that we don't control.
 			 */
-			return VAGT_Invalid;
+			if (IsA(target_entry->expr, Const) || !is_vector_expr(vqinfo, target_entry->expr))
+				return VAGT_Invalid;
+
+			/* The computed grouping keys are never treated as segmentby. */
+			num_grouping_columns++;
+			all_segmentby = false;
+			single_grouping_type = exprType((Node *) target_entry->expr);
+			add_packed_key_column(single_grouping_type,
+								  &packed_key_fits,
+								  &packed_key_value_bytes);
+			all_fixed_by_value &= is_fixed_by_value_key_column(single_grouping_type);
+			continue;
 		}
 
 		num_grouping_columns++;
@@ -328,18 +543,20 @@ get_vectorized_grouping_type(const VectorQualInfo *vqinfo, Agg *agg, List *resol
 		all_segmentby &= vqinfo->segmentby_attrs[var->varattno];
 
 		/*
-		 * If we have a single grouping column, record it for the additional
-		 * checks later.
+		 * If we have a single grouping column, record its type for the
+		 * additional checks later.
 		 */
-		single_grouping_var = var;
+		single_grouping_type = var->vartype;
+		add_packed_key_column(var->vartype, &packed_key_fits, &packed_key_value_bytes);
+		all_fixed_by_value &= is_fixed_by_value_key_column(var->vartype);
 	}
 
 	if (num_grouping_columns != 1)
 	{
-		single_grouping_var = NULL;
+		single_grouping_type = InvalidOid;
 	}
 
-	Assert(num_grouping_columns == 1 || single_grouping_var == NULL);
+	Assert(num_grouping_columns == 1 || single_grouping_type == InvalidOid);
 	Assert(num_grouping_columns >= agg->numCols);
 
 	/*
@@ -358,9 +575,20 @@ get_vectorized_grouping_type(const VectorQualInfo *vqinfo, Agg *agg, List *resol
 		return VAGT_Batch;
 	}
 
+	/*
+	 * When the input is sorted by the grouping columns, e.g. by a segmentby
+	 * and orderby prefix, the rows of a group are consecutive. Then we can
+	 * find the group boundaries and emit the finished groups right away,
+	 * without hashing.
+	 */
+	if (input_sorted && all_fixed_by_value && num_grouping_columns <= INDEX_MAX_KEYS)
+	{
+		return VAGT_Sorted;
+	}
+
 	/*
 	 * We support hashed vectorized grouping by one fixed-size by-value
-	 * compressed column.
+	 * compressed column, or a 16-byte by-reference one such as UUID.
 	 * We can use our hash table for GroupAggregate as well, because it preserves
 	 * the input order of the keys, but only for the direct order, not reverse.
 	 */
@@ -369,7 +597,7 @@ get_vectorized_grouping_type(const VectorQualInfo *vqinfo, Agg *agg, List *resol
 		int16 typlen;
 		bool typbyval;
 
-		get_typlenbyval(single_grouping_var->vartype, &typlen, &typbyval);
+		get_typlenbyval(single_grouping_type, &typlen, &typbyval);
 		if (typbyval)
 		{
 			switch (typlen)
@@ -385,17 +613,31 @@ get_vectorized_grouping_type(const VectorQualInfo *vqinfo, Agg *agg, List *resol
 					break;
 			}
 		}
+		else if (typlen == 16)
+		{
+			return VAGT_HashSingleFixed16;
+		}
 #ifdef TS_USE_UMASH
 		else
 		{
-			Ensure(single_grouping_var->vartype == TEXTOID,
+			Ensure(single_grouping_type == TEXTOID,
 				   "invalid vector type %d for grouping",
-				   single_grouping_var->vartype);
+				   single_grouping_type);
 			return VAGT_HashSingleText;
 		}
 #endif
 	}
 
+	/*
+	 * Several fixed-size by-value columns, such as (tenant_id, metric_id), can
+	 * be packed into one fixed-size key, which is much cheaper to hash than the
+	 * serialized key.
+	 */
+	if (packed_key_fits)
+	{
+		return VAGT_HashPackedFixed16;
+	}
+
 #ifdef TS_USE_UMASH
 	/*
 	 * Use hashing of serialized keys when we have many grouping columns.
@@ -489,6 +731,17 @@ has_vector_agg_node(Plan *plan, bool *has_normal_agg)
 static bool
 vectoragg_plan_possible(Plan *childplan, const List *rtable, VectorQualInfo *vqi)
 {
+	if (ts_guc_enable_heap_vectorized_aggregation &&
+		vectoragg_plan_heap_possible(childplan, rtable))
+	{
+		/*
+		 * The uncompressed chunks are read by the child scan node, which
+		 * evaluates its quals as usual, so they are allowed here.
+		 */
+		vectoragg_plan_heap(childplan, rtable, vqi);
+		return true;
+	}
+
 	if (!IsA(childplan, CustomScan))
 		return false;
 
@@ -521,6 +774,19 @@ vectoragg_plan_possible(Plan *childplan, const List *rtable, VectorQualInfo *vqi
 	return false;
 }
 
+/*
+ * Report why a partial aggregation node is not vectorized, to help with
+ * finding out why a query, e.g., the real-time part of a continuous
+ * aggregate, doesn't use the vectorized aggregation. The reason is shown
+ * with client_min_messages = debug2 when running EXPLAIN.
+ */
+static Plan *
+vector_agg_not_used(Plan *plan, const char *reason)
+{
+	elog(DEBUG2, "vectorized aggregation not used: %s", reason);
+	return plan;
+}
+
 /*
  * Where possible, replace the partial aggregation plan nodes with our own
  * vectorized aggregation node. The replacement is done in-place.
@@ -587,7 +853,7 @@ try_insert_vector_agg_node(Plan *plan, List *rtable)
 	if (agg->groupingSets != NIL)
 	{
 		/* No GROUPING SETS support. */
-		return plan;
+		return vector_agg_not_used(plan, "grouping sets are not supported");
 	}
 
 	if (agg->plan.qual != NIL)
@@ -597,7 +863,7 @@ try_insert_vector_agg_node(Plan *plan, List *rtable)
 		 * because we only replace the partial aggregation nodes which can't
 		 * check the HAVING clause.
 		 */
-		return plan;
+		return vector_agg_not_used(plan, "aggregation has a HAVING clause");
 	}
 
 	if (agg->plan.lefttree == NULL)
@@ -606,7 +872,7 @@ try_insert_vector_agg_node(Plan *plan, List *rtable)
 		 * Not sure what this would mean, but check for it just to be on the
 		 * safe side because we can effectively see any possible plan here.
 		 */
-		return plan;
+		return vector_agg_not_used(plan, "aggregation has no child plan");
 	}
 
 	Plan *childplan = agg->plan.lefttree;
@@ -620,7 +886,10 @@ try_insert_vector_agg_node(Plan *plan, List *rtable)
 	if (!vectoragg_plan_possible(childplan, rtable, &vqi))
 	{
 		/* Not a compatible vectoragg child node */
-		return plan;
+		return vector_agg_not_used(plan,
+								   childplan->qual != NIL ?
+									   "child scan has non-vectorized quals" :
+									   "child plan is not a supported scan");
 	}
 
 	/*
@@ -630,12 +899,18 @@ try_insert_vector_agg_node(Plan *plan, List *rtable)
 	 */
 	List *resolved_targetlist = resolve_outer_special_vars(agg->plan.targetlist, childplan);
 
+	/*
+	 * The sorted partial aggregation gets the input sorted by the grouping
+	 * columns. We read the batches in the reverse order, but the rows inside
+	 * them in the direct order, so the reverse order doesn't work.
+	 */
+	const bool input_sorted = agg->aggstrategy == AGG_SORTED && !vqi.reverse;
 	const VectorAggGroupingType grouping_type =
-		get_vectorized_grouping_type(&vqi, agg, resolved_targetlist);
+		get_vectorized_grouping_type(&vqi, agg, resolved_targetlist, input_sorted);
 	if (grouping_type == VAGT_Invalid)
 	{
 		/* The grouping is not vectorizable. */
-		return plan;
+		return vector_agg_not_used(plan, "grouping columns are not vectorizable");
 	}
 
 	/*
@@ -647,7 +922,7 @@ try_insert_vector_agg_node(Plan *plan, List *rtable)
 	{
 		if (vqi.reverse)
 		{
-			return plan;
+			return vector_agg_not_used(plan, "hash grouping cannot produce the reverse order");
 		}
 	}
 
@@ -656,13 +931,16 @@ try_insert_vector_agg_node(Plan *plan, List *rtable)
 	foreach (lc, resolved_targetlist)
 	{
 		TargetEntry *target_entry = lfirst_node(TargetEntry, lc);
-		if (IsA(target_entry->expr, Aggref))
+		bool partialized;
+		Aggref *aggref = vector_agg_get_aggref(target_entry->expr, &partialized);
+		if (aggref != NULL)
 		{
-			Aggref *aggref = castNode(Aggref, target_entry->expr);
 			if (!can_vectorize_aggref(&vqi, aggref))
 			{
 				/* Aggregate function not vectorizable. */
-				return plan;
+				return vector_agg_not_used(plan,
+										   psprintf("aggregate function %s is not vectorizable",
+													format_procedure(aggref->aggfnoid)));
 			}
 		}
 		else if (IsA(target_entry->expr, Var))
@@ -670,9 +948,13 @@ try_insert_vector_agg_node(Plan *plan, List *rtable)
 			if (!is_vector_var(&vqi, target_entry->expr))
 			{
 				/* Variable not vectorizable. */
-				return plan;
+				return vector_agg_not_used(plan, "output column is not vectorizable");
 			}
 		}
+		else if (!IsA(target_entry->expr, Const) && is_vector_expr(&vqi, target_entry->expr))
+		{
+			/* A computed grouping key, checked above. */
+		}
 		else
 		{
 			/*
@@ -680,7 +962,7 @@ try_insert_vector_agg_node(Plan *plan, List *rtable)
 			 * e.g. we can see a nested loop param in its output targetlist. We
 			 * can't handle this case currently.
 			 */
-			return plan;
+			return vector_agg_not_used(plan, "aggregation has to project its output");
 		}
 	}
 
@@ -21,5 +21,8 @@ typedef enum
 extern void _vector_agg_init(void);
 extern void vectoragg_plan_decompress_chunk(Plan *childplan, VectorQualInfo *vqi);
 extern void vectoragg_plan_tam(Plan *childplan, const List *rtable, VectorQualInfo *vqi);
+extern bool vectoragg_plan_heap_possible(Plan *childplan, const List *rtable);
+extern void vectoragg_plan_heap(Plan *childplan, const List *rtable, VectorQualInfo *vqi);
+extern Aggref *vector_agg_get_aggref(Expr *expr, bool *partialized);
 Plan *try_insert_vector_agg_node(Plan *plan, List *rtable);
 bool has_vector_agg_node(Plan *plan, bool *has_normal_agg);
@@ -0,0 +1,84 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#include <postgres.h>
+#include <access/attnum.h>
+#include <access/table.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_type.h>
+#include <nodes/parsenodes.h>
+#include <nodes/plannodes.h>
+#include <parser/parsetree.h>
+#include <utils/rel.h>
+
+#include "nodes/decompress_chunk/vector_quals.h"
+#include "plan.h"
+#include "utils.h"
+
+/*
+ * Whether the child plan is a scan of an uncompressed heap relation that can
+ * be read in batches by the vectorized aggregation. The heap tuples are taken
+ * from the scan tuple slot of the child node, so we only support the scan
+ * nodes that read the entire heap tuples into it.
+ */
+bool
+vectoragg_plan_heap_possible(Plan *childplan, const List *rtable)
+{
+	if (!IsA(childplan, SeqScan) && !IsA(childplan, IndexScan) && !IsA(childplan, BitmapHeapScan))
+	{
+		return false;
+	}
+
+	const Scan *scan = (const Scan *) childplan;
+	if (scan->scanrelid == 0)
+	{
+		return false;
+	}
+
+	RangeTblEntry *rte = rt_fetch(scan->scanrelid, rtable);
+	return rte->rtekind == RTE_RELATION && rte->relkind == RELKIND_RELATION &&
+		   ts_get_rel_am(rte->relid) == HEAP_TABLE_AM_OID;
+}
+
+void
+vectoragg_plan_heap(Plan *childplan, const List *rtable, VectorQualInfo *vqi)
+{
+	const Scan *scan = (const Scan *) childplan;
+	RangeTblEntry *rte = rt_fetch(scan->scanrelid, rtable);
+	Relation rel = table_open(rte->relid, AccessShareLock);
+	const TupleDesc tupdesc = RelationGetDescr(rel);
+
+	*vqi = (VectorQualInfo){
+		.rti = scan->scanrelid,
+		.maxattno = tupdesc->natts,
+		.vector_attrs = (bool *) palloc0(sizeof(bool) * (tupdesc->natts + 1)),
+		.segmentby_attrs = (bool *) palloc0(sizeof(bool) * (tupdesc->natts + 1)),
+		/*
+		 * The batches are built in the order the tuples are returned by the
+		 * child scan.
+		 */
+		.reverse = false,
+	};
+
+	for (int i = 0; i < tupdesc->natts; i++)
+	{
+		const Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
+		if (attr->attisdropped)
+		{
+			continue;
+		}
+
+		/*
+		 * The heap tuples are copied into the arrow arrays of fixed-size
+		 * by-value types, or of text. There are no segmentby columns.
+		 */
+		const bool fixed_by_value =
+			attr->attbyval && (attr->attlen == 2 || attr->attlen == 4 || attr->attlen == 8);
+		vqi->vector_attrs[AttrOffsetGetAttrNumber(i)] = fixed_by_value || attr->atttypid == TEXTOID;
+	}
+
+	table_close(rel, NoLock);
+}
@@ -0,0 +1,926 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Vectorized evaluation of simple arithmetic expressions for the arguments of
+ * vectorized aggregate functions. The supported expressions are trees of the
+ * arithmetic operators, abs() and the numeric casts over the arithmetic
+ * columns and constants, and time_bucket() with a fixed-width bucket, also in
+ * a timezone. The
+ * result is an arrow array computed for the rows that pass the given filter,
+ * or a scalar if all the inputs are scalar.
+ */
+
+#include <postgres.h>
+#include <catalog/pg_type_d.h>
+#include <common/int.h>
+#include <datatype/timestamp.h>
+#include <nodes/nodeFuncs.h>
+#include <utils/builtins.h>
+#include <utils/float.h>
+#include <utils/fmgroids.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+
+#include "vector_expr.h"
+
+#include "compression/arrow_c_data_interface.h"
+#include "debug_assert.h"
+#include "func_cache.h"
+#include "nodes/vector_agg/vector_slot.h"
+#include "time_bucket.h"
+
+/*
+ * Computes the function for the rows that pass the filter, and zeroes the
+ * results for the other rows. The stride is 0 for a scalar argument, and 1 for
+ * a vector one.
+ */
+typedef void (*VectorExprFunction)(const void *restrict arg1, int stride1,
+								   const void *restrict arg2, int stride2,
+								   const uint64 *restrict filter, int n, void *restrict result);
+
+/*
+ * Computes time_bucket() with the given period and shift for the rows that
+ * pass the filter, and zeroes the results for the other rows.
+ */
+typedef void (*VectorTimeBucketFunction)(const void *restrict arg, int stride, int64 period,
+										 int64 shift, const uint64 *restrict filter, int n,
+										 void *restrict result);
+
+typedef struct VectorExprFunctionInfo
+{
+	Oid funcid;
+	int nargs;
+	Oid argtype;
+	Oid rettype;
+	VectorExprFunction function;
+} VectorExprFunctionInfo;
+
+typedef enum VectorExprType
+{
+	VET_Column,
+	VET_Const,
+	VET_Function,
+	VET_TimeBucket,
+} VectorExprType;
+
+struct VectorExpr
+{
+	VectorExprType type;
+	Oid typid;
+
+	/* VET_Column */
+	int input_offset;
+
+	/* VET_Const */
+	uint64 const_storage;
+	bool const_isnull;
+
+	/* VET_Function */
+	const VectorExprFunctionInfo *function;
+	VectorExpr *args[2];
+
+	/*
+	 * VET_TimeBucket, the bucketed time expression is args[0]. The shift is
+	 * the default origin modulo period for the timestamps, and zero for the
+	 * integers.
+	 */
+	VectorTimeBucketFunction bucket_function;
+	int64 bucket_period;
+	int64 bucket_shift;
+
+	/* The cached offsets of the timezone for time_bucket() in a timezone */
+	TimezoneOffsetCache *bucket_timezone;
+
+	/* Storage for the scalar result of the entire expression. */
+	Datum result_datum;
+	bool result_isnull;
+};
+
+/*
+ * The value of a subexpression for the current batch.
+ */
+typedef struct VectorExprValue
+{
+	bool is_scalar;
+	bool scalar_isnull;
+	uint64 scalar_storage;
+
+	/* For vector values. The validity bitmap is NULL if all rows are valid. */
+	const uint64 *validity;
+	const void *values;
+} VectorExprValue;
+
+static pg_noinline pg_attribute_noreturn() void
+int4_out_of_range(void)
+{
+	ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE), errmsg("integer out of range")));
+	pg_unreachable();
+}
+
+static pg_noinline pg_attribute_noreturn() void
+int8_out_of_range(void)
+{
+	ereport(ERROR, (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE), errmsg("bigint out of range")));
+	pg_unreachable();
+}
+
+static pg_noinline pg_attribute_noreturn() void
+time_bucket_out_of_range(void)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE), errmsg("timestamp out of range")));
+	pg_unreachable();
+}
+
+/*
+ * The implementations of the integer functions below follow the ones in
+ * utils/adt/int.c and int8.c, and the float ones use utils/float.h, so that
+ * the errors are the same as with the usual evaluation.
+ */
+static inline int32
+vector_int4_pl(int32 a, int32 b)
+{
+	int32 result;
+	if (unlikely(pg_add_s32_overflow(a, b, &result)))
+		int4_out_of_range();
+	return result;
+}
+
+static inline int32
+vector_int4_mi(int32 a, int32 b)
+{
+	int32 result;
+	if (unlikely(pg_sub_s32_overflow(a, b, &result)))
+		int4_out_of_range();
+	return result;
+}
+
+static inline int32
+vector_int4_mul(int32 a, int32 b)
+{
+	int32 result;
+	if (unlikely(pg_mul_s32_overflow(a, b, &result)))
+		int4_out_of_range();
+	return result;
+}
+
+static inline int32
+vector_int4_um(int32 a)
+{
+	if (unlikely(a == PG_INT32_MIN))
+		int4_out_of_range();
+	return -a;
+}
+
+static inline int32
+vector_int4_abs(int32 a)
+{
+	if (unlikely(a == PG_INT32_MIN))
+		int4_out_of_range();
+	return (a < 0) ? -a : a;
+}
+
+static inline int64
+vector_int8_pl(int64 a, int64 b)
+{
+	int64 result;
+	if (unlikely(pg_add_s64_overflow(a, b, &result)))
+		int8_out_of_range();
+	return result;
+}
+
+static inline int64
+vector_int8_mi(int64 a, int64 b)
+{
+	int64 result;
+	if (unlikely(pg_sub_s64_overflow(a, b, &result)))
+		int8_out_of_range();
+	return result;
+}
+
+static inline int64
+vector_int8_mul(int64 a, int64 b)
+{
+	int64 result;
+	if (unlikely(pg_mul_s64_overflow(a, b, &result)))
+		int8_out_of_range();
+	return result;
+}
+
+static inline int64
+vector_int8_um(int64 a)
+{
+	if (unlikely(a == PG_INT64_MIN))
+		int8_out_of_range();
+	return -a;
+}
+
+static inline int64
+vector_int8_abs(int64 a)
+{
+	if (unlikely(a == PG_INT64_MIN))
+		int8_out_of_range();
+	return (a < 0) ? -a : a;
+}
+
+#define BINARY_FUNCTION(NAME, CTYPE, RTYPE, EXPR)                                                  \
+	static void NAME(const void *restrict arg1,                                                    \
+					 int stride1,                                                                  \
+					 const void *restrict arg2,                                                    \
+					 int stride2,                                                                  \
+					 const uint64 *restrict filter,                                                \
+					 int n,                                                                        \
+					 void *restrict result)                                                        \
+	{                                                                                              \
+		const CTYPE *restrict a = arg1;                                                            \
+		const CTYPE *restrict b = arg2;                                                            \
+		RTYPE *restrict r = result;                                                                \
+		for (int row = 0; row < n; row++)                                                          \
+		{                                                                                          \
+			if (!arrow_row_is_valid(filter, row))                                                  \
+			{                                                                                      \
+				r[row] = 0;                                                                        \
+				continue;                                                                          \
+			}                                                                                      \
+			const CTYPE x = a[row * stride1];                                                      \
+			const CTYPE y = b[row * stride2];                                                      \
+			r[row] = EXPR;                                                                         \
+		}                                                                                          \
+	}
+
+#define UNARY_FUNCTION(NAME, CTYPE, RTYPE, EXPR)                                                   \
+	static void NAME(const void *restrict arg1,                                                    \
+					 int stride1,                                                                  \
+					 const void *restrict arg2,                                                    \
+					 int stride2,                                                                  \
+					 const uint64 *restrict filter,                                                \
+					 int n,                                                                        \
+					 void *restrict result)                                                        \
+	{                                                                                              \
+		const CTYPE *restrict a = arg1;                                                            \
+		RTYPE *restrict r = result;                                                                \
+		for (int row = 0; row < n; row++)                                                          \
+		{                                                                                          \
+			if (!arrow_row_is_valid(filter, row))                                                  \
+			{                                                                                      \
+				r[row] = 0;                                                                        \
+				continue;                                                                          \
+			}                                                                                      \
+			const CTYPE x = a[row * stride1];                                                      \
+			r[row] = EXPR;                                                                         \
+		}                                                                                          \
+	}
+
+BINARY_FUNCTION(vector_float8pl, float8, float8, float8_pl(x, y))
+BINARY_FUNCTION(vector_float8mi, float8, float8, float8_mi(x, y))
+BINARY_FUNCTION(vector_float8mul, float8, float8, float8_mul(x, y))
+BINARY_FUNCTION(vector_float8div, float8, float8, float8_div(x, y))
+UNARY_FUNCTION(vector_float8um, float8, float8, -x)
+UNARY_FUNCTION(vector_float8abs, float8, float8, fabs(x))
+
+BINARY_FUNCTION(vector_float4pl, float4, float4, float4_pl(x, y))
+BINARY_FUNCTION(vector_float4mi, float4, float4, float4_mi(x, y))
+BINARY_FUNCTION(vector_float4mul, float4, float4, float4_mul(x, y))
+BINARY_FUNCTION(vector_float4div, float4, float4, float4_div(x, y))
+UNARY_FUNCTION(vector_float4um, float4, float4, -x)
+UNARY_FUNCTION(vector_float4abs, float4, float4, fabsf(x))
+
+BINARY_FUNCTION(vector_int4pl, int32, int32, vector_int4_pl(x, y))
+BINARY_FUNCTION(vector_int4mi, int32, int32, vector_int4_mi(x, y))
+BINARY_FUNCTION(vector_int4mul, int32, int32, vector_int4_mul(x, y))
+UNARY_FUNCTION(vector_int4um, int32, int32, vector_int4_um(x))
+UNARY_FUNCTION(vector_int4abs, int32, int32, vector_int4_abs(x))
+
+BINARY_FUNCTION(vector_int8pl, int64, int64, vector_int8_pl(x, y))
+BINARY_FUNCTION(vector_int8mi, int64, int64, vector_int8_mi(x, y))
+BINARY_FUNCTION(vector_int8mul, int64, int64, vector_int8_mul(x, y))
+UNARY_FUNCTION(vector_int8um, int64, int64, vector_int8_um(x))
+UNARY_FUNCTION(vector_int8abs, int64, int64, vector_int8_abs(x))
+
+UNARY_FUNCTION(vector_i4tod, int32, float8, (float8) x)
+UNARY_FUNCTION(vector_i8tod, int64, float8, (float8) x)
+UNARY_FUNCTION(vector_ftod, float4, float8, (float8) x)
+UNARY_FUNCTION(vector_i4tof, int32, float4, (float4) x)
+UNARY_FUNCTION(vector_int48, int32, int64, (int64) x)
+
+#undef BINARY_FUNCTION
+#undef UNARY_FUNCTION
+
+/*
+ * The time_bucket() implementations use the kernel of the scalar functions,
+ * ts_time_bucket_fixed(), for timestamps, and follow TIME_BUCKET in
+ * src/time_bucket.c for integers, for the variants without the origin and
+ * offset arguments. The division doesn't vectorize, but the loops are kept
+ * free of the other branches except the error checks.
+ */
+#define INTEGER_TIME_BUCKET(NAME, CTYPE, MIN)                                                      \
+	static inline CTYPE NAME(CTYPE period, CTYPE timestamp)                                         \
+	{                                                                                              \
+		CTYPE result = (timestamp / period) * period;                                              \
+		if (timestamp < 0 && timestamp % period)                                                   \
+		{                                                                                          \
+			if (unlikely(result < (MIN) + period))                                                 \
+				time_bucket_out_of_range();                                                        \
+			result -= period;                                                                      \
+		}                                                                                          \
+		return result;                                                                             \
+	}
+
+INTEGER_TIME_BUCKET(vector_time_bucket_int4, int32, PG_INT32_MIN)
+INTEGER_TIME_BUCKET(vector_time_bucket_int8, int64, PG_INT64_MIN)
+
+#undef INTEGER_TIME_BUCKET
+
+#define TIME_BUCKET_FUNCTION(NAME, CTYPE, EXPR)                                                    \
+	static void NAME(const void *restrict arg,                                                     \
+					 int stride,                                                                   \
+					 int64 period,                                                                 \
+					 int64 shift,                                                                  \
+					 const uint64 *restrict filter,                                                \
+					 int n,                                                                        \
+					 void *restrict result)                                                        \
+	{                                                                                              \
+		const CTYPE *restrict a = arg;                                                             \
+		CTYPE *restrict r = result;                                                                \
+		for (int row = 0; row < n; row++)                                                          \
+		{                                                                                          \
+			if (!arrow_row_is_valid(filter, row))                                                  \
+			{                                                                                      \
+				r[row] = 0;                                                                        \
+				continue;                                                                          \
+			}                                                                                      \
+			const CTYPE x = a[row * stride];                                                       \
+			r[row] = EXPR;                                                                         \
+		}                                                                                          \
+	}
+
+TIME_BUCKET_FUNCTION(vector_time_bucket_timestamp_function, int64,
+					 ts_time_bucket_fixed(period, shift, x))
+TIME_BUCKET_FUNCTION(vector_time_bucket_int4_function, int32,
+					 vector_time_bucket_int4((int32) period, x))
+TIME_BUCKET_FUNCTION(vector_time_bucket_int8_function, int64, vector_time_bucket_int8(period, x))
+
+#undef TIME_BUCKET_FUNCTION
+
+static const VectorExprFunctionInfo vector_expr_functions[] = {
+	{ F_FLOAT8PL, 2, FLOAT8OID, FLOAT8OID, vector_float8pl },
+	{ F_FLOAT8MI, 2, FLOAT8OID, FLOAT8OID, vector_float8mi },
+	{ F_FLOAT8MUL, 2, FLOAT8OID, FLOAT8OID, vector_float8mul },
+	{ F_FLOAT8DIV, 2, FLOAT8OID, FLOAT8OID, vector_float8div },
+	{ F_FLOAT8UM, 1, FLOAT8OID, FLOAT8OID, vector_float8um },
+	{ F_FLOAT8ABS, 1, FLOAT8OID, FLOAT8OID, vector_float8abs },
+	{ F_ABS_FLOAT8, 1, FLOAT8OID, FLOAT8OID, vector_float8abs },
+
+	{ F_FLOAT4PL, 2, FLOAT4OID, FLOAT4OID, vector_float4pl },
+	{ F_FLOAT4MI, 2, FLOAT4OID, FLOAT4OID, vector_float4mi },
+	{ F_FLOAT4MUL, 2, FLOAT4OID, FLOAT4OID, vector_float4mul },
+	{ F_FLOAT4DIV, 2, FLOAT4OID, FLOAT4OID, vector_float4div },
+	{ F_FLOAT4UM, 1, FLOAT4OID, FLOAT4OID, vector_float4um },
+	{ F_FLOAT4ABS, 1, FLOAT4OID, FLOAT4OID, vector_float4abs },
+	{ F_ABS_FLOAT4, 1, FLOAT4OID, FLOAT4OID, vector_float4abs },
+
+	{ F_INT4PL, 2, INT4OID, INT4OID, vector_int4pl },
+	{ F_INT4MI, 2, INT4OID, INT4OID, vector_int4mi },
+	{ F_INT4MUL, 2, INT4OID, INT4OID, vector_int4mul },
+	{ F_INT4UM, 1, INT4OID, INT4OID, vector_int4um },
+	{ F_INT4ABS, 1, INT4OID, INT4OID, vector_int4abs },
+	{ F_ABS_INT4, 1, INT4OID, INT4OID, vector_int4abs },
+
+	{ F_INT8PL, 2, INT8OID, INT8OID, vector_int8pl },
+	{ F_INT8MI, 2, INT8OID, INT8OID, vector_int8mi },
+	{ F_INT8MUL, 2, INT8OID, INT8OID, vector_int8mul },
+	{ F_INT8UM, 1, INT8OID, INT8OID, vector_int8um },
+	{ F_INT8ABS, 1, INT8OID, INT8OID, vector_int8abs },
+	{ F_ABS_INT8, 1, INT8OID, INT8OID, vector_int8abs },
+
+	{ F_FLOAT8_INT4, 1, INT4OID, FLOAT8OID, vector_i4tod },
+	{ F_FLOAT8_INT8, 1, INT8OID, FLOAT8OID, vector_i8tod },
+	{ F_FLOAT8_FLOAT4, 1, FLOAT4OID, FLOAT8OID, vector_ftod },
+	{ F_FLOAT4_INT4, 1, INT4OID, FLOAT4OID, vector_i4tof },
+	{ F_INT8_INT4, 1, INT4OID, INT8OID, vector_int48 },
+};
+
+static const VectorExprFunctionInfo *
+get_vector_expr_function(Oid funcid)
+{
+	for (size_t i = 0; i < lengthof(vector_expr_functions); i++)
+	{
+		if (vector_expr_functions[i].funcid == funcid)
+			return &vector_expr_functions[i];
+	}
+	return NULL;
+}
+
+static int
+vector_expr_type_bytes(Oid typid)
+{
+	switch (typid)
+	{
+		case INT4OID:
+		case FLOAT4OID:
+			return 4;
+		case INT8OID:
+		case FLOAT8OID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return 8;
+		default:
+			elog(ERROR, "unexpected type %s in vectorized expression", format_type_be(typid));
+			pg_unreachable();
+	}
+}
+
+static uint64
+vector_expr_datum_to_storage(Oid typid, Datum datum)
+{
+	uint64 storage = 0;
+
+#define FOR_TYPE(PGTYPE, CTYPE, FROMDATUM)                                                         \
+	case PGTYPE:                                                                                   \
+	{                                                                                              \
+		const CTYPE value = FROMDATUM(datum);                                                      \
+		memcpy(&storage, &value, sizeof(CTYPE));                                                   \
+		break;                                                                                     \
+	}
+
+	switch (typid)
+	{
+		FOR_TYPE(INT4OID, int32, DatumGetInt32)
+		FOR_TYPE(INT8OID, int64, DatumGetInt64)
+		FOR_TYPE(FLOAT4OID, float4, DatumGetFloat4)
+		FOR_TYPE(FLOAT8OID, float8, DatumGetFloat8)
+		FOR_TYPE(TIMESTAMPOID, Timestamp, DatumGetTimestamp)
+		FOR_TYPE(TIMESTAMPTZOID, TimestampTz, DatumGetTimestampTz)
+		default:
+			elog(ERROR, "unexpected type %s in vectorized expression", format_type_be(typid));
+			pg_unreachable();
+	}
+#undef FOR_TYPE
+
+	return storage;
+}
+
+static Datum
+vector_expr_storage_to_datum(Oid typid, const uint64 *storage)
+{
+	switch (typid)
+	{
+		case INT4OID:
+			return Int32GetDatum(*(const int32 *) storage);
+		case INT8OID:
+			return Int64GetDatum(*(const int64 *) storage);
+		case FLOAT4OID:
+			return Float4GetDatum(*(const float4 *) storage);
+		case FLOAT8OID:
+			return Float8GetDatum(*(const float8 *) storage);
+		case TIMESTAMPOID:
+			return TimestampGetDatum(*(const Timestamp *) storage);
+		case TIMESTAMPTZOID:
+			return TimestampTzGetDatum(*(const TimestampTz *) storage);
+		default:
+			elog(ERROR, "unexpected type %s in vectorized expression", format_type_be(typid));
+			pg_unreachable();
+	}
+}
+
+/*
+ * Check for the timezone argument of time_bucket(width, ts, timezone, origin,
+ * offset). The timezone must be a constant, and the origin and offset must be
+ * NULL, which are their defaults.
+ */
+static bool
+get_time_bucket_timezone(List *args, Oid time_type, const text **timezone)
+{
+	*timezone = NULL;
+
+	if (list_length(args) == 2)
+		return true;
+
+	if (time_type != TIMESTAMPTZOID || list_length(args) > 5)
+		return false;
+
+	Node *tz = lthird(args);
+	if (!IsA(tz, Const) || castNode(Const, tz)->constisnull ||
+		castNode(Const, tz)->consttype != TEXTOID)
+	{
+		return false;
+	}
+
+	for (int i = 3; i < list_length(args); i++)
+	{
+		Node *arg = list_nth(args, i);
+		if (!IsA(arg, Const) || !castNode(Const, arg)->constisnull)
+			return false;
+	}
+
+	*timezone = DatumGetTextPP(castNode(Const, tz)->constvalue);
+	return true;
+}
+
+/*
+ * Check whether this is time_bucket() with a constant fixed-width bucket and
+ * no origin or offset, and get the parameters of the bucketing. The timezone
+ * is a constant or NULL if there is none.
+ */
+static bool
+get_time_bucket_params(Oid funcid, Oid rettype, List *args, VectorTimeBucketFunction *function,
+					   int64 *period, int64 *shift, const text **timezone)
+{
+	FuncInfo *finfo = ts_func_cache_get(funcid);
+	if (finfo == NULL || finfo->origin != ORIGIN_TIMESCALE ||
+		strcmp(finfo->funcname, "time_bucket") != 0 || list_length(args) < 2)
+	{
+		return false;
+	}
+
+	Node *width = linitial(args);
+	const Oid time_type = exprType(lsecond(args));
+	if (!IsA(width, Const) || castNode(Const, width)->constisnull || rettype != time_type ||
+		!get_time_bucket_timezone(args, time_type, timezone))
+	{
+		return false;
+	}
+
+	const Datum width_datum = castNode(Const, width)->constvalue;
+	switch (time_type)
+	{
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		{
+			const Interval *interval = DatumGetIntervalP(width_datum);
+			int64 day_usecs;
+			if (interval->month != 0 ||
+				pg_mul_s64_overflow(interval->day, USECS_PER_DAY, &day_usecs) ||
+				pg_add_s64_overflow(interval->time, day_usecs, period))
+			{
+				return false;
+			}
+
+			/* The default origin is Monday 2000-01-03. */
+			*function = vector_time_bucket_timestamp_function;
+			*shift = *period > 0 ? (2 * USECS_PER_DAY) % *period : 0;
+			break;
+		}
+		case INT4OID:
+			*function = vector_time_bucket_int4_function;
+			*period = DatumGetInt32(width_datum);
+			*shift = 0;
+			break;
+		case INT8OID:
+			*function = vector_time_bucket_int8_function;
+			*period = DatumGetInt64(width_datum);
+			*shift = 0;
+			break;
+		default:
+			return false;
+	}
+
+	/*
+	 * A nonpositive period is an error that is left for the usual evaluation
+	 * to report.
+	 */
+	return *period > 0;
+}
+
+/*
+ * Check whether the function with the given arguments has a vectorized
+ * implementation. The arguments are checked only for their types, the caller
+ * has to check them recursively.
+ */
+bool
+vector_expr_function_is_supported(Oid funcid, Oid rettype, List *args)
+{
+	VectorTimeBucketFunction bucket_function;
+	int64 period;
+	int64 shift;
+	const text *timezone;
+	if (get_time_bucket_params(funcid, rettype, args, &bucket_function, &period, &shift, &timezone))
+		return true;
+
+	const VectorExprFunctionInfo *info = get_vector_expr_function(funcid);
+	if (info == NULL || info->rettype != rettype || list_length(args) != info->nargs)
+		return false;
+
+	ListCell *lc;
+	foreach (lc, args)
+	{
+		if (exprType(lfirst(lc)) != info->argtype)
+			return false;
+	}
+
+	return true;
+}
+
+VectorExpr *
+vector_expr_create(Expr *expr,
+				   int (*get_input_offset)(const CustomScanState *state, const Var *var),
+				   const CustomScanState *state)
+{
+	VectorExpr *vexpr = palloc0(sizeof(VectorExpr));
+	vexpr->typid = exprType((Node *) expr);
+
+	switch (nodeTag(expr))
+	{
+		case T_Var:
+			vexpr->type = VET_Column;
+			vexpr->input_offset = get_input_offset(state, castNode(Var, expr));
+			break;
+		case T_Const:
+		{
+			Const *c = castNode(Const, expr);
+			vexpr->type = VET_Const;
+			vexpr->const_isnull = c->constisnull;
+			if (!c->constisnull)
+				vexpr->const_storage = vector_expr_datum_to_storage(c->consttype, c->constvalue);
+			break;
+		}
+		case T_OpExpr:
+		case T_FuncExpr:
+		{
+			Oid funcid;
+			List *args;
+			if (IsA(expr, OpExpr))
+			{
+				OpExpr *opexpr = castNode(OpExpr, expr);
+				funcid = OidIsValid(opexpr->opfuncid) ? opexpr->opfuncid : get_opcode(opexpr->opno);
+				args = opexpr->args;
+			}
+			else
+			{
+				FuncExpr *funcexpr = castNode(FuncExpr, expr);
+				funcid = funcexpr->funcid;
+				args = funcexpr->args;
+			}
+
+			const text *timezone;
+			if (get_time_bucket_params(funcid,
+									   vexpr->typid,
+									   args,
+									   &vexpr->bucket_function,
+									   &vexpr->bucket_period,
+									   &vexpr->bucket_shift,
+									   &timezone))
+			{
+				/* The bucket width is a constant that we have already read. */
+				vexpr->type = VET_TimeBucket;
+				vexpr->args[0] = vector_expr_create(lsecond(args), get_input_offset, state);
+				if (timezone != NULL)
+					vexpr->bucket_timezone =
+						ts_timezone_offset_cache_create(timezone, CurrentMemoryContext);
+				break;
+			}
+
+			vexpr->type = VET_Function;
+			vexpr->function = get_vector_expr_function(funcid);
+			Ensure(vexpr->function != NULL, "function %u is not vectorized", funcid);
+			Ensure(list_length(args) == vexpr->function->nargs,
+				   "wrong number of arguments for vectorized function %u",
+				   funcid);
+
+			for (int i = 0; i < list_length(args); i++)
+			{
+				vexpr->args[i] = vector_expr_create(list_nth(args, i), get_input_offset, state);
+			}
+			break;
+		}
+		default:
+			elog(ERROR, "unexpected node %d in vectorized expression", nodeTag(expr));
+			pg_unreachable();
+	}
+
+	return vexpr;
+}
+
+static void vector_expr_evaluate(VectorExpr *vexpr, TupleTableSlot *vector_slot,
+								 const uint64 *filter, uint16 num_rows, VectorExprValue *result);
+
+static void
+vector_expr_time_bucket(const VectorExpr *vexpr, const void *arg, int stride, const uint64 *filter,
+						int n, void *result)
+{
+	if (vexpr->bucket_timezone != NULL)
+	{
+		ts_timestamptz_timezone_bucket_vector(vexpr->bucket_timezone,
+											  vexpr->bucket_period,
+											  vexpr->bucket_shift,
+											  arg,
+											  stride,
+											  filter,
+											  n,
+											  result);
+		return;
+	}
+
+	vexpr->bucket_function(arg,
+						   stride,
+						   vexpr->bucket_period,
+						   vexpr->bucket_shift,
+						   filter,
+						   n,
+						   result);
+}
+
+static void
+vector_expr_evaluate_time_bucket(VectorExpr *vexpr, TupleTableSlot *vector_slot,
+								 const uint64 *filter, uint16 num_rows, VectorExprValue *result)
+{
+	VectorExprValue arg;
+	vector_expr_evaluate(vexpr->args[0], vector_slot, filter, num_rows, &arg);
+
+	if (arg.is_scalar)
+	{
+		/* Same as for the other functions, see vector_expr_evaluate(). */
+		result->is_scalar = true;
+		result->scalar_isnull = arg.scalar_isnull || arrow_num_valid(filter, num_rows) == 0;
+		if (!result->scalar_isnull)
+		{
+			vector_expr_time_bucket(vexpr,
+									&arg.scalar_storage,
+									0,
+									NULL,
+									1,
+									&result->scalar_storage);
+		}
+		return;
+	}
+
+	const size_t num_words = (num_rows + 63) / 64;
+	const uint64 *combined_filter = arrow_combine_validity(num_words,
+														   palloc(sizeof(uint64) * num_words),
+														   filter,
+														   arg.validity,
+														   NULL);
+
+	/* The value buffer has 64-byte padding as required by Arrow. */
+	void *values = palloc(TYPEALIGN(64, vector_expr_type_bytes(vexpr->typid) * num_rows) + 64);
+
+	vector_expr_time_bucket(vexpr, arg.values, 1, combined_filter, num_rows, values);
+
+	result->validity = arg.validity;
+	result->values = values;
+}
+
+static void
+vector_expr_evaluate(VectorExpr *vexpr, TupleTableSlot *vector_slot, const uint64 *filter,
+					 uint16 num_rows, VectorExprValue *result)
+{
+	*result = (VectorExprValue){ 0 };
+
+	switch (vexpr->type)
+	{
+		case VET_Const:
+			result->is_scalar = true;
+			result->scalar_isnull = vexpr->const_isnull;
+			result->scalar_storage = vexpr->const_storage;
+			return;
+		case VET_Column:
+		{
+			const CompressedColumnValues *values =
+				vector_slot_get_compressed_column_values(vector_slot,
+														 AttrOffsetGetAttrNumber(
+															 vexpr->input_offset));
+			Assert(values->decompression_type != DT_Invalid);
+			Assert(values->decompression_type != DT_Iterator);
+
+			if (values->arrow == NULL)
+			{
+				Assert(values->decompression_type == DT_Scalar);
+				result->is_scalar = true;
+				result->scalar_isnull = *values->output_isnull;
+				if (!result->scalar_isnull)
+					result->scalar_storage =
+						vector_expr_datum_to_storage(vexpr->typid, *values->output_value);
+				return;
+			}
+
+			Assert(values->arrow->length == num_rows);
+			result->validity = values->arrow->buffers[0];
+			result->values = values->arrow->buffers[1];
+			return;
+		}
+		case VET_TimeBucket:
+			vector_expr_evaluate_time_bucket(vexpr, vector_slot, filter, num_rows, result);
+			return;
+		case VET_Function:
+			break;
+	}
+
+	const VectorExprFunctionInfo *function = vexpr->function;
+	VectorExprValue args[2] = { { 0 } };
+	bool all_scalar = true;
+	for (int i = 0; i < function->nargs; i++)
+	{
+		vector_expr_evaluate(vexpr->args[i], vector_slot, filter, num_rows, &args[i]);
+
+		/* All the supported functions are strict. */
+		if (args[i].is_scalar && args[i].scalar_isnull)
+		{
+			result->is_scalar = true;
+			result->scalar_isnull = true;
+			return;
+		}
+
+		all_scalar &= args[i].is_scalar;
+	}
+
+	if (function->nargs == 1)
+		args[1] = args[0];
+
+	if (all_scalar)
+	{
+		/*
+		 * Don't compute the scalar if no rows pass the filter, because it might
+		 * throw an error that the usual evaluation wouldn't.
+		 */
+		result->is_scalar = true;
+		result->scalar_isnull = arrow_num_valid(filter, num_rows) == 0;
+		if (!result->scalar_isnull)
+		{
+			function->function(&args[0].scalar_storage,
+							   0,
+							   &args[1].scalar_storage,
+							   0,
+							   NULL,
+							   1,
+							   &result->scalar_storage);
+		}
+		return;
+	}
+
+	/*
+	 * The result is valid where all the vector arguments are valid, and
+	 * computed only for the rows that also pass the filter.
+	 */
+	const size_t num_words = (num_rows + 63) / 64;
+	const uint64 *validity =
+		arrow_combine_validity(num_words,
+							   palloc(sizeof(uint64) * num_words),
+							   args[0].is_scalar ? NULL : args[0].validity,
+							   args[1].is_scalar ? NULL : args[1].validity,
+							   NULL);
+	const uint64 *combined_filter = arrow_combine_validity(num_words,
+														   palloc(sizeof(uint64) * num_words),
+														   filter,
+														   validity,
+														   NULL);
+
+	/* The value buffer has 64-byte padding as required by Arrow. */
+	void *values =
+		palloc(TYPEALIGN(64, vector_expr_type_bytes(function->rettype) * num_rows) + 64);
+
+	function->function(args[0].is_scalar ? (const void *) &args[0].scalar_storage :
+										   args[0].values,
+					   args[0].is_scalar ? 0 : 1,
+					   args[1].is_scalar ? (const void *) &args[1].scalar_storage :
+										   args[1].values,
+					   args[1].is_scalar ? 0 : 1,
+					   combined_filter,
+					   num_rows,
+					   values);
+
+	result->validity = validity;
+	result->values = values;
+}
+
+/*
+ * Compute the expression for the current batch. The rows that don't pass the
+ * filter are not computed and their values are undefined.
+ */
+void
+vector_expr_compute(VectorExpr *vexpr, TupleTableSlot *vector_slot, const uint64 *filter,
+					uint16 num_rows, CompressedColumnValues *result)
+{
+	VectorExprValue value;
+	vector_expr_evaluate(vexpr, vector_slot, filter, num_rows, &value);
+
+	*result = (CompressedColumnValues){ 0 };
+
+	if (value.is_scalar)
+	{
+		vexpr->result_isnull = value.scalar_isnull;
+		vexpr->result_datum =
+			value.scalar_isnull ? (Datum) 0 :
+								  vector_expr_storage_to_datum(vexpr->typid, &value.scalar_storage);
+		result->decompression_type = DT_Scalar;
+		result->output_value = &vexpr->result_datum;
+		result->output_isnull = &vexpr->result_isnull;
+		return;
+	}
+
+	ArrowArray *arrow = palloc0(sizeof(ArrowArray) + sizeof(void *) * 2);
+	arrow->length = num_rows;
+	arrow->null_count = num_rows - arrow_num_valid(value.validity, num_rows);
+	arrow->n_buffers = 2;
+	arrow->buffers = (const void **) &arrow[1];
+	arrow->buffers[0] = value.validity;
+	arrow->buffers[1] = value.values;
+
+	result->decompression_type = vector_expr_type_bytes(vexpr->typid);
+	result->arrow = arrow;
+	result->buffers[0] = value.validity;
+	result->buffers[1] = value.values;
+}
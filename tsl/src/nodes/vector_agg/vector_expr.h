@@ -0,0 +1,32 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+#pragma once
+
+#include <postgres.h>
+#include <executor/tuptable.h>
+#include <nodes/execnodes.h>
+#include <nodes/primnodes.h>
+
+#include "nodes/decompress_chunk/compressed_batch.h"
+
+/*
+ * Vectorized evaluation of simple arithmetic expressions over the columns of
+ * a compressed batch, like "value * 1.8 + 32", "abs(x)" or
+ * "time_bucket('5 min', time)". It is used for the arguments of the vectorized
+ * aggregate functions and for the computed grouping keys.
+ */
+typedef struct VectorExpr VectorExpr;
+
+extern bool vector_expr_function_is_supported(Oid funcid, Oid rettype, List *args);
+
+extern VectorExpr *vector_expr_create(Expr *expr,
+									  int (*get_input_offset)(const CustomScanState *state,
+															  const Var *var),
+									  const CustomScanState *state);
+
+extern void vector_expr_compute(VectorExpr *vexpr, TupleTableSlot *vector_slot,
+								const uint64 *filter, uint16 num_rows,
+								CompressedColumnValues *result);
@@ -24,10 +24,13 @@
 #include "nodes/decompress_chunk/decompress_chunk.h"
 #include "nodes/frozen_chunk_dml/frozen_chunk_dml.h"
 #include "nodes/gapfill/gapfill.h"
+#include "nodes/partial_agg_cache/partial_agg_cache.h"
+#include "nodes/runtime_filter/runtime_filter.h"
 #include "nodes/skip_scan/skip_scan.h"
 #include "nodes/vector_agg/plan.h"
 #include "planner.h"
 #include "planner/partialize.h"
+#include "planner/planner_stats.h"
 
 #include <math.h>
 
@@ -83,7 +86,11 @@ tsl_create_upper_paths_hook(PlannerInfo *root, UpperRelationKind stage, RelOptIn
 				!IS_DUMMY_REL(input_rel) && output_rel != NULL &&
 				involves_hypertable(root, input_rel))
 			{
+				instr_time start;
+
+				ts_planner_stats_begin(&start);
 				tsl_pushdown_partial_agg(root, ht, input_rel, output_rel, extra);
+				ts_planner_stats_end(TS_PLANNER_STAGE_PARTIAL_AGG, &start);
 			}
 
 			if (root->numOrderedAggs && !IS_DUMMY_REL(input_rel) && output_rel != NULL)
@@ -214,6 +221,13 @@ tsl_preprocess_query(Query *parse, int *cursor_opts)
 {
 	Assert(parse != NULL);
 
+	/* Answer aggregate queries on hypertables from continuous aggregates. This
+	 * comes first since the rewritten query contains the watermark. */
+	if (ts_guc_enable_cagg_query_rewrite)
+	{
+		cagg_query_rewrite(parse);
+	}
+
 	/* Check if constification of watermark values is enabled */
 	if (ts_guc_enable_cagg_watermark_constify)
 	{
@@ -235,6 +249,11 @@ tsl_preprocess_query(Query *parse, int *cursor_opts)
 void
 tsl_postprocess_plan(PlannedStmt *stmt)
 {
+	if (ts_guc_enable_runtime_join_filters)
+	{
+		stmt->planTree = try_insert_runtime_filters(stmt, stmt->planTree);
+	}
+
 	if (ts_guc_enable_vectorized_aggregation)
 	{
 		stmt->planTree = try_insert_vector_agg_node(stmt->planTree, stmt->rtable);
@@ -257,4 +276,13 @@ tsl_postprocess_plan(PlannedStmt *stmt)
 		}
 	}
 #endif
+
+	/*
+	 * The cache nodes hide the aggregation nodes from the check above, so they
+	 * are inserted last.
+	 */
+	if (ts_guc_partial_agg_cache_size > 0)
+	{
+		stmt->planTree = try_insert_partial_agg_cache(stmt, stmt->planTree);
+	}
 }
@@ -16,31 +16,42 @@
 #include <postgres.h>
 #include "utils.h"
 #include <access/amapi.h>
+#include <access/genam.h>
+#include <access/heapam.h>
 #include <access/multixact.h>
 #include <access/relscan.h>
 #include <access/rewriteheap.h>
+#include <access/tableam.h>
 #include <access/transam.h>
+#include <access/visibilitymap.h>
 #include <access/xact.h>
 #include <access/xlog.h>
+#include <access/xloginsert.h>
 #include <catalog/catalog.h>
 #include <catalog/dependency.h>
 #include <catalog/heap.h>
 #include <catalog/index.h>
+#include <catalog/indexing.h>
 #include <catalog/namespace.h>
 #include <catalog/objectaccess.h>
 #include <catalog/pg_am.h>
 #include <catalog/pg_authid.h>
 #include <catalog/pg_tablespace_d.h>
+#include <catalog/storage.h>
+#include <catalog/storage_xlog.h>
 #include <catalog/toasting.h>
 #include <commands/cluster.h>
 #include <commands/tablecmds.h>
 #include <commands/tablespace.h>
 #include <commands/vacuum.h>
+#include <executor/executor.h>
 #include <executor/spi.h>
 #include <miscadmin.h>
 #include <nodes/pg_list.h>
 #include <optimizer/planner.h>
 #include <storage/bufmgr.h>
+#include <storage/bufpage.h>
+#include <storage/latch.h>
 #include <storage/lmgr.h>
 #include <storage/predicate.h>
 #include <storage/smgr.h>
@@ -49,14 +60,18 @@
 #include <utils/builtins.h>
 #include <utils/fmgroids.h>
 #include <utils/guc.h>
+#include <utils/hsearch.h>
 #include <utils/inval.h>
 #include <utils/lsyscache.h>
 #include <utils/memutils.h>
 #include <utils/pg_rusage.h>
+#include <utils/relcache.h>
 #include <utils/relmapper.h>
 #include <utils/snapmgr.h>
 #include <utils/syscache.h>
+#include <utils/timestamp.h>
 #include <utils/tuplesort.h>
+#include <utils/wait_event.h>
 
 #include "compat/compat.h"
 #include <access/toast_internals.h>
@@ -65,20 +80,88 @@
 #include "chunk.h"
 #include "chunk_index.h"
 #include "debug_assert.h"
+#include "debug_point.h"
+#include "guc.h"
 #include "hypertable_cache.h"
 #include "indexing.h"
 #include "reorder.h"
 
 static void reorder_rel(Oid tableOid, Oid indexOid, bool verbose, Oid wait_id,
-						Oid destination_tablespace, Oid index_tablespace);
+						Oid destination_tablespace, Oid index_tablespace, bool concurrent);
 
 #define REORDER_ACCESS_EXCLUSIVE_DEADLOCK_TIMEOUT "101000"
 
+/*
+ * A concurrent reorder applies the changes made during the copy in rounds
+ * until a round applies at most this many changes, or for at most this many
+ * rounds, before it blocks the writes to apply the remaining changes.
+ */
+#define REORDER_CONCURRENT_MAX_LOCKED_CHANGES 1000
+#define REORDER_CONCURRENT_MAX_ROUNDS 4
+
 static void rebuild_relation(Relation OldHeap, Oid indexOid, bool verbose, Oid wait_id,
-							 Oid destination_tablespace, Oid index_tablespace);
+							 Oid destination_tablespace, Oid index_tablespace, bool concurrent);
 static void copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 						   bool *pSwapToastByContent, TransactionId *pFreezeXid,
 						   MultiXactId *pCutoffMulti);
+static void get_copy_cutoffs(Relation OldHeap, TransactionId *pFreezeXid,
+							 MultiXactId *pCutoffMulti, TransactionId *pOldestXmin);
+static void update_new_heap_stats(Oid OIDNewHeap, BlockNumber num_pages, double num_tuples);
+
+/*
+ * Throttle the I/O of a copy to a budget of bytes per second, similar to the
+ * cost-based vacuum delay.
+ */
+typedef struct IoThrottle
+{
+	int rate_limit_kb;
+	TimestampTz start;
+	uint64 bytes;
+} IoThrottle;
+
+static void io_throttle_init(IoThrottle *throttle, int rate_limit_kb);
+static void io_throttle(IoThrottle *throttle, Size nbytes);
+static void move_relation_storage(Oid relid, Oid tablespace, IoThrottle *throttle);
+
+/* The TID of a tuple in the old heap and the TID of its copy in the new heap */
+typedef struct TidMapEntry
+{
+	ItemPointerData old_tid; /* Hash key */
+	ItemPointerData new_tid;
+} TidMapEntry;
+
+/*
+ * State of a concurrent reorder, see copy_heap_data_concurrently().
+ */
+typedef struct ConcurrentCopyState
+{
+	Relation OldHeap;
+	Relation NewHeap;
+	int elevel;
+	/* The changes made after this snapshot are not applied to the new heap yet */
+	Snapshot snapshot;
+	/* The tuples of the initial copy, sorted by the old TID */
+	TidMapEntry *copied;
+	uint64 ncopied;
+	uint64 maxcopied;
+	/* The tuples copied when applying the changes, by the old TID */
+	HTAB *applied;
+	BulkInsertState bistate;
+	/* Set up to maintain the indexes of the new heap, once it has indexes */
+	ResultRelInfo *indexstate;
+	EState *estate;
+	TupleTableSlot *slot;
+	double num_tuples;
+	IoThrottle throttle;
+} ConcurrentCopyState;
+
+static ConcurrentCopyState *copy_heap_data_concurrently(Oid OIDNewHeap, Oid OIDOldHeap,
+														Oid OIDOldIndex, bool verbose,
+														int io_rate_limit_kb);
+static uint64 apply_concurrent_changes(ConcurrentCopyState *state);
+static void concurrent_copy_open_indexes(ConcurrentCopyState *state);
+static void end_concurrent_copy(ConcurrentCopyState *state, TransactionId *pFreezeXid,
+								MultiXactId *pCutoffMulti);
 
 static void finish_heap_swaps(Oid OIDOldHeap, Oid OIDNewHeap, List *old_index_oids,
 							  List *new_index_oids, bool swap_toast_by_content, bool is_internal,
@@ -110,6 +193,62 @@ tsl_reorder_chunk(PG_FUNCTION_ARGS)
 	PG_RETURN_VOID();
 }
 
+/*
+ * Move a compressed chunk and its compressed chunk to the tablespaces with
+ * the I/O throttled. The relation files are copied block by block, the same
+ * as ALTER TABLE SET TABLESPACE does, since the compressed data needs no
+ * reorder.
+ */
+static void
+move_compressed_chunk_throttled(Oid chunk_relid, Oid compressed_chunk_relid, Oid tablespace,
+								Oid index_tablespace)
+{
+	Oid relids[] = { chunk_relid, compressed_chunk_relid };
+	IoThrottle throttle;
+
+	/* The checks of ALTER TABLE SET TABLESPACE */
+	for (int i = 0; i < lengthof(relids); i++)
+	{
+		if (!object_ownercheck(RelationRelationId, relids[i], GetUserId()))
+			aclcheck_error(ACLCHECK_NOT_OWNER, OBJECT_TABLE, get_rel_name(relids[i]));
+	}
+
+	if (tablespace != MyDatabaseTableSpace)
+	{
+		AclResult aclresult =
+			object_aclcheck(TableSpaceRelationId, tablespace, GetUserId(), ACL_CREATE);
+
+		if (aclresult != ACLCHECK_OK)
+			aclcheck_error(aclresult, OBJECT_TABLESPACE, get_tablespace_name(tablespace));
+	}
+
+	if (index_tablespace != MyDatabaseTableSpace)
+	{
+		AclResult aclresult =
+			object_aclcheck(TableSpaceRelationId, index_tablespace, GetUserId(), ACL_CREATE);
+
+		if (aclresult != ACLCHECK_OK)
+			aclcheck_error(aclresult, OBJECT_TABLESPACE, get_tablespace_name(index_tablespace));
+	}
+
+	io_throttle_init(&throttle, ts_guc_move_chunk_io_rate_limit);
+
+	for (int i = 0; i < lengthof(relids); i++)
+	{
+		Relation rel = table_open(relids[i], AccessExclusiveLock);
+		List *indexlist = RelationGetIndexList(rel);
+		ListCell *lc;
+
+		CheckTableNotInUse(rel, "ALTER TABLE");
+		table_close(rel, NoLock);
+
+		move_relation_storage(relids[i], tablespace, &throttle);
+
+		foreach (lc, indexlist)
+			move_relation_storage(lfirst_oid(lc), index_tablespace, &throttle);
+	}
+}
+
 Datum
 tsl_move_chunk(PG_FUNCTION_ARGS)
 {
@@ -182,14 +321,25 @@ tsl_move_chunk(PG_FUNCTION_ARGS)
 					 errmsg("ignoring index parameter"),
 					 errdetail("Chunk will not be reordered as it has compressed data.")));
 
-		ts_alter_table_with_event_trigger(chunk_id, fcinfo->context, list_make1(&cmd), false);
-		ts_alter_table_with_event_trigger(compressed_chunk->table_id,
-										  fcinfo->context,
-										  list_make1(&cmd),
-										  false);
-		/* move indexes on original and compressed chunk */
-		ts_chunk_index_move_all(chunk_id, index_destination_tablespace);
-		ts_chunk_index_move_all(compressed_chunk->table_id, index_destination_tablespace);
+		if (ts_guc_move_chunk_io_rate_limit > 0)
+			move_compressed_chunk_throttled(chunk_id,
+											compressed_chunk->table_id,
+											destination_tablespace,
+											index_destination_tablespace);
+		else
+		{
+			ts_alter_table_with_event_trigger(chunk_id,
+											  fcinfo->context,
+											  list_make1(&cmd),
+											  false);
+			ts_alter_table_with_event_trigger(compressed_chunk->table_id,
+											  fcinfo->context,
+											  list_make1(&cmd),
+											  false);
+			/* move indexes on original and compressed chunk */
+			ts_chunk_index_move_all(chunk_id, index_destination_tablespace);
+			ts_chunk_index_move_all(compressed_chunk->table_id, index_destination_tablespace);
+		}
 	}
 	else
 	{
@@ -294,7 +444,8 @@ reorder_chunk(Oid chunk_id, Oid index_id, bool verbose, Oid wait_id, Oid destina
 				verbose,
 				wait_id,
 				destination_tablespace,
-				index_tablespace);
+				index_tablespace,
+				ts_guc_enable_concurrent_reorder);
 	ts_cache_release(hcache);
 }
 
@@ -341,11 +492,13 @@ chunk_get_reorder_index(Hypertable *ht, Chunk *chunk, Oid index_relid, ChunkInde
  */
 static void
 reorder_rel(Oid tableOid, Oid indexOid, bool verbose, Oid wait_id, Oid destination_tablespace,
-			Oid index_tablespace)
+			Oid index_tablespace, bool concurrent)
 {
 	Relation OldHeap;
 	HeapTuple tuple;
 	Form_pg_index indexForm;
+	/* A concurrent reorder only blocks the writes at the end */
+	LOCKMODE lockmode = concurrent ? ShareUpdateExclusiveLock : ExclusiveLock;
 
 	if (!OidIsValid(indexOid))
 		elog(ERROR, "Reorder must specify an index.");
@@ -357,9 +510,10 @@ reorder_rel(Oid tableOid, Oid indexOid, bool verbose, Oid wait_id, Oid destinati
 	 * We grab exclusive access to the target rel and index for the duration
 	 * of the transaction.  (This is redundant for the single-transaction
 	 * case, since cluster() already did it.)  The index lock is taken inside
-	 * check_index_is_clusterable.
+	 * check_index_is_clusterable. A concurrent reorder only blocks vacuum and
+	 * DDL until it blocks the writes at the end.
 	 */
-	OldHeap = try_relation_open(tableOid, ExclusiveLock);
+	OldHeap = try_relation_open(tableOid, lockmode);
 
 	/* If the table has gone away, we can skip processing it */
 	if (!OldHeap)
@@ -375,7 +529,7 @@ reorder_rel(Oid tableOid, Oid indexOid, bool verbose, Oid wait_id, Oid destinati
 	/* Check that the user still owns the relation */
 	if (!object_ownercheck(RelationRelationId, tableOid, GetUserId()))
 	{
-		relation_close(OldHeap, ExclusiveLock);
+		relation_close(OldHeap, lockmode);
 		ereport(WARNING, (errcode(ERRCODE_WARNING), errmsg("ownership changed during reorder")));
 		return;
 	}
@@ -406,7 +560,7 @@ reorder_rel(Oid tableOid, Oid indexOid, bool verbose, Oid wait_id, Oid destinati
 	if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(indexOid)))
 	{
 		ereport(WARNING, (errcode(ERRCODE_WARNING), errmsg("index disappeared during reorder")));
-		relation_close(OldHeap, ExclusiveLock);
+		relation_close(OldHeap, lockmode);
 		return;
 	}
 
@@ -417,7 +571,7 @@ reorder_rel(Oid tableOid, Oid indexOid, bool verbose, Oid wait_id, Oid destinati
 	if (!HeapTupleIsValid(tuple)) /* probably can't happen */
 	{
 		ereport(WARNING, (errcode(ERRCODE_WARNING), errmsg("invalid index heap during reorder")));
-		relation_close(OldHeap, ExclusiveLock);
+		relation_close(OldHeap, lockmode);
 		return;
 	}
 	indexForm = (Form_pg_index) GETSTRUCT(tuple);
@@ -438,10 +592,16 @@ reorder_rel(Oid tableOid, Oid indexOid, bool verbose, Oid wait_id, Oid destinati
 	CheckTableNotInUse(OldHeap, "CLUSTER");
 
 	/* Check heap and index are valid to cluster on */
-	check_index_is_clusterable(OldHeap, indexOid, ExclusiveLock);
+	check_index_is_clusterable(OldHeap, indexOid, lockmode);
 
 	/* rebuild_relation does all the dirty work */
-	rebuild_relation(OldHeap, indexOid, verbose, wait_id, destination_tablespace, index_tablespace);
+	rebuild_relation(OldHeap,
+					 indexOid,
+					 verbose,
+					 wait_id,
+					 destination_tablespace,
+					 index_tablespace,
+					 concurrent);
 
 	/* NB: rebuild_relation does table_close() on OldHeap */
 }
@@ -456,7 +616,7 @@ reorder_rel(Oid tableOid, Oid indexOid, bool verbose, Oid wait_id, Oid destinati
  */
 static void
 rebuild_relation(Relation OldHeap, Oid indexOid, bool verbose, Oid wait_id,
-				 Oid destination_tablespace, Oid index_tablespace)
+				 Oid destination_tablespace, Oid index_tablespace, bool concurrent)
 {
 	Oid tableOid = RelationGetRelid(OldHeap);
 	Oid tableSpace = OidIsValid(destination_tablespace) ? destination_tablespace :
@@ -479,21 +639,68 @@ rebuild_relation(Relation OldHeap, Oid indexOid, bool verbose, Oid wait_id,
 	table_close(OldHeap, NoLock);
 
 	/* Create the transient table that will receive the re-ordered data */
-	OIDNewHeap =
-		make_new_heap(tableOid, tableSpace, OldHeap->rd_rel->relam, relpersistence, ExclusiveLock);
-
-	/* Copy the heap data into the new table in the desired order */
-	copy_heap_data(OIDNewHeap,
-				   tableOid,
-				   indexOid,
-				   verbose,
-				   &swap_toast_by_content,
-				   &frozenXid,
-				   &cutoffMulti);
-
-	/* Create versions of the tables indexes for the new table */
-	new_index_oids =
-		ts_chunk_index_duplicate(tableOid, OIDNewHeap, &old_index_oids, index_tablespace);
+	OIDNewHeap = make_new_heap(tableOid,
+							   tableSpace,
+							   OldHeap->rd_rel->relam,
+							   relpersistence,
+							   concurrent ? ShareUpdateExclusiveLock : ExclusiveLock);
+
+	if (concurrent)
+	{
+		/* Throttle the copy if this moves the chunk to another tablespace */
+		ConcurrentCopyState *state =
+			copy_heap_data_concurrently(OIDNewHeap,
+										tableOid,
+										indexOid,
+										verbose,
+										OidIsValid(destination_tablespace) ?
+											ts_guc_move_chunk_io_rate_limit :
+											0);
+
+		DEBUG_WAITPOINT("reorder_concurrent_copy");
+
+		/*
+		 * Apply the changes made during the copy while the writes continue,
+		 * so that few changes are left to apply with the writes blocked.
+		 */
+		for (int round = 0; round < REORDER_CONCURRENT_MAX_ROUNDS; round++)
+		{
+			if (apply_concurrent_changes(state) <= REORDER_CONCURRENT_MAX_LOCKED_CHANGES)
+				break;
+		}
+
+		/* Create versions of the tables indexes for the new table */
+		new_index_oids =
+			ts_chunk_index_duplicate(tableOid, OIDNewHeap, &old_index_oids, index_tablespace);
+
+		/*
+		 * Block the writes, but not the reads, until the swap, and apply the
+		 * remaining changes, which updates the new indexes too.
+		 */
+		DEBUG_WAITPOINT("reorder_concurrent_lock");
+		LockRelationOid(tableOid, ExclusiveLock);
+		concurrent_copy_open_indexes(state);
+		apply_concurrent_changes(state);
+		end_concurrent_copy(state, &frozenXid, &cutoffMulti);
+
+		/* The copied values are toasted in the toast table of the new heap */
+		swap_toast_by_content = false;
+	}
+	else
+	{
+		/* Copy the heap data into the new table in the desired order */
+		copy_heap_data(OIDNewHeap,
+					   tableOid,
+					   indexOid,
+					   verbose,
+					   &swap_toast_by_content,
+					   &frozenXid,
+					   &cutoffMulti);
+
+		/* Create versions of the tables indexes for the new table */
+		new_index_oids =
+			ts_chunk_index_duplicate(tableOid, OIDNewHeap, &old_index_oids, index_tablespace);
+	}
 
 	/*
 	 * Swap the physical files of the target and transient tables, then
@@ -523,9 +730,6 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 			   bool *pSwapToastByContent, TransactionId *pFreezeXid, MultiXactId *pCutoffMulti)
 {
 	Relation NewHeap, OldHeap, OldIndex;
-	Relation relRelation;
-	HeapTuple reltup;
-	Form_pg_class relform;
 	TupleDesc PG_USED_FOR_ASSERTS_ONLY oldTupDesc;
 	TupleDesc newTupDesc;
 	int natts;
@@ -617,41 +821,10 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 
 	/*
 	 * Compute xids used to freeze and weed out dead tuples and multixacts.
-	 * Since we're going to rewrite the whole table anyway, there's no reason
-	 * not to be aggressive about this.
-	 */
-	struct VacuumCutoffs cutoffs;
-	VacuumParams params;
-
-	memset(&params, 0, sizeof(VacuumParams));
-	vacuum_get_cutoffs(OldHeap, &params, &cutoffs);
-
-	/*
-	 * FreezeXid will become the table's new relfrozenxid, and that mustn't go
-	 * backwards, so take the max.
-	 */
-	{
-		TransactionId relfrozenxid = OldHeap->rd_rel->relfrozenxid;
-
-		if (TransactionIdIsValid(relfrozenxid) &&
-			TransactionIdPrecedes(cutoffs.FreezeLimit, relfrozenxid))
-			cutoffs.FreezeLimit = relfrozenxid;
-	}
-
-	/*
-	 * MultiXactCutoff, similarly, shouldn't go backwards either.
 	 */
-	{
-		MultiXactId relminmxid = OldHeap->rd_rel->relminmxid;
-
-		if (MultiXactIdIsValid(relminmxid) &&
-			MultiXactIdPrecedes(cutoffs.MultiXactCutoff, relminmxid))
-			cutoffs.MultiXactCutoff = relminmxid;
-	}
+	TransactionId OldestXmin;
 
-	/* return selected values to caller */
-	*pFreezeXid = cutoffs.FreezeLimit;
-	*pCutoffMulti = cutoffs.MultiXactCutoff;
+	get_copy_cutoffs(OldHeap, pFreezeXid, pCutoffMulti, &OldestXmin);
 
 	/*
 	 * We know how to use a sort to duplicate the ordering of a btree index,
@@ -685,9 +858,9 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 									NewHeap,
 									OldIndex,
 									use_sort,
-									cutoffs.OldestXmin,
-									&cutoffs.FreezeLimit,
-									&cutoffs.MultiXactCutoff,
+									OldestXmin,
+									pFreezeXid,
+									pCutoffMulti,
 									&num_tuples,
 									&tups_vacuumed,
 									&tups_recently_dead);
@@ -718,7 +891,63 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 	table_close(OldHeap, NoLock);
 	table_close(NewHeap, NoLock);
 
-	/* Update pg_class to reflect the correct values of pages and tuples. */
+	/* Don't update the stats for pg_class.  See swap_relation_files. */
+	Assert(OIDOldHeap != RelationRelationId);
+	update_new_heap_stats(OIDNewHeap, num_pages, num_tuples);
+}
+
+/*
+ * Compute xids used to freeze and weed out dead tuples and multixacts.
+ * Since we're going to rewrite the whole table anyway, there's no reason
+ * not to be aggressive about this.
+ */
+static void
+get_copy_cutoffs(Relation OldHeap, TransactionId *pFreezeXid, MultiXactId *pCutoffMulti,
+				 TransactionId *pOldestXmin)
+{
+	struct VacuumCutoffs cutoffs;
+	VacuumParams params;
+
+	memset(&params, 0, sizeof(VacuumParams));
+	vacuum_get_cutoffs(OldHeap, &params, &cutoffs);
+
+	/*
+	 * FreezeXid will become the table's new relfrozenxid, and that mustn't go
+	 * backwards, so take the max.
+	 */
+	{
+		TransactionId relfrozenxid = OldHeap->rd_rel->relfrozenxid;
+
+		if (TransactionIdIsValid(relfrozenxid) &&
+			TransactionIdPrecedes(cutoffs.FreezeLimit, relfrozenxid))
+			cutoffs.FreezeLimit = relfrozenxid;
+	}
+
+	/*
+	 * MultiXactCutoff, similarly, shouldn't go backwards either.
+	 */
+	{
+		MultiXactId relminmxid = OldHeap->rd_rel->relminmxid;
+
+		if (MultiXactIdIsValid(relminmxid) &&
+			MultiXactIdPrecedes(cutoffs.MultiXactCutoff, relminmxid))
+			cutoffs.MultiXactCutoff = relminmxid;
+	}
+
+	/* return selected values to caller */
+	*pFreezeXid = cutoffs.FreezeLimit;
+	*pCutoffMulti = cutoffs.MultiXactCutoff;
+	*pOldestXmin = cutoffs.OldestXmin;
+}
+
+/* Update pg_class to reflect the correct values of pages and tuples. */
+static void
+update_new_heap_stats(Oid OIDNewHeap, BlockNumber num_pages, double num_tuples)
+{
+	Relation relRelation;
+	HeapTuple reltup;
+	Form_pg_class relform;
+
 	relRelation = table_open(RelationRelationId, RowExclusiveLock);
 
 	reltup = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(OIDNewHeap));
@@ -729,8 +958,6 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 	relform->relpages = num_pages;
 	relform->reltuples = num_tuples;
 
-	/* Don't update the stats for pg_class.  See swap_relation_files. */
-	Assert(OIDOldHeap != RelationRelationId);
 	CacheInvalidateRelcacheByTuple(reltup);
 
 	/* Clean up. */
@@ -741,6 +968,583 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
 	CommandCounterIncrement();
 }
 
+static int
+tid_map_entry_cmp(const void *left, const void *right)
+{
+	return ItemPointerCompare(&((TidMapEntry *) left)->old_tid, &((TidMapEntry *) right)->old_tid);
+}
+
+/*
+ * Insert a tuple copied from the old heap into the new heap, and return the
+ * TID of the copy.
+ */
+static ItemPointerData
+concurrent_copy_insert(ConcurrentCopyState *state, HeapTuple tuple)
+{
+	io_throttle(&state->throttle, tuple->t_len);
+
+	heap_insert(state->NewHeap,
+				tuple,
+				GetCurrentCommandId(true),
+				HEAP_INSERT_SKIP_FSM,
+				state->bistate);
+
+	if (state->indexstate != NULL)
+	{
+		ExecStoreHeapTuple(tuple, state->slot, false);
+		ExecInsertIndexTuplesCompat(state->indexstate,
+									state->slot,
+									state->estate,
+									false,
+									false,
+									NULL,
+									NIL,
+									false);
+		ExecClearTuple(state->slot);
+		ResetPerTupleExprContext(state->estate);
+	}
+
+	return tuple->t_self;
+}
+
+/*
+ * Copy the heap data into the new heap in the order of the index without
+ * blocking the writes to the old heap.
+ *
+ * We copy the tuples that are visible in a snapshot, like pg_repack, and
+ * remember the TIDs of their copies. The changes made after the snapshot are
+ * captured by comparing the visibility of the tuples of the old heap in the
+ * snapshot and in a later snapshot, see apply_concurrent_changes(). This
+ * needs that the tuples that were visible in the snapshot are not removed,
+ * which we ensure by holding the snapshot and a lock that conflicts with
+ * vacuum, and that the writes to the old heap are blocked for the final
+ * changes.
+ *
+ * The copied values are toasted again in the toast table of the new heap,
+ * since the toast table of the old heap changes during the copy.
+ */
+static ConcurrentCopyState *
+copy_heap_data_concurrently(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex, bool verbose,
+							int io_rate_limit_kb)
+{
+	ConcurrentCopyState *state = palloc0(sizeof(ConcurrentCopyState));
+	HASHCTL ctl = {
+		.keysize = sizeof(ItemPointerData),
+		.entrysize = sizeof(TidMapEntry),
+		.hcxt = CurrentMemoryContext,
+	};
+	Relation OldIndex;
+	TupleTableSlot *slot;
+	HeapTuple tuple;
+	PGRUsage ru0;
+
+	pg_rusage_init(&ru0);
+
+	state->NewHeap = table_open(OIDNewHeap, AccessExclusiveLock);
+	state->OldHeap = table_open(OIDOldHeap, ShareUpdateExclusiveLock);
+	state->elevel = verbose ? INFO : DEBUG2;
+	io_throttle_init(&state->throttle, io_rate_limit_kb);
+	OldIndex = index_open(OIDOldIndex, ShareUpdateExclusiveLock);
+
+	/* Keep the toast table of the old heap from being vacuumed, see copy_heap_data() */
+	if (state->OldHeap->rd_rel->reltoastrelid)
+		LockRelationOid(state->OldHeap->rd_rel->reltoastrelid, ShareUpdateExclusiveLock);
+
+	ereport(state->elevel,
+			(errmsg("reordering \"%s.%s\" concurrently using index \"%s\"",
+					get_namespace_name(RelationGetNamespace(state->OldHeap)),
+					RelationGetRelationName(state->OldHeap),
+					RelationGetRelationName(OldIndex))));
+
+	state->snapshot = RegisterSnapshot(GetLatestSnapshot());
+	state->maxcopied = 1024;
+	state->copied = MemoryContextAllocHuge(CurrentMemoryContext,
+										   sizeof(TidMapEntry) * state->maxcopied);
+	state->applied =
+		hash_create("reorder applied tuples", 1024, &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	state->bistate = GetBulkInsertState();
+	slot = table_slot_create(state->OldHeap, NULL);
+
+	/*
+	 * We know how to use a sort to duplicate the ordering of a btree index,
+	 * and will use seqscan-and-sort for that. Otherwise, use an indexscan.
+	 * The sort keeps the TIDs of the tuples.
+	 */
+	if (OldIndex->rd_rel->relam == BTREE_AM_OID)
+	{
+		Tuplesortstate *tuplesort = tuplesort_begin_cluster(RelationGetDescr(state->OldHeap),
+															OldIndex,
+															maintenance_work_mem,
+															NULL,
+															TUPLESORT_NONE);
+		TableScanDesc scan = table_beginscan(state->OldHeap, state->snapshot, 0, NULL);
+
+		while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+		{
+			bool should_free;
+
+			CHECK_FOR_INTERRUPTS();
+			tuple = ExecFetchSlotHeapTuple(slot, false, &should_free);
+			tuplesort_putheaptuple(tuplesort, tuple);
+
+			if (should_free)
+				heap_freetuple(tuple);
+		}
+
+		table_endscan(scan);
+		tuplesort_performsort(tuplesort);
+
+		while ((tuple = tuplesort_getheaptuple(tuplesort, true)) != NULL)
+		{
+			ItemPointerData old_tid = tuple->t_self;
+
+			CHECK_FOR_INTERRUPTS();
+
+			if (state->ncopied == state->maxcopied)
+			{
+				state->maxcopied *= 2;
+				state->copied =
+					repalloc_huge(state->copied, sizeof(TidMapEntry) * state->maxcopied);
+			}
+
+			state->copied[state->ncopied].new_tid = concurrent_copy_insert(state, tuple);
+			state->copied[state->ncopied].old_tid = old_tid;
+			state->ncopied++;
+		}
+
+		tuplesort_end(tuplesort);
+	}
+	else
+	{
+		IndexScanDesc scan = index_beginscan(state->OldHeap, OldIndex, state->snapshot, 0, 0);
+
+		index_rescan(scan, NULL, 0, NULL, 0);
+
+		while (index_getnext_slot(scan, ForwardScanDirection, slot))
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			/* Copy the tuple since the insert changes its header */
+			tuple = ExecCopySlotHeapTuple(slot);
+
+			if (state->ncopied == state->maxcopied)
+			{
+				state->maxcopied *= 2;
+				state->copied =
+					repalloc_huge(state->copied, sizeof(TidMapEntry) * state->maxcopied);
+			}
+
+			state->copied[state->ncopied].old_tid = tuple->t_self;
+			state->copied[state->ncopied].new_tid = concurrent_copy_insert(state, tuple);
+			state->ncopied++;
+			heap_freetuple(tuple);
+		}
+
+		index_endscan(scan);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	index_close(OldIndex, NoLock);
+
+	qsort(state->copied, state->ncopied, sizeof(TidMapEntry), tid_map_entry_cmp);
+	state->num_tuples = state->ncopied;
+
+	ereport(state->elevel,
+			(errmsg("\"%s\": copied %.0f row versions",
+					RelationGetRelationName(state->OldHeap),
+					state->num_tuples),
+			 errdetail("%s.", pg_rusage_show(&ru0))));
+
+	return state;
+}
+
+/*
+ * Forget the live copy of the tuple of the old heap with the given TID, and
+ * get the TID of the copy. The TID can be reused in the old heap after the
+ * tuple is deleted and pruned, so the copies made when applying the changes
+ * take precedence.
+ */
+static bool
+concurrent_copy_remove(ConcurrentCopyState *state, ItemPointer old_tid, ItemPointer new_tid)
+{
+	TidMapEntry key = { .old_tid = *old_tid };
+	TidMapEntry *entry = hash_search(state->applied, old_tid, HASH_FIND, NULL);
+
+	if (entry != NULL)
+	{
+		*new_tid = entry->new_tid;
+		hash_search(state->applied, old_tid, HASH_REMOVE, NULL);
+		return true;
+	}
+
+	entry = bsearch(&key, state->copied, state->ncopied, sizeof(TidMapEntry), tid_map_entry_cmp);
+
+	if (entry == NULL || !ItemPointerIsValid(&entry->new_tid))
+		return false;
+
+	*new_tid = entry->new_tid;
+	ItemPointerSetInvalid(&entry->new_tid);
+	return true;
+}
+
+/*
+ * Apply the changes made to the old heap since the last snapshot to the new
+ * heap, and return the number of changes.
+ *
+ * We take a new snapshot and scan the old heap for the tuples that are
+ * visible in only one of the snapshots. The tuples that are no longer visible
+ * were deleted or updated, so we delete their copies, and the tuples that
+ * became visible were inserted or are the new versions of updated tuples, so
+ * we copy them. The pages that are all-visible are skipped since they can't
+ * have such tuples, and vacuum can't set the bits while we hold the lock.
+ */
+static uint64
+apply_concurrent_changes(ConcurrentCopyState *state)
+{
+	Snapshot snapshot = RegisterSnapshot(GetLatestSnapshot());
+	BlockNumber nblocks = RelationGetNumberOfBlocks(state->OldHeap);
+	BufferAccessStrategy bstrategy = GetAccessStrategy(BAS_BULKREAD);
+	Buffer vmbuffer = InvalidBuffer;
+	List *deleted = NIL;
+	List *inserted = NIL;
+	ListCell *lc;
+	uint64 nchanges;
+	PGRUsage ru0;
+
+	pg_rusage_init(&ru0);
+
+	/* Make our inserts visible to the deletes below */
+	CommandCounterIncrement();
+
+	for (BlockNumber blkno = 0; blkno < nblocks; blkno++)
+	{
+		Buffer buf;
+		Page page;
+		OffsetNumber maxoff;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (VM_ALL_VISIBLE(state->OldHeap, blkno, &vmbuffer))
+			continue;
+
+		buf = ReadBufferExtended(state->OldHeap, MAIN_FORKNUM, blkno, RBM_NORMAL, bstrategy);
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buf);
+		maxoff = PageGetMaxOffsetNumber(page);
+
+		for (OffsetNumber offnum = FirstOffsetNumber; offnum <= maxoff;
+			 offnum = OffsetNumberNext(offnum))
+		{
+			ItemId itemid = PageGetItemId(page, offnum);
+			HeapTupleData tuple;
+			bool was_visible, is_visible;
+
+			if (!ItemIdIsNormal(itemid))
+				continue;
+
+			tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
+			tuple.t_len = ItemIdGetLength(itemid);
+			tuple.t_tableOid = RelationGetRelid(state->OldHeap);
+			ItemPointerSet(&tuple.t_self, blkno, offnum);
+
+			was_visible = HeapTupleSatisfiesVisibility(&tuple, state->snapshot, buf);
+			is_visible = HeapTupleSatisfiesVisibility(&tuple, snapshot, buf);
+
+			if (was_visible && !is_visible)
+			{
+				ItemPointer tid = palloc(sizeof(ItemPointerData));
+
+				*tid = tuple.t_self;
+				deleted = lappend(deleted, tid);
+			}
+			else if (!was_visible && is_visible)
+				inserted = lappend(inserted, heap_copytuple(&tuple));
+		}
+
+		UnlockReleaseBuffer(buf);
+	}
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+	FreeAccessStrategy(bstrategy);
+
+	/* Delete first, so that the new versions don't conflict with the old ones */
+	foreach (lc, deleted)
+	{
+		ItemPointerData new_tid;
+		bool found = concurrent_copy_remove(state, lfirst(lc), &new_tid);
+
+		Ensure(found, "deleted tuple was not copied during reorder");
+		simple_heap_delete(state->NewHeap, &new_tid);
+	}
+
+	foreach (lc, inserted)
+	{
+		HeapTuple tuple = lfirst(lc);
+		ItemPointerData old_tid = tuple->t_self;
+		bool found;
+		TidMapEntry *entry = hash_search(state->applied, &old_tid, HASH_ENTER, &found);
+
+		Assert(!found);
+		entry->new_tid = concurrent_copy_insert(state, tuple);
+		heap_freetuple(tuple);
+	}
+
+	UnregisterSnapshot(state->snapshot);
+	state->snapshot = snapshot;
+	state->num_tuples += list_length(inserted) - list_length(deleted);
+	nchanges = list_length(inserted) + list_length(deleted);
+
+	ereport(state->elevel,
+			(errmsg("\"%s\": applied %d deletes and %d inserts made during the reorder",
+					RelationGetRelationName(state->OldHeap),
+					list_length(deleted),
+					list_length(inserted)),
+			 errdetail("%s.", pg_rusage_show(&ru0))));
+
+	list_free_deep(deleted);
+	list_free(inserted);
+
+	return nchanges;
+}
+
+/*
+ * Maintain the indexes of the new heap when applying the changes, after they
+ * are created.
+ */
+static void
+concurrent_copy_open_indexes(ConcurrentCopyState *state)
+{
+	/* Make the new indexes visible in the relcache */
+	CommandCounterIncrement();
+
+	state->estate = CreateExecutorState();
+	state->indexstate = CatalogOpenIndexes(state->NewHeap);
+	state->slot = MakeSingleTupleTableSlot(RelationGetDescr(state->NewHeap), &TTSOpsHeapTuple);
+}
+
+static void
+end_concurrent_copy(ConcurrentCopyState *state, TransactionId *pFreezeXid,
+					MultiXactId *pCutoffMulti)
+{
+	Oid OIDNewHeap = RelationGetRelid(state->NewHeap);
+	BlockNumber num_pages = RelationGetNumberOfBlocks(state->NewHeap);
+	TransactionId OldestXmin;
+
+	/* All tuples of the new heap were inserted by us, so any cutoffs will do */
+	get_copy_cutoffs(state->OldHeap, pFreezeXid, pCutoffMulti, &OldestXmin);
+
+	if (state->indexstate != NULL)
+	{
+		ExecDropSingleTupleTableSlot(state->slot);
+		CatalogCloseIndexes(state->indexstate);
+		FreeExecutorState(state->estate);
+	}
+
+	FreeBulkInsertState(state->bistate);
+	UnregisterSnapshot(state->snapshot);
+	hash_destroy(state->applied);
+	pfree(state->copied);
+
+	table_close(state->OldHeap, NoLock);
+	table_close(state->NewHeap, NoLock);
+
+	update_new_heap_stats(OIDNewHeap, num_pages, state->num_tuples);
+	pfree(state);
+}
+
+static void
+io_throttle_init(IoThrottle *throttle, int rate_limit_kb)
+{
+	throttle->rate_limit_kb = rate_limit_kb;
+	throttle->start = GetCurrentTimestamp();
+	throttle->bytes = 0;
+}
+
+/*
+ * Account for the bytes copied, and sleep if the copy is ahead of the rate
+ * limit. The budget accumulates from the start of the copy, so the sleeps
+ * even out over the whole copy.
+ */
+static void
+io_throttle(IoThrottle *throttle, Size nbytes)
+{
+	int64 budget_us, elapsed_us;
+
+	if (throttle == NULL || throttle->rate_limit_kb <= 0)
+		return;
+
+	throttle->bytes += nbytes;
+	budget_us = (int64) ((double) throttle->bytes * USECS_PER_SEC /
+						 ((double) throttle->rate_limit_kb * 1024));
+	elapsed_us = GetCurrentTimestamp() - throttle->start;
+
+	/* Sleep at least a millisecond at a time, like vacuum_delay_point() */
+	if (budget_us - elapsed_us >= 1000)
+	{
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 (budget_us - elapsed_us) / 1000,
+						 PG_WAIT_EXTENSION);
+		ResetLatch(MyLatch);
+	}
+
+	CHECK_FOR_INTERRUPTS();
+}
+
+/*
+ * Copy a fork of a relation block by block with the I/O throttled, the same
+ * as RelationCopyStorage().
+ */
+static void
+copy_fork_throttled(Relation rel, SMgrRelation dst, ForkNumber forknum, IoThrottle *throttle)
+{
+#if PG16_LT
+	PGAlignedBlock buf;
+	RelFileNode *dst_locator = &dst->smgr_rnode.node;
+#else
+	PGIOAlignedBlock buf;
+	RelFileLocator *dst_locator = &dst->smgr_rlocator.locator;
+#endif
+	Page page = (Page) buf.data;
+	SMgrRelation src = RelationGetSmgr(rel);
+	char relpersistence = rel->rd_rel->relpersistence;
+	bool copying_initfork =
+		relpersistence == RELPERSISTENCE_UNLOGGED && forknum == INIT_FORKNUM;
+	bool use_wal =
+		XLogIsNeeded() && (relpersistence == RELPERSISTENCE_PERMANENT || copying_initfork);
+	BlockNumber nblocks = smgrnblocks(src, forknum);
+
+	for (BlockNumber blkno = 0; blkno < nblocks; blkno++)
+	{
+		io_throttle(throttle, BLCKSZ);
+
+		/* The source relation might be modified by the smgr calls below */
+		src = RelationGetSmgr(rel);
+		smgrread(src, forknum, blkno, buf.data);
+
+		if (!PageIsVerifiedExtended(page, blkno, PIV_LOG_WARNING | PIV_REPORT_STAT))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid page in block %u of relation \"%s\"",
+							blkno,
+							RelationGetRelationName(rel))));
+
+		/*
+		 * WAL-log the copied page. Unfortunately we don't know what kind of a
+		 * page this is, so we have to log the full page including any unused
+		 * space.
+		 */
+		if (use_wal)
+			log_newpage(dst_locator, forknum, blkno, page, false);
+
+		PageSetChecksumInplace(page, blkno);
+
+		/*
+		 * Now write the page.  We say skipFsync = true because there's no
+		 * need for smgr to schedule an fsync for this write; we'll do it
+		 * ourselves below.
+		 */
+		smgrextend(dst, forknum, blkno, buf.data, true);
+	}
+
+	/*
+	 * When we WAL-logged rel pages, we must nonetheless fsync them, since
+	 * the WAL replay only restores the pages written after the checkpoint.
+	 * Otherwise the pending syncs of the new storage take care of it.
+	 */
+	if (use_wal || copying_initfork)
+		smgrimmedsync(dst, forknum);
+}
+
+/*
+ * Move the storage of a relation, and of its toast table, to a tablespace
+ * with the I/O throttled, the same as ATExecSetTableSpace().
+ */
+static void
+move_relation_storage(Oid relid, Oid tablespace, IoThrottle *throttle)
+{
+	Relation rel = relation_open(relid, AccessExclusiveLock);
+	char relpersistence = rel->rd_rel->relpersistence;
+	Oid reltoastrelid = rel->rd_rel->reltoastrelid;
+	List *reltoastidxids = NIL;
+	SMgrRelation dstrel;
+	ListCell *lc;
+
+	if (!CheckRelationTableSpaceMove(rel, tablespace))
+	{
+		relation_close(rel, NoLock);
+		return;
+	}
+
+	if (OidIsValid(reltoastrelid))
+	{
+		Relation toastrel = relation_open(reltoastrelid, AccessExclusiveLock);
+
+		reltoastidxids = RelationGetIndexList(toastrel);
+		relation_close(toastrel, AccessExclusiveLock);
+	}
+
+	/*
+	 * Create the new storage and copy the forks, relfilenumbers are unique
+	 * in the database, so we need a new one for the new tablespace.
+	 */
+#if PG16_LT
+	RelFileNode newrlocator = rel->rd_node;
+
+	newrlocator.relNode = GetNewRelFileNode(tablespace, NULL, relpersistence);
+	newrlocator.spcNode = tablespace;
+#else
+	RelFileLocator newrlocator = rel->rd_locator;
+
+	newrlocator.relNumber = GetNewRelFileNumber(tablespace, NULL, relpersistence);
+	newrlocator.spcOid = tablespace;
+#endif
+
+	dstrel = RelationCreateStorage(newrlocator, relpersistence, true);
+	FlushRelationBuffers(rel);
+	copy_fork_throttled(rel, dstrel, MAIN_FORKNUM, throttle);
+
+	for (ForkNumber forknum = MAIN_FORKNUM + 1; forknum <= MAX_FORKNUM; forknum++)
+	{
+		if (smgrexists(RelationGetSmgr(rel), forknum))
+		{
+			smgrcreate(dstrel, forknum, false);
+
+			if (relpersistence == RELPERSISTENCE_PERMANENT ||
+				(relpersistence == RELPERSISTENCE_UNLOGGED && forknum == INIT_FORKNUM))
+				log_smgrcreate(&newrlocator, forknum);
+
+			copy_fork_throttled(rel, dstrel, forknum, throttle);
+		}
+	}
+
+	/* Drop the old storage at commit */
+	RelationDropStorage(rel);
+	smgrclose(dstrel);
+
+#if PG16_LT
+	SetRelationTableSpace(rel, tablespace, newrlocator.relNode);
+	InvokeObjectPostAlterHook(RelationRelationId, relid, 0);
+	RelationAssumeNewRelfilenode(rel);
+#else
+	SetRelationTableSpace(rel, tablespace, newrlocator.relNumber);
+	InvokeObjectPostAlterHook(RelationRelationId, relid, 0);
+	RelationAssumeNewRelfilelocator(rel);
+#endif
+
+	relation_close(rel, NoLock);
+
+	/* Make sure the reltablespace change is visible */
+	CommandCounterIncrement();
+
+	if (OidIsValid(reltoastrelid))
+		move_relation_storage(reltoastrelid, tablespace, throttle);
+
+	foreach (lc, reltoastidxids)
+		move_relation_storage(lfirst_oid(lc), tablespace, throttle);
+}
+
 /*
  * Remove the transient table that was built by make_new_heap, and finish
  * cleaning up (including rebuilding all indexes on the old heap).
@@ -0,0 +1,60 @@
+# This file and its contents are licensed under the Timescale License.
+# Please see the included NOTICE for copyright information and
+# LICENSE-TIMESCALE for a copy of the license.
+
+###
+# Test inserts into a hypercore while its non-compressed rows are merged
+# into new batches. The inserts go to the chunk and to a plain table, and
+# after the merge the chunk must have the same rows as the plain table,
+# also when read through the index.
+###
+
+setup {
+  CREATE TABLE readings(time int NOT NULL, device int, value int);
+  SELECT FROM create_hypertable('readings', 'time', chunk_time_interval => 1000,
+                                create_default_indexes => false);
+  CREATE INDEX readings_value_idx ON readings(value);
+  ALTER TABLE readings SET (timescaledb.compress,
+                            timescaledb.compress_segmentby = 'device',
+                            timescaledb.compress_orderby = 'time');
+  CREATE TABLE readings_ref(time int NOT NULL, device int, value int);
+  INSERT INTO readings SELECT t, t % 3 + 1, t FROM generate_series(0, 599) t;
+  SELECT FROM compress_chunk(show_chunks('readings'), hypercore_use_access_method => true);
+  INSERT INTO readings SELECT t, t % 3 + 1, t FROM generate_series(600, 899) t;
+  INSERT INTO readings_ref SELECT * FROM readings;
+}
+
+teardown {
+  DROP TABLE readings;
+  DROP TABLE readings_ref;
+}
+
+session "M"
+step "M1" { SELECT count(compress_chunk(c)) AS merged FROM show_chunks('readings') c; }
+
+session "W"
+step "Wb" { BEGIN; }
+step "Wi" { INSERT INTO readings SELECT t, t % 4 + 1, t FROM generate_series(900, 949) t; INSERT INTO readings_ref SELECT t, t % 4 + 1, t FROM generate_series(900, 949) t; }
+step "Wc" { COMMIT; }
+step "Wr" { ROLLBACK; }
+
+session "C"
+step "Ce" { SELECT debug_waitpoint_enable('hypercore_merge_before_status_update'); }
+step "Cr" { SELECT debug_waitpoint_release('hypercore_merge_before_status_update'); }
+
+session "S"
+step "Sdiff" { SELECT count(*) AS differences FROM ((TABLE readings EXCEPT ALL TABLE readings_ref) UNION ALL (TABLE readings_ref EXCEPT ALL TABLE readings)) d; }
+step "Sidx" { SET enable_seqscan TO off; SET timescaledb.enable_columnarscan TO off; SELECT count(*) AS index_rows, sum(value) FROM readings WHERE value >= 0; RESET enable_seqscan; RESET timescaledb.enable_columnarscan; }
+step "Srows" { SELECT count(*) FILTER (WHERE _timescaledb_debug.is_compressed_tid(ctid)) AS compressed, count(*) FILTER (WHERE NOT _timescaledb_debug.is_compressed_tid(ctid)) AS non_compressed FROM readings; }
+step "Sstatus" { SELECT status FROM _timescaledb_catalog.chunk WHERE compressed_chunk_id IS NOT NULL; }
+
+# Inserts that commit during the merge stay non-compressed, and the chunk
+# stays partial
+permutation "Ce" "M1" "Wi" "Cr" "Sdiff" "Sidx" "Srows" "Sstatus"
+# An insert transaction that is open during the merge
+permutation "Wb" "Wi" "M1" "Wc" "Sdiff" "Sidx" "Srows" "Sstatus"
+# An insert transaction that is open when the merge updates the status, and
+# aborts after the merge
+permutation "Ce" "M1" "Wb" "Wi" "Cr" "Wr" "Sdiff" "Sidx" "Srows" "Sstatus"
+# A merge without concurrent inserts clears the partial status
+permutation "M1" "Sdiff" "Sidx" "Srows" "Sstatus"
@@ -0,0 +1,58 @@
+# This file and its contents are licensed under the Timescale License.
+# Please see the included NOTICE for copyright information and
+# LICENSE-TIMESCALE for a copy of the license.
+
+###
+# Test the writes during a concurrent reorder. The writes go to the chunk
+# and to a plain table, and after the reorder the chunk must have the same
+# rows as the plain table, also when read through the new indexes.
+###
+
+setup {
+  CREATE TABLE ts_reorder_test(time int NOT NULL, temp float, location int);
+  SELECT FROM create_hypertable('ts_reorder_test', 'time', chunk_time_interval => 100);
+  CREATE INDEX ts_reorder_test_location_idx ON ts_reorder_test(location);
+  CREATE TABLE reorder_ref(time int NOT NULL, temp float, location int);
+  INSERT INTO ts_reorder_test SELECT i % 100, i, i % 10 FROM generate_series(1, 1000) i;
+  INSERT INTO reorder_ref SELECT * FROM ts_reorder_test;
+}
+
+teardown {
+  DROP TABLE ts_reorder_test;
+  DROP TABLE reorder_ref;
+}
+
+session "R"
+setup { SET timescaledb.enable_concurrent_reorder TO on; }
+step "R1" { SELECT reorder_chunk((SELECT show_chunks('ts_reorder_test') LIMIT 1), 'ts_reorder_test_location_idx'); }
+
+session "W"
+step "Wb" { BEGIN; }
+step "Wi" { INSERT INTO ts_reorder_test VALUES (7, -1, 11), (8, -2, 12); INSERT INTO reorder_ref VALUES (7, -1, 11), (8, -2, 12); }
+step "Wu" { UPDATE ts_reorder_test SET temp = -temp WHERE location = 5; UPDATE reorder_ref SET temp = -temp WHERE location = 5; }
+step "Wd" { DELETE FROM ts_reorder_test WHERE location = 3; DELETE FROM reorder_ref WHERE location = 3; }
+step "Wc" { COMMIT; }
+step "Wr" { ROLLBACK; }
+
+session "C"
+step "Ce_copy" { SELECT debug_waitpoint_enable('reorder_concurrent_copy'); }
+step "Cr_copy" { SELECT debug_waitpoint_release('reorder_concurrent_copy'); }
+step "Ce_lock" { SELECT debug_waitpoint_enable('reorder_concurrent_lock'); }
+step "Cr_lock" { SELECT debug_waitpoint_release('reorder_concurrent_lock'); }
+
+session "S"
+step "Sdiff" { SELECT count(*) AS differences FROM ((TABLE ts_reorder_test EXCEPT ALL TABLE reorder_ref) UNION ALL (TABLE reorder_ref EXCEPT ALL TABLE ts_reorder_test)) d; }
+step "Sidx" { SET enable_seqscan TO off; SELECT location, count(*), sum(temp) FROM ts_reorder_test WHERE location >= 0 GROUP BY location EXCEPT SELECT location, count(*), sum(temp) FROM reorder_ref GROUP BY location; RESET enable_seqscan; }
+
+# Writes during the copy, before the first round of changes
+permutation "Ce_copy" "R1" "Wi" "Wu" "Wd" "Cr_copy" "Sdiff" "Sidx"
+# Writes after the rounds, before the writes are blocked
+permutation "Ce_lock" "R1" "Wi" "Wu" "Wd" "Cr_lock" "Sdiff" "Sidx"
+# A transaction that is open during the copy and commits when the reorder
+# waits for the lock
+permutation "Wb" "Wi" "Ce_copy" "R1" "Wu" "Cr_copy" "Wd" "Wc" "Sdiff" "Sidx"
+# A transaction that is open when the reorder waits for the lock and
+# aborts
+permutation "Ce_lock" "R1" "Wb" "Wi" "Wu" "Cr_lock" "Wd" "Wr" "Sdiff" "Sidx"
+# Writes that block the lock upgrade after the rounds
+permutation "Ce_lock" "R1" "Wb" "Wi" "Cr_lock" "Wu" "Wd" "Wc" "Sdiff" "Sidx"
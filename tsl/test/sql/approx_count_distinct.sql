@@ -0,0 +1,81 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for approx_count_distinct() and its vectorized implementation
+\ir include/setting_compare.sql
+
+CREATE TABLE distinct_ht(time int NOT NULL, device text, s smallint, i int, b bigint, f float8,
+                         n int, note text);
+SELECT table_name FROM create_hypertable('distinct_ht', 'time', chunk_time_interval => 10000);
+ALTER TABLE distinct_ht SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                              timescaledb.compress_orderby = 'time');
+INSERT INTO distinct_ht
+SELECT t, 'd' || t % 5, t % 300, t % 1000, t, (t % 777) * 0.5, NULL, 'note ' || t % 50
+FROM generate_series(0, 29999) t;
+-- The last chunk stays uncompressed
+SELECT count(compress_chunk(c)) FROM show_chunks('distinct_ht') c
+WHERE c != '_timescaledb_internal._hyper_1_3_chunk'::regclass;
+ANALYZE distinct_ht;
+SET max_parallel_workers_per_gather TO 0;
+
+-- The estimates depend on the hash function of the build, so compare them with
+-- the exact counts. The standard error is about 1.6%.
+CREATE VIEW estimates AS
+SELECT 's' AS arg, approx_count_distinct(s) AS estimate, count(DISTINCT s) AS exact FROM distinct_ht
+UNION ALL SELECT 'i', approx_count_distinct(i), count(DISTINCT i) FROM distinct_ht
+UNION ALL SELECT 'b', approx_count_distinct(b), count(DISTINCT b) FROM distinct_ht
+UNION ALL SELECT 'f', approx_count_distinct(f), count(DISTINCT f) FROM distinct_ht
+UNION ALL SELECT 'device', approx_count_distinct(device), count(DISTINCT device) FROM distinct_ht
+UNION ALL SELECT 'note', approx_count_distinct(note), count(DISTINCT note) FROM distinct_ht
+UNION ALL SELECT 'n', approx_count_distinct(n), count(DISTINCT n) FROM distinct_ht;
+SELECT arg, exact, abs(estimate - exact) <= greatest(1, 0.1 * exact) AS within_error FROM estimates;
+
+-- No rows and only null values
+SELECT approx_count_distinct(i) AS no_rows,
+       (SELECT approx_count_distinct(n) FROM distinct_ht) AS only_nulls
+FROM distinct_ht WHERE i < 0;
+
+-- The vectorized aggregation computes the same sketches as the Postgres
+-- aggregation, for the fixed-width types
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT approx_count_distinct(s), approx_count_distinct(i), approx_count_distinct(b),
+       approx_count_distinct(f)
+FROM distinct_ht
+$$, 'VectorAgg');
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, approx_count_distinct(i), approx_count_distinct(f)
+FROM distinct_ht GROUP BY device
+$$, 'VectorAgg');
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT approx_count_distinct(b) FROM distinct_ht WHERE i > 500
+$$, 'VectorAgg');
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, approx_count_distinct(i) FILTER (WHERE f < 100)
+FROM distinct_ht GROUP BY device
+$$, 'VectorAgg');
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT approx_count_distinct(n) FROM distinct_ht
+$$, 'VectorAgg');
+
+-- Varlena arguments are vectorized only for segmentby columns
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT approx_count_distinct(device) FROM distinct_ht
+$$, 'VectorAgg');
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT approx_count_distinct(note) FROM distinct_ht
+$$, 'VectorAgg');
+
+-- The partial sketches of the parallel workers are combined in the same way
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, approx_count_distinct(i), approx_count_distinct(b)
+FROM distinct_ht GROUP BY device
+$$, 'VectorAgg');
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
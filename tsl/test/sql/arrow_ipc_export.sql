@@ -0,0 +1,29 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the Arrow IPC stream export. The expected bytes are the schema
+-- message, the record batches and the end-of-stream marker, in the Arrow
+-- columnar format, which is little-endian.
+
+CREATE TABLE arrow_export(time int NOT NULL, device text, value int8, note text);
+SELECT table_name FROM create_hypertable('arrow_export', 'time', chunk_time_interval => 10);
+-- An empty hypertable has only the schema
+SELECT n AS message, pos, encode(substr(m, pos + 1, 16), 'hex') AS bytes
+FROM export_arrow_ipc('arrow_export') WITH ORDINALITY AS e(m, n),
+     generate_series(0, length(m) - 1, 16) pos
+ORDER BY n, pos;
+
+ALTER TABLE arrow_export SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                                 timescaledb.compress_orderby = 'time');
+INSERT INTO arrow_export VALUES (1, 'a', 10, 'x'), (2, 'a', 20, NULL), (3, 'b', 30, 'yy');
+SELECT count(compress_chunk(c)) FROM show_chunks('arrow_export') c;
+-- The second chunk is not compressed, its NULL fixed-width values are
+-- exported as spaces
+INSERT INTO arrow_export VALUES (11, NULL, NULL, 'z');
+SELECT n AS message, pos, encode(substr(m, pos + 1, 16), 'hex') AS bytes
+FROM export_arrow_ipc('arrow_export') WITH ORDINALITY AS e(m, n),
+     generate_series(0, length(m) - 1, 16) pos
+ORDER BY n, pos;
+
+DROP TABLE arrow_export;
@@ -0,0 +1,150 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for answering aggregate queries on a hypertable from a real-time
+-- continuous aggregate with the same definition
+CREATE TABLE conditions(time int NOT NULL, device int, temp int);
+SELECT table_name FROM create_hypertable('conditions', 'time', chunk_time_interval => 10);
+CREATE FUNCTION conditions_now() RETURNS int LANGUAGE SQL STABLE AS
+$$ SELECT coalesce(max(time), 0) FROM conditions $$;
+SELECT set_integer_now_func('conditions', 'conditions_now');
+INSERT INTO conditions SELECT t, t % 2, t FROM generate_series(0, 49) t;
+
+CREATE MATERIALIZED VIEW cond_summary
+WITH (timescaledb.continuous, timescaledb.materialized_only = false) AS
+SELECT time_bucket(10, time) AS bucket, device, count(*) AS cnt, sum(temp) AS total
+FROM conditions
+GROUP BY 1, 2 WITH NO DATA;
+CALL refresh_continuous_aggregate('cond_summary', NULL, NULL);
+SELECT mat_hypertable_id FROM _timescaledb_catalog.continuous_agg
+WHERE user_view_name = 'cond_summary' \gset
+
+-- Check if the plan of a query scans the materialization hypertable
+CREATE FUNCTION plan_uses_hypertable(query text, hypertable_id int) RETURNS bool
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    plan_line text;
+BEGIN
+    FOR plan_line IN EXECUTE 'EXPLAIN (costs off) ' || query LOOP
+        IF position(format('_hyper_%s_', hypertable_id) IN plan_line) > 0 THEN
+            RETURN true;
+        END IF;
+    END LOOP;
+    RETURN false;
+END
+$$;
+
+CREATE FUNCTION query_rows(query text) RETURNS text[]
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    r record;
+    result text[] := '{}';
+BEGIN
+    FOR r IN EXECUTE query LOOP
+        result := result || r::text;
+    END LOOP;
+    RETURN ARRAY(SELECT unnest(result) ORDER BY 1);
+END
+$$;
+
+-- Run a query with the rewrite off and on, and check if it was rewritten
+-- and if the result is the same
+CREATE FUNCTION check_rewrite(query text, hypertable_id int,
+                              OUT rewritten bool, OUT same_result bool)
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    expected text[];
+BEGIN
+    PERFORM set_config('timescaledb.enable_cagg_query_rewrite', 'off', true);
+    expected := query_rows(query);
+    PERFORM set_config('timescaledb.enable_cagg_query_rewrite', 'on', true);
+    rewritten := plan_uses_hypertable(query, hypertable_id);
+    same_result := query_rows(query) = expected;
+END
+$$;
+
+-- Same grouping and aggregates as the continuous aggregate
+SELECT * FROM check_rewrite($$
+SELECT time_bucket(10, time), device, count(*), sum(temp)
+FROM conditions GROUP BY 1, 2
+$$, :mat_hypertable_id);
+SELECT * FROM check_rewrite($$
+SELECT device, sum(temp), time_bucket(10, time)
+FROM conditions WHERE device = 1 GROUP BY 3, 1 HAVING sum(temp) > 100
+$$, :mat_hypertable_id);
+
+-- Different grouping
+SELECT * FROM check_rewrite($$
+SELECT device, sum(temp) FROM conditions GROUP BY 1
+$$, :mat_hypertable_id);
+SELECT * FROM check_rewrite($$
+SELECT time_bucket(5, time), device, sum(temp) FROM conditions GROUP BY 1, 2
+$$, :mat_hypertable_id);
+
+-- Aggregate that is not in the continuous aggregate
+SELECT * FROM check_rewrite($$
+SELECT time_bucket(10, time), device, max(temp) FROM conditions GROUP BY 1, 2
+$$, :mat_hypertable_id);
+
+-- Filter on a column that is not grouped by
+SELECT * FROM check_rewrite($$
+SELECT time_bucket(10, time), device, sum(temp) FROM conditions WHERE temp > 10 GROUP BY 1, 2
+$$, :mat_hypertable_id);
+
+-- Pending invalidations below the watermark
+INSERT INTO conditions VALUES (1, 1, 100);
+SELECT * FROM check_rewrite($$
+SELECT time_bucket(10, time), device, count(*), sum(temp)
+FROM conditions GROUP BY 1, 2
+$$, :mat_hypertable_id);
+CALL refresh_continuous_aggregate('cond_summary', NULL, NULL);
+SELECT * FROM check_rewrite($$
+SELECT time_bucket(10, time), device, count(*), sum(temp)
+FROM conditions GROUP BY 1, 2
+$$, :mat_hypertable_id);
+
+-- A prepared statement is planned again when the hypertable gets new
+-- invalidations
+SET timescaledb.enable_cagg_query_rewrite TO on;
+PREPARE cond_sum AS
+SELECT time_bucket(10, time) AS bucket, device, sum(temp) AS total
+FROM conditions GROUP BY 1, 2 HAVING time_bucket(10, time) = 20 AND device = 0;
+EXECUTE cond_sum;
+SELECT plan_uses_hypertable('EXECUTE cond_sum', :mat_hypertable_id) AS rewritten;
+INSERT INTO conditions VALUES (20, 0, 1000);
+EXECUTE cond_sum;
+SELECT plan_uses_hypertable('EXECUTE cond_sum', :mat_hypertable_id) AS rewritten;
+CALL refresh_continuous_aggregate('cond_summary', NULL, NULL);
+EXECUTE cond_sum;
+SELECT plan_uses_hypertable('EXECUTE cond_sum', :mat_hypertable_id) AS rewritten;
+DEALLOCATE cond_sum;
+RESET timescaledb.enable_cagg_query_rewrite;
+
+-- The materialized data of dropped chunks is kept until the dropped range
+-- is refreshed
+SELECT count(*) FROM drop_chunks('conditions', older_than => 10);
+SELECT * FROM check_rewrite($$
+SELECT time_bucket(10, time), device, count(*), sum(temp)
+FROM conditions GROUP BY 1, 2
+$$, :mat_hypertable_id);
+CALL refresh_continuous_aggregate('cond_summary', NULL, NULL);
+SELECT * FROM check_rewrite($$
+SELECT time_bucket(10, time), device, count(*), sum(temp)
+FROM conditions GROUP BY 1, 2
+$$, :mat_hypertable_id);
+
+-- No rewrite for hypertables with a retention policy
+SELECT add_retention_policy('conditions', drop_after => 100) AS retention_job_id \gset
+SELECT * FROM check_rewrite($$
+SELECT time_bucket(10, time), device, count(*), sum(temp)
+FROM conditions GROUP BY 1, 2
+$$, :mat_hypertable_id);
+SELECT remove_retention_policy('conditions');
+SELECT * FROM check_rewrite($$
+SELECT time_bucket(10, time), device, count(*), sum(temp)
+FROM conditions GROUP BY 1, 2
+$$, :mat_hypertable_id);
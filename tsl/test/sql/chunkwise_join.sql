@@ -0,0 +1,107 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the chunkwise joins of hypertables with aligned chunks
+\ir include/setting_compare.sql
+
+-- The number of joins in the plan of a query, which is the number of the
+-- joined chunk pairs for a chunkwise join
+CREATE FUNCTION plan_joins(query text) RETURNS int
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    plan_line text;
+    joins int := 0;
+BEGIN
+    FOR plan_line IN EXECUTE 'EXPLAIN (costs off) ' || query LOOP
+        IF plan_line ~ '(Hash|Merge) Join|Nested Loop' THEN
+            joins := joins + 1;
+        END IF;
+    END LOOP;
+    RETURN joins;
+END
+$$;
+-- The chunkwise joins follow enable_partitionwise_join
+CREATE FUNCTION check_join(query text, OUT joins int, OUT same_result bool)
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    expected text[];
+BEGIN
+    PERFORM set_config('enable_partitionwise_join', 'off', true);
+    expected := query_rows(query);
+    PERFORM set_config('enable_partitionwise_join', 'on', true);
+    joins := plan_joins(query);
+    same_result := query_rows(query) = expected;
+END
+$$;
+
+CREATE TABLE ja(time int NOT NULL, device int, v int);
+SELECT table_name FROM create_hypertable('ja', 'time', chunk_time_interval => 1000);
+CREATE TABLE jb(time int NOT NULL, device int, v int);
+SELECT table_name FROM create_hypertable('jb', 'time', chunk_time_interval => 1000);
+-- The chunks of jc are not aligned with the chunks of the others
+CREATE TABLE jc(time int NOT NULL, device int, v int);
+SELECT table_name FROM create_hypertable('jc', 'time', chunk_time_interval => 500);
+INSERT INTO ja SELECT t, t % 4, t % 10 FROM generate_series(0, 4999) t;
+INSERT INTO jb SELECT t, t % 4, t % 7 FROM generate_series(1000, 3999) t;
+INSERT INTO jc SELECT t, t % 4, t % 3 FROM generate_series(0, 4999) t;
+ANALYZE ja, jb, jc;
+SET max_parallel_workers_per_gather TO 0;
+
+-- The chunks of ja have only three matching chunks in jb
+SELECT * FROM check_join($$
+SELECT count(*), sum(ja.v * jb.v) FROM ja JOIN jb ON ja.time = jb.time
+$$);
+SELECT * FROM check_join($$
+SELECT a1.device, count(*), sum(a1.v * a2.v)
+FROM ja a1 JOIN ja a2 ON a1.time = a2.time GROUP BY a1.device
+$$);
+-- Only the chunks left after the chunk exclusion are joined
+SELECT * FROM check_join($$
+SELECT count(*), sum(ja.v * jb.v) FROM ja JOIN jb ON ja.time = jb.time WHERE ja.time < 2500
+$$);
+-- Other join clauses are applied to each chunk pair
+SELECT * FROM check_join($$
+SELECT count(*), sum(ja.v * jb.v)
+FROM ja JOIN jb ON ja.time = jb.time AND ja.device = jb.device AND ja.v < jb.v
+$$);
+
+-- Not joined on the dimension column
+SELECT * FROM check_join($$
+SELECT count(*), sum(ja.v * jb.v) FROM ja JOIN jb ON ja.time = jb.time + 1
+$$);
+SELECT * FROM check_join($$
+SELECT count(*) FROM ja JOIN jb ON ja.device = jb.device AND ja.v = jb.v
+$$);
+-- Outer joins would need the chunks without a match
+SELECT * FROM check_join($$
+SELECT count(*), count(jb.time) FROM ja LEFT JOIN jb ON ja.time = jb.time
+$$);
+-- The chunks are not aligned
+SELECT * FROM check_join($$
+SELECT count(*), sum(ja.v * jc.v) FROM ja JOIN jc ON ja.time = jc.time
+$$);
+
+-- Space partitioning with the same number of partitions, joined on all the
+-- dimension columns
+CREATE TABLE sa(time int NOT NULL, device int NOT NULL, v int);
+SELECT table_name FROM create_hypertable('sa', 'time', 'device', 2,
+                                          chunk_time_interval => 1000);
+CREATE TABLE sb(time int NOT NULL, device int NOT NULL, v int);
+SELECT table_name FROM create_hypertable('sb', 'time', 'device', 2,
+                                          chunk_time_interval => 1000);
+INSERT INTO sa SELECT t, d, (t + d) % 10 FROM generate_series(0, 1999) t, generate_series(1, 4) d;
+INSERT INTO sb SELECT t, d, (t * d) % 7 FROM generate_series(0, 1999) t, generate_series(1, 4) d;
+ANALYZE sa, sb;
+SELECT * FROM check_join($$
+SELECT sa.device, count(*), sum(sa.v * sb.v)
+FROM sa JOIN sb ON sa.time = sb.time AND sa.device = sb.device
+GROUP BY sa.device
+$$);
+SELECT * FROM check_join($$
+SELECT count(*), sum(sa.v * sb.v) FROM sa JOIN sb ON sa.time = sb.time
+$$);
+
+RESET max_parallel_workers_per_gather;
@@ -0,0 +1,65 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the block codec of the array and dictionary compressed data. The
+-- codec is chosen by the GUC and the column compression method, and the
+-- compressed chunk columns it applies to have external storage, so the
+-- compressed data is not compressed again by TOAST.
+CREATE FUNCTION note_codec(chunk regclass, OUT storage "char", OUT batches int,
+                           OUT block_batches int, OUT toast_compressed int)
+LANGUAGE plpgsql AS $$
+DECLARE
+    compressed regclass;
+BEGIN
+    SELECT format('%I.%I', c2.schema_name, c2.table_name)::regclass INTO compressed
+    FROM _timescaledb_catalog.chunk c1
+    JOIN _timescaledb_catalog.chunk c2 ON c1.compressed_chunk_id = c2.id
+    WHERE format('%I.%I', c1.schema_name, c1.table_name)::regclass = chunk;
+    SELECT attstorage INTO storage FROM pg_attribute
+    WHERE attrelid = compressed AND attname = 'note';
+    EXECUTE format($sql$
+        SELECT count(*),
+               count(*) FILTER (WHERE (_timescaledb_functions.compressed_data_info(note)).algorithm = 'BLOCK'),
+               count(*) FILTER (WHERE pg_column_compression(note) IS NOT NULL)
+        FROM %s$sql$, compressed)
+    INTO batches, block_batches, toast_compressed;
+END;
+$$;
+
+CREATE TABLE codec(time int NOT NULL, device int, note text);
+SELECT table_name FROM create_hypertable('codec', 'time', chunk_time_interval => 1000);
+ALTER TABLE codec SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                          timescaledb.compress_orderby = 'time');
+INSERT INTO codec SELECT t, t % 2, repeat('note ', 20) || t FROM generate_series(0, 3999) t;
+CREATE TABLE codec_ref AS SELECT * FROM codec;
+
+-- No codec by default, the data is compressed by TOAST
+SELECT compress_chunk('_timescaledb_internal._hyper_1_1_chunk');
+SELECT * FROM note_codec('_timescaledb_internal._hyper_1_1_chunk');
+
+-- The GUC enables the codec
+SET timescaledb.compression_block_codec TO lz4;
+SELECT compress_chunk('_timescaledb_internal._hyper_1_2_chunk');
+SELECT * FROM note_codec('_timescaledb_internal._hyper_1_2_chunk');
+
+-- The pglz column compression method disables the codec
+ALTER TABLE codec ALTER COLUMN note SET COMPRESSION pglz;
+SELECT compress_chunk('_timescaledb_internal._hyper_1_3_chunk');
+SELECT * FROM note_codec('_timescaledb_internal._hyper_1_3_chunk');
+
+-- The lz4 column compression method enables the codec
+RESET timescaledb.compression_block_codec;
+ALTER TABLE codec ALTER COLUMN note SET COMPRESSION lz4;
+SELECT compress_chunk('_timescaledb_internal._hyper_1_4_chunk');
+SELECT * FROM note_codec('_timescaledb_internal._hyper_1_4_chunk');
+
+-- The compressed chunks give the same data, also after decompression
+SELECT count(*) FROM (SELECT * FROM codec EXCEPT ALL SELECT * FROM codec_ref) diff;
+SELECT count(*) FROM (SELECT * FROM codec_ref EXCEPT ALL SELECT * FROM codec) diff;
+SELECT count(decompress_chunk(c)) FROM show_chunks('codec') c;
+SELECT count(*) FROM (SELECT * FROM codec EXCEPT ALL SELECT * FROM codec_ref) diff;
+SELECT count(*) FROM (SELECT * FROM codec_ref EXCEPT ALL SELECT * FROM codec) diff;
+
+DROP TABLE codec;
+DROP TABLE codec_ref;
@@ -0,0 +1,91 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for writing new compressed chunks with bulk full-page WAL records
+\ir include/setting_compare.sql
+
+CREATE FUNCTION compressed_chunks(ht regclass) RETURNS SETOF regclass
+LANGUAGE sql AS
+$$
+SELECT format('%I.%I', cc.schema_name, cc.table_name)::regclass
+FROM _timescaledb_catalog.hypertable h
+JOIN _timescaledb_catalog.chunk c ON c.hypertable_id = h.id
+JOIN _timescaledb_catalog.chunk cc ON cc.id = c.compressed_chunk_id
+WHERE format('%I.%I', h.schema_name, h.table_name)::regclass = ht
+$$;
+CREATE FUNCTION compressed_rows(ht regclass) RETURNS bigint
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    chunk regclass;
+    chunk_rows bigint;
+    total bigint := 0;
+BEGIN
+    FOR chunk IN SELECT compressed_chunks(ht) LOOP
+        EXECUTE format('SELECT count(*) FROM %s', chunk) INTO chunk_rows;
+        total := total + chunk_rows;
+    END LOOP;
+    RETURN total;
+END
+$$;
+-- The same rows in both tables, and the same batches in their compressed
+-- chunks
+CREATE VIEW compare_tables AS
+SELECT query_rows('SELECT * FROM wal_on') = query_rows('SELECT * FROM wal_off') AS same_rows,
+       compressed_rows('wal_on') = compressed_rows('wal_off') AS same_compressed_rows;
+
+CREATE TABLE wal_off(time int NOT NULL, device int, value float8, note text);
+SELECT table_name FROM create_hypertable('wal_off', 'time', chunk_time_interval => 10000);
+ALTER TABLE wal_off SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                          timescaledb.compress_orderby = 'time');
+CREATE TABLE wal_on(time int NOT NULL, device int, value float8, note text);
+SELECT table_name FROM create_hypertable('wal_on', 'time', chunk_time_interval => 10000);
+ALTER TABLE wal_on SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                          timescaledb.compress_orderby = 'time');
+-- Some of the compressed values are toasted
+INSERT INTO wal_off
+SELECT t, t % 10, t * 0.25,
+       CASE WHEN t % 100 = 0 THEN repeat(md5(t::text), 100) ELSE 'note ' || t % 7 END
+FROM generate_series(0, 29999) t;
+INSERT INTO wal_on SELECT * FROM wal_off;
+
+SET timescaledb.enable_compression_bulk_wal TO off;
+SELECT count(compress_chunk(c)) FROM show_chunks('wal_off') c;
+SET timescaledb.enable_compression_bulk_wal TO on;
+SELECT count(compress_chunk(c)) FROM show_chunks('wal_on') c;
+SELECT * FROM compare_tables;
+
+-- The indexes of the compressed chunks are rebuilt after the load
+SELECT count(*) AS indexes, bool_and(indisvalid AND indisready) AS valid
+FROM pg_index WHERE indrelid IN (SELECT compressed_chunks('wal_on'));
+SET enable_seqscan TO off;
+SELECT query_rows('SELECT * FROM wal_on WHERE device = 3')
+       = query_rows('SELECT * FROM wal_off WHERE device = 3') AS same_rows;
+RESET enable_seqscan;
+
+-- An abort drops the storage of the compressed chunks
+SELECT count(decompress_chunk(c)) FROM show_chunks('wal_on') c;
+BEGIN;
+SELECT count(compress_chunk(c)) FROM show_chunks('wal_on') c;
+ROLLBACK;
+SELECT count(*) FILTER (WHERE is_compressed) AS compressed_chunks
+FROM timescaledb_information.chunks WHERE hypertable_name = 'wal_on';
+SELECT query_rows('SELECT * FROM wal_on') = query_rows('SELECT * FROM wal_off') AS same_rows;
+
+SELECT count(compress_chunk(c)) FROM show_chunks('wal_on') c;
+SELECT * FROM compare_tables;
+
+-- DML on the compressed chunks uses their indexes
+INSERT INTO wal_on VALUES (5, 1, 0.5, 'new');
+INSERT INTO wal_off VALUES (5, 1, 0.5, 'new');
+UPDATE wal_on SET value = -1 WHERE device = 2 AND time < 100;
+UPDATE wal_off SET value = -1 WHERE device = 2 AND time < 100;
+DELETE FROM wal_on WHERE device = 4 AND time BETWEEN 10000 AND 10500;
+DELETE FROM wal_off WHERE device = 4 AND time BETWEEN 10000 AND 10500;
+-- Recompress the partial chunks
+SELECT count(compress_chunk(c)) FROM show_chunks('wal_on', older_than => 20000) c;
+SET timescaledb.enable_compression_bulk_wal TO off;
+SELECT count(compress_chunk(c)) FROM show_chunks('wal_off', older_than => 20000) c;
+SELECT * FROM compare_tables;
+RESET timescaledb.enable_compression_bulk_wal;
@@ -0,0 +1,108 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the direct update of the segmentby values of the compressed
+-- batches, without decompressing them.
+
+CREATE FUNCTION create_metrics(name text) RETURNS void LANGUAGE plpgsql AS
+$$
+BEGIN
+    EXECUTE format('CREATE TABLE %I(time int NOT NULL, tenant int, device int, value float)', name);
+    PERFORM create_hypertable(name::regclass, 'time', chunk_time_interval => 100);
+    EXECUTE format('ALTER TABLE %I SET (timescaledb.compress,
+                    timescaledb.compress_segmentby = ''tenant, device'',
+                    timescaledb.compress_orderby = ''time'')', name);
+    EXECUTE format('INSERT INTO %I SELECT t, d %% 2, d, t + d
+                    FROM generate_series(0, 299) t, generate_series(1, 4) d', name);
+END
+$$;
+
+-- Run the UPDATE on the relation and on a copy of its rows and compare them.
+-- Returns the row count of the UPDATE and the batch counters of EXPLAIN
+-- ANALYZE. The changes are rolled back.
+CREATE FUNCTION check_update(rel regclass, update_rest text,
+                             OUT updated bigint, OUT counters text, OUT same_result bool)
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    plan_line text;
+    lines text[] := '{}';
+BEGIN
+    BEGIN
+        EXECUTE format('CREATE TEMP TABLE expected AS SELECT * FROM %s', rel);
+        FOR plan_line IN EXECUTE format('EXPLAIN (analyze, costs off, timing off, summary off) UPDATE %s %s',
+                                        rel, update_rest) LOOP
+            IF plan_line ~ 'Batches (updated|decompressed)' THEN
+                lines := lines || trim(plan_line);
+            END IF;
+        END LOOP;
+        counters := array_to_string(lines, ', ');
+        EXECUTE format('UPDATE expected %s', update_rest);
+        EXECUTE format('SELECT NOT EXISTS (SELECT * FROM %s EXCEPT ALL TABLE expected)
+                        AND NOT EXISTS (TABLE expected EXCEPT ALL SELECT * FROM %s)', rel, rel)
+        INTO same_result;
+        RAISE EXCEPTION 'rollback' USING ERRCODE = 'ZZ001';
+    EXCEPTION WHEN SQLSTATE 'ZZ001' THEN
+    END;
+    BEGIN
+        EXECUTE format('UPDATE %s %s', rel, update_rest);
+        GET DIAGNOSTICS updated = ROW_COUNT;
+        RAISE EXCEPTION 'rollback' USING ERRCODE = 'ZZ001';
+    EXCEPTION WHEN SQLSTATE 'ZZ001' THEN
+    END;
+END
+$$;
+
+SELECT create_metrics('metrics');
+SELECT count(compress_chunk(c)) FROM show_chunks('metrics') c;
+-- The last chunk is partial
+INSERT INTO metrics SELECT t, 1, 1, 0 FROM generate_series(250, 259) t;
+SET timescaledb.enable_compressed_direct_batch_update TO on;
+
+-- The batches are updated in place, the rows of the partial chunk that are
+-- not compressed are updated by the ModifyTable
+SELECT * FROM check_update('metrics', $$SET tenant = 7 WHERE device = 1$$);
+SELECT * FROM check_update('metrics', $$SET tenant = 5, device = 9 WHERE tenant = 1 AND device = 3$$);
+SELECT * FROM check_update('metrics', $$SET tenant = NULL WHERE device = 2$$);
+
+-- The batches are decompressed when the setting is off
+SET timescaledb.enable_compressed_direct_batch_update TO off;
+SELECT * FROM check_update('metrics', $$SET tenant = 7 WHERE device = 1$$);
+SET timescaledb.enable_compressed_direct_batch_update TO on;
+
+-- The batches are decompressed when a column that is not segmentby is set,
+-- or the WHERE clause is not only on segmentby columns
+SELECT * FROM check_update('metrics', $$SET value = 0 WHERE device = 1$$);
+SELECT * FROM check_update('metrics', $$SET tenant = 7, value = 0 WHERE device = 1$$);
+SELECT * FROM check_update('metrics', $$SET tenant = 7 WHERE time < 50$$);
+-- The RETURNING list needs the rows
+SELECT * FROM check_update('metrics', $$SET tenant = 7 WHERE device = 1 RETURNING time$$);
+
+-- The row triggers need the rows
+SELECT create_metrics('metrics_trigger');
+CREATE FUNCTION keep_row() RETURNS trigger LANGUAGE plpgsql AS $$ BEGIN RETURN NEW; END $$;
+CREATE TRIGGER keep_row BEFORE UPDATE ON metrics_trigger FOR EACH ROW EXECUTE FUNCTION keep_row();
+SELECT count(compress_chunk(c)) FROM show_chunks('metrics_trigger') c;
+SELECT * FROM check_update('metrics_trigger', $$SET tenant = 7 WHERE device = 1$$);
+
+-- The new values could conflict with the other rows of a unique index
+SELECT create_metrics('metrics_unique');
+CREATE UNIQUE INDEX ON metrics_unique(time, tenant, device);
+SELECT count(compress_chunk(c)) FROM show_chunks('metrics_unique') c;
+SELECT * FROM check_update('metrics_unique', $$SET tenant = 7 WHERE device = 1$$);
+
+-- The check constraints on the updated columns have to be checked for the new
+-- values, the other check constraints don't
+SELECT create_metrics('metrics_check');
+ALTER TABLE metrics_check ADD CONSTRAINT tenant_check CHECK (tenant < 100);
+ALTER TABLE metrics_check ADD CONSTRAINT value_check CHECK (value >= 0);
+SELECT count(compress_chunk(c)) FROM show_chunks('metrics_check') c;
+SELECT * FROM check_update('metrics_check', $$SET tenant = 7 WHERE device = 1$$);
+SELECT * FROM check_update('metrics_check', $$SET device = 7 WHERE device = 1$$);
+
+RESET timescaledb.enable_compressed_direct_batch_update;
+DROP TABLE metrics;
+DROP TABLE metrics_trigger;
+DROP TABLE metrics_unique;
+DROP TABLE metrics_check;
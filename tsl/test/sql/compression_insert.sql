@@ -837,3 +837,45 @@ INSERT INTO unique_all VALUES('2024-01-01 00:04', 1, true, 1.0, 3.0, 'first', 1,
 INSERT INTO unique_all VALUES('2024-01-01 00:05', 1, true, 1.0, 1.0, 'third', 1, '{"first":true}');
 INSERT INTO unique_all VALUES('2024-01-01 00:06', 1, true, 1.0, 1.0, 'first', 3, '{"first":true}');
 INSERT INTO unique_all VALUES('2024-01-01 00:07', 1, true, 1.0, 1.0, 'first', 1, '{"third":true}');
+
+-- Test that AFTER STATEMENT triggers see the rows compressed directly
+CREATE TABLE direct_compress(time timestamptz NOT NULL, device_id int, value float);
+SELECT table_name FROM create_hypertable('direct_compress', 'time');
+ALTER TABLE direct_compress SET (tsdb.compress, tsdb.compress_segmentby = 'device_id', tsdb.compress_orderby = 'time');
+INSERT INTO direct_compress VALUES ('2024-01-01 00:00', 1, 1.0);
+SELECT count(compress_chunk(c)) FROM show_chunks('direct_compress') c;
+
+CREATE TABLE direct_compress_counts(id serial, count bigint);
+CREATE FUNCTION direct_compress_count() RETURNS trigger LANGUAGE plpgsql AS $$
+BEGIN
+  INSERT INTO direct_compress_counts(count) SELECT count(*) FROM direct_compress;
+  RETURN NULL;
+END;
+$$;
+CREATE TRIGGER direct_compress_count AFTER INSERT ON direct_compress
+FOR EACH STATEMENT EXECUTE FUNCTION direct_compress_count();
+
+SET timescaledb.enable_direct_compress_insert TO on;
+INSERT INTO direct_compress
+SELECT t, 1, 2.0 FROM generate_series('2024-01-01 00:01'::timestamptz, '2024-01-01 00:10', '1 min') t;
+COPY direct_compress FROM stdin;
+2024-01-01 00:11	1	3.0
+2024-01-01 00:12	1	3.0
+\.
+RESET timescaledb.enable_direct_compress_insert;
+
+SELECT * FROM direct_compress_counts ORDER BY id;
+
+-- The rows went to the compressed chunk, which is unordered but not partial
+SELECT c.status FROM _timescaledb_catalog.chunk c
+  JOIN _timescaledb_catalog.hypertable h ON (c.hypertable_id = h.id)
+ WHERE h.table_name = 'direct_compress';
+
+-- The compression stats include the rows compressed directly
+SELECT s.numrows_pre_compression, s.numrows_post_compression,
+       s.compressed_heap_size = pg_relation_size(format('%I.%I', cc.schema_name, cc.table_name)) AS heap_size_updated
+FROM _timescaledb_catalog.compression_chunk_size s
+  JOIN _timescaledb_catalog.chunk c ON (s.chunk_id = c.id)
+  JOIN _timescaledb_catalog.chunk cc ON (s.compressed_chunk_id = cc.id)
+  JOIN _timescaledb_catalog.hypertable h ON (c.hypertable_id = h.id)
+ WHERE h.table_name = 'direct_compress';
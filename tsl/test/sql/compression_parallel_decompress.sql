@@ -0,0 +1,97 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for decompress_chunk() with parallel workers. The parallel
+-- decompression inserts only into the heap and rebuilds the indexes of the
+-- chunk at the end, so the new files of the indexes show which path was
+-- used.
+
+CREATE TABLE decomp(time int NOT NULL, device int, value float8, note text);
+SELECT table_name FROM create_hypertable('decomp', 'time', chunk_time_interval => 50000);
+CREATE INDEX decomp_device_time_idx ON decomp(device, time);
+ALTER TABLE decomp SET (timescaledb.compress,
+                        timescaledb.compress_segmentby = 'device',
+                        timescaledb.compress_orderby = 'time');
+INSERT INTO decomp
+SELECT t, t % 10, t * 0.5, CASE WHEN t % 3 = 0 THEN NULL ELSE 'note ' || t % 100 END
+FROM generate_series(0, 99999) t;
+CREATE TABLE decomp_ref AS SELECT * FROM decomp;
+SELECT count(compress_chunk(c)) FROM show_chunks('decomp') c;
+
+SELECT show_chunks AS chunk1 FROM show_chunks('decomp') ORDER BY 1 LIMIT 1 \gset
+SELECT show_chunks AS chunk2 FROM show_chunks('decomp') ORDER BY 1 OFFSET 1 LIMIT 1 \gset
+
+-- The files of the indexes of the chunks before the decompression
+CREATE TABLE index_files AS
+SELECT indrelid AS chunk, indexrelid AS index, pg_relation_filenode(indexrelid) AS filenode
+FROM pg_index WHERE indrelid IN (SELECT show_chunks('decomp'));
+
+-- Check the rows of a decompressed chunk against the reference table, also
+-- when read through the indexes, and which of its indexes were rebuilt
+CREATE FUNCTION check_chunk(chunk regclass,
+                            OUT num_rows bigint, OUT same_rows bool, OUT same_index_rows bool,
+                            OUT valid_indexes bigint, OUT rebuilt_indexes bigint)
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    ref_query text := format('SELECT * FROM decomp_ref r WHERE EXISTS
+                             (SELECT FROM %s c WHERE c.time = r.time)', chunk);
+BEGIN
+    EXECUTE format('SELECT count(*) FROM %s', chunk) INTO num_rows;
+    EXECUTE format('SELECT NOT EXISTS (SELECT * FROM %s EXCEPT ALL %s)
+                    AND NOT EXISTS (%s EXCEPT ALL SELECT * FROM %s)',
+                   chunk, ref_query, ref_query, chunk)
+    INTO same_rows;
+    PERFORM set_config('enable_seqscan', 'off', true);
+    PERFORM set_config('enable_bitmapscan', 'off', true);
+    EXECUTE format('SELECT (SELECT array_agg(time ORDER BY time) FROM %s WHERE device = 3)
+                           = (SELECT array_agg(time ORDER BY time) FROM decomp_ref
+                              WHERE device = 3 AND time >= (SELECT min(time) FROM %s)
+                                AND time <= (SELECT max(time) FROM %s))',
+                   chunk, chunk, chunk)
+    INTO same_index_rows;
+    PERFORM set_config('enable_seqscan', 'on', true);
+    PERFORM set_config('enable_bitmapscan', 'on', true);
+    SELECT count(*) FILTER (WHERE i.indisvalid AND i.indisready),
+           count(*) FILTER (WHERE pg_relation_filenode(f.index) <> f.filenode)
+    INTO valid_indexes, rebuilt_indexes
+    FROM index_files f JOIN pg_index i ON i.indexrelid = f.index
+    WHERE f.chunk = check_chunk.chunk;
+END
+$$;
+
+SET max_parallel_maintenance_workers TO 2;
+SET timescaledb.decompression_parallel_workers TO 2;
+
+-- Force the parallel decompression also for the small test chunk
+SET min_parallel_table_scan_size TO 0;
+SELECT decompress_chunk(:'chunk1') IS NOT NULL AS decompressed;
+SELECT * FROM check_chunk(:'chunk1');
+
+-- The chunk is too small for the parallel decompression with the default
+-- setting, so it is decompressed serially and the indexes are updated
+RESET min_parallel_table_scan_size;
+SELECT decompress_chunk(:'chunk2') IS NOT NULL AS decompressed;
+SELECT * FROM check_chunk(:'chunk2');
+
+-- Compressed again and decompressed with the parallel workers disabled
+SELECT count(compress_chunk(c)) FROM show_chunks('decomp') c;
+TRUNCATE index_files;
+INSERT INTO index_files
+SELECT indrelid, indexrelid, pg_relation_filenode(indexrelid)
+FROM pg_index WHERE indrelid IN (SELECT show_chunks('decomp'));
+SET min_parallel_table_scan_size TO 0;
+SET timescaledb.decompression_parallel_workers TO 0;
+SELECT decompress_chunk(:'chunk1') IS NOT NULL AS decompressed;
+SELECT * FROM check_chunk(:'chunk1');
+
+-- All rows are back after the decompressions
+SELECT count(*), sum(value), count(note) FROM decomp;
+
+RESET min_parallel_table_scan_size;
+RESET timescaledb.decompression_parallel_workers;
+RESET max_parallel_maintenance_workers;
+DROP TABLE decomp;
+DROP TABLE decomp_ref;
+DROP TABLE index_files;
@@ -0,0 +1,90 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the compression policy with max_parallel_chunks. The workers
+-- that compress the chunks in parallel log their failures only to the
+-- server log, while the policy warns about the chunks that it compresses
+-- itself, so the warnings show which path was used.
+
+\c :TEST_DBNAME :ROLE_SUPERUSER
+\set VERBOSITY default
+\set SHOW_CONTEXT never
+SET client_min_messages TO WARNING;
+SELECT _timescaledb_functions.stop_background_workers();
+
+CREATE TABLE metrics(time int NOT NULL, device int, value float);
+SELECT table_name FROM create_hypertable('metrics', 'time', chunk_time_interval => 10);
+CREATE FUNCTION metrics_now() RETURNS int LANGUAGE SQL STABLE AS $$ SELECT 1000 $$;
+SELECT set_integer_now_func('metrics', 'metrics_now');
+ALTER TABLE metrics SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                           timescaledb.compress_orderby = 'time');
+INSERT INTO metrics SELECT t, t % 3, t FROM generate_series(0, 49) t;
+SELECT add_compression_policy('metrics', compress_after => 100) AS job_id \gset
+
+-- Decompress the chunks and mark the first chunk as compressed without
+-- having a compressed chunk, so that compressing it fails
+CREATE PROCEDURE reset_chunks() LANGUAGE plpgsql AS
+$$
+DECLARE
+    chunk regclass;
+BEGIN
+    UPDATE _timescaledb_catalog.chunk SET status = 0 WHERE table_name = '_hyper_1_1_chunk';
+    FOR chunk IN SELECT show_chunks('metrics') LOOP
+        PERFORM decompress_chunk(chunk, if_compressed => true);
+    END LOOP;
+    UPDATE _timescaledb_catalog.chunk SET status = 3 WHERE table_name = '_hyper_1_1_chunk';
+END
+$$;
+CREATE FUNCTION set_max_parallel_chunks(job_id int, value int) RETURNS jsonb LANGUAGE SQL AS
+$$
+    SELECT config->'max_parallel_chunks'
+    FROM alter_job(job_id,
+                   config => (SELECT config FROM _timescaledb_config.bgw_job WHERE id = job_id)
+                             || jsonb_build_object('max_parallel_chunks', value))
+$$;
+
+-- Negative values are rejected
+\set ON_ERROR_STOP 0
+SELECT set_max_parallel_chunks(:job_id, -1);
+\set ON_ERROR_STOP 1
+
+-- The chunks are compressed in parallel workers, and the failed chunk is
+-- counted once the other chunks are compressed
+SELECT set_max_parallel_chunks(:job_id, 2);
+CALL reset_chunks();
+\set ON_ERROR_STOP 0
+CALL run_job(:job_id);
+\set ON_ERROR_STOP 1
+SELECT table_name, status FROM _timescaledb_catalog.chunk WHERE hypertable_id = 1 ORDER BY id;
+
+-- The chunks are compressed one by one by the policy itself
+SELECT set_max_parallel_chunks(:job_id, 1);
+CALL reset_chunks();
+\set ON_ERROR_STOP 0
+CALL run_job(:job_id);
+\set ON_ERROR_STOP 1
+SELECT table_name, status FROM _timescaledb_catalog.chunk WHERE hypertable_id = 1 ORDER BY id;
+
+-- The policy compresses the chunks itself if no worker can be started
+SELECT set_max_parallel_chunks(:job_id, 2);
+CALL reset_chunks();
+SELECT debug_waitpoint_enable('bgw_job_start_helper');
+\set ON_ERROR_STOP 0
+CALL run_job(:job_id);
+\set ON_ERROR_STOP 1
+SELECT debug_waitpoint_release('bgw_job_start_helper');
+SELECT table_name, status FROM _timescaledb_catalog.chunk WHERE hypertable_id = 1 ORDER BY id;
+
+-- All chunks are compressed in parallel workers without failures
+SELECT set_max_parallel_chunks(:job_id, 3);
+CALL reset_chunks();
+UPDATE _timescaledb_catalog.chunk SET status = 0 WHERE table_name = '_hyper_1_1_chunk';
+CALL run_job(:job_id);
+SELECT table_name, status FROM _timescaledb_catalog.chunk WHERE hypertable_id = 1 ORDER BY id;
+SELECT count(*), sum(value) FROM metrics;
+
+DROP TABLE metrics;
+DROP PROCEDURE reset_chunks;
+DROP FUNCTION set_max_parallel_chunks;
+DROP FUNCTION metrics_now;
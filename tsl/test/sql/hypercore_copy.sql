@@ -95,3 +95,45 @@ copy test1 from stdin delimiter ',';
 \.
 
 select count(*) from test1;
+
+-- Hypercore TIDs can address at most 1023 rows per compressed batch, so
+-- compressing into hypercore fails with a larger batch size limit.
+create table batch_limit(created_at timestamptz not null, device_id int, temp float);
+select table_name from create_hypertable('batch_limit', 'created_at');
+alter table batch_limit set (timescaledb.compress_segmentby = 'device_id', timescaledb.compress_orderby = 'created_at');
+insert into batch_limit
+select t, 1, 1.0
+from generate_series('2022-06-01'::timestamptz, '2022-06-01'::timestamptz + interval '2499 s', '1 s') t;
+
+select format('%I.%I', chunk_schema, chunk_name)::regclass as limit_chunk
+  from timescaledb_information.chunks
+ where format('%I.%I', hypertable_schema, hypertable_name)::regclass = 'batch_limit'::regclass
+ limit 1 \gset
+
+set timescaledb.compression_batch_size_limit = 2000;
+\set ON_ERROR_STOP 0
+select compress_chunk(:'limit_chunk', hypercore_use_access_method => true);
+\set ON_ERROR_STOP 1
+
+set timescaledb.compression_batch_size_limit = 1023;
+select compress_chunk(:'limit_chunk', hypercore_use_access_method => true) is not null as compressed;
+
+select format('%I.%I', c2.schema_name, c2.table_name)::regclass as limit_cchunk
+  from _timescaledb_catalog.chunk c1
+  join _timescaledb_catalog.chunk c2 on (c1.compressed_chunk_id = c2.id)
+ where format('%I.%I', c1.schema_name, c1.table_name)::regclass = :'limit_chunk'::regclass \gset
+
+select count(*), max(_ts_meta_count), sum(_ts_meta_count) from :limit_cchunk;
+
+-- Recompression of new rows merged into the batches fails the same way
+insert into batch_limit
+select t, 1, 2.0
+from generate_series('2022-06-01'::timestamptz + interval '2500 s', '2022-06-01'::timestamptz + interval '2599 s', '1 s') t;
+
+set timescaledb.compression_batch_size_limit = 2000;
+\set ON_ERROR_STOP 0
+select compress_chunk(:'limit_chunk');
+\set ON_ERROR_STOP 1
+reset timescaledb.compression_batch_size_limit;
+
+select count(*), sum(temp) from batch_limit;
@@ -0,0 +1,124 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for merging the non-compressed rows of a hypercore into new batches
+-- when the chunk is recompressed. The partial batches of a segment are
+-- compressed again together with the new rows, the full batches are kept,
+-- and the index entries of the merged rows are inserted without rebuilding
+-- the indexes.
+\ir include/setting_compare.sql
+
+-- Run a query with a sequential scan and with an index scan, and check if the
+-- index scan uses the index and returns the same rows
+create function compare_index_scan(query text, index_name text,
+                                   out num_rows int, out index_scan bool, out same_result bool)
+language plpgsql as
+$$
+declare
+    expected text[];
+begin
+    perform set_config('enable_seqscan', 'on', true);
+    perform set_config('timescaledb.enable_columnarscan', 'on', true);
+    perform set_config('enable_indexscan', 'off', true);
+    perform set_config('enable_bitmapscan', 'off', true);
+    expected := query_rows(query);
+    num_rows := cardinality(expected);
+    perform set_config('enable_seqscan', 'off', true);
+    perform set_config('timescaledb.enable_columnarscan', 'off', true);
+    perform set_config('enable_indexscan', 'on', true);
+    index_scan := plan_contains(query, index_name);
+    same_result := query_rows(query) = expected;
+end
+$$;
+
+-- Small batches, so that the segments get both full and partial batches
+set timescaledb.compression_batch_size_limit = 250;
+
+create table merge_test(time int not null, device int, location int, value int, note text);
+select table_name from create_hypertable('merge_test', 'time', chunk_time_interval => 1000,
+                                         create_default_indexes => false);
+alter table merge_test set (timescaledb.compress,
+                              timescaledb.compress_segmentby = 'device',
+                              timescaledb.compress_orderby = 'time');
+create table merge_ref (like merge_test);
+
+create function insert_rows(first int, last int, dev int default null) returns void
+language sql as
+$$
+    insert into merge_test
+    select t, coalesce(dev, t % 3 + 1), nullif(t % 7, 0), t, 'note ' || t
+    from generate_series(first, last) t;
+    insert into merge_ref select * from merge_test where time between first and last;
+$$;
+
+-- Every device gets a partial batch of 200 rows
+select insert_rows(0, 599);
+select compress_chunk(show_chunks('merge_test'), hypercore_use_access_method => true);
+
+select format('%I.%I', c1.schema_name, c1.table_name) as chunk,
+       format('%I.%I', c2.schema_name, c2.table_name) as cchunk
+  from _timescaledb_catalog.chunk c1
+  join _timescaledb_catalog.chunk c2 on c1.compressed_chunk_id = c2.id
+  join _timescaledb_catalog.hypertable h on c1.hypertable_id = h.id
+ where h.table_name = 'merge_test' \gset
+
+-- A btree index, a segmentby index, a sparse index on the orderby column, and
+-- a partial index
+create index merge_test_value_idx on merge_test (value);
+create index merge_test_device_idx on merge_test (device);
+create index merge_test_time_idx on merge_test using hypercore_sparse (time);
+create index merge_test_location_idx on merge_test (location) where location is not null;
+
+create table index_queries(ord int, index_name text, query text);
+insert into index_queries values
+    (1, 'merge_test_value_idx', 'select * from merge_test where value between 100 and 120'),
+    (2, 'merge_test_device_idx', 'select * from merge_test where device = 2'),
+    (3, 'merge_test_device_idx', 'select * from merge_test where device = 4'),
+    (4, 'merge_test_time_idx', 'select * from merge_test where time >= 600 and time < 620'),
+    (5, 'merge_test_time_idx', 'select * from merge_test where time = 945'),
+    (6, 'merge_test_location_idx', 'select * from merge_test where location = 3');
+
+select q.index_name, c.*
+  from index_queries q, compare_index_scan(q.query, q.index_name) c
+ order by q.ord;
+
+-- The new rows are merged with the partial batch of 200 rows of every device,
+-- which gives a full batch and a partial batch of 50 rows
+select insert_rows(600, 899);
+select compress_chunk(:'chunk');
+select device, array_agg(_ts_meta_count order by _ts_meta_count desc) as batches
+  from :cchunk group by device order by device;
+select count(*) as non_compressed from merge_test
+ where not _timescaledb_debug.is_compressed_tid(ctid);
+select count(*) as differences
+  from ((table merge_test except all table merge_ref)
+        union all (table merge_ref except all table merge_test)) d;
+select q.index_name, c.*
+  from index_queries q, compare_index_scan(q.query, q.index_name) c
+ order by q.ord;
+
+create table full_batches as select ctid as tid from :cchunk where _ts_meta_count = 250;
+
+-- The new rows are merged with the partial batches of 50 rows, the full
+-- batches are not touched, and the new device gets a new batch
+select insert_rows(900, 929);
+select insert_rows(930, 949, 4);
+select compress_chunk(:'chunk');
+select device, array_agg(_ts_meta_count order by _ts_meta_count desc) as batches
+  from :cchunk group by device order by device;
+select count(*) as non_compressed from merge_test
+ where not _timescaledb_debug.is_compressed_tid(ctid);
+select count(*) as differences
+  from ((table merge_test except all table merge_ref)
+        union all (table merge_ref except all table merge_test)) d;
+select q.index_name, c.*
+  from index_queries q, compare_index_scan(q.query, q.index_name) c
+ order by q.ord;
+select count(*) as kept_full_batches from :cchunk where ctid in (select tid from full_batches);
+
+reset timescaledb.compression_batch_size_limit;
+drop table merge_test;
+drop table merge_ref;
+drop table index_queries;
+drop table full_batches;
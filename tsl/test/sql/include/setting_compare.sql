@@ -0,0 +1,54 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Helpers to check that a setting that enables an optimization changes the
+-- plan but not the result of a query.
+
+-- The sorted rows of the result of a query, as text
+CREATE OR REPLACE FUNCTION query_rows(query text) RETURNS text[]
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    r record;
+    result text[] := '{}';
+BEGIN
+    FOR r IN EXECUTE query LOOP
+        result := result || r::text;
+    END LOOP;
+    RETURN ARRAY(SELECT unnest(result) ORDER BY 1);
+END
+$$;
+
+-- Check if a line of the plan of a query contains the given text
+CREATE OR REPLACE FUNCTION plan_contains(query text, needle text) RETURNS bool
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    plan_line text;
+BEGIN
+    FOR plan_line IN EXECUTE 'EXPLAIN (costs off) ' || query LOOP
+        IF position(needle IN plan_line) > 0 THEN
+            RETURN true;
+        END IF;
+    END LOOP;
+    RETURN false;
+END
+$$;
+
+-- Run a query with a boolean setting off and on, and check if the plan with
+-- the setting on contains the given text and if the result is the same
+CREATE OR REPLACE FUNCTION compare_setting(setting text, query text, needle text,
+                                           OUT in_plan bool, OUT same_result bool)
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    expected text[];
+BEGIN
+    PERFORM set_config(setting, 'off', true);
+    expected := query_rows(query);
+    PERFORM set_config(setting, 'on', true);
+    in_plan := plan_contains(query, needle);
+    same_result := query_rows(query) = expected;
+END
+$$;
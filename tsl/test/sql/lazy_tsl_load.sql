@@ -0,0 +1,55 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for loading the TSL module on first use. Each case starts a new
+-- backend, so that its first statements are the ones that load the module.
+\c :TEST_DBNAME :ROLE_SUPERUSER
+SHOW timescaledb.enable_lazy_tsl_load;
+CREATE TABLE lazy_ht(time int NOT NULL, device int, value int);
+SELECT table_name FROM create_hypertable('lazy_ht', 'time', chunk_time_interval => 10000);
+ALTER TABLE lazy_ht SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                          timescaledb.compress_orderby = 'time');
+INSERT INTO lazy_ht SELECT t, t % 4, t % 10 FROM generate_series(0, 29999) t;
+SELECT count(compress_chunk(c)) FROM show_chunks('lazy_ht') c
+WHERE c != '_timescaledb_internal._hyper_1_3_chunk'::regclass;
+CREATE TABLE lazy_uncompressed(time int NOT NULL, device int, value int);
+SELECT table_name FROM create_hypertable('lazy_uncompressed', 'time', chunk_time_interval => 10000);
+INSERT INTO lazy_uncompressed SELECT * FROM lazy_ht;
+
+-- The session setup commands and queries that don't read any relation
+-- don't need the module, the first query that reads one loads it
+\c :TEST_DBNAME :ROLE_SUPERUSER
+BEGIN;
+SET LOCAL work_mem TO '8MB';
+SHOW work_mem;
+COMMIT;
+SELECT 1 AS one;
+SELECT stage, total_time >= 0 AS measured FROM _timescaledb_debug.init_stats();
+
+-- The first statement is a utility command that is processed by the module
+\c :TEST_DBNAME :ROLE_SUPERUSER
+ALTER TABLE lazy_uncompressed SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                                   timescaledb.compress_orderby = 'time');
+SELECT count(compress_chunk(c)) FROM show_chunks('lazy_uncompressed') c;
+
+-- The first query scans compressed chunks in parallel workers
+\c :TEST_DBNAME :ROLE_SUPERUSER
+SELECT set_config(CASE WHEN current_setting('server_version_num')::int < 160000
+                       THEN 'force_parallel_mode' ELSE 'debug_parallel_query' END, 'on', false);
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+SELECT device, count(*), sum(value) FROM lazy_ht GROUP BY device ORDER BY device;
+
+-- The first statement prepares a query on compressed chunks
+\c :TEST_DBNAME :ROLE_SUPERUSER
+PREPARE lazy_count(int) AS SELECT count(*), sum(value) FROM lazy_ht WHERE device = $1;
+EXECUTE lazy_count(1);
+DEALLOCATE lazy_count;
+
+-- The first statement inserts into a compressed chunk
+\c :TEST_DBNAME :ROLE_SUPERUSER
+INSERT INTO lazy_ht VALUES (1, 1, 1);
+SELECT device, count(*), sum(value) FROM lazy_ht WHERE time < 10 GROUP BY device ORDER BY device;
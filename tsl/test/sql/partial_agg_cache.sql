@@ -0,0 +1,88 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the cache of the per-chunk partial aggregates of compressed chunks
+\ir include/setting_compare.sql
+
+-- Run a query with the cache disabled and with the current cache size, and
+-- return the cache hits and misses of the run with the cache and if the
+-- results are the same
+CREATE FUNCTION check_cache(query text, OUT hits bigint, OUT misses bigint, OUT same_result bool)
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    cache_size text := current_setting('timescaledb.partial_agg_cache_size');
+    expected text[];
+    plan jsonb;
+BEGIN
+    PERFORM set_config('timescaledb.partial_agg_cache_size', '0', true);
+    expected := query_rows(query);
+    PERFORM set_config('timescaledb.partial_agg_cache_size', cache_size, true);
+    EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF, FORMAT JSON) ' || query INTO plan;
+    SELECT coalesce(sum((node->>'Cache Hits')::bigint), 0),
+           coalesce(sum((node->>'Cache Misses')::bigint), 0)
+    INTO hits, misses
+    FROM jsonb_path_query(plan, 'strict $.**') node
+    WHERE jsonb_typeof(node) = 'object' AND node ? 'Cache Hits';
+    same_result := query_rows(query) = expected;
+END
+$$;
+
+CREATE TABLE cache_ht(time int NOT NULL, device int, value float);
+SELECT table_name FROM create_hypertable('cache_ht', 'time', chunk_time_interval => 1000);
+ALTER TABLE cache_ht SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                           timescaledb.compress_orderby = 'time');
+INSERT INTO cache_ht SELECT t, t % 3, t FROM generate_series(0, 2999) t;
+SELECT count(compress_chunk(c)) FROM show_chunks('cache_ht') c;
+VACUUM ANALYZE cache_ht;
+SET max_parallel_workers_per_gather TO 0;
+\set query 'SELECT device, sum(value), count(*) FROM cache_ht GROUP BY device'
+
+-- The cache is disabled by default
+SELECT plan_contains(:'query', 'PartialAggCache');
+SELECT * FROM check_cache(:'query');
+
+SET timescaledb.partial_agg_cache_size TO '1MB';
+SELECT plan_contains(:'query', 'PartialAggCache');
+-- The first run computes the partial aggregates of the chunks, and the next
+-- runs use them
+SELECT * FROM check_cache(:'query');
+SELECT * FROM check_cache(:'query');
+
+-- The results depend on the quals, so another query doesn't use them
+SELECT * FROM check_cache('SELECT device, sum(value) FROM cache_ht WHERE value > 100 GROUP BY device');
+SELECT * FROM check_cache(:'query');
+
+-- Queries with volatile functions are not cached
+SELECT * FROM check_cache('SELECT device, sum(value) FROM cache_ht WHERE value > random() GROUP BY device');
+
+-- Changing the compressed data of a chunk invalidates its partial aggregates,
+-- and only the compressed part of a partially compressed chunk is cached
+DELETE FROM cache_ht WHERE time = 5;
+SELECT * FROM check_cache(:'query');
+SELECT * FROM check_cache(:'query');
+SELECT count(compress_chunk(c)) FROM show_chunks('cache_ht') c
+WHERE c = '_timescaledb_internal._hyper_1_1_chunk'::regclass;
+SELECT * FROM check_cache(:'query');
+SELECT * FROM check_cache(:'query');
+
+-- Changes in the current transaction, also when it changes the same chunk
+-- several times, and after the rollback
+BEGIN;
+UPDATE cache_ht SET value = value + 1 WHERE device = 1 AND time = 2005;
+SELECT * FROM check_cache(:'query');
+SELECT * FROM check_cache(:'query');
+UPDATE cache_ht SET value = value + 1 WHERE device = 2 AND time = 2006;
+SELECT * FROM check_cache(:'query');
+ROLLBACK;
+SELECT * FROM check_cache(:'query');
+
+-- Results that don't fit into the cache are not stored
+SET timescaledb.partial_agg_cache_size TO '1kB';
+\set query 'SELECT device, max(value), min(value) FROM cache_ht GROUP BY device'
+SELECT * FROM check_cache(:'query');
+SELECT * FROM check_cache(:'query');
+
+RESET timescaledb.partial_agg_cache_size;
+RESET max_parallel_workers_per_gather;
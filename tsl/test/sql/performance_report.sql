@@ -0,0 +1,70 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for get_performance_report()
+\c :TEST_DBNAME :ROLE_CLUSTER_SUPERUSER
+SELECT _timescaledb_functions.stop_background_workers();
+
+SELECT key FROM jsonb_object_keys(get_performance_report()) key ORDER BY key;
+
+CREATE TABLE perf_ht(time int NOT NULL, device int, value float8);
+SELECT table_name FROM create_hypertable('perf_ht', 'time', chunk_time_interval => 10000);
+ALTER TABLE perf_ht SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                          timescaledb.compress_orderby = 'time');
+INSERT INTO perf_ht SELECT t, t % 4, t % 100 FROM generate_series(0, 29999) t;
+CREATE VIEW perf_compression AS
+SELECT r->'relations'->'hypertables'->'num_relations' AS hypertables,
+       c->'chunks' AS chunks,
+       c->'compressed_chunks' AS compressed_chunks,
+       round((c->>'compressed_chunk_share')::numeric, 3) AS compressed_chunk_share,
+       c ? 'compressed_data_share' AS has_data_share,
+       (c->>'compression_ratio')::float8 > 1 AS compressed_smaller
+FROM get_performance_report() r, LATERAL (SELECT r->'hypertable_compression') h(c);
+SELECT * FROM perf_compression;
+SELECT count(compress_chunk(c)) FROM show_chunks('perf_ht') c
+WHERE c != '_timescaledb_internal._hyper_1_3_chunk'::regclass;
+SELECT * FROM perf_compression;
+SELECT jsonb_pretty(get_performance_report()->'continuous_aggregate_compression');
+
+-- The job statistics, with a late compression policy that failed last time
+-- and a custom job that crashed once
+CREATE FUNCTION perf_now() RETURNS int LANGUAGE sql STABLE AS $$ SELECT 30000 $$;
+SELECT set_integer_now_func('perf_ht', 'perf_now');
+SELECT add_compression_policy('perf_ht', compress_after => 10000) AS compress_job \gset
+CREATE PROCEDURE custom_job(job_id int, config jsonb) LANGUAGE plpgsql AS $$ BEGIN END $$;
+SELECT add_job('custom_job', '1 hour') AS custom_job \gset
+DELETE FROM _timescaledb_internal.bgw_job_stat;
+INSERT INTO _timescaledb_internal.bgw_job_stat
+VALUES (:compress_job, now() - interval '2 hours', now() - interval '2 hours',
+        now() - interval '1 hour', '-infinity', false, 4, interval '4 min', interval '1 min',
+        3, 1, 0, 1, 0),
+       (:custom_job, now() - interval '2 hours', now() - interval '2 hours', '-infinity',
+        now() - interval '2 hours', true, 2, interval '2 min', interval '0', 1, 0, 1, 0, 0);
+SELECT jsonb_pretty(get_performance_report()->'jobs'->'policy_compression'
+                    - 'max_lateness_seconds') AS compression;
+SELECT (get_performance_report()->'jobs'->'policy_compression'->>'max_lateness_seconds')::float8
+       BETWEEN 3600 AND 3900 AS lateness;
+SELECT jsonb_pretty(get_performance_report()->'jobs'->'user_defined_action') AS custom;
+
+-- The planner counts the plans that expanded a hypertable and the chunks that
+-- were left after the chunk exclusion, and the planner stages only when
+-- timescaledb.enable_planner_stats is on
+SELECT (r->'planner'->>'plans')::int AS plans, (r->'planner'->>'chunks')::int AS chunks,
+       (c->>'hits')::int + (c->>'misses')::int AS lookups, r->'planner'->'stages' AS stages
+FROM get_performance_report() r, LATERAL (SELECT r->'caches'->'hypertable_cache') h(c) \gset
+SELECT :'stages' AS stages;
+SET timescaledb.enable_planner_stats TO on;
+SELECT count(*) FROM perf_ht WHERE time < 15000;
+SELECT (r->'planner'->>'plans')::int - :plans AS plans,
+       (r->'planner'->>'chunks')::int - :chunks AS chunks,
+       (c->>'hits')::int + (c->>'misses')::int > :lookups AS cache_used,
+       (c->>'hit_ratio')::float8 BETWEEN 0 AND 1 AS hit_ratio,
+       r->'planner'->'stages' ?& '{planner, expansion}' AS stages
+FROM get_performance_report() r, LATERAL (SELECT r->'caches'->'hypertable_cache') h(c);
+RESET timescaledb.enable_planner_stats;
+
+SELECT jsonb_typeof(r->'lock_waits') AS lock_waits,
+       (SELECT bool_and((v->>'total_bytes')::bigint >= 0) FROM jsonb_each(r->'memory') e(k, v))
+           AS memory
+FROM get_performance_report() r;
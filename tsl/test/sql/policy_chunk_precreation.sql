@@ -0,0 +1,96 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the chunk precreation policy
+\c :TEST_DBNAME :ROLE_CLUSTER_SUPERUSER
+SELECT _timescaledb_functions.stop_background_workers();
+SET ROLE :ROLE_DEFAULT_PERM_USER;
+\set VERBOSITY default
+
+CREATE TABLE now_value(value int);
+INSERT INTO now_value VALUES (25);
+CREATE FUNCTION precreate_now() RETURNS int LANGUAGE SQL STABLE AS $$ SELECT value FROM now_value $$;
+CREATE TABLE precreate(time int NOT NULL, device int, value float);
+SELECT table_name FROM create_hypertable('precreate', 'time', chunk_time_interval => 10);
+
+-- Integer time dimensions need an integer_now function
+\set ON_ERROR_STOP 0
+SELECT add_chunk_precreation_policy('precreate');
+\set ON_ERROR_STOP 1
+SELECT set_integer_now_func('precreate', 'precreate_now');
+\set ON_ERROR_STOP 0
+SELECT add_chunk_precreation_policy('precreate', chunks_ahead => 0);
+\set ON_ERROR_STOP 1
+SELECT add_chunk_precreation_policy('precreate') AS job_id \gset
+SELECT application_name, schedule_interval, config FROM _timescaledb_config.bgw_job WHERE id = :job_id;
+
+-- Adding the policy again
+\set ON_ERROR_STOP 0
+SELECT add_chunk_precreation_policy('precreate');
+\set ON_ERROR_STOP 1
+SELECT add_chunk_precreation_policy('precreate', if_not_exists => true);
+SELECT add_chunk_precreation_policy('precreate', chunks_ahead => 3, if_not_exists => true);
+
+-- Invalid configurations
+\set ON_ERROR_STOP 0
+SELECT config FROM alter_job(:job_id, config => '{"hypertable_id": 1, "chunks_ahead": 0}');
+SELECT config FROM alter_job(:job_id, config => '{"hypertable_id": 100, "chunks_ahead": 1}');
+\set ON_ERROR_STOP 1
+
+-- The job creates the chunk of the current time and the two chunks after it
+SELECT range_start_integer, range_end_integer FROM timescaledb_information.chunks
+WHERE hypertable_name = 'precreate' ORDER BY 1;
+CALL run_job(:job_id);
+SELECT range_start_integer, range_end_integer FROM timescaledb_information.chunks
+WHERE hypertable_name = 'precreate' ORDER BY 1;
+
+-- Running the job again or inserting into the chunks creates no more chunks
+CALL run_job(:job_id);
+INSERT INTO precreate SELECT t, t % 4, t FROM generate_series(20, 49) t;
+SELECT count(*) FROM show_chunks('precreate');
+
+-- Only the missing chunks are created when the time moves on
+UPDATE now_value SET value = 45;
+CALL run_job(:job_id);
+SELECT range_start_integer, range_end_integer FROM timescaledb_information.chunks
+WHERE hypertable_name = 'precreate' ORDER BY 1;
+
+-- On space-partitioned hypertables, the chunks are created for all the
+-- partitions
+CREATE TABLE precreate_space(time int NOT NULL, device int, value float);
+SELECT table_name FROM create_hypertable('precreate_space', 'time', chunk_time_interval => 10);
+SELECT table_name FROM add_dimension('precreate_space', 'device', number_partitions => 2);
+SELECT set_integer_now_func('precreate_space', 'precreate_now');
+SELECT add_chunk_precreation_policy('precreate_space', chunks_ahead => 1) AS space_job_id \gset
+CALL run_job(:space_job_id);
+SELECT range_start_integer, range_end_integer, count(*) FROM timescaledb_information.chunks
+WHERE hypertable_name = 'precreate_space' GROUP BY 1, 2 ORDER BY 1;
+INSERT INTO precreate_space SELECT t, d, t FROM generate_series(40, 59) t, generate_series(1, 8) d;
+SELECT count(*) FROM show_chunks('precreate_space');
+
+-- Timestamp dimensions use the current time, and the job runs twice per chunk
+-- interval by default
+CREATE TABLE precreate_tz(time timestamptz NOT NULL, value float);
+SELECT table_name FROM create_hypertable('precreate_tz', 'time', chunk_time_interval => interval '1 day');
+SELECT add_chunk_precreation_policy('precreate_tz') AS tz_job_id \gset
+SELECT schedule_interval FROM _timescaledb_config.bgw_job WHERE id = :tz_job_id;
+CALL run_job(:tz_job_id);
+SELECT count(*), min(range_start) <= now() AS covers_now FROM timescaledb_information.chunks
+WHERE hypertable_name = 'precreate_tz';
+
+-- The future values of additional open dimensions are unknown
+CREATE TABLE precreate_multi(time int NOT NULL, time2 int NOT NULL);
+SELECT table_name FROM create_hypertable('precreate_multi', 'time', chunk_time_interval => 10);
+SELECT table_name FROM add_dimension('precreate_multi', 'time2', chunk_time_interval => 10);
+\set ON_ERROR_STOP 0
+SELECT add_chunk_precreation_policy('precreate_multi');
+\set ON_ERROR_STOP 1
+
+-- Removing the policy
+SELECT remove_chunk_precreation_policy('precreate');
+SELECT count(*) FROM _timescaledb_config.bgw_job WHERE id = :job_id;
+\set ON_ERROR_STOP 0
+SELECT remove_chunk_precreation_policy('precreate');
+\set ON_ERROR_STOP 1
+SELECT remove_chunk_precreation_policy('precreate', if_exists => true);
@@ -0,0 +1,75 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the merge chunks policy
+\c :TEST_DBNAME :ROLE_CLUSTER_SUPERUSER
+SELECT _timescaledb_functions.stop_background_workers();
+SET ROLE :ROLE_DEFAULT_PERM_USER;
+\set VERBOSITY default
+
+CREATE FUNCTION merge_now() RETURNS int LANGUAGE SQL STABLE AS $$ SELECT 100 $$;
+CREATE TABLE merge_ht(time int NOT NULL, device int, value float);
+SELECT table_name FROM create_hypertable('merge_ht', 'time', chunk_time_interval => 10);
+
+-- Integer time dimensions need an integer_now function
+\set ON_ERROR_STOP 0
+SELECT add_merge_chunks_policy('merge_ht', '1MB');
+\set ON_ERROR_STOP 1
+SELECT set_integer_now_func('merge_ht', 'merge_now');
+\set ON_ERROR_STOP 0
+SELECT add_merge_chunks_policy('merge_ht', '0');
+\set ON_ERROR_STOP 1
+SELECT add_merge_chunks_policy('merge_ht', '1MB') AS job_id \gset
+SELECT application_name, schedule_interval, config FROM _timescaledb_config.bgw_job WHERE id = :job_id;
+
+-- Adding the policy again
+\set ON_ERROR_STOP 0
+SELECT add_merge_chunks_policy('merge_ht', '1MB');
+\set ON_ERROR_STOP 1
+SELECT add_merge_chunks_policy('merge_ht', '1MB', if_not_exists => true);
+SELECT add_merge_chunks_policy('merge_ht', '2MB', if_not_exists => true);
+
+-- Invalid configurations
+\set ON_ERROR_STOP 0
+SELECT config FROM alter_job(:job_id, config => '{"hypertable_id": 1, "target_size": -1}');
+SELECT config FROM alter_job(:job_id, config => '{"hypertable_id": 100, "target_size": 1}');
+\set ON_ERROR_STOP 1
+
+-- Small chunks from 0 to 60, a chunk from 60 to 70 that is larger than the
+-- target size, small chunks from 70 to 90 and a chunk from 100 to 110 that
+-- ends after the current time. The chunks from 20 to 40 are compressed.
+INSERT INTO merge_ht SELECT t, t % 3, t FROM generate_series(0, 59) t;
+INSERT INTO merge_ht SELECT 60 + t % 10, t % 3, t FROM generate_series(1, 50000) t;
+INSERT INTO merge_ht SELECT t, t % 3, t FROM generate_series(70, 89) t;
+INSERT INTO merge_ht SELECT t, t % 3, t FROM generate_series(100, 105) t;
+ALTER TABLE merge_ht SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                          timescaledb.compress_orderby = 'time');
+SELECT count(compress_chunk(c)) FROM show_chunks('merge_ht') c
+WHERE c IN ('_timescaledb_internal._hyper_1_3_chunk', '_timescaledb_internal._hyper_1_4_chunk');
+CREATE TABLE merge_ht_ref AS SELECT * FROM merge_ht;
+
+SELECT chunk_name, range_start_integer, range_end_integer, is_compressed
+FROM timescaledb_information.chunks WHERE hypertable_name = 'merge_ht' ORDER BY 2;
+
+-- The adjacent small chunks are merged, but compressed chunks are not merged
+-- with uncompressed chunks
+CALL run_job(:job_id);
+SELECT chunk_name, range_start_integer, range_end_integer, is_compressed
+FROM timescaledb_information.chunks WHERE hypertable_name = 'merge_ht' ORDER BY 2;
+SELECT count(*) AS num_rows,
+       (SELECT count(*) FROM (SELECT * FROM merge_ht EXCEPT ALL SELECT * FROM merge_ht_ref) d) AS num_different
+FROM merge_ht;
+
+-- Running the job again merges nothing
+CALL run_job(:job_id);
+SELECT chunk_name, range_start_integer, range_end_integer, is_compressed
+FROM timescaledb_information.chunks WHERE hypertable_name = 'merge_ht' ORDER BY 2;
+
+-- Removing the policy
+SELECT remove_merge_chunks_policy('merge_ht');
+SELECT count(*) FROM _timescaledb_config.bgw_job WHERE id = :job_id;
+\set ON_ERROR_STOP 0
+SELECT remove_merge_chunks_policy('merge_ht');
+\set ON_ERROR_STOP 1
+SELECT remove_merge_chunks_policy('merge_ht', if_exists => true);
@@ -0,0 +1,80 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the job that applies the retention policies of many
+-- hypertables, which are not scheduled themselves
+\c :TEST_DBNAME :ROLE_CLUSTER_SUPERUSER
+SELECT _timescaledb_functions.stop_background_workers();
+SET ROLE :ROLE_DEFAULT_PERM_USER;
+\set VERBOSITY default
+
+CREATE FUNCTION ret_now() RETURNS int LANGUAGE SQL STABLE AS $$ SELECT 100 $$;
+CREATE TABLE ret_a(time int NOT NULL, value float);
+CREATE TABLE ret_b(time int NOT NULL, value float);
+CREATE TABLE ret_c(time int NOT NULL, value float);
+SELECT table_name FROM create_hypertable('ret_a', 'time', chunk_time_interval => 10);
+SELECT table_name FROM create_hypertable('ret_b', 'time', chunk_time_interval => 10);
+SELECT table_name FROM create_hypertable('ret_c', 'time', chunk_time_interval => 10);
+SELECT count(set_integer_now_func(ht, 'ret_now')) FROM unnest('{ret_a,ret_b,ret_c}'::regclass[]) ht;
+INSERT INTO ret_a SELECT t, t FROM generate_series(0, 99) t;
+INSERT INTO ret_b SELECT t, t FROM generate_series(0, 99) t;
+INSERT INTO ret_c SELECT t, t FROM generate_series(0, 99) t;
+
+-- A continuous aggregate on one of the hypertables, to see the invalidations
+-- of the dropped chunks
+CREATE MATERIALIZED VIEW ret_a_cagg WITH (timescaledb.continuous) AS
+SELECT time_bucket(10, time) AS bucket, count(*) FROM ret_a GROUP BY 1 WITH NO DATA;
+CALL refresh_continuous_aggregate('ret_a_cagg', NULL, NULL);
+
+-- The policies of ret_a and ret_b are applied by the batch job, the policy of
+-- ret_c is scheduled itself
+SELECT add_retention_policy('ret_a', drop_after => 50) AS job_a \gset
+SELECT add_retention_policy('ret_b', drop_after => 30) AS job_b \gset
+SELECT add_retention_policy('ret_c', drop_after => 80) AS job_c \gset
+SELECT job_id, scheduled FROM alter_job(:job_a, scheduled => false);
+SELECT job_id, scheduled FROM alter_job(:job_b, scheduled => false);
+
+-- Negative batch sizes are rejected
+\set ON_ERROR_STOP 0
+SELECT add_job('_timescaledb_functions.policy_retention_batch', '1 hour',
+               config => '{"max_chunks_per_batch": -1}',
+               check_config => '_timescaledb_functions.policy_retention_batch_check');
+\set ON_ERROR_STOP 1
+SELECT add_job('_timescaledb_functions.policy_retention_batch', '1 hour',
+               config => '{"max_chunks_per_batch": 4}',
+               check_config => '_timescaledb_functions.policy_retention_batch_check') AS batch_job \gset
+
+SELECT hypertable_name, count(*), min(range_start_integer) FROM timescaledb_information.chunks
+WHERE hypertable_name IN ('ret_a', 'ret_b', 'ret_c') GROUP BY 1 ORDER BY 1;
+SELECT lowest_modified_value, greatest_modified_value
+FROM _timescaledb_catalog.continuous_aggs_hypertable_invalidation_log
+WHERE hypertable_id = 1;
+
+-- The batch job commits after dropping the chunks of ret_a, which are more
+-- than max_chunks_per_batch, and then drops the chunks of ret_b. The
+-- chunks of ret_c are kept.
+CALL run_job(:batch_job);
+SELECT hypertable_name, count(*), min(range_start_integer) FROM timescaledb_information.chunks
+WHERE hypertable_name IN ('ret_a', 'ret_b', 'ret_c') GROUP BY 1 ORDER BY 1;
+
+-- The ranges of the adjacent dropped chunks are added to the invalidation log
+-- as one entry
+SELECT lowest_modified_value, greatest_modified_value
+FROM _timescaledb_catalog.continuous_aggs_hypertable_invalidation_log
+WHERE hypertable_id = 1;
+
+-- Running the batch job again drops nothing
+CALL run_job(:batch_job);
+SELECT hypertable_name, count(*), min(range_start_integer) FROM timescaledb_information.chunks
+WHERE hypertable_name IN ('ret_a', 'ret_b', 'ret_c') GROUP BY 1 ORDER BY 1;
+
+-- The batch job in one transaction, and the policies that are scheduled
+-- again, which are no longer in the batch
+SELECT job_id, scheduled FROM alter_job(:job_b, scheduled => true);
+SELECT job_id, scheduled FROM alter_job(:job_c, scheduled => false);
+SELECT config FROM alter_job(:batch_job, config => '{"max_chunks_per_batch": 0}');
+INSERT INTO ret_b SELECT t, t FROM generate_series(0, 19) t;
+CALL run_job(:batch_job);
+SELECT hypertable_name, count(*), min(range_start_integer) FROM timescaledb_information.chunks
+WHERE hypertable_name IN ('ret_a', 'ret_b', 'ret_c') GROUP BY 1 ORDER BY 1;
@@ -0,0 +1,96 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for quantile_sketch() and its vectorized implementation
+\ir include/setting_compare.sql
+
+CREATE TABLE sketch_ht(time int NOT NULL, device int, v float8);
+SELECT table_name FROM create_hypertable('sketch_ht', 'time', chunk_time_interval => 10000);
+ALTER TABLE sketch_ht SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                            timescaledb.compress_orderby = 'time');
+-- Negative, zero and positive values over eight orders of magnitude, each
+-- repeated 30 times
+INSERT INTO sketch_ht
+SELECT t, t % 4,
+       CASE WHEN t % 1000 % 7 = 0 THEN 0
+            WHEN t % 1000 % 3 = 0 THEN -exp(t % 1000 / 47.0)
+            ELSE exp(t % 1000 / 47.0) END
+FROM generate_series(0, 29999) t;
+-- The last chunk stays uncompressed
+SELECT count(compress_chunk(c)) FROM show_chunks('sketch_ht') c
+WHERE c != '_timescaledb_internal._hyper_1_3_chunk'::regclass;
+ANALYZE sketch_ht;
+SET max_parallel_workers_per_gather TO 0;
+
+-- The estimates are within 1% of the exact values, up to the rounding
+SELECT fraction,
+       abs(approx_quantile(sketch, fraction) - exact) <= 0.0101 * abs(exact) AS within_error
+FROM (SELECT quantile_sketch(v) AS sketch FROM sketch_ht) s,
+     (SELECT fraction, percentile_disc(fraction) WITHIN GROUP (ORDER BY v) AS exact
+      FROM unnest('{0, 0.01, 0.25, 0.5, 0.75, 0.9, 0.99, 1}'::float8[]) fraction, sketch_ht
+      GROUP BY fraction) e
+ORDER BY fraction;
+
+-- The range of a sketch is limited, so the lowest values are collapsed when
+-- the values span too many orders of magnitude. The high quantiles and the
+-- extremes are still accurate.
+CREATE TABLE sketch_wide AS SELECT ('1e' || k)::float8 AS v FROM generate_series(-200, 200) k;
+SELECT fraction,
+       abs(approx_quantile(sketch, fraction) - exact) <= 0.0101 * abs(exact) AS within_error
+FROM (SELECT quantile_sketch(v) AS sketch FROM sketch_wide) s,
+     (SELECT fraction, percentile_disc(fraction) WITHIN GROUP (ORDER BY v) AS exact
+      FROM unnest('{0, 0.5, 0.99, 1}'::float8[]) fraction, sketch_wide
+      GROUP BY fraction) e
+ORDER BY fraction;
+
+-- No rows and only null values
+SELECT (SELECT quantile_sketch(v) FROM sketch_ht WHERE v > 1e100) IS NULL AS no_rows,
+       (SELECT quantile_sketch(x) FROM (VALUES (NULL::float8)) v(x)) IS NULL AS only_nulls;
+
+\set ON_ERROR_STOP 0
+SELECT approx_quantile(quantile_sketch(v), 1.5) FROM sketch_ht;
+SELECT quantile_sketch(x) FROM (VALUES (1::float8), ('NaN'), (2)) v(x);
+SELECT approx_quantile('\x0102'::bytea, 0.5);
+\set ON_ERROR_STOP 1
+
+-- The merge is exact, so the rollup of the stored sketches is the same as the
+-- sketch of all the values
+CREATE TABLE sketches AS
+SELECT time / 1000 AS bucket, device, quantile_sketch(v) AS sketch
+FROM sketch_ht GROUP BY 1, 2;
+SELECT (SELECT quantile_sketch_rollup(sketch) FROM sketches)
+       = (SELECT quantile_sketch(v) FROM sketch_ht) AS same_sketch;
+SELECT device, approx_quantile(quantile_sketch_rollup(sketch), 0.5)
+       = (SELECT approx_quantile(quantile_sketch(v), 0.5) FROM sketch_ht h
+          WHERE h.device = s.device) AS same_median
+FROM sketches s GROUP BY device ORDER BY device;
+
+-- The vectorized aggregation computes the same sketches
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT quantile_sketch(v) FROM sketch_ht
+$$, 'VectorAgg');
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, quantile_sketch(v) FROM sketch_ht GROUP BY device
+$$, 'VectorAgg');
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, quantile_sketch(v) FROM sketch_ht WHERE v < 100 GROUP BY device
+$$, 'VectorAgg');
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, quantile_sketch(v) FILTER (WHERE v > 0),
+       quantile_sketch(v) FILTER (WHERE v > 1e100)
+FROM sketch_ht GROUP BY device
+$$, 'VectorAgg');
+
+-- The partial sketches of the parallel workers are combined in the same way
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+SELECT * FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, quantile_sketch(v) FROM sketch_ht GROUP BY device
+$$, 'VectorAgg');
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
@@ -0,0 +1,112 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the runtime join filters on the probe side of hash joins
+\ir include/setting_compare.sql
+
+CREATE TABLE fact(time int NOT NULL, device int, metric int, value float);
+SELECT table_name FROM create_hypertable('fact', 'time', chunk_time_interval => 1000);
+ALTER TABLE fact SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                         timescaledb.compress_orderby = 'time');
+INSERT INTO fact SELECT t, d, (t + d) % 100, t % 7 FROM generate_series(0, 2999) t, generate_series(1, 10) d;
+SELECT count(compress_chunk(c)) FROM show_chunks('fact') c;
+CREATE TABLE dim(id int PRIMARY KEY, name text, region int);
+INSERT INTO dim SELECT i, 'dev' || i, i % 3 FROM generate_series(1, 200) i;
+ANALYZE fact, dim;
+
+SET max_parallel_workers_per_gather TO 0;
+SET enable_mergejoin TO off;
+SET enable_nestloop TO off;
+
+-- Inner join on a segmentby column
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT d.name, count(*), sum(f.value)
+FROM fact f JOIN dim d ON f.device = d.id
+WHERE d.region = 1 GROUP BY d.name
+$$, 'RuntimeFilter');
+-- Inner join on a compressed column, with few and many distinct keys
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT count(*), sum(f.value)
+FROM fact f JOIN dim d ON f.metric = d.id
+WHERE d.id % 10 = 0
+$$, 'RuntimeFilter');
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT count(*), sum(f.value)
+FROM fact f JOIN dim d ON f.metric = d.id
+WHERE d.id > 20
+$$, 'RuntimeFilter');
+
+-- Semi join
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT count(*), sum(value)
+FROM fact WHERE device IN (SELECT id FROM dim WHERE region = 2)
+$$, 'RuntimeFilter');
+
+-- Right join, which preserves the hashed side. The keys without matches
+-- are in the result.
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT d.id, count(f.time)
+FROM dim d LEFT JOIN fact f ON f.device = d.id
+WHERE d.id <= 12 GROUP BY d.id
+$$, 'RuntimeFilter');
+
+-- Left join, which preserves the probe side, is not filtered
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT count(*), count(d.id)
+FROM fact f LEFT JOIN dim d ON f.device = d.id AND d.region = 1
+$$, 'RuntimeFilter');
+
+-- Empty hashed side
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT count(*)
+FROM fact f JOIN dim d ON f.device = d.id
+WHERE d.name = 'none'
+$$, 'RuntimeFilter');
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT d.id, count(f.time)
+FROM dim d LEFT JOIN fact f ON f.device = d.id
+WHERE d.name = 'none' GROUP BY d.id
+$$, 'RuntimeFilter');
+
+-- Rescans of the probe side, with or without parameters. The hash table is
+-- reused, and so is the filter.
+SET enable_material TO off;
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT g, s.cnt
+FROM generate_series(1, 3) g,
+     LATERAL (SELECT count(*) AS cnt FROM fact f JOIN dim d ON f.device = d.id
+              WHERE d.region = 1) s
+$$, 'RuntimeFilter');
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT g, (SELECT count(*) FROM fact f JOIN dim d ON f.device = d.id
+           WHERE d.region = 1 AND f.time < g * 1000)
+FROM generate_series(1, 3) g
+$$, 'RuntimeFilter');
+RESET enable_material;
+
+-- A hashed side that depends on parameters is not filtered, because the
+-- hash table is rebuilt when the probe side might have read a batch already
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT r, (SELECT count(*) FROM fact f JOIN dim d ON f.device = d.id WHERE d.region = r)
+FROM generate_series(0, 2) r
+$$, 'RuntimeFilter');
+
+-- Hypercore tables, which are read with ColumnarScan instead of
+-- DecompressChunk, are not filtered
+CREATE TABLE fact_hypercore(time int NOT NULL, device int, metric int, value float);
+SELECT table_name FROM create_hypertable('fact_hypercore', 'time', chunk_time_interval => 1000);
+ALTER TABLE fact_hypercore SET (timescaledb.compress_segmentby = 'device',
+                                   timescaledb.compress_orderby = 'time');
+INSERT INTO fact_hypercore SELECT * FROM fact;
+SELECT count(compress_chunk(c, hypercore_use_access_method => true))
+FROM show_chunks('fact_hypercore') c;
+SELECT * FROM compare_setting('timescaledb.enable_runtime_join_filters', $$
+SELECT d.name, count(*), sum(f.value)
+FROM fact_hypercore f JOIN dim d ON f.device = d.id
+WHERE d.region = 1 GROUP BY d.name
+$$, 'RuntimeFilter');
+
+RESET enable_nestloop;
+RESET enable_mergejoin;
+RESET max_parallel_workers_per_gather;
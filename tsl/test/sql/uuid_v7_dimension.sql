@@ -0,0 +1,120 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for UUIDv7 columns as open dimensions
+SET timezone TO UTC;
+
+SELECT _timescaledb_functions.uuid_v7_from_timestamptz('2024-01-01 00:00:00+00') AS lowest,
+       _timescaledb_functions.timestamptz_from_uuid_v7(
+           '018cc251-f400-7000-8000-000000000000') AS ts;
+-- The timestamps are truncated to milliseconds
+SELECT _timescaledb_functions.timestamptz_from_uuid_v7(
+           _timescaledb_functions.uuid_v7_from_timestamptz('2024-05-06 07:08:09.123456+00')) AS ts;
+SELECT _timescaledb_functions.timestamptz_from_uuid_v7(_timescaledb_functions.generate_uuid_v7())
+       BETWEEN now() - interval '1 minute' AND now() + interval '1 minute' AS current;
+\set ON_ERROR_STOP 0
+SELECT _timescaledb_functions.timestamptz_from_uuid_v7('00000000-0000-4000-8000-000000000000');
+SELECT _timescaledb_functions.uuid_v7_from_timestamptz('1969-12-31 23:59:59+00');
+SELECT _timescaledb_functions.uuid_v7_from_timestamptz('infinity');
+\set ON_ERROR_STOP 1
+
+-- The number of chunks in the plan and the number of rows of a query
+CREATE FUNCTION check_query(query text, OUT chunks int, OUT num_rows bigint)
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    plan_line text;
+    names text[] := '{}';
+BEGIN
+    FOR plan_line IN EXECUTE 'EXPLAIN (costs off) ' || query LOOP
+        names := names || ARRAY(SELECT m[1]
+                                FROM regexp_matches(plan_line, '\m(_hyper_1_\d+_chunk)', 'g') m);
+    END LOOP;
+    SELECT count(DISTINCT n) INTO chunks FROM unnest(names) n;
+    EXECUTE 'SELECT count(*) FROM (' || query || ') q' INTO num_rows;
+END
+$$;
+
+-- An open dimension on a uuid column is partitioned on the timestamp of the
+-- UUIDv7 values
+CREATE TABLE uuid_ht(id uuid NOT NULL, device int, value float8);
+SELECT table_name FROM create_hypertable('uuid_ht', 'id', chunk_time_interval => interval '1 day');
+SELECT column_name, column_type, interval_length, partitioning_func
+FROM _timescaledb_catalog.dimension;
+INSERT INTO uuid_ht
+SELECT _timescaledb_functions.uuid_v7_from_timestamptz(ts), extract(hour FROM ts)::int % 3, 1
+FROM generate_series('2024-01-01 00:00:00+00'::timestamptz, '2024-01-05 23:00:00+00', '1 hour') ts;
+SELECT count(*) FROM show_chunks('uuid_ht');
+\set ON_ERROR_STOP 0
+INSERT INTO uuid_ht VALUES ('00000000-0000-4000-8000-000000000000', 1, 1);
+\set ON_ERROR_STOP 1
+
+-- Chunk exclusion
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht
+WHERE id >= _timescaledb_functions.uuid_v7_from_timestamptz('2024-01-04 00:00:00+00')
+$$);
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht
+WHERE id BETWEEN _timescaledb_functions.uuid_v7_from_timestamptz('2024-01-02 12:00:00+00')
+           AND _timescaledb_functions.uuid_v7_from_timestamptz('2024-01-03 12:00:00+00')
+$$);
+-- A strict inequality on the column is not strict for the timestamps,
+-- because all the values of a millisecond have the same timestamp
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht
+WHERE id < _timescaledb_functions.uuid_v7_from_timestamptz('2024-01-02 00:00:00+00')
+$$);
+-- Predicates on the timestamps
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht
+WHERE _timescaledb_functions.timestamptz_from_uuid_v7(id) >= '2024-01-05 00:00:00+00'
+$$);
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht
+WHERE _timescaledb_functions.timestamptz_from_uuid_v7(id) < '2024-01-02 00:00:00+00'
+$$);
+-- Other UUID versions are not used for the chunk exclusion
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht WHERE id > '00000000-0000-4000-8000-000000000000'
+$$);
+
+-- The batch metadata of the compressed chunks is ordered by the timestamps
+ALTER TABLE uuid_ht SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                          timescaledb.compress_orderby = 'id');
+SELECT count(compress_chunk(c)) FROM show_chunks('uuid_ht') c;
+-- Chunk exclusion on the compressed chunks
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht
+WHERE id >= _timescaledb_functions.uuid_v7_from_timestamptz('2024-01-04 00:00:00+00')
+$$);
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht
+WHERE id BETWEEN _timescaledb_functions.uuid_v7_from_timestamptz('2024-01-02 12:00:00+00')
+           AND _timescaledb_functions.uuid_v7_from_timestamptz('2024-01-03 12:00:00+00')
+$$);
+-- A strict inequality on the column is not strict for the timestamps,
+-- because all the values of a millisecond have the same timestamp
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht
+WHERE id < _timescaledb_functions.uuid_v7_from_timestamptz('2024-01-02 00:00:00+00')
+$$);
+-- Predicates on the timestamps
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht
+WHERE _timescaledb_functions.timestamptz_from_uuid_v7(id) >= '2024-01-05 00:00:00+00'
+$$);
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht
+WHERE _timescaledb_functions.timestamptz_from_uuid_v7(id) < '2024-01-02 00:00:00+00'
+$$);
+-- Other UUID versions are not used for the chunk exclusion
+SELECT * FROM check_query($$
+SELECT * FROM uuid_ht WHERE id > '00000000-0000-4000-8000-000000000000'
+$$);
+SELECT _timescaledb_functions.timestamptz_from_uuid_v7(id) AS ts FROM uuid_ht
+WHERE id > _timescaledb_functions.uuid_v7_from_timestamptz('2024-01-03 21:00:00+00')
+ORDER BY id LIMIT 3;
+
+RESET timezone;
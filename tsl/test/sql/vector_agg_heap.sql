@@ -0,0 +1,198 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the vectorized aggregation over the uncompressed heap chunks
+\ir include/setting_compare.sql
+
+-- The number of VectorAgg nodes in the plan of a query
+CREATE FUNCTION vector_aggs(query text) RETURNS int
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    plan_line text;
+    result int := 0;
+BEGIN
+    FOR plan_line IN EXECUTE 'EXPLAIN (costs off) ' || query LOOP
+        IF position('VectorAgg' IN plan_line) > 0 THEN
+            result := result + 1;
+        END IF;
+    END LOOP;
+    RETURN result;
+END
+$$;
+
+-- Run a query with the heap vectorized aggregation off and on, and check if
+-- more partial aggregations are vectorized with it on and if the result is the
+-- same. The compressed chunks use VectorAgg in both cases.
+CREATE FUNCTION check_heap_agg(query text, OUT heap_vectorized bool, OUT same_result bool)
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    expected text[];
+    vector_aggs_off int;
+BEGIN
+    PERFORM set_config('timescaledb.enable_heap_vectorized_aggregation', 'off', true);
+    expected := query_rows(query);
+    vector_aggs_off := vector_aggs(query);
+    PERFORM set_config('timescaledb.enable_heap_vectorized_aggregation', 'on', true);
+    heap_vectorized := vector_aggs(query) > vector_aggs_off;
+    same_result := query_rows(query) = expected;
+END
+$$;
+
+CREATE TABLE heap_agg(time int NOT NULL, device int, value int, big bigint, measure float8,
+                      tag text, amount numeric, nothing int);
+SELECT table_name FROM create_hypertable('heap_agg', 'time', chunk_time_interval => 10000);
+INSERT INTO heap_agg
+SELECT t, t % 10,
+       CASE WHEN t % 13 = 0 THEN NULL ELSE t % 1000 END,
+       t::bigint * 1000,
+       t / 7.0,
+       CASE WHEN t % 11 = 0 THEN NULL ELSE 'tag' || t % 5 END,
+       t % 100,
+       NULL
+FROM generate_series(0, 29999) t;
+
+-- The same data in a hypertable without compressed chunks
+CREATE TABLE heap_plain(LIKE heap_agg);
+SELECT table_name FROM create_hypertable('heap_plain', 'time', chunk_time_interval => 10000);
+INSERT INTO heap_plain SELECT * FROM heap_agg;
+
+-- Compress all but the last chunk, and add some uncompressed rows to the first
+-- one, so that the hypertable has compressed, partially compressed and heap
+-- chunks
+ALTER TABLE heap_agg SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                          timescaledb.compress_orderby = 'time');
+SELECT count(compress_chunk(c)) FROM show_chunks('heap_agg') c
+WHERE c <> '_timescaledb_internal._hyper_1_3_chunk'::regclass;
+INSERT INTO heap_agg
+SELECT t, t % 10, t % 1000, t::bigint * 1000, t / 7.0, 'new' || t % 3, t % 100, NULL
+FROM generate_series(5, 9995, 10) t;
+ANALYZE heap_agg, heap_plain;
+
+SET max_parallel_workers_per_gather TO 0;
+
+-- Aggregates without grouping
+SELECT * FROM check_heap_agg($$
+SELECT count(*), count(value), sum(value), sum(big), min(measure), max(measure), avg(measure)
+FROM heap_agg
+$$);
+-- Aggregates over a column with only NULLs
+SELECT * FROM check_heap_agg($$
+SELECT count(nothing), sum(nothing), min(nothing) FROM heap_agg
+$$);
+
+-- Grouping by an integer column, which is the segmentby column in the
+-- compressed chunks
+SELECT * FROM check_heap_agg($$
+SELECT device, count(*), sum(value), max(big) FROM heap_agg GROUP BY device
+$$);
+
+-- Grouping by a text column with NULLs
+SELECT * FROM check_heap_agg($$
+SELECT tag, count(*), sum(value), min(measure) FROM heap_agg GROUP BY tag
+$$);
+SELECT * FROM check_heap_agg($$
+SELECT device, tag, count(*), sum(value) FROM heap_agg GROUP BY device, tag
+$$);
+-- Grouping by a column with only NULLs
+SELECT * FROM check_heap_agg($$
+SELECT nothing, count(*), sum(value) FROM heap_agg GROUP BY nothing
+$$);
+
+-- Filters, which the child scan evaluates
+SELECT * FROM check_heap_agg($$
+SELECT tag, count(*), sum(value) FROM heap_agg
+WHERE value > 500 AND tag <> 'tag1' GROUP BY tag
+$$);
+SELECT * FROM check_heap_agg($$
+SELECT device, sum(big) FROM heap_agg WHERE tag IS NULL GROUP BY device
+$$);
+SELECT * FROM check_heap_agg($$
+SELECT count(*), sum(value) FROM heap_agg WHERE amount > 50
+$$);
+-- Filters that no row passes
+SELECT * FROM check_heap_agg($$
+SELECT tag, count(*), sum(value) FROM heap_agg WHERE value < 0 GROUP BY tag
+$$);
+
+-- FILTER clauses
+SELECT * FROM check_heap_agg($$
+SELECT tag, count(*) FILTER (WHERE value > 100),
+       sum(big) FILTER (WHERE measure < 1000),
+       count(*) FILTER (WHERE tag IS NULL)
+FROM heap_agg GROUP BY tag
+$$);
+
+-- Aggregates and grouping columns that are not vectorized
+SELECT * FROM check_heap_agg($$
+SELECT sum(amount) FROM heap_agg
+$$);
+SELECT * FROM check_heap_agg($$
+SELECT amount, count(*) FROM heap_agg GROUP BY amount
+$$);
+
+-- Index and bitmap heap scans of the heap chunk, next to a compressed one
+SET enable_seqscan TO off;
+SELECT * FROM check_heap_agg($$
+SELECT tag, count(*), sum(value) FROM heap_agg
+WHERE time >= 15000 AND time < 25000 GROUP BY tag
+$$);
+SET enable_indexscan TO off;
+SELECT * FROM check_heap_agg($$
+SELECT tag, count(*), sum(value) FROM heap_agg
+WHERE time >= 15000 AND time < 25000 GROUP BY tag
+$$);
+RESET enable_indexscan;
+RESET enable_seqscan;
+
+-- Rescans, with and without parameters
+SET enable_material TO off;
+SELECT * FROM check_heap_agg($$
+SELECT g, s.*
+FROM generate_series(1, 3) g,
+     LATERAL (SELECT tag, count(*), sum(value) FROM heap_agg GROUP BY tag) s
+$$);
+SELECT * FROM check_heap_agg($$
+SELECT g, s.*
+FROM generate_series(1, 3) g,
+     LATERAL (SELECT tag, count(*), sum(value) FROM heap_agg
+              WHERE device = g GROUP BY tag) s
+$$);
+SELECT * FROM check_heap_agg($$
+SELECT g, (SELECT sum(value) FROM heap_agg WHERE value > g * 300)
+FROM generate_series(1, 3) g
+$$);
+RESET enable_material;
+
+-- The chunkwise aggregation is chosen by cost for a hypertable without
+-- compressed chunks, so here only check the result
+SELECT same_result FROM check_heap_agg($$
+SELECT count(*), sum(value), sum(big), avg(measure) FROM heap_plain
+$$);
+SELECT same_result FROM check_heap_agg($$
+SELECT tag, count(*), sum(value) FROM heap_plain WHERE value > 500 GROUP BY tag
+$$);
+SELECT same_result FROM check_heap_agg($$
+SELECT device, count(*) FILTER (WHERE tag IS NULL) FROM heap_plain GROUP BY device
+$$);
+
+-- Parallel plans, where the heap chunk is read with a parallel scan
+SELECT set_config(CASE WHEN current_setting('server_version_num')::int < 160000
+                         THEN 'force_parallel_mode' ELSE 'debug_parallel_query' END,
+                  'on', false);
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+SELECT * FROM check_heap_agg($$
+SELECT tag, count(*), sum(value), min(measure) FROM heap_agg GROUP BY tag
+$$);
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+SELECT set_config(CASE WHEN current_setting('server_version_num')::int < 160000
+                         THEN 'force_parallel_mode' ELSE 'debug_parallel_query' END,
+                  'off', false);
@@ -0,0 +1,80 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the vectorized implementation of histogram()
+\ir include/setting_compare.sql
+
+-- The vectorized histogram() follows width_bucket() of PG16 and later, and
+-- is not used on the older versions
+CREATE FUNCTION histogram_vectorized() RETURNS bool LANGUAGE sql AS
+$$ SELECT current_setting('server_version_num')::int >= 160000 $$;
+
+CREATE TABLE hist_ht(time int NOT NULL, device int, v float8);
+SELECT table_name FROM create_hypertable('hist_ht', 'time', chunk_time_interval => 10000);
+ALTER TABLE hist_ht SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                          timescaledb.compress_orderby = 'time');
+INSERT INTO hist_ht
+SELECT t, t % 4, CASE WHEN t % 11 = 0 THEN NULL ELSE t % 1000 / 10.0 - 10 END
+FROM generate_series(0, 29999) t;
+-- The last chunk stays uncompressed
+SELECT count(compress_chunk(c)) FROM show_chunks('hist_ht') c
+WHERE c != '_timescaledb_internal._hyper_1_3_chunk'::regclass;
+ANALYZE hist_ht;
+SET max_parallel_workers_per_gather TO 0;
+
+-- The null values are counted as zero, the values below the lower bound in
+-- the first bucket and the values at or above the upper bound in the last one
+SELECT in_plan = histogram_vectorized() AS expected_plan, same_result
+FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT histogram(v, 0, 50, 5) FROM hist_ht
+$$, 'VectorAgg');
+SELECT in_plan = histogram_vectorized() AS expected_plan, same_result
+FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, histogram(v, -5, 95, 10) FROM hist_ht GROUP BY device
+$$, 'VectorAgg');
+SELECT in_plan = histogram_vectorized() AS expected_plan, same_result
+FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT histogram(v, 0.05, 0.15, 1000) FROM hist_ht
+$$, 'VectorAgg');
+SELECT in_plan = histogram_vectorized() AS expected_plan, same_result
+FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, histogram(v, 20, 30, 7) FROM hist_ht WHERE v > 20 GROUP BY device
+$$, 'VectorAgg');
+SELECT in_plan = histogram_vectorized() AS expected_plan, same_result
+FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, histogram(v, 0, 90, 3) FILTER (WHERE time % 3 = 0),
+       histogram(v, 0, 90, 3) FILTER (WHERE v > 1000)
+FROM hist_ht GROUP BY device
+$$, 'VectorAgg');
+-- The width of the range overflows
+SELECT in_plan = histogram_vectorized() AS expected_plan, same_result
+FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT histogram(v, -1e308, 1e308, 4) FROM hist_ht
+$$, 'VectorAgg');
+
+-- The parameters that are not constant or make the Postgres aggregation raise
+-- an error are not vectorized
+SELECT plan_contains('SELECT histogram(v, 0, time, 5) FROM hist_ht', 'VectorAgg') AS not_const,
+       plan_contains('SELECT histogram(v, 0, ''NaN'', 5) FROM hist_ht', 'VectorAgg') AS nan,
+       plan_contains('SELECT histogram(v, 0, ''Infinity'', 5) FROM hist_ht', 'VectorAgg') AS inf,
+       plan_contains('SELECT histogram(v, 50, 0, 5) FROM hist_ht', 'VectorAgg') AS min_max,
+       plan_contains('SELECT histogram(v, 0, 50, 0) FROM hist_ht', 'VectorAgg') AS nbuckets;
+\set ON_ERROR_STOP 0
+SELECT histogram(v, 50, 0, 5) FROM hist_ht;
+SELECT histogram(v, 0, 50, 0) FROM hist_ht;
+\set ON_ERROR_STOP 1
+
+-- The partial histograms of the parallel workers are combined in the same way
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+SELECT in_plan = histogram_vectorized() AS expected_plan, same_result
+FROM compare_setting('timescaledb.enable_vectorized_aggregation', $$
+SELECT device, histogram(v, 0, 50, 5) FROM hist_ht GROUP BY device
+$$, 'VectorAgg');
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
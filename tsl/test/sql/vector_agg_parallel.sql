@@ -0,0 +1,72 @@
+-- This file and its contents are licensed under the Timescale License.
+-- Please see the included NOTICE for copyright information and
+-- LICENSE-TIMESCALE for a copy of the license.
+
+-- Tests for the partial vectorized aggregation in parallel plans. The partial
+-- states of sum(int8), avg(int8) and the int4 variance are serialized by
+-- VectorAgg and combined by the Finalize Aggregate, so compare them with the
+-- results of the non-vectorized aggregation, for the values near the int64
+-- limits as well.
+\ir include/setting_compare.sql
+
+CREATE TABLE big(time int NOT NULL, device int, x int8, y int4);
+SELECT table_name FROM create_hypertable('big', 'time', chunk_time_interval => 1000);
+ALTER TABLE big SET (timescaledb.compress, timescaledb.compress_segmentby = 'device',
+                        timescaledb.compress_orderby = 'time');
+INSERT INTO big
+SELECT t, t % 4,
+    CASE WHEN t % 11 = 0 THEN NULL
+         WHEN t % 13 = 0 THEN 0
+         WHEN t % 3 = 0 THEN 9223372036854775807 - t
+         WHEN t % 3 = 1 THEN -9223372036854775808 + t
+         ELSE t::int8 * 1000003 END,
+    CASE WHEN t % 2 = 0 THEN 2147483647 - t ELSE -2147483648 + t END
+FROM generate_series(0, 4999) t;
+-- The last chunk stays uncompressed
+SELECT count(compress_chunk(c)) FROM show_chunks('big') c
+WHERE c != '_timescaledb_internal._hyper_1_5_chunk'::regclass;
+ANALYZE big;
+
+-- Force the parallel plans
+SELECT set_config(CASE WHEN current_setting('server_version_num')::int < 160000 THEN 'force_parallel_mode' ELSE 'debug_parallel_query' END,'on', false);
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+
+-- The expected results without the vectorized aggregation
+SET timescaledb.enable_vectorized_aggregation TO off;
+CREATE TABLE expected_total AS SELECT sum(x)::text, avg(x)::text, count(x), var_samp(y)::text FROM big;
+CREATE TABLE expected_grouped AS SELECT device, sum(x)::text, avg(x)::text, var_samp(y)::text FROM big GROUP BY device;
+CREATE TABLE expected_positive AS SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x > 0 GROUP BY device;
+CREATE TABLE expected_negative AS SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x < 0 GROUP BY device;
+CREATE TABLE expected_zero AS SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x = 0 GROUP BY device;
+RESET timescaledb.enable_vectorized_aggregation;
+
+SELECT plan_contains($$SELECT sum(x)::text, avg(x)::text, count(x), var_samp(y)::text FROM big$$, 'Gather') AS parallel,
+       plan_contains($$SELECT sum(x)::text, avg(x)::text, count(x), var_samp(y)::text FROM big$$, 'VectorAgg') AS vectorized;
+SELECT count(*) FROM ((SELECT sum(x)::text, avg(x)::text, count(x), var_samp(y)::text FROM big) EXCEPT ALL TABLE expected_total) diff;
+SELECT count(*) FROM (TABLE expected_total EXCEPT ALL (SELECT sum(x)::text, avg(x)::text, count(x), var_samp(y)::text FROM big)) diff;
+SELECT plan_contains($$SELECT device, sum(x)::text, avg(x)::text, var_samp(y)::text FROM big GROUP BY device$$, 'Gather') AS parallel,
+       plan_contains($$SELECT device, sum(x)::text, avg(x)::text, var_samp(y)::text FROM big GROUP BY device$$, 'VectorAgg') AS vectorized;
+SELECT count(*) FROM ((SELECT device, sum(x)::text, avg(x)::text, var_samp(y)::text FROM big GROUP BY device) EXCEPT ALL TABLE expected_grouped) diff;
+SELECT count(*) FROM (TABLE expected_grouped EXCEPT ALL (SELECT device, sum(x)::text, avg(x)::text, var_samp(y)::text FROM big GROUP BY device)) diff;
+-- The sums above and below the int64 range, and the zero sums
+SELECT plan_contains($$SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x > 0 GROUP BY device$$, 'Gather') AS parallel,
+       plan_contains($$SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x > 0 GROUP BY device$$, 'VectorAgg') AS vectorized;
+SELECT count(*) FROM ((SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x > 0 GROUP BY device) EXCEPT ALL TABLE expected_positive) diff;
+SELECT count(*) FROM (TABLE expected_positive EXCEPT ALL (SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x > 0 GROUP BY device)) diff;
+SELECT plan_contains($$SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x < 0 GROUP BY device$$, 'Gather') AS parallel,
+       plan_contains($$SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x < 0 GROUP BY device$$, 'VectorAgg') AS vectorized;
+SELECT count(*) FROM ((SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x < 0 GROUP BY device) EXCEPT ALL TABLE expected_negative) diff;
+SELECT count(*) FROM (TABLE expected_negative EXCEPT ALL (SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x < 0 GROUP BY device)) diff;
+SELECT plan_contains($$SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x = 0 GROUP BY device$$, 'Gather') AS parallel,
+       plan_contains($$SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x = 0 GROUP BY device$$, 'VectorAgg') AS vectorized;
+SELECT count(*) FROM ((SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x = 0 GROUP BY device) EXCEPT ALL TABLE expected_zero) diff;
+SELECT count(*) FROM (TABLE expected_zero EXCEPT ALL (SELECT device, sum(x)::text, avg(x)::text FROM big WHERE x = 0 GROUP BY device)) diff;
+
+SELECT set_config(CASE WHEN current_setting('server_version_num')::int < 160000 THEN 'force_parallel_mode' ELSE 'debug_parallel_query' END,'off', false);
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
@@ -0,0 +1,590 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Benchmark for the compression algorithms. Compresses a dataset in batches of
+ * the usual size and measures the throughput of compression, of the forward
+ * and reverse decompression iterators and of the bulk decompression.
+ */
+
+#include <postgres.h>
+
+#include <dirent.h>
+
+#include <access/htup_details.h>
+#include <catalog/pg_type.h>
+#include <common/pg_prng.h>
+#include <fmgr.h>
+#include <funcapi.h>
+#include <libpq/pqformat.h>
+#include <portability/instr_time.h>
+#include <utils/builtins.h>
+#include <utils/datum.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+
+#include "compression/arrow_c_data_interface.h"
+#include "compression/compression.h"
+#include "compression_sql_test.h"
+#include "export.h"
+
+/* The values to compress, one batch is compressed per TARGET_COMPRESSED_BATCH_SIZE rows. */
+typedef struct BenchDataset
+{
+	Oid type;
+	int rows;
+	int capacity;
+	Datum *values;
+	bool *nulls;
+
+	/* The total size of the non-null values in their in-memory format. */
+	int64 bytes;
+} BenchDataset;
+
+/* The throughput measurements of one phase of the benchmark. */
+typedef struct BenchTiming
+{
+	int64 rows;
+	double seconds;
+} BenchTiming;
+
+static CompressionAlgorithm
+bench_get_algorithm(const char *name)
+{
+	for (int algo = 1; algo < _END_COMPRESSION_ALGORITHMS; algo++)
+	{
+		if (pg_strcasecmp(name, NameStr(*compression_get_algorithm_name(algo))) == 0)
+		{
+			return algo;
+		}
+	}
+
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("unknown compression algorithm %s", name)));
+	pg_unreachable();
+}
+
+static void
+bench_dataset_append(BenchDataset *dataset, Datum value, bool isnull)
+{
+	if (dataset->rows == dataset->capacity)
+	{
+		dataset->capacity = Max(dataset->capacity * 2, TARGET_COMPRESSED_BATCH_SIZE);
+		dataset->values = repalloc(dataset->values, sizeof(Datum) * dataset->capacity);
+		dataset->nulls = repalloc(dataset->nulls, sizeof(bool) * dataset->capacity);
+	}
+
+	dataset->values[dataset->rows] = value;
+	dataset->nulls[dataset->rows] = isnull;
+	dataset->rows++;
+
+	if (!isnull)
+	{
+		const int16 typlen = get_typlen(dataset->type);
+		dataset->bytes += typlen > 0 ? typlen : VARSIZE_ANY(DatumGetPointer(value));
+	}
+}
+
+static BenchDataset *
+bench_dataset_create(Oid type)
+{
+	BenchDataset *dataset = palloc0(sizeof(BenchDataset));
+	dataset->type = type;
+	dataset->capacity = TARGET_COMPRESSED_BATCH_SIZE;
+	dataset->values = palloc(sizeof(Datum) * dataset->capacity);
+	dataset->nulls = palloc(sizeof(bool) * dataset->capacity);
+	return dataset;
+}
+
+/*
+ * Convert the generated integer value to the given type. The floats get a
+ * fractional part, and the text values have a common prefix, which is
+ * typical for the real data.
+ */
+static Datum
+bench_make_value(Oid type, int64 value)
+{
+	switch (type)
+	{
+		case BOOLOID:
+			return BoolGetDatum(value % 2 != 0);
+		case INT2OID:
+			return Int16GetDatum((int16) value);
+		case INT4OID:
+		case DATEOID:
+			return Int32GetDatum((int32) value);
+		case INT8OID:
+			return Int64GetDatum(value);
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			/* The sequential values are then one second apart. */
+			return Int64GetDatum(value * USECS_PER_SEC);
+		case FLOAT4OID:
+			return Float4GetDatum((float4) value / 8);
+		case FLOAT8OID:
+			return Float8GetDatum((float8) value / 8);
+		case TEXTOID:
+			return PointerGetDatum(cstring_to_text(psprintf("value-" INT64_FORMAT, value)));
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("type %s is not supported by the compression benchmark",
+							format_type_be(type))));
+			pg_unreachable();
+	}
+}
+
+/*
+ * Generate the synthetic dataset with the given distribution of values:
+ *   constant: the same value in every row;
+ *   sequential: increasing values with a constant step;
+ *   random: uniformly distributed values;
+ *   low_cardinality: random values out of 16 distinct ones.
+ */
+static BenchDataset *
+bench_generate_dataset(Oid type, const char *distribution, double null_fraction, int rows)
+{
+	enum
+	{
+		DIST_CONSTANT,
+		DIST_SEQUENTIAL,
+		DIST_RANDOM,
+		DIST_LOW_CARDINALITY,
+	} dist;
+
+	if (pg_strcasecmp(distribution, "constant") == 0)
+		dist = DIST_CONSTANT;
+	else if (pg_strcasecmp(distribution, "sequential") == 0)
+		dist = DIST_SEQUENTIAL;
+	else if (pg_strcasecmp(distribution, "random") == 0)
+		dist = DIST_RANDOM;
+	else if (pg_strcasecmp(distribution, "low_cardinality") == 0)
+		dist = DIST_LOW_CARDINALITY;
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("unknown data distribution %s", distribution),
+				 errhint("Use one of constant, sequential, random or low_cardinality.")));
+
+	pg_prng_state prng;
+	pg_prng_seed(&prng, 0);
+
+	BenchDataset *dataset = bench_dataset_create(type);
+	for (int row = 0; row < rows; row++)
+	{
+		if (null_fraction > 0 && pg_prng_double(&prng) < null_fraction)
+		{
+			bench_dataset_append(dataset, (Datum) 0, true);
+			continue;
+		}
+
+		int64 value = 0;
+		switch (dist)
+		{
+			case DIST_CONSTANT:
+				value = 42;
+				break;
+			case DIST_SEQUENTIAL:
+				value = row;
+				break;
+			case DIST_RANDOM:
+				value = (int64) pg_prng_uint64_range(&prng, 0, PG_INT32_MAX);
+				break;
+			case DIST_LOW_CARDINALITY:
+				value = (int64) pg_prng_uint64_range(&prng, 0, 15);
+				break;
+		}
+
+		bench_dataset_append(dataset, bench_make_value(type, value), false);
+	}
+
+	return dataset;
+}
+
+/*
+ * Build the dataset from the compressed data files in the given directory,
+ * e.g. a fuzzing corpus. The files are decompressed and their values are
+ * concatenated, the files that can't be decompressed as the given type are
+ * skipped.
+ */
+static BenchDataset *
+bench_read_dataset(Oid type, const char *path)
+{
+	DIR *dp = opendir(path);
+	if (!dp)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_FILE), errmsg("could not open directory '%s'", path)));
+	}
+
+	BenchDataset *dataset = bench_dataset_create(type);
+	const int16 typlen = get_typlen(type);
+	const bool typbyval = get_typbyval(type);
+	MemoryContext dataset_mctx = CurrentMemoryContext;
+	MemoryContext file_mctx =
+		AllocSetContextCreate(CurrentMemoryContext, "bench file", ALLOCSET_DEFAULT_SIZES);
+
+	struct dirent *ep;
+	while ((ep = readdir(dp)))
+	{
+		if (ep->d_name[0] == '.')
+		{
+			continue;
+		}
+
+		char *file_path = psprintf("%s/%s", path, ep->d_name);
+		FILE *f = fopen(file_path, "r");
+		if (!f)
+		{
+			continue;
+		}
+
+		fseek(f, 0, SEEK_END);
+		const size_t fsize = ftell(f);
+		fseek(f, 0, SEEK_SET);
+
+		MemoryContextSwitchTo(file_mctx);
+		char *data = palloc(fsize + 1);
+		const bool read_ok = fsize > 0 && fread(data, fsize, 1, f) == 1;
+		fclose(f);
+
+		const int rows_before = dataset->rows;
+		const int64 bytes_before = dataset->bytes;
+		if (read_ok)
+		{
+			PG_TRY();
+			{
+				StringInfoData si = { .data = data, .len = fsize };
+				const CompressionAlgorithm algo = pq_getmsgbyte(&si);
+				CheckCompressedData(algo > 0 && algo < _END_COMPRESSION_ALGORITHMS);
+				const CompressionAlgorithmDefinition *def = algorithm_definition(algo);
+				CheckCompressedData(def->compressed_data_recv != NULL);
+				Datum compressed = def->compressed_data_recv(&si);
+				DecompressionIterator *iter = def->iterator_init_forward(compressed, type);
+				DecompressResult r;
+				for (r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+				{
+					MemoryContextSwitchTo(dataset_mctx);
+					bench_dataset_append(dataset,
+										 r.is_null ? (Datum) 0 : datumCopy(r.val, typbyval, typlen),
+										 r.is_null);
+					MemoryContextSwitchTo(file_mctx);
+				}
+			}
+			PG_CATCH();
+			{
+				/* Skip the invalid data, the fuzzing corpora have a lot of it. */
+				FlushErrorState();
+				dataset->rows = rows_before;
+				dataset->bytes = bytes_before;
+			}
+			PG_END_TRY();
+		}
+
+		MemoryContextSwitchTo(dataset_mctx);
+		MemoryContextReset(file_mctx);
+	}
+
+	(void) closedir(dp);
+	MemoryContextDelete(file_mctx);
+
+	if (dataset->rows == 0)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_NO_DATA),
+				 errmsg("no valid compressed data of type %s in directory '%s'",
+						format_type_be(type),
+						path)));
+	}
+
+	return dataset;
+}
+
+static double
+bench_elapsed(instr_time start)
+{
+	instr_time duration;
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	return INSTR_TIME_GET_DOUBLE(duration);
+}
+
+/*
+ * Compress the dataset in batches. Returns the compressed batches, NULL if the
+ * batch has only null values.
+ */
+static void **
+bench_compress(const BenchDataset *dataset, CompressionAlgorithm algo, int nbatches)
+{
+	const CompressionAlgorithmDefinition *def = algorithm_definition(algo);
+	void **batches = palloc0(sizeof(void *) * nbatches);
+
+	for (int batch = 0; batch < nbatches; batch++)
+	{
+		const int start_row = batch * TARGET_COMPRESSED_BATCH_SIZE;
+		const int end_row = Min(dataset->rows, start_row + TARGET_COMPRESSED_BATCH_SIZE);
+		Compressor *compressor = def->compressor_for_type(dataset->type);
+		for (int row = start_row; row < end_row; row++)
+		{
+			if (dataset->nulls[row])
+				compressor->append_null(compressor);
+			else
+				compressor->append_val(compressor, dataset->values[row]);
+		}
+		batches[batch] = compressor->finish(compressor);
+	}
+
+	return batches;
+}
+
+static int64
+bench_decompress_iterator(void **batches, int nbatches, Oid type, bool reverse,
+						  MemoryContext scratch_mctx)
+{
+	int64 rows = 0;
+	MemoryContext old_mctx = MemoryContextSwitchTo(scratch_mctx);
+	for (int batch = 0; batch < nbatches; batch++)
+	{
+		if (batches[batch] == NULL)
+			continue;
+
+		const CompressedDataHeader *header = (CompressedDataHeader *) batches[batch];
+		DecompressionIterator *iter =
+			tsl_get_decompression_iterator_init(header->compression_algorithm,
+												reverse)(PointerGetDatum(batches[batch]), type);
+		for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+		{
+			rows++;
+		}
+		MemoryContextReset(scratch_mctx);
+	}
+	MemoryContextSwitchTo(old_mctx);
+	return rows;
+}
+
+/*
+ * Returns -1 if bulk decompression is not supported for the compressed data.
+ */
+static int64
+bench_decompress_all(void **batches, int nbatches, Oid type, MemoryContext scratch_mctx)
+{
+	int64 rows = 0;
+	for (int batch = 0; batch < nbatches; batch++)
+	{
+		if (batches[batch] == NULL)
+			continue;
+
+		const CompressedDataHeader *header = (CompressedDataHeader *) batches[batch];
+		DecompressAllFunction decompress_all =
+			tsl_get_decompress_all_function(header->compression_algorithm, type);
+		if (decompress_all == NULL)
+			return -1;
+
+		ArrowArray *arrow = decompress_all(PointerGetDatum(batches[batch]), type, scratch_mctx);
+		rows += arrow->length;
+		MemoryContextReset(scratch_mctx);
+	}
+	return rows;
+}
+
+/*
+ * Run the benchmark for the given dataset and form the result tuple.
+ */
+static Datum
+bench_run(FunctionCallInfo fcinfo, const BenchDataset *dataset, CompressionAlgorithm algo,
+		  int iterations)
+{
+	enum
+	{
+		out_rows = 0,
+		out_uncompressed_bytes,
+		out_compressed_bytes,
+		out_compression_ratio,
+		out_result_algorithms,
+		out_compress_mb_per_second,
+		out_compress_rows_per_second,
+		out_forward_mb_per_second,
+		out_forward_rows_per_second,
+		out_reverse_mb_per_second,
+		out_reverse_rows_per_second,
+		out_bulk_mb_per_second,
+		out_bulk_rows_per_second,
+		_out_columns
+	};
+
+	TupleDesc tupdesc;
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+						"that cannot accept type record")));
+
+	if (iterations <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of iterations must be positive")));
+
+	if (algorithm_definition(algo)->compressor_for_type == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("compression algorithm %s has no compressor",
+						NameStr(*compression_get_algorithm_name(algo)))));
+
+	const int nbatches =
+		(dataset->rows + TARGET_COMPRESSED_BATCH_SIZE - 1) / TARGET_COMPRESSED_BATCH_SIZE;
+	MemoryContext compressed_mctx =
+		AllocSetContextCreate(CurrentMemoryContext, "bench compressed", ALLOCSET_DEFAULT_SIZES);
+	MemoryContext scratch_mctx =
+		AllocSetContextCreate(CurrentMemoryContext, "bench scratch", ALLOCSET_DEFAULT_SIZES);
+	MemoryContext old_mctx = CurrentMemoryContext;
+
+	BenchTiming compress = { 0 };
+	BenchTiming forward = { 0 };
+	BenchTiming reverse = { 0 };
+	BenchTiming bulk = { 0 };
+	void **batches = NULL;
+	instr_time start;
+
+	for (int i = 0; i < iterations; i++)
+	{
+		/* Keep the compressed data of the last iteration for decompression. */
+		MemoryContextReset(compressed_mctx);
+		MemoryContextSwitchTo(compressed_mctx);
+		INSTR_TIME_SET_CURRENT(start);
+		batches = bench_compress(dataset, algo, nbatches);
+		compress.seconds += bench_elapsed(start);
+		compress.rows += dataset->rows;
+		MemoryContextSwitchTo(old_mctx);
+	}
+
+	for (int i = 0; i < iterations; i++)
+	{
+		INSTR_TIME_SET_CURRENT(start);
+		forward.rows +=
+			bench_decompress_iterator(batches, nbatches, dataset->type, false, scratch_mctx);
+		forward.seconds += bench_elapsed(start);
+
+		INSTR_TIME_SET_CURRENT(start);
+		reverse.rows +=
+			bench_decompress_iterator(batches, nbatches, dataset->type, true, scratch_mctx);
+		reverse.seconds += bench_elapsed(start);
+
+		if (bulk.rows >= 0)
+		{
+			INSTR_TIME_SET_CURRENT(start);
+			const int64 rows = bench_decompress_all(batches, nbatches, dataset->type, scratch_mctx);
+			bulk.seconds += bench_elapsed(start);
+			bulk.rows = rows < 0 ? -1 : bulk.rows + rows;
+		}
+	}
+
+	/* The size and the algorithms of the compressed data. */
+	int64 compressed_bytes = 0;
+	bool used_algorithms[_END_COMPRESSION_ALGORITHMS] = { 0 };
+	for (int batch = 0; batch < nbatches; batch++)
+	{
+		if (batches[batch] == NULL)
+			continue;
+
+		compressed_bytes += VARSIZE(batches[batch]);
+		used_algorithms[((CompressedDataHeader *) batches[batch])->compression_algorithm] = true;
+	}
+
+	StringInfoData used_names;
+	initStringInfo(&used_names);
+	for (int i = 1; i < _END_COMPRESSION_ALGORITHMS; i++)
+	{
+		if (used_algorithms[i])
+			appendStringInfo(&used_names,
+							 "%s%s",
+							 used_names.len > 0 ? "," : "",
+							 NameStr(*compression_get_algorithm_name(i)));
+	}
+
+	Datum values[_out_columns] = { 0 };
+	bool nulls[_out_columns] = { 0 };
+	const double mb = (double) dataset->bytes / (1024.0 * 1024.0);
+
+	values[out_rows] = Int64GetDatum(dataset->rows);
+	values[out_uncompressed_bytes] = Int64GetDatum(dataset->bytes);
+	values[out_compressed_bytes] = Int64GetDatum(compressed_bytes);
+	values[out_result_algorithms] = PointerGetDatum(cstring_to_text(used_names.data));
+	if (compressed_bytes > 0)
+		values[out_compression_ratio] = Float8GetDatum((double) dataset->bytes / compressed_bytes);
+	else
+		nulls[out_compression_ratio] = true;
+
+	/* The MB/s are counted in the uncompressed size for every phase. */
+#define SET_THROUGHPUT(TIMING, OUT)                                                                \
+	if ((TIMING).rows >= 0)                                                                        \
+	{                                                                                              \
+		const double seconds = Max((TIMING).seconds, 1e-9);                                        \
+		values[out_##OUT##_mb_per_second] = Float8GetDatum(mb * iterations / seconds);             \
+		values[out_##OUT##_rows_per_second] = Float8GetDatum((TIMING).rows / seconds);             \
+	}                                                                                              \
+	else                                                                                           \
+	{                                                                                              \
+		nulls[out_##OUT##_mb_per_second] = true;                                                   \
+		nulls[out_##OUT##_rows_per_second] = true;                                                 \
+	}
+
+	SET_THROUGHPUT(compress, compress);
+	SET_THROUGHPUT(forward, forward);
+	SET_THROUGHPUT(reverse, reverse);
+	SET_THROUGHPUT(bulk, bulk);
+#undef SET_THROUGHPUT
+
+	MemoryContextDelete(compressed_mctx);
+	MemoryContextDelete(scratch_mctx);
+
+	return HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls));
+}
+
+TS_FUNCTION_INFO_V1(ts_bench_compression);
+
+/*
+ * Benchmark the compression algorithm on a synthetic dataset. The arguments
+ * are the algorithm name, the type, the data distribution, the fraction of
+ * nulls, the number of rows and the number of iterations.
+ */
+Datum
+ts_bench_compression(PG_FUNCTION_ARGS)
+{
+	const CompressionAlgorithm algo = bench_get_algorithm(PG_GETARG_CSTRING(0));
+	const Oid type = PG_GETARG_OID(1);
+	const double null_fraction = PG_GETARG_FLOAT8(3);
+	const int32 rows = PG_GETARG_INT32(4);
+
+	if (null_fraction < 0 || null_fraction > 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("null fraction must be between 0 and 1")));
+
+	if (rows <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of rows must be positive")));
+
+	BenchDataset *dataset =
+		bench_generate_dataset(type, PG_GETARG_CSTRING(2), null_fraction, rows);
+	PG_RETURN_DATUM(bench_run(fcinfo, dataset, algo, PG_GETARG_INT32(5)));
+}
+
+TS_FUNCTION_INFO_V1(ts_bench_compression_directory);
+
+/*
+ * Benchmark the compression algorithm on the values read from the compressed
+ * data files in the given directory. The arguments are the algorithm name,
+ * the type, the directory and the number of iterations.
+ */
+Datum
+ts_bench_compression_directory(PG_FUNCTION_ARGS)
+{
+	const CompressionAlgorithm algo = bench_get_algorithm(PG_GETARG_CSTRING(0));
+	BenchDataset *dataset = bench_read_dataset(PG_GETARG_OID(1), PG_GETARG_CSTRING(2));
+	PG_RETURN_DATUM(bench_run(fcinfo, dataset, algo, PG_GETARG_INT32(3)));
+}
@@ -7,8 +7,11 @@
 
 #include <postgres.h>
 
+#include <common/hashfn.h>
 #include <funcapi.h>
 #include <libpq/pqformat.h>
+#include <portability/instr_time.h>
+#include <storage/fd.h>
 #include <utils/builtins.h>
 
 #include "compression_sql_test.h"
@@ -40,6 +43,18 @@ get_compression_algorithm(char *name)
 	{
 		return COMPRESSION_ALGORITHM_BOOL;
 	}
+	else if (pg_strcasecmp(name, "for") == 0)
+	{
+		return COMPRESSION_ALGORITHM_FOR;
+	}
+	else if (pg_strcasecmp(name, "alp") == 0)
+	{
+		return COMPRESSION_ALGORITHM_ALP;
+	}
+	else if (pg_strcasecmp(name, "fsst") == 0)
+	{
+		return COMPRESSION_ALGORITHM_FSST;
+	}
 
 	ereport(ERROR, (errmsg("unknown compression algorithm %s", name)));
 	return _INVALID_COMPRESSION_ALGORITHM;
@@ -68,6 +83,26 @@ get_compression_algorithm(char *name)
 #undef PG_TYPE_PREFIX
 #undef DATUM_TO_CTYPE
 
+#define ALGO FOR
+#define CTYPE int64
+#define PG_TYPE_PREFIX INT8
+#define DATUM_TO_CTYPE DatumGetInt64
+#include "decompress_arithmetic_test_impl.c"
+#undef ALGO
+#undef CTYPE
+#undef PG_TYPE_PREFIX
+#undef DATUM_TO_CTYPE
+
+#define ALGO ALP
+#define CTYPE float8
+#define PG_TYPE_PREFIX FLOAT8
+#define DATUM_TO_CTYPE DatumGetFloat8
+#include "decompress_arithmetic_test_impl.c"
+#undef ALGO
+#undef CTYPE
+#undef PG_TYPE_PREFIX
+#undef DATUM_TO_CTYPE
+
 /*
  * The table of the supported testing configurations. We use it to generate
  * dispatch tables and specializations of test functions.
@@ -77,10 +112,16 @@ get_compression_algorithm(char *name)
 	X(GORILLA, FLOAT8, false)                                                                      \
 	X(DELTADELTA, INT8, true)                                                                      \
 	X(DELTADELTA, INT8, false)                                                                     \
+	X(FOR, INT8, true)                                                                             \
+	X(FOR, INT8, false)                                                                            \
+	X(ALP, FLOAT8, true)                                                                           \
+	X(ALP, FLOAT8, false)                                                                          \
 	X(ARRAY, TEXT, false)                                                                          \
 	X(ARRAY, TEXT, true)                                                                           \
 	X(DICTIONARY, TEXT, false)                                                                     \
-	X(DICTIONARY, TEXT, true)
+	X(DICTIONARY, TEXT, true)                                                                      \
+	X(FSST, TEXT, false)                                                                           \
+	X(FSST, TEXT, true)
 
 static int (*get_decompress_fn(int algo, Oid type))(const uint8 *Data, size_t Size, bool bulk)
 {
@@ -101,14 +142,13 @@ static int (*get_decompress_fn(int algo, Oid type))(const uint8 *Data, size_t Si
 }
 
 /*
- * Read and decompress compressed data from file. Useful for debugging the
- * results of fuzzing.
+ * Read the contents of a file with compressed data. Returns NULL for an empty
+ * file.
  * The out parameter bytes is volatile because we want to fill it even
  * if we error out later.
  */
-static void
-read_compressed_data_file_impl(int algo, Oid type, const char *path, bool bulk, volatile int *bytes,
-							   int *rows)
+static char *
+read_compressed_data_file_contents(const char *path, volatile int *bytes)
 {
 	FILE *f = fopen(path, "r");
 
@@ -122,7 +162,6 @@ read_compressed_data_file_impl(int algo, Oid type, const char *path, bool bulk,
 	const size_t fsize = ftell(f);
 	fseek(f, 0, SEEK_SET); /* same as rewind(f); */
 
-	*rows = 0;
 	*bytes = fsize;
 
 	if (fsize == 0)
@@ -132,7 +171,7 @@ read_compressed_data_file_impl(int algo, Oid type, const char *path, bool bulk,
 		 * right away.
 		 */
 		fclose(f);
-		return;
+		return NULL;
 	}
 
 	char *string = palloc(fsize + 1);
@@ -148,7 +187,24 @@ read_compressed_data_file_impl(int algo, Oid type, const char *path, bool bulk,
 
 	string[fsize] = 0;
 
-	*rows = get_decompress_fn(algo, type)((const uint8 *) string, fsize, bulk);
+	return string;
+}
+
+/*
+ * Read and decompress compressed data from file. Useful for debugging the
+ * results of fuzzing.
+ */
+static void
+read_compressed_data_file_impl(int algo, Oid type, const char *path, bool bulk, volatile int *bytes,
+							   int *rows)
+{
+	*rows = 0;
+
+	const char *string = read_compressed_data_file_contents(path, bytes);
+	if (string == NULL)
+		return;
+
+	*rows = get_decompress_fn(algo, type)((const uint8 *) string, *bytes, bulk);
 }
 
 TS_FUNCTION_INFO_V1(ts_read_compressed_data_file);
@@ -306,16 +362,14 @@ ts_read_compressed_data_directory(PG_FUNCTION_ARGS)
 	SRF_RETURN_DONE(funcctx);
 }
 
-#endif
-
-#ifdef TS_COMPRESSION_FUZZING
-
 /*
- * Fuzzing target for all supported types.
+ * Decompress the data like the decompression of a compressed chunk does,
+ * without checking the results. Returns the number of rows, or -1 if the
+ * data is for another compression algorithm.
  */
 static int
-target_generic(const uint8 *Data, size_t Size, CompressionAlgorithm requested_algo, Oid pg_type,
-			   bool bulk)
+decompress_generic(const uint8 *Data, size_t Size, CompressionAlgorithm requested_algo,
+				   Oid pg_type, bool bulk)
 {
 	StringInfoData si = { .data = (char *) Data, .len = Size };
 
@@ -339,14 +393,229 @@ target_generic(const uint8 *Data, size_t Size, CompressionAlgorithm requested_al
 	if (bulk)
 	{
 		DecompressAllFunction decompress_all = tsl_get_decompress_all_function(data_algo, pg_type);
-		decompress_all(compressed_data, pg_type, CurrentMemoryContext);
-		return 0;
+		return decompress_all(compressed_data, pg_type, CurrentMemoryContext)->length;
 	}
 
+	int rows = 0;
 	DecompressionIterator *iter = def->iterator_init_forward(compressed_data, pg_type);
 	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
-		;
-	return 0;
+		rows++;
+	return rows;
+}
+
+/*
+ * Decompress the data the given number of times, and return the minimal
+ * time of a decompression in nanoseconds. The errors for corrupt data are
+ * caught, the time until the error is counted then, and the SQLSTATE of the
+ * error is returned.
+ */
+static double
+time_decompression(const uint8 *Data, size_t Size, CompressionAlgorithm algo, Oid pg_type,
+				   bool bulk, int repeats, int *rows, int *sqlerrcode)
+{
+	MemoryContext call_context = CurrentMemoryContext;
+	MemoryContext decompression_context =
+		AllocSetContextCreate(CurrentMemoryContext, "time decompression", ALLOCSET_DEFAULT_SIZES);
+	double min_ns = -1;
+
+	*rows = 0;
+	*sqlerrcode = 0;
+
+	for (int i = 0; i < repeats; i++)
+	{
+		instr_time start;
+		instr_time duration;
+
+		MemoryContextReset(decompression_context);
+		MemoryContextSwitchTo(decompression_context);
+		INSTR_TIME_SET_CURRENT(start);
+		PG_TRY();
+		{
+			*rows = decompress_generic(Data, Size, algo, pg_type, bulk);
+		}
+		PG_CATCH();
+		{
+			MemoryContextSwitchTo(call_context);
+			ErrorData *error = CopyErrorData();
+			FlushErrorState();
+			*sqlerrcode = error->sqlerrcode;
+			FreeErrorData(error);
+		}
+		PG_END_TRY();
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+		MemoryContextSwitchTo(call_context);
+
+		CHECK_FOR_INTERRUPTS();
+
+		const double ns = INSTR_TIME_GET_DOUBLE(duration) * 1e9;
+		if (min_ns < 0 || ns < min_ns)
+			min_ns = ns;
+	}
+
+	MemoryContextDelete(decompression_context);
+	return min_ns;
+}
+
+TS_FUNCTION_INFO_V1(ts_bench_compressed_data_directory);
+
+/*
+ * Time the decompression of all compressed data files from directory, to
+ * check that no input is much more expensive to decompress per row than the
+ * normal data. The time in nanoseconds is the minimum of the given number of
+ * repeats. The rows are null for the corrupt data.
+ */
+Datum
+ts_bench_compressed_data_directory(PG_FUNCTION_ARGS)
+{
+	/* Output columns of this function. */
+	enum
+	{
+		out_path = 0,
+		out_bytes,
+		out_rows,
+		out_sqlstate,
+		out_ns,
+		_out_columns
+	};
+
+	char *name = PG_GETARG_CSTRING(2);
+	const int algo = get_compression_algorithm(PG_GETARG_CSTRING(0));
+	const int repeats = PG_GETARG_INT32(4);
+
+	FuncCallContext *funcctx;
+	DIR *dp;
+	struct dirent *ep;
+
+	if (repeats <= 0)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of repeats must be positive")));
+	}
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		funcctx = SRF_FIRSTCALL_INIT();
+		MemoryContext oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &funcctx->tuple_desc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
+
+		funcctx->user_fctx = opendir(name);
+		if (funcctx->user_fctx == NULL)
+		{
+			elog(ERROR, "could not open directory '%s'", name);
+		}
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	dp = (DIR *) funcctx->user_fctx;
+
+	while ((ep = readdir(dp)))
+	{
+		Datum values[_out_columns] = { 0 };
+		bool nulls[_out_columns] = { 0 };
+		int bytes;
+		int rows;
+		int sqlerrcode;
+
+		if (ep->d_name[0] == '.')
+		{
+			continue;
+		}
+
+		char *path = psprintf("%s/%s", name, ep->d_name);
+		const char *string = read_compressed_data_file_contents(path, &bytes);
+		if (string == NULL)
+		{
+			continue;
+		}
+
+		const double ns = time_decompression((const uint8 *) string,
+											 bytes,
+											 algo,
+											 PG_GETARG_OID(1),
+											 PG_GETARG_BOOL(3),
+											 repeats,
+											 &rows,
+											 &sqlerrcode);
+
+		values[out_path] = PointerGetDatum(cstring_to_text(path));
+		values[out_bytes] = Int32GetDatum(bytes);
+		values[out_rows] = Int32GetDatum(rows);
+		nulls[out_rows] = sqlerrcode != 0;
+		values[out_sqlstate] = PointerGetDatum(cstring_to_text(unpack_sql_state(sqlerrcode)));
+		nulls[out_sqlstate] = sqlerrcode == 0;
+		values[out_ns] = Float8GetDatum(ns);
+
+		SRF_RETURN_NEXT(funcctx,
+						HeapTupleGetDatum(heap_form_tuple(funcctx->tuple_desc, values, nulls)));
+	}
+
+	(void) closedir(dp);
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+#endif
+
+#ifdef TS_COMPRESSION_FUZZING
+
+/*
+ * In the mode that records the slow inputs, the inputs that are slower to
+ * decompress per row than all inputs before are saved to this directory, in
+ * files named by the time per row, so that the slowest inputs can be added to
+ * the corpus used for the performance checks. The time per row counts at least
+ * FUZZING_SLOW_MIN_ROWS rows, so that the fixed cost of short or corrupt
+ * inputs doesn't dominate.
+ */
+#define FUZZING_SLOW_DIRECTORY "slow"
+#define FUZZING_SLOW_MIN_ROWS 100
+#define FUZZING_SLOW_REPEATS 10
+
+static bool fuzzing_record_slow = false;
+static double fuzzing_slowest_ns_per_row = 0;
+
+static void
+record_slow_input(const uint8_t *Data, size_t Size, CompressionAlgorithm requested_algo,
+				  Oid pg_type, bool bulk, double ns, int rows)
+{
+	int sqlerrcode;
+
+	if (ns / Max(rows, FUZZING_SLOW_MIN_ROWS) <= fuzzing_slowest_ns_per_row)
+		return;
+
+	/* Measure again, so that a single slow run is not recorded */
+	ns = time_decompression(Data,
+							Size,
+							requested_algo,
+							pg_type,
+							bulk,
+							FUZZING_SLOW_REPEATS,
+							&rows,
+							&sqlerrcode);
+
+	const double ns_per_row = ns / Max(rows, FUZZING_SLOW_MIN_ROWS);
+	if (ns_per_row <= fuzzing_slowest_ns_per_row)
+		return;
+
+	fuzzing_slowest_ns_per_row = ns_per_row;
+
+	char *path = psprintf("%s/%012.0f-%08x",
+						  FUZZING_SLOW_DIRECTORY,
+						  ns_per_row * 1000,
+						  hash_bytes(Data, Size));
+	FILE *f = fopen(path, "w");
+	if (f == NULL || fwrite(Data, Size, 1, f) != 1)
+		elog(WARNING, "could not write the slow fuzzing input '%s'", path);
+	if (f != NULL)
+		fclose(f);
 }
 
 /*
@@ -357,13 +626,17 @@ static int
 target_wrapper(const uint8_t *Data, size_t Size, CompressionAlgorithm requested_algo, Oid pg_type,
 			   bool bulk)
 {
+	instr_time start;
+	instr_time duration;
+
 	MemoryContextReset(CurrentMemoryContext);
 
 	int res = 0;
+	INSTR_TIME_SET_CURRENT(start);
 	PG_TRY();
 	{
 		CHECK_FOR_INTERRUPTS();
-		res = target_generic(Data, Size, requested_algo, pg_type, bulk);
+		res = decompress_generic(Data, Size, requested_algo, pg_type, bulk);
 	}
 	PG_CATCH();
 	{
@@ -371,10 +644,23 @@ target_wrapper(const uint8_t *Data, size_t Size, CompressionAlgorithm requested_
 		FlushErrorState();
 	}
 	PG_END_TRY();
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	if (fuzzing_record_slow && res != -1)
+	{
+		record_slow_input(Data,
+						  Size,
+						  requested_algo,
+						  pg_type,
+						  bulk,
+						  INSTR_TIME_GET_DOUBLE(duration) * 1e9,
+						  res);
+	}
 
 	/*
 	 * -1 means "don't include it into corpus", return it if the test function
-	 * says so, otherwise return 0. Some test functions also returns the number
+	 * says so, otherwise return 0. The test function also returns the number
 	 * of rows for the correct data, the fuzzer doesn't understand these values.
 	 */
 	return res == -1 ? -1 : 0;
@@ -440,6 +726,16 @@ ts_fuzz_compression(PG_FUNCTION_ARGS)
 	Oid type = PG_GETARG_OID(1);
 	bool bulk = PG_GETARG_BOOL(2);
 
+	/* The optional fifth argument enables the recording of the slow inputs */
+	fuzzing_record_slow = PG_NARGS() > 4 && !PG_ARGISNULL(4) && PG_GETARG_BOOL(4);
+	fuzzing_slowest_ns_per_row = 0;
+	if (fuzzing_record_slow && MakePGDirectory(FUZZING_SLOW_DIRECTORY) != 0 && errno != EEXIST)
+	{
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create directory \"%s\": %m", FUZZING_SLOW_DIRECTORY)));
+	}
+
 	int (*target)(const uint8_t *, size_t) = NULL;
 
 #define DISPATCH(ALGO, PGTYPE, BULK)                                                               \
@@ -11,4 +11,6 @@ int decompress_ARRAY_TEXT(const uint8 *Data, size_t Size, bool bulk);
 
 int decompress_DICTIONARY_TEXT(const uint8 *Data, size_t Size, bool bulk);
 
+int decompress_FSST_TEXT(const uint8 *Data, size_t Size, bool bulk);
+
 const CompressionAlgorithmDefinition *algorithm_definition(CompressionAlgorithm algo);
@@ -13,25 +13,36 @@
 #include <guc.h>
 #include <lib/stringinfo.h>
 #include <libpq/pqformat.h>
+#include <port/pg_bswap.h>
 #include <utils/array.h>
 #include <utils/builtins.h>
+#include <utils/float.h>
+#include <utils/jsonb.h>
 #include <utils/lsyscache.h>
 #include <utils/rel.h>
 #include <utils/syscache.h>
 #include <utils/typcache.h>
+#include <utils/uuid.h>
 
 #include "test_utils.h"
 #include "ts_catalog/catalog.h"
 #include <export.h>
 
+#include "compression/algorithms/alp.h"
 #include "compression/algorithms/array.h"
+#include "compression/algorithms/block_codec.h"
 #include "compression/algorithms/bool_compress.h"
 #include "compression/algorithms/deltadelta.h"
 #include "compression/algorithms/dictionary.h"
 #include "compression/algorithms/float_utils.h"
+#include "compression/algorithms/for.h"
+#include "compression/algorithms/fsst.h"
 #include "compression/algorithms/gorilla.h"
+#include "compression/algorithms/jsonb_shred.h"
 #include "compression/algorithms/null.h"
+#include "compression/algorithms/uuid_compress.h"
 #include "compression/arrow_c_data_interface.h"
+#include "compression/batch_metadata_builder_bloom1.h"
 #include "compression/batch_metadata_builder_minmax.h"
 
 #define TEST_ELEMENTS 1015
@@ -427,6 +438,43 @@ test_gorilla_double(bool have_nulls, bool have_random)
 	TestAssertTrue(r.is_done);
 }
 
+/*
+ * All-zero values are encoded with zero-width xors, so the xor bit array is
+ * empty. Check that the bulk decompression handles this case.
+ */
+static void
+test_gorilla_zeros()
+{
+	GorillaCompressor *compressor = gorilla_compressor_alloc();
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		if (i % 7 == 3)
+		{
+			gorilla_compressor_append_null(compressor);
+		}
+		else
+		{
+			gorilla_compressor_append_value(compressor, double_get_bits(0.0));
+		}
+	}
+
+	GorillaCompressed *compressed = gorilla_compressor_finish(compressor);
+	TestAssertTrue(compressed != NULL);
+
+	ArrowArray *bulk_result =
+		gorilla_decompress_all(PointerGetDatum(compressed), FLOAT8OID, CurrentMemoryContext);
+	TestAssertInt64Eq(bulk_result->length, TEST_ELEMENTS);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		const bool valid = arrow_row_is_valid(bulk_result->buffers[0], i);
+		TestAssertTrue(valid == (i % 7 != 3));
+		if (valid)
+		{
+			TestAssertTrue(((double *) bulk_result->buffers[1])[i] == 0.0);
+		}
+	}
+}
+
 static void
 test_delta()
 {
@@ -584,6 +632,1107 @@ test_delta3(bool have_nulls, bool have_random)
 	TestAssertTrue(r.is_done);
 }
 
+/*
+ * The timestamps that go with a fixed interval use the constant step
+ * decompression and are reported as an arithmetic sequence.
+ */
+static void
+test_delta_constant_step(int64 first, int64 step, int jitter_row, bool expect_arithmetic)
+{
+	const bool old_enable_for = ts_guc_enable_for_compression;
+	ts_guc_enable_for_compression = false;
+
+	int64 values[TEST_ELEMENTS];
+	DeltaDeltaCompressor *compressor = delta_delta_compressor_alloc();
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		values[i] = (int64) ((uint64) first + (uint64) step * i) + (i == jitter_row ? 1 : 0);
+		delta_delta_compressor_append_value(compressor, values[i]);
+	}
+	Datum compressed = PointerGetDatum(delta_delta_compressor_finish(compressor));
+	CompressedDataHeader *header = (CompressedDataHeader *) DatumGetPointer(compressed);
+	TestAssertInt64Eq(header->compression_algorithm, COMPRESSION_ALGORITHM_DELTADELTA);
+
+	int64 arithmetic_first = 0;
+	int64 arithmetic_step = 0;
+	TestAssertTrue(delta_delta_compressed_get_step(header, &arithmetic_first, &arithmetic_step) ==
+				   expect_arithmetic);
+	if (expect_arithmetic)
+	{
+		TestAssertInt64Eq(arithmetic_first, first);
+		TestAssertInt64Eq(arithmetic_step, step);
+	}
+
+	ArrowArray *bulk_result =
+		delta_delta_decompress_all(compressed, TIMESTAMPTZOID, CurrentMemoryContext);
+	TestAssertInt64Eq(bulk_result->length, TEST_ELEMENTS);
+	TestAssertInt64Eq(bulk_result->null_count, 0);
+
+	int i = 0;
+	DecompressionIterator *iter =
+		delta_delta_decompression_iterator_from_datum_forward(compressed, TIMESTAMPTZOID);
+	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+	{
+		TestAssertTrue(!r.is_null);
+		TestAssertInt64Eq(DatumGetInt64(r.val), values[i]);
+		TestAssertInt64Eq(((int64 *) bulk_result->buffers[1])[i], values[i]);
+		i++;
+	}
+	TestAssertInt64Eq(i, TEST_ELEMENTS);
+
+	ts_guc_enable_for_compression = old_enable_for;
+}
+
+static void
+test_for(bool have_nulls, bool have_exceptions)
+{
+	ForCompressor *compressor = for_compressor_alloc();
+
+	int64 values[TEST_ELEMENTS];
+	bool nulls[TEST_ELEMENTS];
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		/* A narrow range of values without a monotonic pattern. */
+		values[i] = -3 + (int64) (test_hash64(i) % 11);
+
+		/* Some rare outliers that become patched exceptions. */
+		if (have_exceptions && i % 97 == 5)
+		{
+			values[i] = (int64) test_hash64(i);
+		}
+
+		nulls[i] = have_nulls && i % 29 == 0;
+
+		if (nulls[i])
+		{
+			for_compressor_append_null(compressor);
+		}
+		else
+		{
+			for_compressor_append_value(compressor, values[i]);
+		}
+	}
+
+	Datum compressed = PointerGetDatum(for_compressor_finish(compressor));
+	TestAssertTrue(DatumGetPointer(compressed) != NULL);
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_FOR);
+	if (!have_nulls && !have_exceptions)
+	{
+		/* 4 bits per value plus the header and the padding word. */
+		TestAssertInt64Eq(VARSIZE(DatumGetPointer(compressed)), 24 + 64 * 8 + 8);
+	}
+
+	/* Forward and bulk decompression. */
+	DecompressionIterator *iter = for_decompression_iterator_from_datum_forward(compressed, INT8OID);
+	ArrowArray *bulk_result = for_decompress_all(compressed, INT8OID, CurrentMemoryContext);
+	TestAssertInt64Eq(bulk_result->length, TEST_ELEMENTS);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		DecompressResult r = for_decompression_iterator_try_next_forward(iter);
+		TestAssertTrue(!r.is_done);
+		if (r.is_null)
+		{
+			TestAssertTrue(nulls[i]);
+			TestAssertTrue(!arrow_row_is_valid(bulk_result->buffers[0], i));
+		}
+		else
+		{
+			TestAssertTrue(!nulls[i]);
+			TestAssertTrue(arrow_row_is_valid(bulk_result->buffers[0], i));
+			TestAssertTrue(values[i] == DatumGetInt64(r.val));
+			TestAssertTrue(values[i] == ((int64 *) bulk_result->buffers[1])[i]);
+		}
+	}
+	DecompressResult r = for_decompression_iterator_try_next_forward(iter);
+	TestAssertTrue(r.is_done);
+
+	/* Reverse decompression. */
+	iter = for_decompression_iterator_from_datum_reverse(compressed, INT8OID);
+	for (int i = TEST_ELEMENTS - 1; i >= 0; i--)
+	{
+		DecompressResult r = for_decompression_iterator_try_next_reverse(iter);
+		TestAssertTrue(!r.is_done);
+		if (r.is_null)
+		{
+			TestAssertTrue(nulls[i]);
+		}
+		else
+		{
+			TestAssertTrue(!nulls[i]);
+			TestAssertTrue(values[i] == DatumGetInt64(r.val));
+		}
+	}
+	r = for_decompression_iterator_try_next_reverse(iter);
+	TestAssertTrue(r.is_done);
+
+	/* Narrower element types use the same packed data. */
+	bulk_result = for_decompress_all(compressed, INT4OID, CurrentMemoryContext);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		if (!nulls[i])
+		{
+			TestAssertTrue((int32) values[i] == ((int32 *) bulk_result->buffers[1])[i]);
+		}
+	}
+}
+
+/*
+ * The delta-delta compressor falls back to FOR for the values where the
+ * delta encoding doesn't help.
+ */
+static void
+test_delta_for_fallback()
+{
+	const bool old_enable_for = ts_guc_enable_for_compression;
+	ts_guc_enable_for_compression = true;
+
+	DeltaDeltaCompressor *compressor = delta_delta_compressor_alloc();
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		delta_delta_compressor_append_value(compressor, 200 + test_hash64(i) % 7);
+	}
+	Datum compressed = PointerGetDatum(delta_delta_compressor_finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_FOR);
+
+	int i = 0;
+	DecompressionIterator *iter = for_decompression_iterator_from_datum_forward(compressed, INT8OID);
+	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+	{
+		TestAssertTrue(!r.is_null);
+		TestAssertInt64Eq(DatumGetInt64(r.val), 200 + test_hash64(i) % 7);
+		i++;
+	}
+	TestAssertInt64Eq(i, TEST_ELEMENTS);
+
+	/* Monotonic values still use delta-delta. */
+	compressor = delta_delta_compressor_alloc();
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		delta_delta_compressor_append_value(compressor, i * 1000);
+	}
+	compressed = PointerGetDatum(delta_delta_compressor_finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_DELTADELTA);
+
+	ts_guc_enable_for_compression = old_enable_for;
+}
+
+static void
+test_alp(bool have_nulls, bool have_exceptions)
+{
+	AlpCompressor *compressor = alp_compressor_alloc(FLOAT8OID);
+
+	double values[TEST_ELEMENTS];
+	bool nulls[TEST_ELEMENTS];
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		/* Decimals with two digits after the point. */
+		values[i] = (int64) (test_hash64(i) % 10000) / 100.;
+
+		/* Some values that can't be encoded and become exceptions. */
+		if (have_exceptions && i % 97 == 5)
+		{
+			values[i] = (test_hash64(i) / (double) PG_UINT64_MAX) * 100.;
+		}
+		else if (have_exceptions && i % 97 == 7)
+		{
+			values[i] = -0.;
+		}
+		else if (have_exceptions && i % 97 == 11)
+		{
+			values[i] = get_float8_nan();
+		}
+
+		nulls[i] = have_nulls && i % 29 == 0;
+
+		if (nulls[i])
+		{
+			alp_compressor_append_null(compressor);
+		}
+		else
+		{
+			alp_compressor_append_value(compressor, double_get_bits(values[i]));
+		}
+	}
+
+	Datum compressed = PointerGetDatum(alp_compressor_finish(compressor));
+	TestAssertTrue(DatumGetPointer(compressed) != NULL);
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_ALP);
+	if (!have_nulls && !have_exceptions)
+	{
+		/*
+		 * 14 bits per value in the nested FOR data, plus the headers and the
+		 * padding word.
+		 */
+		TestAssertInt64Eq(VARSIZE(DatumGetPointer(compressed)), 16 + 24 + 223 * 8 + 8);
+	}
+
+	/* Forward and bulk decompression. */
+	DecompressionIterator *iter =
+		alp_decompression_iterator_from_datum_forward(compressed, FLOAT8OID);
+	ArrowArray *bulk_result = alp_decompress_all(compressed, FLOAT8OID, CurrentMemoryContext);
+	TestAssertInt64Eq(bulk_result->length, TEST_ELEMENTS);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		DecompressResult r = alp_decompression_iterator_try_next_forward(iter);
+		TestAssertTrue(!r.is_done);
+		if (r.is_null)
+		{
+			TestAssertTrue(nulls[i]);
+			TestAssertTrue(!arrow_row_is_valid(bulk_result->buffers[0], i));
+		}
+		else
+		{
+			TestAssertTrue(!nulls[i]);
+			TestAssertTrue(arrow_row_is_valid(bulk_result->buffers[0], i));
+			/* Compare the bits, so that NaN and -0 are checked as well. */
+			TestAssertInt64Eq(double_get_bits(DatumGetFloat8(r.val)), double_get_bits(values[i]));
+			TestAssertInt64Eq(double_get_bits(((double *) bulk_result->buffers[1])[i]),
+							  double_get_bits(values[i]));
+		}
+	}
+	DecompressResult r = alp_decompression_iterator_try_next_forward(iter);
+	TestAssertTrue(r.is_done);
+
+	/* Reverse decompression. */
+	iter = alp_decompression_iterator_from_datum_reverse(compressed, FLOAT8OID);
+	for (int i = TEST_ELEMENTS - 1; i >= 0; i--)
+	{
+		DecompressResult r = alp_decompression_iterator_try_next_reverse(iter);
+		TestAssertTrue(!r.is_done);
+		if (r.is_null)
+		{
+			TestAssertTrue(nulls[i]);
+		}
+		else
+		{
+			TestAssertTrue(!nulls[i]);
+			TestAssertInt64Eq(double_get_bits(DatumGetFloat8(r.val)), double_get_bits(values[i]));
+		}
+	}
+	r = alp_decompression_iterator_try_next_reverse(iter);
+	TestAssertTrue(r.is_done);
+}
+
+/*
+ * The Gorilla compressor for float columns switches to ALP for the batches
+ * where it gives a smaller result.
+ */
+static void
+test_gorilla_alp_choice()
+{
+	const bool old_enable_alp = ts_guc_enable_alp_compression;
+	ts_guc_enable_alp_compression = true;
+
+	/* Decimals with one digit after the point. */
+	Compressor *compressor = gorilla_compressor_for_type(FLOAT4OID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		compressor->append_val(compressor, Float4GetDatum(20.f + (test_hash64(i) % 100) / 10.f));
+	}
+	Datum compressed = PointerGetDatum(compressor->finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_ALP);
+
+	ArrowArray *bulk_result = alp_decompress_all(compressed, FLOAT4OID, CurrentMemoryContext);
+	TestAssertInt64Eq(bulk_result->length, TEST_ELEMENTS);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		TestAssertInt64Eq(float_get_bits(((float *) bulk_result->buffers[1])[i]),
+						  float_get_bits(20.f + (test_hash64(i) % 100) / 10.f));
+	}
+
+	/* Random floats still use Gorilla. */
+	compressor = gorilla_compressor_for_type(FLOAT8OID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		compressor->append_val(compressor,
+							   Float8GetDatum((test_hash64(i) / (double) PG_UINT64_MAX) * 100.));
+	}
+	compressed = PointerGetDatum(compressor->finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_GORILLA);
+
+	ts_guc_enable_alp_compression = old_enable_alp;
+}
+
+/*
+ * An enum-like int8 value with a wide range, or a float setpoint, including
+ * both zeros.
+ */
+static int64
+test_fixed_dictionary_int(int i)
+{
+	return (int64) (test_hash64(i) % 5) * INT64CONST(1000000000037) - INT64CONST(2000000000000);
+}
+
+static double
+test_fixed_dictionary_float(int i)
+{
+	static const double setpoints[] = { 21.5, 19.25, -0.0, 0.0, 1e300 };
+	return setpoints[test_hash64(i) % lengthof(setpoints)];
+}
+
+static void
+test_fixed_dictionary(bool have_nulls)
+{
+	const bool old_enable_dictionary = ts_guc_enable_fixed_dictionary_compression;
+	ts_guc_enable_fixed_dictionary_compression = true;
+
+	Compressor *compressor = delta_delta_compressor_for_type(INT8OID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		if (have_nulls && i % 7 == 0)
+			compressor->append_null(compressor);
+		else
+			compressor->append_val(compressor, Int64GetDatum(test_fixed_dictionary_int(i)));
+	}
+	Datum compressed = PointerGetDatum(compressor->finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_DICTIONARY);
+	TestAssertTrue(tsl_get_decompress_all_function(COMPRESSION_ALGORITHM_DICTIONARY, INT8OID) ==
+				   tsl_fixed_dictionary_decompress_all);
+
+	/* Forward iteration and bulk decompression. */
+	DecompressionIterator *iter =
+		tsl_dictionary_decompression_iterator_from_datum_forward(compressed, INT8OID);
+	ArrowArray *bulk_result =
+		tsl_fixed_dictionary_decompress_all(compressed, INT8OID, CurrentMemoryContext);
+	TestAssertInt64Eq(bulk_result->length, TEST_ELEMENTS);
+	TestAssertInt64Eq(bulk_result->null_count, have_nulls ? (TEST_ELEMENTS + 6) / 7 : 0);
+	int row = 0;
+	for (DecompressResult r = dictionary_decompression_iterator_try_next_forward(iter); !r.is_done;
+		 r = dictionary_decompression_iterator_try_next_forward(iter))
+	{
+		const bool is_null = have_nulls && row % 7 == 0;
+		TestAssertTrue(r.is_null == is_null);
+		TestAssertTrue(arrow_row_is_valid(bulk_result->buffers[0], row) == !is_null);
+		if (!is_null)
+		{
+			TestAssertInt64Eq(DatumGetInt64(r.val), test_fixed_dictionary_int(row));
+			TestAssertInt64Eq(((const int64 *) bulk_result->buffers[1])[row],
+							  test_fixed_dictionary_int(row));
+		}
+		row++;
+	}
+	TestAssertInt64Eq(row, TEST_ELEMENTS);
+
+	/* The floats are restored bit for bit, including the sign of zero. */
+	compressor = gorilla_compressor_for_type(FLOAT8OID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		compressor->append_val(compressor, Float8GetDatum(test_fixed_dictionary_float(i)));
+	}
+	compressed = PointerGetDatum(compressor->finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_DICTIONARY);
+	bulk_result = tsl_fixed_dictionary_decompress_all(compressed, FLOAT8OID, CurrentMemoryContext);
+	TestAssertInt64Eq(bulk_result->length, TEST_ELEMENTS);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		TestAssertInt64Eq(double_get_bits(((const double *) bulk_result->buffers[1])[i]),
+						  double_get_bits(test_fixed_dictionary_float(i)));
+	}
+
+	/* Distinct values don't use the dictionary. */
+	compressor = delta_delta_compressor_for_type(INT8OID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		compressor->append_val(compressor, Int64GetDatum(test_hash64(i)));
+	}
+	compressed = PointerGetDatum(compressor->finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_DELTADELTA);
+
+	/* Without the GUC, we get the delta-delta encoding. */
+	ts_guc_enable_fixed_dictionary_compression = false;
+	compressor = delta_delta_compressor_for_type(INT8OID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		compressor->append_val(compressor, Int64GetDatum(test_fixed_dictionary_int(i)));
+	}
+	compressed = PointerGetDatum(compressor->finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_DELTADELTA);
+
+	ts_guc_enable_fixed_dictionary_compression = old_enable_dictionary;
+}
+
+static char *
+test_fsst_string(int i)
+{
+	return psprintf("https://www.example.com/products/item-%d?session=%08x&ref=newsletter",
+					(int) (test_hash64(i) % 100000),
+					(uint32) test_hash64(i + TEST_ELEMENTS));
+}
+
+static void
+test_fsst(bool have_nulls)
+{
+	FsstCompressor *compressor = fsst_compressor_alloc(TEXTOID);
+	Size raw_size = 0;
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		if (have_nulls && i % 7 == 3)
+		{
+			fsst_compressor_append_null(compressor);
+			continue;
+		}
+
+		char *str = test_fsst_string(i);
+		raw_size += strlen(str);
+		fsst_compressor_append(compressor, CStringGetTextDatum(str));
+	}
+	Datum compressed = PointerGetDatum(fsst_compressor_finish(compressor));
+	TestAssertTrue(DatumGetPointer(compressed) != NULL);
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_FSST);
+	TestAssertInt64Eq(fsst_compressed_has_nulls((CompressedDataHeader *) DatumGetPointer(
+						  compressed)),
+					  have_nulls);
+
+	/* The strings have a lot of common substrings, so we should compress them well. */
+	TestAssertTrue(VARSIZE(DatumGetPointer(compressed)) < raw_size / 2);
+
+	/* Forward decompression. */
+	DecompressionIterator *iter =
+		fsst_decompression_iterator_from_datum_forward(compressed, TEXTOID);
+	int i = 0;
+	for (DecompressResult r = fsst_decompression_iterator_try_next(iter); !r.is_done;
+		 r = fsst_decompression_iterator_try_next(iter))
+	{
+		TestAssertTrue(i < TEST_ELEMENTS);
+		TestAssertInt64Eq(r.is_null, have_nulls && i % 7 == 3);
+		if (!r.is_null && strcmp(TextDatumGetCString(r.val), test_fsst_string(i)) != 0)
+			elog(ERROR,
+				 "%4d \"%s\" != \"%s\" @ %d",
+				 i,
+				 TextDatumGetCString(r.val),
+				 test_fsst_string(i),
+				 __LINE__);
+		i++;
+	}
+	TestAssertInt64Eq(i, TEST_ELEMENTS);
+
+	/* Bulk decompression. */
+	ArrowArray *arrow = fsst_decompress_all(compressed, TEXTOID, CurrentMemoryContext);
+	TestAssertInt64Eq(arrow->length, TEST_ELEMENTS);
+	TestAssertInt64Eq(arrow->n_buffers, 3);
+	const uint32 *offsets = (const uint32 *) arrow->buffers[1];
+	const char *bodies = (const char *) arrow->buffers[2];
+	for (i = 0; i < TEST_ELEMENTS; i++)
+	{
+		const bool is_null = have_nulls && i % 7 == 3;
+		TestAssertInt64Eq(arrow_row_is_valid(arrow->buffers[0], i), !is_null);
+		if (is_null)
+		{
+			TestAssertInt64Eq(offsets[i + 1], offsets[i]);
+			continue;
+		}
+
+		char *str = test_fsst_string(i);
+		TestAssertInt64Eq(offsets[i + 1] - offsets[i], strlen(str));
+		TestAssertTrue(memcmp(&bodies[offsets[i]], str, strlen(str)) == 0);
+	}
+
+	/* Reverse decompression. */
+	iter = fsst_decompression_iterator_from_datum_reverse(compressed, TEXTOID);
+	for (DecompressResult r = fsst_decompression_iterator_try_next(iter); !r.is_done;
+		 r = fsst_decompression_iterator_try_next(iter))
+	{
+		i--;
+		TestAssertTrue(i >= 0);
+		TestAssertInt64Eq(r.is_null, have_nulls && i % 7 == 3);
+		if (!r.is_null && strcmp(TextDatumGetCString(r.val), test_fsst_string(i)) != 0)
+			elog(ERROR,
+				 "%4d \"%s\" != \"%s\" @ %d",
+				 i,
+				 TextDatumGetCString(r.val),
+				 test_fsst_string(i),
+				 __LINE__);
+	}
+	TestAssertInt64Eq(i, 0);
+
+	/* Send and receive. */
+	StringInfoData buffer;
+	initStringInfo(&buffer);
+	fsst_compressed_send((CompressedDataHeader *) DatumGetPointer(compressed), &buffer);
+	Datum received = fsst_compressed_recv(&buffer);
+	TestAssertInt64Eq(VARSIZE(DatumGetPointer(received)), VARSIZE(DatumGetPointer(compressed)));
+	TestAssertTrue(memcmp(DatumGetPointer(received),
+						  DatumGetPointer(compressed),
+						  VARSIZE(DatumGetPointer(compressed))) == 0);
+
+	TestEnsureError(fsst_compressor_for_type(INT4OID));
+}
+
+static void
+test_dictionary_fsst_fallback()
+{
+	const bool old_enable_fsst = ts_guc_enable_fsst_compression;
+	ts_guc_enable_fsst_compression = true;
+
+	/* The strings are all distinct, so the dictionary falls back. */
+	DictionaryCompressor *compressor = dictionary_compressor_alloc(TEXTOID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		dictionary_compressor_append(compressor, CStringGetTextDatum(test_fsst_string(i)));
+	}
+	Datum compressed = PointerGetDatum(dictionary_compressor_finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_FSST);
+
+	/* Without the GUC, we get the array. */
+	ts_guc_enable_fsst_compression = false;
+	compressor = dictionary_compressor_alloc(TEXTOID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		dictionary_compressor_append(compressor, CStringGetTextDatum(test_fsst_string(i)));
+	}
+	compressed = PointerGetDatum(dictionary_compressor_finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_ARRAY);
+
+	ts_guc_enable_fsst_compression = old_enable_fsst;
+}
+
+/*
+ * A version 7 UUID with a timestamp that grows by a few milliseconds per row,
+ * or a version 4 one that is all random.
+ */
+static pg_uuid_t
+test_uuid_value(int i, bool v7)
+{
+	uint64 hi = test_hash64(i);
+	uint64 lo = test_hash64(i + TEST_ELEMENTS);
+	if (v7)
+	{
+		const uint64 timestamp = INT64CONST(1700000000000) + 3 * i + test_hash64(i) % 2;
+		hi = (timestamp << 16) | (UINT64CONST(7) << 12) | (hi & 0xFFF);
+	}
+	else
+	{
+		hi = (hi & ~(UINT64CONST(0xF) << 12)) | (UINT64CONST(4) << 12);
+	}
+	lo = (UINT64CONST(2) << 62) | (lo >> 2);
+
+	pg_uuid_t result;
+	hi = pg_hton64(hi);
+	lo = pg_hton64(lo);
+	memcpy(&result.data[0], &hi, sizeof(hi));
+	memcpy(&result.data[sizeof(hi)], &lo, sizeof(lo));
+	return result;
+}
+
+static void
+test_uuid(bool have_nulls)
+{
+	UuidCompressor *compressor = uuid_compressor_alloc();
+	pg_uuid_t *values = palloc(sizeof(pg_uuid_t) * TEST_ELEMENTS);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		values[i] = test_uuid_value(i, /* v7 = */ true);
+		if (have_nulls && i % 7 == 3)
+		{
+			uuid_compressor_append_null(compressor);
+			continue;
+		}
+
+		uuid_compressor_append(compressor, UUIDPGetDatum(&values[i]));
+	}
+	Datum compressed = PointerGetDatum(uuid_compressor_finish(compressor));
+	TestAssertTrue(DatumGetPointer(compressed) != NULL);
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_UUID);
+	TestAssertInt64Eq(uuid_compressed_has_nulls((CompressedDataHeader *) DatumGetPointer(
+						  compressed)),
+					  have_nulls);
+
+	/* We store a bit more than the random part of the UUIDs. */
+	TestAssertTrue(VARSIZE(DatumGetPointer(compressed)) < TEST_ELEMENTS * UUID_LEN * 3 / 4);
+
+	/* Forward decompression. */
+	DecompressionIterator *iter =
+		uuid_decompression_iterator_from_datum_forward(compressed, UUIDOID);
+	int i = 0;
+	for (DecompressResult r = uuid_decompression_iterator_try_next(iter); !r.is_done;
+		 r = uuid_decompression_iterator_try_next(iter))
+	{
+		TestAssertTrue(i < TEST_ELEMENTS);
+		TestAssertInt64Eq(r.is_null, have_nulls && i % 7 == 3);
+		if (!r.is_null)
+			TestAssertTrue(memcmp(DatumGetUUIDP(r.val), &values[i], UUID_LEN) == 0);
+		i++;
+	}
+	TestAssertInt64Eq(i, TEST_ELEMENTS);
+
+	/* Bulk decompression. */
+	ArrowArray *arrow = uuid_decompress_all(compressed, UUIDOID, CurrentMemoryContext);
+	TestAssertInt64Eq(arrow->length, TEST_ELEMENTS);
+	TestAssertInt64Eq(arrow->n_buffers, 2);
+	TestAssertInt64Eq(arrow->null_count, have_nulls ? (TEST_ELEMENTS + 3) / 7 : 0);
+	const uint8 *arrow_values = (const uint8 *) arrow->buffers[1];
+	for (i = 0; i < TEST_ELEMENTS; i++)
+	{
+		const bool is_null = have_nulls && i % 7 == 3;
+		TestAssertInt64Eq(arrow_row_is_valid(arrow->buffers[0], i), !is_null);
+		if (!is_null)
+			TestAssertTrue(memcmp(&arrow_values[UUID_LEN * i], &values[i], UUID_LEN) == 0);
+	}
+
+	/* Reverse decompression. */
+	iter = uuid_decompression_iterator_from_datum_reverse(compressed, UUIDOID);
+	for (DecompressResult r = uuid_decompression_iterator_try_next(iter); !r.is_done;
+		 r = uuid_decompression_iterator_try_next(iter))
+	{
+		i--;
+		TestAssertTrue(i >= 0);
+		TestAssertInt64Eq(r.is_null, have_nulls && i % 7 == 3);
+		if (!r.is_null)
+			TestAssertTrue(memcmp(DatumGetUUIDP(r.val), &values[i], UUID_LEN) == 0);
+	}
+	TestAssertInt64Eq(i, 0);
+
+	/* Send and receive. */
+	StringInfoData buffer;
+	initStringInfo(&buffer);
+	uuid_compressed_send((CompressedDataHeader *) DatumGetPointer(compressed), &buffer);
+	Datum received = uuid_compressed_recv(&buffer);
+	TestAssertInt64Eq(VARSIZE(DatumGetPointer(received)), VARSIZE(DatumGetPointer(compressed)));
+	TestAssertTrue(memcmp(DatumGetPointer(received),
+						  DatumGetPointer(compressed),
+						  VARSIZE(DatumGetPointer(compressed))) == 0);
+
+	/*
+	 * The same values compressed with the dictionary algorithm are bulk
+	 * decompressed into the same Arrow array.
+	 */
+	Compressor *dictionary = dictionary_compressor_for_type(UUIDOID);
+	for (i = 0; i < TEST_ELEMENTS; i++)
+	{
+		if (have_nulls && i % 7 == 3)
+			dictionary->append_null(dictionary);
+		else
+			dictionary->append_val(dictionary, UUIDPGetDatum(&values[i]));
+	}
+	Datum dictionary_compressed = PointerGetDatum(dictionary->finish(dictionary));
+	const CompressedDataHeader *dictionary_header =
+		(const CompressedDataHeader *) DatumGetPointer(dictionary_compressed);
+	DecompressAllFunction decompress_all =
+		tsl_get_decompress_all_function(dictionary_header->compression_algorithm, UUIDOID);
+	TestAssertTrue(decompress_all == uuid_iterator_decompress_all);
+	ArrowArray *dictionary_arrow =
+		decompress_all(dictionary_compressed, UUIDOID, CurrentMemoryContext);
+	TestAssertInt64Eq(dictionary_arrow->length, TEST_ELEMENTS);
+	TestAssertInt64Eq(dictionary_arrow->null_count, arrow->null_count);
+	for (i = 0; i < TEST_ELEMENTS; i++)
+	{
+		TestAssertInt64Eq(arrow_row_is_valid(dictionary_arrow->buffers[0], i),
+						  arrow_row_is_valid(arrow->buffers[0], i));
+	}
+	TestAssertTrue(
+		memcmp(dictionary_arrow->buffers[1], arrow->buffers[1], UUID_LEN * TEST_ELEMENTS) == 0);
+
+	TestEnsureError(uuid_compressor_for_type(INT4OID));
+}
+
+static void
+test_uuid_fallback()
+{
+	/* The version 4 UUIDs go to the dictionary compressor. */
+	UuidCompressor *uuid_compressor = uuid_compressor_alloc();
+	Compressor *compressor = uuid_compressor_for_type(UUIDOID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		pg_uuid_t value = test_uuid_value(i, /* v7 = */ i != TEST_ELEMENTS / 2);
+		uuid_compressor_append(uuid_compressor, UUIDPGetDatum(&value));
+		compressor->append_val(compressor, UUIDPGetDatum(&value));
+	}
+	TestAssertTrue(uuid_compressor_finish(uuid_compressor) == NULL);
+	Datum compressed = PointerGetDatum(compressor->finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_ARRAY);
+	DecompressionIterator *iter = tsl_array_decompression_iterator_from_datum_forward(compressed,
+																					   UUIDOID);
+	int i = 0;
+	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+	{
+		pg_uuid_t value = test_uuid_value(i, /* v7 = */ i != TEST_ELEMENTS / 2);
+		TestAssertTrue(!r.is_null);
+		TestAssertTrue(memcmp(DatumGetUUIDP(r.val), &value, UUID_LEN) == 0);
+		i++;
+	}
+	TestAssertInt64Eq(i, TEST_ELEMENTS);
+
+	/* The dictionary compressor tries the UUID algorithm if enabled. */
+	const bool old_enable_uuid = ts_guc_enable_uuid_compression;
+	ts_guc_enable_uuid_compression = true;
+	DictionaryCompressor *dictionary = dictionary_compressor_alloc(UUIDOID);
+	for (i = 0; i < TEST_ELEMENTS; i++)
+	{
+		pg_uuid_t value = test_uuid_value(i, /* v7 = */ true);
+		dictionary_compressor_append(dictionary, UUIDPGetDatum(&value));
+	}
+	compressed = PointerGetDatum(dictionary_compressor_finish(dictionary));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_UUID);
+
+	ts_guc_enable_uuid_compression = false;
+	dictionary = dictionary_compressor_alloc(UUIDOID);
+	for (i = 0; i < TEST_ELEMENTS; i++)
+	{
+		pg_uuid_t value = test_uuid_value(i, /* v7 = */ true);
+		dictionary_compressor_append(dictionary, UUIDPGetDatum(&value));
+	}
+	compressed = PointerGetDatum(dictionary_compressor_finish(dictionary));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_ARRAY);
+
+	ts_guc_enable_uuid_compression = old_enable_uuid;
+}
+
+/*
+ * The jsonb objects with a few string attributes that are always there and
+ * some that are not, and a few non-object values.
+ */
+static Datum
+test_jsonb_value(int i)
+{
+	char *str;
+	if (i % 11 == 5)
+		str = psprintf("[%d, \"host-%d\"]", i, i % 5);
+	else if (i % 10 == 0)
+		str = psprintf("{\"host\": \"host-%d\", \"value\": %d, \"rare\": \"r%d\"}",
+					   i % 5,
+					   i,
+					   i);
+	else
+		str = psprintf("{\"host\": \"host-%d\", \"level\": \"%s\", \"value\": %d, "
+					   "\"nested\": {\"host\": %d}}",
+					   i % 5,
+					   i % 3 == 0 ? "warn" : "info",
+					   i,
+					   i);
+	return DirectFunctionCall1(jsonb_in, CStringGetDatum(str));
+}
+
+static void
+test_jsonb_field(Datum compressed, const char *key, bool have_nulls)
+{
+	Datum key_datum = CStringGetTextDatum(key);
+	ArrowArray *arrow =
+		jsonb_field_text_decompress_all(compressed, key_datum, CurrentMemoryContext);
+	TestAssertInt64Eq(arrow->length, TEST_ELEMENTS);
+
+	const uint32 *offsets = (const uint32 *) arrow->buffers[1];
+	const char *bodies = (const char *) arrow->buffers[2];
+	if (arrow->dictionary != NULL)
+	{
+		offsets = (const uint32 *) arrow->dictionary->buffers[1];
+		bodies = (const char *) arrow->dictionary->buffers[2];
+	}
+
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		bool expected_isnull = have_nulls && i % 7 == 3;
+		Datum expected = (Datum) 0;
+		if (!expected_isnull)
+			expected = jsonb_field_text(test_jsonb_value(i), key_datum, &expected_isnull);
+
+		TestAssertInt64Eq(arrow_row_is_valid(arrow->buffers[0], i), !expected_isnull);
+		if (expected_isnull)
+			continue;
+
+		const int index = arrow->dictionary != NULL ? ((const int16 *) arrow->buffers[1])[i] : i;
+		text *expected_text = DatumGetTextPP(expected);
+		TestAssertInt64Eq(offsets[index + 1] - offsets[index], VARSIZE_ANY_EXHDR(expected_text));
+		TestAssertTrue(memcmp(&bodies[offsets[index]],
+							  VARDATA_ANY(expected_text),
+							  VARSIZE_ANY_EXHDR(expected_text)) == 0);
+	}
+}
+
+static void
+test_jsonb_shred(bool have_nulls)
+{
+	const bool old_enable_shredding = ts_guc_enable_jsonb_shredding;
+	ts_guc_enable_jsonb_shredding = true;
+
+	DictionaryCompressor *compressor = dictionary_compressor_alloc(JSONBOID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		if (have_nulls && i % 7 == 3)
+			dictionary_compressor_append_null(compressor);
+		else
+			dictionary_compressor_append(compressor, test_jsonb_value(i));
+	}
+	Datum compressed = PointerGetDatum(dictionary_compressor_finish(compressor));
+	CompressedDataHeader *header = (CompressedDataHeader *) DatumGetPointer(compressed);
+	TestAssertInt64Eq(header->compression_algorithm, COMPRESSION_ALGORITHM_JSONB);
+	TestAssertInt64Eq(jsonb_shred_compressed_has_nulls(header), have_nulls);
+
+	/* Forward decompression. */
+	DecompressionIterator *iter =
+		tsl_get_decompression_iterator_init(COMPRESSION_ALGORITHM_JSONB,
+											/* reverse = */ false)(compressed, JSONBOID);
+	int i = 0;
+	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+	{
+		TestAssertTrue(i < TEST_ELEMENTS);
+		TestAssertInt64Eq(r.is_null, have_nulls && i % 7 == 3);
+		if (!r.is_null)
+			TestAssertTrue(
+				DatumGetBool(DirectFunctionCall2(jsonb_eq, r.val, test_jsonb_value(i))));
+		i++;
+	}
+	TestAssertInt64Eq(i, TEST_ELEMENTS);
+
+	/* Reverse decompression. */
+	iter = tsl_get_decompression_iterator_init(COMPRESSION_ALGORITHM_JSONB,
+											   /* reverse = */ true)(compressed, JSONBOID);
+	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+	{
+		i--;
+		TestAssertTrue(i >= 0);
+		TestAssertInt64Eq(r.is_null, have_nulls && i % 7 == 3);
+		if (!r.is_null)
+			TestAssertTrue(
+				DatumGetBool(DirectFunctionCall2(jsonb_eq, r.val, test_jsonb_value(i))));
+	}
+	TestAssertInt64Eq(i, 0);
+
+	/*
+	 * The fields of the shredded keys, of the residual keys, and of the keys
+	 * that are not there.
+	 */
+	test_jsonb_field(compressed, "host", have_nulls);
+	test_jsonb_field(compressed, "level", have_nulls);
+	test_jsonb_field(compressed, "value", have_nulls);
+	test_jsonb_field(compressed, "rare", have_nulls);
+	test_jsonb_field(compressed, "missing", have_nulls);
+
+	/* Send and receive. */
+	StringInfoData buffer;
+	initStringInfo(&buffer);
+	jsonb_shred_compressed_send(header, &buffer);
+	Datum received = jsonb_shred_compressed_recv(&buffer);
+	TestAssertInt64Eq(VARSIZE(DatumGetPointer(received)), VARSIZE(header));
+	TestAssertTrue(memcmp(DatumGetPointer(received), header, VARSIZE(header)) == 0);
+
+	/* Without shredding, the fields are computed from the jsonb values. */
+	ts_guc_enable_jsonb_shredding = false;
+	compressor = dictionary_compressor_alloc(JSONBOID);
+	for (i = 0; i < TEST_ELEMENTS; i++)
+	{
+		if (have_nulls && i % 7 == 3)
+			dictionary_compressor_append_null(compressor);
+		else
+			dictionary_compressor_append(compressor, test_jsonb_value(i));
+	}
+	compressed = PointerGetDatum(dictionary_compressor_finish(compressor));
+	TestAssertTrue(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm !=
+				   COMPRESSION_ALGORITHM_JSONB);
+	test_jsonb_field(compressed, "host", have_nulls);
+	test_jsonb_field(compressed, "value", have_nulls);
+
+	TestEnsureError(jsonb_shred_compressor_for_type(TEXTOID));
+
+	ts_guc_enable_jsonb_shredding = old_enable_shredding;
+}
+
+static void
+test_compression_objective()
+{
+	const CompressionObjective old_objective = ts_guc_compression_objective;
+
+	/* With the size objective, only the size matters. */
+	ts_guc_compression_objective = COMPRESSION_OBJECTIVE_SIZE;
+	TestAssertTrue(compression_candidate_is_better(COMPRESSION_ALGORITHM_GORILLA,
+												   999,
+												   COMPRESSION_ALGORITHM_ALP,
+												   1000));
+	TestAssertTrue(!compression_candidate_is_better(COMPRESSION_ALGORITHM_ALP,
+													1000,
+													COMPRESSION_ALGORITHM_GORILLA,
+													1000));
+
+	/* The other objectives trade some size for the decompression speed. */
+	ts_guc_compression_objective = COMPRESSION_OBJECTIVE_BALANCED;
+	TestAssertTrue(!compression_candidate_is_better(COMPRESSION_ALGORITHM_GORILLA,
+													999,
+													COMPRESSION_ALGORITHM_ALP,
+													1000));
+	TestAssertTrue(compression_candidate_is_better(COMPRESSION_ALGORITHM_ALP,
+												   1100,
+												   COMPRESSION_ALGORITHM_GORILLA,
+												   1000));
+	TestAssertTrue(!compression_candidate_is_better(COMPRESSION_ALGORITHM_ALP,
+													2000,
+													COMPRESSION_ALGORITHM_GORILLA,
+													1000));
+
+	ts_guc_compression_objective = COMPRESSION_OBJECTIVE_SPEED;
+	TestAssertTrue(compression_candidate_is_better(COMPRESSION_ALGORITHM_ALP,
+												   1500,
+												   COMPRESSION_ALGORITHM_GORILLA,
+												   1000));
+
+	ts_guc_compression_objective = old_objective;
+
+	/* The adaptive compression tries all candidates regardless of their GUCs. */
+	const bool old_enable_fsst = ts_guc_enable_fsst_compression;
+	const bool old_enable_adaptive = ts_guc_enable_adaptive_compression;
+	ts_guc_enable_fsst_compression = false;
+	ts_guc_enable_adaptive_compression = true;
+	TestAssertTrue(compression_candidate_enabled(COMPRESSION_ALGORITHM_FSST));
+
+	DictionaryCompressor *compressor = dictionary_compressor_alloc(TEXTOID);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		dictionary_compressor_append(compressor, CStringGetTextDatum(test_fsst_string(i)));
+	}
+	Datum compressed = PointerGetDatum(dictionary_compressor_finish(compressor));
+	TestAssertInt64Eq(((CompressedDataHeader *) DatumGetPointer(compressed))->compression_algorithm,
+					  COMPRESSION_ALGORITHM_FSST);
+
+	ts_guc_enable_adaptive_compression = false;
+	TestAssertTrue(!compression_candidate_enabled(COMPRESSION_ALGORITHM_FSST));
+
+	ts_guc_enable_fsst_compression = old_enable_fsst;
+	ts_guc_enable_adaptive_compression = old_enable_adaptive;
+}
+
+static void
+test_bloom1()
+{
+	Datum compressed_values[1] = { 0 };
+	bool compressed_is_null[1] = { true };
+	RowCompressor compressor = {
+		.compressed_values = compressed_values,
+		.compressed_is_null = compressed_is_null,
+	};
+	TypeCacheEntry *type = lookup_type_cache(INT4OID, TYPECACHE_HASH_EXTENDED_PROC_FINFO);
+	BatchMetadataBuilder *builder = batch_metadata_builder_bloom1_create(INT4OID, InvalidOid, 0);
+
+	/* No filter for a batch of nulls. */
+	builder->update_null(builder);
+	builder->insert_to_compressed_row(builder, &compressor);
+	TestAssertTrue(compressed_is_null[0]);
+
+	for (int i = 0; i < 100; i++)
+	{
+		builder->update_val(builder, Int32GetDatum(i * 7));
+	}
+	builder->insert_to_compressed_row(builder, &compressor);
+	TestAssertTrue(!compressed_is_null[0]);
+
+	/* The filter with few values is folded. */
+	bytea *bloom = DatumGetByteaP(compressed_values[0]);
+	TestAssertTrue(VARSIZE_ANY_EXHDR(bloom) < BLOOM1_MAX_BITS / 8);
+
+	/* No false negatives, and only a few false positives. */
+	int false_positives = 0;
+	for (int i = 0; i < 700; i++)
+	{
+		const uint64 hash =
+			bloom1_hash_value(&type->hash_extended_proc_finfo, InvalidOid, Int32GetDatum(i));
+		const bool contains = bloom1_contains_hash(bloom, hash);
+		if (i % 7 == 0)
+			TestAssertTrue(contains);
+		else
+			false_positives += contains;
+	}
+	TestAssertTrue(false_positives < 60);
+
+	builder->reset(builder, &compressor);
+	TestAssertTrue(compressed_is_null[0]);
+}
+
+#if defined(USE_LZ4) || defined(USE_ZSTD)
+static void
+test_block_codec(CompressionBlockCodec codec)
+{
+	/* Low-cardinality strings as array, so that the codec has something to do. */
+	Compressor *compressor = block_codec_compressor_wrap(array_compressor_for_type(TEXTOID), codec);
+	for (int i = 0; i < TEST_ELEMENTS; i++)
+	{
+		if (i % 11 == 5)
+		{
+			compressor->append_null(compressor);
+			continue;
+		}
+		compressor->append_val(compressor, CStringGetTextDatum(test_fsst_string(i % 20)));
+	}
+	Datum compressed = PointerGetDatum(compressor->finish(compressor));
+	CompressedDataHeader *header = (CompressedDataHeader *) DatumGetPointer(compressed);
+	TestAssertInt64Eq(header->compression_algorithm, COMPRESSION_ALGORITHM_BLOCK);
+	TestAssertTrue(block_codec_compressed_has_nulls(header));
+
+	/* Forward decompression. */
+	DecompressionIterator *iter =
+		block_codec_decompression_iterator_from_datum_forward(compressed, TEXTOID);
+	int i = 0;
+	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+	{
+		TestAssertTrue(i < TEST_ELEMENTS);
+		TestAssertInt64Eq(r.is_null, i % 11 == 5);
+		if (!r.is_null && strcmp(TextDatumGetCString(r.val), test_fsst_string(i % 20)) != 0)
+			elog(ERROR,
+				 "%4d \"%s\" != \"%s\" @ %d",
+				 i,
+				 TextDatumGetCString(r.val),
+				 test_fsst_string(i % 20),
+				 __LINE__);
+		i++;
+	}
+	TestAssertInt64Eq(i, TEST_ELEMENTS);
+
+	/* Reverse decompression. */
+	iter = block_codec_decompression_iterator_from_datum_reverse(compressed, TEXTOID);
+	for (DecompressResult r = iter->try_next(iter); !r.is_done; r = iter->try_next(iter))
+	{
+		i--;
+		TestAssertTrue(i >= 0);
+		TestAssertInt64Eq(r.is_null, i % 11 == 5);
+	}
+	TestAssertInt64Eq(i, 0);
+
+	/* Bulk decompression. */
+	ArrowArray *arrow = block_codec_decompress_all(compressed, TEXTOID, CurrentMemoryContext);
+	TestAssertInt64Eq(arrow->length, TEST_ELEMENTS);
+	TestAssertInt64Eq(arrow->null_count, (TEST_ELEMENTS + 5) / 11);
+	const uint32 *offsets = (const uint32 *) arrow->buffers[1];
+	const char *bodies = (const char *) arrow->buffers[2];
+	for (i = 0; i < TEST_ELEMENTS; i++)
+	{
+		TestAssertInt64Eq(arrow_row_is_valid(arrow->buffers[0], i), i % 11 != 5);
+		if (i % 11 == 5)
+			continue;
+
+		char *str = test_fsst_string(i % 20);
+		TestAssertInt64Eq(offsets[i + 1] - offsets[i], strlen(str));
+		TestAssertTrue(memcmp(&bodies[offsets[i]], str, strlen(str)) == 0);
+	}
+
+	/* Send and receive. */
+	StringInfoData buffer;
+	initStringInfo(&buffer);
+	block_codec_compressed_send(header, &buffer);
+	Datum received = block_codec_compressed_recv(&buffer);
+	TestAssertInt64Eq(VARSIZE(DatumGetPointer(received)), VARSIZE(header));
+	TestAssertTrue(memcmp(DatumGetPointer(received), header, VARSIZE(header)) == 0);
+
+	/* Small data is not worth compressing. */
+	compressor = block_codec_compressor_wrap(array_compressor_for_type(TEXTOID), codec);
+	compressor->append_val(compressor, CStringGetTextDatum("a"));
+	header = compressor->finish(compressor);
+	TestAssertInt64Eq(header->compression_algorithm, COMPRESSION_ALGORITHM_ARRAY);
+}
+#endif
+
 static int32 test_delta4_case1[] = { -603979776, 1462059044 };
 
 static int32 test_delta4_case2[] = {
@@ -909,12 +2058,47 @@ ts_test_compression(PG_FUNCTION_ARGS)
 	test_gorilla_double(/* have_nulls = */ false, /* have_random = */ true);
 	test_gorilla_double(/* have_nulls = */ true, /* have_random = */ false);
 	test_gorilla_double(/* have_nulls = */ true, /* have_random = */ true);
+	test_gorilla_zeros();
 	test_delta();
 	test_delta2();
 	test_delta3(/* have_nulls = */ false, /* have_random = */ false);
 	test_delta3(/* have_nulls = */ false, /* have_random = */ true);
 	test_delta3(/* have_nulls = */ true, /* have_random = */ false);
 	test_delta3(/* have_nulls = */ true, /* have_random = */ true);
+	/* 10 seconds interval in microseconds. */
+	test_delta_constant_step(INT64CONST(757382400000000), 10000000, -1, true);
+	test_delta_constant_step(INT64CONST(757382400000000), -10000000, -1, true);
+	test_delta_constant_step(INT64CONST(757382400000000), 10000000, TEST_ELEMENTS / 2, false);
+	/* The sequence overflows int64, so it is not monotonic. */
+	test_delta_constant_step(PG_INT64_MAX - 100, 1, -1, false);
+	test_for(/* have_nulls = */ false, /* have_exceptions = */ false);
+	test_for(/* have_nulls = */ false, /* have_exceptions = */ true);
+	test_for(/* have_nulls = */ true, /* have_exceptions = */ false);
+	test_for(/* have_nulls = */ true, /* have_exceptions = */ true);
+	test_delta_for_fallback();
+	test_alp(/* have_nulls = */ false, /* have_exceptions = */ false);
+	test_alp(/* have_nulls = */ false, /* have_exceptions = */ true);
+	test_alp(/* have_nulls = */ true, /* have_exceptions = */ false);
+	test_alp(/* have_nulls = */ true, /* have_exceptions = */ true);
+	test_gorilla_alp_choice();
+	test_fixed_dictionary(/* have_nulls = */ false);
+	test_fixed_dictionary(/* have_nulls = */ true);
+	test_fsst(/* have_nulls = */ false);
+	test_fsst(/* have_nulls = */ true);
+	test_dictionary_fsst_fallback();
+	test_uuid(/* have_nulls = */ false);
+	test_uuid(/* have_nulls = */ true);
+	test_uuid_fallback();
+	test_jsonb_shred(/* have_nulls = */ false);
+	test_jsonb_shred(/* have_nulls = */ true);
+	test_compression_objective();
+	test_bloom1();
+#ifdef USE_LZ4
+	test_block_codec(BLOCK_CODEC_LZ4);
+#endif
+#ifdef USE_ZSTD
+	test_block_codec(BLOCK_CODEC_ZSTD);
+#endif
 	test_bool();
 	test_null();
 
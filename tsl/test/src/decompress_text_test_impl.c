@@ -247,3 +247,9 @@ decompress_DICTIONARY_TEXT(const uint8 *Data, size_t Size, bool bulk)
 {
 	return decompress_generic_text(Data, Size, bulk, COMPRESSION_ALGORITHM_DICTIONARY);
 }
+
+int
+decompress_FSST_TEXT(const uint8 *Data, size_t Size, bool bulk)
+{
+	return decompress_generic_text(Data, Size, bulk, COMPRESSION_ALGORITHM_FSST);
+}
@@ -0,0 +1,138 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Microbenchmark for the vectorized implementations of the aggregate
+ * functions over one arrow array.
+ */
+
+#include <postgres.h>
+
+#include <access/tupmacs.h>
+#include <catalog/pg_type.h>
+#include <common/pg_prng.h>
+#include <fmgr.h>
+#include <portability/instr_time.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+
+#include "compression/arrow_c_data_interface.h"
+#include "compression/compression.h"
+#include "export.h"
+#include "nodes/vector_agg/function/functions.h"
+
+TS_FUNCTION_INFO_V1(ts_bench_vector_agg);
+
+/*
+ * Aggregate the batches of random values with the given fraction of null rows,
+ * and return the number of aggregated rows per second. With zero null
+ * fraction, no filter bitmap is passed, same as for the batches without nulls
+ * and filters.
+ */
+Datum
+ts_bench_vector_agg(PG_FUNCTION_ARGS)
+{
+	const Oid aggfnoid = PG_GETARG_OID(0);
+	const Oid argtype = PG_GETARG_OID(1);
+	const double null_fraction = PG_GETARG_FLOAT8(2);
+	const int32 total_rows = PG_GETARG_INT32(3);
+
+	const int16 typlen = get_typlen(argtype);
+	if (typlen <= 0 || typlen > 8 || !get_typbyval(argtype))
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("only the fixed-length by-value types are supported")));
+	}
+
+	if (null_fraction < 0 || null_fraction > 1)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("null fraction must be between 0 and 1")));
+	}
+
+	VectorAggFunctions *agg = get_vector_aggregate(aggfnoid, argtype);
+	if (agg == NULL || agg->agg_vector == NULL)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("aggregate function %u has no vectorized implementation for type %u",
+						aggfnoid,
+						argtype)));
+	}
+
+	const int batch_rows = TARGET_COMPRESSED_BATCH_SIZE;
+	const int padded_rows = pad_to_multiple(64, batch_rows);
+
+	/*
+	 * The values are small integers, which are valid and don't overflow the
+	 * sums for every supported type, including the floats and the timestamps.
+	 */
+	pg_prng_state prng;
+	pg_prng_seed(&prng, 0);
+	char *values = palloc0(typlen * padded_rows + 64);
+	for (int row = 0; row < batch_rows; row++)
+	{
+		const int64 value = (int64) pg_prng_uint64_range(&prng, 0, 1000);
+		switch (argtype)
+		{
+			case FLOAT4OID:
+				((float *) values)[row] = value;
+				break;
+			case FLOAT8OID:
+				((double *) values)[row] = value;
+				break;
+			default:
+				store_att_byval(values + row * typlen, Int64GetDatum(value), typlen);
+				break;
+		}
+	}
+
+	uint64 *filter = NULL;
+	if (null_fraction > 0)
+	{
+		filter = palloc0(sizeof(uint64) * padded_rows / 64);
+		for (int row = 0; row < batch_rows; row++)
+		{
+			arrow_set_row_validity(filter, row, pg_prng_double(&prng) >= null_fraction);
+		}
+	}
+
+	const void *buffers[2] = { filter, values };
+	ArrowArray vector = {
+		.length = batch_rows,
+		.null_count = filter == NULL ? 0 : batch_rows - arrow_num_valid(filter, batch_rows),
+		.n_buffers = 2,
+		.buffers = buffers,
+	};
+
+	MemoryContext agg_extra_mctx =
+		AllocSetContextCreate(CurrentMemoryContext, "bench vector agg", ALLOCSET_DEFAULT_SIZES);
+	void *agg_state = palloc0(agg->state_bytes);
+	agg->agg_init(agg_state, 1);
+
+	const int batches = Max(1, total_rows / batch_rows);
+	instr_time start;
+	instr_time duration;
+	INSTR_TIME_SET_CURRENT(start);
+	for (int i = 0; i < batches; i++)
+	{
+		agg->agg_vector(agg_state, &vector, filter, agg_extra_mctx);
+	}
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	/* Emit the result so that the aggregation can't be optimized away. */
+	Datum result;
+	bool isnull;
+	agg->agg_emit(agg_state, &result, &isnull);
+
+	MemoryContextDelete(agg_extra_mctx);
+
+	const double seconds = Max(INSTR_TIME_GET_DOUBLE(duration), 1e-9);
+	PG_RETURN_FLOAT8((double) batches * batch_rows / seconds);
+}
@@ -0,0 +1,204 @@
+/*
+ * This file and its contents are licensed under the Timescale License.
+ * Please see the included NOTICE for copyright information and
+ * LICENSE-TIMESCALE for a copy of the license.
+ */
+
+/*
+ * Microbenchmark for the vectorized implementations of the predicates with
+ * one arrow array and one constant argument.
+ */
+
+#include <postgres.h>
+
+#include <access/tupmacs.h>
+#include <catalog/pg_type.h>
+#include <common/pg_prng.h>
+#include <fmgr.h>
+#include <portability/instr_time.h>
+#include <utils/builtins.h>
+#include <utils/lsyscache.h>
+
+#include "compression/arrow_c_data_interface.h"
+#include "compression/compression.h"
+#include "export.h"
+#include "nodes/decompress_chunk/vector_predicates.h"
+
+/* The values of the arrays are uniformly distributed in [0, BENCH_DISTINCT_VALUES). */
+#define BENCH_DISTINCT_VALUES 1000
+
+#define BENCH_TEXT_FORMAT "value-%03d"
+
+static Datum
+bench_make_value(Oid type, int value)
+{
+	switch (type)
+	{
+		case FLOAT4OID:
+			return Float4GetDatum(value);
+		case FLOAT8OID:
+			return Float8GetDatum(value);
+		case TEXTOID:
+			return PointerGetDatum(cstring_to_text(psprintf(BENCH_TEXT_FORMAT, value)));
+		default:
+			return Int64GetDatum(value);
+	}
+}
+
+/*
+ * Build an arrow array of the given type with random values in
+ * [0, BENCH_DISTINCT_VALUES). The text values are formatted with a fixed width
+ * so that their order is the same as for the numbers.
+ */
+static ArrowArray *
+bench_make_arrow(Oid type, int rows, double null_fraction, pg_prng_state *prng)
+{
+	const int padded_rows = pad_to_multiple(64, rows);
+	uint64 *validity = palloc0(sizeof(uint64) * padded_rows / 64);
+	for (int row = 0; row < rows; row++)
+	{
+		arrow_set_row_validity(validity, row, pg_prng_double(prng) >= null_fraction);
+	}
+
+	ArrowArray *arrow = palloc0(sizeof(ArrowArray) + sizeof(void *) * 3);
+	const void **buffers = (const void **) &arrow[1];
+	arrow->length = rows;
+	arrow->null_count = rows - arrow_num_valid(validity, rows);
+	arrow->buffers = buffers;
+	buffers[0] = validity;
+
+	if (type == TEXTOID)
+	{
+		const int value_bytes = strlen(psprintf(BENCH_TEXT_FORMAT, 0));
+		uint32 *offsets = palloc(sizeof(uint32) * (padded_rows + 1));
+		char *data = palloc0(value_bytes * padded_rows + 64);
+		offsets[0] = 0;
+		for (int row = 0; row < rows; row++)
+		{
+			const int value = (int) pg_prng_uint64_range(prng, 0, BENCH_DISTINCT_VALUES - 1);
+			snprintf(data + offsets[row], value_bytes + 1, BENCH_TEXT_FORMAT, value);
+			offsets[row + 1] = offsets[row] + value_bytes;
+		}
+		arrow->n_buffers = 3;
+		buffers[1] = offsets;
+		buffers[2] = data;
+		return arrow;
+	}
+
+	const int16 typlen = get_typlen(type);
+	char *values = palloc0(typlen * padded_rows + 64);
+	for (int row = 0; row < rows; row++)
+	{
+		const int value = (int) pg_prng_uint64_range(prng, 0, BENCH_DISTINCT_VALUES - 1);
+		switch (type)
+		{
+			case FLOAT4OID:
+				((float *) values)[row] = value;
+				break;
+			case FLOAT8OID:
+				((double *) values)[row] = value;
+				break;
+			default:
+				store_att_byval(values + row * typlen, bench_make_value(type, value), typlen);
+				break;
+		}
+	}
+	arrow->n_buffers = 2;
+	buffers[1] = values;
+	return arrow;
+}
+
+TS_FUNCTION_INFO_V1(ts_bench_vector_predicate);
+
+/*
+ * Compute the predicate on the batches of random values with the given
+ * fraction of null rows, and return the number of nanoseconds per row. The
+ * constant is the value at the given quantile of the values, so it is the
+ * selectivity of the "<" operators.
+ */
+Datum
+ts_bench_vector_predicate(PG_FUNCTION_ARGS)
+{
+	const Oid opno = PG_GETARG_OID(0);
+	const double null_fraction = PG_GETARG_FLOAT8(1);
+	const double selectivity = PG_GETARG_FLOAT8(2);
+	const int32 batch_rows = PG_GETARG_INT32(3);
+	const int32 total_rows = PG_GETARG_INT32(4);
+
+	if (null_fraction < 0 || null_fraction > 1)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("null fraction must be between 0 and 1")));
+	}
+
+	if (selectivity < 0 || selectivity > 1)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("selectivity must be between 0 and 1")));
+	}
+
+	if (batch_rows <= 0 || batch_rows > GLOBAL_MAX_ROWS_PER_COMPRESSION)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("batch rows must be between 1 and %d", GLOBAL_MAX_ROWS_PER_COMPRESSION)));
+	}
+
+	Oid vector_type;
+	Oid const_type;
+	op_input_types(opno, &vector_type, &const_type);
+
+	VectorPredicate *predicate = get_vector_const_predicate(get_opcode(opno));
+	if (predicate == NULL)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("operator %u has no vectorized implementation", opno)));
+	}
+
+	if (vector_type != TEXTOID &&
+		(get_typlen(vector_type) <= 0 || get_typlen(vector_type) > 8 ||
+		 !get_typbyval(vector_type)))
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("only the text and fixed-length by-value types are supported")));
+	}
+
+	pg_prng_state prng;
+	pg_prng_seed(&prng, 0);
+	ArrowArray *arrow = bench_make_arrow(vector_type, batch_rows, null_fraction, &prng);
+	const Datum constvalue =
+		bench_make_value(const_type, (int) (selectivity * BENCH_DISTINCT_VALUES));
+
+	/*
+	 * The predicates are ANDed to the result bitmap, which starts as the
+	 * validity bitmap of the array, like in the decompression.
+	 */
+	const uint64 *validity = arrow->buffers[0];
+	const size_t bitmap_bytes = sizeof(uint64) * pad_to_multiple(64, batch_rows) / 64;
+	uint64 *result = palloc(bitmap_bytes);
+	uint64 passed = 0;
+
+	const int batches = Max(1, total_rows / batch_rows);
+	instr_time start;
+	instr_time duration;
+	INSTR_TIME_SET_CURRENT(start);
+	for (int i = 0; i < batches; i++)
+	{
+		memcpy(result, validity, bitmap_bytes);
+		predicate(arrow, constvalue, result);
+		passed += result[0];
+	}
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	/* Use the result so that the computation can't be optimized away. */
+	if (passed == PG_UINT64_MAX)
+		elog(DEBUG1, "unexpected predicate result");
+
+	const double seconds = INSTR_TIME_GET_DOUBLE(duration);
+	PG_RETURN_FLOAT8(seconds * 1e9 / ((double) batches * batch_rows));
+}
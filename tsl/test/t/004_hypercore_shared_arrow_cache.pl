@@ -0,0 +1,116 @@
+# This file and its contents are licensed under the Timescale License.
+# Please see the included NOTICE for copyright information and
+# LICENSE-TIMESCALE for a copy of the license.
+
+# This TAP test checks the arrow cache shared by all backends. The cache is
+# sized at server start, so it needs its own node. The test reads a
+# hypercore from several sessions while the compressed tuples are merged,
+# vacuumed and frozen, so that new compressed tuples reuse the TIDs of the
+# old ones, and checks the result against a plain table with the same data.
+
+use strict;
+use warnings;
+use TimescaleNode;
+use Test::More;
+
+my $node = TimescaleNode->create('shared_arrow_cache');
+$node->append_conf('postgresql.conf',
+	'timescaledb.hypercore_shared_arrow_cache_size=16MB');
+$node->restart;
+
+my $server_version =
+  $node->safe_psql('postgres', "SELECT current_setting('server_version_num')::int");
+if ($server_version < 170000)
+{
+	plan skip_all => 'the shared arrow cache requires PostgreSQL 17';
+}
+
+$node->safe_psql(
+	'postgres', q{
+	SELECT _timescaledb_functions.stop_background_workers();
+	CREATE TABLE readings(time timestamptz NOT NULL, device int, value int);
+	SELECT create_hypertable('readings', 'time', create_default_indexes => false);
+	ALTER TABLE readings SET (timescaledb.compress_segmentby = 'device',
+							  timescaledb.compress_orderby = 'time');
+	CREATE TABLE readings_ref(time timestamptz NOT NULL, device int, value int);
+	INSERT INTO readings SELECT t, d, d * 1000 + extract(minute from t)
+	FROM generate_series('2024-01-01 00:00'::timestamptz, '2024-01-01 02:00', '1 minute') t,
+		 generate_series(1, 3) d;
+	INSERT INTO readings_ref SELECT * FROM readings;
+	SELECT count(compress_chunk(ch, hypercore_use_access_method => true))
+	FROM show_chunks('readings') ch;
+});
+
+my $compressed = $node->safe_psql(
+	'postgres', q{
+	SELECT format('%I.%I', c2.schema_name, c2.table_name)
+	FROM _timescaledb_catalog.chunk c1
+	JOIN _timescaledb_catalog.chunk c2 ON c1.compressed_chunk_id = c2.id
+	JOIN _timescaledb_catalog.hypertable h ON c1.hypertable_id = h.id
+	WHERE h.table_name = 'readings'
+});
+
+my $query = q{
+	SET enable_indexscan = off;
+	SET enable_bitmapscan = off;
+	SELECT device, count(*), sum(value), min(time), max(time)
+	FROM %s GROUP BY device ORDER BY device;
+};
+
+# Each call runs in its own session, so the arrays can only come from the
+# decompression or the shared cache.
+sub check_readings
+{
+	my ($description) = @_;
+	my $expected = $node->safe_psql('postgres', sprintf($query, 'readings_ref'));
+	is($node->safe_psql('postgres', sprintf($query, 'readings')),
+		$expected, "$description: first session");
+	is($node->safe_psql('postgres', sprintf($query, 'readings')),
+		$expected, "$description: second session");
+}
+
+sub merge_device
+{
+	my ($device, $minute) = @_;
+	$node->safe_psql(
+		'postgres', qq{
+		INSERT INTO readings VALUES ('2024-01-01 00:00'::timestamptz + interval '$minute seconds',
+									 $device, -$minute);
+		INSERT INTO readings_ref VALUES ('2024-01-01 00:00'::timestamptz + interval '$minute seconds',
+										 $device, -$minute);
+		SELECT count(compress_chunk(ch)) FROM show_chunks('readings') ch;
+	});
+}
+
+check_readings('after compression');
+
+my $explain = $node->safe_psql(
+	'postgres', q{
+	SET enable_indexscan = off;
+	SET enable_bitmapscan = off;
+	EXPLAIN (analyze, costs off, timing off, summary off, decompress_cache_stats)
+	SELECT device, sum(value) FROM readings GROUP BY device;
+});
+like($explain, qr/shared_hits=\d+/, 'arrays are found in the shared cache');
+
+$node->safe_psql('postgres', "VACUUM FREEZE $compressed");
+check_readings('after freezing');
+
+# Merge new rows into the batch of one device twice, with a vacuum in
+# between, so that the second merge can put the new compressed tuple at the
+# TID freed by the first one. Freezing it gives it the same visible xmin as
+# the frozen tuple that was there before.
+merge_device(1, 1);
+check_readings('after the first merge');
+$node->safe_psql('postgres', "VACUUM $compressed");
+merge_device(1, 2);
+$node->safe_psql('postgres', "VACUUM FREEZE $compressed");
+check_readings('after the second merge');
+
+merge_device(2, 3);
+$node->safe_psql('postgres', "VACUUM FREEZE $compressed");
+merge_device(2, 4);
+$node->safe_psql('postgres', "VACUUM FREEZE $compressed");
+check_readings('after merging another device');
+
+done_testing();
@@ -0,0 +1,97 @@
+# This file and its contents are licensed under the Timescale License.
+# Please see the included NOTICE for copyright information and
+# LICENSE-TIMESCALE for a copy of the license.
+
+# This TAP test checks the pooled job runners, see src/bgw/job_runner.c. It
+# needs the real scheduler and waits for the runners to expire, so it cannot
+# be a regression test. It checks that a runner runs the next job of the
+# same owner, that the job can be deleted while the runner that ran it is
+# idle, and that the runners exit at the end of their lifetime and after
+# being idle for a minute.
+
+use strict;
+use warnings;
+use TimescaleNode;
+use Test::More;
+
+my $node = TimescaleNode->create('bgw_job_runner');
+
+$node->safe_psql(
+	'postgres', q{
+	ALTER SYSTEM SET timescaledb.bgw_job_runner_lifetime = '10min';
+	SELECT pg_reload_conf();
+	CREATE TABLE job_log(job_id int, pid int);
+	CREATE PROCEDURE log_job(job_id int, config jsonb) LANGUAGE SQL AS
+	$$ INSERT INTO job_log VALUES (job_id, pg_backend_pid()) $$;
+});
+
+# Add a job and return its id and the pid of the worker that ran it, once
+# the job finished.
+sub run_job
+{
+	my $job_id = $node->safe_psql('postgres',
+		q{SELECT add_job('log_job', '1 hour', initial_start => now())});
+
+	ok( $node->poll_query_until(
+			'postgres', qq{
+		SELECT total_successes = 1 FROM _timescaledb_internal.bgw_job_stat
+		WHERE job_id = $job_id
+	}), "job $job_id finished");
+
+	my $pid = $node->safe_psql('postgres',
+		"SELECT pid FROM job_log WHERE job_id = $job_id");
+	return ($job_id, $pid);
+}
+
+sub runner_exited
+{
+	my ($pid) = @_;
+	return $node->poll_query_until('postgres',
+		"SELECT count(*) = 0 FROM pg_stat_activity WHERE pid = $pid");
+}
+
+my ($job1, $pid1) = run_job();
+my ($job2, $pid2) = run_job();
+is($pid2, $pid1, 'the runner of the first job ran the second job');
+
+# The runner is idle and holds no lock on the jobs it ran, so deleting them
+# doesn't block.
+$node->safe_psql(
+	'postgres', qq{
+	SET lock_timeout = '5s';
+	SELECT delete_job($job1);
+	SELECT delete_job($job2);
+});
+is( $node->safe_psql(
+		'postgres', "SELECT count(*) FROM pg_stat_activity WHERE pid = $pid1"),
+	'1',
+	'the runner is still idle after deleting its jobs');
+
+# The idle runner exits at the end of its lifetime, and the next job runs on
+# a new runner.
+$node->safe_psql(
+	'postgres', q{
+	ALTER SYSTEM SET timescaledb.bgw_job_runner_lifetime = '1s';
+	SELECT pg_reload_conf();
+});
+ok(runner_exited($pid1), 'the runner exited at the end of its lifetime');
+
+my ($job3, $pid3) = run_job();
+isnt($pid3, $pid1, 'the job after the lifetime ran on a new runner');
+ok(runner_exited($pid3), 'the new runner exited at the end of its lifetime');
+
+# A runner exits when it doesn't get a job for a minute.
+$node->safe_psql(
+	'postgres', q{
+	ALTER SYSTEM SET timescaledb.bgw_job_runner_lifetime = '10min';
+	SELECT pg_reload_conf();
+});
+
+my ($job4, $pid4) = run_job();
+is( $node->safe_psql(
+		'postgres', "SELECT count(*) FROM pg_stat_activity WHERE pid = $pid4"),
+	'1',
+	'the runner is idle after the job');
+ok(runner_exited($pid4), 'the idle runner exited');
+
+done_testing();